@@ -13,7 +13,7 @@ function(${PROJECT_NAME}_cxx_compile_options target)
                 -fno-strict-aliasing            # TODO: add a note
                 -fno-var-tracking-assignments   # Turn off variable tracking
                 -fpermissive                    # Downgrade some diagnostics about nonconformant code from errors to warnings.
-                -march=core-avx2                # Specify the name of the target architecture
+                -march=${cxxTargetArch}         # Specify the name of the target architecture
                 -mavx                           # x86 options
                 -pipe                           # Use pipes rather than intermediate files.
                 -pthread                        # Define additional macros required for using the POSIX threads library.
@@ -38,7 +38,7 @@ function(${PROJECT_NAME}_cxx_compile_options target)
         target_compile_options(${target}
             # TODO: Some if not all of these should probably be PUBLIC
             PRIVATE
-                -march=core-avx2                # Specify the name of the target architecture
+                -march=${cxxTargetArch}         # Specify the name of the target architecture
                 -fdelayed-template-parsing      # Shader.h has a template method that uses a moonray class which is no available to scene_rdl2 and is only used in moonray+
                 -Wno-deprecated-declarations    # disable auto_ptr deprecated warnings from log4cplus-1.
                 -Wno-unused-value               # caused by opt-debug build and MNRY_VERIFY.
@@ -55,7 +55,7 @@ function(${PROJECT_NAME}_cxx_compile_options target)
         target_compile_options(${target}
             # TODO: Some if not all of these should probably be PUBLIC
             PRIVATE
-                -march=core-avx2                # Specify the name of the target architecture
+                -march=${cxxTargetArch}         # Specify the name of the target architecture
                 -mavx
                 -Qoption,cpp,--print_include_stack
                 -fmerge-debug-strings
@@ -67,6 +67,38 @@ function(${PROJECT_NAME}_cxx_compile_options target)
     endif()
 endfunction()
 
+# ISPC targets
+# Several targets build one object per target plus a dispatch object which
+# picks the best target the cpu supports at run time, so one build runs at
+# its best on a farm mixing AVX2 and AVX-512 nodes. The C++ code shares the
+# layout of the ray and intersection bundles with the ISPC code, sized by the
+# compile time VLEN, so all the targets must have the same gang width, e.g.
+# avx2-i32x8;avx512skx-i32x8, or avx512skx-i32x16 alone for the 16 wide
+# pipeline.
+if(${PROJECT_NAME_UPPER}_ISPC_INSTRUCTION_SETS)
+    set(GLOBAL_ISPC_INSTRUCTION_SETS ${${PROJECT_NAME_UPPER}_ISPC_INSTRUCTION_SETS})
+endif()
+string(REPLACE "," ";" GLOBAL_ISPC_INSTRUCTION_SETS "${GLOBAL_ISPC_INSTRUCTION_SETS}")
+set(ispcGangWidth "")
+foreach(isa ${GLOBAL_ISPC_INSTRUCTION_SETS})
+    string(REGEX MATCH "x[0-9]+$" isaGangWidth ${isa})
+    if(ispcGangWidth AND NOT isaGangWidth STREQUAL ispcGangWidth)
+        message(FATAL_ERROR "ISPC targets ${GLOBAL_ISPC_INSTRUCTION_SETS} have different gang widths")
+    endif()
+    set(ispcGangWidth ${isaGangWidth})
+endforeach()
+
+# The C++ VLEN follows the ISA the C++ code is compiled for, 8 lanes with AVX2
+# and 16 with AVX-512, so 16 wide ISPC targets (avx512skx-i32x16,
+# avx512spr-x16) need the C++ code compiled for AVX-512 as well.
+set(cxxTargetArch core-avx2)
+if(ispcGangWidth STREQUAL "x16")
+    set(cxxTargetArch skylake-avx512)
+    if(GLOBAL_ISPC_INSTRUCTION_SETS MATCHES "avx512spr")
+        set(cxxTargetArch sapphirerapids)
+    endif()
+endif()
+
 # ISPC compiler
 function(${PROJECT_NAME}_ispc_compile_options target)
     set(commonOptions
@@ -86,6 +118,8 @@ function(${PROJECT_NAME}_ispc_compile_options target)
         get_target_property(ISPC_HEADER_SUFFIX ${target} ISPC_HEADER_SUFFIX)
         get_target_property(ISPC_HEADER_DIRECTORY ${target} ISPC_HEADER_DIRECTORY)
         get_target_property(ISPC_INSTRUCTION_SETS ${target} ISPC_INSTRUCTION_SETS)
+        list(LENGTH ISPC_INSTRUCTION_SETS numIspcTargets)
+        string(REPLACE ";" "," ispcTargets "${ISPC_INSTRUCTION_SETS}")
 
         set(configDepFlags "")
         if (CMAKE_BUILD_TYPE STREQUAL "Debug")
@@ -117,14 +151,25 @@ function(${PROJECT_NAME}_ispc_compile_options target)
             
             set(objOut "${CMAKE_CURRENT_BINARY_DIR}/${srcName}.o")
             set(depFile "${CMAKE_CURRENT_BINARY_DIR}/${srcName}.dep")
+
+            # With several targets ispc also writes <name>_<isa>.o per target,
+            # objOut being the dispatch code.
+            set(isaObjs "")
+            if(numIspcTargets GREATER 1)
+                foreach(isa ${ISPC_INSTRUCTION_SETS})
+                    string(REGEX REPLACE "-.*$" "" isaName ${isa})
+                    list(APPEND isaObjs "${CMAKE_CURRENT_BINARY_DIR}/${srcName}_${isaName}.o")
+                endforeach()
+            endif()
+
             add_custom_command(
-                OUTPUT ${objOut}
+                OUTPUT ${objOut} ${isaObjs}
                 COMMAND ${ISPC_COMPILER} ${CMAKE_CURRENT_SOURCE_DIR}/${src}
                     -o ${objOut}
                     -h "./${ISPC_HEADER_DIRECTORY}/${srcName}${ISPC_HEADER_SUFFIX}"
                     -M -MF ${depFile}
                     --arch=aarch64                      # TODO: harcoded...
-                    --target=${ISPC_INSTRUCTION_SETS}
+                    --target=${ispcTargets}
                     --target-os=macos
                     ${commonOptions}
                     ${configDepFlags}
@@ -134,7 +179,7 @@ function(${PROJECT_NAME}_ispc_compile_options target)
                 VERBATIM
                 DEPFILE ${depFile}
                 DEPENDS ${CMAKE_CURRENT_SOURCE_DIR}/${src})
-            list(APPEND ISPC_TARGET_OBJECTS ${objOut})
+            list(APPEND ISPC_TARGET_OBJECTS ${objOut} ${isaObjs})
         endforeach()
         target_link_libraries(${target}
                 PRIVATE ${ISPC_TARGET_OBJECTS})
@@ -0,0 +1,745 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+// moonray_bench renders a suite of reference scenes in each execution mode and
+// reports, for each scene and mode, the render prep time, the mcrt time, the
+// ray and sample throughput, the peak memory and the mcrt time breakdown of the
+// profile accumulators as JSON. Given the JSON of an earlier run as a baseline,
+// it flags the metrics which regressed by more than a threshold and exits with
+// a non zero status, so a CI job can catch a performance regression before it
+// reaches the farm.
+//
+// Each scene and mode renders in a child process: the render driver and its
+// thread local state are global and set up once per process for one execution
+// mode, and the peak memory of a process is only meaningful for a single render.
+//
+
+#include <moonray/rendering/mcrt_common/ExecutionMode.h>
+#include <moonray/rendering/mcrt_common/ProfileAccumulator.h>
+#include <moonray/rendering/pbr/core/Statistics.h>
+#include <moonray/rendering/rndr/RenderContext.h>
+#include <moonray/rendering/rndr/RenderDriver.h>
+#include <moonray/rendering/rndr/RenderOptions.h>
+#include <moonray/rendering/rndr/RenderStatistics.h>
+#include <scene_rdl2/render/logging/logging.h>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace {
+
+const char *const sUsage =
+"Usage: moonray_bench [options] [-- moonray options]\n"
+"\n"
+"    -scenes dir\n"
+"        Render every .rdla and .rdlb file of dir, the reference scenes are\n"
+"        installed in share/moonray_bench/scenes. May appear more than once.\n"
+"\n"
+"    -scene file.rdl{a|b}\n"
+"        Render this scene. May appear more than once.\n"
+"\n"
+"    -modes scalar,vector,xpu\n"
+"        Comma separated execution modes to render each scene in (default).\n"
+"        xpu falls back to vector when no GPU is available, the mode which\n"
+"        actually rendered is reported.\n"
+"\n"
+"    -repeat n\n"
+"        Render each scene and mode n times and keep the fastest run\n"
+"        (default 1).\n"
+"\n"
+"    -json results.json\n"
+"        Write the results to this file, stdout by default.\n"
+"\n"
+"    -baseline baseline.json\n"
+"        Compare the results with those of an earlier run. The exit status\n"
+"        is 1 if any metric regressed by more than the threshold.\n"
+"\n"
+"    -threshold 0.1\n"
+"        Relative regression allowed for the times and throughputs\n"
+"        (default 0.1, i.e. 10%).\n"
+"\n"
+"    -memory_threshold 0.05\n"
+"        Relative regression allowed for the peak memory (default 0.05).\n"
+"\n"
+"    -- moonray options\n"
+"        The options after -- are passed on to each render, as for moonray\n"
+"        (e.g. -- -threads 16 -dso_path path).\n";
+
+struct BenchCase
+{
+    std::string mName;  // scene file name without directory and extension
+    std::string mScene;
+    std::string mMode;
+};
+
+struct BenchResult
+{
+    std::string mName;
+    std::string mMode;
+    std::string mExecMode; // the mode which actually rendered
+    bool mOk {false};
+    std::string mError;
+
+    double mRenderPrepTime {0.0};
+    double mMcrtTime {0.0};
+    double mRaysPerSec {0.0};
+    double mSamplesPerSec {0.0};
+    double mPeakMemoryMb {0.0};
+
+    // mcrt time breakdown, average seconds per thread
+    std::map<std::string, double> mAccumulators;
+};
+
+// A metric compared against the baseline, lower is better unless mHigherIsBetter.
+struct Metric
+{
+    const char *mName;
+    double BenchResult::*mValue;
+    bool mHigherIsBetter;
+    bool mIsMemory;
+};
+
+const Metric sMetrics[] = {
+    { "render_prep_sec", &BenchResult::mRenderPrepTime, false, false },
+    { "mcrt_sec",        &BenchResult::mMcrtTime,       false, false },
+    { "rays_per_sec",    &BenchResult::mRaysPerSec,     true,  false },
+    { "samples_per_sec", &BenchResult::mSamplesPerSec,  true,  false },
+    { "peak_memory_mb",  &BenchResult::mPeakMemoryMb,   false, true  },
+};
+
+std::string
+execModeName(mcrt_common::ExecutionMode mode)
+{
+    switch (mode) {
+    case mcrt_common::ExecutionMode::AUTO:       return "auto";
+    case mcrt_common::ExecutionMode::VECTORIZED: return "vector";
+    case mcrt_common::ExecutionMode::SCALAR:     return "scalar";
+    case mcrt_common::ExecutionMode::XPU:        return "xpu";
+    default:                                     return "unknown";
+    }
+}
+
+//----------------------------------------------------------------------------
+// JSON output, and a reader for the subset of JSON written here.
+
+std::string
+jsonString(const std::string &str)
+{
+    std::string result = "\"";
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            result += buf;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+void
+writeResultJson(std::ostream &out, const BenchResult &result, const char *indent)
+{
+    out << indent << "{\n";
+    out << indent << "  \"scene\": " << jsonString(result.mName) << ",\n";
+    out << indent << "  \"mode\": " << jsonString(result.mMode) << ",\n";
+    if (!result.mOk) {
+        out << indent << "  \"error\": " << jsonString(result.mError) << "\n";
+        out << indent << "}";
+        return;
+    }
+    out << indent << "  \"exec_mode\": " << jsonString(result.mExecMode) << ",\n";
+    for (const Metric &metric : sMetrics) {
+        out << indent << "  " << jsonString(metric.mName) << ": " << result.*metric.mValue << ",\n";
+    }
+    out << indent << "  \"mcrt_breakdown\": {";
+    const char *sep = "\n";
+    for (const auto &acc : result.mAccumulators) {
+        out << sep << indent << "    " << jsonString(acc.first) << ": " << acc.second;
+        sep = ",\n";
+    }
+    out << "\n" << indent << "  }\n";
+    out << indent << "}";
+}
+
+void
+writeJson(std::ostream &out, const std::vector<BenchResult> &results, const std::string &threads)
+{
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    const std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"host\": " << jsonString(host) << ",\n";
+    out << "  \"date\": " << jsonString(date) << ",\n";
+    out << "  \"threads\": " << jsonString(threads) << ",\n";
+    out << "  \"results\": [";
+    const char *sep = "\n";
+    for (const BenchResult &result : results) {
+        out << sep;
+        writeResultJson(out, result, "    ");
+        sep = ",\n";
+    }
+    out << "\n  ]\n";
+    out << "}\n";
+}
+
+// Reads the "results" of a JSON file written by writeJson(), anything else
+// is skipped.
+class ResultReader
+{
+public:
+    explicit ResultReader(const std::string &text) : mText(text) {}
+
+    bool read(std::vector<BenchResult> &results)
+    {
+        skipSpace();
+        if (!consume('{')) return false;
+        while (true) {
+            std::string key;
+            if (!readString(key) || !consume(':')) return false;
+            if (key == "results") {
+                if (!readResults(results)) return false;
+            } else if (!skipValue()) {
+                return false;
+            }
+            if (consume(',')) continue;
+            return consume('}');
+        }
+    }
+
+private:
+    bool readResults(std::vector<BenchResult> &results)
+    {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        do {
+            BenchResult result;
+            if (!consume('{')) return false;
+            do {
+                std::string key;
+                if (!readString(key) || !consume(':')) return false;
+                if (key == "scene") {
+                    if (!readString(result.mName)) return false;
+                } else if (key == "mode") {
+                    if (!readString(result.mMode)) return false;
+                } else if (key == "exec_mode") {
+                    if (!readString(result.mExecMode)) return false;
+                } else if (key == "error") {
+                    if (!readString(result.mError)) return false;
+                } else if (key == "mcrt_breakdown") {
+                    if (!readNumbers(result.mAccumulators)) return false;
+                } else if (const Metric *metric = findMetric(key)) {
+                    if (!readNumber(result.*metric->mValue)) return false;
+                } else if (!skipValue()) {
+                    return false;
+                }
+            } while (consume(','));
+            if (!consume('}')) return false;
+            result.mOk = result.mError.empty();
+            results.push_back(result);
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool readNumbers(std::map<std::string, double> &numbers)
+    {
+        if (!consume('{')) return false;
+        if (consume('}')) return true;
+        do {
+            std::string key;
+            if (!readString(key) || !consume(':') || !readNumber(numbers[key])) return false;
+        } while (consume(','));
+        return consume('}');
+    }
+
+    static const Metric *findMetric(const std::string &name)
+    {
+        for (const Metric &metric : sMetrics) {
+            if (name == metric.mName) return &metric;
+        }
+        return nullptr;
+    }
+
+    void skipSpace()
+    {
+        while (mPos < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPos]))) ++mPos;
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (mPos < mText.size() && mText[mPos] == c) {
+            ++mPos;
+            return true;
+        }
+        return false;
+    }
+
+    bool readString(std::string &str)
+    {
+        if (!consume('"')) return false;
+        str.clear();
+        while (mPos < mText.size() && mText[mPos] != '"') {
+            if (mText[mPos] == '\\' && mPos + 1 < mText.size()) {
+                ++mPos;
+                if (mText[mPos] == 'u' && mPos + 4 < mText.size()) {
+                    str += static_cast<char>(std::strtol(mText.substr(mPos + 1, 4).c_str(), nullptr, 16));
+                    mPos += 5;
+                    continue;
+                }
+            }
+            str += mText[mPos++];
+        }
+        return consume('"');
+    }
+
+    bool readNumber(double &value)
+    {
+        skipSpace();
+        const char *begin = mText.c_str() + mPos;
+        char *end = nullptr;
+        value = std::strtod(begin, &end);
+        if (end == begin) return false;
+        mPos += end - begin;
+        return true;
+    }
+
+    bool skipValue()
+    {
+        skipSpace();
+        if (mPos >= mText.size()) return false;
+        std::string str;
+        double number;
+        switch (mText[mPos]) {
+        case '"':
+            return readString(str);
+        case '{':
+            ++mPos;
+            if (consume('}')) return true;
+            do {
+                if (!readString(str) || !consume(':') || !skipValue()) return false;
+            } while (consume(','));
+            return consume('}');
+        case '[':
+            ++mPos;
+            if (consume(']')) return true;
+            do {
+                if (!skipValue()) return false;
+            } while (consume(','));
+            return consume(']');
+        default:
+            for (const char *word : { "true", "false", "null" }) {
+                if (mText.compare(mPos, std::strlen(word), word) == 0) {
+                    mPos += std::strlen(word);
+                    return true;
+                }
+            }
+            return readNumber(number);
+        }
+    }
+
+    const std::string &mText;
+    size_t mPos {0};
+};
+
+//----------------------------------------------------------------------------
+
+// Renders one scene in one mode, in the calling process.
+BenchResult
+renderCase(const BenchCase &benchCase, const std::vector<std::string> &moonrayArgs)
+{
+    BenchResult result;
+    result.mName = benchCase.mName;
+    result.mMode = benchCase.mMode;
+
+    std::vector<std::string> args = { "moonray_bench", "-in", benchCase.mScene, "-exec_mode", benchCase.mMode };
+    args.insert(args.end(), moonrayArgs.begin(), moonrayArgs.end());
+    std::vector<char *> argv;
+    for (std::string &arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    rndr::RenderOptions options;
+    options.parseFromCommandLine(static_cast<int>(args.size()), argv.data());
+
+    rndr::initGlobalDriver(options);
+    {
+        std::stringstream initMessages;
+        rndr::RenderContext renderContext(options, &initMessages);
+        renderContext.initialize(initMessages, rndr::RenderContext::LoggingConfiguration::ATHENA_DISABLED);
+        renderContext.setRenderMode(rndr::RenderMode::BATCH);
+
+        renderContext.startFrame();
+        while (!renderContext.isFrameComplete()) {
+            usleep(10000);
+        }
+        renderContext.stopFrame();
+
+        const pbr::Statistics &pbrStats = renderContext.getPbrStatistics();
+        rndr::RenderStats &renderStats = renderContext.getSceneRenderStats();
+        const double mcrtTime = pbrStats.mMcrtTime;
+        const double rays = static_cast<double>(pbrStats.getCounter(pbr::STATS_INTERSECTION_RAYS) +
+                                                pbrStats.getCounter(pbr::STATS_OCCLUSION_RAYS));
+        const double samples = static_cast<double>(pbrStats.getCounter(pbr::STATS_PIXEL_SAMPLES));
+
+        result.mExecMode = execModeName(static_cast<mcrt_common::ExecutionMode>(
+            rndr::getRenderDriver()->getFrameState().mExecutionMode));
+        result.mRenderPrepTime = renderStats.getTotalRenderPrepTime();
+        result.mMcrtTime = mcrtTime;
+        result.mRaysPerSec = (mcrtTime > 0.0) ? rays / mcrtTime : 0.0;
+        result.mSamplesPerSec = (mcrtTime > 0.0) ? samples / mcrtTime : 0.0;
+
+        std::vector<mcrt_common::AccumulatorResult> accumulators;
+        const unsigned numAccumulators = renderStats.snapshotAccumulators(&accumulators);
+        for (unsigned i = 0; i < numAccumulators; ++i) {
+            result.mAccumulators[accumulators[i].mName] = accumulators[i].mTimePerThread;
+        }
+    }
+    rndr::cleanUpGlobalDriver();
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.mPeakMemoryMb = usage.ru_maxrss / 1024.0; // KB on Linux
+
+    result.mOk = true;
+    return result;
+}
+
+// Renders one scene in one mode in a child process, which sends back its
+// result as JSON through a pipe.
+BenchResult
+runCase(const BenchCase &benchCase, const std::vector<std::string> &moonrayArgs)
+{
+    BenchResult failed;
+    failed.mName = benchCase.mName;
+    failed.mMode = benchCase.mMode;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        failed.mError = std::string("pipe failed: ") + std::strerror(errno);
+        return failed;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        failed.mError = std::string("fork failed: ") + std::strerror(errno);
+        return failed;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        BenchResult result;
+        try {
+            result = renderCase(benchCase, moonrayArgs);
+        } catch (const std::exception &e) {
+            result = failed;
+            result.mError = e.what();
+        }
+        std::ostringstream out;
+        out << std::setprecision(9) << "{ \"results\": [\n";
+        writeResultJson(out, result, "");
+        out << "\n] }\n";
+        const std::string text = out.str();
+        size_t written = 0;
+        while (written < text.size()) {
+            const ssize_t n = write(fds[1], text.data() + written, text.size() - written);
+            if (n <= 0) break;
+            written += n;
+        }
+        close(fds[1]);
+        _exit(result.mOk ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    std::string text;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        text.append(buf, n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    std::vector<BenchResult> results;
+    if (!ResultReader(text).read(results) || results.size() != 1) {
+        std::ostringstream err;
+        if (WIFSIGNALED(status)) {
+            err << "render crashed with signal " << WTERMSIG(status);
+        } else {
+            err << "render exited with status " << WEXITSTATUS(status);
+        }
+        failed.mError = err.str();
+        return failed;
+    }
+
+    return results[0];
+}
+
+// Keeps the faster of two runs of the same case, the peak memory is the max.
+void
+keepFastest(BenchResult &best, const BenchResult &run)
+{
+    if (!run.mOk) {
+        return;
+    }
+    if (!best.mOk) {
+        best = run;
+        return;
+    }
+    const double peakMemory = std::max(best.mPeakMemoryMb, run.mPeakMemoryMb);
+    if (run.mRenderPrepTime + run.mMcrtTime < best.mRenderPrepTime + best.mMcrtTime) {
+        best = run;
+    }
+    best.mPeakMemoryMb = peakMemory;
+}
+
+// Returns the number of regressions, printed to stderr.
+int
+compareWithBaseline(const std::vector<BenchResult> &results, const std::vector<BenchResult> &baseline,
+                    double threshold, double memoryThreshold)
+{
+    int numRegressions = 0;
+    for (const BenchResult &result : results) {
+        if (!result.mOk) {
+            std::cerr << "FAILED  " << result.mName << " [" << result.mMode << "]: " << result.mError << '\n';
+            ++numRegressions;
+            continue;
+        }
+        const auto base = std::find_if(baseline.begin(), baseline.end(), [&](const BenchResult &b) {
+            return b.mOk && b.mName == result.mName && b.mMode == result.mMode;
+        });
+        if (base == baseline.end()) {
+            std::cerr << "NEW     " << result.mName << " [" << result.mMode << "]: no baseline\n";
+            continue;
+        }
+        for (const Metric &metric : sMetrics) {
+            const double value = result.*metric.mValue;
+            const double reference = (*base).*metric.mValue;
+            if (reference <= 0.0) {
+                continue;
+            }
+            const double change = (value - reference) / reference;
+            const double allowed = metric.mIsMemory ? memoryThreshold : threshold;
+            const bool regressed = metric.mHigherIsBetter ? (change < -allowed) : (change > allowed);
+            if (regressed) {
+                ++numRegressions;
+            }
+            std::cerr << (regressed ? "REGRESS " : "ok      ") << result.mName << " [" << result.mMode << "] "
+                      << std::left << std::setw(16) << metric.mName << std::right
+                      << std::setw(12) << std::setprecision(4) << reference << " -> "
+                      << std::setw(12) << value
+                      << " (" << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%)"
+                      << std::noshowpos << std::defaultfloat << '\n';
+        }
+    }
+    return numRegressions;
+}
+
+std::vector<std::string>
+splitModes(const std::string &modes)
+{
+    std::vector<std::string> result;
+    std::stringstream ss(modes);
+    std::string mode;
+    while (std::getline(ss, mode, ',')) {
+        if (!mode.empty()) {
+            result.push_back(mode);
+        }
+    }
+    return result;
+}
+
+std::string
+sceneName(const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    const size_t dot = name.rfind('.');
+    return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+void
+listScenes(const std::string &dir, std::vector<std::string> &scenes)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        std::cerr << "moonray_bench: can't open scene directory " << dir << '\n';
+        exit(EXIT_FAILURE);
+    }
+    std::vector<std::string> found;
+    while (const dirent *entry = readdir(d)) {
+        const std::string name = entry->d_name;
+        const size_t dot = name.rfind('.');
+        if (dot != std::string::npos && (name.substr(dot) == ".rdla" || name.substr(dot) == ".rdlb")) {
+            found.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    std::sort(found.begin(), found.end());
+    scenes.insert(scenes.end(), found.begin(), found.end());
+}
+
+} // namespace
+
+int
+benchMain(int argc, char **argv)
+{
+    std::vector<std::string> scenes;
+    std::vector<std::string> modes = { "scalar", "vector", "xpu" };
+    std::vector<std::string> moonrayArgs;
+    std::string jsonFile;
+    std::string baselineFile;
+    int repeat = 1;
+    double threshold = 0.1;
+    double memoryThreshold = 0.05;
+    std::string threads = "all";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "moonray_bench: " << arg << " expects a value\n" << sUsage;
+                exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "-help" || arg == "--help") {
+            std::cerr << sUsage;
+            return EXIT_SUCCESS;
+        } else if (arg == "-scenes") {
+            listScenes(value(), scenes);
+        } else if (arg == "-scene") {
+            scenes.push_back(value());
+        } else if (arg == "-modes") {
+            modes = splitModes(value());
+        } else if (arg == "-repeat") {
+            repeat = std::max(1, std::atoi(value().c_str()));
+        } else if (arg == "-json") {
+            jsonFile = value();
+        } else if (arg == "-baseline") {
+            baselineFile = value();
+        } else if (arg == "-threshold") {
+            threshold = std::atof(value().c_str());
+        } else if (arg == "-memory_threshold") {
+            memoryThreshold = std::atof(value().c_str());
+        } else if (arg == "--") {
+            for (++i; i < argc; ++i) {
+                moonrayArgs.push_back(argv[i]);
+                if (moonrayArgs.back() == "-threads" && i + 1 < argc) {
+                    threads = argv[i + 1];
+                }
+            }
+        } else {
+            std::cerr << "moonray_bench: unknown option " << arg << '\n' << sUsage;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (scenes.empty()) {
+        std::cerr << "moonray_bench: no scene, use -scenes or -scene\n" << sUsage;
+        return EXIT_FAILURE;
+    }
+
+    // Read the baseline first, a typo in its path shouldn't cost a full run.
+    std::vector<BenchResult> baseline;
+    if (!baselineFile.empty()) {
+        std::ifstream in(baselineFile);
+        std::stringstream text;
+        text << in.rdbuf();
+        const std::string str = text.str();
+        if (!in || !ResultReader(str).read(baseline)) {
+            std::cerr << "moonray_bench: can't read baseline " << baselineFile << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    scene_rdl2::logging::Logger::init();
+
+    std::vector<BenchResult> results;
+    for (const std::string &scene : scenes) {
+        for (const std::string &mode : modes) {
+            const BenchCase benchCase { sceneName(scene), scene, mode };
+            BenchResult best;
+            best.mName = benchCase.mName;
+            best.mMode = mode;
+            for (int r = 0; r < repeat; ++r) {
+                std::cerr << "moonray_bench: " << benchCase.mName << " [" << mode << "] run "
+                          << (r + 1) << '/' << repeat << '\n';
+                const BenchResult run = runCase(benchCase, moonrayArgs);
+                if (!run.mOk) {
+                    best.mError = run.mError;
+                }
+                keepFastest(best, run);
+            }
+            results.push_back(best);
+        }
+    }
+
+    if (jsonFile.empty()) {
+        writeJson(std::cout, results, threads);
+    } else {
+        std::ofstream out(jsonFile);
+        writeJson(out, results, threads);
+        if (!out) {
+            std::cerr << "moonray_bench: can't write " << jsonFile << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    int status = EXIT_SUCCESS;
+    for (const BenchResult &result : results) {
+        if (!result.mOk) {
+            status = EXIT_FAILURE;
+        }
+    }
+    if (!baselineFile.empty()) {
+        const int numRegressions = compareWithBaseline(results, baseline, threshold, memoryThreshold);
+        std::cerr << "moonray_bench: " << numRegressions << " regression(s) against " << baselineFile << '\n';
+        if (numRegressions > 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
+
+} // namespace moonray
+
+int
+main(int argc, char **argv)
+{
+    return moonray::benchMain(argc, argv);
+}
@@ -16,6 +16,7 @@
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 
 using namespace moonray;
@@ -205,6 +206,24 @@ runTest(const TaskSettings &test, const Fresnel *omFPrime,
     float thetaInc = sHalfPi / viewAnglesTheta;
     float phyInc = sTwoPi / viewAnglesPhy;
 
+    // The view directions are integrated concurrently, on top of the
+    // samples of each direction, and printed in order afterwards.
+    const int viewCount = viewAnglesTheta * viewAnglesPhy;
+    std::vector<Color> RsImportance(viewCount);
+    tbb::parallel_for(0, viewCount, [&](int view) {
+        const int t = view / viewAnglesPhy;
+        const int p = view % viewAnglesPhy;
+
+        float theta = t * thetaInc;
+        float phy = p * phyInc;
+        Vec3f wo = shading::computeLocalSphericalDirection(
+            scene_rdl2::math::cos(theta), scene_rdl2::math::sin(theta), phy);
+        wo = test.frame.localToGlobal(wo);
+
+        Color RsUniform;
+        evalIntegral(test, wo, sampleCount, RsUniform, RsImportance[view]);
+    });
+
 #if PRINT_CSV
     printInfo("ThetaWo,Rs,Fprime,WeightedSum,Furnace");
 #endif
@@ -214,30 +233,24 @@ runTest(const TaskSettings &test, const Fresnel *omFPrime,
 
             float theta = t * thetaInc;
             float cosTheta = scene_rdl2::math::cos(theta);
-            float phy = p * phyInc;
-            Vec3f wo = shading::computeLocalSphericalDirection(
-                cosTheta, scene_rdl2::math::sin(theta), phy);
-            wo = test.frame.localToGlobal(wo);
+            const Color &Rs = RsImportance[t * viewAnglesPhy + p];
 
 #if !PRINT_CSV
+            float phy = p * phyInc;
             printInfo("----- thetaWo - %f , phiWo - %f -----",
                     theta / sPi * 180.0f,
                     phy / sPi * 180.0f);
 #endif
 
-            Color RsUniform;
-            Color RsImportance;
-            evalIntegral(test, wo, sampleCount, RsUniform, RsImportance);
-
             Color Fprime = Color(1.0f) - omFPrime->eval(cosTheta);
-            Color RsPlusOmFprime = RsImportance + (Color(1.0f) - Fprime);
+            Color RsPlusOmFprime = Rs + (Color(1.0f) - Fprime);
             Color RsPlusOmFprimeFurnace = Color(0.217f) * RsPlusOmFprime;
 
 #if PRINT_CSV
             printInfo("%f,%f,%f,%f,%f", theta / sPi * 180.0f,
-                    RsImportance.r, Fprime.r, RsPlusOmFprime.r, RsPlusOmFprimeFurnace.r);
+                    Rs.r, Fprime.r, RsPlusOmFprime.r, RsPlusOmFprimeFurnace.r);
 #else
-            printInfo("Rs importance = %f", RsImportance.r);
+            printInfo("Rs importance = %f", Rs.r);
             printInfo("Fprime        = %f", Fprime.r);
             printfInfo("Rs + (1-Fprime) = %f", RsPlusOmFprime.r);
             printfInfo("0.217 * (Rs + (1-Fprime)) = %f", RsPlusOmFprimeFurnace.r);
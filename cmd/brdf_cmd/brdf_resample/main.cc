@@ -12,6 +12,8 @@
 #include <scene_rdl2/render/util/Args.h>
 #include <scene_rdl2/render/logging/logging.h>
 
+#include <tbb/parallel_for.h>
+
 #include <string>
 #include <sstream>
 #include <exception>
@@ -42,8 +44,10 @@ reSampleBsdf(const std::vector<int> &phiValues,
 {
     MNRY_ASSERT(bsdf.getSizePhiH() == phiValues.size() * 2);
 
-    int size = phiValues.size();
-    for (int indexThetaH = 0; indexThetaH < bsdf.getSizeThetaH(); indexThetaH++) {
+    // Each thetaH bin writes its own part of the table and the slices are
+    // only read, so the bins are resampled in parallel.
+    const int size = phiValues.size();
+    tbb::parallel_for(0, bsdf.getSizeThetaH(), [&](int indexThetaH) {
         for (int indexPhiH = 0; indexPhiH < size; indexPhiH++) {
             for (int indexThetaD = 0; indexThetaD < bsdf.getSizeThetaD(); indexThetaD++) {
                 for (int indexPhiD = 0; indexPhiD < bsdf.getSizePhiD(); indexPhiD++) {
@@ -68,7 +72,7 @@ reSampleBsdf(const std::vector<int> &phiValues,
                 }
             }
         }
-    }
+    });
 }
 
 
@@ -0,0 +1,220 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include <moonray/rendering/pbr/core/DebugRay.h>
+
+#include <scene_rdl2/render/util/Args.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace moonray;
+
+//---------------------------------------------------------------------------
+
+void usage(char *argv0)
+{
+    std::cerr << "Queries the debug ray files streamed by moonray -debug_rays_stream" << std::endl;
+    std::cerr << "Usage: " << argv0 << " [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  -in a.0.rays [a.1.rays ...]  input stream files, one per render thread" << std::endl;
+    std::cerr << "  -viewport x0 y0 x1 y1        only the paths started in this pixel rectangle, inclusive" << std::endl;
+    std::cerr << "  -tags t                      only the vertices with any of these tag bits" << std::endl;
+    std::cerr << "  -match_all                   ... with all of the tag bits" << std::endl;
+    std::cerr << "  -depth min max               only the vertices of these bounces (0 = first hit)" << std::endl;
+    std::cerr << "  -list                        print the matching vertices, in world space" << std::endl;
+    std::cerr << "  -out rays.raydb              build a debug ray database from the paths in the" << std::endl;
+    std::cerr << "                               viewport, for the debug ray viewers" << std::endl;
+    std::cerr << "  -size w h                    image size of the database (default = the extent" << std::endl;
+    std::cerr << "                               of the recorded pixels)" << std::endl;
+}
+
+bool
+matchesFilter(const pbr::DebugRayVertex &vert, const pbr::DebugRayFilter &filter)
+{
+    if (vert.mDepth < filter.mMinDepth || vert.mDepth > filter.mMaxDepth) {
+        return false;
+    }
+    if (filter.mTags) {
+        const uint32_t maskedTags = vert.mUserTags & filter.mTags;
+        if ((!filter.mMatchAll && !maskedTags) || (filter.mMatchAll && maskedTags != filter.mTags)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+inViewport(const pbr::DebugRayVertex &vert, const scene_rdl2::math::BBox2i &viewport)
+{
+    // all the vertices of a path carry the pixel it started from
+    return int(vert.mScreenX) >= viewport.lower.x && int(vert.mScreenX) <= viewport.upper.x &&
+           int(vert.mScreenY) >= viewport.lower.y && int(vert.mScreenY) <= viewport.upper.y;
+}
+
+//---------------------------------------------------------------------------
+
+int
+main(int argc, char* argv[])
+{
+    try {
+        // Check for no flags or help flag.
+        if (argc == 1 || std::string(argv[1]) == "-h") {
+            usage(argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+
+        //------------------------------------
+
+        // Args parsing
+        scene_rdl2::util::Args args(argc, argv);
+        scene_rdl2::util::Args::StringArray values;
+
+        std::vector<std::string> inFilenames;
+        int foundAtIndex = args.getFlagValues("-in", -1 /*get all filenames*/, values);
+        while (foundAtIndex >= 0) {
+            inFilenames.insert(inFilenames.end(), values.begin(), values.end());
+            foundAtIndex = args.getFlagValues("-in", -1 /*get all filenames*/, values, foundAtIndex + 1);
+        }
+        if (inFilenames.empty()) {
+            usage(argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+
+        scene_rdl2::math::BBox2i viewport(scene_rdl2::math::Vec2i(0), scene_rdl2::math::Vec2i(0xffff));
+        if (args.getFlagValues("-viewport", 4, values) >= 0) {
+            viewport = scene_rdl2::math::BBox2i(scene_rdl2::math::Vec2i(std::stoi(values[0]), std::stoi(values[1])),
+                                                scene_rdl2::math::Vec2i(std::stoi(values[2]), std::stoi(values[3])));
+        }
+
+        // primary vertices have depth 255, the bounces count from 0
+        pbr::DebugRayFilter filter;
+        filter.mMinDepth = 0;
+        filter.mMaxDepth = 254;
+        if (args.getFlagValues("-tags", 1, values) >= 0) {
+            filter.mTags = uint32_t(std::stoul(values[0], nullptr, 0));
+        }
+        filter.mMatchAll = (args.getFlagValues("-match_all", 0, values) >= 0) ? 1 : 0;
+        if (args.getFlagValues("-depth", 2, values) >= 0) {
+            filter.mMinDepth = uint32_t(std::stoul(values[0]));
+            filter.mMaxDepth = uint32_t(std::stoul(values[1]));
+        }
+
+        const bool list = args.getFlagValues("-list", 0, values) >= 0;
+
+        std::string outFilename;
+        if (args.getFlagValues("-out", 1, values) >= 0) {
+            outFilename = values[0];
+        }
+
+        unsigned width = 0;
+        unsigned height = 0;
+        if (args.getFlagValues("-size", 2, values) >= 0) {
+            width = unsigned(std::stoul(values[0]));
+            height = unsigned(std::stoul(values[1]));
+        }
+
+        //------------------------------------
+
+        // Files are scanned a chunk at a time, only the vertices going into
+        // the database are kept.
+        size_t numChunks = 0;
+        size_t numVertices = 0;
+        size_t numPaths = 0;
+        size_t numSelectedPaths = 0;
+        size_t numMatches = 0;
+        std::vector<size_t> depthHistogram;
+        std::vector<pbr::DebugRayVertex> chunk;
+        std::vector<pbr::DebugRayVertex> selected;
+        scene_rdl2::math::Mat4f render2world(scene_rdl2::math::one);
+        unsigned maxX = 0;
+        unsigned maxY = 0;
+
+        for (const std::string &inFilename : inFilenames) {
+            pbr::DebugRayStreamReader reader;
+            if (!reader.open(inFilename.c_str())) {
+                return EXIT_FAILURE;
+            }
+            render2world = reader.getRenderToWorldMatrix();
+
+            chunk.clear();
+            while (reader.readChunk(&chunk)) {
+                ++numChunks;
+                for (const pbr::DebugRayVertex &vert : chunk) {
+                    ++numVertices;
+                    const bool isPrimary = vert.mParentId == uint32_t(-1);
+                    numPaths += isPrimary ? 1 : 0;
+                    maxX = std::max(maxX, unsigned(vert.mScreenX));
+                    maxY = std::max(maxY, unsigned(vert.mScreenY));
+
+                    if (!inViewport(vert, viewport)) {
+                        continue;
+                    }
+                    numSelectedPaths += isPrimary ? 1 : 0;
+                    if (!outFilename.empty()) {
+                        selected.push_back(vert);
+                    }
+                    if (!matchesFilter(vert, filter)) {
+                        continue;
+                    }
+
+                    ++numMatches;
+                    if (depthHistogram.size() <= vert.mDepth) {
+                        depthHistogram.resize(vert.mDepth + 1, 0);
+                    }
+                    ++depthHistogram[vert.mDepth];
+
+                    if (list) {
+                        const scene_rdl2::math::Vec3f p =
+                            scene_rdl2::math::transformPoint(render2world, vert.mHitPoint);
+                        std::cout << "pixel " << vert.mScreenX << " " << vert.mScreenY
+                                  << " thread " << vert.mThreadId << " id " << vert.mId
+                                  << " depth " << unsigned(vert.mDepth)
+                                  << " tags 0x" << std::hex << vert.mUserTags << std::dec
+                                  << " P (" << p.x << ", " << p.y << ", " << p.z << ")"
+                                  << " contribution (" << vert.mContribution.x << ", "
+                                  << vert.mContribution.y << ", " << vert.mContribution.z << ")\n";
+                    }
+                }
+                chunk.clear();
+            }
+        }
+
+        std::cout << "Files: " << inFilenames.size() << ", chunks: " << numChunks << "\n";
+        std::cout << "Vertices: " << numVertices << ", paths: " << numPaths << "\n";
+        std::cout << "Paths in viewport: " << numSelectedPaths << ", matching vertices: " << numMatches << "\n";
+        for (size_t depth = 0; depth < depthHistogram.size(); ++depth) {
+            if (depthHistogram[depth]) {
+                std::cout << "  depth " << depth << ": " << depthHistogram[depth] << "\n";
+            }
+        }
+
+        if (!outFilename.empty()) {
+            if (!width || !height) {
+                width = maxX + 1;
+                height = maxY + 1;
+            }
+            pbr::DebugRayBuilder builder;
+            pbr::DebugRayDatabase db;
+            if (!builder.build(width, height, &selected, render2world) || !builder.exportDatabase(&db)) {
+                std::cerr << "No rays to write to \"" << outFilename << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!db.save(outFilename.c_str())) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "Wrote " << db.getPrimaryRayIndices().size() << " paths, "
+                      << db.getRays().size() << " vertices to \"" << outFilename << "\"" << std::endl;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include <moonray/deepfile/DcxDeepMerge.h>
+
+#include <scene_rdl2/render/util/Args.h>
+
+#include <tbb/global_control.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+void usage(char *argv0)
+{
+    std::cerr << "Merges and compacts deep images" << std::endl;
+    std::cerr << "Usage: " << argv0 << " [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  -in a.exr [b.exr ...]      input deep files, e.g. the outputs of several render nodes." << std::endl;
+    std::cerr << "                             A single input is just compacted." << std::endl;
+    std::cerr << "  -out output.exr            merged output deep file (default = \"merged.exr\")" << std::endl;
+    std::cerr << "  -z_tolerance t             max relative depth difference of the segments collapsed" << std::endl;
+    std::cerr << "                             together (default = 0.001)" << std::endl;
+    std::cerr << "  -value_tolerance t         max relative difference of their channel values" << std::endl;
+    std::cerr << "                             (default = 0.001)" << std::endl;
+    std::cerr << "  -id channel                extra deep ID channel which must match exactly, the" << std::endl;
+    std::cerr << "                             channels of the \"deep\" layer always have to" << std::endl;
+    std::cerr << "  -band_height n             scanlines held in memory at once (default = 64)" << std::endl;
+    std::cerr << "  -threads n                 number of threads (default = all)" << std::endl;
+}
+
+//---------------------------------------------------------------------------
+
+int
+main(int argc, char* argv[])
+{
+    try {
+        // Check for no flags or help flag.
+        if (argc == 1 || std::string(argv[1]) == "-h") {
+            usage(argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+
+        //------------------------------------
+
+        // Args parsing
+        scene_rdl2::util::Args args(argc, argv);
+        scene_rdl2::util::Args::StringArray values;
+
+        std::vector<std::string> inFilenames;
+        int foundAtIndex = args.getFlagValues("-in", -1 /*get all filenames*/, values);
+        while (foundAtIndex >= 0) {
+            inFilenames.insert(inFilenames.end(), values.begin(), values.end());
+            foundAtIndex = args.getFlagValues("-in", -1 /*get all filenames*/, values, foundAtIndex + 1);
+        }
+        if (inFilenames.empty()) {
+            usage(argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::string outFilename = "merged.exr";
+        if (args.getFlagValues("-out", 1, values) >= 0) {
+            outFilename = values[0];
+        }
+
+        OPENDCX_INTERNAL_NAMESPACE::DeepMergeOptions options;
+        if (args.getFlagValues("-z_tolerance", 1, values) >= 0) {
+            options.z_tolerance = std::stof(values[0]);
+        }
+        if (args.getFlagValues("-value_tolerance", 1, values) >= 0) {
+            options.value_tolerance = std::stof(values[0]);
+        }
+        foundAtIndex = args.getFlagValues("-id", 1, values);
+        while (foundAtIndex >= 0) {
+            options.id_channel_names.push_back(values[0]);
+            foundAtIndex = args.getFlagValues("-id", 1, values, foundAtIndex + 1);
+        }
+        if (args.getFlagValues("-band_height", 1, values) >= 0) {
+            options.band_height = std::stoi(values[0]);
+        }
+
+        std::unique_ptr<tbb::global_control> threadLimit;
+        if (args.getFlagValues("-threads", 1, values) >= 0) {
+            threadLimit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism,
+                                                      std::max(1, std::stoi(values[0]))));
+        }
+
+        //------------------------------------
+
+        std::cout << "Merging " << inFilenames.size() << " deep file(s) into \"" << outFilename << "\"" << std::endl;
+
+        const auto start = std::chrono::steady_clock::now();
+        const OPENDCX_INTERNAL_NAMESPACE::DeepMergeStats stats =
+            OPENDCX_INTERNAL_NAMESPACE::mergeDeepFiles(inFilenames, outFilename, options);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "Input segments: " << stats.input_segments << "\n";
+        std::cout << "Output segments: " << stats.output_segments << "\n";
+        std::cout << "Time: " << elapsed.count() << " s" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
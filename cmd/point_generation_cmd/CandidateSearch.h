@@ -0,0 +1,113 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "NPoint.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+// The best of the candidates for the next point of a progressive sequence.
+// Poisson candidates (score >= threshold) beat all the others, the first one
+// found wins. Otherwise the highest score wins, the lowest index on ties.
+template <unsigned D>
+struct CandidateResult
+{
+    NPoint<D> mPoint;
+    float mScore = -std::numeric_limits<float>::max();
+    unsigned mIndex = std::numeric_limits<unsigned>::max();
+    bool mPoisson = false;
+
+    bool found() const { return mIndex != std::numeric_limits<unsigned>::max(); }
+
+    bool isBetterThan(const CandidateResult& other) const
+    {
+        if (mPoisson != other.mPoisson) {
+            return mPoisson;
+        }
+        if (!mPoisson && mScore != other.mScore) {
+            return mScore > other.mScore;
+        }
+        return mIndex < other.mIndex;
+    }
+};
+
+// Evaluates up to 'numCandidates' random candidates in parallel and returns
+// the best one. 'score(candidate)' is called concurrently, so it may only read
+// the points and the acceleration grid. The search stops at the first wave of
+// candidates holding a Poisson one.
+//
+// Candidates are generated in fixed size chunks, each with its own generator
+// seeded from (seed, pointIndex, chunk), so the result does not depend on the
+// number of threads or on the scheduling.
+template <unsigned D, typename F>
+CandidateResult<D> findBestCandidate(uint32_t seed, unsigned pointIndex, unsigned numCandidates,
+                                     float poissonThreshold, const F& score)
+{
+    constexpr unsigned kChunkSize = 256;
+    constexpr unsigned kChunksPerWave = 256;
+
+    using Result = CandidateResult<D>;
+
+    const unsigned numChunks = (numCandidates + kChunkSize - 1) / kChunkSize;
+
+    Result best;
+    for (unsigned waveBegin = 0; waveBegin < numChunks; waveBegin += kChunksPerWave) {
+        const unsigned waveEnd = std::min(waveBegin + kChunksPerWave, numChunks);
+
+        // Chunks past the first Poisson one can't win, skip them.
+        std::atomic<unsigned> firstPoissonChunk(std::numeric_limits<unsigned>::max());
+
+        const Result waveBest = tbb::parallel_reduce(
+            tbb::blocked_range<unsigned>(waveBegin, waveEnd, 1),
+            Result(),
+            [&](const tbb::blocked_range<unsigned>& r, Result result) {
+                for (unsigned chunk = r.begin(); chunk != r.end(); ++chunk) {
+                    if (chunk > firstPoissonChunk.load(std::memory_order_relaxed)) {
+                        break;
+                    }
+                    std::seed_seq seq{seed, pointIndex, chunk};
+                    std::mt19937 rng(seq);
+
+                    const unsigned begin = chunk * kChunkSize;
+                    const unsigned end = std::min(begin + kChunkSize, numCandidates);
+                    for (unsigned k = begin; k < end; ++k) {
+                        Result candidate;
+                        candidate.mPoint = generateRandomPoint<D>(rng);
+                        candidate.mScore = score(candidate.mPoint);
+                        candidate.mIndex = k;
+                        candidate.mPoisson = candidate.mScore >= poissonThreshold;
+                        if (candidate.isBetterThan(result)) {
+                            result = candidate;
+                        }
+                        if (candidate.mPoisson) {
+                            unsigned current = firstPoissonChunk.load(std::memory_order_relaxed);
+                            while (chunk < current &&
+                                   !firstPoissonChunk.compare_exchange_weak(current, chunk)) {
+                            }
+                            break;
+                        }
+                    }
+                }
+                return result;
+            },
+            [](const Result& a, const Result& b) {
+                return a.isBetterThan(b) ? a : b;
+            });
+
+        if (waveBest.isBetterThan(best)) {
+            best = waveBest;
+        }
+        if (best.mPoisson) {
+            break;
+        }
+    }
+    return best;
+}
@@ -409,6 +409,21 @@ inline void writePoints(const std::vector<NPoint<D>>& points, std::ostream& outs
     }
 }
 
+// Writes the points as packed native floats with no header, the layout of the
+// tables under lib/rendering/pbr/sampler which are linked into the renderer
+// and used in place.
+template <unsigned D>
+inline void writeBinaryPoints(const std::vector<NPoint<D>>& points, std::ostream& outs)
+{
+    outs.exceptions(std::ios_base::failbit);
+    for (const auto& p : points) {
+        for (unsigned i = 0; i < D; ++i) {
+            const float f = p[i];
+            outs.write(reinterpret_cast<const char*>(&f), sizeof(f));
+        }
+    }
+}
+
 inline unsigned gridIdx(float v, unsigned gridSize)
 {
     const unsigned r = static_cast<unsigned>(v * gridSize);
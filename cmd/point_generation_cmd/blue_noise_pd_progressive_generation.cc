@@ -6,6 +6,9 @@
 #include "ProgressBar.h"
 #include "util.h"
 #include "ArgumentParser.h"
+#include "CandidateSearch.h"
+
+#include <tbb/task_arena.h>
 
 #include <fstream>
 #include <iostream>
@@ -115,16 +118,13 @@ std::vector<NPoint<kDims>> run(std::uint32_t seed, unsigned numDesired)
     // We may get better results if we best-candidate our Poisson points, but it's probably very slow.
     unsigned pointsAdded = 1;
     float radiusWeight = kRadiusWeight;
+    unsigned search = 0; // seeds the candidates of each search
     for (pointsAdded = 1; pointsAdded < numDesired; ) {
         const float radiusFullDimension = radiusMax<kDims>(pointsAdded+0);
 
-        Point toAdd;
-        constexpr unsigned ncandidates = std::max(5'000'000u * kDims, 50'000u);
-        bool addPoint = false;
-        for (unsigned k = 0; k < ncandidates; ++k) {
-            const Point candidate = generateRandomPoint<kDims>(rng);
-
-            bool poisson = true;
+        // Candidates score 1 when they are Poisson in all the projections.
+        const Grid& searchGrid = grid;
+        auto poissonScore = [&](const Point& candidate) {
             for (const auto& projectionVector : projectionVectors) {
                 const auto effDim = effectiveDimension(projectionVector);
                 if (effDim == 0) {
@@ -141,18 +141,17 @@ std::vector<NPoint<kDims>> run(std::uint32_t seed, unsigned numDesired)
                     return SearchResult::SEARCH_COMPLETE;
                 };
 
-                if (grid.visitProjectedNeighbors(poissonCheck, candidate) == SearchResult::TERMINATED_EARLY) {
-                    poisson = false;
-                    break;
+                if (searchGrid.visitProjectedNeighbors(poissonCheck, candidate) == SearchResult::TERMINATED_EARLY) {
+                    return 0.0f;
                 }
             }
+            return 1.0f;
+        };
 
-            if (poisson) {
-                toAdd = candidate;
-                addPoint = true;
-                break;
-            }
-        }
+        constexpr unsigned ncandidates = std::max(5'000'000u * kDims, 50'000u);
+        const auto best = findBestCandidate<kDims>(seed, search++, ncandidates, 1.0f, poissonScore);
+        const bool addPoint = best.mPoisson;
+        const Point toAdd = best.mPoint;
         if (addPoint) {
             grid.add(toAdd);
             points.push_back(toAdd);
@@ -175,6 +174,8 @@ int main(int argc, const char* argv[])
 #if 1
     uint32_t seed = 0;
     unsigned count = 1024;
+    unsigned threads = 0;
+    bool binary = false;
     std::string filename("points.dat");
 
     try {
@@ -188,14 +189,25 @@ int main(int argc, const char* argv[])
         if (parser.has("-count")) {
             count = parser.getModifier<unsigned>("-count", 0);
         }
+        if (parser.has("-threads")) {
+            threads = parser.getModifier<unsigned>("-threads", 0);
+        }
+        binary = parser.has("-binary");
     } catch (std::exception& e) {
         std::cerr << e.what() << '\n';
         return EXIT_FAILURE;
     }
 
-    const auto points = run(seed, count);
+    // The candidates are evaluated on all the cores unless told otherwise.
+    tbb::task_arena arena(threads ? static_cast<int>(threads) : tbb::task_arena::automatic);
+    const auto points = arena.execute([&] { return run(seed, count); });
 
-    std::ofstream outs(filename);
-    writePoints(points, outs);
+    if (binary) {
+        std::ofstream outs(filename, std::ios::binary);
+        writeBinaryPoints(points, outs);
+    } else {
+        std::ofstream outs(filename);
+        writePoints(points, outs);
+    }
 #endif
 }
@@ -2,11 +2,14 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ArgumentParser.h"
+#include "CandidateSearch.h"
 #include "NPoint.h"
 #include "PerfectPowerArray.h"
 #include "ProgressBar.h"
 #include "util.h"
 
+#include <tbb/task_arena.h>
+
 #include <algorithm>
 #include <array>
 #include <fstream>
@@ -19,8 +22,6 @@
 #include <cmath>
 #include <cstddef>
 
-typedef std::mt19937 RNG;
-
 const unsigned kNoSample = std::numeric_limits<unsigned>::max();
 
 template <typename T>
@@ -49,8 +50,6 @@ std::vector<NPoint<kDims>> run(uint32_t seed, unsigned numDesired)
     typedef PerfectPowerArray<std::size_t, kDims> Grid;
     typedef NPoint<kDims> Point;
 
-    RNG rng(seed);
-
     std::vector<Point> points;
 
     ProgressBar progress(numDesired);
@@ -89,21 +88,16 @@ std::vector<NPoint<kDims>> run(uint32_t seed, unsigned numDesired)
             lastGridSize = numCells;
         }
 
-        Point bestCandidate;
-        float farthestD2 = 0.0f;
-        const unsigned ncandidates = std::max(5'000'000u * kDims, 50'000u);
-        for (unsigned k = 0; k < ncandidates; ++k) {
-            const Point candidate = generateRandomPoint<kDims>(rng);
-
-            // Check to see if candidate within 'radius' of other
-            // points. We check ourselves and the neighbors on either
-            // side.
+        // Check to see if a candidate is within 'radius' of other points. We
+        // check its cell and the neighbors on either side.
+        const Grid& searchGrid = *grid;
+        auto nearestDistanceSquared = [&points, &searchGrid](const Point& candidate) {
             constexpr unsigned nneighbors = powu(3, kDims);
             std::array<unsigned, nneighbors> otherPointIndices;
             unsigned arrayIdx = 0;
             auto f = [&otherPointIndices, &arrayIdx](unsigned idx) { otherPointIndices[arrayIdx++] = idx; };
-            const auto gridIdx = toGridLocation(candidate, grid->size());
-            grid->visitNeighbors(f, gridIdx.data());
+            const auto gridIdx = toGridLocation(candidate, searchGrid.size());
+            searchGrid.visitNeighbors(f, gridIdx.data());
 
             float nearestD2 = std::numeric_limits<float>::max();
             for (unsigned idx = 0; idx < nneighbors; ++idx) {
@@ -114,19 +108,16 @@ std::vector<NPoint<kDims>> run(uint32_t seed, unsigned numDesired)
                     nearestD2 = std::min(d2, nearestD2);
                 }
             }
+            return nearestD2;
+        };
 
-            if (nearestD2 >= radius*radius) {
-                // Is Poisson. We can stop looking.
-                bestCandidate = candidate;
-                ++poissonPointsAdded;
-                break;
-            }
-
-            if (nearestD2 > farthestD2) {
-                farthestD2 = nearestD2;
-                bestCandidate = candidate;
-            }
+        // A Poisson candidate ends the search.
+        const unsigned ncandidates = std::max(5'000'000u * kDims, 50'000u);
+        const auto best = findBestCandidate<kDims>(seed, i, ncandidates, radius*radius, nearestDistanceSquared);
+        if (best.mPoisson) {
+            ++poissonPointsAdded;
         }
+        const Point bestCandidate = best.mPoint;
         ++pointsAdded;
         points.push_back(bestCandidate);
         addSampleToGrid(bestCandidate, points.size() - 1u, *grid);
@@ -145,6 +136,8 @@ int main(int argc, const char* argv[])
 {
     uint32_t seed = 0;
     unsigned count = 1024;
+    unsigned threads = 0;
+    bool binary = false;
     std::string filename("points.dat");
 
     try {
@@ -158,13 +151,24 @@ int main(int argc, const char* argv[])
         if (parser.has("-count")) {
             count = parser.getModifier<unsigned>("-count", 0);
         }
+        if (parser.has("-threads")) {
+            threads = parser.getModifier<unsigned>("-threads", 0);
+        }
+        binary = parser.has("-binary");
     } catch (std::exception& e) {
         std::cerr << e.what() << '\n';
         return EXIT_FAILURE;
     }
 
-    const auto points = run(seed, count);
+    // The candidates are evaluated on all the cores unless told otherwise.
+    tbb::task_arena arena(threads ? static_cast<int>(threads) : tbb::task_arena::automatic);
+    const auto points = arena.execute([&] { return run(seed, count); });
 
-    std::ofstream outs(filename);
-    writePoints(points, outs);
+    if (binary) {
+        std::ofstream outs(filename, std::ios::binary);
+        writeBinaryPoints(points, outs);
+    } else {
+        std::ofstream outs(filename);
+        writePoints(points, outs);
+    }
 }
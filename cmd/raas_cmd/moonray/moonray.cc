@@ -1,21 +1,127 @@
 // Copyright 2023-2024 DreamWorks Animation LLC
 // SPDX-License-Identifier: Apache-2.0
 
+#include <moonray/application/MetricsServer.h>
 #include <moonray/application/RaasApplication.h>
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
+#include <moonray/rendering/pbr/camera/StereoView.h>
+#include <moonray/rendering/rndr/HeatMapReport.h>
+#include <moonray/rendering/rndr/ImageWriteDriver.h>
 #include <moonray/rendering/rndr/PixelBufferUtils.h>
 #include <moonray/rendering/rndr/RenderContext.h>
 #include <moonray/rendering/rndr/RenderDriver.h>
+#include <moonray/rendering/rndr/RenderOutputDriver.h>
+#include <moonray/rendering/rndr/RenderStatistics.h>
 #include <scene_rdl2/render/logging/logging.h>
 #include <scene_rdl2/render/util/Files.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
 using scene_rdl2::logging::Logger;
 
 namespace moonray {
 
+namespace {
+
+std::string
+insertBeforeExtension(const std::string& filename, const std::string& str)
+{
+    const std::size_t slashPos = filename.rfind('/');
+    const std::size_t dotPos = filename.rfind('.');
+    if (dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos)) {
+        return filename + str;
+    }
+    return std::string(filename).insert(dotPos, str);
+}
+
+std::string
+replaceExtension(const std::string& filename, const std::string& ext)
+{
+    const std::size_t slashPos = filename.rfind('/');
+    const std::size_t dotPos = filename.rfind('.');
+    if (dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos)) {
+        return filename + ext;
+    }
+    return filename.substr(0, dotPos) + ext;
+}
+
+// Replaces the <UDIM> token of a file name template with udim, or inserts
+// ".<udim>" before the extension when there is no token, so each bake writes
+// its own files.
+std::string
+substituteUdim(const std::string& filename, int udim)
+{
+    const std::string udimToken = "<UDIM>";
+    const std::string udimStr = std::to_string(udim);
+
+    std::string result = filename;
+    const std::size_t udimPos = result.find(udimToken);
+    if (udimPos != std::string::npos) {
+        return result.replace(udimPos, udimToken.size(), udimStr);
+    }
+
+    return insertBeforeExtension(result, '.' + udimStr);
+}
+
+// Replaces the first run of # of a file name template with frame, zero padded
+// to the length of the run. Without one, ".<frame>" padded to 4 digits is
+// inserted before the extension when insert is set, so each frame writes its
+// own files.
+std::string
+substituteFrame(const std::string& filename, int frame, bool insert)
+{
+    const std::size_t hashPos = filename.find('#');
+    if (hashPos == std::string::npos) {
+        if (!insert) {
+            return filename;
+        }
+        char frameStr[32];
+        snprintf(frameStr, sizeof(frameStr), ".%04d", frame);
+        return insertBeforeExtension(filename, frameStr);
+    }
+
+    std::size_t hashEnd = filename.find_first_not_of('#', hashPos);
+    if (hashEnd == std::string::npos) {
+        hashEnd = filename.size();
+    }
+    std::string frameStr = std::to_string(frame);
+    if (frameStr.size() < hashEnd - hashPos) {
+        frameStr.insert(0, hashEnd - hashPos - frameStr.size(), '0');
+    }
+    return std::string(filename).replace(hashPos, hashEnd - hashPos, frameStr);
+}
+
+// Replaces the %V and %v tokens of a file name template with the eye name
+// ("left", "right") and its initial, or inserts ".<eye>" before the extension
+// when there is no token, so each eye writes its own files.
+std::string
+substituteEye(const std::string& filename, const std::string& eye)
+{
+    std::string result = filename;
+    bool substituted = false;
+    for (std::size_t pos = result.find('%'); pos != std::string::npos && pos + 1 < result.size();
+         pos = result.find('%', pos + 1)) {
+        if (result[pos + 1] == 'V') {
+            result.replace(pos, 2, eye);
+            substituted = true;
+        } else if (result[pos + 1] == 'v') {
+            result.replace(pos, 2, eye.substr(0, 1));
+            substituted = true;
+        }
+    }
+    if (substituted) {
+        return result;
+    }
+
+    return insertBeforeExtension(result, '.' + eye);
+}
+
+} // namespace
+
 class RaasCommandLineApplication : public RaasApplication
 {
 public:
@@ -25,6 +131,11 @@ protected:
     void parseOptions();
     void render(rndr::RenderContext & renderContext);
     void renderOutput(rndr::RenderContext &renderContext);
+    int writeHeatMapReport(const rndr::RenderContext &renderContext, const std::string &outputFile);
+    void bakeUdims(rndr::RenderContext &renderContext);
+    void renderSequence(rndr::RenderContext &renderContext);
+    void renderStereoEyes(rndr::RenderContext &renderContext);
+    void waitBackgroundOutput();
     void run();
 };
 
@@ -84,23 +195,53 @@ RaasCommandLineApplication::renderOutput(rndr::RenderContext &renderContext)
 
     int error = writeImageWithMessage(&outputBuffer, outputFile, metadata, aperture, region);
 
+    // write the denoised beauty, denoised in process from the film
+    if (!mOptions.getDenoiseMode().empty()) {
+        scene_rdl2::fb_util::RenderBuffer denoisedBuffer;
+        std::string errorMsg;
+        if (renderContext.snapshotDenoisedRenderBuffer(&denoisedBuffer, true, errorMsg)) {
+            const std::string denoisedFile = mOptions.getDenoiseOutputFile().empty() ?
+                insertBeforeExtension(outputFile, ".denoised") : mOptions.getDenoiseOutputFile();
+            error += writeImageWithMessage(&denoisedBuffer, denoisedFile, metadata, aperture, region);
+        } else {
+            Logger::error("Failed to denoise: " + errorMsg);
+            ++error;
+        }
+    }
+
     // write any arbitrary RenderOutput objects
+    // The buffers are kept in the Film's tiled layout, the writer reads them through the tiler.
     const pbr::DeepBuffer *deepBuffer = renderContext.getDeepBuffer();
     pbr::CryptomatteBuffer *cryptomatteBuffer = renderContext.getCryptomatteBuffer();
     scene_rdl2::fb_util::HeatMapBuffer heatMapBuffer;
-    renderContext.snapshotHeatMapBuffer(&heatMapBuffer, /*untile*/ true, /*parallel*/ true); // internally only do snapshot when it has heatmapAOV
+    renderContext.snapshotHeatMapBuffer(&heatMapBuffer, /*untile*/ false, /*parallel*/ true); // internally only do snapshot when it has heatmapAOV
     scene_rdl2::fb_util::FloatBuffer weightBuffer;
-    renderContext.snapshotWeightBuffer(&weightBuffer, /*untile*/ true, /*parallel*/ true); // internally only do snapshot when it has weightAOV
+    renderContext.snapshotWeightBuffer(&weightBuffer, /*untile*/ false, /*parallel*/ true); // internally only do snapshot when it has weightAOV
     std::vector<scene_rdl2::fb_util::VariablePixelBuffer> aovBuffers;
-    renderContext.snapshotAovBuffers(aovBuffers, /*untile*/ true, /*parallel*/ true);
+    renderContext.snapshotAovBuffers(aovBuffers, /*untile*/ false, /*parallel*/ true);
     scene_rdl2::fb_util::RenderBuffer renderBufferOdd;
-    renderContext.snapshotRenderBufferOdd(&renderBufferOdd, /*untile*/ true, /*parallel*/ true);
+    renderContext.snapshotRenderBufferOdd(&renderBufferOdd, /*untile*/ false, /*parallel*/ true);
     std::vector<scene_rdl2::fb_util::VariablePixelBuffer> displayFilterBuffers;
-    renderContext.snapshotDisplayFilterBuffers(displayFilterBuffers, /*untile*/ true, /*parallel*/ true);
-    error += writeRenderOutputsWithMessages(renderContext.getRenderOutputDriver(),
-                                            deepBuffer, cryptomatteBuffer, &heatMapBuffer,
-                                            &weightBuffer, &renderBufferOdd, aovBuffers,
-                                            displayFilterBuffers);
+    renderContext.snapshotDisplayFilterBuffers(displayFilterBuffers, /*untile*/ false, /*parallel*/ true);
+    // With -background_output they are written while the next frame renders, see waitBackgroundOutput().
+    const bool enqueued = mOptions.getBackgroundOutput() &&
+                          enqRenderOutputs(renderContext.shareRenderOutputDriver(),
+                                           cryptomatteBuffer, &heatMapBuffer,
+                                           &weightBuffer, &renderBufferOdd, aovBuffers,
+                                           displayFilterBuffers,
+                                           /*tiled*/ true);
+    if (!enqueued) {
+        error += writeRenderOutputsWithMessages(renderContext.getRenderOutputDriver(),
+                                                deepBuffer, cryptomatteBuffer, &heatMapBuffer,
+                                                &weightBuffer, &renderBufferOdd, aovBuffers,
+                                                displayFilterBuffers,
+                                                /*tiled*/ true);
+    }
+    renderContext.getSceneRenderStats().logImageWriteStats();
+
+    if (mOptions.getHeatMapReport()) {
+        error += writeHeatMapReport(renderContext, outputFile);
+    }
 
     // throw a file io error if anything failed to write, this will cause main to
     // exit with a non-zero error code.
@@ -109,6 +250,230 @@ RaasCommandLineApplication::renderOutput(rndr::RenderContext &renderContext)
     }
 }
 
+int
+RaasCommandLineApplication::writeHeatMapReport(const rndr::RenderContext &renderContext,
+                                               const std::string &outputFile)
+//
+// Ranks the geometries and materials by the heat map time of the pixels they
+// are seen through and writes it next to the output file. The heat map and the
+// id AOV are untiled, their pixels are relative to the region window like the
+// pick coordinates.
+//
+{
+    scene_rdl2::fb_util::HeatMapBuffer heatMapBuffer;
+    renderContext.snapshotHeatMapBuffer(&heatMapBuffer, /*untile*/ true, /*parallel*/ true);
+
+    scene_rdl2::fb_util::VariablePixelBuffer idBuffer;
+    const scene_rdl2::fb_util::FloatBuffer *ids = nullptr;
+    const std::string &idAov = mOptions.getHeatMapReportAov();
+    if (!idAov.empty()) {
+        const rndr::RenderOutputDriver *rod = renderContext.getRenderOutputDriver();
+        int aov = -1;
+        for (unsigned int i = 0; rod && i < rod->getNumberOfRenderOutputs(); ++i) {
+            if (rod->getRenderOutput(i)->getName() == idAov) {
+                aov = rod->getAovBuffer(i);
+                break;
+            }
+        }
+        if (aov >= 0) {
+            renderContext.snapshotAovBuffer(&idBuffer, static_cast<unsigned int>(aov),
+                                            /*untile*/ true, /*parallel*/ true);
+        }
+        if (aov >= 0 && idBuffer.getFormat() == scene_rdl2::fb_util::VariablePixelBuffer::FLOAT) {
+            ids = &idBuffer.getFloatBuffer();
+        } else {
+            Logger::warn("Heat map report: \"" + idAov + "\" is not a single channel AOV RenderOutput, "
+                         "the ids are left out.");
+        }
+    }
+
+    rndr::HeatMapReport report([&](int x, int y, std::string &geometry, std::string &material) {
+        if (const scene_rdl2::rdl2::Geometry *g = renderContext.handlePickGeometry(x, y)) {
+            geometry = g->getName();
+        }
+        if (const scene_rdl2::rdl2::Material *m = renderContext.handlePickMaterial(x, y)) {
+            material = m->getName();
+        }
+    });
+    if (!report.build(heatMapBuffer, ids)) {
+        Logger::warn("Heat map report: the heat map is empty, it needs a heat map RenderOutput.");
+        return 0;
+    }
+
+    const std::string reportFile = replaceExtension(outputFile, ".heat_map_report.json");
+    if (!report.writeJson(reportFile, outputFile)) {
+        Logger::error("Failed to write the heat map report " + reportFile);
+        return 1;
+    }
+    Logger::info("Wrote the heat map report " + reportFile);
+    return 0;
+}
+
+void
+RaasCommandLineApplication::bakeUdims(rndr::RenderContext &renderContext)
+//
+// Bakes the udims one after the other. Only the camera udim and the output
+// file names change between bakes, so the geometry, the BVH and the loaded
+// textures are kept from one udim to the next.
+//
+{
+    scene_rdl2::rdl2::SceneContext &sceneContext = renderContext.getSceneContext();
+
+    const scene_rdl2::rdl2::Camera *primaryCamera = sceneContext.getPrimaryCamera();
+    if (!primaryCamera || primaryCamera->getSceneClass().getName() != "BakeCamera") {
+        throw scene_rdl2::except::ValueError("-bake_udims requires the primary camera to be a BakeCamera");
+    }
+    scene_rdl2::rdl2::SceneObject *camera = sceneContext.getSceneObject(primaryCamera->getName());
+
+    // The file names as given in the scene, substituted again for each udim.
+    scene_rdl2::rdl2::SceneVariables &sceneVars = sceneContext.getSceneVariables();
+    const std::string outputFileTemplate = sceneVars.get(scene_rdl2::rdl2::SceneVariables::sOutputFile);
+    std::vector<std::pair<scene_rdl2::rdl2::SceneObject *, std::string>> renderOutputTemplates;
+    for (const scene_rdl2::rdl2::RenderOutput *ro : sceneContext.getAllRenderOutputs()) {
+        renderOutputTemplates.emplace_back(sceneContext.getSceneObject(ro->getName()), ro->getFileName());
+    }
+
+    for (int udim : mOptions.getBakeUdims()) {
+        Logger::info("Baking udim " + std::to_string(udim) + ".");
+
+        camera->beginUpdate();
+        camera->set<scene_rdl2::rdl2::Int>("udim", udim);
+        camera->endUpdate();
+
+        sceneVars.beginUpdate();
+        sceneVars.set(scene_rdl2::rdl2::SceneVariables::sOutputFile, substituteUdim(outputFileTemplate, udim));
+        sceneVars.endUpdate();
+
+        for (const auto &ro : renderOutputTemplates) {
+            ro.first->beginUpdate();
+            ro.first->set<scene_rdl2::rdl2::String>("file_name", substituteUdim(ro.second, udim));
+            ro.first->endUpdate();
+        }
+
+        renderContext.setSceneUpdated();
+        render(renderContext);
+    }
+}
+
+void
+RaasCommandLineApplication::renderSequence(rndr::RenderContext &renderContext)
+//
+// Renders the frames one after the other. The frame scene variable and the
+// output file names are set for each frame and its deltas are applied on top
+// of the scene, the process, the shader DSOs, the texture cache and the scene
+// objects which don't change are kept from one frame to the next.
+//
+{
+    scene_rdl2::rdl2::SceneContext &sceneContext = renderContext.getSceneContext();
+
+    // The file names as given in the scene, substituted again for each frame.
+    scene_rdl2::rdl2::SceneVariables &sceneVars = sceneContext.getSceneVariables();
+    const std::string outputFileTemplate = sceneVars.get(scene_rdl2::rdl2::SceneVariables::sOutputFile);
+    std::vector<std::pair<scene_rdl2::rdl2::SceneObject *, std::string>> renderOutputTemplates;
+    for (const scene_rdl2::rdl2::RenderOutput *ro : sceneContext.getAllRenderOutputs()) {
+        renderOutputTemplates.emplace_back(sceneContext.getSceneObject(ro->getName()), ro->getFileName());
+    }
+    const std::string &frameDeltasTemplate = mOptions.getFrameDeltasFile();
+
+    for (int frame : mOptions.getSequenceFrames()) {
+        Logger::info("Rendering frame " + std::to_string(frame) + ".");
+
+        if (!frameDeltasTemplate.empty()) {
+            const std::string deltasFile = substituteFrame(frameDeltasTemplate, frame, false);
+            Logger::info("Applying deltas from '" + deltasFile + "'.");
+            renderContext.updateScene(deltasFile);
+        }
+
+        sceneVars.beginUpdate();
+        sceneVars.set(scene_rdl2::rdl2::SceneVariables::sFrameKey, static_cast<float>(frame));
+        sceneVars.set(scene_rdl2::rdl2::SceneVariables::sOutputFile,
+                      substituteFrame(outputFileTemplate, frame, true));
+        sceneVars.endUpdate();
+
+        // Render outputs added by the deltas keep the names they were given.
+        for (const auto &ro : renderOutputTemplates) {
+            ro.first->beginUpdate();
+            ro.first->set<scene_rdl2::rdl2::String>("file_name", substituteFrame(ro.second, frame, true));
+            ro.first->endUpdate();
+        }
+
+        renderContext.setSceneUpdated();
+        render(renderContext);
+    }
+}
+
+void
+RaasCommandLineApplication::renderStereoEyes(rndr::RenderContext &renderContext)
+//
+// Renders the left and the right eye one after the other. Only the stereo view
+// of the camera and the output file names change between the eyes, so the
+// geometry, the BVH, the lights and the loaded textures are prepared once, and
+// the path guide learned on the left eye keeps guiding the right eye.
+//
+{
+    scene_rdl2::rdl2::SceneContext &sceneContext = renderContext.getSceneContext();
+
+    const scene_rdl2::rdl2::Camera *primaryCamera = sceneContext.getPrimaryCamera();
+    const std::string cameraClass = primaryCamera ? primaryCamera->getSceneClass().getName() : "";
+    if (cameraClass != "PerspectiveCamera" && cameraClass != "DomeMaster3DCamera") {
+        throw scene_rdl2::except::ValueError(
+            "-stereo_eyes requires the primary camera to be a PerspectiveCamera or a DomeMaster3DCamera");
+    }
+    scene_rdl2::rdl2::SceneObject *camera = sceneContext.getSceneObject(primaryCamera->getName());
+
+    // The file names as given in the scene, substituted again for each eye.
+    scene_rdl2::rdl2::SceneVariables &sceneVars = sceneContext.getSceneVariables();
+    const std::string outputFileTemplate = sceneVars.get(scene_rdl2::rdl2::SceneVariables::sOutputFile);
+    std::vector<std::pair<scene_rdl2::rdl2::SceneObject *, std::string>> renderOutputTemplates;
+    for (const scene_rdl2::rdl2::RenderOutput *ro : sceneContext.getAllRenderOutputs()) {
+        renderOutputTemplates.emplace_back(sceneContext.getSceneObject(ro->getName()), ro->getFileName());
+    }
+
+    const std::pair<StereoView, std::string> eyes[] = {{StereoView::LEFT, "left"},
+                                                           {StereoView::RIGHT, "right"}};
+    for (const auto &eye : eyes) {
+        Logger::info("Rendering " + eye.second + " eye.");
+
+        camera->beginUpdate();
+        camera->set<scene_rdl2::rdl2::Int>("stereo_view", static_cast<scene_rdl2::rdl2::Int>(eye.first));
+        camera->endUpdate();
+
+        sceneVars.beginUpdate();
+        sceneVars.set(scene_rdl2::rdl2::SceneVariables::sOutputFile, substituteEye(outputFileTemplate, eye.second));
+        sceneVars.endUpdate();
+
+        for (const auto &ro : renderOutputTemplates) {
+            ro.first->beginUpdate();
+            ro.first->set<scene_rdl2::rdl2::String>("file_name", substituteEye(ro.second, eye.second));
+            ro.first->endUpdate();
+        }
+
+        renderContext.setSceneUpdated();
+        render(renderContext);
+
+        // the right eye sees the same scene, keep guiding it with what was learned
+        mOptions.setKeepPathGuide(true);
+    }
+    mOptions.setKeepPathGuide(false);
+}
+
+void
+RaasCommandLineApplication::waitBackgroundOutput()
+//
+// Waits for the render outputs still being written in the background, the
+// last frame's at least, and reports the frames which failed to write.
+//
+{
+    std::shared_ptr<rndr::ImageWriteDriver> imageWriteDriver = rndr::ImageWriteDriver::get();
+    imageWriteDriver->conditionWaitUntilAllCompleted();
+
+    const unsigned errorTotal = imageWriteDriver->getFinalOutputErrorTotal();
+    if (errorTotal) {
+        throw scene_rdl2::except::IoError("Failed to write the output images of " + std::to_string(errorTotal) +
+                                          " frame(s)");
+    }
+}
+
 void
 RaasCommandLineApplication::run()
 {
@@ -130,16 +495,31 @@ RaasCommandLineApplication::run()
 #endif
         renderContext.initialize(mInitMessages, loggingConfig);
 
+        // Declared after the context so it stops serving before the context goes away.
+        std::unique_ptr<MetricsServer> metricsServer = startMetricsServer(renderContext);
+
         // TODO: allow progressive mode rendering in moonray also.
         renderContext.setRenderMode(rndr::RenderMode::BATCH);
 
-        render(renderContext);
+        if (!mOptions.getBakeUdims().empty()) {
+            bakeUdims(renderContext);
+        } else if (!mOptions.getSequenceFrames().empty()) {
+            renderSequence(renderContext);
+        } else if (mOptions.getStereoEyes()) {
+            renderStereoEyes(renderContext);
+        } else {
+            render(renderContext);
+        }
 
         for (const std::string & deltasFile : mOptions.getDeltasFiles()) {
             Logger::info("Applying deltas from '" + deltasFile + "'.");
             renderContext.updateScene(deltasFile);
             render(renderContext);
         }
+
+        if (mOptions.getBackgroundOutput()) {
+            waitBackgroundOutput();
+        }
     }
 
     rndr::cleanUpGlobalDriver();
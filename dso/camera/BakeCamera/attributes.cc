@@ -58,7 +58,8 @@ sceneClass.setMetadata(attrNormalMap, "label", "normal map");
 sceneClass.setMetadata(attrNormalMap, "comment", "Use this option to supply "
                        "your own normals that are used when computing ray directions.  "
                        "Without this option, normals are computed from the geometry and do "
-                       "not take into account any material applied normal mapping.");
+                       "not take into account any material applied normal mapping.  "
+                       "A <UDIM> token in the file name is replaced by the baked udim.");
 attrNormalMapSpace = sceneClass.declareAttribute<rdl2::Int>("normal_map_space", 0, rdl2::FLAGS_ENUMERABLE, rdl2::INTERFACE_GENERIC, { "normal map space" });
 sceneClass.setMetadata(attrNormalMapSpace, "label", "normal map space");
 sceneClass.setEnumValue(attrNormalMapSpace, 0, "camera space");
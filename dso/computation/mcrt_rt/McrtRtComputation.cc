@@ -8,6 +8,8 @@
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <moonray/rendering/pbr/core/Statistics.h>
 #include <moonray/rendering/rndr/RenderDriver.h>
+#include <moonray/rendering/rndr/RenderNodeBalancer.h>
+#include <moonray/rendering/rndr/RenderProgressEstimation.h>
 #include <moonray/rendering/rndr/rndr.h>
 #include <moonray/rendering/rndr/TileScheduler.h>
 #include <moonray/rendering/texturing/sampler/TextureSampler.h>
@@ -149,6 +151,13 @@ namespace {
     }
 
 
+    // GenericMessage for multi-machine dynamic load balancing between mcrt_rt and mcrt_rt_dispatch
+    //   "renderNodeStat <machineId> <samplesPerSec> <cpuUsage>" : mcrt_rt -> dispatch
+    //   "renderNodeWeights <w0> <w1> ... <wN-1>"                : dispatch -> mcrt_rt
+    const std::string RENDER_NODE_STAT_KEY = "renderNodeStat ";
+    const std::string RENDER_NODE_WEIGHTS_KEY = "renderNodeWeights ";
+    const double RENDER_NODE_STAT_INTERVAL_SEC = 1.0;
+
     // KEY used to indicate that a RenderSetupMessage originated from an upstream computation, and not a client
     // Used to get around the lack of message intents: http://jira.anim.dreamworks.com/browse/NOVADEV-985
     const std::string RENDER_SETUP_KEY = "776CD313-6D4B-40A4-82D2-C61F2FD055A9";
@@ -485,6 +494,10 @@ McrtRtComputation::onIdle()
     }
 #endif // end RTT_TEST_MODE    
 
+    if (mRenderContext && isMultiMachine()) {
+        processRenderNodeStat();
+    }
+
     // Process queues first
 
     // Do we have pending updates?
@@ -628,8 +641,11 @@ McrtRtComputation::onIdle()
         }
     }
 
+    // Once the fast preview frame went out, restart to build the full quality geometry.
+    const bool previewDisplayed = mRenderContext->isPreviewFrame() && mLastSnapshotTimestamp >= mRenderTimestamp;
+
     // Apply updates if needed
-    if (haveUpdates && mLastSnapshotTimestamp >= mRenderTimestamp ||
+    if ((haveUpdates || previewDisplayed) && mLastSnapshotTimestamp >= mRenderTimestamp ||
         mRenderContext->getRenderMode() == rndr::RenderMode::REALTIME) {
         TEST_SHOW_TIMING_INFO(ms.mLap.sectionStart(ms.mId_start));
         applyUpdatesAndRestartRender();
@@ -667,6 +683,34 @@ McrtRtComputation::processGeoUpdateAck()
 }
 #endif // end RTT_TEST_MODE
 
+void
+McrtRtComputation::processRenderNodeStat()
+{
+    double now = util::getSeconds();
+    if (now - mLastRenderNodeStatTime < RENDER_NODE_STAT_INTERVAL_SEC) {
+        return;
+    }
+
+    // RenderProgressEstimation keeps the total samples since the process started under multi-machine.
+    unsigned samples = mRenderContext->getFrameProgressEstimation()->getSamplesTotal();
+    rec_load::RecLoadCoreStat cpuAverage;
+    bool cpuValid = mRecLoadSampler.sample(cpuAverage);
+    if (mLastRenderNodeStatTime > 0.0 && cpuValid) {
+        float samplesPerSec = (float)(samples - mLastRenderNodeStatSamples) / (float)(now - mLastRenderNodeStatTime);
+
+        rdl2::SceneVariables& sceneVars = mRenderContext->getSceneContext().getSceneVariables();
+        std::ostringstream os;
+        os << RENDER_NODE_STAT_KEY << sceneVars.getMachineId() << " " << samplesPerSec << " "
+           << rec_load::RecLoadSampler::getUsage(cpuAverage);
+
+        GenericMessage::Ptr statMsg(new GenericMessage);
+        statMsg->mValue = os.str();
+        send(statMsg);
+    }
+    mLastRenderNodeStatTime = now;
+    mLastRenderNodeStatSamples = samples;
+}
+
 void
 McrtRtComputation::snapshotBuffers()
 {
@@ -1179,6 +1223,19 @@ McrtRtComputation::onGenericMessage(const GenericMessage::Ptr msg)
         mReceivedSnapshotRequest = true;
         return;
     }
+    if (msg->mValue.compare(0, RENDER_NODE_WEIGHTS_KEY.size(), RENDER_NODE_WEIGHTS_KEY) == 0) {
+        // New tile ownership is applied when the render restarts by the next update.
+        std::vector<float> weights;
+        if (!mRenderContext) {
+            return;
+        }
+        if (rndr::RenderNodeBalancer::decodeWeights(msg->mValue.substr(RENDER_NODE_WEIGHTS_KEY.size()), weights)) {
+            mRenderContext->setRenderNodeWeights(weights);
+        } else {
+            MOONRAY_LOG_ERROR("invalid renderNodeWeights message:%s", msg->mValue.c_str());
+        }
+        return;
+    }
     return;
 }
 
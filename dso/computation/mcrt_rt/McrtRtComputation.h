@@ -14,6 +14,7 @@
 #include <moonray/rendering/rndr/rndr.h>
 
 #include <moonray/common/log/logging.h>
+#include <moonray/common/rec_load/RecLoad.h>
 #include <moonray/engine/messages/generic_message/GenericMessage.h>
 #include <moonray/engine/messages/geometry_data/GeometryData.h>
 #include <moonray/engine/messages/json_message/JSONMessage.h>
@@ -96,6 +97,8 @@ private:
     void processGeoUpdateAck();
 #endif // end RTT_TEST_MODE
 
+    void processRenderNodeStat(); // report sample rate and cpu usage for dynamic load balancing
+
     rndr::RenderOptions mOptions;
     moonray::network::RenderedFrame::ImageEncoding mImageEncoding;
     std::unique_ptr<rndr::RenderContext> mRenderContext;
@@ -170,6 +173,10 @@ private:
     bool mResetCounter;
 
     McrtRtComputationRealtimeController mRTController;
+
+    rec_load::RecLoadSampler mRecLoadSampler;
+    double mLastRenderNodeStatTime {0.0};
+    unsigned mLastRenderNodeStatSamples {0};
 };
 
 
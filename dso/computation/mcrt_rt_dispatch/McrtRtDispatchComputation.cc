@@ -17,6 +17,7 @@
 
 #include <cstdlib>
 #include <iostream>             // test
+#include <sstream>
 #include <string>
 
 using moonray::engine::Computation;
@@ -70,6 +71,15 @@ namespace mcrt_rt_dispatch_computation {
 
 //------------------------------------------------------------------------------
 
+namespace {
+
+// GenericMessage for multi-machine dynamic load balancing (see McrtRtComputation.cc)
+const std::string RENDER_NODE_STAT_KEY = "renderNodeStat ";
+const std::string RENDER_NODE_WEIGHTS_KEY = "renderNodeWeights ";
+const double RENDER_NODE_BALANCE_INTERVAL_SEC = 5.0;
+
+} // namespace
+
 namespace moonray {
 namespace mcrt_rt_dispatch_computation {
 
@@ -82,7 +92,9 @@ McrtRtDispatchComputation::McrtRtDispatchComputation() :
     mContinuous(false),
     mMotionCaptureMode(false),
     mGeoUpdateMode(true),
-    mFrameId(0)
+    mFrameId(0),
+    mRenderNodeBalance(false),
+    mLastRenderNodeBalanceTime(0.0)
 #ifdef RTT_TEST_MODE
     , mReceivedGenericMessage(false)
 #endif // end RTT_TEST_MODE    
@@ -116,6 +128,15 @@ McrtRtDispatchComputation::configure(const object::Object& aConfig)
         }
     }
 
+    // numMachines is optional and only used by dynamic load balancing.
+    if (!aConfig["numMachines"].isNull()) {
+        int numMachines = aConfig["numMachines"];
+        if (numMachines > 1) {
+            mRenderNodeBalance = true;
+            mRenderNodeBalancer.setNumRenderNodes(numMachines);
+        }
+    }
+
 #ifdef DEBUG_CONSOLE_MODE
     mDebugConsole.open(20000, this);
 #endif // end DEBUG_CONSOLE_MODE
@@ -139,6 +160,10 @@ McrtRtDispatchComputation::onIdle()
     }
 #endif // end RTT_TEST_MODE    
 
+    if (mRenderNodeBalance) {
+        processRenderNodeBalance();
+    }
+
     // Is it time to kick out a frame yet?
     double now = util::getSeconds();
     if (mMotionCaptureMode && mFps == 0.0f) {
@@ -238,12 +263,53 @@ McrtRtDispatchComputation::onMessage(const Message::Ptr msg)
             mReceivedCameraUpdate = true;
         } // end renderCameraTransformId
     } // end JSONMessage
-#ifdef RTT_TEST_MODE
     else if (msg->id() == GenericMessage::ID) {
-        mGenericMessage = std::static_pointer_cast<GenericMessage>(msg);
-        mReceivedGenericMessage = true;
-    }
+        GenericMessage::Ptr gm = std::static_pointer_cast<GenericMessage>(msg);
+        if (gm->mValue.compare(0, RENDER_NODE_STAT_KEY.size(), RENDER_NODE_STAT_KEY) == 0) {
+            onRenderNodeStat(gm->mValue.substr(RENDER_NODE_STAT_KEY.size()));
+        }
+#ifdef RTT_TEST_MODE
+        else {
+            mGenericMessage = gm;
+            mReceivedGenericMessage = true;
+        }
 #endif // end RTT_TEST_MODE
+    }
+}
+
+void
+McrtRtDispatchComputation::onRenderNodeStat(const std::string &stat)
+{
+    if (!mRenderNodeBalance) return;
+
+    std::istringstream istr(stat);
+    int machineId;
+    float samplesPerSec, cpuUsage;
+    if (!(istr >> machineId >> samplesPerSec >> cpuUsage) || machineId < 0) {
+        MOONRAY_LOG_ERROR("invalid renderNodeStat message:%s", stat.c_str());
+        return;
+    }
+    mRenderNodeBalancer.updateNodeStat((unsigned)machineId, samplesPerSec, cpuUsage);
+}
+
+void
+McrtRtDispatchComputation::processRenderNodeBalance()
+{
+    double now = util::getSeconds();
+    if (now - mLastRenderNodeBalanceTime < RENDER_NODE_BALANCE_INTERVAL_SEC) {
+        return;
+    }
+    mLastRenderNodeBalanceTime = now;
+
+    if (!mRenderNodeBalancer.rebalance()) {
+        return;                 // not all nodes reported yet or already balanced
+    }
+
+    GenericMessage* msg = new GenericMessage;
+    msg->mValue = RENDER_NODE_WEIGHTS_KEY + rndr::RenderNodeBalancer::encodeWeights(mRenderNodeBalancer.getWeights());
+    send(Message::Ptr(msg));
+
+    MOONRAY_LOG_INFO(mRenderNodeBalancer.show().c_str());
 }
 
 #ifdef RTT_TEST_MODE
@@ -8,6 +8,8 @@
 #include "McrtRtDispatchComputationDebugConsole.h"
 #endif  // end DEBUG_CONSOLE_MODE
 
+#include <moonray/rendering/rndr/RenderNodeBalancer.h>
+
 #include <engine/computation/Computation.h>
 #include <engine/messages/geometry_data/GeometryData.h>
 #include <engine/messages/json_message/JSONMessage.h>
@@ -46,6 +48,9 @@ protected:
     void processGenericMessage();
 #endif // end RTT_TEST_MODE
 
+    void onRenderNodeStat(const std::string &stat);
+    void processRenderNodeBalance();
+
 private:
     moonray::network::GeometryData::Ptr mGeometryUpdate;
     std::vector<moonray::network::RDLMessage::Ptr> mRdlUpdates;
@@ -60,6 +65,11 @@ private:
     bool mGeoUpdateMode;
     int mFrameId;
 
+    // Dynamic load balancing of the tile ownership between mcrt_rt computations
+    bool mRenderNodeBalance;
+    rndr::RenderNodeBalancer mRenderNodeBalancer;
+    double mLastRenderNodeBalanceTime;
+
 #ifdef DEBUG_CONSOLE_MODE
     McrtRtDispatchComputationDebugConsole mDebugConsole;
 #endif  // end DEBUG_CONSOLE_MODE
@@ -5,6 +5,7 @@
 #include "McrtRtMergeComputation.h"
 
 #include <moonray/rendering/rndr/rndr.h>
+#include <moonray/rendering/rndr/RenderNodeBalancer.h>
 
 #include <moonray/client/protocol/viewport_message/ViewportMessage.h>
 #include <moonray/common/log/logging.h>
@@ -21,6 +22,8 @@
 #include <dwa/Assert.h>
 #include <logging_base/macros.h>
 
+#include <tbb/parallel_for.h>
+
 #include <cstdlib>
 #include <stdint.h>
 #include <string>
@@ -65,6 +68,12 @@ void tmpHack(fb_util::VariablePixelBuffer *frame)
 }
 #endif // end ALPHA_VIEW_TEST
 
+// GenericMessage from dispatch for multi-machine dynamic load balancing (see McrtRtComputation.cc)
+const std::string RENDER_NODE_WEIGHTS_KEY = "renderNodeWeights ";
+
+// Number of frames between the merge latency histogram log outputs.
+constexpr unsigned MERGE_LATENCY_LOG_INTERVAL = 256;
+
 const char* boolToString(bool v) {
     static const char* YES = "yes";
     static const char* NO = "no";
@@ -220,17 +229,19 @@ McrtRtMergeComputation::onIdle()
     frameMsg->mHeader.mStatus = status;
     frameMsg->mHeader.mProgress = progress;
 
+    const double mergeStartSec = util::getSeconds();
+
     // Copy each upstream buffer into the final frame buffer.
-    for (size_t i = 0; i < mUpstreamBuffers.size(); ++i) {
-        if (!mTiles[i].empty() && mUpstreamBuffers[i].size() != 0) {
-            mTiledFrame.unpackSparseTiles(&mUpstreamBuffers[i][0], mTiles[i]);
-        }
-    }
+    unpackUpstreamSparseTiles(mUpstreamBuffers, mTiles, mTiledFrame);
 
     // Untile buffer.
     fb_util::Tiler tiler(mFinalFrame.getWidth(), mFinalFrame.getHeight());
     mFinalFrame.untile(mTiledFrame, tiler, true);
 
+    if (!mHasPixelInfo) {
+        addMergeLatency(mergeStartSec);
+    }
+
 #   ifdef ALPHA_VIEW_TEST
     tmpHack(&mFinalFrame);      // test code to view alpha value
 #   endif // end ALPHA_VIEW_TEST
@@ -263,11 +274,16 @@ McrtRtMergeComputation::onIdle()
 
     if (mHasPixelInfo) {
         // Copy each upstream pixel buffer into the final pixel info buffer.
-        for (size_t i = 0; i < mUpstreamPixelInfoBuffers.size(); ++i) {
-            if (!mTiles[i].empty() && mUpstreamPixelInfoBuffers[i].size() != 0) {
-                fb_util::unpackSparseTiles(&mPixelInfoTiledFrame, &mUpstreamPixelInfoBuffers[i][0], mTiles[i]);
+        // Same as the beauty, tiles of each upstream buffer don't overlap.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, mUpstreamPixelInfoBuffers.size(), 1),
+                          [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++i) {
+                if (!mTiles[i].empty() && mUpstreamPixelInfoBuffers[i].size() != 0) {
+                    fb_util::unpackSparseTiles(&mPixelInfoTiledFrame, &mUpstreamPixelInfoBuffers[i][0],
+                                               mTiles[i]);
+                }
             }
-        }
+        });
 
         // Untile buffer.
         fb_util::Tiler tiler(mFinalPixelInfoFrame.getWidth(), mFinalPixelInfoFrame.getHeight());
@@ -277,6 +293,7 @@ McrtRtMergeComputation::onIdle()
                             return pixel;
                         });
 
+        addMergeLatency(mergeStartSec);
 
         // Handle ROI for the pixel buffer
         if (mUsingROI) {
@@ -333,6 +350,8 @@ McrtRtMergeComputation::onIdle_mocap()
 
     mLastTime = now;
 
+    const double mergeStartSec = util::getSeconds();
+
     RenderFb * cRenderFb = mFbArray->getLocal(0); // get first frame data in the fbArray
     float progress = cRenderFb->unpackSparseTiles(mTiles, mTiledFrame);
     mFbArray->shiftFbTbl();     // shift one frame
@@ -352,6 +371,8 @@ McrtRtMergeComputation::onIdle_mocap()
     fb_util::Tiler tiler(mFinalFrame.getWidth(), mFinalFrame.getHeight());
     mFinalFrame.untile(mTiledFrame, tiler, true);
 
+    addMergeLatency(mergeStartSec);
+
     // Send it downstream.
     RenderedFrame::Ptr frameMsg(new RenderedFrame);
 
@@ -402,6 +423,18 @@ McrtRtMergeComputation::onIdle_mocap()
 void
 McrtRtMergeComputation::onMessage(const Message::Ptr aMsg)
 {
+    if (aMsg->id() == moonray::network::GenericMessage::ID) {
+        const auto &gm = static_cast<const moonray::network::GenericMessage &>(*aMsg);
+        if (gm.mValue.compare(0, RENDER_NODE_WEIGHTS_KEY.size(), RENDER_NODE_WEIGHTS_KEY) == 0) {
+            std::vector<float> weights;
+            if (rndr::RenderNodeBalancer::decodeWeights(gm.mValue.substr(RENDER_NODE_WEIGHTS_KEY.size()), weights)) {
+                mRenderNodeWeights = weights;
+                generateUpstreamTiles();
+            }
+        }
+        return;
+    }
+
     if (mMotionCaptureMode) {
         onMessage_mocap(aMsg);
         return;
@@ -453,6 +486,35 @@ McrtRtMergeComputation::onMessage_mocap(const Message::Ptr aMsg)
     }
 }
 
+void
+McrtRtMergeComputation::addMergeLatency(double startSec)
+{
+    mMergeLatency.add(util::getSeconds() - startSec);
+    if (mMergeLatency.getTotal() >= MERGE_LATENCY_LOG_INTERVAL) {
+        MOONRAY_LOG_INFO(mMergeLatency.show().c_str());
+        mMergeLatency.reset();
+    }
+}
+
+void
+McrtRtMergeComputation::generateUpstreamTiles()
+{
+    if (!mTileScheduler) {
+        return;                 // not initialized yet, onViewportChanged() will generate tiles
+    }
+
+    // Same tile ownership as the upstream MCRT computations, including the dynamic load balancing
+    // weights which are sent to all the MCRT computations by dispatch.
+    mTileScheduler->setRenderNodeWeights(mRenderNodeWeights);
+    for (unsigned int i = 0; i < mNumMachines; ++i) {
+        SCOPED_MEM(&mArena);
+        mTiles[i].clear();
+        if (mTileScheduler->generateTiles(&mArena, mFrameWidth, mFrameHeight, mViewport, i, mNumMachines)) {
+            mTiles[i] = mTileScheduler->getTiles();
+        }
+    }
+}
+
 void
 McrtRtMergeComputation::onViewportChanged(const PartialFrame& msg)
 {
@@ -524,13 +586,7 @@ McrtRtMergeComputation::onViewportChanged(const PartialFrame& msg)
     auto tileSchedulerType = rndr::TileScheduler::SPIRAL_SQUARE;
     mTileScheduler = rndr::TileScheduler::create(tileSchedulerType);
 
-    for (unsigned int i = 0; i < mNumMachines; ++i) {
-        SCOPED_MEM(&mArena);
-        mTiles[i].clear();
-        if (mTileScheduler->generateTiles(&mArena, mFrameWidth, mFrameHeight, mViewport, i, mNumMachines)) {
-            mTiles[i] = mTileScheduler->getTiles();
-        }
-    }
+    generateUpstreamTiles();
 
     // Init buffers.
     unsigned tiledWidth  = util::alignUp(mFrameWidth, COARSE_TILE_SIZE);
@@ -43,6 +43,8 @@ private:
     bool fpsIntervalPassed();
     void onIdle_mocap();        // onIdle function for mocap mode
     void onMessage_mocap(const moonray::network::Message::Ptr msg); // onMessage function for mocap mode
+    void addMergeLatency(double startSec);
+    void generateUpstreamTiles();
 
     util::Ref<alloc::ArenaBlockPool> mArenaBlockPool;
     alloc::Arena mArena;
@@ -53,11 +55,14 @@ private:
 
     std::unique_ptr<RenderFbArray> mFbArray; // for mocap mode
 
+    MergeLatencyHistogram mMergeLatency; // time to merge upstream buffers into the final frame
+
     // Holds all the partial frame buffers we've received from the upstream
     // MCRT computations.
     std::vector<std::vector<uint8_t>> mUpstreamBuffers;
     std::vector<std::vector<fb_util::PixelInfoBuffer::PixelType>> mUpstreamPixelInfoBuffers;
     std::vector<std::vector<fb_util::Tile>> mTiles;
+    std::vector<float> mRenderNodeWeights; // tile ownership weights by dispatch dynamic load balancing
 
     // Type of frame buffers to encode.
     network::BaseFrame::ImageEncoding mImageEncoding;
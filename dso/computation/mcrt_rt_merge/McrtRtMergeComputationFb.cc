@@ -7,9 +7,80 @@
 
 #include <scene_rdl2/common/log/logging.h>
 
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
 namespace moonray {
 namespace mcrt_rt_merge_computation {
 
+void
+unpackUpstreamSparseTiles(const std::vector<std::vector<uint8_t>> &upstreamBuffers,
+                          const std::vector<std::vector<fb_util::Tile>> &tiles,
+                          fb_util::VariablePixelBuffer &tiledFrame)
+{
+    // Upstream buffer which does not match its tiles is skipped. This happens for a short while after
+    // the tile ownership is rebalanced until the upstream computation restarts by the new ownership.
+    const size_t tileDataSize = COARSE_TILE_SIZE * COARSE_TILE_SIZE * tiledFrame.getSizeOfPixel();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, upstreamBuffers.size(), 1),
+                      [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++i) {
+            if (!tiles[i].empty() && upstreamBuffers[i].size() == tiles[i].size() * tileDataSize) {
+                tiledFrame.unpackSparseTiles(&upstreamBuffers[i][0], tiles[i]);
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+
+void
+MergeLatencyHistogram::add(double sec)
+{
+    const double msec = sec * 1000.0;
+    int binId = 0;
+    if (msec >= 1.0) {
+        binId = std::min(static_cast<int>(std::log2(msec)) + 1, sBinTotal - 1);
+    }
+    mBin[binId]++;
+    mTotal++;
+    mSumSec += sec;
+    mMaxSec = std::max(mMaxSec, sec);
+}
+
+void
+MergeLatencyHistogram::reset()
+{
+    mBin.fill(0);
+    mTotal = 0;
+    mSumSec = 0.0;
+    mMaxSec = 0.0;
+}
+
+std::string
+MergeLatencyHistogram::show() const
+{
+    std::ostringstream ostr;
+    ostr << "MergeLatencyHistogram (total:" << mTotal << std::fixed << std::setprecision(3)
+         << " ave:" << ((mTotal) ? mSumSec / mTotal * 1000.0 : 0.0) << "ms"
+         << " max:" << mMaxSec * 1000.0 << "ms) {\n";
+    for (int i = 0; i < sBinTotal; ++i) {
+        if (!mBin[i]) continue;
+        ostr << "  ";
+        if (i == 0) ostr << "      <1ms";
+        else if (i == sBinTotal - 1) ostr << " >=" << std::setw(5) << (1 << (i - 1)) << "ms";
+        else ostr << std::setw(5) << (1 << (i - 1)) << '-' << std::setw(4) << (1 << i) << "ms";
+        ostr << " : " << mBin[i] << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+//------------------------------------------------------------------------------
+
 void    
 RenderFb::setup(int numMachines)
 {
@@ -74,11 +145,7 @@ RenderFb::unpackSparseTiles(const std::vector<std::vector<fb_util::Tile>> &tiles
                             fb_util::VariablePixelBuffer &tiledFrame)
 {
     // Copy each upstream buffer into the final frame buffer.
-    for (size_t i = 0; i < mUpstreamBuffers.size(); ++i) {
-        if (!tiles[i].empty() && mUpstreamBuffers[i].size() != 0) {
-            tiledFrame.unpackSparseTiles(&mUpstreamBuffers[i][0], tiles[i]);
-        }
-    }
+    unpackUpstreamSparseTiles(mUpstreamBuffers, tiles, tiledFrame);
 
     return mProgressTotal;
 }
@@ -9,6 +9,8 @@
 
 #include <moonray/engine/messages/partial_frame/PartialFrame.h>
 
+#include <array>
+#include <string>
 #include <vector>
 
 using moonray::network::Message;
@@ -17,6 +19,39 @@ using moonray::network::PartialFrame;
 namespace moonray {
 namespace mcrt_rt_merge_computation {
 
+//
+// Copies each upstream buffer into the tiled frame buffer in parallel.
+// Each upstream MCRT computation renders its own set of tiles (see TileScheduler::generateTiles()),
+// so the destination regions never overlap and each upstream buffer is merged by one task without
+// any lock or atomic operation.
+//
+void unpackUpstreamSparseTiles(const std::vector<std::vector<uint8_t>> &upstreamBuffers,
+                               const std::vector<std::vector<fb_util::Tile>> &tiles,
+                               fb_util::VariablePixelBuffer &tiledFrame);
+
+//
+// Histogram of the merge time of each frame for performance analyze.
+// Bin 0 is less than 1 millisecond and bin N (N > 0) is [2^(N-1), 2^N) milliseconds.
+//
+class MergeLatencyHistogram
+{
+public:
+    void add(double sec);
+    void reset();
+
+    unsigned getTotal() const { return mTotal; }
+
+    std::string show() const;
+
+protected:
+    static constexpr int sBinTotal = 12; // last bin also holds everything over 1 sec
+
+    std::array<unsigned, sBinTotal> mBin {};
+    unsigned mTotal {0};
+    double mSumSec {0.0};
+    double mMaxSec {0.0};
+};
+
 //
 // Frame buffer which containes entire image. This is one frame of rendered image.
 // Under distributed MCRT situation, entire image is split into multiple PartialFrames.
@@ -68,6 +68,11 @@ public:
             scene_rdl2::math::toFloat(rdlGeometry->get(scene_rdl2::rdl2::Node::sNodeXformKey,
                                                        scene_rdl2::rdl2::TIMESTEP_BEGIN));
 
+        InstanceLod lod;
+        lod.mCoarserIndices = instanceGeometry->get(attrLodCoarserIndices);
+        lod.mMinPixelSizes = instanceGeometry->get(attrLodMinPixelSizes);
+        lod.mBlend = scene_rdl2::math::clamp(instanceGeometry->get(attrLodBlend), 0.0f, 1.0f);
+
         instanceWithXforms(generateContext,
                            parent2render,
                            nodeXform,
@@ -87,7 +92,8 @@ public:
                            instanceGeometry->get(attrPositions),
                            instanceGeometry->get(attrOrientations),
                            instanceGeometry->get(attrScales),
-                           instanceGeometry->get(attrXformList));
+                           instanceGeometry->get(attrXformList),
+                           lod);
     }
 };
 
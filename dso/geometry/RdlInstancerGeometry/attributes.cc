@@ -24,6 +24,9 @@ RDL2_DSO_ATTR_DECLARE
     scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool> attrUseRotationMotionBlur;
     scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool> attrUseReferenceXforms;
     scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool> attrUseReferenceAttributes;
+    scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::IntVector> attrLodCoarserIndices;
+    scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::FloatVector> attrLodMinPixelSizes;
+    scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> attrLodBlend;
     DECLARE_COMMON_EXPLICIT_SHADING_ATTRIBUTES
 
 RDL2_DSO_ATTR_DEFINE(scene_rdl2::rdl2::Geometry)
@@ -146,6 +149,36 @@ RDL2_DSO_ATTR_DEFINE(scene_rdl2::rdl2::Geometry)
     sceneClass.setMetadata(attrUseReferenceAttributes, "comment", "Use the geometry attributes of the reference (prototype) instead of the ones on the InstanceGeometry.   Currently only works for shadow_ray_epsilon");
     sceneClass.setGroup("Instancing", attrUseReferenceAttributes);
 
+    attrLodCoarserIndices =
+        sceneClass.declareAttribute<scene_rdl2::rdl2::IntVector>("lod_coarser_indices", {});
+    sceneClass.setMetadata(attrLodCoarserIndices, "label", "lod coarser indices");
+    sceneClass.setMetadata(attrLodCoarserIndices, "comment",
+        "For each entry of \"references\", the index of the reference holding a coarser version "
+        "of the same geometry, or -1 if there is none. Instances of a reference which are smaller "
+        "in the render camera than its \"lod min pixel sizes\" use the coarser reference instead, "
+        "which may itself have a coarser reference. The instances are measured when the geometry "
+        "is generated, with the bound of the reference geometry before displacement. "
+        "Level of detail is off when this list is empty or the camera has no frustum.");
+    sceneClass.setGroup("Level of Detail", attrLodCoarserIndices);
+
+    attrLodMinPixelSizes =
+        sceneClass.declareAttribute<scene_rdl2::rdl2::FloatVector>("lod_min_pixel_sizes", {});
+    sceneClass.setMetadata(attrLodMinPixelSizes, "label", "lod min pixel sizes");
+    sceneClass.setMetadata(attrLodMinPixelSizes, "comment",
+        "For each entry of \"references\", the projected size in pixels of the bounding sphere "
+        "of an instance under which the instance uses the coarser reference given by "
+        "\"lod coarser indices\".");
+    sceneClass.setGroup("Level of Detail", attrLodMinPixelSizes);
+
+    attrLodBlend =
+        sceneClass.declareAttribute<scene_rdl2::rdl2::Float>("lod_blend", 0.0f);
+    sceneClass.setMetadata(attrLodBlend, "label", "lod blend");
+    sceneClass.setMetadata(attrLodBlend, "comment",
+        "Instances within this fraction of a \"lod min pixel sizes\" value, on either side, "
+        "randomly pick the finer or the coarser reference with a chance following their size, "
+        "which hides the line where the references switch. 0 switches sharply.");
+    sceneClass.setGroup("Level of Detail", attrLodBlend);
+
     DEFINE_COMMON_EXPLICIT_SHADING_ATTRIBUTES
 
 RDL2_DSO_ATTR_END
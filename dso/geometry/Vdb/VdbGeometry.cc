@@ -106,6 +106,9 @@ public:
         }
 
         const std::string resolvedVdbFilePath = getIndexedFile(vdbFilePath, *rdlGeometry);
+        // The grids are read at tessellation, pull the file in while the
+        // other procedurals generate.
+        file_resource::prefetchFile(resolvedVdbFilePath);
         const std::string densityGridName = pVdbGeometry->get(attrDensityGrid);
         const std::string emissionGridName = pVdbGeometry->get(attrEmissionGrid);
         moonray::geom::VdbVolume::VdbInitData vdbInitData = {
@@ -9,6 +9,7 @@ using namespace scene_rdl2;
 RDL2_DSO_ATTR_DECLARE
 
     rdl2::AttributeKey<rdl2::Bool>      attrSampleUpperHemisphereOnly;
+    rdl2::AttributeKey<rdl2::SceneObjectVector> attrPortals;
 
 RDL2_DSO_ATTR_DEFINE(rdl2::Light)
 
@@ -23,5 +24,16 @@ RDL2_DSO_ATTR_DEFINE(rdl2::Light)
     
     sceneClass.setGroup("Map", attrSampleUpperHemisphereOnly);
 
+    attrPortals = sceneClass.declareAttribute<rdl2::SceneObjectVector>("portals", {},
+        rdl2::FLAGS_NONE, rdl2::INTERFACE_LIGHT);
+    sceneClass.setMetadata(attrPortals, rdl2::SceneClass::sComment,
+        "RectLights marking the openings (windows, doors) through which the environment lights an interior. "
+        "When set, the EnvLight only samples directions through these rectangles, with more samples going "
+        "to the larger, closer and brighter ones, which cuts the noise of interiors lit through small "
+        "openings. Points outside of all of the portals get no light samples from the EnvLight. "
+        "The RectLights should be placed in the openings facing the interior and are usually turned "
+        "off, only their transform, width and height are used.");
+    sceneClass.setGroup("Portals", attrPortals);
+
 RDL2_DSO_ATTR_END
 
@@ -13,6 +13,7 @@ RDL2_DSO_ATTR_DECLARE
     rdl2::AttributeKey<rdl2::Float>        attrProjectorFilmWidthApertureKey;
     rdl2::AttributeKey<rdl2::Float>        attrProjectorPixelAspectRatio;
     rdl2::AttributeKey<rdl2::SceneObject*> attrTextureMap;
+    rdl2::AttributeKey<rdl2::Int>          attrBakeResolution;
     rdl2::AttributeKey<rdl2::Float>        attrBlurNearDistance;
     rdl2::AttributeKey<rdl2::Float>        attrBlurMidpoint;
     rdl2::AttributeKey<rdl2::Float>        attrBlurFarDistance;
@@ -60,6 +61,16 @@ RDL2_DSO_ATTR_DEFINE(rdl2::LightFilter)
         "You may also add any of the map modifiers, color correct for example.  "
         "The default is an image map.");
 
+    attrBakeResolution = sceneClass.declareAttribute<rdl2::Int>("bake_resolution", 0);
+    sceneClass.setMetadata(attrBakeResolution, "min", "0");
+    sceneClass.setMetadata(attrBakeResolution, "max", "16384");
+    sceneClass.setMetadata(attrBakeResolution, "comment",
+        "If non-zero, the map is baked at this resolution (rounded up to a power of two) "
+        "into an in-memory mip pyramid when the filter is updated, and the light samples "
+        "look up the pyramid instead of evaluating the map. Much faster, but the map "
+        "detail finer than a texel is lost and the map must only depend on the uv. "
+        "0 evaluates the map for every light sample.");
+
     attrBlurNearDistance = sceneClass.declareAttribute<rdl2::Float>("blur_near_distance", 0.0f);
     sceneClass.setMetadata(attrBlurNearDistance, "comment", "Distance from cookie filter");
 
@@ -115,6 +126,7 @@ RDL2_DSO_ATTR_DEFINE(rdl2::LightFilter)
 
     sceneClass.setGroup("Properties", attrProjector);
     sceneClass.setGroup("Properties", attrTextureMap);
+    sceneClass.setGroup("Properties", attrBakeResolution);
     sceneClass.setGroup("Properties", attrBlurNearDistance);
     sceneClass.setGroup("Properties", attrBlurMidpoint);
     sceneClass.setGroup("Properties", attrBlurFarDistance);
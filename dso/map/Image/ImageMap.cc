@@ -100,6 +100,8 @@ ImageMap::~ImageMap()
 void
 ImageMap::update()
 {
+    mSampleFuncv = (scene_rdl2::rdl2::SampleFuncv) ispc::ImageMap_getSampleFunc();
+
     std::string filename = get(attrTexture);
     std::size_t udimPos = filename.find("<UDIM>");
     bool areWeAUdim = udimPos != std::string::npos;
@@ -197,6 +199,16 @@ ImageMap::update()
                             get(attrTMIControlEnabled);
 
     mIspc.mApplyColorCorrection = mApplyColorCorrection;
+
+    // Most image maps are a plain lookup of a non-udim texture with the surface
+    // st, they are vectorized without the per call checks of the other options.
+    if (mTexture &&
+        get(attrTextureEnum) == ispc::ST &&
+        isZero(math::deg2rad(get(attrRotationAngle))) &&
+        !get(attrAlphaOnly) &&
+        !mApplyColorCorrection) {
+        mSampleFuncv = (scene_rdl2::rdl2::SampleFuncv) ispc::ImageMapBasic_getSampleFunc();
+    }
 }
 
 float
@@ -43,6 +43,8 @@ private:
                       const State& state,
                       BsdfBuilder& bsdfBuilder);
 
+    ispc::BaseMaterial mIspc;
+
 RDL2_DSO_CLASS_END(BaseMaterial)
 
 
@@ -53,11 +55,33 @@ BaseMaterial::BaseMaterial(const SceneClass& sceneClass, const std::string& name
 {
     mShadeFunc = BaseMaterial::shade;
     mShadeFuncv = (ShadeFuncv) ispc::BaseMaterial_getShadeFunc();
+    mIspc.mFeatures = 0;
 }
 
 void
 BaseMaterial::update()
 {
+    // A lobe or input is only left out when no value or binding of this
+    // instance can make it non zero.
+    int features = 0;
+    if (get(attrSpecular) && !isZero(get(attrSpecularFactor))) {
+        features |= ispc::BASE_MATERIAL_SPECULAR;
+    }
+    if (getBinding(attrRetroreflectivity) || !isZero(get(attrRetroreflectivity))) {
+        features |= ispc::BASE_MATERIAL_RETROREFLECTIVITY;
+    }
+    if (get(attrDirectionalDiffuse) && !isZero(get(attrDirectionalDiffuseFactor))) {
+        features |= ispc::BASE_MATERIAL_DIRECTIONAL_DIFFUSE;
+    }
+    if (get(attrTransmission) && !isZero(get(attrTransmissionFactor))) {
+        features |= ispc::BASE_MATERIAL_TRANSMISSION;
+    }
+    // Only the specular and directional diffuse lobes are anisotropic
+    if ((features & (ispc::BASE_MATERIAL_SPECULAR | ispc::BASE_MATERIAL_DIRECTIONAL_DIFFUSE)) &&
+        (getBinding(attrAnisotropy) || !isZero(get(attrAnisotropy)))) {
+        features |= ispc::BASE_MATERIAL_ANISOTROPY;
+    }
+    mIspc.mFeatures = features;
 }
 
 void
@@ -65,6 +89,10 @@ BaseMaterial::shade(const Material* self, moonray::shading::TLState *tls,
                     const State& state, BsdfBuilder& bsdfBuilder)
 {
     const BaseMaterial* me = static_cast<const BaseMaterial*>(self);
+    const int features = me->mIspc.mFeatures;
+    const bool hasFresnel = (features & (ispc::BASE_MATERIAL_SPECULAR |
+                                         ispc::BASE_MATERIAL_DIRECTIONAL_DIFFUSE |
+                                         ispc::BASE_MATERIAL_TRANSMISSION)) != 0;
     moonray::shading::Bsdf *bsdf = const_cast<moonray::shading::Bsdf*>(bsdfBuilder.getBsdf());
 
     scene_rdl2::alloc::Arena *arena = getArena(tls);
@@ -79,7 +107,8 @@ BaseMaterial::shade(const Material* self, moonray::shading::TLState *tls,
     Color omTransmissionColor(1.0f);
 
     Vec3f anisotropicDirection(0.0f);
-    float anisotropy = evalFloat(me, attrAnisotropy, tls, state);
+    float anisotropy = (features & ispc::BASE_MATERIAL_ANISOTROPY) ?
+                       evalFloat(me, attrAnisotropy, tls, state) : 0.0f;
 
     // Get minimum roughness used to apply roughness clamping.
     const Vec2f minRoughnessAniso = state.getMinRoughness();
@@ -112,9 +141,15 @@ BaseMaterial::shade(const Material* self, moonray::shading::TLState *tls,
         specularColor = evalColorComponent(me, attrSpecular, attrSpecularFactor,
                 attrSpecularColor, tls, state);
 
-        specularRoughness = evalFloat(me, attrSpecularRoughness, tls, state);
+        if (features & (ispc::BASE_MATERIAL_SPECULAR |
+                        ispc::BASE_MATERIAL_RETROREFLECTIVITY |
+                        ispc::BASE_MATERIAL_TRANSMISSION)) {
+            specularRoughness = evalFloat(me, attrSpecularRoughness, tls, state);
+        }
 
-        retroreflectivity = evalFloat(me, attrRetroreflectivity, tls, state);
+        if (features & ispc::BASE_MATERIAL_RETROREFLECTIVITY) {
+            retroreflectivity = evalFloat(me, attrRetroreflectivity, tls, state);
+        }
 
         directionalDiffuseColor = evalColorComponent(me, attrDirectionalDiffuse,
                 attrDirectionalDiffuseFactor, attrDirectionalDiffuseColor, tls, state);
@@ -137,19 +172,20 @@ BaseMaterial::shade(const Material* self, moonray::shading::TLState *tls,
     // We use a top specular lobe and use it to attenuate energy from lower lobes
     moonray::shading::Fresnel *omSpecFresnel = nullptr;
 
-    // TODO: avoid doing these eval() calls if the result is unused
     const Vec3f N = evalNormal(me, attrInputNormal, attrInputNormalDial, 
         attrInputNormalSpace, tls, state);
-    const float fresnelFactor = (me->get(attrUseFresnel)  ?
+    const float fresnelFactor = (hasFresnel  &&  me->get(attrUseFresnel)  ?
             evalFloat(me, attrFresnelFactor, tls, state)  :  0.0);
     const ShaderIor ior(state, me->get(attrIndexOfRefraction));
 
     const bool isTransmissive = !isBlack(transmissionColor);
     // Energy Compensation Params
-    float favg, favgInv;
-    moonray::shading::averageFresnelReflectance(
-            ior.getTransmitted()/ior.getIncident(),
-            favg, favgInv);
+    float favg = 0.0f, favgInv = 0.0f;
+    if (hasFresnel) {
+        moonray::shading::averageFresnelReflectance(
+                ior.getTransmitted()/ior.getIncident(),
+                favg, favgInv);
+    }
 
     // Top Specular lobe
     if (!isBlack(specularColor) && (retroreflectivity < 1.0f)) {
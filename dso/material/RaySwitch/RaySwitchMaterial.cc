@@ -128,7 +128,7 @@ RaySwitchMaterial::raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) cons
         }
         const SceneObject* materialObj = get(attrCameraRayMaterial);
         if (materialObj) {
-            return materialObj->asA<scene_rdl2::rdl2::Material>();
+            return materialObj->asA<scene_rdl2::rdl2::Material>()->raySwitch(ctx);
         }
     }
     break;
@@ -136,7 +136,7 @@ RaySwitchMaterial::raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) cons
     {
         const SceneObject* materialObj = get(attrIndirectMirrorRayMaterial);
         if (materialObj) {
-            return materialObj->asA<scene_rdl2::rdl2::Material>();
+            return materialObj->asA<scene_rdl2::rdl2::Material>()->raySwitch(ctx);
         }
     }
     break;
@@ -144,7 +144,7 @@ RaySwitchMaterial::raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) cons
     {
         const SceneObject* materialObj = get(attrIndirectGlossyRayMaterial);
         if (materialObj) {
-            return materialObj->asA<scene_rdl2::rdl2::Material>();
+            return materialObj->asA<scene_rdl2::rdl2::Material>()->raySwitch(ctx);
         }
     }
     break;
@@ -152,12 +152,19 @@ RaySwitchMaterial::raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) cons
     {
         const SceneObject* materialObj = get(attrIndirectDiffuseRayMaterial);
         if (materialObj) {
-            return materialObj->asA<scene_rdl2::rdl2::Material>();
+            return materialObj->asA<scene_rdl2::rdl2::Material>()->raySwitch(ctx);
         }
     }
     break;
     }
 
+    // Shading this material would only shade the default material, so substitute
+    // it right away.  Nested switches are resolved as well.
+    const SceneObject* defaultMaterialObj = get(attrDefaultMaterial);
+    if (defaultMaterialObj) {
+        return defaultMaterialObj->asA<scene_rdl2::rdl2::Material>()->raySwitch(ctx);
+    }
+
     return this;
 }
 
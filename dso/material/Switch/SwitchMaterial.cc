@@ -22,6 +22,8 @@ public:
     ~SwitchMaterial();
     virtual void update();
 
+    const scene_rdl2::rdl2::Material* raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) const override;
+
 private:
     static void shade(const scene_rdl2::rdl2::Material* self, moonray::shading::TLState *tls,
                       const State& state, BsdfBuilder& bsdfBuilder);
@@ -142,6 +144,24 @@ SwitchMaterial::update()
 
 //---------------------------------------------------------------------------
 
+// The choice can't be bound, so the integrator substitutes the chosen material
+// before queueing the ray for shading and the switch itself is only shaded if
+// nothing is chosen.  The chosen material may be a switch in turn.
+const scene_rdl2::rdl2::Material*
+SwitchMaterial::raySwitch(const scene_rdl2::rdl2::RaySwitchContext& ctx) const
+{
+    const int choice = get(attrChoice);
+    if (choice < 0 || choice >= ispc::MAX_MATERIALS) {
+        return this;
+    }
+
+    const scene_rdl2::rdl2::Material* mtl = reinterpret_cast<scene_rdl2::rdl2::Material*>(mIspc.mMaterial[choice]);
+    if (mtl) {
+        return mtl->raySwitch(ctx);
+    }
+    return this;
+}
+
 void
 SwitchMaterial::shade(const scene_rdl2::rdl2::Material* self, moonray::shading::TLState *tls,
                       const State& state, BsdfBuilder& bsdfBuilder)
@@ -70,7 +70,7 @@ public:
         bool useRamp =                  get(attrMatchAlbedo) ? get(attrUseAlbedoRamp)  : get(attrUseAttenuationRamp);     
         float minDepth =                get(attrMatchAlbedo) ? get(attrAlbedoMinDepth) : get(attrAttenuationMinDepth);
         float maxDepth =                get(attrMatchAlbedo) ? get(attrAlbedoMaxDepth) : get(attrAttenuationMaxDepth);
-        moonray::shading::ColorRampControl ramp = get(attrMatchAlbedo) ? mAlbedoRamp : mAttenuationRamp;
+        const moonray::shading::ColorRampControl& ramp = get(attrMatchAlbedo) ? mAlbedoRamp : mAttenuationRamp;
 
         if (useRamp && rayVolumeDepth >= 0.f) { // -1 indicates ramp is not supported      
             color = evalColorRamp(ramp, minDepth, maxDepth, rayVolumeDepth);
@@ -245,16 +245,19 @@ BaseVolume::update()
                             get(attrAttenuationInterpolationTypes).data()
                           ),
                           ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+    mAttenuationRamp.bake();
 
     mAlbedoRamp.init(get(attrAlbedoDistances).size(), 
                      get(attrAlbedoDistances).data(), 
                      get(attrAlbedoColors).data(),
                      reinterpret_cast<const ispc::RampInterpolatorMode*>(get(attrAlbedoInterpolationTypes).data()),
                      ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+    mAlbedoRamp.bake();
     
     mDensityRamp.init(get(attrDensityDistances).size(), 
                       get(attrDensityDistances).data(), 
                       get(attrDensities).data(),
                       reinterpret_cast<const ispc::RampInterpolatorMode*>(get(attrDensityInterpolationTypes).data()));
+    mDensityRamp.bake();
 }
 
@@ -0,0 +1,170 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MetricsServer.h"
+
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace moonray {
+
+namespace {
+
+// How often the server thread checks for stop() while no one connects.
+constexpr int POLL_TIMEOUT_MS = 200;
+// A scraper which doesn't send its request within this is dropped.
+constexpr int REQUEST_TIMEOUT_MS = 2000;
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+void
+sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+void
+sendResponse(int fd, const char *status, const std::string &body)
+{
+    std::ostringstream ostr;
+    ostr << "HTTP/1.1 " << status << "\r\n"
+         << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+         << "Content-Length: " << body.size() << "\r\n"
+         << "Connection: close\r\n"
+         << "\r\n"
+         << body;
+    sendAll(fd, ostr.str());
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(unsigned port, const CollectFunc &collect) :
+    mPort(port),
+    mCollect(collect),
+    mListenFd(-1),
+    mStop(false)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool
+MetricsServer::start(std::string &errorMessage)
+{
+    mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (mListenFd < 0) {
+        errorMessage = std::string("socket() failed: ") + strerror(errno);
+        return false;
+    }
+
+    const int reuse = 1;
+    setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(mPort));
+
+    if (bind(mListenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        listen(mListenFd, 4) < 0) {
+        std::ostringstream ostr;
+        ostr << "can't listen on port " << mPort << ": " << strerror(errno);
+        errorMessage = ostr.str();
+        close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+
+    mStop = false;
+    mThread = std::thread(&MetricsServer::threadMain, this);
+    return true;
+}
+
+void
+MetricsServer::stop()
+{
+    mStop = true;
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    if (mListenFd >= 0) {
+        close(mListenFd);
+        mListenFd = -1;
+    }
+}
+
+void
+MetricsServer::threadMain()
+{
+    mcrt_common::TimelineTrace::setThreadName("metricsServer");
+
+    while (!mStop) {
+        pollfd pfd {mListenFd, POLLIN, 0};
+        if (poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+        const int fd = accept(mListenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        serveConnection(fd);
+        close(fd);
+    }
+}
+
+void
+MetricsServer::serveConnection(int fd) const
+{
+    // Only the request line matters, read until the end of the headers.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        pollfd pfd {fd, POLLIN, 0};
+        if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0) {
+            return;
+        }
+        const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::istringstream istr(request);
+    std::string method, target;
+    istr >> method >> target;
+
+    // Ignore any query string, e.g. /metrics?name[]=...
+    target = target.substr(0, target.find('?'));
+
+    if (method != "GET") {
+        sendResponse(fd, "405 Method Not Allowed", "only GET is supported\n");
+    } else if (target != "/metrics") {
+        sendResponse(fd, "404 Not Found", "metrics are served at /metrics\n");
+    } else {
+        sendResponse(fd, "200 OK", mCollect());
+    }
+}
+
+} // namespace moonray
+
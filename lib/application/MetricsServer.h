@@ -0,0 +1,48 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace moonray {
+
+//
+// Minimal HTTP server for farm monitoring. Answers GET /metrics with the text
+// returned by the collect callback (Prometheus text exposition format) and
+// everything else with 404. Requests are served one at a time on a thread of
+// its own, so a slow scraper never holds up the render.
+//
+class MetricsServer
+{
+public:
+    using CollectFunc = std::function<std::string()>;
+
+    MetricsServer(unsigned port, const CollectFunc &collect);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    // Binds the port on all the interfaces and starts serving. Returns false,
+    // with the reason in errorMessage, if the port couldn't be bound.
+    bool start(std::string &errorMessage);
+    void stop();
+
+private:
+    void threadMain();
+    void serveConnection(int fd) const;
+
+    const unsigned mPort;
+    const CollectFunc mCollect;
+
+    int mListenFd;
+    std::atomic<bool> mStop;
+    std::thread mThread;
+};
+
+} // namespace moonray
+
@@ -3,6 +3,8 @@
 
 #include "RaasApplication.h"
 #include "ChangeWatcher.h"
+#include "MetricsServer.h"
+#include "RenderMetrics.h"
 
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <moonray/common/time/Timer.h>
@@ -86,6 +88,26 @@ RaasApplication::logInitMessages()
     mInitMessages << "Using OpenImageIO Texture System\n";
 }
 
+std::unique_ptr<MetricsServer>
+RaasApplication::startMetricsServer(const rndr::RenderContext& renderContext) const
+{
+    const unsigned port = mOptions.getMetricsPort();
+    if (port == 0) {
+        return nullptr;
+    }
+
+    auto metrics = std::make_shared<RenderMetrics>(renderContext);
+    std::unique_ptr<MetricsServer> server(new MetricsServer(port, [metrics]() { return metrics->collect(); }));
+
+    std::string errorMessage;
+    if (!server->start(errorMessage)) {
+        scene_rdl2::Logger::warn("Metrics endpoint disabled, " + errorMessage);
+        return nullptr;
+    }
+    scene_rdl2::Logger::info("Serving render metrics at http://localhost:" + std::to_string(port) + "/metrics");
+    return server;
+}
+
 void 
 stackTraceHandler(int sig) 
 {
@@ -301,7 +323,8 @@ writeRenderOutputsWithMessages(const rndr::RenderOutputDriver *rod,
                                const scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                                const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
-                               const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers)
+                               const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                               const bool tiled)
 {
     int err = 0;
 
@@ -340,6 +363,7 @@ writeRenderOutputsWithMessages(const rndr::RenderOutputDriver *rod,
                         renderBufferOdd,
                         aovBuffers,
                         displayFilterBuffers,
+                        tiled,
                         cache.get());
         err = rod->loggingErrorAndInfo(cache.get())? 0: 1;
 
@@ -351,6 +375,48 @@ writeRenderOutputsWithMessages(const rndr::RenderOutputDriver *rod,
     return err;
 }
 
+bool
+enqRenderOutputs(const std::shared_ptr<const rndr::RenderOutputDriver> &rod,
+                 pbr::CryptomatteBuffer *cryptomatteBuffer,
+                 const scene_rdl2::fb_util::HeatMapBuffer *heatMap,
+                 const scene_rdl2::fb_util::FloatBuffer *weightBuffer,
+                 const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
+                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
+                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                 const bool tiled)
+{
+    const rndr::ImageWriteDriver::ImageWriteDriverShPtr driver = rndr::ImageWriteDriver::get();
+
+    // Deep files are only written in STD mode and the aov buffers of the streamed files aren't
+    // snapshot. The last two stage checkpoint is copied to the final files instead.
+    const rndr::ImageWriteCache *lastImageWriteCache = driver->getLastImageWriteCache();
+    if (!rod || rod->requiresDeepBuffer() || rod->hasStreamedFiles() ||
+        (lastImageWriteCache && lastImageWriteCache->getTwoStageOutput())) {
+        return false;
+    }
+
+    // Each cache holds a copy of the outputs, bound the number of frames waiting to be written.
+    driver->waitUntilBgWriteReady();
+
+    rndr::ImageWriteDriver::ImageWriteCacheUqPtr cache = driver->newImageWriteCache(rod.get());
+    cache->setFinalOutput(rod);
+    cache->setTwoStageOutput(driver->getTwoStageOutput());
+    cache->setupEnqMode();
+
+    rod->writeFinal(nullptr, // deepBuffer
+                    cryptomatteBuffer,
+                    heatMap,
+                    weightBuffer,
+                    renderBufferOdd,
+                    aovBuffers,
+                    displayFilterBuffers,
+                    tiled,
+                    cache.get());
+
+    cache->calcFinalBlockInternalDataSize();
+    driver->enqImageWriteCache(cache);
+    return true;
+}
 
 void
 watchShaderDsos(ChangeWatcher& watcher, const rndr::RenderContext& renderContext)
@@ -8,6 +8,7 @@
 
 #include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
 
+#include <memory>
 #include <sstream>
 #include <vector>
 
@@ -21,6 +22,7 @@ class SceneObject;
 
 namespace moonray {
 class ChangeWatcher;
+class MetricsServer;
 
 namespace rndr {
 class RenderContext;
@@ -49,6 +51,11 @@ protected:
     void parseOptions(bool guiMode);
 
     void logInitMessages();
+
+    // Serves the live counters of renderContext at /metrics when the options set a
+    // metrics port, returns null otherwise. Destroy the server before the context.
+    std::unique_ptr<MetricsServer> startMetricsServer(const rndr::RenderContext& renderContext) const;
+
     std::string secStr(double etaSec) const;
 
     int mArgc;
@@ -76,7 +83,23 @@ writeRenderOutputsWithMessages(const rndr::RenderOutputDriver *renderOutputs,
                                const scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                                const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
-                               const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers);
+                               const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                               const bool tiled);
+
+// Same as writeRenderOutputsWithMessages() but the outputs are only copied into an ImageWriteCache
+// here and written by the ImageWriteDriver thread, so the caller can go on with the next frame.
+// Returns false without writing anything when they have to be written by
+// writeRenderOutputsWithMessages() instead: deep outputs, files streamed while rendering and the
+// final copy of two stage checkpoint files. Write failures are counted by the ImageWriteDriver.
+bool
+enqRenderOutputs(const std::shared_ptr<const rndr::RenderOutputDriver> &renderOutputs,
+                 pbr::CryptomatteBuffer *cryptomatteBuffer,
+                 const scene_rdl2::fb_util::HeatMapBuffer *heatMap,
+                 const scene_rdl2::fb_util::FloatBuffer *weightBuffer,
+                 const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
+                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
+                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                 const bool tiled);
 
 void
 watchShaderDsos(ChangeWatcher& watcher,
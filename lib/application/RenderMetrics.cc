@@ -0,0 +1,162 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "RenderMetrics.h"
+
+#include <moonray/common/time/Timer.h>
+#include <moonray/rendering/pbr/core/PbrTLState.h>
+#include <moonray/rendering/rndr/RenderContext.h>
+#include <moonray/rendering/texturing/sampler/TextureSampler.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace moonray {
+
+namespace {
+
+struct RayType
+{
+    const char *mLabel;
+    unsigned mCounter;
+};
+
+const RayType sRayTypes[] = {
+    { "intersection",             pbr::STATS_INTERSECTION_RAYS },
+    { "bundled_intersection",     pbr::STATS_BUNDLED_INTERSECTION_RAYS },
+    { "bundled_gpu_intersection", pbr::STATS_BUNDLED_GPU_INTERSECTION_RAYS },
+    { "volume",                   pbr::STATS_VOLUME_RAYS },
+    { "occlusion",                pbr::STATS_OCCLUSION_RAYS },
+    { "bundled_occlusion",        pbr::STATS_BUNDLED_OCCLUSION_RAYS },
+    { "bundled_gpu_occlusion",    pbr::STATS_BUNDLED_GPU_OCCLUSION_RAYS },
+    { "presence_shadow",          pbr::STATS_PRESENCE_SHADOW_RAYS },
+};
+
+void
+writeHeader(std::ostream &out, const char *name, const char *type, const char *help)
+{
+    out << "# HELP " << name << ' ' << help << '\n'
+        << "# TYPE " << name << ' ' << type << '\n';
+}
+
+template <typename T>
+void
+writeMetric(std::ostream &out, const char *name, const char *type, const char *help, T value)
+{
+    writeHeader(out, name, type, help);
+    out << name << ' ' << value << '\n';
+}
+
+double
+ratePerSecond(uint64_t current, uint64_t previous, double seconds)
+{
+    // A counter below its previous value was reset by a new frame.
+    if (seconds <= 0.0 || current < previous) {
+        return 0.0;
+    }
+    return double(current - previous) / seconds;
+}
+
+} // namespace
+
+RenderMetrics::RenderMetrics(const rndr::RenderContext &renderContext) :
+    mRenderContext(renderContext)
+{
+}
+
+std::string
+RenderMetrics::collect()
+{
+    // Sum the per thread counters, they are plain counters each thread bumps
+    // on its own, reading them while rendering only costs some precision.
+    uint64_t rays[sizeof(sRayTypes) / sizeof(sRayTypes[0])] = {};
+    uint64_t pixelSamples = 0;
+    uint64_t shaderEvals = 0;
+    pbr::forEachTLS([&](pbr::TLState const *tls) {
+        for (size_t i = 0; i < sizeof(sRayTypes) / sizeof(sRayTypes[0]); ++i) {
+            rays[i] += tls->mStatistics.getCounter(sRayTypes[i].mCounter);
+        }
+        pixelSamples += tls->mStatistics.getCounter(pbr::STATS_PIXEL_SAMPLES);
+        shaderEvals += tls->mStatistics.getCounter(pbr::STATS_SHADER_EVALS);
+    });
+
+    uint64_t totalRays = 0;
+    for (uint64_t count : rays) {
+        totalRays += count;
+    }
+
+    std::size_t submitted = 0;
+    std::size_t total = 0;
+    const float progress = mRenderContext.getFrameProgressFraction(&submitted, &total);
+
+    Counters current;
+    current.mTime = time::getTime();
+    current.mSamples = pixelSamples;
+    current.mRays = totalRays;
+
+    Counters previous;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        previous = mPrevious;
+        mPrevious = current;
+    }
+    const double elapsed = previous.mTime > 0.0 ? current.mTime - previous.mTime : 0.0;
+
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    writeMetric(out, "moonray_frame_rendering", "gauge",
+                "1 while a frame is rendering.", mRenderContext.isFrameRendering() ? 1 : 0);
+    writeMetric(out, "moonray_frame_progress", "gauge",
+                "Fraction of the frame samples rendered, 0 to 1.",
+                total ? std::max(0.0f, std::min(progress, 1.0f)) : 0.0f);
+    writeMetric(out, "moonray_frame_samples_submitted", "gauge",
+                "Samples submitted to the render threads this frame.", submitted);
+    writeMetric(out, "moonray_frame_samples_total", "gauge",
+                "Samples the frame renders once complete.", total);
+
+    writeMetric(out, "moonray_pixel_samples_total", "counter",
+                "Pixel samples rendered this frame.", pixelSamples);
+    writeMetric(out, "moonray_pixel_samples_per_second", "gauge",
+                "Pixel samples rendered per second since the previous scrape.",
+                ratePerSecond(current.mSamples, previous.mSamples, elapsed));
+    writeMetric(out, "moonray_shader_evals_total", "counter",
+                "Shader evaluations this frame.", shaderEvals);
+
+    writeHeader(out, "moonray_rays_total", "counter", "Rays traced this frame, by ray type.");
+    for (size_t i = 0; i < sizeof(sRayTypes) / sizeof(sRayTypes[0]); ++i) {
+        out << "moonray_rays_total{type=\"" << sRayTypes[i].mLabel << "\"} " << rays[i] << '\n';
+    }
+    writeMetric(out, "moonray_rays_per_second", "gauge",
+                "Rays of all types traced per second since the previous scrape.",
+                ratePerSecond(current.mRays, previous.mRays, elapsed));
+
+    const texture::TextureSampler *sampler = texture::getTextureSampler();
+    int64_t textureCacheMemory = 0;
+    if (sampler) {
+        const texture::TextureSampler::CacheCounters cache = sampler->getCacheCounters();
+        textureCacheMemory = cache.mMemoryUsed;
+        writeMetric(out, "moonray_texture_tile_lookups_total", "counter",
+                    "Texture tile lookups.", cache.mTileLookups);
+        writeMetric(out, "moonray_texture_tile_misses_total", "counter",
+                    "Texture tile lookups which had to read the tile.", cache.mTileMisses);
+        writeMetric(out, "moonray_texture_cache_hit_ratio", "gauge",
+                    "Fraction of the texture tile lookups found in the cache.",
+                    cache.mTileLookups > 0 ?
+                    1.0 - double(cache.mTileMisses) / double(cache.mTileLookups) : 1.0);
+        writeMetric(out, "moonray_texture_read_bytes_total", "counter",
+                    "Bytes read from texture files.", cache.mBytesRead);
+    }
+
+    writeHeader(out, "moonray_memory_bytes", "gauge", "Memory in use, by subsystem.");
+    out << "moonray_memory_bytes{subsystem=\"process\"} " << mProcessStats.getProcessMemory() << '\n'
+        << "moonray_memory_bytes{subsystem=\"texture_cache\"} " << textureCacheMemory << '\n';
+    writeMetric(out, "moonray_process_read_bytes_total", "counter",
+                "Bytes the process read, all files included.", mProcessStats.getBytesRead());
+
+    return out.str();
+}
+
+} // namespace moonray
+
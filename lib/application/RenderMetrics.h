@@ -0,0 +1,51 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <moonray/common/mcrt_util/ProcessStats.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace moonray {
+
+namespace rndr {
+class RenderContext;
+}
+
+//
+// Snapshot of the live render counters in the Prometheus text exposition
+// format, for MetricsServer. The counters are read as they are, from the per
+// thread statistics and the texture cache, without pausing the render, so a
+// snapshot taken mid pass can be a few samples off between two counters.
+//
+// The per thread counters restart from zero every frame, which Prometheus
+// treats as a counter reset. The *_per_second gauges are the rates since the
+// previous snapshot.
+//
+class RenderMetrics
+{
+public:
+    explicit RenderMetrics(const rndr::RenderContext &renderContext);
+
+    std::string collect();
+
+private:
+    struct Counters
+    {
+        double mTime {0.0};
+        uint64_t mSamples {0};
+        uint64_t mRays {0};
+    };
+
+    const rndr::RenderContext &mRenderContext;
+    util::ProcessStats mProcessStats;
+
+    std::mutex mMutex;
+    Counters mPrevious;
+};
+
+} // namespace moonray
+
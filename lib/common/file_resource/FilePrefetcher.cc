@@ -0,0 +1,103 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+
+#include "FilePrefetcher.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moonray {
+namespace file_resource {
+
+FilePrefetcher::FilePrefetcher()
+    : mStop(false)
+{
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mQueue.clear();
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void
+FilePrefetcher::prefetch(const std::string& path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mStop || !mRequested.emplace(path, st.st_mtim.tv_sec, st.st_mtim.tv_nsec).second) {
+            return;
+        }
+        mQueue.push_back(path);
+        // threads are only started once something is prefetched
+        if (mThreads.size() < sNumThreads && mThreads.size() < mQueue.size()) {
+            mThreads.emplace_back(&FilePrefetcher::run, this);
+        }
+    }
+    mCondition.notify_one();
+}
+
+void
+FilePrefetcher::run()
+{
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+            if (mStop) {
+                return;
+            }
+            path = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+        readFile(path);
+    }
+}
+
+void
+FilePrefetcher::readFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    // The hints are enough for local disks, network file systems only fill
+    // the cache on actual reads.
+#ifndef __APPLE__
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+    std::vector<char> buffer(1 << 20);
+    while (::read(fd, buffer.data(), buffer.size()) > 0) {
+    }
+    ::close(fd);
+}
+
+FilePrefetcher&
+getFilePrefetcher()
+{
+    static FilePrefetcher prefetcher;
+    return prefetcher;
+}
+
+} // namespace file_resource
+} // namespace moonray
+
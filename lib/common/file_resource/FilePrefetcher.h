@@ -0,0 +1,58 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/** FilePrefetcher reads files in the background so that the page cache
+ * already holds them when they are opened. Geometry files are requested
+ * when their procedural is generated and read at tessellation, the
+ * prefetch hides the file system latency in between.
+ *
+ * Reads are latency bound, so a few threads are used regardless of the
+ * number of cores. A file is only read once per modification time.
+ */
+namespace moonray {
+namespace file_resource {
+
+class FilePrefetcher
+{
+public:
+    FilePrefetcher();
+    ~FilePrefetcher();
+
+    /* queue the file to be read, returns immediately */
+    void prefetch(const std::string& path);
+
+private:
+    static constexpr unsigned sNumThreads = 4;
+
+    void run();
+    static void readFile(const std::string& path);
+
+    // path, mtime seconds, mtime nanoseconds
+    typedef std::tuple<std::string, long, long> Key;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::string> mQueue;
+    std::set<Key> mRequested;
+    std::vector<std::thread> mThreads;
+    bool mStop;
+};
+
+FilePrefetcher& getFilePrefetcher();
+
+} // namespace file_resource
+} // namespace moonray
+
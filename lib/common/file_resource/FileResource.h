@@ -43,6 +43,11 @@ public:
        returns NULL if stream cannot be obtained. */
     virtual std::ostream* openOStream() = 0;
 
+    /* start reading this file in the background, so a later
+       read doesn't wait on the file system. returns immediately.
+       resources that can't be prefetched ignore it. */
+    virtual void prefetch() {}
+
     /* return true if this represents an indexed set of
        files */
     virtual bool supportsIndexing() const = 0;
@@ -4,6 +4,7 @@
 //
 
 #include "UNIXFileResource.h"
+#include "FilePrefetcher.h"
 #include <fstream>
 #include <scene_rdl2/render/util/Strings.h>
 #include <unistd.h>
@@ -53,6 +54,12 @@ UNIXFileResource:: openOStream()
     return new std::ofstream(mPath.c_str());
 }
 
+void
+UNIXFileResource::prefetch()
+{
+    getFilePrefetcher().prefetch(mPath);
+}
+
 bool 
 UNIXFileResource::supportsIndexing() const
 {
@@ -24,6 +24,7 @@ public:
     bool exists() const;
     std::istream* openIStream();
     std::ostream* openOStream();
+    void prefetch();
 
     bool supportsIndexing() const;
     FileResource* getIndexed(float indexVal) const;
@@ -59,6 +59,12 @@ bool fileExists(const std::string& name)
     return resource->exists();
 }
 
+void prefetchFile(const std::string& name)
+{
+    std::unique_ptr<FileResource> resource(getFileResource(name));
+    resource->prefetch();
+}
+
 } // namespace file_resource
 } // namespace moonray
 
@@ -25,6 +25,11 @@ namespace file_resource {
     FileResource* getFileResource(const std::string& name);
 
     bool fileExists(const std::string & name);
+
+    /* Start reading the file in the background, see
+     * FileResource::prefetch()
+     */
+    void prefetchFile(const std::string & name);
 }
 }
 
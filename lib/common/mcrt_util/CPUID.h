@@ -165,6 +165,18 @@ public:
         return cpuid_detail::is_set(s_features, cpuid_detail::CPUFeatures::CPU_FEATURE_AVX512F);
     }
 
+    // The AVX-512 subsets of Skylake server and later, which ISPC's avx512skx
+    // targets need.
+    bool avx512skx() const noexcept
+    {
+        using cpuid_detail::CPUFeatures;
+        return cpuid_detail::is_set(s_features, CPUFeatures::CPU_FEATURE_AVX512F  |
+                                                CPUFeatures::CPU_FEATURE_AVX512CD |
+                                                CPUFeatures::CPU_FEATURE_AVX512DQ |
+                                                CPUFeatures::CPU_FEATURE_AVX512BW |
+                                                CPUFeatures::CPU_FEATURE_AVX512VL);
+    }
+
 private:
     static constexpr std::size_t log2(std::size_t n) noexcept
     {
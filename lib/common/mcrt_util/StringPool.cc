@@ -12,14 +12,6 @@ StringPool& getStringPool()
     return sInstance;
 }
 
-StringPool::~StringPool() 
-{
-    for (auto& s: mStringMap) {
-        delete s.second;
-    }
-    mStringMap.clear();
-}
-
 } // namespace util
 } // namespace moonray
 
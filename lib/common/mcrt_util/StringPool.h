@@ -10,46 +10,46 @@
 #pragma once
 
 #include <scene_rdl2/common/platform/Platform.h>
-#include <tbb/concurrent_unordered_map.h>
+#include <tbb/concurrent_unordered_set.h>
+#include <cstddef>
 #include <string>
 
 namespace moonray {
 namespace util {
 
+// Interns strings: equal strings get the same pointer, which stays valid for
+// the lifetime of the pool, so interned strings compare by pointer.
+// Lookups and inserts don't lock and run concurrently. The interned string is
+// the key of the set node, so a string costs a single allocation, and the
+// thread losing an insert race gets the winner's node back from insert().
 class StringPool
 {
 public:
     StringPool() = default;
-    ~StringPool();
 
     StringPool(const StringPool&) = delete;
     StringPool& operator=(const StringPool&) = delete;
 
     const std::string* get(const std::string& s);
 
+    // Number of distinct strings interned.
+    std::size_t size() const { return mStrings.size(); }
+
 private:
-    typedef tbb::concurrent_unordered_map<std::string, std::string*> StringMap;
+    typedef tbb::concurrent_unordered_set<std::string> StringSet;
 
 private:
-    StringMap mStringMap;
+    StringSet mStrings;
 };
 
 finline const std::string* StringPool::get(const std::string& s)
 {
-    auto it = mStringMap.find(s);
-    if (it != mStringMap.end()) {
-        return it->second;
-    } else {
-        std::string* newString = new std::string(s);  
-        std::pair<std::string, std::string*> item(s, newString);
-        std::pair<StringMap::iterator, bool> result = mStringMap.insert(item);
-        if (result.second) {
-            return newString;
-        } else {
-            delete newString;
-            return mStringMap[s];
-        }
+    // Nodes are never erased, their addresses are stable.
+    auto it = mStrings.find(s);
+    if (it == mStrings.end()) {
+        it = mStrings.insert(s).first;
     }
+    return &*it;
 }
 
 // TODO remove this temporary singleton-like interface when we have
@@ -9,6 +9,7 @@
 #include <scene_rdl2/common/platform/Platform.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <system_error>
 #include <thread>
@@ -401,7 +402,10 @@ inline void wait(const std::atomic<T>& a, T old, std::memory_order order = std::
     const T* const addr = reinterpret_cast<const T*>(std::addressof(a));
     wait_impl::atomic_wait_address_v(addr, old, [order, &a] { return a.load(order); });
 #else
-    wait_impl::spin_lock([&a, old, order]() { return a.load(order) != old; });
+    // No futex: back off to short sleeps once the spinning is over, so long
+    // waits don't keep a core busy.
+    wait_impl::atomic_spin([&a, old, order]() { return a.load(order) != old; },
+                           [] { std::this_thread::sleep_for(std::chrono::microseconds(100)); return true; });
 #endif
 }
 
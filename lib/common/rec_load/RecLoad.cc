@@ -610,6 +610,33 @@ RecLoad::outputLogsCSV()
     ofs.close();
 }
 
+//------------------------------------------------------------------------------
+
+bool
+RecLoadSampler::sample(RecLoadCoreStat &average)
+{
+    std::vector<RecLoadCoreStat> coresCurrent;
+    if (!RecLoad::getCoresStat(coresCurrent)) {
+        return false;
+    }
+
+    const bool first = (mCoresPrevious.size() != coresCurrent.size());
+    average.reset();
+    if (!first) {
+        for (size_t coreId = 0; coreId < coresCurrent.size(); ++coreId) {
+            RecLoadCoreStat currCore = coresCurrent[coreId] - mCoresPrevious[coreId];
+            float total = std::max(currCore.getTotal(), 1.0f); // minimum = 1 tick
+            currCore *= 1.0f / total;
+            currCore.rangeClip(0.0f, 1.0f); // 0.0 ~ 1.0
+            average += currCore;
+        }
+        average *= 1.0f / static_cast<float>(coresCurrent.size());
+    }
+    mCoresPrevious.swap(coresCurrent);
+
+    return !first;              // first call only initializes the previous status
+}
+
 } // namespace rec_load
 } // namespace moonray
 
@@ -90,6 +90,7 @@ public:
 
     float getUser() const { return mData[id(Tag::USER)]; }
     float getSys() const { return mData[id(Tag::SYS)]; }
+    float getIdle() const { return mData[id(Tag::IDLE)]; }
 
     void rangeClip(const float minVal, const float maxVal) {
         for (size_t i = 0; i < id(Tag::SIZE); ++i) { mData[i] = std::max(minVal, std::min(maxVal, mData[i])); }
@@ -231,6 +232,25 @@ protected:
 
     scene_rdl2::rec_time::RecTime mRecTime;           // time between startLog ~ stopLog
     float mStartEndDurationSec;
+
+    friend class RecLoadSampler;
+};
+
+//
+// Light weight CPU load sampling without watchdog thread and log. Used for runtime decisions like
+// multi-machine load balancing. Each sample() call returns the average load of all cores between
+// the previous and current call.
+//
+class RecLoadSampler
+{
+public:
+    bool sample(RecLoadCoreStat &average); // non MTsafe
+
+    // user + nice + sys : 0.0 ~ 1.0
+    static float getUsage(const RecLoadCoreStat &average) { return 1.0f - average.getIdle(); }
+
+protected:
+    std::vector<RecLoadCoreStat> mCoresPrevious; // non normalize raw value
 };
 
 } // namespace rec_load
@@ -7,6 +7,9 @@
 #include <OpenEXR/ImfHeader.h>
 #include <OpenEXR/ImfDeepImage.h>
 
+#include <algorithm>
+#include <map>
+
 OPENDCX_INTERNAL_NAMESPACE_HEADER_ENTER
 
 
@@ -660,4 +663,293 @@ DeepImageOutputTile::writeTile (bool flush_tile)
 }
 
 
+//----------------------------------------------------------
+//
+//  DeepImageInputTile
+//
+//----------------------------------------------------------
+
+
+DeepImageInputTile::DeepLine::DeepLine (uint32_t width,
+                                        size_t num_channels)
+{
+    channel_arrays.resize(num_channels);
+    samples_per_pixel.resize(width, 0);
+    pixel_offsets.resize(width, 0);
+}
+
+
+DeepImageInputTile::DeepImageInputTile (const char* filename,
+                                        ChannelContext& channel_ctx,
+                                        bool yAxisUp) :
+    DeepTile(channel_ctx,
+             WRITE_DISABLED,
+             yAxisUp),
+    m_file(new Imf::DeepScanLineInputFile(filename))
+{
+    const Imf::Header& hdr = m_file->header();
+
+    // The file's windows are Y-down, flip the data window if the tile is Y-up,
+    // matching what DeepImageOutputTile writes:
+    m_top_reference = hdr.displayWindow().max.y;
+    PixelTile::setDataWindow(hdr.dataWindow(), false/*sourceWindowYAxisUp*/, true/*force*/);
+    m_deep_lines.resize(std::max(0, h()), 0);
+
+    // Map the file channels to the context's, adding the unknown ones with
+    // the file name and pixel type so they are written back the same way:
+    ChannelSet channels;
+    std::map<ChannelIdx, std::string> file_names;
+    for (Imf::ChannelList::ConstIterator it = hdr.channels().begin(); it != hdr.channels().end(); ++it)
+    {
+        const std::string name(it.name());
+        ChannelAlias* c = channel_ctx.findChannelAlias(name);
+        if (!c)
+        {
+            const size_t dot = name.rfind('.');
+            const std::string layer = (dot == std::string::npos)?std::string("other"):name.substr(0, dot);
+            const std::string chan  = (dot == std::string::npos)?name:name.substr(dot + 1);
+            c = channel_ctx.addChannelAlias(chan,
+                                            layer,
+                                            OPENDCX_INTERNAL_NAMESPACE::Chan_Invalid,
+                                            0/*position*/,
+                                            name/*io_name*/,
+                                            it.channel().type,
+                                            0/*io_part*/);
+        }
+        if (c && file_names.find(c->channel()) == file_names.end())
+        {
+            channels += c->channel();
+            file_names[c->channel()] = name;
+        }
+    }
+    setChannels(channels, true/*force*/);
+
+    foreach_channel(z, m_channels)
+        m_file_channel_names.push_back(file_names[z]);
+}
+
+
+DeepImageInputTile::~DeepImageInputTile ()
+{
+    const size_t nLines = m_deep_lines.size();
+    for (size_t y=0; y < nLines; ++y)
+        delete m_deep_lines[y];
+    delete m_file;
+}
+
+
+void
+DeepImageInputTile::readScanlines (int y_min,
+                                   int y_max)
+{
+    y_min = std::max(y_min, m_dataWindow.min.y);
+    y_max = std::min(y_max, m_dataWindow.max.y);
+    if (y_min > y_max)
+        return;
+
+    const int width = w();
+    const int nLines = y_max - y_min + 1;
+    const size_t nChannels = m_file_channel_names.size();
+    const int file_y_min = std::min(flipY(y_min), flipY(y_max));
+    const int file_y_max = std::max(flipY(y_min), flipY(y_max));
+
+    // Slices are addressed in file pixel coordinates:
+    const ptrdiff_t count_origin = ptrdiff_t(m_dataWindow.min.x) + ptrdiff_t(file_y_min)*width;
+
+    std::vector<uint32_t> counts(size_t(width)*nLines);
+    Imf::DeepFrameBuffer fb;
+    fb.insertSampleCountSlice(Imf::Slice(Imf::UINT,
+                                         (char*)(counts.data() - count_origin),
+                                         sizeof(uint32_t)/*xStride*/,
+                                         sizeof(uint32_t)*width/*yStride*/));
+    m_file->setFrameBuffer(fb);
+    m_file->readPixelSampleCounts(file_y_min, file_y_max);
+
+    // Allocate the lines and point the channel slices at their packed arrays:
+    std::vector<PtrVec> data_ptrs(nChannels, PtrVec(size_t(width)*nLines));
+    for (int y=y_min; y <= y_max; ++y)
+    {
+        DeepLine*& dl = m_deep_lines[y - m_dataWindow.min.y];
+        delete dl;
+        dl = new DeepLine(width, nChannels);
+
+        const size_t row = size_t(flipY(y) - file_y_min)*width;
+        uint32_t offset = 0;
+        for (int x=0; x < width; ++x)
+        {
+            dl->samples_per_pixel[x] = counts[row + x];
+            dl->pixel_offsets[x] = offset;
+            offset += counts[row + x];
+        }
+        for (size_t c=0; c < nChannels; ++c)
+        {
+            FloatVec& values = dl->channel_arrays[c];
+            values.resize(offset);
+            for (int x=0; x < width; ++x)
+                data_ptrs[c][row + x] = values.data() + dl->pixel_offsets[x];
+        }
+    }
+
+    for (size_t c=0; c < nChannels; ++c)
+    {
+        fb.insert(m_file_channel_names[c], Imf::DeepSlice(Imf::FLOAT,
+                                                          (char*)(data_ptrs[c].data() - count_origin),
+                                                          sizeof(void*)/*xStride*/,
+                                                          sizeof(void*)*width/*yStride*/,
+                                                          sizeof(float)/*sampleStride*/));
+    }
+    m_file->setFrameBuffer(fb);
+    m_file->readPixels(file_y_min, file_y_max);
+}
+
+
+void
+DeepImageInputTile::flushScanlines (int y_min,
+                                    int y_max)
+{
+    y_min = std::max(y_min, m_dataWindow.min.y);
+    y_max = std::min(y_max, m_dataWindow.max.y);
+    for (int y=y_min; y <= y_max; ++y)
+    {
+        delete m_deep_lines[y - m_dataWindow.min.y];
+        m_deep_lines[y - m_dataWindow.min.y] = 0;
+    }
+}
+
+
+size_t
+DeepImageInputTile::bytesUsed () const
+{
+    size_t count = 0;
+    const size_t nLines = m_deep_lines.size();
+    for (size_t j=0; j < nLines; ++j)
+    {
+        const DeepLine* dl = m_deep_lines[j];
+        if (dl)
+        {
+            for (size_t c=0; c < dl->channel_arrays.size(); ++c)
+                count += dl->channel_arrays[c].size();
+        }
+    }
+    return (count * sizeof(float));
+}
+
+
+/*virtual*/
+size_t
+DeepImageInputTile::getNumSamplesAt (int x, int y) const
+{
+    const DeepLine* dl = getLine(y);
+    if (!dl)
+        return 0;
+    x -= m_dataWindow.min.x;
+    return (x < 0 || x >= (int)dl->samples_per_pixel.size())?0:dl->samples_per_pixel[x];
+}
+
+
+/*virtual*/
+bool
+DeepImageInputTile::getDeepPixel (int x,
+                                  int y,
+                                  OPENDCX_INTERNAL_NAMESPACE::DeepPixel& deep_pixel) const
+{
+    deep_pixel.clear();
+    if (!isActivePixel(x, y))
+        return false;
+
+    ChannelSet out_channels(m_channels);
+    out_channels -= Mask_DeepMetadata;
+    deep_pixel.setChannels(out_channels);
+
+    const DeepLine* dl = getLine(y);
+    if (!dl)
+        return true;
+
+    const int xoffset = x - m_dataWindow.min.x;
+    const uint32_t nSegments = dl->samples_per_pixel[xoffset];
+    if (nSegments == 0)
+        return true;
+    deep_pixel.reserve(nSegments);
+
+    const uint32_t foffset = dl->pixel_offsets[xoffset];
+
+    OPENDCX_INTERNAL_NAMESPACE::DeepSegment ds;
+    OPENDCX_INTERNAL_NAMESPACE::Pixelf dp(deep_pixel.channels());
+    dp.erase();
+    float sp1, sp2;
+
+    for (uint32_t i=0; i < nSegments; ++i)
+    {
+        ds.Zf = ds.Zb = 0.0f;
+        sp1 = sp2 = 0.0f;
+        ds.metadata.flags.clearAll();
+
+        int chan_index = 0;
+        foreach_channel(z, m_channels)
+        {
+            const float v = dl->channel_arrays[chan_index][foffset + i];
+            if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_ZFront)
+                ds.Zf = v;
+            else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_ZBack)
+                ds.Zb = v;
+            else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_SpBits1)
+                sp1 = v;
+            else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_SpBits2)
+                sp2 = v;
+            else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_DeepFlags)
+                ds.metadata.flags.fromFloat(v);
+            else
+                dp[z] = v;
+            ++chan_index;
+        }
+
+        ds.metadata.spmask.fromFloat(sp1, sp2);
+        if (ds.Zb < ds.Zf)
+            ds.Zb = ds.Zf;
+        ds.index = -1; // gets updated when added to deep pixel
+
+        deep_pixel.append(ds, dp);
+    }
+
+    return true;
+}
+
+
+/*virtual*/
+bool
+DeepImageInputTile::getSampleMetadata (int x,
+                                       int y,
+                                       size_t sample,
+                                       OPENDCX_INTERNAL_NAMESPACE::DeepMetadata& metadata) const
+{
+    if (!isActivePixel(x, y))
+        return false;
+
+    const DeepLine* dl = getLine(y);
+    const int xoffset = x - m_dataWindow.min.x;
+    if (!dl || sample >= dl->samples_per_pixel[xoffset])
+        return false;
+
+    const uint32_t foffset = dl->pixel_offsets[xoffset] + (uint32_t)sample;
+
+    float sp1=0.0f, sp2=0.0f;
+    metadata.flags.clearAll();
+
+    int chan_index = 0;
+    foreach_channel(z, m_channels)
+    {
+        if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_SpBits1)
+            sp1 = dl->channel_arrays[chan_index][foffset];
+        else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_SpBits2)
+            sp2 = dl->channel_arrays[chan_index][foffset];
+        else if (z == OPENDCX_INTERNAL_NAMESPACE::Chan_DeepFlags)
+            metadata.flags = (int)floorf(dl->channel_arrays[chan_index][foffset]);
+        ++chan_index;
+    }
+
+    metadata.spmask.fromFloat(sp1, sp2);
+    return true;
+}
+
+
 OPENDCX_INTERNAL_NAMESPACE_HEADER_EXIT
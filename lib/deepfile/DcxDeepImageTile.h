@@ -7,6 +7,7 @@
 //=============================================================================
 //
 //  class  DeepImageOutputTile
+//  class  DeepImageInputTile
 //
 //=============================================================================
 
@@ -20,6 +21,7 @@
 #endif
 #include <OpenEXR/ImfDeepImage.h>
 #include <OpenEXR/ImfDeepImageLevel.h>
+#include <OpenEXR/ImfDeepScanLineInputFile.h>
 #include <OpenEXR/ImfDeepScanLineOutputFile.h>
 
 #ifdef DEBUG
@@ -248,6 +250,134 @@ class DCX_EXPORT DeepImageOutputTile : public DeepTile, public ImageFormat
 
 
 
+//------------------------------
+//!rst:left-align::
+//.. _deepimageinputtile_class:
+//
+//DeepImageInputTile
+//==================
+//------------------------------
+
+//==============================
+//
+//  class DeepImageInputTile
+//
+//==============================
+//-----------------------------------------------------------------------------
+//
+//  Adapter class for an input deep scanline file.
+//
+//  Only the scanlines loaded with readScanlines() are held in memory, so
+//  large files can be streamed through in bands of lines.
+//
+//  Every channel of the file is read as float. Channels the ChannelContext
+//  doesn't know yet are added to it with the file's pixel type, so a
+//  DeepImageOutputTile sharing the context writes them back unchanged.
+//
+//-----------------------------------------------------------------------------
+
+
+class DCX_EXPORT DeepImageInputTile : public DeepTile
+{
+  public:
+
+    typedef std::vector<float>    FloatVec;
+    typedef std::vector<void*>    PtrVec;
+
+    struct DeepLine
+    {
+        std::vector<FloatVec> channel_arrays;       // Packed channel data for entire line
+        std::vector<uint32_t> samples_per_pixel;    // Per-pixel sample count
+        std::vector<uint32_t> pixel_offsets;        // Per-pixel offset into channel_arrays
+
+        DeepLine (uint32_t width, size_t num_channels);
+    };
+
+
+  public:
+
+    //
+    // Opens the file and gets resolution and channel info from its header.
+    // Throws the OpenEXR exceptions if the file can't be opened.
+    //
+
+    DeepImageInputTile (const char* filename,
+                        ChannelContext& channel_ctx,
+                        bool yAxisUp=true);
+
+    //
+    ~DeepImageInputTile ();
+
+
+    //
+    // The header of the input file
+    //
+
+    const Imf::Header&  header () const;
+
+
+    //
+    // Load the pixel-space lines y_min..y_max (inclusive) from the file,
+    // clipped to the data window. Lines loaded before are kept until
+    // flushed.
+    //
+
+    void        readScanlines (int y_min,
+                               int y_max);
+
+
+    //
+    // Free the memory of the lines y_min..y_max (inclusive).
+    //
+
+    void        flushScanlines (int y_min,
+                                int y_max);
+
+
+    //
+    // Returns the number of total bytes used by the loaded lines.
+    //
+
+    size_t      bytesUsed () const;
+
+
+    //
+    // Returns the number of deep samples at pixel x,y, 0 if its line isn't
+    // loaded.
+    //
+
+    /*virtual*/ size_t getNumSamplesAt (int x, int y) const;
+
+
+    //
+    // Reads deep samples from a pixel-space location (x, y) into a deep pixel.
+    // If xy is out of bounds the deep pixel is left empty and false is returned.
+    // Pixels of lines which aren't loaded are empty.
+    //
+
+    /*virtual*/ bool getDeepPixel (int x,
+                                   int y,
+                                   OPENDCX_INTERNAL_NAMESPACE::DeepPixel& pixel) const;
+
+    /*virtual*/ bool getSampleMetadata (int x,
+                                        int y,
+                                        size_t sample,
+                                        OPENDCX_INTERNAL_NAMESPACE::DeepMetadata& metadata) const;
+
+
+  protected:
+
+    const DeepLine* getLine (int y) const;
+
+
+    std::vector<DeepLine*>          m_deep_lines;           // Loaded lines, null if not loaded
+    std::vector<std::string>        m_file_channel_names;   // File channel name of each channel, in channel order
+    OPENEXR_IMF_NAMESPACE::DeepScanLineInputFile* m_file;   // Input file
+
+};
+
+
+
 //--------------
 //!rst:cpp:end::
 //--------------
@@ -277,6 +407,13 @@ DeepImageOutputTile::DeepLine::floatOffset (uint32_t xoffset) const
     return offset;
 }
 
+//-------------------------------------------------------
+inline const Imf::Header& DeepImageInputTile::header () const { return m_file->header(); }
+//-------------------------------------------------------
+inline
+const DeepImageInputTile::DeepLine* DeepImageInputTile::getLine(int y) const {
+    return (y < m_dataWindow.min.y || y > m_dataWindow.max.y)?0:m_deep_lines[y - m_dataWindow.min.y]; }
+
 
 OPENDCX_INTERNAL_NAMESPACE_HEADER_EXIT
 
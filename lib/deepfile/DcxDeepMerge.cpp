@@ -0,0 +1,288 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DcxDeepMerge.h"
+#include "DcxChannelContext.h"
+#include "DcxDeepImageTile.h"
+
+#include <OpenEXR/Iex.h>
+#include <OpenEXR/ImfHeader.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+OPENDCX_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+DeepMergeOptions::DeepMergeOptions () :
+    z_tolerance(0.001f),
+    value_tolerance(0.001f),
+    band_height(64)
+{
+    //
+}
+
+
+DeepMergeStats::DeepMergeStats () :
+    input_segments(0),
+    output_segments(0)
+{
+    //
+}
+
+
+namespace {
+
+//
+// Header attributes describing the file layout, set by DeepImageOutputTile
+// or the OpenEXR library rather than copied from the input.
+//
+
+const char* const layoutAttributes[] = {
+    "channels", "chunkCount", "dataWindow", "displayWindow", "lineOrder",
+    "compression", "type", "version", "tiles", "name"
+};
+
+
+bool
+isLayoutAttribute (const char* name)
+{
+    for (const char* attr : layoutAttributes)
+        if (strcmp(name, attr) == 0)
+            return true;
+    return false;
+}
+
+
+inline bool
+withinTolerance (float a,
+                 float b,
+                 float tolerance,
+                 float floor)
+{
+    return fabsf(a - b) <= tolerance*std::max(floor, std::max(fabsf(a), fabsf(b)));
+}
+
+
+//
+// Can segment b be collapsed into a without changing the flattened result
+// beyond the tolerances?
+//
+
+bool
+isCollapsible (const DeepSegment& a,
+               const Pixelf& ap,
+               const DeepSegment& b,
+               const Pixelf& bp,
+               const ChannelSet& id_channels,
+               const ChannelSet& value_channels,
+               const DeepMergeOptions& options)
+{
+    // Hard surface samples covering different subpixels only:
+    if (!a.isHardSurface() || a.isMatte() || a.hasPartialSpCoverage() || !(a.flags() == b.flags()))
+        return false;
+    if (a.zeroCoverage() || b.zeroCoverage() || (a.spMask() & b.spMask()) != SpMask8::zeroCoverage)
+        return false;
+
+    if (!withinTolerance(a.Zf, b.Zf, options.z_tolerance, 0.0f) ||
+        !withinTolerance(a.Zb, b.Zb, options.z_tolerance, 0.0f))
+        return false;
+
+    foreach_channel(z, id_channels)
+    {
+        if (ap[z] != bp[z])
+            return false;
+    }
+    foreach_channel(z, value_channels)
+    {
+        if (!withinTolerance(ap[z], bp[z], options.value_tolerance, 1.0f))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+size_t
+compactDeepPixel (DeepPixel& pixel,
+                  const ChannelSet& id_channels,
+                  const DeepMergeOptions& options)
+{
+    const size_t nSegments = pixel.size();
+    if (nSegments < 2)
+        return 0;
+    pixel.sort();
+
+    ChannelSet value_channels(pixel.channels());
+    value_channels -= Mask_Depths;
+    value_channels -= Mask_DeepMetadata;
+    value_channels -= id_channels;
+
+    DeepPixel out(pixel.channels());
+    out.setXY(pixel.x(), pixel.y());
+    out.reserve(nSegments);
+
+    for (size_t i=0; i < nSegments; ++i)
+    {
+        const DeepSegment& b = pixel[i];
+        const Pixelf& bp = pixel.getSegmentPixel(b);
+
+        if (!out.empty())
+        {
+            // Only the previous segment is a candidate, segments of the same
+            // surface are next to each other once Z sorted:
+            DeepSegment& a = out[out.size()-1];
+            Pixelf& ap = out.getSegmentPixel(a);
+            if (isCollapsible(a, ap, b, bp, id_channels, value_channels, options))
+            {
+                const float wa = float(a.spMask().bitsOn());
+                const float wb = float(b.spMask().bitsOn());
+                const float t = wb/(wa + wb);
+                a.Zf += (b.Zf - a.Zf)*t;
+                a.Zb += (b.Zb - a.Zb)*t;
+                a.spMask() |= b.spMask();
+                foreach_channel(z, value_channels)
+                    ap[z] += (bp[z] - ap[z])*t;
+                continue;
+            }
+        }
+        out.append(b, bp);
+    }
+
+    const size_t removed = nSegments - out.size();
+    if (removed > 0)
+        pixel = out;
+    return removed;
+}
+
+
+DeepMergeStats
+mergeDeepFiles (const std::vector<std::string>& inputs,
+                const std::string& output,
+                const DeepMergeOptions& options)
+{
+    if (inputs.empty())
+        throw IEX_NAMESPACE::ArgExc("No input deep files to merge.");
+
+    // All tiles work in the files' Y-down space:
+    ChannelContext channel_ctx;
+    std::vector<std::unique_ptr<DeepImageInputTile>> tiles;
+    IMATH_NAMESPACE::Box2i display_window;
+    IMATH_NAMESPACE::Box2i data_window;
+    ChannelSet channels;
+    for (const std::string& input : inputs)
+    {
+        tiles.emplace_back(new DeepImageInputTile(input.c_str(), channel_ctx, false/*yAxisUp*/));
+        const DeepImageInputTile& tile = *tiles.back();
+        if (tiles.size() == 1)
+            display_window = tile.header().displayWindow();
+        else if (tile.header().displayWindow() != display_window)
+            throw IEX_NAMESPACE::ArgExc("Deep file '" + input +
+                                        "' has a different display window than '" + inputs[0] + "'.");
+        data_window.extendBy(tile.dataWindow());
+        channels += tile.channels();
+    }
+
+    // Deep IDs, which must match for segments to collapse:
+    ChannelSet id_channels;
+    foreach_channel(z, channels)
+    {
+        const ChannelAlias* c = channel_ctx.findChannelAlias(z);
+        if (c && c->layer() == "deep")
+            id_channels += z;
+    }
+    for (const std::string& name : options.id_channel_names)
+    {
+        const ChannelAlias* c = channel_ctx.findChannelAlias(name);
+        if (!c || !channels.contains(c->channel()))
+            throw IEX_NAMESPACE::ArgExc("Deep ID channel '" + name + "' isn't in the input deep files.");
+        id_channels += c->channel();
+    }
+
+    ChannelSet pixel_channels(channels);
+    pixel_channels -= Mask_DeepMetadata;
+
+    DeepImageOutputTile out_tile(display_window,
+                                 data_window,
+                                 false/*sourceWindowsYup*/,
+                                 channels,
+                                 channel_ctx,
+                                 false/*yAxisUp*/);
+
+    Imf::Header header;
+    const Imf::Header& in_header = tiles[0]->header();
+    for (Imf::Header::ConstIterator it = in_header.begin(); it != in_header.end(); ++it)
+    {
+        if (!isLayoutAttribute(it.name()))
+            header.insert(it.name(), it.attribute());
+    }
+    out_tile.setOutputFile(output.c_str(), header);
+
+    DeepMergeStats stats;
+    const int band_height = std::max(1, options.band_height);
+    for (int y_min=data_window.min.y; y_min <= data_window.max.y; y_min += band_height)
+    {
+        const int y_max = std::min(y_min + band_height - 1, data_window.max.y);
+        const int nLines = y_max - y_min + 1;
+
+        tbb::parallel_for(size_t(0), tiles.size(), [&](size_t i) {
+            tiles[i]->readScanlines(y_min, y_max);
+        });
+
+        // Lines are independent, each one only touches its own output DeepLine:
+        std::vector<size_t> input_segments(nLines, 0);
+        std::vector<size_t> output_segments(nLines, 0);
+        tbb::parallel_for(tbb::blocked_range<int>(y_min, y_max + 1, 1),
+                          [&](const tbb::blocked_range<int>& range) {
+            DeepPixel in_pixel(pixel_channels);
+            DeepPixel merged(pixel_channels);
+            Pixelf sample(pixel_channels);
+            for (int y=range.begin(); y != range.end(); ++y)
+            {
+                for (int x=data_window.min.x; x <= data_window.max.x; ++x)
+                {
+                    merged.clear();
+                    merged.setChannels(pixel_channels);
+                    merged.setXY(x, y);
+                    for (const auto& tile : tiles)
+                    {
+                        if (!tile->getDeepPixel(x, y, in_pixel))
+                            continue;
+                        for (size_t s=0; s < in_pixel.size(); ++s)
+                        {
+                            sample.erase();
+                            sample.copy(in_pixel.getSegmentPixel(s), in_pixel.channels());
+                            merged.append(in_pixel[s], sample);
+                        }
+                    }
+
+                    input_segments[y - y_min] += merged.size();
+                    compactDeepPixel(merged, id_channels, options);
+                    output_segments[y - y_min] += merged.size();
+
+                    out_tile.setDeepPixel(x, y, merged);
+                }
+            }
+        });
+
+        for (int y=y_min; y <= y_max; ++y)
+        {
+            out_tile.writeScanline(y, true/*flush_line*/);
+            stats.input_segments += input_segments[y - y_min];
+            stats.output_segments += output_segments[y - y_min];
+        }
+        for (const auto& tile : tiles)
+            tile->flushScanlines(y_min, y_max);
+    }
+
+    return stats;
+}
+
+
+OPENDCX_INTERNAL_NAMESPACE_HEADER_EXIT
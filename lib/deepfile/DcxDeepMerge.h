@@ -0,0 +1,106 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef INCLUDED_DCX_DEEPMERGE_H
+#define INCLUDED_DCX_DEEPMERGE_H
+
+//=============================================================================
+//
+//  struct DeepMergeOptions
+//  struct DeepMergeStats
+//
+//  compactDeepPixel()
+//  mergeDeepFiles()
+//
+//=============================================================================
+
+#include "DcxDeepPixel.h"
+
+#include <string>
+#include <vector>
+
+
+//-----------------
+//!rst:cpp:begin::
+//DeepMerge
+//=========
+//-----------------
+
+
+OPENDCX_INTERNAL_NAMESPACE_HEADER_ENTER
+
+//-----------------------------------------------------------------------------
+//
+//  Merging and compaction of deep files.
+//
+//  Merging combines the segments of the same pixel of several deep files,
+//  e.g. the outputs of render nodes which rendered different pixels or
+//  different subpixel samples of the same frame.
+//
+//  Compaction collapses hard surface segments which cover different subpixels
+//  of the same surface: their depths and channel values are within the
+//  tolerances and their deep IDs match. The collapsed segment covers the
+//  union of their subpixel masks and holds their coverage weighted average,
+//  so the flattened result doesn't change beyond the tolerances. Volumetric,
+//  matte, partial coverage and maskless (legacy) segments are left alone as
+//  collapsing them would change the result.
+//
+//-----------------------------------------------------------------------------
+
+struct DCX_EXPORT DeepMergeOptions
+{
+    float       z_tolerance;        // Max relative difference of the collapsed segments' depths
+    float       value_tolerance;    // Max relative difference of their channel values (absolute below 1)
+    std::vector<std::string> id_channel_names;  // Channels which must match exactly, besides the 'deep' layer
+    int         band_height;        // Scanlines held in memory at once per file, bounds the memory use
+
+    DeepMergeOptions ();
+};
+
+
+struct DCX_EXPORT DeepMergeStats
+{
+    size_t      input_segments;
+    size_t      output_segments;
+
+    DeepMergeStats ();
+};
+
+
+//
+// Collapses the segments of a deep pixel, sorting it.
+// Returns the number of segments removed.
+//
+
+DCX_EXPORT
+size_t  compactDeepPixel (DeepPixel& pixel,
+                          const ChannelSet& id_channels,
+                          const DeepMergeOptions& options);
+
+
+//
+// Merges and compacts the deep scanline files 'inputs' into 'output'.
+//
+// All the inputs must have the same display window, the output data window
+// and channels are the union of the inputs' and the header attributes are
+// copied from the first input. The files are streamed through in bands of
+// options.band_height scanlines, the pixels of a band are processed in
+// parallel.
+//
+// Throws the OpenEXR exceptions on I/O errors and Iex::ArgExc on
+// mismatching inputs.
+//
+
+DCX_EXPORT
+DeepMergeStats  mergeDeepFiles (const std::vector<std::string>& inputs,
+                                const std::string& output,
+                                const DeepMergeOptions& options);
+
+
+OPENDCX_INTERNAL_NAMESPACE_HEADER_EXIT
+
+//--------------
+//!rst:cpp:end::
+//--------------
+
+#endif // INCLUDED_DCX_DEEPMERGE_H
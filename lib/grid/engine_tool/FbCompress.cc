@@ -0,0 +1,194 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "FbCompress.h"
+
+#include <tbb/parallel_for.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+constexpr char sMagic[4] = {'M', 'F', 'B', 'Z'};
+constexpr uint32_t sVersion = 1;
+constexpr uint32_t sChunkSize = 1 << 20; // byte
+constexpr int sLevel = 1; // favor speed, the data is already packed by PackTiles
+
+struct Header
+{
+    char mMagic[4];
+    uint32_t mVersion;
+    uint64_t mRawSize;
+    uint32_t mChunkSize;
+    uint32_t mChunkTotal;
+    // followed by uint32_t compressed size of each chunk and the chunk data
+};
+
+} // namespace
+
+namespace moonray {
+namespace engine_tool {
+
+// static function
+size_t
+FbCompress::encode(const void *src, const size_t srcSize, std::string &dst)
+{
+    const uint32_t chunkTotal = static_cast<uint32_t>((srcSize + sChunkSize - 1) / sChunkSize);
+    const uint8_t *srcData = static_cast<const uint8_t *>(src);
+
+    std::vector<std::vector<Bytef>> chunks(chunkTotal);
+    std::vector<uint32_t> chunkSizes(chunkTotal);
+    std::atomic<bool> error(false);
+    tbb::parallel_for(0u, chunkTotal, [&](uint32_t chunkId) {
+        const size_t offset = static_cast<size_t>(chunkId) * sChunkSize;
+        const uLong len = static_cast<uLong>(std::min(static_cast<size_t>(sChunkSize), srcSize - offset));
+        std::vector<Bytef> &chunk = chunks[chunkId];
+        chunk.resize(compressBound(len));
+        uLongf chunkSize = chunk.size();
+        if (compress2(chunk.data(), &chunkSize, srcData + offset, len, sLevel) != Z_OK) {
+            error = true;
+            return;
+        }
+        chunkSizes[chunkId] = static_cast<uint32_t>(chunkSize);
+    });
+    if (error) return 0;
+
+    Header header;
+    std::memcpy(header.mMagic, sMagic, sizeof(sMagic));
+    header.mVersion = sVersion;
+    header.mRawSize = srcSize;
+    header.mChunkSize = sChunkSize;
+    header.mChunkTotal = chunkTotal;
+
+    size_t dataSize = sizeof(Header) + chunkTotal * sizeof(uint32_t);
+    for (uint32_t chunkSize : chunkSizes) dataSize += chunkSize;
+
+    dst.resize(dataSize);
+    char *ptr = &dst[0];
+    std::memcpy(ptr, &header, sizeof(Header));
+    ptr += sizeof(Header);
+    std::memcpy(ptr, chunkSizes.data(), chunkTotal * sizeof(uint32_t));
+    ptr += chunkTotal * sizeof(uint32_t);
+    for (uint32_t chunkId = 0; chunkId < chunkTotal; ++chunkId) {
+        std::memcpy(ptr, chunks[chunkId].data(), chunkSizes[chunkId]);
+        ptr += chunkSizes[chunkId];
+    }
+    return dataSize;
+}
+
+// static function
+bool
+FbCompress::isCompressed(const void *data, const size_t dataSize)
+{
+    if (dataSize < sizeof(Header)) return false;
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    return (std::memcmp(header.mMagic, sMagic, sizeof(sMagic)) == 0 && header.mVersion == sVersion);
+}
+
+// static function
+bool
+FbCompress::decode(const void *data, const size_t dataSize, std::string &dst)
+{
+    if (!isCompressed(data, dataSize)) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (header.mChunkSize == 0 ||
+        header.mChunkTotal != (header.mRawSize + header.mChunkSize - 1) / header.mChunkSize ||
+        dataSize < sizeof(Header) + header.mChunkTotal * sizeof(uint32_t)) {
+        return false;
+    }
+
+    const uint8_t *ptr = static_cast<const uint8_t *>(data) + sizeof(Header);
+    std::vector<uint32_t> chunkSizes(header.mChunkTotal);
+    std::memcpy(chunkSizes.data(), ptr, header.mChunkTotal * sizeof(uint32_t));
+    ptr += header.mChunkTotal * sizeof(uint32_t);
+
+    std::vector<size_t> chunkOffsets(header.mChunkTotal);
+    size_t offset = ptr - static_cast<const uint8_t *>(data);
+    for (uint32_t chunkId = 0; chunkId < header.mChunkTotal; ++chunkId) {
+        chunkOffsets[chunkId] = offset;
+        offset += chunkSizes[chunkId];
+    }
+    if (offset > dataSize) return false;
+
+    dst.resize(header.mRawSize);
+    std::atomic<bool> error(false);
+    tbb::parallel_for(0u, header.mChunkTotal, [&](uint32_t chunkId) {
+        const size_t rawOffset = static_cast<size_t>(chunkId) * header.mChunkSize;
+        const uLongf rawLen = static_cast<uLongf>(std::min(static_cast<uint64_t>(header.mChunkSize),
+                                                           header.mRawSize - rawOffset));
+        uLongf len = rawLen;
+        if (uncompress(reinterpret_cast<Bytef *>(&dst[rawOffset]), &len,
+                       static_cast<const Bytef *>(data) + chunkOffsets[chunkId], chunkSizes[chunkId]) != Z_OK ||
+            len != rawLen) {
+            error = true;
+        }
+    });
+    return !error;
+}
+
+//------------------------------------------------------------------------------------------
+
+bool
+FbCompressStat::shouldCompress(const size_t rawSize, const float linkBandwidthMbps)
+{
+    if (rawSize < sMinRawSize) return false;
+
+    bool compress = true;
+    if (mMeasured && mSkipTotal < sRetestInterval && linkBandwidthMbps > 0.0f) {
+        // Compression pays off if encoding plus sending the compressed data is faster than sending
+        // the raw data : rawSize / speed + rawSize * ratio / bandwidth < rawSize / bandwidth
+        const float bandwidthBytesPerSec = linkBandwidthMbps * (1000.0f * 1000.0f / 8.0f);
+        compress = (mBytesPerSec > 0.0f &&
+                    1.0f / mBytesPerSec < (1.0f - mRatio) / bandwidthBytesPerSec);
+    }
+
+    if (compress) {
+        mSkipTotal = 0;
+        ++mCompressedTotal;
+    } else {
+        ++mSkipTotal;
+        ++mRawTotal;
+    }
+    return compress;
+}
+
+void
+FbCompressStat::update(const size_t rawSize, const size_t compressedSize, const float sec)
+{
+    if (rawSize == 0) return;
+
+    const float ratio = static_cast<float>(compressedSize) / static_cast<float>(rawSize);
+    const float bytesPerSec = (sec > 0.0f) ? static_cast<float>(rawSize) / sec : 0.0f;
+    if (!mMeasured) {
+        mRatio = ratio;
+        mBytesPerSec = bytesPerSec;
+        mMeasured = true;
+    } else {
+        // moving average, the content changes gradually over the progressive frames
+        constexpr float blend = 0.25f;
+        mRatio += (ratio - mRatio) * blend;
+        mBytesPerSec += (bytesPerSec - mBytesPerSec) * blend;
+    }
+}
+
+std::string
+FbCompressStat::show() const
+{
+    std::ostringstream ostr;
+    ostr << "ratio:" << mRatio
+         << " speed:" << mBytesPerSec / (1024.0f * 1024.0f) << "MB/s"
+         << " compressed:" << mCompressedTotal
+         << " raw:" << mRawTotal;
+    return ostr.str();
+}
+
+} // namespace engine_tool
+} // namespace moonray
@@ -0,0 +1,64 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+//
+// -- Lossless compression of ProgressiveFrame buffer data --
+//
+// PackTiles already sends the active tiles only with reduced precision. This adds a generic
+// lossless compression on top of the PackTiles data for bandwidth bound links (i.e. multi-machine
+// sessions). The data is split into fixed size chunks which are deflated in parallel, so the
+// encoding cost scales with the number of cores.
+//
+// FbCompressStat decides per buffer whether compression pays off, based on the measured compression
+// ratio and throughput of the previous frames and on the link bandwidth. Buffers which don't pay off
+// are sent as is and tested again once in a while, since the content changes over the frames.
+//
+// Compressed data starts with a magic number, so a receiver can tell it apart from the plain
+// PackTiles data by isCompressed() and should decode() it before PackTiles decoding.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace moonray {
+namespace engine_tool {
+
+class FbCompress
+{
+public:
+    // Compresses src[0, srcSize) into dst. Returns the compressed size or 0 on error.
+    static size_t encode(const void *src, const size_t srcSize, std::string &dst);
+
+    static bool isCompressed(const void *data, const size_t dataSize);
+
+    // Returns false if data is broken.
+    static bool decode(const void *data, const size_t dataSize, std::string &dst);
+};
+
+class FbCompressStat
+{
+public:
+    // linkBandwidthMbps : bandwidth of the link to the receiver in megabits/sec
+    bool shouldCompress(const size_t rawSize, const float linkBandwidthMbps);
+
+    void update(const size_t rawSize, const size_t compressedSize, const float sec);
+
+    std::string show() const;
+
+private:
+    static constexpr size_t sMinRawSize = 4096; // small data is not worth the cost
+    static constexpr unsigned sRetestInterval = 32; // retest skipped buffers every N frames
+
+    bool mMeasured {false};
+    float mRatio {1.0f};           // compressed size / raw size
+    float mBytesPerSec {0.0f};     // encode throughput
+    unsigned mSkipTotal {0};       // sends without compression since the last test
+    uint64_t mCompressedTotal {0}; // number of compressed sends
+    uint64_t mRawTotal {0};        // number of sends without compression
+};
+
+} // namespace engine_tool
+} // namespace moonray
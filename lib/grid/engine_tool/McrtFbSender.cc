@@ -11,9 +11,11 @@
 #include <scene_rdl2/common/fb_util/SparseTiledPixelBuffer.h>
 #include <scene_rdl2/common/grid_util/PackTiles.h>
 #include <scene_rdl2/common/grid_util/ProgressiveFrameBufferName.h>
+#include <scene_rdl2/common/rec_time/RecTime.h>
 #include <scene_rdl2/render/util/StrUtil.h>
 #include <scene_rdl2/scene/rdl2/RenderOutput.h>
 
+#include <algorithm>
 #include <fstream>
 
 namespace moonray {
@@ -37,12 +39,15 @@ McrtFbSender::init(const unsigned w, const unsigned h)
 
     mMin = 0;
     mMax = 0;
+
+    resetDirtyEpochs();
 }
 
 void
 McrtFbSender::initPixelInfo(const bool sw)
 {
     mPixelInfoStatus = sw;
+    mPixelInfoDirtyEpoch = 0;
 
     if (!sw) {
         //
@@ -102,6 +107,8 @@ McrtFbSender::initRenderOutput(const rndr::RenderOutputDriver *rod)
         mRenderOutputBufferFinePassPrecision.shrink_to_fit();
         mRenderOutputBufferCoarsePassPrecision.clear();
         mRenderOutputBufferCoarsePassPrecision.shrink_to_fit();
+        mRenderOutputDirtyEpoch.clear();
+        mRenderOutputDirtyEpoch.shrink_to_fit();
 
         initHeatMap(-1);               // no heatMap buffer
         initWeightBuffer(nullptr, -1); // no weight buffer
@@ -121,6 +128,7 @@ McrtFbSender::initRenderOutput(const rndr::RenderOutputDriver *rod)
     mRenderOutputBufferClosestFilterStatus.resize(total);
     mRenderOutputBufferCoarsePassPrecision.resize(total);
     mRenderOutputBufferFinePassPrecision.resize(total);
+    mRenderOutputDirtyEpoch.assign(total, 0);
 
     const pbr::AovSchema &schema = rod->getAovSchema();
 
@@ -190,6 +198,19 @@ McrtFbSender::fbReset()
             mRenderOutputWeightBufferTiled[rodId].clear();
         }
     }
+
+    resetDirtyEpochs(); // cleared buffers need every tile again
+}
+
+void
+McrtFbSender::resetDirtyEpochs()
+{
+    mRenderBufferDirtyEpoch = 0;
+    mPixelInfoDirtyEpoch = 0;
+    mHeatMapDirtyEpoch = 0;
+    mWeightBufferDirtyEpoch = 0;
+    mRenderBufferOddDirtyEpoch = 0;
+    std::fill(mRenderOutputDirtyEpoch.begin(), mRenderOutputDirtyEpoch.end(), 0);
 }
 
 //------------------------------------------------------------------------------
@@ -210,7 +231,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
     // Beauty
     //
     timeLogStart(snapshotId); // for performance analyze
-    renderContext.snapshotDelta(&mRenderBufferTiled, &mRenderBufferWeightBufferTiled, mActivePixels, doParallel);
+    renderContext.snapshotDelta(&mRenderBufferTiled, &mRenderBufferWeightBufferTiled, mActivePixels, doParallel,
+                                &mRenderBufferDirtyEpoch);
     mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_BEAUTY); // for performance analyze : finish snapshot
 
     if (mActivePixelsArray) {
@@ -226,7 +248,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
         renderContext.snapshotDeltaPixelInfo(&mPixelInfoBufferTiled,
                                              &mPixelInfoWeightBufferTiled,
                                              mActivePixelsPixelInfo,
-                                             doParallel);
+                                             doParallel,
+                                             &mPixelInfoDirtyEpoch);
         mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_PIXELINFO); // for performance analyze
     }
 
@@ -240,7 +263,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
                                                &mHeatMapWeightBufferTiled,
                                                mActivePixelsHeatMap,
                                                &mHeatMapSecBufferTiled,
-                                               doParallel);
+                                               doParallel,
+                                               &mHeatMapDirtyEpoch);
             mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_HEATMAP); // for performance analyze
             mHeatMapSkipCondition = false;
         } else {
@@ -254,7 +278,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
     if (mWeightBufferStatus) {
         if (checkOutputIntervalFunc(mRenderOutputName[mWeightBufferId])) {
             mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_START_WEIGHTBUFFER); // for performance analyze
-            renderContext.snapshotDeltaWeightBuffer(&mWeightBufferTiled, mActivePixelsWeightBuffer, doParallel);
+            renderContext.snapshotDeltaWeightBuffer(&mWeightBufferTiled, mActivePixelsWeightBuffer, doParallel,
+                                                    &mWeightBufferDirtyEpoch);
             mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_WEIGHTBUFFER); // for performance analyze
             mWeightBufferSkipCondition = false;
         } else {
@@ -272,7 +297,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
             renderContext.snapshotDeltaRenderBufferOdd(&mRenderBufferOddTiled,
                                                        &mRenderBufferOddWeightBufferTiled,
                                                        mActivePixelsRenderBufferOdd,
-                                                       doParallel);
+                                                       doParallel,
+                                                       &mRenderBufferOddDirtyEpoch);
             mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_BEAUTYODD); // for performance analyze
             mRenderBufferOddSkipCondition = false;            
         } else {
@@ -306,7 +332,8 @@ McrtFbSender::snapshotDelta(const rndr::RenderContext &renderContext,
                                                 mActivePixelsRenderOutput[id],
                                                 doParallel,
                                                 denoiserAlbedoInput,
-                                                denoiserNormalInput);
+                                                denoiserNormalInput,
+                                                &mRenderOutputDirtyEpoch[id]);
         if (denoiserAlbedoInput) mDenoiserAlbedoInputNamePtr = &bufferName;
         if (denoiserNormalInput) mDenoiserNormalInputNamePtr = &bufferName;
         mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::SNAPSHOT_END_RENDEROUTPUT);
@@ -416,6 +443,7 @@ McrtFbSender::addBeautyToProgressiveFrame(const bool directToClient,
                                                      directToClient,
                                                      sha1HashSw);
     }
+    dataSize = compressWork(scene_rdl2::grid_util::ProgressiveFrameBufferName::Beauty, dataSize, directToClient);
     mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::ENCODE_END_BEAUTY);
 
     /* runtime verify
@@ -513,14 +541,15 @@ McrtFbSender::addHeatMapToProgressiveFrame(const bool directToClient, MessageAdd
                                                        directToClient,
                                                        sha1HashSw);
     }
+    const char *buffName = 0x0;
+    if (mHeatMapId >= 0) {
+        buffName = mRenderOutputName[mHeatMapId].c_str();
+    } else {
+        buffName = scene_rdl2::grid_util::ProgressiveFrameBufferName::HeatMapDefault;
+    }
+    dataSize = compressWork(buffName, dataSize, directToClient);
     mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::ENCODE_END_HEATMAP);
     {
-        const char *buffName = 0x0;
-        if (mHeatMapId >= 0) {
-            buffName = mRenderOutputName[mHeatMapId].c_str();
-        } else {
-            buffName = scene_rdl2::grid_util::ProgressiveFrameBufferName::HeatMapDefault;
-        }
         func(makeSharedPtr(duplicateWorkData()), dataSize, buffName, ImgEncodingType::ENCODING_UNKNOWN);
     }
     mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::ADDBUFFER_END_HEATMAP);
@@ -592,6 +621,8 @@ McrtFbSender::addRenderBufferOddToProgressiveFrame(const bool directToClient,
                                                      directToClient,
                                                      sha1HashSw);
     }
+    dataSize = compressWork(scene_rdl2::grid_util::ProgressiveFrameBufferName::RenderBufferOdd, dataSize,
+                            directToClient);
     mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::ENCODE_END_BEAUTYODD);
     {
         func(makeSharedPtr(duplicateWorkData()),
@@ -690,6 +721,7 @@ McrtFbSender::addRenderOutputToProgressiveFrame(const bool directToClient,
                      mRenderOutputBufferFinePassPrecision[id],
                      sha1HashSw);
             }
+            dataSize = compressWork(mRenderOutputName[id], dataSize, directToClient);
             mLatencyLog.enq(scene_rdl2::grid_util::LatencyItem::Key::ENCODE_END_RENDEROUTPUT);
             {
                 func(makeSharedPtr(duplicateWorkData()), dataSize, mRenderOutputName[id].c_str(),
@@ -701,6 +733,31 @@ McrtFbSender::addRenderOutputToProgressiveFrame(const bool directToClient,
     }
 }
 
+size_t
+McrtFbSender::compressWork(const std::string &buffName, const size_t dataSize, const bool directToClient)
+//
+// Replaces mWork by the compressed data when it pays off and returns the new data size.
+// Only the data to the merger is compressed, the frontend client decodes the PackTiles data directly.
+//
+{
+    if (!mCompressEnable || directToClient) return dataSize;
+
+    FbCompressStat &stat = mCompressStat[buffName];
+    if (!stat.shouldCompress(dataSize, mLinkBandwidthMbps)) return dataSize;
+
+    scene_rdl2::rec_time::RecTime recTime;
+    recTime.start();
+    const size_t compressedSize = FbCompress::encode(mWork.data(), dataSize, mCompressWork);
+    const float sec = recTime.end();
+    if (compressedSize == 0) return dataSize; // error : send as is
+
+    stat.update(dataSize, compressedSize, sec);
+    if (compressedSize >= dataSize) return dataSize;
+
+    mWork.swap(mCompressWork);
+    return compressedSize;
+}
+
 void
 McrtFbSender::addAuxInfoToProgressiveFrame(const std::vector<std::string> &infoDataArray,
                                            MessageAddBuffFunc func)
@@ -1468,6 +1525,22 @@ McrtFbSender::parserConfigure()
                     unsigned sy = (arg++).as<unsigned>(0);
                     return arg.msg(showRenderBufferPix(sx, sy) + '\n');
                 });
+    mParser.opt("compress", "<on|off|show>", "progressive frame compression for merger",
+                [&](Arg& arg) -> bool {
+                    if (arg() == "show") arg++;
+                    else mCompressEnable = (arg++).as<bool>(0);
+                    return arg.msg(std::string("compress:") +
+                                   scene_rdl2::str_util::boolStr(mCompressEnable) + '\n');
+                });
+    mParser.opt("bandwidth", "<Mbps>", "set link bandwidth for the compression decision",
+                [&](Arg& arg) -> bool {
+                    mLinkBandwidthMbps = (arg++).as<float>(0);
+                    return arg.fmtMsg("bandwidth:%f Mbps\n", mLinkBandwidthMbps);
+                });
+    mParser.opt("compressStat", "", "show compression statistics of each buffer",
+                [&](Arg& arg) -> bool {
+                    return arg.msg(showCompressStat() + '\n');
+                });
 }
 
 std::string
@@ -1489,6 +1562,19 @@ McrtFbSender::showDenoiseInfo() const
     return ostr.str();
 }
 
+std::string
+McrtFbSender::showCompressStat() const
+{
+    std::ostringstream ostr;
+    ostr << "compressStat (compress:" << scene_rdl2::str_util::boolStr(mCompressEnable)
+         << " bandwidth:" << mLinkBandwidthMbps << "Mbps) {\n";
+    for (const auto &itr : mCompressStat) {
+        ostr << "  " << itr.first << " " << itr.second.show() << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
 std::string
 McrtFbSender::showRenderBufferPix(const unsigned sx, const unsigned sy) const
 {
@@ -16,6 +16,7 @@
 // multiple MCRT (send to merger).
 //
 
+#include "FbCompress.h"
 #include "ImgEncodingType.h"
 
 #include <moonray/rendering/rndr/RenderOutputDriver.h>
@@ -31,6 +32,8 @@
 #include <scene_rdl2/common/math/Viewport.h>
 #include <scene_rdl2/common/platform/Platform.h> // finline
 
+#include <unordered_map>
+
 namespace moonray {
     namespace rndr { class RenderContext; }
 }
@@ -89,21 +92,26 @@ public:
         mBeautyHDRITest(HdriTestCondition::INIT),
         mRenderBufferCoarsePassPrecision(COARSE_PASS_PRECISION_BEAUTY),
         mRenderBufferFinePassPrecision(FinePassPrecision::F32),
+        mRenderBufferDirtyEpoch(0),
         mPixelInfoStatus(false),
         mPixelInfoCoarsePassPrecision(COARSE_PASS_PRECISION_PIXEL_INFO),
         mPixelInfoFinePassPrecision(FinePassPrecision::F32),
+        mPixelInfoDirtyEpoch(0),
         mHeatMapStatus(false),
         mHeatMapSkipCondition(false),
         mHeatMapId(-1),
+        mHeatMapDirtyEpoch(0),
         mWeightBufferStatus(false),
         mWeightBufferSkipCondition(false),
         mWeightBufferId(-1),
         mWeightBufferCoarsePassPrecision(COARSE_PASS_PRECISION_WEIGHT),
         mWeightBufferFinePassPrecision(FinePassPrecision::F32),
+        mWeightBufferDirtyEpoch(0),
         mRenderBufferOddStatus(false),
         mRenderBufferOddSkipCondition(false),
         mBeautyAuxId(-1),
         mAlphaAuxId(-1),
+        mRenderBufferOddDirtyEpoch(0),
         mDenoiserAlbedoInputNamePtr(nullptr),
         mDenoiserNormalInputNamePtr(nullptr),
         mMin(0),
@@ -137,6 +145,13 @@ public:
 
     void setMachineId(const int machineId) { mLatencyLog.setMachineId(machineId); }
 
+    // Lossless compression on top of PackTiles for the data sent to the merger (multiple MCRT).
+    // Each buffer is only compressed when it pays off for the given link bandwidth (megabits/sec).
+    // The merger has to decode it by FbCompress::decode() before PackTiles decoding.
+    void setCompression(const bool sw) { mCompressEnable = sw; }
+    bool getCompression() const { return mCompressEnable; }
+    void setLinkBandwidthMbps(const float mbps) { mLinkBandwidthMbps = mbps; }
+
     void fbReset();
 
     //------------------------------
@@ -242,6 +257,7 @@ protected:
     FloatBuffer  mRenderBufferWeightBufferTiled; // pixel weight data : tile size aligned resolution
     CoarsePassPrecision mRenderBufferCoarsePassPrecision; // minimum packTile precision
     FinePassPrecision mRenderBufferFinePassPrecision;     // minimum packTile precision
+    uint32_t mRenderBufferDirtyEpoch;            // film dirty tile epoch of the last snapshot
 
     // PixelInfo buffer
     bool mPixelInfoStatus;
@@ -250,6 +266,7 @@ protected:
     FloatBuffer mPixelInfoWeightBufferTiled; // pixel weight data for pixelInfo : tile aligned
     CoarsePassPrecision mPixelInfoCoarsePassPrecision; // minimum packTile precision
     FinePassPrecision mPixelInfoFinePassPrecision;     // minimum packTile precision
+    uint32_t mPixelInfoDirtyEpoch;                     // film dirty tile epoch of the last snapshot
 
     // HeatMap buffer
     bool mHeatMapStatus;
@@ -259,6 +276,7 @@ protected:
     HeatMapBuffer mHeatMapBufferTiled;     // heatMap data : tile size aligned resolution (uint64_t)
     FloatBuffer mHeatMapWeightBufferTiled; // pixel weight data for heatMap : tile aligned resolution
     FloatBuffer mHeatMapSecBufferTiled;    // convert sec only activePixels (work buffer)
+    uint32_t mHeatMapDirtyEpoch;           // film dirty tile epoch of the last snapshot
 
     // Weight buffer
     bool mWeightBufferStatus;
@@ -268,6 +286,7 @@ protected:
     FloatBuffer mWeightBufferTiled;         // pixel weight data : tile size aligned resolution
     CoarsePassPrecision mWeightBufferCoarsePassPrecision; // minimum packTile precision
     FinePassPrecision mWeightBufferFinePassPrecision;     // minimum packTile precision
+    uint32_t mWeightBufferDirtyEpoch;                     // film dirty tile epoch of the last snapshot
 
     // RenderBufferOdd (beautyAux/alphaAux)
     bool mRenderBufferOddStatus;
@@ -277,6 +296,7 @@ protected:
     ActivePixels mActivePixelsRenderBufferOdd;     // active pixel mask information for renderBufferOdd
     RenderBuffer mRenderBufferOddTiled;            // renderBufferOdd data : tile aligned resolution
     FloatBuffer mRenderBufferOddWeightBufferTiled; // pixel weight data : tile size aligned resolution
+    uint32_t mRenderBufferOddDirtyEpoch;           // film dirty tile epoch of the last snapshot
 
     // RenderOutput buffer
     std::vector<std::string> mRenderOutputName;                      // AOV buffer name
@@ -306,6 +326,7 @@ protected:
     std::vector<float> mRenderOutputBufferDefaultValue;        // renderOutput buff default value
     std::vector<FloatBuffer> mRenderOutputWeightBufferTiled;   // pixWeight for renderOutput tile aligned
     std::vector<char> mRenderOutputBufferScaledByWeight;       // requires scaled by weight condition.
+    std::vector<uint32_t> mRenderOutputDirtyEpoch;             // film dirty tile epoch of the last snapshot
 
     std::vector<int> mRenderOutputBufferOrigNumChan; // original renderOutputBuffer numChan
                                                      // regardless of using closestFilter or not.
@@ -324,6 +345,11 @@ protected:
     size_t mMin, mMax; // for performance analyze. packet size min/max info
     std::string mWork; // work memory for encoding
 
+    bool mCompressEnable {false};
+    float mLinkBandwidthMbps {10000.0f};
+    std::string mCompressWork; // work memory for compression
+    std::unordered_map<std::string, FbCompressStat> mCompressStat; // per buffer name
+
     //------------------------------
 
     scene_rdl2::grid_util::LatencyLog mLatencyLog; // latency log information for performance analyze
@@ -343,6 +369,7 @@ protected:
     void initWeightBuffer(const rndr::RenderOutputDriver *rod,
                           const int weightBufferId); // this function should be called after init()
     void initRenderBufferOdd(const int beautyAuxId, const int alphaAuxId); // should call after init()
+    void resetDirtyEpochs(); // next snapshots compare all the tiles
     void initRenderOutputVisibilityAOV(const rndr::RenderOutputDriver *rod, const unsigned int roIdx);
     void initRenderOutputRegularAOV(const rndr::RenderOutputDriver *rod, const unsigned int roIdx,
                                     int &beautyId, int &alphaId,
@@ -394,6 +421,7 @@ protected:
     }
 
     finline uint8_t *duplicateWorkData();
+    size_t compressWork(const std::string &buffName, const size_t dataSize, const bool directToClient);
 
     void timeLogStart(const uint32_t snapshotId)
     {
@@ -416,6 +444,7 @@ protected:
 
     void parserConfigure();
     std::string showDenoiseInfo() const;
+    std::string showCompressStat() const;
     std::string showRenderBufferPix(const unsigned sx, const unsigned sy) const;
 
     RenderColor getRenderBufferPix(const int x, const int y) const;
@@ -15,6 +15,52 @@ using scene_rdl2::math::Vec3f;
 namespace moonray {
 namespace shading {
 
+namespace {
+
+// Every intersection reads 3 or 4 rows of the varying, face varying and vertex
+// rates. Rows which fit within the buffer alignment are padded to a power of
+// two size, so that none of them straddles two cache lines, as long as that
+// wastes no more than a quarter of the padded row.
+size_t
+packedRowStride(size_t stride)
+{
+    if (stride == 0 || stride > SIMD_MEMORY_ALIGNMENT) {
+        return stride;
+    }
+    size_t padded = sizeof(float);
+    while (padded < stride) {
+        padded <<= 1;
+    }
+    return 4 * stride >= 3 * padded ? padded : stride;
+}
+
+} // anonymous namespace
+
+void
+Attributes::initFloatRates()
+{
+    for (int rate = 0; rate < RATE_LAST; ++rate) {
+        mFloatRate[rate] = true;
+    }
+    for (size_t k = 0; k < mNumKeys; ++k) {
+        if (mKeyRate[k] == RATE_UNKNOWN) {
+            continue;
+        }
+        switch (AttributeKey(k).getType()) {
+        case rdl2::TYPE_FLOAT:
+        case rdl2::TYPE_RGB:
+        case rdl2::TYPE_RGBA:
+        case rdl2::TYPE_VEC2F:
+        case rdl2::TYPE_VEC3F:
+        case rdl2::TYPE_MAT4F:
+            break;
+        default:
+            mFloatRate[mKeyRate[k]] = false;
+            break;
+        }
+    }
+}
+
 size_t
 Attributes::getMemory() const
 {
@@ -108,6 +154,9 @@ Attributes::interleave(const PrimitiveAttributeTable& primitiveAttributeTable,
     // vertex rate alignment is a bit weird since the OSD primitive attribute
     // tessellator require data to be Vec2f aligned
     dataSize[RATE_VERTEX] = scene_rdl2::util::alignUp(dataSize[RATE_VERTEX], sizeof(Vec2f));
+    dataSize[RATE_VARYING] = packedRowStride(dataSize[RATE_VARYING]);
+    dataSize[RATE_FACE_VARYING] = packedRowStride(dataSize[RATE_FACE_VARYING]);
+    dataSize[RATE_VERTEX] = packedRowStride(dataSize[RATE_VERTEX]);
 
     size_t attrNumParts = numParts;
     size_t attrNumVaryings = numVaryings;
@@ -142,6 +142,11 @@ namespace shading {
  * called mBeginFaceVarying that indicates at which block of attributes the first 
  * vertex/span for a given face(curve) begins.
  * 
+ * An intersection reads several mVaryings, mFaceVaryings and mVertices blocks
+ * at once, so blocks smaller than the buffer alignment may be padded to a
+ * power of two size (see interleave()). That way none of them straddles two
+ * cache lines.
+ * 
  */
 
 class Attributes 
@@ -192,6 +197,7 @@ class Attributes
             mFaceVaryings(std::move(faceVaryings)),
             mVertices(std::move(vertices))
     {
+        initFloatRates();
     }
 
     std::unique_ptr<Attributes> copy() const
@@ -368,7 +374,36 @@ class Attributes
         return reinterpret_cast<float*>(mVertices.data());
     }
 
+    // Whether every key of the varying, face varying or vertex rate is made of
+    // floats (float, color, vector and matrix types), so that a whole row of
+    // that rate, with all its keys and time samples, can be blended as a
+    // plain float array. Rows are getRowStride(rate) bytes apart, which is
+    // always a multiple of sizeof(float).
+    finline bool isFloatRate(AttributeRate rate) const {
+        return mFloatRate[rate];
+    }
+
+    finline size_t getRowStride(AttributeRate rate) const {
+        MNRY_ASSERT(rate == RATE_VARYING || rate == RATE_FACE_VARYING ||
+            rate == RATE_VERTEX);
+        return rate == RATE_VARYING ? mVaryingStride :
+            (rate == RATE_FACE_VARYING ? mFaceVaryingStride : mVertexStride);
+    }
+
+    // face is only used by the face varying rate
+    finline const float* getRow(AttributeRate rate, size_t face,
+            size_t index) const {
+        MNRY_ASSERT(isFloatRate(rate));
+        const char* row = rate == RATE_VARYING ?
+            &mVaryings[index * mVaryingStride] :
+            (rate == RATE_FACE_VARYING ?
+            &mFaceVaryings[(mBeginFaceVarying[face] + index) * mFaceVaryingStride] :
+            &mVertices[index * mVertexStride]);
+        return reinterpret_cast<const float*>(row);
+    }
+
 private:
+    void initFloatRates();
 
     template <typename T>
     finline T& getConstantInternal(TypedAttributeKey<T> key,
@@ -439,6 +474,8 @@ private:
     Vector<char> mVaryings;
     Vector<char> mFaceVaryings;
     Vector<char> mVertices;
+
+    bool mFloatRate[RATE_LAST];
 };
 
 
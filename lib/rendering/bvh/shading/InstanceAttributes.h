@@ -12,15 +12,34 @@
 #include <moonray/rendering/bvh/shading/PrimitiveAttribute.h>
 #include <moonray/rendering/bvh/shading/Xform.h>
 
+#include <memory>
+
 namespace moonray {
 namespace shading {
 
 class InstanceAttributes
 {
 public:
+    // key -> offset of the attribute in the constant data, -1 for keys
+    // the instance doesn't have
+    using KeyOffsetTable = std::vector<int>;
+
     finline InstanceAttributes(
             PrimitiveAttributeTable&& primitiveAttributeTable);
 
+    // Instances of an instancer usually all carry the same attribute keys,
+    // so they can share one key offset table built by buildKeyOffsetTable().
+    // The constant data starts zeroed, the values are written with
+    // setAttribute(). This avoids building a PrimitiveAttributeTable and a
+    // key offset table per instance.
+    finline InstanceAttributes(
+            std::shared_ptr<const KeyOffsetTable> keyOffset,
+            size_t constantsSize);
+
+    // constantsSize receives the size of the constant data of the keys
+    static finline std::shared_ptr<const KeyOffsetTable> buildKeyOffsetTable(
+            const std::vector<AttributeKey>& keys, size_t& constantsSize);
+
     template <typename T>
     finline void getAttribute(TypedAttributeKey<T> key, char* data) const;
 
@@ -30,11 +49,16 @@ public:
     template <typename T>
     finline const T &getAttribute(TypedAttributeKey<T> key) const;
 
+    template <typename T>
+    finline void setAttribute(TypedAttributeKey<T> key, const T& value);
+
     finline bool isSupported(AttributeKey key) const;
 
     size_t getMemory() const {
+        // a shared key offset table is split among its users
         return sizeof(InstanceAttributes) +
-            scene_rdl2::util::getVectorElementsMemory(mKeyOffset) +
+            scene_rdl2::util::getVectorElementsMemory(*mKeyOffset) /
+            mKeyOffset.use_count() +
             scene_rdl2::util::getVectorElementsMemory(mConstants);
     }
 
@@ -47,50 +71,70 @@ private:
     finline int keyOffset(int key) const;
 
 private:
-    std::vector<int> mKeyOffset;
+    std::shared_ptr<const KeyOffsetTable> mKeyOffset;
     Vector<char> mConstants;
 };
 
-InstanceAttributes::InstanceAttributes(
-        PrimitiveAttributeTable&& primitiveAttributeTable)
+std::shared_ptr<const InstanceAttributes::KeyOffsetTable>
+InstanceAttributes::buildKeyOffsetTable(const std::vector<AttributeKey>& keys,
+        size_t& constantsSize)
 {
     // make sure data in allocated buffer aligned
     // we sort the key by attribute size, and build key->offset table
     // with size descending order (to avoid wasted padding space)
     int maxKey = -1;
     std::map<size_t, std::vector<AttributeKey>> attrSizeMap;
+    for (AttributeKey key : keys) {
+        maxKey = scene_rdl2::math::max(maxKey, (int)key);
+        attrSizeMap[key.getSize()].push_back(key);
+    }
+    auto keyOffset = std::make_shared<KeyOffsetTable>(maxKey + 1, -1);
+    constantsSize = 0;
+    for (auto rit = attrSizeMap.rbegin(); rit != attrSizeMap.rend(); ++rit) {
+        size_t attrSize = rit->first;
+        for (auto k: rit->second) {
+            (*keyOffset)[k] = constantsSize;
+            constantsSize += attrSize;
+        }
+    }
+    return keyOffset;
+}
+
+InstanceAttributes::InstanceAttributes(
+        PrimitiveAttributeTable&& primitiveAttributeTable)
+{
+    std::vector<AttributeKey> keys;
     for (const auto& kv : primitiveAttributeTable) {
         AttributeKey key = kv.first;
         if (primitiveAttributeTable.getRate(key) == RATE_CONSTANT &&
             primitiveAttributeTable.getTimeSampleCount(key) == 1) {
-            maxKey = scene_rdl2::math::max(maxKey, (int)key);
-            attrSizeMap[key.getSize()].push_back(key);
+            keys.push_back(key);
         } else {
             MNRY_ASSERT(false, "InstanceAttributes only support "
                 "constant rate static primitive attributes now");
         }
     }
-    mKeyOffset.resize(maxKey + 1, -1);
-    size_t totalSize = 0;
-    for (auto rit = attrSizeMap.rbegin(); rit != attrSizeMap.rend(); ++rit) {
-        size_t attrSize = rit->first;
-        for (auto k: rit->second) {
-            mKeyOffset[k] = totalSize;
-            totalSize += attrSize;
-        }
-    }
+    size_t totalSize;
+    mKeyOffset = buildKeyOffsetTable(keys, totalSize);
     mConstants.resize(totalSize);
     // Fill in data
     for (const auto& kv : primitiveAttributeTable) {
         AttributeKey key = kv.first;
-        int offset = mKeyOffset[key];
-        if (mKeyOffset[key] != -1) {
+        if (isSupported(key)) {
             const auto& primitiveAttribute = kv.second[0];
-            primitiveAttribute->fetchData(0, &mConstants[offset]);
+            primitiveAttribute->fetchData(0, &mConstants[keyOffset(key)]);
         }
     }
 }
 
+InstanceAttributes::InstanceAttributes(
+        std::shared_ptr<const KeyOffsetTable> keyOffset,
+        size_t constantsSize) :
+    mKeyOffset(std::move(keyOffset)),
+    mConstants(constantsSize, 0)
+{
+}
+
 template <typename T>
 void
 InstanceAttributes::getAttribute(TypedAttributeKey<T> key, char* data) const
@@ -153,17 +197,37 @@ InstanceAttributes::getAttribute(TypedAttributeKey<std::string> key) const
     return *(*(reinterpret_cast<std::string **>(constData)));
 }
 
+template <typename T>
+void
+InstanceAttributes::setAttribute(TypedAttributeKey<T> key, const T& value)
+{
+    MNRY_ASSERT(isSupported(key));
+    *(reinterpret_cast<T *>(&mConstants[keyOffset(key)])) = value;
+}
+
+template <>
+inline void
+InstanceAttributes::setAttribute(TypedAttributeKey<std::string> key,
+        const std::string& value)
+{
+    // strings live in the string pool, like the ones fetched from a
+    // PrimitiveAttributeTable
+    MNRY_ASSERT(isSupported(key));
+    *(reinterpret_cast<const std::string **>(&mConstants[keyOffset(key)])) =
+        util::getStringPool().get(value);
+}
+
 bool
 InstanceAttributes::isSupported(AttributeKey key) const
 {
-    return 0 <= key && key < static_cast<int>(mKeyOffset.size()) &&
-        mKeyOffset[key] != -1;
+    return 0 <= key && key < static_cast<int>(mKeyOffset->size()) &&
+        (*mKeyOffset)[key] != -1;
 }
 
 int
 InstanceAttributes::keyOffset(int key) const
 {
-    return mKeyOffset[key];
+    return (*mKeyOffset)[key];
 }
 
 } // namespace shading
@@ -6,8 +6,59 @@
 namespace moonray {
 namespace shading {
 
+constexpr size_t Interpolator::sMaxRowFloats;
 constexpr std::array<int, 4> QuadricInterpolator::mIndices;
 
+void
+Interpolator::prepareRows(const std::vector<AttributeKey>& requiredKeys,
+                          const std::vector<AttributeKey>& optionalKeys)
+{
+    int keyCount[3] = {0, 0, 0};
+    for (const std::vector<AttributeKey>* keys : {&requiredKeys, &optionalKeys}) {
+        for (AttributeKey key : *keys) {
+            if (!mAttr->isSupported(key)) {
+                continue;
+            }
+            const AttributeRate rate = mAttr->getRate(key);
+            if (rate == RATE_VARYING || rate == RATE_FACE_VARYING ||
+                rate == RATE_VERTEX) {
+                ++keyCount[rate - RATE_VARYING];
+            }
+        }
+    }
+
+    // a single key gains nothing over its own weighted sum
+    mRowReady[0] = keyCount[0] > 1 && interpolateRow(RATE_VARYING,
+        mNumVaryings, mVaryings, mVaryingWeights, mRows[0]);
+    mRowReady[1] = keyCount[1] > 1 && interpolateRow(RATE_FACE_VARYING,
+        mNumFaceVaryings, mFaceVaryings, mFaceVaryingWeights, mRows[1]);
+    mRowReady[2] = keyCount[2] > 1 && interpolateRow(RATE_VERTEX,
+        mNumVertices, mVertices, mVertexWeights, mRows[2]);
+}
+
+bool
+Interpolator::interpolateRow(AttributeRate rate, int count,
+        const int* indices, const float* weights, float* row) const
+{
+    const size_t stride = mAttr->getRowStride(rate);
+    if (!mAttr->isFloatRate(rate) || stride > sMaxRowFloats * sizeof(float)) {
+        return false;
+    }
+
+    const size_t numFloats = stride / sizeof(float);
+    for (size_t j = 0; j < numFloats; ++j) {
+        row[j] = 0.0f;
+    }
+    for (int i = 0; i < count; ++i) {
+        const float* src = mAttr->getRow(rate, mCoarseFace, indices[i]);
+        const float w = weights[i];
+        for (size_t j = 0; j < numFloats; ++j) {
+            row[j] += w * src[j];
+        }
+    }
+    return true;
+}
+
 } // namespace shading
 } // namespace moonray
 
@@ -13,6 +13,7 @@
 #include <moonray/rendering/bvh/shading/PrimitiveAttribute.h>
 
 #include <array>
+#include <vector>
 
 namespace moonray {
 namespace shading {
@@ -41,13 +42,25 @@ public:
             interpolateUniform(key, data);
             break;
         case RATE_VARYING:
-            interpolateVaryings(key, data);
+            if (mRowReady[RATE_VARYING - RATE_VARYING]) {
+                interpolateFromRow(key, mRows[RATE_VARYING - RATE_VARYING], data);
+            } else {
+                interpolateVaryings(key, data);
+            }
             break;
         case RATE_FACE_VARYING:
-            interpolateFaceVaryings(key, data);
+            if (mRowReady[RATE_FACE_VARYING - RATE_VARYING]) {
+                interpolateFromRow(key, mRows[RATE_FACE_VARYING - RATE_VARYING], data);
+            } else {
+                interpolateFaceVaryings(key, data);
+            }
             break;
         case RATE_VERTEX:
-            interpolateVertices(key, data);
+            if (mRowReady[RATE_VERTEX - RATE_VARYING]) {
+                interpolateFromRow(key, mRows[RATE_VERTEX - RATE_VARYING], data);
+            } else {
+                interpolateVertices(key, data);
+            }
             break;
         default:
             isValidInterpolation = false;
@@ -56,6 +69,16 @@ public:
         return isValidInterpolation;
     }
 
+    // Interpolates in one go the whole attribute row of each varying, face
+    // varying and vertex rate at least two of the keys live in: a single
+    // weighted sum over the float rows of the primitive, all keys and time
+    // samples at once, instead of one weighted sum per key. interpolate()
+    // then only picks the value of a key out of the interpolated row and
+    // blends its time samples. Rates which hold non float types, or rows
+    // too wide for the inline storage, keep interpolating per key.
+    void prepareRows(const std::vector<AttributeKey>& requiredKeys,
+                     const std::vector<AttributeKey>& optionalKeys);
+
 protected:
     Interpolator(const shading::Attributes *attr, float time, int part,
                  int coarseFace, int numVaryings,
@@ -80,9 +103,33 @@ protected:
         mTessellatedFace(tessellatedFace), 
         mNumVertices(numVertices), 
         mVertices(vertices),
-        mVertexWeights(vertexWeights)
+        mVertexWeights(vertexWeights),
+        mRowReady{false, false, false}
     {}
 
+    template <typename T>
+    void interpolateFromRow(TypedAttributeKey<T> key, const float* row,
+            char* data) const {
+        const char* rowData = reinterpret_cast<const char*>(row);
+        T& result = *(reinterpret_cast<T*>(data));
+        int timeSampleCount = mAttr->getTimeSampleCount(key);
+        if (timeSampleCount == 1) {
+            result = *reinterpret_cast<const T*>(
+                rowData + mAttr->keyOffset(key, 0));
+        } else {
+            // TODO only support two time samples for motion blur case right now
+            MNRY_ASSERT(timeSampleCount == 2);
+            result = (T)(
+                (1.0f - mTime) * *reinterpret_cast<const T*>(
+                    rowData + mAttr->keyOffset(key, 0)) +
+                (       mTime) * *reinterpret_cast<const T*>(
+                    rowData + mAttr->keyOffset(key, 1)));
+        }
+    }
+
+    bool interpolateRow(AttributeRate rate, int count, const int* indices,
+            const float* weights, float* row) const;
+
     template <typename T>
     void interpolateConstant(TypedAttributeKey<T> key, char* data) const {
         int timeSampleCount = mAttr->getTimeSampleCount(key);
@@ -215,6 +262,11 @@ protected:
     int mNumVertices;
     const int *mVertices;
     const float *mVertexWeights;
+
+    // interpolated rows of the varying, face varying and vertex rates
+    static constexpr size_t sMaxRowFloats = 64;
+    bool mRowReady[3];
+    alignas(16) float mRows[3][sMaxRowFloats];
 };
 
 template <>
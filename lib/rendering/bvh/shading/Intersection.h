@@ -24,6 +24,14 @@
 namespace moonray {
 namespace shading {
 
+// Layouts of the sort key used to order shading points before shading them,
+// see Intersection::computeShadingSortKey().
+enum class ShadingSortKey
+{
+    UV = 0,         // light set, udim, mip level, uv (default)
+    DIRECTION,      // light set, udim, ray direction octant, mip level, uv
+};
+
 class CACHE_ALIGN Intersection
 {
 public:
@@ -287,6 +295,8 @@ public:
     }
 
     inline void setRequiredAttributes(Interpolator &interpolator) {
+        interpolator.prepareRows(getTable()->getRequiredAttributes(),
+                                 getTable()->getOptionalAttributes());
         for (const auto k : getTable()->getRequiredAttributes()) {
             setAttribute(k, interpolator);
         }
@@ -487,6 +497,20 @@ public:
     //
     finline uint32_t computeShadingSortKey() const;
 
+    //
+    // Same as above, but with a choice of layout.  ShadingSortKey::DIRECTION
+    // also groups the shading points of each texture tile by the octant of
+    // rayDir, which keeps rays hitting the same texels from the same side
+    // together for more coherent texture and light lookups:
+    // Bits  0-11   quantized swizzled uv coordinates, 12 bits = 4,096 mini-tiles.
+    // Bits 12-14   mip level, lower resolution mips sorted earlier, 3 bits = 8 mip levels.
+    // Bits 15-17   ray direction octant.
+    // Bits 18-24   udim tile, lower resolution idx sorted earlier, 7 bits = 128 tiles.
+    // Bits 25-31   lightset index, 7 bits = 128 light sets.
+    //
+    finline uint32_t computeShadingSortKey(ShadingSortKey keyType,
+                                           const scene_rdl2::math::Vec3f &rayDir) const;
+
     /// Normal derivatives
     finline scene_rdl2::math::Vec3f getdNdx() const
     {
@@ -713,6 +737,48 @@ Intersection::computeShadingSortKey() const
     return (ls << 25) | (udim << 18) | (ms << 14) | uv;
 }
 
+finline uint32_t
+Intersection::computeShadingSortKey(ShadingSortKey keyType,
+                                    const scene_rdl2::math::Vec3f &rayDir) const
+{
+    if (keyType != ShadingSortKey::DIRECTION) {
+        return computeShadingSortKey();
+    }
+
+    MNRY_ASSERT(mFlags.get(GeomInitialized));
+    MNRY_ASSERT(getLayerAssignmentId() >= 0);
+
+    // n = 64 quads per dimension to make room for the octant.
+    uint64_t x = ((uint64_t)(mSt.x * 63.9999f)) & 0x3f;
+    uint64_t y = ((uint64_t)(mSt.y * 63.9999f)) & 0x3f;
+
+    uint32_t uv = (((x * 0x0101010101010101ULL & 0x8040201008040201ULL) *
+                  0x0102040810204081ULL >> 49) & 0x5555) |
+                  (((y * 0x0101010101010101ULL & 0x8040201008040201ULL) *
+                  0x0102040810204081ULL >> 48) & 0xAAAA);
+
+    float mipSelector = computeMipSelector(mdSdx, mdTdx, mdSdy, mdTdy);
+
+    uint32_t ms = (uint32_t)minI32(int(mipSelector), 7);
+
+    uint32_t octant = (rayDir.x < 0.f ? 1u : 0u) |
+                      (rayDir.y < 0.f ? 2u : 0u) |
+                      (rayDir.z < 0.f ? 4u : 0u);
+
+    int32_t tileU = clampI32(int(mSt.x), 0, 9);
+    int32_t tileV = maxI32(int(mSt.y), 0);
+    uint32_t udim = (uint32_t)minI32(tileV * 10 + tileU, 127);
+
+    uint32_t ls = (uint32_t)minI32(getLayerAssignmentId(), 127);
+
+    MNRY_ASSERT(uv < 4096);
+    MNRY_ASSERT(ms < 8);
+    MNRY_ASSERT(udim < 128);
+    MNRY_ASSERT(ls < 128);
+
+    return (ls << 25) | (udim << 18) | (octant << 15) | (ms << 12) | uv;
+}
+
 
 finline std::ostream& operator<<(std::ostream& outs, const Intersection& i)
 {
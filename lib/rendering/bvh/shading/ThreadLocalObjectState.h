@@ -51,10 +51,14 @@ class CACHE_ALIGN ThreadLocalObjectState
     }
 
     moonray::util::InclusiveExclusiveAverage<int64> mShaderCallStat;
+    // Materials only: seconds spent in the shadow rays cast from their
+    // shading points, when cost attribution is on.
+    moonray::util::AverageDouble mOcclusionTime;
 
     void clear()
     {
         mShaderCallStat.reset();
+        mOcclusionTime.reset();
     }
 };
 
@@ -12,6 +12,7 @@
 #include <moonray/rendering/geom/ProceduralContext.h>
 
 #include <moonray/rendering/bvh/shading/AttributeKey.h>
+#include <moonray/rendering/bvh/shading/InstanceAttributes.h>
 #include <moonray/rendering/bvh/shading/PrimitiveAttribute.h>
 #include <scene_rdl2/render/util/stdmemory.h>
 #include <scene_rdl2/scene/rdl2/Geometry.h>
@@ -570,6 +571,16 @@ createInstance(const shading::XformSamples& xform,
                                           std::move(primitiveAttributeTable));
 }
 
+std::unique_ptr<Instance>
+createInstance(const shading::XformSamples& xform,
+               std::shared_ptr<SharedPrimitive> reference,
+               std::unique_ptr<shading::InstanceAttributes> attributes)
+{
+    return fauxstd::make_unique<Instance>(xform,
+                                          reference,
+                                          std::move(attributes));
+}
+
 std::shared_ptr<SharedPrimitive>
 createSharedPrimitive(std::unique_ptr<Primitive> primitive)
 {
@@ -256,6 +256,20 @@ createInstance(const shading::XformSamples& xform,
                std::shared_ptr<SharedPrimitive> reference,
                shading::PrimitiveAttributeTable&& attributeTable = shading::PrimitiveAttributeTable());
 
+/// @brief create an Instance with a transform, a referenced Primitive and
+///     prebuilt attributes. Procedurals which create many instances with
+///     the same attribute keys can share a key offset table among them
+///     (see shading::InstanceAttributes::buildKeyOffsetTable) rather than
+///     building a PrimitiveAttributeTable per instance
+/// @param xform shading::XformSamples that specify the local transform of instance
+/// @param reference the SharedPrimitive this instance referenced to
+/// @param attributes the constant rate attributes of the instance, may be null
+/// @return a unique pointer points to the created Instance primitive
+std::unique_ptr<Instance>
+createInstance(const shading::XformSamples& xform,
+               std::shared_ptr<SharedPrimitive> reference,
+               std::unique_ptr<shading::InstanceAttributes> attributes);
+
 /// @brief create a SharedPrimitive for instancing usage
 /// @param primitive the primitive to be shared/referenced by Instance
 /// @return a shared pointer points to the SharedPrimitive which can be
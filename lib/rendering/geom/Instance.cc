@@ -24,6 +24,12 @@ public:
         internal::Instance(xform, reference, std::move(primitiveAttributeTable))
     {}
 
+    explicit Impl(const shading::XformSamples& xform,
+            std::shared_ptr<SharedPrimitive> reference,
+            std::unique_ptr<shading::InstanceAttributes> attributes) :
+        internal::Instance(xform, reference, std::move(attributes))
+    {}
+
 };
 
 Instance::Instance(const shading::XformSamples& xform,
@@ -34,6 +40,13 @@ Instance::Instance(const shading::XformSamples& xform,
 {
 }
 
+Instance::Instance(const shading::XformSamples& xform,
+        std::shared_ptr<SharedPrimitive> reference,
+        std::unique_ptr<shading::InstanceAttributes> attributes) :
+    mImpl(new Instance::Impl(xform, reference, std::move(attributes)))
+{
+}
+
 
 Instance::~Instance() = default;
 
@@ -15,6 +15,9 @@
 #include <moonray/rendering/bvh/shading/Xform.h>
 
 namespace moonray {
+
+namespace shading { class InstanceAttributes; }
+
 namespace geom {
 
 /// @class Instance
@@ -28,6 +31,11 @@ public:
             std::shared_ptr<SharedPrimitive> reference,
             shading::PrimitiveAttributeTable&& primitiveAttributeTable);
 
+    /// @brief attributes is null for instances without attributes
+    Instance(const shading::XformSamples& xform,
+            std::shared_ptr<SharedPrimitive> reference,
+            std::unique_ptr<shading::InstanceAttributes> attributes);
+
     ~Instance();
 
     virtual void accept(PrimitiveVisitor& v) override;
@@ -9,7 +9,17 @@
 #include "InstanceProceduralLeaf.h"
 
 #include <moonray/rendering/geom/Api.h>
+#include <moonray/rendering/geom/PrimitiveGroup.h>
+#include <moonray/rendering/geom/PrimitiveVisitor.h>
 #include <moonray/rendering/geom/SharedPrimitive.h>
+#include <moonray/rendering/geom/TransformedPrimitive.h>
+#include <moonray/rendering/geom/prim/Primitive.h>
+#include <moonray/rendering/geom/prim/PrimitivePrivateAccess.h>
+
+#include <moonray/rendering/bvh/shading/InstanceAttributes.h>
+
+#include <algorithm>
+#include <cstdint>
 
 namespace {
 
@@ -66,6 +76,50 @@ isValidXform(const moonray::shading::XformSamples& xforms)
     return true;
 }
 
+// Bound of the primitives of a shared primitive in its local space, as they
+// are generated, before tessellation and displacement. The instances it
+// contains are left out, their bounds are only known once their reference
+// BVH is built.
+class SharedPrimitiveBound : public moonray::geom::PrimitiveVisitor
+{
+public:
+    SharedPrimitiveBound() : mBound(scene_rdl2::util::empty) {}
+
+    virtual void visitPrimitive(moonray::geom::Primitive& p) override {
+        const moonray::geom::internal::Primitive* pImpl =
+            moonray::geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&p);
+        if (pImpl != nullptr) {
+            mBound.extend(pImpl->computeAABB());
+        }
+    }
+
+    virtual void visitInstance(moonray::geom::Instance&) override {}
+
+    virtual void visitPrimitiveGroup(moonray::geom::PrimitiveGroup& pg) override {
+        bool isParallel = false;
+        pg.forEachPrimitive(*this, isParallel);
+    }
+
+    virtual void visitTransformedPrimitive(moonray::geom::TransformedPrimitive& t) override {
+        t.getPrimitive()->accept(*this);
+    }
+
+    scene_rdl2::math::BBox3f mBound;
+};
+
+// Uniform random number in [0, 1) for instance i, the same from render to render
+float
+instanceRandom(size_t i)
+{
+    uint32_t h = static_cast<uint32_t>(i);
+    h = (h ^ 61u) ^ (h >> 16);
+    h *= 9u;
+    h = h ^ (h >> 4);
+    h *= 0x27d4eb2du;
+    h = h ^ (h >> 15);
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+
 } // end anonymous namespace
 
 
@@ -143,7 +197,8 @@ InstanceProceduralLeaf::instanceWithXforms(const GenerateContext& generateContex
                                            const scene_rdl2::rdl2::Vec3fVector& positions,
                                            const scene_rdl2::rdl2::Vec4fVector& orientations,
                                            const scene_rdl2::rdl2::Vec3fVector& scales,
-                                           const scene_rdl2::rdl2::Mat4dVector& xforms)
+                                           const scene_rdl2::rdl2::Mat4dVector& xforms,
+                                           const InstanceLod& lod)
     {
         const scene_rdl2::rdl2::Geometry* rdlGeometry = generateContext.getRdlGeometry();
 
@@ -311,9 +366,202 @@ InstanceProceduralLeaf::instanceWithXforms(const GenerateContext& generateContex
                                applyScale);
         }
 
+        // Every instance carries the same attribute keys, so they share one key
+        // offset table and each only owns the constant data it points into,
+        // rather than a PrimitiveAttributeTable and key table per instance.
+        std::vector<shading::AttributeKey> attributeKeys;
+        if (addVelocityAttribute) {
+            attributeKeys.push_back(shading::StandardAttributes::sVelocity);
+        }
+        if (addInstanceTransformAttribute) {
+            attributeKeys.push_back(instanceLevelKey);
+        }
+        if (addInstanceObjectTransformAttribute) {
+            attributeKeys.push_back(shading::StandardAttributes::sInstanceObjectTransform);
+        }
+        if (useRefAttrs) {
+            // Only adding shadow_ray_epsilon for now
+            // MOONRAY-4313 - Propagate common geometry attributes to instanced primitives
+            attributeKeys.push_back(shading::StandardAttributes::sShadowRayEpsilon);
+        }
+
+        // Add explicit shading primitive attribute if explicit shading is enabled.
+        // Its validation only looks at the keys added so far.
+        if (explicitShading && xformsCount > disableIndicesSet.size()) {
+            shading::PrimitiveAttributeTable keyTable;
+            for (const auto& key : attributeKeys) {
+                if (key.getType() == scene_rdl2::rdl2::TYPE_MAT4F) {
+                    keyTable.addAttribute(shading::TypedAttributeKey<scene_rdl2::math::Mat4f>(key),
+                        shading::RATE_CONSTANT, {scene_rdl2::math::Mat4f(scene_rdl2::math::one)});
+                } else if (key.getType() == scene_rdl2::rdl2::TYPE_VEC3F) {
+                    keyTable.addAttribute(shading::TypedAttributeKey<Vec3f>(key),
+                        shading::RATE_CONSTANT, {Vec3f(scene_rdl2::math::zero)});
+                } else {
+                    keyTable.addAttribute(shading::TypedAttributeKey<float>(key),
+                        shading::RATE_CONSTANT, std::vector<float>{0.0f});
+                }
+            }
+            if (!addExplicitShading(rdlGeometry, keyTable)) {
+                return;
+            }
+            attributeKeys.push_back(shading::StandardAttributes::sExplicitShading);
+        }
+
+        for (const auto& kv : attrMap) {
+            if (kv.second != nullptr &&
+                std::find(attributeKeys.begin(), attributeKeys.end(), kv.first) == attributeKeys.end()) {
+                attributeKeys.push_back(kv.first);
+            }
+        }
+
+        size_t constantsSize = 0;
+        std::shared_ptr<const shading::InstanceAttributes::KeyOffsetTable> keyOffset =
+            shading::InstanceAttributes::buildKeyOffsetTable(attributeKeys, constantsSize);
+
+        auto setInstanceAttributes = [&](shading::InstanceAttributes& attrs, size_t i, int index,
+                                         const shading::XformSamples& xform) {
+            // handle a special case that user requests velocity,
+            // which is stored in its own separate location "velocities"
+            // instead of "primitive attributes" field
+            if (addVelocityAttribute) {
+                attrs.setAttribute(shading::StandardAttributes::sVelocity, velocities[i]);
+            }
+            if (addInstanceTransformAttribute) {
+                scene_rdl2::math::Mat4f instanceTransform(xform[0]);
+                if (useRefXforms) {
+                    instanceTransform = static_cast<scene_rdl2::math::Mat4f>(refXforms[index][0]) * instanceTransform;
+                }
+                attrs.setAttribute(instanceLevelKey, instanceTransform);
+            }
+            if (addInstanceObjectTransformAttribute) {
+                attrs.setAttribute(shading::StandardAttributes::sInstanceObjectTransform, nodeXform);
+            }
+            if (useRefAttrs) {
+                attrs.setAttribute(shading::StandardAttributes::sShadowRayEpsilon, shadowRayEpsilons[index]);
+            }
+            if (explicitShading) {
+                attrs.setAttribute(shading::StandardAttributes::sExplicitShading, true);
+            }
+
+            for (const auto& kv : attrMap) {
+                const auto& key = kv.first;
+                const void* values = kv.second;
+                if (values == nullptr) {
+                    continue;
+                }
+                switch (key.getType()) {
+                case scene_rdl2::rdl2::TYPE_BOOL:
+                    attrs.setAttribute(shading::TypedAttributeKey<bool>(key),
+                        static_cast<bool>((*(const scene_rdl2::rdl2::BoolVector*)values)[i]));
+                    break;
+                case scene_rdl2::rdl2::TYPE_INT:
+                    attrs.setAttribute(shading::TypedAttributeKey<int>(key),
+                        (*(const scene_rdl2::rdl2::IntVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_FLOAT:
+                    attrs.setAttribute(shading::TypedAttributeKey<float>(key),
+                        (*(const scene_rdl2::rdl2::FloatVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_STRING:
+                    attrs.setAttribute(shading::TypedAttributeKey<std::string>(key),
+                        (*(const scene_rdl2::rdl2::StringVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_RGB:
+                    attrs.setAttribute(shading::TypedAttributeKey<scene_rdl2::math::Color>(key),
+                        (*(const scene_rdl2::rdl2::RgbVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_VEC2F:
+                    attrs.setAttribute(shading::TypedAttributeKey<Vec2f>(key),
+                        (*(const scene_rdl2::rdl2::Vec2fVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_VEC3F:
+                    attrs.setAttribute(shading::TypedAttributeKey<Vec3f>(key),
+                        (*(const scene_rdl2::rdl2::Vec3fVector*)values)[i]);
+                    break;
+                case scene_rdl2::rdl2::TYPE_MAT4F:
+                    attrs.setAttribute(shading::TypedAttributeKey<scene_rdl2::math::Mat4f>(key),
+                        (*(const scene_rdl2::rdl2::Mat4fVector*)values)[i]);
+                    break;
+                default:
+                    break;
+                }
+            }
+        };
+
         size_t badXformCount = 0;
         int maxIndex = ref.size() - 1;
 
+        // Level of detail needs the render camera frustum to measure the instances.
+        const std::vector<mcrt_common::Frustum>& frustums = generateContext.getFrustums();
+        const bool applyLod = lod.isEnabled() && !frustums.empty();
+        std::vector<scene_rdl2::math::BBox3f> refBounds;
+        if (applyLod) {
+            refBounds.reserve(ref.size());
+            for (const auto& r : ref) {
+                SharedPrimitiveBound bound;
+                if (r) {
+                    r->getPrimitive()->accept(bound);
+                }
+                refBounds.push_back(bound.mBound);
+            }
+        }
+        const float pixelsPerScreenHeight = applyLod ?
+            frustums[0].mViewport[3] - frustums[0].mViewport[1] + 1 : 0.0f;
+        size_t lodCount = 0;
+
+        // Walks down the coarser references of index while the instance is
+        // smaller on screen than their minimum pixel size.
+        auto selectLod = [&](size_t i, int index, const shading::XformSamples& xform) {
+            const scene_rdl2::math::BBox3f& refBound = refBounds[index];
+            if (!scene_rdl2::math::isFinite(refBound.lower) ||
+                !scene_rdl2::math::isFinite(refBound.upper)) {
+                return index;
+            }
+
+            // sized at shutter open, the bounding sphere of the instance in render space
+            scene_rdl2::math::Xform3f local2render = xform[0] * parent2render[0];
+            if (useRefXforms) {
+                local2render = refXforms[index][0] * local2render;
+            }
+            const scene_rdl2::math::BBox3f bound =
+                scene_rdl2::math::transformBounds(local2render, refBound);
+            const float diameter = scene_rdl2::math::length(bound.size());
+            const float distance = scene_rdl2::math::max(
+                scene_rdl2::math::length(scene_rdl2::math::center(bound)), 0.5f * diameter);
+            if (distance <= 0.0f) {
+                return index;
+            }
+            // same projection as the adaptive tessellation of the meshes
+            const float pixelSize = 0.5f * pixelsPerScreenHeight * diameter *
+                scene_rdl2::math::abs(frustums[0].mC2S[1][1]) / distance;
+
+            const float u = instanceRandom(i);
+            for (size_t level = 0; level < ref.size(); ++level) {
+                if (index >= static_cast<int>(lod.mCoarserIndices.size()) ||
+                    index >= static_cast<int>(lod.mMinPixelSizes.size())) {
+                    break;
+                }
+                const int coarser = lod.mCoarserIndices[index];
+                const float minPixelSize = lod.mMinPixelSizes[index];
+                if (coarser < 0 || coarser > maxIndex || !ref[coarser] || minPixelSize <= 0.0f) {
+                    break;
+                }
+                // chance of keeping the finer reference
+                float keep;
+                if (lod.mBlend > 0.0f) {
+                    keep = (pixelSize - minPixelSize * (1.0f - lod.mBlend)) /
+                           (2.0f * lod.mBlend * minPixelSize);
+                } else {
+                    keep = pixelSize >= minPixelSize ? 1.0f : 0.0f;
+                }
+                if (u < keep) {
+                    break;
+                }
+                index = coarser;
+            }
+            return index;
+        };
+
         // disableIndicesSet contains no duplicates or elements >= xformsCount
         reservePrimitive(xformsCount - disableIndicesSet.size());
         // combine above info to XformSamples
@@ -376,101 +624,22 @@ InstanceProceduralLeaf::instanceWithXforms(const GenerateContext& generateContex
             if (!ref[index]) {
                 continue;
             }
-
-            shading::PrimitiveAttributeTable primitiveAttributeTable;
-
-            // handle a special case that user requests velocity,
-            // which is stored in its own separate location "velocities"
-            // instead of "primitive attributes" field
-            if (addVelocityAttribute) {
-                primitiveAttributeTable.addAttribute(
-                    shading::StandardAttributes::sVelocity, shading::RATE_CONSTANT,
-                    {velocities[i]});
-            }
-            if (addInstanceTransformAttribute) {
-                scene_rdl2::math::Mat4f instanceTransform(xform[0]);
-                if (useRefXforms) {
-                    instanceTransform = static_cast<scene_rdl2::math::Mat4f>(refXforms[index][0]) * instanceTransform;
+            if (applyLod) {
+                const int lodIndex = selectLod(i, index, xform);
+                if (lodIndex != index) {
+                    index = lodIndex;
+                    lodCount++;
                 }
-
-                primitiveAttributeTable.addAttribute(
-                    instanceLevelKey,
-                    shading::RATE_CONSTANT,
-                    { instanceTransform });
-            }
-            if (addInstanceObjectTransformAttribute) {
-                primitiveAttributeTable.addAttribute(
-                    shading::StandardAttributes::sInstanceObjectTransform,
-                    shading::RATE_CONSTANT,
-                    { nodeXform });
-            }
-            if (useRefAttrs) {
-                // Only adding shadow_ray_epsilon for now
-                // MOONRAY-4313 - Propagate common geometry attributes to instanced primitives
-                std::vector<float> shadowRayEpsilon = { shadowRayEpsilons[index] };
-                primitiveAttributeTable.addAttribute(
-                    shading::StandardAttributes::sShadowRayEpsilon,
-                    shading::RATE_CONSTANT,
-                    std::move(shadowRayEpsilon));
             }
 
-            // Add explicit shading primitive attribute if explicit shading is enabled
-            if (explicitShading &&
-                !addExplicitShading(rdlGeometry, primitiveAttributeTable)) {
-                return;
+            // the values of this instance, laid out by the shared key offset table
+            std::unique_ptr<shading::InstanceAttributes> instanceAttributes;
+            if (!attributeKeys.empty()) {
+                instanceAttributes.reset(
+                    new shading::InstanceAttributes(keyOffset, constantsSize));
+                setInstanceAttributes(*instanceAttributes, i, index, xform);
             }
 
-            for (const auto& kv : attrMap) {
-                const auto& key = kv.first;
-                const void* values = kv.second;
-                if (values == nullptr) {
-                    continue;
-                }
-                switch (key.getType()) {
-                case scene_rdl2::rdl2::TYPE_BOOL:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<bool>(key), shading::RATE_CONSTANT,
-                        std::vector<bool>({ (*(const scene_rdl2::rdl2::BoolVector*)values)[i]}) );
-                    break;
-                case scene_rdl2::rdl2::TYPE_INT:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<int>(key), shading::RATE_CONSTANT,
-                        std::vector<int>({ (*(const scene_rdl2::rdl2::IntVector*)values)[i]}) );
-                    break;
-                case scene_rdl2::rdl2::TYPE_FLOAT:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<float>(key), shading::RATE_CONSTANT,
-                        std::vector<float>({ (*(const scene_rdl2::rdl2::FloatVector*)values)[i]}) );
-                    break;
-                case scene_rdl2::rdl2::TYPE_STRING:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<std::string>(key), shading::RATE_CONSTANT,
-                        {(*(const scene_rdl2::rdl2::StringVector*)values)[i]});
-                    break;
-                case scene_rdl2::rdl2::TYPE_RGB:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<scene_rdl2::math::Color>(key), shading::RATE_CONSTANT,
-                        {(*(const scene_rdl2::rdl2::RgbVector*)values)[i]});
-                    break;
-                case scene_rdl2::rdl2::TYPE_VEC2F:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<Vec2f>(key), shading::RATE_CONSTANT,
-                        {(*(const scene_rdl2::rdl2::Vec2fVector*)values)[i]});
-                    break;
-                case scene_rdl2::rdl2::TYPE_VEC3F:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<Vec3f>(key), shading::RATE_CONSTANT,
-                        {(*(const scene_rdl2::rdl2::Vec3fVector*)values)[i]});
-                    break;
-                case scene_rdl2::rdl2::TYPE_MAT4F:
-                    primitiveAttributeTable.addAttribute(
-                        shading::TypedAttributeKey<scene_rdl2::math::Mat4f>(key), shading::RATE_CONSTANT,
-                        {(*(const scene_rdl2::rdl2::Mat4fVector*)values)[i]});
-                    break;
-                default:
-                    break;
-                }
-            }
             if (useRefXforms) {
                 for (size_t j = 0; j < xform.size(); ++j) {
                     xform[j] = refXforms[index][j] * xform[j];
@@ -479,7 +648,7 @@ InstanceProceduralLeaf::instanceWithXforms(const GenerateContext& generateContex
             if (isValidXform(xform)) {
                 auto instance = createInstance(xform,
                                                ref[index],
-                                               std::move(primitiveAttributeTable));
+                                               std::move(instanceAttributes));
                 addPrimitive(std::move(instance),
                              generateContext.getMotionBlurParams(),
                              parent2render);
@@ -491,6 +660,10 @@ InstanceProceduralLeaf::instanceWithXforms(const GenerateContext& generateContex
             rdlGeometry->warn("Skipped ", badXformCount,
                 " instances which contained invalid transform matrices");
         }
+        if (lodCount > 0) {
+            rdlGeometry->info("Level of detail: ", lodCount,
+                " instances use a coarser reference");
+        }
     }
 
 
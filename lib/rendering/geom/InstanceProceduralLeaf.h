@@ -26,6 +26,23 @@ enum class InstanceMethod {
     XFORMS = 2
 };
 
+/// Level of detail of the references of an instancer. Each instance of a
+/// reference whose projected size in the render camera is under the minimum
+/// pixel size of the reference uses the coarser reference instead, which
+/// itself may have a coarser reference. Both vectors are indexed like the
+/// references, a reference without a coarser reference has an index of -1.
+/// Within blend times the minimum pixel size on either side of it,
+/// instances pick one of the two references at random with a probability
+/// following their size, so the switch doesn't show as a sharp line.
+struct InstanceLod
+{
+    scene_rdl2::rdl2::IntVector mCoarserIndices;
+    scene_rdl2::rdl2::FloatVector mMinPixelSizes;
+    float mBlend = 0.0f;
+
+    bool isEnabled() const { return !mCoarserIndices.empty(); }
+};
+
 bool
 getReferenceData(const scene_rdl2::rdl2::Geometry& rdlGeometry,
                  const scene_rdl2::rdl2::SceneObjectVector& references,
@@ -72,7 +89,8 @@ protected:
                             const scene_rdl2::rdl2::Vec3fVector& positions,
                             const scene_rdl2::rdl2::Vec4fVector& orientations,
                             const scene_rdl2::rdl2::Vec3fVector& scales,
-                            const scene_rdl2::rdl2::Mat4dVector& xforms);
+                            const scene_rdl2::rdl2::Mat4dVector& xforms,
+                            const InstanceLod& lod = InstanceLod());
 
 };
 
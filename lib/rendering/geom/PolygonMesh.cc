@@ -23,8 +23,9 @@ namespace geom {
 
 struct PolygonMesh::Impl
 {
-    explicit Impl(internal::PolyMesh* polyMesh) : mPolyMesh(polyMesh) {}
+    explicit Impl(internal::PolyMesh* polyMesh) : mPolyMesh(polyMesh), mVertexBytesCopied(0) {}
     std::unique_ptr<internal::PolyMesh> mPolyMesh;
+    size_t mVertexBytesCopied;
 };
 
 PolygonMesh::PolygonMesh(FaceVertexCount&& faceVertexCount,
@@ -55,6 +56,7 @@ PolygonMesh::PolygonMesh(FaceVertexCount&& faceVertexCount,
 
     const size_t maxFVCount = *std::max_element(faceVertexCount.begin(),
                                                 faceVertexCount.end());
+    const size_t vertexBytesCopied = vertices.get_bytes_copied();
     // If the maximum face vertex count is more than four we always create a
     // tri mesh for now since it can deal with concave ngons.   If not, we
     // create a quad mesh if it will generate less polygons than a trimesh.
@@ -67,6 +69,7 @@ PolygonMesh::PolygonMesh(FaceVertexCount&& faceVertexCount,
                 std::move(faceVertexCount), std::move(indices), std::move(vertices),
                 std::move(layerAssignmentId), std::move(primitiveAttributeTable)));
     }
+    mImpl->mVertexBytesCopied = vertexBytesCopied;
 }
 
 PolygonMesh::~PolygonMesh() = default;
@@ -230,6 +233,12 @@ PolygonMesh::getVertexCount() const
     return mImpl->mPolyMesh->getVertexCount();
 }
 
+size_t
+PolygonMesh::getVertexBytesCopied() const
+{
+    return mImpl->mVertexBytesCopied;
+}
+
 } // namespace geom
 } // namespace moonray
 
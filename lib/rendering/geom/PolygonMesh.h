@@ -149,6 +149,10 @@ public:
     /// return the number of vertices in this polygon mesh
     size_type getVertexCount() const;
 
+    /// return the number of vertex bytes the procedural copied into the
+    /// vertex buffer it constructed the mesh with, 0 for an adopted buffer
+    size_t getVertexBytesCopied() const;
+
     void setCurvedMotionBlurSampleCount(int count);
 
 private:
@@ -15,6 +15,7 @@
 #include <moonray/rendering/geom/PrimitiveVisitor.h>
 
 #include <tbb/atomic.h>
+#include <tbb/enumerable_thread_specific.h>
 
 #include <numeric>
 
@@ -68,11 +69,15 @@ private:
     bool mInPrimitiveGroup;
 };
 
+// forEachPrimitive() visits the primitives of a group in parallel, so each
+// thread counts into its own GeometryStatistics.
 class StatisticsAccumulator : public PrimitiveVisitor
 {
 public:
+    typedef tbb::enumerable_thread_specific<GeometryStatistics> ThreadStatistics;
+
     StatisticsAccumulator(
-            GeometryStatistics& geometryStatistics,
+            ThreadStatistics& geometryStatistics,
             SharedPrimitiveSet& sharedPrimitives) :
         mGeometryStatistics(geometryStatistics),
         mSharedPrimitives(sharedPrimitives) {}
@@ -81,19 +86,24 @@ public:
     }
 
     virtual void visitPolygonMesh(PolygonMesh& p) override {
-        mGeometryStatistics.mFaceCount += p.getFaceCount();
-        mGeometryStatistics.mMeshVertexCount += p.getVertexCount();
+        GeometryStatistics& statistics = mGeometryStatistics.local();
+        statistics.mFaceCount += p.getFaceCount();
+        statistics.mMeshVertexCount += p.getVertexCount();
+        statistics.mVertexBytesCopied += p.getVertexBytesCopied();
     }
 
     virtual void visitSubdivisionMesh(SubdivisionMesh& s) override {
-        mGeometryStatistics.mFaceCount += s.getSubdivideFaceCount();
-        mGeometryStatistics.mMeshVertexCount += s.getSubdivideVertexCount();
+        GeometryStatistics& statistics = mGeometryStatistics.local();
+        statistics.mFaceCount += s.getSubdivideFaceCount();
+        statistics.mMeshVertexCount += s.getSubdivideVertexCount();
+        statistics.mVertexBytesCopied += s.getVertexBytesCopied();
     }
 
     virtual void visitCurves(Curves& c) override {
-        mGeometryStatistics.mCurvesCount += c.getCurvesCount();
+        GeometryStatistics& statistics = mGeometryStatistics.local();
+        statistics.mCurvesCount += c.getCurvesCount();
         const auto& curvesVertexCount = c.getCurvesVertexCount();
-        mGeometryStatistics.mCVCount += std::accumulate(curvesVertexCount.begin(),
+        statistics.mCVCount += std::accumulate(curvesVertexCount.begin(),
             curvesVertexCount.end(), 0);
     }
 
@@ -106,7 +116,7 @@ public:
     }
 
     virtual void visitInstance(Instance& i) override {
-        ++mGeometryStatistics.mInstanceCount;
+        ++mGeometryStatistics.local().mInstanceCount;
         const auto& ref = i.getReference();
         // visit the referenced Primitive if it's not visited yet
         if (mSharedPrimitives.insert(ref).second) {
@@ -115,7 +125,7 @@ public:
     }
 
 private:
-    GeometryStatistics& mGeometryStatistics;
+    ThreadStatistics& mGeometryStatistics;
     SharedPrimitiveSet& mSharedPrimitives;
 };
 
@@ -133,12 +143,16 @@ Procedural::getMemory()
 GeometryStatistics
 Procedural::getStatistics() const
 {
-    GeometryStatistics geometryStatistics;
+    StatisticsAccumulator::ThreadStatistics threadStatistics;
 
     SharedPrimitiveSet sharedPrimitives;
-    StatisticsAccumulator accumulator(geometryStatistics, sharedPrimitives);
+    StatisticsAccumulator accumulator(threadStatistics, sharedPrimitives);
     const_cast<Procedural *>(this)->forEachPrimitive(accumulator);
 
+    GeometryStatistics geometryStatistics;
+    for (const GeometryStatistics& statistics : threadStatistics) {
+        geometryStatistics += statistics;
+    }
     return geometryStatistics;
 }
 
@@ -27,13 +27,26 @@ namespace moonray {
 namespace geom {
 
 struct GeometryStatistics {
-    GeometryStatistics() : mFaceCount(0), mMeshVertexCount(0), mCurvesCount(0), mCVCount(0), mInstanceCount(0) {}
+    GeometryStatistics() : mFaceCount(0), mMeshVertexCount(0), mCurvesCount(0), mCVCount(0), mInstanceCount(0),
+        mVertexBytesCopied(0) {}
 
     Primitive::size_type mFaceCount;
     Primitive::size_type mMeshVertexCount;
     Primitive::size_type mCurvesCount;
     Primitive::size_type mCVCount;
     Primitive::size_type mInstanceCount;
+    // mesh vertex data the procedural copied instead of handing it over
+    size_t mVertexBytesCopied;
+
+    GeometryStatistics& operator+=(const GeometryStatistics& other) {
+        mFaceCount += other.mFaceCount;
+        mMeshVertexCount += other.mMeshVertexCount;
+        mCurvesCount += other.mCurvesCount;
+        mCVCount += other.mCVCount;
+        mInstanceCount += other.mInstanceCount;
+        mVertexBytesCopied += other.mVertexBytesCopied;
+        return *this;
+    }
 };
 
 //----------------------------------------------------------------------------
@@ -142,6 +155,11 @@ public:
     ///     referenced by other geometry procedural through getReference()
     virtual bool isReference() const = 0;
 
+    /// @brief Whether generate() may run concurrently with the generate() of
+    ///     other procedurals of the same scene class. Procedurals sharing
+    ///     non thread safe state between instances should return false.
+    virtual bool isGenerateThreadSafe() const { return true; }
+
     /// @brief Query the SharedPrimitive stored in this procedural when the
     ///     owner geometry is referenced by other geometry
     virtual const std::shared_ptr<SharedPrimitive>& getReference() const = 0;
@@ -95,6 +95,11 @@ public:
     virtual const shading::AttributeKeySet &getRequestedAttributes() const = 0;
 
     virtual bool requestAttribute(const shading::AttributeKey& attributeKey) const = 0;
+
+    /// Get the frustums of the render camera at shutter open and close, the same
+    /// ones adaptive tessellation is computed with
+    /// @return the camera frustums, empty when the camera doesn't have one
+    virtual const std::vector<mcrt_common::Frustum>& getFrustums() const = 0;
 };
 
 ///
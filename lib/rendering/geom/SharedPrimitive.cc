@@ -10,6 +10,9 @@
 
 #include <embree4/rtcore.h>
 
+#include <atomic>
+#include <mutex>
+
 namespace moonray {
 namespace geom {
 
@@ -32,6 +35,11 @@ struct SharedPrimitive::Impl {
 
     std::unique_ptr<Primitive> mPrimitive;
     RTCScene mBVHScene;
+    // deferred BVH construction, see setDeferredBVHScene()
+    std::atomic<bool> mBVHDeferred {false};
+    std::function<void*()> mBuildBVHScene;
+    BBox3f mDeferredBound;
+    std::mutex mDeferredMutex;
     bool mHasSurfaceAssignment; // assumed to be yes
     bool mHasVolumeAssignment; // assumed to be no
 };
@@ -75,14 +83,44 @@ SharedPrimitive::getHasVolumeAssignment() const
 
 void
 SharedPrimitive::setBVHScene(void* bvhScene) {
+    std::lock_guard<std::mutex> lock(mImpl->mDeferredMutex);
+    mImpl->mBVHDeferred = false;
+    mImpl->mBuildBVHScene = nullptr;
     mImpl->resetBVHScene(static_cast<RTCScene>(bvhScene));
 }
 
 void*
 SharedPrimitive::getBVHScene() {
+    if (mImpl->mBVHDeferred.load(std::memory_order_acquire)) {
+        // the first caller builds the scene, the others wait for it
+        std::lock_guard<std::mutex> lock(mImpl->mDeferredMutex);
+        if (mImpl->mBVHDeferred.load(std::memory_order_relaxed)) {
+            mImpl->resetBVHScene(static_cast<RTCScene>(mImpl->mBuildBVHScene()));
+            mImpl->mBuildBVHScene = nullptr;
+            mImpl->mBVHDeferred.store(false, std::memory_order_release);
+        }
+    }
     return static_cast<void*>(mImpl->mBVHScene);
 }
 
+void
+SharedPrimitive::setDeferredBVHScene(std::function<void*()>&& buildScene, const BBox3f& localBound) {
+    std::lock_guard<std::mutex> lock(mImpl->mDeferredMutex);
+    mImpl->resetBVHScene();
+    mImpl->mBuildBVHScene = std::move(buildScene);
+    mImpl->mDeferredBound = localBound;
+    mImpl->mBVHDeferred.store(true, std::memory_order_release);
+}
+
+bool
+SharedPrimitive::getDeferredBVHBound(BBox3f& localBound) const {
+    if (!mImpl->mBVHDeferred.load(std::memory_order_acquire)) {
+        return false;
+    }
+    localBound = mImpl->mDeferredBound;
+    return true;
+}
+
 } // namespace geom
 } // namespace moonray
 
@@ -10,6 +10,8 @@
 
 #include <moonray/rendering/geom/Primitive.h>
 
+#include <functional>
+
 namespace moonray {
 namespace geom {
 
@@ -37,7 +39,16 @@ private:
     /// @remark For renderer internal use, procedural should never call this
     void setBVHScene(void* bvhScene);
     /// @remark For renderer internal use, procedural should never call this
+    /// Builds the BVH scene first if its construction was deferred
     void* getBVHScene();
+    /// @remark For renderer internal use, procedural should never call this
+    /// Defers the BVH scene construction until getBVHScene() is first called,
+    /// localBound stands in for the scene bounds until then
+    void setDeferredBVHScene(std::function<void*()>&& buildScene, const BBox3f& localBound);
+    /// @remark For renderer internal use, procedural should never call this
+    /// Returns true and the bound passed to setDeferredBVHScene() if the BVH
+    /// scene is not built yet
+    bool getDeferredBVHBound(BBox3f& localBound) const;
 
 private:
     struct Impl;
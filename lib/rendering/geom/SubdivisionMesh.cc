@@ -24,13 +24,16 @@ class SubdMesh;
 
 struct SubdivisionMesh::Impl
 {
-    explicit Impl(internal::SubdMesh* subdMesh) : mSubdMesh(subdMesh) {}
+    explicit Impl(internal::SubdMesh* subdMesh) : mSubdMesh(subdMesh), mVertexBytesCopied(0) {}
     std::unique_ptr<internal::SubdMesh> mSubdMesh;
+    size_t mVertexBytesCopied;
 };
 
 SubdivisionMesh::SubdivisionMesh(Impl* impl) :
     mImpl(fauxstd::make_unique<Impl>(impl->mSubdMesh->copy()))
-{}
+{
+    mImpl->mVertexBytesCopied = impl->mVertexBytesCopied;
+}
 
 SubdivisionMesh::~SubdivisionMesh() = default;
 
@@ -42,11 +45,13 @@ SubdivisionMesh::SubdivisionMesh(
         LayerAssignmentId&& layerAssignmentId,
         shading::PrimitiveAttributeTable&& primitiveAttributeTable)
 {
+    const size_t vertexBytesCopied = vertices.get_bytes_copied();
     mImpl = fauxstd::make_unique<Impl>(new internal::OpenSubdivMesh(
         scheme,
         std::move(faceVertexCount), std::move(indices),
         std::move(vertices), std::move(layerAssignmentId),
         std::move(primitiveAttributeTable)));
+    mImpl->mVertexBytesCopied = vertexBytesCopied;
 }
 
 std::unique_ptr<SubdivisionMesh>
@@ -73,6 +78,12 @@ SubdivisionMesh::getSubdivideVertexCount() const
     return mImpl->mSubdMesh->getTessellatedMeshVertexCount();
 }
 
+size_t
+SubdivisionMesh::getVertexBytesCopied() const
+{
+    return mImpl->mVertexBytesCopied;
+}
+
 
 Primitive::size_type
 SubdivisionMesh::getMemory() const
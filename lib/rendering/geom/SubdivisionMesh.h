@@ -82,6 +82,11 @@ public:
 
     size_type getSubdivideVertexCount() const;
 
+    /// return the number of vertex bytes the procedural copied into the
+    /// control vertex buffer it constructed the mesh with, 0 for an adopted
+    /// buffer
+    size_t getVertexBytesCopied() const;
+
     virtual size_type getMemory() const override;
 
     virtual size_type getMotionSamplesCount() const override;
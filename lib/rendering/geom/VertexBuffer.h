@@ -9,8 +9,10 @@
 #pragma once
 
 #include <scene_rdl2/render/util/AlignedAllocator.h>
+#include <cassert>
 #include <cstdint>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 namespace moonray {
@@ -50,6 +52,15 @@ public:
     /// we return 4*2*3 == 24
     using traits_type::data_size;
     using traits_type::get_memory_usage;
+
+    /// Whether the elements live in memory adopted through adopt() rather
+    /// than in memory the VertexBuffer allocated.
+    using traits_type::is_adopted;
+
+    /// Gets the number of bytes of element data copied into the VertexBuffer
+    /// so far, by push_back, append, copy and reallocations. Adopted memory
+    /// doesn't count as copied.
+    using traits_type::get_bytes_copied;
     using traits_type::empty;
     using traits_type::clear;
 
@@ -85,6 +96,38 @@ public:
     {
     }
 
+    /// Construct a VertexBuffer referencing n elements of timeSteps samples
+    /// at data directly, without copying them. data has to be laid out like
+    /// the VertexBuffer, writable and aligned for value_type, for example
+    /// the source array of a procedural or a MAP_PRIVATE mapping of a file.
+    /// owner keeps the memory alive, the VertexBuffer releases it when
+    /// destroyed or when it has to grow, which copies the elements into
+    /// memory of its own.
+    static VertexBuffer adopt(pointer data, size_type n, size_type timeSteps,
+                              std::shared_ptr<void> owner,
+                              allocator_type alloc = allocator_type())
+    {
+        return VertexBuffer(data, n, timeSteps, std::move(owner), alloc);
+    }
+
+    /// Construct a VertexBuffer taking over the elements of a contiguous
+    /// container, e.g. a std::vector<value_type>, without copying them. The
+    /// container holds the timeSteps samples of each element in turn.
+    template <typename Container>
+    static VertexBuffer adopt(Container&& container, size_type timeSteps = 1)
+    {
+        typedef typename std::decay<Container>::type ContainerType;
+        static_assert(std::is_same<typename ContainerType::value_type, value_type>::value,
+            "The container has to hold elements of the VertexBuffer type.");
+        static_assert(std::is_rvalue_reference<Container&&>::value,
+            "Ownership of the container has to be handed over, move it in.");
+        assert(timeSteps > 0 && container.size() % timeSteps == 0);
+        auto owner = std::make_shared<ContainerType>(std::move(container));
+        const size_type n = owner->size() / timeSteps;
+        pointer data = owner->data();
+        return VertexBuffer(data, n, timeSteps, std::move(owner), allocator_type());
+    }
+
     VertexBuffer(VertexBuffer&&) noexcept = default;
 
     VertexBuffer& operator=(const VertexBuffer&) = delete;
@@ -200,6 +243,12 @@ private:
     {
     }
 
+    VertexBuffer(pointer data, size_type n, size_type timeSteps,
+                 std::shared_ptr<void> owner, allocator_type alloc) :
+        Traits<T, Allocator>(data, n, timeSteps, std::move(owner), alloc)
+    {
+    }
+
     void ensure_capacity(size_type nelements)
     {
         auto cap = capacity();
@@ -59,7 +59,8 @@ protected:
         mCapacity(0),
         mSize(0),
         mTimeSteps(timeSteps),
-        mData(nullptr)
+        mData(nullptr),
+        mBytesCopied(0)
     {
     }
 
@@ -69,7 +70,8 @@ protected:
         mCapacity(n),
         mSize(n),
         mTimeSteps(timeSteps),
-        mData(create(getAllocatorInternal(), n, timeSteps))
+        mData(create(getAllocatorInternal(), n, timeSteps)),
+        mBytesCopied(0)
     {
     }
 
@@ -79,16 +81,37 @@ protected:
         mCapacity(n),
         mSize(n),
         mTimeSteps(timeSteps),
-        mData(create(getAllocatorInternal(), n, timeSteps, value))
+        mData(create(getAllocatorInternal(), n, timeSteps, value)),
+        mBytesCopied(0)
     {
     }
 
+    // Adopts n elements of timeSteps samples at data without copying them.
+    // The memory isn't owned by the allocator, owner keeps it alive until
+    // it gets released.
+    InterleavedTraits(pointer data, size_type n, size_type timeSteps,
+                      std::shared_ptr<void> owner,
+                      allocator_type alloc = allocator_type()) :
+        allocator_type(alloc),
+        mCapacity(n),
+        mSize(n),
+        mTimeSteps(timeSteps),
+        mData(data),
+        mOwner(std::move(owner)),
+        mBytesCopied(0)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+            "Adopted memory is released without destroying its elements.");
+        assert(mOwner);
+    }
+
     InterleavedTraits(const InterleavedTraits& other) :
         allocator_type(traits::select_on_container_copy_construction(other)),
         mCapacity(other.mSize),
         mSize(other.mSize),
         mTimeSteps(other.mTimeSteps),
-        mData(copyValue(getAllocatorInternal(), other.mData, other.mSize, other.mTimeSteps))
+        mData(copyValue(getAllocatorInternal(), other.mData, other.mSize, other.mTimeSteps)),
+        mBytesCopied(sizeof(value_type) * other.mSize * other.mTimeSteps)
     {
     }
 
@@ -97,12 +120,15 @@ protected:
         mCapacity(other.mCapacity),
         mSize(other.mSize),
         mTimeSteps(other.mTimeSteps),
-        mData(other.mData)
+        mData(other.mData),
+        mOwner(std::move(other.mOwner)),
+        mBytesCopied(other.mBytesCopied)
     {
         other.mCapacity = 0;
         other.mTimeSteps = 0;
         other.mData = nullptr;
         other.mSize = 0;
+        other.mBytesCopied = 0;
     }
 
     InterleavedTraits& operator=(const InterleavedTraits& other) = delete;
@@ -119,11 +145,14 @@ protected:
             mSize = other.mSize;
             mTimeSteps = other.mTimeSteps;
             mData = std::move(other.mData);
+            mOwner = std::move(other.mOwner);
+            mBytesCopied = other.mBytesCopied;
 
             other.mTimeSteps = 0;
             other.mCapacity = 0;
             other.mSize = 0;
             other.mData = nullptr;
+            other.mBytesCopied = 0;
         } else if (fauxstd::is_always_equal<allocator_type>::value ||
                    this->getAllocatorInternal() ==
                    other.getAllocatorInternal()) {
@@ -132,11 +161,14 @@ protected:
             mSize = other.mSize;
             mTimeSteps = other.mTimeSteps;
             mData = std::move(other.mData);
+            mOwner = std::move(other.mOwner);
+            mBytesCopied = other.mBytesCopied;
 
             other.mTimeSteps = 0;
             other.mCapacity = 0;
             other.mSize = 0;
             other.mData = nullptr;
+            other.mBytesCopied = 0;
         } else {
             // Our only option is to copy all of the elements, because we can't
             // do anything smart with the allocators. This is bad.
@@ -147,6 +179,8 @@ protected:
             mSize = other.mSize;
             mTimeSteps = other.mTimeSteps;
             mData = newData;
+            mBytesCopied = other.mBytesCopied +
+                           sizeof(value_type) * other.mSize * other.mTimeSteps;
         }
 
         return *this;
@@ -184,6 +218,8 @@ protected:
         swap(mSize, other.mSize);
         swap(mTimeSteps, other.mTimeSteps);
         swap(mData, other.mData);
+        swap(mOwner, other.mOwner);
+        swap(mBytesCopied, other.mBytesCopied);
     }
 
     float* data()
@@ -227,6 +263,20 @@ protected:
         return getAllocatorInternal();
     }
 
+    // Whether the elements live in adopted memory rather than memory
+    // allocated by the allocator
+    bool is_adopted() const noexcept
+    {
+        return mOwner != nullptr;
+    }
+
+    // Bytes of element data copied into the buffer so far: elements pushed
+    // or appended, copies of other buffers and reallocations
+    size_type get_bytes_copied() const noexcept
+    {
+        return mBytesCopied;
+    }
+
     size_type get_memory_usage() const noexcept
     {
         size_type mem = sizeof(*this) +
@@ -241,6 +291,7 @@ protected:
         pointer p = getAddress(0, mSize);
         traits::construct(getAllocatorInternal(), p, u);
         ++mSize;
+        mBytesCopied += sizeof(value_type);
     }
 
     void push_back(value_type&& u)
@@ -250,6 +301,7 @@ protected:
         pointer p = getAddress(0, mSize);
         traits::construct(getAllocatorInternal(), p, std::move(u));
         ++mSize;
+        mBytesCopied += sizeof(value_type);
     }
 
     template <typename U>
@@ -261,6 +313,7 @@ protected:
             traits::construct(getAllocatorInternal(), p, u[t]);
         }
         ++mSize;
+        mBytesCopied += sizeof(value_type) * mTimeSteps;
     }
 
     void append(const InterleavedTraits& other)
@@ -272,6 +325,7 @@ protected:
                          other.mData,
                          other.mSize * other.mTimeSteps);
         mSize += other.mSize;
+        mBytesCopied += sizeof(value_type) * other.mSize * other.mTimeSteps;
     }
 
     void append(InterleavedTraits&& other)
@@ -283,6 +337,7 @@ protected:
                          other.mData,
                          other.mSize * other.mTimeSteps);
         mSize += other.mSize;
+        mBytesCopied += sizeof(value_type) * other.mSize * other.mTimeSteps;
         other.destroy();
         other.mSize = 0;
         other.mCapacity = 0;
@@ -420,13 +475,22 @@ private:
         // Now that all of the throwing operations are done, we can modify
         // the state of our object with non-throwing operations.
         swap(p, mData);
-        traits::deallocate(getAllocatorInternal(), p, mCapacity * mTimeSteps);
+        if (mOwner) {
+            // The elements got copied out of the adopted memory
+            mOwner.reset();
+        } else {
+            traits::deallocate(getAllocatorInternal(), p, mCapacity * mTimeSteps);
+        }
         mCapacity = size;
+        mBytesCopied += sizeof(value_type) * mSize * mTimeSteps;
     }
 
     void destroy() noexcept
     {
-        if (mData) {
+        if (mOwner) {
+            // Elements of adopted memory are trivially destructible
+            mOwner.reset();
+        } else if (mData) {
             destroyArraySamples(getAllocatorInternal(), mData,
                                 mSize * mTimeSteps);
             traits::deallocate(getAllocatorInternal(), mData,
@@ -438,6 +502,9 @@ private:
     size_type mSize;
     size_type mTimeSteps;
     pointer mData;
+    // Keeps adopted memory alive, null when mData comes from the allocator
+    std::shared_ptr<void> mOwner;
+    size_type mBytesCopied;
 };
 
 } // namespace geom
@@ -21,8 +21,10 @@ namespace internal {
 class BVHHandle {
 public:
 
-    BVHHandle(RTCScene& parentScene, uint32_t geomID):
-        mParentScene(parentScene), mGeomID(geomID) {}
+    // topologyKey identifies the topology and shared buffers the embree
+    // geometry got built with, 0 if the primitive doesn't support refit
+    BVHHandle(RTCScene& parentScene, uint32_t geomID, size_t topologyKey = 0):
+        mParentScene(parentScene), mGeomID(geomID), mTopologyKey(topologyKey) {}
 
     ~BVHHandle() {
         if (mParentScene != nullptr && mGeomID != RTC_INVALID_GEOMETRY_ID) {
@@ -39,11 +41,28 @@ public:
         }
     }
 
+    // Refit the embree geometry BVH to the current content of its vertex
+    // buffers instead of rebuilding it. Only valid when the topology and
+    // the shared buffers are the ones the geometry got created with.
+    void refit(unsigned numVertexBuffers) {
+        if (mParentScene != nullptr && mGeomID != RTC_INVALID_GEOMETRY_ID) {
+            RTCGeometry rtcGeom = rtcGetGeometry(mParentScene, mGeomID);
+            rtcSetGeometryBuildQuality(rtcGeom, RTC_BUILD_QUALITY_REFIT);
+            for (unsigned i = 0; i < numVertexBuffers; ++i) {
+                rtcUpdateGeometryBuffer(rtcGeom, RTC_BUFFER_TYPE_VERTEX, i);
+            }
+            rtcCommitGeometry(rtcGeom);
+        }
+    }
+
     uint32_t getGeomID() const { return mGeomID; }
 
+    size_t getTopologyKey() const { return mTopologyKey; }
+
 private:
     RTCScene mParentScene;
     uint32_t mGeomID;
+    size_t mTopologyKey;
 };
  
 } // namespace internal
@@ -59,6 +59,11 @@ public:
             const shading::PrimitiveAttribute<scene_rdl2::math::Vec3f>& normalAttr =
                 mPrimitiveAttributeTable.getAttribute<scene_rdl2::math::Vec3f>(shading::StandardAttributes::sNormal);
 
+            // Embree reads one normal per vertex. Growing the buffer one normal
+            // at a time would leave up to half of it as unused capacity, which
+            // for dense grooms is a sizeable share of the curves memory.
+            mNormalBuffer.reserve(mVertexBuffer.size());
+
             switch(normalAttr.getRate()) {
             case shading::AttributeRate::RATE_CONSTANT:
                 for (size_t i = 0; i < mVertexBuffer.size(); ++i) {
@@ -224,6 +229,7 @@ public:
         mem += mVertexBuffer.get_memory_usage();
         // get memory for mIndexBuffer;
         mem += scene_rdl2::util::getVectorElementsMemory(mIndexBuffer);
+        mem += scene_rdl2::util::getVectorElementsMemory(mNormalBuffer);
         mem += scene_rdl2::util::getVectorElementsMemory(mCurvesVertexCount);
         return mem;
     }
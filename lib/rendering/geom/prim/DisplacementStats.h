@@ -0,0 +1,36 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file DisplacementStats.h
+///
+
+#pragma once
+
+#include <cstddef>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+/// Displacement stats of a mesh
+struct DisplacementStats {
+    DisplacementStats()
+    {
+        mTime = 0.0;
+        mEvalCount = 0;
+        mReusedCount = 0;
+    }
+    // Wall clock time spent displacing the vertices, in seconds
+    double mTime;
+    // Displacement shader evaluations
+    size_t mEvalCount;
+    // Motion steps which reused the result of the previous step instead
+    // of evaluating the shader again
+    size_t mReusedCount;
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
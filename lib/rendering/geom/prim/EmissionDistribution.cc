@@ -7,6 +7,8 @@
 
 #include "EmissionDistribution.h"
 
+#include <tbb/parallel_for.h>
+
 using namespace scene_rdl2;
 namespace moonray {
 namespace geom {
@@ -140,6 +142,109 @@ DenseEmissionDistribution::pdfDiscrete(const scene_rdl2::math::Vec3i& pos) const
     return mDistribution->pdfDiscrete(pos);
 }
 
+SparseEmissionDistribution::Builder::Builder(const scene_rdl2::math::Vec3i& res) :
+    mBrickRes((res[0] + sBrickDim - 1) >> sBrickLog2Dim,
+              (res[1] + sBrickDim - 1) >> sBrickLog2Dim,
+              (res[2] + sBrickDim - 1) >> sBrickLog2Dim),
+    mBrickIndices(size_t(mBrickRes[0]) * mBrickRes[1] * mBrickRes[2], -1)
+{
+}
+
+void
+SparseEmissionDistribution::Builder::add(const scene_rdl2::math::Vec3i& pos, float value)
+{
+    const scene_rdl2::math::Vec3i brick(pos[0] >> sBrickLog2Dim, pos[1] >> sBrickLog2Dim, pos[2] >> sBrickLog2Dim);
+    int &index = mBrickIndices[(size_t(brick[2]) * mBrickRes[1] + brick[1]) * mBrickRes[0] + brick[0]];
+    if (index < 0) {
+        index = int(mBrickOrigins.size());
+        mBrickOrigins.emplace_back(brick[0] << sBrickLog2Dim, brick[1] << sBrickLog2Dim, brick[2] << sBrickLog2Dim);
+        mValues.resize(mValues.size() + sBrickVoxelCount, 0.0f);
+    }
+    const int voxel = (((pos[2] & (sBrickDim - 1)) << sBrickLog2Dim) + (pos[1] & (sBrickDim - 1))) << sBrickLog2Dim |
+                      (pos[0] & (sBrickDim - 1));
+    mValues[size_t(index) * sBrickVoxelCount + voxel] += value;
+}
+
+SparseEmissionDistribution::SparseEmissionDistribution(const scene_rdl2::math::Vec3i& res,
+        const scene_rdl2::math::Mat4f distToRender[2],
+        float invUnitVolume,
+        const Builder& builder) :
+    EmissionDistribution(res, distToRender, invUnitVolume),
+    mBrickRes(builder.mBrickRes),
+    mBrickIndices(builder.mBrickIndices),
+    mBrickOrigins(builder.mBrickOrigins),
+    mVoxelDistributions(builder.mBrickOrigins.size())
+{
+    const int brickCount = int(mBrickOrigins.size());
+    tbb::parallel_for(0, brickCount, [&](int b) {
+        mVoxelDistributions[b] =
+            Distribution3D::Distribution1D(&builder.mValues[size_t(b) * sBrickVoxelCount], sBrickVoxelCount);
+    });
+
+    // The bricks all have the same voxel count, so their integrals are proportional to their energies.
+    std::vector<float> brickIntegrals(brickCount);
+    double total = 0.0;
+    for (int b = 0; b < brickCount; ++b) {
+        brickIntegrals[b] = mVoxelDistributions[b].mFuncInt;
+        total += double(mVoxelDistributions[b].mFuncInt) * sBrickVoxelCount;
+    }
+    mBrickDistribution = Distribution3D::Distribution1D(brickIntegrals.data(), brickCount);
+    mInvTotal = total > 0.0 ? float(1.0 / total) : 0.0f;
+}
+
+scene_rdl2::math::Vec3f
+SparseEmissionDistribution::sampleDist(float u1, float u2, float u3) const
+{
+    float pdfBrick, pdfVoxel;
+    float u1Remapped, u2Remapped;
+    const int brick = mBrickDistribution.sampleDiscrete(u1, &pdfBrick, &u1Remapped);
+    const int voxel = mVoxelDistributions[brick].sampleDiscrete(u2, &pdfVoxel, &u2Remapped);
+    const scene_rdl2::math::Vec3i& origin = mBrickOrigins[brick];
+    return Vec3f(
+        origin[0] + (voxel & (sBrickDim - 1)) + u1Remapped,
+        origin[1] + ((voxel >> sBrickLog2Dim) & (sBrickDim - 1)) + u2Remapped,
+        origin[2] + (voxel >> (2 * sBrickLog2Dim)) + u3);
+}
+
+void
+SparseEmissionDistribution::sample(const Transform &xform, const Vec3f& p, float u1, float u2, float u3,
+        Vec3f& wi, float& pdfWi, float& tEnd, float time) const
+{
+    const Vec3f pDist = sampleDist(u1, u2, u3);
+    Vec3f pt = mIsMotionBlurOn ? scene_rdl2::math::transformPoint(xform.getDistToRender(time), pDist) :
+                                 scene_rdl2::math::transformPoint(xform.getDistToRender()[0], pDist);
+    wi = normalize(pt - p);
+    pdfWi = pdf(xform, p, wi, tEnd, time);
+}
+
+Vec3f
+SparseEmissionDistribution::sample(const Transform &xform, float u1, float u2, float u3, float time) const
+{
+    const Vec3f pDist = sampleDist(u1, u2, u3);
+    return mIsMotionBlurOn ? scene_rdl2::math::transformPoint(xform.getDistToRender(time), pDist) :
+                             scene_rdl2::math::transformPoint(xform.getDistToRender()[0], pDist);
+}
+
+float
+SparseEmissionDistribution::pdfDiscrete(const scene_rdl2::math::Vec3i& pos) const
+{
+    // out of index boundary
+    if (pos[0] < 0 || pos[0] >= mRes[0] ||
+        pos[1] < 0 || pos[1] >= mRes[1] ||
+        pos[2] < 0 || pos[2] >= mRes[2]) {
+        return 0.0f;
+    }
+    const int index = mBrickIndices[(size_t(pos[2] >> sBrickLog2Dim) * mBrickRes[1] + (pos[1] >> sBrickLog2Dim)) *
+                                    mBrickRes[0] + (pos[0] >> sBrickLog2Dim)];
+    if (index < 0) {
+        return 0.0f;
+    }
+    const int voxel = (((pos[2] & (sBrickDim - 1)) << sBrickLog2Dim) + (pos[1] & (sBrickDim - 1))) << sBrickLog2Dim |
+                      (pos[0] & (sBrickDim - 1));
+    // The product of the brick and voxel pdfs is the voxel's share of the total energy.
+    return mVoxelDistributions[index].mFunc[voxel] * mInvTotal;
+}
+
 } // namespace internal
 } // namespace geom
 } // namespace moonray
@@ -10,6 +10,8 @@
 #include <moonray/rendering/geom/prim/Util.h>
 #include <scene_rdl2/common/math/Mat4.h>
 
+#include <vector>
+
 namespace moonray {
 namespace geom {
 namespace internal {
@@ -137,6 +139,74 @@ private:
     std::unique_ptr<Distribution3D> mDistribution;
 };
 
+// SparseEmissionDistribution only stores the bricks of 8x8x8 voxels which have some emission, the same
+// blocks as the leaf nodes of a VDB tree, so its memory follows the active voxels rather than the bounding
+// box. A brick is picked first from the distribution of the brick energies, then a voxel within it. A coarse
+// grid over the bounding box, one index per brick, finds the brick of a voxel for the pdf.
+
+class SparseEmissionDistribution : public EmissionDistribution
+{
+public:
+    static constexpr int sBrickLog2Dim = 3;
+    static constexpr int sBrickDim = 1 << sBrickLog2Dim;
+    static constexpr int sBrickVoxelCount = sBrickDim * sBrickDim * sBrickDim;
+
+    // Accumulates the voxel values of the bricks before the distribution is built.
+    class Builder
+    {
+    public:
+        explicit Builder(const scene_rdl2::math::Vec3i& res);
+
+        // Adds value to voxel pos, in [0, res)
+        void add(const scene_rdl2::math::Vec3i& pos, float value);
+
+        size_t getBrickCount() const { return mBrickOrigins.size(); }
+
+    private:
+        friend class SparseEmissionDistribution;
+
+        scene_rdl2::math::Vec3i mBrickRes;
+        std::vector<int> mBrickIndices;                     // -1 for the empty bricks
+        std::vector<scene_rdl2::math::Vec3i> mBrickOrigins; // first voxel of each brick
+        std::vector<float> mValues;                         // sBrickVoxelCount values per brick
+    };
+
+    SparseEmissionDistribution(const scene_rdl2::math::Vec3i& res,
+            const scene_rdl2::math::Mat4f distToRender[2],
+            float invUnitVolume,
+            const Builder& builder);
+
+    virtual ~SparseEmissionDistribution() = default;
+
+    virtual int count() const override
+    {
+        return mBrickDistribution.count();
+    }
+
+    // given a shading point p, draw a direction wi based on the emission energy
+    // distribution represented here and return corresponding solid angle pdf
+    // in pdfWi, t interval exiting this emission region in tEnd
+    void sample(const Transform &xform, const scene_rdl2::math::Vec3f& p, float u1, float u2, float u3,
+            Vec3f& wi, float& pdfWi, float& tEnd, float time) const override;
+
+    // sample a position based on emission energy distribution represented here
+    scene_rdl2::math::Vec3f sample(const Transform &xform, float u1, float u2, float u3, float time) const override;
+
+private:
+    // Evaluate the discrete pdf at a point pos
+    float pdfDiscrete(const scene_rdl2::math::Vec3i& pos) const override;
+
+    // Sample a point in distribution space
+    scene_rdl2::math::Vec3f sampleDist(float u1, float u2, float u3) const;
+
+    scene_rdl2::math::Vec3i mBrickRes;
+    std::vector<int> mBrickIndices;
+    std::vector<scene_rdl2::math::Vec3i> mBrickOrigins;
+    Distribution3D::Distribution1D mBrickDistribution;
+    std::vector<Distribution3D::Distribution1D> mVoxelDistributions;
+    float mInvTotal;
+};
+
 } // namespace internal
 } // namespace geom
 } // namespace moonray
@@ -23,6 +23,8 @@ TLState::~TLState()
 void
 TLState::reset()
 {
+    mVolumeShaderCache.clear();
+    mPresenceCache.clear();
 }
 
 std::shared_ptr<TLState>
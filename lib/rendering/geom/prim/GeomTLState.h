@@ -3,8 +3,10 @@
 
 #pragma once
 
+#include <moonray/rendering/geom/prim/PresenceCache.h>
 #include <moonray/rendering/geom/prim/Statistics.h>
 #include <moonray/rendering/geom/prim/VolumeRayState.h>
+#include <moonray/rendering/geom/prim/VolumeShaderCache.h>
 
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 #include <scene_rdl2/scene/rdl2/SceneObject.h>
@@ -44,6 +46,10 @@ public:
             bool okToAllocBundledResources);
 
     VolumeRayState mVolumeRayState;
+    // volume shader results of the current frame, only in use when sized
+    VolumeShaderCache mVolumeShaderCache;
+    // presence of shadow ray hits of the current frame, only in use when sized
+    PresenceCache mPresenceCache;
     const scene_rdl2::rdl2::SceneObject * mSubsurfaceTraceSet;
     Statistics mStatistics;
 
@@ -16,6 +16,11 @@
 #include <openvdb/Grid.h>
 #include <openvdb/tools/Interpolation.h>
 
+#ifdef MOONRAY_USE_NANOVDB
+#include <moonray/rendering/texturing/sampler/NanoVDBSampler.h>
+#include <memory>
+#endif
+
 namespace moonray {
 namespace geom {
 namespace internal {
@@ -104,6 +109,11 @@ struct VDBSampler
     {
         mGrid = grid;
         mIsValid = (mGrid != nullptr) && !mGrid->empty();
+#ifdef MOONRAY_USE_NANOVDB
+        // A single NanoVDB copy of the grid serves all the threads and
+        // volume ids, no per thread accessors are needed.
+        mNanoSampler.reset(mIsValid ? new texture::TypedNanoVDBSampler<GridType>(*mGrid) : nullptr);
+#else
         if (mIsValid) {
             mVolumeIdCount = volumeIds.size();
             for (uint32_t samplerId = 0; samplerId < mVolumeIdCount; ++samplerId) {
@@ -115,6 +125,7 @@ struct VDBSampler
                 mSamplers.emplace_back(*mGrid);
             }
         }
+#endif
 
         mStatsCounterType = statsCounterType;
     }
@@ -126,6 +137,10 @@ struct VDBSampler
     {
         if (mIsValid) {
             tls->mGeomTls->mStatistics.incCounter(mStatsCounterType);
+#ifdef MOONRAY_USE_NANOVDB
+            return mNanoSampler->sample(tls->mThreadIdx, p,
+                                        static_cast<texture::VDBSampler::Interpolation>(mode));
+#else
             uint32_t threadIdx = tls->mThreadIdx;
             unsigned samplerIdx = threadIdx * mVolumeIdCount + (mVolumeIdToSamplerId.at(volumeId));
             switch (mode) {
@@ -142,6 +157,7 @@ struct VDBSampler
                 return mSamplers[samplerIdx].evalPoint(p);
                 break;
             }
+#endif
         }
 
         return ValueT(0.0f);
@@ -153,7 +169,12 @@ struct VDBSampler
         // is shared with other members of the Primitive class, and we
         // count those members instead.
 
+#ifdef MOONRAY_USE_NANOVDB
+        // The NanoVDB grid is a copy owned by this sampler.
+        return mNanoSampler ? mNanoSampler->getMemory() : 0;
+#else
         return scene_rdl2::util::getVectorElementsMemory(mSamplers);
+#endif
     }
 
     GridConstPtr mGrid;
@@ -162,6 +183,9 @@ struct VDBSampler
     std::unordered_map<uint32_t, uint32_t> mVolumeIdToSamplerId;
     unsigned mVolumeIdCount;
     StatCounters mStatsCounterType;
+#ifdef MOONRAY_USE_NANOVDB
+    std::shared_ptr<texture::TypedNanoVDBSampler<GridType>> mNanoSampler;
+#endif
 };
 
 } // namespace internal
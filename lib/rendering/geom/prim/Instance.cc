@@ -275,15 +275,24 @@ Instance::getOccludedFunction() const
 }
 
 BBox3f
-Instance::computeAABB() const
+Instance::computeReferenceBound() const
 {
-    const RTCScene& referenceScene = getReferenceScene();
-    const MotionTransform& local2Parent = getLocal2Parent();
-    RTCBounds refBound;
-    rtcGetSceneBounds(referenceScene, &refBound);
     BBox3f localBound;
+    if (PrimitivePrivateAccess::getDeferredBVHBound(*mReference, localBound)) {
+        return localBound;
+    }
+    RTCBounds refBound;
+    rtcGetSceneBounds(getReferenceScene(), &refBound);
     localBound.lower = Vec3f(refBound.lower_x, refBound.lower_y, refBound.lower_z);
     localBound.upper = Vec3f(refBound.upper_x, refBound.upper_y, refBound.upper_z);
+    return localBound;
+}
+
+BBox3f
+Instance::computeAABB() const
+{
+    const MotionTransform& local2Parent = getLocal2Parent();
+    const BBox3f localBound = computeReferenceBound();
     // Instance with empty source scene (usually due to incorrect user setup)
     // Make it a valid (but meaningless) bounding box so it won't break the
     // partition process during BVH construction
@@ -325,13 +334,8 @@ Instance::computeAABB() const
 BBox3f
 Instance::computeAABBAtTimeStep(int timeStep) const
 {
-    const RTCScene& referenceScene = getReferenceScene();
     const MotionTransform& local2Parent = getLocal2Parent();
-    RTCBounds refBound;
-    rtcGetSceneBounds(referenceScene, &refBound);
-    BBox3f localBound;
-    localBound.lower = Vec3f(refBound.lower_x, refBound.lower_y, refBound.lower_z);
-    localBound.upper = Vec3f(refBound.upper_x, refBound.upper_y, refBound.upper_z);
+    const BBox3f localBound = computeReferenceBound();
     // Instance with empty source scene (usually due to incorrect user setup)
     // Make it a valid (but meaningless) bounding box so it won't break the
     // partition process during BVH construction
@@ -34,6 +34,14 @@ public:
         }
     }
 
+    explicit Instance(const shading::XformSamples& xform,
+            std::shared_ptr<SharedPrimitive> reference,
+            std::unique_ptr<shading::InstanceAttributes> attributes):
+        mLocal2Parent(xform, 0, 0), mReference(reference),
+        mAttributes(std::move(attributes))
+    {
+    }
+
     ~Instance()
     {
         mBVHHandle.reset();
@@ -132,6 +140,10 @@ public:
     static const int sMaxInstanceAttributesDepth = 4;
 
 private:
+    // Bounds of the reference in its own space. Doesn't force the build of a
+    // deferred reference BVH, the bound recorded when it was deferred is used.
+    BBox3f computeReferenceBound() const;
+
     MotionTransform mLocal2Parent;
     std::shared_ptr<SharedPrimitive> mReference;
     std::unique_ptr<shading::InstanceAttributes> mAttributes;
@@ -0,0 +1,145 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file MajorantGrid.cc
+///
+
+#include "MajorantGrid.h"
+
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <algorithm>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+using namespace scene_rdl2::math;
+
+void
+MajorantGrid::build(const openvdb::FloatGrid& grid, int resolution)
+{
+    mMajorants.clear();
+    mGlobalMajorant = 0.0f;
+    mBackground = max(grid.background(), 0.0f);
+
+    openvdb::math::CoordBBox bbox = grid.evalActiveVoxelBoundingBox();
+    if (bbox.empty() || resolution <= 0) {
+        return;
+    }
+    // Pad by the footprint of the widest interpolation kernel so the cells
+    // also cover the lookups just outside the active voxels.
+    bbox.expand(2);
+
+    const openvdb::math::Transform& gridXform = grid.transform();
+    const openvdb::BBoxd aabb = gridXform.indexToWorld(bbox);
+    mBBox = BBox3f(Vec3f(aabb.min().x(), aabb.min().y(), aabb.min().z()),
+                   Vec3f(aabb.max().x(), aabb.max().y(), aabb.max().z()));
+    const Vec3f dim = mBBox.size();
+    const float unitWidth = max(dim.x, max(dim.y, dim.z)) / resolution;
+    if (!(unitWidth > 0.0f)) {
+        return;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        mRes[axis] = clamp(static_cast<int>(ceil(dim[axis] / unitWidth)), 1, resolution);
+        mCellSize[axis] = dim[axis] / mRes[axis];
+        mInvCellSize[axis] = (mCellSize[axis] == 0.0f) ? 0.0f : 1.0f / mCellSize[axis];
+    }
+    mMajorants.assign(size_t(mRes[0]) * mRes[1] * mRes[2], mBackground);
+    mGlobalMajorant = mBackground;
+
+    // Splat the maximum of a block of voxels onto all the cells its padded
+    // world space bounds overlap.
+    auto splat = [&](openvdb::math::CoordBBox indexBBox, float value) {
+        if (value <= mBackground) {
+            return;
+        }
+        mGlobalMajorant = max(mGlobalMajorant, value);
+        indexBBox.expand(2);
+        const openvdb::BBoxd b = gridXform.indexToWorld(indexBBox);
+        int lo[3], hi[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            lo[axis] = clamp(static_cast<int>(floor((b.min()[axis] - mBBox.lower[axis]) * mInvCellSize[axis])),
+                             0, mRes[axis] - 1);
+            hi[axis] = clamp(static_cast<int>(floor((b.max()[axis] - mBBox.lower[axis]) * mInvCellSize[axis])),
+                             0, mRes[axis] - 1);
+        }
+        for (int z = lo[2]; z <= hi[2]; ++z) {
+            for (int y = lo[1]; y <= hi[1]; ++y) {
+                float* row = &mMajorants[(size_t(z) * mRes[1] + y) * mRes[0]];
+                for (int x = lo[0]; x <= hi[0]; ++x) {
+                    row[x] = max(row[x], value);
+                }
+            }
+        }
+    };
+
+    const openvdb::FloatTree& tree = grid.tree();
+    for (auto leaf = tree.cbeginLeaf(); leaf; ++leaf) {
+        float leafMax = -inf;
+        for (auto it = leaf->cbeginValueOn(); it; ++it) {
+            leafMax = max(leafMax, *it);
+        }
+        splat(leaf->getNodeBoundingBox(), leafMax);
+    }
+    // Active tiles of the internal nodes, stop above the leaf level since the
+    // voxels were handled per leaf.
+    openvdb::FloatTree::ValueOnCIter tile = tree.cbeginValueOn();
+    tile.setMaxDepth(openvdb::FloatTree::ValueOnCIter::LEAF_DEPTH - 1);
+    for (; tile; ++tile) {
+        openvdb::math::CoordBBox tileBBox;
+        tile.getBoundingBox(tileBBox);
+        splat(tileBBox, *tile);
+    }
+}
+
+float
+MajorantGrid::lookup(const Vec3f& org, const Vec3f& dir, float t, float& tExit) const
+{
+    MNRY_ASSERT(isValid());
+
+    // Nudges degenerate exit distances forward so callers always make progress.
+    const float tMin = t + sEpsilon * max(1.0f, abs(t));
+
+    const Vec3f p = org + t * dir;
+    if (p.x < mBBox.lower.x || p.x > mBBox.upper.x ||
+        p.y < mBBox.lower.y || p.y > mBBox.upper.y ||
+        p.z < mBBox.lower.z || p.z > mBBox.upper.z) {
+        // Outside the grid only the background is looked up, until the ray
+        // enters the grid, if it ever does.
+        float t0 = t;
+        float t1 = inf;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float invDir = 1.0f / dir[axis];
+            float tNear = (mBBox.lower[axis] - org[axis]) * invDir;
+            float tFar  = (mBBox.upper[axis] - org[axis]) * invDir;
+            if (tNear > tFar) {
+                std::swap(tNear, tFar);
+            }
+            t0 = max(t0, tNear);
+            t1 = min(t1, tFar);
+        }
+        tExit = (t0 <= t1 && t0 > t) ? max(t0, tMin) : inf;
+        return mBackground;
+    }
+
+    int cell[3];
+    tExit = inf;
+    for (int axis = 0; axis < 3; ++axis) {
+        cell[axis] = clamp(static_cast<int>(floor((p[axis] - mBBox.lower[axis]) * mInvCellSize[axis])),
+                           0, mRes[axis] - 1);
+        if (dir[axis] != 0.0f) {
+            const float bound = mBBox.lower[axis] + (cell[axis] + (dir[axis] > 0.0f ? 1 : 0)) * mCellSize[axis];
+            tExit = min(tExit, (bound - org[axis]) / dir[axis]);
+        }
+    }
+    tExit = max(tExit, tMin);
+    return mMajorants[(size_t(cell[2]) * mRes[1] + cell[1]) * mRes[0] + cell[0]];
+}
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,71 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file MajorantGrid.h
+///
+
+#pragma once
+
+#include <moonray/rendering/geom/Types.h>
+
+#include <scene_rdl2/common/math/BBox.h>
+#include <scene_rdl2/render/util/Memory.h>
+
+#include <openvdb/openvdb.h>
+
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// MajorantGrid is a coarse, dense grid storing an upper bound of the values of
+// a density grid in each of its cells. The cells are axis aligned in the world
+// space of the density grid, so the bounds can be looked up along the sample
+// rays of VolumeSampleInfo, which are in that same space. Null scattering
+// estimators (delta/ratio tracking) use the bounds as their majorant and only
+// look the density up at the points of their tentative collisions.
+//
+// Each cell bounds all the voxels whose support overlaps the cell, including
+// the neighbors a lookup may interpolate, as well as the background value, so
+// the bound holds for any interpolation mode and any position in the grid.
+class MajorantGrid
+{
+public:
+    MajorantGrid() : mRes{0, 0, 0}, mGlobalMajorant(0.0f), mBackground(0.0f) {}
+
+    // resolution is the number of cells along the longest axis of the active
+    // voxel bounding box.
+    void build(const openvdb::FloatGrid& grid, int resolution);
+
+    bool isValid() const { return !mMajorants.empty(); }
+
+    // Upper bound of the whole grid.
+    float getGlobalMajorant() const { return mGlobalMajorant; }
+
+    // Upper bound of the grid in the cell containing org + t * dir. tExit is
+    // set to the ray distance where the ray leaves that cell, which is always
+    // past t so a tracking loop is guaranteed to make progress.
+    float lookup(const Vec3f& org, const Vec3f& dir, float t, float& tExit) const;
+
+    // Memory of the cells, not counting the object itself.
+    size_t getMemory() const
+    {
+        return scene_rdl2::util::getVectorElementsMemory(mMajorants);
+    }
+
+private:
+    scene_rdl2::math::BBox3f mBBox;
+    int mRes[3];
+    Vec3f mCellSize;
+    Vec3f mInvCellSize;
+    std::vector<float> mMajorants;
+    float mGlobalMajorant;
+    float mBackground;
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
@@ -120,6 +120,10 @@ public:
 
     virtual size_t getTessellatedMeshFaceCount() const = 0;
 
+    // face count of the input mesh before tessellation, only
+    // meaningful before the mesh gets tessellated
+    virtual size_t getBaseFaceCount() const = 0;
+
     void setIsSingleSided(bool isSingleSided)
     {
         mIsSingleSided = isSingleSided;
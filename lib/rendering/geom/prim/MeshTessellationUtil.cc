@@ -6,6 +6,8 @@
 ///
 
 #include "MeshTessellationUtil.h"
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 namespace moonray {
@@ -192,6 +194,116 @@ SubdTopologyIdLookup::SubdTopologyIdLookup(const int faceVaryingVertexCount,
     }
 }
 
+namespace {
+
+size_t
+estimateQuadFaceCount(int segmentCount0, int segmentCount1,
+        int segmentCount2, int segmentCount3)
+{
+    return static_cast<size_t>(std::max(segmentCount0, segmentCount2)) *
+        static_cast<size_t>(std::max(segmentCount1, segmentCount3));
+}
+
+// The factor counts the vertices inserted on an edge, so the edge is split
+// into (factor + 1) segments
+int
+scaleEdgeFactor(int edgeFactor, float scale)
+{
+    return std::max(0, static_cast<int>((edgeFactor + 1) * scale) - 1);
+}
+
+float
+getBudgetScale(size_t estimatedFaceCount, size_t faceBudget)
+{
+    // face count grows with the square of the edge factors
+    return std::sqrt(static_cast<float>(faceBudget) /
+        static_cast<float>(estimatedFaceCount));
+}
+
+} // anonymous namespace
+
+size_t
+estimateTessellatedFaceCount(
+        const std::vector<PolyTessellationFactor>& tessellationFactors,
+        size_t faceVertexCount)
+{
+    size_t faceCount = 0;
+    for (const PolyTessellationFactor& factor : tessellationFactors) {
+        const auto& f = factor.mEdgeFactor;
+        if (faceVertexCount == sQuadVertexCount) {
+            faceCount += estimateQuadFaceCount(
+                f[0] + 1, f[1] + 1, f[2] + 1, f[3] + 1);
+        } else {
+            size_t n = std::max(f[0], std::max(f[1], f[2])) + 1;
+            faceCount += std::max(size_t(1), 3 * n * n / 4);
+        }
+    }
+    return faceCount;
+}
+
+size_t
+estimateTessellatedFaceCount(
+        const std::vector<SubdTessellationFactor>& tessellationFactors)
+{
+    size_t faceCount = 0;
+    for (const SubdTessellationFactor& factor : tessellationFactors) {
+        const auto& f0 = factor.mEdge0Factor;
+        const auto& f1 = factor.mEdge1Factor;
+        // quads from quadrangulated n-gons leave the second half edge at 0
+        faceCount += estimateQuadFaceCount(
+            f0[0] + f1[0] + 1, f0[1] + f1[1] + 1,
+            f0[2] + f1[2] + 1, f0[3] + f1[3] + 1);
+    }
+    return faceCount;
+}
+
+size_t
+applyTessellationFaceBudget(
+        std::vector<PolyTessellationFactor>& tessellationFactors,
+        size_t faceVertexCount, size_t faceBudget)
+{
+    if (faceBudget == 0) {
+        return 0;
+    }
+    size_t estimatedFaceCount =
+        estimateTessellatedFaceCount(tessellationFactors, faceVertexCount);
+    if (estimatedFaceCount <= faceBudget) {
+        return 0;
+    }
+    float scale = getBudgetScale(estimatedFaceCount, faceBudget);
+    for (PolyTessellationFactor& factor : tessellationFactors) {
+        for (size_t i = 0; i < faceVertexCount; ++i) {
+            factor.mEdgeFactor[i] = scaleEdgeFactor(factor.mEdgeFactor[i], scale);
+        }
+    }
+    size_t budgetFaceCount =
+        estimateTessellatedFaceCount(tessellationFactors, faceVertexCount);
+    return estimatedFaceCount - std::min(budgetFaceCount, estimatedFaceCount);
+}
+
+size_t
+applyTessellationFaceBudget(
+        std::vector<SubdTessellationFactor>& tessellationFactors,
+        size_t faceBudget)
+{
+    if (faceBudget == 0) {
+        return 0;
+    }
+    size_t estimatedFaceCount = estimateTessellatedFaceCount(tessellationFactors);
+    if (estimatedFaceCount <= faceBudget) {
+        return 0;
+    }
+    float scale = getBudgetScale(estimatedFaceCount, faceBudget);
+    for (SubdTessellationFactor& factor : tessellationFactors) {
+        for (size_t i = 0; i < sQuadVertexCount; ++i) {
+            factor.mEdge0Factor[i] = scaleEdgeFactor(factor.mEdge0Factor[i], scale);
+            factor.mEdge1Factor[i] = scaleEdgeFactor(factor.mEdge1Factor[i], scale);
+        }
+    }
+    size_t budgetFaceCount = estimateTessellatedFaceCount(tessellationFactors);
+    return estimatedFaceCount - std::min(budgetFaceCount, estimatedFaceCount);
+}
+
 PolyTessellatedVertexLookup::PolyTessellatedVertexLookup(
         const std::vector<PolyFaceTopology>& faceTopologies,
         const PolyTopologyIdLookup& topologyIdLookup,
@@ -165,6 +165,32 @@ computeEdgeVertexCount(const Vec3f& v0, const Vec3f& v1,
     return edgeVertexCount;
 }
 
+// Rough estimation of the face count the given tessellation factors
+// will generate. faceVertexCount is the vertex count of the polygon mesh
+// base faces (quads or triangles)
+size_t
+estimateTessellatedFaceCount(
+        const std::vector<PolyTessellationFactor>& tessellationFactors,
+        size_t faceVertexCount);
+
+size_t
+estimateTessellatedFaceCount(
+        const std::vector<SubdTessellationFactor>& tessellationFactors);
+
+// Scale down the tessellation factors so the estimated tessellated face count
+// fits into faceBudget (0 means no budget). All factors are scaled with the
+// same ratio so shared edges stay crack free, and faces outside the camera
+// frustum, which already use the coarsest factor, keep it. Returns the
+// estimated number of faces saved.
+size_t
+applyTessellationFaceBudget(
+        std::vector<PolyTessellationFactor>& tessellationFactors,
+        size_t faceVertexCount, size_t faceBudget);
+
+size_t
+applyTessellationFaceBudget(
+        std::vector<SubdTessellationFactor>& tessellationFactors,
+        size_t faceBudget);
 
 // This helper struct stores 3 ids to represent a control edge.
 //   edgeid0  edgeid1
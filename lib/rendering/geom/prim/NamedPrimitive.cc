@@ -121,6 +121,7 @@ NamedPrimitive::resetShadowLinking()
         }
     }
     mShadowLinkings.clear();
+    mHasAnyShadowLinking = false;
     std::unordered_set<int> casterIds;
     getUniqueAssignmentIds(casterIds);
     for (int casterId : casterIds) {
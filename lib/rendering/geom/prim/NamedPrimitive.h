@@ -18,6 +18,9 @@
 #include <moonray/rendering/bvh/shading/Attributes.h>
 #include <moonray/rendering/geom/LayerAssignmentId.h>
 
+#include <unordered_map>
+#include <unordered_set>
+
 namespace moonray {
 namespace geom {
 namespace internal {
@@ -106,6 +109,7 @@ public:
     void createShadowLinking(int casterId, bool complementReceiverSet)
     {
         mShadowLinkings[casterId] = new ShadowLinking(complementReceiverSet);
+        mHasAnyShadowLinking = true;
     }
 
     void addShadowLinkedLight(int casterId, const scene_rdl2::rdl2::Light* light)
@@ -137,6 +141,13 @@ public:
 
     bool hasShadowLinking(const scene_rdl2::rdl2::Layer* layer) const;
 
+    /// Whether any caster of this primitive has a ShadowLinking, i.e. whether
+    /// getShadowLinking() can return anything but nullptr.
+    bool hasAnyShadowLinking() const
+    {
+        return mHasAnyShadowLinking;
+    }
+
     virtual int getIntersectionAssignmentId(int primID) const = 0;
 
 protected:
@@ -207,6 +218,7 @@ protected:
     std::string mName;
     LayerAssignmentId mLayerAssignmentId;
     std::unordered_map<int, ShadowLinking *> mShadowLinkings;
+    bool mHasAnyShadowLinking = false;
 };
 
 } // namespace internal
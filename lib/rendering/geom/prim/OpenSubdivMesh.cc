@@ -6,6 +6,8 @@
 ///
 
 #include "OpenSubdivMesh.h"
+#include "OpenSubdivTopologyCache.h"
+#include "TessellationArena.h"
 
 #include <moonray/rendering/geom/prim/GeomTLState.h>
 #include <moonray/rendering/geom/prim/MeshTessellationUtil.h>
@@ -17,6 +19,7 @@
 #include <moonray/rendering/bvh/shading/State.h>
 #include <moonray/rendering/geom/BakedAttribute.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/common/time/Timer.h>
 
 #include <opensubdiv/far/patchDescriptor.h>
 #include <opensubdiv/far/patchMap.h>
@@ -33,6 +36,8 @@
 
 #include <scene_rdl2/common/math/Vec2.h>
 
+#include <atomic>
+#include <cstring>
 #include <limits>
 #include <numeric>
 
@@ -515,6 +520,54 @@ createTopologyRefiner(const ControlMeshData& controlMeshData,
     return refiner;
 }
 
+// Build the OpenSubdivTopologyCache key for a control mesh. It covers
+// everything createTopologyRefiner() feeds into the refiner along with the
+// refinement and patch table options.
+static void
+appendTopologyCacheKey(const ControlMeshData& controlMeshData,
+        const FaceVaryingAttributes& faceVaryingAttributes,
+        OpenSubdivTopologyCache::Key& key)
+{
+    auto appendFloats = [&key](const float* data, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            int bits;
+            std::memcpy(&bits, &data[i], sizeof(bits));
+            key.push_back(bits);
+        }
+    };
+    auto appendIndices = [&key](const auto& indices) {
+        key.push_back(static_cast<int>(indices.size()));
+        key.insert(key.end(), indices.begin(), indices.end());
+    };
+
+    key.push_back(static_cast<int>(controlMeshData.mScheme));
+    key.push_back(static_cast<int>(controlMeshData.mBoundaryInterpolation));
+    key.push_back(static_cast<int>(controlMeshData.mFVarLinearInterpolation));
+    key.push_back(static_cast<int>(controlMeshData.mVertices.size()));
+    key.push_back(static_cast<int>(controlMeshData.mFaceVertexCount.size()));
+    key.insert(key.end(), controlMeshData.mFaceVertexCount.begin(),
+        controlMeshData.mFaceVertexCount.end());
+    appendIndices(controlMeshData.mIndices);
+
+    if (controlMeshData.mTextureRate == RATE_FACE_VARYING) {
+        key.push_back(static_cast<int>(controlMeshData.mTextureVertices.size()));
+        appendIndices(controlMeshData.mTextureIndices);
+    } else {
+        key.push_back(-1);
+    }
+    for (const auto& fvarKey : faceVaryingAttributes.getAllKeys()) {
+        const auto& attribute = faceVaryingAttributes.getAttributeBuffer(fvarKey);
+        key.push_back(attribute.mChannel);
+        key.push_back(attribute.getVertexCount());
+        appendIndices(attribute.mIndices);
+    }
+
+    appendIndices(controlMeshData.mCreaseIndices);
+    appendFloats(controlMeshData.mCreaseSharpness.data(), controlMeshData.mCreaseSharpness.size());
+    appendIndices(controlMeshData.mCornerIndices);
+    appendFloats(controlMeshData.mCornerSharpness.data(), controlMeshData.mCornerSharpness.size());
+}
+
 // This is the control point OpenSubdiv use to weight sum final limit surface
 // sample point for position data
 struct PatchCV
@@ -1678,19 +1731,19 @@ evalLimitSurface(const OpenSubdiv::Far::PatchTable* patchTable,
         VertexBuffer<Vec3f, InterleavedTraits>& surfaceDpdt,
         std::vector<DisplacementFootprint>& displacementFootprints,
         bool& hasBadDerivatives, bool requireUniformFix,
-        uint motionSampleCount)
+        uint motionSampleCount, TessellationArena* arena)
 {
     // allocate tessellated vertex/index buffer to hold the evaluation result
     size_t tessellatedVertexCount = limitSurfaceSamples.size();
-    tessellatedVertices = SubdivisionMesh::VertexBuffer(
+    tessellatedVertices = allocateTessellatedBuffer<Vec3fa>(arena,
         tessellatedVertexCount, motionSampleCount);
-    surfaceNormal = VertexBuffer<Vec3f, InterleavedTraits>(
+    surfaceNormal = allocateTessellatedBuffer<Vec3f>(arena,
         tessellatedVertexCount, motionSampleCount);
-    surfaceSt = VertexBuffer<Vec2f, InterleavedTraits>(
+    surfaceSt = allocateTessellatedBuffer<Vec2f>(arena,
         tessellatedVertexCount, 1);
-    surfaceDpds = VertexBuffer<Vec3f, InterleavedTraits>(
+    surfaceDpds = allocateTessellatedBuffer<Vec3f>(arena,
         tessellatedVertexCount, motionSampleCount);
-    surfaceDpdt = VertexBuffer<Vec3f, InterleavedTraits>(
+    surfaceDpdt = allocateTessellatedBuffer<Vec3f>(arena,
         tessellatedVertexCount, motionSampleCount);
     displacementFootprints.resize(tessellatedVertexCount);
     bool hasTextureSt = textureRate != RATE_UNKNOWN;
@@ -2092,6 +2145,10 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
     std::vector<SubdTessellationFactor> tessellationFactors =
         computeSubdTessellationFactor(pRdlLayer, tessellationParams.mFrustums,
             tessellationParams.mEnableDisplacement, noTessellation);
+    if (!noTessellation) {
+        stats.mBudgetSavedFaceCount += applyTessellationFaceBudget(
+            tessellationFactors, tessellationParams.mFaceBudget);
+    }
     stats.mMemoryUsed += tessellationFactors.size() * sizeof(SubdTessellationFactor);
 
     // analyze control faces and generate quadTopologies, which are used
@@ -2161,10 +2218,6 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
 
     stats.mMemoryUsed += limitSurfaceSamples.size() * sizeof(LimitSurfaceSample);
 
-    // generate a TopologyRefiner
-    OpenSubdiv::Far::TopologyRefiner* refiner = createTopologyRefiner(
-        *mControlMeshData, *mFaceVaryingAttributes);
-
     bool hasFaceVaryingAttributes =
         mControlMeshData->mTextureRate == RATE_FACE_VARYING ||
         mFaceVaryingAttributes->getAllKeys().size() > 0;
@@ -2207,9 +2260,9 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
     // for face varying primitive attributes and textureSt
     bool requireUniformFix = false;
     bool hasCreaseOrCorner = this->hasSubdCreases() || this->hasSubdCorners();
-    if (mControlMeshData->mScheme != SubdivisionMesh::Scheme::CATMULL_CLARK) {
-        refiner->RefineUniform(
-           OpenSubdiv::Far::TopologyRefiner::UniformOptions(1));
+    bool refineUniform = mControlMeshData->mScheme != SubdivisionMesh::Scheme::CATMULL_CLARK;
+    OpenSubdiv::Far::TopologyRefiner::AdaptiveOptions adaptiveOptions(0);
+    if (refineUniform) {
         requireUniformFix = true;
     } else {
         // determine a suitably accurate depth for feature adaptive refinement
@@ -2227,24 +2280,61 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
         int maxDepth = std::max(tessDepth, creaseDepth);
         int minDepth = std::min(tessDepth, creaseDepth);
 
-        OpenSubdiv::Far::TopologyRefiner::AdaptiveOptions options(maxDepth);
-        options.secondaryLevel = minDepth;
-        options.useInfSharpPatch = hasCreaseOrCorner;
-        options.considerFVarChannels = hasFaceVaryingAttributes;
+        adaptiveOptions = OpenSubdiv::Far::TopologyRefiner::AdaptiveOptions(maxDepth);
+        adaptiveOptions.secondaryLevel = minDepth;
+        adaptiveOptions.useInfSharpPatch = hasCreaseOrCorner;
+        adaptiveOptions.considerFVarChannels = hasFaceVaryingAttributes;
+    }
+
+    // Reuse the refined topology and patch table from a previous tessellation
+    // pass when the topology and refinement options are the same
+    OpenSubdivTopologyCache& topologyCache = OpenSubdivTopologyCache::get();
+    OpenSubdivTopologyCache::Key topologyKey;
+    OpenSubdivTopologyCache::EntryPtr cachedTopology;
+    if (topologyCache.isEnabled()) {
+        appendTopologyCacheKey(*mControlMeshData, *mFaceVaryingAttributes, topologyKey);
+        topologyKey.push_back(refineUniform ? 1 : 0);
+        topologyKey.push_back(refineUniform ? 0 : static_cast<int>(adaptiveOptions.isolationLevel));
+        topologyKey.push_back(refineUniform ? 0 : static_cast<int>(adaptiveOptions.secondaryLevel));
+        topologyKey.push_back(hasCreaseOrCorner ? 1 : 0);
+        topologyKey.push_back(hasFaceVaryingAttributes ? 1 : 0);
+        cachedTopology = topologyCache.find(topologyKey);
+    }
+
+    std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> ownedRefiner;
+    std::unique_ptr<const OpenSubdiv::Far::PatchTable> ownedPatchTable;
+    if (!cachedTopology) {
+        // generate a TopologyRefiner
+        ownedRefiner.reset(createTopologyRefiner(
+            *mControlMeshData, *mFaceVaryingAttributes));
+
+        if (refineUniform) {
+            ownedRefiner->RefineUniform(
+               OpenSubdiv::Far::TopologyRefiner::UniformOptions(1));
+        } else {
+            // adaptively refine the topology with an isolation level
+            ownedRefiner->RefineAdaptive(adaptiveOptions);
+        }
 
-        // adaptively refine the topology with an isolation level
-        refiner->RefineAdaptive(options);
-    }
+        // generate PatchTable that we will use to evaluate the surface limit
+        OpenSubdiv::Far::PatchTableFactory::Options patchOptions;
+        patchOptions.SetEndCapType(
+            OpenSubdiv::Far::PatchTableFactory::Options::ENDCAP_GREGORY_BASIS);
+        patchOptions.generateFVarTables = hasFaceVaryingAttributes;
+        patchOptions.generateFVarLegacyLinearPatches = false;
+        patchOptions.useInfSharpPatch = hasCreaseOrCorner;
+        ownedPatchTable.reset(
+            OpenSubdiv::Far::PatchTableFactory::Create(*ownedRefiner, patchOptions));
 
-    // generate PatchTable that we will use to evaluate the surface limit
-    OpenSubdiv::Far::PatchTableFactory::Options patchOptions;
-    patchOptions.SetEndCapType(
-        OpenSubdiv::Far::PatchTableFactory::Options::ENDCAP_GREGORY_BASIS);
-    patchOptions.generateFVarTables = hasFaceVaryingAttributes;
-    patchOptions.generateFVarLegacyLinearPatches = false;
-    patchOptions.useInfSharpPatch = hasCreaseOrCorner;
-    const OpenSubdiv::Far::PatchTable* patchTable =
-        OpenSubdiv::Far::PatchTableFactory::Create(*refiner, patchOptions);
+        if (topologyCache.isEnabled()) {
+            cachedTopology = topologyCache.insert(std::move(topologyKey),
+                std::move(ownedRefiner), std::move(ownedPatchTable));
+        }
+    }
+    const OpenSubdiv::Far::TopologyRefiner* refiner = cachedTopology ?
+        cachedTopology->mRefiner.get() : ownedRefiner.get();
+    const OpenSubdiv::Far::PatchTable* patchTable = cachedTopology ?
+        cachedTopology->mPatchTable.get() : ownedPatchTable.get();
 
     std::vector<DisplacementFootprint> displacementFootprints;
 
@@ -2265,7 +2355,8 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
         evalLimitSurface(patchTable, limitSurfaceSamples, patchCvs,
             textureCvs, textureRate, mTessellatedVertices, mSurfaceNormal,
             mSurfaceSt, mSurfaceDpds, mSurfaceDpdt, displacementFootprints,
-            hasBadDerivatives, requireUniformFix, motionSampleCount);
+            hasBadDerivatives, requireUniformFix, motionSampleCount,
+            tessellationParams.mArena);
         if (hasBadDerivatives) {
             const scene_rdl2::rdl2::Geometry* pRdlGeometry = getRdlGeometry();
             MNRY_ASSERT(pRdlGeometry != nullptr);
@@ -2311,7 +2402,7 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
         displaceMesh(pRdlLayer, limitSurfaceSamples, displacementFootprints,
             tessellatedVertexLookup, topologyIdLookup.getFaceVaryingSeams(),
             tessellationParams.mFrustums[0],
-            tessellationParams.mWorld2Render);
+            tessellationParams.mWorld2Render, stats.mDisplacement);
     }
 
     // For the baked volume shader grid, we want to set the transform
@@ -2325,9 +2416,6 @@ OpenSubdivMesh::tessellate(const TessellationParams& tessellationParams, Tessell
     if (!tessellationParams.mFastGeomUpdate && !tessellationParams.mIsBaking) {
         mControlMeshData.reset();
     }
-    delete refiner;
-    delete patchTable;
-
     mIsMeshFinalized = true;
 }
 
@@ -3369,8 +3457,11 @@ OpenSubdivMesh::displaceMesh(const scene_rdl2::rdl2::Layer *pRdlLayer,
         const SubdTessellatedVertexLookup& tessellatedVertexLookup,
         const FaceVaryingSeams& faceVaryingSeams,
         const mcrt_common::Frustum& frustum,
-        const scene_rdl2::math::Mat4d& world2render)
+        const scene_rdl2::math::Mat4d& world2render,
+        DisplacementStats& stats)
 {
+    time::RAIITimer<double> displacementTimer(stats.mTime);
+
     size_t motionSampleCount = getMotionSamplesCount();
     size_t tessellatedVertexCount = getTessellatedMeshVertexCount();
 
@@ -3405,10 +3496,14 @@ OpenSubdivMesh::displaceMesh(const scene_rdl2::rdl2::Layer *pRdlLayer,
 
     tbb::blocked_range<size_t> range =
         tbb::blocked_range<size_t>(0, tessellatedVertexCount);
+    std::atomic<size_t> evalCount(0);
+    std::atomic<size_t> reusedCount(0);
     tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
         mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
         shading::TLState *shadingTls = MNRY_VERIFY(tls->mShadingTls.get());
         Intersection isect;
+        size_t rangeEvalCount = 0;
+        size_t rangeReusedCount = 0;
         for (size_t v = r.begin(); v < r.end(); ++v) {
             int assignmentId = limitSurfaceSamples[v].mAssignmentId;
             if (assignmentId == -1) {
@@ -3430,12 +3525,28 @@ OpenSubdivMesh::displaceMesh(const scene_rdl2::rdl2::Layer *pRdlLayer,
             const scene_rdl2::rdl2::Geometry* geometry =
                 pRdlLayer->lookupGeomAndPart(assignmentId).first;
             Vec2f st = mSurfaceSt(v);
+            Vec3f prevPosition, prevNormal, prevDpds, prevDpdt, prevDisplace;
             for (size_t t = 0; t < motionSampleCount; ++t) {
                 Vec3f position = mTessellatedVertices(v, t);
                 Vec3f normal = mSurfaceNormal(v, t);
                 Vec3f dPds = mSurfaceDpds(v, t);
                 Vec3f dPdt = mSurfaceDpdt(v, t);
 
+                // The shader inputs only vary over the motion steps through
+                // the limit surface samples, the st coordinates and primitive
+                // attributes are the same for all of them. Parts of a mesh
+                // which don't move get displaced once.
+                if (t > 0 && position == prevPosition && normal == prevNormal &&
+                    dPds == prevDpds && dPdt == prevDpdt) {
+                    mTessellatedVertices(v, t) += Vec3fa(prevDisplace, 0.f);
+                    ++rangeReusedCount;
+                    continue;
+                }
+                prevPosition = position;
+                prevNormal = normal;
+                prevDpds = dPds;
+                prevDpdt = dPdt;
+
                 if (getIsReference()) {
                     // If this primitive is referenced by another geometry (i.e. instancing)
                     // then these attributes are given to us in local/object space.   Our 
@@ -3457,13 +3568,17 @@ OpenSubdivMesh::displaceMesh(const scene_rdl2::rdl2::Layer *pRdlLayer,
                 fillDisplacementAttributes(vidToFaceId[v], vidToFVIndex[v],
                     isect);
 
-                Vec3f displace;
-                shading::displace(displacement, shadingTls, shading::State(&isect), &displace);
-                mTessellatedVertices(v, t) += Vec3fa(displace, 0.f);
+                shading::displace(displacement, shadingTls, shading::State(&isect), &prevDisplace);
+                mTessellatedVertices(v, t) += Vec3fa(prevDisplace, 0.f);
                 isDisplaced[v] = true;
+                ++rangeEvalCount;
             }
         }
+        evalCount += rangeEvalCount;
+        reusedCount += rangeReusedCount;
     });
+    stats.mEvalCount += evalCount;
+    stats.mReusedCount += reusedCount;
 
     // stitch uv discontinuity area after displacement to avoid crack
     std::vector<std::vector<int>> vertexClusters;
@@ -71,6 +71,11 @@ public:
         return mTessellatedIndices.size() / sQuadVertexCount;
     }
 
+    virtual size_t getBaseFaceCount() const override
+    {
+        return mControlMeshData ? mControlMeshData->mFaceVertexCount.size() : 0;
+    }
+
     virtual size_t getTessellatedMeshVertexCount() const override
     {
         return mTessellatedVertices.size();
@@ -183,7 +188,8 @@ private:
             const SubdTessellatedVertexLookup& tessellatedVertexLookup,
             const FaceVaryingSeams& faceVaryingSeams,
             const mcrt_common::Frustum& frustum,
-            const scene_rdl2::math::Mat4d& world2render);
+            const scene_rdl2::math::Mat4d& world2render,
+            DisplacementStats& stats);
 
     template <typename T>
     T getAttribute(const shading::TypedAttributeKey<T>& key,
@@ -0,0 +1,123 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file OpenSubdivTopologyCache.cc
+///
+
+#include "OpenSubdivTopologyCache.h"
+
+#include <sstream>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+OpenSubdivTopologyCache&
+OpenSubdivTopologyCache::get()
+{
+    static OpenSubdivTopologyCache sCache;
+    return sCache;
+}
+
+void
+OpenSubdivTopologyCache::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    if (!mEnabled) {
+        clear();
+    }
+}
+
+OpenSubdivTopologyCache::EntryPtr
+OpenSubdivTopologyCache::find(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mSlots.find(key);
+    if (it == mSlots.end()) {
+        ++mMissCount;
+        return nullptr;
+    }
+    ++mHitCount;
+    it->second.mLastUsedPass = mPass;
+    return it->second.mEntry;
+}
+
+OpenSubdivTopologyCache::EntryPtr
+OpenSubdivTopologyCache::insert(Key&& key,
+                                std::unique_ptr<OpenSubdiv::Far::TopologyRefiner>&& refiner,
+                                std::unique_ptr<const OpenSubdiv::Far::PatchTable>&& patchTable)
+{
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->mRefiner = std::move(refiner);
+    entry->mPatchTable = std::move(patchTable);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto result = mSlots.emplace(std::move(key), Slot {entry, mPass});
+    result.first->second.mLastUsedPass = mPass;
+    return result.first->second.mEntry;
+}
+
+void
+OpenSubdivTopologyCache::beginPass()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mPass;
+}
+
+void
+OpenSubdivTopologyCache::endPass()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mSlots.begin(); it != mSlots.end();) {
+        if (it->second.mLastUsedPass != mPass) {
+            it = mSlots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void
+OpenSubdivTopologyCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSlots.clear();
+}
+
+size_t
+OpenSubdivTopologyCache::getEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSlots.size();
+}
+
+std::string
+OpenSubdivTopologyCache::show() const
+{
+    std::ostringstream ostr;
+    ostr << "OpenSubdivTopologyCache {\n"
+         << "  enabled:" << (mEnabled ? "true" : "false") << '\n'
+         << "  entries:" << getEntryCount() << '\n'
+         << "  hits:" << mHitCount << '\n'
+         << "  misses:" << mMissCount << '\n'
+         << "}";
+    return ostr.str();
+}
+
+size_t
+OpenSubdivTopologyCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a over the key values
+    size_t hash = 14695981039346656037ULL;
+    for (int v : key) {
+        hash ^= static_cast<size_t>(static_cast<unsigned>(v));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
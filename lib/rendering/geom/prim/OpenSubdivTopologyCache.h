@@ -0,0 +1,94 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file OpenSubdivTopologyCache.h
+///
+
+#pragma once
+
+#include <opensubdiv/far/patchTable.h>
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// OpenSubdivTopologyCache keeps the refined OpenSubdiv TopologyRefiner and
+// PatchTable of subdivision meshes alive between tessellation passes, so a
+// mesh whose topology doesn't change from one frame to the next (deforming
+// characters) skips the topology analysis and only re-evaluates its limit
+// surface. Entries are keyed by the complete topology description plus the
+// refinement options, so a hit is always exact. Entries that were not used
+// during a whole tessellation pass get evicted at the end of that pass.
+// The cache is disabled by default.
+class OpenSubdivTopologyCache
+{
+public:
+    struct Entry
+    {
+        std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> mRefiner;
+        std::unique_ptr<const OpenSubdiv::Far::PatchTable> mPatchTable;
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+    typedef std::vector<int> Key;
+
+    static OpenSubdivTopologyCache& get();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled; }
+
+    // Thread-safe. Returns nullptr if there is no entry for this key.
+    EntryPtr find(const Key& key);
+
+    // Thread-safe. Returns the entry stored for the key, which is the
+    // existing one when another thread inserted the same key first.
+    EntryPtr insert(Key&& key,
+                    std::unique_ptr<OpenSubdiv::Far::TopologyRefiner>&& refiner,
+                    std::unique_ptr<const OpenSubdiv::Far::PatchTable>&& patchTable);
+
+    // Called around each tessellation pass, not thread-safe with find/insert.
+    void beginPass();
+    void endPass();
+
+    void clear();
+
+    size_t getEntryCount() const;
+    size_t getHitCount() const { return mHitCount; }
+    size_t getMissCount() const { return mMissCount; }
+
+    std::string show() const;
+
+private:
+    OpenSubdivTopologyCache() = default;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Slot
+    {
+        EntryPtr mEntry;
+        unsigned mLastUsedPass;
+    };
+
+    bool mEnabled {false};
+    unsigned mPass {0};
+    mutable std::mutex mMutex;
+    std::unordered_map<Key, Slot, KeyHash> mSlots;
+    std::atomic<size_t> mHitCount {0};
+    std::atomic<size_t> mMissCount {0};
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
@@ -199,6 +199,20 @@ Points::postIntersect(mcrt_common::ThreadLocalState& tls,
     }
 }
 
+void
+Points::updateSphereVertices()
+{
+    const size_t pointsCount = mPosition.size();
+    const size_t timeSteps = getMotionSamplesCount();
+    mSphereVertices.resize(pointsCount * timeSteps);
+    for (size_t t = 0; t < timeSteps; ++t) {
+        Vec3fa* vertices = mSphereVertices.data() + t * pointsCount;
+        for (size_t v = 0; v < pointsCount; ++v) {
+            vertices[v] = Vec3fa(mPosition(v, t), mRadius[v]);
+        }
+    }
+}
+
 BBox3f
 Points::computeAABB() const
 {
@@ -11,6 +11,10 @@
 
 #include <moonray/rendering/geom/Points.h>
 
+#include <scene_rdl2/common/math/Vec3fa.h>
+
+#include <vector>
+
 namespace moonray {
 namespace geom {
 namespace internal {
@@ -55,6 +59,7 @@ public:
 
         mem += mPosition.get_memory_usage();
         mem += scene_rdl2::util::getVectorElementsMemory(mRadius);
+        mem += scene_rdl2::util::getVectorElementsMemory(mSphereVertices);
         return  mem;
     }
 
@@ -96,6 +101,21 @@ public:
 
     const shading::PrimitiveAttributeTable* getPrimitiveAttributeTable() const { return &mPrimitiveAttributeTable; }
 
+    // Fills the (x, y, z, radius) vertices of the native embree sphere point
+    // geometry, the points of each motion step one after the other. The user
+    // geometry path does not need them.
+    void updateSphereVertices();
+
+    const scene_rdl2::math::Vec3fa* getSphereVertices(size_t timeStep) const
+    {
+        return mSphereVertices.data() + timeStep * mPosition.size();
+    }
+
+    bool hasSphereVertices() const
+    {
+        return !mSphereVertices.empty();
+    }
+
     void setCurvedMotionBlurSampleCount(uint32_t count)
     {
         mCurvedMotionBlurSampleCount = count;
@@ -115,6 +135,7 @@ private:
     // TODO maybe interleave position and radius? (as Vec3fa buffer)
     geom::Points::VertexBuffer mPosition;
     geom::Points::RadiusBuffer mRadius;
+    std::vector<scene_rdl2::math::Vec3fa> mSphereVertices;
 
 protected:
     shading::PrimitiveAttributeTable mPrimitiveAttributeTable;
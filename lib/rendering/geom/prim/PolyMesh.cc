@@ -18,8 +18,11 @@
 #include <moonray/rendering/bvh/shading/RootShader.h>
 #include <moonray/rendering/bvh/shading/State.h>
 #include <moonray/rendering/geom/BakedAttribute.h>
+#include <moonray/common/time/Timer.h>
 #include <scene_rdl2/common/math/MathUtil.h>
 
+#include <atomic>
+
 namespace moonray {
 namespace geom {
 namespace internal {
@@ -40,7 +43,7 @@ PolyMesh::getMemory() const
     // get memory for vertex buffer
     mem += mVertices.get_memory_usage();
     mem += scene_rdl2::util::getVectorElementsMemory(mTessellatedToBaseFace);
-    mem += scene_rdl2::util::getVectorElementsMemory(mFaceVaryingUv);
+    mem += mFaceVaryingUv.getMemory();
     return mem;
 }
 
@@ -98,6 +101,8 @@ PolyMesh::tessellate(const TessellationParams& tessellationParams, TessellationS
         // resolution (uniform) or camera frustum info (adaptive)
         std::vector<PolyTessellationFactor> tessellationFactors =
             computeTessellationFactor(pRdlLayer, tessellationParams.mFrustums, topologyIdLookup);
+        stats.mBudgetSavedFaceCount += applyTessellationFaceBudget(
+            tessellationFactors, baseFaceVertexCount, tessellationParams.mFaceBudget);
         stats.mMemoryUsed += tessellationFactors.size() * sizeof(PolyTessellationFactor);
 
         std::vector<PolyFaceTopology> faceTopologies =
@@ -131,11 +136,11 @@ PolyMesh::tessellate(const TessellationParams& tessellationParams, TessellationS
         stats.mMemoryUsed += faceVaryingUv.size() * sizeof(Vec2f);
 
         mTessellatedToBaseFace = std::move(tessellatedToBaseFace);
-        mFaceVaryingUv = std::move(faceVaryingUv);
+        mFaceVaryingUv.assign(faceVaryingUv);
 
         // generate tessellated vertex buffer
         PolygonMesh::VertexBuffer tessellatedVertices =
-            generateVertexBuffer(mVertices, mIndices, surfaceSamples);
+            generateVertexBuffer(mVertices, mIndices, surfaceSamples, tessellationParams.mArena);
         stats.mMemoryUsed += tessellatedVertices.size() * sizeof(Vec3fa);
 
         mBaseIndices = std::move(mIndices);
@@ -148,7 +153,7 @@ PolyMesh::tessellate(const TessellationParams& tessellationParams, TessellationS
     initAttributesAndDisplace(pRdlLayer, baseFaceCount,
         baseVertexCount, tessellationParams.mEnableDisplacement,
         tessellationParams.mFastGeomUpdate, tessellationParams.mIsBaking,
-        tessellationParams.mWorld2Render);
+        tessellationParams.mWorld2Render, stats.mDisplacement);
 
     // reverse normals reverses orientation and negates normals
     if (mIsNormalReversed ^ mIsOrientationReversed) {
@@ -860,7 +865,8 @@ void
 PolyMesh::initAttributesAndDisplace(const scene_rdl2::rdl2::Layer *pRdlLayer,
         size_t baseFaceCount, size_t varyingsCount, bool enableDisplacement,
         bool realtimeMode, bool isBaking,
-        const scene_rdl2::math::Mat4d& world2render)
+        const scene_rdl2::math::Mat4d& world2render,
+        DisplacementStats& displacementStats)
 {
     auto& primitiveAttributeTable = mPolyMeshData->mPrimitiveAttributeTable;
     MeshIndexType baseFaceType = getBaseFaceType();
@@ -918,7 +924,7 @@ PolyMesh::initAttributesAndDisplace(const scene_rdl2::rdl2::Layer *pRdlLayer,
     }
 
     if (hasDisplacement) {
-        displaceMesh(pRdlLayer, world2render);
+        displaceMesh(pRdlLayer, world2render, displacementStats);
     }
     // if it's not real time mode, we don't need the smooth normal utility
     // after shading normal computation is done
@@ -935,8 +941,11 @@ PolyMesh::initAttributesAndDisplace(const scene_rdl2::rdl2::Layer *pRdlLayer,
 
 void
 PolyMesh::displaceMesh(const scene_rdl2::rdl2::Layer* pRdlLayer,
-                       const scene_rdl2::math::Mat4d& world2render)
+                       const scene_rdl2::math::Mat4d& world2render,
+                       DisplacementStats& stats)
 {
+    time::RAIITimer<double> displacementTimer(stats.mTime);
+
     struct VertexToDisplace {
         VertexToDisplace(): mAssignmentId(-1), mFaceId(0), mVIndex(0)
         {}
@@ -975,10 +984,14 @@ PolyMesh::displaceMesh(const scene_rdl2::rdl2::Layer* pRdlLayer,
     tbb::blocked_range<size_t> range =
         tbb::blocked_range<size_t>(0, vertexCount);
 
+    std::atomic<size_t> evalCount(0);
+    std::atomic<size_t> reusedCount(0);
     tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
         mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
         shading::TLState *shadingTls = MNRY_VERIFY(tls->mShadingTls.get());
         Intersection isect;
+        size_t rangeEvalCount = 0;
+        size_t rangeReusedCount = 0;
         for (size_t v = r.begin(); v < r.end(); ++v) {
             int assignmentId = toDisplace[v].mAssignmentId;
             if (assignmentId == -1) {
@@ -1008,6 +1021,20 @@ PolyMesh::displaceMesh(const scene_rdl2::rdl2::Layer* pRdlLayer,
                 vid, vid1, vid2, vid3, st, st1, st2, st3);
 
             for (size_t t = 0; t < motionSampleCount; ++t) {
+                // The shader inputs only vary over the motion steps through
+                // the vertex positions, the st coordinates and primitive
+                // attributes are the same for all of them. Parts of a mesh
+                // which don't move get displaced once.
+                if (t > 0 &&
+                    Vec3f(mVertices(vid, t)) == Vec3f(mVertices(vid, t - 1)) &&
+                    Vec3f(mVertices(vid1, t)) == Vec3f(mVertices(vid1, t - 1)) &&
+                    Vec3f(mVertices(vid2, t)) == Vec3f(mVertices(vid2, t - 1)) &&
+                    Vec3f(mVertices(vid3, t)) == Vec3f(mVertices(vid3, t - 1))) {
+                    displacementResult(vid, t) = displacementResult(vid, t - 1);
+                    ++rangeReusedCount;
+                    continue;
+                }
+
                 Vec3f position = mVertices(vid, t);
                 Vec3f p1 = mVertices(vid1, t);
                 Vec3f p2 = mVertices(vid2, t);
@@ -1052,9 +1079,14 @@ PolyMesh::displaceMesh(const scene_rdl2::rdl2::Layer* pRdlLayer,
                 // otherwise it will cause wrong dpds/dpdt calculation since
                 // displacement shaders expect pre-displaced dpds/dpdt values
                 displacementResult(vid, t) = Vec3fa(displace, 0.f);
+                ++rangeEvalCount;
             }
         }
+        evalCount += rangeEvalCount;
+        reusedCount += rangeReusedCount;
     });
+    stats.mEvalCount += evalCount;
+    stats.mReusedCount += reusedCount;
     // now add the displacement result back to vertex buffer
     tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
         for (size_t v = r.begin(); v < r.end(); ++v) {
@@ -9,6 +9,7 @@
 
 #include <moonray/rendering/geom/prim/Mesh.h>
 #include <moonray/rendering/geom/prim/PolyMeshCalcNv.h>
+#include <moonray/rendering/geom/prim/QuantizedUvBuffer.h>
 
 #include <moonray/rendering/bvh/shading/AttributeKey.h>
 #include <moonray/rendering/bvh/shading/Attributes.h>
@@ -86,6 +87,11 @@ public:
 
     virtual size_t getTessellatedMeshFaceCount() const override;
 
+    virtual size_t getBaseFaceCount() const override
+    {
+        return mPolyMeshData ? mPolyMeshData->mEstiFaceCount : 0;
+    }
+
     virtual void getTessellatedMesh(TessellatedMesh& tessMesh) const override;
 
     virtual void getBakedMesh(BakedMesh &bakedMesh) const override;
@@ -219,7 +225,8 @@ protected:
     virtual PolygonMesh::VertexBuffer generateVertexBuffer(
             const PolygonMesh::VertexBuffer& baseVertices,
             const PolygonMesh::IndexBuffer& baseIndices,
-            const std::vector<PolyMesh::SurfaceSample>& surfaceSamples) const = 0;
+            const std::vector<PolyMesh::SurfaceSample>& surfaceSamples,
+            TessellationArena* arena) const = 0;
 
     // whether we should tessellate the input mesh
     bool shouldTessellate(bool enableDisplacement, const scene_rdl2::rdl2::Layer *pRdlLayer) const;
@@ -235,7 +242,8 @@ protected:
     void initAttributesAndDisplace(const scene_rdl2::rdl2::Layer *pRdlLayer,
             size_t baseFaceCount, size_t varyingsCount, bool enableDisplacement,
             bool realtimeMode, bool isBaking,
-            const scene_rdl2::math::Mat4d& world2render);
+            const scene_rdl2::math::Mat4d& world2render,
+            DisplacementStats& displacementStats);
 
     template <typename T> T
     getFaceVaryingAttribute(shading::TypedAttributeKey<T> key, int fid, int vIndex,
@@ -277,7 +285,8 @@ protected:
     }
 
     void displaceMesh(const scene_rdl2::rdl2::Layer *pRdlLayer,
-                      const scene_rdl2::math::Mat4d& world2render);
+                      const scene_rdl2::math::Mat4d& world2render,
+                      DisplacementStats& stats);
 
     // helper for displaceMesh to query:
     // for a tessellated vertex with face id tessFaceId and
@@ -304,8 +313,8 @@ protected:
     // mapping from tessellated face id to base mesh face id
     std::vector<int> mTessellatedToBaseFace;
     // mapping from tessellated vertices to base mesh face surface uv
-    // use this for varying/facevarying interpolation
-    std::vector<Vec2f> mFaceVaryingUv;
+    // use this for varying/facevarying interpolation, stored as 16 bit values
+    QuantizedUvBuffer mFaceVaryingUv;
     // whether the mesh is tessellated for displacement
     bool mIsTessellated;
     // utilities for calculating smooth normal
@@ -0,0 +1,160 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file PresenceCache.h
+///
+
+#pragma once
+
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+#include <scene_rdl2/render/util/Memory.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// PresenceCache keeps the material presence values the shadow rays of one
+// thread evaluated, so later shadow rays crossing the same region of a
+// surface, typically the leaves of a tree, skip the intersection setup and
+// the presence shader. It bakes the presence lazily into a grid of cells over
+// the (u, v) parameterization of each primitive: entries are keyed by layer
+// assignment, instance, primitive and the cell the hit falls into, which turns
+// the presence into a piecewise constant function at the cell size. Only
+// presence which depends on the surface parameterization alone, such as a
+// texture mapped cutout, is reproduced faithfully.
+//
+// The cache is set associative: a key can only go into the few entries of the
+// set it hashes to, and the least recently used entry of the set is evicted
+// on a miss. Lookups never allocate.
+class PresenceCache
+{
+public:
+    PresenceCache() : mCellResolution(0.0f), mSetMask(0), mClock(0) {}
+
+    // The capacity is rounded up to a power of two number of sets, 0 disables
+    // the cache. cellResolution is the number of cells along u and v of each
+    // primitive. Drops the cached values.
+    void setCapacity(size_t capacity, unsigned cellResolution)
+    {
+        mEntries.clear();
+        mSetMask = 0;
+        mCellResolution = static_cast<float>(scene_rdl2::math::max(cellResolution, 1u));
+        if (capacity == 0) {
+            return;
+        }
+        size_t numSets = 1;
+        while (numSets * sWays < capacity) {
+            numSets <<= 1;
+        }
+        mEntries.resize(numSets * sWays);
+        mEntries.shrink_to_fit();
+        mSetMask = numSets - 1;
+        clear();
+    }
+
+    bool isEnabled() const { return !mEntries.empty(); }
+
+    void clear()
+    {
+        for (Entry& entry : mEntries) {
+            entry.mLastUse = 0;
+        }
+        mClock = 0;
+    }
+
+    // Returns the presence of the cell the hit at (u, v) falls into. hit
+    // tells whether it holds the value of that cell, otherwise the entry was
+    // claimed for the cell and the caller is expected to fill it.
+    float* lookup(int assignmentId, const void* instance, int geomId, int primId, int instId,
+                  float u, float v, bool& hit)
+    {
+        MNRY_ASSERT(isEnabled());
+
+        const Key key = { instance, assignmentId, geomId, primId, instId, toCell(u), toCell(v) };
+
+        Entry* set = &mEntries[(hash(key) & mSetMask) * sWays];
+        Entry* victim = set;
+        ++mClock;
+        for (int i = 0; i < sWays; ++i) {
+            Entry& entry = set[i];
+            if (entry.mLastUse != 0 && entry.mKey == key) {
+                entry.mLastUse = mClock;
+                hit = true;
+                return &entry.mPresence;
+            }
+            if (entry.mLastUse < victim->mLastUse) {
+                victim = &entry;
+            }
+        }
+
+        victim->mKey = key;
+        victim->mLastUse = mClock;
+        hit = false;
+        return &victim->mPresence;
+    }
+
+    size_t getMemory() const
+    {
+        return scene_rdl2::util::getVectorElementsMemory(mEntries);
+    }
+
+private:
+    static constexpr int sWays = 4;
+
+    struct Key
+    {
+        const void* mInstance;
+        int32_t mAssignmentId;
+        int32_t mGeomId, mPrimId, mInstId;
+        int32_t mU, mV;
+
+        bool operator==(const Key& other) const
+        {
+            return mInstance == other.mInstance && mAssignmentId == other.mAssignmentId &&
+                   mGeomId == other.mGeomId && mPrimId == other.mPrimId && mInstId == other.mInstId &&
+                   mU == other.mU && mV == other.mV;
+        }
+    };
+
+    struct Entry
+    {
+        Key mKey;
+        // 0 marks an empty entry
+        uint64_t mLastUse;
+        float mPresence;
+    };
+
+    int32_t toCell(float x) const
+    {
+        // barycentric coordinates stay within [0, 1], the clamp only guards
+        // against primitives with other parameterizations
+        return static_cast<int32_t>(scene_rdl2::math::clamp(scene_rdl2::math::floor(x * mCellResolution),
+                                                            -2.0e9f, 2.0e9f));
+    }
+
+    static uint32_t hash(const Key& key)
+    {
+        const uint64_t p = reinterpret_cast<uintptr_t>(key.mInstance);
+        uint32_t h = uint32_t(key.mPrimId) * 2654435761u ^ uint32_t(key.mGeomId) * 73856093u ^
+                     uint32_t(key.mInstId) * 19349663u ^ uint32_t(key.mU) * 83492791u ^
+                     uint32_t(key.mV) * 40503u ^ uint32_t(key.mAssignmentId) * 97u ^
+                     uint32_t(p >> 4) ^ uint32_t(p >> 32);
+        h ^= h >> 16;
+        return h;
+    }
+
+    std::vector<Entry> mEntries;
+    float mCellResolution;
+    size_t mSetMask;
+    uint64_t mClock;
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
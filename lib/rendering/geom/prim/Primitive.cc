@@ -236,11 +236,44 @@ Primitive::bakeVolumeShaderDensityMap(const scene_rdl2::rdl2::VolumeShader* volu
     });
 
     mBakedDensityGrid->pruneGrid();
+    computeBakedDensityMajorant();
     mBakedDensitySampler.initialize(mBakedDensityGrid,
                                     volumeIds,
                                     STATS_BAKED_DENSITY_GRID_SAMPLES);
 }
 
+void
+Primitive::computeBakedDensityMajorant()
+{
+    MNRY_ASSERT(mBakedDensityGrid);
+    // Inactive lookups return the background.
+    const openvdb::Vec3f background = mBakedDensityGrid->background();
+    mBakedDensityMajorant = scene_rdl2::math::max(
+        scene_rdl2::math::max(background.x(), background.y(), background.z()), 0.0f);
+    for (auto it = mBakedDensityGrid->cbeginValueOn(); it; ++it) {
+        const openvdb::Vec3f v = *it;
+        mBakedDensityMajorant = scene_rdl2::math::max(mBakedDensityMajorant,
+                                                      scene_rdl2::math::max(v.x(), v.y(), v.z()));
+    }
+}
+
+float
+Primitive::getBakedDensityMajorant() const
+{
+    if (mBakedDensitySampler.mIsValid) {
+        return mBakedDensityMajorant;
+    }
+    return scene_rdl2::math::max(scene_rdl2::math::max(mDensityColor.r, mDensityColor.g, mDensityColor.b), 0.0f);
+}
+
+float
+Primitive::getDensityMajorant(const Vec3f& /*org*/, const Vec3f& /*dir*/, float /*t*/, float& tExit) const
+{
+    tExit = scene_rdl2::math::inf;
+    // Without a baked grid the density comes from the volume shader.
+    return mBakedDensitySampler.mIsValid ? mBakedDensityMajorant : scene_rdl2::math::inf;
+}
+
  scene_rdl2::math::Vec3f
  Primitive::evalVolumeSamplePosition(mcrt_common::ThreadLocalState* tls,
                                      uint32_t volumeId,
@@ -13,6 +13,7 @@
 
 #include <moonray/rendering/geom/Types.h>
 #include <moonray/rendering/geom/prim/BVHHandle.h>
+#include <moonray/rendering/geom/prim/DisplacementStats.h>
 #include <moonray/rendering/geom/prim/EmissionDistribution.h>
 #include <moonray/rendering/geom/prim/GridSampler.h>
 #include <moonray/rendering/geom/prim/VDBVelocity.h>
@@ -53,6 +54,7 @@ struct MotionBlurParams;
 
 namespace internal {
 
+class TessellationArena;
 class VolumeAssignmentTable;
 class VolumeSampleInfo;
 
@@ -64,13 +66,17 @@ struct TessellationParams {
         bool enableDisplacement,
         bool fastGeomUpdate,
         bool isBaking,
-        const VolumeAssignmentTable* volumeAssignmentTable) :
+        const VolumeAssignmentTable* volumeAssignmentTable,
+        size_t faceBudget = 0,
+        TessellationArena* arena = nullptr) :
             mRdlLayer(rdlLayer), mFrustums(frustums),
             mWorld2Render(world2render),
             mEnableDisplacement(enableDisplacement),
             mFastGeomUpdate(fastGeomUpdate),
             mIsBaking(isBaking),
-            mVolumeAssignmentTable(volumeAssignmentTable) {}
+            mVolumeAssignmentTable(volumeAssignmentTable),
+            mFaceBudget(faceBudget),
+            mArena(arena) {}
 
     const scene_rdl2::rdl2::Layer *mRdlLayer;
     const std::vector<mcrt_common::Frustum>& mFrustums;
@@ -79,6 +85,11 @@ struct TessellationParams {
     bool mFastGeomUpdate;
     bool mIsBaking;
     const VolumeAssignmentTable* mVolumeAssignmentTable;
+    // Upper bound of tessellated faces for this primitive, 0 means unlimited
+    size_t mFaceBudget;
+    // Where the tessellated vertex buffers are carved out from, nullptr
+    // to allocate each of them on its own
+    TessellationArena* mArena;
 };
 
 /// Tessellation stats
@@ -86,11 +97,16 @@ struct TessellationStats {
     TessellationStats()
     {
         mMemoryUsed = 0;
+        mBudgetSavedFaceCount = 0;
     }
     // Approximate temporary memory used for tessellation.  Doesn't need to be exact,
     // it's only meant to identify the worst offenders when parallel tessellation
     // runs out of system memory.
     size_t mMemoryUsed;
+    // Estimated tessellated faces that were not generated because of
+    // TessellationParams::mFaceBudget
+    size_t mBudgetSavedFaceCount;
+    DisplacementStats mDisplacement;
 };
 
 /// @brief A Primitive is the actual geometry to be rendered.
@@ -108,7 +124,8 @@ public:
     /// A Primitive stores a geometry primitive to be rendered. The Procedural
     /// creating the primitive must construct / update it passing vertex "P"
     /// and "N" defined in local-space(local space of the primitive).
-    Primitive() : mRdlGeometry(nullptr), mIsReference(false), mFeatureSize(1.0f), mDensityColor(1.0f)
+    Primitive() : mRdlGeometry(nullptr), mIsReference(false), mFeatureSize(1.0f), mDensityColor(1.0f),
+        mBakedDensityMajorant(0.0f)
     {
         // VDBVelocity stores shutter open and close data, an openvdb velocity grid,
         // and openvdb velocity samplers. It is needed for motion blur when the primitive
@@ -253,6 +270,20 @@ public:
         mBVHHandle->update();
     }
 
+    /// Refit BVH side representation after this primitive got deformed
+    /// without any topology change
+    void refitBVHHandle(unsigned numVertexBuffers)
+    {
+        MNRY_ASSERT_REQUIRE(isBVHInitialized());
+        mBVHHandle->refit(numVertexBuffers);
+    }
+
+    /// Query the topology key the BVH side representation got built with
+    size_t getBVHTopologyKey() const
+    {
+        return mBVHHandle->getTopologyKey();
+    }
+
     /// Query the geometry ID in BVH for this primitive
     uint32_t getGeomID() const
     {
@@ -347,6 +378,13 @@ public:
                                     const float rayVolumeDepth,
                                     const scene_rdl2::rdl2::VolumeShader* const volumeShader) const;
 
+    // Upper bound of the density evalDensity() returns along the ray org + t * dir,
+    // where org and dir are the sample ray of the VolumeSampleInfo. The bound holds
+    // from t up to tExit, past which it has to be queried again. Returns infinity
+    // when the primitive can't bound its density, e.g. when the density is
+    // evaluated from the volume shader at render time.
+    virtual float getDensityMajorant(const Vec3f& org, const Vec3f& dir, float t, float& tExit) const;
+
     // Performs voxel value lookup. VdbVolume can have voxel grids for extinction,
     // albedo, and temperature. Meshes have voxel grids only for extinction.
     virtual void evalVolumeCoefficients(mcrt_common::ThreadLocalState* tls,
@@ -381,9 +419,15 @@ protected:
     // This corresponds to the voxel size of a VDB grid.
     float mFeatureSize;
 
+    // Largest channel of mBakedDensityGrid, or of mDensityColor when there
+    // is no baked grid.
+    float getBakedDensityMajorant() const;
+    void computeBakedDensityMajorant();
+
     VDBSampler<openvdb::Vec3SGrid> mBakedDensitySampler;
     openvdb::Vec3SGrid::Ptr mBakedDensityGrid;
     scene_rdl2::math::Color mDensityColor;
+    float mBakedDensityMajorant;
 
     // velocity field used for advection based motion blur
     std::unique_ptr<VDBVelocity> mVdbVelocity;
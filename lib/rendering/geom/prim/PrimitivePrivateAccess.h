@@ -37,6 +37,15 @@ public:
         return handle.getBVHScene();
     }
 
+    static void setDeferredBVHScene(geom::SharedPrimitive& handle,
+            std::function<void*()>&& buildScene, const BBox3f& localBound) {
+        handle.setDeferredBVHScene(std::move(buildScene), localBound);
+    }
+
+    static bool getDeferredBVHBound(const geom::SharedPrimitive& handle, BBox3f& localBound) {
+        return handle.getDeferredBVHBound(localBound);
+    }
+
     static void transformToReference(geom::Procedural* handle) {
         handle->transformToReference();
     }
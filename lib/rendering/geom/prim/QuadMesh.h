@@ -81,7 +81,8 @@ private:
     virtual PolygonMesh::VertexBuffer generateVertexBuffer(
             const PolygonMesh::VertexBuffer& baseVertices,
             const PolygonMesh::IndexBuffer& baseIndices,
-            const std::vector<PolyMesh::SurfaceSample>& surfaceSamples) const override;
+            const std::vector<PolyMesh::SurfaceSample>& surfaceSamples,
+            TessellationArena* arena) const override;
 
     virtual void fillDisplacementAttributes(int tessFaceId, int vIndex,
             shading::Intersection& intersection) const override;
@@ -0,0 +1,75 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file QuantizedUvBuffer.h
+///
+
+#pragma once
+
+#include <moonray/rendering/geom/Types.h>
+
+#include <scene_rdl2/render/util/Memory.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// QuantizedUvBuffer stores uv coordinates in [0, 1] as pairs of 16 bit
+// unsigned normalized integers, half the size of Vec2f. It is used for the
+// per face vertex surface uv that tessellated meshes keep to map each
+// tessellated vertex back onto its base face. The 1 / 65535 precision is far
+// below what the interpolation of face varying attributes can resolve.
+class QuantizedUvBuffer
+{
+public:
+    void assign(const std::vector<Vec2f>& uvs)
+    {
+        mData.resize(2 * uvs.size());
+        for (size_t i = 0; i < uvs.size(); ++i) {
+            mData[2 * i    ] = encode(uvs[i].x);
+            mData[2 * i + 1] = encode(uvs[i].y);
+        }
+        mData.shrink_to_fit();
+    }
+
+    Vec2f operator[](size_t i) const
+    {
+        return Vec2f(decode(mData[2 * i]), decode(mData[2 * i + 1]));
+    }
+
+    size_t size() const { return mData.size() / 2; }
+
+    bool empty() const { return mData.empty(); }
+
+    void clear() { mData.clear(); }
+
+    size_t getMemory() const
+    {
+        return scene_rdl2::util::getVectorElementsMemory(mData);
+    }
+
+private:
+    static constexpr float sScale = 65535.0f;
+
+    static uint16_t encode(float x)
+    {
+        x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+        return static_cast<uint16_t>(x * sScale + 0.5f);
+    }
+
+    static float decode(uint16_t q)
+    {
+        return static_cast<float>(q) * (1.0f / sScale);
+    }
+
+    std::vector<uint16_t> mData;
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
@@ -9,7 +9,10 @@
 #pragma once
 
 #include <scene_rdl2/scene/rdl2/Light.h>
-#include <unordered_set>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 namespace moonray {
 namespace geom {
@@ -23,6 +26,10 @@ namespace internal {
 //  - whether it will cast a shadow onto specific receivers
 // 
 // This feature is provided purely for artistic control and is obviously not physically correct.
+//
+// The lights and receivers are kept in compact forms for the per-hit queries made inside Embree traversal:
+// the lights in a sorted vector searched with a binary search, the receivers (layer assignment ids) in a
+// bitset over the range of ids added.
 
 class ShadowLinking
 {
@@ -32,42 +39,68 @@ public:
 
     void reset()
     {
-        mLightSet.clear();
-        mReceiverSet.clear();
+        mLights.clear();
+        mReceivers.clear();
+        mReceiverBits.clear();
+        mReceiverBase = 0;
     }
 
     bool canCastShadow(const scene_rdl2::rdl2::Light* light) const
     {
-        return mLightSet.find(light) == mLightSet.end();
+        return mLights.empty() || !std::binary_search(mLights.begin(), mLights.end(), light);
     }
 
     void addLight(const scene_rdl2::rdl2::Light* light)
     {
-        mLightSet.insert(light);
+        auto it = std::lower_bound(mLights.begin(), mLights.end(), light);
+        if (it == mLights.end() || *it != light) {
+            mLights.insert(it, light);
+        }
     }
 
-    const std::unordered_set<const scene_rdl2::rdl2::Light*>& getLights() const
+    // Sorted by address
+    const std::vector<const scene_rdl2::rdl2::Light*>& getLights() const
     {
-        return mLightSet;
+        return mLights;
     }
 
     bool canReceiveShadow(int receiverId) const
     {
         if (mIsComplemented) {
-            return mReceiverSet.find(receiverId) != mReceiverSet.end();
+            return hasReceiver(receiverId);
         } else {
-            return mReceiverSet.find(receiverId) == mReceiverSet.end();
+            return !hasReceiver(receiverId);
         }
     }
 
     void addReceiver(int receiverID)
     {
-        mReceiverSet.insert(receiverID);
+        auto it = std::lower_bound(mReceivers.begin(), mReceivers.end(), receiverID);
+        if (it != mReceivers.end() && *it == receiverID) {
+            return;
+        }
+        mReceivers.insert(it, receiverID);
+
+        if (mReceiverBits.empty() || receiverID < mReceiverBase) {
+            // the range starts lower, rebuild the bits from the sorted ids
+            mReceiverBase = mReceivers.front();
+            mReceiverBits.assign(((mReceivers.back() - mReceiverBase) >> 6) + 1, 0);
+            for (int id : mReceivers) {
+                setReceiverBit(id);
+            }
+            return;
+        }
+        const size_t word = size_t(receiverID - mReceiverBase) >> 6;
+        if (word >= mReceiverBits.size()) {
+            mReceiverBits.resize(word + 1, 0);
+        }
+        setReceiverBit(receiverID);
     }
 
-    const std::unordered_set<int>& getReceivers() const
+    // Sorted by id
+    const std::vector<int>& getReceivers() const
     {
-        return mReceiverSet;
+        return mReceivers;
     }
 
     bool getIsComplemented() const
@@ -76,9 +109,27 @@ public:
     }
 
 private:
-    std::unordered_set<const scene_rdl2::rdl2::Light*> mLightSet;
-    std::unordered_set<int> mReceiverSet;
-    bool mIsComplemented;
+    bool hasReceiver(int receiverId) const
+    {
+        if (receiverId < mReceiverBase) {
+            return false;
+        }
+        const size_t bit = size_t(receiverId - mReceiverBase);
+        const size_t word = bit >> 6;
+        return word < mReceiverBits.size() && (mReceiverBits[word] >> (bit & 63)) & 1;
+    }
+
+    void setReceiverBit(int receiverId)
+    {
+        const size_t bit = size_t(receiverId - mReceiverBase);
+        mReceiverBits[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+
+    std::vector<const scene_rdl2::rdl2::Light*> mLights;
+    std::vector<int> mReceivers;
+    std::vector<uint64_t> mReceiverBits;    // bit i is receiver mReceiverBase + i
+    int mReceiverBase = 0;
+    bool mIsComplemented = false;
 };
 
 } // namespace internal
@@ -22,6 +22,10 @@ enum StatCounters
     STATS_EMISSION_GRID_SAMPLES,
     STATS_COLOR_GRID_SAMPLES,
     STATS_BAKED_DENSITY_GRID_SAMPLES,
+    STATS_VOLUME_SHADER_CACHE_HITS,
+    STATS_VOLUME_SHADER_CACHE_MISSES,
+    STATS_PRESENCE_CACHE_HITS,
+    STATS_PRESENCE_CACHE_MISSES,
     NUM_STATS_COUNTERS
 };
 
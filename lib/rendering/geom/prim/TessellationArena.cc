@@ -0,0 +1,148 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TessellationArena.cc
+///
+
+#include "TessellationArena.h"
+
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <algorithm>
+#include <new>
+#include <sstream>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+namespace {
+
+size_t
+roundUpToHugePages(size_t size)
+{
+    return (size + mcrt_common::HUGE_PAGE_SIZE - 1) & ~(mcrt_common::HUGE_PAGE_SIZE - 1);
+}
+
+} // namespace
+
+struct TessellationArena::Chunk
+{
+    Chunk(size_t size, mcrt_common::HugePageMode hugePageMode) :
+        mAddr(mcrt_common::allocHugePageBacked(size, hugePageMode)),
+        mSize(size)
+    {
+        if (!mAddr) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~Chunk()
+    {
+        mcrt_common::freeHugePageBacked(mAddr, mSize);
+    }
+
+    void* mAddr;
+    size_t mSize;
+};
+
+TessellationArena::TessellationArena(mcrt_common::HugePageMode hugePageMode) :
+    mHugePageMode(hugePageMode),
+    mChunkOffset(0),
+    mNextChunkSize(sMinChunkSize),
+    mUsedBytes(0),
+    mSharedBytes(0),
+    mReservedBytes(0),
+    mChunkCount(0)
+{
+}
+
+TessellationArena::~TessellationArena() = default;
+
+void*
+TessellationArena::allocate(size_t bytes, size_t alignment, std::shared_ptr<void>& owner)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Buffers too big to share a chunk get one of their own, the current
+    // chunk stays open for the smaller ones.
+    if (bytes > sMinChunkSize / 4) {
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(roundUpToHugePages(bytes), mHugePageMode);
+        mUsedBytes += bytes;
+        mReservedBytes += chunk->mSize;
+        ++mChunkCount;
+        owner = chunk;
+        return chunk->mAddr;
+    }
+
+    size_t offset = (mChunkOffset + alignment - 1) & ~(alignment - 1);
+    if (!mChunk || offset + bytes > mChunk->mSize) {
+        mChunk = std::make_shared<Chunk>(mNextChunkSize, mHugePageMode);
+        mReservedBytes += mChunk->mSize;
+        ++mChunkCount;
+        mNextChunkSize = sMinChunkSize;
+        offset = 0;
+    }
+
+    mUsedBytes += bytes;
+    mSharedBytes += bytes;
+    mChunkOffset = offset + bytes;
+    owner = mChunk;
+    return static_cast<char*>(mChunk->mAddr) + offset;
+}
+
+void
+TessellationArena::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mNextChunkSize = std::min(std::max(roundUpToHugePages(mSharedBytes), sMinChunkSize), sMaxChunkSize);
+    mChunk.reset();
+    mChunkOffset = 0;
+    mUsedBytes = 0;
+    mSharedBytes = 0;
+    mReservedBytes = 0;
+    mChunkCount = 0;
+}
+
+size_t
+TessellationArena::getUsedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsedBytes;
+}
+
+size_t
+TessellationArena::getReservedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mReservedBytes;
+}
+
+size_t
+TessellationArena::getChunkCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mChunkCount;
+}
+
+std::string
+TessellationArena::show() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::ostringstream ostr;
+    ostr << "TessellationArena {\n"
+         << "  hugePageMode:" << mcrt_common::showHugePageMode(mHugePageMode) << '\n'
+         << "  used:" << scene_rdl2::str_util::byteStr(mUsedBytes) << '\n'
+         << "  reserved:" << scene_rdl2::str_util::byteStr(mReservedBytes) << '\n'
+         << "  chunks:" << mChunkCount << '\n'
+         << "}";
+    return ostr.str();
+}
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,96 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TessellationArena.h
+///
+
+#pragma once
+
+#include <moonray/rendering/geom/VertexBuffer.h>
+#include <moonray/rendering/geom/internal/InterleavedTraits.h>
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// TessellationArena hands out the tessellated vertex buffers of the meshes
+// of a layer from a few large, huge page aligned chunks instead of one
+// aligned allocation per buffer. Meshes know their tessellated vertex count
+// before they allocate, so every buffer is carved out at its final size and
+// never grows. A chunk is released in one go once the arena has moved on to
+// another chunk and the last buffer carved out of it is gone, which happens
+// when the meshes using it are re-tessellated or deleted.
+//
+// allocate() is thread-safe, the other calls are meant to be made between
+// tessellation passes.
+class TessellationArena
+{
+public:
+    explicit TessellationArena(mcrt_common::HugePageMode hugePageMode = mcrt_common::HugePageMode::OFF);
+    ~TessellationArena();
+
+    TessellationArena(const TessellationArena&) = delete;
+    TessellationArena& operator=(const TessellationArena&) = delete;
+
+    // Returns bytes of zeroed memory aligned to alignment (a power of two
+    // no larger than a page). owner keeps the memory alive.
+    void* allocate(size_t bytes, size_t alignment, std::shared_ptr<void>& owner);
+
+    // Starts a new tessellation pass. The current chunk is given up so the
+    // buffers of the previous pass release their chunks as they get replaced,
+    // and the first shared chunk of the new pass is sized to hold all of the
+    // small buffers of the previous pass.
+    void reset();
+
+    // Bytes handed out by allocate() and bytes mapped for the chunks, since
+    // the last reset().
+    size_t getUsedBytes() const;
+    size_t getReservedBytes() const;
+    size_t getChunkCount() const;
+
+    std::string show() const;
+
+    static constexpr size_t sMinChunkSize = 64 * 1024 * 1024;
+    static constexpr size_t sMaxChunkSize = 1024 * 1024 * 1024;
+
+private:
+    struct Chunk;
+
+    mcrt_common::HugePageMode mHugePageMode;
+
+    mutable std::mutex mMutex;
+    std::shared_ptr<Chunk> mChunk;
+    size_t mChunkOffset;
+    size_t mNextChunkSize;
+
+    size_t mUsedBytes;
+    size_t mSharedBytes; // the part of mUsedBytes carved out of shared chunks
+    size_t mReservedBytes;
+    size_t mChunkCount;
+};
+
+// Tessellated vertex buffer of n elements of timeSteps samples, carved out
+// of the arena, or allocated on its own when there is no arena.
+template <typename T>
+VertexBuffer<T, InterleavedTraits>
+allocateTessellatedBuffer(TessellationArena* arena, size_t n, size_t timeSteps)
+{
+    typedef VertexBuffer<T, InterleavedTraits> Buffer;
+    if (arena == nullptr || n == 0) {
+        return Buffer(n, timeSteps);
+    }
+    std::shared_ptr<void> owner;
+    void* data = arena->allocate(n * timeSteps * sizeof(T), SIMD_MEMORY_ALIGNMENT, owner);
+    return Buffer::adopt(static_cast<T*>(data), n, timeSteps, std::move(owner));
+}
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
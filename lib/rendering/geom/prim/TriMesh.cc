@@ -9,6 +9,7 @@
 #include "TriMesh.h"
 
 #include <moonray/rendering/geom/prim/MeshTessellationUtil.h>
+#include <moonray/rendering/geom/prim/TessellationArena.h>
 
 #include <moonray/rendering/bvh/shading/AttributeKey.h>
 #include <moonray/rendering/bvh/shading/Attributes.h>
@@ -1075,13 +1076,14 @@ PolygonMesh::VertexBuffer
 TriMesh::generateVertexBuffer(
         const PolygonMesh::VertexBuffer& baseVertices,
         const PolygonMesh::IndexBuffer& baseIndices,
-        const std::vector<PolyMesh::SurfaceSample>& surfaceSamples) const
+        const std::vector<PolyMesh::SurfaceSample>& surfaceSamples,
+        TessellationArena* arena) const
 {
     // allocate tessellated vertex/index buffer to hold the evaluation result
     size_t tessellatedVertexCount = surfaceSamples.size();
     size_t motionSampleCount = baseVertices.get_time_steps();
-    PolygonMesh::VertexBuffer tessellatedVertices(
-        tessellatedVertexCount, motionSampleCount);
+    PolygonMesh::VertexBuffer tessellatedVertices =
+        allocateTessellatedBuffer<Vec3fa>(arena, tessellatedVertexCount, motionSampleCount);
     tbb::blocked_range<size_t> range =
         tbb::blocked_range<size_t>(0, tessellatedVertexCount);
     tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
@@ -46,6 +46,11 @@ public:
         mIsMotionBlurOn = true;
     }
 
+    bool isMotionBlurOn() const
+    {
+        return mIsMotionBlurOn;
+    }
+
     void setShutterValues(float tShutterOpen, float tShutterRange)
     {
         mTShutterOpen = tShutterOpen;
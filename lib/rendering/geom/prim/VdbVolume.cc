@@ -13,6 +13,7 @@
 #include <moonray/rendering/bvh/shading/AttributeKey.h>
 #include <moonray/rendering/bvh/shading/RootShader.h>
 #include <moonray/rendering/bvh/shading/State.h>
+#include <moonray/rendering/texturing/sampler/VdbGridCache.h>
 #include <scene_rdl2/render/logging/logging.h>
 #include <scene_rdl2/render/util/stdmemory.h>
 #include <scene_rdl2/scene/rdl2/VisibilityFlags.h>
@@ -49,13 +50,17 @@ getGridLuminance(const VDBSampler<openvdb::VectorGrid>& emissionSampler,
 {
     std::vector<float> values;
     for (auto it = emissionGrid.cbeginValueOn(); it; ++it) {
-        const openvdb::math::Coord& xyz = it.getCoord();
-        const auto rgba = emissionSampler.mSamplers[0].mAccessor.getValue(it.getCoord());
+        // Read the value from the iterator, the sampler may not hold
+        // OpenVDB accessors when the grid was converted to NanoVDB.
+        const auto rgba = it.getValue();
         values.push_back(luminance(Color(rgba.x(), rgba.y(), rgba.z())));
     }
     return values;
 }
 
+// Number of cells along the longest axis of the majorant grid.
+constexpr int sMajorantGridResolution = 64;
+
 } // anonymous namespace
 
 // The algorithm openvdb::tools::VolumeRayIntersector uses to collect all
@@ -67,9 +72,8 @@ getGridLuminance(const VDBSampler<openvdb::VectorGrid>& emissionSampler,
 //
 // TODO currently we use coarser resolution grid to record whether
 // a particular grid entry contains any active voxel
-// This grid can be further used to store meta data like maximum/minimum sigmaT
-// in the grid entry, which will be helpful for other advanced volume rendering
-// techniques like residual/ratio tracking and decomposition tracking
+// The maximum sigmaT used by ratio tracking is kept separately in a
+// MajorantGrid since it is needed for uniform voxel grids as well.
 class DDAIntersector
 {
 public:
@@ -402,6 +406,8 @@ VdbVolume::getMemory() const
         mem += mDDAIntersector->getMemory();
     }
 
+    mem += mMajorantGrid.getMemory();
+
     if (mVdbVolumeData) {
         mem += sizeof(VdbVolumeData);
     }
@@ -476,6 +482,8 @@ VdbVolume::tessellate(const TessellationParams& tessellationParams, Tessellation
             xform[1] = &mPrimToRender[1];
         }
 
+        mMajorantGrid.build(*mTopologyGrid, sMajorantGridResolution);
+
         // Transform bounding box vertices to render space
         for (int i = 0; i < 2; i++) {
             mBBoxVertices[i + 0 * 2] = Vec3fa(scene_rdl2::math::transformPoint(*xform[i], Vec3f(pMin.x, pMin.y, pMin.z)), 0.f);
@@ -681,6 +689,21 @@ VdbVolume::evalDensity(mcrt_common::ThreadLocalState* tls,
     return density * sampleBakedDensity(tls, volumeId, p);
 }
 
+float
+VdbVolume::getDensityMajorant(const Vec3f& org, const Vec3f& dir, float t, float& tExit) const
+{
+    if (!mMajorantGrid.isValid()) {
+        return Primitive::getDensityMajorant(org, dir, t, tExit);
+    }
+    // The density is looked up at advected positions under velocity motion
+    // blur, which may come from any cell.
+    if (mVdbVelocity->isMotionBlurOn()) {
+        tExit = inf;
+        return mMajorantGrid.getGlobalMajorant() * getBakedDensityMajorant();
+    }
+    return mMajorantGrid.lookup(org, dir, t, tExit) * getBakedDensityMajorant();
+}
+
 void
 VdbVolume::evalVolumeCoefficients(mcrt_common::ThreadLocalState* tls,
                                   uint32_t volumeId,
@@ -1027,6 +1050,22 @@ findNthGridByName(const openvdb::GridPtrVec& grids, const std::string& name)
     return openvdb::GridBase::Ptr();
 }
 
+// Reads the voxel data of a grid through the process wide grid cache, so a
+// grid also used by a map or light filter is only read once.
+openvdb::GridBase::ConstPtr
+readCachedGrid(const openvdb::io::File& file, const std::string& gridName)
+{
+    std::string errorMsg;
+    openvdb::GridBase::ConstPtr grid =
+        texture::getVdbGridCache().getGrid(file.filename(), gridName, errorMsg);
+    if (!grid) {
+        // caught by moonray::rt::GeometryManager::tessellate, like the
+        // exceptions of openvdb::io::File
+        OPENVDB_THROW(openvdb::IoError, errorMsg);
+    }
+    return grid;
+}
+
 bool
 VdbVolume::initializePhase1(const std::string& vdbFilePath,
                             openvdb::io::File& file,
@@ -1068,8 +1107,8 @@ VdbVolume::initializePhase1(const std::string& vdbFilePath,
             *grids, mVdbVolumeData->mVelocityGridName);
         // validate grid from metadata
         if (velocityGridTmp && velocityGridTmp->isType<openvdb::VectorGrid>()) {
-            // read voxel data
-            velocityGridTmp = file.readGrid(mVdbVolumeData->mVelocityGridName);
+            // read voxel data, copied as it is scaled below
+            velocityGridTmp = readCachedGrid(file, mVdbVolumeData->mVelocityGridName)->deepCopyGrid();
             if (!velocityGridTmp->empty()) {
                 velocityGrid = openvdb::gridPtrCast<openvdb::VectorGrid>(
                     velocityGridTmp);
@@ -1199,6 +1238,19 @@ VdbVolume::initialize(const scene_rdl2::rdl2::Geometry& rdlGeometry,
         return false;
     }
 
+    // Read the grids used in parallel. They are held here until the samplers
+    // below pick them up from the grid cache, errors are reported there.
+    std::vector<std::string> gridNames(1, mVdbVolumeData->mDensityGridName);
+    if (!mVdbVolumeData->mEmissionGridName.empty()) {
+        gridNames.push_back(mVdbVolumeData->mEmissionGridName);
+    }
+    if (mVdbVolumeData->mIsMotionBlurOn && !isZero(mVdbVolumeData->mVelocityScale)) {
+        gridNames.push_back(mVdbVolumeData->mVelocityGridName);
+    }
+    std::vector<std::string> errorMsgs;
+    const std::vector<openvdb::GridBase::ConstPtr> prefetchedGrids =
+        texture::getVdbGridCache().getGrids(vdbFilePath, gridNames, errorMsgs);
+
     openvdb::io::File file(vdbFilePath);
     openvdb::GridPtrVecPtr grids;
     openvdb::VectorGrid::Ptr velocityGrid;
@@ -1266,11 +1318,15 @@ VdbVolume::initDensitySampler(openvdb::io::File& file,
             return false;
         }
         // read voxel data
-        densityGrid = file.readGrid(densityGridName);
-        if (densityGrid->empty()) {
+        const openvdb::GridBase::ConstPtr cachedGrid = readCachedGrid(file, densityGridName);
+        if (cachedGrid->empty()) {
             rdlGeometry.error("Density grid: \"", densityGridName, "\" is empty.");
             return false;
         }
+        // The motion blur padding below changes the grid, which is shared
+        // through the grid cache otherwise.
+        densityGrid = velocityGrid ? cachedGrid->deepCopyGrid() :
+                                     openvdb::ConstPtrCast<openvdb::GridBase>(cachedGrid);
 
         mTopologyGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(densityGrid);
     } else {
@@ -1307,7 +1363,7 @@ VdbVolume::initEmissionSampler(openvdb::io::File& file,
             return false;
         }
         // read voxel data
-        emissionGrid = file.readGrid(emissionGridName);
+        emissionGrid = openvdb::ConstPtrCast<openvdb::GridBase>(readCachedGrid(file, emissionGridName));
         if (emissionGrid->empty()) {
             rdlGeometry.error("Emission grid: \"", emissionGridName, "\" is empty.");
             return false;
@@ -1404,6 +1460,7 @@ VdbVolume::bakeVolumeShaderDensityMap(const scene_rdl2::rdl2::VolumeShader* volu
     );
 
     mBakedDensityGrid->pruneGrid();
+    computeBakedDensityMajorant();
 
     // Get volume ids. There is a separate density sampler for each volume id.
     const std::vector<int>& volumeIds = volumeAssignmentTable->getVolumeIds(assignmentId);
@@ -11,6 +11,7 @@
 #include <moonray/rendering/geom/prim/BufferDesc.h>
 #include <moonray/rendering/geom/prim/GeomTLState.h>
 #include <moonray/rendering/geom/prim/GridSampler.h>
+#include <moonray/rendering/geom/prim/MajorantGrid.h>
 #include <moonray/rendering/geom/prim/NamedPrimitive.h>
 
 #include <moonray/rendering/bvh/shading/Intersection.h>
@@ -32,6 +33,8 @@
 #include <openvdb/tools/RayIntersector.h>
 #include <openvdb/tools/VelocityFields.h>
 
+#include <limits>
+
 namespace moonray {
 namespace geom {
 
@@ -101,13 +104,17 @@ computeEmissionDistributionImpl(const scene_rdl2::rdl2::Geometry* rdlGeometry,
         tx  , ty  , tz  , 1.0f);
     scene_rdl2::math::Mat4f distToRender[2] = {distToIndex * indexToRender[0],
                                                distToIndex * indexToRender[1]};
-    size_t denseResolution = res[0] * res[1] * res[2];
+    // Only the brick grid of the sparse distribution is dense.
+    const size_t brickResolution =
+        size_t((res[0] + SparseEmissionDistribution::sBrickDim - 1) >> SparseEmissionDistribution::sBrickLog2Dim) *
+        size_t((res[1] + SparseEmissionDistribution::sBrickDim - 1) >> SparseEmissionDistribution::sBrickLog2Dim) *
+        size_t((res[2] + SparseEmissionDistribution::sBrickDim - 1) >> SparseEmissionDistribution::sBrickLog2Dim);
 
     // check for overflow
-    if (denseResolution != 0 && res[0] != denseResolution / (res[1] * res[2])) {
+    if (brickResolution > size_t(std::numeric_limits<int>::max())) {
         float emissionSampleRate = scene_rdl2::math::clamp(rdlGeometry->get<scene_rdl2::rdl2::Float>("emission_sample_rate"));
-        // The cube root of 2 ^ 31 is about 1290.
-        float factor = 3.f * 1290.f / (res[0] + res[1] + res[2]);
+        // The cube root of 2 ^ 31 bricks of 8 ^ 3 voxels is about 10321 voxels.
+        float factor = 3.f * 10321.f / (res[0] + res[1] + res[2]);
         // round to nearest 2 decimal
         float suggestedSampleRate = int(factor * emissionSampleRate * 100) / 100.f;
 
@@ -130,41 +137,34 @@ computeEmissionDistributionImpl(const scene_rdl2::rdl2::Geometry* rdlGeometry,
                                                                   scene_rdl2::math::Color(1.0f)));
     };
 
-    std::vector<float> histogram(denseResolution, 0.0f);
+    SparseEmissionDistribution::Builder builder(res);
 
-    auto getHistogramIndex = [&](const openvdb::Coord& ijk)->size_t
+    auto getDistCoord = [&](const openvdb::Coord& ijk)->scene_rdl2::math::Vec3i
         {
-            size_t index =
-                (ijk[2] - pMin[2]) * res[0] * res[1] +
-                (ijk[1] - pMin[1]) * res[0] +
-                (ijk[0] - pMin[0]);
-            return index;
+            return scene_rdl2::math::Vec3i(ijk[0] - pMin[0], ijk[1] - pMin[1], ijk[2] - pMin[2]);
         };
 
     valueIndex = 0;
     for (auto it = emissionGrid.cbeginValueOn(); it.test(); ++it) {
-        float value = values[valueIndex];
+        const float value = values[valueIndex];
         ++valueIndex;
         if (value <= scene_rdl2::math::sEpsilon || !scene_rdl2::math::isfinite(value)) {
             continue;
         }
         if (it.isVoxelValue()) {
             const openvdb::Coord& coord = it.getCoord();
-            value *= evalVolumeShader(coord);
-            // set histogram value
-            histogram[getHistogramIndex(coord)] += value;
+            builder.add(getDistCoord(coord), value * evalVolumeShader(coord));
         } else {
             openvdb::CoordBBox bound;
             it.getBoundingBox(bound);
             for (openvdb::CoordBBox::Iterator<true> ijk(bound); ijk; ++ijk) {
                 const openvdb::Coord& coord = *ijk;
-                value *= evalVolumeShader(coord);
-                histogram[getHistogramIndex(coord)] += value;
+                builder.add(getDistCoord(coord), value * evalVolumeShader(coord));
             }
         }
     }
     return std::unique_ptr<EmissionDistribution>(
-        new DenseEmissionDistribution(res, distToRender, invUnitVolume, histogram));
+        new SparseEmissionDistribution(res, distToRender, invUnitVolume, builder));
 }
 
 } // end anonymous namespace
@@ -306,6 +306,9 @@ public:
                                     float /*rayVolumeDepth*/,
                                     const scene_rdl2::rdl2::VolumeShader* const /*volumeShader*/) const override;
 
+    virtual float getDensityMajorant(const Vec3f& org, const Vec3f& dir, float t,
+                                     float& tExit) const override;
+
     virtual void evalVolumeCoefficients(mcrt_common::ThreadLocalState* tls,
                                         uint32_t volumeId,
                                         const Vec3f& pSample,
@@ -477,6 +480,8 @@ protected:
     bool mHasUniformVoxels;
 
     VDBSampler<openvdb::FloatGrid> mDensitySampler;
+    // upper bounds of mTopologyGrid, for null scattering transmittance estimation
+    MajorantGrid mMajorantGrid;
 
     bool mHasEmissionField;
     openvdb::Vec3SGrid::Ptr mEmissionGrid;
@@ -330,7 +330,11 @@ private:
 //
 //  To do this, we'll use a finite state machine to record transition events.
 
-VolumeIdFSM::VolumeIdFSM()
+VolumeIdFSM::VolumeIdFSM() :
+    mTransitions(1, Transition{nullptr, -1, -1}),
+    mTransitionMask(0),
+    mVolumeIds(1, -1),
+    mIsLeaf(1, 1)
 {
     // start with a single empty node
     mNodes.push_back(Node());
@@ -353,34 +357,46 @@ VolumeIdFSM::add(const std::vector<const geom::internal::Instance *> &sequence,
     // we should now be at a leaf node with an unset volumeId
     MNRY_ASSERT(!sequence.empty());
     MNRY_ASSERT(state > 0 && state < static_cast<int>(mNodes.size()));
-    MNRY_ASSERT(isLeaf(state));
+    MNRY_ASSERT(mNodes[state].mTransitions.empty());
     Node &n = mNodes[state];
     MNRY_ASSERT(n.mVolumeId == -1); // hasn't been set yet
     n.mVolumeId = volumeId;
 }
 
-int
-VolumeIdFSM::transition(int state, const geom::internal::Instance *to) const
-{
-    MNRY_ASSERT(state >= 0 && state < static_cast<int>(mNodes.size()));
-    const Node &n = mNodes[state];
-    return n.findTransition(to);
-}
-
-bool
-VolumeIdFSM::isLeaf(int state) const
+void
+VolumeIdFSM::finalize()
 {
-    MNRY_ASSERT(state >= 0 && state < static_cast<int>(mNodes.size()));
-    const Node &n = mNodes[state];
-    return n.mTransitions.size() == 0;
-}
+    // Every ray traversing a volume instance does a transition per instance
+    // level, so the per node hash maps are flattened into one table, which
+    // is a handful of contiguous loads per lookup.
+    size_t transitionCount = 0;
+    for (const Node &n : mNodes) {
+        transitionCount += n.mTransitions.size();
+    }
+    size_t tableSize = 1;
+    while (tableSize < 2 * transitionCount) {
+        tableSize <<= 1;
+    }
+    mTransitions.assign(tableSize, Transition{nullptr, -1, -1});
+    mTransitionMask = static_cast<uint32_t>(tableSize - 1);
+
+    mVolumeIds.resize(mNodes.size());
+    mIsLeaf.resize(mNodes.size());
+    for (size_t state = 0; state < mNodes.size(); ++state) {
+        const Node &n = mNodes[state];
+        mVolumeIds[state] = n.mVolumeId;
+        mIsLeaf[state] = n.mTransitions.empty();
+        for (const auto &it : n.mTransitions) {
+            uint32_t slot = hash(static_cast<int>(state), it.first);
+            while (mTransitions[slot & mTransitionMask].mTo != nullptr) {
+                ++slot;
+            }
+            mTransitions[slot & mTransitionMask] = Transition{it.first, static_cast<int>(state), it.second};
+        }
+    }
 
-int
-VolumeIdFSM::getVolumeId(int state) const
-{
-    MNRY_ASSERT(state >= 0 && state < static_cast<int>(mNodes.size()));
-    const Node &n = mNodes[state];
-    return n.mVolumeId;
+    // Sequences can't be added anymore, release the build time nodes.
+    std::vector<Node>().swap(mNodes);
 }
 
 int
@@ -470,6 +486,7 @@ VolumeAssignmentTable::initLookupTable(const scene_rdl2::rdl2::Layer *layer)
                                       volumeCount);
             proc->forEachPrimitive(avi, /* doParallel = */ false);
         }
+        mInstanceVolumeIds.finalize();
     }
 
     // Now handle the non shared, non instances
@@ -489,6 +506,7 @@ VolumeAssignmentTable::initLookupTable(const scene_rdl2::rdl2::Layer *layer)
 
     // reset volume shaders
     mVolumeShaders = std::vector<const scene_rdl2::rdl2::VolumeShader *>(assignmentCount, nullptr);
+    mIsInert = std::vector<uint8_t>(assignmentCount, 0);
 
     // reset shadow linking lookup table
     mShadowLinkings.clear();
@@ -497,7 +515,9 @@ VolumeAssignmentTable::initLookupTable(const scene_rdl2::rdl2::Layer *layer)
     // Fill in volume shaders and shadow linking
     for (int32_t aId = 0; aId < assignmentCount; ++aId) {
         if (!mAssignmentIdToVolumeIds.empty()) {
-            mVolumeShaders[aId] = layer->lookupVolumeShader(aId);
+            const scene_rdl2::rdl2::VolumeShader* volumeShader = layer->lookupVolumeShader(aId);
+            mVolumeShaders[aId] = volumeShader;
+            mIsInert[aId] = volumeShader && volumeShader->isCutout() && volumeShader->getProperties() == 0;
             const scene_rdl2::rdl2::ShadowSet* shadowSet = layer->lookupShadowSet(aId);
             // add lights to shadow set
             if (shadowSet) {
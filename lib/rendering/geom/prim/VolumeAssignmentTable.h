@@ -16,6 +16,7 @@
 #include <scene_rdl2/scene/rdl2/ShadowSet.h>
 #include <scene_rdl2/scene/rdl2/VolumeShader.h>
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
@@ -37,18 +38,45 @@ public:
     // is a sequence of instance primitives ending in a volumeId
     void add(const std::vector<const geom::internal::Instance *> &sequence, int volumeId);
 
+    // Compiles the sequences added so far into the flat tables used by
+    // transition(), isLeaf() and getVolumeId().  Must be called once all
+    // the sequences are added.
+    void finalize();
+
     // Transition to instance "to"
     // Returns next valid state (>= 0) based on this transition.  If the
     // transition is invalid, return -1.
-    int transition(int state, const geom::internal::Instance *to) const;
+    int transition(int state, const geom::internal::Instance *to) const
+    {
+        MNRY_ASSERT(state >= 0 && state < static_cast<int>(mVolumeIds.size()));
+        // Linear probing, the table is at most half full so the probe
+        // sequences are short and mostly stay within a cache line.
+        for (uint32_t slot = hash(state, to); ; ++slot) {
+            const Transition &t = mTransitions[slot & mTransitionMask];
+            if (t.mTo == to && t.mState == state) {
+                return t.mNextState;
+            }
+            if (t.mTo == nullptr) {
+                return -1;
+            }
+        }
+    }
 
     // Is this an end state?
-    bool isLeaf(int state) const;
+    bool isLeaf(int state) const
+    {
+        MNRY_ASSERT(state >= 0 && state < static_cast<int>(mIsLeaf.size()));
+        return mIsLeaf[state];
+    }
 
     // What is the volumeId of this state?
     // If the state is a leaf state it will be the volumeId otherwise
     // it will be -1.
-    int getVolumeId(int state) const;
+    int getVolumeId(int state) const
+    {
+        MNRY_ASSERT(state >= 0 && state < static_cast<int>(mVolumeIds.size()));
+        return mVolumeIds[state];
+    }
 
 private:
     struct Node
@@ -70,7 +98,35 @@ private:
         int mVolumeId;
     };
 
+    // An entry of the flat transition table, keyed by (mState, mTo).
+    // Empty entries have a null mTo.
+    struct Transition
+    {
+        const geom::internal::Instance *mTo;
+        int mState;
+        int mNextState;
+    };
+
+    static uint32_t hash(int state, const geom::internal::Instance *to)
+    {
+        uint64_t h = reinterpret_cast<uintptr_t>(to) ^ (uint64_t(state) * 0x9e3779b97f4a7c15ull);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return static_cast<uint32_t>(h);
+    }
+
+    // Only used while the sequences are added, released by finalize().
     std::vector<Node> mNodes;
+
+    // Open addressed transition table of all the nodes, its size is a power
+    // of two.
+    std::vector<Transition> mTransitions;
+    uint32_t mTransitionMask;
+
+    // Indexed by state.
+    std::vector<int> mVolumeIds;
+    std::vector<uint8_t> mIsLeaf;
 };
 
 
@@ -95,6 +151,13 @@ public:
         return mVolumeShaders[assignmentId];
     }
 
+    // A cutout volume without an indirect volume has no density of its own
+    // and carves nothing out of the volumes it overlaps, so the volume
+    // interval filters drop its intersections before they become intervals.
+    bool isInert(int assignmentId) const {
+        return mIsInert[assignmentId];
+    }
+
     const ShadowLinking& lookupShadowLinkingWithVolumeId(int volumeId) const {
         return mShadowLinkings[mVolumeIdToAssignmentId[volumeId]];
     }
@@ -139,6 +202,9 @@ private:
     // Based on assignment id
     std::vector<const scene_rdl2::rdl2::VolumeShader*> mVolumeShaders;
 
+    // Based on assignment id
+    std::vector<uint8_t> mIsInert;
+
     // Based on assignment id
     std::vector<ShadowLinking> mShadowLinkings;
 
@@ -26,7 +26,7 @@ public:
     static constexpr int ORIGIN_VOLUME_INIT = -2; // We don't have volume along the ray
     static constexpr int ORIGIN_VOLUME_EMPTY = -1; // We have volume but ray origin is outside volume
 
-    VolumeRayState() : mIntervalCount(0), mVolumeAssignmentTable(nullptr) {}
+    VolumeRayState() : mIntervalCount(0), mIntervalsSorted(true), mVolumeAssignmentTable(nullptr) {}
 
     finline void initializeVolumeLookup(
             const VolumeAssignmentTable* volumeAssignmentTable) {
@@ -36,6 +36,7 @@ public:
 
     finline void resetState(float tEnd, bool estimateInScatter) {
         mIntervalCount = 0;
+        mIntervalsSorted = true;
         mVolumeRegions.reset();
         mVisitedVolumes.reset();
         mTEnd = tEnd;
@@ -43,14 +44,30 @@ public:
         mEstimateInScatter = estimateInScatter;
     }
 
+    // Intervals are kept sorted by t as they are added, intervals at the same
+    // t stay in the order they were added.  Past sMaxSortedIntervalCount
+    // they are only appended, see areIntervalsSorted().
     finline void addInterval(const Primitive* primitive, float t, int volumeId, bool isEntry, float *tRenderSpace = nullptr) {
         MNRY_ASSERT(mIntervalCount < sMaxIntervalCount,
             "volume intersections along the ray exceeds "
             "thread local storage capacity");
-        mVolumeIntervals[mIntervalCount++] =
-            VolumeTransition(primitive, t, volumeId, isEntry, tRenderSpace);
+        size_t i = mIntervalCount++;
+        if (mIntervalsSorted) {
+            if (i < sMaxSortedIntervalCount) {
+                for (; i > 0 && mVolumeIntervals[i - 1].mT > t; --i) {
+                    mVolumeIntervals[i] = mVolumeIntervals[i - 1];
+                }
+            } else {
+                mIntervalsSorted = false;
+            }
+        }
+        mVolumeIntervals[i] = VolumeTransition(primitive, t, volumeId, isEntry, tRenderSpace);
     }
 
+    // False if there were too many intervals to insert them in order, they
+    // then need sorting.
+    finline bool areIntervalsSorted() const { return mIntervalsSorted; }
+
     finline size_t getIntervalCount() const { return mIntervalCount; }
 
     finline const VolumeRegions& getCurrentVolumeRegions() const {
@@ -135,12 +152,15 @@ public:
 
 private:
     size_t mIntervalCount;
+    bool mIntervalsSorted;
     const VolumeAssignmentTable* mVolumeAssignmentTable;
     VolumeRegions mVolumeRegions;
     VolumeRegions mVisitedVolumes;
     std::vector<VolumeSampleInfo> mVolumeSampleInfo;
     float mTEnd;
     static constexpr size_t sMaxIntervalCount = 4096;
+    // Past this, insertion costs more than sorting once.
+    static constexpr size_t sMaxSortedIntervalCount = 64;
     std::array<VolumeTransition, sMaxIntervalCount> mVolumeIntervals;
 
     // volumeId of ray origin position. 3 possible conditions.
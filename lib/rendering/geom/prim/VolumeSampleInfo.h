@@ -51,6 +51,16 @@ public:
         return mSampleRayOrg + t * mSampleRayDir;
     }
 
+    const Vec3f& getSampleRayOrg() const
+    {
+        return mSampleRayOrg;
+    }
+
+    const Vec3f& getSampleRayDir() const
+    {
+        return mSampleRayDir;
+    }
+
     // Is volume sample homogenous?
     bool isHomogenous() const
     {
@@ -0,0 +1,157 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file VolumeShaderCache.h
+///
+
+#pragma once
+
+#include <moonray/rendering/geom/Types.h>
+
+#include <scene_rdl2/common/math/Color.h>
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+#include <scene_rdl2/render/util/Memory.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace internal {
+
+// VolumeShaderCache keeps the results of volume shader evaluations of one
+// thread so the pixel samples and bounces marching through the same region of
+// a volume can share them. Entries are keyed by volume id and by the cell of a
+// regular grid the render space sample position falls into, which turns the
+// shader into a piecewise constant function at the cell size.
+//
+// The cache is set associative: a key can only go into the few entries of the
+// set it hashes to, and the least recently used entry of the set is evicted
+// on a miss. Lookups never allocate.
+class VolumeShaderCache
+{
+public:
+    struct Result
+    {
+        scene_rdl2::math::Color mExtinction;
+        scene_rdl2::math::Color mAlbedo;
+        scene_rdl2::math::Color mEmission;
+        float mAnisotropy;
+        bool mHasEmission;
+    };
+
+    VolumeShaderCache() : mSetMask(0), mClock(0) {}
+
+    // The capacity is rounded up to a power of two number of sets, 0 disables
+    // the cache. Drops the cached results.
+    void setCapacity(size_t capacity)
+    {
+        mEntries.clear();
+        mSetMask = 0;
+        if (capacity == 0) {
+            return;
+        }
+        size_t numSets = 1;
+        while (numSets * sWays < capacity) {
+            numSets <<= 1;
+        }
+        mEntries.resize(numSets * sWays);
+        mEntries.shrink_to_fit();
+        mSetMask = numSets - 1;
+        clear();
+    }
+
+    bool isEnabled() const { return !mEntries.empty(); }
+
+    void clear()
+    {
+        for (Entry& entry : mEntries) {
+            entry.mLastUse = 0;
+        }
+        mClock = 0;
+    }
+
+    // Returns the entry of the cell containing p. hit tells whether it holds
+    // the result of that cell, otherwise the entry was claimed for the cell
+    // and the caller is expected to fill it.
+    Result* lookup(int volumeId, const Vec3f& p, float cellSize, bool& hit)
+    {
+        MNRY_ASSERT(isEnabled() && cellSize > 0.0f);
+
+        const float invCellSize = 1.0f / cellSize;
+        const Key key = { volumeId, toCell(p.x * invCellSize), toCell(p.y * invCellSize),
+                          toCell(p.z * invCellSize) };
+
+        Entry* set = &mEntries[(hash(key) & mSetMask) * sWays];
+        Entry* victim = set;
+        ++mClock;
+        for (int i = 0; i < sWays; ++i) {
+            Entry& entry = set[i];
+            if (entry.mLastUse != 0 && entry.mKey == key) {
+                entry.mLastUse = mClock;
+                hit = true;
+                return &entry.mResult;
+            }
+            if (entry.mLastUse < victim->mLastUse) {
+                victim = &entry;
+            }
+        }
+
+        victim->mKey = key;
+        victim->mLastUse = mClock;
+        hit = false;
+        return &victim->mResult;
+    }
+
+    size_t getMemory() const
+    {
+        return scene_rdl2::util::getVectorElementsMemory(mEntries);
+    }
+
+private:
+    static constexpr int sWays = 4;
+
+    struct Key
+    {
+        int32_t mVolumeId;
+        int32_t mX, mY, mZ;
+
+        bool operator==(const Key& other) const
+        {
+            return mVolumeId == other.mVolumeId && mX == other.mX && mY == other.mY && mZ == other.mZ;
+        }
+    };
+
+    struct Entry
+    {
+        Key mKey;
+        // 0 marks an empty entry
+        uint64_t mLastUse;
+        Result mResult;
+    };
+
+    static int32_t toCell(float x)
+    {
+        // clamp far away positions, they only share cells with each other
+        return static_cast<int32_t>(scene_rdl2::math::clamp(scene_rdl2::math::floor(x), -2.0e9f, 2.0e9f));
+    }
+
+    static uint32_t hash(const Key& key)
+    {
+        uint32_t h = uint32_t(key.mX) * 73856093u ^ uint32_t(key.mY) * 19349663u ^
+                     uint32_t(key.mZ) * 83492791u ^ uint32_t(key.mVolumeId) * 2654435761u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    std::vector<Entry> mEntries;
+    size_t mSetMask;
+    uint64_t mClock;
+};
+
+} // namespace internal
+} // namespace geom
+} // namespace moonray
+
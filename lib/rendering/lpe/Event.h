@@ -20,6 +20,10 @@ enum EventScatteringType {
 
 const int sNoLabel = LPE_NO_LABEL;
 
+static_assert(EVENT_TYPE_MATERIAL + 1 == LPE_NUM_EVENT_TYPES, "LPE_NUM_EVENT_TYPES is out of date");
+static_assert(EVENT_SCATTERING_TYPE_STRAIGHT + 1 == LPE_NUM_EVENT_SCATTERING_TYPES,
+              "LPE_NUM_EVENT_SCATTERING_TYPES is out of date");
+
 
 } // namespace lpe
 } // namespace moonray
@@ -26,3 +26,9 @@
 
 #define LPE_NO_LABEL -1
 
+// Number of entries in the enums above.  An event code, the column of the
+// dense transition table, is ev * LPE_NUM_EVENT_SCATTERING_TYPES + evs.
+#define LPE_NUM_EVENT_TYPES 10
+#define LPE_NUM_EVENT_SCATTERING_TYPES 5
+#define LPE_NUM_EVENT_CODES (LPE_NUM_EVENT_TYPES * LPE_NUM_EVENT_SCATTERING_TYPES)
+
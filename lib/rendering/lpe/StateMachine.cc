@@ -12,7 +12,9 @@
 #include "osl/optautomata.h"
 
 #include <scene_rdl2/common/platform/Platform.h>
+#include <scene_rdl2/render/util/AlignedAllocator.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <tuple>
@@ -33,10 +35,22 @@ public:
     void build();
     int transition(int stateId, EventType ev, EventScatteringType evs, int labelId) const;
     bool isValid(int stateId, int id) const;
+    const int *getValidIds(int stateId, int &count) const;
+    void getDenseTables(const int *&eventTable, const int *&labelTable, int &numLabelColumns) const;
 
 private:
     typedef std::vector<std::tuple<std::string, int, osl::lpexp::LPexp *> > Expressions;
     typedef std::vector<osl::ustring> Labels;
+    typedef std::vector<int, scene_rdl2::alloc::AlignedAllocator<int, CACHE_LINE_SIZE>> Table;
+
+    // Past this many entries the dense tables aren't worth their memory.
+    static constexpr size_t sMaxDenseTableSize = 16 * 1024 * 1024;
+
+    // The two halves of a transition, walking the automata.
+    int eventTransition(int stateId, EventType ev, EventScatteringType evs) const;
+    int labelTransition(int stateId, int labelId) const;
+    void buildDenseTables(int numStates);
+    void buildValidIds(int numStates);
 
     Expressions mExpressions;
     Labels mLabels;
@@ -44,12 +58,22 @@ private:
     const osl::ustring mMaterialLabel; // For material AOVs that have an LPE
     osl::DfOptimizedAutomata mOptFsm;
     bool mBuilt;
+
+    Table mEventTable;
+    Table mLabelTable;
+    int mNumLabelColumns;
+
+    // The sorted ids valid at each state, state s owns
+    // mValidIds[mValidIdOffsets[s] .. mValidIdOffsets[s + 1]).
+    std::vector<int> mValidIds;
+    std::vector<int> mValidIdOffsets;
 };
 
 StateMachine::Impl::Impl():
     mExtraLabel("U"),
     mMaterialLabel("M"),
-    mBuilt(false)
+    mBuilt(false),
+    mNumLabelColumns(0)
 {
 }
 
@@ -174,6 +198,58 @@ StateMachine::Impl::build()
         mOptFsm.compileFrom(fsm);
 
         mBuilt = true;
+
+        buildDenseTables(static_cast<int>(fsm.size()));
+        buildValidIds(static_cast<int>(fsm.size()));
+    }
+}
+
+void
+StateMachine::Impl::buildValidIds(int numStates)
+{
+    mValidIds.clear();
+    mValidIdOffsets.resize(numStates + 1);
+    mValidIdOffsets[0] = 0;
+
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        int nrules = 0;
+        void * const * rules = mOptFsm.getRules(stateId, nrules);
+        const size_t first = mValidIds.size();
+        for (int i = 0; i < nrules; ++i) {
+            mValidIds.push_back(static_cast<int>(reinterpret_cast<intptr_t>(rules[i])));
+        }
+        std::sort(mValidIds.begin() + first, mValidIds.end());
+        mValidIds.erase(std::unique(mValidIds.begin() + first, mValidIds.end()), mValidIds.end());
+        mValidIdOffsets[stateId + 1] = static_cast<int>(mValidIds.size());
+    }
+}
+
+void
+StateMachine::Impl::buildDenseTables(int numStates)
+{
+    mNumLabelColumns = static_cast<int>(mLabels.size()) + 1; // column 0 is for "no label"
+    const size_t tableSize = static_cast<size_t>(numStates) * (LPE_NUM_EVENT_CODES + mNumLabelColumns);
+    if (tableSize > sMaxDenseTableSize) {
+        mNumLabelColumns = 0;
+        return;
+    }
+
+    mEventTable.resize(static_cast<size_t>(numStates) * LPE_NUM_EVENT_CODES);
+    mLabelTable.resize(static_cast<size_t>(numStates) * mNumLabelColumns);
+
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        int *eventRow = &mEventTable[static_cast<size_t>(stateId) * LPE_NUM_EVENT_CODES];
+        for (int ev = 0; ev < LPE_NUM_EVENT_TYPES; ++ev) {
+            for (int evs = 0; evs < LPE_NUM_EVENT_SCATTERING_TYPES; ++evs) {
+                eventRow[ev * LPE_NUM_EVENT_SCATTERING_TYPES + evs] =
+                    eventTransition(stateId, static_cast<EventType>(ev), static_cast<EventScatteringType>(evs));
+            }
+        }
+
+        int *labelRow = &mLabelTable[static_cast<size_t>(stateId) * mNumLabelColumns];
+        for (int labelId = -1; labelId < mNumLabelColumns - 1; ++labelId) {
+            labelRow[labelId + 1] = labelTransition(stateId, labelId);
+        }
     }
 }
 
@@ -182,6 +258,28 @@ StateMachine::Impl::transition(int stateId, EventType ev, EventScatteringType ev
 {
     MNRY_ASSERT(mBuilt);
 
+    if (stateId < 0) return stateId;
+
+    if (!mEventTable.empty()) {
+        if (static_cast<unsigned int>(ev) >= LPE_NUM_EVENT_TYPES ||
+            static_cast<unsigned int>(evs) >= LPE_NUM_EVENT_SCATTERING_TYPES) {
+            return -1; // broken
+        }
+        MNRY_ASSERT(labelId < mNumLabelColumns - 1);
+        const int newStateId = mEventTable[static_cast<size_t>(stateId) * LPE_NUM_EVENT_CODES +
+                                           ev * LPE_NUM_EVENT_SCATTERING_TYPES + evs];
+        if (newStateId < 0) return newStateId;
+        return mLabelTable[static_cast<size_t>(newStateId) * mNumLabelColumns + (labelId < 0 ? 0 : labelId + 1)];
+    }
+
+    const int newStateId = eventTransition(stateId, ev, evs);
+    if (newStateId < 0) return newStateId;
+    return labelTransition(newStateId, labelId);
+}
+
+int
+StateMachine::Impl::eventTransition(int stateId, EventType ev, EventScatteringType evs) const
+{
     int newStateId = stateId;
     if (newStateId < 0) return newStateId;
 
@@ -244,6 +342,13 @@ StateMachine::Impl::transition(int stateId, EventType ev, EventScatteringType ev
         newStateId = -1; // broken
     }
 
+    return newStateId;
+}
+
+int
+StateMachine::Impl::labelTransition(int stateId, int labelId) const
+{
+    int newStateId = stateId;
     if (newStateId < 0) return newStateId;
 
     // labelId
@@ -285,6 +390,35 @@ StateMachine::Impl::isValid(int stateId, int id) const
     return result;
 }
 
+const int *
+StateMachine::Impl::getValidIds(int stateId, int &count) const
+{
+    MNRY_ASSERT(mBuilt);
+
+    if (stateId < 0 || stateId + 1 >= static_cast<int>(mValidIdOffsets.size())) {
+        count = 0;
+        return nullptr;
+    }
+
+    const int first = mValidIdOffsets[stateId];
+    count = mValidIdOffsets[stateId + 1] - first;
+    return count ? &mValidIds[first] : nullptr;
+}
+
+void
+StateMachine::Impl::getDenseTables(const int *&eventTable, const int *&labelTable, int &numLabelColumns) const
+{
+    if (mEventTable.empty()) {
+        eventTable = nullptr;
+        labelTable = nullptr;
+        numLabelColumns = 0;
+    } else {
+        eventTable = mEventTable.data();
+        labelTable = mLabelTable.data();
+        numLabelColumns = mNumLabelColumns;
+    }
+}
+
 // ----------------------------------------------------------------------------
 StateMachine::StateMachine():
     mImpl { new Impl }
@@ -325,6 +459,18 @@ StateMachine::isValid(int stateId, int id) const
    return mImpl->isValid(stateId, id);
 }
 
+const int *
+StateMachine::getValidIds(int stateId, int &count) const
+{
+    return mImpl->getValidIds(stateId, count);
+}
+
+void
+StateMachine::getDenseTables(const int *&eventTable, const int *&labelTable, int &numLabelColumns) const
+{
+    mImpl->getDenseTables(eventTable, labelTable, numLabelColumns);
+}
+
 
 // ispc hook
 extern "C" int
@@ -336,6 +482,15 @@ CPP_LpeStateMachine_transition(const uint8_t *stateMachine, int stateId, EventTy
     return s->transition(stateId, ev, evs, labelId);
 }
 
+extern "C" void
+CPP_LpeStateMachine_getDenseTables(const uint8_t *stateMachine, const int **eventTable, const int **labelTable,
+                                   int *numLabelColumns)
+{
+    const StateMachine *s = reinterpret_cast<const StateMachine *>(stateMachine);
+
+    s->getDenseTables(*eventTable, *labelTable, *numLabelColumns);
+}
+
 } // namespace lpe
 } // namespace moonray
 
@@ -53,6 +53,23 @@ public:
     /// @return true if id is valid at this stateId, false otherwise
     bool isValid(int stateId, int id) const;
 
+    /// @param stateId current state of machine
+    /// @param count set to the number of ids valid at this stateId
+    /// @return the ids of the expressions valid at this stateId, in
+    /// increasing order, or null when count is 0
+    const int *getValidIds(int stateId, int &count) const;
+
+    /// build() flattens the automata into two dense tables, both indexed
+    /// by state id and holding the next state id, -1 for a dead path:
+    ///   eventTable[stateId * LPE_NUM_EVENT_CODES + ev * LPE_NUM_EVENT_SCATTERING_TYPES + evs]
+    ///     covers the event and scattering type steps,
+    ///   labelTable[stateId * numLabelColumns + labelId + 1]
+    ///     covers the label and the closing stop steps.
+    /// The tables are cache line aligned.  Both are null if the machine has
+    /// no expressions or is too large to flatten, transition() then walks
+    /// the automata instead.
+    void getDenseTables(const int *&eventTable, const int *&labelTable, int &numLabelColumns) const;
+
 private:
     class Impl;
 
@@ -5,6 +5,7 @@
 //
 
 #pragma once
+#include "QueueSizeController.h"
 #include "ThreadLocalState.h"
 #include <scene_rdl2/render/util/Arena.h>
 #include <scene_rdl2/render/util/SortUtil.h>
@@ -101,6 +102,22 @@ public:
         return unsigned(mQueueSize);
     }
 
+    unsigned getNumQueued() const
+    {
+        return unsigned(mNumQueued);
+    }
+
+    // Handler timings used to adapt the queue size, see QueueSizeController.
+    const QueueFlushStats &getFlushStats() const
+    {
+        return mFlushStats;
+    }
+
+    void resetFlushStats()
+    {
+        mFlushStats.reset();
+    }
+
     bool isValid() const
     {
         MNRY_ASSERT(mMaxEntries > 0);
@@ -196,10 +213,13 @@ protected:
 
         // Call handler. The entries are only valid for the duration of this call.
         // Other threads may also call this handler simultaneously with different entries.
+        const unsigned queueSize = mQueueSize;
+        const uint64_t startTicks = getProfileAccumulatorTicks();
         ++tls->mHandlerStackDepth;
         (*mHandler)(tls, entriesToFlush, entries, mHandlerData);
         MNRY_ASSERT(tls->mHandlerStackDepth > 0);
         --tls->mHandlerStackDepth;
+        mFlushStats.record(queueSize, entriesToFlush, getProfileAccumulatorTicks() - startTicks);
 
         return unsigned(entriesToFlush);
     }
@@ -210,6 +230,7 @@ protected:
     Handler                 mHandler;
     void *                  mHandlerData;
     uint32_t                mNumQueued;
+    QueueFlushStats         mFlushStats;
 };
 
 //-------------------------------------------------------------------------
@@ -296,6 +317,22 @@ public:
         return unsigned(mQueueSize);
     }
 
+    unsigned getNumQueued() const
+    {
+        return unsigned(mNumQueued);
+    }
+
+    // Handler timings used to adapt the queue size, see QueueSizeController.
+    const QueueFlushStats &getFlushStats() const
+    {
+        return mFlushStats;
+    }
+
+    void resetFlushStats()
+    {
+        mFlushStats.reset();
+    }
+
     bool isValid() const
     {
         MNRY_ASSERT(mMaxEntries > 0);
@@ -396,10 +433,13 @@ protected:
 
         // Call handler. The entries are only valid for the duration of this call.
         // Other threads may also call this handler simultaneously with different entries.
+        const unsigned queueSize = mQueueSize;
+        const uint64_t startTicks = getProfileAccumulatorTicks();
         ++tls->mHandlerStackDepth;
         (*mHandler)(tls, entriesToFlush, entries, mHandlerData);
         MNRY_ASSERT(tls->mHandlerStackDepth > 0);
         --tls->mHandlerStackDepth;
+        mFlushStats.record(queueSize, entriesToFlush, getProfileAccumulatorTicks() - startTicks);
 
         // Copy the left overs back into the primary queue.
         for (uint32_t i = 0; i < mNumQueued; ++i) {
@@ -477,10 +517,13 @@ protected:
 
         // Call handler. The entries are only valid for the duration of this call.
         // Other threads may also call this handler simultaneously with different entries.
+        const unsigned queueSize = mQueueSize;
+        const uint64_t startTicks = getProfileAccumulatorTicks();
         ++tls->mHandlerStackDepth;
         (*mHandler)(tls, entriesToFlush, entries, mHandlerData);
         MNRY_ASSERT(tls->mHandlerStackDepth > 0);
         --tls->mHandlerStackDepth;
+        mFlushStats.record(queueSize, entriesToFlush, getProfileAccumulatorTicks() - startTicks);
 
         // Copy the left overs back into the primary queue.
         for (uint32_t i = 0; i < mNumQueued; ++i) {
@@ -502,6 +545,7 @@ protected:
     Handler                 mHandler;
     void *                  mHandlerData;
     uint32_t                mNumQueued;
+    QueueFlushStats         mFlushStats;
 };
 
 //-------------------------------------------------------------------------
@@ -0,0 +1,246 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "HugePageUtil.h"
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <cstring>
+#include <vector>
+
+#ifndef PLATFORM_APPLE
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <cstdlib>
+#endif // end ifndef PLATFORM_APPLE
+
+namespace moonray {
+namespace mcrt_common {
+
+namespace {
+
+#ifndef PLATFORM_APPLE
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+size_t
+roundUpToHugePages(size_t size)
+{
+    return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+// Maps size bytes aligned to HUGE_PAGE_SIZE out of an over sized regular mapping.
+void *
+mapAligned(size_t size)
+{
+    const size_t mapSize = size + HUGE_PAGE_SIZE;
+    void *map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(map);
+    const uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) {
+        munmap(map, aligned - start);
+    }
+    const uintptr_t end = start + mapSize;
+    if (end > aligned + size) {
+        munmap(reinterpret_cast<void *>(aligned + size), end - (aligned + size));
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+
+int
+openDtlbCounter(uint64_t result)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (result << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // Calling thread, any cpu.
+    const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return static_cast<int>(fd);
+}
+
+uint64_t
+readCounter(int fd)
+{
+    uint64_t count = 0;
+    if (fd >= 0 && ::read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+    return count;
+}
+#endif // end ifndef PLATFORM_APPLE
+
+} // namespace
+
+const char *
+showHugePageMode(HugePageMode mode)
+{
+    switch (mode) {
+    case HugePageMode::OFF:         return "off";
+    case HugePageMode::TRANSPARENT: return "transparent";
+    case HugePageMode::EXPLICIT:    return "explicit";
+    }
+    return "?";
+}
+
+void *
+allocHugePageBacked(size_t size, HugePageMode mode, HugePageMode *usedMode)
+{
+#ifndef PLATFORM_APPLE
+    size = roundUpToHugePages(size);
+
+    if (mode == HugePageMode::EXPLICIT) {
+        void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (addr != MAP_FAILED) {
+            if (usedMode) *usedMode = HugePageMode::EXPLICIT;
+            return addr;
+        }
+        mode = HugePageMode::TRANSPARENT; // hugetlbfs pool too small or not configured
+    }
+
+    void *addr = mapAligned(size);
+    if (!addr) {
+        return nullptr;
+    }
+    if (mode == HugePageMode::TRANSPARENT && madvise(addr, size, MADV_HUGEPAGE) != 0) {
+        mode = HugePageMode::OFF;
+    }
+    if (usedMode) *usedMode = mode;
+    return addr;
+#else
+    void *addr = nullptr;
+    if (posix_memalign(&addr, HUGE_PAGE_SIZE, size) != 0) {
+        return nullptr;
+    }
+    memset(addr, 0, size);
+    if (usedMode) *usedMode = HugePageMode::OFF;
+    return addr;
+#endif
+}
+
+void
+freeHugePageBacked(void *addr, size_t size)
+{
+    if (!addr) return;
+#ifndef PLATFORM_APPLE
+    munmap(addr, roundUpToHugePages(size));
+#else
+    free(addr);
+#endif
+}
+
+size_t
+getResidentBytes(const void *addr, size_t size)
+{
+#ifndef PLATFORM_APPLE
+    static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + size;
+    if (!addr || end <= start) {
+        return 0;
+    }
+
+    std::vector<unsigned char> pages((end - start + pageSize - 1) / pageSize);
+    if (mincore(reinterpret_cast<void *>(start), end - start, pages.data()) != 0) {
+        return 0;
+    }
+
+    size_t numResident = 0;
+    for (unsigned char page : pages) {
+        numResident += page & 1;
+    }
+    return numResident * pageSize;
+#else
+    return 0;
+#endif
+}
+
+bool
+releasePages(void *addr, size_t size)
+{
+#ifndef PLATFORM_APPLE
+    static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(addr) + pageSize - 1) & ~(pageSize - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) & ~(pageSize - 1);
+    if (end <= start) {
+        return true; // nothing but partial pages
+    }
+    return madvise(reinterpret_cast<void *>(start), end - start, MADV_DONTNEED) == 0;
+#else
+    return false;
+#endif
+}
+
+bool
+adviseHugePages(void *addr, size_t size)
+{
+#ifndef PLATFORM_APPLE
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(addr) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) & ~(HUGE_PAGE_SIZE - 1);
+    if (end <= start) {
+        return false; // smaller than a huge page
+    }
+    return madvise(reinterpret_cast<void *>(start), end - start, MADV_HUGEPAGE) == 0;
+#else
+    return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+
+DtlbMissCounter::DtlbMissCounter(bool enable)
+{
+#ifndef PLATFORM_APPLE
+    if (enable) {
+        mAccessFd = openDtlbCounter(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+        mMissFd = openDtlbCounter(PERF_COUNT_HW_CACHE_RESULT_MISS);
+    }
+#endif
+}
+
+DtlbMissCounter::~DtlbMissCounter()
+{
+#ifndef PLATFORM_APPLE
+    if (mAccessFd >= 0) close(mAccessFd);
+    if (mMissFd >= 0) close(mMissFd);
+#endif
+}
+
+void
+DtlbMissCounter::read(uint64_t &accesses, uint64_t &misses) const
+{
+#ifndef PLATFORM_APPLE
+    accesses = readCounter(mAccessFd);
+    misses = readCounter(mMissFd);
+#else
+    accesses = 0;
+    misses = 0;
+#endif
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
@@ -0,0 +1,91 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace moonray {
+namespace mcrt_common {
+
+//
+// How the large, long lived render memory (the RayState and CL1 pools, the film
+// buffers and the BVH) is backed:
+//   OFF         : regular pages.
+//   TRANSPARENT : 2MB transparent huge pages, the kernel promotes the memory when it
+//                 can. Needs /sys/kernel/mm/transparent_hugepage/enabled set to
+//                 "madvise" or "always".
+//   EXPLICIT    : pages from the reserved 2MB hugetlbfs pool (vm.nr_hugepages), with
+//                 a fall back to transparent huge pages if the pool runs dry.
+//
+enum class HugePageMode
+{
+    OFF,
+    TRANSPARENT,
+    EXPLICIT
+};
+
+const char *showHugePageMode(HugePageMode mode);
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+//
+// Maps size bytes, rounded up to whole huge pages, backed as requested by mode.
+// The memory is zeroed, aligned to HUGE_PAGE_SIZE and only committed as it gets
+// touched, so large reservations are cheap. usedMode, if given, receives
+// the backing actually obtained. Returns nullptr on failure. The block must be
+// released with freeHugePageBacked() and the same size.
+//
+void *allocHugePageBacked(size_t size, HugePageMode mode, HugePageMode *usedMode = nullptr);
+void freeHugePageBacked(void *addr, size_t size);
+
+//
+// Bytes of [addr, addr + size) currently backed by physical memory, rounded to
+// whole pages.
+//
+size_t getResidentBytes(const void *addr, size_t size);
+
+//
+// Hands the physical pages which lie entirely inside [addr, addr + size) back to
+// the system. The range stays mapped and reads back as zero when touched again.
+// Returns false if the kernel refused.
+//
+bool releasePages(void *addr, size_t size);
+
+//
+// Asks for transparent huge pages on the 2MB aligned part of [addr, addr + size),
+// for memory which was allocated elsewhere. Pages already touched are collapsed
+// later by khugepaged. Returns false if nothing could be advised.
+//
+bool adviseHugePages(void *addr, size_t size);
+
+//
+// Counts the data TLB load accesses and misses of the calling thread, user space
+// only, from construction until read. Either count is left at zero if the cpu or
+// the kernel (see perf_event_paranoid) doesn't provide it. Not thread-safe, a
+// counter must be read by the thread which created it.
+//
+class DtlbMissCounter
+{
+public:
+    explicit DtlbMissCounter(bool enable);
+    ~DtlbMissCounter();
+
+    DtlbMissCounter(const DtlbMissCounter &) = delete;
+    DtlbMissCounter &operator=(const DtlbMissCounter &) = delete;
+
+    bool isValid() const { return mMissFd >= 0; }
+
+    void read(uint64_t &accesses, uint64_t &misses) const;
+
+private:
+    int mAccessFd {-1};
+    int mMissFd {-1};
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
@@ -0,0 +1,247 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "NumaUtil.h"
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifndef PLATFORM_APPLE
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // end ifndef PLATFORM_APPLE
+
+namespace moonray {
+namespace mcrt_common {
+
+namespace {
+
+#ifndef PLATFORM_APPLE
+// Parses a sysfs cpu list like "0-15,32-47".
+bool
+parseCpuList(const std::string &str, std::vector<unsigned> &cpus)
+{
+    std::istringstream istr(str);
+    std::string range;
+    while (std::getline(istr, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        try {
+            const size_t dash = range.find('-');
+            const unsigned first = std::stoul(range.substr(0, dash));
+            const unsigned last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+            for (unsigned cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception &) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif // end ifndef PLATFORM_APPLE
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+NumaTopology::NumaTopology()
+{
+#ifndef PLATFORM_APPLE
+    // Node ids may have holes, so probe until a few ids in a row are missing.
+    constexpr unsigned maxMissingNodes = 8;
+    for (unsigned node = 0, missing = 0; missing < maxMissingNodes; ++node) {
+        std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpuList;
+        if (!ifs || !std::getline(ifs, cpuList)) {
+            ++missing;
+            continue;
+        }
+        missing = 0;
+
+        std::vector<unsigned> cpus;
+        if (!parseCpuList(cpuList, cpus) || cpus.empty()) {
+            continue; // memory only node
+        }
+        mNodeIds.push_back(node);
+        mNodeCpus.push_back(std::move(cpus));
+    }
+#endif // end ifndef PLATFORM_APPLE
+
+    if (mNodeCpus.empty()) {
+        std::vector<unsigned> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+        for (unsigned i = 0; i < cpus.size(); ++i) cpus[i] = i;
+        mNodeIds.assign(1, 0);
+        mNodeCpus.assign(1, std::move(cpus));
+    }
+
+    for (unsigned i = 0; i < mNodeCpus.size(); ++i) {
+        for (unsigned cpu : mNodeCpus[i]) {
+            if (cpu >= mCpuNode.size()) mCpuNode.resize(cpu + 1, 0);
+            mCpuNode[cpu] = mNodeIds[i];
+        }
+    }
+}
+
+bool
+NumaTopology::makeThreadPlacement(unsigned numThreads,
+                                  std::vector<unsigned> &cpuIdTbl,
+                                  std::vector<unsigned> &nodeTbl) const
+{
+    const unsigned numNodes = getNumNodes();
+    if (numNodes < 2 || numThreads == 0) {
+        return false;
+    }
+
+    size_t numCpus = 0;
+    for (const auto &cpus : mNodeCpus) numCpus += cpus.size();
+
+    // Largest remainder split of the threads over the nodes.
+    std::vector<unsigned> nodeThreads(numNodes);
+    std::vector<std::pair<size_t, unsigned>> remainders(numNodes);
+    unsigned assigned = 0;
+    for (unsigned node = 0; node < numNodes; ++node) {
+        const size_t share = static_cast<size_t>(numThreads) * mNodeCpus[node].size();
+        nodeThreads[node] = static_cast<unsigned>(share / numCpus);
+        remainders[node] = {share % numCpus, node};
+        assigned += nodeThreads[node];
+    }
+    std::stable_sort(remainders.begin(), remainders.end(),
+                     [](const std::pair<size_t, unsigned> &a, const std::pair<size_t, unsigned> &b) {
+                         return a.first > b.first;
+                     });
+    for (unsigned i = 0; assigned < numThreads; ++i, ++assigned) {
+        ++nodeThreads[remainders[i % numNodes].second];
+    }
+
+    cpuIdTbl.clear();
+    nodeTbl.clear();
+    cpuIdTbl.reserve(numThreads);
+    nodeTbl.reserve(numThreads);
+    for (unsigned node = 0; node < numNodes; ++node) {
+        const std::vector<unsigned> &cpus = mNodeCpus[node];
+        for (unsigned i = 0; i < nodeThreads[node]; ++i) {
+            cpuIdTbl.push_back(cpus[i % cpus.size()]);
+            nodeTbl.push_back(mNodeIds[node]);
+        }
+    }
+    return true;
+}
+
+std::string
+NumaTopology::show() const
+{
+    std::ostringstream ostr;
+    ostr << "NumaTopology {\n";
+    for (unsigned node = 0; node < getNumNodes(); ++node) {
+        const std::vector<unsigned> &cpus = mNodeCpus[node];
+        ostr << "  node:" << mNodeIds[node] << " cpus:" << cpus.size();
+        if (!cpus.empty()) {
+            ostr << " (" << cpus.front() << "~" << cpus.back() << ")";
+        }
+        ostr << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+//-----------------------------------------------------------------------------
+
+NumaThreadSlots::NumaThreadSlots(const std::vector<unsigned> &cpuIdTbl,
+                                 const std::vector<unsigned> &nodeTbl,
+                                 unsigned numSlots) :
+    mNodeTbl(nodeTbl.begin(), nodeTbl.begin() + std::min<size_t>(numSlots, nodeTbl.size())),
+    mClaimed(new std::atomic<bool>[mNodeTbl.size()])
+{
+    for (size_t i = 0; i < mNodeTbl.size(); ++i) {
+        mClaimed[i].store(false, std::memory_order_relaxed);
+
+        const unsigned cpu = cpuIdTbl[i];
+        if (cpu >= mCpuNode.size()) mCpuNode.resize(cpu + 1, 0);
+        mCpuNode[cpu] = mNodeTbl[i];
+    }
+}
+
+unsigned
+NumaThreadSlots::claim()
+{
+    const unsigned cpu = getCurrentCpu();
+    const unsigned node = (cpu < mCpuNode.size()) ? mCpuNode[cpu] : 0;
+
+    // Own node first, then whatever is left.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < mNodeTbl.size(); ++i) {
+            if (pass == 0 && mNodeTbl[i] != node) continue;
+            if (!mClaimed[i].load(std::memory_order_relaxed) &&
+                !mClaimed[i].exchange(true, std::memory_order_acq_rel)) {
+                return static_cast<unsigned>(i);
+            }
+        }
+    }
+
+    MNRY_ASSERT(!"More claims than NUMA thread slots");
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+unsigned
+getCurrentCpu()
+{
+#ifndef PLATFORM_APPLE
+    const int cpu = sched_getcpu();
+    return (cpu < 0) ? 0u : static_cast<unsigned>(cpu);
+#else
+    return 0;
+#endif
+}
+
+bool
+bindCurrentThreadToCpu(unsigned cpuId)
+{
+#ifndef PLATFORM_APPLE
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpuId, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+#else
+    return false;
+#endif
+}
+
+bool
+numaBindMemory(void *addr, size_t size, unsigned node)
+{
+#ifndef PLATFORM_APPLE
+    static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(addr) + pageSize - 1) & ~(pageSize - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) & ~(pageSize - 1);
+    if (end <= start) {
+        return true; // nothing but partial pages
+    }
+
+    constexpr unsigned bitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(node / bitsPerWord + 1, 0ul);
+    nodeMask[node / bitsPerWord] = 1ul << (node % bitsPerWord);
+
+    // The kernel wants the mask size in bits plus one.
+    const unsigned long maxNode = nodeMask.size() * bitsPerWord + 1;
+    return syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, nodeMask.data(), maxNode, MPOL_MF_MOVE) == 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
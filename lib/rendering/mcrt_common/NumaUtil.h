@@ -0,0 +1,98 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace mcrt_common {
+
+//
+// NUMA topology of the machine as reported by /sys/devices/system/node.
+// Machines without NUMA information and non-Linux platforms report a single
+// node which holds every cpu.
+//
+class NumaTopology
+{
+public:
+    NumaTopology();
+
+    // Nodes are numbered 0 to getNumNodes() - 1 here, getNodeId() returns the
+    // kernel's id of a node, which is what the tables below hold.
+    unsigned getNumNodes() const { return static_cast<unsigned>(mNodeCpus.size()); }
+    unsigned getNodeId(unsigned node) const { return mNodeIds[node]; }
+    const std::vector<unsigned> &getNodeCpus(unsigned node) const { return mNodeCpus[node]; }
+
+    // Kernel id of the node of cpuId, 0 for cpus the topology doesn't know about.
+    unsigned getNodeOfCpu(unsigned cpuId) const
+    {
+        return (cpuId < mCpuNode.size()) ? mCpuNode[cpuId] : 0;
+    }
+
+    //
+    // Spreads numThreads render threads over the nodes in proportion to the
+    // number of cpus of each node. Threads of the same node get consecutive
+    // indices, so cpuIdTbl[i] is the cpu thread i is pinned to and nodeTbl[i]
+    // is the kernel id of its node. Nodes run more than one thread per cpu if
+    // numThreads exceeds the number of cpus.
+    //
+    // Returns false, and leaves the tables untouched, on single node machines.
+    //
+    bool makeThreadPlacement(unsigned numThreads,
+                             std::vector<unsigned> &cpuIdTbl,
+                             std::vector<unsigned> &nodeTbl) const;
+
+    std::string show() const;
+
+private:
+    std::vector<unsigned>              mNodeIds;
+    std::vector<std::vector<unsigned>> mNodeCpus;
+    std::vector<unsigned>              mCpuNode;  // Indexed by cpu id.
+};
+
+//
+// Hands out the slots of a NUMA thread placement, i.e. the render TLS objects,
+// to whichever threads end up running the render tasks. A thread claims a free
+// slot on the node of the cpu it runs on, or any free slot if its node has
+// none left. Thread-safe.
+//
+class NumaThreadSlots
+{
+public:
+    NumaThreadSlots(const std::vector<unsigned> &cpuIdTbl,
+                    const std::vector<unsigned> &nodeTbl,
+                    unsigned numSlots);
+
+    // Each call returns a different slot, at most numSlots calls are allowed.
+    unsigned claim();
+
+private:
+    std::vector<unsigned>                mNodeTbl;
+    std::vector<unsigned>                mCpuNode;
+    std::unique_ptr<std::atomic<bool>[]> mClaimed;
+};
+
+// Cpu the calling thread currently runs on, 0 if unknown.
+unsigned getCurrentCpu();
+
+// Pins the calling thread to a single cpu. Returns false on failure.
+bool bindCurrentThreadToCpu(unsigned cpuId);
+
+//
+// Moves the pages which lie entirely inside [addr, addr + size) onto the given
+// node and makes it the preferred node of those which are not touched yet.
+// Pages shared with neighbouring memory are left alone. Returns false if the
+// kernel refused, which is not fatal since the memory stays usable wherever it
+// is.
+//
+bool numaBindMemory(void *addr, size_t size, unsigned node);
+
+} // namespace mcrt_common
+} // namespace moonray
+
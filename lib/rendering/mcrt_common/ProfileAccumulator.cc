@@ -161,6 +161,8 @@ snapshotRawAccumulators(std::vector<AccumulatorResult> *dstResults, double rcpTi
     rootResult.mTotalTime = wallClockTime * double(gPrivate.mNumThreads);
     rootResult.mTimePerThread = wallClockTime;
     rootResult.mPercentageOfTotal = 100.0;
+    rootResult.mActiveLanes = 0;
+    rootResult.mTotalLanes = 0;
 
     // Gather remaining results.
     const double rcpNumThreads = 1.0 / double(gPrivate.mNumThreads);
@@ -179,6 +181,7 @@ snapshotRawAccumulators(std::vector<AccumulatorResult> *dstResults, double rcpTi
         result.mTotalTime = double(ticks) * rcpTickFrequency;
         result.mTimePerThread = result.mTotalTime * rcpNumThreads;
         result.mPercentageOfTotal = result.mTimePerThread * rcpWallClockTime * 100.0;
+        acc->getAccumulatedLanes(&result.mActiveLanes, &result.mTotalLanes);
 
         ++numResults;
     }
@@ -280,6 +283,20 @@ uint64_t Accumulator::getAccumulatedTicks() const
     return localTicks;
 }
 
+void Accumulator::getAccumulatedLanes(uint64_t *activeLanes, uint64_t *totalLanes) const
+{
+    MNRY_ASSERT(activeLanes && totalLanes);
+
+    *activeLanes = 0;
+    *totalLanes = 0;
+
+    for (unsigned i = 0; i < gPrivate.mNumThreads; ++i) {
+        const auto &tla = mThreadLocal[i];
+        *activeLanes += tla.mActiveLanes;
+        *totalLanes += tla.mTotalLanes;
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 } //namespace mcrt_common
@@ -77,7 +77,9 @@ struct AccumulatorResult
         mFlags(ACCFLAG_NONE),
         mTotalTime(0.0),
         mTimePerThread(0.0),
-        mPercentageOfTotal(0.0) {}
+        mPercentageOfTotal(0.0),
+        mActiveLanes(0),
+        mTotalLanes(0) {}
 
     const char *mName;
     AccumulatorFlags mFlags;
@@ -91,6 +93,12 @@ struct AccumulatorResult
     // Assuming we were running in parallel the whole time, this is the percentage
     // of the total time recorded by this accumulator.
     double mPercentageOfTotal;
+
+    // The number of active and available SIMD lanes recorded by the vectorized
+    // code timed by this accumulator, summed over all threads. Both are zero
+    // for accumulators which don't record lane utilization.
+    uint64_t mActiveLanes;
+    uint64_t mTotalLanes;
 };
 
 //-----------------------------------------------------------------------------
@@ -229,6 +237,16 @@ struct CACHE_ALIGN ThreadLocalAccumulator
         MNRY_ASSERT(--gNumAccumulatorsActive >= 0);
     }
 
+    // Records how many of the available SIMD lanes were active for a single
+    // varying invocation. Unlike start/stop, this may be called any number of
+    // times while the timer is running.
+    __forceinline void addLanes(unsigned activeLanes, unsigned totalLanes)
+    {
+        MNRY_ASSERT(activeLanes <= totalLanes);
+        mActiveLanes += activeLanes;
+        mTotalLanes += totalLanes;
+    }
+
     __forceinline bool canStart() const
     {
         return !mTimerActive;
@@ -241,6 +259,8 @@ struct CACHE_ALIGN ThreadLocalAccumulator
 
     uint64_t    mLastStartTime;
     uint64_t    mTotalTime;
+    uint64_t    mActiveLanes;
+    uint64_t    mTotalLanes;
     unsigned    mTotalCallCount;
     bool        mTimerActive;
 };
@@ -258,6 +278,7 @@ struct Accumulator
 
     void reset();
     uint64_t getAccumulatedTicks() const;
+    void getAccumulatedLanes(uint64_t *activeLanes, uint64_t *totalLanes) const;
 
     std::string             mName;
     unsigned                mIndex; // A zero based index determined by the creation order.
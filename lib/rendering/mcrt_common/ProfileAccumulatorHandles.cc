@@ -6,6 +6,11 @@
 
 #include "ProfileAccumulatorHandles.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 namespace moonray {
 namespace mcrt_common {
 
@@ -89,6 +94,35 @@ conditionTimes(std::vector<double> &times)
 
 #endif  // #ifdef PROFILE_ACCUMULATORS_ENABLED
 
+// Sampling profiler state, see setExclusiveAccumulatorSamplingInterval().
+unsigned gSamplingInterval = 0;                     // microseconds
+std::vector<ExclusiveAccumulators *> gSampledThreads; // indexed by render thread
+std::atomic<bool> gStopSampling(false);
+std::thread gSamplingThread;
+
+void
+samplingLoop()
+{
+    const std::chrono::microseconds interval(gSamplingInterval);
+    uint64_t lastTicks = getProfileAccumulatorTicks();
+
+    while (!gStopSampling.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(interval);
+
+        // The time since the previous sample goes to the accumulator each
+        // thread is in now. Only this thread writes their time while sampling.
+        const uint64_t ticks = getProfileAccumulatorTicks();
+        const uint64_t elapsed = ticks - lastTicks;
+        lastTicks = ticks;
+        for (const ExclusiveAccumulators *exclAcc : gSampledThreads) {
+            ThreadLocalAccumulator *acc = exclAcc ? exclAcc->getSampledAccumulator() : nullptr;
+            if (acc) {
+                acc->mTotalTime += elapsed;
+            }
+        }
+    }
+}
+
 }  // End of anon namespace.
 
 AccumulatorHandles gAccumulatorHandles;
@@ -141,6 +175,7 @@ AccumulatorHandles::init(unsigned numThreads, unsigned numTLS)
     mExclusiveAccumulators[EXCL_ACCUM_UNRECORDED]               = allocAccumulator("Unrecorded", ACCFLAG_DISPLAYABLE);
     mExclusiveAccumulators[EXCL_ACCUM_VOL_INTEGRATION]          = allocAccumulator("Volume integration", ACCFLAG_DISPLAYABLE);
     mExclusiveAccumulators[EXCL_BUILD_ADAPTIVE_TREE]            = allocAccumulator("Adaptive tree rebuild", ACCFLAG_DISPLAYABLE);
+    mExclusiveAccumulators[EXCL_ADAPTIVE_PIXEL_ERROR]           = allocAccumulator("Adaptive pixel error", ACCFLAG_DISPLAYABLE);
     mExclusiveAccumulators[EXCL_QUERY_ADAPTIVE_TREE]            = allocAccumulator("Adaptive tree query", ACCFLAG_DISPLAYABLE);
     mExclusiveAccumulators[EXCL_EXCL_LOCK_ADAPTIVE_TREE]        = allocAccumulator("Adaptive tree exclusive lock", ACCFLAG_DISPLAYABLE);
 
@@ -208,6 +243,8 @@ AccumulatorHandles::init(unsigned numThreads, unsigned numTLS)
         MNRY_ASSERT(mInternalAccumulators[i]);
     }
 
+    gSampledThreads.assign(numThreads, nullptr);
+
     // Reset accumulators.
     resetAllAccumulators();
 }
@@ -215,6 +252,9 @@ AccumulatorHandles::init(unsigned numThreads, unsigned numTLS)
 void
 AccumulatorHandles::cleanUp()
 {
+    stopExclusiveAccumulatorSampling();
+    gSampledThreads.clear();
+
     cleanUpAccumulators();
 
     // False positive from cppcheck, this struct doesn't contain a std::string!
@@ -301,6 +341,39 @@ snapshotAccumulators(std::vector<AccumulatorResult> *dstResults,
 #endif
 }
 
+void
+setExclusiveAccumulatorSamplingInterval(unsigned microseconds)
+{
+    MNRY_ASSERT(!gSamplingThread.joinable());
+    gSamplingInterval = microseconds;
+}
+
+unsigned
+getExclusiveAccumulatorSamplingInterval()
+{
+    return gSamplingInterval;
+}
+
+void
+startExclusiveAccumulatorSampling()
+{
+#ifdef PROFILE_ACCUMULATORS_ENABLED
+    if (gSamplingInterval && !gSamplingThread.joinable()) {
+        gStopSampling = false;
+        gSamplingThread = std::thread(samplingLoop);
+    }
+#endif
+}
+
+void
+stopExclusiveAccumulatorSampling()
+{
+    if (gSamplingThread.joinable()) {
+        gStopSampling = true;
+        gSamplingThread.join();
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 ExclusiveAccumulators::ExclusiveAccumulators()
@@ -317,6 +390,12 @@ ExclusiveAccumulators::cacheThreadLocalAccumulators(unsigned threadIdx)
         mAccumulators[i] = MNRY_VERIFY(&gAccumulatorHandles.mExclusiveAccumulators[i]->mThreadLocal[threadIdx]);
         MNRY_ASSERT(mAccumulators[i]->canStart());
     }
+
+    // The main and GUI thread TLS aren't part of the render stats.
+    mSampled = gSamplingInterval != 0;
+    if (threadIdx < gSampledThreads.size()) {
+        gSampledThreads[threadIdx] = this;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -354,6 +433,13 @@ CPP_stopOverlappedAccumulator(intptr_t acc)
     tlAcc->stop();
 }
 
+void
+CPP_addExclusiveAccumulatorLanes(pbr::TLState *tls, ExclAccType type,
+                                 uint32_t activeLanes, uint32_t totalLanes)
+{
+    EXCL_ACCUMULATOR_ADD_LANES(tls, type, activeLanes, totalLanes);
+}
+
 }
 
 } //namespace mcrt_common
@@ -19,11 +19,15 @@
     #define EXCL_ACCUMULATOR_GET_AND_START(tls, type, handle)   moonray::mcrt_common::ScopedExclAccumulator handle(getExclusiveAccumulators(tls), (type))
     #define EXCL_ACCUMULATOR_STOP(handle)                       handle.pop()
     #define EXCL_ACCUMULATOR_IS_RUNNING(tls, type)              (getExclusiveAccumulators(tls)->isRunning(type))
+    // Records the SIMD lane utilization of a varying invocation against the
+    // accumulator of the given type.
+    #define EXCL_ACCUMULATOR_ADD_LANES(tls, type, active, total) (getExclusiveAccumulators(tls)->addLanes((type), (active), (total)))
 #else
     #define EXCL_ACCUMULATOR_PROFILE(tls, type)
     #define EXCL_ACCUMULATOR_GET_AND_START(tls, type, handle)
     #define EXCL_ACCUMULATOR_STOP(handle)
     #define EXCL_ACCUMULATOR_IS_RUNNING(tls, type)
+    #define EXCL_ACCUMULATOR_ADD_LANES(tls, type, active, total)
 #endif
 
 #define TLS_OFFSET_TO_EXCL_ACCUMULATORS                         56u
@@ -82,6 +86,23 @@ unsigned snapshotAccumulators(std::vector<mcrt_common::AccumulatorResult> *dstRe
                               double rcpTickFrequency,
                               double threshold);
 
+//
+// Sampling profiler mode of the exclusive accumulators. Instead of reading the
+// time stamp counter on every push and pop, the render threads only publish
+// which accumulator is on top of their stack. A sampling thread running
+// through the MCRT phase credits each interval to the accumulator every render
+// thread is in. The exclusive times become statistical estimates, without the
+// cost of timing blocks which are entered and left at a high rate. An interval
+// of 0 (the default) times every block.
+//
+void setExclusiveAccumulatorSamplingInterval(unsigned microseconds);
+unsigned getExclusiveAccumulatorSamplingInterval();
+
+// Called around the MCRT phase of a frame, after the render threads called
+// cacheThreadLocalAccumulators(). They do nothing unless an interval is set.
+void startExclusiveAccumulatorSampling();
+void stopExclusiveAccumulatorSampling();
+
 //-----------------------------------------------------------------------------
 
 //
@@ -111,6 +132,16 @@ public:
 
     inline unsigned getStackSize() const   { return mStackSize; }
 
+    // The accumulator on top of the stack, or null outside of any exclusive
+    // block. Only published in sampling mode, read by the sampling thread.
+    inline ThreadLocalAccumulator *getSampledAccumulator() const
+    {
+        return mSampledTop.load(std::memory_order_relaxed);
+    }
+
+    // Lane utilization can be recorded whether or not the accumulator is running.
+    inline void     addLanes(ExclAccType type, unsigned activeLanes, unsigned totalLanes);
+
 private:
     inline void     startAccumulator(ThreadLocalAccumulator *acc);
     inline void     stopAccumulator(ThreadLocalAccumulator *acc);
@@ -120,6 +151,8 @@ private:
     ThreadLocalAccumulator *mAccumulators[NUM_EXCLUSIVE_ACC];
     CACHE_ALIGN uint32_t    mPad;
     uint32_t                mStackSize;
+    bool                    mSampled;       // The sampling thread accumulates the time.
+    std::atomic<ThreadLocalAccumulator *> mSampledTop;
     ThreadLocalAccumulator *mStack[MAX_EXCL_ACCUM_STACK_SIZE];
 };
 
@@ -136,6 +169,16 @@ ExclusiveAccumulators::isValid() const
     return true;
 }
 
+inline void
+ExclusiveAccumulators::addLanes(ExclAccType type, unsigned activeLanes, unsigned totalLanes)
+{
+    MNRY_ASSERT(type < NUM_EXCLUSIVE_ACC);
+
+#ifdef PROFILE_ACCUMULATORS_ENABLED
+    MNRY_VERIFY(mAccumulators[type])->addLanes(activeLanes, totalLanes);
+#endif
+}
+
 inline bool
 ExclusiveAccumulators::push(ExclAccType type)
 {
@@ -181,7 +224,13 @@ ExclusiveAccumulators::startAccumulator(ThreadLocalAccumulator *acc)
 
 #ifdef PROFILE_ACCUMULATORS_ENABLED
     MNRY_ASSERT(!isRunning(acc));
-    MNRY_VERIFY(acc)->start();
+    if (mSampled) {
+        ++acc->mTotalCallCount;
+        acc->mTimerActive = true;
+        mSampledTop.store(acc, std::memory_order_relaxed);
+    } else {
+        MNRY_VERIFY(acc)->start();
+    }
 #else
     uint64_t &active = reinterpret_cast<uint64_t &>(acc);
     ++active;
@@ -195,7 +244,12 @@ ExclusiveAccumulators::stopAccumulator(ThreadLocalAccumulator *acc)
 
 #ifdef PROFILE_ACCUMULATORS_ENABLED
     MNRY_ASSERT(isRunning(acc));
-    MNRY_VERIFY(acc)->stop();
+    if (mSampled) {
+        acc->mTimerActive = false;
+        mSampledTop.store(nullptr, std::memory_order_relaxed);
+    } else {
+        MNRY_VERIFY(acc)->stop();
+    }
 #else
     uint64_t &active = reinterpret_cast<uint64_t &>(acc);
     --active;
@@ -296,6 +350,9 @@ void CPP_pauseOverlappedAccumulator(intptr_t tlAcc);
 void CPP_unpauseOverlappedAccumulator(intptr_t tlAcc);
 void CPP_stopOverlappedAccumulator(intptr_t tlAcc);
 
+void CPP_addExclusiveAccumulatorLanes(pbr::TLState *tls, ExclAccType type,
+                                      uint32_t activeLanes, uint32_t totalLanes);
+
 }
 
 
@@ -111,6 +111,9 @@ enum ExclAccType
     // Time spent rebuilding adaptive tree.
     EXCL_BUILD_ADAPTIVE_TREE,
 
+    // Time spent evaluating the pixel errors for the adaptive tree rebuild.
+    EXCL_ADAPTIVE_PIXEL_ERROR,
+
     // Time spent querying adaptive tree.
     EXCL_QUERY_ADAPTIVE_TREE,
 
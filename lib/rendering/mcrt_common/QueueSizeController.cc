@@ -0,0 +1,122 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "QueueSizeController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace moonray {
+namespace mcrt_common {
+
+namespace {
+
+// Number of flushes needed before a window is trusted.
+const unsigned sMinFlushes = 8;
+
+// The first step doubles or halves the queue size, the search stops once the
+// step drops under roughly a 9% change in size.
+const float sInitialStep = 1.f;
+const float sMinStep = 0.125f;
+
+// Relative cost decrease needed for a step to count as an improvement.
+const double sMinImprovement = 0.02;
+
+// Relative cost increase which restarts the search once converged.
+const double sRestartTolerance = 0.25;
+
+// Below this occupancy the queue is considered too large.
+const double sMinOccupancy = 0.5;
+
+}   // End of anon namespace.
+
+QueueSizeController::QueueSizeController()
+{
+    reset();
+}
+
+void
+QueueSizeController::reset()
+{
+    mBestCost = -1.0;
+    mConvergedCost = 0.0;
+    mStep = sInitialStep;
+    mDirection = 1;
+    mBestSize = 0;
+    mConverged = false;
+}
+
+unsigned
+QueueSizeController::update(const QueueFlushStats &stats, unsigned maxSize)
+{
+    if (stats.mQueueSize == 0 || stats.mNumFlushes < sMinFlushes || stats.mNumEntries == 0) {
+        return 0;
+    }
+
+    const unsigned size = stats.mQueueSize;
+    const double cost = double(stats.mTicks) / double(stats.mNumEntries);
+    const bool lowOccupancy = stats.getOccupancy() < sMinOccupancy;
+
+    if (mConverged) {
+        if (cost <= mConvergedCost * (1.0 + sRestartTolerance)) {
+            return std::min(mBestSize, maxSize);
+        }
+
+        // The workload changed, restart with a smaller search range.
+        mConverged = false;
+        mStep = sInitialStep * 0.5f;
+        mBestCost = -1.0;
+    }
+
+    if (mBestCost < 0.0) {
+        mBestCost = cost;
+        mBestSize = size;
+        mDirection = lowOccupancy ? -1 : 1;
+    } else if (cost < mBestCost * (1.0 - sMinImprovement)) {
+        mBestCost = cost;
+        mBestSize = size;
+    } else {
+        // The last step didn't pay off, search the other side of the best
+        // size with a smaller step.
+        mDirection = -mDirection;
+        mStep *= 0.5f;
+    }
+
+    if (mDirection > 0 && lowOccupancy) {
+        mDirection = -1;
+    }
+
+    // Reverse once if we ran into either bound.
+    unsigned next = mStep < sMinStep ? mBestSize : step(mBestSize, maxSize);
+    if (next == mBestSize && mStep >= sMinStep) {
+        mDirection = -mDirection;
+        mStep *= 0.5f;
+        next = mStep < sMinStep ? mBestSize : step(mBestSize, maxSize);
+    }
+
+    if (next == mBestSize) {
+        mConverged = true;
+        mConvergedCost = mBestCost;
+    }
+
+    return std::min(next, maxSize);
+}
+
+unsigned
+QueueSizeController::step(unsigned size, unsigned maxSize) const
+{
+    const float scale = std::exp2(float(mDirection) * mStep);
+    unsigned next = unsigned(float(size) * scale + 0.5f);
+
+    // Keep sizes a multiple of VLEN so full flushes don't leave partial blocks.
+    next = (next + VLEN - 1) & ~(VLEN - 1);
+
+    const unsigned minSize = std::min(unsigned(VLEN), maxSize);
+    return std::max(std::min(next, maxSize), minSize);
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
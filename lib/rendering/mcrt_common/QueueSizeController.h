@@ -0,0 +1,94 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <cstdint>
+
+namespace moonray {
+namespace mcrt_common {
+
+//
+// Flush measurements gathered by a thread local queue. All the flushes in a
+// window are made at the same queue size. Recording a flush at a different
+// queue size, for example after another thread called setQueueSize(), starts
+// a new window.
+//
+struct QueueFlushStats
+{
+    void reset()
+    {
+        *this = QueueFlushStats();
+    }
+
+    finline void record(unsigned queueSize, unsigned numEntries, uint64_t ticks)
+    {
+        if (queueSize != mQueueSize) {
+            reset();
+            mQueueSize = queueSize;
+        }
+        ++mNumFlushes;
+        mNumEntries += numEntries;
+        mTicks += ticks;
+    }
+
+    // Average fraction of the queue which was filled at flush time.
+    double getOccupancy() const
+    {
+        return mNumFlushes ? double(mNumEntries) / (double(mNumFlushes) * double(mQueueSize)) : 0.0;
+    }
+
+    uint32_t mQueueSize {0};    // Queue size the flushes were made at.
+    uint32_t mNumFlushes {0};
+    uint64_t mNumEntries {0};   // Entries passed to the handler.
+    uint64_t mTicks {0};        // Ticks spent in the handler.
+};
+
+//
+// Searches for the queue size which minimizes the handler ticks spent per
+// queued entry. Small queues starve the SIMD lanes of the handlers and large
+// ones push their working set out of cache, so the cost is assumed to have a
+// single minimum between VLEN and the allocated queue size.
+//
+// The search multiplies or divides the queue size by a power of two step,
+// keeping its direction while the cost improves, and reverses and halves the
+// step once it doesn't. Low occupancy windows, where most flushes are explicit
+// flushes of a partially filled queue, only ever shrink the queue since a
+// larger queue wouldn't fill up either. Once the step is small enough the size
+// is kept as is, unless the cost drifts far enough from the converged cost to
+// restart the search.
+//
+class QueueSizeController
+{
+public:
+    QueueSizeController();
+
+    void reset();
+
+    // Returns the size to use for the queue measured by stats, clamped to
+    // [VLEN, maxSize], or 0 if more flushes are needed before deciding. When a
+    // size is returned the caller should apply it and reset the stats.
+    unsigned update(const QueueFlushStats &stats, unsigned maxSize);
+
+    bool isConverged() const    { return mConverged; }
+
+    unsigned getBestSize() const    { return mBestSize; }
+
+private:
+    unsigned step(unsigned size, unsigned maxSize) const;
+
+    double   mBestCost;     // Ticks per entry at mBestSize, negative if unknown.
+    double   mConvergedCost;
+    float    mStep;         // log2 of the size multiplier.
+    int      mDirection;    // 1 to grow, -1 to shrink.
+    unsigned mBestSize;
+    bool     mConverged;
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
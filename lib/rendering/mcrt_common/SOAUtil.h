@@ -25,7 +25,6 @@ inline void convertAOSToSOA_AVX512(unsigned numElems,
 {
     MNRY_STATIC_ASSERT(SRC_AOS_SIZE <= SRC_AOS_STRIDE);
 
-    MNRY_STATIC_ASSERT(SRC_AOS_SIZE % (AVX512_VLEN * 4) == 0);
     MNRY_STATIC_ASSERT(SRC_AOS_SIZE % (AVX512_VLEN * 4) == 0);
     MNRY_STATIC_ASSERT(SRC_AOS_STRIDE % (AVX512_VLEN * 4) == 0);
     MNRY_STATIC_ASSERT(DST_SOA_STRIDE % (AVX512_VLEN * 4) == 0);
@@ -70,7 +69,7 @@ inline void convertAOSToSOA_AVX512(unsigned numElems,
             (const uint32_t *)(&aosData[15]),
         };
 
-        aosData += AVX_VLEN;
+        aosData += AVX512_VLEN;
 
         for (unsigned i = 0; i < numChunksPerBlock; ++i) {
 
@@ -4,6 +4,7 @@
 //
 //
 #include "ThreadLocalState.h"
+#include "NumaUtil.h"
 #include "ProfileAccumulatorHandles.h"
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <moonray/common/time/Ticker.h>
@@ -12,6 +13,8 @@
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/task_scheduler_init.h>
 
+#include <thread>
+
 // There are on average 3 entries added to the profiler stack for each single
 // entry on the handler stack. This heuristic is used to compute the
 // MAX_HANDLER_STACK_SIZE.
@@ -303,8 +306,24 @@ initTLS(const TLSInitParams &initParams)
                             (scene_rdl2::util::alignedMalloc(sizeof(ThreadLocalState) * numThreads,
                             CACHE_LINE_SIZE));
 
-    for (unsigned i = 0; i < numThreads; ++i) {
-        new (&gPrivate.mTLSList[i]) ThreadLocalState(i, true);
+    const std::vector<unsigned> *numaNodeTbl = gPrivate.mInitParams.mNumaNodeTbl.get();
+    const std::vector<unsigned> *numaCpuIdTbl = gPrivate.mInitParams.mAffinityCpuIdTbl.get();
+    if (numaNodeTbl && numaCpuIdTbl &&
+        numaNodeTbl->size() >= numThreads && numaCpuIdTbl->size() >= numThreads) {
+        // Construct each TLS on a helper thread pinned to the cpu of its render thread.
+        // The queues and pools allocated by the TLState constructors are first-touch
+        // allocated on the node of the render thread that will use them.
+        for (unsigned i = 0; i < numThreads; ++i) {
+            std::thread initThread([i, numaCpuIdTbl]() {
+                bindCurrentThreadToCpu((*numaCpuIdTbl)[i]);
+                new (&gPrivate.mTLSList[i]) ThreadLocalState(i, true);
+            });
+            initThread.join();
+        }
+    } else {
+        for (unsigned i = 0; i < numThreads; ++i) {
+            new (&gPrivate.mTLSList[i]) ThreadLocalState(i, true);
+        }
     }
 
     // Create special GUI TLS here.
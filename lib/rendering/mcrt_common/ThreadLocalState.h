@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #pragma once
+#include "HugePageUtil.h"
 #include "ProfileAccumulatorHandles.h"
 #include "ThreadLocalState.hh"
 #include "Types.h"
@@ -50,6 +51,16 @@ struct TLSInitParams
     bool mEnableMcrtCpuAffinity {true};
     std::shared_ptr<std::vector<unsigned>> mAffinityCpuIdTbl; // cpuId table for CPU-Affinity mask
 
+    // NUMA aware placement of the render threads, see NumaUtil.h. When mNumaNodeTbl is
+    // set, render thread i is pinned to cpu (*mAffinityCpuIdTbl)[i] of node (*mNumaNodeTbl)[i],
+    // and its ThreadLocalState is constructed on that cpu so that the memory it touches
+    // first lands on the thread's own node.
+    bool mNumaAware {false};
+    std::shared_ptr<std::vector<unsigned>> mNumaNodeTbl;
+
+    // Backing of the shared RayState and CL1 pools, see HugePageUtil.h.
+    HugePageMode mHugePageMode {HugePageMode::OFF};
+
     scene_rdl2::alloc::ArenaBlockPool *mArenaBlockPool;
 
     // This is the total number of RayState objects allocated per thread.
@@ -67,6 +78,16 @@ struct TLSInitParams
     // by numThreads to determine the total allocation size.
     unsigned        mPerThreadCL1PoolSize;
 
+    // 0 preallocates both pools at the sizes above. Otherwise the pools reserve
+    // address space for mPoolGrowthLimit times those sizes, get backed by memory
+    // block by block as the render needs them and hand the memory back to the
+    // system after each frame.
+    unsigned        mPoolGrowthLimit {0};
+
+    // Sort each bundle of intersection rays by direction octant and origin
+    // before tracing it, see pbr::RAY_HANDLER_SORT_RAYS.
+    bool            mSortRays {false};
+
     // The number of entries in *each* thread local ray queue, set to
     // zero if not in bundled mode.
     unsigned        mRayQueueSize;
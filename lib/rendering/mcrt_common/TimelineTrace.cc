@@ -0,0 +1,234 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TimelineTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+namespace {
+
+struct TimelineEvent
+{
+    const char *mName;
+    const char *mCategory;
+    const char *mArgName;
+    int64_t mArg;
+    double mStart;
+    double mEnd;
+};
+
+//
+// Events of one thread. Only the owning thread writes to mEvents and mCount,
+// the writer reads the events below mCount after an acquire load of it.
+//
+struct ThreadBuffer
+{
+    ThreadBuffer(unsigned tid, size_t capacity) :
+        mTid(tid),
+        mEvents(capacity),
+        mEpoch(0),
+        mCount(0)
+    {
+        std::ostringstream ostr;
+        ostr << "thread " << tid;
+        mName = ostr.str();
+    }
+
+    const unsigned mTid;
+    std::string mName;  // Guarded by sRegistryMutex.
+    std::vector<TimelineEvent> mEvents;
+    std::atomic<uint64_t> mEpoch;   // Trace the events belong to.
+    std::atomic<uint64_t> mCount;   // Events recorded, mCount % capacity is the next slot.
+};
+
+std::mutex sRegistryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> sBuffers;    // Never shrinks, threads keep pointers.
+size_t sEventsPerThread = TimelineTrace::DEFAULT_EVENTS_PER_THREAD;
+
+std::atomic<uint64_t> sEpoch {0};
+std::atomic<int64_t> sOriginNs {0};
+
+thread_local ThreadBuffer *tThreadBuffer = nullptr;
+
+ThreadBuffer *
+getThreadBuffer()
+{
+    if (!tThreadBuffer) {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        sBuffers.emplace_back(new ThreadBuffer(static_cast<unsigned>(sBuffers.size()), sEventsPerThread));
+        tThreadBuffer = sBuffers.back().get();
+    }
+    return tThreadBuffer;
+}
+
+int64_t
+getClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+writeJsonString(std::ostream &out, const char *str)
+{
+    out << '"';
+    for (const char *c = str; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            out << ' ';
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> TimelineTrace::sEnabled {false};
+
+void
+TimelineTrace::enable(size_t eventsPerThread)
+{
+    {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        sEventsPerThread = std::max(eventsPerThread, size_t(1));
+    }
+    sOriginNs.store(getClockNs(), std::memory_order_relaxed);
+    // Each thread drops its old events the next time it records.
+    sEpoch.fetch_add(1, std::memory_order_release);
+    sEnabled.store(true, std::memory_order_release);
+}
+
+void
+TimelineTrace::disable()
+{
+    sEnabled.store(false, std::memory_order_release);
+}
+
+double
+TimelineTrace::now()
+{
+    return double(getClockNs() - sOriginNs.load(std::memory_order_relaxed)) * 0.001;
+}
+
+void
+TimelineTrace::record(const char *name, const char *category, double start, double end,
+                      const char *argName, int64_t arg)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    ThreadBuffer *buffer = getThreadBuffer();
+    const uint64_t epoch = sEpoch.load(std::memory_order_acquire);
+    uint64_t count = buffer->mCount.load(std::memory_order_relaxed);
+    if (buffer->mEpoch.load(std::memory_order_relaxed) != epoch) {
+        count = 0;
+        buffer->mCount.store(0, std::memory_order_relaxed);
+        buffer->mEpoch.store(epoch, std::memory_order_release);
+    }
+
+    buffer->mEvents[count % buffer->mEvents.size()] = TimelineEvent {name, category, argName, arg, start, end};
+    buffer->mCount.store(count + 1, std::memory_order_release);
+}
+
+void
+TimelineTrace::setThreadName(const std::string &name)
+{
+    ThreadBuffer *buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    buffer->mName = name;
+}
+
+bool
+TimelineTrace::writeChromeTrace(const std::string &filename)
+{
+    std::ofstream out(filename);
+    if (!out) {
+        return false;
+    }
+
+    const int pid = static_cast<int>(getpid());
+    const uint64_t epoch = sEpoch.load(std::memory_order_acquire);
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out.precision(3);
+    out << std::fixed;
+
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : sBuffers) {
+        if (buffer->mEpoch.load(std::memory_order_acquire) != epoch) {
+            continue;
+        }
+        const uint64_t count = buffer->mCount.load(std::memory_order_acquire);
+        if (count == 0) {
+            continue;
+        }
+
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->mTid
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->mName.c_str());
+        out << "}}";
+
+        const uint64_t capacity = buffer->mEvents.size();
+        for (uint64_t i = (count > capacity) ? count - capacity : 0; i < count; ++i) {
+            const TimelineEvent &event = buffer->mEvents[i % capacity];
+            separator();
+            out << "{\"name\":";
+            writeJsonString(out, event.mName);
+            out << ",\"cat\":";
+            writeJsonString(out, event.mCategory);
+            out << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->mTid
+                << ",\"ts\":" << event.mStart << ",\"dur\":" << std::max(event.mEnd - event.mStart, 0.0);
+            if (event.mArgName) {
+                out << ",\"args\":{";
+                writeJsonString(out, event.mArgName);
+                out << ':' << event.mArg << '}';
+            }
+            out << '}';
+        }
+    }
+
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+size_t
+TimelineTrace::getNumEvents()
+{
+    const uint64_t epoch = sEpoch.load(std::memory_order_acquire);
+    size_t numEvents = 0;
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : sBuffers) {
+        if (buffer->mEpoch.load(std::memory_order_acquire) == epoch) {
+            numEvents += std::min(buffer->mCount.load(std::memory_order_acquire),
+                                  static_cast<uint64_t>(buffer->mEvents.size()));
+        }
+    }
+    return numEvents;
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
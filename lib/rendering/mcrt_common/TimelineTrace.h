@@ -0,0 +1,104 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace moonray {
+namespace mcrt_common {
+
+//
+// Process wide timeline of what each thread was doing, written out in the
+// Chrome trace event format (load it into chrome://tracing or ui.perfetto.dev).
+//
+// Each thread records its events into a buffer of its own, so recording never
+// takes a lock once the buffer exists. A buffer holds a fixed number of events
+// and overwrites its oldest ones when full, so a long session keeps the last
+// part of the timeline per thread. Recording is a single relaxed load while the
+// trace is disabled.
+//
+// Event names and categories aren't copied, they must be string literals or
+// otherwise outlive the trace.
+//
+class TimelineTrace
+{
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    // Starts recording, dropping the events recorded so far. Buffers of threads
+    // which already recorded keep their capacity.
+    static void enable(size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    static void disable();
+    finline static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Microseconds since the trace was enabled.
+    static double now();
+
+    // Records an event of the calling thread which spans [start, end], in
+    // microseconds from now(). arg is shown in the event details under argName
+    // when argName is set.
+    static void record(const char *name, const char *category, double start, double end,
+                       const char *argName = nullptr, int64_t arg = 0);
+
+    // Names the calling thread in the timeline, threads are otherwise named by
+    // the order they first recorded in.
+    static void setThreadName(const std::string &name);
+
+    // Writes the recorded events of all the threads. Threads may keep recording
+    // while this runs, but an event being overwritten at the same time can come
+    // out garbled, so call it when the threads are mostly idle, e.g. between
+    // frames. Returns false if the file couldn't be written.
+    static bool writeChromeTrace(const std::string &filename);
+
+    // Number of events currently held, over all the threads.
+    static size_t getNumEvents();
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+//
+// Records the lifetime of the scope as an event of the calling thread.
+//
+class TimelineScope
+{
+public:
+    finline TimelineScope(const char *name, const char *category,
+                          const char *argName = nullptr, int64_t arg = 0) :
+        mName(name),
+        mCategory(category),
+        mArgName(argName),
+        mArg(arg),
+        mStart(TimelineTrace::isEnabled() ? TimelineTrace::now() : -1.0)
+    {
+    }
+
+    finline ~TimelineScope()
+    {
+        if (mStart >= 0.0) {
+            TimelineTrace::record(mName, mCategory, mStart, TimelineTrace::now(), mArgName, mArg);
+        }
+    }
+
+    TimelineScope(const TimelineScope &) = delete;
+    TimelineScope &operator=(const TimelineScope &) = delete;
+
+private:
+    const char *mName;
+    const char *mCategory;
+    const char *mArgName;
+    int64_t mArg;
+    double mStart;
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
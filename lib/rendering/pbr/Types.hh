@@ -20,9 +20,9 @@ enum OcclTestType
 //
 
 #if __APPLE__
-#define BUNDLED_OCCL_RAY_MEMBERS_PAD (60+64) /*Alignment: 128, Total size: 132, Padded size: 256*/
+#define BUNDLED_OCCL_RAY_MEMBERS_PAD (36+64) /*Alignment: 128, Total size: 156, Padded size: 256*/
 #else
-#define BUNDLED_OCCL_RAY_MEMBERS_PAD  60 /*Alignment: 64, Total size: 132, Padded size: 192*/
+#define BUNDLED_OCCL_RAY_MEMBERS_PAD  36 /*Alignment: 64, Total size: 156, Padded size: 192*/
 #endif
 
 #define BUNDLED_OCCL_RAY_MEMBERS                                    /*  size  */\
@@ -46,6 +46,8 @@ enum OcclTestType
     HUD_MEMBER(HVD_NAMESPACE(scene_rdl2::math, Vec2f), mCryptoUV);  /*  124   */\
     HVD_MEMBER(uint32_t, mOcclTestType);                            /*  128   */\
     HVD_MEMBER(int32_t,  mShadowReceiverId);                        /*  132   */\
+    HVD_MEMBER(HVD_NAMESPACE(scene_rdl2::math, Vec3f), mPathGuideOrigin);/*  144   */\
+    HVD_MEMBER(HVD_NAMESPACE(scene_rdl2::math, Vec3f), mPathGuideDir);   /*  156   */\
     HVD_ISPC_PAD(mIspcPad, BUNDLED_OCCL_RAY_MEMBERS_PAD)
 
 #define BUNDLED_OCCL_RAY_VALIDATION(vlen)                   \
@@ -70,6 +72,8 @@ enum OcclTestType
     HUD_VALIDATE(BundledOcclRay, mCryptoUV);                \
     HVD_VALIDATE(BundledOcclRay, mOcclTestType);            \
     HVD_VALIDATE(BundledOcclRay, mShadowReceiverId);        \
+    HVD_VALIDATE(BundledOcclRay, mPathGuideOrigin);         \
+    HVD_VALIDATE(BundledOcclRay, mPathGuideDir);            \
     HVD_END_VALIDATION
 
 #define BUNDLED_OCCL_RAY_DATA_MEMBERS                                   \
@@ -242,6 +246,10 @@ enum OcclTestType
 //                                  in a single iteration. This should be tweaked
 //                                  per architecture such that the working data set
 //                                  can be kept inside of our cache hierarchy.
+// mShadingSortKey                  shading::ShadingSortKey layout used to order
+//                                  shading points within a shade queue.
+// mAdaptiveQueueSizes              Adapt the local queue sizes to the measured
+//                                  handler cost while rendering.
 // mMaxPresenceDepth                The maximum depth the ray can travel through
 //                                  presence < 1 object
 
@@ -260,7 +268,9 @@ enum OcclTestType
     HUD_CPP_PTR(const LightAovs *, mLightAovs);                             \
     HUD_MEMBER(bool, mRequiresHeatMap);                                     \
     HUD_MEMBER(bool,     mLockFrameNoise);                                  \
+    HUD_MEMBER(bool, mAdaptiveQueueSizes);                                  \
     HUD_MEMBER(uint32_t, mShadingWorkloadChunkSize);                        \
+    HUD_MEMBER(int, mShadingSortKey);                                       \
     HUD_MEMBER(uint32_t, mFrameNumber);                                     \
     HUD_MEMBER(uint32_t, mInitialSeed);                                     \
     HUD_MEMBER(int, mMaxPresenceDepth);                                     \
@@ -286,7 +296,9 @@ enum OcclTestType
     HUD_VALIDATE(FrameState, mLightAovs);                       \
     HUD_VALIDATE(FrameState, mRequiresHeatMap);                 \
     HUD_VALIDATE(FrameState, mShadingWorkloadChunkSize);        \
+    HUD_VALIDATE(FrameState, mShadingSortKey);                  \
     HUD_VALIDATE(FrameState, mLockFrameNoise);                  \
+    HUD_VALIDATE(FrameState, mAdaptiveQueueSizes);              \
     HUD_VALIDATE(FrameState, mFrameNumber);                     \
     HUD_VALIDATE(FrameState, mInitialSeed);                     \
     HUD_VALIDATE(FrameState, mMaxPresenceDepth);                \
@@ -249,8 +249,14 @@ BakeCamera::updateImpl(const scene_rdl2::math::Mat4d &world2render)
     mHeight = height;
 
     // has the user supplied a normal map?
-    // TODO: handle udim string subst.
-    const std::string filename = rdlCamera->get(mAttrNormalMap);
+    // a <UDIM> token in the name is replaced by the udim we bake, so one
+    // camera can bake a whole udim set.
+    std::string filename = rdlCamera->get(mAttrNormalMap);
+    const std::string udimToken = "<UDIM>";
+    const std::size_t udimPos = filename.find(udimToken);
+    if (udimPos != std::string::npos) {
+        filename.replace(udimPos, udimToken.size(), std::to_string(rdlCamera->get(mAttrUdim)));
+    }
     if (filename != mNormalMap.mFilename) {
         // cleanup previously allocated texture handle
         mNormalMap.mFilename = "";
@@ -142,6 +142,17 @@ Camera::getRequiredPrimAttributesImpl(shading::PerGeometryAttributeKeySet & /*ke
     // empty
 }
 
+void
+Camera::createRaysImpl(unsigned numRays, mcrt_common::RayDifferential* const* dstRays,
+                       const float* x, const float* y, const float* time,
+                       const float* lensU, const float* lensV) const
+{
+    for (unsigned i = 0; i < numRays; ++i) {
+        createRayImpl(dstRays[i], x[i] + mRegionToApertureOffsetX, y[i] + mRegionToApertureOffsetY,
+                      time[i], lensU[i], lensV[i]);
+    }
+}
+
 bool
 Camera::getMotionBlur() const
 {
@@ -96,6 +96,27 @@ public:
         dstRay->mFlags.set(mcrt_common::RayDifferential::HAS_DIFFERENTIALS, createDifferentials);
     }
 
+    /// Create a batch of rays, e.g. for all the samples of a pixel, given
+    /// their (x, y) coordinates in region space. The sample values are passed
+    /// as arrays of numRays values. Cameras can override createRaysImpl() to
+    /// hoist per-camera work out of the loop, the results are the same as
+    /// calling createRay() for each sample.
+    void createRays(unsigned numRays,
+                    mcrt_common::RayDifferential* const* dstRays,
+                    const float* x,
+                    const float* y,
+                    const float* time,
+                    const float* lensU,
+                    const float* lensV,
+                    bool createDifferentials) const
+    {
+        createRaysImpl(numRays, dstRays, x, y, time, lensU, lensV);
+
+        for (unsigned i = 0; i < numRays; ++i) {
+            dstRays[i]->mFlags.set(mcrt_common::RayDifferential::HAS_DIFFERENTIALS, createDifferentials);
+        }
+    }
+
     bool getIsDofEnabled() const {  return getIsDofEnabledImpl(); }
 
     float getNear() const { return mRdlCamera->get(scene_rdl2::rdl2::Camera::sNearKey); }
@@ -152,6 +173,16 @@ private:
                            float lensU,
                            float lensV) const = 0;
 
+    /// Batched createRayImpl(), the (x, y) coordinates are in region space.
+    /// The default calls createRayImpl() for each ray.
+    virtual void createRaysImpl(unsigned numRays,
+                                mcrt_common::RayDifferential* const* dstRays,
+                                const float* x,
+                                const float* y,
+                                const float* time,
+                                const float* lensU,
+                                const float* lensV) const;
+
     virtual StereoView getStereoViewImpl() const { return StereoView::CENTER; }
 
     const scene_rdl2::rdl2::Camera* mRdlCamera;
@@ -24,22 +24,28 @@ LensDistribution LensDistribution::createUnitTestDistribution()
 LensDistribution::LensDistribution() :
     mCamera(nullptr),
     mBokeh(false),
+    mMode(Mode::DISK),
     mBokehSides(0),
     mBokehImage(),
     mBokehAngle(0.0f),
     mBokehWeightLocation(0.0f),
-    mBokehWeightStrength(0.0f)
+    mBokehWeightStrength(0.0f),
+    mWeightScale(0.0f),
+    mWeightExpScale(0.0f)
 {
 }
 
 LensDistribution::LensDistribution(const scene_rdl2::rdl2::Camera* rdlCamera) :
     mCamera(rdlCamera),
     mBokeh(false),
+    mMode(Mode::DISK),
     mBokehSides(0),
     mBokehImage(),
     mBokehAngle(0.0f),
     mBokehWeightLocation(0.0f),
-    mBokehWeightStrength(0.0f)
+    mBokehWeightStrength(0.0f),
+    mWeightScale(0.0f),
+    mWeightExpScale(0.0f)
 {
     MNRY_ASSERT(mCamera != nullptr);
     initAttributeKeys(rdlCamera->getSceneClass());
@@ -67,6 +73,7 @@ LensDistribution::initAttributeKeys(const scene_rdl2::rdl2::SceneClass& sceneCla
 void
 LensDistribution::update()
 {
+    mMode = Mode::DISK;
     try {
         mBokeh = mCamera->get(mBokehKey);
 
@@ -80,15 +87,21 @@ LensDistribution::update()
             mBokehWeightLocation = mCamera->get(mBokehWeightLocationKey);
             mBokehWeightStrength = mCamera->get(mBokehWeightStrengthKey);
 
+            // PDF of a normal function, mean = location, stddev = strength
+            mWeightScale = 1.0f / (mBokehWeightStrength * scene_rdl2::math::sqrt(scene_rdl2::math::sTwoPi));
+            mWeightExpScale = -1.0f / (2.0f * mBokehWeightStrength * mBokehWeightStrength);
+
             if (!mBokehImage.empty()) {
                 try {
                     mBokehImageDist.reset(new ImageDistribution(mBokehImage, Distribution2D::PLANAR));
+                    mMode = Mode::IMAGE;
                 } catch (const scene_rdl2::except::IoError&) {
                     scene_rdl2::Logger::error("Failed to open: ", mBokehImage, ". Switching to Disk mode.");
                     mBokehImage = "";
                 }
             } else if (mBokehSides >= 3) {
                 bokehPolygonBuilder();
+                mMode = Mode::POLYGON;
             } else if (mBokehSides > 0) {
                 scene_rdl2::Logger::error("Unable to create a shape with less than 3 vertices. Switching to Disk mode.");
             }
@@ -98,84 +111,61 @@ LensDistribution::update()
     }
 }
 
-float
-LensDistribution::sampleLens(float &u, float &v) const
+void
+LensDistribution::sampleLensPosition(float &u, float &v) const
 {
     MNRY_ASSERT(0.0f <= u && u < 1.0f);
     MNRY_ASSERT(0.0f <= v && v < 1.0f);
 
-    if (mBokeh) {
-        // Input Coordinates - [0, 1)^2
-        float localU = u;
-        float localV = v;
-
-        if (!mBokehImage.empty()) {
-            // Image Mode
-            scene_rdl2::math::Vec2f uv;
-
-            mBokehImageDist->sample(localU, localV, 0, &uv, nullptr, TEXTURE_FILTER_NEAREST);
-
-            // Output - [-1, 1]^2
-            localU = (2.0f * uv.x) - 1.0f;
-            localV = (2.0f * uv.y) - 1.0f;
-        } else if (mBokehSides >= 3) {
-            // Polygon Mode
-            // Graphics Gems I p. 650
-            // Find the closest index and the next counter-clockwise index
-            int curIndex = std::min(static_cast<int>(localU * mBokehSides), mBokehSides);
-            int nextIndex = (curIndex + 1) % mBokehSides;
-
-            // Map u to a point in the sub-triangle
-            localU = (localU * mBokehSides) - static_cast<float>(curIndex);
-            localV = scene_rdl2::math::sqrt(localV); // Necessary to weight all portions of triangle equally
-
-            // Barycentric coordinates of the triangle
-            float a = 1.0f - localV;
-            float b = (1.0f - localU) * localV;
-            float c = (localU * localV);
-
-            // Vertices of the triangle
-            scene_rdl2::math::Vec2f A = scene_rdl2::math::Vec2f(0.0f, 0.0f);
-            scene_rdl2::math::Vec2f B = mBokehVertices[curIndex];
-            scene_rdl2::math::Vec2f C = mBokehVertices[nextIndex];
-
-            // Mapping the point to a new location within the triangle
-            // Output - [-1, 1]^2
-            localU = a * A.x + b * B.x + c * C.x;
-            localV = a * A.y + b * B.y + c * C.y;
-        } else {
-            // Disk Mode - Default. Also used if Image cannot be found or Shape cannot be generated.
-            // Output - [-1, 1]^2
-            toUnitDisk(localU, localV);
-        }
-
-        u = localU;
-        v = localV;
-
-        // For the pronounced edge effect, the sample's weight needs to be altered depending on position
-        // Find the distance of (u, v) from origin
-        float localDistance = scene_rdl2::math::sqrt(scene_rdl2::math::pow(scene_rdl2::math::abs(localU), 2) + scene_rdl2::math::pow(scene_rdl2::math::abs(localV), 2));
-
-        float weightLocation = mBokehWeightLocation; // mean
-        float weightStrength = mBokehWeightStrength; // stddev
-
-        // Weighting Calculation
-        // PDF of a normal function
-        // TODO: Edge detection for image and polygon modes
-        // TODO: Integrate to 1 so weight values do not need to be manipulated by user
-        float weight = (1.0f / (weightStrength * scene_rdl2::math::sqrt(scene_rdl2::math::sTwoPi))) 
-                 * scene_rdl2::math::exp((-1.0f * scene_rdl2::math::pow(localDistance - weightLocation, 2)) / 
-                             (2.0f * scene_rdl2::math::pow(weightStrength, 2)))
-                 + 0.5f;
-
-        return weight;
-    } else {
+    // Input Coordinates - [0, 1)^2
+    // Output - [-1, 1]^2
+    switch (mMode) {
+    case Mode::IMAGE:
+    {
+        scene_rdl2::math::Vec2f uv;
+        mBokehImageDist->sample(u, v, 0, &uv, nullptr, TEXTURE_FILTER_NEAREST);
+        u = (2.0f * uv.x) - 1.0f;
+        v = (2.0f * uv.y) - 1.0f;
+        break;
+    }
+    case Mode::POLYGON:
+    {
+        // Graphics Gems I p. 650
+        // u picks the triangle and the position along its outer edge, sqrt(v)
+        // the distance from the center, so all portions of the triangle are
+        // weighted equally.
+        const float su = u * mBokehSides;
+        const int index = std::min(static_cast<int>(su), mBokehSides - 1);
+        const float t = su - static_cast<float>(index);
+        const float r = scene_rdl2::math::sqrt(v);
+        const scene_rdl2::math::Vec2f p = r * (mBokehVertices[index] + t * mBokehEdges[index]);
+        u = p.x;
+        v = p.y;
+        break;
+    }
+    default:
+        // Disk Mode - Default. Also used if Image cannot be found or Shape cannot be generated.
         // TODO: Keith, evaluate Cranley-Patterson rotations or rotational rotations
-        // If bokeh is off, just map to a unit disk
         toUnitDisk(u, v);
+        break;
+    }
+}
 
+float
+LensDistribution::sampleLens(float &u, float &v) const
+{
+    sampleLensPosition(u, v);
+
+    if (!mBokeh) {
         return 1.0f;
     }
+
+    // For the pronounced edge effect, the sample's weight needs to be altered depending on position
+    // TODO: Edge detection for image and polygon modes
+    // TODO: Integrate to 1 so weight values do not need to be manipulated by user
+    const float localDistance = scene_rdl2::math::sqrt(u * u + v * v);
+    const float offset = localDistance - mBokehWeightLocation;
+    return mWeightScale * scene_rdl2::math::exp(mWeightExpScale * offset * offset) + 0.5f;
 }
 
 void
@@ -190,6 +180,11 @@ LensDistribution::bokehPolygonBuilder()
         scene_rdl2::math::sincos(curStep, &mBokehVertices[i].y, &mBokehVertices[i].x);
         curStep += mBokehStep;
     }
+
+    mBokehEdges.reset(new scene_rdl2::math::Vec2f[mBokehSides]);
+    for (int i = 0; i < mBokehSides; ++i) {
+        mBokehEdges[i] = mBokehVertices[(i + 1) % mBokehSides] - mBokehVertices[i];
+    }
 }
 
 } // namespace pbr
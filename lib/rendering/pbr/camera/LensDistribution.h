@@ -18,7 +18,12 @@ public:
 
     void update();
 
+    /// Maps (u, v) in [0, 1)^2 to a point of the aperture shape in [-1, 1]^2
+    /// and returns the bokeh weight of that point.
     float sampleLens(float &u, float &v) const;
+
+    /// Same as sampleLens(), without computing the weight.
+    void sampleLensPosition(float &u, float &v) const;
 protected:
 
     const scene_rdl2::rdl2::Camera* mCamera;
@@ -41,7 +46,15 @@ private:
 
     void bokehPolygonBuilder();
 
+    enum class Mode
+    {
+        DISK,
+        POLYGON,
+        IMAGE
+    };
+
     bool mBokeh;
+    Mode mMode;
 
     // Bokeh Shape
     int         mBokehSides;
@@ -52,8 +65,18 @@ private:
     float       mBokehWeightLocation;
     float       mBokehWeightStrength;
 
+    // Normal pdf of the weight, precomputed from the controls:
+    // weight = mWeightScale * exp(mWeightExpScale * (d - location)^2) + 0.5
+    float       mWeightScale;
+    float       mWeightExpScale;
+
     // Bokeh Vectors
+    // The polygon is made of one triangle per side, between the center,
+    // vertex i and vertex i + 1. The triangles of a regular polygon all have
+    // the same area, so they are picked uniformly. mBokehEdges[i] is the edge
+    // from vertex i to vertex i + 1.
     std::unique_ptr<scene_rdl2::math::Vec2f[]> mBokehVertices;
+    std::unique_ptr<scene_rdl2::math::Vec2f[]> mBokehEdges;
     std::unique_ptr<ImageDistribution> mBokehImageDist;
 };
 
@@ -176,7 +176,7 @@ ProjectiveCamera::createRayImpl(mcrt_common::RayDifferential *dstRay, float x, f
     const bool doDof = getIsDofEnabled();
 
     if (doDof) {
-        mLensDistribution.sampleLens(lensU, lensV);
+        mLensDistribution.sampleLensPosition(lensU, lensV);
     }
 
     const float lensX = lensU * mDofLensRadius;
@@ -190,6 +190,30 @@ ProjectiveCamera::createRayImpl(mcrt_common::RayDifferential *dstRay, float x, f
 
 }
 
+void
+ProjectiveCamera::createRaysImpl(unsigned numRays, mcrt_common::RayDifferential* const* dstRays,
+                                 const float* x, const float* y, const float* time,
+                                 const float* lensU, const float* lensV) const
+{
+    const float offsetX = getRegionToApertureOffsetX();
+    const float offsetY = getRegionToApertureOffsetY();
+
+    if (!getIsDofEnabled()) {
+        for (unsigned i = 0; i < numRays; ++i) {
+            createSimpleRay(dstRays[i], Vec3f(x[i] + offsetX, y[i] + offsetY, -1.0f), time[i]);
+        }
+        return;
+    }
+
+    for (unsigned i = 0; i < numRays; ++i) {
+        float u = lensU[i];
+        float v = lensV[i];
+        mLensDistribution.sampleLensPosition(u, v);
+        createDOFRay(dstRays[i], Vec3f(x[i] + offsetX, y[i] + offsetY, -1.0f),
+                     u * mDofLensRadius, v * mDofLensRadius, time[i]);
+    }
+}
+
 float
 ProjectiveCamera::computeZDistanceImpl(const Vec3f &p, const Vec3f &o, float time) const
 {
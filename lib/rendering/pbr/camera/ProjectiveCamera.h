@@ -29,6 +29,10 @@ public:
 
     scene_rdl2::math::Mat4f computeCamera2Screen(float time) const;
 
+    // Camera space to raster space (aperture window pixels), the inverse of the
+    // mapping primary rays are created with. Projective, apply with transformH().
+    scene_rdl2::math::Mat4f computeCamera2Raster(float time) const { return computeRaster2Camera(time).inverse(); }
+
 protected:
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool>  sDofKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sDofApertureKey;
@@ -68,6 +72,16 @@ private:
                        float lensU,
                        float lensV) const final;
 
+    /// Same as createRayImpl() for each ray, with the depth of field test
+    /// done once per batch.
+    void createRaysImpl(unsigned numRays,
+                        mcrt_common::RayDifferential* const* dstRays,
+                        const float* x,
+                        const float* y,
+                        const float* time,
+                        const float* lensU,
+                        const float* lensV) const final;
+
     virtual void createDOFRay(mcrt_common::RayDifferential* dstRay,
                               const scene_rdl2::math::Vec3f& Pr,
                               float lensX,
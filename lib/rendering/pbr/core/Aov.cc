@@ -292,6 +292,18 @@ AovSchema::init(const std::vector<AovSchema::EntryData> &data)
         mNumChannels += mEntries.back().numChannels();
         mAllLpePrefixFlags |= mEntries.back().lpePrefixFlags();
     }
+
+    mLpeEntries.clear();
+    unsigned int floatOffset = 0;
+    for (unsigned int aov = 0; aov < mEntries.size(); ++aov) {
+        const Entry &entry = mEntries[aov];
+        if (entry.type() == AOV_TYPE_LIGHT_AOV || entry.type() == AOV_TYPE_VISIBILITY_AOV) {
+            mLpeEntries.push_back({entry.id(), aov, floatOffset});
+        }
+        floatOffset += entry.numChannels();
+    }
+    std::stable_sort(mLpeEntries.begin(), mLpeEntries.end(),
+                     [](const LpeEntry &a, const LpeEntry &b) { return a.mId < b.mId; });
 }
 
 void
@@ -2898,6 +2910,196 @@ MaterialAovs::computeVector(pbr::TLState *pbrTls,
     return localLanemask;
 }
 
+void
+MaterialAovs::compile(const AovSchema &aovSchema)
+{
+    mProgram.clear();
+    mProgramLpeLabels.clear();
+    mProgramLabelFilters.clear();
+    mProgramNumChannels = 0;
+    mProgramNeedsDepth = false;
+
+    unsigned int destOffset = 0;
+    for (const auto &schemaEntry: aovSchema) {
+        if (schemaEntry.type() == AOV_TYPE_MATERIAL_AOV) {
+            const unsigned int indx = schemaEntry.id() % AOV_MAX_RANGE_TYPE;
+            MNRY_ASSERT(indx < mEntries.size());
+            const Entry &entry = mEntries[indx];
+            MNRY_ASSERT(entry.mAovSchemaId == schemaEntry.id());
+
+            ProgramStep step;
+            step.mEntryIdx = indx;
+            step.mDestOffset = destOffset;
+            step.mBufferOffset = mProgramNumChannels;
+            step.mAvgFilter = schemaEntry.filter() == AOV_FILTER_AVG;
+
+            // Aovs sharing an LPE label share its transition.
+            step.mGate = -1;
+            if (entry.mLpeSchemaId != AOV_SCHEMA_ID_UNKNOWN) {
+                MNRY_ASSERT(entry.mLpeLabelId != -1);
+                auto it = std::find(mProgramLpeLabels.begin(), mProgramLpeLabels.end(), entry.mLpeLabelId);
+                step.mGate = it - mProgramLpeLabels.begin();
+                if (it == mProgramLpeLabels.end()) {
+                    mProgramLpeLabels.push_back(entry.mLpeLabelId);
+                }
+            }
+
+            // State variable and primitive attribute aovs write a miss value when
+            // the labels don't match, so they test the labels themselves.  For
+            // everything else a failed test means there is nothing to add.
+            step.mLabelFilter = -1;
+            if (entry.mPrimAttrKey == -1 && entry.mStateAovId == AOV_SCHEMA_ID_UNKNOWN &&
+                (!entry.mGeomLabelIndices.empty() || !entry.mMaterialLabelIndices.empty())) {
+                auto it = std::find_if(mProgramLabelFilters.begin(), mProgramLabelFilters.end(),
+                    [&](unsigned other) {
+                        return mEntries[other].mGeomLabelIndices == entry.mGeomLabelIndices &&
+                               mEntries[other].mMaterialLabelIndices == entry.mMaterialLabelIndices;
+                    });
+                step.mLabelFilter = it - mProgramLabelFilters.begin();
+                if (it == mProgramLabelFilters.end()) {
+                    mProgramLabelFilters.push_back(indx);
+                }
+            }
+
+            mProgram.push_back(step);
+            mProgramNumChannels += schemaEntry.numChannels();
+            if (schemaEntry.stateAovId() == AOV_SCHEMA_ID_STATE_DEPTH) {
+                mProgramNeedsDepth = true;
+            }
+        }
+        destOffset += schemaEntry.numChannels();
+    }
+
+    mProgramSchema = &aovSchema;
+    mProgramSchemaChannels = aovSchema.numChannels();
+}
+
+void
+MaterialAovs::computeProgramScalar(pbr::TLState *pbrTls,
+                                   const LightAovs &lightAovs,
+                                   const shading::Intersection &isect,
+                                   const mcrt_common::RayDifferential &ray,
+                                   const Scene &scene,
+                                   const shading::Bsdf &bsdf,
+                                   const Color &ssAov,
+                                   const BsdfSampler *bSampler,
+                                   const BsdfSample *bsmps,
+                                   const BsdfSlice *bsdfSlice,
+                                   float pixelWeight,
+                                   int lpeStateId,
+                                   float *dest) const
+{
+    if (mProgram.empty()) return;
+
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+
+    // Gate and label filter results, evaluated on first use:
+    // 0 = not evaluated yet, 1 = pass, 2 = fail.
+    const unsigned int numResults = mProgramLpeLabels.size() + mProgramLabelFilters.size();
+    uint8_t *gates = arena->allocArray<uint8_t>(numResults + 1);
+    memset(gates, 0, numResults + 1);
+    uint8_t *filters = gates + mProgramLpeLabels.size();
+
+    const bool isPrimaryRay = ray.getDepth() == 0;
+    const int geomLabelId = bsdf.getGeomLabelId();
+    const int materialLabelId = bsdf.getMaterialLabelId();
+
+    for (const ProgramStep &step: mProgram) {
+        if (step.mGate < 0) {
+            if (!isPrimaryRay) continue;
+        } else {
+            uint8_t &gate = gates[step.mGate];
+            if (!gate) {
+                gate = lightAovs.materialAovEventTransition(pbrTls, lpeStateId,
+                                                            mProgramLpeLabels[step.mGate]) == -1 ? 2 : 1;
+            }
+            if (gate == 2) continue;
+        }
+
+        if (step.mLabelFilter >= 0) {
+            uint8_t &filter = filters[step.mLabelFilter];
+            if (!filter) {
+                const Entry &filterEntry = mEntries[mProgramLabelFilters[step.mLabelFilter]];
+                filter = (labelMatch(geomLabelId, filterEntry.mGeomLabelIndices) &&
+                          labelMatch(materialLabelId, filterEntry.mMaterialLabelIndices)) ? 1 : 2;
+            }
+            if (filter == 2) continue;
+        }
+
+        const Entry &entry = mEntries[step.mEntryIdx];
+        ComputeParams params { entry, isect, ray, scene, bsdf, ssAov, bSampler, bsmps, bsdfSlice,
+                               step.mAvgFilter ? pixelWeight : 1.0f };
+        entry.mComputeFn(params, dest + step.mDestOffset);
+    }
+}
+
+void
+MaterialAovs::computeProgramVector(pbr::TLState *pbrTls,
+                                   const LightAovs &lightAovs,
+                                   const shading::Intersectionv &isect,
+                                   const mcrt_common::RayDifferentialv &ray,
+                                   const Scene &scene,
+                                   const shading::Bsdfv &bsdf,
+                                   const Colorv &ssAov,
+                                   const BsdfSamplerv *bSampler,
+                                   const BsdfSamplev *bsmps,
+                                   const BsdfSlicev *bsdfSlice,
+                                   const float *pixelWeight,
+                                   const float *onev,
+                                   const int *lpeStateId,
+                                   const uint32_t *isPrimaryRay,
+                                   float *dest,
+                                   uint32_t *lanemasks,
+                                   const uint32_t lanemask) const
+{
+    if (mProgram.empty()) return;
+
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+
+    // Lanes passing each LPE gate, evaluated on first use.  A lane mask has at
+    // most VLEN bits so all ones can't be a real result.
+    constexpr uint32_t notEvaluated = ~0u;
+    uint32_t *gateMasks = arena->allocArray<uint32_t>(mProgramLpeLabels.size() + 1);
+    std::fill(gateMasks, gateMasks + mProgramLpeLabels.size(), notEvaluated);
+
+    uint32_t primaryMask = 0;
+    for (unsigned int lane = 0; lane < VLEN; ++lane) {
+        if ((lanemask & (1 << lane)) && isPrimaryRay[lane]) {
+            primaryMask |= 1 << lane;
+        }
+    }
+
+    for (unsigned int i = 0; i < mProgram.size(); ++i) {
+        const ProgramStep &step = mProgram[i];
+
+        uint32_t stepLanemask = primaryMask;
+        if (step.mGate >= 0) {
+            uint32_t &gateMask = gateMasks[step.mGate];
+            if (gateMask == notEvaluated) {
+                gateMask = 0;
+                for (unsigned int lane = 0; lane < VLEN; ++lane) {
+                    if (!(lanemask & (1 << lane))) continue;
+                    if (lightAovs.materialAovEventTransition(pbrTls, lpeStateId[lane],
+                                                             mProgramLpeLabels[step.mGate]) != -1) {
+                        gateMask |= 1 << lane;
+                    }
+                }
+            }
+            stepLanemask = gateMask;
+        }
+
+        lanemasks[i] = stepLanemask;
+        if (stepLanemask != 0) {
+            const Entry &entry = mEntries[step.mEntryIdx];
+            ComputeParamsv params { entry, isect, ray, scene, bsdf, ssAov, bSampler, bsmps, bsdfSlice,
+                                    step.mAvgFilter ? pixelWeight : onev, stepLanemask };
+            entry.mComputeFnv(params, dest + step.mBufferOffset * VLEN);
+        }
+    }
+}
+
 void
 aovSetMaterialAovs(pbr::TLState *pbrTls,
                    const AovSchema &aovSchema,
@@ -2916,6 +3118,13 @@ aovSetMaterialAovs(pbr::TLState *pbrTls,
 {
     EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
 
+    if (materialAovs.isCompiledFor(aovSchema)) {
+        materialAovs.computeProgramScalar(pbrTls, lightAovs, isect, ray, scene, bsdf,
+                                          ssAov, bSampler, bsmps, nullptr,
+                                          pixelWeight, lpeStateId, dest);
+        return;
+    }
+
     for (const auto &entry: aovSchema) {
 
         if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
@@ -2948,6 +3157,13 @@ aovSetMaterialAovs(pbr::TLState *pbrTls,
 {
     EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
 
+    if (materialAovs.isCompiledFor(aovSchema)) {
+        materialAovs.computeProgramScalar(pbrTls, lightAovs, isect, ray, scene, bsdf,
+                                          ssAov, nullptr, nullptr, bsdfSlice,
+                                          pixelWeight, lpeStateId, dest);
+        return;
+    }
+
     for (const auto &entry: aovSchema) {
 
         if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
@@ -2989,15 +3205,22 @@ CPP_aovSetMaterialAovs(pbr::TLState *pbrTls,
 
     scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
     SCOPED_MEM(arena);
+    const bool compiled = materialAovs.isCompiledFor(aovSchema);
     unsigned int numMaterialAovChannels = 0;
     unsigned int numMaterialAovEntries = 0;
     bool needsDepth = false;
-    for (const auto &entry: aovSchema) {
-        if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
-            numMaterialAovChannels += entry.numChannels();
-            numMaterialAovEntries++;
-            if (entry.stateAovId() == AOV_SCHEMA_ID_STATE_DEPTH) {
-                needsDepth = true;
+    if (compiled) {
+        numMaterialAovChannels = materialAovs.getProgramNumChannels();
+        numMaterialAovEntries = materialAovs.getProgramSize();
+        needsDepth = materialAovs.programNeedsDepth();
+    } else {
+        for (const auto &entry: aovSchema) {
+            if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
+                numMaterialAovChannels += entry.numChannels();
+                numMaterialAovEntries++;
+                if (entry.stateAovId() == AOV_SCHEMA_ID_STATE_DEPTH) {
+                    needsDepth = true;
+                }
             }
         }
     }
@@ -3033,15 +3256,22 @@ CPP_aovSetMaterialAovs(pbr::TLState *pbrTls,
 #endif
 
     // Compute aov results
-    float *dest = buffer;
-    int i = 0;
-    for (const auto &entry: aovSchema) {
-        if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
-            materialAovLanemasks[i++] = materialAovs.computeVector(pbrTls, entry.id(), lightAovs, isect, ray, scene,
-                                                        bsdf, ssAov, bSampler, bsmps, bsdfSlice,
-                                                        entry.filter() == AOV_FILTER_AVG ? pixelWeight : onev,
-                                                        lpeStateId, isPrimaryRay, dest, lanemask);
-            dest += entry.numChannels() * VLEN;
+    if (compiled) {
+        materialAovs.computeProgramVector(pbrTls, lightAovs, isect, ray, scene,
+                                          bsdf, ssAov, bSampler, bsmps, bsdfSlice,
+                                          pixelWeight, onev, lpeStateId, isPrimaryRay,
+                                          buffer, materialAovLanemasks, lanemask);
+    } else {
+        float *dest = buffer;
+        int i = 0;
+        for (const auto &entry: aovSchema) {
+            if (entry.type() == AOV_TYPE_MATERIAL_AOV) {
+                materialAovLanemasks[i++] = materialAovs.computeVector(pbrTls, entry.id(), lightAovs, isect, ray, scene,
+                                                            bsdf, ssAov, bSampler, bsmps, bsdfSlice,
+                                                            entry.filter() == AOV_FILTER_AVG ? pixelWeight : onev,
+                                                            lpeStateId, isPrimaryRay, dest, lanemask);
+                dest += entry.numChannels() * VLEN;
+            }
         }
     }
 
@@ -3462,6 +3692,17 @@ LightAovs::isValid(pbr::TLState *pbrTls, int lpeStateId, int aovSchemaId) const
     return mLpeStateMachine.isValid(lpeStateId, aovSchemaId);
 }
 
+const int *
+LightAovs::getValidIds(int lpeStateId, int &count) const
+{
+    MNRY_ASSERT(mFinalized);
+    count = 0;
+    if (!hasEntries()) return nullptr;
+    if (lpeStateId < 0) return nullptr;
+
+    return mLpeStateMachine.getValidIds(lpeStateId, count);
+}
+
 std::string
 LightAovs::expandLpeLabels(const std::string &lpe) const
 {
@@ -3617,6 +3858,46 @@ LightAovs::buildLabelSubstitutions(const scene_rdl2::rdl2::Layer &layer)
     // }
 }
 
+// Calls func(entry, floatOffset) for each aov of the given type that is
+// valid at lpeStateId, or for all of them when lpePassthrough is set.
+// Rather than testing every schema entry against the state machine, the
+// ids valid at lpeStateId are looked up in the schema's lpe entries.
+template<AovType type, typename FUNC>
+void
+forEachValidLpeAov(const AovSchema &aovSchema,
+                   const LightAovs &lightAovs,
+                   int lpeStateId,
+                   bool lpePassthrough,
+                   const FUNC &func)
+{
+    const std::vector<AovSchema::LpeEntry> &lpeEntries = aovSchema.lpeEntries();
+
+    if (lpePassthrough) {
+        for (const AovSchema::LpeEntry &lpeEntry: lpeEntries) {
+            const AovSchema::Entry &entry = aovSchema[lpeEntry.mEntryIdx];
+            if (entry.type() == type) {
+                func(entry, lpeEntry.mFloatOffset);
+            }
+        }
+        return;
+    }
+
+    int numValidIds = 0;
+    const int *validIds = lightAovs.getValidIds(lpeStateId, numValidIds);
+    auto lpeEntry = lpeEntries.begin();
+    for (int i = 0; i < numValidIds && lpeEntry != lpeEntries.end(); ++i) {
+        // both lists are sorted by id
+        lpeEntry = std::lower_bound(lpeEntry, lpeEntries.end(), validIds[i],
+            [](const AovSchema::LpeEntry &e, int id) { return e.mId < id; });
+        for (; lpeEntry != lpeEntries.end() && lpeEntry->mId == validIds[i]; ++lpeEntry) {
+            const AovSchema::Entry &entry = aovSchema[lpeEntry->mEntryIdx];
+            if (entry.type() == type) {
+                func(entry, lpeEntry->mFloatOffset);
+            }
+        }
+    }
+}
+
 // Accumulates two values into separate aovs depending on whether or not they match with a certain flag or not.
 template<AovType type, typename VALUE>
 bool
@@ -3635,48 +3916,43 @@ aovAccumLpeAovs(pbr::TLState *pbrTls,
 {
     EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
     bool success = false;
-    for (const auto &entry: aovSchema) {
-        if (entry.type() == type) {
-            if (lpePassthrough || lightAovs.isValid(pbrTls, lpeStateId, entry.id())) {
-                // Make sure to keep (== prefixFlags) as this statement should always hold true when prefixFlags == 0.
-                const bool aovMatchPrefixFlags = (entry.lpePrefixFlags() & prefixFlags) == prefixFlags;
-                if (aovMatchPrefixFlags || (nonMatchValue && nonMatchSampleValue)) {
-                    const VALUE &value = aovMatchPrefixFlags ? matchValue : *nonMatchValue;
-                    const VALUE &sampleValue = aovMatchPrefixFlags ? matchSampleValue : *nonMatchSampleValue;
-
-                    for (size_t i = 0; i < entry.numChannels(); ++i) {
-                        switch (entry.filter()) {
-                        // Only "extra aovs" support non-avg math filters.  For extra aovs,
-                        // we are computing and accumulating results at potentially every
-                        // path vertex.  If the filter is "avg" then we just accumulate the value
-                        // normally.  This basically just means to add the value (which should
-                        // already take the path throughput into account) to the frame buffer.
-                        // For min, max, and sum we want to use the raw sample value.  With min and
-                        // max we need to check against the current value in dest and replace
-                        // if appropriate.
-                        case AOV_FILTER_SUM:
-                            *(dest + i) += sampleValue[i];
-                            break;
-                        case AOV_FILTER_MAX:
-                            *(dest + i) = (*(dest + i) < sampleValue[i]) ? sampleValue[i] : *(dest + i);
-                            break;
-                        case AOV_FILTER_MIN:
-                            *(dest + i) = (*(dest + i) < sampleValue[i]) ? *(dest + i) : sampleValue[i];
-                            break;
-                        case AOV_FILTER_AVG:
-                        default:
-                            *(dest + i) += value[i];
-                            break;
-                        }
-                    }
-                    success = true;
+    forEachValidLpeAov<type>(aovSchema, lightAovs, lpeStateId, lpePassthrough,
+                             [&](const AovSchema::Entry &entry, unsigned int floatOffset) {
+        // Make sure to keep (== prefixFlags) as this statement should always hold true when prefixFlags == 0.
+        const bool aovMatchPrefixFlags = (entry.lpePrefixFlags() & prefixFlags) == prefixFlags;
+        if (aovMatchPrefixFlags || (nonMatchValue && nonMatchSampleValue)) {
+            const VALUE &value = aovMatchPrefixFlags ? matchValue : *nonMatchValue;
+            const VALUE &sampleValue = aovMatchPrefixFlags ? matchSampleValue : *nonMatchSampleValue;
+            float *entryDest = dest + floatOffset;
+
+            for (size_t i = 0; i < entry.numChannels(); ++i) {
+                switch (entry.filter()) {
+                // Only "extra aovs" support non-avg math filters.  For extra aovs,
+                // we are computing and accumulating results at potentially every
+                // path vertex.  If the filter is "avg" then we just accumulate the value
+                // normally.  This basically just means to add the value (which should
+                // already take the path throughput into account) to the frame buffer.
+                // For min, max, and sum we want to use the raw sample value.  With min and
+                // max we need to check against the current value in dest and replace
+                // if appropriate.
+                case AOV_FILTER_SUM:
+                    entryDest[i] += sampleValue[i];
+                    break;
+                case AOV_FILTER_MAX:
+                    entryDest[i] = (entryDest[i] < sampleValue[i]) ? sampleValue[i] : entryDest[i];
+                    break;
+                case AOV_FILTER_MIN:
+                    entryDest[i] = (entryDest[i] < sampleValue[i]) ? entryDest[i] : sampleValue[i];
+                    break;
+                case AOV_FILTER_AVG:
+                default:
+                    entryDest[i] += value[i];
+                    break;
                 }
             }
+            success = true;
         }
-
-        // onto the next one
-        dest += entry.numChannels();
-    }
+    });
 
     return success;
 }
@@ -3747,66 +4023,58 @@ aovAccumLpeAovsBundled(pbr::TLState *pbrTls,
     // performance reasons, we check the lpeStateId and queue passing results
     // immediately, without the need to create a temporary aov buffer.
     // Sorry about the duplication.
-    unsigned aovIdx = 0;
     unsigned aov = 0;
 
     BundledAov bundledAov(pixel, pbr::nullHandle);
-    for (const auto &entry: aovSchema) {
-
-        if (entry.type() == type) {
-            if (lpePassthrough || lightAovs.isValid(pbrTls, lpeStateId, entry.id())) {
-                // Make sure to keep (== prefixFlags) as this statement should always hold true when prefixFlags == 0.
-                const bool aovMatchPrefixFlags = (entry.lpePrefixFlags() & prefixFlags) == prefixFlags;
-                if (aovMatchPrefixFlags || (nonMatchValue && nonMatchSampleValue)) {
-                    const VALUE &value = aovMatchPrefixFlags ? matchValue : *nonMatchValue;
-                    const VALUE &sampleValue = aovMatchPrefixFlags ? matchSampleValue : *nonMatchSampleValue;
-
-                    // need to process each color channel, we only
-                    // send non-zero values
-                    for (unsigned c = 0; c < entry.numChannels(); ++c ) {
-                        switch (entry.filter()) {
-                        // Only "extra aovs" support non-avg math filters.  For extra aovs,
-                        // we are computing and accumulating results at potentially every
-                        // path vertex.  If the filter is "avg" then we just accumulate the value
-                        // normally.  This basically just means to add the value (which should
-                        // already take the path throughput into account) to the frame buffer.
-                        // For min, max, and sum we want to use the raw sample value.  As an
-                        // optimization, we only queue meaningful values based on the filter.
-                        // For avg and sum this means non-zero values.  For min and max this
-                        // means non +/-inf to which the frame buffer is already cleared.
-                        case AOV_FILTER_SUM:
-                            if (sampleValue[c] != 0.f) {
-                                bundledAov.setAov(aov++, sampleValue[c], aovIdx + c);
-                            }
-                            break;
-                        case AOV_FILTER_MAX:
-                        case AOV_FILTER_MIN:
-                            if (scene_rdl2::math::isfinite(sampleValue[c])) {
-                                bundledAov.setAov(aov++, sampleValue[c], aovIdx + c);
-                            }
-                            break;
-                        case AOV_FILTER_AVG:
-                        default:
-                            if (value[c] != 0.f) {
-                                bundledAov.setAov(aov++, value[c], aovIdx + c);
-                            }
-                            break;
-                        }
-                        if (aov == BundledAov::MAX_AOV) {
-                            bundledAov.mDeepDataHandle = pbrTls->acquireDeepData(deepDataHandle);
-                            pbrTls->addAovQueueEntries(1, &bundledAov);
-                            bundledAov.init(pixel, pbr::nullHandle);
-                            aov = 0;
-                        }
+    forEachValidLpeAov<type>(aovSchema, lightAovs, lpeStateId, lpePassthrough,
+                             [&](const AovSchema::Entry &entry, unsigned int aovIdx) {
+        // Make sure to keep (== prefixFlags) as this statement should always hold true when prefixFlags == 0.
+        const bool aovMatchPrefixFlags = (entry.lpePrefixFlags() & prefixFlags) == prefixFlags;
+        if (aovMatchPrefixFlags || (nonMatchValue && nonMatchSampleValue)) {
+            const VALUE &value = aovMatchPrefixFlags ? matchValue : *nonMatchValue;
+            const VALUE &sampleValue = aovMatchPrefixFlags ? matchSampleValue : *nonMatchSampleValue;
+
+            // need to process each color channel, we only
+            // send non-zero values
+            for (unsigned c = 0; c < entry.numChannels(); ++c ) {
+                switch (entry.filter()) {
+                // Only "extra aovs" support non-avg math filters.  For extra aovs,
+                // we are computing and accumulating results at potentially every
+                // path vertex.  If the filter is "avg" then we just accumulate the value
+                // normally.  This basically just means to add the value (which should
+                // already take the path throughput into account) to the frame buffer.
+                // For min, max, and sum we want to use the raw sample value.  As an
+                // optimization, we only queue meaningful values based on the filter.
+                // For avg and sum this means non-zero values.  For min and max this
+                // means non +/-inf to which the frame buffer is already cleared.
+                case AOV_FILTER_SUM:
+                    if (sampleValue[c] != 0.f) {
+                        bundledAov.setAov(aov++, sampleValue[c], aovIdx + c);
+                    }
+                    break;
+                case AOV_FILTER_MAX:
+                case AOV_FILTER_MIN:
+                    if (scene_rdl2::math::isfinite(sampleValue[c])) {
+                        bundledAov.setAov(aov++, sampleValue[c], aovIdx + c);
                     }
-                    success = true;
+                    break;
+                case AOV_FILTER_AVG:
+                default:
+                    if (value[c] != 0.f) {
+                        bundledAov.setAov(aov++, value[c], aovIdx + c);
+                    }
+                    break;
+                }
+                if (aov == BundledAov::MAX_AOV) {
+                    bundledAov.mDeepDataHandle = pbrTls->acquireDeepData(deepDataHandle);
+                    pbrTls->addAovQueueEntries(1, &bundledAov);
+                    bundledAov.init(pixel, pbr::nullHandle);
+                    aov = 0;
                 }
             }
+            success = true;
         }
-
-        // advance aovIdx
-        aovIdx += entry.numChannels();
-    }
+    });
 
     // queue any remainders
     if (aov > 0) {
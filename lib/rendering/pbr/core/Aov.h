@@ -244,6 +244,15 @@ public:
         int            mStateAovId;
     };
 
+    // Locates a light or visibility aov entry, and its first float in
+    // an aov array, by schema id.
+    struct LpeEntry
+    {
+        int mId;
+        unsigned int mEntryIdx;
+        unsigned int mFloatOffset;
+    };
+
     // HUD validation
     static uint32_t hudValidation(bool verbose) { AOV_SCHEMA_VALIDATION; }
 
@@ -282,6 +291,9 @@ public:
         return mEntries[idx].filter() == AOV_FILTER_AVG;
     }
 
+    // The light and visibility aov entries, sorted by schema id.
+    const std::vector<LpeEntry> &lpeEntries() const { return mLpeEntries; }
+
     std::vector<Entry>::const_iterator begin() const { return mEntries.begin(); }
     std::vector<Entry>::const_iterator end()   const { return mEntries.end(); }
 
@@ -570,7 +582,71 @@ public:
                        float *dest,
                        uint32_t lanemask) const;
 
+    // Flattens the material aovs of aovSchema, in schema order, into a single
+    // evaluation program.  Work the aovs have in common is then done once per
+    // shading point instead of once per aov: the LPE transition of each distinct
+    // LPE label, the primary ray test and, in scalar mode, the geometry/material
+    // label test of each distinct label selection.  Call once the schema and the
+    // entries are final; the aovSetMaterialAovs() functions fall back to
+    // evaluating the aovs one by one for any other schema.
+    void compile(const AovSchema &aovSchema);
+
+    bool isCompiledFor(const AovSchema &aovSchema) const
+    {
+        return mProgramSchema == &aovSchema && mProgramSchemaChannels == aovSchema.numChannels();
+    }
+
+    unsigned int getProgramNumChannels() const { return mProgramNumChannels; }
+    unsigned int getProgramSize() const { return mProgram.size(); }
+    bool programNeedsDepth() const { return mProgramNeedsDepth; }
+
+    // Runs the compiled program, dest is laid out as the compiled schema.
+    void computeProgramScalar(pbr::TLState *pbrTls,
+                              const LightAovs &lightAovs,
+                              const shading::Intersection &isect,
+                              const mcrt_common::RayDifferential &ray,
+                              const Scene &scene,
+                              const shading::Bsdf &bsdf,
+                              const scene_rdl2::math::Color &ssAov,
+                              const BsdfSampler *bSampler,
+                              const BsdfSample *bsmps,
+                              const shading::BsdfSlice *bsdfSlice,
+                              float pixelWeight,
+                              int lpeStateId,
+                              float *dest) const;
+
+    // Runs the compiled program, dest holds getProgramNumChannels() * VLEN floats
+    // with the material aovs packed back to back.  The lane mask each aov was
+    // computed for is written to lanemasks, getProgramSize() entries.
+    void computeProgramVector(pbr::TLState *pbrTls,
+                              const LightAovs &lightAovs,
+                              const shading::Intersectionv &isectv,
+                              const mcrt_common::RayDifferentialv &ray,
+                              const Scene &scene,
+                              const shading::Bsdfv &bsdfv,
+                              const Colorv &ssAov,
+                              const BsdfSamplerv *bSampler,
+                              const BsdfSamplev *bsmps,
+                              const shading::BsdfSlicev *bsdfSlice,
+                              const float *pixelWeight,
+                              const float *onev,
+                              const int *lpeStateId,
+                              const uint32_t *isPrimaryRay,
+                              float *dest,
+                              uint32_t *lanemasks,
+                              uint32_t lanemask) const;
+
 private:
+    // One material aov of the compiled schema.
+    struct ProgramStep
+    {
+        unsigned int mEntryIdx;     // into mEntries
+        unsigned int mDestOffset;   // first channel of the aov in the schema
+        unsigned int mBufferOffset; // first channel of the aov among the material aovs
+        bool         mAvgFilter;    // scaled by the pixel weight
+        int          mGate;         // -1: primary rays only, else index into mProgramLpeLabels
+        int          mLabelFilter;  // index into mProgramLabelFilters, -1: nothing to test
+    };
 
     static AovSchemaId parseExpression(const std::string &expression,
                                        ComputeFn &computeFn,
@@ -584,6 +660,15 @@ private:
                                        bool &subsurface);
 
     MATERIAL_AOVS_MEMBERS;
+
+    // Compiled program, see compile().  Only ever used from C++.
+    const AovSchema          *mProgramSchema {nullptr};
+    unsigned int             mProgramSchemaChannels {0};
+    std::vector<ProgramStep> mProgram;
+    std::vector<int>         mProgramLpeLabels;
+    std::vector<unsigned>    mProgramLabelFilters; // entry whose geom and material labels make the filter
+    unsigned int             mProgramNumChannels {0};
+    bool                     mProgramNeedsDepth {false};
 };
 
 // Parsing
@@ -836,6 +921,10 @@ public:
     // is valid at this lpeStateId
     bool isValid(pbr::TLState *pbrTls, int lpeStateId, int aovSchemaId) const;
 
+    // @return the aovSchemaIds valid at this lpeStateId, in increasing
+    // order, count is set to their number
+    const int *getValidIds(int lpeStateId, int &count) const;
+
     // @return true if we have light or visibility aovs, false otherwise
     bool hasEntries() const {
         return mNextLightAovSchemaId > AOV_SCHEMA_ID_LIGHT_AOV ||
@@ -50,6 +50,7 @@ enum {
 
 #define AOV_SCHEMA_MEMBERS                                              \
     HUD_CPP_MEMBER(std::vector<Entry>, mEntries, SIZEOF_STD_VECTOR);    \
+    HUD_CPP_MEMBER(std::vector<LpeEntry>, mLpeEntries, SIZEOF_STD_VECTOR); \
     HUD_CPP_MEMBER(int, mAllLpePrefixFlags, 4);                         \
     HUD_MEMBER(unsigned int, mNumChannels);                             \
     HUD_MEMBER(bool, mHasAovFilter);                                    \
@@ -59,6 +60,7 @@ enum {
 #define AOV_SCHEMA_VALIDATION                    \
     HUD_BEGIN_VALIDATION(AovSchema);             \
     HUD_VALIDATE(AovSchema, mEntries);           \
+    HUD_VALIDATE(AovSchema, mLpeEntries);        \
     HUD_VALIDATE(AovSchema, mAllLpePrefixFlags); \
     HUD_VALIDATE(AovSchema, mNumChannels);       \
     HUD_VALIDATE(AovSchema, mHasAovFilter);      \
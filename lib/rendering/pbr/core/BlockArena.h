@@ -0,0 +1,51 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <memory>
+#include <vector>
+
+namespace moonray {
+namespace pbr {
+
+// Small objects which live until the end of a frame are carved out of large
+// blocks instead of being allocated one by one on the heap.  They are never
+// freed individually, clear() recycles all the blocks at once.  An arena is not
+// thread safe, the buffers using one keep an arena per render thread.
+class BlockArena
+{
+public:
+    void *alloc(size_t size)
+    {
+        // keep the allocations 8 byte aligned
+        size = (size + 7) & ~size_t(7);
+        MNRY_ASSERT(size <= mBlockSize);
+
+        if (mNumBlocksUsed == 0 || mBlockOffset + size > mBlockSize) {
+            if (mNumBlocksUsed == mBlocks.size()) {
+                mBlocks.emplace_back(new char[mBlockSize]);
+            }
+            mNumBlocksUsed++;
+            mBlockOffset = 0;
+        }
+        void *ptr = mBlocks[mNumBlocksUsed - 1].get() + mBlockOffset;
+        mBlockOffset += size;
+        return ptr;
+    }
+
+    void clear() { mNumBlocksUsed = 0; }
+    size_t getMemoryUsage() const { return mBlocks.size() * mBlockSize; }
+
+    static const size_t mBlockSize = 64 * 1024;
+
+private:
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    size_t mNumBlocksUsed = 0;
+    size_t mBlockOffset = mBlockSize;
+};
+
+} // namespace pbr
+} // namespace moonray
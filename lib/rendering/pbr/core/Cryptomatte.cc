@@ -3,7 +3,9 @@
 
 #include "Cryptomatte.h"
 
+#include <algorithm>
 #include <cstring> // for size_t
+#include <numeric>
 
 namespace moonray {
 namespace pbr {
@@ -23,17 +25,22 @@ CryptomatteBuffer::~CryptomatteBuffer()
     scene_rdl2::util::alignedFreeArrayDtor(mPixelMutexes, mMutexTileSize * mMutexTileSize);
 }
 
-void CryptomatteBuffer::init(unsigned width, unsigned height, unsigned numIdChannels, bool multiPresenceOn)
+void CryptomatteBuffer::init(unsigned width, unsigned height, unsigned numIdChannels, bool multiPresenceOn,
+                             unsigned numRenderThreads)
 {
     MNRY_ASSERT_REQUIRE(numIdChannels == 1);     // Production only wants simple 32-bit ids at present
 
     mWidth = width;
     mHeight = height;
     for (int iType = 0; iType < NUM_CRYPTOMATTE_TYPES; iType++) {
-        mPixelEntries[iType].reserve(width * height);
-        for (size_t iPixel = 0; iPixel < width * height; iPixel++) {
-            mPixelEntries[iType].push_back(PixelEntry());
-        }
+        mPixelEntries[iType].assign(width * height, PixelEntry());
+    }
+    mArenas.resize(numRenderThreads);
+    mSampleQueues.resize(numRenderThreads);
+    for (unsigned i = 0; i < numRenderThreads; i++) {
+        mArenas[i].clear();
+        mSampleQueues[i].mSamples.clear();
+        mSampleQueues[i].mSamples.reserve(mSampleQueueSize);
     }
     mFinalized = false;
     mMultiPresenceOn = multiPresenceOn;
@@ -43,51 +50,81 @@ void CryptomatteBuffer::clear()
 {
     for (int iType = 0; iType < NUM_CRYPTOMATTE_TYPES; iType++) {
         for (size_t iPixel = 0; iPixel < mWidth * mHeight; iPixel++) {
-            PixelEntry &pixelEntry = mPixelEntries[iType][iPixel];
-            pixelEntry.mFragments.clear();
+            mPixelEntries[iType][iPixel] = PixelEntry();
         }
     }
+    // the fragment arrays live in the arenas, drop any unmerged samples too
+    for (size_t i = 0; i < mArenas.size(); i++) {
+        mArenas[i].clear();
+        mSampleQueues[i].mSamples.clear();
+    }
     mFinalized = false;
 }
 
-void CryptomatteBuffer::addSampleScalar(unsigned x, unsigned y, float sampleId, float weight,
-                                        const scene_rdl2::math::Vec3f& position,
-                                        const scene_rdl2::math::Vec3f& p0,
-                                        const scene_rdl2::math::Vec3f& normal,
-                                        const scene_rdl2::math::Color4& beauty,
-                                        const scene_rdl2::math::Vec3f refP,
-                                        const scene_rdl2::math::Vec3f refN,
-                                        const scene_rdl2::math::Vec2f uv,
-                                        unsigned presenceDepth,
-                                        int cryptoType)
+bool CryptomatteBuffer::appendFragment(BlockArena &arena, PixelEntry &pixelEntry, const Fragment &fragment)
 {
-    PixelEntry &pixelEntry = mPixelEntries[cryptoType][y * mWidth + x];
+    if (pixelEntry.mNumFragments == pixelEntry.mCapacity) {
+        if (pixelEntry.mCapacity == mMaxFragments) {
+            return false;
+        }
+        const unsigned capacity = pixelEntry.mCapacity ? 2 * pixelEntry.mCapacity : 1;
+        Fragment *fragments = static_cast<Fragment *>(arena.alloc(capacity * sizeof(Fragment)));
+        std::uninitialized_copy(pixelEntry.begin(), pixelEntry.end(), fragments);
+        pixelEntry.mFragments = fragments;
+        pixelEntry.mCapacity = capacity;
+    }
+    new (pixelEntry.mFragments + pixelEntry.mNumFragments) Fragment(fragment);
+    pixelEntry.mNumFragments++;
+    return true;
+}
 
+void CryptomatteBuffer::mergeSample(BlockArena &arena, PixelEntry &pixelEntry, const Fragment &sample)
+{
     // Iterate over fragments stored at current pixel and see if we can merge the sample in to any of them
-    for (Fragment &fragment : pixelEntry.mFragments) {
+    for (Fragment &fragment : pixelEntry) {
         // if multi presence is on, we treat each presence bounce as a separate cryptomatte fragment
-        bool fragMatches = mMultiPresenceOn ? fragment.mId == sampleId && fragment.mPresenceDepth == presenceDepth
-                                            : fragment.mId == sampleId;
+        bool fragMatches = mMultiPresenceOn ? fragment.mId == sample.mId &&
+                                              fragment.mPresenceDepth == sample.mPresenceDepth
+                                            : fragment.mId == sample.mId;
         if (fragMatches) {
-            fragment.mCoverage += weight;
-            fragment.mPosition += position;
-            fragment.mP0 += p0;
-            fragment.mNormal += normal;
-            fragment.mBeauty += beauty;
-            fragment.mRefP += refP;
-            fragment.mRefN += refN;
-            fragment.mUV += uv;
-            fragment.mNumSamples++;
+            fragment.mCoverage += sample.mCoverage;
+            fragment.mPosition += sample.mPosition;
+            fragment.mP0 += sample.mP0;
+            fragment.mNormal += sample.mNormal;
+            fragment.mBeauty += sample.mBeauty;
+            fragment.mRefP += sample.mRefP;
+            fragment.mRefN += sample.mRefN;
+            fragment.mUV += sample.mUV;
+            fragment.mNumSamples += sample.mNumSamples;
             return;
         }
     }
 
     // No match, so add a new fragment.
-    pixelEntry.mFragments.push_back(Fragment(sampleId, weight, position, p0, normal, beauty,
-                                             refP, refN, uv, presenceDepth));
+    if (!appendFragment(arena, pixelEntry, sample)) {
+        pixelEntry.mDroppedCoverage += sample.mCoverage;
+    }
 }
 
-void CryptomatteBuffer::addSampleVector(unsigned x, unsigned y, float sampleId, float weight, 
+void CryptomatteBuffer::addSampleScalar(pbr::TLState *pbrTls,
+                                        unsigned x, unsigned y, float sampleId, float weight,
+                                        const scene_rdl2::math::Vec3f& position,
+                                        const scene_rdl2::math::Vec3f& p0,
+                                        const scene_rdl2::math::Vec3f& normal,
+                                        const scene_rdl2::math::Color4& beauty,
+                                        const scene_rdl2::math::Vec3f refP,
+                                        const scene_rdl2::math::Vec3f refN,
+                                        const scene_rdl2::math::Vec2f uv,
+                                        unsigned presenceDepth,
+                                        int cryptoType)
+{
+    // In scalar mode a pixel is only ever rendered by one thread, no locking needed
+    mergeSample(mArenas[pbrTls->mThreadIdx], mPixelEntries[cryptoType][y * mWidth + x],
+                Fragment(sampleId, weight, position, p0, normal, beauty, refP, refN, uv, presenceDepth));
+}
+
+void CryptomatteBuffer::addSampleVector(pbr::TLState *pbrTls,
+                                        unsigned x, unsigned y, float sampleId, float weight, 
                                         const scene_rdl2::math::Vec3f& position,
                                         const scene_rdl2::math::Vec3f& normal,
                                         const scene_rdl2::math::Color4& beauty,
@@ -98,36 +135,62 @@ void CryptomatteBuffer::addSampleVector(unsigned x, unsigned y, float sampleId,
                                         unsigned presenceDepth,
                                         bool incrementSamples)
 {
-    // Lock in case multiple threads want to add samples to this pixel
-    tbb::mutex::scoped_lock lock(mPixelMutexes[getMutexIdx(x, y)]);
+    const unsigned threadIdx = pbrTls->mThreadIdx;
+    std::vector<QueuedSample> &samples = mSampleQueues[threadIdx].mSamples;
+    // A sample which doesn't increment the sample count is queued as a fragment of 0 samples,
+    // so it merges the same way whether it is flushed before or after the sample it completes.
+    samples.push_back(QueuedSample {
+        Fragment(sampleId, weight, position, p0, normal, beauty, refP, refN, uv, presenceDepth,
+                 incrementSamples ? 1 : 0),
+        static_cast<uint32_t>(y * mWidth + x)
+    });
+    if (samples.size() == mSampleQueueSize) {
+        flushSampleQueue(threadIdx);
+    }
+}
 
-    PixelEntry &pixelEntry = mPixelEntries[CRYPTOMATTE_TYPE_REGULAR][y * mWidth + x];
+void CryptomatteBuffer::flushSampleQueue(unsigned threadIdx)
+{
+    SampleQueue &queue = mSampleQueues[threadIdx];
+    const unsigned numSamples = queue.mSamples.size();
+    if (numSamples == 0) {
+        return;
+    }
 
-    // Iterate over fragments stored at current pixel and see if we can merge the sample in to any of them
-    for (Fragment &fragment : pixelEntry.mFragments) {
-        // if multi presence is on, we treat each presence bounce as a separate cryptomatte fragment
-        bool fragMatches = mMultiPresenceOn ? fragment.mId == sampleId && fragment.mPresenceDepth == presenceDepth
-                                            : fragment.mId == sampleId;
-        if (fragMatches) {
-            fragment.mCoverage += weight;
-            fragment.mPosition += position;
-            fragment.mP0 += p0;
-            fragment.mNormal += normal;
-            fragment.mBeauty += beauty;
-            fragment.mRefP += refP;
-            fragment.mRefN += refN;
-            fragment.mUV += uv;
-            if (incrementSamples) fragment.mNumSamples++;
-            return;
-        }
+    // Sort the samples by pixel so that each pixel is only locked once.  The sort is
+    // stable so the samples of a pixel are merged in the order they were added.
+    queue.mOrder.resize(numSamples);
+    std::iota(queue.mOrder.begin(), queue.mOrder.end(), 0u);
+    std::stable_sort(queue.mOrder.begin(), queue.mOrder.end(), [&](uint32_t a, uint32_t b) {
+        return queue.mSamples[a].mPixelIdx < queue.mSamples[b].mPixelIdx;
+    });
+
+    BlockArena &arena = mArenas[threadIdx];
+    unsigned i = 0;
+    while (i < numSamples) {
+        const uint32_t pixelIdx = queue.mSamples[queue.mOrder[i]].mPixelIdx;
+        PixelEntry &pixelEntry = mPixelEntries[CRYPTOMATTE_TYPE_REGULAR][pixelIdx];
+
+        // Lock in case multiple threads want to add samples to this pixel
+        tbb::mutex::scoped_lock lock(mPixelMutexes[getMutexIdx(pixelIdx % mWidth, pixelIdx / mWidth)]);
+        do {
+            const QueuedSample &sample = queue.mSamples[queue.mOrder[i]];
+            mergeSample(arena, pixelEntry, sample.mFragment);
+            i++;
+        } while (i < numSamples && queue.mSamples[queue.mOrder[i]].mPixelIdx == pixelIdx);
     }
 
-    // No match, so add a new fragment.
-    pixelEntry.mFragments.push_back(Fragment(sampleId, weight, position, p0, normal, beauty,
-                                             refP, refN, uv, presenceDepth));
+    queue.mSamples.clear();
 }
 
-void CryptomatteBuffer::addBeautySampleVector(unsigned x, unsigned y, 
+void CryptomatteBuffer::flushSamples()
+{
+    for (unsigned i = 0; i < mSampleQueues.size(); i++) {
+        flushSampleQueue(i);
+    }
+}
+
+void CryptomatteBuffer::addBeautySampleVector(pbr::TLState *pbrTls, unsigned x, unsigned y,
                                               float id, const scene_rdl2::math::Color4& beauty,
                                               unsigned depth) 
 {
@@ -138,7 +201,7 @@ void CryptomatteBuffer::addBeautySampleVector(unsigned x, unsigned y,
     // number of samples (which we use to average position/normal data) because we already added this fragment in 
     // shadeBundleHandler, and this is basically an addendum, where we add no new position/normal data. We pass in false
     // to the incrementSamples parameter in order to suppress this incrementation 
-    addSampleVector(x, y, id, 0.f, scene_rdl2::math::Vec3f(0.f), scene_rdl2::math::Vec3f(0.f), beauty,
+    addSampleVector(pbrTls, x, y, id, 0.f, scene_rdl2::math::Vec3f(0.f), scene_rdl2::math::Vec3f(0.f), beauty,
                     scene_rdl2::math::Vec3f(0.f), scene_rdl2::math::Vec3f(0.f), scene_rdl2::math::Vec3f(0.f),
                     scene_rdl2::math::Vec2f(0.f), depth, false);
 }
@@ -149,6 +212,8 @@ void CryptomatteBuffer::finalize(const scene_rdl2::fb_util::PixelBuffer<unsigned
         return;
     }
 
+    flushSamples();
+
     // Sort fragments in each pixel and compute final coverage values
     for (int cryptoType = 0; cryptoType < NUM_CRYPTOMATTE_TYPES; cryptoType++) {
         for (size_t py = 0; py < mHeight; py++) {
@@ -161,7 +226,7 @@ void CryptomatteBuffer::finalize(const scene_rdl2::fb_util::PixelBuffer<unsigned
                     PixelEntry &pixelEntry = mPixelEntries[cryptoType][py * mWidth + px];
                     // We want ties to be broken deterministically so that we don't get false negatives when running Rats
                     // test when the fragments are added to the pixel entry in different orders.
-                    pixelEntry.mFragments.sort([](const Fragment &f0, const Fragment &f1) {
+                    std::stable_sort(pixelEntry.begin(), pixelEntry.end(), [](const Fragment &f0, const Fragment &f1) {
                         if (f0.mCoverage != f1.mCoverage) {
                             return f0.mCoverage > f1.mCoverage;
                         }
@@ -170,7 +235,8 @@ void CryptomatteBuffer::finalize(const scene_rdl2::fb_util::PixelBuffer<unsigned
 
                     // Normalize coverages so that they sum to 1 over the pixel
                     float recipNumSamples = 1.0f / static_cast<float>(numSamples);
-                    for (Fragment &fragment : pixelEntry.mFragments) {
+                    pixelEntry.mDroppedCoverage *= recipNumSamples;
+                    for (Fragment &fragment : pixelEntry) {
                         fragment.mCoverage *= recipNumSamples;
                         if (fragment.mNumSamples > 0) {
                             float recipFragNumSamples = 1.f / static_cast<float>(fragment.mNumSamples);
@@ -212,15 +278,15 @@ void CryptomatteBuffer::outputFragments(unsigned x, unsigned y,
         const PixelEntry &pixelEntry = mPixelEntries[cryptoType][y * mWidth + x];
 
         // Sum up the total coverage for all fragments
-        float totalCoverage = 0.f;
-        for (const Fragment &fragment : pixelEntry.mFragments) {
+        float totalCoverage = pixelEntry.mDroppedCoverage;
+        for (const Fragment &fragment : pixelEntry) {
             totalCoverage += fragment.mCoverage;
         }
 
         // Sum up the total coverage for the fragments we intend to output
         int numOutputFragments = 0;
         float totalOutputCoverage = 0.f;
-        for (const Fragment &fragment : pixelEntry.mFragments) {
+        for (const Fragment &fragment : pixelEntry) {
             totalOutputCoverage += fragment.mCoverage;
             if (++numOutputFragments >= 2 * numLayers) {
                 break;
@@ -231,7 +297,7 @@ void CryptomatteBuffer::outputFragments(unsigned x, unsigned y,
         float coverageScale = totalCoverage / totalOutputCoverage;
 
         int numFragments = 0;
-        for (const Fragment &fragment : pixelEntry.mFragments) {
+        for (const Fragment &fragment : pixelEntry) {
             *dest++ = fragment.mId;
             *dest++ = fragment.mCoverage * coverageScale;
             // ensure numFragments added to memory isn't larger than max number 
@@ -253,7 +319,7 @@ void CryptomatteBuffer::outputFragments(unsigned x, unsigned y,
 
         numFragments = 0;
         // Output positions, normals, and beauty
-        for (const Fragment &fragment : pixelEntry.mFragments) {
+        for (const Fragment &fragment : pixelEntry) {
 
             if (ro.getCryptomatteOutputPositions()) {
                 *dest++ = fragment.mPosition.x;
@@ -329,7 +395,8 @@ void CryptomatteBuffer::unfinalize(const scene_rdl2::fb_util::PixelBuffer<unsign
                 if (numSamples > 0) {
                     PixelEntry &pixelEntry = mPixelEntries[cryptoType][py * mWidth + px];
                     float numSamplesFloat = static_cast<float>(numSamples);
-                    for (Fragment &fragment : pixelEntry.mFragments) {
+                    pixelEntry.mDroppedCoverage *= numSamplesFloat;
+                    for (Fragment &fragment : pixelEntry) {
                         fragment.mCoverage = fragment.mCoverage * numSamplesFloat;
                         // multiply by the number of fragment samples to get the accumulated (not averaged) data
                         fragment.mPosition = fragment.mPosition * fragment.mNumSamples;
@@ -424,10 +491,12 @@ void CryptomatteBuffer::addFragments(unsigned x, unsigned y,
                 resumeRenderSupportData += 2;
             }
 
+            // resuming is single threaded, the first thread's arena holds the fragments
             if (coverage > 0.f) {
-                pixelEntry.mFragments.push_back(Fragment(id, coverage, position, p0, normal, beauty,
-                                                         refP, refN, uv,
-                                                         presenceDepth, numFragSamples));
+                appendFragment(mArenas[0], pixelEntry,
+                               Fragment(id, coverage, position, p0, normal, beauty,
+                                        refP, refN, uv,
+                                        presenceDepth, numFragSamples));
             }
         }
     }
@@ -447,11 +516,11 @@ void CryptomatteBuffer::printAllPixelEntries() const
 void CryptomatteBuffer::printFragments(unsigned x, unsigned y, int cryptoType) const
 {
     const PixelEntry &pixelEntry = mPixelEntries[cryptoType][y * mWidth + x];
-    unsigned numFragments = pixelEntry.mFragments.size();
+    unsigned numFragments = pixelEntry.mNumFragments;
 
     printf("(%u, %u): %u fragments; ", x, y, numFragments);
     int iFragment = 0;
-    for (const Fragment &fragment : pixelEntry.mFragments) {
+    for (const Fragment &fragment : pixelEntry) {
         printf("Fragment %d: ", iFragment++);
         printf("Coverage = %g, ", fragment.mCoverage);
         printf("Id = %g, ", fragment.mId);
@@ -3,12 +3,12 @@
 
 #pragma once
 
+#include "BlockArena.h"
 #include "PbrTLState.h"
 
 #include <scene_rdl2/common/fb_util/PixelBuffer.h>
 #include <scene_rdl2/scene/rdl2/RenderOutput.h>
 
-#include <list>
 #include <tbb/mutex.h>
 #include <vector>
 
@@ -105,17 +105,53 @@ private:
         {}
     };
 
+    // The fragments of a pixel are kept in a flat array carved out of the arena of the
+    // thread which adds them.  A full array is replaced by one twice as large, the old
+    // one is only recycled with the arena in clear().  A pixel keeps at most mMaxFragments
+    // fragments, the coverage of the samples which don't fit is kept in mDroppedCoverage
+    // so the output coverages are still normalized against the full pixel.
     struct PixelEntry
     {
-        std::list<Fragment> mFragments;
+        Fragment *mFragments = nullptr;
+        uint16_t mNumFragments = 0;
+        uint16_t mCapacity = 0;
+        float mDroppedCoverage = 0.f;
+
+        Fragment *begin() { return mFragments; }
+        Fragment *end() { return mFragments + mNumFragments; }
+        const Fragment *begin() const { return mFragments; }
+        const Fragment *end() const { return mFragments + mNumFragments; }
     };
 
+    // Enough for the 100 layers (200 fragments) outputFragments() can write
+    static const unsigned mMaxFragments = 256;
+    static_assert(mMaxFragments * sizeof(Fragment) <= BlockArena::mBlockSize,
+                  "Cryptomatte fragment arrays must fit in an arena block");
+
+    // In vector mode several threads add samples to the same pixel, so instead of locking
+    // the pixel for every sample each thread queues its samples.  A full queue is sorted
+    // by pixel and merged, locking each pixel once for all of its queued samples.
+    struct QueuedSample
+    {
+        Fragment mFragment;
+        uint32_t mPixelIdx;         // y * mWidth + x
+    };
+
+    struct CACHE_ALIGN SampleQueue
+    {
+        std::vector<QueuedSample> mSamples;
+        std::vector<uint32_t> mOrder;
+    };
+
+    static const unsigned mSampleQueueSize = 1024;
+
 
 public:
     CryptomatteBuffer();
     ~CryptomatteBuffer();
 
-    void init(unsigned width, unsigned height, unsigned numIdChannels, bool multiPresenceOn);
+    void init(unsigned width, unsigned height, unsigned numIdChannels, bool multiPresenceOn,
+              unsigned numRenderThreads);
 
     void clear();
 
@@ -127,10 +163,12 @@ public:
     unsigned getWidth()     const { return mWidth; }
     unsigned getHeight()    const { return mHeight; }
     bool getMultiPresenceOn() const { return mMultiPresenceOn; }
+    unsigned getNumRenderThreads() const { return mArenas.size(); }
 
     // -----------------------------------------------------------------------------------------------------------------
 
-    void addSampleScalar(unsigned x, unsigned y, float id, float weight, 
+    void addSampleScalar(pbr::TLState *pbrTls,
+                         unsigned x, unsigned y, float id, float weight, 
                          const scene_rdl2::math::Vec3f& position,
                          const scene_rdl2::math::Vec3f& p0,
                          const scene_rdl2::math::Vec3f& normal,
@@ -142,7 +180,8 @@ public:
                          int cryptoType);
 
     // For details on why we have the incrementSamples parameter, see CryptomatteBuffer.cc::addBeautySampleVector
-    void addSampleVector(unsigned x, unsigned y, float id, float weight,
+    void addSampleVector(pbr::TLState *pbrTls,
+                         unsigned x, unsigned y, float id, float weight,
                          const scene_rdl2::math::Vec3f& position,
                          const scene_rdl2::math::Vec3f& normal,
                          const scene_rdl2::math::Color4& beauty,
@@ -154,7 +193,12 @@ public:
                          bool incrementSamples = true);
 
     // see CryptomatteBuffer.cc::addBeautySampleVector for info on why this function exists only in vector mode
-    void addBeautySampleVector(unsigned x, unsigned y, float id, const scene_rdl2::math::Color4& beauty, unsigned depth);
+    void addBeautySampleVector(pbr::TLState *pbrTls, unsigned x, unsigned y, float id,
+                               const scene_rdl2::math::Color4& beauty, unsigned depth);
+
+    // Merges the samples still queued by addSampleVector().  Not thread safe, called once
+    // the render threads are done with the pass.
+    void flushSamples();
 
     void finalize(const scene_rdl2::fb_util::PixelBuffer<unsigned>& samplesCount);
     void outputFragments(unsigned x, unsigned y, int numLayers, float *dest, const scene_rdl2::rdl2::RenderOutput& ro) const;
@@ -177,6 +221,14 @@ public:
     void printFragments(unsigned x, unsigned y, int cryptoType) const;
 
 private:
+    // Merges the sample into the matching fragment of the pixel, or appends a new
+    // fragment.  The sample's mNumSamples is added to the fragment's.  No internal locking, the caller must own the pixel.
+    void mergeSample(BlockArena &arena, PixelEntry &pixelEntry, const Fragment &sample);
+    // Returns false when the pixel already holds mMaxFragments fragments
+    bool appendFragment(BlockArena &arena, PixelEntry &pixelEntry, const Fragment &fragment);
+
+    void flushSampleQueue(unsigned threadIdx);
+
     // Two sets of pixel entries: one for the regular cryptomatte data and one for the refracted
     //  cryptomatte data.
     std::vector<PixelEntry> mPixelEntries[NUM_CRYPTOMATTE_TYPES];
@@ -189,6 +241,9 @@ private:
 
     bool mMultiPresenceOn;
 
+    std::vector<BlockArena> mArenas;            // one per thread
+    std::vector<SampleQueue> mSampleQueues;     // one per thread
+
 /* The following notes are adapted from the DeepBuffer mutex description.
  *  
  * Cryptomatte pixels are independent of each other, so there is no threading hazard
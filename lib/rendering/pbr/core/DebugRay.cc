@@ -6,6 +6,8 @@
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <scene_rdl2/render/logging/logging.h>
 
+#include <zlib.h>
+
 #include <algorithm>
 #include <map>
 
@@ -13,6 +15,7 @@ namespace moonray {
 namespace pbr {
 
 #define DEBUG_RAYS_VERSION      4
+#define DEBUG_RAYS_STREAM_MAGIC uint32_t(0x53595244)   // "DRYS"
 #define NULL_RAY_VERTEX_ID      uint32_t(-1)
 #define NULL_THREAD_ID          uint16_t(-1)
 
@@ -100,10 +103,18 @@ write(FILE *file, T value)
 BBox2i DebugRayRecorder::sActiveViewport = BBox2i(Vec2i(0), Vec2i(-1));
 Mat4f DebugRayRecorder::sRender2World = Mat4f(one);
 unsigned DebugRayRecorder::sMaxVertsPerThread = 0;
+unsigned DebugRayRecorder::sPathSampleRate = 1;
+std::string DebugRayRecorder::sStreamFilePrefix;
 bool DebugRayRecorder::sRecordingEnabled = false;
 
 DebugRayRecorder::DebugRayRecorder(uint32_t threadId) :
-    mThreadId(uint16_t(threadId))
+    mThreadId(uint16_t(threadId)),
+    mNextId(0),
+    mEndId(0),
+    mBlockBaseId(0),
+    mNumPathsStarted(0),
+    mStreamFile(nullptr),
+    mNumStreamedBytes(0)
 {
     MNRY_ASSERT(threadId < 0xffff);
 
@@ -124,6 +135,19 @@ DebugRayRecorder::record()
         VertexBlock *vertBlock = new VertexBlock;
         vertBlock->reserve(MAX_VERTS_PER_BLOCK);
         mVertexBlocks.push_back(vertBlock);
+
+        if (isStreaming()) {
+            const std::string fileName = getStreamFileName(sStreamFilePrefix, mThreadId);
+            mStreamFile = fopen(fileName.c_str(), "wb");
+            if (!mStreamFile ||
+                !write(mStreamFile, DEBUG_RAYS_STREAM_MAGIC) ||
+                !write(mStreamFile, uint32_t(DEBUG_RAYS_VERSION)) ||
+                !write(mStreamFile, uint32_t(mThreadId)) ||
+                !write(mStreamFile, sRender2World)) {
+                Logger::error("[MCRT-RENDER] Unable to create debug ray stream file \"" , fileName , "\".");
+                mEndId = 0;
+            }
+        }
     }
 }
 
@@ -131,6 +155,14 @@ void
 DebugRayRecorder::stopRecording()
 {
     mEndId = mNextId;
+
+    if (mStreamFile) {
+        flushStream();
+        if (mStreamFile) {
+            fclose(mStreamFile);
+            mStreamFile = nullptr;
+        }
+    }
 }
 
 void
@@ -138,6 +170,14 @@ DebugRayRecorder::cleanUp()
 {
     mEndId = 0;
     mNextId = 0;
+    mBlockBaseId = 0;
+    mNumPathsStarted = 0;
+    mNumStreamedBytes = 0;
+
+    if (mStreamFile) {
+        fclose(mStreamFile);
+        mStreamFile = nullptr;
+    }
 
     for (auto it = mVertexBlocks.begin(); it != mVertexBlocks.end(); ++it) {
         delete *it;
@@ -154,7 +194,15 @@ DebugRayRecorder::startNewRay(Vec3f const &origin, unsigned screenX, unsigned sc
 {
     if (int(screenX) >= sActiveViewport.lower.x && int(screenX) <= sActiveViewport.upper.x &&
         int(screenY) >= sActiveViewport.lower.y && int(screenY) <= sActiveViewport.upper.y &&
-        mNextId < mEndId) {
+        mNextId < mEndId && (mNumPathsStarted++ % sPathSampleRate) == 0) {
+
+        // no path is in flight on this thread, the previous ones can go to disk
+        if (mStreamFile && getNumBufferedRayVertices() >= MAX_VERTS_PER_BLOCK) {
+            flushStream();
+            if (mNextId >= mEndId) {
+                return &mDummyVertex;
+            }
+        }
 
         DebugRayVertex *vert = allocRayVertex();
 
@@ -203,13 +251,16 @@ DebugRayRecorder::extendRay(DebugRayVertex const *parent)
 
 void
 DebugRayRecorder::enableRecording(BBox2i viewport, Mat4f const &render2world,
-        uint32_t maxVerticesPerThread)
+        uint32_t maxVerticesPerThread, uint32_t pathSampleRate,
+        std::string const &streamFilePrefix)
 {
     MOONRAY_START_THREADSAFE_STATIC_WRITE
 
     sActiveViewport = viewport;
     sRender2World = render2world;
     sMaxVertsPerThread = maxVerticesPerThread;
+    sPathSampleRate = std::max(pathSampleRate, 1u);
+    sStreamFilePrefix = streamFilePrefix;
     sRecordingEnabled = true;
 
     MOONRAY_FINISH_THREADSAFE_STATIC_WRITE
@@ -222,18 +273,63 @@ DebugRayRecorder::disableRecording()
     sActiveViewport = BBox2i(Vec2i(0), Vec2i(-1));
     sRender2World = Mat4f(one);
     sMaxVertsPerThread = 0;
+    sPathSampleRate = 1;
+    sStreamFilePrefix.clear();
     sRecordingEnabled = false;
     MOONRAY_FINISH_THREADSAFE_STATIC_WRITE
 }
 
+std::string
+DebugRayRecorder::getStreamFileName(std::string const &prefix, uint32_t threadId)
+{
+    return prefix + "." + std::to_string(threadId) + ".rays";
+}
+
+void
+DebugRayRecorder::flushStream()
+{
+    MNRY_ASSERT(mStreamFile);
+
+    // each block is a chunk: vertex count, compressed size, zlib data
+    bool success = true;
+    for (auto it = mVertexBlocks.begin(); it != mVertexBlocks.end(); ++it) {
+        VertexBlock *vertBlock = *it;
+        if (success && !vertBlock->empty()) {
+            const uLong srcSize = uLong(vertBlock->size() * sizeof(DebugRayVertex));
+            uLongf dstSize = compressBound(srcSize);
+            mCompressBuffer.resize(dstSize);
+            // the fastest level, this runs on the render threads
+            success = compress2(mCompressBuffer.data(), &dstSize,
+                                reinterpret_cast<Bytef const *>(vertBlock->data()), srcSize, 1) == Z_OK &&
+                      write(mStreamFile, uint32_t(vertBlock->size())) &&
+                      write(mStreamFile, uint32_t(dstSize)) &&
+                      writeRawData(mStreamFile, mCompressBuffer.data(), dstSize);
+            mNumStreamedBytes += dstSize;
+        }
+        mBlockBaseId += uint32_t(vertBlock->size());
+        delete vertBlock;
+    }
+    mVertexBlocks.clear();
+
+    MNRY_ASSERT(mBlockBaseId == mNextId);
+
+    if (!success) {
+        Logger::error("[MCRT-RENDER] Failed to write debug ray stream file \"" ,
+                      getStreamFileName(sStreamFilePrefix, mThreadId) , "\", recording stopped.");
+        fclose(mStreamFile);
+        mStreamFile = nullptr;
+        mEndId = mNextId;
+    }
+}
+
 DebugRayVertex *
 DebugRayRecorder::allocRayVertex()
 {
     // we have checked this is true higher up
     MNRY_ASSERT(mNextId < mEndId);
 
-    VertexBlock *vertBlock = mVertexBlocks.back();
-    if (vertBlock->size() == MAX_VERTS_PER_BLOCK) {
+    VertexBlock *vertBlock = mVertexBlocks.empty() ? nullptr : mVertexBlocks.back();
+    if (!vertBlock || vertBlock->size() == MAX_VERTS_PER_BLOCK) {
         // time to allocate a new list
         vertBlock = new VertexBlock;
         vertBlock->reserve(MAX_VERTS_PER_BLOCK);
@@ -258,9 +354,10 @@ DebugRayRecorder::allocRayVertex()
 DebugRayVertex *
 DebugRayRecorder::getRay(uint32_t id)
 {
-    if (id < mEndId) {
-        size_t listIdx = id >> MAX_VERTS_PER_BLOCK_SHIFT;
-        size_t elemIdx = id & (MAX_VERTS_PER_BLOCK - 1);
+    if (id < mEndId && id >= mBlockBaseId) {
+        // after a flush, the blocks are filled again starting from mBlockBaseId
+        size_t listIdx = (id - mBlockBaseId) >> MAX_VERTS_PER_BLOCK_SHIFT;
+        size_t elemIdx = (id - mBlockBaseId) & (MAX_VERTS_PER_BLOCK - 1);
 
         if (listIdx < mVertexBlocks.size() && elemIdx < mVertexBlocks[listIdx]->size()) {
             return &((*mVertexBlocks[listIdx])[elemIdx]);
@@ -273,10 +370,39 @@ DebugRayRecorder::getRay(uint32_t id)
 
 bool
 DebugRayBuilder::build(unsigned width, unsigned height, std::vector<DebugRayRecorder *> const &recorders)
+{
+    std::vector<VertexSpan> spans;
+    for (size_t i = 0; i < recorders.size(); ++i) {
+        // streamed vertices have left the recorder, only the buffered ones are built
+        DebugRayRecorder *recorder = recorders[i];
+        for (size_t iblock = 0; iblock < recorder->mVertexBlocks.size(); ++iblock) {
+            DebugRayRecorder::VertexBlock &vertBlock = *recorder->mVertexBlocks[iblock];
+            spans.emplace_back(vertBlock.data(), vertBlock.size());
+        }
+    }
+
+    return build(width, height, spans, DebugRayRecorder::sRender2World);
+}
+
+bool
+DebugRayBuilder::build(unsigned width, unsigned height, std::vector<DebugRayVertex> *vertices,
+                       Mat4f const &render2world)
+{
+    MNRY_ASSERT(vertices);
+
+    std::vector<VertexSpan> spans;
+    spans.emplace_back(vertices->data(), vertices->size());
+
+    return build(width, height, spans, render2world);
+}
+
+bool
+DebugRayBuilder::build(unsigned width, unsigned height, std::vector<VertexSpan> const &spans,
+                       Mat4f const &render2world)
 {
     cleanUp();
 
-    if (recorders.empty() || !width || !height) {
+    if (spans.empty() || !width || !height) {
         return false;
     }
 
@@ -289,8 +415,8 @@ DebugRayBuilder::build(unsigned width, unsigned height, std::vector<DebugRayReco
 
     // compute total amount of debug vertices
     size_t numSrcVertices = 0;
-    for (size_t i = 0; i < recorders.size(); ++i) {
-        numSrcVertices += recorders[i]->getNumRayVertices();
+    for (size_t i = 0; i < spans.size(); ++i) {
+        numSrcVertices += spans[i].second;
     }
 
     if (!numSrcVertices) {
@@ -315,26 +441,23 @@ DebugRayBuilder::build(unsigned width, unsigned height, std::vector<DebugRayReco
         // reserve 0 as the parent id
         remapper.remapId(fullId(NULL_RAY_VERTEX_ID, NULL_THREAD_ID));
 
-        for (size_t i = 0; i < recorders.size(); ++i) {
-            DebugRayRecorder *recorder = recorders[i];
-            for (size_t iblock = 0; iblock < recorder->mVertexBlocks.size(); ++iblock) {
-                DebugRayRecorder::VertexBlock &vertBlock = *recorders[i]->mVertexBlocks[iblock];
-                for (size_t ivert = 0; ivert < vertBlock.size(); ++ivert, ++numNodes) {
-                    DebugRayVertex *vert = &vertBlock[ivert];
-                    MNRY_ASSERT(vert->mScreenX < mWidth && vert->mScreenY < mHeight);
-
-                    vert->mParentId = remapper.remapId(fullParentId(*vert));
-                    vert->mId = remapper.remapId(fullId(*vert));
-
-                    // verify the index of the vert matches up with its location in the
-                    // mNodes array
-                    MNRY_ASSERT(vert->mId == numNodes);
-
-                    Node *node = &mNodes[numNodes];
-                    node->mVertex = &vertBlock[ivert];
-                    node->mParent = nullptr;    // this gets hookup up later
-                    node->mNumSubnodes = 1;     // start at 1 to account for self
-                }
+        for (size_t ispan = 0; ispan < spans.size(); ++ispan) {
+            DebugRayVertex *spanVerts = spans[ispan].first;
+            for (size_t ivert = 0; ivert < spans[ispan].second; ++ivert, ++numNodes) {
+                DebugRayVertex *vert = &spanVerts[ivert];
+                MNRY_ASSERT(vert->mScreenX < mWidth && vert->mScreenY < mHeight);
+
+                vert->mParentId = remapper.remapId(fullParentId(*vert));
+                vert->mId = remapper.remapId(fullId(*vert));
+
+                // verify the index of the vert matches up with its location in the
+                // mNodes array
+                MNRY_ASSERT(vert->mId == numNodes);
+
+                Node *node = &mNodes[numNodes];
+                node->mVertex = vert;
+                node->mParent = nullptr;    // this gets hookup up later
+                node->mNumSubnodes = 1;     // start at 1 to account for self
             }
         }
 
@@ -453,7 +576,6 @@ DebugRayBuilder::build(unsigned width, unsigned height, std::vector<DebugRayReco
     //
     // transform everything into world space before saving
     //
-    Mat4f render2world = DebugRayRecorder::sRender2World;
     if (render2world != Mat4f(one)) {
 
         for (size_t i = 0; i < mSortedVertices.size(); ++i) {
@@ -520,6 +642,80 @@ DebugRayBuilder::depthFirstPreorderTraversal(Node const *rootNode, Node *node, s
 
 //----------------------------------------------------------------------------
 
+DebugRayStreamReader::DebugRayStreamReader() :
+    mFile(nullptr),
+    mThreadId(0),
+    mRender2World(one)
+{
+}
+
+bool
+DebugRayStreamReader::open(char const *fileName)
+{
+    close();
+
+    mFile = fopen(fileName, "rb");
+    if (!mFile) {
+        Logger::error("[MCRT-RENDER] Unable to open file \"" , fileName , "\".");
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!read(mFile, &magic) || magic != DEBUG_RAYS_STREAM_MAGIC ||
+        !read(mFile, &version) || version != DEBUG_RAYS_VERSION ||
+        !read(mFile, &mThreadId) ||
+        !read(mFile, &mRender2World)) {
+        Logger::error("[MCRT-RENDER] \"" , fileName , "\" is not a debug ray stream file.");
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void
+DebugRayStreamReader::close()
+{
+    if (mFile) {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+    mThreadId = 0;
+    mRender2World = Mat4f(one);
+}
+
+bool
+DebugRayStreamReader::readChunk(std::vector<DebugRayVertex> *vertices)
+{
+    MNRY_ASSERT(vertices);
+
+    uint32_t numVerts = 0;
+    uint32_t compressedSize = 0;
+    if (!mFile || !read(mFile, &numVerts) || !read(mFile, &compressedSize)) {
+        return false;
+    }
+
+    mCompressed.resize(compressedSize);
+    if (!readRawData(mFile, mCompressed.data(), compressedSize)) {
+        return false;
+    }
+
+    const size_t offset = vertices->size();
+    vertices->resize(offset + numVerts);
+    uLongf rawSize = uLongf(numVerts * sizeof(DebugRayVertex));
+    if (uncompress(reinterpret_cast<Bytef *>(vertices->data() + offset), &rawSize,
+                   mCompressed.data(), compressedSize) != Z_OK ||
+        rawSize != numVerts * sizeof(DebugRayVertex)) {
+        vertices->resize(offset);
+        return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
 DebugRayDatabase::Iterator::Iterator(DebugRayDatabase const &db, DebugRayFilter const *filter) :
     mDb(&db),
     mNumPrimariesSeen(0),
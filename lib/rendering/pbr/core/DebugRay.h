@@ -8,7 +8,10 @@
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/mcrt_common/Ray.h>
 
+#include <cstdio>
 #include <set>
+#include <string>
+#include <utility>
 #include <vector>
 
 /// Comment this out to remove the debug ray instrumentation from the integrator.
@@ -168,6 +171,12 @@ static_assert(sizeof(DebugRayVertex) == 96, "DebugRayVertex is an unexpected siz
 /// Each thread will have its own instance of a DebugRayRecorder in thread local
 /// storage. Data from each instance then gets merged inside of the DebugRayRecorder.
 ///
+/// Recording a large region doesn't fit in memory, so a recorder can instead
+/// stream its vertices to a file of its own (see enableRecording). Full blocks
+/// of vertices are zlib compressed and appended to the file as chunks, whenever
+/// a new path starts, so that only the vertices of the path being traced stay
+/// in memory. The chunks are read back with DebugRayStreamReader.
+///
 
 class DebugRayRecorder
 {
@@ -190,6 +199,12 @@ public:
 
     size_t          getNumRayVertices() const       { return mNextId; }
 
+    /// Vertices still held in memory, i.e. not streamed out yet.
+    size_t          getNumBufferedRayVertices() const   { return mNextId - mBlockBaseId; }
+
+    size_t          getNumStreamedRayVertices() const   { return mBlockBaseId; }
+    size_t          getNumStreamedBytes() const         { return mNumStreamedBytes; }
+
     DebugRayVertex *startNewRay(scene_rdl2::math::Vec3f const &origin, unsigned screenX,
                                 unsigned screenY, uint32_t userTags = 0);
     DebugRayVertex *extendRay(DebugRayVertex const *parent);
@@ -205,13 +220,24 @@ public:
     /// - A cap on the amount of rays we can record on each thread, otherwise
     ///   there no limit, but beware that the machine may have to switch to swap
     ///   for even very modest images.
+    /// - A path sample rate N, to only record 1 in N of the paths started on
+    ///   each thread. The paths which aren't sampled record into the dummy ray.
+    /// - A stream file prefix, to stream the vertices of each thread into the
+    ///   file getStreamFileName(prefix, threadId) instead of keeping them in
+    ///   memory. Streamed vertices can't be passed to the DebugRayBuilder
+    ///   directly, use DebugRayStreamReader to load them.
     ///
     static void     enableRecording(scene_rdl2::math::BBox2i viewport,
                                     scene_rdl2::math::Mat4f const &render2world,
-                                    uint32_t maxVerticesPerThread = 0x200000);
+                                    uint32_t maxVerticesPerThread = 0x200000,
+                                    uint32_t pathSampleRate = 1,
+                                    std::string const &streamFilePrefix = std::string());
 
     static void     disableRecording();
     static bool     isRecordingEnabled()    { return sRecordingEnabled; }
+    static bool     isStreaming()           { return !sStreamFilePrefix.empty(); }
+
+    static std::string getStreamFileName(std::string const &prefix, uint32_t threadId);
 
     static scene_rdl2::math::Mat4f const &getRenderToWorldMatrix()   { return sRender2World; }
 
@@ -222,6 +248,11 @@ public:
 private:
     DebugRayVertex *allocRayVertex();
 
+    /// Writes the buffered vertices to the stream file and frees their blocks.
+    /// Only safe while no path is being traced on this thread, since the
+    /// vertices of the current path are referenced by the TLS vertex stack.
+    void            flushStream();
+
     DebugRayVertex *getRay(uint32_t id);
     DebugRayVertex const *getRay(uint32_t id) const    { return const_cast<DebugRayRecorder *>(this)->getRay(id); }
 
@@ -230,15 +261,27 @@ private:
     uint32_t        mNextId;
     uint32_t        mEndId;     // one past end
 
+    /// Id of the first vertex of mVertexBlocks, the vertices before it have
+    /// been streamed out.
+    uint32_t        mBlockBaseId;
+
+    uint32_t        mNumPathsStarted;
+
     typedef std::vector<DebugRayVertex> VertexBlock;
     std::vector<VertexBlock *>  mVertexBlocks;
 
+    FILE *          mStreamFile;
+    size_t          mNumStreamedBytes;
+    std::vector<uint8_t> mCompressBuffer;
+
     /// Return this if we are starting a new ray outside of the active area.
     DebugRayVertex  mDummyVertex;
 
     static scene_rdl2::math::BBox2i sActiveViewport;
     static scene_rdl2::math::Mat4f sRender2World;
     static unsigned sMaxVertsPerThread;
+    static unsigned sPathSampleRate;
+    static std::string sStreamFilePrefix;
     static bool sRecordingEnabled;
 };
 
@@ -286,6 +329,11 @@ public:
     // @@@ TODO, Pass in a matrix to go from shade space to world space before
     // saving data out.
     bool    build(unsigned width, unsigned height, std::vector<DebugRayRecorder *> const &recorders);
+
+    /// Builds from vertices in recorder form, e.g. read with a DebugRayStreamReader.
+    /// The vertices are mutated in the same way as the recorders' above.
+    bool    build(unsigned width, unsigned height, std::vector<DebugRayVertex> *vertices,
+                  scene_rdl2::math::Mat4f const &render2world);
     void    cleanUp();
 
     bool    exportDatabase(DebugRayDatabase *dst) const;
@@ -293,6 +341,11 @@ public:
 private:
     struct Node;
 
+    typedef std::pair<DebugRayVertex *, size_t> VertexSpan;
+
+    bool    build(unsigned width, unsigned height, std::vector<VertexSpan> const &spans,
+                  scene_rdl2::math::Mat4f const &render2world);
+
     // fills in the ordering vector with the final desired locations of each DebugRayVertex
     void    depthFirstPreorderTraversal(Node const *rootNode, Node *node, std::vector<uint32_t> *ordering) const;
 
@@ -333,6 +386,41 @@ private:
 
 //----------------------------------------------------------------------------
 
+///
+/// Reads the stream files written by DebugRayRecorders in streaming mode, one
+/// chunk at a time so that files larger than memory can be scanned. Vertices
+/// are returned in recorder form: in render space and identified by their
+/// (mId, mThreadId) and (mParentId, mParentThreadId) pairs.
+///
+
+class DebugRayStreamReader
+{
+public:
+                    DebugRayStreamReader();
+                    ~DebugRayStreamReader() { close(); }
+
+    bool            open(char const *fileName);
+    void            close();
+
+    /// Appends the vertices of the next chunk, returns false once the end of
+    /// the file is reached or if the chunk is corrupt.
+    bool            readChunk(std::vector<DebugRayVertex> *vertices);
+
+    uint32_t        getThreadId() const                 { return mThreadId; }
+    scene_rdl2::math::Mat4f const &getRenderToWorldMatrix() const   { return mRender2World; }
+
+                    DebugRayStreamReader(DebugRayStreamReader const &other) = delete;
+    DebugRayStreamReader &operator = (DebugRayStreamReader const &other) = delete;
+
+private:
+    FILE *          mFile;
+    uint32_t        mThreadId;
+    scene_rdl2::math::Mat4f mRender2World;
+    std::vector<uint8_t> mCompressed;
+};
+
+//----------------------------------------------------------------------------
+
 ///
 /// DebugRayFilter is the structure a user would use to generate a ray database
 /// query. Each member relates to another way to filter down the potentially
@@ -16,7 +16,9 @@
 #include <OpenEXR/ImfStringAttribute.h>
 #include <OpenEXR/ImfVecAttribute.h>
 
+#include <algorithm>
 #include <fstream>
+#include <numeric>
 
 
 namespace moonray {
@@ -50,19 +52,27 @@ DeepBuffer::~DeepBuffer()
 void
 DeepBuffer::clear()
 {
-    // iterate over the hard surface segment linked lists and free the segments
+    // an unfinished stream owns heap allocated segments
+    if (mStreaming) {
+        freeSegments(0, mHeight);
+        mStreamOutputs.clear();
+        mStreaming = false;
+    }
+    mStreamedFilenames.clear();
+
+    // reset the hard surface segment linked lists
     for (size_t i = 0; i < mWidth * mHeight; i++) {
         for (size_t layer = 0; layer < mMaxLayers; layer++) {
-            HardSurfaceSegment *current = mHardSurfaceSegments[layer][i];
-            while (current) {
-                HardSurfaceSegment *next = current->mNext;
-                free(current);
-                current = next;
-            }
             mHardSurfaceSegments[layer][i] = nullptr;
         }
     }
 
+    // the hard surface segments live in the arenas, drop any unmerged samples too
+    for (unsigned i = 0; i < mNumRenderThreads; i++) {
+        mSegmentArenas[i].clear();
+        mSampleQueues[i].mNumSamples = 0;
+    }
+
     // iterate over the volume output segment linked lists and free the segments
     for (size_t i = 0; i < mWidth * mHeight; i++) {
         VolumeOutputSegment *current = mVolumeOutputSegments[i];
@@ -133,6 +143,17 @@ DeepBuffer::initDeep(unsigned width, unsigned height,
         mVolumePixelBuffers[i].mSampleList = nullptr;
         mVolumePixelBuffers[i].clear();
     }
+
+    mSegmentArenas.resize(mNumRenderThreads);
+
+    MNRY_ASSERT(mMaxLayers <= 256);
+    mAllChannels.resize(mNumChannels);
+    std::iota(mAllChannels.begin(), mAllChannels.end(), 0);
+    mSampleQueues.resize(mNumRenderThreads);
+    for (unsigned i = 0; i < mNumRenderThreads; i++) {
+        mSampleQueues[i].mData.resize(mSampleQueueCapacity * getQueuedSampleFloats());
+        mSampleQueues[i].mNumSamples = 0;
+    }
 }
 
 void
@@ -186,66 +207,57 @@ DeepBuffer::addSample(pbr::TLState *pbrTls,
     scene_rdl2::math::Vec3f nnormal = normal;
     nnormal.safeNormalize();
 
-    // Don't need to lock in scalar mode
-    auto addSample8x8Func = pbrTls->mFs->mExecutionMode == mcrt_common::ExecutionMode::SCALAR ?
-        &DeepBuffer::addSample8x8 :
-        &DeepBuffer::addSample8x8Safe;
-
-    if (mFormat == DeepFormat::OpenEXR2_0) {
-        // No sample duplication is needed.  Although we are still calling the 8x8
-        // function, and an 8x8 mask is being constructed, we ignore it when we
-        // output the deep file.
-        (this->*addSample8x8Func)(x, y, subpixelX, subpixelY, layer, deepIDs, t, rayZ, nnormal,
-                                  alpha, channels, numChannels, values, scale, weight);
-    } else {
-        // If the subpixel res is less than 8, we need to duplicate samples to
-        //  fill the subpixel mask.
+    // If the subpixel res is less than 8, we need to duplicate samples to
+    //  fill the subpixel mask.
+    unsigned subpixelSize = 1;
+    if (mFormat == DeepFormat::OpenDCX2_0) {
         switch (mSubpixelRes) {
-        case 8:  // 8x8, no sample duplication needed
-            (this->*addSample8x8Func)(x, y, subpixelX, subpixelY, layer, deepIDs, t, rayZ, nnormal,
-                                      alpha, channels, numChannels, values, scale, weight);
-        break;
-        case 4:  // 4x4, duplicate samples
-        {
-            unsigned startX = subpixelX & 0x06;
-            unsigned startY = subpixelY & 0x06;
-            for (int ssy = startY; ssy < startY + 2; ssy++) {
-                for (int ssx = startX; ssx < startX + 2; ssx++) {
-                    (this->*addSample8x8Func)(x, y, ssx, ssy, layer, deepIDs, t, rayZ, nnormal,
-                                     alpha, channels, numChannels, values, scale, weight);
-                }
-            }
-        }
-        break;
-        case 2:  // 2x2, duplicate samples
-        {
-            unsigned startX = subpixelX & 0x04;
-            unsigned startY = subpixelY & 0x04;
-            for (int ssy = startY; ssy < startY + 4; ssy++) {
-                for (int ssx = startX; ssx < startX + 4; ssx++) {
-                    (this->*addSample8x8Func)(x, y, ssx, ssy, layer, deepIDs, t, rayZ, nnormal,
-                                              alpha, channels, numChannels, values, scale, weight);
-                }
-            }
-        }
-        break;
-        case 1:  // 1x1, duplicate samples
-            for (int ssy = 0; ssy < 8; ssy++) {
-                for (int ssx = 0; ssx < 8; ssx++) {
-                    (this->*addSample8x8Func)(x, y, ssx, ssy, layer, deepIDs, t, rayZ, nnormal,
-                                              alpha, channels, numChannels, values, scale, weight);
-                }
-            }
-        break;
+        case 8: subpixelSize = 1; break;    // 8x8, no sample duplication needed
+        case 4: subpixelSize = 2; break;    // 4x4, duplicate samples
+        case 2: subpixelSize = 4; break;    // 2x2, duplicate samples
+        case 1: subpixelSize = 8; break;    // 1x1, duplicate samples
         default:
             MNRY_ASSERT(0);
         }
     }
+    // No sample duplication is needed for OpenEXR2_0.  Although an 8x8 mask is
+    // still being constructed, we ignore it when we output the deep file.
+    subpixelX &= ~(subpixelSize - 1);
+    subpixelY &= ~(subpixelSize - 1);
+
+    if (pbrTls->mFs->mExecutionMode == mcrt_common::ExecutionMode::SCALAR) {
+        // Don't need to lock in scalar mode
+        addSampleBlock(mSegmentArenas[pbrTls->mThreadIdx], x, y, subpixelX, subpixelY, subpixelSize,
+                       layer, deepIDs, t, rayZ, nnormal, alpha, channels, numChannels, values, scale, weight);
+    } else {
+        queueSample(pbrTls->mThreadIdx, x, y, subpixelX, subpixelY, subpixelSize,
+                    layer, deepIDs, t, rayZ, nnormal, alpha, channels, numChannels, values, scale, weight);
+    }
 }
 
-// No internal locking, suitable for scalar mode execution.
 void
-DeepBuffer::addSample8x8(unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
+DeepBuffer::addSampleBlock(BlockArena &arena,
+                           unsigned x, unsigned y,
+                           unsigned subpixelX, unsigned subpixelY, unsigned subpixelSize,
+                           int layer,
+                           const float *ids, float t, float rayZ,
+                           const scene_rdl2::math::Vec3f& normal, float alpha,
+                           const int *channels, int numChannels,
+                           const float *values,
+                           float scale, float weight)
+{
+    for (unsigned ssy = subpixelY; ssy < subpixelY + subpixelSize; ssy++) {
+        for (unsigned ssx = subpixelX; ssx < subpixelX + subpixelSize; ssx++) {
+            addSample8x8(arena, x, y, ssx, ssy, layer, ids, t, rayZ, normal,
+                         alpha, channels, numChannels, values, scale, weight);
+        }
+    }
+}
+
+// No internal locking, the caller must own the pixel.
+void
+DeepBuffer::addSample8x8(BlockArena &arena,
+                         unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
                          int layer,
                          const float *ids, float t, float rayZ,
                          const scene_rdl2::math::Vec3f& normal, float alpha,
@@ -296,23 +308,10 @@ DeepBuffer::addSample8x8(unsigned x, unsigned y, unsigned subpixelX, unsigned su
     }
 
     // At the end of the list without being able to merge.  Append a new segment.
-    HardSurfaceSegment *newSegment = (HardSurfaceSegment*)malloc(getHardSurfaceSegmentSize());
-    // Intuitively, doing a malloc() here which needs to lock the heap is a bad idea
-    //  as it would block other threads adding samples here.  But... this code rarely
-    //  gets called because the vast majority of the samples are merged into existing
-    //  segments.  The number of segments allocated here is in the same ballpark as
-    //  the number of pixels in the image, as some pixels will be empty (no segments),
-    //  most pixels will have one segment (as they overlap only one scene object),
-    //  and a small percentage of pixels will have multiple segments, such as at
-    //  object edges.  Allocating a few million small objects on the heap in this way
-    //  doesn't seem to measurably affect rendering time.
-    // If we have massive numbers of threads this might start to become a problem,
-    //  but we could pre-allocate blocks of segments per thread, and the new segment
-    //  would be pulled from the current thread's preallocated segments.  Testing
-    //  hasn't shown a need for this yet.
-    // Discussing with Mark: We can add a frame arena that persists for the lifetime
-    //  of the frame to the ThreadLocalState object.  This arena is cleared at the end
-    //  of the frame.
+    // This rarely gets called because the vast majority of the samples are merged
+    //  into existing segments, the segments are allocated from the thread's arena
+    //  so it doesn't need to lock the heap either way.
+    HardSurfaceSegment *newSegment = (HardSurfaceSegment*)allocHardSurfaceSegment(arena);
     if (prev) {
         prev->mNext = newSegment;
     } else { // at start of list
@@ -340,21 +339,93 @@ DeepBuffer::addSample8x8(unsigned x, unsigned y, unsigned subpixelX, unsigned su
     newSegment->mNext = nullptr;
 }
 
-// Does internal locking, suitable for vector mode execution.
+// Queues the sample in the thread's SampleQueue, suitable for vector mode execution.
+void
+DeepBuffer::queueSample(unsigned threadIdx,
+                        unsigned x, unsigned y,
+                        unsigned subpixelX, unsigned subpixelY, unsigned subpixelSize,
+                        int layer,
+                        const float *ids, float t, float rayZ,
+                        const scene_rdl2::math::Vec3f& normal, float alpha,
+                        const int *channels, int numChannels,
+                        const float *values,
+                        float scale, float weight)
+{
+    SampleQueue &queue = mSampleQueues[threadIdx];
+    if (queue.mNumSamples == mSampleQueueCapacity) {
+        flushSampleQueue(threadIdx);
+    }
+
+    QueuedSample *sample = getQueuedSample(queue, queue.mNumSamples++);
+    sample->mPixelIdx = y * mWidth + x;
+    sample->mSubpixelX = subpixelX;
+    sample->mSubpixelY = subpixelY;
+    sample->mSubpixelSize = subpixelSize;
+    sample->mLayer = layer;
+    sample->mT = t;
+    sample->mRayZ = rayZ;
+    sample->mNormal = normal;
+    sample->mAlpha = alpha * scale;
+    sample->mWeight = weight;
+
+    for (size_t i = 0; i < mDeepIDChannels.size(); i++) {
+        sample->mIDsAndValues[i] = ids[i];
+    }
+    float *sampleValues = sample->mIDsAndValues + mDeepIDChannels.size();
+    for (int i = 0; i < mNumChannels; i++) {
+        sampleValues[i] = 0.f;
+    }
+    for (int i = 0; i < numChannels; i++) {
+        sampleValues[channels[i]] += values[i] * scale;
+    }
+}
+
 void
-DeepBuffer::addSample8x8Safe(unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
-                             int layer,
-                             const float *ids, float t, float rayZ,
-                             const scene_rdl2::math::Vec3f& normal, float alpha,
-                             const int *channels, int numChannels,
-                             const float *values,
-                             float scale, float weight)
+DeepBuffer::flushSampleQueue(unsigned threadIdx)
 {
-    // Lock in case multiple threads want to add samples to this pixel
-    tbb::mutex::scoped_lock lock(mPixelMutex[getMutexIdx(x, y)]);
+    SampleQueue &queue = mSampleQueues[threadIdx];
+    const unsigned numSamples = queue.mNumSamples;
+    if (numSamples == 0) {
+        return;
+    }
+
+    // Sort the samples by pixel so that each pixel is only locked once.  The sort is
+    //  stable so the samples of a pixel are merged in the order they were added.
+    queue.mOrder.resize(numSamples);
+    std::iota(queue.mOrder.begin(), queue.mOrder.end(), 0u);
+    std::stable_sort(queue.mOrder.begin(), queue.mOrder.end(), [&](uint32_t a, uint32_t b) {
+        return getQueuedSample(queue, a)->mPixelIdx < getQueuedSample(queue, b)->mPixelIdx;
+    });
+
+    BlockArena &arena = mSegmentArenas[threadIdx];
+    unsigned i = 0;
+    while (i < numSamples) {
+        const uint32_t pixelIdx = getQueuedSample(queue, queue.mOrder[i])->mPixelIdx;
+        const unsigned x = pixelIdx % mWidth;
+        const unsigned y = pixelIdx / mWidth;
+
+        // Lock in case multiple threads want to add samples to this pixel
+        tbb::mutex::scoped_lock lock(mPixelMutex[getMutexIdx(x, y)]);
+        do {
+            const QueuedSample *sample = getQueuedSample(queue, queue.mOrder[i]);
+            addSampleBlock(arena, x, y, sample->mSubpixelX, sample->mSubpixelY, sample->mSubpixelSize,
+                           sample->mLayer, sample->mIDsAndValues, sample->mT, sample->mRayZ,
+                           sample->mNormal, sample->mAlpha,
+                           mAllChannels.data(), mNumChannels, sample->mIDsAndValues + mDeepIDChannels.size(),
+                           1.f, sample->mWeight);
+            i++;
+        } while (i < numSamples && getQueuedSample(queue, queue.mOrder[i])->mPixelIdx == pixelIdx);
+    }
+
+    queue.mNumSamples = 0;
+}
 
-    addSample8x8(x, y, subpixelX, subpixelY, layer, ids, t, rayZ, normal, alpha,
-                 channels, numChannels, values, scale, weight);
+void
+DeepBuffer::flushSamples()
+{
+    for (unsigned i = 0; i < mNumRenderThreads; i++) {
+        flushSampleQueue(i);
+    }
 }
 
 void
@@ -363,6 +434,9 @@ DeepBuffer::finishPixel(unsigned threadIdx)
     VolumePixelBuffer &vpb = mVolumePixelBuffers[threadIdx];
 
     if (vpb.mCurrentX != 0xffffffff && vpb.mCurrentY != 0xffffffff) {
+        // The volume segments are clipped against the hard surfaces, merge in the hard
+        //  surface samples this thread has queued so far.
+        flushSampleQueue(threadIdx);
         mVolumeOutputSegments[mWidth * vpb.mCurrentY + vpb.mCurrentX] =
             vpb.mergeSegments(*this,
                               std::min(mSamplesPerPixel, VolumePixelBuffer::mMaxPixelSamples),
@@ -1254,8 +1328,7 @@ DeepBuffer::sortSegmentByZ(const DeepBuffer::HardSurfaceSegment *lhs,
 
 void
 DeepBuffer::writeHardSurfaceSegmentsNoMask(int idx,
-                                           int filmX, int filmY,
-                                           const scene_rdl2::fb_util::PixelBuffer<unsigned>& samplesCount,
+                                           unsigned pixelSamples,
                                            const OPENDCX_INTERNAL_NAMESPACE::ChannelSet& chanSet,
                                            const std::vector<std::pair<unsigned, unsigned> >& channelsToOutput,
                                            const std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx>& deepIDChannels,
@@ -1320,7 +1393,7 @@ DeepBuffer::writeHardSurfaceSegmentsNoMask(int idx,
 
             // Get the number of samples for this pixel.  This varies
             // when using adaptive sampling.
-            int samplesPerPixel = samplesCount.getPixel(filmX, filmY);
+            int samplesPerPixel = pixelSamples;
             // Deeper layers have fewer samples
             int samplesDivision = 1 << (layer * 2);  // 1, 4, 16, 64 ...
             samplesPerPixel /= samplesDivision;
@@ -1385,17 +1458,18 @@ DeepBuffer::writeHardSurfaceSegmentsNoMask(int idx,
     }
 }
 
-void
-DeepBuffer::write(const std::string& filename,
-                  const std::vector<int>& aovs,
-                  const std::vector<std::string>& aovChannelNames,
-                  const scene_rdl2::fb_util::PixelBuffer<unsigned>& samplesCount,
-                  const scene_rdl2::math::HalfOpenViewport& aperture, const scene_rdl2::math::HalfOpenViewport& region,
-                  const scene_rdl2::rdl2::Metadata *metadata) const
+std::unique_ptr<DeepBuffer::OutputFile>
+DeepBuffer::openOutputFile(const std::string& filename,
+                           const std::vector<int>& aovs,
+                           const std::vector<std::string>& aovChannelNames,
+                           const scene_rdl2::math::HalfOpenViewport& aperture,
+                           const scene_rdl2::math::HalfOpenViewport& region,
+                           const scene_rdl2::rdl2::Metadata *metadata) const
 {
-    // Create an OpenDCX deep file and copy all of the HardSurfaceSegments to it
+    // Create an OpenDCX deep file the HardSurfaceSegments can be copied to
 
-    OPENDCX_INTERNAL_NAMESPACE::ChannelSet chanSet;
+    std::unique_ptr<OutputFile> file(new OutputFile);
+    OPENDCX_INTERNAL_NAMESPACE::ChannelSet& chanSet = file->mChanSet;
     chanSet.insert(OPENDCX_INTERNAL_NAMESPACE::Chan_ZFront);
     chanSet.insert(OPENDCX_INTERNAL_NAMESPACE::Chan_ZBack);
     if (mFormat == DeepFormat::OpenDCX2_0) {
@@ -1407,10 +1481,10 @@ DeepBuffer::write(const std::string& filename,
     }
     chanSet.insert(OPENDCX_INTERNAL_NAMESPACE::Chan_A);
 
-    OPENDCX_INTERNAL_NAMESPACE::ChannelContext chanCtx;
+    OPENDCX_INTERNAL_NAMESPACE::ChannelContext& chanCtx = file->mChanCtx;
 
     // Add in all of the deep ID channels
-    std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx> deepIDChannels;
+    std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx>& deepIDChannels = file->mDeepIDChannels;
     for (size_t i = 0; i < mDeepIDChannels.size(); i++) {
         chanCtx.addChannelAlias (mDeepIDChannels[i],  // channel name
                                  "deep",              // layer name
@@ -1426,8 +1500,8 @@ DeepBuffer::write(const std::string& filename,
     // We have multiple ranges of deep channels to output depending on whether the
     // beauty and which AOVs are selected for output.  Note that these are the
     // channels in the deep data, not the AOV channel ids.
-    std::vector<std::pair<unsigned, unsigned> > channelsToOutput;
-    std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx> channelIdxs;
+    std::vector<std::pair<unsigned, unsigned> >& channelsToOutput = file->mChannelsToOutput;
+    std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx>& channelIdxs = file->mChannelIdxs;
 
     {
         int channelNameIdx = 0;
@@ -1463,70 +1537,199 @@ DeepBuffer::write(const std::string& filename,
     IMATH_NAMESPACE::Box2i dataWindow(IMATH_NAMESPACE::V2i(region.min().x, region.min().y),
                                       IMATH_NAMESPACE::V2i(region.max().x - 1, region.max().y - 1));
 
-    OPENDCX_INTERNAL_NAMESPACE::DeepImageOutputTile *outputTile = new OPENDCX_INTERNAL_NAMESPACE::DeepImageOutputTile(displayWindow,
-                                               dataWindow,
-                                               true,
-                                               chanSet,
-                                               chanCtx);
+    file->mOutputTile.reset(new OPENDCX_INTERNAL_NAMESPACE::DeepImageOutputTile(displayWindow,
+                                                                                dataWindow,
+                                                                                true,
+                                                                                chanSet,
+                                                                                chanCtx));
     Imf::Header header;
     if (metadata) {
         fillHeaderMetadata(metadata, header);
     }
-    outputTile->setOutputFile(filename.c_str(), header);
+    file->mOutputTile->setOutputFile(filename.c_str(), header);
 
     if (mFormat == DeepFormat::OpenEXR2_0) {
         std::cout << "Writing hard deep surfaces without masks." << std::endl;
     }
 
-    // Iterate over the pixels/HardSurfaceSegments and copy their data to the OpenDCX
-    //  file.
+    return file;
+}
+
+void
+DeepBuffer::writeScanline(OutputFile& file, int filmY, const SamplesCountFunc& samplesCount) const
+{
+    // Iterate over the pixels/HardSurfaceSegments of the row and copy their data to
+    //  the OpenDCX file.
     // Note that the film coordinates (filmX, filmY) are not necessarily the same as the
     //  image coordinates (outX, outY) in that the image coordinates sometimes have an
     //  offset applied.
-    int idx = 0;
-    for (int outY = outputTile->minY(), filmY = 0; outY <= outputTile->maxY(); outY++, filmY++) {
-        for (int outX = outputTile->minX(), filmX = 0; outX <= outputTile->maxX(); outX++, filmX++, idx++) {
-
-            // if mHardSurfaceSegments[0] doesn't have segments then we can assume
-            // there are no deeper layers
-            if (!mHardSurfaceSegments[0][idx] && !mVolumeOutputSegments[idx]) {
-                outputTile->clearDeepPixel(outX, outY);
-                continue;
+    OPENDCX_INTERNAL_NAMESPACE::DeepImageOutputTile *outputTile = file.mOutputTile.get();
+    const int outY = outputTile->minY() + filmY;
+    int idx = filmY * mWidth;
+    for (int outX = outputTile->minX(), filmX = 0; outX <= outputTile->maxX(); outX++, filmX++, idx++) {
+
+        // if mHardSurfaceSegments[0] doesn't have segments then we can assume
+        // there are no deeper layers
+        if (!mHardSurfaceSegments[0][idx] && !mVolumeOutputSegments[idx]) {
+            outputTile->clearDeepPixel(outX, outY);
+            continue;
+        }
+
+        OPENDCX_INTERNAL_NAMESPACE::DeepPixel dcxpixel(file.mChanSet);
+
+        writeVolumeSegments(mVolumeOutputSegments[idx],
+                            file.mChanSet,
+                            file.mChannelsToOutput,
+                            file.mDeepIDChannels,
+                            file.mChannelIdxs,
+                            dcxpixel);
+
+        if (mFormat == DeepFormat::OpenDCX2_0) {
+            writeHardSurfaceSegments(idx,
+                                     file.mChanSet,
+                                     file.mChannelsToOutput,
+                                     file.mDeepIDChannels,
+                                     file.mChannelIdxs,
+                                     dcxpixel);
+        } else {
+            writeHardSurfaceSegmentsNoMask(idx,
+                                           samplesCount(filmX, filmY),
+                                           file.mChanSet,
+                                           file.mChannelsToOutput,
+                                           file.mDeepIDChannels,
+                                           file.mChannelIdxs,
+                                           dcxpixel);
+        }
+
+        outputTile->setDeepPixel(outX, outY, dcxpixel);
+    }
+    outputTile->writeScanline(outY, true);
+}
+
+void
+DeepBuffer::write(const std::string& filename,
+                  const std::vector<int>& aovs,
+                  const std::vector<std::string>& aovChannelNames,
+                  const scene_rdl2::fb_util::PixelBuffer<unsigned>& samplesCount,
+                  const scene_rdl2::math::HalfOpenViewport& aperture, const scene_rdl2::math::HalfOpenViewport& region,
+                  const scene_rdl2::rdl2::Metadata *metadata) const
+{
+    std::unique_ptr<OutputFile> file = openOutputFile(filename, aovs, aovChannelNames, aperture, region, metadata);
+
+    const SamplesCountFunc pixelSamples = [&](unsigned x, unsigned y) {
+        return samplesCount.getPixel(x, y);
+    };
+    const int numRows = file->mOutputTile->maxY() - file->mOutputTile->minY() + 1;
+    for (int filmY = 0; filmY < numRows; filmY++) {
+        writeScanline(*file, filmY, pixelSamples);
+    }
+}
+
+void
+DeepBuffer::startStreaming(const SamplesCountFunc& samplesCount)
+{
+    clear();
+
+    // the render tiles are 8x8
+    mNumTileColumns = (mWidth + 7) / 8;
+    mNumTileRows = (mHeight + 7) / 8;
+    mRowTilesFinished.reset(new std::atomic<unsigned>[mNumTileRows]);
+    for (unsigned i = 0; i < mNumTileRows; i++) {
+        mRowTilesFinished[i] = 0;
+    }
+    mNextStreamRow = 0;
+    mStreamSamplesCount = samplesCount;
+    mStreaming = true;
+}
+
+void
+DeepBuffer::addStreamingOutput(const std::string& filename,
+                               const std::vector<int>& aovs,
+                               const std::vector<std::string>& aovChannelNames,
+                               const scene_rdl2::math::HalfOpenViewport& aperture,
+                               const scene_rdl2::math::HalfOpenViewport& region,
+                               const scene_rdl2::rdl2::Metadata *metadata)
+{
+    MNRY_ASSERT(mStreaming && mNextStreamRow == 0);
+    mStreamOutputs.push_back(openOutputFile(filename, aovs, aovChannelNames, aperture, region, metadata));
+    mStreamedFilenames.push_back(filename);
+}
+
+void
+DeepBuffer::finishTile(unsigned minY)
+{
+    const unsigned row = minY / 8;
+    MNRY_ASSERT(row < mNumTileRows);
+    if (mRowTilesFinished[row].fetch_add(1) + 1 < mNumTileColumns) {
+        return;
+    }
+
+    tbb::mutex::scoped_lock lock(mStreamMutex);
+    writeFinishedRows(false);
+}
+
+void
+DeepBuffer::writeFinishedRows(bool all)
+{
+    while (mNextStreamRow < mNumTileRows &&
+           (all || mRowTilesFinished[mNextStreamRow] >= mNumTileColumns)) {
+        const unsigned yBegin = mNextStreamRow * 8;
+        const unsigned yEnd = std::min(yBegin + 8, mHeight);
+        for (const auto &file : mStreamOutputs) {
+            for (unsigned y = yBegin; y < yEnd; y++) {
+                writeScanline(*file, y, mStreamSamplesCount);
             }
+        }
+        freeSegments(yBegin, yEnd);
+        mNextStreamRow++;
+    }
+}
 
-            OPENDCX_INTERNAL_NAMESPACE::DeepPixel dcxpixel(chanSet);
-
-            writeVolumeSegments(mVolumeOutputSegments[idx],
-                                chanSet,
-                                channelsToOutput,
-                                deepIDChannels,
-                                channelIdxs,
-                                dcxpixel);
-
-            if (mFormat == DeepFormat::OpenDCX2_0) {
-                writeHardSurfaceSegments(idx,
-                                         chanSet,
-                                         channelsToOutput,
-                                         deepIDChannels,
-                                         channelIdxs,
-                                         dcxpixel);
-            } else {
-                writeHardSurfaceSegmentsNoMask(idx,
-                                               filmX, filmY,
-                                               samplesCount,
-                                               chanSet,
-                                               channelsToOutput,
-                                               deepIDChannels,
-                                               channelIdxs,
-                                               dcxpixel);
+void
+DeepBuffer::finishStreaming()
+{
+    if (!mStreaming) {
+        return;
+    }
+
+    {
+        tbb::mutex::scoped_lock lock(mStreamMutex);
+        writeFinishedRows(true);
+    }
+    mStreamOutputs.clear();  // closes the files
+    mStreaming = false;
+}
+
+bool
+DeepBuffer::isStreamed(const std::string& filename) const
+{
+    return std::find(mStreamedFilenames.begin(), mStreamedFilenames.end(), filename) != mStreamedFilenames.end();
+}
+
+void
+DeepBuffer::freeSegments(unsigned yBegin, unsigned yEnd)
+{
+    // Only heap allocated segments, see allocHardSurfaceSegment()
+    MNRY_ASSERT(mStreaming);
+    for (size_t i = yBegin * mWidth; i < yEnd * mWidth; i++) {
+        for (size_t layer = 0; layer < mMaxLayers; layer++) {
+            HardSurfaceSegment *current = mHardSurfaceSegments[layer][i];
+            while (current) {
+                HardSurfaceSegment *next = current->mNext;
+                free(current);
+                current = next;
             }
+            mHardSurfaceSegments[layer][i] = nullptr;
+        }
 
-            outputTile->setDeepPixel(outX, outY, dcxpixel);
+        VolumeOutputSegment *current = mVolumeOutputSegments[i];
+        while (current) {
+            VolumeOutputSegment *next = current->mNext;
+            free(current);
+            current = next;
         }
-        outputTile->writeScanline(outY, true);
+        mVolumeOutputSegments[i] = nullptr;
     }
-
-    delete outputTile;
 }
 
 size_t
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <moonray/rendering/pbr/core/Aov.h>
+#include <moonray/rendering/pbr/core/BlockArena.h>
 
 #include <scene_rdl2/common/fb_util/PixelBuffer.h>
 #include <scene_rdl2/common/math/Color.h>
@@ -15,6 +16,11 @@
 #include <OpenEXR/ImfHeader.h>
 #include <tbb/mutex.h>
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace moonray {
 
 namespace pbr {
@@ -104,6 +110,11 @@ public:
 
     void finishPixel(unsigned threadIdx);
 
+    // Merges the samples which the render threads queued in vector mode into the
+    // deep pixels.  Must be called once all the render threads have stopped adding
+    // samples, before the deep buffer is read.
+    void flushSamples();
+
     // Write the deep buffer to a deep file using OpenDCX
     void write(const std::string& filename,
                const std::vector<int>& aovs,       // aov channels
@@ -112,6 +123,37 @@ public:
                const scene_rdl2::math::HalfOpenViewport& aperture, const scene_rdl2::math::HalfOpenViewport& region,
                const scene_rdl2::rdl2::Metadata *metadata) const;
 
+    // Streaming output, batch mode only.  Instead of keeping the whole image until
+    //  write(), each row of tiles is written to the deep files as soon as all of its
+    //  tiles are finished, and its segments are freed.  The deep files are written
+    //  scanline by scanline in increasing y order, so a finished row of tiles also
+    //  waits for the rows before it.
+    typedef std::function<unsigned (unsigned x, unsigned y)> SamplesCountFunc;
+
+    // Clears the buffer and starts streaming.  samplesCount returns the number of
+    //  samples of a finished pixel, see write().
+    void startStreaming(const SamplesCountFunc& samplesCount);
+
+    // Opens a deep file to stream to, same parameters as write()
+    void addStreamingOutput(const std::string& filename,
+                            const std::vector<int>& aovs,
+                            const std::vector<std::string>& aovChannelNames,
+                            const scene_rdl2::math::HalfOpenViewport& aperture,
+                            const scene_rdl2::math::HalfOpenViewport& region,
+                            const scene_rdl2::rdl2::Metadata *metadata);
+
+    // Called when the 8x8 tile starting at row minY received all of its samples.
+    //  Thread safe, the thread finishing a row of tiles writes it out.
+    void finishTile(unsigned minY);
+
+    // Writes the rows which are left, finished or not, and closes the deep files.
+    void finishStreaming();
+
+    bool isStreaming() const { return mStreaming; }
+
+    // True if the file was already written by streaming this frame
+    bool isStreamed(const std::string& filename) const;
+
     size_t getMemoryUsage() const;
 
     DeepFormat getFormat() const { return mFormat; }
@@ -121,8 +163,21 @@ private:
     //  simulate a 1x1, 2x2, or 4x4 subpixel resolution.  This is the method that
     //  actually adds the (un)duplicated deep samples to the buffer.
 
-    // Lock free version, suitable for use in scalar mode.
-    void addSample8x8(unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
+    // Adds the sample to every subpixel of the subpixelSize x subpixelSize block
+    //  starting at (subpixelX, subpixelY).  No internal locking, the caller must
+    //  own the pixel.  New segments are allocated from the arena.
+    void addSampleBlock(BlockArena &arena,
+                        unsigned x, unsigned y,
+                        unsigned subpixelX, unsigned subpixelY, unsigned subpixelSize,
+                        int layer,
+                        const float *ids, float t, float rayZ,
+                        const scene_rdl2::math::Vec3f& normal, float alpha,
+                        const int *channels, int numChannels,
+                        const float *values,
+                        float scale, float weight);
+
+    void addSample8x8(BlockArena &arena,
+                      unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
                       int layer,
                       const float *ids, float t, float rayZ,
                       const scene_rdl2::math::Vec3f& normal, float alpha,
@@ -130,14 +185,20 @@ private:
                       const float *values,
                       float scale, float weight);
 
-    // Thread safe version suitable for use in vector mode.
-    void addSample8x8Safe(unsigned x, unsigned y, unsigned subpixelX, unsigned subpixelY,
-                          int layer,
-                          const float *ids, float t, float rayZ,
-                          const scene_rdl2::math::Vec3f& normal, float alpha,
-                          const int *channels, int numChannels,
-                          const float *values,
-                          float scale, float weight);
+    // Vector mode version, queues the sample in the thread's SampleQueue.
+    void queueSample(unsigned threadIdx,
+                     unsigned x, unsigned y,
+                     unsigned subpixelX, unsigned subpixelY, unsigned subpixelSize,
+                     int layer,
+                     const float *ids, float t, float rayZ,
+                     const scene_rdl2::math::Vec3f& normal, float alpha,
+                     const int *channels, int numChannels,
+                     const float *values,
+                     float scale, float weight);
+
+    // Merges the queued samples of one thread into the deep pixels.  Only called
+    //  by the owning thread while rendering.
+    void flushSampleQueue(unsigned threadIdx);
 
     /* Each pixel has a linked list of HardSurfaceSegments.  Pixels may be empty and
      * have no HardSurfaceSegments assigned, in which case mHardSurfaceSegments will
@@ -166,6 +227,58 @@ private:
     // One vector<HardSurfaceSegment *> per depth layer, up to mMaxLayers
     std::vector< std::vector<HardSurfaceSegment *> > mHardSurfaceSegments;
 
+    // The HardSurfaceSegments are carved out of per thread arenas, see BlockArena.
+    //  While streaming they are allocated on the heap instead so that every written
+    //  row of tiles can free its segments.
+    std::vector<BlockArena> mSegmentArenas;  // one per thread
+
+    void *allocHardSurfaceSegment(BlockArena &arena) {
+        return mStreaming ? malloc(getHardSurfaceSegmentSize()) : arena.alloc(getHardSurfaceSegmentSize());
+    }
+
+    /* In vector mode several threads add samples to the same pixel, so instead
+     * of locking the pixel for every sample each thread queues its samples in a
+     * SampleQueue.  A full queue is sorted by pixel and merged into the deep pixels,
+     * locking each pixel once for all of its queued samples.
+     * The channel values of a QueuedSample are dense (mNumChannels of them) and
+     * already scaled, so they are merged with a scale of 1.
+     */
+    struct QueuedSample
+    {
+        uint32_t mPixelIdx;         // y * mWidth + x
+        uint8_t mSubpixelX;         // first subpixel of the duplicated block
+        uint8_t mSubpixelY;
+        uint8_t mSubpixelSize;      // 1, 2, 4, or 8 subpixels wide block
+        uint8_t mLayer;
+        float mT;
+        float mRayZ;
+        scene_rdl2::math::Vec3f mNormal;
+        float mAlpha;               // scaled alpha
+        float mWeight;
+        float mIDsAndValues[0];     // deep IDs followed by the scaled channel values
+    };
+    static_assert(sizeof(QueuedSample) % sizeof(float) == 0, "QueuedSamples are stored in a float array");
+
+    struct CACHE_ALIGN SampleQueue
+    {
+        std::vector<float> mData;       // mSampleQueueCapacity QueuedSamples
+        std::vector<uint32_t> mOrder;   // scratch for sorting the samples by pixel
+        unsigned mNumSamples = 0;
+    };
+    static const unsigned mSampleQueueCapacity = 1024;
+    std::vector<SampleQueue> mSampleQueues;  // one per thread
+
+    // 0..mNumChannels-1, the channel list of the queued samples
+    std::vector<int> mAllChannels;
+
+    // QueuedSample size, in floats
+    size_t getQueuedSampleFloats() const {
+        return sizeof(QueuedSample) / sizeof(float) + mDeepIDChannels.size() + mNumChannels;
+    }
+    QueuedSample *getQueuedSample(SampleQueue &queue, unsigned i) const {
+        return reinterpret_cast<QueuedSample *>(&queue.mData[i * getQueuedSampleFloats()]);
+    }
+
     static bool sortSegmentByZ(const HardSurfaceSegment *lhs, const HardSurfaceSegment *rhs);
 
     size_t getHardSurfaceSegmentSize() const {
@@ -218,8 +331,7 @@ private:
                                   OPENDCX_INTERNAL_NAMESPACE::DeepPixel& dcxpixel) const;
 
     void writeHardSurfaceSegmentsNoMask(int idx,
-                                        int filmX, int filmY,
-                                        const scene_rdl2::fb_util::PixelBuffer<unsigned>& samplesCount,
+                                        unsigned pixelSamples,
                                         const OPENDCX_INTERNAL_NAMESPACE::ChannelSet& chanSet,
                                         const std::vector<std::pair<unsigned, unsigned> >& channelsToOutput,
                                         const std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx>& deepIDChannels,
@@ -406,7 +518,7 @@ private:
 /* Deep pixels are independent of each other, so there is no threading hazard
  * when different threads are writing to different pixels.  It is possible
  * (although uncommon) that multiple threads might write to the same pixel,
- * so that needs to be protected with a mutex.  The simple solution is to
+ * so that needs to be protected with a mutex while merging the SampleQueues.  The simple solution is to
  * have one mutex per pixel.  This would consume a lot of memory, so instead
  * there is an array of 225 mutexes for the entire image that are shared
  * between the pixels.  Some pixels will share the same mutex, which results
@@ -466,6 +578,43 @@ private:
     DeepFormat mFormat;
 
     int mMaxLayers;
+
+    // An open deep file and the mapping of the deep buffer channels to its channels
+    struct OutputFile
+    {
+        OPENDCX_INTERNAL_NAMESPACE::ChannelSet mChanSet;
+        OPENDCX_INTERNAL_NAMESPACE::ChannelContext mChanCtx;    // referenced by mOutputTile
+        std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx> mDeepIDChannels;
+        std::vector<std::pair<unsigned, unsigned> > mChannelsToOutput;
+        std::vector<OPENDCX_INTERNAL_NAMESPACE::ChannelIdx> mChannelIdxs;
+        std::unique_ptr<OPENDCX_INTERNAL_NAMESPACE::DeepImageOutputTile> mOutputTile;
+    };
+
+    std::unique_ptr<OutputFile> openOutputFile(const std::string& filename,
+                                               const std::vector<int>& aovs,
+                                               const std::vector<std::string>& aovChannelNames,
+                                               const scene_rdl2::math::HalfOpenViewport& aperture,
+                                               const scene_rdl2::math::HalfOpenViewport& region,
+                                               const scene_rdl2::rdl2::Metadata *metadata) const;
+
+    // Writes film row filmY to the file, scanlines must be written in increasing order
+    void writeScanline(OutputFile& file, int filmY, const SamplesCountFunc& samplesCount) const;
+
+    // Writes the rows of tiles from mNextStreamRow on as long as they are finished, or
+    //  all of them if all is true.  The caller holds mStreamMutex.
+    void writeFinishedRows(bool all);
+
+    void freeSegments(unsigned yBegin, unsigned yEnd);
+
+    bool mStreaming = false;
+    SamplesCountFunc mStreamSamplesCount;
+    std::vector<std::unique_ptr<OutputFile>> mStreamOutputs;
+    std::vector<std::string> mStreamedFilenames;
+    unsigned mNumTileColumns = 0;
+    unsigned mNumTileRows = 0;
+    std::unique_ptr<std::atomic<unsigned>[]> mRowTilesFinished;   // per row of tiles
+    unsigned mNextStreamRow = 0;                                // first row not written yet
+    tbb::mutex mStreamMutex;
 };
 
 }
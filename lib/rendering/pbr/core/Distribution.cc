@@ -24,6 +24,7 @@
 #include <tbb/parallel_for.h>
 
 #include <cstring>
+#include <new>
 
 // TODO: rethink the idea of recovering pdf values by diffing cdf values. Jeff Mahovsky points out that it has the
 // potential for highly imprecise pdf values due to catastrophic cancellation.
@@ -39,6 +40,14 @@ using scene_rdl2::logging::Logger;
 
 static const int sRangeDivider = 80;
 
+// Grain size splitting count rows into about sRangeDivider tbb tasks. Never 0,
+// which tbb doesn't accept for distributions smaller than sRangeDivider.
+finline Distribution2D::size_type
+getGrainSize(Distribution2D::size_type count)
+{
+    return scene_rdl2::math::max(count / sRangeDivider, Distribution2D::size_type(1));
+}
+
 
 finline void
 intAndFrac(float x, int *xInt, float *xFrac)
@@ -467,13 +476,31 @@ HUD_VALIDATOR(Distribution2D);
 Distribution2D::Distribution2D(size_type sizeU, size_type sizeV) :
     mSizeV(sizeV),
     mConditional(NULL),
-    mMarginal(NULL)
+    mMarginal(NULL),
+    mConditionalStorage(NULL),
+    mCdfStorage(NULL),
+    mGuideStorage(NULL)
 {
-    // Allocate 1D distributions
+    // Allocate 1D distributions. The conditionals and their tables are carved
+    // out of 3 blocks rather than allocated row by row, which keeps the
+    // allocation cost of large images independent of their height and the
+    // tables of neighbouring rows, which bilinear sampling reads together,
+    // next to each other.
+    const size_t numTexels = size_t(sizeU) * sizeV;
     mConditional = scene_rdl2::util::alignedMallocArray<Distribution1D*>(mSizeV);
-    for (size_type i = 0; i < mSizeV; ++i) {
-        mConditional[i] = scene_rdl2::util::alignedMallocCtorArgs<Distribution1D>(DEFAULT_MEMORY_ALIGNMENT, sizeU);
-    }
+    mConditionalStorage = reinterpret_cast<Distribution1D *>
+                              (scene_rdl2::util::alignedMalloc(sizeof(Distribution1D) * mSizeV,
+                                                               DEFAULT_MEMORY_ALIGNMENT));
+    mCdfStorage = scene_rdl2::util::alignedMallocArray<float>(numTexels);
+    mGuideStorage = scene_rdl2::util::alignedMallocArray<size_type>(numTexels);
+    tbb::parallel_for(tbb::blocked_range<size_type>(0, mSizeV, getGrainSize(mSizeV)),
+                      [&](const tbb::blocked_range<size_type> range) {
+        for (size_type i = range.begin(); i < range.end(); ++i) {
+            const size_t offset = size_t(i) * sizeU;
+            mConditional[i] = new (&mConditionalStorage[i])
+                Distribution1D(sizeU, mCdfStorage + offset, mGuideStorage + offset);
+        }
+    });
     mMarginal = scene_rdl2::util::alignedMallocCtorArgs<Distribution1D>(DEFAULT_MEMORY_ALIGNMENT, sizeV);
 }
 
@@ -481,8 +508,14 @@ Distribution2D::Distribution2D(size_type sizeU, size_type sizeV) :
 Distribution2D::~Distribution2D()
 {
     for (size_type i = 0; i < mSizeV; ++i) {
-        scene_rdl2::util::alignedFreeDtor<Distribution1D>(mConditional[i]);
+        mConditionalStorage[i].~Distribution1D();
     }
+    scene_rdl2::util::alignedFree(mConditionalStorage);
+    mConditionalStorage = nullptr;
+    scene_rdl2::util::alignedFreeArray<float>(mCdfStorage);
+    mCdfStorage = nullptr;
+    scene_rdl2::util::alignedFreeArray<size_type>(mGuideStorage);
+    mGuideStorage = nullptr;
     scene_rdl2::util::alignedFreeArray<Distribution1D*> (mConditional);
     mConditional = nullptr;
     scene_rdl2::util::alignedFreeDtor<Distribution1D> (mMarginal);
@@ -505,7 +538,7 @@ Distribution2D::tabulateCdf(Mapping mapping)
         //       the top and bottom scanlines
         float sclV, ofsV;
         getScaleOffset(-0.5f, float(sizeV) - 0.5f, 0.0f, sPi, &sclV, &ofsV);
-        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, sizeV / sRangeDivider),
+        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, getGrainSize(sizeV)),
                           [&](const tbb::blocked_range<size_type> range) {
             for (size_type y = range.begin(); y < range.end(); ++y) {
                 // The sinTheta term accounts for the distortion of the image mapping
@@ -528,7 +561,7 @@ Distribution2D::tabulateCdf(Mapping mapping)
         getScaleOffset(-0.5f, float(sizeV) - 0.5f, 0.0f, sPi, &sclV, &ofsV);
         unsigned halfSizeV = sizeV / 2;
 
-        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, sizeV / sRangeDivider),
+        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, getGrainSize(sizeV)),
                           [&](const tbb::blocked_range<size_type> range) {
             for (size_type y = range.begin(); y < range.end(); ++y) {
                 // The sinTheta term accounts for the distortion of the image mapping
@@ -558,7 +591,7 @@ Distribution2D::tabulateCdf(Mapping mapping)
         getScaleOffset(-0.5f, float(sizeU) - 0.5f, -1.0f, 1.0f, &sclU, &ofsU);
         getScaleOffset(-0.5f, float(sizeV) - 0.5f, -1.0f, 1.0f, &sclV, &ofsV);
 
-        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, sizeV / sRangeDivider),
+        tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, getGrainSize(sizeV)),
                           [&](const tbb::blocked_range<size_type> range) {
             for (size_type y = range.begin(); y < range.end(); ++y) {
                 float t = float(y) * sclV + ofsV;
@@ -579,7 +612,7 @@ Distribution2D::tabulateCdf(Mapping mapping)
     }
 
     // Now compute CDF.
-    tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, sizeV / sRangeDivider),
+    tbb::parallel_for(tbb::blocked_range<size_type>(0, sizeV, getGrainSize(sizeV)),
                       [&](const tbb::blocked_range<size_type> range) {
         for (size_type y = range.begin(); y < range.end(); ++y) {
             float integral = mConditional[y]->tabulateCdf();
@@ -1005,8 +1038,10 @@ ImageDistribution::init(const std::string &mapFilename,
 
     bool doColorCorrect = gammaOn || saturationOn || contrastOn || gainOffsetOn || temperatureControlOn;
 
-    // Loop over mipmap levels
-    for (int mipLevel = 0; mipLevel < mNumMipLevels; ++mipLevel) {
+    // Loop over mipmap levels. The levels don't share any data, so the small
+    // ones, whose row loops below are too short to keep all threads busy,
+    // are built alongside the larger ones.
+    tbb::parallel_for(0, int(mNumMipLevels), [&](const int mipLevel) {
 
         // Dimensions of mip level
         int mipWidth  = mWidth  >> mipLevel;
@@ -1048,7 +1083,7 @@ ImageDistribution::init(const std::string &mapFilename,
             float vOffset = 0.5f * (vCount - 1.0f);                         //   texel center
 
             // Sample the texture at the determined rate, (uCount x vCount) samples per texel
-            tbb::parallel_for(tbb::blocked_range<size_type>(0, mipHeight, mipHeight / sRangeDivider),
+            tbb::parallel_for(tbb::blocked_range<size_type>(0, mipHeight, getGrainSize(mipHeight)),
                               [&](const tbb::blocked_range<size_type> range) {
                 for (size_type y = range.begin(); y < range.end(); ++y) {
                     float v = (static_cast<float>(y) + 0.5f) / mipHeight;
@@ -1076,7 +1111,7 @@ ImageDistribution::init(const std::string &mapFilename,
             });
         } else {
             // Non-transformed case is simpler (1 sample per texel)
-            tbb::parallel_for(tbb::blocked_range<size_type>(0, mipHeight, mipHeight / sRangeDivider),
+            tbb::parallel_for(tbb::blocked_range<size_type>(0, mipHeight, getGrainSize(mipHeight)),
                               [&](const tbb::blocked_range<size_type> range) {
                 for (size_type y = range.begin(); y < range.end(); ++y) {
                     float v = (static_cast<float>(y) + 0.5f) / mipHeight;
@@ -1093,7 +1128,7 @@ ImageDistribution::init(const std::string &mapFilename,
 
         // Get ready to sample
         mDistribution[mipLevel]->tabulateCdf(mapping);
-    }
+    });
 }
 
 
@@ -1110,6 +1145,19 @@ ImageDistribution::~ImageDistribution()
 }
 
 
+size_t
+ImageDistribution::getMemory() const
+{
+    size_t memory = 0;
+    for (int mipLevel = 0; mipLevel < mNumMipLevels; ++mipLevel) {
+        const size_t numPixels = size_t(mWidth >> mipLevel) * size_t(mHeight >> mipLevel);
+        // rgb pixels, plus the cdf and the guide table of each conditional
+        memory += numPixels * (3 * sizeof(float) + sizeof(float) + sizeof(uint32_t));
+    }
+    return memory;
+}
+
+
 //----------------------------------------------------------------------------
 
 // Lookup pixel by a pair of indices and a mip level.
@@ -371,6 +371,10 @@ public:
     int getWidth()  const { return mWidth;  }
     int getHeight() const { return mHeight; }
 
+    /// Approximate memory held by the pixels and the distributions of all
+    /// the mip levels, in bytes.
+    size_t getMemory() const;
+
     /// Return the pdf of sampling the given (u, v) value
     /// Note: the mapping only affects the weight of the distribution
     /// It's up to the caller to transform the returned pdf wrt. the proper
@@ -57,13 +57,19 @@
 #define DISTRIBUTION_2D_MEMBERS                                 \
     HUD_MEMBER(uint32_t, mSizeV);                               \
     HUD_PTR(GuideDistribution1D * HUD_UNIFORM *, mConditional); \
-    HUD_PTR(GuideDistribution1D *, mMarginal)
+    HUD_PTR(GuideDistribution1D *, mMarginal);                  \
+    HUD_PTR(GuideDistribution1D *, mConditionalStorage);        \
+    HUD_PTR(float *, mCdfStorage);                              \
+    HUD_PTR(uint32_t *, mGuideStorage)
 
 #define DISTRIBUTION_2D_VALIDATION              \
     HUD_BEGIN_VALIDATION(Distribution2D);       \
     HUD_VALIDATE(Distribution2D, mSizeV);       \
     HUD_VALIDATE(Distribution2D, mConditional); \
     HUD_VALIDATE(Distribution2D, mMarginal);    \
+    HUD_VALIDATE(Distribution2D, mConditionalStorage); \
+    HUD_VALIDATE(Distribution2D, mCdfStorage);  \
+    HUD_VALIDATE(Distribution2D, mGuideStorage);\
     HUD_END_VALIDATION
 
 
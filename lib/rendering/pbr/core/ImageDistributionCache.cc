@@ -0,0 +1,185 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file ImageDistributionCache.cc
+///
+
+#include "ImageDistributionCache.h"
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <sys/stat.h>
+
+using namespace scene_rdl2::math;
+
+namespace moonray {
+namespace pbr {
+
+namespace {
+
+template <typename T>
+void
+appendBytes(std::string &key, const T &value)
+{
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+} // namespace
+
+ImageDistributionCache &
+ImageDistributionCache::get()
+{
+    static ImageDistributionCache sCache;
+    return sCache;
+}
+
+ImageDistribution *
+ImageDistributionCache::acquire(const std::string &mapFilename,
+                                const Distribution2D::Mapping mapping,
+                                const Color& gamma,
+                                const Color& contrast,
+                                const Color& saturation,
+                                const Color& gain,
+                                const Color& offset,
+                                const Vec3f& temperature,
+                                const float  rotationAngle,
+                                const Vec2f& translation,
+                                const Vec2f& coverage,
+                                const float  repsU,
+                                const float  repsV,
+                                const bool   mirrorU,
+                                const bool   mirrorV,
+                                const Color& borderColor)
+{
+    // The file size and modification time stand in for the image content.
+    // Files which can't be stat'ed are left to the constructor to report.
+    std::string key = mapFilename;
+    key.push_back('\0');
+    struct stat fileStat;
+    if (stat(mapFilename.c_str(), &fileStat) == 0) {
+        appendBytes(key, fileStat.st_size);
+        appendBytes(key, fileStat.st_mtim.tv_sec);
+        appendBytes(key, fileStat.st_mtim.tv_nsec);
+    }
+    appendBytes(key, mapping);
+    appendBytes(key, gamma);
+    appendBytes(key, contrast);
+    appendBytes(key, saturation);
+    appendBytes(key, gain);
+    appendBytes(key, offset);
+    appendBytes(key, temperature);
+    appendBytes(key, rotationAngle);
+    appendBytes(key, translation);
+    appendBytes(key, coverage);
+    appendBytes(key, repsU);
+    appendBytes(key, repsV);
+    appendBytes(key, mirrorU);
+    appendBytes(key, mirrorV);
+    appendBytes(key, borderColor);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it != mEntries.end()) {
+            Entry &entry = it->second;
+            if (entry.mRefCount++ == 0) {
+                mUnused.erase(entry.mUnusedIt);
+                mUnusedMemory -= entry.mMemory;
+            }
+            return entry.mDistribution.get();
+        }
+    }
+
+    std::unique_ptr<ImageDistribution> distribution(new ImageDistribution(mapFilename, mapping,
+        gamma, contrast, saturation, gain, offset, temperature, rotationAngle, translation, coverage,
+        repsU, repsV, mirrorU, mirrorV, borderColor));
+    if (!distribution->isValid()) {
+        return distribution.release();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto inserted = mEntries.emplace(key, Entry());
+    Entry &entry = inserted.first->second;
+    if (inserted.second) {
+        entry.mMemory = distribution->getMemory();
+        entry.mDistribution = std::move(distribution);
+        mKeys.emplace(entry.mDistribution.get(), key);
+    } else if (entry.mRefCount == 0) {
+        // Another thread built the same distribution meanwhile, ours is
+        // dropped on the way out.
+        mUnused.erase(entry.mUnusedIt);
+        mUnusedMemory -= entry.mMemory;
+    }
+    ++entry.mRefCount;
+    return entry.mDistribution.get();
+}
+
+void
+ImageDistributionCache::release(const ImageDistribution *distribution)
+{
+    if (distribution == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto keyIt = mKeys.find(distribution);
+    if (keyIt == mKeys.end()) {
+        // not shared, see acquire()
+        delete distribution;
+        return;
+    }
+
+    Entry &entry = mEntries.find(keyIt->second)->second;
+    MNRY_ASSERT(entry.mRefCount > 0);
+    if (--entry.mRefCount == 0) {
+        entry.mUnusedIt = mUnused.insert(mUnused.end(), keyIt->second);
+        mUnusedMemory += entry.mMemory;
+        evict(mUnusedMemoryLimit);
+    }
+}
+
+void
+ImageDistributionCache::setUnusedMemoryLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mUnusedMemoryLimit = bytes;
+    evict(mUnusedMemoryLimit);
+}
+
+void
+ImageDistributionCache::trim()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    evict(0);
+}
+
+size_t
+ImageDistributionCache::getNumEntries() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+size_t
+ImageDistributionCache::getUnusedMemory() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUnusedMemory;
+}
+
+void
+ImageDistributionCache::evict(size_t limit)
+{
+    while (mUnusedMemory > limit || (limit == 0 && !mUnused.empty())) {
+        auto it = mEntries.find(mUnused.front());
+        mUnused.pop_front();
+        mUnusedMemory -= it->second.mMemory;
+        mKeys.erase(it->second.mDistribution.get());
+        mEntries.erase(it);
+    }
+}
+
+} // namespace pbr
+} // namespace moonray
+
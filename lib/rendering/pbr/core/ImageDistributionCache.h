@@ -0,0 +1,108 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file ImageDistributionCache.h
+///
+
+#pragma once
+
+#include "Distribution.h"
+
+#include <scene_rdl2/common/math/Color.h>
+#include <scene_rdl2/common/math/Vec2.h>
+#include <scene_rdl2/common/math/Vec3.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace moonray {
+namespace pbr {
+
+///
+/// @class ImageDistributionCache ImageDistributionCache.h <pbr/core/ImageDistributionCache.h>
+/// @brief Process-wide store of the ImageDistributions built for lights and
+/// light filters, so lights mapping the same image with the same settings share
+/// one distribution and re-renders don't load and tabulate it again.
+///
+/// Distributions are keyed by content: the image filename, its size and
+/// modification time on disk, the mapping and the color correction and texture
+/// transform settings. Editing the image file on disk therefore yields a new
+/// entry. Distributions nobody references any more are kept, least recently
+/// released first out, until their memory exceeds the unused memory limit. The
+/// limit defaults to 0, which frees a distribution with its last reference.
+///
+/// Thread-safe. Distributions are built outside of the lock, so lights loading
+/// different images don't wait on each other.
+///
+class ImageDistributionCache
+{
+public:
+    static ImageDistributionCache &get();
+
+    ImageDistributionCache(const ImageDistributionCache &) = delete;
+    ImageDistributionCache &operator=(const ImageDistributionCache &) = delete;
+
+    /// Returns a distribution built with the given arguments, see the
+    /// ImageDistribution constructor, and adds a reference to it. Exceptions of
+    /// the ImageDistribution constructor propagate, nothing is cached then.
+    /// Invalid distributions are returned but not shared.
+    ImageDistribution *acquire(const std::string &mapFilename,
+                               const Distribution2D::Mapping mapping,
+                               const scene_rdl2::math::Color& gamma,
+                               const scene_rdl2::math::Color& contrast,
+                               const scene_rdl2::math::Color& saturation,
+                               const scene_rdl2::math::Color& gain,
+                               const scene_rdl2::math::Color& offset,
+                               const scene_rdl2::math::Vec3f& temperature,
+                               const float  rotationAngle,
+                               const scene_rdl2::math::Vec2f& translation,
+                               const scene_rdl2::math::Vec2f& coverage,
+                               const float  repsU,
+                               const float  repsV,
+                               const bool   mirrorU,
+                               const bool   mirrorV,
+                               const scene_rdl2::math::Color& borderColor);
+
+    /// Drops a reference returned by acquire(). nullptr is ignored.
+    void release(const ImageDistribution *distribution);
+
+    /// Memory the unreferenced distributions may hold on to, in bytes.
+    void setUnusedMemoryLimit(size_t bytes);
+
+    /// Frees all the unreferenced distributions.
+    void trim();
+
+    size_t getNumEntries() const;
+    size_t getUnusedMemory() const;
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<ImageDistribution> mDistribution;
+        size_t mMemory = 0;
+        unsigned mRefCount = 0;
+        std::list<std::string>::iterator mUnusedIt;
+    };
+
+    ImageDistributionCache() = default;
+
+    // Requires mMutex to be held.
+    void evict(size_t limit);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, Entry> mEntries;
+    std::unordered_map<const ImageDistribution *, std::string> mKeys;
+    // Keys of the unreferenced entries, least recently released first.
+    std::list<std::string> mUnused;
+    size_t mUnusedMemory = 0;
+    size_t mUnusedMemoryLimit = 0;
+};
+
+} // namespace pbr
+} // namespace moonray
+
@@ -8,11 +8,14 @@
 #include "RayState.h"
 #include "XPUOcclusionRayQueue.h"
 #include "XPURayQueue.h"
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/pbr/handlers/RayHandlers.h>
 #include <moonray/rendering/shading/Types.h>
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <tbb/mutex.h>
 
+#include <sstream>
+
 // These aren't free so only turn it on if you are doing memory profiling.
 // This will print out the peak number of pool items used for a particular run.
 //#define DEBUG_RECORD_PEAK_RAYSTATE_USAGE
@@ -77,7 +80,10 @@ struct PoolInfo
         mActualPoolSize(0),
         mMemBlockManager(nullptr),
         mBlockMemory(nullptr),
-        mEntryMemory(nullptr)
+        mEntryMemory(nullptr),
+        mEntryMemorySize(0),
+        mEntryMemoryMapped(false),
+        mResidentBytes(0)
     {
     }
 
@@ -85,6 +91,9 @@ struct PoolInfo
     scene_rdl2::alloc::MemBlockManager *mMemBlockManager;
     scene_rdl2::alloc::MemBlock        *mBlockMemory;
     uint8_t                            *mEntryMemory;
+    size_t                             mEntryMemorySize;
+    bool                               mEntryMemoryMapped; // mapped by allocHugePageBacked()
+    size_t                             mResidentBytes;     // high water mark of the last frame, growable pools only
 };
 
 struct Private
@@ -108,13 +117,18 @@ tbb::mutex gInitMutex;
 void
 initPool(const unsigned poolSize, const unsigned numTBBThreads,
          const unsigned entrySize, const char * const poolName,
+         const mcrt_common::HugePageMode hugePageMode, const unsigned growthLimit,
          PoolInfo &p)
 {
     // Using poolSize * numTBBThreads isn't adequate for XPU mode because we
     // run out of space with low numbers of threads for things like BundledOcclRayData.
     // poolSize * 8 seems to be adequate, so for safety poolSize * 16 is used as the
     // minimum number of totalEntries.
-    const unsigned totalEntries    = poolSize * std::max(numTBBThreads, 16u);
+    // Growable pools reserve growthLimit times that, only the blocks which get
+    // used are ever backed by memory. Entries are addressed by 28 bit handles.
+    const uint64_t maxEntries      = 1ull << ALLOC_LIST_INFO_BIT_SHIFT;
+    const unsigned totalEntries    = unsigned(std::min(uint64_t(poolSize) * std::max(numTBBThreads, 16u) *
+                                                       std::max(growthLimit, 1u), maxEntries));
     const unsigned entryStride     = entrySize;
     const unsigned entriesPerBlock = scene_rdl2::alloc::MemBlock::getNumEntries();
 
@@ -126,6 +140,7 @@ initPool(const unsigned poolSize, const unsigned numTBBThreads,
     MNRY_ASSERT(numBlocks * entriesPerBlock >= totalEntries);
 
     numBlocks = std::max(numBlocks, numTBBThreads);
+    numBlocks = std::min(numBlocks, unsigned(maxEntries / entriesPerBlock));
 
     // Update the stored pool size so that the assertions in <typeName>ToIndex
     // and indexTo<typeName> remain valid
@@ -136,13 +151,42 @@ initPool(const unsigned poolSize, const unsigned numTBBThreads,
     // Uncomment to see how much memory is being allocated for each pool.
     // scene_rdl2::logging::Logger::info("Attempting to allocate ", entryMemorySize, " bytes for ", poolName, " pool.\n");
 
-    p.mEntryMemory = scene_rdl2::alignedMallocArray<uint8_t>(entryMemorySize, CACHE_LINE_SIZE);
+    // The pools are hit at random by every thread in bundled mode, which makes them
+    // the largest source of dTLB misses on 4K pages. Growable pools need a mapping of
+    // their own so that their pages can be handed back between frames.
+    if (hugePageMode != mcrt_common::HugePageMode::OFF || growthLimit) {
+        mcrt_common::HugePageMode usedMode;
+        p.mEntryMemory = static_cast<uint8_t *>(mcrt_common::allocHugePageBacked(entryMemorySize, hugePageMode,
+                                                                                 &usedMode));
+        if (p.mEntryMemory) {
+            p.mEntryMemoryMapped = true;
+            if (hugePageMode != mcrt_common::HugePageMode::OFF && usedMode != hugePageMode) {
+                scene_rdl2::logging::Logger::warn(poolName, " pool wanted ",
+                                                  mcrt_common::showHugePageMode(hugePageMode),
+                                                  " huge pages but got ",
+                                                  mcrt_common::showHugePageMode(usedMode));
+            }
+        }
+    }
+    if (!p.mEntryMemory) {
+        p.mEntryMemory = scene_rdl2::alignedMallocArray<uint8_t>(entryMemorySize, CACHE_LINE_SIZE);
+    }
+    p.mEntryMemorySize = entryMemorySize;
     p.mBlockMemory = scene_rdl2::alignedMallocArrayCtor<scene_rdl2::alloc::MemBlock>(numBlocks, CACHE_LINE_SIZE);
 
     p.mMemBlockManager = MNRY_VERIFY(scene_rdl2::alignedMallocCtor<scene_rdl2::alloc::MemBlockManager>(CACHE_LINE_SIZE));
     p.mMemBlockManager->init(numBlocks, p.mBlockMemory, p.mEntryMemory, entryStride);
 }
 
+void
+freeEntryMemory(PoolInfo &p)
+{
+    if (p.mEntryMemoryMapped) {
+        mcrt_common::freeHugePageBacked(p.mEntryMemory, p.mEntryMemorySize);
+    } else {
+        scene_rdl2::alignedFreeArray(p.mEntryMemory);
+    }
+}
 
 void
 initPrivate(const mcrt_common::TLSInitParams &initParams)
@@ -159,11 +203,13 @@ initPrivate(const mcrt_common::TLSInitParams &initParams)
     //
     if (initParams.mPerThreadRayStatePoolSize) {
         initPool(initParams.mPerThreadRayStatePoolSize, initParams.mDesiredNumTBBThreads,
-                 sizeof(RayState), "RayState", gPrivate.mRayState);
+                 sizeof(RayState), "RayState", initParams.mHugePageMode, initParams.mPoolGrowthLimit,
+                 gPrivate.mRayState);
     }
     if (initParams.mPerThreadCL1PoolSize) {
         initPool(initParams.mPerThreadCL1PoolSize, initParams.mDesiredNumTBBThreads,
-                 sizeof(TLState::CacheLine1), "CL1", gPrivate.mCL1);
+                 sizeof(TLState::CacheLine1), "CL1", initParams.mHugePageMode, initParams.mPoolGrowthLimit,
+                 gPrivate.mCL1);
     }
 
     // initParams is owned by the top level ThreadLocalState object so we know
@@ -181,11 +227,11 @@ cleanUpPrivate()
 
     scene_rdl2::alignedFreeDtor(gPrivate.mRayState.mMemBlockManager);
     scene_rdl2::alignedFreeArray(gPrivate.mRayState.mBlockMemory);
-    scene_rdl2::alignedFreeArray(gPrivate.mRayState.mEntryMemory);
+    freeEntryMemory(gPrivate.mRayState);
 
     scene_rdl2::alignedFreeDtor(gPrivate.mCL1.mMemBlockManager);
     scene_rdl2::alignedFreeArray(gPrivate.mCL1.mBlockMemory);
-    scene_rdl2::alignedFreeArray(gPrivate.mCL1.mEntryMemory);
+    freeEntryMemory(gPrivate.mCL1);
 
     // Reset internal TLS related data.
     gPrivate.~Private();
@@ -216,6 +262,30 @@ inline setQueueSize(T *queue, float t)
     }
 }
 
+template <typename T>
+void
+inline adaptQueueSize(T *queue, mcrt_common::QueueSizeController &controller)
+{
+    MNRY_ASSERT(queue);
+
+    const unsigned maxEntries = queue->getMaxEntries();
+    if (maxEntries == 0) {
+        return;
+    }
+
+    unsigned size = controller.update(queue->getFlushStats(), maxEntries);
+    if (size == 0) {
+        return;
+    }
+
+    // The queue has to be able to hold what's currently queued.
+    size = std::min(std::max(size, queue->getNumQueued() + 1), maxEntries);
+    if (size != queue->getQueueSize()) {
+        queue->setQueueSize(size);
+    }
+    queue->resetFlushStats();
+}
+
 }   // End of anon namespace.
 
 //-----------------------------------------------------------------------------
@@ -260,6 +330,9 @@ TLState::TLState(mcrt_common::ThreadLocalState *tls,
                                      (queueSize, CACHE_LINE_SIZE);
             mRayQueue.init(queueSize, mRayEntries);
             uint32_t rayHandlerFlags = 0;
+            if (initParams.mSortRays) {
+                rayHandlerFlags |= RAY_HANDLER_SORT_RAYS;
+            }
             mRayQueue.setHandler(rayBundleHandler, (void *)((uint64_t)rayHandlerFlags));
         }
 
@@ -615,6 +688,7 @@ TLState::setXPURayQueue(XPURayQueue* queue)
 void
 TLState::flushRadianceQueue()
 {
+     mcrt_common::TimelineScope timelineScope("flushRadianceQueue", "queue");
      mRadianceQueue->flush(mTopLevelTls, mArena);
 }
 
@@ -625,6 +699,8 @@ TLState::flushLocalQueues()
         return 0;
     }
 
+    mcrt_common::TimelineScope timelineScope("flushLocalQueues", "queue");
+
     unsigned processed = 0;
 
     processed += mRayQueue.flush(mTopLevelTls, mArena);
@@ -653,6 +729,24 @@ TLState::flushLocalQueues()
     return processed;
 }
 
+std::string
+TLState::showQueueFill() const
+{
+    std::ostringstream ostr;
+    auto showQueue = [&](const char *name, const auto *queue) {
+        if (queue) {
+            ostr << ' ' << name << ':' << queue->getNumQueued() << '/' << queue->getQueueSize();
+        }
+    };
+    showQueue("ray", &mRayQueue);
+    showQueue("occlusion", &mOcclusionQueue);
+    showQueue("presenceShadows", &mPresenceShadowsQueue);
+    showQueue("radiance", mRadianceQueue);
+    showQueue("aov", mAovQueue);
+    showQueue("heatMap", mHeatMapQueue);
+    return ostr.str();
+}
+
 bool
 TLState::areAllLocalQueuesEmpty()
 {
@@ -701,6 +795,46 @@ TLState::setAllQueueSizes(float t)
     }
 }
 
+void
+TLState::updateAdaptiveQueueSizes()
+{
+    adaptQueueSize(&mRayQueue, mQueueSizeControllers[0]);
+    adaptQueueSize(&mOcclusionQueue, mQueueSizeControllers[1]);
+    adaptQueueSize(&mPresenceShadowsQueue, mQueueSizeControllers[2]);
+
+    if (mRadianceQueue) {
+        adaptQueueSize(mRadianceQueue, mQueueSizeControllers[3]);
+    }
+    if (mAovQueue) {
+        adaptQueueSize(mAovQueue, mQueueSizeControllers[4]);
+    }
+    if (mHeatMapQueue) {
+        adaptQueueSize(mHeatMapQueue, mQueueSizeControllers[5]);
+    }
+}
+
+void
+TLState::resetAdaptiveQueueSizes()
+{
+    for (unsigned i = 0; i < NUM_ADAPTIVE_QUEUES; ++i) {
+        mQueueSizeControllers[i].reset();
+    }
+
+    mRayQueue.resetFlushStats();
+    mOcclusionQueue.resetFlushStats();
+    mPresenceShadowsQueue.resetFlushStats();
+
+    if (mRadianceQueue) {
+        mRadianceQueue->resetFlushStats();
+    }
+    if (mAovQueue) {
+        mAovQueue->resetFlushStats();
+    }
+    if (mHeatMapQueue) {
+        mHeatMapQueue->resetFlushStats();
+    }
+}
+
 void
 TLState::enableCancellation(bool waitUntilReadyForDisplay)
 {
@@ -820,6 +954,18 @@ TLState::getRayStatePoolSize()
     return gPrivate.mRayState.mMemBlockManager->getMemoryUsage();
 }
 
+size_t
+TLState::getCL1PoolHighWater()
+{
+    return gPrivate.mCL1.mResidentBytes;
+}
+
+size_t
+TLState::getRayStatePoolHighWater()
+{
+    return gPrivate.mRayState.mResidentBytes;
+}
+
 void
 resetPools()
 {
@@ -835,6 +981,16 @@ resetPools()
         tls->mCL1Pool.fastReset();
     });
 
+    // Growable pools: whatever got touched during the frame is its high water mark,
+    // hand it back so that the next frame starts from nothing again.
+    if (gPrivate.mInitParams && gPrivate.mInitParams->mPoolGrowthLimit) {
+        for (PoolInfo *p : {&gPrivate.mRayState, &gPrivate.mCL1}) {
+            if (!p->mEntryMemoryMapped) continue;
+            p->mResidentBytes = mcrt_common::getResidentBytes(p->mEntryMemory, p->mEntryMemorySize);
+            mcrt_common::releasePages(p->mEntryMemory, p->mEntryMemorySize);
+        }
+    }
+
 #ifdef DEBUG_RECORD_PEAK_RAYSTATE_USAGE
     static unsigned prevPeakRayStateUsage = 0;
     if (gPeakRayStateUsage > prevPeakRayStateUsage) {
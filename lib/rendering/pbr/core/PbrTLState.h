@@ -51,6 +51,7 @@ public:
     typedef mcrt_common::LocalLargeEntryQueue<BundledOcclRay>  PresenceShadowsQueue;
 
     typedef mcrt_common::ExclusiveAccumulators    ExclusiveAccumulators;
+    typedef mcrt_common::QueueSizeController      QueueSizeController;
 
 #pragma warning push
 #pragma warning disable 1875
@@ -75,6 +76,11 @@ public:
 
     static size_t       getCL1PoolSize();
 
+    // Memory the growable pools used during the last frame, 0 unless
+    // TLSInitParams::mPoolGrowthLimit is set. Updated by resetPools().
+    static size_t       getCL1PoolHighWater();
+    static size_t       getRayStatePoolHighWater();
+
     // RayState management.
     RayState **         allocRayStates(unsigned numRayStates);
     void                freeRayStates(unsigned numRayStates, RayState **rayStates);
@@ -120,11 +126,23 @@ public:
     unsigned            flushLocalQueues();
     bool                areAllLocalQueuesEmpty();
 
+    // One line of "name:queued/size" for each local queue. Meant for the
+    // debug console, which reads it while this thread keeps queuing, so the
+    // counts are only a snapshot.
+    std::string         showQueueFill() const;
+
     // t is a value in [0, 1] which is a hint for what proportion of the max
     // queue entries to size each queue. It's useful to fine control the
     // balancing throughput vs. latency wrt to samples being displayed.
     void                setAllQueueSizes(float t);
 
+    // Adapts each local queue size to the handler cost measured since the
+    // previous call, see mcrt_common::QueueSizeController. Only call this from
+    // the thread owning this TLState. resetAdaptiveQueueSizes restarts the
+    // search from the current queue sizes.
+    void                updateAdaptiveQueueSizes();
+    void                resetAdaptiveQueueSizes();
+
     //
     // Cancellation functionality:
     //
@@ -175,6 +193,16 @@ public:
 
     PBR_TL_STATE_MEMBERS;
 
+    // Arena mark of the innermost bounce of the scalar path being traced, and
+    // the arena memory held by the bounces above it, see ArenaBounceScope.
+    uint8_t *mBounceArenaMark = nullptr;
+    size_t mPathArenaBytes = 0;
+
+    // Scale of the russian roulette threshold of the scalar paths being traced,
+    // raised by the render driver for the pixels close to their adaptive target
+    // error so that their paths end earlier.
+    float mRussianRouletteScale = 1.f;
+
 private:
     template <typename QueueType>
     finline void addFilmQueueEntries(unsigned numEntries,
@@ -200,6 +228,9 @@ private:
 MNRY_STATIC_ASSERT((offsetof(TLState, mExclusiveAccumulators)) == TLS_OFFSET_TO_EXCL_ACCUMULATORS);
 #pragma warning(pop)
 
+// If this fails, update the size of mQueueSizeControllers in PbrTLState.hh.
+MNRY_STATIC_ASSERT(sizeof(mcrt_common::QueueSizeController) * NUM_ADAPTIVE_QUEUES == 192);
+
 // Shorten the TLS queue type names for convenience.
 typedef TLState::RayStatePool         RayStatePool;
 typedef TLState::RayQueue             RayQueue;
@@ -212,6 +243,55 @@ typedef TLState::HeatMapQueue         HeatMapQueue;
 typedef TLState::CacheLine1        CacheLine1;
 typedef TLState::CL1Pool           CL1Pool;
 
+//
+// Measures the arena memory a bounce of a scalar path holds on to while the
+// bounces below it are traced. Constructed right after the SCOPED_MEM of the
+// bounce, so it is destroyed before the arena is rolled back, and keeps the
+// peak of the path in Statistics::mPathArenaPeakBytes.
+//
+class ArenaBounceScope
+{
+public:
+    explicit ArenaBounceScope(TLState *tls) :
+        mTls(tls),
+        mParentMark(tls->mBounceArenaMark),
+        mParentBytes(tls->mPathArenaBytes)
+    {
+        uint8_t *ptr = mTls->mArena->getPtr();
+        if (mParentMark) {
+            mTls->mPathArenaBytes += measure(mParentMark, ptr);
+        }
+        mTls->mBounceArenaMark = ptr;
+    }
+
+    ~ArenaBounceScope()
+    {
+        const uint64_t bytes = mTls->mPathArenaBytes + measure(mTls->mBounceArenaMark, mTls->mArena->getPtr());
+        Statistics &stats = mTls->mStatistics;
+        stats.mPathArenaPeakBytes = std::max(stats.mPathArenaPeakBytes, bytes);
+
+        mTls->mBounceArenaMark = mParentMark;
+        mTls->mPathArenaBytes = mParentBytes;
+    }
+
+private:
+    size_t measure(const uint8_t *mark, const uint8_t *ptr) const
+    {
+        // Pointers into different arena blocks can't be compared.
+        if (ptr < mark || size_t(ptr - mark) >= mTls->mArena->getBlockSize()) {
+            ++mTls->mStatistics.mPathArenaUnmeasuredBounces;
+            return 0;
+        }
+        return size_t(ptr - mark);
+    }
+
+    TLState *mTls;
+    uint8_t *mParentMark;
+    size_t mParentBytes;
+
+    DISALLOW_COPY_OR_ASSIGNMENT(ArenaBounceScope);
+};
+
 //
 // Convenience function for iterating over all existing pbr TLS instances.
 //
@@ -9,6 +9,9 @@
 
 #define ACTIVE_ACC_STACK_SIZE   64
 
+// Ray, occlusion, presence shadows, radiance, aov and heat map queues.
+#define NUM_ADAPTIVE_QUEUES     6
+
 //
 //  mTopLevelTls                        Backpointer to top level TLS.
 //  mRayStatePool                       Pooled memory allocator.
@@ -34,16 +37,17 @@
 //  mRadianceEntries
 //  mAovEntries
 //  mHeatMapEntries
+//  mQueueSizeControllers               Adaptive queue sizing state, one per local queue.
 //
 #define PBR_TL_STATE_MEMBERS                                                        \
     HUD_PTR(ThreadLocalState *, mTopLevelTls);                                      \
     HUD_CPP_PTR(ExclusiveAccumulators *, mExclusiveAccumulators);                   \
     HUD_CPP_MEMBER(RayStatePool, mRayStatePool, 96);                                \
     HUD_CPP_MEMBER(CL1Pool, mCL1Pool, 96);                                          \
-    HUD_CPP_MEMBER(RayQueue, mRayQueue, 40);                                        \
+    HUD_CPP_MEMBER(RayQueue, mRayQueue, 64);                                        \
     HUD_PRIVATE()                                                                   \
-    HUD_CPP_MEMBER(OcclusionQueue, mOcclusionQueue, 40);                            \
-    HUD_CPP_MEMBER(PresenceShadowsQueue, mPresenceShadowsQueue, 40);                \
+    HUD_CPP_MEMBER(OcclusionQueue, mOcclusionQueue, 64);                            \
+    HUD_CPP_MEMBER(PresenceShadowsQueue, mPresenceShadowsQueue, 64);                \
     HUD_CPP_PTR(RadianceQueue *, mRadianceQueue);                                   \
     HUD_CPP_PTR(AovQueue *, mAovQueue);                                             \
     HUD_CPP_PTR(HeatMapQueue *, mHeatMapQueue);                                     \
@@ -65,6 +69,7 @@
     HUD_CPP_PTR(RadianceQueue::EntryType *, mRadianceEntries);                      \
     HUD_CPP_PTR(AovQueue::EntryType *, mAovEntries);                                \
     HUD_CPP_PTR(HeatMapQueue::EntryType *, mHeatMapEntries);                        \
+    HUD_CPP_ARRAY(QueueSizeController, mQueueSizeControllers, NUM_ADAPTIVE_QUEUES, 192); \
     HUD_ISPC_PAD(mPad, 8)
 
 
@@ -96,6 +101,7 @@
     HUD_VALIDATE(PbrTLState, mRadianceEntries);                 \
     HUD_VALIDATE(PbrTLState, mAovEntries);                      \
     HUD_VALIDATE(PbrTLState, mHeatMapEntries);                  \
+    HUD_VALIDATE(PbrTLState, mQueueSizeControllers);            \
     HUD_END_VALIDATION
 
 #define PBR_TL_STATE_NULL_HANDLE 0xffffffff
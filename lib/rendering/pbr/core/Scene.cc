@@ -51,6 +51,7 @@
 #include <moonray/rendering/shading/bsdf/Bsdf.h>
 #include <moonray/rendering/shading/bssrdf/Bssrdf.h>
 #include <scene_rdl2/render/logging/logging.h>
+#include <scene_rdl2/render/util/Arena.h>
 #include <scene_rdl2/scene/rdl2/VisibilityFlags.h>
 
 #include <iomanip>
@@ -240,8 +241,16 @@ Scene::preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode execution
     // Updating lights needs to happen after the mCamera->update() above
     // All lights are updated as well
     // Lights needs to be updated if there is a frame change or motion blur is toggled.
-    bool updateLights = mRdlLayer->lightSetsChanged() || vars.hasChanged(rdl2::SceneVariables::sFrameKey) ||
+    bool updateLights = vars.hasChanged(rdl2::SceneVariables::sFrameKey) ||
         vars.hasChanged(rdl2::SceneVariables::sEnableMotionBlur);
+    // Lights edited in place, e.g. interactively, rather than re-created with the light list. Their light
+    // accelerators are refit rather than rebuilt.
+    std::unordered_set<const Light *> changedLights;
+    bool lightsChanged = false;
+    if (!updateLights && mRdlLayer->lightSetsChanged()) {
+        lightsChanged = updateChangedLights(changedLights);
+        updateLights = !lightsChanged;
+    }
     if (updateLights) {
         updateLightList();
     } else {
@@ -268,12 +277,11 @@ Scene::preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode execution
 
     // Update light filters. This must be done after we update the lights. Since light filters are mapped
     // to lights, if we do update the lights, we must also update light filters.
-    if (mRdlLayer->lightFilterSetsChanged() || updateLights) {
+    if (mRdlLayer->lightFilterSetsChanged() || updateLights || lightsChanged) {
         updateLightFilters();
     }
 
-    mVisibleLightList.clear();
-    mVisibleLightFilterLists.clear();
+    LightPtrList visibleLightList;
     // Make the visible light list.
     // Do 3 passes, adding the bounded lights (sphere, rect, disk, spot, cylinder) in the first pass
     // distant lights in the second pass, env lights in the third pass. This is done
@@ -290,13 +298,17 @@ Scene::preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode execution
                 ( (pass == 2) && light->isEnv()     ) ) {
 
                 if (light->getIsVisibleInCamera()) {
-                    mVisibleLightList.push_back(light);
-                    // lights visible in camera do not have light filters (for now)
-                    mVisibleLightFilterLists.push_back(nullptr);
+                    visibleLightList.push_back(light);
                 }
             }
         }
     }
+    const bool visibleLightsChanged = visibleLightList != mVisibleLightList;
+    if (visibleLightsChanged) {
+        mVisibleLightList.swap(visibleLightList);
+        // lights visible in camera do not have light filters (for now)
+        mVisibleLightFilterLists.assign(mVisibleLightList.size(), nullptr);
+    }
 
     mVisibleLightSet.init(mVisibleLightList.data(), mVisibleLightList.size(), mVisibleLightFilterLists.data());
 
@@ -321,27 +333,39 @@ Scene::preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode execution
                     static_cast<pbr::LightSamplingMode>(vars.get(scene_rdl2::rdl2::SceneVariables::sLightSamplingMode));
     const float lightSamplingQuality = vars.get(scene_rdl2::rdl2::SceneVariables::sLightSamplingQuality);
 
+    // The light accelerators are kept from the previous frame and refit to the changed lights, unless the lights
+    // were re-created, or the mesh lights regenerated, or the light sampling settings changed.
+    const bool refitLightAccelerators = !updateLights && !forceMeshLightGeneration &&
+        !vars.hasChanged(scene_rdl2::rdl2::SceneVariables::sLightSamplingMode) &&
+        !vars.hasChanged(scene_rdl2::rdl2::SceneVariables::sLightSamplingQuality);
+
+    const auto updateLightAccelerator = [&](LightAccelerator* acc, const Light* const* lights, int lightCount,
+                                            bool refit) {
+        RenderTimer buildLightBVHTimer(stats.mBuildLightBVHTime);
+        // A refit tree that has degraded too much is rebuilt
+        if (!refit || !acc->refit(changedLights)) {
+            acc->init(lights, lightCount, lightSamplingQuality);
+            if (lightSamplingMode == pbr::LightSamplingMode::ADAPTIVE) {
+                acc->buildSamplingTree();
+            }
+            // Skipped when the sampling tree can be used for intersection
+            acc->buildIntersectionScene(rtcDevice);
+        }
+        stats.mLightBVHMemoryFootprint += acc->getLightTree()->getMemoryFootprint();
+    };
+
     // First the per-layer light sets
     LightAccelerator* acc = mLightAccList.data();
     MNRY_ASSERT(acc);
     LightPtrList* lightPtrList = mLightSets.data();
     for (unsigned int i=0; i<mLightSets.size(); i++, acc++, lightPtrList++) {
-        acc->init(lightPtrList->data(), lightPtrList->size(), rtcDevice, lightSamplingQuality);
-        if (lightSamplingMode == pbr::LightSamplingMode::ADAPTIVE) {
-            RenderTimer buildLightBVHTimer(stats.mBuildLightBVHTime);
-            acc->buildSamplingTree();
-            stats.mLightBVHMemoryFootprint += acc->getLightTree()->getMemoryFootprint();
-        }
+        updateLightAccelerator(acc, lightPtrList->data(), lightPtrList->size(), refitLightAccelerators);
     }
 
     // Finally the visible light set
     size_t visibleLightCount = mVisibleLightSet.getLightCount();
-    acc->init(mVisibleLightSet.getLights(), visibleLightCount, rtcDevice, lightSamplingQuality);
-    if (lightSamplingMode == pbr::LightSamplingMode::ADAPTIVE) {
-        RenderTimer buildLightBVHTimer(stats.mBuildLightBVHTime);
-        acc->buildSamplingTree();
-        stats.mLightBVHMemoryFootprint += acc->getLightTree()->getMemoryFootprint();
-    }
+    updateLightAccelerator(acc, mVisibleLightSet.getLights(), visibleLightCount,
+                           refitLightAccelerators && !visibleLightsChanged);
     int * visibleLightAcceleratorIndexMap = new int[visibleLightCount];
     for (size_t i = 0; i < visibleLightCount; ++i) {
         visibleLightAcceleratorIndexMap[i] = i;
@@ -370,7 +394,11 @@ Scene::preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode execution
 
     // Store the list of emissive volume primitives
     geometryManager.getEmissiveRegions(mRdlLayer, mEmissiveRegions);
+}
 
+void
+Scene::updateShadowLinkings(rt::GeometryManager& geometryManager)
+{
     // If the ShadowSets or the geometries changed, we must change the shadow linkings.
     if (mRdlLayer->shadowSetsChanged() || !mRdlLayer->getChangedOrDeformedGeometries().empty()) {
         geometryManager.updateShadowLinkings(mRdlLayer);
@@ -742,6 +770,10 @@ Scene::updateLightList()
         }
     }
 
+    for (const rdl2::LightSet* const rdlLightSet : rdlLightSets) {
+        mRdlLightSetLights[rdlLightSet] = rdlLightSet->getLights();
+    }
+
     // Initialize the light accelerators (there will always be lightSetCount + 1 members,
     // where the extra 1 is the visible light set)
     mLightAccList.resize(lightSetCount + 1);
@@ -768,6 +800,7 @@ Scene::updateLightList()
         }
 
         // It's ok to add null pointers to this list.
+        mIdToRdlLightSetMap.push_back(rdlLightSet);
         mIdToLightSetMap.push_back(lightPtrList);
         mIdToLightAcceleratorMap.push_back(lightAccelerator);
         mIdToLightSetActiveList.push_back(lightSetActiveList);
@@ -775,6 +808,67 @@ Scene::updateLightList()
 }
 
 
+bool
+Scene::updateChangedLights(std::unordered_set<const Light *> &changedLights)
+{
+    // Nothing to update in place before the first light list
+    if (mLightAccList.empty()) {
+        return false;
+    }
+
+    // Same light sets, holding the same lights
+    uint32_t assignmentCount = mRdlLayer->getAssignmentCount();
+    if (assignmentCount != mIdToRdlLightSetMap.size()) {
+        return false;
+    }
+    std::set<const rdl2::LightSet *> rdlLightSets;
+    for (uint32_t i = 0; i < assignmentCount; ++i) {
+        const rdl2::LightSet *lightSet = mRdlLayer->lookupLightSet(i);
+        if (lightSet != mIdToRdlLightSetMap[i]) {
+            return false;
+        }
+        if (lightSet) {
+            rdlLightSets.insert(lightSet);
+        }
+    }
+    for (const rdl2::LightSet* const rdlLightSet : rdlLightSets) {
+        const auto lights = mRdlLightSetLights.find(rdlLightSet);
+        if (lights == mRdlLightSetLights.end() || lights->second != rdlLightSet->getLights()) {
+            return false;
+        }
+    }
+
+    // Update the edited lights
+    for (const rdl2::LightSet* const rdlLightSet : rdlLightSets) {
+        for (const auto& lightobj : rdlLightSet->getLights()) {
+            const rdl2::Light* const rdlLight = static_cast<const rdl2::Light*>(lightobj);
+            if (!rdlLight->updateRequired()) {
+                continue;
+            }
+            // A light which was off may be switched on
+            const auto lightIdx = mRdlLightToLightMap.find(rdlLight);
+            if (lightIdx == mRdlLightToLightMap.end()) {
+                return false;
+            }
+            Light* light = mLightList[lightIdx->second];
+            if (changedLights.count(light)) {
+                // in several light sets
+                continue;
+            }
+            // The mesh light geometry may need regenerating
+            if (light->isMesh()) {
+                return false;
+            }
+            // A light which was on may be switched off
+            if (!light->update(getWorld2Render()) || !light->isOn()) {
+                return false;
+            }
+            changedLights.insert(light);
+        }
+    }
+    return true;
+}
+
 void
 Scene::clearLightList()
 {
@@ -785,6 +879,8 @@ Scene::clearLightList()
     mLightList.clear();
     mLightSets.clear();
     mRdlLightToLightMap.clear();
+    mIdToRdlLightSetMap.clear();
+    mRdlLightSetLights.clear();
     mIdToLightSetMap.clear();
     mIdToLightAcceleratorMap.clear();
     mIdToLightSetActiveList.clear();
@@ -836,6 +932,54 @@ Scene::intersectRay(mcrt_common::ThreadLocalState *tls, mcrt_common::Ray &ray, s
     }
 }
 
+void
+Scene::intersectRays(mcrt_common::ThreadLocalState *tls, unsigned numRays,
+        mcrt_common::Ray **rays, shading::Intersection *isects, bool *hits,
+        const int lobeType) const
+{
+    pbr::TLState *pbrTls = tls->mPbrTls.get();
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+
+    // Empty rays are not traced, as in intersectRay()
+    mcrt_common::Ray **tracedRays = arena->allocArray<mcrt_common::Ray *>(numRays);
+    unsigned numTracedRays = 0;
+    const int lobeMask = lobeTypeToRayMask(lobeType);
+    for (unsigned i = 0; i < numRays; ++i) {
+        hits[i] = false;
+        mcrt_common::Ray &ray = *rays[i];
+        if (ray.getStart() >= ray.getEnd()) {
+            continue;
+        }
+        if (lobeType == 0) {
+            ray.mask = rdl2::CAMERA;
+        } else {
+            ray.mask = mPropagateVisibilityBounceType
+                    ?  ((ray.mask | lobeMask) & ~rdl2::CAMERA)
+                    : lobeMask;
+        }
+        tracedRays[numTracedRays++] = &ray;
+    }
+    if (numTracedRays == 0) {
+        return;
+    }
+
+    pbrTls->mStatistics.addToCounter(STATS_INTERSECTION_RAYS, numTracedRays);
+
+    {
+        EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_EMBREE_INTERSECTION);
+        mEmbreeAccel->intersect(numTracedRays, tracedRays);
+    }
+
+    for (unsigned i = 0; i < numRays; ++i) {
+        mcrt_common::Ray &ray = *rays[i];
+        if (ray.getStart() < ray.getEnd() && ray.geomID != -1) {
+            geom::initIntersectionPhase1(isects[i], tls, ray, mRdlLayer);
+            hits[i] = true;
+        }
+    }
+}
+
 bool
 Scene::intersectPresenceRay(mcrt_common::ThreadLocalState *tls,
                             mcrt_common::Ray &ray,
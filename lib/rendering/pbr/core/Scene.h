@@ -23,6 +23,7 @@
 #include <iostream>
 #include <memory>
 #include <set>
+#include <unordered_set>
 #include <vector>
 
 namespace scene_rdl2 {
@@ -118,6 +119,11 @@ public:
     void preFrame(const LightAovs &lightAovs, mcrt_common::ExecutionMode executionMode,
             rt::GeometryManager& geometryManager, bool forceMeshLightGeneration, rndr::RenderStats& stats);
 
+    /// Update the shadow linkings of the geometries if the shadow sets or the
+    /// geometries changed. Called before preFrame(), the GPU accelerator reads
+    /// the linkings while preFrame() runs.
+    void updateShadowLinkings(rt::GeometryManager& geometryManager);
+
     void postFrame();
 
     /// The intersections return hits with geometry and area lights.
@@ -129,6 +135,14 @@ public:
     bool intersectRay(mcrt_common::ThreadLocalState *tls, mcrt_common::Ray &ray,
             shading::Intersection &isect, const int lobeType) const;
 
+    /// Batched intersectRay() for independent rays of a single shading point,
+    /// traced together through the Embree packet API. hits[i] and isects[i]
+    /// receive what intersectRay() would return for rays[i]; isects[i] is
+    /// left untouched on a miss.
+    void intersectRays(mcrt_common::ThreadLocalState *tls, unsigned numRays,
+            mcrt_common::Ray **rays, shading::Intersection *isects, bool *hits,
+            const int lobeType) const;
+
     /// Checks whether the given ray intersects the geometry we've marked "is_camera_medium_geometry".
     /// Used to check whether we should add the "medium_material" to the primary ray's material priority list.
     bool intersectCameraMedium(const mcrt_common::Ray &ray) const;
@@ -318,6 +332,12 @@ private:
     void updateLightList();
     void clearLightList();
 
+    /// Update in place the lights edited since the last frame, rather than re-creating all the lights with
+    /// updateLightList(). Only possible when the layer still assigns the same light sets, holding the same
+    /// lights, and no light was switched on or off; mesh lights aren't updated in place either. Returns false
+    /// when the light list has to be rebuilt instead, otherwise the updated lights are added to changedLights.
+    bool updateChangedLights(std::unordered_set<const Light *> &changedLights);
+
     // Generate the geometry for the mesh light if the mesh light needs to be updated (called during preFrame())
     void generateMeshLightGeometry(Light* light);
 
@@ -380,6 +400,11 @@ private:
     // Maps an rdl2 light object to a runtime light index.
     std::map<const scene_rdl2::rdl2::Light *, int> mRdlLightToLightMap;
 
+    // The rdl2 light set of each layer assignment and the lights of each rdl2 light set, as of the last
+    // updateLightList(). They tell whether updateChangedLights() can update the lights in place.
+    std::vector<const scene_rdl2::rdl2::LightSet *> mIdToRdlLightSetMap;
+    std::map<const scene_rdl2::rdl2::LightSet *, scene_rdl2::rdl2::SceneObjectVector> mRdlLightSetLights;
+
     // Maps a layer assignment id to a runtime light set in constant time.
     std::vector<const LightPtrList *> mIdToLightSetMap;
     std::vector<const LightAccelerator *> mIdToLightAcceleratorMap;
@@ -10,6 +10,8 @@
 #include <moonray/common/mcrt_util/Average.h>
 #include <scene_rdl2/common/platform/Platform.h>
 
+#include <algorithm>
+
 namespace moonray {
 namespace pbr {
 
@@ -43,17 +45,28 @@ public:
         }
         mMcrtTime = 0.0;
         mMcrtUtilization = 0.0;
+        mPathGuideSamplesRecorded = 0;
+        mPathGuideMergeTime = 0.0;
+        mGPUBusyTime = 0.0;
+        mGPUDeviceBusyTime.clear();
+        mGPUDeviceRays.clear();
         mAdaptiveLightSamplingOverhead.reset();
         mLightSamplingTime.clear();
+        mLightOcclusionTime.clear();
         mLightSamples.clear();
         mUsefulLightSamples.clear();
+        mCulledShadowRays.clear();
+        mPathArenaPeakBytes = 0;
+        mPathArenaUnmeasuredBounces = 0;
     }
 
     void initLightStats(size_t numLights) 
     {
         mLightSamplingTime.resize(numLights, moonray::util::AverageDouble());
+        mLightOcclusionTime.resize(numLights, moonray::util::AverageDouble());
         mLightSamples.resize(numLights, 0);
         mUsefulLightSamples.resize(numLights, 0);
+        mCulledShadowRays.resize(numLights, 0);
     }
 
     Statistics &operator += (Statistics const &rhs) {
@@ -64,11 +77,16 @@ public:
         MNRY_ASSERT(mLightSamples.size() == rhs.mLightSamples.size());
         for (size_t i = 0; i < mLightSamples.size(); i++) {
             mLightSamplingTime[i] += rhs.mLightSamplingTime[i];
+            mLightOcclusionTime[i] += rhs.mLightOcclusionTime[i];
             mLightSamples[i] += rhs.mLightSamples[i];
             mUsefulLightSamples[i] += rhs.mUsefulLightSamples[i];
+            mCulledShadowRays[i] += rhs.mCulledShadowRays[i];
         }
 
         mAdaptiveLightSamplingOverhead += rhs.mAdaptiveLightSamplingOverhead;
+
+        mPathArenaPeakBytes = std::max(mPathArenaPeakBytes, rhs.mPathArenaPeakBytes);
+        mPathArenaUnmeasuredBounces += rhs.mPathArenaUnmeasuredBounces;
     
         return *this;
     }
@@ -85,10 +103,10 @@ public:
         ++mCounters[counter];
     }
 
-    void addToCounter(unsigned counter, unsigned count)
+    void addToCounter(unsigned counter, uint64_t count)
     {
         MNRY_ASSERT(counter < NUM_STATS_COUNTERS);
-        mCounters[counter] += uint64_t(count);
+        mCounters[counter] += count;
     }
 
     void incLightSamples(int lightIdx)
@@ -103,14 +121,45 @@ public:
         mUsefulLightSamples[lightIdx]++;
     }
 
+    void incCulledShadowRays(int lightIdx)
+    {
+        if (lightIdx == -1) return;
+        mCulledShadowRays[lightIdx]++;
+    }
+
     // HUD validation.
     static uint32_t hudValidation(bool verbose) { PBR_STATISTICS_VALIDATION; }
 
     PBR_STATISTICS_MEMBERS;
     std::vector<moonray::util::AverageDouble> mLightSamplingTime;
+    // Time spent in the shadow rays toward each light, only filled in when
+    // cost attribution is on (see PathIntegrator::isRayOccludedWithCost()).
+    std::vector<moonray::util::AverageDouble> mLightOcclusionTime;
     std::vector<uint32_t> mLightSamples;
     std::vector<uint32_t> mUsefulLightSamples;
+    // Light samples culled by the shadow ray roulette, scalar mode only
+    // (see applyShadowRayRoulette()).
+    std::vector<uint32_t> mCulledShadowRays;
     moonray::util::AverageDouble mAdaptiveLightSamplingOverhead;
+
+    // Scalar mode only, the most arena memory held at once by the bounces of
+    // a path (see ArenaBounceScope). Combined as the maximum over the threads.
+    uint64_t mPathArenaPeakBytes;
+    // Bounces whose allocations spanned two arena blocks and couldn't be
+    // measured.
+    uint64_t mPathArenaUnmeasuredBounces;
+
+    // Frame level path guiding stats, filled in from the PathGuide at the
+    // end of the frame rather than accumulated per thread.
+    uint64_t mPathGuideSamplesRecorded;
+    double mPathGuideMergeTime;
+
+    // Frame level XPU stats, wall clock time during which at least one
+    // thread was waiting on the GPU, overall and per device, and the number
+    // of rays traced by each device.  Filled in from the GPUAccelerator.
+    double mGPUBusyTime;
+    std::vector<double> mGPUDeviceBusyTime;
+    std::vector<uint64_t> mGPUDeviceRays;
 };
 
 //----------------------------------------------------------------------------
@@ -19,16 +19,41 @@ enum StatCounters
     STATS_INTERSECTION_RAYS,
     STATS_BUNDLED_INTERSECTION_RAYS,
     STATS_BUNDLED_GPU_INTERSECTION_RAYS,
+    // Bundled intersection rays sorted for coherence, and the runs of rays
+    // sharing a direction octant they were sorted into.
+    STATS_SORTED_INTERSECTION_RAYS,
+    STATS_SORTED_INTERSECTION_RAY_RUNS,
     STATS_VOLUME_RAYS,
     STATS_OCCLUSION_RAYS,
     STATS_BUNDLED_OCCLUSION_RAYS,
     STATS_BUNDLED_GPU_OCCLUSION_RAYS,
     STATS_PRESENCE_SHADOW_RAYS,
+    // Light samples whose shadow ray the shadow ray roulette culled.
+    STATS_CULLED_SHADOW_RAYS,
+
+    // Bsdf sample rays the scalar paths continued with, for the average path depth.
+    STATS_SCALAR_PATH_BOUNCES,
 
     STATS_SHADER_EVALS,
     STATS_TEXTURE_SAMPLES,
     STATS_NUM_LIGHTS_CHOSEN,
 
+    // Heterogeneous volume segments the shadow transmittance is estimated
+    // over, and the density lookups it took.
+    STATS_VOLUME_TRANSMITTANCE_SEGMENTS,
+    STATS_VOLUME_TRANSMITTANCE_LOOKUPS,
+
+    // Rays collecting volume intervals, the intervals they collected, and
+    // the rays with too many intervals to keep them sorted on insertion.
+    STATS_VOLUME_INTERVAL_RAYS,
+    STATS_VOLUME_INTERVALS,
+    STATS_VOLUME_INTERVAL_SORTS,
+
+    // Data TLB load accesses and misses of the render threads, only counted
+    // with RenderOptions::setTlbStats().
+    STATS_DTLB_LOAD_ACCESSES,
+    STATS_DTLB_LOAD_MISSES,
+
     // Vectorized only. These count the numbers of samples we're taking assuming
     // all lanes are active. This allows us to compute our actual lane utilization
     // at a later stage.
@@ -48,7 +73,7 @@ enum StatCounters
     //
 
     // Shading related:
-
+    LANE_UTILIZATION_COUNTER( STATS_VEC_SHADE ),
 
     // Texturing related:
 
@@ -82,12 +107,13 @@ enum StatCounters
     NUM_STATS_COUNTERS,
 };
 
-// need to pad ispc by 88 to accomodate extra c++ members (light sampling stats)
+// need to pad ispc by 224 to accomodate extra c++ members (light sampling stats: 136,
+// path arena stats: 16, path guiding stats: 16, XPU stats: 56)
 #define PBR_STATISTICS_MEMBERS                              \
     HUD_ARRAY(uint64_t, mCounters, NUM_STATS_COUNTERS);     \
     HUD_MEMBER(double, mMcrtTime);                          \
     HUD_MEMBER(double, mMcrtUtilization);                   \
-    HUD_ISPC_PAD(mPad, 88)
+    HUD_ISPC_PAD(mPad, 224)
 
 #define PBR_STATISTICS_VALIDATION                           \
     HUD_BEGIN_VALIDATION(PbrStatistics);                    \
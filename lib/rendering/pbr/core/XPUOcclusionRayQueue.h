@@ -8,6 +8,9 @@
 #include <moonray/rendering/rt/gpu/GPURay.h>
 #include <moonray/rendering/rt/gpu/GPUAccelerator.h>
 
+#include <atomic>
+#include <chrono>
+
 // warning #1684: conversion from pointer to
 // same-sized integral type (potential portability problem)
 // needed for reinterpret_cast<intptr_t>(light)
@@ -51,6 +54,20 @@ This system can potentially be improved upon with Keith's lock-free queue ideas,
 but this current scheme is a reasonable baseline that we can compare more sophisticated
 and efficient methods.
 
+Once both devices have processed some batches, the thread count heuristic is replaced by
+a cost model: the queue keeps running averages of the CPU time per ray and of the GPU time
+per ray (the latency of a batch over the rays that were on the GPU with it), and sends a
+batch to the GPU when the rays already on the GPU plus this batch would be done there
+sooner than this thread could trace the batch itself.  An idle GPU always gets the batch,
+which also keeps its estimate up to date.
+
+When the GPU accelerator supports asynchronous submission (Metal), each thread's queue
+is double buffered.  A full buffer is submitted to the GPU and the thread goes on queueing
+rays into the other buffer, so the CPU keeps shading while the GPU traces.  The results of
+a batch are handed to the GPU handler on the thread that queued it, once the thread needs
+that buffer again or flushes the queue.  With a single buffer (Optix) the batch is traced
+and handled right away.
+
 The API design of this queue class resembles the other queues in mcrt_common/Bundle.h.
 The two main methods are addEntries() and flush().
 */
@@ -64,11 +81,12 @@ public:
                                BundledOcclRay **entryData,
                                void *userData);
 
-    // The GPU handler that calls the GPU
+    // The GPU handler that waits for the GPU to trace a submitted buffer of rays
+    // and processes the results
     typedef void (*GPUHandler)(mcrt_common::ThreadLocalState *tls,
                                unsigned numEntries,
                                BundledOcclRay *entryData,
-                               const rt::GPURay *gpuRays,
+                               unsigned bufferIdx,
                                std::atomic<int>& threadsUsingGPU);
 
     XPUOcclusionRayQueue(unsigned numCPUThreads,
@@ -79,49 +97,68 @@ public:
                          void *handlerData) :
         mNumCPUThreads(numCPUThreads),
         mCPUThreadQueueSize(cpuThreadQueueSize),
+        mNumBuffers(rt::GPUAccelerator::getNumQueueBuffers()),
         mCPUThreadQueueHandler(cpuThreadQueueHandler),
         mGPUQueueHandler(gpuQueueHandler),
         mHandlerData(handlerData)
     {
         MNRY_ASSERT(numCPUThreads);
         MNRY_ASSERT(cpuThreadQueueSize);
+        MNRY_ASSERT(mNumBuffers);
         MNRY_ASSERT(mCPUThreadQueueHandler);
         MNRY_ASSERT(mGPUQueueHandler);
 
-        // Create a queue for each CPU thread
-        mCPUThreadQueueEntries.resize(mNumCPUThreads);
+        // Create the queue buffers for each CPU thread
+        mCPUThreadQueueEntries.resize(mNumCPUThreads * mNumBuffers);
+        mCPUThreadQueueNumInFlight.resize(mNumCPUThreads * mNumBuffers);
+        mCPUThreadQueueSubmitTime.resize(mNumCPUThreads * mNumBuffers);
+        mCPUThreadQueueRaysOnGPUAtSubmit.resize(mNumCPUThreads * mNumBuffers);
         mCPUThreadQueueNumQueued.resize(mNumCPUThreads);
+        mCPUThreadQueueFillBuffer.resize(mNumCPUThreads);
 
         for (size_t i = 0; i < numCPUThreads; i++) {
+            for (unsigned b = 0; b < mNumBuffers; b++) {
+                const size_t slot = i * mNumBuffers + b;
 #ifdef __APPLE__
-            // The GPU accelerator supports UMA: we ask for a UMA buffer from the accelerator instead
-            //  of allocating one ourselves.
-            mCPUThreadQueueEntries[i] = (BundledOcclRay*)gpuAccel->getBundledOcclRaysBufUMA(
-                                            i, mCPUThreadQueueSize, sizeof(BundledOcclRay));
+                // The GPU accelerator supports UMA: we ask for a UMA buffer from the accelerator instead
+                //  of allocating one ourselves.
+                mCPUThreadQueueEntries[slot] = (BundledOcclRay*)gpuAccel->getBundledOcclRaysBufUMA(
+                                                   i, mCPUThreadQueueSize, sizeof(BundledOcclRay), b);
 #else
-            mCPUThreadQueueEntries[i] = scene_rdl2::util::alignedMallocArray<BundledOcclRay>(mCPUThreadQueueSize, CACHE_LINE_SIZE);
+                mCPUThreadQueueEntries[slot] =
+                    scene_rdl2::util::alignedMallocArray<BundledOcclRay>(mCPUThreadQueueSize, CACHE_LINE_SIZE);
 #endif
+                mCPUThreadQueueNumInFlight[slot] = 0;
+                mCPUThreadQueueRaysOnGPUAtSubmit[slot] = 0;
+            }
             mCPUThreadQueueNumQueued[i] = 0;
+            mCPUThreadQueueFillBuffer[i] = 0;
         }
 
         mNumThreadsUsingGPU = 0;
+        mNumRaysOnGPU = 0;
+        mCPUSecondsPerRay = 0.0f;
+        mGPUSecondsPerRay = 0.0f;
     }
 
     virtual ~XPUOcclusionRayQueue()
     {
         for (size_t i = 0; i < mNumCPUThreads; i++) {
             MNRY_ASSERT(mCPUThreadQueueNumQueued[i] == 0);
+        }
+        for (size_t slot = 0; slot < mCPUThreadQueueEntries.size(); slot++) {
+            MNRY_ASSERT(mCPUThreadQueueNumInFlight[slot] == 0);
 #ifdef __APPLE__
             // Nothing to do - the GPUAccelerator will destroy the UMA buffer
 #else
-            scene_rdl2::util::alignedFree(mCPUThreadQueueEntries[i]);
+            scene_rdl2::util::alignedFree(mCPUThreadQueueEntries[slot]);
 #endif
         }
     }
 
     unsigned getMemoryUsed() const
     {
-        return (sizeof(BundledOcclRay) * mCPUThreadQueueSize * mNumCPUThreads) + sizeof(*this);
+        return (sizeof(BundledOcclRay) * mCPUThreadQueueSize * mNumCPUThreads * mNumBuffers) + sizeof(*this);
     }
 
     bool isValid() const
@@ -141,54 +178,48 @@ public:
 
         EXCL_ACCUMULATOR_PROFILE(tls, EXCL_ACCUM_QUEUE_LOGIC);
 
-        while (numEntries >= mCPUThreadQueueSize) {
-            // The number of rays that have been submitted exceeds or equals the
-            // CPU thread queue size.  Process them in batches of mCPUThreadQueueSize.
-            processRays(tls, mCPUThreadQueueSize, entries);
-            entries += mCPUThreadQueueSize;
-            numEntries -= mCPUThreadQueueSize;
-        }
-
         int threadIdx = tls->mThreadIdx;
 
-        MNRY_ASSERT(mCPUThreadQueueNumQueued[threadIdx] <= mCPUThreadQueueSize);
-        unsigned totalEntries = mCPUThreadQueueNumQueued[threadIdx] + numEntries;
+        // The entries are always copied into the thread's queue, even when there are
+        // more than a full queue of them: on Apple the GPU reads the rays straight from
+        // the queue's UMA buffers.
+        while (numEntries) {
+            MNRY_ASSERT(mCPUThreadQueueNumQueued[threadIdx] <= mCPUThreadQueueSize);
+            if (mCPUThreadQueueNumQueued[threadIdx] == mCPUThreadQueueSize) {
+                // The queue is full, flush it to free up space.
+                processQueuedRays(tls);
+            }
 
-        // Is there enough room in the CPU thread queue for the new entries?
-        if (totalEntries <= mCPUThreadQueueSize) {
-            // Copy entries into CPU thread's queue as there is room for them in that queue.
-            memcpy(mCPUThreadQueueEntries[threadIdx] + mCPUThreadQueueNumQueued[threadIdx],
+            const unsigned numQueued = mCPUThreadQueueNumQueued[threadIdx];
+            const unsigned numToCopy = std::min(numEntries, mCPUThreadQueueSize - numQueued);
+            memcpy(getFillBuffer(threadIdx) + numQueued,
                    entries,
-                   numEntries * sizeof(BundledOcclRay));
-            mCPUThreadQueueNumQueued[threadIdx] = totalEntries;
-            return;
-        }
+                   numToCopy * sizeof(BundledOcclRay));
+            mCPUThreadQueueNumQueued[threadIdx] = numQueued + numToCopy;
 
-        // Else there isn't enough room in the CPU thread's queue for all of the new
-        // entries.  We need to flush the queue to free up space.
-        processRays(tls, mCPUThreadQueueNumQueued[threadIdx], mCPUThreadQueueEntries[threadIdx]);
-        mCPUThreadQueueNumQueued[threadIdx] = 0;
-
-        // Now that the queue is empty, we can add the new entries.
-        memcpy(mCPUThreadQueueEntries[threadIdx],
-               entries,
-               numEntries * sizeof(BundledOcclRay));
-        mCPUThreadQueueNumQueued[threadIdx] = numEntries;
-
-        MNRY_ASSERT(mCPUThreadQueueNumQueued[threadIdx] <= mCPUThreadQueueSize);
+            entries += numToCopy;
+            numEntries -= numToCopy;
+        }
     }
 
-    // Explicit flush of the CPU queues per thread.
+    // Explicit flush of the CPU queues per thread.  Also waits on the batches the
+    // GPU is still tracing.
     unsigned flush(mcrt_common::ThreadLocalState *tls, scene_rdl2::alloc::Arena *arena)
     {
         EXCL_ACCUMULATOR_PROFILE(tls, EXCL_ACCUM_QUEUE_LOGIC);
 
         int threadIdx = tls->mThreadIdx;
 
-        int numFlushed = mCPUThreadQueueNumQueued[threadIdx];
+        unsigned numFlushed = mCPUThreadQueueNumQueued[threadIdx];
+        for (unsigned b = 0; b < mNumBuffers; b++) {
+            numFlushed += mCPUThreadQueueNumInFlight[threadIdx * mNumBuffers + b];
+        }
+
         if (mCPUThreadQueueNumQueued[threadIdx]) {
-            processRays(tls, mCPUThreadQueueNumQueued[threadIdx], mCPUThreadQueueEntries[threadIdx]);
-            mCPUThreadQueueNumQueued[threadIdx] = 0;
+            processQueuedRays(tls);
+        }
+        for (unsigned b = 0; b < mNumBuffers; b++) {
+            completeRays(tls, b);
         }
 
         return numFlushed;
@@ -196,56 +227,45 @@ public:
 
 protected:
 
-    void processRays(mcrt_common::ThreadLocalState *tls,
-                     unsigned numRays,
-                     BundledOcclRay *rays)
+    BundledOcclRay* getFillBuffer(int threadIdx) const
+    {
+        return mCPUThreadQueueEntries[threadIdx * mNumBuffers + mCPUThreadQueueFillBuffer[threadIdx]];
+    }
+
+    // Processes the rays queued in the thread's fill buffer, which is empty afterwards.
+    void processQueuedRays(mcrt_common::ThreadLocalState *tls)
     {
         EXCL_ACCUMULATOR_PROFILE(tls, EXCL_ACCUM_QUEUE_LOGIC);
 
-        MNRY_ASSERT(numRays);
+        int threadIdx = tls->mThreadIdx;
+        const unsigned bufferIdx = mCPUThreadQueueFillBuffer[threadIdx];
+        const unsigned numRays = mCPUThreadQueueNumQueued[threadIdx];
+        BundledOcclRay *rays = getFillBuffer(threadIdx);
 
-#ifdef __APPLE__
-        int maxThreads = 64;
-#else
-        // This is an imperfect heuristic, but the idea is that occlusion ray
-        // processing should be no more than 25% of the total work, so thus
-        // if more than 25% of the threads are idle waiting on the GPU, then the
-        // GPU is overloaded and we shouldn't give the GPU any more work.
-        int maxThreads = std::max(mNumCPUThreads / 4, (unsigned int)1);
-#endif
+        MNRY_ASSERT(numRays);
+        mCPUThreadQueueNumQueued[threadIdx] = 0;
 
-        if ((mNumThreadsUsingGPU.load() < maxThreads) && numRays > 1024) {
-            // There are an acceptable number of threads using the GPU, so we
-            // can go ahead.
+        if (shouldUseGPU(numRays)) {
+            // The GPU is expected to be done with these rays sooner than this
+            // thread, or there are an acceptable number of threads using it.
 
             pbr::TLState *pbrTls = tls->mPbrTls.get();
-            scene_rdl2::alloc::Arena *arena = &tls->mArena;
 
             const FrameState &fs = *pbrTls->mFs;
             rt::GPUAccelerator *accel = const_cast<rt::GPUAccelerator*>(fs.mGPUAccel);
 
-#ifdef __APPLE__
-            rt::GPURay* gpuRays = accel->getGPURaysBufUMA(pbrTls->mThreadIdx);
-
-            for (size_t i = 0; i < numRays; ++i) {
-                const BundledOcclRay &occlRay = rays[i];
-                MNRY_ASSERT(occlRay.isValid());
-                // Apple uses UMA so it gets most of the data for the GPURay directly from
-                // the queued BundledOcclRays that are in UMA memory.  Thus, the GPURay only
-                // has a few members that aren't present on the BundledOcclRay.
-                gpuRays[i].mShadowReceiverId = occlRay.mShadowReceiverId;
-                const scene_rdl2::rdl2::Light* light = static_cast<BundledOcclRayData *>(
-                    pbrTls->getListItem(occlRay.mDataPtrHandle, 0))->mLight->getRdlLight();
-                gpuRays[i].mLightId = reinterpret_cast<intptr_t>(light);
-            }
-#else
-            rt::GPURay* gpuRays = arena->allocArray<rt::GPURay>(numRays, CACHE_LINE_SIZE);
+            // The rays are written straight into the accelerator's input buffer for this
+            // queue, which the GPU reads from directly (UMA or pinned memory.)
+            rt::GPURay* gpuRays = accel->getGPURaysBufUMA(threadIdx, bufferIdx);
+            MNRY_ASSERT(numRays <= rt::GPUAccelerator::getRaysBufSize());
 
             for (size_t i = 0; i < numRays; ++i) {
                 const BundledOcclRay &occlRay = rays[i];
                 MNRY_ASSERT(occlRay.isValid());
+#ifndef __APPLE__
                 // Optix doesn't access these values from the cpu ray directly, so we copy the
-                // values here into a GPU-accessible buffer
+                // values here into a GPU-accessible buffer.  Apple reads them straight from
+                // the queued BundledOcclRays, which are in UMA memory.
                 gpuRays[i].mOriginX = occlRay.mOrigin.x;
                 gpuRays[i].mOriginY = occlRay.mOrigin.y;
                 gpuRays[i].mOriginZ = occlRay.mOrigin.z;
@@ -255,21 +275,27 @@ protected:
                 gpuRays[i].mMinT = occlRay.mMinT;
                 gpuRays[i].mMaxT = occlRay.mMaxT;
                 gpuRays[i].mTime = occlRay.mTime;
+#endif
                 gpuRays[i].mShadowReceiverId = occlRay.mShadowReceiverId;
                 const scene_rdl2::rdl2::Light* light = static_cast<BundledOcclRayData *>(
                     pbrTls->getListItem(occlRay.mDataPtrHandle, 0))->mLight->getRdlLight();
                 gpuRays[i].mLightId = reinterpret_cast<intptr_t>(light);
             }
-#endif
 
-            ++tls->mHandlerStackDepth;
-            (*mGPUQueueHandler)(tls,
-                                numRays,
-                                rays,
-                                gpuRays,
-                                mNumThreadsUsingGPU);
-            MNRY_ASSERT(tls->mHandlerStackDepth > 0);
-            --tls->mHandlerStackDepth;
+            // Submit the rays, the GPU handler decrements the count once it has
+            // waited on them.
+            const size_t slot = threadIdx * mNumBuffers + bufferIdx;
+            mNumThreadsUsingGPU++;
+            mCPUThreadQueueRaysOnGPUAtSubmit[slot] = mNumRaysOnGPU.fetch_add(numRays) + numRays;
+            mCPUThreadQueueSubmitTime[slot] = std::chrono::steady_clock::now();
+            accel->occludedAsync(threadIdx, bufferIdx, numRays, gpuRays, rays, sizeof(BundledOcclRay));
+            mCPUThreadQueueNumInFlight[slot] = numRays;
+
+            // Queue up the next rays in the next buffer while the GPU traces these.
+            // That buffer's previous batch has to be completed first.
+            const unsigned nextBufferIdx = (bufferIdx + 1) % mNumBuffers;
+            mCPUThreadQueueFillBuffer[threadIdx] = nextBufferIdx;
+            completeRays(tls, nextBufferIdx);
 
         } else {
             // There's too many threads using the GPU, and we would need to wait
@@ -280,20 +306,105 @@ protected:
             SCOPED_MEM(arena);
             BundledOcclRay** entries = arena->allocArray<BundledOcclRay*>(numRays, CACHE_LINE_SIZE);
             for (int i = 0; i < numRays; i++) {
-                entries[i] = const_cast<BundledOcclRay*>(rays + i);
+                entries[i] = rays + i;
             }
 
+            const auto start = std::chrono::steady_clock::now();
             ++tls->mHandlerStackDepth;
             (*mCPUThreadQueueHandler)(tls, numRays, entries, mHandlerData);
             MNRY_ASSERT(tls->mHandlerStackDepth > 0);
             --tls->mHandlerStackDepth;
+            const std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+            updateSecondsPerRay(mCPUSecondsPerRay, elapsed.count() / numRays);
+        }
+    }
+
+    // Whether a batch of rays should go to the GPU rather than be traced by
+    // the calling thread.
+    bool shouldUseGPU(unsigned numRays) const
+    {
+        // Small batches aren't worth the GPU overhead
+        if (numRays <= 1024) {
+            return false;
+        }
+
+        const float cpuSecondsPerRay = mCPUSecondsPerRay.load(std::memory_order_relaxed);
+        const float gpuSecondsPerRay = mGPUSecondsPerRay.load(std::memory_order_relaxed);
+        if (cpuSecondsPerRay > 0.0f && gpuSecondsPerRay > 0.0f) {
+            const int64_t numRaysOnGPU = mNumRaysOnGPU.load(std::memory_order_relaxed);
+            if (numRaysOnGPU == 0) {
+                return true;
+            }
+            return (numRaysOnGPU + numRays) * gpuSecondsPerRay <= numRays * cpuSecondsPerRay;
+        }
+
+        // Until both devices have been measured
+#ifdef __APPLE__
+        int maxThreads = 64;
+#else
+        // This is an imperfect heuristic, but the idea is that occlusion ray
+        // processing should be no more than 25% of the total work, so thus
+        // if more than 25% of the threads are idle waiting on the GPU, then the
+        // GPU is overloaded and we shouldn't give the GPU any more work.
+        int maxThreads = std::max(mNumCPUThreads / 4, (unsigned int)1);
+#endif
+        return mNumThreadsUsingGPU.load() < maxThreads;
+    }
+
+    // Running average, the races between threads only lose a few samples.
+    static void updateSecondsPerRay(std::atomic<float>& average, float secondsPerRay)
+    {
+        const float current = average.load(std::memory_order_relaxed);
+        average.store(current > 0.0f ? current + 0.1f * (secondsPerRay - current) : secondsPerRay,
+                      std::memory_order_relaxed);
+    }
+
+    // Waits for the batch of rays the thread submitted from the buffer, if any, and
+    // hands the results to the GPU handler.
+    void completeRays(mcrt_common::ThreadLocalState *tls, unsigned bufferIdx)
+    {
+        const size_t slot = tls->mThreadIdx * mNumBuffers + bufferIdx;
+        const unsigned numRays = mCPUThreadQueueNumInFlight[slot];
+        if (!numRays) {
+            return;
+        }
+        mCPUThreadQueueNumInFlight[slot] = 0;
+
+        // Wait on the batch here, before the handler does, to measure the GPU
+        // time per ray. The GPU time is shared by all the rays which were on
+        // the GPU with this batch.
+        {
+            pbr::TLState *pbrTls = tls->mPbrTls.get();
+            EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_GPU_OCCLUSION);
+            pbrTls->mFs->mGPUAccel->waitOccluded(tls->mThreadIdx, bufferIdx);
         }
+        const std::chrono::duration<float> latency =
+            std::chrono::steady_clock::now() - mCPUThreadQueueSubmitTime[slot];
+        updateSecondsPerRay(mGPUSecondsPerRay, latency.count() / mCPUThreadQueueRaysOnGPUAtSubmit[slot]);
+        mNumRaysOnGPU -= numRays;
+
+        ++tls->mHandlerStackDepth;
+        (*mGPUQueueHandler)(tls,
+                            numRays,
+                            mCPUThreadQueueEntries[slot],
+                            bufferIdx,
+                            mNumThreadsUsingGPU);
+        MNRY_ASSERT(tls->mHandlerStackDepth > 0);
+        --tls->mHandlerStackDepth;
     }
 
     unsigned                     mNumCPUThreads;
     unsigned                     mCPUThreadQueueSize;
-    std::vector<BundledOcclRay*> mCPUThreadQueueEntries;
-    std::vector<unsigned>        mCPUThreadQueueNumQueued;
+    unsigned                     mNumBuffers;                 // per thread, see rt::GPUAccelerator::getNumQueueBuffers()
+    std::vector<BundledOcclRay*> mCPUThreadQueueEntries;      // [thread * mNumBuffers + buffer]
+    std::vector<unsigned>        mCPUThreadQueueNumInFlight;  // [thread * mNumBuffers + buffer], submitted to the GPU
+    std::vector<unsigned>        mCPUThreadQueueNumQueued;    // in the thread's fill buffer
+    std::vector<unsigned>        mCPUThreadQueueFillBuffer;
+    std::vector<std::chrono::steady_clock::time_point> mCPUThreadQueueSubmitTime; // [thread * mNumBuffers + buffer]
+    std::vector<int64_t>         mCPUThreadQueueRaysOnGPUAtSubmit; // [thread * mNumBuffers + buffer], including the batch
+    std::atomic<int64_t>         mNumRaysOnGPU;               // submitted and not waited on yet
+    std::atomic<float>           mCPUSecondsPerRay;           // 0 until measured
+    std::atomic<float>           mGPUSecondsPerRay;           // 0 until measured
     CPUHandler                   mCPUThreadQueueHandler;
     std::atomic<int>             mNumThreadsUsingGPU;
     GPUHandler                   mGPUQueueHandler;
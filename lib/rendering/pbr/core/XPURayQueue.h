@@ -6,6 +6,7 @@
 #include <moonray/rendering/mcrt_common/Bundle.h>
 #include <moonray/rendering/pbr/core/PbrTLState.h>
 #include <moonray/rendering/rt/gpu/GPURay.h>
+#include <moonray/rendering/rt/gpu/GPUAccelerator.h>
 
 // warning #1684: conversion from pointer to
 // same-sized integral type (potential portability problem)
@@ -183,12 +184,14 @@ protected:
             // can go ahead.
 
             pbr::TLState *pbrTls = tls->mPbrTls.get();
-            scene_rdl2::alloc::Arena *arena = &tls->mArena;
 
             const FrameState &fs = *pbrTls->mFs;
             rt::GPUAccelerator *accel = const_cast<rt::GPUAccelerator*>(fs.mGPUAccel);
 
-            rt::GPURay* gpuRays = arena->allocArray<rt::GPURay>(numRays, CACHE_LINE_SIZE);
+            // The rays are written straight into the accelerator's input buffer for this
+            // queue, which the GPU reads from directly (UMA or pinned memory.)
+            rt::GPURay* gpuRays = accel->getGPURaysBufUMA(pbrTls->mThreadIdx);
+            MNRY_ASSERT(numRays <= rt::GPUAccelerator::getRaysBufSize());
 
             for (size_t i = 0; i < numRays; ++i) {
                 RayState* rs = entries[i];
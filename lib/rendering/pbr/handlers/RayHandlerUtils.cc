@@ -7,6 +7,7 @@
 #include <moonray/rendering/pbr/core/Aov.h>
 #include <moonray/rendering/pbr/core/RayState.h>
 #include <moonray/rendering/pbr/core/PbrTLState.h>
+#include <moonray/rendering/pbr/integrator/PathGuide.h>
 
 
 namespace moonray {
@@ -103,6 +104,13 @@ fillBundledRadiance(pbr::TLState* pbrTls, BundledRadiance* dst, const BundledOcc
 
     scene_rdl2::math::Color radiance = occlRay.mRadiance;
 
+    // Train the path guide with the unoccluded radiance, at the vertex which
+    // spawned the bounce reaching this occlusion ray's origin. Occlusion rays
+    // cast from the first vertex only carry direct lighting.
+    const PathGuide &pathGuide = pbrTls->mFs->mIntegrator->getPathGuide();
+    if (pathGuide.isEnabled() && occlRay.mDepth > 1) {
+        pathGuide.recordRadiance(occlRay.mPathGuideOrigin, occlRay.mPathGuideDir, radiance);
+    }
 
     dst->mRadiance = RenderColor(radiance.r,
                                  radiance.g,
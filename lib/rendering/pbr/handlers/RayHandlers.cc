@@ -48,12 +48,22 @@ areSingleRaysOccluded(pbr::TLState *pbrTls, unsigned numEntries, BundledOcclRay
     const bool disableShadowing = !fs.mIntegrator->getEnableShadowing();
     unsigned numRadiancesFilled = 0;
 
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+
+    // Set up all the rays up front so they can be traced together in packets.
+    mcrt_common::Ray *rtRays = arena->allocArray<mcrt_common::Ray>(numEntries, CACHE_LINE_SIZE);
+    mcrt_common::Ray **rtRayPtrs = arena->allocArray<mcrt_common::Ray *>(numEntries);
+    bool *occluded = arena->allocArray<bool>(numEntries);
+
     for (unsigned i = 0; i < numEntries; ++i) {
-        BundledOcclRay &occlRay = *entries[i];
+        const BundledOcclRay &occlRay = *entries[i];
 
         MNRY_ASSERT(occlRay.isValid());
+        MNRY_ASSERT(occlRay.mOcclTestType == OcclTestType::STANDARD);
 
-        mcrt_common::Ray rtRay;
+        mcrt_common::Ray &rtRay = rtRays[i];
+        new (&rtRay) mcrt_common::Ray();
 
         rtRay.org[0]  = occlRay.mOrigin.x;
         rtRay.org[1]  = occlRay.mOrigin.y;
@@ -75,13 +85,17 @@ areSingleRaysOccluded(pbr::TLState *pbrTls, unsigned numEntries, BundledOcclRay
                                             // be sure of this because a scene with volumes will trigger a fallback
                                             // to scalar mode, so there won't be any vector-mode occlusion rays
                                             // generated by volumes.
+        rtRayPtrs[i] = &rtRay;
+    }
 
-        bool isOccluded;
-        {
-            MNRY_ASSERT(occlRay.mOcclTestType == OcclTestType::STANDARD);
-            EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_EMBREE_OCCLUSION);
-            isOccluded = accel->occluded(rtRay);
-        }
+    {
+        EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_EMBREE_OCCLUSION);
+        accel->occluded(numEntries, rtRayPtrs, occluded);
+    }
+
+    for (unsigned i = 0; i < numEntries; ++i) {
+        BundledOcclRay &occlRay = *entries[i];
+        const bool isOccluded = occluded[i];
 
         if (!isOccluded || disableShadowing) {
             // At this point, we know that the ray is not occluded, but we still need to
@@ -294,6 +308,80 @@ computePresenceShadowsQueriesBundled(pbr::TLState *pbrTls, unsigned int numEntri
 
 //-----------------------------------------------------------------------------
 
+namespace {
+
+// Spreads the low 9 bits of v out so that 2 zero bits sit between each of them.
+finline uint32_t
+spreadBits3(uint32_t v)
+{
+    v &= 0x1ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8))  & 0x0300f00f;
+    v = (v | (v << 4))  & 0x030c30c3;
+    v = (v | (v << 2))  & 0x09249249;
+    return v;
+}
+
+// Reorders the rays of a bundle by direction octant, then by the Morton code
+// of their origin within the bounds of the bundle, so that the rays embree
+// traces next to each other tend to visit the same BVH nodes. Only the order
+// of the ray pointers changes, the ray states keep their order.
+void
+sortRaysForCoherence(pbr::TLState *pbrTls, unsigned numEntries, mcrt_common::Ray **rays,
+                     scene_rdl2::alloc::Arena *arena)
+{
+    struct SortedRay
+    {
+        uint32_t mSortKey;      // direction octant in bits 27-29, origin Morton code below
+        mcrt_common::Ray *mRay;
+    };
+
+    scene_rdl2::math::Vec3f lower(rays[0]->org);
+    scene_rdl2::math::Vec3f upper(rays[0]->org);
+    for (unsigned i = 1; i < numEntries; ++i) {
+        lower = min(lower, rays[i]->org);
+        upper = max(upper, rays[i]->org);
+    }
+    const scene_rdl2::math::Vec3f extent = upper - lower;
+    const scene_rdl2::math::Vec3f scale(extent.x > 0.f ? 511.f / extent.x : 0.f,
+                                        extent.y > 0.f ? 511.f / extent.y : 0.f,
+                                        extent.z > 0.f ? 511.f / extent.z : 0.f);
+
+    SortedRay *sortedRays = arena->allocArray<SortedRay>(numEntries, CACHE_LINE_SIZE);
+    uint32_t maxSortKey = 0;
+    for (unsigned i = 0; i < numEntries; ++i) {
+        const mcrt_common::Ray &ray = *rays[i];
+        const scene_rdl2::math::Vec3f p = (ray.org - lower) * scale;
+        const uint32_t octant = (ray.dir.x < 0.f ? 1u : 0u) |
+                                (ray.dir.y < 0.f ? 2u : 0u) |
+                                (ray.dir.z < 0.f ? 4u : 0u);
+        sortedRays[i].mSortKey = (octant << 27) |
+                                 (spreadBits3(uint32_t(p.z)) << 2) |
+                                 (spreadBits3(uint32_t(p.y)) << 1) |
+                                  spreadBits3(uint32_t(p.x));
+        sortedRays[i].mRay = rays[i];
+        maxSortKey = std::max(maxSortKey, sortedRays[i].mSortKey);
+    }
+
+    sortedRays = scene_rdl2::util::smartSort32<SortedRay, 0, RAY_HANDLER_STD_SORT_CUTOFF>(numEntries,
+                                                                                          sortedRays,
+                                                                                          maxSortKey, arena);
+
+    // A run is a span of consecutive rays sharing a direction octant, the
+    // longer the runs the more coherent the bundle.
+    unsigned numRuns = 1;
+    rays[0] = sortedRays[0].mRay;
+    for (unsigned i = 1; i < numEntries; ++i) {
+        rays[i] = sortedRays[i].mRay;
+        numRuns += (sortedRays[i].mSortKey >> 27) != (sortedRays[i - 1].mSortKey >> 27);
+    }
+
+    pbrTls->mStatistics.addToCounter(STATS_SORTED_INTERSECTION_RAYS, numEntries);
+    pbrTls->mStatistics.addToCounter(STATS_SORTED_INTERSECTION_RAY_RUNS, numRuns);
+}
+
+} // namespace
+
 void
 rayBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
                  RayState **rayStates, void *userData)
@@ -324,11 +412,17 @@ rayBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
         EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_EMBREE_INTERSECTION);
 
         const rt::EmbreeAccelerator *accel = fs.mEmbreeAccel;
+        mcrt_common::Ray **rays = arena->allocArray<mcrt_common::Ray *>(numEntries);
         for (unsigned i = 0; i < numEntries; ++i) {
             RayState *rs = rayStates[i];
             MNRY_ASSERT(isValid(rs));
-            accel->intersect(rs->mRay);
+            rays[i] = &rs->mRay;
+        }
+        if (handlerFlags & RAY_HANDLER_SORT_RAYS) {
+            sortRaysForCoherence(pbrTls, numEntries, rays, arena);
         }
+        // Trace the whole queue at once so Embree can use packet traversal.
+        accel->intersect(numEntries, rays);
     }
 
     // Volumes - compute volume radiance and transmission for each ray
@@ -22,7 +22,9 @@ class TLState;
 // the queue.
 enum RayHandlerFlags
 {
-    // Currently empty
+    // rayBundleHandler sorts the rays by direction octant and origin Morton
+    // code before tracing them.
+    RAY_HANDLER_SORT_RAYS = 1 << 0,
 };
 
 //
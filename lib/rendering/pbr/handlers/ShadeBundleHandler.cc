@@ -414,7 +414,8 @@ void shadeBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
                 isect->transferAndComputeDerivatives(tls, ray,
                     rs->mSubpixel.mTextureDiffScale);
 
-                sortedEntries[i].mSortKey = isect->computeShadingSortKey();
+                sortedEntries[i].mSortKey = isect->computeShadingSortKey(
+                    static_cast<shading::ShadingSortKey>(fs.mShadingSortKey), ray->getDirection());
 
                 sortedEntries[i].mLayerAssignmentId = isect->getLayerAssignmentId();
 
@@ -541,6 +542,11 @@ void shadeBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
 
         unsigned numBlocks = (workLoadSize + VLEN_MASK) / VLEN;
 
+        // Lanes past workLoadSize in the last block are smeared copies.
+        pbrTls->mStatistics.addToCounter(STATS_VEC_SHADE, workLoadSize);
+        pbrTls->mStatistics.addToCounter(STATS_VEC_SHADE_MAX, numBlocks * VLEN);
+        EXCL_ACCUMULATOR_ADD_LANES(pbrTls, EXCL_ACCUM_SHADING, workLoadSize, numBlocks * VLEN);
+
         // Resort ray state pointers based on sort results. This is necessary
         // so that we're updating the correct raystates objects after integration
         // is complete.
@@ -694,7 +700,7 @@ void shadeBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
                             // radiance, which we will add to the cryptomatte in the radiance handler
                             if (cryptomatteData->mCryptomatteBuffer != nullptr && rs->mPathVertex.pathPixelWeight > 0.01f) {
                                 scene_rdl2::math::Color4 beauty(0.f, 0.f, 0.f, presences[i]);
-                                cryptomatteData->mCryptomatteBuffer->addSampleVector(px, py, cryptomatteData->mId, 
+                                cryptomatteData->mCryptomatteBuffer->addSampleVector(pbrTls, px, py, cryptomatteData->mId, 
                                                                                     rs->mPathVertex.pathPixelWeight,
                                                                                     cryptomatteData->mPosition,
                                                                                     cryptomatteData->mNormal, 
@@ -740,7 +746,7 @@ void shadeBundleHandler(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
                         // we will add beauty data in the radiance handler
                         if (cryptomatteData->mCryptomatteBuffer != nullptr && rs->mPathVertex.pathPixelWeight > 0.01f) {
                             scene_rdl2::math::Color4 beauty(0.f, 0.f, 0.f, presences[i]);
-                            cryptomatteData->mCryptomatteBuffer->addSampleVector(px, py, cryptomatteData->mId, 
+                            cryptomatteData->mCryptomatteBuffer->addSampleVector(pbrTls, px, py, cryptomatteData->mId, 
                                                                                 rs->mPathVertex.pathPixelWeight,
                                                                                 cryptomatteData->mPosition,
                                                                                 cryptomatteData->mNormal, 
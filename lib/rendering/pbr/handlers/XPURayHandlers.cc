@@ -27,6 +27,10 @@
 
 #define RAY_HANDLER_STD_SORT_CUTOFF     200
 
+// Re-trace every GPU intersection ray with Embree and print any mismatch.
+// This is a development aid only, it doubles the CPU side cost of each batch.
+#define XPU_VALIDATE_GPU_INTERSECTIONS  0
+
 namespace moonray {
 namespace pbr {
 
@@ -41,7 +45,7 @@ unsigned
 computeXPUOcclusionQueriesOnGPU(mcrt_common::ThreadLocalState *tls,
                                 unsigned numRays,
                                 BundledOcclRay* rays,
-                                const rt::GPURay* gpuRays,
+                                unsigned bufferIdx,
                                 BundledRadiance *results,
                                 std::atomic<int>& threadsUsingGPU)
 {
@@ -57,16 +61,69 @@ computeXPUOcclusionQueriesOnGPU(mcrt_common::ThreadLocalState *tls,
     rt::GPUAccelerator *accel = const_cast<rt::GPUAccelerator*>(fs.mGPUAccel);
     const bool disableShadowing = !fs.mIntegrator->getEnableShadowing();
 
-    threadsUsingGPU++;
     {
         EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_GPU_OCCLUSION);
 
-        // Call the GPU and wait for it to finish processing these rays.
-        accel->occluded(tls->mThreadIdx, numRays, gpuRays, rays, sizeof(rays[0]));
+        // Wait for the GPU to finish processing these rays, the queue submitted
+        // them with occludedAsync().
+        accel->waitOccluded(tls->mThreadIdx, bufferIdx);
     }
     threadsUsingGPU--;
 
-    unsigned char *isOccluded = accel->getOutputOcclusionBuf(tls->mThreadIdx);
+    unsigned char *isOccluded = accel->getOutputOcclusionBuf(tls->mThreadIdx, bufferIdx);
+
+    // Rays which crossed geometry that didn't fit on the GPU come back as 2,
+    // trace them again with Embree.
+    {
+        SCOPED_MEM(arena);
+
+        unsigned numCPURays = 0;
+        unsigned *cpuRayIndices = arena->allocArray<unsigned>(numRays);
+        for (unsigned i = 0; i < numRays; ++i) {
+            if (isOccluded[i] == 2 && rays[i].mOcclTestType == OcclTestType::STANDARD) {
+                cpuRayIndices[numCPURays++] = i;
+            }
+        }
+
+        if (numCPURays) {
+            mcrt_common::Ray *rtRays = arena->allocArray<mcrt_common::Ray>(numCPURays, CACHE_LINE_SIZE);
+            mcrt_common::Ray **rtRayPtrs = arena->allocArray<mcrt_common::Ray *>(numCPURays);
+            bool *occluded = arena->allocArray<bool>(numCPURays);
+
+            for (unsigned i = 0; i < numCPURays; ++i) {
+                const BundledOcclRay &occlRay = rays[cpuRayIndices[i]];
+
+                mcrt_common::Ray &rtRay = rtRays[i];
+                new (&rtRay) mcrt_common::Ray();
+
+                rtRay.org[0]  = occlRay.mOrigin.x;
+                rtRay.org[1]  = occlRay.mOrigin.y;
+                rtRay.org[2]  = occlRay.mOrigin.z;
+                rtRay.dir[0]  = occlRay.mDir.x;
+                rtRay.dir[1]  = occlRay.mDir.y;
+                rtRay.dir[2]  = occlRay.mDir.z;
+                rtRay.tnear   = occlRay.mMinT;
+                rtRay.tfar    = occlRay.mMaxT;
+                rtRay.time    = occlRay.mTime;
+                rtRay.mask    = scene_rdl2::rdl2::SHADOW;
+                rtRay.geomID  = RT_INVALID_RAY_ID;
+                rtRay.ext.instance0OrLight = static_cast<BundledOcclRayData *>(
+                    pbrTls->getListItem(occlRay.mDataPtrHandle, 0))->mLight->getRdlLight();
+                rtRay.ext.shadowReceiverId = occlRay.mShadowReceiverId;
+                rtRay.ext.volumeInstanceState = 0;  // surface ray, see areSingleRaysOccluded()
+                rtRayPtrs[i] = &rtRay;
+            }
+
+            {
+                EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_EMBREE_OCCLUSION);
+                fs.mEmbreeAccel->occluded(numCPURays, rtRayPtrs, occluded);
+            }
+
+            for (unsigned i = 0; i < numCPURays; ++i) {
+                isOccluded[cpuRayIndices[i]] = occluded[i] ? 1 : 0;
+            }
+        }
+    }
 
 /*
     {
@@ -236,7 +293,9 @@ xpuRayBundleHandler(mcrt_common::ThreadLocalState *tls,
 
         for (unsigned i = 0; i < numEntries; ++i) {
             RayState *rs = rayStates[i];
+#if XPU_VALIDATE_GPU_INTERSECTIONS
             RayState rsCPU = *rs; // copy for validation below
+#endif
 
             MNRY_ASSERT(isValid(rs));
             rs->mRay.tfar = isects[i].mTFar;
@@ -250,8 +309,9 @@ xpuRayBundleHandler(mcrt_common::ThreadLocalState *tls,
             rs->mRay.instID = -1;
             rs->mRay.ext.userData = reinterpret_cast<void*>(isects[i].mEmbreeUserData);
 
+#if XPU_VALIDATE_GPU_INTERSECTIONS
             // Validate the GPU intersection results against CPU Embree
-            if (true) {
+            {
                 const rt::EmbreeAccelerator *embreeAccel = fs.mEmbreeAccel;
                 embreeAccel->intersect(rsCPU.mRay);
 
@@ -294,6 +354,7 @@ xpuRayBundleHandler(mcrt_common::ThreadLocalState *tls,
                     }
                 }
             }
+#endif
         }
     }
 
@@ -691,7 +752,7 @@ void
 xpuOcclusionQueryBundleHandler(mcrt_common::ThreadLocalState *tls,
                                unsigned numRays,
                                BundledOcclRay *rays,
-                               const rt::GPURay *gpuRays,
+                               unsigned bufferIdx,
                                std::atomic<int>& threadsUsingGPU)
 {
     pbr::TLState *pbrTls = tls->mPbrTls.get();
@@ -707,7 +768,7 @@ xpuOcclusionQueryBundleHandler(mcrt_common::ThreadLocalState *tls,
         computeXPUOcclusionQueriesOnGPU(tls,
                                         numRays,
                                         rays,
-                                        gpuRays,
+                                        bufferIdx,
                                         results,
                                         threadsUsingGPU);
 
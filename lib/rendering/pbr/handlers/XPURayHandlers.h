@@ -17,11 +17,12 @@ void xpuRayBundleHandler(mcrt_common::ThreadLocalState *tls,
                          const rt::GPURay *gpuRays,
                          std::atomic<int>& threadsUsingGPU);
 
-// Unlocks the mutex when we're done with the GPU
+// Waits for the GPU to trace the rays submitted from the queue buffer and
+// decrements threadsUsingGPU when we're done with the GPU
 void xpuOcclusionQueryBundleHandler(mcrt_common::ThreadLocalState *tls,
                                     unsigned numRays,
                                     BundledOcclRay *rays,
-                                    const rt::GPURay *gpuRays,
+                                    unsigned bufferIdx,
                                     std::atomic<int>& threadsUsingGPU);
 
 } // namespace pbr
@@ -125,7 +125,7 @@ BsdfSampler::sample(pbr::TLState *pbrTls, int lobeIndex, const Vec3f &p, float r
     sample.sample = Vec2f(r1, r2);
 
     // Pdf computation needs to be kept in sync when integrating
-    // light samples (see integrateLightSetSample() in PathIntegratorUtil.cc).
+    // light samples (see integrateLightSetSamples() in PathIntegratorUtil.cc).
     // Skip path guiding on mirror lobes, because their
     // sample direction is already precisely determined.
     if (mPathGuide.canSample() && !(lobe->getType() & shading::BsdfLobe::MIRROR)) {
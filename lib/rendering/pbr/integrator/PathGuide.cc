@@ -5,25 +5,48 @@
 
 #include "PathGuide.h"
 
+#include <moonray/rendering/mcrt_common/Clock.h>
+#include <moonray/rendering/pbr/integrator/PathGuide_ispc_stubs.h>
+
 #include <scene_rdl2/render/util/AtomicFloat.h>
 #include <scene_rdl2/render/logging/logging.h>
 #include <scene_rdl2/common/math/BBox.h>
 #include <scene_rdl2/common/math/Constants.h>
 #include <scene_rdl2/common/math/Math.h>
 #include <scene_rdl2/common/math/Vec3.h>
+#include <scene_rdl2/common/platform/HybridUniformData.h>
 #include <scene_rdl2/scene/rdl2/SceneVariables.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <stack>
 #include <stdint.h>
 #include <vector>
 
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
 namespace moonray {
 namespace pbr {
 
 using namespace scene_rdl2::math;
 
+HUD_VALIDATOR(PathGuideSpatialNode);
+HUD_VALIDATOR(PathGuideDirNode);
+HUD_VALIDATOR(PathGuideSampleTree);
+
+// A radiance sample waiting to be merged into a directional tree.
+// Samples are buffered per thread while rendering and merged into the
+// build trees at pass reset, so render threads don't contend on the
+// atomic node means.
+struct RadianceRecord
+{
+    uint32_t mDirTreeIndex; // spatial tree node that owns the directional tree
+    Vec2f mPos;             // direction mapped to the unit square
+    float mLuminance;
+};
+
 //===--------------------------------------------------------------------------
 // SD-Tree based path guiding
 //   See "Practical Path Guiding for Efficient Light-Transport Simulation"
@@ -46,13 +69,22 @@ public:
 
     void setNumSamplesBuild(uint64_t numSamples);
     uint64_t getNumSamplesBuild() const;
-    void recordRadiance(const Vec3f &dir, const Color &radiance);
+
+    // Thread-safe, atomically adds the record into the build tree.
+    void recordBuffered(const RadianceRecord &record);
+
+    // Only called by the thread that owns this tree while merging, no
+    // other thread may record radiance into it at the same time.
+    void mergeRecord(const RadianceRecord &record);
 
     void reset(int maxDepth, float threshold);
     void build();
 
-    float getPdf(const Vec3f &dir) const;
-    Vec3f sampleDirection(float r1, float r2) const;
+    // Append the sample tree to the flattened dir node array and return the
+    // index of its root, or PATH_GUIDE_INVALID_DIR_NODE if the tree is empty.
+    // The sample tree itself is not needed anymore until the next build()
+    // and is released.
+    uint32_t flatten(std::vector<PathGuideDirNode> &dirNodes);
 
 private:
     struct Tree
@@ -64,7 +96,8 @@ private:
 
         void setNumSamples(uint64_t numSamples);
         uint64_t getNumSamples() const;
-        void recordRadiance(const Vec2f &pos, const Color &radiance);
+        void recordLuminance(const Vec2f &pos, float luminance);
+        void mergeLuminance(const Vec2f &pos, float luminance);
         
         struct Node
         {
@@ -217,12 +250,8 @@ DirTree::Tree::setNumSamples(uint64_t numSamples)
 }
 
 void
-DirTree::Tree::recordRadiance(const Vec2f &pos, const Color &radiance)
+DirTree::Tree::recordLuminance(const Vec2f &pos, float luminance)
 {
-    MNRY_ASSERT(scene_rdl2::math::isFinite(radiance));
-    if (!scene_rdl2::math::isFinite(radiance)) return;
-    
-    const float luminance = scene_rdl2::math::luminance(radiance);
     mNumSamples.fetch_add(1, std::memory_order_acq_rel);
     mSum.fetch_add(luminance, std::memory_order_acq_rel);
 
@@ -246,6 +275,25 @@ DirTree::Tree::recordRadiance(const Vec2f &pos, const Color &radiance)
     } while (index != 0);
 }
 
+void
+DirTree::Tree::mergeLuminance(const Vec2f &pos, float luminance)
+{
+    // Same as recordLuminance(), but the caller guarantees exclusive access
+    // to this tree so plain loads and stores replace the read-modify-writes.
+    mNumSamples.store(mNumSamples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mSum.store(mSum.load(std::memory_order_relaxed) + luminance, std::memory_order_relaxed);
+
+    uint64_t index = 0;
+    Vec2f curPos = pos;
+    do {
+        Node &node = mNodes[index];
+        uint32_t childIndex = getChildIndexAndRemap(curPos);
+        node.mMean[childIndex].store(node.mMean[childIndex].load(std::memory_order_relaxed) + luminance,
+                                     std::memory_order_relaxed);
+        index = node.mChildren[childIndex];
+    } while (index != 0);
+}
+
 
 DirTree::DirTree()
 {
@@ -268,10 +316,15 @@ DirTree::getNumSamplesBuild() const
 }
 
 void
-DirTree::recordRadiance(const Vec3f &dir, const Color &radiance)
+DirTree::recordBuffered(const RadianceRecord &record)
+{
+    mBuild.recordLuminance(record.mPos, record.mLuminance);
+}
+
+void
+DirTree::mergeRecord(const RadianceRecord &record)
 {
-    const Vec2f pos = dirToPos(dir);
-    mBuild.recordRadiance(pos, radiance);
+    mBuild.mergeLuminance(record.mPos, record.mLuminance);
 }
 
 void
@@ -372,16 +425,48 @@ DirTree::build()
     mSample = mBuild;
 }
 
-float
-DirTree::getPdf(const Vec3f &dir) const
+uint32_t
+DirTree::flatten(std::vector<PathGuideDirNode> &dirNodes)
 {
-    // Use the sample tree
-
-    // First check for an empty (or nearly empty) tree
-    // in which case, we'll just use spherical sampling
+    // Check for an empty (or nearly empty) tree, we'll just use spherical
+    // sampling for those
     const auto numSamples = mSample.mNumSamples.load(std::memory_order_acquire);
     const auto sum = mSample.mSum.load(std::memory_order_acquire);
-    if (numSamples == 0 || (sum / (scene_rdl2::math::sFourPi * numSamples)) == 0.0f) {
+    uint32_t root = PATH_GUIDE_INVALID_DIR_NODE;
+    if (numSamples != 0 && (sum / (scene_rdl2::math::sFourPi * numSamples)) != 0.0f) {
+        if (dirNodes.size() + mSample.mNodes.size() < PATH_GUIDE_INVALID_DIR_NODE) {
+            root = static_cast<uint32_t>(dirNodes.size());
+            for (const Tree::Node &node : mSample.mNodes) {
+                float mean[4];
+                float total = 0.f;
+                for (int i = 0; i < 4; ++i) {
+                    mean[i] = node.mMean[i].load(std::memory_order_acquire);
+                    total += mean[i];
+                }
+
+                // Store normalized quadrant energies so the samplers don't have
+                // to divide by the node total at every level.
+                PathGuideDirNode &flat = dirNodes.emplace_back();
+                for (int i = 0; i < 4; ++i) {
+                    flat.mProb[i] = (total > 0.f) ? mean[i] / total : 0.f;
+                    flat.mChildren[i] = node.mChildren[i] ? root + node.mChildren[i] : 0;
+                }
+            }
+        } else {
+            scene_rdl2::Logger::warn("PathGuide hit max flattened dir node count.");
+        }
+    }
+
+    mSample = Tree();
+
+    return root;
+}
+
+// Returns the pdf of direction dir in the flattened dir tree whose root is at index root.
+static float
+getDirTreePdf(const PathGuideDirNode *dirNodes, uint32_t root, const Vec3f &dir)
+{
+    if (root == PATH_GUIDE_INVALID_DIR_NODE) {
         return scene_rdl2::math::sOneOverFourPi;
     }
 
@@ -389,42 +474,40 @@ DirTree::getPdf(const Vec3f &dir) const
 
     // recurse into the nodes
     float pdf = scene_rdl2::math::sOneOverFourPi;
-    uint64_t index = 0; // start at the root
+    uint32_t index = root;
     do {
+        const PathGuideDirNode &node = dirNodes[index];
+
         // which quadrant?
         const uint32_t i = getChildIndexAndRemap(pos); // 0, 1, 2, or 3
-
-        if (mSample.mNodes[index].mMean[i].load(std::memory_order_acquire) <= 0.f) {
+        if (node.mProb[i] <= 0.f) {
             return 0; // invalid pdf
         }
 
-        float total = 0.f;
-        for (uint32_t j = 0; j < 4; ++j) {
-            total += mSample.mNodes[index].mMean[j].load(std::memory_order_acquire);
-        }
         // Why the 4.0f?
         // The domain is the unit square.  Broken into
         // four quadrants - each with area of 1/4.
-        // mean[0]/total + mean[1]/total + mean[2]/total + mean[3]/total = 1.
-        //        A               B               C               D
+        // prob[0] + prob[1] + prob[2] + prob[3] = 1.
+        //    A         B         C         D
         // Total integral value is A/4 + B/4 + C/4 + D/4 = (A + B + C + D)/4.
-        pdf *= (4.0f * mSample.mNodes[index].mMean[i].load(std::memory_order_acquire) / total);
+        pdf *= 4.0f * node.mProb[i];
 
-        index = mSample.mNodes[index].mChildren[i];
+        // children of a leaf quadrant are 0, the root is never a child
+        index = node.mChildren[i];
     } while (index != 0); // until we hit a leaf
 
     return pdf;
 }
 
 static inline bool
-checkForZero(float val, int index, const Vec2f &rpos, Vec2f &pos)
+checkForZero(float val, bool isRoot, const Vec2f &rpos, Vec2f &pos)
 {
     // It is possible that some denominators in sampleDirection can reach exactly zero, even though they should
     // theoretically be greater than 0.  In this case we need to break from the recursion. If this is our first time
-    // through in the recursion (index == 0), then we need to set the quad position to some reasonable default.  (we'll
+    // through in the recursion (isRoot), then we need to set the quad position to some reasonable default.  (we'll
     // just use some random position).  We return true if the recursion needs to be broken, false otherwise.
     if (val == 0.f) {
-        if (index == 0) {
+        if (isRoot) {
             pos = rpos;
         }
         return true;
@@ -433,44 +516,40 @@ checkForZero(float val, int index, const Vec2f &rpos, Vec2f &pos)
     return false;
 }
 
-Vec3f
-DirTree::sampleDirection(float r1, float r2) const
+// Samples a direction from the flattened dir tree whose root is at index root.
+static Vec3f
+sampleDirTree(const PathGuideDirNode *dirNodes, uint32_t root, float r1, float r2)
 {
-    // Use the sample tree
-
     // in some cases we may return just a random direction
     const Vec2f rpos(r1, r2);  // random quad position
 
-    // First check for an empty tree
-    // in which case, we'll just use spherical sampling
-    const auto numSamples = mSample.mNumSamples.load(std::memory_order_acquire);
-    const auto sum = mSample.mSum.load(std::memory_order_acquire);
-    if (numSamples == 0 || (sum / (scene_rdl2::math::sFourPi * numSamples)) == 0.0f) {
+    if (root == PATH_GUIDE_INVALID_DIR_NODE) {
         return posToDir(rpos);
     }
 
     // recurse into the sample nodes
-    // Pick quadtree children based on their mean value, compared
+    // Pick quadtree children based on their probability, compared
     // to the random sample values.
-    uint64_t index = 0; // start at the root
+    uint32_t index = root;
     Vec2f pos = Vec2f(0.f, 0.f);
     Vec2f sample = rpos;
     float scale = 1.0f; // halved with each recursion
     do {
-        const Tree::Node &node = mSample.mNodes[index];
+        const PathGuideDirNode &node = dirNodes[index];
+        const bool isRoot = (index == root);
 
         // compute a quadrant, as well as a location in
         // the quadrant
         int quadrant = 0;               // quadrant in node 0, 1, 2, or 3
         Vec2f quadrantOrigin(0.f, 0.f); // [0 or .5, 0 or .5]
 
-        const float topLeft  = node.mMean[0].load(std::memory_order_acquire);
-        const float topRight = node.mMean[1].load(std::memory_order_acquire);
-        const float botLeft  = node.mMean[2].load(std::memory_order_acquire);
-        const float botRight = node.mMean[3].load(std::memory_order_acquire);
+        const float topLeft  = node.mProb[0];
+        const float topRight = node.mProb[1];
+        const float botLeft  = node.mProb[2];
+        const float botRight = node.mProb[3];
         const float total = topLeft + topRight + botLeft + botRight;
 
-        if (checkForZero(total, index, rpos, pos)) break;
+        if (checkForZero(total, isRoot, rpos, pos)) break;
 
         // first the x-axis, re-normalizing sample
         // as needed
@@ -478,27 +557,27 @@ DirTree::sampleDirection(float r1, float r2) const
         float boundary = partial / total;
 
         if (sample.x < boundary) {
-            if (checkForZero(boundary, index, rpos, pos)) break;
+            if (checkForZero(boundary, isRoot, rpos, pos)) break;
             sample.x /= boundary;
-            if (checkForZero(partial, index, rpos, pos)) break;
+            if (checkForZero(partial, isRoot, rpos, pos)) break;
             boundary = topLeft / partial;
         } else {
             partial = total - partial;
             quadrantOrigin.x = 0.5f;
-            if (checkForZero(1.0f - boundary, index, rpos, pos)) break;
+            if (checkForZero(1.0f - boundary, isRoot, rpos, pos)) break;
             sample.x = (sample.x - boundary) / (1.0f - boundary);
-            if (checkForZero(partial, index, rpos, pos)) break;
+            if (checkForZero(partial, isRoot, rpos, pos)) break;
             boundary = topRight / partial;
             quadrant |= 1;
         }
 
         // now split the y axis
         if (sample.y < boundary) {
-            if (checkForZero(boundary, index, rpos, pos)) break;
+            if (checkForZero(boundary, isRoot, rpos, pos)) break;
             sample.y /= boundary;
         } else {
             quadrantOrigin.y = 0.5f;
-            if (checkForZero(1.0f - boundary, index, rpos, pos)) break;
+            if (checkForZero(1.0f - boundary, isRoot, rpos, pos)) break;
             sample.y = (sample.y - boundary) / (1.0f - boundary);
             quadrant |= 2;
         }
@@ -511,13 +590,35 @@ DirTree::sampleDirection(float r1, float r2) const
             pos += scale * quadrantOrigin;
             scale *= 0.5f;
         }
-        
+
         index = node.mChildren[quadrant];
     } while (index != 0); // until we hit a leaf
 
     return posToDir(pos);
 }
 
+// Returns the root of the flattened dir tree of the spatial leaf containing p.
+static uint32_t
+getDirTreeRoot(const PathGuideSampleTree &tree, const Vec3f &p)
+{
+    // normalize all position look ups to maximize precision
+    Vec3f np = (p - tree.mBboxLower) * tree.mInvBboxSize;
+
+    const PathGuideSpatialNode *node = &tree.mSpatialNodes[0]; // start at root
+    while (node->mAxis >= 0) {
+        float &x = np[node->mAxis];
+        if (x < 0.5f) {
+            x *= 2.f;
+            node = &tree.mSpatialNodes[node->mChildren[0]];
+        } else {
+            x = 2.0f * (x - 0.5f);
+            node = &tree.mSpatialNodes[node->mChildren[1]];
+        }
+    }
+
+    return node->mChildren[0];
+}
+
 class SpatialTree
 {
 public:
@@ -530,7 +631,18 @@ public:
 
     void resetDirTrees(int maxDepth, float threshold);
     void buildDirTrees();
-    DirTree *getDirTree(const Vec3f &p);
+
+    // Flatten the sample trees, spatial nodes keep their index.  This
+    // releases the sample trees of the dir trees, so it must be called
+    // after resetDirTrees().
+    void flatten(std::vector<PathGuideSpatialNode> &spatialNodes, std::vector<PathGuideDirNode> &dirNodes);
+    const scene_rdl2::math::BBox3f &getBbox() const { return mBbox; }
+
+    // Index based access used to buffer and merge radiance records.
+    // Indices are stable until the next refine().
+    uint32_t getDirTreeIndex(const Vec3f &p) const;
+    DirTree *getDirTreeAtIndex(uint32_t index);
+    size_t getNodeCount() const { return mNodes.size(); }
 
 private:
     struct Node
@@ -642,8 +754,35 @@ SpatialTree::buildDirTrees()
     }
 }
 
+void
+SpatialTree::flatten(std::vector<PathGuideSpatialNode> &spatialNodes, std::vector<PathGuideDirNode> &dirNodes)
+{
+    spatialNodes.resize(mNodes.size());
+    dirNodes.clear();
+    for (size_t i = 0; i < mNodes.size(); ++i) {
+        Node &node = mNodes[i];
+        PathGuideSpatialNode &flat = spatialNodes[i];
+        if (node.mIsLeaf) {
+            flat.mAxis = -1;
+            flat.mChildren[0] = node.mDirTree.flatten(dirNodes);
+            flat.mChildren[1] = 0;
+        } else {
+            flat.mAxis = node.mAxis;
+            flat.mChildren[0] = node.mChildren[0];
+            flat.mChildren[1] = node.mChildren[1];
+        }
+    }
+}
+
 DirTree *
-SpatialTree::getDirTree(const Vec3f &p)
+SpatialTree::getDirTreeAtIndex(uint32_t index)
+{
+    MNRY_ASSERT(index < mNodes.size() && mNodes[index].mIsLeaf);
+    return &mNodes[index].mDirTree;
+}
+
+uint32_t
+SpatialTree::getDirTreeIndex(const Vec3f &p) const
 {
     // normalize all position look ups to maximize precision
     Vec3f np = (p - mBbox.lower) / mBbox.size();
@@ -664,7 +803,7 @@ SpatialTree::getDirTree(const Vec3f &p)
     }
 
     MNRY_ASSERT(index < mNodes.size());
-    return &mNodes[index].mDirTree;
+    return static_cast<uint32_t>(index);
 }
 
 //===--------------------------------------------------------------------------
@@ -679,7 +818,7 @@ public:
     Impl &operator=(const Impl &) = delete;
     ~Impl() = default;
 
-    void startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars);
+    void startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars, bool keep);
     void passReset();
     void recordRadiance(const Vec3f &p, const Vec3f &dir, const Color &radiance) const;
     float getPdf(const Vec3f &p, const Vec3f &dir) const;
@@ -687,8 +826,17 @@ public:
     bool isEnabled() const;
     bool canSample() const;
     float getPercentage() const;
+    uint64_t getNumSamplesRecorded() const;
+    double getMergeTime() const;
+    const PathGuideSampleTree &getSampleTree() const { return mSampleTree; }
 
 private:
+    typedef std::vector<RadianceRecord> RecordBuffer;
+
+    void flushRecordBuffer(RecordBuffer &buffer) const;
+    void mergeRecordBuffers();
+    void updateSampleTree();
+
     bool mEnable;
     float mPercentage;
     mutable std::unique_ptr<SpatialTree> mSpatialTree;
@@ -697,9 +845,23 @@ private:
     float mDirTreeThreshold;
     int mMinResetIterations;
     unsigned int mResetIterations;
-    
+
+    // Per thread radiance records, merged into the dir trees at pass reset
+    mutable tbb::enumerable_thread_specific<RecordBuffer, tbb::cache_aligned_allocator<RecordBuffer>,
+                                            tbb::ets_key_per_instance> mRecordBuffers;
+    mutable std::atomic<uint64_t> mNumSamplesRecorded;
+    int64_t mMergeTime; // nanoseconds spent merging records, per frame
+
+    // Flattened sample trees, see PathGuide.hh
+    std::vector<PathGuideSpatialNode> mSpatialNodes;
+    std::vector<PathGuideDirNode> mDirNodes;
+    PathGuideSampleTree mSampleTree;
 };
 
+// A thread that fills its buffer merges it right away, which bounds the
+// memory used by the buffers (about 1.5 MB per thread).
+static constexpr size_t sRecordBufferCapacity = 1 << 16;
+
 PathGuide::Impl::Impl():
     mEnable(false),
     mPercentage(0.0f),
@@ -708,16 +870,38 @@ PathGuide::Impl::Impl():
     mDirTreeMaxDepth(0),
     mDirTreeThreshold(0.f),
     mMinResetIterations(0),
-    mResetIterations(0)
+    mResetIterations(0),
+    mNumSamplesRecorded(0),
+    mMergeTime(0)
 {
+    updateSampleTree();
 }
 
 void
-PathGuide::Impl::startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars)
+PathGuide::Impl::startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars, bool keep)
 {
+    if (keep && mEnable && mSpatialTree && vars.get(scene_rdl2::rdl2::SceneVariables::sPathGuideEnable) &&
+        mSpatialTree->getBbox().lower == bbox.lower && mSpatialTree->getBbox().upper == bbox.upper) {
+        // Same scene seen from another view: merge the radiance recorded by the
+        // last pass of the previous frame as a pass reset would, and start
+        // guiding from the first pass.
+        mNumSamplesRecorded.store(0, std::memory_order_relaxed);
+        mMergeTime = 0;
+        passReset();
+        return;
+    }
+
     mSpatialTree.reset();
+    for (RecordBuffer &buffer : mRecordBuffers) {
+        buffer.clear();
+    }
+    mNumSamplesRecorded.store(0, std::memory_order_relaxed);
+    mMergeTime = 0;
     mEnable = vars.get(scene_rdl2::rdl2::SceneVariables::sPathGuideEnable);
-    if (!mEnable) return;
+    if (!mEnable) {
+        updateSampleTree();
+        return;
+    }
 
     // these could become user settings via rdl scene variables
     // so far, these defaults seem to work reasonably well
@@ -732,6 +916,7 @@ PathGuide::Impl::startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVar
     mSpatialTree.reset(new SpatialTree(bbox));
     mSpatialTree->refine(mSpatialTreeThreshold);
     mSpatialTree->resetDirTrees(mDirTreeMaxDepth, mDirTreeThreshold);
+    updateSampleTree();
 }
 
 void
@@ -744,11 +929,13 @@ PathGuide::Impl::passReset()
     // It is the responsibility of the render driver to ensure that
     // this thread safety requirement is met.
     //
-    // This method is single threaded.  If it becomes a slow bottleneck
-    // we can investigate ways to parallelize it - probably by parallelizing
-    // the resetDirTrees method.
+    // The radiance buffered by the render threads is merged in parallel,
+    // the rest of the method is single threaded.  If it becomes a slow
+    // bottleneck we can investigate ways to parallelize it - probably by
+    // parallelizing the resetDirTrees method.
 
     MNRY_ASSERT(mEnable);
+    mergeRecordBuffers();
     mSpatialTree->buildDirTrees();
     ++mResetIterations;
     // Split a spatial tree node when the number of samples in the node's dirtree
@@ -757,6 +944,29 @@ PathGuide::Impl::passReset()
     // pass has roughly twice as many samples as the previous.
     mSpatialTree->refine(std::pow(2, mResetIterations / 2.0f) * mSpatialTreeThreshold);
     mSpatialTree->resetDirTrees(mDirTreeMaxDepth, mDirTreeThreshold);
+    updateSampleTree();
+}
+
+void
+PathGuide::Impl::updateSampleTree()
+{
+    if (mEnable) {
+        mSpatialTree->flatten(mSpatialNodes, mDirNodes);
+        const BBox3f &bbox = mSpatialTree->getBbox();
+        mSampleTree.mBboxLower = bbox.lower;
+        mSampleTree.mInvBboxSize = Vec3f(1.0f) / bbox.size();
+    } else {
+        mSpatialNodes.clear();
+        mDirNodes.clear();
+        mSampleTree.mBboxLower = Vec3f(0.f);
+        mSampleTree.mInvBboxSize = Vec3f(0.f);
+    }
+
+    mSampleTree.mSpatialNodes = mSpatialNodes.data();
+    mSampleTree.mDirNodes = mDirNodes.data();
+    mSampleTree.mPercentage = mPercentage;
+    mSampleTree.mEnable = mEnable;
+    mSampleTree.mCanSample = canSample();
 }
 
 void
@@ -764,28 +974,92 @@ PathGuide::Impl::recordRadiance(const Vec3f &p, const Vec3f &dir, const Color &r
 {
     if (!mEnable) return;
 
-    DirTree *dirTree = mSpatialTree->getDirTree(p);
-    MNRY_ASSERT(dirTree != nullptr);
-    dirTree->recordRadiance(dir, radiance);
+    MNRY_ASSERT(scene_rdl2::math::isFinite(radiance));
+    if (!scene_rdl2::math::isFinite(radiance)) return;
+
+    RecordBuffer &buffer = mRecordBuffers.local();
+    if (buffer.capacity() == 0) {
+        buffer.reserve(sRecordBufferCapacity);
+    }
+    buffer.push_back({ mSpatialTree->getDirTreeIndex(p), dirToPos(dir),
+                       scene_rdl2::math::luminance(radiance) });
+    if (buffer.size() == sRecordBufferCapacity) {
+        flushRecordBuffer(buffer);
+    }
+}
+
+void
+PathGuide::Impl::flushRecordBuffer(RecordBuffer &buffer) const
+{
+    // Called by a render thread, other threads may be recording into the same
+    // trees so this goes through the atomic update path.
+    for (const RadianceRecord &record : buffer) {
+        mSpatialTree->getDirTreeAtIndex(record.mDirTreeIndex)->recordBuffered(record);
+    }
+    mNumSamplesRecorded.fetch_add(buffer.size(), std::memory_order_relaxed);
+    buffer.clear();
+}
+
+void
+PathGuide::Impl::mergeRecordBuffers()
+{
+    mcrt_common::Clock clock(&mMergeTime, true, CLOCK_MONOTONIC);
+
+    std::vector<RecordBuffer *> buffers;
+    for (RecordBuffer &buffer : mRecordBuffers) {
+        if (!buffer.empty()) {
+            buffers.push_back(&buffer);
+        }
+    }
+    if (buffers.empty()) {
+        return;
+    }
+
+    // sort every buffer by dir tree so each dir tree can be merged by a
+    // single task without any atomic read-modify-write
+    auto byDirTree = [](const RadianceRecord &a, const RadianceRecord &b) {
+        return a.mDirTreeIndex < b.mDirTreeIndex;
+    };
+    tbb::parallel_for(size_t(0), buffers.size(), [&](size_t i) {
+        std::sort(buffers[i]->begin(), buffers[i]->end(), byDirTree);
+    });
+
+    const uint32_t nodeCount = static_cast<uint32_t>(mSpatialTree->getNodeCount());
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, nodeCount),
+                      [&](const tbb::blocked_range<uint32_t> &range) {
+        for (const RecordBuffer *buffer : buffers) {
+            const RadianceRecord first { range.begin(), Vec2f(0.f, 0.f), 0.f };
+            auto it = std::lower_bound(buffer->begin(), buffer->end(), first, byDirTree);
+            for (; it != buffer->end() && it->mDirTreeIndex < range.end(); ++it) {
+                mSpatialTree->getDirTreeAtIndex(it->mDirTreeIndex)->mergeRecord(*it);
+            }
+        }
+    });
+
+    uint64_t numRecords = 0;
+    for (RecordBuffer *buffer : buffers) {
+        numRecords += buffer->size();
+        buffer->clear();
+    }
+    mNumSamplesRecorded.fetch_add(numRecords, std::memory_order_relaxed);
 }
 
 float
 PathGuide::Impl::getPdf(const Vec3f &p, const Vec3f &dir) const
 {
     MNRY_ASSERT(mEnable);
-    const DirTree *dirTree = mSpatialTree->getDirTree(p);
-    return dirTree->getPdf(dir);
+    const uint32_t root = getDirTreeRoot(mSampleTree, p);
+    return getDirTreePdf(mSampleTree.mDirNodes, root, dir);
 }
 
 Vec3f
 PathGuide::Impl::sampleDirection(const Vec3f &p, float r1, float r2, float *pdf) const
 {
     MNRY_ASSERT(mEnable);
-    const DirTree *dirTree = mSpatialTree->getDirTree(p);
-    MNRY_ASSERT(dirTree != nullptr);
-    const Vec3f dir = dirTree->sampleDirection(r1, r2);
+    const uint32_t root = getDirTreeRoot(mSampleTree, p);
+    const Vec3f dir = sampleDirTree(mSampleTree.mDirNodes, root, r1, r2);
     if (pdf) {
-        *pdf = dirTree->getPdf(dir);
+        *pdf = getDirTreePdf(mSampleTree.mDirNodes, root, dir);
     }
 
     return dir;
@@ -812,6 +1086,18 @@ PathGuide::Impl::getPercentage() const
     return mPercentage;
 }
 
+uint64_t
+PathGuide::Impl::getNumSamplesRecorded() const
+{
+    return mNumSamplesRecorded.load(std::memory_order_relaxed);
+}
+
+double
+PathGuide::Impl::getMergeTime() const
+{
+    return mcrt_common::Clock::seconds(mMergeTime);
+}
+
 //===--------------------------------------------------------------------------
 // PathGuide
 //===--------------------------------------------------------------------------
@@ -825,9 +1111,9 @@ PathGuide::~PathGuide()
 }
 
 void
-PathGuide::startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars)
+PathGuide::startFrame(const BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars, bool keep)
 {
-    mImpl->startFrame(bbox, vars);
+    mImpl->startFrame(bbox, vars, keep);
 }
 
 void
@@ -872,6 +1158,24 @@ PathGuide::getPercentage() const
     return mImpl->getPercentage();
 }
 
+uint64_t
+PathGuide::getNumSamplesRecorded() const
+{
+    return mImpl->getNumSamplesRecorded();
+}
+
+double
+PathGuide::getMergeTime() const
+{
+    return mImpl->getMergeTime();
+}
+
+const PathGuideSampleTree &
+PathGuide::getSampleTree() const
+{
+    return mImpl->getSampleTree();
+}
+
 } // namespace pbr
 } // namespace moonray
 
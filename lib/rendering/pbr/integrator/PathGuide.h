@@ -4,19 +4,51 @@
 /// @file PathGuide.h
 #pragma once
 
+#include "PathGuide.hh"
+
 #include <scene_rdl2/common/math/BBox.h>
 #include <scene_rdl2/common/math/Color.h>
 #include <scene_rdl2/common/math/Vec3.h>
+#include <scene_rdl2/common/platform/HybridUniformData.h>
 
 #include <memory>
+#include <stdint.h>
 
 namespace scene_rdl2 {
 namespace rdl2 { class SceneVariables; }
 }
 
+// Forward declaration of the ISPC types
+namespace ispc {
+    struct PathGuideSampleTree;
+}
+
 namespace moonray {
 namespace pbr {
 
+// See PathGuide.hh for a description of the flattened sample tree layout
+struct PathGuideSpatialNode
+{
+    PATH_GUIDE_SPATIAL_NODE_MEMBERS;
+
+    static uint32_t hudValidation(bool verbose) { PATH_GUIDE_SPATIAL_NODE_VALIDATION; }
+};
+
+struct PathGuideDirNode
+{
+    PATH_GUIDE_DIR_NODE_MEMBERS;
+
+    static uint32_t hudValidation(bool verbose) { PATH_GUIDE_DIR_NODE_VALIDATION; }
+};
+
+struct PathGuideSampleTree
+{
+    PATH_GUIDE_SAMPLE_TREE_MEMBERS;
+
+    static uint32_t hudValidation(bool verbose) { PATH_GUIDE_SAMPLE_TREE_VALIDATION; }
+    HUD_AS_ISPC_METHODS(PathGuideSampleTree);
+};
+
 class PathGuide
 {
 public:
@@ -26,7 +58,11 @@ public:
     ~PathGuide();
 
     // Initialize path guide for a new frame.  Bbox is an aabb of the scene.
-    void startFrame(const scene_rdl2::math::BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars);
+    // With keep set, the trees learned during the previous frame are kept when
+    // guiding is still enabled and the scene bounds haven't changed, such as
+    // when the same scene is rendered again from another eye.
+    void startFrame(const scene_rdl2::math::BBox3f &bbox, const scene_rdl2::rdl2::SceneVariables &vars,
+                    bool keep = false);
 
     // A path guided render should be broken into a series of passes where
     // each pass covers the entire frame and each new pass should contain roughly
@@ -61,6 +97,18 @@ public:
     // What percentage of samples should use path guiding?
     float getPercentage() const;
 
+    // Guiding statistics for the current frame: the number of radiance
+    // samples merged into the directional trees, and the wall clock time
+    // spent merging them in passReset().
+    uint64_t getNumSamplesRecorded() const;
+    double getMergeTime() const;
+
+    // Flattened copy of the sampling trees, used by getPdf() and
+    // sampleDirection() as well as by the vectorized integrator.  The object
+    // lives as long as the path guide, its contents are only valid between
+    // pass resets.
+    const PathGuideSampleTree &getSampleTree() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> mImpl;
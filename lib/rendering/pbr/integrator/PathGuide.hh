@@ -0,0 +1,67 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <scene_rdl2/common/platform/HybridUniformData.hh>
+
+
+//----------------------------------------------------------------------------
+
+// The path guide sample tree is a flattened, read-only copy of the SD-tree
+// that is rebuilt at every pass reset.  It is shared by the scalar and the
+// vectorized integrators.
+//
+// Spatial nodes are stored in the same order as the spatial tree.  Inner
+// nodes have mAxis in [0, 2] and mChildren holds the indices of the two
+// children.  Leaves have mAxis == -1 and mChildren[0] holds the index of the
+// root of their directional tree in the dir node array, or
+// PATH_GUIDE_INVALID_DIR_NODE if the directional tree has no energy yet.
+//
+// The directional trees of all leaves are concatenated into a single dir node
+// array.  mProb holds the normalized energy of each quadrant and mChildren
+// the absolute index of the quadrant's child node, 0 for leaves.
+
+#define PATH_GUIDE_INVALID_DIR_NODE 0xffffffff
+
+#define PATH_GUIDE_SPATIAL_NODE_MEMBERS     \
+    HUD_MEMBER(int32_t, mAxis);             \
+    HUD_ARRAY(uint32_t, mChildren, 2)
+
+#define PATH_GUIDE_SPATIAL_NODE_VALIDATION          \
+    HUD_BEGIN_VALIDATION(PathGuideSpatialNode);     \
+    HUD_VALIDATE(PathGuideSpatialNode, mAxis);      \
+    HUD_VALIDATE(PathGuideSpatialNode, mChildren);  \
+    HUD_END_VALIDATION
+
+#define PATH_GUIDE_DIR_NODE_MEMBERS         \
+    HUD_ARRAY(float, mProb, 4);             \
+    HUD_ARRAY(uint32_t, mChildren, 4)
+
+#define PATH_GUIDE_DIR_NODE_VALIDATION              \
+    HUD_BEGIN_VALIDATION(PathGuideDirNode);         \
+    HUD_VALIDATE(PathGuideDirNode, mProb);          \
+    HUD_VALIDATE(PathGuideDirNode, mChildren);      \
+    HUD_END_VALIDATION
+
+#define PATH_GUIDE_SAMPLE_TREE_MEMBERS                                              \
+    HUD_PTR(const HUD_UNIFORM PathGuideSpatialNode * HUD_UNIFORM, mSpatialNodes);   \
+    HUD_PTR(const HUD_UNIFORM PathGuideDirNode * HUD_UNIFORM, mDirNodes);           \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mBboxLower);                 \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mInvBboxSize);               \
+    HUD_MEMBER(float, mPercentage);                                                 \
+    HUD_MEMBER(bool, mEnable);                                                      \
+    HUD_MEMBER(bool, mCanSample)
+
+#define PATH_GUIDE_SAMPLE_TREE_VALIDATION                   \
+    HUD_BEGIN_VALIDATION(PathGuideSampleTree);              \
+    HUD_VALIDATE(PathGuideSampleTree, mSpatialNodes);       \
+    HUD_VALIDATE(PathGuideSampleTree, mDirNodes);           \
+    HUD_VALIDATE(PathGuideSampleTree, mBboxLower);          \
+    HUD_VALIDATE(PathGuideSampleTree, mInvBboxSize);        \
+    HUD_VALIDATE(PathGuideSampleTree, mPercentage);         \
+    HUD_VALIDATE(PathGuideSampleTree, mEnable);             \
+    HUD_VALIDATE(PathGuideSampleTree, mCanSample);          \
+    HUD_END_VALIDATION
+
@@ -25,6 +25,7 @@
 
 #include <moonray/rendering/geom/IntersectionInit.h>
 #include <moonray/rendering/geom/prim/BVHUserData.h>
+#include <moonray/rendering/geom/prim/GeomTLState.h>
 #include <moonray/rendering/mcrt_common/Ray.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 #include <moonray/rendering/rt/rt.h>
@@ -44,6 +45,7 @@
 #include <moonray/rendering/shading/Material.h>
 
 #include <moonray/common/time/Ticker.h>
+#include <moonray/common/time/Timer.h>
 
 #include <scene_rdl2/common/math/Constants.h>
 #include <scene_rdl2/scene/rdl2/SceneContext.h>
@@ -146,6 +148,7 @@ PathIntegrator::PathIntegrator() :
     mPresenceThreshold(0.999f),
     mRussianRouletteThreshold(0.f),
     mInvRussianRouletteThreshold(0.f),
+    mShadowRayRouletteThreshold(0.f),
     mSampleClampingValue(0.0f),
     mSampleClampingDepth(1),
     mRoughnessClampingFactor(0.0f),
@@ -158,7 +161,10 @@ PathIntegrator::PathIntegrator() :
     mVolumePhaseAttenuationFactor(1.0f),
     mVolumeOverlapMode(VolumeOverlapMode::SUM),
     mEnableSSS(true),
-    mEnableShadowing(true)
+    mEnableShadowing(true),
+    mVolumeRatioTracking(false),
+    mCostAttribution(false),
+    mPathGuideSampleTree(&mPathGuide.getSampleTree())
 {
 }
 
@@ -188,6 +194,7 @@ PathIntegrator::update(const FrameState &fs, const PathIntegratorParams& params)
     mPresenceThreshold = params.mIntegratorPresenceThreshold;
     mRussianRouletteThreshold = params.mIntegratorRussianRouletteThreshold;
     mInvRussianRouletteThreshold = 1.f / mRussianRouletteThreshold;
+    mShadowRayRouletteThreshold = scene_rdl2::math::max(0.f, params.mShadowRayRouletteThreshold);
     mSampleClampingValue = params.mSampleClampingValue;
     // volume related params
     mInvVolumeQuality = 1.0f / scene_rdl2::math::max(1e-5f, params.mIntegratorVolumeQuality);
@@ -200,6 +207,8 @@ PathIntegrator::update(const FrameState &fs, const PathIntegratorParams& params)
     mVolumePhaseAttenuationFactor =
         params.mIntegratorVolumePhaseAttenuationFactor;
     mVolumeOverlapMode = params.mIntegratorVolumeOverlapMode;
+    mVolumeRatioTracking = params.mVolumeRatioTracking;
+    mCostAttribution = params.mCostAttribution;
 
     mSampleClampingDepth = params.mSampleClampingDepth;
     mRoughnessClampingFactor = params.mRoughnessClampingFactor;
@@ -230,7 +239,28 @@ PathIntegrator::update(const FrameState &fs, const PathIntegratorParams& params)
     }
 
     // initialize path guiding
-    mPathGuide.startFrame(fs.mEmbreeAccel->getBounds(), vars);
+    mPathGuide.startFrame(fs.mEmbreeAccel->getBounds(), vars, params.mKeepPathGuide);
+
+    // per thread volume shader results and shadow ray presence, sized here
+    // since the frame is not rendering yet
+    geom::internal::forEachTLS([&](geom::internal::TLState *geomTls) {
+        geomTls->mVolumeShaderCache.setCapacity(params.mVolumeShaderCacheSize);
+        geomTls->mPresenceCache.setCapacity(params.mPresenceCacheSize, params.mPresenceCacheResolution);
+    });
+
+    // per thread shaded camera ray hits, they are shared by the passes of
+    // this frame only
+    mShadingResultCaches.resize(params.mPrimaryShadingCacheSize ? mcrt_common::getMaxNumTLS() : 0);
+    for (std::unique_ptr<ShadingResultCache> &cache : mShadingResultCaches) {
+        if (!cache) {
+            cache.reset(new ShadingResultCache);
+        }
+        cache->setCapacity(params.mPrimaryShadingCacheSize, params.mPrimaryShadingCacheResolution);
+    }
+
+    // the volume light importance is recorded during the first passes
+    mVolumeLightCache.startFrame(fs.mEmbreeAccel->getBounds(), params.mVolumeLightCacheResolution,
+                                 scene->getLightCount());
 }
 
 void
@@ -376,6 +406,8 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
 
     scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
     SCOPED_MEM(arena);
+    // Tracks the arena memory of the path, for the sampling stats.
+    ArenaBounceScope arenaBounceScope(pbrTls);
 
     radiance = scene_rdl2::math::sBlack;
     transparency = 0.0f;
@@ -730,7 +762,7 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
         if (newCryptomatteParamsPtr && newCryptomatteParamsPtr->mHit) {
             unsigned px, py;
             uint32ToPixelLocation(sp.mPixel, &px, &py);
-            newCryptomatteParamsPtr->mCryptomatteBuffer->addSampleScalar(px, py, newCryptomatteParamsPtr->mId, 
+            newCryptomatteParamsPtr->mCryptomatteBuffer->addSampleScalar(pbrTls, px, py, newCryptomatteParamsPtr->mId, 
                                                                                  newPv.pathPixelWeight,
                                                                                  newCryptomatteParamsPtr->mPosition,
                                                                                  newCryptomatteParamsPtr->mP0,
@@ -770,9 +802,30 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
         }
     }
 
-    auto bsdf = arena->allocWithCtor<shading::Bsdf>();
-    shadeMaterial(pbrTls->mTopLevelTls, material, isect, bsdf);
-    stats.incCounter(STATS_SHADER_EVALS);
+    shading::Bsdf *bsdf = nullptr;
+    if (ray.getDepth() == 0 && !mShadingResultCaches.empty()) {
+        // Camera ray hits reuse the Bsdf shaded for their cell in an earlier
+        // sample, a new one is shaded into the cache's arena so it outlives
+        // this sample.
+        ShadingResultCache &shadingCache = *mShadingResultCaches[pbrTls->mThreadIdx];
+        bool hit;
+        shading::Bsdf **cached = shadingCache.lookup(material, ray, hit);
+        if (!hit) {
+            scene_rdl2::alloc::Arena *cacheArena = shadingCache.getArena();
+            shading::TLState *shadingTls = pbrTls->mTopLevelTls->mShadingTls.get();
+            scene_rdl2::alloc::Arena *shadingArena = shadingTls->mArena;
+            shadingTls->mArena = cacheArena;
+            *cached = cacheArena->allocWithCtor<shading::Bsdf>();
+            shadeMaterial(pbrTls->mTopLevelTls, material, isect, *cached);
+            shadingTls->mArena = shadingArena;
+            stats.incCounter(STATS_SHADER_EVALS);
+        }
+        bsdf = *cached;
+    } else {
+        bsdf = arena->allocWithCtor<shading::Bsdf>();
+        shadeMaterial(pbrTls->mTopLevelTls, material, isect, bsdf);
+        stats.incCounter(STATS_SHADER_EVALS);
+    }
 
     // Evaluate any extra aovs on this material
     if (aovs) {
@@ -951,7 +1004,7 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
         // started up inside of computeRadianceSubsurface as needed.
         radiance += computeRadianceDiffusionSubsurface(pbrTls, *bsdf, sp, pv, ray,
             isect, slice, *bssrdf, activeLightSet, doIndirect, rayEpsilon, shadowRayEpsilon,
-            sequenceID, ssAov, aovs);
+            sequenceID, ssAov, aovs, nullptr);
     }
     // Option 2: path trace volumetric approach
     const shading::VolumeSubsurface *volumeSubsurface = bsdf->getVolumeSubsurface();
@@ -960,7 +1013,7 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
         pv.subsurfaceDepth += 1;
         radiance += computeRadiancePathTraceSubsurface(pbrTls, *bsdf, sp, pv, ray,
             isect, *volumeSubsurface, activeLightSet, doIndirect, rayEpsilon, shadowRayEpsilon,
-            sequenceID, ssAov, aovs);
+            sequenceID, ssAov, aovs, nullptr);
     }
 
     checkForNan(radiance, "Subsurface scattering", sp, pv, ray, isect);
@@ -1007,7 +1060,7 @@ PathIntegrator::computeRadianceRecurse(pbr::TLState *pbrTls, mcrt_common::RayDif
         scene_rdl2::math::Color cryptoBeauty = radiance - presenceRadiance;
         cryptoBeauty *= presenceInv;
 
-        cryptomatteParamsPtr->mCryptomatteBuffer->addSampleScalar(px, py, cryptomatteParamsPtr->mId,
+        cryptomatteParamsPtr->mCryptomatteBuffer->addSampleScalar(pbrTls, px, py, cryptomatteParamsPtr->mId,
                                                                           pv.pathPixelWeight,
                                                                           cryptomatteParamsPtr->mPosition,
                                                                           cryptomatteParamsPtr->mP0,
@@ -1063,6 +1116,22 @@ PathIntegrator::initPrimaryRay(pbr::TLState *pbrTls,
          return false;
      }
 
+    initPrimaryPath(pbrTls, pixelX, pixelY, subpixelIndex, pixelSamples, sample, ray, sp, pv);
+
+    return true;
+}
+
+void
+PathIntegrator::initPrimaryPath(pbr::TLState *pbrTls,
+                                int pixelX,
+                                int pixelY,
+                                int subpixelIndex,
+                                int pixelSamples,
+                                const Sample& sample,
+                                mcrt_common::RayDifferential &ray,
+                                Subpixel &sp,
+                                PathVertex &pv) const
+{
     // Create a sub-pixel structure
     sp.mPixel = pixelLocationToUint32(unsigned(pixelX), unsigned(pixelY));
     sp.mSubpixelIndex = subpixelIndex;
@@ -1136,8 +1205,29 @@ PathIntegrator::initPrimaryRay(pbr::TLState *pbrTls,
     // Increment stats
     Statistics &stats = pbrTls->mStatistics;
     stats.incCounter(STATS_PIXEL_SAMPLES);
+}
 
-    return true;
+bool
+PathIntegrator::isRayOccludedWithCost(pbr::TLState *pbrTls, const Light* light, mcrt_common::Ray& shadowRay,
+                                      float rayEpsilon, float shadowRayEpsilon, float& presence,
+                                      const shading::Intersection &isect) const
+{
+    const int32_t assignmentId = isect.getLayerAssignmentId();
+    if (!mCostAttribution) {
+        return isRayOccluded(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence, assignmentId);
+    }
+
+    const double start = time::getTime();
+    const bool occluded = isRayOccluded(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence,
+                                        assignmentId);
+    const double elapsed = time::getTime() - start;
+
+    pbrTls->mStatistics.mLightOcclusionTime[light->getSceneIndex()] += elapsed;
+    const scene_rdl2::rdl2::Material *material = isect.getMaterial();
+    if (material && material->getThreadLocalObjectState()) {
+        material->getThreadLocalObjectState()[pbrTls->mThreadIdx].mOcclusionTime += elapsed;
+    }
+    return occluded;
 }
 
 bool
@@ -1361,7 +1451,7 @@ PathIntegrator::computeRadiance(pbr::TLState *pbrTls, int pixelX, int pixelY,
     }
 
     if (cryptomatteBuffer && cryptomatteParams.mHit) {
-        cryptomatteBuffer->addSampleScalar(pixelX, pixelY, cryptomatteParams.mId, 
+        cryptomatteBuffer->addSampleScalar(pbrTls, pixelX, pixelY, cryptomatteParams.mId, 
                                                            1.0f, 
                                                            cryptomatteParams.mPosition,
                                                            cryptomatteParams.mP0,
@@ -1375,7 +1465,7 @@ PathIntegrator::computeRadiance(pbr::TLState *pbrTls, int pixelX, int pixelY,
     }
 
     if (cryptomatteBuffer && refractCryptomatteParams.mHit) {
-        cryptomatteBuffer->addSampleScalar(pixelX, pixelY, refractCryptomatteParams.mId, 
+        cryptomatteBuffer->addSampleScalar(pbrTls, pixelX, pixelY, refractCryptomatteParams.mId, 
                                                            1.0f, 
                                                            refractCryptomatteParams.mPosition,
                                                            refractCryptomatteParams.mP0,
@@ -1498,6 +1588,84 @@ PathIntegrator::queuePrimaryRay(pbr::TLState *pbrTls,
     return true;
 }
 
+unsigned
+PathIntegrator::queuePrimaryRays(pbr::TLState *pbrTls,
+                                 int pixelX,
+                                 int pixelY,
+                                 unsigned numRays,
+                                 const int *subpixelIndices,
+                                 int pixelSamples,
+                                 const Sample *samples,
+                                 RayState **rayStates,
+                                 RayState **invalidRayStates) const
+{
+    MNRY_ASSERT(numRays);
+
+    const Scene *scene = MNRY_VERIFY(pbrTls->mFs->mScene);
+    const Camera *camera = MNRY_VERIFY(scene->getCamera());
+
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+
+    RayState **validRayStates = arena->allocArray<RayState *>(numRays);
+    unsigned numValid = 0;
+    unsigned numInvalid = 0;
+
+    {
+        EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_PRIMARY_RAY_GEN);
+
+        // Create all the primary rays in one call to the camera, from the
+        // samples laid out as separate arrays.
+        mcrt_common::RayDifferential **rays = arena->allocArray<mcrt_common::RayDifferential *>(numRays);
+        float *x = arena->allocArray<float>(numRays);
+        float *y = arena->allocArray<float>(numRays);
+        float *time = arena->allocArray<float>(numRays);
+        float *lensU = arena->allocArray<float>(numRays);
+        float *lensV = arena->allocArray<float>(numRays);
+        for (unsigned i = 0; i < numRays; ++i) {
+            rays[i] = &rayStates[i]->mRay;
+            x[i] = pixelX + samples[i].pixelX;
+            y[i] = pixelY + samples[i].pixelY;
+            time[i] = samples[i].time;
+            lensU[i] = samples[i].lensU;
+            lensV[i] = samples[i].lensV;
+        }
+        camera->createRays(numRays, rays, x, y, time, lensU, lensV, true);
+
+        for (unsigned i = 0; i < numRays; ++i) {
+            RayState *rs = rayStates[i];
+            const mcrt_common::RayDifferential &ray = rs->mRay;
+            if (ray.getStart() == scene_rdl2::math::sMaxValue && ray.getEnd() == scene_rdl2::math::sMaxValue) {
+                invalidRayStates[numInvalid++] = rs;
+                continue;
+            }
+            initPrimaryPath(pbrTls, pixelX, pixelY, subpixelIndices[i], pixelSamples, samples[i],
+                            rs->mRay, rs->mSubpixel, rs->mPathVertex);
+            validRayStates[numValid++] = rs;
+        }
+    }
+
+    if (!numValid) {
+        return 0;
+    }
+
+    // Fill in remaining RayState members, as in queuePrimaryRay().
+    const LightAovs *lightAovs = pbrTls->mFs->mAovSchema->empty() ? nullptr : pbrTls->mFs->mLightAovs;
+    for (unsigned i = 0; i < numValid; ++i) {
+        RayState *rs = validRayStates[i];
+        rs->mRay.mask = scene_rdl2::rdl2::CAMERA;
+        rs->mSequenceID = pbrTls->mFs->mInitialSeed;
+        if (lightAovs) {
+            rs->mPathVertex.lpeStateId = lightAovs->cameraEventTransition(pbrTls);
+        }
+    }
+
+    // Queue up all the rays at once.
+    pbrTls->addRayQueueEntries(numValid, validRayStates);
+
+    return numValid;
+}
+
 void
 PathIntegrator::integrateBundledv(pbr::TLState *pbrTls,
                                   shading::TLState *shadingTls,
@@ -13,6 +13,8 @@
 #include "BsdfOneSampler.h"
 #include "BsdfSampler.h"
 #include "LightSetSampler.h"
+#include "ShadingResultCache.h"
+#include "VolumeLightCache.h"
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/geom/prim/Primitive.h>
@@ -28,6 +30,7 @@
 #include <scene_rdl2/scene/rdl2/SceneVariables.h>
 #include <scene_rdl2/common/math/Vec3.h>
 
+#include <memory>
 #include <vector>
 
 namespace moonray {
@@ -109,6 +112,16 @@ struct PathIntegratorParams
     float mIntegratorVolumeContributionFactor;
     float mIntegratorVolumePhaseAttenuationFactor;
     VolumeOverlapMode mIntegratorVolumeOverlapMode;
+    unsigned mVolumeLightCacheResolution;
+    bool mVolumeRatioTracking;
+    bool mCostAttribution;
+    float mShadowRayRouletteThreshold;
+    unsigned mVolumeShaderCacheSize;
+    unsigned mPrimaryShadingCacheSize;
+    unsigned mPrimaryShadingCacheResolution;
+    unsigned mPresenceCacheSize;
+    unsigned mPresenceCacheResolution;
+    bool mKeepPathGuide;
 };
 
 struct ComputeRadianceAovParams
@@ -176,6 +189,11 @@ public:
     // only on one thread and that all other render threads are blocked.
     void passReset();
 
+    // Stops recording the volume light importance and starts using it to pick
+    // the lights of volume in-scattering. Thread safe, only the first call of
+    // a frame has any effect.
+    void freezeVolumeLightCache() const { mVolumeLightCache.freeze(); }
+
     /// Sample a path for the given:
     /// - pixel in viewport coordinates)
     /// - subpixel in the range [0,subpixelRate)
@@ -191,19 +209,24 @@ public:
             int subpixelIndex, int pixelSamples, const Sample& sample,
             ComputeRadianceAovParams &aovParams, rndr::FastRenderMode fastMode) const;
 
+    // Subsurface scattering estimators. RayState will be null if rendering
+    // scalar, otherwise it is the RayState of the path and the indirect rays
+    // leaving the subsurface sample points are queued as new RayStates rather
+    // than recursed into, so their radiance reaches the frame buffer through
+    // the radiance queue instead of the returned radiance.
     scene_rdl2::math::Color computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls, const shading::Bsdf &bsdf,
             const Subpixel &sp, const PathVertex &pv,
             const mcrt_common::RayDifferential &ray, const shading::Intersection &isect,
             const shading::BsdfSlice &slice, const shading::Bssrdf &bssrdf, const LightSet &lightSet,
             bool doIndirect, float rayEpsilon, float shadowRayEpsilon, unsigned &sequenceID,
-            scene_rdl2::math::Color &ssAov, float *aovs) const;
+            scene_rdl2::math::Color &ssAov, float *aovs, const RayState *rs) const;
 
     scene_rdl2::math::Color computeRadiancePathTraceSubsurface(pbr::TLState *pbrTls, const shading::Bsdf &bsdf,
             const Subpixel &sp, const PathVertex &pv,
             const mcrt_common::RayDifferential &ray, const shading::Intersection &isect,
             const shading::VolumeSubsurface& volumeSubsurface, const LightSet &lightSet,
             bool doIndirect, float rayEpsilon, float shadowRayEpsilon, unsigned &sequenceID,
-            scene_rdl2::math::Color &ssAov, float *aovs) const;
+            scene_rdl2::math::Color &ssAov, float *aovs, const RayState *rs) const;
 
     // compute the volume scattering contribution and add the result to
     // radiance, also compute the volume transmittance across
@@ -237,6 +260,15 @@ public:
             int subpixelIndex, int pixelSamples, const Sample& sample,
             RayState *rs) const;
 
+    // Batched queuePrimaryRay() for samples of the same pixel, the rays are
+    // created with a single Camera::createRays() call and queued together.
+    // The ray states of invalid rays are not queued but returned in
+    // invalidRayStates. Returns the number of rays queued.
+    unsigned queuePrimaryRays(pbr::TLState *pbrTls, int pixelX, int pixelY,
+            unsigned numRays, const int *subpixelIndices, int pixelSamples,
+            const Sample *samples, RayState **rayStates,
+            RayState **invalidRayStates) const;
+
     // Used for bundled case as a wrapper to call directly into ISPC.
     void integrateBundledv(pbr::TLState *pbrTls, shading::TLState *shadingTls, unsigned numEntries,
             RayStatev *rayStates, const shading::Intersectionv *isects,
@@ -247,6 +279,7 @@ public:
 
     bool getEnableShadowing() const { return mEnableShadowing; }
     bool getEnablePathGuide() const;
+    const PathGuide &getPathGuide() const { return mPathGuide; }
 
     // mLightSamples is the user parameter "light_sample_count" squared
     int getLightSampleCount() const { return mLightSamples; }
@@ -276,6 +309,9 @@ private:
         ALL = SURFACE | VOLUME
     };
 
+    // Shaded camera ray hits, one cache per thread index.
+    typedef std::vector<std::unique_ptr<ShadingResultCache>> ShadingResultCaches;
+
 
     struct CryptomatteParams
     {
@@ -480,7 +516,13 @@ private:
             int subsurfaceSplitFactor, int computeRadianceSplitFactor,
             int subsurfaceIndex, bool doIndirect, float rayEpsilon, float shadowRayEpsilon,
             unsigned sssSampleID, unsigned &sequenceID, bool isLocal, float *aovs,
-            const shading::Intersection &isect) const;
+            const shading::Intersection &isect, const RayState *rs) const;
+
+    // Queues the indirect ray leaving a subsurface sample point as a new
+    // RayState, the bundled counterpart of recursing into it.
+    void queueSubsurfaceIndirectRay(pbr::TLState *pbrTls, const RayState &parentRs,
+            const mcrt_common::RayDifferential &ray, const PathVertex &pv,
+            unsigned sequenceID) const;
 
     scene_rdl2::math::Color computeDiffusionForwardScattering(pbr::TLState *pbrTls,
             const shading::Bsdf &bsdf, const Subpixel &sp, const PathVertex &pv,
@@ -490,13 +532,19 @@ private:
             const shading::Bssrdf &bssrdf, const scene_rdl2::math::Vec3f &P, const scene_rdl2::math::Vec3f &N,
             const scene_rdl2::math::ReferenceFrame &localF, int subsurfaceSplitFactor,
             bool doIndirect, float rayEpsilon, float shadowRayEpsilon, unsigned sssSampleID,
-            unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs) const;
+            unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs,
+            const RayState *rs) const;
 
     bool initPrimaryRay(pbr::TLState *pbrTls, const Camera *camera,
             int pixelX, int pixelY, int subpixelIndex, int pixelSamples,
             const Sample& sample, mcrt_common::RayDifferential &ray,
             Subpixel &sp, PathVertex &pv) const;
 
+    // Initializes the subpixel and path vertex of a valid primary ray.
+    void initPrimaryPath(pbr::TLState *pbrTls, int pixelX, int pixelY,
+            int subpixelIndex, int pixelSamples, const Sample& sample,
+            mcrt_common::RayDifferential &ray, Subpixel &sp, PathVertex &pv) const;
+
     // Utility function handling occlusion/presence shadow ray query based on whether light has presence shadow enabled.
     // Return true when the ray is completely occluded
     // (either hits a fully opaque surface, or accumulated presence reaches 1).
@@ -506,6 +554,12 @@ private:
     bool isRayOccluded(pbr::TLState *pbrTls, const Light* light, mcrt_common::Ray& shadowRay, float rayEpsilon,
                        float shadowRayEpsilon, float& presence, int receiverId, bool isVolume = false) const;
 
+    // isRayOccluded() for the shadow rays cast from the surface isect, which also times the
+    // query for the light and the material of isect when cost attribution is on.
+    bool isRayOccludedWithCost(pbr::TLState *pbrTls, const Light* light, mcrt_common::Ray& shadowRay,
+                               float rayEpsilon, float shadowRayEpsilon, float& presence,
+                               const shading::Intersection &isect) const;
+
     PATH_INTEGRATOR_MEMBERS;
 };
 
@@ -24,6 +24,7 @@
     HUD_MEMBER(float, mPresenceThreshold);                 \
     HUD_MEMBER(float, mRussianRouletteThreshold);          \
     HUD_MEMBER(float, mInvRussianRouletteThreshold);       \
+    HUD_MEMBER(float, mShadowRayRouletteThreshold);        \
     HUD_MEMBER(float, mSampleClampingValue);               \
     HUD_MEMBER(int, mSampleClampingDepth);                 \
     HUD_MEMBER(float, mRoughnessClampingFactor);           \
@@ -38,11 +39,16 @@
     HUD_MEMBER(float, mResolution);                        \
     HUD_MEMBER(bool, mEnableSSS);                          \
     HUD_MEMBER(bool, mEnableShadowing);                    \
+    HUD_MEMBER(bool, mVolumeRatioTracking);                \
+    HUD_MEMBER(bool, mCostAttribution);                    \
     HUD_MEMBER(int, mPad0);                                \
     HUD_CPP_MEMBER(std::vector<int>, mDeepIDAttrIdxs, 24); \
     HUD_MEMBER(int, mCryptoUVAttrIdx);                     \
     HUD_MEMBER(int, mPad1);                                \
-    HUD_CPP_MEMBER(PathGuide, mPathGuide, 8)
+    HUD_CPP_MEMBER(PathGuide, mPathGuide, 8);              \
+    HUD_PTR(const HUD_UNIFORM PathGuideSampleTree *, mPathGuideSampleTree); \
+    HUD_CPP_MEMBER(VolumeLightCache, mVolumeLightCache, 8); \
+    HUD_CPP_MEMBER(ShadingResultCaches, mShadingResultCaches, 24)
                 
 
 #define PATH_INTEGRATOR_VALIDATION                                 \
@@ -63,6 +69,7 @@
     HUD_VALIDATE(PathIntegrator, mPresenceThreshold);              \
     HUD_VALIDATE(PathIntegrator, mRussianRouletteThreshold);       \
     HUD_VALIDATE(PathIntegrator, mInvRussianRouletteThreshold);    \
+    HUD_VALIDATE(PathIntegrator, mShadowRayRouletteThreshold);     \
     HUD_VALIDATE(PathIntegrator, mSampleClampingValue);            \
     HUD_VALIDATE(PathIntegrator, mSampleClampingDepth);            \
     HUD_VALIDATE(PathIntegrator, mRoughnessClampingFactor);        \
@@ -77,10 +84,15 @@
     HUD_VALIDATE(PathIntegrator, mResolution);                     \
     HUD_VALIDATE(PathIntegrator, mEnableSSS);                      \
     HUD_VALIDATE(PathIntegrator, mEnableShadowing);                \
+    HUD_VALIDATE(PathIntegrator, mVolumeRatioTracking);            \
+    HUD_VALIDATE(PathIntegrator, mCostAttribution);                \
     HUD_VALIDATE(PathIntegrator, mPad0);                           \
     HUD_VALIDATE(PathIntegrator, mDeepIDAttrIdxs);                 \
     HUD_VALIDATE(PathIntegrator, mCryptoUVAttrIdx);                \
     HUD_VALIDATE(PathIntegrator, mPad1);                           \
     HUD_VALIDATE(PathIntegrator, mPathGuide);                      \
+    HUD_VALIDATE(PathIntegrator, mPathGuideSampleTree);            \
+    HUD_VALIDATE(PathIntegrator, mVolumeLightCache);               \
+    HUD_VALIDATE(PathIntegrator, mShadingResultCaches);            \
     HUD_END_VALIDATION
 
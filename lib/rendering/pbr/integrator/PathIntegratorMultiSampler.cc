@@ -76,8 +76,7 @@ PathIntegrator::addDirectVisibleBsdfLobeSampleContribution(pbr::TLState *pbrTls,
             isOccluded = false;
         }
     } else {
-        int32_t assignmentId = isect.getLayerAssignmentId();
-        isOccluded = isRayOccluded(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence, assignmentId);
+        isOccluded = isRayOccludedWithCost(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence, isect);
     }
     if (!isOccluded) {
         // We can't reuse shadowRay because it can be modified in occlusion query
@@ -184,8 +183,7 @@ void PathIntegrator::addDirectVisibleLightSampleContributions(pbr::TLState* pbrT
 
         const FrameState &fs = *pbrTls->mFs;
         const bool hasUnoccludedFlag = fs.mAovSchema->hasLpePrefixFlags(AovSchema::sLpePrefixUnoccluded);
-        int32_t assignmentId = isect.getLayerAssignmentId();
-        if (isRayOccluded(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence, assignmentId)) {
+        if (isRayOccludedWithCost(pbrTls, light, shadowRay, rayEpsilon, shadowRayEpsilon, presence, isect)) {
             // Calculate clear radius falloff
             // only do extra calculations if clear radius falloff enabled
             if (light->getClearRadiusFalloffDistance() != 0.f && 
@@ -376,7 +374,11 @@ PathIntegrator::sampleAndAddDirectLightContributions(pbr::TLState* pbrTls,
 
         if (pv.nonMirrorDepth > 0 && mRussianRouletteThreshold > 0.0f) {
             applyRussianRoulette(lSampler, lsmp, sp, pv, sequenceID, 
-                                 mRussianRouletteThreshold, rrSamples);
+                                 mRussianRouletteThreshold * pbrTls->mRussianRouletteScale, rrSamples);
+        }
+        if (mShadowRayRouletteThreshold > 0.0f) {
+            applyShadowRayRoulette(pbrTls, lSampler, lsmp, pv, lightIndex,
+                                   mShadowRayRouletteThreshold, rrSamples);
         }
 
         // ---------------- Trace shadow rays and add any light sample contributions -----------------------------------
@@ -581,6 +583,7 @@ PathIntegrator::addIndirectOrDirectVisibleContributions(
                                            refractCryptomatteParams : nullptr;
 
 
+            pbrTls->mStatistics.incCounter(STATS_SCALAR_PATH_BOUNCES);
             IndirectRadianceType indirectRadianceType = computeRadianceRecurse(
                     pbrTls, ray, sp,
                     pv, lobe, radianceIndirect, transparencyIndirect,
@@ -672,6 +675,9 @@ PathIntegrator::computeRadianceBsdfMultiSampler(pbr::TLState *pbrTls,
             scene_rdl2::math::min(mLightSamples, 1));
     LightSetSampler lSampler(arena, activeLightSet, bsdf, isect.getP(), maxSamplesPerLight);
 
+    // The light samples are only used by the direct lighting, they are
+    // released before the indirect bounces below.
+    uint8_t *lightMemBookmark = arena->getPtr();
     LightSample *lsmp = arena->allocArray<LightSample>(lSampler.getLightSampleCount());
 
     // If adaptive light sampling is on, intelligently choose lights to sample using a 
@@ -706,11 +712,12 @@ PathIntegrator::computeRadianceBsdfMultiSampler(pbr::TLState *pbrTls,
     // Apply Russian Roulette (RR). Note we only do RR past a non-mirror
     // bounce, to avoid breaking the nice stratification of samples on the
     // first non-mirror hit.
-    // TODO: We should find a way to use efficiency optimized RR. For this we
-    // need an estimate of the final pixel color so our threshold can be
-    // computed accordingly.
+    // In adaptive mode the threshold is raised for the pixels close to their
+    // target error (see TLState::mRussianRouletteScale), the continuation
+    // probability of each lobe sample still follows its throughput.
     if (pv.nonMirrorDepth > 0  &&  mRussianRouletteThreshold > 0.0f) {
-        applyRussianRoulette(bSampler, bsmp, sp, pv, sequenceID, mRussianRouletteThreshold);
+        applyRussianRoulette(bSampler, bsmp, sp, pv, sequenceID,
+                             mRussianRouletteThreshold * pbrTls->mRussianRouletteScale);
     }
 
     CHECK_CANCELLATION(pbrTls, return scene_rdl2::math::sBlack );
@@ -723,6 +730,7 @@ PathIntegrator::computeRadianceBsdfMultiSampler(pbr::TLState *pbrTls,
     sampleAndAddDirectLightContributions(pbrTls, sp, pv, lSampler, lsmp, bSampler, cullingNormal, ray,
             rayEpsilon, shadowRayEpsilon, radiance, sequenceID, aovs, isect, lightSelectionPdfs);
     checkForNan(radiance, "Direct contributions", sp, pv, ray, isect);
+    arena->setPtr(lightMemBookmark);
 
     if (doIndirect) {
         // Note: This will recurse
@@ -100,7 +100,7 @@ PathIntegrator::computeRadianceSubsurfaceSample(pbr::TLState *pbrTls,
         int subsurfaceSplitFactor, int computeRadianceSplitFactor,
         int subsurfaceIndex, bool doIndirect, float rayEpsilon, float shadowRayEpsilon,
         unsigned sssSampleID, unsigned &sequenceID, bool isLocal,
-        float *aovs, const shading::Intersection &isect) const
+        float *aovs, const shading::Intersection &isect, const RayState *rs) const
 {
     scene_rdl2::math::Color radiance = scene_rdl2::math::sBlack;
     // Estimate emissive volume region energy contribution
@@ -457,20 +457,35 @@ PathIntegrator::computeRadianceSubsurfaceSample(pbr::TLState *pbrTls,
                             bsdfSample[1],
                             ray);
 
-            // Recurse
-            scene_rdl2::math::Color contribution;
-            float transparency;
             ++sequenceID;
-            bool hitVolume;
-
-            IndirectRadianceType indirectRadianceType = computeRadianceRecurse(
-                    pbrTls, ray, sp, nextPv, &lobe,
-                    contribution, transparency, vt,
-                    sequenceID, aovs, nullptr, nullptr, nullptr, nullptr, false, hitVolume);
-            if (indirectRadianceType != NONE) {
-                // Accumulate radiance, but only accumulate indirect or direct
-                // contribution
-                radiance += contribution;
+            if (rs) {
+                // Bundled mode: continue the path breadth first like the
+                // rays spawned by the bsdf samplers do, rather than tracing
+                // it depth first while the rest of the shade bundle waits.
+                PathVertex queuedPv = nextPv;
+                queuedPv.lpeStateId = aovs ? nextPv.lpeStateId : -1;
+                queuedPv.lpeStateIdLight = -1;
+                if (hitLight && queuedPv.lpeStateId >= 0) {
+                    const LightAovs &lightAovs = *pbrTls->mFs->mLightAovs;
+                    queuedPv.lpeStateIdLight = lightAovs.lightEventTransition(pbrTls,
+                        queuedPv.lpeStateId, hitLight);
+                }
+                queueSubsurfaceIndirectRay(pbrTls, *rs, ray, queuedPv, sequenceID);
+            } else {
+                // Recurse
+                scene_rdl2::math::Color contribution;
+                float transparency;
+                bool hitVolume;
+
+                IndirectRadianceType indirectRadianceType = computeRadianceRecurse(
+                        pbrTls, ray, sp, nextPv, &lobe,
+                        contribution, transparency, vt,
+                        sequenceID, aovs, nullptr, nullptr, nullptr, nullptr, false, hitVolume);
+                if (indirectRadianceType != NONE) {
+                    // Accumulate radiance, but only accumulate indirect or direct
+                    // contribution
+                    radiance += contribution;
+                }
             }
         }
         //------------------------------
@@ -565,6 +580,44 @@ PathIntegrator::computeRadianceSubsurfaceSample(pbr::TLState *pbrTls,
     return radiance;
 }
 
+void
+PathIntegrator::queueSubsurfaceIndirectRay(pbr::TLState *pbrTls, const RayState &parentRs,
+        const RayDifferential &ray, const PathVertex &pv, unsigned sequenceID) const
+{
+    if (ray.getEnd() <= ray.getStart()) {
+        return;
+    }
+
+    const FrameState &fs = *pbrTls->mFs;
+    RayState *rs = pbrTls->allocRayStates(1)[0];
+
+    rs->mRay = ray;
+    // Same mask the scalar recursion sets in Scene::intersectRay()
+    const int lobeMask = lobeTypeToRayMask(pv.lobeType);
+    rs->mRay.mask = fs.mPropagateVisibilityBounceType
+        ? ((parentRs.mRay.mask | lobeMask) & ~scene_rdl2::rdl2::CAMERA)
+        : lobeMask;
+
+    rs->mPathVertex = pv;
+    // The radiance queue entry of the parent path already carries the pixel
+    // weight, see PathIntegratorMultiSampler.ispc.
+    rs->mPathVertex.pathPixelWeight = 0.0f;
+    rs->mPathVertex.aovPathPixelWeight = pv.pathPixelWeight;
+    rs->mPathVertex.accumOpacity = parentRs.mPathVertex.accumOpacity;
+
+    rs->mSequenceID = sequenceID;
+    rs->mSubpixel = parentRs.mSubpixel;
+    rs->mTilePass = parentRs.mTilePass;
+    rs->mDeepDataHandle = pbrTls->acquireDeepData(parentRs.mDeepDataHandle);
+    rs->mCryptomatteDataHandle = pbrTls->acquireCryptomatteData(parentRs.mCryptomatteDataHandle);
+    rs->mCryptoRefP = parentRs.mCryptoRefP;
+    rs->mCryptoP0 = parentRs.mCryptoP0;
+    rs->mCryptoRefN = parentRs.mCryptoRefN;
+    rs->mCryptoUV = parentRs.mCryptoUV;
+
+    pbrTls->addRayQueueEntries(1, &rs);
+}
+
 scene_rdl2::math::Color
 PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         const Bsdf &bsdf, const Subpixel &sp, const PathVertex &pv,
@@ -572,7 +625,8 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         const BsdfSlice &slice, const Bssrdf &bssrdf,
         const LightSet &lightSet, bool doIndirect,
         float rayEpsilon, float shadowRayEpsilon,
-        unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs) const
+        unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs,
+        const RayState *rs) const
 {
     scene_rdl2::math::Color radiance = scene_rdl2::math::sBlack;
     if (mBssrdfSamples < 1 || !mEnableSSS) {
@@ -642,7 +696,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
             subsurfaceSplitFactor,           //subsurfaceSplitFactor
             computeRadianceSplitFactor,      //regular split factor
             0,                               //split index
-            doIndirect, rayEpsilon, shadowRayEpsilon, sequenceID, sequenceID, true, aovs, isect);
+            doIndirect, rayEpsilon, shadowRayEpsilon, sequenceID, sequenceID, true, aovs, isect, rs);
 
 
         // We cannot approximate the forward scattering with a
@@ -650,7 +704,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         radiance += computeDiffusionForwardScattering(pbrTls, bsdf, sp, pv,
             ray, isect, slice, transmissionFresnel, scaleFresnelWo, lightSet,
             bssrdf, P, N, localF, subsurfaceSplitFactor, doIndirect,
-            rayEpsilon, shadowRayEpsilon, sequenceID, sequenceID, ssAov, aovs);
+            rayEpsilon, shadowRayEpsilon, sequenceID, sequenceID, ssAov, aovs, rs);
 
         return radiance;
     }
@@ -693,20 +747,44 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         scene_rdl2::math::Vec3f mdNdx, mdNdy;
         scene_rdl2::math::Color mBssrdfEval;
     };
-    std::vector<SubsurfaceSample> subsurfaceSamples;
+
+    // The probe rays, their intersections and the collected samples of this
+    // shading point all live in the arena
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
+    SubsurfaceSample *subsurfaceSamples =
+        arena->allocArray<SubsurfaceSample>(subsurfaceSplitFactor);
+    int numSubsurfaceSamples = 0;
 
     // Bssrdf input normal
     const scene_rdl2::rdl2::Material* sssMaterial = bssrdf.getMaterial();
     const scene_rdl2::rdl2::EvalNormalFunc evalSubsurfaceNormal = bssrdf.getEvalNormalFunc();
     bool validInputNormal = sssMaterial && evalSubsurfaceNormal;
 
+    // get trace set for sss
+    auto geomTls = pbrTls->mTopLevelTls->mGeomTls.get();
+    geomTls->mSubsurfaceTraceSet = bssrdf.getTraceSet();
+
+    // default material for trace set
+    const scene_rdl2::rdl2::Material* isectMaterial = isect.getMaterial();
+    const int probeMaterialId = isectMaterial ?
+        isectMaterial->get<const shading::Material>().getMaterialId() : -1;
+
+    // Step 1 - Draw all the probe rays of this shading point, so they can be
+    // traced together rather than one Embree query each
+    Ray *probeRays = arena->allocArray<Ray>(subsurfaceSplitFactor, CACHE_LINE_SIZE);
+    Ray **probeRayPtrs = arena->allocArray<Ray *>(subsurfaceSplitFactor);
+    scene_rdl2::math::Vec3f *probeDirections =
+        arena->allocArray<scene_rdl2::math::Vec3f>(subsurfaceSplitFactor);
+    int numProbes = 0;
+
     for (int sampleIndex = 0; sampleIndex < subsurfaceSplitFactor; sampleIndex++) {
 
         // Draw a low discrepancy sample
         float sample[2];
         bssrdfLocalSamples.getSample(sample, pv.nonMirrorDepth);
 
-        // Step 1 - Select a projection axis & remap the random number to be
+        // Select a projection axis & remap the random number to be
         // in [0,1) Axis of Projection
         scene_rdl2::math::Vec3f directionProj;
         int axisIndex = bssrdfSelectAxisAndRemapSample(
@@ -729,34 +807,41 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         search = scene_rdl2::math::max(search, minRadius);
         scene_rdl2::math::Vec3f originProj = PiTangent - directionProj * search;
 
-        shading::Intersection isectProj;
-        Ray rayProj(originProj,
+        Ray *rayProj = new (&probeRays[numProbes]) Ray(originProj,
                     directionProj,
                     0.0f,
                     2.0f * search,
                     ray.getTime(),
                     ray.getDepth() + 1);
+        rayProj->ext.geomTls = (void*)geomTls;
+        rayProj->ext.materialID = probeMaterialId;
 
-        // get trace set for sss
-        auto geomTls = pbrTls->mTopLevelTls->mGeomTls.get();
-        geomTls->mSubsurfaceTraceSet = bssrdf.getTraceSet();
-        rayProj.ext.geomTls = (void*)geomTls;
+        probeRayPtrs[numProbes] = rayProj;
+        probeDirections[numProbes] = directionProj;
+        ++numProbes;
+    }
 
-        // set default material for trace set;
-        const scene_rdl2::rdl2::Material* isectMaterial = isect.getMaterial();
-        if (isectMaterial) {
-            const shading::Material *materialExt =
-                &isectMaterial->get<const shading::Material>();
-            rayProj.ext.materialID = materialExt->getMaterialId();
-        }
+    // Step 2 - Project them onto the nearby surfaces
+    // TODO: We need position and normal only in the intersection
+    shading::Intersection *probeIsects =
+        arena->allocArray<shading::Intersection>(subsurfaceSplitFactor, CACHE_LINE_SIZE);
+    bool *probeHits = arena->allocArray<bool>(subsurfaceSplitFactor);
+    for (int probeIndex = 0; probeIndex < numProbes; ++probeIndex) {
+        new (&probeIsects[probeIndex]) shading::Intersection();
+    }
+    scene->intersectRays(pbrTls->mTopLevelTls, numProbes, probeRayPtrs,
+        probeIsects, probeHits, lobeType);
 
-        // TODO: We need position and normal only in the intersection
-        bool intersected = scene->intersectRay(pbrTls->mTopLevelTls, rayProj,
-            isectProj, lobeType);
+    // Step 3 - Evaluate the Bssrdf at the projected points
+    for (int probeIndex = 0; probeIndex < numProbes; ++probeIndex) {
+
+        Ray &rayProj = probeRays[probeIndex];
+        shading::Intersection &isectProj = probeIsects[probeIndex];
+        const scene_rdl2::math::Vec3f &directionProj = probeDirections[probeIndex];
 
         const scene_rdl2::rdl2::Material* isectProjMaterial = isectProj.getMaterial();
 
-        if (!intersected || isectProj.getMaterial() == nullptr) {
+        if (!probeHits[probeIndex] || isectProjMaterial == nullptr) {
             continue;
         }
         geom::initIntersectionPhase2(isectProj,
@@ -803,7 +888,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         // position is still within maxRadius, otherwise this may clash
         // with light culling (see where the lightSet is computed).
         scene_rdl2::math::Vec3f dp = P - PiProj;
-        r = dp.length();
+        const float r = dp.length();
         if (r > maxRadius) {
             continue;
         }
@@ -824,14 +909,13 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         ssAov += pt;
 
         // Collect this sample
-        SubsurfaceSample s;
+        SubsurfaceSample &s = subsurfaceSamples[numSubsurfaceSamples++];
         s.mP             = PiProj;
         s.mN             = NiProjMap;
         s.mNg            = isectProj.getNg();
         s.mdNdx          = isectProj.getdNdx();
         s.mdNdy          = isectProj.getdNdy();
         s.mBssrdfEval    = pt;
-        subsurfaceSamples.push_back(std::move(s));
     }
 
     // DiffuseReflectance Integral
@@ -849,7 +933,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
         int computeRadianceSplitFactor = 1;
     #endif
 
-    for (size_t i = 0; i < subsurfaceSamples.size(); ++i) {
+    for (int i = 0; i < numSubsurfaceSamples; ++i) {
         // Compute the direct irradiance for this sample
         // TODO: compute woiProj
         shading::BsdfSlice sliceLocal(subsurfaceSamples[i].mNg, slice.getWo(), true, true,
@@ -865,7 +949,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
             subsurfaceSamples[i].mP, subsurfaceSamples[i].mN,
             subsurfaceSplitFactor, computeRadianceSplitFactor, i,
             doIndirect, rayEpsilon, shadowRayEpsilon, sssSampleID,
-            sequenceID, true, aovs, isect);
+            sequenceID, true, aovs, isect, rs);
         RAYDB_SET_CONTRIBUTION(pbrTls, radiance / pv.pathThroughput);
     }
 
@@ -873,7 +957,7 @@ PathIntegrator::computeRadianceDiffusionSubsurface(pbr::TLState *pbrTls,
     radiance += computeDiffusionForwardScattering(pbrTls, bsdf, sp, pv, ray,
         isect, slice, transmissionFresnel, scaleFresnelWo, lightSet, bssrdf,
         P, N, localF, subsurfaceSplitFactor, doIndirect, rayEpsilon, shadowRayEpsilon,
-        sssSampleID, sequenceID, ssAov, aovs);
+        sssSampleID, sequenceID, ssAov, aovs, rs);
 
     return radiance;
 }
@@ -887,7 +971,8 @@ PathIntegrator::computeDiffusionForwardScattering(pbr::TLState *pbrTls, const Bs
         const Bssrdf &bssrdf, const scene_rdl2::math::Vec3f &P, const scene_rdl2::math::Vec3f &N,
         const scene_rdl2::math::ReferenceFrame &localF, int subsurfaceSplitFactor,
         bool doIndirect, float rayEpsilon, float shadowRayEpsilon,
-        unsigned sssSampleID, unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs) const
+        unsigned sssSampleID, unsigned &sequenceID, scene_rdl2::math::Color &ssAov, float *aovs,
+        const RayState *rs) const
 {
     scene_rdl2::math::Color radiance = scene_rdl2::math::sBlack;
     const Scene *scene = MNRY_VERIFY(pbrTls->mFs->mScene);
@@ -1045,7 +1130,7 @@ PathIntegrator::computeDiffusionForwardScattering(pbr::TLState *pbrTls, const Bs
             pt, transmissionFresnel, lightSet, lobeGlobal, sliceGlobal,
             Pi, NiMap, subsurfaceSplitFactor, computeRadianceSplitFactor,
             sampleIndex, doIndirect, rayEpsilon, shadowRayEpsilon,
-            sssSampleID, sequenceID, false, aovs, isect);
+            sssSampleID, sequenceID, false, aovs, isect, rs);
 
         RAYDB_SET_CONTRIBUTION(pbrTls, radiance / pv.pathThroughput);
     }
@@ -1231,7 +1316,7 @@ PathIntegrator::computeRadiancePathTraceSubsurface(pbr::TLState* pbrTls,
         const RayDifferential& ray, const Intersection& isect,
         const VolumeSubsurface& volumeSubsurface, const LightSet& lightSet,
         bool doIndirect, float rayEpsilon, float shadowRayEpsilon, unsigned &sequenceID,
-        scene_rdl2::math::Color &ssAov, float* aovs) const
+        scene_rdl2::math::Color &ssAov, float* aovs, const RayState *rs) const
 {
     scene_rdl2::math::Color radiance(0.0f);
     // Check if samples are zero OR
@@ -1485,7 +1570,7 @@ PathIntegrator::computeRadiancePathTraceSubsurface(pbr::TLState* pbrTls,
                     pbrTls, bsdf, sp, pv, ray, isectOut.getdNdx(), isectOut.getdNdy(),
                     pt, transmissionFresnel, lightSet, lobeLocal, sliceLocal, pOut, nOut,
                     nSubsurfaceSample, 1, s, doIndirect,  rayEpsilon, shadowRayEpsilon,
-                    sequenceID, sequenceID, true, aovs, isect);
+                    sequenceID, sequenceID, true, aovs, isect, rs);
             }
         }
 
@@ -1700,7 +1785,7 @@ PathIntegrator::computeRadiancePathTraceSubsurface(pbr::TLState* pbrTls,
             pbrTls, bsdf, sp, pv, ray, isectOut.getdNdx(), isectOut.getdNdy(),
             pt, transmissionFresnel, lightSet, lobeLocal, sliceLocal, pOut, nOut,
             nSubsurfaceSample, 1, s, doIndirect,  rayEpsilon, shadowRayEpsilon,
-            sequenceID, sequenceID, true, aovs, isect);
+            sequenceID, sequenceID, true, aovs, isect, rs);
 
     }
 
@@ -7,6 +7,7 @@
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/geom/IntersectionInit.h>
 #include <moonray/rendering/geom/prim/BVHUserData.h>
+#include <moonray/rendering/geom/prim/GeomTLState.h>
 #include <moonray/rendering/geom/prim/NamedPrimitive.h>
 #include <moonray/rendering/mcrt_common/Ray.h>
 #include <moonray/rendering/mcrt_common/SOAUtil.h>
@@ -342,90 +343,126 @@ void chooseLightsToSample(float* lightSelectionPdfs, const LightSetSampler& lSam
                       lSampler.getLightSet().getLightIdMap(), pv.nonMirrorDepth);
 }
 
-finline void
-integrateLightSetSample(const LightSetSampler &lSampler,
+// Computes the tentative contributions (omitting shadowing) of the count light
+// samples drawn from a light, using multiple importance sampling with all the
+// matching lobes. Each lobe evaluates all the directions it sees in a single
+// evalBatch() call, and the path guide pdf, which doesn't depend on the lobe,
+// is looked up once per sample.
+static void
+integrateLightSetSamples(pbr::TLState *pbrTls, const LightSetSampler &lSampler,
         int lightIndex, const BsdfSampler &bSampler,
-        const PathVertex &pv, LightSample &lsmp,
+        const PathVertex &pv, LightSample *lsmp, int count,
         int clampingDepth, float clampingValue, const scene_rdl2::math::Vec3f &P)
 {
-    // Mark the sample valid only if we have valid lobe contributions and
-    // initialize contribution for summing
-    bool isInvalid = true;
-    lsmp.t = scene_rdl2::math::sBlack;
+    scene_rdl2::alloc::Arena *arena = pbrTls->mArena;
+    SCOPED_MEM(arena);
 
     const float ni = static_cast<const float>(lSampler.getLightSampleCount());
 
-    const scene_rdl2::math::Color factor = pv.pathThroughput * lsmp.Li * (1.0f / (ni * lsmp.pdf));
-
-    // Integrate with all the matching lobes
     const shading::BsdfSlice &slice = bSampler.getBsdfSlice();
-    shading::BsdfLobe::Type flags = slice.getSurfaceFlags(bSampler.getBsdf(), lsmp.wi);
+    const shading::Bsdf &bsdf = bSampler.getBsdf();
+    const PathGuide &pg = bSampler.getPathGuide();
     const int lobeCount = bSampler.getLobeCount();
     MNRY_ASSERT(lobeCount > 0);
 
-    // initialize lpe member, setting each lobe entry to a null value
-    for (unsigned k = 0; k < shading::Bsdf::maxLobes; ++k) lsmp.lp.lobe[k] = nullptr;
+    shading::BsdfLobe::Type *flags = arena->allocArray<shading::BsdfLobe::Type>(count);
+    scene_rdl2::math::Color *factor = arena->allocArray<scene_rdl2::math::Color>(count);
+    float *pgPdf = arena->allocArray<float>(count);
+    bool *hasContribution = arena->allocArray<bool>(count);
+    int *sampleIndex = arena->allocArray<int>(count);
+    scene_rdl2::math::Vec3f *wi = arena->allocArray<scene_rdl2::math::Vec3f>(count);
+    scene_rdl2::math::Color *f = arena->allocArray<scene_rdl2::math::Color>(count);
+    float *pdf = arena->allocArray<float>(count);
+
+    // Initialize contributions for summing, the samples are marked valid only
+    // if we have valid lobe contributions.
+    for (int i = 0; i < count; ++i) {
+        hasContribution[i] = false;
+        if (lsmp[i].isInvalid()) {
+            continue;
+        }
+        lsmp[i].t = scene_rdl2::math::sBlack;
+        // initialize lpe member, setting each lobe entry to a null value
+        for (unsigned k = 0; k < shading::Bsdf::maxLobes; ++k) lsmp[i].lp.lobe[k] = nullptr;
 
+        factor[i] = pv.pathThroughput * lsmp[i].Li * (1.0f / (ni * lsmp[i].pdf));
+        flags[i] = slice.getSurfaceFlags(bsdf, lsmp[i].wi);
+        pgPdf[i] = pg.canSample() ? pg.getPdf(P, lsmp[i].wi) : 0.0f;
+    }
+
+    const Light* light = lSampler.getLight(lightIndex);
     for (int k = 0; k < lobeCount; ++k) {
         const shading::BsdfLobe* const lobe = bSampler.getLobe(k);
-        // TODO: Should we still go through MIS calculations if
-        //  !lobe->matchesFlags(flags)
-        if (!lobe->matchesFlags(flags)) {
-            continue;
-        }
 
         // skip lobe if light is marked as not visible from this lobe
         int lobeMask = lobeTypeToRayMask(lobe->getType());
-        const Light* light = lSampler.getLight(lightIndex);
         if (!(lobeMask & light->getVisibilityMask())) {
             continue;
         }
 
-        // Evaluate the lobe
+        // Gather the directions this lobe integrates
         // TODO: Should we still go through MIS calculations if
-        // isSampleInvalid() because of pdf = 0
-        float pdf;
-        scene_rdl2::math::Color f;
-        // Pdf computation needs to be kept in sync with BsdfSampler::sample()
-        // Skip path guiding on mirror lobes, because their
-        // sample direction is already precisely determined.
-        const PathGuide &pg = bSampler.getPathGuide();
-        if (pg.canSample() && !(lobe->getType() & shading::BsdfLobe::MIRROR)) {
-            const float u = pg.getPercentage();
-            const float pgPdf = pg.getPdf(P, lsmp.wi);
-            f = lobe->eval(slice, lsmp.wi, &pdf);
-            // blending pdf values seems to work well enough in practice, and
-            // allows for a potential user percentage control.
-            pdf = u * pgPdf + (1.0 - u) * pdf;
-        } else {
-            f = lobe->eval(slice, lsmp.wi, &pdf);
+        //  !lobe->matchesFlags(flags)
+        int numDirs = 0;
+        for (int i = 0; i < count; ++i) {
+            if (!lsmp[i].isInvalid() && lobe->matchesFlags(flags[i])) {
+                sampleIndex[numDirs] = i;
+                wi[numDirs] = lsmp[i].wi;
+                ++numDirs;
+            }
         }
-        if (isSampleInvalid(f, pdf)) {
+        if (numDirs == 0) {
             continue;
         }
 
-        // Direct lighting tentative contribution (omits shadowing)
-        // using multiple importance sampling:
+        // Evaluate the lobe
+        lobe->evalBatch(slice, numDirs, wi, f, pdf);
+
+        // Pdf computation needs to be kept in sync with BsdfSampler::sample()
+        // Skip path guiding on mirror lobes, because their
+        // sample direction is already precisely determined.
+        const bool usePathGuide = pg.canSample() && !(lobe->getType() & shading::BsdfLobe::MIRROR);
+        const float u = usePathGuide ? pg.getPercentage() : 0.0f;
         const float nk = static_cast<const float>(bSampler.getLobeSampleCount(k));
-        scene_rdl2::math::Color t = factor * f * powerHeuristic(ni * lsmp.misPdf, nk * pdf);
 
-        // Selective clamp of t with clampingValue
-        if (pv.nonMirrorDepth >= clampingDepth) {
-            t = smartClamp(t, clampingValue);
-        }
+        for (int j = 0; j < numDirs; ++j) {
+            const int i = sampleIndex[j];
+            float lobePdf = pdf[j];
+            if (usePathGuide) {
+                // blending pdf values seems to work well enough in practice, and
+                // allows for a potential user percentage control.
+                lobePdf = u * pgPdf[i] + (1.0 - u) * lobePdf;
+            }
+            // TODO: Should we still go through MIS calculations if
+            // isSampleInvalid() because of pdf = 0
+            if (isSampleInvalid(f[j], lobePdf)) {
+                continue;
+            }
+
+            // Direct lighting tentative contribution (omits shadowing)
+            // using multiple importance sampling:
+            scene_rdl2::math::Color t = factor[i] * f[j] * powerHeuristic(ni * lsmp[i].misPdf, nk * lobePdf);
+
+            // Selective clamp of t with clampingValue
+            if (pv.nonMirrorDepth >= clampingDepth) {
+                t = smartClamp(t, clampingValue);
+            }
 
-        lsmp.t += t;
+            lsmp[i].t += t;
 
-        // save off per-lobe t info, we'll need these for LPEs
-        MNRY_ASSERT(k < static_cast<int>(shading::Bsdf::maxLobes));
-        lsmp.lp.t[k] = t;
-        lsmp.lp.lobe[k] = lobe;
+            // save off per-lobe t info, we'll need these for LPEs
+            MNRY_ASSERT(k < static_cast<int>(shading::Bsdf::maxLobes));
+            lsmp[i].lp.t[k] = t;
+            lsmp[i].lp.lobe[k] = lobe;
 
-        isInvalid = false;
+            hasContribution[i] = true;
+        }
     }
 
-    if (isInvalid) {
-        lsmp.setInvalid();
+    for (int i = 0; i < count; ++i) {
+        if (!hasContribution[i]) {
+            lsmp[i].setInvalid();
+        }
     }
 }
 
@@ -553,11 +590,12 @@ drawLightSamples(pbr::TLState *pbrTls, const LightSetSampler &lSampler, const Bs
         lsmp[i].misPdf = lsmp[i].pdf;
         lsmp[i].pdf *= lightSelectionPdf;
 
-        integrateLightSetSample(lSampler, lightIndex, bSampler, pv, lsmp[i],
-            clampingDepth, clampingValue, P);
-
         stats.incCounter(STATS_LIGHT_SAMPLES);
     }
+
+    // Integrate all the valid samples of the light with the bsdf at once.
+    integrateLightSetSamples(pbrTls, lSampler, lightIndex, bSampler, pv, lsmp, lightSampleCount,
+        clampingDepth, clampingValue, P);
 }
 
 
@@ -599,6 +637,23 @@ applyRussianRoulette(const BsdfSampler &bSampler, BsdfSample *bsmp,
     }
 }
 
+namespace {
+
+void
+reweightLightSample(LightSample &lsmp, float invContinueProbability)
+{
+    lsmp.t *= invContinueProbability;
+
+    // adjust per lobe values, if needed (see integrateLightSetSamples())
+    for (unsigned int k = 0; k < shading::Bsdf::maxLobes; ++k) {
+        if (lsmp.lp.lobe[k]) {
+            lsmp.lp.t[k] *= invContinueProbability;
+        }
+    }
+}
+
+} // namespace
+
 void
 applyRussianRoulette(const LightSetSampler &lSampler, LightSample *lsmp,
         const Subpixel &sp, const PathVertex &pv, unsigned sequenceID,
@@ -619,21 +674,45 @@ applyRussianRoulette(const LightSetSampler &lSampler, LightSample *lsmp,
             if (lum < sample[0] * threshold) {
                 lsmp[s].setInvalid();
             } else {
-                const float invContinueProbability = threshold / lum;
-                lsmp[s].t *= invContinueProbability;
-
-                // adjust per lobe values, if needed (see integrateLightSetSample())
-                for (unsigned int k = 0; k < shading::Bsdf::maxLobes; ++k) {
-                    if (lsmp[s].lp.lobe[k]) {
-                        lsmp[s].lp.t[k] *= invContinueProbability;
-                    }
-                }
+                reweightLightSample(lsmp[s], threshold / lum);
             }
         }
 
     }
 }
 
+void
+applyShadowRayRoulette(pbr::TLState *pbrTls, const LightSetSampler &lSampler, LightSample *lsmp,
+        const PathVertex &pv, int lightIndex, float threshold, IntegratorSample1D& rrSamples)
+{
+    // Relative to the path throughput, so the camera hits are culled too
+    const float lumThreshold = threshold * luminance(pv.pathThroughput);
+    if (!(lumThreshold > 0.0f)) {
+        return;
+    }
+
+    const int sceneLightIndex = lSampler.getLight(lightIndex)->getSceneIndex();
+    const int lightSampleCount = lSampler.getLightSampleCount();
+    for (int s = 0; s < lightSampleCount; ++s) {
+        if (lsmp[s].isInvalid()) {
+            continue;
+        }
+
+        const float lum = luminance(lsmp[s].t);
+        if (lum < lumThreshold) {
+            float sample[1];
+            rrSamples.getSample(sample, pv.nonMirrorDepth);
+            if (lum < sample[0] * lumThreshold) {
+                lsmp[s].setInvalid();
+                pbrTls->mStatistics.incCounter(STATS_CULLED_SHADOW_RAYS);
+                pbrTls->mStatistics.incCulledShadowRays(sceneLightIndex);
+            } else {
+                reweightLightSample(lsmp[s], lumThreshold / lum);
+            }
+        }
+    }
+}
+
 void
 accumulateRayPresence(pbr::TLState *pbrTls,
                       const Light* light,
@@ -647,6 +726,8 @@ accumulateRayPresence(pbr::TLState *pbrTls,
 
     mcrt_common::ThreadLocalState *topLevelTls = pbrTls->mTopLevelTls;
     shading::TLState *shadingTls = topLevelTls->mShadingTls.get();
+    geom::internal::TLState *geomTls = topLevelTls->mGeomTls.get();
+    geom::internal::PresenceCache &presenceCache = geomTls->mPresenceCache;
     const Scene *scene = MNRY_VERIFY(pbrTls->mFs->mScene);
     const scene_rdl2::rdl2::Light* rdlLight = light->getRdlLight();
 
@@ -662,20 +743,42 @@ accumulateRayPresence(pbr::TLState *pbrTls,
             static_cast<const geom::internal::NamedPrimitive*>(userData->mPrimitive);
         const geom::internal::ShadowLinking* shadowLinking = primPtr->getShadowLinking(isect.getLayerAssignmentId());
         if (!shadowLinking || shadowLinking->canCastShadow(rdlLight)) {
-            // Finish setting up the intersection with the minimum needed to evaluate the material's
-            // presence
-            geom::initIntersectionPhase2(isect,
-                                         topLevelTls,
-                                         0, // mirrordepth
-                                         0, // glossydepth
-                                         0, // diffuseDepth
-                                         false, // subsurface allowed
-                                         scene_rdl2::math::Vec2f(0.0f, 0.0f), // minRoughness
-                                         -currentShadowRay.getDirection());
-            // get the presence value from the material
-            const scene_rdl2::rdl2::Material* material = isect.getMaterial()->asA<scene_rdl2::rdl2::Material>();
-            MNRY_ASSERT(material != nullptr);
-            float presence = shading::presence(material, shadingTls, shading::State(&isect));
+            // Reuse the presence an earlier shadow ray of this thread baked for
+            // the same cell of this primitive, which skips the intersection
+            // setup as well as the shader.
+            float *cached = nullptr;
+            bool isHit = false;
+            if (presenceCache.isEnabled()) {
+                cached = presenceCache.lookup(isect.getLayerAssignmentId(), currentShadowRay.ext.instance0OrLight,
+                                              currentShadowRay.geomID, currentShadowRay.primID,
+                                              currentShadowRay.instID, currentShadowRay.u, currentShadowRay.v,
+                                              isHit);
+                geomTls->mStatistics.incCounter(isHit ? geom::internal::STATS_PRESENCE_CACHE_HITS :
+                                                        geom::internal::STATS_PRESENCE_CACHE_MISSES);
+            }
+
+            float presence;
+            if (isHit) {
+                presence = *cached;
+            } else {
+                // Finish setting up the intersection with the minimum needed to evaluate the material's
+                // presence
+                geom::initIntersectionPhase2(isect,
+                                             topLevelTls,
+                                             0, // mirrordepth
+                                             0, // glossydepth
+                                             0, // diffuseDepth
+                                             false, // subsurface allowed
+                                             scene_rdl2::math::Vec2f(0.0f, 0.0f), // minRoughness
+                                             -currentShadowRay.getDirection());
+                // get the presence value from the material
+                const scene_rdl2::rdl2::Material* material = isect.getMaterial()->asA<scene_rdl2::rdl2::Material>();
+                MNRY_ASSERT(material != nullptr);
+                presence = shading::presence(material, shadingTls, shading::State(&isect));
+                if (cached) {
+                    *cached = presence;
+                }
+            }
             totalPresence += (1.0f - totalPresence) * presence;
         }
 
@@ -1057,7 +1160,7 @@ CPP_computeRadianceSubsurface(const PathIntegrator * pathIntegrator,
             pv.subsurfaceDepth += 1;
             radiance += pathIntegrator->computeRadianceDiffusionSubsurface(
                     pbrTls, bsdf, sp, pv, ray, isect, slice, *bssrdf, *lightSet,
-                    doIndirect[i], rayEpsilon[i], shadowRayEpsilon[i], sequenceID[i], ssAov, aovs);
+                    doIndirect[i], rayEpsilon[i], shadowRayEpsilon[i], sequenceID[i], ssAov, aovs, rs);
         }
         if (volumeSubsurface) {
             MNRY_ASSERT(!bssrdf); // else our depth count will be messed up
@@ -1067,7 +1170,7 @@ CPP_computeRadianceSubsurface(const PathIntegrator * pathIntegrator,
             pv.subsurfaceDepth += 1;
             radiance += pathIntegrator->computeRadiancePathTraceSubsurface(
                     pbrTls, bsdf, sp, pv, ray, isect, *volumeSubsurface, *lightSet,
-                    doIndirect[i], rayEpsilon[i], shadowRayEpsilon[i], sequenceID[i], ssAov, aovs);
+                    doIndirect[i], rayEpsilon[i], shadowRayEpsilon[i], sequenceID[i], ssAov, aovs, rs);
         }
 
         if (aovs) {
@@ -1332,6 +1435,47 @@ CPP_computeRadianceEmissiveRegionsBundled(const PathIntegrator *pathIntegrator,
     pbrTls->startIspcAccumulator();
 }
 
+void
+CPP_recordPathGuideRadianceBundled(const PathIntegrator *pathIntegrator,
+    PbrTLState *pbrTls, const uint32_t *rayStateIndices, const float *radiances,
+    int32_t lanemask)
+{
+    MNRY_ASSERT(pbrTls->isIntegratorAccumulatorRunning());
+    MNRY_ASSERT(pbrTls->isIspcAccumulatorRunning());
+
+    pbrTls->stopIspcAccumulator();
+
+    const PathGuide &pathGuide = pathIntegrator->getPathGuide();
+    RayState *baseRayState = indexToRayState(0);
+
+    for (unsigned i = 0; i < VLEN; ++i) {
+        if (!isActive(lanemask, i)) {
+            continue;
+        }
+
+        // Camera rays don't have a parent vertex to record at.
+        const RayState *rs = &baseRayState[rayStateIndices[i]];
+        const mcrt_common::RayDifferential &ray = rs->mRay;
+        if (ray.getDepth() == 0) {
+            continue;
+        }
+
+        const scene_rdl2::math::Color radiance(radiances[i],
+                                               radiances[VLEN + i],
+                                               radiances[VLEN * 2 + i]);
+        if (scene_rdl2::math::isBlack(radiance)) {
+            continue;
+        }
+
+        // The ray was transferred to the hit point, recover the vertex
+        // it was spawned from.
+        pathGuide.recordRadiance(ray.getOrigin() - ray.getDirection() * ray.getEnd(),
+                                 ray.getDirection(), radiance);
+    }
+
+    pbrTls->startIspcAccumulator();
+}
+
 void
 CPP_applyVolumeTransmittance(const PathIntegrator *pathIntegrator,
     PbrTLState *pbrTls, const uint32_t *rayStateIndices, int32_t lanemask)
@@ -277,6 +277,13 @@ void applyRussianRoulette(const LightSetSampler &lSampler, LightSample *lsmp,
         const Subpixel &sp, const PathVertex &pv, unsigned sequenceID,
         float threshold, IntegratorSample1D& rrSamples);
 
+// Russian roulette on the shadow rays of the light samples, at any depth.
+// Samples whose unoccluded contribution is below threshold times the path
+// throughput survive with a probability proportional to it and are reweighted,
+// so dim lights cast fewer shadow rays without biasing the result.
+void applyShadowRayRoulette(pbr::TLState *pbrTls, const LightSetSampler &lSampler, LightSample *lsmp,
+        const PathVertex &pv, int lightIndex, float threshold, IntegratorSample1D& rrSamples);
+
 void accumulateRayPresence(pbr::TLState *pbrTls,
                            const Light* light,
                            const mcrt_common::Ray& shadowRay,
@@ -369,6 +376,11 @@ void
 CPP_applyVolumeTransmittance(const PathIntegrator *pathIntegrator,
     PbrTLState *pbrTls, const uint32_t *rayStateIndices, int32_t lanemask);
 
+void
+CPP_recordPathGuideRadianceBundled(const PathIntegrator *pathIntegrator,
+    PbrTLState *pbrTls, const uint32_t *rayStateIndices, const float *radiances,
+    int32_t lanemask);
+
 void CPP_addRayQueueEntries(pbr::TLState *pbrTls, const RayStatev *rayStatesv,
                             unsigned numRayStates, const unsigned *indices);
 
@@ -311,8 +311,42 @@ PathIntegrator::integrateVolumeScattering(pbr::TLState *pbrTls, const mcrt_commo
     }
     scene_rdl2::math::Color LSingleScatter(0.0f);
     float invN = 1.0f / (samplesPerLight * scatterSampleCount);
+
+    // The volume light cache is keyed by the middle of the marched segment.
+    // While it records, all the lights are evaluated and their contributions
+    // are accumulated in the cell. Once frozen, each light is evaluated with
+    // its selection probability for the cell and weighted by the inverse.
+    const bool recordLightImportance = mVolumeLightCache.isRecording();
+    const float *lightProbabilities = nullptr;
+    scene_rdl2::math::Vec3f cachePosition(0.0f);
+    float invThroughputLuminance = 0.0f;
+    if (mVolumeLightCache.isEnabled()) {
+        const auto& firstVp = volumeProperties[0];
+        const auto& lastVp = volumeProperties[densityDistribution.getSize() - 1];
+        cachePosition = ray.org + ray.dir *
+            (0.5f * (firstVp.mTStart + lastVp.mTStart + lastVp.mDelta));
+        if (recordLightImportance) {
+            const float throughputLuminance = scene_rdl2::math::luminance(pv.pathThroughput);
+            invThroughputLuminance = throughputLuminance > 0.0f ? 1.0f / throughputLuminance : 0.0f;
+        } else {
+            lightProbabilities = mVolumeLightCache.getProbabilities(cachePosition);
+        }
+    }
+
     for (int lightIndex = 0; lightIndex < lightCount; ++lightIndex) {
         const Light* light = scene->getLight(lightIndex);
+        float lightInvN = invN;
+        if (lightProbabilities && lightProbabilities[lightIndex] < 1.0f) {
+            VolumeScatterEventSampler lightSelectionSampler(sp, pv, 1,
+                highQualitySample, SequenceType::IndexSelection,
+                SequenceType::Light, sequenceID, SequenceType::Light,
+                lightIndex);
+            if (lightSelectionSampler.getSample(pv.nonMirrorDepth) >=
+                lightProbabilities[lightIndex]) {
+                continue;
+            }
+            lightInvN /= lightProbabilities[lightIndex];
+        }
         // equi-angular sampling is not effective for infinite lights
         // no eqi-angular sampling for deep volumes
         bool doEquiAngular = light->isBounded() && !deepParams;
@@ -349,7 +383,7 @@ PathIntegrator::integrateVolumeScattering(pbr::TLState *pbrTls, const mcrt_commo
                     float tb = lastVp.mTStart + lastVp.mDelta - offset;
                     thetaA = scene_rdl2::math::atan2(ta, D);
                     thetaB = scene_rdl2::math::atan2(tb, D);
-                    scene_rdl2::math::Color contribution = invN * pv.pathThroughput *
+                    scene_rdl2::math::Color contribution = lightInvN * pv.pathThroughput *
                         equiAngularVolumeScattering(
                         pbrTls, ray, lightIndex, ue, uel, uelFilter, D,
                         thetaA, thetaB, offset, volumeProperties,
@@ -368,7 +402,7 @@ PathIntegrator::integrateVolumeScattering(pbr::TLState *pbrTls, const mcrt_commo
                 scene_rdl2::math::Color radiance;
                 scene_rdl2::math::Color transmittance;
 
-                scene_rdl2::math::Color contribution = invN * pv.pathThroughput *
+                scene_rdl2::math::Color contribution = lightInvN * pv.pathThroughput *
                     distanceVolumeScattering(
                     pbrTls, ray, lightIndex, ud, udl, udlFilter, D,
                     thetaA, thetaB, offset, volumeProperties,
@@ -377,7 +411,7 @@ PathIntegrator::integrateVolumeScattering(pbr::TLState *pbrTls, const mcrt_commo
                 LDirect += contribution;
 
                 if (deepParams) {
-                    scene_rdl2::math::Color deepContribution = radiance * invN;
+                    scene_rdl2::math::Color deepContribution = radiance * lightInvN;
                     if (deepParams->mVolumeAovs) {
                         const FrameState &fs = *pbrTls->mFs;
                         const LightAovs &lightAovs = *fs.mLightAovs;
@@ -402,6 +436,10 @@ PathIntegrator::integrateVolumeScattering(pbr::TLState *pbrTls, const mcrt_commo
             }
         }
         LSingleScatter += LDirect;
+        if (recordLightImportance) {
+            mVolumeLightCache.record(cachePosition, lightIndex,
+                scene_rdl2::math::luminance(LDirect) * invThroughputLuminance);
+        }
         // LPE
         if (pbrTls->mFs->mLightAovs->hasEntries() && (aovs || rs)) {
             EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
@@ -453,10 +491,17 @@ collectVolumeIntervals(pbr::TLState *pbrTls, const mcrt_common::Ray& ray, int ra
         return 0;
     }
 
+    Statistics &stats = pbrTls->mStatistics;
+    stats.incCounter(STATS_VOLUME_INTERVAL_RAYS);
+    stats.addToCounter(STATS_VOLUME_INTERVALS, intervalCount);
+
     geom::internal::VolumeTransition* intervals = volumeRayState.getVolumeIntervals();
-    // sort the volume intervals
-    intervals = scene_rdl2::util::smartSort32<geom::internal::VolumeTransition>(
-            intervalCount, intervals, 0xffffffff, arena);
+    // the intervals are sorted as they are added, unless there are too many
+    if (!volumeRayState.areIntervalsSorted()) {
+        stats.incCounter(STATS_VOLUME_INTERVAL_SORTS);
+        intervals = scene_rdl2::util::smartSort32<geom::internal::VolumeTransition>(
+                intervalCount, intervals, 0xffffffff, arena);
+    }
 
     // Eliminate the spurious duplicate intersections which Embree generates
     intervalCount = std::unique(intervals, intervals + intervalCount) - intervals;
@@ -631,11 +676,47 @@ evalVolumeShaders(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
         const geom::internal::Primitive* prim = volumeRayState.getCurrentVolumeRegions().getPrimitive(volumeIds[i]);
         isect.init(prim->getRdlGeometry());
         const scene_rdl2::math::Vec3f evalP = prim->evalVolumeSamplePosition(tls, volumeIds[i], p, time);
-        isect.setP(prim->transformVolumeSamplePosition(evalP, time));
+        const scene_rdl2::math::Vec3f renderP = prim->transformVolumeSamplePosition(evalP, time);
+        isect.setP(renderP);
         const shading::State state(&isect);
-        prim->evalVolumeCoefficients(tls, volumeIds[i], evalP,
-            &extinction, &albedo, temperaturePtr, highQuality, rayVolumeDepth, volumeShader);
-        scene_rdl2::math::Color sigmaTLocal = extinction;
+
+        // Reuse the results of an earlier evaluation of this thread in the
+        // same cell. Intervals evaluated once for their whole depth, and
+        // moving volumes whose lookups depend on the time, always evaluate.
+        geom::internal::VolumeShaderCache& shaderCache = tls->mGeomTls->mVolumeShaderCache;
+        geom::internal::VolumeShaderCache::Result* cached = nullptr;
+        if (shaderCache.isEnabled() && rayVolumeDepth < 0.0f && sampleInfo.getFeatureSize() > 0.0f &&
+            !prim->isMotionBlurOn() && evalP == p) {
+            bool isHit;
+            cached = shaderCache.lookup(volumeIds[i], renderP, 0.5f * sampleInfo.getFeatureSize(), isHit);
+            isHit &= (!temperaturePtr || cached->mHasEmission);
+            tls->mGeomTls->mStatistics.incCounter(isHit ? geom::internal::STATS_VOLUME_SHADER_CACHE_HITS :
+                                                          geom::internal::STATS_VOLUME_SHADER_CACHE_MISSES);
+            if (!isHit) {
+                prim->evalVolumeCoefficients(tls, volumeIds[i], evalP,
+                    &extinction, &albedo, temperaturePtr, highQuality, rayVolumeDepth, volumeShader);
+                cached->mExtinction = extinction;
+                cached->mAlbedo = volumeShader->albedo(shadingTls, state, albedo, rayVolumeDepth);
+                cached->mAnisotropy = volumeShader->anisotropy(shadingTls, state);
+                cached->mHasEmission = (temperaturePtr != nullptr);
+                if (temperaturePtr) {
+                    cached->mEmission = volumeShader->emission(shadingTls, state, temperature);
+                }
+            }
+        } else {
+            prim->evalVolumeCoefficients(tls, volumeIds[i], evalP,
+                &extinction, &albedo, temperaturePtr, highQuality, rayVolumeDepth, volumeShader);
+        }
+        auto shaderAlbedo = [&]() -> scene_rdl2::math::Color {
+            return cached ? cached->mAlbedo : volumeShader->albedo(shadingTls, state, albedo, rayVolumeDepth);
+        };
+        auto shaderAnisotropy = [&]() -> float {
+            return cached ? cached->mAnisotropy : volumeShader->anisotropy(shadingTls, state);
+        };
+        auto shaderEmission = [&]() -> scene_rdl2::math::Color {
+            return cached ? cached->mEmission : volumeShader->emission(shadingTls, state, temperature);
+        };
+        scene_rdl2::math::Color sigmaTLocal = cached ? cached->mExtinction : extinction;
 
         switch (overlapMode) {
         case VolumeOverlapMode::RND:
@@ -644,16 +725,16 @@ evalVolumeShaders(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
                 // build a cdf with sigmaT
                 sigmaTSum += sigmaTLocal;
                 cdf[i] = scene_rdl2::math::luminance(sigmaTSum);
-                scene_rdl2::math::Color scatter(volumeShader->albedo(shadingTls, state, albedo, rayVolumeDepth) * sigmaTLocal);
+                scene_rdl2::math::Color scatter(shaderAlbedo() * sigmaTLocal);
                 if (!isCutout) {
                     sigmaTs[i] = sigmaTLocal;
                     sigmaThs[i] = scene_rdl2::math::Color(0.f);
                     sigmaSs[i] = scatter;
                     sigmaShs[i] = scene_rdl2::math::Color(0.f);
                     if (emission) {
-                        emissions[i] = volumeShader->emission(shadingTls, state, temperature);
+                        emissions[i] = shaderEmission();
                     }
-                    anisotropies[i] = scatter * volumeShader->anisotropy(shadingTls, state);
+                    anisotropies[i] = scatter * shaderAnisotropy();
                 } else {
                     sigmaTs[i] = scene_rdl2::math::Color(0.f);
                     sigmaThs[i] = sigmaTLocal;
@@ -674,16 +755,16 @@ evalVolumeShaders(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
                 const float sigmaTLumLocal = scene_rdl2::math::luminance(sigmaTLocal);
                 if (sigmaTLumLocal > maxSigmaTLum) {
                     maxSigmaTLum = sigmaTLumLocal;
-                    scene_rdl2::math::Color scatter(volumeShader->albedo(shadingTls, state, albedo, rayVolumeDepth) * sigmaTLocal);
+                    scene_rdl2::math::Color scatter(shaderAlbedo() * sigmaTLocal);
                     if (!isCutout) {
                         *sigmaT = sigmaTLocal;
                         *sigmaTh = scene_rdl2::math::Color(0.f);
                         *sigmaS = scatter;
                         *sigmaSh = scene_rdl2::math::Color(0.f);
                         if (emission) {
-                            *emission = volumeShader->emission(shadingTls, state, temperature);
+                            *emission = shaderEmission();
                         }
-                        anisotropy = scatter * volumeShader->anisotropy(shadingTls, state);
+                        anisotropy = scatter * shaderAnisotropy();
                     } else {
                         *sigmaT = scene_rdl2::math::Color(0.f);
                         *sigmaTh = sigmaTLocal;
@@ -702,15 +783,15 @@ evalVolumeShaders(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
         case VolumeOverlapMode::SUM:
             // old behavior
             {
-                scene_rdl2::math::Color scatter(volumeShader->albedo(shadingTls, state, albedo, rayVolumeDepth) * sigmaTLocal);
+                scene_rdl2::math::Color scatter(shaderAlbedo() * sigmaTLocal);
 
                 if (!isCutout) {
                     *sigmaT += sigmaTLocal;
                     *sigmaS += scatter;
                     if (emission) {
-                        emission[volumeIds[i]] = volumeShader->emission(shadingTls, state, temperature);
+                        emission[volumeIds[i]] = shaderEmission();
                     }
-                    anisotropy += scatter * volumeShader->anisotropy(shadingTls, state);
+                    anisotropy += scatter * shaderAnisotropy();
                 } else {
                     *sigmaTh += sigmaTLocal;
                     *sigmaSh += scatter;
@@ -901,6 +982,73 @@ evalSigmaT(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
     return sigmaT;
 }
 
+// Ratio tracking estimate of the transmittance from t0 to t1 (Novak et al. 14
+// "Residual Ratio Tracking for Estimating Attenuation in Participating Media").
+// Tentative collisions are drawn with the majorant of the cells of the
+// primitives' majorant grids the ray is in, and the transmittance is scaled by
+// the probability of each collision being a null one. The density is only
+// looked up at the collisions. Returns false, without estimating anything, if
+// one of the volume regions can't bound its density.
+static bool
+ratioTrackingTransmittance(pbr::TLState *pbrTls, int volumeRegionsCount, int* volumeIds,
+        VolumeOverlapMode overlapMode, const geom::internal::VolumeRegions& volumeRegions,
+        const std::vector<geom::internal::VolumeSampleInfo>& volumeSampleInfo,
+        float t0, float t1, float time, const IntegratorSample1D& trSamples,
+        float tauThreshold, const Light* light, float scaleFactor,
+        scene_rdl2::math::Color& tr, unsigned& lookupCount)
+{
+    MNRY_ASSERT(overlapMode != VolumeOverlapMode::RND);
+
+    const float trThreshold = scene_rdl2::math::exp(-tauThreshold);
+    tr = scene_rdl2::math::Color(1.0f);
+    float t = t0;
+    while (t < t1) {
+        // Combine the majorants of the overlapping regions the same way
+        // evalSigmaT() combines their densities.
+        float majorant = 0.0f;
+        float tExit = t1;
+        for (int i = 0; i < volumeRegionsCount; ++i) {
+            const geom::internal::VolumeSampleInfo& sampleInfo = volumeSampleInfo[volumeIds[i]];
+            if (!(sampleInfo.getProperties() & scene_rdl2::rdl2::VolumeShader::IS_EXTINCTIVE)) {
+                continue;
+            }
+            float tExitRegion;
+            const float majorantRegion = volumeRegions.getPrimitive(volumeIds[i])->getDensityMajorant(
+                sampleInfo.getSampleRayOrg(), sampleInfo.getSampleRayDir(), t, tExitRegion);
+            if (!scene_rdl2::math::isfinite(majorantRegion)) {
+                return false;
+            }
+            majorant = (overlapMode == VolumeOverlapMode::SUM) ?
+                majorant + majorantRegion : scene_rdl2::math::max(majorant, majorantRegion);
+            tExit = scene_rdl2::math::min(tExit, tExitRegion);
+        }
+        majorant *= scaleFactor;
+
+        if (majorant > 0.0f) {
+            const float invMajorant = 1.0f / majorant;
+            while (true) {
+                float u;
+                trSamples.getSample(&u, 0);
+                // exponential free flight, restarted at each cell boundary
+                t -= scene_rdl2::math::log(1.0f - u) * invMajorant;
+                if (t >= tExit) {
+                    break;
+                }
+                const scene_rdl2::math::Color sigmaT = evalSigmaT(pbrTls, volumeRegionsCount, volumeIds,
+                    overlapMode, 0.0f, volumeSampleInfo, t, time, light, -1);
+                ++lookupCount;
+                tr *= scene_rdl2::math::Color(1.0f) - sigmaT * (scaleFactor * invMajorant);
+                if (luminance(tr) <= trThreshold) {
+                    tr = scene_rdl2::math::Color(0.0f);
+                    return true;
+                }
+            }
+        }
+        t = tExit;
+    }
+    return true;
+}
+
 // Volume shader evaluation
 //==---------------------------------------------------------------------------
 
@@ -2444,9 +2592,23 @@ PathIntegrator::transmittanceSubinterval(pbr::TLState *pbrTls,
             volumeSampleInfo, t0, time, light, rayVolumeDepth);
         tr = exp(-sigmaT * (t1 - t0) * scaleFactor);
     } else {
-        // For now using traditional ray marching approach.
-        // Once we have the ability to query averge value on leaf node,
-        // we can potentially replace this with residual ratio tracking
+        pbrTls->mStatistics.incCounter(STATS_VOLUME_TRANSMITTANCE_SEGMENTS);
+
+        // Null scattering estimate when the regions bound their density,
+        // there is no such bound on the density "random" overlap picks.
+        if (mVolumeRatioTracking && mVolumeOverlapMode != VolumeOverlapMode::RND) {
+            unsigned lookupCount = 0;
+            const bool isTracked = ratioTrackingTransmittance(pbrTls, volumeRegionsCount, volumeIds,
+                mVolumeOverlapMode, volumeRegions, volumeSampleInfo, t0, t1, time, trSamples,
+                tauThreshold, light, scaleFactor, tr, lookupCount);
+            pbrTls->mStatistics.addToCounter(STATS_VOLUME_TRANSMITTANCE_LOOKUPS, lookupCount);
+            if (isTracked) {
+                return tr;
+            }
+            tr = scene_rdl2::math::Color(1.0f);
+        }
+
+        // Otherwise use the traditional ray marching approach.
 
         // figure out the step size: when there are multiple volume regions
         // in this interval, use the smallest feature size for stepping
@@ -2474,6 +2636,7 @@ PathIntegrator::transmittanceSubinterval(pbr::TLState *pbrTls,
             }
             scene_rdl2::math::Color sigmaT = evalSigmaT(pbrTls, volumeRegionsCount, volumeIds, mVolumeOverlapMode,
                                                         rndVal, volumeSampleInfo, t, time, light, -1);
+            pbrTls->mStatistics.incCounter(STATS_VOLUME_TRANSMITTANCE_LOOKUPS);
             tau += sigmaT;
             if (luminance(tau * stepSize * scaleFactor) > tauThreshold) {
                 return scene_rdl2::math::Color(0.0f);
@@ -0,0 +1,235 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file ShadingResultCache.h
+///
+
+#pragma once
+
+#include <moonray/rendering/mcrt_common/Ray.h>
+#include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+#include <scene_rdl2/render/util/Arena.h>
+#include <scene_rdl2/render/util/Memory.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace scene_rdl2 {
+namespace rdl2 {
+class Material;
+}
+}
+
+namespace moonray {
+
+namespace shading { class Bsdf; }
+
+namespace pbr {
+
+// ShadingResultCache keeps the Bsdfs the material shaders built for the camera
+// ray hits of one thread, so the pixel samples of later passes landing on the
+// same surface reuse them instead of running the shader again. Only the
+// lighting integration, which is where the noise comes from, is recomputed.
+// Entries are keyed by material, primitive and instance of the hit and by the
+// cell of a regular grid over the (u, v) parameterization of the primitive the
+// hit falls into, which turns the shading of camera rays into a piecewise
+// constant function at the cell size. View dependent shader inputs (ray
+// direction, ray time, ray differentials) are the ones of the first sample
+// landing in the cell.
+//
+// The Bsdfs, their lobes and whatever else the shader allocates live in the
+// cache's own arena rather than the per sample arena. Entries are evicted
+// least recently used within the set they hash to, but the arena can only be
+// reclaimed as a whole, so the whole cache is dropped once capacity entries
+// were built since it was last cleared. This bounds the memory to about
+// capacity shaded Bsdfs.
+//
+// One cache per render thread, no locking.
+class ShadingResultCache
+{
+public:
+    ShadingResultCache() :
+        mCapacity(0),
+        mCellResolution(0.0f),
+        mSetMask(0),
+        mClock(0),
+        mNumBuilt(0),
+        mArenaInitialized(false)
+    {
+    }
+
+    ShadingResultCache(const ShadingResultCache &) = delete;
+    ShadingResultCache &operator=(const ShadingResultCache &) = delete;
+
+    ~ShadingResultCache()
+    {
+        if (mArenaInitialized) {
+            mArena.cleanUp();
+        }
+    }
+
+    // capacity is the number of Bsdfs kept, rounded up to a power of two
+    // number of sets, 0 disables the cache. cellResolution is the number of
+    // cells along u and v of each primitive. Drops the cached results, the
+    // table itself is only allocated by the first lookup so threads which
+    // never shade a camera ray don't pay for it.
+    void setCapacity(size_t capacity, unsigned cellResolution)
+    {
+        mEntries.clear();
+        mEntries.shrink_to_fit();
+        mCapacity = capacity;
+        mCellResolution = static_cast<float>(scene_rdl2::math::max(cellResolution, 1u));
+        mSetMask = 0;
+        clear();
+    }
+
+    bool isEnabled() const { return mCapacity != 0; }
+
+    void clear()
+    {
+        for (Entry &entry : mEntries) {
+            entry.mLastUse = 0;
+        }
+        mClock = 0;
+        mNumBuilt = 0;
+        if (mArenaInitialized) {
+            mArena.clear();
+        }
+    }
+
+    // Returns the entry of the cell the hit of ray falls into. hit tells
+    // whether it holds the Bsdf of that cell, otherwise the entry was claimed
+    // for the cell and the caller is expected to shade into a Bsdf allocated
+    // from getArena() and store it there. A miss may drop the whole cache to
+    // reclaim the arena, so the caller must not hold on to Bsdfs returned by
+    // earlier lookups.
+    shading::Bsdf **lookup(const scene_rdl2::rdl2::Material *material, const mcrt_common::Ray &ray, bool &hit)
+    {
+        MNRY_ASSERT(isEnabled());
+
+        if (mEntries.empty()) {
+            allocate();
+        }
+
+        const Key key = { material, ray.ext.instance0OrLight, ray.geomID, ray.primID, ray.instID,
+                          toCell(ray.u), toCell(ray.v) };
+
+        Entry *set = &mEntries[(hash(key) & mSetMask) * sWays];
+        Entry *victim = set;
+        ++mClock;
+        for (int i = 0; i < sWays; ++i) {
+            Entry &entry = set[i];
+            if (entry.mLastUse != 0 && entry.mKey == key) {
+                entry.mLastUse = mClock;
+                hit = true;
+                return &entry.mBsdf;
+            }
+            if (entry.mLastUse < victim->mLastUse) {
+                victim = &entry;
+            }
+        }
+
+        if (mNumBuilt == mCapacity) {
+            clear();
+            ++mClock;
+            victim = set;
+        }
+        ++mNumBuilt;
+
+        victim->mKey = key;
+        victim->mLastUse = mClock;
+        victim->mBsdf = nullptr;
+        hit = false;
+        return &victim->mBsdf;
+    }
+
+    // Memory the Bsdfs of claimed entries are allocated from.
+    scene_rdl2::alloc::Arena *getArena()
+    {
+        if (!mArenaInitialized) {
+            mArena.init(MNRY_VERIFY(mcrt_common::getTLSInitParams().mArenaBlockPool));
+            mArenaInitialized = true;
+        }
+        return &mArena;
+    }
+
+    size_t getMemory() const
+    {
+        return scene_rdl2::util::getVectorElementsMemory(mEntries);
+    }
+
+private:
+    static constexpr int sWays = 4;
+
+    struct Key
+    {
+        const scene_rdl2::rdl2::Material *mMaterial;
+        const void *mInstance;
+        int32_t mGeomId, mPrimId, mInstId;
+        int32_t mU, mV;
+
+        bool operator==(const Key &other) const
+        {
+            return mMaterial == other.mMaterial && mInstance == other.mInstance &&
+                   mGeomId == other.mGeomId && mPrimId == other.mPrimId && mInstId == other.mInstId &&
+                   mU == other.mU && mV == other.mV;
+        }
+    };
+
+    struct Entry
+    {
+        Key mKey;
+        // 0 marks an empty entry
+        uint64_t mLastUse;
+        shading::Bsdf *mBsdf;
+    };
+
+    void allocate()
+    {
+        size_t numSets = 1;
+        while (numSets * sWays < mCapacity) {
+            numSets <<= 1;
+        }
+        mEntries.resize(numSets * sWays);
+        mSetMask = numSets - 1;
+        for (Entry &entry : mEntries) {
+            entry.mLastUse = 0;
+        }
+    }
+
+    int32_t toCell(float x) const
+    {
+        // barycentric coordinates stay within [0, 1], the clamp only guards
+        // against primitives with other parameterizations
+        return static_cast<int32_t>(scene_rdl2::math::clamp(scene_rdl2::math::floor(x * mCellResolution),
+                                                            -2.0e9f, 2.0e9f));
+    }
+
+    static uint32_t hash(const Key &key)
+    {
+        const uint64_t p = reinterpret_cast<uintptr_t>(key.mMaterial) ^
+                           reinterpret_cast<uintptr_t>(key.mInstance);
+        uint32_t h = uint32_t(key.mPrimId) * 2654435761u ^ uint32_t(key.mGeomId) * 73856093u ^
+                     uint32_t(key.mInstId) * 19349663u ^ uint32_t(key.mU) * 83492791u ^
+                     uint32_t(key.mV) * 40503u ^ uint32_t(p >> 4) ^ uint32_t(p >> 32);
+        h ^= h >> 16;
+        return h;
+    }
+
+    std::vector<Entry> mEntries;
+    size_t mCapacity;
+    float mCellResolution;
+    size_t mSetMask;
+    uint64_t mClock;
+    size_t mNumBuilt;
+    scene_rdl2::alloc::Arena mArena;
+    bool mArenaInitialized;
+};
+
+} // namespace pbr
+} // namespace moonray
+
@@ -0,0 +1,222 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file VolumeLightCache.cc
+
+#include "VolumeLightCache.h"
+
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/spin_mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace moonray {
+namespace pbr {
+
+using namespace scene_rdl2::math;
+
+namespace {
+
+constexpr int      sCoordBits = 21;
+constexpr uint64_t sCoordMask = (uint64_t(1) << sCoordBits) - 1;
+
+// Lower bound of the selection probabilities, so a light whose contribution
+// was missed while recording is still evaluated now and then.
+constexpr float    sMinProbability = 0.1f;
+
+// Bounds the memory used while recording, cells past this are dropped and
+// evaluate all the lights.
+constexpr size_t   sMaxCellsPerThread = 1 << 12;
+
+} // namespace
+
+class VolumeLightCache::Impl
+{
+public:
+    Impl() :
+        mInvCellSize(0.0f),
+        mLightCount(0),
+        mRecording(false),
+        mFreezeStarted(false),
+        mReady(false)
+    {
+    }
+
+    void startFrame(const BBox3f &bbox, unsigned resolution, int lightCount)
+    {
+        for (ThreadCells &cells : mThreadCells) {
+            cells.mCells.clear();
+        }
+        mCellOffsets.clear();
+        mProbabilities.clear();
+        mRecording = false;
+        mFreezeStarted = false;
+        mReady = false;
+
+        const Vec3f extent = bbox.size();
+        const float maxExtent = max(extent.x, max(extent.y, extent.z));
+        if (resolution == 0 || lightCount <= 1 || !(maxExtent > 0.0f)) {
+            mLightCount = 0;
+            return;
+        }
+
+        mOrigin = bbox.lower;
+        mInvCellSize = float(resolution) / maxExtent;
+        mLightCount = lightCount;
+        mRecording = true;
+    }
+
+    bool isEnabled() const { return mLightCount > 0; }
+
+    bool isRecording() const { return mRecording.load(std::memory_order_relaxed); }
+
+    void record(const Vec3f &p, int lightIndex, float contribution)
+    {
+        MNRY_ASSERT(lightIndex >= 0 && lightIndex < mLightCount);
+        if (!(contribution > 0.0f)) {
+            return;
+        }
+
+        const uint64_t key = getKey(p);
+        ThreadCells &cells = mThreadCells.local();
+        tbb::spin_mutex::scoped_lock lock(cells.mMutex);
+        auto it = cells.mCells.find(key);
+        if (it == cells.mCells.end()) {
+            if (cells.mCells.size() >= sMaxCellsPerThread) {
+                return;
+            }
+            it = cells.mCells.emplace(key, std::vector<float>(mLightCount, 0.0f)).first;
+        }
+        it->second[lightIndex] += contribution;
+    }
+
+    void freeze()
+    {
+        if (!isRecording() || mFreezeStarted.exchange(true)) {
+            return;
+        }
+        mRecording = false;
+
+        std::unordered_map<uint64_t, std::vector<float>> merged;
+        for (ThreadCells &cells : mThreadCells) {
+            tbb::spin_mutex::scoped_lock lock(cells.mMutex);
+            for (const auto &cell : cells.mCells) {
+                std::vector<float> &sum = merged[cell.first];
+                if (sum.empty()) {
+                    sum = cell.second;
+                } else {
+                    for (int i = 0; i < mLightCount; ++i) {
+                        sum[i] += cell.second[i];
+                    }
+                }
+            }
+        }
+
+        mProbabilities.reserve(merged.size() * mLightCount);
+        for (const auto &cell : merged) {
+            const float maxContribution = *std::max_element(cell.second.begin(), cell.second.end());
+            const float invMaxContribution = (maxContribution > 0.0f) ? 1.0f / maxContribution : 0.0f;
+            mCellOffsets[cell.first] = uint32_t(mProbabilities.size());
+            for (int i = 0; i < mLightCount; ++i) {
+                mProbabilities.push_back(clamp(cell.second[i] * invMaxContribution, sMinProbability, 1.0f));
+            }
+        }
+
+        mReady.store(true, std::memory_order_release);
+    }
+
+    const float *getProbabilities(const Vec3f &p) const
+    {
+        if (!mReady.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        const auto it = mCellOffsets.find(getKey(p));
+        return (it == mCellOffsets.end()) ? nullptr : &mProbabilities[it->second];
+    }
+
+private:
+    // The lock is only contended while the cells are merged.
+    struct ThreadCells
+    {
+        tbb::spin_mutex mMutex;
+        std::unordered_map<uint64_t, std::vector<float>> mCells;
+    };
+
+    uint64_t getKey(const Vec3f &p) const
+    {
+        const Vec3f c = (p - mOrigin) * mInvCellSize;
+        auto coord = [](float x) {
+            return uint64_t(clamp(x, 0.0f, float(sCoordMask)));
+        };
+        return coord(c.z) << (2 * sCoordBits) | coord(c.y) << sCoordBits | coord(c.x);
+    }
+
+    Vec3f mOrigin;
+    float mInvCellSize;
+    int mLightCount;
+
+    std::atomic<bool> mRecording;
+    std::atomic<bool> mFreezeStarted;
+    std::atomic<bool> mReady;
+
+    tbb::enumerable_thread_specific<ThreadCells, tbb::cache_aligned_allocator<ThreadCells>,
+                                    tbb::ets_key_per_instance> mThreadCells;
+
+    // Built by freeze(), read only while mReady is set.
+    std::unordered_map<uint64_t, uint32_t> mCellOffsets;
+    std::vector<float> mProbabilities;
+};
+
+VolumeLightCache::VolumeLightCache() :
+    mImpl(new Impl)
+{
+}
+
+VolumeLightCache::~VolumeLightCache() = default;
+
+void
+VolumeLightCache::startFrame(const BBox3f &bbox, unsigned resolution, int lightCount)
+{
+    mImpl->startFrame(bbox, resolution, lightCount);
+}
+
+bool
+VolumeLightCache::isEnabled() const
+{
+    return mImpl->isEnabled();
+}
+
+bool
+VolumeLightCache::isRecording() const
+{
+    return mImpl->isRecording();
+}
+
+void
+VolumeLightCache::record(const Vec3f &p, int lightIndex, float contribution) const
+{
+    mImpl->record(p, lightIndex, contribution);
+}
+
+void
+VolumeLightCache::freeze() const
+{
+    mImpl->freeze();
+}
+
+const float *
+VolumeLightCache::getProbabilities(const Vec3f &p) const
+{
+    return mImpl->getProbabilities(p);
+}
+
+} // namespace pbr
+} // namespace moonray
+
@@ -0,0 +1,65 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file VolumeLightCache.h
+#pragma once
+
+#include <scene_rdl2/common/math/BBox.h>
+#include <scene_rdl2/common/math/Vec3.h>
+
+#include <memory>
+
+namespace moonray {
+namespace pbr {
+
+//
+// Sparse grid of per light importance used to pick the lights evaluated for
+// volume in-scattering. During the first passes of a frame the integrator
+// records how much each light contributes to the in-scattering of the volume
+// segments falling into each cell. The cache is then frozen into per light
+// selection probabilities, proportional to the recorded contribution relative
+// to the brightest light of the cell and bounded below so no light is ever
+// left out. The integrator evaluates each light with its probability and
+// scales the contributions it keeps by the inverse, which keeps the estimate
+// unbiased while the lights that don't matter to a cell are mostly skipped.
+//
+// Only the cells volume segments reached while recording are stored, any other
+// cell evaluates all the lights.
+//
+class VolumeLightCache
+{
+public:
+    VolumeLightCache();
+    VolumeLightCache(const VolumeLightCache &) = delete;
+    VolumeLightCache &operator=(const VolumeLightCache &) = delete;
+    ~VolumeLightCache();
+
+    // Clears the cache of the previous frame and starts recording. resolution
+    // is the number of cells along the longest axis of bbox, 0 disables the
+    // cache. Not thread safe.
+    void startFrame(const scene_rdl2::math::BBox3f &bbox, unsigned resolution, int lightCount);
+
+    bool isEnabled() const;
+    bool isRecording() const;
+
+    // Records the contribution of a light to the in-scattering of a volume
+    // segment around p. This method is "const" because it is thread-safe.
+    void record(const scene_rdl2::math::Vec3f &p, int lightIndex, float contribution) const;
+
+    // Stops recording and builds the selection probabilities. Thread safe,
+    // only the first call of a frame has any effect and the cache is not used
+    // until that call completes.
+    void freeze() const;
+
+    // Selection probability of each light for the cell containing p, or
+    // nullptr if all the lights should be evaluated.
+    const float *getProbabilities(const scene_rdl2::math::Vec3f &p) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> mImpl;
+};
+
+} // namespace pbr
+} // namespace moonray
+
@@ -18,6 +18,7 @@ using namespace scene_rdl2::math;
 
 bool                             EnvLight::sAttributeKeyInitialized;
 scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool>   EnvLight::sSampleUpperHemisphereOnlyKey;
+scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::SceneObjectVector>   EnvLight::sPortalsKey;
 
 /// Special case for EnvLight where we want +Y to be the up direction in world/
 /// render space. We still want z to be up in local space.
@@ -84,6 +85,7 @@ local2uv(const Vec3f &dir)
 
 //----------------------------------------------------------------------------
 
+HUD_VALIDATOR(EnvLightPortal);
 HUD_VALIDATOR(EnvLight);
 
 Vec3f
@@ -124,7 +126,9 @@ EnvLight::globalToLocalXform(float time, bool needed) const
 
 EnvLight::EnvLight(const scene_rdl2::rdl2::Light* rdlLight) :
     Light(rdlLight),
-    mHemispherical(false)
+    mHemispherical(false),
+    mPortals(nullptr),
+    mPortalCount(0)
 {
     mIsOpaqueInAlpha = false;
 
@@ -215,9 +219,160 @@ EnvLight::update(const Mat4d& world2render)
         mLog2TexelAngle = scene_rdl2::math::log2(texelAngle);
     }
 
+    updatePortals(world2render);
+
+    return true;
+}
+
+void
+EnvLight::updatePortals(const Mat4d& world2render)
+{
+    mPortalData.clear();
+
+    const scene_rdl2::rdl2::SceneObjectVector &portals = mRdlLight->get(sPortalsKey);
+    for (const scene_rdl2::rdl2::SceneObject *so : portals) {
+        if (!so) {
+            continue;
+        }
+        if (so->getSceneClass().getName() != "RectLight") {
+            mRdlLight->warn("Portal \"", so->getName(), "\" is not a RectLight - ignoring it.");
+            continue;
+        }
+        if ((int)mPortalData.size() == sMaxPortals) {
+            mRdlLight->warn("More than ", sMaxPortals, " portals - ignoring the rest.");
+            break;
+        }
+
+        // Same local frame as the RectLight itself, which faces along its
+        // local -z axis, into the interior.
+        const Mat4d l2w = so->get(scene_rdl2::rdl2::Node::sNodeXformKey, /* rayTime = */ 0.0f);
+        const Mat4f local2render = sRotateX180 * toFloat(l2w * world2render);
+        const float halfWidth  = 0.5f * so->get<scene_rdl2::rdl2::Float>("width");
+        const float halfHeight = 0.5f * so->get<scene_rdl2::rdl2::Float>("height");
+
+        EnvLightPortal portal;
+        portal.mCorner = transformPoint(local2render, Vec3f(-halfWidth, -halfHeight, 0.0f));
+        portal.mEdgeU = transformPoint(local2render, Vec3f(halfWidth, -halfHeight, 0.0f)) - portal.mCorner;
+        portal.mEdgeV = transformPoint(local2render, Vec3f(-halfWidth, halfHeight, 0.0f)) - portal.mCorner;
+        portal.mNormal = cross(portal.mEdgeU, portal.mEdgeV);
+        portal.mArea = portal.mNormal.length();
+        if (!(portal.mArea > 0.0f) || !finite(portal.mArea)) {
+            mRdlLight->warn("Portal \"", so->getName(), "\" is degenerate - ignoring it.");
+            continue;
+        }
+        portal.mNormal /= portal.mArea;
+        if (dot(portal.mNormal, transformVector(local2render, Vec3f(0.0f, 0.0f, 1.0f))) < 0.0f) {
+            portal.mNormal = -portal.mNormal;
+        }
+        portal.mWeight = 1.0f;
+        mPortalData.push_back(portal);
+    }
+
+    // Weight each portal with the average env map luminance over the
+    // directions it opens onto, so bright sky windows get more samples than
+    // windows facing the ground. A coarse lat-long grid is plenty for this.
+    if (mDistribution && !mPortalData.empty()) {
+        constexpr int sizeU = 64;
+        constexpr int sizeV = 32;
+        float maxWeight = 0.0f;
+        for (EnvLightPortal &portal : mPortalData) {
+            float sum = 0.0f;
+            float sumWeights = 0.0f;
+            for (int j = 0; j < sizeV; ++j) {
+                const float v = (j + 0.5f) / sizeV;
+                const float sinTheta = scene_rdl2::math::sin(v * sPi);
+                for (int i = 0; i < sizeU; ++i) {
+                    const Vec2f uv((i + 0.5f) / sizeU, v);
+                    const Vec3f dir = mFrame.localToGlobal(uv2local(uv));
+                    const float cosine = -dot(dir, portal.mNormal);
+                    if (cosine <= 0.0f) {
+                        continue;
+                    }
+                    const float w = cosine * sinTheta;
+                    sum += w * luminance(mDistribution->eval(uv.x, uv.y, 0.0f, mTextureFilter));
+                    sumWeights += w;
+                }
+            }
+            portal.mWeight = sumWeights > 0.0f ? sum / sumWeights : 0.0f;
+            maxWeight = max(maxWeight, portal.mWeight);
+        }
+
+        // Don't starve the dark portals altogether.
+        for (EnvLightPortal &portal : mPortalData) {
+            portal.mWeight = maxWeight > 0.0f ? max(portal.mWeight, 0.01f * maxWeight) : 1.0f;
+        }
+    }
+
+    mPortals = mPortalData.empty() ? nullptr : mPortalData.data();
+    mPortalCount = (int32_t)mPortalData.size();
+}
+
+bool
+EnvLight::computePortalPmf(const Vec3f &p, float *pmf) const
+{
+    float sum = 0.0f;
+    for (int i = 0; i < mPortalCount; ++i) {
+        const EnvLightPortal &portal = mPortals[i];
+        pmf[i] = 0.0f;
+
+        // Height of p above the portal plane, on the interior side.
+        const float h = dot(p - portal.mCorner, portal.mNormal);
+        if (h <= 0.0f) {
+            continue;
+        }
+
+        // Approximate solid angle of the portal seen from p.
+        const Vec3f d = portal.mCorner + 0.5f * (portal.mEdgeU + portal.mEdgeV) - p;
+        const float dist = d.length();
+        const float solidAngle = min(portal.mArea * h / (dist * dist * dist), sTwoPi);
+        pmf[i] = solidAngle * portal.mWeight;
+        sum += pmf[i];
+    }
+
+    if (!(sum > 0.0f)) {
+        return false;
+    }
+
+    const float invSum = 1.0f / sum;
+    for (int i = 0; i < mPortalCount; ++i) {
+        pmf[i] *= invSum;
+    }
     return true;
 }
 
+float
+EnvLight::portalPdf(const Vec3f &p, const Vec3f &wi) const
+{
+    float pmf[sMaxPortals];
+    if (!computePortalPmf(p, pmf)) {
+        return 0.0f;
+    }
+
+    // Directions may go through several overlapping portals, sum the
+    // density of each of them.
+    float pdf = 0.0f;
+    for (int i = 0; i < mPortalCount; ++i) {
+        if (pmf[i] == 0.0f) {
+            continue;
+        }
+        const EnvLightPortal &portal = mPortals[i];
+        const float cosine = -dot(wi, portal.mNormal);
+        if (cosine <= 0.0f) {
+            continue;
+        }
+        const float t = dot(p - portal.mCorner, portal.mNormal) / cosine;
+        const Vec3f hit = p + t * wi - portal.mCorner;
+        const float a = dot(hit, portal.mEdgeU) / lengthSqr(portal.mEdgeU);
+        const float b = dot(hit, portal.mEdgeV) / lengthSqr(portal.mEdgeV);
+        if (a < 0.0f || a > 1.0f || b < 0.0f || b > 1.0f) {
+            continue;
+        }
+        // Area to solid angle measure.
+        pdf += pmf[i] * t * t / (portal.mArea * cosine);
+    }
+    return pdf;
+}
+
 
 bool
 EnvLight::isBounded() const
@@ -262,7 +417,30 @@ EnvLight::sample(const Vec3f &p, const Vec3f *n, float time, const Vec3f& r,
 {
     MNRY_ASSERT(mOn);
 
-    if (mDistribution) {
+    if (mPortalCount > 0) {
+        // Pick a portal and a point on it uniformly.
+        float pmf[sMaxPortals];
+        if (!computePortalPmf(p, pmf)) {
+            return false;
+        }
+        int index = 0;
+        float cdf = pmf[0];
+        while (r[2] >= cdf && index < mPortalCount - 1) {
+            cdf += pmf[++index];
+        }
+        const EnvLightPortal &portal = mPortals[index];
+        const Vec3f q = portal.mCorner + r[0] * portal.mEdgeU + r[1] * portal.mEdgeV;
+        const Vec3f d = q - p;
+        const float dist = d.length();
+        if (!(dist > 0.0f)) {
+            return false;
+        }
+        wi = d / dist;
+        if (mHemispherical && dot(wi, getDirection(time)) < 0.0f) {
+            return false;
+        }
+        isect.uv = mDistribution ? local2uv(globalToLocal(wi, time)) : zero;
+    } else if (mDistribution) {
         float mipLevel = getMipLevel(rayDirFootprint);
         mDistribution->sample(r[0], r[1], mipLevel, &isect.uv, nullptr, mTextureFilter);
 
@@ -321,7 +499,10 @@ EnvLight::eval(mcrt_common::ThreadLocalState* tls, const Vec3f &wi, const Vec3f
     }
 
     if (pdf) {
-        if (mDistribution) {
+        if (mPortalCount > 0) {
+            // Only directions through the portals are ever sampled.
+            *pdf = portalPdf(p, wi);
+        } else if (mDistribution) {
             // We must account for the mapping transformation so we express the
             // pdf density on the sphere in solid angles (see pbrt section 14.6.5)
             float sinTheta = scene_rdl2::math::sin((isect.uv[1]) * sPi);
@@ -357,6 +538,7 @@ EnvLight::initAttributeKeys(const scene_rdl2::rdl2::SceneClass &sc)
     sAttributeKeyInitialized = true;
 
     sSampleUpperHemisphereOnlyKey = sc.getAttributeKey<scene_rdl2::rdl2::Bool>("sample_upper_hemisphere_only");
+    sPortalsKey = sc.getAttributeKey<scene_rdl2::rdl2::SceneObjectVector>("portals");
 
     MOONRAY_FINISH_NON_THREADSAFE_STATIC_WRITE
 }
@@ -11,9 +11,12 @@
 #include <scene_rdl2/common/math/ReferenceFrame.h>
 #include <scene_rdl2/common/math/Vec3.h>
 
+#include <vector>
+
 // Forward declaration of the ISPC types
 namespace ispc {
     struct EnvLight;
+    struct EnvLightPortal;
 }
 
 
@@ -28,6 +31,21 @@ namespace pbr {
 
 //----------------------------------------------------------------------------
 
+/// A rectangular opening (window, door) the environment is seen through from
+/// an interior. The EnvLight samples directions through its portals only.
+struct EnvLightPortal
+{
+    /// HUD validation and type casting
+    static uint32_t hudValidation(bool verbose) {
+        ENV_LIGHT_PORTAL_VALIDATION;
+    }
+    HUD_AS_ISPC_METHODS(EnvLightPortal);
+
+    ENV_LIGHT_PORTAL_MEMBERS;
+};
+
+//----------------------------------------------------------------------------
+
 /// @brief Implements light sampling for environment lights.
 /// @brief Implements light sampling for textured infinite spherical environment
 /// lights. Only the rotation of the w2c transform will have an effect.
@@ -74,9 +92,21 @@ public:
     float getThetaO() const override { return -1.f; }
     float getThetaE() const override { return -1.f; }
 
+    // Portals are picked from a fixed size array on the stack, any extra
+    // portals are ignored.
+    static constexpr int sMaxPortals = 16;
+
 private:
     void initAttributeKeys(const scene_rdl2::rdl2::SceneClass &sc);
 
+    void updatePortals(const scene_rdl2::math::Mat4d& world2render);
+
+    // Probability of picking each portal to sample from p, proportional to
+    // the solid angle of the portal times its weight. Portals p is outside
+    // of get 0. Returns false when no portal can be sampled from p.
+    bool computePortalPmf(const scene_rdl2::math::Vec3f &p, float *pmf) const;
+    float portalPdf(const scene_rdl2::math::Vec3f &p, const scene_rdl2::math::Vec3f &wi) const;
+
     scene_rdl2::math::Vec3f localToGlobal(const scene_rdl2::math::Vec3f &v, float time) const;
     scene_rdl2::math::Vec3f globalToLocal(const scene_rdl2::math::Vec3f &v, float time) const;
     scene_rdl2::math::Xform3f globalToLocalXform(float time, bool needed = true) const;
@@ -95,12 +125,15 @@ private:
 
     ENV_LIGHT_MEMBERS;
 
+    std::vector<EnvLightPortal> mPortalData; // storage for mPortals
+
     //
     // Cached attribute keys:
     //
     // cppcheck-suppress duplInheritedMember
     static bool sAttributeKeyInitialized;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Bool> sSampleUpperHemisphereOnlyKey;
+    static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::SceneObjectVector> sPortalsKey;
 
     static const scene_rdl2::math::Mat4f sLocalOrientation;
 };
@@ -136,7 +136,7 @@ Light::updateImageMap(Distribution2D::Mapping distributionMapping)
 
     mDistributionMapping = distributionMapping;
 
-    delete mDistribution;
+    ImageDistributionCache::get().release(mDistribution);
     mDistribution = nullptr;
 
     const std::string & mapFilename = mRdlLight->get(scene_rdl2::rdl2::Light::sTextureKey);
@@ -144,9 +144,10 @@ Light::updateImageMap(Distribution2D::Mapping distributionMapping)
         return true;
     }
 
-    // TODO: Keep and share image distributions in a scene-global resource manager
+    // Lights mapping the same image with the same settings share a distribution,
+    // which also outlives the light if the cache is allowed to keep it
     try {
-        mDistribution = new ImageDistribution(mapFilename, mDistributionMapping,
+        mDistribution = ImageDistributionCache::get().acquire(mapFilename, mDistributionMapping,
             mRdlLight->get(scene_rdl2::rdl2::Light::sGammaKey), 
             mRdlLight->get(scene_rdl2::rdl2::Light::sContrastKey), 
             mRdlLight->get(scene_rdl2::rdl2::Light::sSaturationKey),
@@ -166,7 +167,7 @@ Light::updateImageMap(Distribution2D::Mapping distributionMapping)
     }
 
     if (mDistribution == nullptr  ||  !mDistribution->isValid()) {
-        delete mDistribution;
+        ImageDistributionCache::get().release(mDistribution);
         mDistribution = nullptr;
         mRadiance = math::sBlack;
         mOn = false;
@@ -8,6 +8,7 @@
 #include "LightUtil.h"
 #include <moonray/rendering/pbr/lightfilter/LightFilter.h>
 #include <moonray/rendering/pbr/core/Distribution.h>
+#include <moonray/rendering/pbr/core/ImageDistributionCache.h>
 
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 
@@ -49,7 +50,7 @@ public:
     /// Constructor / Destructor
     Light(const scene_rdl2::rdl2::Light* rdlLight);
     virtual ~Light()  {
-        delete mDistribution;
+        ImageDistributionCache::get().release(mDistribution);
     }
 
     /// HUD validation and type casting
@@ -250,12 +250,38 @@ enum LightSidednessType
 
 //----------------------------------------------------------------------------
 
+#define ENV_LIGHT_PORTAL_MEMBERS                                    \
+    /* Render space rectangle, mNormal faces the interior */        \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mCorner);    \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mEdgeU);     \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mEdgeV);     \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mNormal);    \
+    HUD_MEMBER(float, mArea);                                       \
+    /* Relative env map radiance coming in through the portal */    \
+    HUD_MEMBER(float, mWeight)
+
+
+#define ENV_LIGHT_PORTAL_VALIDATION             \
+    HUD_BEGIN_VALIDATION(EnvLightPortal);       \
+    HUD_VALIDATE(EnvLightPortal, mCorner);      \
+    HUD_VALIDATE(EnvLightPortal, mEdgeU);       \
+    HUD_VALIDATE(EnvLightPortal, mEdgeV);       \
+    HUD_VALIDATE(EnvLightPortal, mNormal);      \
+    HUD_VALIDATE(EnvLightPortal, mArea);        \
+    HUD_VALIDATE(EnvLightPortal, mWeight);      \
+    HUD_END_VALIDATION
+
+
 #define ENV_LIGHT_MEMBERS                                                \
     HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, ReferenceFrame), mFrame); \
                                                                          \
     /* Are we upper-hemisphere-only ? */                                 \
     HUD_MEMBER(bool, mHemispherical);                                    \
-    HUD_MEMBER(float, mLog2TexelAngle)
+    HUD_MEMBER(float, mLog2TexelAngle);                                  \
+                                                                         \
+    /* Portals the light is sampled through, none samples the sphere */  \
+    HUD_PTR(const EnvLightPortal *, mPortals);                           \
+    HUD_MEMBER(int32_t, mPortalCount)
 
 
 #define ENV_LIGHT_VALIDATION                \
@@ -263,6 +289,8 @@ enum LightSidednessType
     HUD_VALIDATE(EnvLight, mFrame);         \
     HUD_VALIDATE(EnvLight, mHemispherical); \
     HUD_VALIDATE(EnvLight, mLog2TexelAngle);\
+    HUD_VALIDATE(EnvLight, mPortals);       \
+    HUD_VALIDATE(EnvLight, mPortalCount);   \
     HUD_END_VALIDATION
 
 
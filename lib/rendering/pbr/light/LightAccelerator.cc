@@ -166,10 +166,13 @@ intersectCallback(const RTCIntersectFunctionNArguments* args)
 // This function sets all of the callbacks required by Embree.
 
 void
-LightAccelerator::init(const Light*const* lights, int lightCount, const RTCDevice& rtcDevice, float samplingThreshold)
+LightAccelerator::init(const Light*const* lights, int lightCount, float samplingThreshold)
 {
     // Deal with boundary cases
     if (lights == nullptr) {
+        if (mRtcScene) {
+            rtcReleaseScene(mRtcScene);
+        }
         mRtcScene            = nullptr;
         mLights              = nullptr;
         mLightCount          = 0;
@@ -203,15 +206,30 @@ LightAccelerator::init(const Light*const* lights, int lightCount, const RTCDevic
     mUnboundedLights = lights + boundedLightCount;
     mUnboundedLightCount = lightCount - boundedLightCount;
 
+    mSamplingTree.setSamplingThreshold(samplingThreshold);
+}
+
+
+void
+LightAccelerator::buildIntersectionScene(const RTCDevice& rtcDevice)
+{
     // Create an Embree scene as long as there are enough lights to put in it.
     // We check the SCALAR_THRESHOLD_COUNT because even in vector mode,
     // we fall into scalar code when computing subsurface radiance.
-    // All bounded lights are stored in embree as one UserGeometry
-    if (boundedLightCount >= SCALAR_THRESHOLD_COUNT) {
+    // When the sampling tree holds every bounded light, i.e. there are no mesh lights,
+    // its nodes bound the lights just as well and we intersect them through the tree.
+    // Otherwise all bounded lights are stored in embree as one UserGeometry
+    if (mRtcScene) {
+        // rebuilding
+        rtcReleaseScene(mRtcScene);
+    }
+    if (mBoundedLightCount >= SCALAR_THRESHOLD_COUNT &&
+        mSamplingTree.getBoundedLightCount() != static_cast<uint32_t>(mBoundedLightCount)) {
         mRtcScene = rtcNewScene(rtcDevice);
         RTCGeometry rtcGeom = rtcNewGeometry(rtcDevice, RTC_GEOMETRY_TYPE_USER);
-        rtcSetGeometryBuildQuality(rtcGeom, RTC_BUILD_QUALITY_MEDIUM);
-        rtcSetGeometryUserPrimitiveCount(rtcGeom, boundedLightCount);
+        // Refit rather than rebuild when lights are edited in place, see refit()
+        rtcSetGeometryBuildQuality(rtcGeom, RTC_BUILD_QUALITY_REFIT);
+        rtcSetGeometryUserPrimitiveCount(rtcGeom, mBoundedLightCount);
         rtcSetGeometryTimeStepCount(rtcGeom, 1);
         rtcSetGeometryUserData(rtcGeom, (void *)const_cast<Light**>(mBoundedLights));
         rtcSetGeometryBoundsFunction(rtcGeom, boundsCallback, nullptr);
@@ -228,8 +246,6 @@ LightAccelerator::init(const Light*const* lights, int lightCount, const RTCDevic
     } else {
         mRtcScene = nullptr;
     }
-
-    mSamplingTree.setSamplingThreshold(samplingThreshold);
 }
 
 
@@ -246,8 +262,7 @@ LightAccelerator::intersect(const Vec3f &P,  const Vec3f* N, const Vec3f &wi,
         const int* lightIdMap) const
 {
     MNRY_ASSERT(mBoundedLightCount >= SCALAR_THRESHOLD_COUNT);
-    MNRY_ASSERT(mRtcScene != nullptr);
-    if (mBoundedLightCount < SCALAR_THRESHOLD_COUNT  ||  mRtcScene == nullptr) {
+    if (mBoundedLightCount < SCALAR_THRESHOLD_COUNT) {
         return -1;
     }
 
@@ -277,6 +292,11 @@ LightAccelerator::intersectBounded(const Vec3f &P,  const Vec3f* N, const Vec3f
         float time, float maxDistance, bool includeRayTerminationLights, int visibilityMask,
         IntegratorSample1D &samples, int depth, LightIntersection &isect, int &numHits, const int* lightIdMap) const
 {
+    if (mRtcScene == nullptr) {
+        return intersectSamplingTree(P, N, wi, time, maxDistance, includeRayTerminationLights, visibilityMask,
+            samples, depth, isect, numHits, lightIdMap);
+    }
+
     RTCRayHit rayHit;
     rayHit.ray.org_x = P.x;
     rayHit.ray.org_y = P.y;
@@ -331,6 +351,50 @@ LightAccelerator::intersectBounded(const Vec3f &P,  const Vec3f* N, const Vec3f
 }
 
 
+// Randomly intersect a ray against the bounded lights whose bounding boxes it overlaps, found by
+// traversing the sampling tree. This matches what intersectCallback() does for the lights Embree hits.
+
+int
+LightAccelerator::intersectSamplingTree(const Vec3f &P, const Vec3f* N, const Vec3f &wi,
+        float time, float maxDistance, bool includeRayTerminationLights, int visibilityMask,
+        IntegratorSample1D &samples, int depth, LightIntersection &isect, int &numHits, const int* lightIdMap) const
+{
+    isect.distance = maxDistance;
+
+    int chosenLightIdx = -1;
+    mSamplingTree.intersectBounds(P, wi, maxDistance, [&](int idx) {
+        // skip lights that do not exist in LightSet
+        if (lightIdMap[idx] == -1) {
+            return;
+        }
+        const Light *light = mBoundedLights[idx];
+
+        if (!(visibilityMask & light->getVisibilityMask())) {
+            // skip light if it is masked
+            return;
+        }
+
+        if (!includeRayTerminationLights && light->getIsRayTerminator()) {
+            // Skip any ray termination lights if we were told not to include them
+            return;
+        }
+
+        LightIntersection currentIsect;
+        if (light->intersect(P, N, wi, time, maxDistance, currentIsect)) {
+
+            numHits++;
+
+            if (chooseThisLight(samples, depth, numHits)) {
+                chosenLightIdx = idx;
+                isect = currentIsect;
+            }
+        }
+    });
+
+    return chosenLightIdx;
+}
+
+
 // Randomly intersect a ray against the LightAccelerator's list of unbounded lights.
 
 int
@@ -382,7 +446,7 @@ LightAccelerator::intersectUnbounded(const Vec3f &P, const Vec3f &wi, float time
 // For now, the mechanism used here offers the path of least resistance.
 // See VLEN switch above for vector type information.
 
-extern "C" void CPP_lightIntersect(RTCScene scene, RTCRayHitv& rayHitv,
+extern "C" void CPP_lightIntersect(const LightAccelerator* acc, RTCRayHitv& rayHitv,
     int* includeRayTerminationLights, float* isectData0, float* isectData1, SequenceID* sequenceID,
     uint32_t* totalSamples, uint32_t* sampleNumber, int* depth, float* isectDistance, int* numHits,
     float* pdf, int* meshGeomId, int* meshPrimId, const scene_rdl2::math::Vec3fv* shadingNormalv,
@@ -394,6 +458,43 @@ extern "C" void CPP_lightIntersect(RTCScene scene, RTCRayHitv& rayHitv,
         samples[i] = IntegratorSample1D(sequenceID[i], totalSamples[i], sampleNumber[i]);
     }
 
+    if (acc->getRtcScene() == nullptr) {
+        // There is no Embree scene, intersect the lanes one by one through the sampling tree
+        for (int i = 0; i < VLEN; ++i) {
+            const Vec3f P(rayHitv.ray.org_x[i], rayHitv.ray.org_y[i], rayHitv.ray.org_z[i]);
+            const Vec3f wi(rayHitv.ray.dir_x[i], rayHitv.ray.dir_y[i], rayHitv.ray.dir_z[i]);
+            // an invalid normal coming from ispc has x > 1
+            const Vec3f N(shadingNormalv->x[i], shadingNormalv->y[i], shadingNormalv->z[i]);
+
+            LightIntersection isect;
+            const int lightIdx = acc->intersectSamplingTree(P, (N.x > 1.f) ? nullptr : &N, wi,
+                rayHitv.ray.time[i], rayHitv.ray.tfar[i], includeRayTerminationLights[i], rayHitv.ray.mask[i],
+                samples[i], depth[i], isect, numHits[i], lightIdMap);
+            if (lightIdx < 0) {
+                continue;
+            }
+
+            rayHitv.hit.geomID[i] = 0;
+            rayHitv.hit.primID[i] = lightIdx;
+            rayHitv.hit.u[i] = isect.uv[0];
+            rayHitv.hit.v[i] = isect.uv[1];
+            rayHitv.hit.Ng_x[i] = isect.N.x;
+            rayHitv.hit.Ng_y[i] = isect.N.y;
+            rayHitv.hit.Ng_z[i] = isect.N.z;
+            isectData0[i] = isect.data[0];
+            isectData1[i] = isect.data[1];
+            isectDistance[i] = isect.distance;
+            pdf[i] = isect.pdf;
+            meshGeomId[i] = isect.geomID;
+            meshPrimId[i] = isect.primID;
+        }
+
+        for (int i = 0; i < VLEN; ++i) {
+            sampleNumber[i] = samples[i].getSampleNumber();
+        }
+        return;
+    }
+
     LightIntersectContext context;
     context.mNumHits = numHits;
     context.mDepth = depth;
@@ -421,7 +522,7 @@ extern "C" void CPP_lightIntersect(RTCScene scene, RTCRayHitv& rayHitv,
     rtcInitIntersectArguments(&args);
     args.context = &context.mRtcContext;
 
-    rtcIntersectv(sAllValidMask, scene, &rayHitv, &args);
+    rtcIntersectv(sAllValidMask, acc->getRtcScene(), &rayHitv, &args);
 
     // need to update the sample number for the ispc SampleIntegrator1D struct
     for (int i = 0; i < VLEN; ++i) {
@@ -434,6 +535,30 @@ void LightAccelerator::buildSamplingTree()
     mSamplingTree.build(mBoundedLights, mBoundedLightCount, mUnboundedLights, mUnboundedLightCount);
 }
 
+bool
+LightAccelerator::refit(const std::unordered_set<const Light*>& changedLights)
+{
+    std::vector<uint32_t> boundedLightIndices;
+    for (int l = 0; l < mBoundedLightCount; ++l) {
+        if (changedLights.count(mBoundedLights[l])) {
+            boundedLightIndices.push_back(l);
+        }
+    }
+    // Changed unbounded lights are only referenced from here, nothing to update for them
+    if (boundedLightIndices.empty()) {
+        return true;
+    }
+
+    const bool treeIsValid = mSamplingTree.refit(boundedLightIndices);
+
+    if (mRtcScene) {
+        // The bounds callback reads the new light bounds, the geometry was set up to be refit
+        rtcCommitGeometry(rtcGetGeometry(mRtcScene, 0));
+        rtcCommitScene(mRtcScene);
+    }
+    return treeIsValid;
+}
+
 //----------------------------------------------------------------------------
 
 } // namespace pbr
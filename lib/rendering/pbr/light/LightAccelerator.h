@@ -14,6 +14,8 @@
 #include <embree4/rtcore.h>
 #include <embree4/rtcore_ray.h>
 
+#include <unordered_set>
+
 
 namespace moonray {
 namespace pbr {
@@ -29,7 +31,10 @@ public:
         LIGHT_ACCELERATOR_VALIDATION;
     }
 
-    void init(const Light*const* lights, int lightCount, const RTCDevice& rtcDevice, float samplingThreshold);
+    void init(const Light*const* lights, int lightCount, float samplingThreshold);
+    // Builds the Embree scene used to intersect the bounded lights. Call it after buildSamplingTree(), if
+    // the sampling tree holds all the bounded lights it is used for intersection instead and no scene is built.
+    void buildIntersectionScene(const RTCDevice& rtcDevice);
     int intersect(const scene_rdl2::math::Vec3f &P, const scene_rdl2::math::Vec3f* N, const scene_rdl2::math::Vec3f &wi, float time,
         float maxDistance, bool includeRayTerminationLights, int visibilityMask, IntegratorSample1D &samples,
         int depth, LightIntersection &isect, int &numHits, const int* lightIdMap) const;
@@ -41,6 +46,19 @@ public:
     finline bool useAcceleration() const { return mBoundedLightCount >= SCALAR_THRESHOLD_COUNT; }
     finline const LightTree* getLightTree() const { return &mSamplingTree; }
     void buildSamplingTree();
+    // Updates the sampling tree and the intersection scene after the given lights changed in place, e.g. from an
+    // interactive light edit, rather than rebuilding them: the tree nodes above the changed lights are refit and
+    // the Embree scene refits its BVH to the new light bounds. Lights which aren't in this accelerator are
+    // ignored. Returns false when the refit sampling tree has degraded enough that the accelerator should be
+    // rebuilt.
+    bool refit(const std::unordered_set<const Light*>& changedLights);
+    finline RTCScene getRtcScene() const { return mRtcScene; }
+
+    // Intersection against the bounded lights using the sampling tree, same parameters as intersectBounded
+    int intersectSamplingTree(const scene_rdl2::math::Vec3f &P, const scene_rdl2::math::Vec3f* N,
+        const scene_rdl2::math::Vec3f &wi, float time, float maxDistance, bool includeRayTerminationLights,
+        int visibilityMask, IntegratorSample1D &samples, int depth, LightIntersection &isect, int &numHits,
+        const int* lightIdMap) const;
 
 private:
     LIGHT_ACCELERATOR_MEMBERS;
@@ -22,6 +22,12 @@ void LightTree::build(const Light* const* boundedLights, uint32_t boundedLightCo
     mBoundedLightCount = boundedLightCount;
     mUnboundedLightCount = unboundedLightCount;
 
+    // start over when rebuilding
+    mNodes.clear();
+    mLightIndices.clear();
+    mParentIndices.clear();
+    mLeafIndices.clear();
+
     // pre-allocate since we know the size of the array
     mLightIndices.reserve(boundedLightCount);
 
@@ -44,11 +50,79 @@ void LightTree::build(const Light* const* boundedLights, uint32_t boundedLightCo
 
         // build light tree recursively
         buildRecurse(/* root index */ 0);
+        refitBBoxesRecurse(/* root index */ 0);
+        linkNodes(boundedLightCount);
+    }
+
+    // update HUD data
+    mNodesPtr = mNodes.data();
+    mLightIndicesPtr = mLightIndices.data();
+}
+
+void LightTree::linkNodes(uint32_t lightCount)
+{
+    mParentIndices.assign(mNodes.size(), -1);
+    mLeafIndices.assign(lightCount, -1);
+    for (uint32_t i = 0; i < mNodes.size(); ++i) {
+        const LightTreeNode& node = mNodes[i];
+        if (node.isLeaf()) {
+            mLeafIndices[node.getLightIndex()] = i;
+        } else {
+            mParentIndices[i + 1] = i;
+            mParentIndices[node.getRightNodeIndex()] = i;
+        }
+    }
+    mBuildSaoMeasure = mSaoMeasure = getSaoMeasure();
+}
 
-        // update HUD data
-        mNodesPtr = mNodes.data();
-        mLightIndicesPtr = mLightIndices.data();
+double LightTree::getSaoMeasure() const
+{
+    double measure = 0.0;
+    for (const LightTreeNode& node : mNodes) {
+        if (!node.isLeaf()) {
+            measure += node.getSaoMeasure();
+        }
     }
+    return measure;
+}
+
+bool LightTree::refit(const std::vector<uint32_t>& lightIndices)
+{
+    if (mNodes.empty()) {
+        return true;
+    }
+
+    // re-initialize the leaves of the lights and flag their ancestors
+    std::vector<bool> refitNodes(mNodes.size(), false);
+    for (const uint32_t lightIndex : lightIndices) {
+        // mesh lights aren't in the tree
+        if (lightIndex >= mLeafIndices.size() || mLeafIndices[lightIndex] < 0) {
+            continue;
+        }
+        const int32_t leafIndex = mLeafIndices[lightIndex];
+        LightTreeNode leaf;
+        leaf.init(/* lightCount */ 1, mNodes[leafIndex].getStartIndex(), mBoundedLights, mLightIndices);
+        leaf.setLeafLightIndex(mLightIndices);
+        mNodes[leafIndex] = leaf;
+
+        // once an ancestor is flagged, so are the ones above it
+        for (int32_t i = mParentIndices[leafIndex]; i >= 0 && !refitNodes[i]; i = mParentIndices[i]) {
+            refitNodes[i] = true;
+        }
+    }
+
+    // children are stored after their parent, going backwards refits the children first
+    for (int32_t i = static_cast<int32_t>(mNodes.size()) - 1; i >= 0; --i) {
+        if (!refitNodes[i]) {
+            continue;
+        }
+        LightTreeNode& node = mNodes[i];
+        mSaoMeasure -= node.getSaoMeasure();
+        node.refit(mNodes[i + 1], mNodes[node.getRightNodeIndex()]);
+        mSaoMeasure += node.getSaoMeasure();
+    }
+
+    return mSaoMeasure <= sRefitDegradationThreshold * mBuildSaoMeasure;
 }
 
 /// Recursively build tree
@@ -85,6 +159,22 @@ void LightTree::buildRecurse(uint32_t nodeIndex)
     buildRecurse(mNodes.size() - 1);
 }
 
+const scene_rdl2::math::BBox3f& LightTree::refitBBoxesRecurse(uint32_t nodeIndex)
+{
+    LightTreeNode& node = mNodes[nodeIndex];
+    if (node.isLeaf()) {
+        node.setBBox(mBoundedLights[node.getLightIndex()]->getBounds());
+        return node.getBBox();
+    }
+
+    scene_rdl2::math::BBox3f bbox = refitBBoxesRecurse(nodeIndex + 1);
+    bbox.extend(refitBBoxesRecurse(node.getRightNodeIndex()));
+
+    // mNodes isn't resized here, node is still valid
+    node.setBBox(bbox);
+    return node.getBBox();
+}
+
 float LightTree::split(LightTreeNode& leftNode, LightTreeNode& rightNode, uint32_t nodeIndex)
 {
     LightTreeNode& node = mNodes[nodeIndex];
@@ -8,6 +8,8 @@
 #include "LightTree.hh"
 #include "MeshLight.h"
 
+#include <cmath>
+
 namespace moonray {
 namespace pbr {
 
@@ -43,6 +45,16 @@ public:
     void build(const Light* const* boundedLights, unsigned int boundedLightCount,
                const Light* const* unboundedLights, unsigned int unboundedLightCount);
 
+    /// Refit the tree after the given bounded lights changed in place (moved, rotated, recolored...), instead of
+    /// rebuilding it: the leaves of the lights are re-initialized and the nodes along the paths from these leaves
+    /// to the root are refit to their children. The tree keeps its structure, which gets worse the further the
+    /// lights move. Returns false once the tree has degraded past sRefitDegradationThreshold since it was built,
+    /// the tree is still valid but should be rebuilt.
+    bool refit(const std::vector<uint32_t>& lightIndices);
+
+    /// How much the surface area orientation measure of the tree may grow by refitting before it's rebuilt
+    static constexpr float sRefitDegradationThreshold = 1.5f;
+
     /// Chooses light(s) using importance sampling and adaptive tree splitting [1] (Section 5.4).
     ///
     /// OUTPUTS:
@@ -56,6 +68,23 @@ public:
                 const IntegratorSample1D& lightSelectionSample,
                 const int* lightIdMap, int nonMirrorDepth) const;
 
+    /// Calls visitLight(lightIndex) for each light whose bounding box overlaps the ray segment from p to
+    /// p + maxDistance * wi. The light index is the index into the bounded lights the tree was built from.
+    /// This lets the tree double as the LightAccelerator's intersection structure.
+    template <typename F>
+    void intersectBounds(const scene_rdl2::math::Vec3f& p, const scene_rdl2::math::Vec3f& wi, float maxDistance,
+                         const F& visitLight) const
+    {
+        if (mNodes.empty()) {
+            return;
+        }
+        const scene_rdl2::math::Vec3f invDir(1.f / wi.x, 1.f / wi.y, 1.f / wi.z);
+        intersectBoundsRecurse(/* root index */ 0, p, invDir, maxDistance, visitLight);
+    }
+
+    /// Returns the number of bounded lights in the tree. Mesh lights are left out of the tree.
+    uint32_t getBoundedLightCount() const { return mNodes.empty() ? 0 : mBoundedLightCount; }
+
     /// Sets the sampling threshold (which determines the amount of adaptive tree splitting)
     void setSamplingThreshold(float threshold) { mSamplingThreshold = threshold; }
 
@@ -82,6 +111,39 @@ private:
         }
     }
 
+    // Does the ray segment [0, maxDistance] overlap the node's bounding box? A NaN slab distance, from a ray
+    // starting on a slab plane with a zero direction component, doesn't cull the node.
+    inline bool overlaps(const LightTreeNode& node, const scene_rdl2::math::Vec3f& p,
+                         const scene_rdl2::math::Vec3f& invDir, float maxDistance) const
+    {
+        const scene_rdl2::math::BBox3f& bbox = node.getBBox();
+        float tNear = 0.f;
+        float tFar = maxDistance;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float t0 = (bbox.lower[axis] - p[axis]) * invDir[axis];
+            const float t1 = (bbox.upper[axis] - p[axis]) * invDir[axis];
+            tNear = std::fmax(tNear, std::fmin(t0, t1));
+            tFar  = std::fmin(tFar,  std::fmax(t0, t1));
+        }
+        return tNear <= tFar;
+    }
+
+    template <typename F>
+    void intersectBoundsRecurse(uint32_t nodeIndex, const scene_rdl2::math::Vec3f& p,
+                                const scene_rdl2::math::Vec3f& invDir, float maxDistance, const F& visitLight) const
+    {
+        const LightTreeNode& node = mNodes[nodeIndex];
+        if (!overlaps(node, p, invDir, maxDistance)) {
+            return;
+        }
+        if (node.isLeaf()) {
+            visitLight(node.getLightIndex());
+            return;
+        }
+        intersectBoundsRecurse(nodeIndex + 1, p, invDir, maxDistance, visitLight);
+        intersectBoundsRecurse(node.getRightNodeIndex(), p, invDir, maxDistance, visitLight);
+    }
+
     // Returns whether all lights are in the same position
     inline bool lightsAreCoincident(const LightTreeNode& node, const Light* const* lights)
     {
@@ -179,6 +241,17 @@ private:
     /// Recursively build tree
     void buildRecurse(uint32_t nodeIndex);
 
+    /// Records the parent of each node and the leaf of each of the lightCount bounded lights, for refit()
+    void linkNodes(uint32_t lightCount);
+
+    /// Sum of the surface area orientation measure of the interior nodes
+    double getSaoMeasure() const;
+
+    /// Recursively shrinks the node bounding boxes to the union of the bounds of their lights. The split
+    /// candidates bound their lights by bucket, which can disagree with the partition for lights that land on a
+    /// bucket boundary, and intersectBounds() needs every light to be inside the boxes of its ancestors.
+    const scene_rdl2::math::BBox3f& refitBBoxesRecurse(uint32_t nodeIndex);
+
 
     /// Create a tree split. This involves initializing SplitCandidate objects, which are possibilities of tree splits. 
     /// Each SplitCandidate contains an axis and an associated cost. We choose (and initialize) the SplitCandidate
@@ -258,6 +331,10 @@ private:
     std::vector<LightTreeNode> mNodes;         // array of nodes 
     std::vector<uint32_t> mLightIndices;       // array of light indices -- allows us to change the "order" of 
                                                // lights in the light tree without mutating the lightset itself
+    std::vector<int32_t> mParentIndices;       // parent of each node, -1 for the root
+    std::vector<int32_t> mLeafIndices;         // leaf node of each bounded light, -1 for lights left out of the tree
+    double mBuildSaoMeasure = 0.0;             // measure of the tree as built
+    double mSaoMeasure = 0.0;                  // measure of the tree as refit since
 };
 
 } // end namespace pbr
@@ -224,6 +224,29 @@ void LightTreeNode::init(uint startIndex, float energy, const LightTreeCone& con
     calcEnergyVariance(lightCount, startIndex, lights, lightIndices);
 }
 
+void LightTreeNode::refit(const LightTreeNode& left, const LightTreeNode& right)
+{
+    MNRY_ASSERT(mLightCount == left.mLightCount + right.mLightCount);
+
+    mEnergy = left.mEnergy + right.mEnergy;
+    mBBox = left.mBBox;
+    mBBox.extend(right.mBBox);
+    mCone = combineCones(left.mCone, right.mCone);
+
+    // combine the energy variances of the children around the new mean
+    mEnergyMean = mEnergy / mLightCount;
+    const float diffL = left.mEnergyMean - mEnergyMean;
+    const float diffR = right.mEnergyMean - mEnergyMean;
+    mEnergyVariance = (left.mLightCount  * (left.mEnergyVariance  + diffL * diffL) +
+                       right.mLightCount * (right.mEnergyVariance + diffR * diffR)) / mLightCount;
+}
+
+float LightTreeNode::getSaoMeasure() const
+{
+    const SplitCandidate measure;
+    return measure.bboxArea(mBBox) * measure.calcOrientationTerm(mCone);
+}
+
 float LightTreeNode::importance(const Vec3f& p, const Vec3f& n, const LightTreeNode& sibling, bool cullLights) const
 {
     if (mLightCount == 0) return 0.f;
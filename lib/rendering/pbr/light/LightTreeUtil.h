@@ -189,6 +189,9 @@ public:
     /// Gets the energy mean
     inline float getEnergyMean() const { return mEnergyMean; }
 
+    /// Sets the bounding box of the node
+    inline void setBBox(const scene_rdl2::math::BBox3f& bbox) { mBBox = bbox; }
+
     /// Sets the index of the right child
     inline void setRightNodeIndex(uint i) { mRightNodeIndex = i; }
     
@@ -212,6 +215,14 @@ public:
               const std::vector<uint>& lightIndices, 
               uint lightCount);
 
+    /// Refit the node to its children, after the lights below it changed. The energy, bounding box, orientation
+    /// cone and energy statistics are combined from the children's, the lights aren't visited again.
+    void refit(const LightTreeNode& left, const LightTreeNode& right);
+
+    /// Surface area orientation measure of the node, its bounding box area times the orientation term of [1] eq (1).
+    /// Summed over the tree, it tells how much the tree degrades when it is refit rather than rebuilt.
+    float getSaoMeasure() const;
+
     // Calculate the importance weight for the node
     float importance(const scene_rdl2::math::Vec3f& p, 
                      const scene_rdl2::math::Vec3f& n, 
@@ -77,72 +77,32 @@ static constexpr float sThetaE = scene_rdl2::math::sHalfPi;
 // triangles.
 static constexpr float sThetaO = 0.0f;
 
+// The energy of a face is estimated from the map shader sampled on a lattice
+// of this many steps along each uv axis of the face, corners included.
+static constexpr int sEnergySampleSteps = 4;
+// The estimate is the mean of the lattice samples but no less than this
+// fraction of the brightest one, so a face whose emission peaks between the
+// lattice points is still drawn now and then.
+static constexpr float sEnergyMaxFraction = 0.125f;
+
 //----------------------------------------------------------------------------
 
-// Get uv coordinates of a point p on a quad. The first triangle of the quad is defined
-// by p0, p1, and p3. The second triangle is defined by p2, p3, and p1. If u + v <= 1,
-// then the point lies on the first tringle. If u + v > 1, then it lies on the second
-// triangle. If the quad is degenerate, or p lies outside of the quad, then we fall back
-// to a dummy uv of (0,0).
-scene_rdl2::math::Vec2f getQuadUVCoordinates(const scene_rdl2::math::Vec3f& p0, const scene_rdl2::math::Vec3f& p1, const scene_rdl2::math::Vec3f& p2,
-    const scene_rdl2::math::Vec3f& p3, const scene_rdl2::math::Vec3f& p)
+// Get the point at uv on a face. Triangles have their corners at uvs (0,0),
+// (1,0) and (0,1). Quads have theirs at (0,0), (1,0), (1,1) and (0,1), the
+// first triangle (p0, p1, p3) covers u + v <= 1 and the second triangle
+// (p2, p3, p1) the rest, with flipped uv coordinates.
+scene_rdl2::math::Vec3f getFacePoint(const scene_rdl2::math::Vec3f p[], unsigned faceVertexCount,
+    const scene_rdl2::math::Vec2f& uv)
 {
-    // Which triangle in the quad do we use to compute the uv coordinates for p?
-    // Figure out which side of the triangle's diagonal the point is on.
-    // The diagonal is p3 - p1.
-    const scene_rdl2::math::Vec3f diagonal = p3 - p1;
-    const scene_rdl2::math::Vec3f pvec = p - p1;
-    const scene_rdl2::math::Vec3f pvecxdiag = math::cross(pvec, diagonal);
-    // edge on first triangle
-    const scene_rdl2::math::Vec3f e1 = p0 - p1;
-    // edge on second triangle
-    const scene_rdl2::math::Vec3f e2 = p2 - p1;
-    // normal of first triangle
-    const scene_rdl2::math::Vec3f n1 = math::cross(e1, diagonal);
-    // normal of second triangle (pointing in opposite direction)
-    const scene_rdl2::math::Vec3f n2 = math::cross(e2, diagonal);
-    float tri1 = math::dot(pvecxdiag, n1);
-    float tri2 = math::dot(pvecxdiag, n2);
-    // 99% of the time, one dot product will be negative and the other will be positive.
-    // But if there is a precision error, pick the larger one.
-    bool insideTri1 = tri1 > tri2;
-
-    scene_rdl2::math::Vec2f uv;
-    if (insideTri1) {
-        float recipDenom = 1.0f / dot(n1, n1);
-        // w is weight applied to p0
-        float w = tri1 * recipDenom;
-        // v is weight applied to p3
-        float v = math::dot(math::cross(e1, pvec), n1) * recipDenom;
-        // u is weight applied to p1
-        float u = 1.f - v - w;
-        uv.x = u;
-        uv.y = v;
-    } else {
-        float recipDenom = 1.0f / dot(n2, n2);
-        // w is weight applied to p2
-        float w = tri2 * recipDenom;
-        // v is weight applied to p3
-        float v = math::dot(math::cross(e2, pvec), n2) * recipDenom;
-        // u is weight applied to p1
-        float u = 1.f - v - w;
-        // second triangle must flip the uv coordinates
-        uv.x = 1.f - u;
-        uv.y = 1.f - v;
-    }
-
-    // Check that uv is valid. Reasons to have an invalid uv are:
-    // Zero area quad or the point p is outside the quad.
-    // In that case, make a dummy uv.
-    if (!math::isFinite(uv) ||
-        uv.x > 1.f || uv.y > 1.f ||
-        uv.x < 0.f || uv.y < 0.f) {
-
-        uv.x = 0.f;
-        uv.y = 0.f;
-    }
-
-    return uv;
+    const float w = 1.f - uv.x - uv.y;
+    if (faceVertexCount == 3 || w >= 0.f) {
+        // triangle, or first triangle (p0, p1, p3) of the quad
+        return w * p[0] + uv.x * p[1] + uv.y * (faceVertexCount == 3 ? p[2] : p[3]);
+    }
+    // second triangle (p2, p3, p1) of the quad, which flips the uv coordinates
+    const float u = 1.f - uv.x;
+    const float v = 1.f - uv.y;
+    return (1.f - u - v) * p[2] + u * p[1] + v * p[3];
 }
 
 // Given three points that define a triangle, find the cross product of
@@ -806,66 +766,36 @@ MeshLight::setMesh(geom::internal::Primitive* prim)
         faces[f].mInvArea = 1 / area;
 
         // get energy
-        // TODO: more fine detail on texture sampling? Take average instead of max?
-        // Currently we sample the texture from each corner of the mesh and from its
-        // center. But it might be better to take many more samples than that.
         if (mMapShader) {
-            float energy = 0.0f;
             mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
-
-            // In order to approximate the energy of a face, we sample at each
-            // corner of the face and its center and take the maximum color value.
-            // Due to the location of the samples, it is trivial to compute most
-            // of the uv coordinates.
-
-            // sample texture at first corner of the face
-            const scene_rdl2::math::Color& firstColor = sampleMapShader(tls, geomID, f,
-                getFaceVertex(faces[f], 0, centroidTime), faces[f].mNormal, scene_rdl2::math::Vec2f(0.f, 0.f));
-            energy = scene_rdl2::math::max(energy, luminance(firstColor));
-
-            // sample texture at second corner of the face
-            const scene_rdl2::math::Color& secondColor = sampleMapShader(tls, geomID, f,
-                getFaceVertex(faces[f], 1, centroidTime), faces[f].mNormal, scene_rdl2::math::Vec2f(1.f, 0.f));
-            energy = scene_rdl2::math::max(energy, luminance(secondColor));
-
-            // sample texture at third corner of the face
-            scene_rdl2::math::Vec2f thirdUV;
-            if (faceVertexCount == 3) {
-                // triangle
-                thirdUV = scene_rdl2::math::Vec2f(0.f, 1.f);
-            } else {
-                // quad
-                thirdUV = scene_rdl2::math::Vec2f(1.f, 1.f);
+            scene_rdl2::alloc::Arena *arena = &tls->mArena;
+            SCOPED_MEM(arena);
+
+            // Sample the texture on a lattice over the uvs of the face. A single
+            // corner and the center miss emission features smaller than the
+            // face, which then gets drawn far too rarely for how bright it is.
+            scene_rdl2::math::Vec3f p[4];
+            for (unsigned i = 0; i < faceVertexCount; ++i) {
+                p[i] = getFaceVertex(faces[f], i, centroidTime);
             }
-            const scene_rdl2::math::Color& thirdColor = sampleMapShader(tls, geomID, f,
-                getFaceVertex(faces[f], 2, centroidTime), faces[f].mNormal, thirdUV);
-            energy = scene_rdl2::math::max(energy, luminance(thirdColor));
-
-            // sample texture at fourth corner if the face is a quad
-            if (faceVertexCount == 4) {
-                const scene_rdl2::math::Color& fourthColor = sampleMapShader(tls, geomID, f,
-                    getFaceVertex(faces[f], 3, centroidTime), faces[f].mNormal, scene_rdl2::math::Vec2f(0.f, 1.f));
-                energy = scene_rdl2::math::max(energy, luminance(fourthColor));
-            }
-
-            // sample texture in the middle of the face
-            scene_rdl2::math::Vec2f centerUV;
-            if (faceVertexCount == 3) {
-                // the uv is trivial if the face is a triangle
-                centerUV = scene_rdl2::math::Vec2f(1.f / 3.f, 1.f / 3.f);
-            } else {
-                // if the face is a quad, we need to compute the uv coordinate
-                const scene_rdl2::math::Vec3f& p0 = getFaceVertex(faces[f], 0, centroidTime);
-                const scene_rdl2::math::Vec3f& p1 = getFaceVertex(faces[f], 1, centroidTime);
-                const scene_rdl2::math::Vec3f& p2 = getFaceVertex(faces[f], 2, centroidTime);
-                const scene_rdl2::math::Vec3f& p3 = getFaceVertex(faces[f], 3, centroidTime);
-                const scene_rdl2::math::Vec3f& center = faces[f].mCenter;
-
-                centerUV = getQuadUVCoordinates(p0, p1, p2, p3, center);
+            float energySum = 0.0f;
+            float energyMax = 0.0f;
+            int sampleCount = 0;
+            for (int j = 0; j <= sEnergySampleSteps; ++j) {
+                // triangles only cover the lower half of the uv square
+                const int iEnd = (faceVertexCount == 3) ? sEnergySampleSteps - j : sEnergySampleSteps;
+                for (int i = 0; i <= iEnd; ++i) {
+                    const scene_rdl2::math::Vec2f uv(float(i) / sEnergySampleSteps,
+                                                     float(j) / sEnergySampleSteps);
+                    const float energy = luminance(sampleMapShader(tls, geomID, f,
+                        getFacePoint(p, faceVertexCount, uv), faces[f].mNormal, uv));
+                    energySum += energy;
+                    energyMax = scene_rdl2::math::max(energyMax, energy);
+                    ++sampleCount;
+                }
             }
-            const scene_rdl2::math::Color& centerColor = sampleMapShader(tls, geomID, f,
-                faces[f].mCenter, faces[f].mNormal, centerUV);
-            energy = scene_rdl2::math::max(energy, luminance(centerColor));
+            const float energy = scene_rdl2::math::max(energySum / sampleCount,
+                                                       sEnergyMaxFraction * energyMax);
             faces[f].mEnergy = energy * area;
         } else {
             faces[f].mEnergy = 1.0f * area;
@@ -1511,19 +1441,17 @@ MeshLight::getPdfOfFace(size_t nodeID, const scene_rdl2::math::Vec3f& p, const s
     float pdf = 1.0f;
     unsigned currNodeIndex = nodeID;
     while (currNodeIndex > 0) {
-        Node currNode = mBVH[currNodeIndex];
+        // The nodes are only read, no need to copy them on every level.
+        const Node& currNode = mBVH[currNodeIndex];
         MNRY_ASSERT(currNode.mParentIndex < (int)mBVH.size() ||
             (currNode.mParentIndex == -1 && currNodeIndex == 0));
-        Node siblingNode;
         const Node& parentNode = mBVH[currNode.mParentIndex];
-        if (parentNode.mRightChildIndex == currNodeIndex) {
-            // currNode is the right child, sibling is the left child
-            siblingNode = mBVH[currNode.mParentIndex + 1];
-        } else {
-            // currNode is the left child, sibling is the right child
-            MNRY_ASSERT(currNodeIndex == currNode.mParentIndex + 1);
-            siblingNode =  mBVH[parentNode.mRightChildIndex];
-        }
+        // currNode is the right child and its sibling the left one, or the
+        // other way around
+        MNRY_ASSERT(parentNode.mRightChildIndex == (int)currNodeIndex ||
+                    currNodeIndex == currNode.mParentIndex + 1);
+        const Node& siblingNode = (parentNode.mRightChildIndex == (int)currNodeIndex) ?
+            mBVH[currNode.mParentIndex + 1] : mBVH[parentNode.mRightChildIndex];
 
         float currImportance = importance(p, n, currNode);
         float siblingImportance = importance(p, n, siblingNode);
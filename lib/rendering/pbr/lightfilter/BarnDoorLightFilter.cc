@@ -272,7 +272,8 @@ BarnDoorLightFilter::update(const LightFilterMap& /*lightFilters*/,
 
     // Setup mProjector2Screen
     mProjector2Screen = Mat4f(math::one);
-    switch (mRdlLightFilter->get(sProjectorTypeKey)) {
+    mProjectorType = mRdlLightFilter->get(sProjectorTypeKey);
+    switch (mProjectorType) {
     case PERSPECTIVE:
         mProjector2Screen = getPerspectiveProjectionMatrix();
         break;
@@ -295,6 +296,14 @@ BarnDoorLightFilter::update(const LightFilterMap& /*lightFilters*/,
     mMinCorner = center - filmSize * 0.5f;
     mMaxCorner = center + filmSize * 0.5f;
 
+    // Bounding box of the edge transition, see canIlluminate()
+    mOuterMinCorner = mMinCorner -
+        Vec2f(max(mRadius, 1.f / mReciprocalEdgeScales[BARNDOOR_EDGE_LEFT]),
+              max(mRadius, 1.f / mReciprocalEdgeScales[BARNDOOR_EDGE_BOTTOM]));
+    mOuterMaxCorner = mMaxCorner +
+        Vec2f(max(mRadius, 1.f / mReciprocalEdgeScales[BARNDOOR_EDGE_RIGHT]),
+              max(mRadius, 1.f / mReciprocalEdgeScales[BARNDOOR_EDGE_TOP]));
+
     // A note about rotations
     //
     // Most lights (Spot, Disk, Rect, Sphere, Distant) have a 180 degree
@@ -373,8 +382,11 @@ BarnDoorLightFilter::canIlluminate(const CanIlluminateData& data) const
     Xform3f r2l = mUseLightXform ? 
         data.lightRender2LocalXform : getXformRender2Local(data.time);
 
+    // shading point in projector space
+    const Vec3f pt = transformPoint(r2l, data.shadingPointPosition);
+
     // z distance from projector
-    float shadingDist = transformPoint(r2l, data.shadingPointPosition).z;
+    float shadingDist = pt.z;
 
     // No illumination behind barn
     if (shadingDist < 0.f) {
@@ -394,7 +406,39 @@ BarnDoorLightFilter::canIlluminate(const CanIlluminateData& data) const
         }
     }
 
-    return true;
+    return !isOutsideCullingVolume(r2l, pt, data.shadingPointRadius);
+}
+
+bool
+BarnDoorLightFilter::isOutsideCullingVolume(const Xform3f &r2l, const Vec3f &pt, float radius) const
+{
+    // In analytic mode the filter only depends on the shading point, which is
+    // black outside of the edge transition at full density. It is otherwise
+    // let through somewhere whatever the shading point.
+    if (mMode != ANALYTIC || mInvert || mDensity < 1.f) {
+        return false;
+    }
+
+    // Bound the radius of the shading point's sphere in projector space
+    const float localRadius = radius *
+        sqrt(lengthSqr(r2l.l.vx) + lengthSqr(r2l.l.vy) + lengthSqr(r2l.l.vz));
+    const float nearDist = pt.z - localRadius;
+    if (mPreBarnMode == WHITE && nearDist < mPreBarnDist) {
+        return false;
+    }
+
+    const Vec3f screenP = transformH(mProjector2Screen, pt);
+    float margin = localRadius;
+    if (mProjectorType == PERSPECTIVE) {
+        if (nearDist <= 0.f) {
+            return false;
+        }
+        // Bound of the change of xy / z over the sphere
+        margin = localRadius * (1.f + max(abs(screenP.x), abs(screenP.y))) / nearDist;
+    }
+
+    return screenP.x + margin < mOuterMinCorner.x || screenP.x - margin > mOuterMaxCorner.x ||
+           screenP.y + margin < mOuterMinCorner.y || screenP.y - margin > mOuterMaxCorner.y;
 }
 
 namespace {   // functions for local use only
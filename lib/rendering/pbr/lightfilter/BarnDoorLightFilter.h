@@ -58,6 +58,7 @@ public:
     virtual bool canIlluminate(const CanIlluminateData& data) const override;
     virtual scene_rdl2::math::Color eval(const EvalData& data) const override;
     virtual bool needsLightXform() const override { return mUseLightXform; }
+    virtual EvalOrder getEvalOrder() const override { return EVAL_ORDER_CULLING; }
 
     /// HUD validation and type casting
     static uint32_t hudValidation(bool verbose) {
@@ -77,6 +78,11 @@ private:
         return isMb() ? getSlerpXformRender2Local(time) : mRender2Local0;
     }
 
+    // Is the sphere of shading points around pt (in projector space) in the
+    // region no light passes through?
+    bool isOutsideCullingVolume(const scene_rdl2::math::Xform3f &r2l,
+                                const scene_rdl2::math::Vec3f &pt, float radius) const;
+
     static scene_rdl2::math::Mat4f getPerspectiveProjectionMatrix();
     static scene_rdl2::math::Mat4f getOrthoProjectionMatrix();
 
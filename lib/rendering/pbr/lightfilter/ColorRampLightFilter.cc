@@ -114,6 +114,7 @@ ColorRampLightFilter::update(const LightFilterMap& /*lightFilters*/,
         colorsVec.data(),
         reinterpret_cast<const ispc::RampInterpolatorMode*>(interpolationTypesVec.data()),
         ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+    mColorRamp.bake();
 
     mIntensity = mRdlLightFilter->get<rdl2::Float>(sIntensityKey);
     mDensity = clamp(mRdlLightFilter->get<rdl2::Float>(sDensityKey), 0.f, 1.f);
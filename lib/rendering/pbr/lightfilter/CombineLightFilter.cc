@@ -103,6 +103,18 @@ CombineLightFilter::needsLightXform() const {
     return false;
 }
 
+LightFilter::EvalOrder
+CombineLightFilter::getEvalOrder() const
+{
+    // Only as cheap as its most expensive child, and whether the combination
+    // zeroes the light depends on the mode.
+    EvalOrder order = EVAL_ORDER_DEFAULT;
+    for (int i = 0; i < mLightFiltersVec.size(); i++) {
+        order = std::max(order, mLightFiltersVec[i]->getEvalOrder());
+    }
+    return order;
+}
+
 bool
 CombineLightFilter::canIlluminate(const CanIlluminateData& data) const
 {
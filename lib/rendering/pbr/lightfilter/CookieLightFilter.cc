@@ -7,9 +7,12 @@
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/bvh/shading/State.h>
+#include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 #include <moonray/rendering/pbr/core/Util.h>
 #include <moonray/rendering/pbr/lightfilter/CookieLightFilter_ispc_stubs.h>
 
+#include <cmath>
+
 namespace moonray {
 namespace pbr{
 
@@ -24,6 +27,7 @@ rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sProjectorFocalKey;
 rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sProjectorFilmWidthApertureKey;
 rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sProjectorPixelAspectRatioKey;
 rdl2::AttributeKey<rdl2::SceneObject *> CookieLightFilter::sMapShaderKey;
+rdl2::AttributeKey<rdl2::Int> CookieLightFilter::sBakeResolutionKey;
 rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sBlurNearDistanceKey;
 rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sBlurMidpointKey;
 rdl2::AttributeKey<rdl2::Float> CookieLightFilter::sBlurFarDistanceKey;
@@ -40,7 +44,10 @@ HUD_VALIDATOR(CookieLightFilter);
 
 CookieLightFilter::CookieLightFilter(const rdl2::LightFilter* rdlLightFilter) :
     LightFilter(rdlLightFilter),
-    mMapShader(nullptr)
+    mMapShader(nullptr),
+    mBakedPixels(nullptr),
+    mBakedResolution(0),
+    mBakedNumLevels(0)
 {
     if (mRdlLightFilter) {
         initAttributeKeys(mRdlLightFilter->getSceneClass());
@@ -67,6 +74,7 @@ CookieLightFilter::initAttributeKeys(const rdl2::SceneClass &sc)
     sProjectorFilmWidthApertureKey = sc.getAttributeKey<rdl2::Float>("projector_film_width_aperture");
     sProjectorPixelAspectRatioKey = sc.getAttributeKey<rdl2::Float>("projector_pixel_aspect_ratio");
     sMapShaderKey = sc.getAttributeKey<rdl2::SceneObject *>("texture_map");
+    sBakeResolutionKey = sc.getAttributeKey<rdl2::Int>("bake_resolution");
     sBlurNearDistanceKey = sc.getAttributeKey<rdl2::Float>("blur_near_distance");
     sBlurMidpointKey = sc.getAttributeKey<rdl2::Float>("blur_midpoint");
     sBlurFarDistanceKey = sc.getAttributeKey<rdl2::Float>("blur_far_distance");
@@ -310,6 +318,80 @@ CookieLightFilter::update(const LightFilterMap& /*lightFilters*/,
 
     mDensity = clamp(mRdlLightFilter->get<rdl2::Float>(sDensityKey), 0.f, 1.f);
     mInvert = mRdlLightFilter->get<rdl2::Bool>(sInvertKey);
+
+    const int bakeResolution = mRdlLightFilter->get<rdl2::Int>(sBakeResolutionKey);
+    if (mMapShader && bakeResolution > 0) {
+        bakeMapShader(bakeResolution);
+    } else {
+        clearBakedMap();
+    }
+}
+
+void
+CookieLightFilter::clearBakedMap()
+{
+    std::vector<float>().swap(mBakedPixelsVec);
+    mBakedPixels = nullptr;
+    mBakedResolution = 0;
+    mBakedNumLevels = 0;
+}
+
+void
+CookieLightFilter::bakeMapShader(int resolution)
+{
+    // Power of two, so each level is exactly half of the one above
+    const int maxResolution = 1 << (COOKIE_MAX_BAKED_LEVELS - 1);
+    int res = 1;
+    int numLevels = 1;
+    while (res < resolution && res < maxResolution) {
+        res <<= 1;
+        ++numLevels;
+    }
+
+    size_t size = 0;
+    for (int level = 0; level < numLevels; ++level) {
+        const size_t levelRes = res >> level;
+        mBakedLevelOffsets[level] = static_cast<int>(size);
+        size += levelRes * levelRes * 3;
+    }
+    mBakedPixelsVec.assign(size, 0.f);
+    float *pixels = mBakedPixelsVec.data();
+
+    // Finest level: the map at the texel centers. The map is only given a uv,
+    // like in sampleMapShader().
+    mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
+    const float invRes = 1.f / res;
+    for (int y = 0; y < res; ++y) {
+        SCOPED_MEM(&tls->mArena);
+        for (int x = 0; x < res; ++x) {
+            const Color c = sampleMapShader(tls, Vec2f((x + 0.5f) * invRes, (y + 0.5f) * invRes));
+            float *texel = pixels + (y * res + x) * 3;
+            texel[0] = c.r;
+            texel[1] = c.g;
+            texel[2] = c.b;
+        }
+    }
+
+    // Coarser levels: 2x2 box filter of the level above
+    for (int level = 1; level < numLevels; ++level) {
+        const int srcRes = res >> (level - 1);
+        const int dstRes = res >> level;
+        const float *src = pixels + mBakedLevelOffsets[level - 1];
+        float *dst = pixels + mBakedLevelOffsets[level];
+        for (int y = 0; y < dstRes; ++y) {
+            for (int x = 0; x < dstRes; ++x) {
+                const float *s00 = src + ((2 * y) * srcRes + 2 * x) * 3;
+                const float *s01 = s00 + srcRes * 3;
+                for (int c = 0; c < 3; ++c) {
+                    dst[(y * dstRes + x) * 3 + c] = 0.25f * (s00[c] + s00[c + 3] + s01[c] + s01[c + 3]);
+                }
+            }
+        }
+    }
+
+    mBakedPixels = pixels;
+    mBakedResolution = res;
+    mBakedNumLevels = numLevels;
 }
 
 bool
@@ -437,7 +519,8 @@ CookieLightFilter::eval(const EvalData& data) const
     }
 
     // Lookup the map value using the displaced screen space position
-    Color mapValue = sampleMapShader(data.tls, st);
+    Color mapValue = mBakedPixels ? sampleBakedMap(st, filterRadius) :
+                                    sampleMapShader(data.tls, st);
 
     // Apply density scaling to allow partial light filtering
     mapValue = Color(1.f - mDensity) + mapValue * mDensity;
@@ -478,6 +561,50 @@ CookieLightFilter::sampleMapShader(mcrt_common::ThreadLocalState* tls,
     return result;
 }
 
+Color
+CookieLightFilter::lookupBakedMap(int level, float s, float t) const
+{
+    // Bilinear, clamped to the edge texels
+    const int res = mBakedResolution >> level;
+    const float *pixels = mBakedPixels + mBakedLevelOffsets[level];
+
+    const float x = s * res - 0.5f;
+    const float y = t * res - 0.5f;
+    int x0 = static_cast<int>(floor(x));
+    int y0 = static_cast<int>(floor(y));
+    const float xf = x - x0;
+    const float yf = y - y0;
+    const int x1 = clamp(x0 + 1, 0, res - 1);
+    const int y1 = clamp(y0 + 1, 0, res - 1);
+    x0 = clamp(x0, 0, res - 1);
+    y0 = clamp(y0, 0, res - 1);
+
+    const float *p00 = pixels + (y0 * res + x0) * 3;
+    const float *p10 = pixels + (y0 * res + x1) * 3;
+    const float *p01 = pixels + (y1 * res + x0) * 3;
+    const float *p11 = pixels + (y1 * res + x1) * 3;
+    return lerp(lerp(Color(p00[0], p00[1], p00[2]), Color(p10[0], p10[1], p10[2]), xf),
+                lerp(Color(p01[0], p01[1], p01[2]), Color(p11[0], p11[1], p11[2]), xf), yf);
+}
+
+Color
+CookieLightFilter::sampleBakedMap(const Vec2f& st, float filterRadius) const
+{
+    // The blur jitters st over the filter radius, so a level whose texels are
+    // half the radius wide adds little blur but removes most of the noise.
+    const float lod = clamp(std::log2(max(0.5f * filterRadius * mBakedResolution, 1.f)),
+                            0.f, static_cast<float>(mBakedNumLevels - 1));
+    const int level0 = static_cast<int>(lod);
+    const int level1 = min(level0 + 1, mBakedNumLevels - 1);
+    const float t = lod - level0;
+
+    const Color c0 = lookupBakedMap(level0, st.x, st.y);
+    if (t == 0.f || level1 == level0) {
+        return c0;
+    }
+    return lerp(c0, lookupBakedMap(level1, st.x, st.y), t);
+}
+
 } //namespace pbr
 } //namespace moonray
 
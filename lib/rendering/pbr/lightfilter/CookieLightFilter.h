@@ -7,10 +7,14 @@
 
 #include <scene_rdl2/common/math/Color.h>
 
+#include <vector>
+
 // The cookie light filter takes a render space position and transforms it to
 // a screen space position for a specified camera projection.  The screen space
 // position is used to lookup a value in a Map shader, which becomes the filter value.
 // The screen space position may be displaced by a random amount to apply a blur filter.
+// If bake_resolution is set, the map is baked into a mip pyramid at update() and
+// looked up directly, the blur then also selects a coarser, prefiltered level.
 
 // Forward declaration of the ISPC types
 namespace ispc {
@@ -25,7 +29,7 @@ class CookieLightFilter : public LightFilter
 public:
     void initAttributeKeys(const scene_rdl2::rdl2::SceneClass &sc);
 
-    CookieLightFilter() : mMapShader(nullptr) {}
+    CookieLightFilter() : mMapShader(nullptr), mBakedPixels(nullptr), mBakedResolution(0), mBakedNumLevels(0) {}
     CookieLightFilter(const scene_rdl2::rdl2::LightFilter* rdlLightFilter);
 
     virtual ~CookieLightFilter() override {}
@@ -35,6 +39,7 @@ public:
     virtual bool canIlluminate(const CanIlluminateData& data) const override;
     virtual scene_rdl2::math::Color eval(const EvalData& data) const override;
     virtual bool needsSamples() const override;
+    virtual EvalOrder getEvalOrder() const override { return EVAL_ORDER_EXPENSIVE; }
 
     /// HUD validation and type casting
     static uint32_t hudValidation(bool verbose) {
@@ -50,6 +55,14 @@ private:
     scene_rdl2::math::Color sampleMapShader(mcrt_common::ThreadLocalState* tls,
                           const scene_rdl2::math::Vec2f& st) const;
 
+    // Bakes the map shader into mBakedPixels, resolution is rounded up to a power of two.
+    void bakeMapShader(int resolution);
+    void clearBakedMap();
+
+    // Trilinear lookup of the baked map, the level is chosen from the blur filter radius.
+    scene_rdl2::math::Color sampleBakedMap(const scene_rdl2::math::Vec2f& st, float filterRadius) const;
+    scene_rdl2::math::Color lookupBakedMap(int level, float s, float t) const;
+
     COOKIE_LIGHT_FILTER_MEMBERS;
 
     static bool sAttributeKeyInitialized;
@@ -60,6 +73,7 @@ private:
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sProjectorFilmWidthApertureKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sProjectorPixelAspectRatioKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::SceneObject *> sMapShaderKey;
+    static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Int> sBakeResolutionKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sBlurNearDistanceKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sBlurMidpointKey;
     static scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::Float> sBlurFarDistanceKey;
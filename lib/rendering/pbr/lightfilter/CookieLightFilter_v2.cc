@@ -7,9 +7,12 @@
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/bvh/shading/State.h>
+#include <moonray/rendering/pbr/core/ImageDistributionCache.h>
 #include <moonray/rendering/pbr/core/Util.h>
 #include <moonray/rendering/pbr/lightfilter/CookieLightFilter_v2_ispc_stubs.h>
 
+#include <cmath>
+
 namespace moonray {
 namespace pbr{
 
@@ -52,7 +55,7 @@ CookieLightFilter_v2::CookieLightFilter_v2(const rdl2::LightFilter* rdlLightFilt
 
 CookieLightFilter_v2::~CookieLightFilter_v2()
 {
-    delete mDistribution;
+    ImageDistributionCache::get().release(mDistribution);
 }
 
 void
@@ -309,8 +312,9 @@ CookieLightFilter_v2::update(const LightFilterMap& /*lightFilters*/,
 
     try {
         rdl2::Rgb gamma = mRdlLightFilter->get<rdl2::Rgb>(sGammaKey);
-        delete mDistribution;
-        mDistribution = new ImageDistribution(textureFilename, 
+        ImageDistributionCache::get().release(mDistribution);
+        mDistribution = nullptr;
+        mDistribution = ImageDistributionCache::get().acquire(textureFilename,
                                               Distribution2D::Mapping::PLANAR,
                                               gamma,
                                               sWhite, 
@@ -452,9 +456,13 @@ CookieLightFilter_v2::eval(const EvalData& data) const
         }
     }
 
-    // Lookup the map value using the displaced screen space position
-    Color mapValue = mDistribution->eval(st.x, st.y, 0,
-                         moonray::pbr::TextureFilterType::TEXTURE_FILTER_BILINEAR);
+    // Lookup the map value using the displaced screen space position. The
+    // blur jitters st over the filter radius, so the mip level whose texels
+    // are half the radius wide (if the texture has mip levels) adds little
+    // blur but removes most of the noise.
+    const float mipLevel = std::log2(max(0.5f * filterRadius * mDistribution->getWidth(), 1.f));
+    Color mapValue = mDistribution->eval(st.x, st.y, mipLevel,
+                         moonray::pbr::TextureFilterType::TEXTURE_FILTER_BILINEAR_MIP_NEAREST);
 
     // Apply density scaling to allow partial light filtering
     mapValue = Color(1.f - mDensity) + mapValue * mDensity;
@@ -37,6 +37,7 @@ public:
     virtual bool canIlluminate(const CanIlluminateData& data) const override;
     virtual scene_rdl2::math::Color eval(const EvalData& data) const override;
     virtual bool needsSamples() const override;
+    virtual EvalOrder getEvalOrder() const override { return EVAL_ORDER_EXPENSIVE; }
 
     /// HUD validation and type casting
     static uint32_t hudValidation(bool verbose) {
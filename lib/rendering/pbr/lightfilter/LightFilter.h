@@ -19,6 +19,8 @@
 #include <scene_rdl2/common/math/Vec3.h>
 #include <scene_rdl2/common/platform/HybridUniformData.h>
 
+#include <algorithm>
+
 // Forward declaration of the ISPC types
 namespace ispc {
     struct LightFilter;
@@ -83,10 +85,22 @@ public:
         scene_rdl2::math::Vec3f wi;   // direction of incoming light
     };
 
+    /// Order in which the filters of a LightFilterList are evaluated: cheap
+    /// filters which often zero the light, such as the ones bounding a lit
+    /// region, go first so the list can stop early, filters doing texture or
+    /// volume lookups go last.
+    enum EvalOrder
+    {
+        EVAL_ORDER_CULLING,
+        EVAL_ORDER_DEFAULT,
+        EVAL_ORDER_EXPENSIVE
+    };
+
     virtual bool canIlluminate(const CanIlluminateData& data) const = 0;
     virtual scene_rdl2::math::Color eval(const EvalData& data) const = 0;
     virtual bool needsLightXform() const { return false; }
     virtual bool needsSamples() const { return false; }
+    virtual EvalOrder getEvalOrder() const { return EVAL_ORDER_DEFAULT; }
 
 protected:
 
@@ -118,6 +132,13 @@ public:
         mLightFilterCount = count;
         mNeedsLightXform = false;
 
+        // The filters multiply, so their order only matters for the early out
+        // of evalLightFilterList().
+        std::stable_sort(mLightFilters.get(), mLightFilters.get() + mLightFilterCount,
+                         [](const LightFilter* a, const LightFilter* b) {
+                             return a->getEvalOrder() < b->getEvalOrder();
+                         });
+
         for (int i = 0; i < mLightFilterCount; i++) {
             if (mLightFilters[i]->needsLightXform()) {
                 mNeedsLightXform = true;
@@ -161,6 +182,10 @@ inline void evalLightFilterList(const LightFilterList* lightFilterList,
         const LightFilter *lightFilter = lightFilterList->getLightFilter(i);
         MNRY_ASSERT(lightFilter);
         radiance *= lightFilter->eval(data);
+        // Fully filtered, the remaining filters can't bring the light back
+        if (scene_rdl2::math::isExactlyZero(radiance)) {
+            return;
+        }
     }
 }
 
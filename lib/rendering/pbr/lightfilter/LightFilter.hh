@@ -135,8 +135,20 @@ enum CookieOutsideProjection
     DEFAULT
 };
 
+// Levels of the baked map pyramid, enough for a 16k bake resolution
+#define COOKIE_MAX_BAKED_LEVELS     15
+
+// mBakedPixels         RGB texels of all the levels of the baked map, finest first
+// mBakedLevelOffsets   Offset of each level in mBakedPixels, in floats
+// mBakedResolution     Width and height of the finest level, 0 if the map isn't baked
+
 #define COOKIE_LIGHT_FILTER_MEMBERS                                           \
     HUD_PTR(const int64 *, mMapShader);                                       \
+    HUD_CPP_MEMBER(std::vector<float>, mBakedPixelsVec, SIZEOF_STD_VECTOR);   \
+    HUD_PTR(const float *, mBakedPixels);                                     \
+    HUD_ARRAY(int, mBakedLevelOffsets, COOKIE_MAX_BAKED_LEVELS);              \
+    HUD_MEMBER(int, mBakedResolution);                                        \
+    HUD_MEMBER(int, mBakedNumLevels);                                         \
     HUD_ARRAY(HUD_NAMESPACE(scene_rdl2::math, Mat4f), mProjectorR2S, 2);      \
     HUD_ARRAY(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mProjectorPos, 2);      \
     HUD_ARRAY(HUD_NAMESPACE(scene_rdl2::math, Vec3f), mProjectorDir, 2);      \
@@ -154,6 +166,11 @@ enum CookieOutsideProjection
 #define COOKIE_LIGHT_FILTER_VALIDATION                                        \
     HUD_BEGIN_VALIDATION(CookieLightFilter);                                  \
     HUD_VALIDATE(CookieLightFilter, mMapShader);                              \
+    HUD_VALIDATE(CookieLightFilter, mBakedPixelsVec);                         \
+    HUD_VALIDATE(CookieLightFilter, mBakedPixels);                            \
+    HUD_VALIDATE(CookieLightFilter, mBakedLevelOffsets);                      \
+    HUD_VALIDATE(CookieLightFilter, mBakedResolution);                        \
+    HUD_VALIDATE(CookieLightFilter, mBakedNumLevels);                         \
     HUD_VALIDATE(CookieLightFilter, mProjectorR2S);                           \
     HUD_VALIDATE(CookieLightFilter, mProjectorPos);                           \
     HUD_VALIDATE(CookieLightFilter, mProjectorDir);                           \
@@ -373,6 +390,10 @@ enum BarnDoorEdge
 // mProjector2Screen     Projection matrix (perspective or orthographic)
 // mMinCorner            Aperture min corner at the virtual focal length (1.0)
 // mMaxCorner            Aperture max corner at the virtual focal length (1.0)
+// mOuterMinCorner       Min corner of the edge transition's bounding box, no
+//                       light passes outside of it (the culling volume)
+// mOuterMaxCorner       Max corner of the edge transition's bounding box
+// mProjectorType        Perspective or orthographic projection
 // mMode                 Analytic or Physical mode toggle
 // mUseLightXform        Bind projector to the light?
 // mPreBarnMode          Choice of behavior for region before the Barn Door
@@ -396,6 +417,9 @@ enum BarnDoorEdge
     HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Mat4f), mProjector2Screen);    \
     HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec2f), mMinCorner);           \
     HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec2f), mMaxCorner);           \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec2f), mOuterMinCorner);      \
+    HUD_MEMBER(HUD_NAMESPACE(scene_rdl2::math, Vec2f), mOuterMaxCorner);      \
+    HUD_MEMBER(int, mProjectorType);                                          \
     HUD_MEMBER(int, mMode);                                                   \
     HUD_MEMBER(bool, mUseLightXform);                                         \
     HUD_MEMBER(int, mPreBarnMode);                                            \
@@ -420,6 +444,9 @@ enum BarnDoorEdge
     HUD_VALIDATE(BarnDoorLightFilter, mProjector2Screen);                     \
     HUD_VALIDATE(BarnDoorLightFilter, mMinCorner);                            \
     HUD_VALIDATE(BarnDoorLightFilter, mMaxCorner);                            \
+    HUD_VALIDATE(BarnDoorLightFilter, mOuterMinCorner);                       \
+    HUD_VALIDATE(BarnDoorLightFilter, mOuterMaxCorner);                       \
+    HUD_VALIDATE(BarnDoorLightFilter, mProjectorType);                        \
     HUD_VALIDATE(BarnDoorLightFilter, mMode);                                 \
     HUD_VALIDATE(BarnDoorLightFilter, mUseLightXform);                        \
     HUD_VALIDATE(BarnDoorLightFilter, mPreBarnMode);                          \
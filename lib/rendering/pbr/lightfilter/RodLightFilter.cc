@@ -188,6 +188,7 @@ RodLightFilter::update(const LightFilterMap& /*lightFilters*/,
         inDistancesVec.data(),
         outDistancesVec.data(),
         reinterpret_cast<const ispc::RampInterpolatorMode*>(interpolationTypesVec.data()));
+    mRamp.bake();
 }
 
 Vec3f
@@ -33,6 +33,7 @@ public:
                         const scene_rdl2::math::Mat4d& world2render) override;
     virtual bool canIlluminate(const CanIlluminateData& data) const override;
     virtual scene_rdl2::math::Color eval(const EvalData& data) const override;
+    virtual EvalOrder getEvalOrder() const override { return EVAL_ORDER_CULLING; }
 
     /// HUD validation and type casting
     static uint32_t hudValidation(bool verbose) {
@@ -226,6 +226,7 @@ VdbLightFilter::update(const LightFilterMap& /*lightFilters*/,
             inDensityRampVec.data(),
             outDensityRampVec.data(),
             reinterpret_cast<const ispc::RampInterpolatorMode*>(interpolationTypesVec.data()));
+    mDensityRamp.bake();
 
     mBlurValue = mRdlLightFilter->get<rdl2::Float>(sBlurValueKey);
     mBlurType = mRdlLightFilter->get<rdl2::Int>(sBlurType);
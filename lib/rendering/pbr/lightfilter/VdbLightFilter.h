@@ -41,6 +41,7 @@ public:
                         const scene_rdl2::math::Mat4d& world2render) override;
     bool canIlluminate(const CanIlluminateData& data) const override;
     virtual bool needsSamples() const override;
+    virtual EvalOrder getEvalOrder() const override { return EVAL_ORDER_EXPENSIVE; }
     scene_rdl2::math::Color eval(const EvalData& data) const override;
 
     /// HUD validation and type casting
@@ -7,6 +7,7 @@
 #include <moonray/rendering/pbr/sampler/Sampling_ispc_stubs.h>
 
 #include <algorithm>
+#include <cmath>
 
 namespace moonray {
 namespace pbr {
@@ -24,6 +25,14 @@ public:
         applyOffset(dataSize, data);
     }
 
+    // Distance in pixels from the center beyond which evaluate() is 0.
+    float getRadius() const { return 0.5f * mFootprint; }
+
+    // Unnormalized filter weight of a sample 'offset' pixels away from a pixel
+    // center, along one dimension. Used to splat samples over the footprint
+    // instead of importance sampling it.
+    virtual float evaluate(float offset) const = 0;
+
 protected:
     float getDesiredFootprint() const { return mFootprint; }
 
@@ -42,6 +51,11 @@ public:
     {
     }
 
+    float evaluate(float offset) const override
+    {
+        return std::abs(offset) <= getRadius() ? 1.0f : 0.0f;
+    }
+
 private:
     void applyFilter(utype /*dataSize*/, float* /*data*/) const override
     {
@@ -69,6 +83,18 @@ public:
     {
     }
 
+    float evaluate(float offset) const override
+    {
+        const float x = std::abs(offset) * 4.0f / getDesiredFootprint();
+        if (x < 1.0f) {
+            return (4.0f + x * x * (3.0f * x - 6.0f)) / 6.0f;
+        }
+        if (x < 2.0f) {
+            return (2.0f - x) * (2.0f - x) * (2.0f - x) / 6.0f;
+        }
+        return 0.0f;
+    }
+
 private:
     void applyFilter(utype dataSize, float* data) const override
     {
@@ -94,6 +120,18 @@ public:
     {
     }
 
+    float evaluate(float offset) const override
+    {
+        const float x = std::abs(offset) * 3.0f / getDesiredFootprint();
+        if (x < 0.5f) {
+            return 0.75f - x * x;
+        }
+        if (x < 1.5f) {
+            return 0.5f * (1.5f - x) * (1.5f - x);
+        }
+        return 0.0f;
+    }
+
 private:
     void applyFilter(utype dataSize, float* data) const override
     {
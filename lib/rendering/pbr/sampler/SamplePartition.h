@@ -13,6 +13,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <limits>
@@ -25,6 +26,10 @@ namespace pbr {
 
 namespace sp {
 using size_type = std::int32_t;
+
+// Tags the constructors which use the samples in place instead of copying
+// them. The samples must outlive the partition.
+struct ExternalStorage {};
 }
 
 namespace aux {
@@ -115,10 +120,30 @@ public:
     template <typename Iter>
     SpatialSamplePartition(Iter first, Iter last);
 
+    // Uses samples already in the built layout, as returned by data().
+    SpatialSamplePartition(const T* samples, size_type size, sp::ExternalStorage);
+
+    SpatialSamplePartition(SpatialSamplePartition&&) = default;
+    SpatialSamplePartition(const SpatialSamplePartition&) = delete;
+    SpatialSamplePartition& operator=(const SpatialSamplePartition&) = delete;
+
     const T& operator()(size_type pixelX, size_type pixelY, size_type n) const;
     void rotate(size_type n);
     size_type numPixelSamples() const;
 
+    // Calls f(i, (*this)(pixelX, pixelY, n + i)) for i in [0, count), looking
+    // up the pixel's stratum only once. n + count must not exceed
+    // numPixelSamples().
+    template <typename F>
+    void forEachSample(size_type pixelX, size_type pixelY, size_type n, size_type count, F f) const;
+
+    // The built samples, in stratum order, and their number.
+    const T* data() const { return mSamples; }
+    size_type size() const { return mSize; }
+
+    // Number of samples the partition holds once built from numPoints points.
+    static size_type buildSize(size_type numPoints);
+
     std::ostream& print(std::ostream& outs) const;
 
 private:
@@ -145,7 +170,9 @@ private:
     // Rotation amounts for torus rotation in u and v.
     size_type mURotation;
     size_type mVRotation;
-    Container mData;
+    Container mData;     // Empty when the samples are stored externally.
+    const T*  mSamples;  // mData.data() or the external samples.
+    size_type mSize;
 };
 
 ///
@@ -170,9 +197,21 @@ public:
     template <typename Iter>
     SamplePartition(Iter first, Iter last);
 
+    // Uses sets*samplesPerSet samples in place, they are stored in input order.
+    SamplePartition(const T* samples, size_type size, sp::ExternalStorage);
+
+    SamplePartition(SamplePartition&&) = default;
+    SamplePartition(const SamplePartition&) = delete;
+    SamplePartition& operator=(const SamplePartition&) = delete;
+
     T operator()(size_type pixelX, size_type pixelY, size_type n) const;
     void rotate(size_type n);
 
+    // Calls f(i, (*this)(pixelX, pixelY, n + i)) for i in [0, count), finding
+    // the set only once. n + count must not exceed samplesPerSet.
+    template <typename F>
+    void forEachSample(size_type pixelX, size_type pixelY, size_type n, size_type count, F f) const;
+
     std::ostream& print(std::ostream& outs) const;
 
 private:
@@ -198,7 +237,36 @@ private:
     // achieve more permutations.
     size_type mURotation;
     size_type mVRotation;
-    Container mData;
+    Container mData;     // Empty when the samples are stored externally.
+    const T*  mSamples;  // mData.data() or the external samples.
+};
+
+///
+/// @class SampleTable
+/// @brief Read only array of samples. Suitably aligned samples, like the
+/// tables linked into the library, are used in place so that they aren't
+/// copied and only get paged in where they are read. Others are copied.
+///
+template <typename T>
+class SampleTable
+{
+public:
+    using value_type = T;
+    using size_type  = std::size_t;
+
+    SampleTable(const T* first, const T* last);
+
+    SampleTable(const SampleTable&) = delete;
+    SampleTable& operator=(const SampleTable&) = delete;
+
+    const T& operator[](size_type i) const { return mSamples[i]; }
+    const T* data() const { return mSamples; }
+    size_type size() const { return mSize; }
+
+private:
+    std::vector<T> mData;     // Empty when the samples are used in place.
+    const T*       mSamples;
+    size_type      mSize;
 };
 
 //
@@ -261,7 +329,28 @@ finline const T& SpatialSamplePartition<T, kDimension>::operator()(size_type pix
 {
     pixelX = dimensionMod(pixelX + mURotation);
     pixelY = dimensionMod(pixelY + mVRotation);
-    return mData[getStratum(pixelX, pixelY) * numPixelSamples() + n];
+    return mSamples[getStratum(pixelX, pixelY) * numPixelSamples() + n];
+}
+
+template <typename T, sp::size_type kDimension>
+template <typename F>
+finline void SpatialSamplePartition<T, kDimension>::forEachSample(size_type pixelX, size_type pixelY,
+                                                                  size_type n, size_type count, F f) const
+{
+    MNRY_ASSERT(n + count <= numPixelSamples() || count == 0);
+    pixelX = dimensionMod(pixelX + mURotation);
+    pixelY = dimensionMod(pixelY + mVRotation);
+    const T* const samples = mSamples + getStratum(pixelX, pixelY) * numPixelSamples() + n;
+    for (size_type i = 0; i < count; ++i) {
+        f(i, samples[i]);
+    }
+}
+
+template <typename T, sp::size_type kDimension>
+finline sp::size_type SpatialSamplePartition<T, kDimension>::buildSize(size_type numPoints)
+{
+    const size_type numStrata = kDimension * kDimension;
+    return numStrata * scene_rdl2::util::roundUpToPowerOfTwo(numPoints / numStrata);
 }
 
 // Precondition: T is in [0, 1)
@@ -294,7 +383,7 @@ finline typename SpatialSamplePartition<T, kDimension>::Container SpatialSampleP
 {
     const size_type numPoints = std::distance(first, last);
     const size_type numStrata = kDimension * kDimension;
-    const size_type pointsPerStratum = scene_rdl2::util::roundUpToPowerOfTwo(numPoints / numStrata);
+    const size_type pointsPerStratum = buildSize(numPoints) / numStrata;
 
     std::vector<int> count(numStrata);
     Container data(numStrata * pointsPerStratum);
@@ -342,8 +431,21 @@ template <typename Iter>
 SpatialSamplePartition<T, kDimension>::SpatialSamplePartition(Iter first, Iter last) :
     mURotation(0),
     mVRotation(0),
-    mData(build(first, last, typename std::iterator_traits<Iter>::iterator_category()))
+    mData(build(first, last, typename std::iterator_traits<Iter>::iterator_category())),
+    mSamples(mData.data()),
+    mSize(mData.size())
+{
+}
+
+template <typename T, sp::size_type kDimension>
+SpatialSamplePartition<T, kDimension>::SpatialSamplePartition(const T* samples, size_type size, sp::ExternalStorage) :
+    mURotation(0),
+    mVRotation(0),
+    mData(),
+    mSamples(samples),
+    mSize(size)
 {
+    MNRY_ASSERT(size % (kDimension * kDimension) == 0);
 }
 
 template <typename T, sp::size_type kDimension>
@@ -376,7 +478,7 @@ void SpatialSamplePartition<T, kDimension>::rotate(size_type n)
 template <typename T, sp::size_type kDimension>
 sp::size_type SpatialSamplePartition<T, kDimension>::numPixelSamples() const
 {
-    return mData.size() / (kDimension * kDimension);
+    return mSize / (kDimension * kDimension);
 }
 
 template <typename T, sp::size_type kDimension>
@@ -491,18 +593,35 @@ finline T SamplePartition<T, sets, samplesPerSet>::operator()(size_type pixelX,
     pixelX = dimensionMod(pixelX + mURotation);
     pixelY = dimensionMod(pixelY + mVRotation);
 
-    T t = mData[getStratum(pixelX, pixelY) * samplesPerSet + n];
+    T t = mSamples[getStratum(pixelX, pixelY) * samplesPerSet + n];
     rotateMirror(t, mURotation);
 
     return t;
 }
 
+template <typename T, sp::size_type sets, sp::size_type samplesPerSet>
+template <typename F>
+finline void SamplePartition<T, sets, samplesPerSet>::forEachSample(size_type pixelX, size_type pixelY,
+                                                                    size_type n, size_type count, F f) const
+{
+    MNRY_ASSERT(n + count <= samplesPerSet || count == 0);
+    pixelX = dimensionMod(pixelX + mURotation);
+    pixelY = dimensionMod(pixelY + mVRotation);
+    const T* const samples = mSamples + getStratum(pixelX, pixelY) * samplesPerSet + n;
+    for (size_type i = 0; i < count; ++i) {
+        T t = samples[i];
+        rotateMirror(t, mURotation);
+        f(i, t);
+    }
+}
+
 template <typename T, sp::size_type sets, sp::size_type samplesPerSet>
 template <typename Iter>
 SamplePartition<T, sets, samplesPerSet>::SamplePartition(Iter first, Iter last) :
     mURotation(0),
     mVRotation(0),
-    mData(sets * samplesPerSet)
+    mData(sets * samplesPerSet),
+    mSamples(mData.data())
 {
     MNRY_ASSERT(sets * samplesPerSet == std::distance(first, last));
     for (size_type i = 0; i < sets; ++i) {
@@ -513,6 +632,16 @@ SamplePartition<T, sets, samplesPerSet>::SamplePartition(Iter first, Iter last)
     }
 }
 
+template <typename T, sp::size_type sets, sp::size_type samplesPerSet>
+SamplePartition<T, sets, samplesPerSet>::SamplePartition(const T* samples, size_type size, sp::ExternalStorage) :
+    mURotation(0),
+    mVRotation(0),
+    mData(),
+    mSamples(samples)
+{
+    MNRY_ASSERT(size == sets * samplesPerSet);
+}
+
 template <typename T, sp::size_type sets, sp::size_type samplesPerSet>
 void SamplePartition<T, sets, samplesPerSet>::rotate(size_type n)
 {
@@ -554,6 +683,23 @@ std::ostream& operator<<(std::ostream& outs, SamplePartition<T, sets, samplesPer
 //////////////////////////////////////////////////////////////////////////////
 //
 
+template <typename T>
+SampleTable<T>::SampleTable(const T* first, const T* last) :
+    mSamples(first),
+    mSize(last - first)
+{
+    if (reinterpret_cast<std::uintptr_t>(first) % alignof(T) != 0) {
+        mData.resize(mSize);
+        std::memcpy(mData.data(), first, mSize * sizeof(T));
+        mSamples = mData.data();
+    }
+}
+
+//
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//
+
 namespace aux {
 template <typename Container>
 std::ostream& print(std::ostream& outs,
@@ -0,0 +1,162 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "SampleTableImage.h"
+
+#include <scene_rdl2/render/util/GetEnv.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moonray {
+namespace pbr {
+
+namespace {
+
+// Bump when the layout of any preprocessed table changes.
+constexpr std::uint32_t sImageVersion = 1;
+constexpr char sImageMagic[8] = { 'M', 'N', 'R', 'Y', 'S', 'M', 'P', 'L' };
+
+// The header takes a whole page so the payload is page aligned.
+constexpr std::size_t sHeaderSize = 4096;
+
+struct ImageHeader
+{
+    char          mMagic[8];
+    std::uint32_t mVersion;
+    std::uint32_t mPad;
+    std::uint64_t mKey;
+    std::uint64_t mPayloadSize;
+};
+
+std::string
+imagePath(const char *name)
+{
+    const std::string dir = scene_rdl2::util::getenv<std::string>("MOONRAY_SAMPLE_TABLE_CACHE");
+    if (dir.empty()) {
+        return std::string();
+    }
+    return dir + "/" + name + ".v" + std::to_string(sImageVersion) + ".smpl";
+}
+
+std::uint64_t
+fnv1a(std::uint64_t hash, const void *data, std::size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool
+writeAll(int fd, const void *data, std::size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        const ssize_t written = ::write(fd, bytes, size);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+} // namespace
+
+std::uint64_t
+sampleTableImageKey(const void *source, std::size_t sourceSize)
+{
+    // The size and both ends of the source are enough to tell the tables
+    // linked into different builds apart, without paging in all of it.
+    constexpr std::size_t sEdgeSize = 4096;
+    const std::size_t edge = std::min(sEdgeSize, sourceSize);
+    const unsigned char *bytes = static_cast<const unsigned char *>(source);
+
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, &sourceSize, sizeof(sourceSize));
+    hash = fnv1a(hash, bytes, edge);
+    hash = fnv1a(hash, bytes + sourceSize - edge, edge);
+    return hash;
+}
+
+const void *
+mapSampleTableImage(const char *name, std::uint64_t key, std::size_t payloadSize)
+{
+    const std::string path = imagePath(name);
+    if (path.empty()) {
+        return nullptr;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    const void *payload = nullptr;
+    struct stat st;
+    ImageHeader header;
+    if (::fstat(fd, &st) == 0 &&
+        static_cast<std::size_t>(st.st_size) == sHeaderSize + payloadSize &&
+        ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+        std::memcmp(header.mMagic, sImageMagic, sizeof(sImageMagic)) == 0 &&
+        header.mVersion == sImageVersion &&
+        header.mKey == key &&
+        header.mPayloadSize == payloadSize) {
+
+        void *addr = ::mmap(nullptr, sHeaderSize + payloadSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            payload = static_cast<const char *>(addr) + sHeaderSize;
+        }
+    }
+
+    ::close(fd); // the mapping keeps the file alive
+    return payload;
+}
+
+bool
+saveSampleTableImage(const char *name, std::uint64_t key, const void *payload, std::size_t payloadSize)
+{
+    const std::string path = imagePath(name);
+    if (path.empty()) {
+        return false;
+    }
+
+    const std::string tmpPath = path + ".tmp." + std::to_string(::getpid());
+    const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    char headerPage[sHeaderSize] = {};
+    ImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.mMagic, sImageMagic, sizeof(sImageMagic));
+    header.mVersion = sImageVersion;
+    header.mKey = key;
+    header.mPayloadSize = payloadSize;
+    std::memcpy(headerPage, &header, sizeof(header));
+
+    bool ok = writeAll(fd, headerPage, sHeaderSize) && writeAll(fd, payload, payloadSize);
+    ok = (::close(fd) == 0) && ok;
+    ok = ok && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        ::unlink(tmpPath.c_str());
+    }
+    return ok;
+}
+
+} // namespace pbr
+} // namespace moonray
+
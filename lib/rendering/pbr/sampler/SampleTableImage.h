@@ -0,0 +1,37 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace moonray {
+namespace pbr {
+
+//
+// Sample tables which are expensive to preprocess, e.g. the pixel partition,
+// can be saved as page aligned image files so that later processes map the
+// result instead of rebuilding it. Mapped images are shared through the page
+// cache and only paged in where samples are read. The images live in the
+// directory named by MOONRAY_SAMPLE_TABLE_CACHE; nothing is read or written if
+// it isn't set.
+//
+
+// Identifies the source data an image was built from, without reading all of it.
+std::uint64_t sampleTableImageKey(const void *source, std::size_t sourceSize);
+
+// Returns the payload of the image called name if it exists and was built from
+// the source identified by key, nullptr otherwise. The payload is page aligned,
+// read only and stays mapped for the life of the process.
+const void *mapSampleTableImage(const char *name, std::uint64_t key, std::size_t payloadSize);
+
+// Writes the image called name for later processes. The file is replaced
+// atomically, so concurrent processes never see a partial image. Returns
+// false on failure, which leaves the cache as it was.
+bool saveSampleTableImage(const char *name, std::uint64_t key, const void *payload, std::size_t payloadSize);
+
+} // namespace pbr
+} // namespace moonray
+
@@ -3,7 +3,9 @@
 
 #include "Sample.h"
 #include "Sampler.h"
+#include "SampleTableImage.h"
 
+#include <cstdint>
 #include <fstream>
 #include <iterator>
 
@@ -30,6 +32,37 @@ finline Container containerFromFile(const std::string& filename)
     return Container(std::istream_iterator<value_type>(ins), std::istream_iterator<value_type>());
 }
 
+// Partitions which keep their samples in input order use the linked-in
+// samples in place when they are aligned, instead of copying all of them at
+// startup.
+template <typename Partition, typename T>
+Partition makeInPlacePartition(const T* first, const T* last)
+{
+    if (reinterpret_cast<std::uintptr_t>(first) % alignof(T) == 0) {
+        return Partition(first, static_cast<sp::size_type>(last - first), sp::ExternalStorage());
+    }
+    return Partition(first, last);
+}
+
+// Partitions which reorder their samples are built once and then mapped from
+// a table image by later processes, see SampleTableImage.h.
+template <typename Partition, typename T>
+Partition makePreprocessedPartition(const char* imageName, const T* first, const T* last)
+{
+    const sp::size_type size = Partition::buildSize(static_cast<sp::size_type>(last - first));
+    const std::size_t payloadSize = size * sizeof(T);
+    const std::uint64_t key = sampleTableImageKey(first, (last - first) * sizeof(T));
+
+    if (const void* image = mapSampleTableImage(imageName, key, payloadSize)) {
+        return Partition(static_cast<const T*>(image), size, sp::ExternalStorage());
+    }
+
+    Partition partition(first, last);
+    MNRY_ASSERT(partition.size() == size);
+    saveSampleTableImage(imageName, key, partition.data(), payloadSize);
+    return partition;
+}
+
 } // namespace
 
 #if defined(USE_POISSON_PIXEL)
@@ -60,7 +93,8 @@ finline Container containerFromFile(const std::string& filename)
 extern "C" moonray::pbr::Sample2D SAMPLES_PMJ02_BEST_CANDIDATE_4096_BIN_START;
 extern "C" moonray::pbr::Sample2D SAMPLES_PMJ02_BEST_CANDIDATE_4096_BIN_END;
 
-PixelPartition kPixelPartition(
+PixelPartition kPixelPartition = makePreprocessedPartition<PixelPartition>(
+    "pmj02_pixel_partition",
     &SAMPLES_PMJ02_BEST_CANDIDATE_4096_BIN_START,
     &SAMPLES_PMJ02_BEST_CANDIDATE_4096_BIN_END
 );
@@ -125,7 +159,7 @@ PixelPartition kPixelPartition(
 extern "C" moonray::pbr::Sample2D SAMPLES_PPD_LENS_BIN_START;
 extern "C" moonray::pbr::Sample2D SAMPLES_PPD_LENS_BIN_END;
 
-LensPartition kLensPartition(
+LensPartition kLensPartition = makeInPlacePartition<LensPartition>(
     &SAMPLES_PPD_LENS_BIN_START,
     &SAMPLES_PPD_LENS_BIN_END
 );
@@ -135,7 +169,7 @@ LensPartition kLensPartition(
 extern "C" float SAMPLES_BC_TIME_BIN_START;
 extern "C" float SAMPLES_BC_TIME_BIN_END;
 
-TimePartition kTimePartition(
+TimePartition kTimePartition = makeInPlacePartition<TimePartition>(
    &SAMPLES_BC_TIME_BIN_START,
    &SAMPLES_BC_TIME_BIN_END
 );
@@ -146,7 +180,7 @@ TimePartition kTimePartition(
 extern "C" float SAMPLES_BC_1D_INTEGRATOR_BIN_START;
 extern "C" float SAMPLES_BC_1D_INTEGRATOR_BIN_END;
 
-const std::vector<float> k1DSampleTable(
+const SampleTable<float> k1DSampleTable(
     &SAMPLES_BC_1D_INTEGRATOR_BIN_START,
     &SAMPLES_BC_1D_INTEGRATOR_BIN_END
 );
@@ -167,7 +201,7 @@ const std::vector<float> k1DSampleTable(
 extern "C" moonray::pbr::Sample2D SAMPLES_PPD_2D_INTEGRATOR_BIN_START;
 extern "C" moonray::pbr::Sample2D SAMPLES_PPD_2D_INTEGRATOR_BIN_END;
 
-extern const std::vector<Sample2D> k2DSampleTable(
+extern const SampleTable<Sample2D> k2DSampleTable(
     &SAMPLES_PPD_2D_INTEGRATOR_BIN_START,
     &SAMPLES_PPD_2D_INTEGRATOR_BIN_END
 );
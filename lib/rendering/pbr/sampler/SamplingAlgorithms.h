@@ -13,6 +13,7 @@
 #include <scene_rdl2/common/math/Math.h>
 #include <moonray/common/mcrt_util/StatelessRandomEngine.h>
 
+#include <algorithm>
 #include <vector>
 
 // USE_PURE_RANDOM is useful for testing random values without any hashing. This
@@ -70,11 +71,11 @@ extern TimePartition kTimePartition;
 #endif
 
 #if defined(USE_PARTITIONED_1D)
-extern const std::vector<float>    k1DSampleTable;
+extern const SampleTable<float>    k1DSampleTable;
 #endif
 
 #if defined(USE_PARTITIONED_2D)
-extern const std::vector<Sample2D> k2DSampleTable;
+extern const SampleTable<Sample2D> k2DSampleTable;
 #endif
 
 namespace detail {
@@ -117,6 +118,13 @@ inline RandomEngine& getRandomEngine()
 }
 #endif
 
+// Number of samples of the window [n, n + kSIMDSize) which come from a table
+// holding tableSize samples, the remaining ones are generated on the fly.
+finline utype numTableSamples(utype n, utype tableSize)
+{
+    return (n >= tableSize) ? 0u : std::min(kSIMDSize, tableSize - n);
+}
+
 } // namespace detail
 
 // We want to make sure we're using an odd integer when we're multiplying
@@ -247,17 +255,17 @@ finline void randomPixel(utype pixelWideScramble, int /*x*/, int /*y*/, int /*t*
 finline void partitionedPixelLens(utype pixelWideScramble, int x, int y, int /*t*/, utype n, float* valsx, float* valsy)
 {
     static const utype maxSamples = kPixelPartition.numPixelSamples();
-    for (utype i = 0; i < kSIMDSize; ++i) {
-        const utype sampleNum = n + i;
-        if (unlikely(sampleNum >= maxSamples)) {
-            moonray::util::StatelessRandomEngine reng(pixelWideScramble);
-            const auto result = reng.asFloat(sampleNum);
+    const utype numFromTable = detail::numTableSamples(n, maxSamples);
+    kPixelPartition.forEachSample(x, y, n, numFromTable, [=](utype i, const PixelPartition::value_type& sample) {
+        valsx[i] = getPrimaryValue0(sample);
+        valsy[i] = getPrimaryValue1(sample);
+    });
+    if (unlikely(numFromTable < kSIMDSize)) {
+        moonray::util::StatelessRandomEngine reng(pixelWideScramble);
+        for (utype i = numFromTable; i < kSIMDSize; ++i) {
+            const auto result = reng.asFloat(n + i);
             valsx[i] = result[0];
             valsy[i] = result[1];
-        } else {
-            const auto sample = kPixelPartition(x, y, n + i);
-            valsx[i] = getPrimaryValue0(sample);
-            valsy[i] = getPrimaryValue1(sample);
         }
     }
 }
@@ -278,14 +286,14 @@ finline void rotate2D(float& u, float& v, float theta)
 #if defined(USE_PARTITIONED_LENS)
 finline void partitionedLens(utype pixelWideScramble, int x, int y, int /*t*/, utype n, float* valsu, float* valsv)
 {
-    for (utype i = 0; i < kSIMDSize; ++i) {
-        const utype offsetIndex = n + i;
-        if (offsetIndex < LensPartition::kSamplesPerSet) {
-            auto sample = kLensPartition(x, y, n + i);
-            valsu[i] = sample.u;
-            valsv[i] = sample.v;
-        } else {
-            moonray::util::StatelessRandomEngine reng(pixelWideScramble * oddCheck(0x564e246d));
+    const utype numFromTable = detail::numTableSamples(n, LensPartition::kSamplesPerSet);
+    kLensPartition.forEachSample(x, y, n, numFromTable, [=](utype i, const Sample2D& sample) {
+        valsu[i] = sample.u;
+        valsv[i] = sample.v;
+    });
+    if (unlikely(numFromTable < kSIMDSize)) {
+        moonray::util::StatelessRandomEngine reng(pixelWideScramble * oddCheck(0x564e246d));
+        for (utype i = numFromTable; i < kSIMDSize; ++i) {
             const auto result = reng.asFloat(n + i);
             valsu[i] = result[0];
             valsv[i] = result[1];
@@ -305,12 +313,13 @@ finline void partitionedLens(utype pixelWideScramble, int x, int y, int /*t*/, u
 #if defined(USE_PARTITIONED_TIME)
 finline void partitionedTime(utype pixelWideScramble, int x, int y, int /*t*/, utype n, float* valst)
 {
-    for (utype i = 0; i < kSIMDSize; ++i) {
-        const utype offsetIndex = n + i;
-        if (offsetIndex < TimePartition::kSamplesPerSet) {
-            valst[i] = kTimePartition(x, y, n + i);
-        } else {
-            moonray::util::StatelessRandomEngine reng(pixelWideScramble * oddCheck(0x564e246d));
+    const utype numFromTable = detail::numTableSamples(n, TimePartition::kSamplesPerSet);
+    kTimePartition.forEachSample(x, y, n, numFromTable, [=](utype i, float sample) {
+        valst[i] = sample;
+    });
+    if (unlikely(numFromTable < kSIMDSize)) {
+        moonray::util::StatelessRandomEngine reng(pixelWideScramble * oddCheck(0x564e246d));
+        for (utype i = numFromTable; i < kSIMDSize; ++i) {
             const auto result = reng.asFloat(n + i);
             valst[i] = result[0];
         }
@@ -352,17 +361,20 @@ finline void randomLens(utype pixelWideScramble, int /*x*/, int /*y*/, int /*t*/
 inline void partitionedPixel(utype pixelWideScramble, int x, int y, int /*t*/, utype n, float* valsu, float* valsv)
 {
     static const utype maxSamples = kPixelPartition.numPixelSamples();
-    for (utype i = 0; i < kSIMDSize; ++i) {
-        const utype sampleNum = n + i;
-        if (unlikely(sampleNum >= maxSamples)) {
-            moonray::util::StatelessRandomEngine reng(pixelWideScramble);
-            const auto result = reng.asFloat(sampleNum);
+
+    // The pixel's stratum is looked up once for the part of the window the
+    // table covers, anything beyond the table is generated on the fly.
+    const utype numFromTable = detail::numTableSamples(n, maxSamples);
+    kPixelPartition.forEachSample(x, y, n, numFromTable, [=](utype i, const PixelPartition::value_type& sample) {
+        valsu[i] = getPrimaryValue0(sample);
+        valsv[i] = getPrimaryValue1(sample);
+    });
+    if (unlikely(numFromTable < kSIMDSize)) {
+        moonray::util::StatelessRandomEngine reng(pixelWideScramble);
+        for (utype i = numFromTable; i < kSIMDSize; ++i) {
+            const auto result = reng.asFloat(n + i);
             valsu[i] = result[0];
             valsv[i] = result[1];
-        } else {
-            const auto sample = kPixelPartition(x, y, sampleNum);
-            valsu[i] = getPrimaryValue0(sample);
-            valsv[i] = getPrimaryValue1(sample);
         }
     }
 }
@@ -388,15 +400,15 @@ finline void randomTime(utype pixelWideScramble, int /*x*/, int /*y*/, int /*t*/
 finline void partitionedPixelTime(utype pixelWideScramble, int x, int y, int /*t*/, utype n, float* valst)
 {
     static const utype maxSamples = kPixelPartition.numPixelSamples();
-    for (utype i = 0; i < kSIMDSize; ++i) {
-        const utype sampleNum = n + i;
-        if (unlikely(sampleNum >= maxSamples)) {
-            moonray::util::StatelessRandomEngine reng(pixelWideScramble);
-            const auto result = reng.asFloat(sampleNum);
+    const utype numFromTable = detail::numTableSamples(n, maxSamples);
+    kPixelPartition.forEachSample(x, y, n, numFromTable, [=](utype i, const PixelPartition::value_type& sample) {
+        valst[i] = sample.time;
+    });
+    if (unlikely(numFromTable < kSIMDSize)) {
+        moonray::util::StatelessRandomEngine reng(pixelWideScramble);
+        for (utype i = numFromTable; i < kSIMDSize; ++i) {
+            const auto result = reng.asFloat(n + i);
             valst[i] = result[0];
-        } else {
-            const auto sample = kPixelPartition(x, y, n + i);
-            valst[i] = sample.time;
         }
     }
 }
@@ -12,7 +12,10 @@
 #include <scene_rdl2/scene/rdl2/rdl2.h>
 
 #include <exception>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace scene_rdl2 {
@@ -37,7 +40,6 @@ setOverrideHelper(
     scene_rdl2::rdl2::AttributeKey<T> key =
         object->getSceneClass().getAttributeKey<T>(attrOverride.mAttribute);
 
-    scene_rdl2::rdl2::SceneObject::UpdateGuard guard(object);
     if (!attrOverride.mValue.empty()) {
         object->set(key, scene_rdl2::rdl2::convertFromString<T>(attrOverride.mValue));
     }
@@ -56,7 +58,6 @@ setOverrideHelper<scene_rdl2::rdl2::SceneObject*>(
     scene_rdl2::rdl2::AttributeKey<scene_rdl2::rdl2::SceneObject*> key =
         object->getSceneClass().getAttributeKey<scene_rdl2::rdl2::SceneObject*>(attrOverride.mAttribute);
 
-    scene_rdl2::rdl2::SceneObject::UpdateGuard guard(object);
     if (!attrOverride.mValue.empty()) {
         object->set(key, context.getSceneObject(attrOverride.mValue));
     }
@@ -82,7 +83,6 @@ setOverrideHelper<scene_rdl2::rdl2::SceneObjectVector>(
         objPointers.push_back(context.getSceneObject(*iter));
     }
 
-    scene_rdl2::rdl2::SceneObject::UpdateGuard guard(object);
     if (!attrOverride.mValue.empty()) {
         object->set(key, objPointers);
     }
@@ -91,12 +91,13 @@ setOverrideHelper<scene_rdl2::rdl2::SceneObjectVector>(
     }
 }
 
+// Sets one override on its object, which must be between beginUpdate() and
+// endUpdate().
 void
 setOverride(scene_rdl2::rdl2::SceneContext& context,
+            scene_rdl2::rdl2::SceneObject* object,
             const RenderOptions::AttributeOverride& attrOverride)
 {
-    scene_rdl2::rdl2::SceneObject* object = context.getSceneObject(attrOverride.mObject);
-
     switch (object->getSceneClass().getAttribute(attrOverride.mAttribute)->getType()) {
     case scene_rdl2::rdl2::TYPE_BOOL:
         return setOverrideHelper<scene_rdl2::rdl2::Bool>(context, object, attrOverride);
@@ -193,33 +194,127 @@ setOverride(scene_rdl2::rdl2::SceneContext& context,
     }
 }
 
+void
+addToScope(AttributeOverrideScope& scope, const scene_rdl2::rdl2::SceneObject* object)
+{
+    ++scope.mObjects;
+    if (object->isA<scene_rdl2::rdl2::SceneVariables>()) {
+        scope.mSceneVariables = true;
+    } else if (object->isA<scene_rdl2::rdl2::Camera>()) {
+        ++scope.mCameras;
+    } else if (object->isA<scene_rdl2::rdl2::Geometry>()) {
+        ++scope.mGeometries;
+    } else if (object->isA<scene_rdl2::rdl2::Light>() || object->isA<scene_rdl2::rdl2::LightFilter>()) {
+        ++scope.mLights;
+    } else if (object->isA<scene_rdl2::rdl2::Shader>()) {
+        ++scope.mShaders;
+    } else {
+        ++scope.mOthers;
+    }
+}
+
 } // namespace
 
-void
+AttributeOverrideScope
 applyAttributeOverrides(scene_rdl2::rdl2::SceneContext& context,
-                        const RenderStats& renderStats,
-                        const RenderOptions& options,
-                        std::stringstream& initMessages)
+                        const std::vector<RenderOptions::AttributeOverride>& overrides,
+                        std::stringstream& messages)
 {
-    std::vector<RenderOptions::AttributeOverride> overrides =
-        options.getAttributeOverrides();
-    std::string prepend = renderStats.getPrependString();
-    
-    for (auto iter = overrides.begin(); iter != overrides.end(); ++iter) {
+    AttributeOverrideScope scope;
+
+    // Group the overrides by object, in the order the objects are first
+    // overridden. The overrides of an object keep their order, so the last
+    // one of an attribute wins.
+    std::vector<std::pair<scene_rdl2::rdl2::SceneObject*, std::vector<const RenderOptions::AttributeOverride*>>>
+        objectOverrides;
+    std::unordered_map<const scene_rdl2::rdl2::SceneObject*, size_t> objectIndices;
+    for (const RenderOptions::AttributeOverride& attrOverride : overrides) {
         try {
-            setOverride(context, *iter);
-            if (!iter->mValue.empty()) {
-                initMessages << "Overriding '" << iter->mAttribute <<
-                             "' value with '" << iter->mValue << "'." << '\n';
-            }
-            if (!iter->mBinding.empty()) {
-                initMessages << "Overriding '" << iter->mAttribute <<
-                             "' binding with '" << iter->mBinding << "'." << '\n';
+            scene_rdl2::rdl2::SceneObject* object = context.getSceneObject(attrOverride.mObject);
+            const auto it = objectIndices.emplace(object, objectOverrides.size()).first;
+            if (it->second == objectOverrides.size()) {
+                objectOverrides.emplace_back(object, std::vector<const RenderOptions::AttributeOverride*>());
             }
+            objectOverrides[it->second].second.push_back(&attrOverride);
         } catch (std::exception& e) {
             scene_rdl2::logging::Logger::warn("Skipping override: " , e.what());
+            ++scope.mSkipped;
         }
     }
+
+    // Each object is updated once with all of its overrides, so it is only
+    // dirtied once however many of its attributes change.
+    for (const auto& entry : objectOverrides) {
+        scene_rdl2::rdl2::SceneObject* object = entry.first;
+        size_t applied = 0;
+        {
+            scene_rdl2::rdl2::SceneObject::UpdateGuard guard(object);
+            for (const RenderOptions::AttributeOverride* attrOverride : entry.second) {
+                try {
+                    setOverride(context, object, *attrOverride);
+                    ++applied;
+                    if (!attrOverride->mValue.empty()) {
+                        messages << "Overriding '" << attrOverride->mAttribute <<
+                                 "' value with '" << attrOverride->mValue << "'." << '\n';
+                    }
+                    if (!attrOverride->mBinding.empty()) {
+                        messages << "Overriding '" << attrOverride->mAttribute <<
+                                 "' binding with '" << attrOverride->mBinding << "'." << '\n';
+                    }
+                } catch (std::exception& e) {
+                    scene_rdl2::logging::Logger::warn("Skipping override: " , e.what());
+                    ++scope.mSkipped;
+                }
+            }
+        }
+        if (applied) {
+            scope.mApplied += applied;
+            addToScope(scope, object);
+        }
+    }
+
+    return scope;
+}
+
+void
+applyAttributeOverrides(scene_rdl2::rdl2::SceneContext& context,
+                        const RenderStats& renderStats,
+                        const RenderOptions& options,
+                        std::stringstream& initMessages)
+{
+    const std::vector<RenderOptions::AttributeOverride> overrides = options.getAttributeOverrides();
+    if (overrides.empty()) {
+        return;
+    }
+
+    const AttributeOverrideScope scope = applyAttributeOverrides(context, overrides, initMessages);
+    initMessages << renderStats.getPrependString() << "Applied " << scope.mApplied << " overrides to " <<
+                 scope.mObjects << " objects, " << scope.describe() << '\n';
+}
+
+std::string
+AttributeOverrideScope::describe() const
+{
+    // What the next render prep redoes, see RenderContext::renderPrep().
+    std::ostringstream os;
+    os << "re-prep scope:";
+    if (mSceneVariables || mCameras) {
+        os << " frame settings (may reload all the geometry),";
+    }
+    if (mGeometries) {
+        os << " reload " << mGeometries << " geometries,";
+    }
+    if (mLights) {
+        os << " update " << mLights << " lights,";
+    }
+    if (mShaders || mOthers) {
+        os << " update " << mShaders + mOthers << " shaders and other objects,";
+    }
+    if (!mObjects) {
+        os << " none,";
+    }
+    os << " " << mSkipped << " overrides skipped";
+    return os.str();
 }
 
 } // namespace rndr
@@ -9,6 +9,8 @@
 
 #include <scene_rdl2/scene/rdl2/rdl2.h>
 
+#include <cstddef>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -17,6 +19,40 @@ namespace rndr {
 
 class RenderStats;
 
+/**
+ * What a set of attribute overrides touched, i.e. which parts of the next
+ * render prep they trigger.
+ */
+struct AttributeOverrideScope
+{
+    std::string describe() const;
+
+    size_t mApplied = 0;            // overrides applied
+    size_t mSkipped = 0;            // overrides which failed
+    size_t mObjects = 0;            // objects overridden
+    size_t mGeometries = 0;
+    size_t mLights = 0;             // lights and light filters
+    size_t mShaders = 0;
+    size_t mCameras = 0;
+    size_t mOthers = 0;
+    bool mSceneVariables = false;
+};
+
+/**
+ * Applies the given attribute value and attribute binding overrides to the
+ * SceneContext. The overrides are grouped by object, so each object is updated
+ * once, whatever the number of its overridden attributes. Overrides which
+ * fail are skipped with a warning.
+ *
+ * @param   context     The SceneContext to apply overrides on.
+ * @param   overrides   The overrides, the last one of an attribute wins.
+ * @param   messages    Receives a line per applied override.
+ * @return  The objects the overrides touched.
+ */
+AttributeOverrideScope applyAttributeOverrides(scene_rdl2::rdl2::SceneContext& context,
+                                               const std::vector<RenderOptions::AttributeOverride>& overrides,
+                                               std::stringstream& messages);
+
 /**
  * Applies all of the attribute value and attribute binding overrides present
  * in the RenderOptions to the given SceneContext.
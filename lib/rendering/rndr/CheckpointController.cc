@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "CheckpointController.h"
+#include "Film.h"
 #include "ImageWriteDriver.h"
 #include "RenderContext.h"
+#include "RenderDriver.h"
 #include "RenderOutputDriver.h"
 
 #include <scene_rdl2/render/util/StrUtil.h>
@@ -295,6 +297,7 @@ CheckpointController::reset()
     mMaxDeltaSamples = 1;
 
     mRayCostEstimator.reset();
+    mDelta.reset();
 
     mLastSnapshotIntervalSec = 0.0f;
     mSnapshotIntervalTime.start(); // for debug
@@ -386,12 +389,14 @@ CheckpointController::snapshotOnly(RenderContext *renderContext,
 {
     scene_rdl2::rec_time::RecTime time;
     time.start();
-    fileOutputMain(true, // checkpointBgWrite
-                   true, // twoStageOutput
-                   true, // snapshotOnly
-                   renderContext,
-                   checkpointPostScript,
-                   endSampleId);
+    if (!emergencyCheckpointSnapshot(endSampleId)) {
+        fileOutputMain(true, // checkpointBgWrite
+                       true, // twoStageOutput
+                       true, // snapshotOnly
+                       renderContext,
+                       checkpointPostScript,
+                       endSampleId);
+    }
     float snapshotActionSec = time.end();
     mSnapshotEstimator.pushSnapshotCost(snapshotActionSec);
 
@@ -414,6 +419,7 @@ CheckpointController::snapshotOnly(RenderContext *renderContext,
 void
 CheckpointController::output(bool checkpointBgWrite,
                              bool twoStageOutput,
+                             unsigned checkpointDeltaMax,
                              RenderContext *renderContext,
                              const std::string &checkpointPostScript,
                              const unsigned endSampleId)
@@ -421,12 +427,24 @@ CheckpointController::output(bool checkpointBgWrite,
 // This is a standard image output action that includes both checkpoint and non-checkpoint situations. 
 //
 {
+    if (checkpointDeltaMax > 0 &&
+        mDelta.hasBase() &&
+        mDelta.getDeltaTotal() < checkpointDeltaMax &&
+        deltaOutput(renderContext, endSampleId)) {
+        resetRemainingIntervalSec();
+        return; // only delta checkpoint file is written
+    }
+
     fileOutputMain(checkpointBgWrite,
                    twoStageOutput,
                    false, // snapshotOnly
                    renderContext,
                    checkpointPostScript,
                    endSampleId);
+    tileHashOutput(renderContext, endSampleId);
+    if (checkpointDeltaMax > 0 || mEmergencyCheckpoint) {
+        startDeltaBase(renderContext, endSampleId);
+    }
 
     resetRemainingIntervalSec();
 
@@ -438,6 +456,25 @@ CheckpointController::output(bool checkpointBgWrite,
 
 //------------------------------------------------------------------------------------------
 
+void
+CheckpointController::compactDelta(bool checkpointBgWrite,
+                                   bool twoStageOutput,
+                                   RenderContext *renderContext,
+                                   const std::string &checkpointPostScript,
+                                   const unsigned endSampleId)
+{
+    if (mDelta.getDeltaTotal() == 0) return; // last checkpoint output was full
+
+    fileOutputMain(checkpointBgWrite,
+                   twoStageOutput,
+                   false, // snapshotOnly
+                   renderContext,
+                   checkpointPostScript,
+                   endSampleId);
+    tileHashOutput(renderContext, endSampleId);
+    startDeltaBase(renderContext, endSampleId);
+}
+
 void
 CheckpointController::resetRemainingIntervalSec()
 {
@@ -535,16 +572,18 @@ CheckpointController::fileOutputMain(bool checkpointBgWrite,
     // We can generate deep buffer checkpoint file data but not support deep buffer resume render yet.
     const pbr::DeepBuffer *deepBuffer = renderContext->getDeepBuffer();
     pbr::CryptomatteBuffer *cryptomatteBuffer = renderContext->getCryptomatteBuffer();
+    // Buffers are kept in the Film's tiled layout and the writer reads them through the tiler,
+    // which skips the untile pass of every buffer.
     scene_rdl2::fb_util::HeatMapBuffer heatMapBuffer;
-    renderContext->snapshotHeatMapBuffer(&heatMapBuffer, true, true); // only do if it has data
+    renderContext->snapshotHeatMapBuffer(&heatMapBuffer, false, true); // only do if it has data
     scene_rdl2::fb_util::FloatBuffer weightBuffer;
-    renderContext->snapshotWeightBuffer(&weightBuffer, true, true); // only do if it has data
+    renderContext->snapshotWeightBuffer(&weightBuffer, false, true); // only do if it has data
     scene_rdl2::fb_util::RenderBuffer renderBufferOdd;
-    renderContext->snapshotRenderBufferOdd(&renderBufferOdd, true, true); // only do if it has data
+    renderContext->snapshotRenderBufferOdd(&renderBufferOdd, false, true); // only do if it has data
     std::vector<scene_rdl2::fb_util::VariablePixelBuffer> aovBuffers;
-    renderContext->snapshotAovBuffers(aovBuffers, true, true);
+    renderContext->snapshotAovBuffers(aovBuffers, false, true);
     std::vector<scene_rdl2::fb_util::VariablePixelBuffer> displayFilterBuffers;
-    renderContext->snapshotDisplayFilterBuffers(displayFilterBuffers, true, true);
+    renderContext->snapshotDisplayFilterBuffers(displayFilterBuffers, false, true);
 
     if (!snapshotOnly && checkpointBgWrite) {
         // Non memorySnapshot only situation : conditional wait until we have enough bg cache memory capacity
@@ -582,6 +621,7 @@ CheckpointController::fileOutputMain(bool checkpointBgWrite,
                                            &renderBufferOdd,
                                            aovBuffers,
                                            displayFilterBuffers,
+                                           true, // tiled
                                            endSampleId,
                                            cache.get());
     renderOutputDriver->loggingErrorAndInfo(cache.get());
@@ -611,6 +651,7 @@ CheckpointController::fileOutputMain(bool checkpointBgWrite,
                                                    &renderBufferOdd,
                                                    aovBuffers,
                                                    displayFilterBuffers,
+                                                   true, // tiled
                                                    endSampleId,
                                                    nullptr);
             renderOutputDriver->loggingErrorAndInfo(nullptr);
@@ -634,5 +675,87 @@ CheckpointController::fileOutputMain(bool checkpointBgWrite,
     }
 }
 
+bool
+CheckpointController::deltaOutput(RenderContext *renderContext, const unsigned endSampleId)
+//
+// Returns false when the delta checkpoint file could not be written and a full checkpoint output
+// is required instead.
+//
+{
+    scene_rdl2::rec_time::RecTime time;
+    time.start();
+    std::string errMsg;
+    if (!mDelta.writeDelta(getRenderDriver()->getFilm(), endSampleId, errMsg)) {
+        scene_rdl2::logging::Logger::warn("Delta checkpoint output failed (" + errMsg +
+                                          "). Fall back on full checkpoint output");
+        return false;
+    }
+
+    // The memory snapshot is older than the delta checkpoint file now. Writing it out at SIGINT would
+    // replace the base checkpoint file by older data.
+    ImageWriteDriver::get()->resetSnapshotData();
+
+    std::ostringstream ostr;
+    ostr << "wrote delta checkpoint file "
+         << CheckpointDelta::deltaFilename(renderContext->getRenderOutputDriver()->getCheckpointDeltaBaseName(),
+                                           mDelta.getDeltaTotal() - 1)
+         << " tileSamples:" << endSampleId
+         << " time:" << time.end() << " sec";
+    scene_rdl2::logging::Logger::info(ostr.str());
+    return true;
+}
+
+bool
+CheckpointController::emergencyCheckpointSnapshot(const unsigned endSampleId)
+//
+// Returns false when the emergency checkpoint is off or not possible yet (no full checkpoint file
+// of this frame) and the regular snapshot is required instead.
+//
+{
+    if (!mEmergencyCheckpoint || !mDelta.hasBase()) return false;
+
+    std::string errMsg;
+    CheckpointDelta::CaptureUqPtr capture = mDelta.capture(getRenderDriver()->getFilm(), endSampleId, errMsg);
+    if (!capture) {
+        scene_rdl2::logging::Logger::warn("Emergency checkpoint snapshot failed (" + errMsg +
+                                          "). Fall back on regular snapshot");
+        return false;
+    }
+    ImageWriteDriver::get()->updateEmergencyCheckpoint(capture);
+    return true;
+}
+
+void
+CheckpointController::startDeltaBase(RenderContext *renderContext, const unsigned endSampleId)
+{
+    // Delta checkpoint files only keep the tiled Film buffers. Deep and cryptomatte buffers
+    // are not tile based and always need full checkpoint output.
+    const std::string baseName = renderContext->getRenderOutputDriver()->getCheckpointDeltaBaseName();
+    if (baseName.empty() || renderContext->getDeepBuffer() || renderContext->getCryptomatteBuffer()) {
+        mDelta.reset();
+        return;
+    }
+    mDelta.startBase(getRenderDriver()->getFilm(), baseName, endSampleId);
+}
+
+void
+CheckpointController::tileHashOutput(RenderContext *renderContext, const unsigned endSampleId) const
+//
+// Saves the tile hash table of the current frame next to the full checkpoint file. It is stamped
+// by the tile samples of the checkpoint file, so resume can tell if both files belong together.
+//
+{
+    const CheckpointTileHash::HashTable &tileHashes = getRenderDriver()->getTileHashes();
+    if (tileHashes.empty()) return; // checkpoint tile reuse is off
+
+    const std::string checkpointName = renderContext->getRenderOutputDriver()->getCheckpointDeltaBaseName();
+    if (checkpointName.empty()) return;
+
+    std::string errMsg;
+    if (!CheckpointTileHash::write(checkpointName, endSampleId, tileHashes, errMsg)) {
+        scene_rdl2::logging::Logger::warn("Checkpoint tile hash output failed (" + errMsg + ")");
+    }
+}
+
 } // namespace rndr
 } // namespace moonray
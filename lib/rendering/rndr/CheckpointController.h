@@ -5,6 +5,8 @@
 //
 #pragma once
 
+#include "CheckpointDelta.h"
+
 #include <scene_rdl2/common/rec_time/RecTime.h>
 
 #include <list>
@@ -135,12 +137,17 @@ public:
         mCurrDeltaSampleStartId(0),
         mCurrDeltaSampleEndId(0),
         mMaxDeltaSamples(0),
+        mEmergencyCheckpoint(false),
         mLastSnapshotIntervalSec(0.0f)
     {}        
 
     // See CheckpointSnapshotEstimator comments for more detail.
     void set(float snapshotIntervalMinute, float snapshotOverheadFraction);
 
+    // Snapshots are taken as raw delta checkpoint data once the frame has a full checkpoint file,
+    // see CheckpointDelta. The signal interruption writes them within seconds.
+    void setEmergencyCheckpoint(bool flag) { mEmergencyCheckpoint = flag; }
+
     void reset();
 
     //------------------------------
@@ -157,19 +164,29 @@ public:
 
     //------------------------------
 
-    // Creates new ImageWriteCache for snapshot action and stores it properly.
-    // No file output operation itself, just snapshot only.
+    // Creates new ImageWriteCache (or emergency checkpoint data) for snapshot action and stores it
+    // properly. No file output operation itself, just snapshot only.
     void snapshotOnly(RenderContext *renderContext,
                       const std::string &checkpointPostScript,
                       const unsigned endSampleId);
 
     // This is a standard image output action that includes both checkpoint and non-checkpoint situations. 
+    // If checkpointDeltaMax is more than 0, only writes a delta checkpoint file when possible.
     void output(bool checkpointBgWrite,
                 bool twoStageOutput,
+                unsigned checkpointDeltaMax,
                 RenderContext *renderContext,
                 const std::string &checkpointPostScript,
                 const unsigned endSampleId);
 
+    // Writes full checkpoint files if the last checkpoint output was a delta. This makes sure the
+    // checkpoint files at the end of the frame are complete by themselves.
+    void compactDelta(bool checkpointBgWrite,
+                      bool twoStageOutput,
+                      RenderContext *renderContext,
+                      const std::string &checkpointPostScript,
+                      const unsigned endSampleId);
+
 private:
     void resetRemainingIntervalSec();
 
@@ -180,6 +197,11 @@ private:
                         const std::string &checkpointPostScript,
                         const unsigned endSampleId);
 
+    bool deltaOutput(RenderContext *renderContext, const unsigned endSampleId);
+    bool emergencyCheckpointSnapshot(const unsigned endSampleId);
+    void startDeltaBase(RenderContext *renderContext, const unsigned endSampleId);
+    void tileHashOutput(RenderContext *renderContext, const unsigned endSampleId) const;
+
     //------------------------------
 
     float mRemainingIntervalSec;
@@ -192,6 +214,9 @@ private:
 
     scene_rdl2::rec_time::RecTime mRayCostEvalTime;
 
+    CheckpointDelta mDelta;
+    bool mEmergencyCheckpoint;
+
     float mLastSnapshotIntervalSec; // for debug
     scene_rdl2::rec_time::RecTime mSnapshotIntervalTime; // for debug
 };
@@ -0,0 +1,328 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CheckpointDelta.h"
+#include "Film.h"
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char sMagic[8] = {'M', 'N', 'R', 'Y', 'C', 'P', 'D', '1'};
+constexpr unsigned sPixelsPerTile = 64; // tileWidth * tileHeight
+
+struct DeltaBuffer
+{
+    uint8_t *mData;
+    unsigned mPixelSize; // byte
+};
+
+template <typename BufferType>
+void
+pushBuffer(BufferType &buffer, std::vector<DeltaBuffer> &buffers)
+{
+    buffers.push_back({reinterpret_cast<uint8_t *>(buffer.getData()),
+                       static_cast<unsigned>(sizeof(*buffer.getData()))});
+}
+
+std::vector<DeltaBuffer>
+collectBuffers(moonray::rndr::Film &film)
+//
+// All the Film buffers which are reverted from the checkpoint file, in a fixed order.
+// All of them share the Film's tiled layout.
+//
+{
+    std::vector<DeltaBuffer> buffers;
+    pushBuffer(film.getWeightBuffer(), buffers);
+    pushBuffer(film.getRenderBuffer(), buffers);
+    if (film.getRenderBufferOdd()) pushBuffer(*film.getRenderBufferOdd(), buffers);
+    if (film.getHeatMapBuffer()) pushBuffer(*film.getHeatMapBuffer(), buffers);
+    for (unsigned aovIdx = 0; aovIdx < film.getNumAovs(); ++aovIdx) {
+        scene_rdl2::fb_util::VariablePixelBuffer &aov = film.getAovBuffer(aovIdx);
+        buffers.push_back({aov.getData(), aov.getSizeOfPixel()});
+    }
+    return buffers;
+}
+
+template <typename T>
+void
+writeVal(std::vector<char> &out, const T &v)
+{
+    const char *p = reinterpret_cast<const char *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool
+readVal(std::ifstream &in, T &v)
+{
+    in.read(reinterpret_cast<char *>(&v), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+} // namespace
+
+namespace moonray {
+namespace rndr {
+
+void
+CheckpointDelta::reset()
+{
+    mBaseName.clear();
+    mBaseTileSamples = 0;
+    mPrevTileSamples = 0;
+    mDeltaTotal = 0;
+    mTileWeights.clear();
+}
+
+void
+CheckpointDelta::startBase(const Film &film, const std::string &baseName, unsigned tileSamples)
+{
+    removeDeltaFiles();
+
+    // Also removes the left over delta files of the previous process which used the same filename.
+    mBaseName = baseName;
+    removeDeltaFiles();
+
+    mBaseTileSamples = tileSamples;
+    mPrevTileSamples = tileSamples;
+    mDeltaTotal = 0;
+    snapshotTileWeights(film, mTileWeights);
+}
+
+bool
+CheckpointDelta::writeDelta(const Film &film, unsigned tileSamples, std::string &errMsg)
+{
+    CaptureUqPtr delta = capture(film, tileSamples, errMsg);
+    if (!delta || !writeCapture(*delta, errMsg)) {
+        return false;
+    }
+
+    mPrevTileSamples = tileSamples;
+    mTileWeights = std::move(delta->mTileWeights);
+    ++mDeltaTotal;
+    return true;
+}
+
+CheckpointDelta::CaptureUqPtr
+CheckpointDelta::capture(const Film &film, unsigned tileSamples, std::string &errMsg) const
+{
+    MNRY_ASSERT(hasBase());
+
+    CaptureUqPtr delta(new Capture);
+    delta->mFilename = deltaFilename(mBaseName, mDeltaTotal);
+    delta->mTileSamples = tileSamples;
+
+    snapshotTileWeights(film, delta->mTileWeights);
+    if (delta->mTileWeights.size() != mTileWeights.size()) {
+        errMsg = "film resolution changed since the base checkpoint file";
+        return nullptr;
+    }
+
+    std::vector<uint32_t> changedTiles;
+    for (size_t tileId = 0; tileId < delta->mTileWeights.size(); ++tileId) {
+        if (delta->mTileWeights[tileId] != mTileWeights[tileId]) changedTiles.push_back(tileId);
+    }
+    delta->mChangedTileTotal = changedTiles.size();
+
+    // Film buffers are only read here. collectBuffers() returns non-const pointers for applyDeltas().
+    const std::vector<DeltaBuffer> buffers = collectBuffers(const_cast<Film &>(film));
+    const scene_rdl2::fb_util::Tiler &tiler = film.getTiler();
+
+    size_t dataSize = 0;
+    for (const DeltaBuffer &buffer : buffers) {
+        dataSize += changedTiles.size() * sPixelsPerTile * buffer.mPixelSize;
+    }
+
+    std::vector<char> &out = delta->mData;
+    out.reserve(sizeof(sMagic) + (8 + buffers.size() + changedTiles.size()) * sizeof(uint32_t) + dataSize);
+    out.insert(out.end(), sMagic, sMagic + sizeof(sMagic));
+    writeVal(out, static_cast<uint32_t>(tiler.mAlignedW));
+    writeVal(out, static_cast<uint32_t>(tiler.mAlignedH));
+    writeVal(out, static_cast<uint32_t>(mBaseTileSamples));
+    writeVal(out, static_cast<uint32_t>(mPrevTileSamples));
+    writeVal(out, static_cast<uint32_t>(tileSamples));
+    writeVal(out, static_cast<uint32_t>(buffers.size()));
+    for (const DeltaBuffer &buffer : buffers) {
+        writeVal(out, static_cast<uint32_t>(buffer.mPixelSize));
+    }
+    writeVal(out, static_cast<uint32_t>(changedTiles.size()));
+    const char *tileIds = reinterpret_cast<const char *>(changedTiles.data());
+    out.insert(out.end(), tileIds, tileIds + changedTiles.size() * sizeof(uint32_t));
+    for (const DeltaBuffer &buffer : buffers) {
+        const size_t tileSize = sPixelsPerTile * buffer.mPixelSize;
+        for (uint32_t tileId : changedTiles) {
+            const char *tile = reinterpret_cast<const char *>(buffer.mData + tileId * tileSize);
+            out.insert(out.end(), tile, tile + tileSize);
+        }
+    }
+    return delta;
+}
+
+// static function
+bool
+CheckpointDelta::writeCapture(const Capture &capture, std::string &errMsg)
+{
+    const std::string tmpFilename = capture.mFilename + ".tmp";
+    const size_t size = capture.mData.size();
+
+    const int fd = ::open(tmpFilename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        errMsg = "could not open " + tmpFilename;
+        return false;
+    }
+    bool written = false;
+    if (::ftruncate(fd, size) == 0) {
+        void *addr = ::mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            std::memcpy(addr, capture.mData.data(), size);
+            written = (::munmap(addr, size) == 0);
+        }
+    }
+    if (::close(fd) != 0) written = false;
+    if (!written) {
+        errMsg = "could not write " + tmpFilename;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+
+    if (std::rename(tmpFilename.c_str(), capture.mFilename.c_str()) != 0) {
+        errMsg = "could not rename " + tmpFilename + " to " + capture.mFilename;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// static function
+std::string
+CheckpointDelta::deltaFilename(const std::string &baseName, unsigned deltaId)
+{
+    std::ostringstream ostr;
+    ostr << baseName << ".delta" << std::setw(4) << std::setfill('0') << deltaId;
+    return ostr.str();
+}
+
+// static function
+unsigned
+CheckpointDelta::applyDeltas(Film &film,
+                             const std::string &baseName,
+                             unsigned baseTileSamples,
+                             std::vector<std::string> &infoMsg)
+{
+    const std::vector<DeltaBuffer> buffers = collectBuffers(film);
+    const scene_rdl2::fb_util::Tiler &tiler = film.getTiler();
+
+    unsigned currTileSamples = baseTileSamples;
+    for (unsigned deltaId = 0; ; ++deltaId) {
+        const std::string filename = deltaFilename(baseName, deltaId);
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) break; // end of delta chain
+
+        auto skip = [&](const std::string &msg) {
+            infoMsg.push_back("Stop applying delta checkpoint files at " + filename + " : " + msg);
+        };
+
+        char magic[sizeof(sMagic)];
+        in.read(magic, sizeof(magic));
+        if (!in || std::memcmp(magic, sMagic, sizeof(sMagic)) != 0) {
+            skip("not a delta checkpoint file");
+            break;
+        }
+        uint32_t w, h, base, prev, tileSamples, bufferTotal;
+        if (!readVal(in, w) || !readVal(in, h) || !readVal(in, base) || !readVal(in, prev) ||
+            !readVal(in, tileSamples) || !readVal(in, bufferTotal)) {
+            skip("broken header");
+            break;
+        }
+        if (w != tiler.mAlignedW || h != tiler.mAlignedH || bufferTotal != buffers.size()) {
+            skip("film resolution or AOV configuration mismatch");
+            break;
+        }
+        if (base != baseTileSamples || prev != currTileSamples) {
+            // Left over from the other checkpoint file or the chain is broken.
+            skip("does not belong to the resumed checkpoint file");
+            break;
+        }
+        bool pixelSizeMatch = true;
+        for (const DeltaBuffer &buffer : buffers) {
+            uint32_t pixelSize;
+            if (!readVal(in, pixelSize) || pixelSize != buffer.mPixelSize) pixelSizeMatch = false;
+        }
+        uint32_t changedTileTotal;
+        if (!pixelSizeMatch || !readVal(in, changedTileTotal) || changedTileTotal > tiler.mNumTiles) {
+            skip("film buffer layout mismatch");
+            break;
+        }
+        std::vector<uint32_t> changedTiles(changedTileTotal);
+        in.read(reinterpret_cast<char *>(changedTiles.data()), changedTileTotal * sizeof(uint32_t));
+
+        // Read everything first, so a broken file does not leave a partially updated film.
+        std::vector<std::vector<char>> tileData(buffers.size());
+        for (size_t bufferId = 0; bufferId < buffers.size(); ++bufferId) {
+            tileData[bufferId].resize(changedTileTotal * sPixelsPerTile * buffers[bufferId].mPixelSize);
+            in.read(tileData[bufferId].data(), tileData[bufferId].size());
+        }
+        bool tileIdValid = true;
+        for (uint32_t tileId : changedTiles) {
+            if (tileId >= tiler.mNumTiles) tileIdValid = false;
+        }
+        if (!in || !tileIdValid) {
+            skip("truncated file");
+            break;
+        }
+
+        for (size_t bufferId = 0; bufferId < buffers.size(); ++bufferId) {
+            const size_t tileSize = sPixelsPerTile * buffers[bufferId].mPixelSize;
+            for (size_t i = 0; i < changedTiles.size(); ++i) {
+                std::memcpy(buffers[bufferId].mData + changedTiles[i] * tileSize,
+                            tileData[bufferId].data() + i * tileSize,
+                            tileSize);
+            }
+        }
+
+        std::ostringstream ostr;
+        ostr << "Applied delta checkpoint file " << filename
+             << " (tiles:" << changedTileTotal << '/' << tiler.mNumTiles
+             << " tileSamples:" << currTileSamples << "->" << tileSamples << ')';
+        infoMsg.push_back(ostr.str());
+        currTileSamples = tileSamples;
+    }
+    return currTileSamples;
+}
+
+void
+CheckpointDelta::snapshotTileWeights(const Film &film, std::vector<float> &tileWeights) const
+{
+    const scene_rdl2::fb_util::Tiler &tiler = film.getTiler();
+    const float *weight = film.getWeightBuffer().getData();
+    tileWeights.resize(tiler.mNumTiles);
+    for (unsigned tileId = 0; tileId < tiler.mNumTiles; ++tileId) {
+        const float *tileWeight = weight + tileId * sPixelsPerTile;
+        float total = 0.0f;
+        for (unsigned i = 0; i < sPixelsPerTile; ++i) total += tileWeight[i];
+        tileWeights[tileId] = total;
+    }
+}
+
+void
+CheckpointDelta::removeDeltaFiles() const
+{
+    if (mBaseName.empty()) return;
+    for (unsigned deltaId = 0; ; ++deltaId) {
+        if (std::remove(deltaFilename(mBaseName, deltaId).c_str()) != 0) break;
+    }
+}
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,99 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+
+class Film;
+
+class CheckpointDelta
+//
+// This class writes and applies delta checkpoint files.
+//
+// A full checkpoint file rewrites every pixel of every buffer even if most of the tiles did not get
+// any new samples since the previous checkpoint, which is typical for the later part of an adaptive
+// sampling render. A delta checkpoint file only stores the tiles whose weight changed since the
+// previous checkpoint (full or delta), as raw tiled Film data. Delta files are written next to the
+// base checkpoint file as <checkpointFile>.deltaNNNN and build a chain on top of it. The chain is
+// removed when the next full checkpoint file is written.
+//
+// Resume reads the base checkpoint file first and then applies the chain in order. Each delta file
+// records the tile samples of its base checkpoint and of its previous delta, so deltas which do not
+// belong to the resumed checkpoint file are ignored.
+//
+// The next delta file can also be captured in memory without writing it. The signal interruption
+// writes the last capture in one go as an emergency checkpoint, which takes a fraction of the time
+// of the encoded checkpoint file output. The capture is in the delta file format, so resume applies
+// it like any other delta file and the next full checkpoint folds it into the checkpoint file.
+//
+{
+public:
+    // Complete image of the next delta file of the chain
+    struct Capture
+    {
+        std::string mFilename;
+        unsigned mTileSamples {0};
+        unsigned mChangedTileTotal {0};
+        std::vector<char> mData; // file image
+        std::vector<float> mTileWeights; // weight total of each tile at capture time
+    };
+    using CaptureUqPtr = std::unique_ptr<Capture>;
+
+    CheckpointDelta() :
+        mBaseTileSamples(0),
+        mPrevTileSamples(0),
+        mDeltaTotal(0)
+    {}
+
+    void reset();
+
+    // Is called right after the full checkpoint file output. Removes the previous delta chain and
+    // records the current film condition as a start point of the new delta chain.
+    void startBase(const Film &film, const std::string &baseName, unsigned tileSamples);
+
+    bool hasBase() const { return !mBaseName.empty(); }
+    unsigned getDeltaTotal() const { return mDeltaTotal; }
+
+    // Writes the tiles which changed since the previous checkpoint. Returns false and sets errMsg
+    // if the file can not be written, in which case the caller should write a full checkpoint.
+    bool writeDelta(const Film &film, unsigned tileSamples, std::string &errMsg);
+
+    // Copies the tiles which changed since the previous checkpoint into the image of the next delta
+    // file without writing it or advancing the chain. Returns nullptr and sets errMsg on failure.
+    CaptureUqPtr capture(const Film &film, unsigned tileSamples, std::string &errMsg) const;
+
+    // Writes a captured delta file through a memory mapping of the file.
+    static bool writeCapture(const Capture &capture, std::string &errMsg);
+
+    static std::string deltaFilename(const std::string &baseName, unsigned deltaId);
+
+    // Applies the delta chain of baseName on top of the film which is already reverted from baseName.
+    // Film buffers have to be in the non-normalized condition. Returns the tile samples of the last
+    // applied delta file, or baseTileSamples if there is nothing to apply.
+    static unsigned applyDeltas(Film &film,
+                                const std::string &baseName,
+                                unsigned baseTileSamples,
+                                std::vector<std::string> &infoMsg);
+
+private:
+    void snapshotTileWeights(const Film &film, std::vector<float> &tileWeights) const;
+    void removeDeltaFiles() const;
+
+    std::string mBaseName; // empty when we don't have a base checkpoint file
+    unsigned mBaseTileSamples;
+    unsigned mPrevTileSamples;
+    unsigned mDeltaTotal;
+
+    std::vector<float> mTileWeights; // weight total of each tile at the previous checkpoint
+};
+
+} // namespace rndr
+} // namespace moonray
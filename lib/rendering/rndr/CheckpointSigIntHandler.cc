@@ -50,6 +50,7 @@ sceneContextDumpSigActionFunction(int sig, siginfo_t */*info*/, void */*ctx*/)
 //-----------------------------------------------------------------------------------------
 
 static std::atomic<bool> gCheckpointSigIntHandlerActionStarted(false);
+static std::atomic<bool> gCheckpointSigIntHandlerEnabled(false);
 
 // static function
 void
@@ -77,6 +78,8 @@ CheckpointSigIntHandler::enable()
     if (!ProcKeeper::get()->openWriteProgressFile()) {
         scene_rdl2::logging::Logger::fatal("writeProgressFile open failed.");
     }
+
+    gCheckpointSigIntHandlerEnabled.store(true, std::memory_order_relaxed);
 }
 
 // static function
@@ -106,6 +109,15 @@ CheckpointSigIntHandler::disable()
         scene_rdl2::logging::Logger::fatal("fall back to default SIGINT handler failed.");
         exit(EXIT_FAILURE);
     }
+
+    gCheckpointSigIntHandlerEnabled.store(false, std::memory_order_relaxed);
+}
+
+// static function
+bool
+CheckpointSigIntHandler::isEnabled()
+{
+    return gCheckpointSigIntHandlerEnabled.load(std::memory_order_relaxed);
 }
 
 // static function
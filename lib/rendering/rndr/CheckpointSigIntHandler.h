@@ -18,6 +18,7 @@ class CheckpointSigIntHandler
 public:
     static void enable();
     static void disable();
+    static bool isEnabled(); // SIGINT checkpoints and exits while this is true
     static void handlerActionStarted();
 };
 
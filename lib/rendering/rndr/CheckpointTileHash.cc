@@ -0,0 +1,181 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include <scene_rdl2/render/util/AtomicFloat.h> // Needs to be included before any OpenImageIO file
+#include <moonray/rendering/pbr/core/Scene.h>
+
+#include "CheckpointTileHash.h"
+#include "Util.h"
+
+#include <moonray/rendering/bvh/shading/Intersection.h>
+#include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/pbr/camera/Camera.h>
+#include <scene_rdl2/common/fb_util/Tiler.h>
+#include <scene_rdl2/scene/rdl2/Geometry.h>
+#include <scene_rdl2/scene/rdl2/Layer.h>
+#include <scene_rdl2/scene/rdl2/Material.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <tbb/task_arena.h>
+
+namespace {
+
+constexpr char sMagic[8] = {'M', 'N', 'R', 'Y', 'T', 'H', 'S', '1'};
+
+// FNV-1a : the table is saved to the file, so we don't use std::hash which is implementation defined.
+constexpr uint64_t sHashInit = 0xcbf29ce484222325ULL;
+
+inline void
+hashBytes(uint64_t &hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+}
+
+inline void
+hashFloat(uint64_t &hash, float v)
+{
+    // Drops the lower mantissa bits, tiny differences of the ray evaluation on the other frame
+    // should not invalidate the tile.
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    bits >>= 10;
+    hashBytes(hash, &bits, sizeof(bits));
+}
+
+inline void
+hashString(uint64_t &hash, const std::string &str)
+{
+    hashBytes(hash, str.data(), str.size());
+    hashBytes(hash, "", 1); // terminator, so concatenated names don't collide
+}
+
+} // namespace
+
+namespace moonray {
+namespace rndr {
+
+// static function
+void
+CheckpointTileHash::compute(const pbr::Scene &scene, const scene_rdl2::fb_util::Tiler &tiler,
+                            HashTable &tileHashes)
+{
+    const pbr::Camera *camera = scene.getCamera();
+    const scene_rdl2::rdl2::Layer *layer = scene.getLayer();
+    const unsigned numTilesX = tiler.mAlignedW >> 3;
+
+    tileHashes.assign(tiler.mNumTiles, sHashInit);
+    mcrt_common::ThreadLocalState *topLevelTlsList = MNRY_VERIFY(mcrt_common::getTLSList());
+    simpleLoop(true, 0u, tiler.mNumTiles, [&](unsigned tileIdx) {
+        mcrt_common::ThreadLocalState *tls = topLevelTlsList + tbb::task_arena::current_thread_index();
+
+        const unsigned startX = (tileIdx % numTilesX) << 3;
+        const unsigned startY = (tileIdx / numTilesX) << 3;
+        uint64_t hash = sHashInit;
+        for (unsigned y = startY; y < startY + 8 && y < tiler.mOriginalH; ++y) {
+            for (unsigned x = startX; x < startX + 8 && x < tiler.mOriginalW; ++x) {
+                mcrt_common::RayDifferential ray;
+                camera->createRay(&ray, x + 0.5f, y + 0.5f, 0.5f, 0.5f, 0.5f, false);
+                for (int axis = 0; axis < 3; ++axis) hashFloat(hash, ray.getDirection()[axis]);
+
+                shading::Intersection isect;
+                const int lobeType = 0; // primary ray
+                if (!scene.intersectRay(tls, ray, isect, lobeType)) {
+                    hashBytes(hash, "miss", 4);
+                    continue;
+                }
+                hashFloat(hash, ray.getEnd());
+                for (int axis = 0; axis < 3; ++axis) hashFloat(hash, isect.getNg()[axis]);
+
+                const int assignmentId = isect.getLayerAssignmentId();
+                if (assignmentId >= 0) {
+                    const scene_rdl2::rdl2::Layer::GeometryPartPair geomPart =
+                        layer->lookupGeomAndPart(assignmentId);
+                    if (geomPart.first) hashString(hash, geomPart.first->getName());
+                    hashString(hash, geomPart.second);
+                }
+                if (isect.getMaterial()) hashString(hash, isect.getMaterial()->getName());
+            }
+        }
+        tileHashes[tileIdx] = hash;
+    });
+}
+
+// static function
+std::string
+CheckpointTileHash::filename(const std::string &checkpointFilename)
+{
+    return checkpointFilename + ".tilehash";
+}
+
+// static function
+bool
+CheckpointTileHash::write(const std::string &checkpointFilename, unsigned tileSamples,
+                          const HashTable &tileHashes, std::string &errMsg)
+{
+    const std::string outFilename = filename(checkpointFilename);
+    const std::string tmpFilename = outFilename + ".tmp";
+    {
+        std::ofstream out(tmpFilename, std::ios::trunc | std::ios::binary);
+        if (!out) {
+            errMsg = "could not open " + tmpFilename;
+            return false;
+        }
+        const uint32_t samples = tileSamples;
+        const uint32_t tileTotal = static_cast<uint32_t>(tileHashes.size());
+        out.write(sMagic, sizeof(sMagic));
+        out.write(reinterpret_cast<const char *>(&samples), sizeof(samples));
+        out.write(reinterpret_cast<const char *>(&tileTotal), sizeof(tileTotal));
+        out.write(reinterpret_cast<const char *>(tileHashes.data()), tileHashes.size() * sizeof(uint64_t));
+        if (!out) {
+            errMsg = "could not write " + tmpFilename;
+            out.close();
+            std::remove(tmpFilename.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpFilename.c_str(), outFilename.c_str()) != 0) {
+        errMsg = "could not rename " + tmpFilename + " to " + outFilename;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// static function
+bool
+CheckpointTileHash::read(const std::string &checkpointFilename, unsigned &tileSamples,
+                         HashTable &tileHashes, std::string &errMsg)
+{
+    const std::string inFilename = filename(checkpointFilename);
+    std::ifstream in(inFilename, std::ios::binary);
+    if (!in) {
+        errMsg = "could not open " + inFilename;
+        return false;
+    }
+    char magic[sizeof(sMagic)];
+    uint32_t samples, tileTotal;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&samples), sizeof(samples));
+    in.read(reinterpret_cast<char *>(&tileTotal), sizeof(tileTotal));
+    if (!in || std::memcmp(magic, sMagic, sizeof(sMagic)) != 0 || tileTotal > (1u << 26)) {
+        errMsg = inFilename + " is not a tile hash file";
+        return false;
+    }
+    tileHashes.resize(tileTotal);
+    in.read(reinterpret_cast<char *>(tileHashes.data()), tileHashes.size() * sizeof(uint64_t));
+    if (!in) {
+        errMsg = inFilename + " is truncated";
+        return false;
+    }
+    tileSamples = samples;
+    return true;
+}
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,58 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scene_rdl2 {
+namespace fb_util {
+class Tiler;
+}
+}
+
+namespace moonray {
+
+namespace pbr {
+class Scene;
+}
+
+namespace rndr {
+
+class CheckpointTileHash
+//
+// Per tile hash of the primary visibility, used to resume a render from the checkpoint file of the
+// other frame (turntable, lookdev iteration with a static camera ...).
+//
+// The hash of a tile is computed from one primary ray at the center of each pixel and combines the
+// ray direction, the hit distance, the geometric normal and the names of the hit geometry, part and
+// material. A tile whose hash is the same on both frames sees the same surfaces, so its samples of
+// the previous frame are kept and only the other tiles are rendered from scratch.
+// Changes which do not show up in the primary visibility, like light or shader parameter edits or
+// the shadows and reflections of moved geometry in the other tiles, are not detected.
+//
+// The table is saved next to the checkpoint file as <checkpointFile>.tilehash together with the
+// tile samples of the checkpoint file it belongs to.
+//
+{
+public:
+    using HashTable = std::vector<uint64_t>;
+
+    // Traces the primary rays in parallel by the render thread TLS. Has to be called from the render
+    // thread before MCRT starts.
+    static void compute(const pbr::Scene &scene, const scene_rdl2::fb_util::Tiler &tiler, HashTable &tileHashes);
+
+    static std::string filename(const std::string &checkpointFilename);
+
+    static bool write(const std::string &checkpointFilename, unsigned tileSamples, const HashTable &tileHashes,
+                      std::string &errMsg);
+    static bool read(const std::string &checkpointFilename, unsigned &tileSamples, HashTable &tileHashes,
+                     std::string &errMsg);
+};
+
+} // namespace rndr
+} // namespace moonray
@@ -17,6 +17,12 @@
 #include <scene_rdl2/common/math/Viewport.h>
 #include <scene_rdl2/scene/rdl2/DisplayFilter.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #define TILE_WIDTH 8
 
 namespace moonray {
@@ -34,7 +40,9 @@ public:
               const std::vector<scene_rdl2::fb_util::Tile>* tiles,
               const uint32_t *tileIndices,
               const scene_rdl2::math::Viewport& viewport,
-              unsigned int threadCount);
+              unsigned int threadCount,
+              unsigned int asyncThreadCount,
+              const std::function<void()>& snapshotAovs);
 
     bool hasDisplayFilters() const { return mRenderOutputDisplayFilterCount > 0; }
 
@@ -47,6 +55,11 @@ public:
 
     void requestTileUpdate(unsigned int tileIdx) const;
 
+    bool isAsync() const { return !mAsyncThreads.empty(); }
+    void queueTileUpdate(unsigned int tileIdx) const;
+    void pauseAsync() const;
+    void resumeAsync() const;
+
 private:
 
     // The DisplayFilterDriver has an internal DAG to organize which
@@ -139,6 +152,15 @@ private:
     void createUpdateMask();
     void createInputBuffers(const InputDataMap& inputDataMap, unsigned int threadCount);
 
+    // async display filter threads
+    void startAsync(unsigned int threadCount,
+                    unsigned int asyncThreadCount,
+                    const std::function<void()>& snapshotAovs);
+    void stopAsync();
+    void asyncThreadMain(unsigned int asyncIdx);
+    bool collectAsyncBatch() const;
+    void runAsyncBatch(unsigned int threadId) const;
+
     // update mask
     void haltTileUpdate(int dfIdx, unsigned int tileIdx) const;
     bool updateRequested(int dfIdx, unsigned int tileIdx) const;
@@ -212,6 +234,27 @@ private:
     unsigned int mHeight;
     int mNumTilesX;
     int mNumTilesY;
+
+    // Async mode. The render threads queue the tiles they finish, the async
+    // threads run the display filters of the queued tiles in batches, with the
+    // input buffers of the render threads followed by their own.
+    unsigned int mAsyncThreadIdOffset {0};
+    unsigned int mAsyncThreadCount {0};
+    std::vector<std::thread> mAsyncThreads;
+    std::function<void()> mSnapshotAovs;
+    mutable std::unique_ptr<std::atomic<bool>[]> mQueuedTiles;
+    mutable std::atomic<unsigned int> mNumQueuedTiles {0};
+    unsigned int mAsyncBatchSize {1};
+    mutable std::mutex mAsyncMutex;
+    mutable std::condition_variable mAsyncCv;     // wakes the async threads
+    mutable std::condition_variable mAsyncIdleCv; // signals the end of a batch
+    bool mAsyncShutdown {false};
+    mutable bool mAsyncPaused {false};
+    mutable bool mBatchInFlight {false};
+    mutable unsigned int mBatchId {0};
+    mutable unsigned int mNumBatchThreads {0};
+    mutable std::vector<unsigned int> mBatch;
+    mutable std::atomic<unsigned int> mBatchNext {0};
 };
 
 DisplayFilterDriver::Impl::~Impl()
@@ -219,13 +262,23 @@ DisplayFilterDriver::Impl::~Impl()
     clear();
 }
 
+namespace {
+
+// The async threads run a batch once this much time passed since the last one,
+// or earlier once a batch worth of tiles got queued.
+constexpr std::chrono::milliseconds sAsyncBatchInterval(20);
+
+} // namespace
+
 void
 DisplayFilterDriver::Impl::init(rndr::Film *film,
                                 const rndr::RenderOutputDriver *roDriver,
                                 const std::vector<scene_rdl2::fb_util::Tile>* tiles,
                                 const uint32_t *tileIndices,
                                 const scene_rdl2::math::Viewport& viewport,
-                                unsigned int threadCount)
+                                unsigned int threadCount,
+                                unsigned int asyncThreadCount,
+                                const std::function<void()>& snapshotAovs)
 {
     clear();
 
@@ -246,7 +299,12 @@ DisplayFilterDriver::Impl::init(rndr::Film *film,
     validateDAG(roDriver, inputDataMap);
     prepareFatalBuffers();
     createUpdateMask();
-    createInputBuffers(inputDataMap, threadCount);
+    if (hasDisplayFilters() && asyncThreadCount > 0) {
+        createInputBuffers(inputDataMap, threadCount + asyncThreadCount);
+        startAsync(threadCount, asyncThreadCount, snapshotAovs);
+    } else {
+        createInputBuffers(inputDataMap, threadCount);
+    }
 }
 
 void
@@ -271,9 +329,193 @@ DisplayFilterDriver::Impl::updateRequested(int dfIdx, unsigned int tileIdx) cons
     return mUpdateMask[dfIdx][tileIdx];
 }
 
+void
+DisplayFilterDriver::Impl::queueTileUpdate(unsigned int tileIdx) const
+{
+    MNRY_ASSERT(isAsync());
+    if (!mQueuedTiles[tileIdx].exchange(true, std::memory_order_acq_rel)) {
+        if (mNumQueuedTiles.fetch_add(1, std::memory_order_acq_rel) + 1 == mAsyncBatchSize) {
+            mAsyncCv.notify_all();
+        }
+    }
+}
+
+void
+DisplayFilterDriver::Impl::pauseAsync() const
+{
+    if (!isAsync()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mAsyncMutex);
+    mAsyncPaused = true;
+    mAsyncIdleCv.wait(lock, [&]{ return !mBatchInFlight; });
+
+    // Hand the tiles still queued over to the update mask so that they are
+    // picked up by whoever runs the display filters next.
+    for (unsigned int tileIdx = 0; tileIdx < mTiles->size(); ++tileIdx) {
+        if (mQueuedTiles[tileIdx].exchange(false, std::memory_order_acq_rel)) {
+            requestTileUpdate(tileIdx);
+        }
+    }
+    mNumQueuedTiles.store(0, std::memory_order_release);
+}
+
+void
+DisplayFilterDriver::Impl::resumeAsync() const
+{
+    if (!isAsync()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mAsyncMutex);
+    mAsyncPaused = false;
+}
+
+void
+DisplayFilterDriver::Impl::startAsync(unsigned int threadCount,
+                                      unsigned int asyncThreadCount,
+                                      const std::function<void()>& snapshotAovs)
+{
+    const size_t numTiles = mTiles->size();
+
+    mAsyncThreadIdOffset = threadCount;
+    mAsyncThreadCount = asyncThreadCount;
+    mSnapshotAovs = snapshotAovs;
+    mQueuedTiles.reset(new std::atomic<bool>[numTiles]);
+    for (size_t tileIdx = 0; tileIdx < numTiles; ++tileIdx) {
+        mQueuedTiles[tileIdx].store(false, std::memory_order_relaxed);
+    }
+    mNumQueuedTiles.store(0, std::memory_order_relaxed);
+    // A tile per render thread, i.e. about one round of finished tiles.
+    mAsyncBatchSize = std::max(threadCount, 1u);
+    mBatch.reserve(numTiles);
+    mAsyncShutdown = false;
+    mAsyncPaused = false;
+    mBatchInFlight = false;
+    mBatchId = 0;
+    mNumBatchThreads = 0;
+
+    for (unsigned int asyncIdx = 0; asyncIdx < asyncThreadCount; ++asyncIdx) {
+        mAsyncThreads.emplace_back(&DisplayFilterDriver::Impl::asyncThreadMain, this, asyncIdx);
+    }
+}
+
+void
+DisplayFilterDriver::Impl::stopAsync()
+{
+    if (!isAsync()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        mAsyncShutdown = true;
+    }
+    mAsyncCv.notify_all();
+    for (std::thread& thread : mAsyncThreads) {
+        thread.join();
+    }
+    mAsyncThreads.clear();
+    mQueuedTiles.reset();
+    mBatch.clear();
+    mSnapshotAovs = nullptr;
+}
+
+void
+DisplayFilterDriver::Impl::asyncThreadMain(unsigned int asyncIdx)
+{
+    const unsigned int threadId = mAsyncThreadIdOffset + asyncIdx;
+    unsigned int lastBatchId = 0;
+
+    std::unique_lock<std::mutex> lock(mAsyncMutex);
+    while (true) {
+        if (asyncIdx == 0) {
+            // The first async thread collects the batches, the others only help
+            // running them.
+            mAsyncCv.wait_for(lock, sAsyncBatchInterval, [&]{
+                return mAsyncShutdown ||
+                       (!mAsyncPaused && mNumQueuedTiles.load(std::memory_order_acquire) >= mAsyncBatchSize);
+            });
+            if (mAsyncShutdown) {
+                break;
+            }
+            if (mAsyncPaused || !collectAsyncBatch()) {
+                continue;
+            }
+
+            // The aov snapshot reads the film which the render threads keep
+            // writing to, the same as when they run the display filters
+            // themselves.
+            lock.unlock();
+            if (mSnapshotAovs) {
+                mSnapshotAovs();
+            }
+            lock.lock();
+
+            mBatchNext.store(0, std::memory_order_relaxed);
+            mNumBatchThreads = mAsyncThreadCount;
+            lastBatchId = ++mBatchId;
+            mAsyncCv.notify_all();
+        } else {
+            mAsyncCv.wait(lock, [&]{ return mAsyncShutdown || mBatchId != lastBatchId; });
+            if (mBatchId == lastBatchId) {
+                break; // shutdown, a batch in flight is joined first though
+            }
+            lastBatchId = mBatchId;
+        }
+
+        lock.unlock();
+        runAsyncBatch(threadId);
+        lock.lock();
+
+        if (--mNumBatchThreads == 0) {
+            mBatchInFlight = false;
+            mAsyncIdleCv.notify_all();
+        } else if (asyncIdx == 0) {
+            // Don't collect the next batch before everyone left this one.
+            mAsyncIdleCv.wait(lock, [&]{ return !mBatchInFlight; });
+        }
+    }
+}
+
+bool
+DisplayFilterDriver::Impl::collectAsyncBatch() const
+{
+    // Called with mAsyncMutex held and no batch running, so the async threads
+    // are the only ones touching the update mask.
+    mBatch.clear();
+    for (unsigned int tileIdx = 0; tileIdx < mTiles->size(); ++tileIdx) {
+        if (mQueuedTiles[tileIdx].load(std::memory_order_relaxed) &&
+            mQueuedTiles[tileIdx].exchange(false, std::memory_order_acq_rel)) {
+            mNumQueuedTiles.fetch_sub(1, std::memory_order_acq_rel);
+            requestTileUpdate(tileIdx);
+            mBatch.push_back(tileIdx);
+        }
+    }
+    mBatchInFlight = !mBatch.empty();
+    return mBatchInFlight;
+}
+
+void
+DisplayFilterDriver::Impl::runAsyncBatch(unsigned int threadId) const
+{
+    // Like in progressive mode on the render threads, filtering a tile may run
+    // the display filters of neighboring tiles other threads are working on.
+    while (true) {
+        const unsigned int idx = mBatchNext.fetch_add(1, std::memory_order_relaxed);
+        if (idx >= mBatch.size()) {
+            break;
+        }
+        runDisplayFilters(mBatch[idx], threadId);
+    }
+}
+
 void
 DisplayFilterDriver::Impl::clear()
 {
+    stopAsync();
+
     for (auto& perThreadInputBuffers : mInputBuffers) {
         for (auto& inputBuffers : perThreadInputBuffers) {
             for (InputBuffer * inputBuffer : inputBuffers) {
@@ -1058,9 +1300,11 @@ DisplayFilterDriver::init(rndr::Film *film,
                           const std::vector<scene_rdl2::fb_util::Tile>* tiles,
                           const uint32_t *tileIndices,
                           const scene_rdl2::math::Viewport& viewport,
-                          unsigned int threadCount)
+                          unsigned int threadCount,
+                          unsigned int asyncThreadCount,
+                          const std::function<void()>& snapshotAovs)
 {
-    mImpl->init(film, roDriver, tiles, tileIndices, viewport, threadCount);
+    mImpl->init(film, roDriver, tiles, tileIndices, viewport, threadCount, asyncThreadCount, snapshotAovs);
 }
 
 bool
@@ -1094,6 +1338,30 @@ DisplayFilterDriver::runDisplayFilters(unsigned int tileIdx,
     mImpl->runDisplayFilters(tileIdx, threadId);
 }
 
+bool
+DisplayFilterDriver::isAsync() const
+{
+    return mImpl->isAsync();
+}
+
+void
+DisplayFilterDriver::queueTileUpdate(unsigned int tileIdx) const
+{
+    mImpl->queueTileUpdate(tileIdx);
+}
+
+void
+DisplayFilterDriver::pauseAsync() const
+{
+    mImpl->pauseAsync();
+}
+
+void
+DisplayFilterDriver::resumeAsync() const
+{
+    mImpl->resumeAsync();
+}
+
 } // namespace displayfilter
 } // namespace moonray
 
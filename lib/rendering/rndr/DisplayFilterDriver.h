@@ -9,6 +9,8 @@
 #include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
 #include <scene_rdl2/scene/rdl2/DisplayFilter.h>
 
+#include <functional>
+
 namespace scene_rdl2 {
 
 namespace math {
@@ -37,12 +39,17 @@ public:
     DisplayFilterDriver();
     ~DisplayFilterDriver();
 
+    // asyncThreadCount > 0 starts that many dedicated threads which run the
+    // display filters of the tiles passed to queueTileUpdate(), calling
+    // snapshotAovs before each batch of tiles.
     void init(rndr::Film* film,
               const rndr::RenderOutputDriver *roDriver,
               const std::vector<scene_rdl2::fb_util::Tile>* tiles,
               const uint32_t *tileIndices,
               const scene_rdl2::math::Viewport& viewport,
-              unsigned int threadCount);
+              unsigned int threadCount,
+              unsigned int asyncThreadCount = 0,
+              const std::function<void()>& snapshotAovs = nullptr);
 
     bool hasDisplayFilters() const;
 
@@ -61,6 +68,19 @@ public:
     // each tile is operated on by one thread at a time.
     void requestTileUpdate(unsigned int tileIdx) const;
 
+    // Async mode, see init(). Thread safe, the render threads queue the tiles
+    // they finish instead of running the display filters themselves. The async
+    // threads pick them up in batches of about one tile per render thread.
+    bool isAsync() const;
+    void queueTileUpdate(unsigned int tileIdx) const;
+
+    // pauseAsync() waits for the batch in flight and moves the tiles still
+    // queued to the update mask, after which runDisplayFilters() and
+    // requestTileUpdate() may be used again until resumeAsync(). No-ops when
+    // not in async mode.
+    void pauseAsync() const;
+    void resumeAsync() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> mImpl;
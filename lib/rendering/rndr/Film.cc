@@ -11,11 +11,14 @@
 #include "Util.h"
 
 #include <moonray/common/mcrt_util/Atomic.h>
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
+#include <moonray/rendering/mcrt_common/NumaUtil.h>
 
 #include <moonray/rendering/pbr/core/Aov.h>
 #include <moonray/rendering/pbr/core/PbrTLState.h>
 
 #include <scene_rdl2/common/fb_util/TileExtrapolation.h>
+#include <scene_rdl2/render/logging/logging.h>
 #include <scene_rdl2/render/util/Random.h>
 #include <scene_rdl2/common/math/Viewport.h>
 
@@ -98,6 +101,46 @@ atomicMathFilter(float *dest, const float *src, const size_t sz, float depth, co
     }
 }
 
+// Non atomic version of atomicMathFilter, the caller has to own dest.
+inline void
+mathFilter(float *dest, const float *src, const size_t sz, float depth, const pbr::AovFilter filter)
+{
+    if (filter == pbr::AOV_FILTER_CLOSEST) {
+        MNRY_ASSERT(sz <= 3);
+        if (scene_rdl2::math::isfinite(depth) && depth < dest[3]) {
+            for (size_t i = 0; i < sz; ++i) {
+                if (!scene_rdl2::math::isfinite(src[i])) return;
+            }
+            for (size_t i = 0; i < sz; ++i) {
+                dest[i] = src[i];
+            }
+            dest[3] = depth;
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < sz; ++i) {
+        // see atomicMathFilter for why non finite values are skipped
+        if (scene_rdl2::math::isfinite(src[i])) {
+            switch (filter) {
+            case pbr::AOV_FILTER_AVG:
+            case pbr::AOV_FILTER_SUM:
+                dest[i] += src[i];
+                break;
+            case pbr::AOV_FILTER_MIN:
+                dest[i] = std::min(dest[i], src[i]);
+                break;
+            case pbr::AOV_FILTER_MAX:
+                dest[i] = std::max(dest[i], src[i]);
+                break;
+            case pbr::AOV_FILTER_CLOSEST:
+            default:
+                MNRY_ASSERT(0 && "unexpected aov scene_rdl2::math filter");
+            }
+        }
+    }
+}
+
 #ifdef DEBUG
 bool
 areBundledEntriesValid(mcrt_common::ThreadLocalState *tls, unsigned numEntries,
@@ -205,6 +248,57 @@ extrapolatePartialTileV2(scene_rdl2::fb_util::RenderColor *__restrict dst,
     }
 }
 
+// Full tile version of extrapolatePartialTileV2, the preview path of every
+// progressive snapshot. The weights are tested and normalized with
+// straight loops over the 64 pixels, which vectorize, and the nearest
+// active pixel search is skipped for full tiles and for the fill levels of
+// gPixelFillOrder, whose results are precomputed.
+inline void
+extrapolateFullTile(scene_rdl2::fb_util::RenderColor *__restrict dst,
+                    const scene_rdl2::fb_util::RenderColor *__restrict srcColor,
+                    const float *__restrict srcWeight,
+                    const scene_rdl2::fb_util::TileExtrapolation *tileExtrapolation,
+                    const uint64_t *fillLevelMasks,
+                    const uint8_t (*fillLevelPixIds)[64])
+{
+    float invWeight[64];
+    for (unsigned i = 0; i < 64; ++i) {
+        invWeight[i] = (srcWeight[i] > 0.f) ? 1.f / srcWeight[i] : 0.f;
+    }
+    uint64_t activePixelMask = (uint64_t)0x0;
+    for (unsigned i = 0; i < 64; ++i) {
+        activePixelMask |= (uint64_t)(invWeight[i] > 0.f) << i;
+    }
+
+    if (activePixelMask == ~(uint64_t)0x0) {
+        for (unsigned i = 0; i < 64; ++i) {
+            dst[i] = srcColor[i] * invWeight[i];
+        }
+        return;
+    }
+
+    scene_rdl2::fb_util::RenderColor workPixel[64];
+    for (unsigned i = 0; i < 64; ++i) {
+        workPixel[i] = srcColor[i] * invWeight[i];
+    }
+
+    const unsigned fillLevel = __builtin_popcountll(activePixelMask);
+    if (activePixelMask == fillLevelMasks[fillLevel]) {
+        const uint8_t *pixIds = fillLevelPixIds[fillLevel];
+        for (unsigned i = 0; i < 64; ++i) {
+            dst[i] = workPixel[pixIds[i]];
+        }
+        return;
+    }
+
+    // Not rendered in the default order, e.g. adaptive or distributed.
+    int extrapolatePixIdArray[64];
+    tileExtrapolation->searchActiveNearestPixel(activePixelMask, extrapolatePixIdArray, 0, 8, 0, 8);
+    for (unsigned i = 0; i < 64; ++i) {
+        dst[i] = workPixel[extrapolatePixIdArray[i]];
+    }
+}
+
 void
 copyPixIdTable(const std::vector<uint8_t> &src, uint8_t dst[64])
 {
@@ -294,6 +388,7 @@ uint8_t gScrambledPixelFillOrder[1024][64];
 Film::Film() :
     mFilmActivity(0),
     mPixelInfoBufActivity(0),
+    mDirtyTileEpoch(1),
     mUseAdaptiveSampling(false),
     mRenderBufOdd(nullptr),
     mDeepBuf(nullptr),
@@ -335,9 +430,12 @@ Film::init(unsigned w, unsigned h,
            )
 {
     mTileExtrapolation = tileExtrapolation;
+    initFillLevelPixIds();
 
     MNRY_ASSERT(w * h > 0);
     mTiler = scene_rdl2::fb_util::Tiler(w, h);
+    mTileWriteEpochs.reset(new std::atomic<uint32_t>[mTiler.mNumTiles]);
+    markAllTilesDirty();
 
     unsigned alignedW = mTiler.mAlignedW;
     unsigned alignedH = mTiler.mAlignedH;
@@ -426,6 +524,18 @@ Film::init(unsigned w, unsigned h,
         mAdaptiveRenderTilesTable.reset();
     }
 
+    if (flags & SPLAT_PIXEL_FILTER) {
+        if (!mSplatBuf) {
+            mSplatBuf.reset(new scene_rdl2::fb_util::RenderBuffer);
+            mSplatWeightBuf.reset(new scene_rdl2::fb_util::FloatBuffer);
+        }
+        mSplatBuf->init(alignedW, alignedH);
+        mSplatWeightBuf->init(alignedW, alignedH);
+    } else {
+        mSplatBuf.reset();
+        mSplatWeightBuf.reset();
+    }
+
     if (flags & ALLOC_DEEP_BUFFER) {
         if (!mDeepBuf) {
             mDeepBuf = new pbr::DeepBuffer;
@@ -448,7 +558,7 @@ Film::init(unsigned w, unsigned h,
         if (!mCryptomatteBuf) {
             mCryptomatteBuf = new pbr::CryptomatteBuffer;
         }
-        mCryptomatteBuf->init(w, h, deepIDChannelNames.size(), multiPresenceOn);
+        mCryptomatteBuf->init(w, h, deepIDChannelNames.size(), multiPresenceOn, numRenderThreads);
     } else {
         delete mCryptomatteBuf;
         mCryptomatteBuf = nullptr;
@@ -500,6 +610,9 @@ Film::cleanUp()
     delete mRenderBufOdd;
     mRenderBufOdd = nullptr;
 
+    mSplatBuf.reset();
+    mSplatWeightBuf.reset();
+
     mFilmActivity = 0;
     mPixelInfoBufActivity = 0;
 }
@@ -514,6 +627,11 @@ Film::clearAllBuffers()
         mRenderBufOdd->clear();
     }
 
+    if (mSplatBuf) {
+        mSplatBuf->clear();
+        mSplatWeightBuf->clear();
+    }
+
     if (mAdaptiveRenderTilesTable) {
         mAdaptiveRenderTilesTable->reset();
     }
@@ -542,6 +660,132 @@ Film::clearAllBuffers()
 
     mFilmActivity = 0;
     mPixelInfoBufActivity = 0;
+    markAllTilesDirty();
+}
+
+void
+Film::markAllTilesDirty()
+{
+    const uint32_t epoch = mDirtyTileEpoch.load(std::memory_order_acquire);
+    for (unsigned tileIdx = 0; tileIdx < mTiler.mNumTiles; ++tileIdx) {
+        mTileWriteEpochs[tileIdx].store(epoch, std::memory_order_release);
+    }
+}
+
+void
+Film::clearTile(unsigned tileIdx)
+{
+    MNRY_ASSERT(tileIdx < mTiler.mNumTiles);
+
+    // Every tile is 64 contiguous pixels in the tiled buffers.
+    const size_t pixOfs = static_cast<size_t>(tileIdx) << 6;
+    auto clearPixels = [&](auto *pixels, const auto &value) {
+        std::fill(pixels + pixOfs, pixels + pixOfs + 64, value);
+    };
+
+    clearPixels(mRenderBuf.getData(), scene_rdl2::fb_util::RenderColor(scene_rdl2::math::zero));
+    clearPixels(mWeightBuf.getData(), 0.0f);
+    if (mRenderBufOdd) {
+        clearPixels(mRenderBufOdd->getData(), scene_rdl2::fb_util::RenderColor(scene_rdl2::math::zero));
+    }
+    if (mSplatBuf) {
+        clearPixels(mSplatBuf->getData(), scene_rdl2::fb_util::RenderColor(scene_rdl2::math::zero));
+        clearPixels(mSplatWeightBuf->getData(), 0.0f);
+    }
+
+    for (size_t b = 0; b < mAovBuf.size(); ++b) {
+        scene_rdl2::fb_util::VariablePixelBuffer &buf = mAovBuf[b];
+        // aov pixels are made of floats only
+        MNRY_ASSERT(buf.getSizeOfPixel() % sizeof(float) == 0);
+        const size_t numFloats = buf.getSizeOfPixel() / sizeof(float);
+        float *data = reinterpret_cast<float *>(buf.getData()) + pixOfs * numFloats;
+        std::fill(data, data + 64 * numFloats, mAovEntries[b].defaultValue());
+    }
+
+    if (mPixelInfoBuf) {
+        clearPixels(mPixelInfoBuf->getData(), scene_rdl2::fb_util::PixelInfo(FLT_MAX));
+    }
+
+    if (mHeatMapBuf) {
+        clearPixels(mHeatMapBuf->getData(), 0);
+    }
+
+    mTileWriteEpochs[tileIdx].store(mDirtyTileEpoch.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void
+Film::bindTilesToNumaNodes(const std::vector<scene_rdl2::fb_util::Tile> &tiles,
+                           const std::vector<unsigned> &tileNodes)
+{
+    MNRY_ASSERT(tiles.size() == tileNodes.size());
+
+    // Node of each tile of the tiled buffers, in memory order. Every tile is 64
+    // contiguous pixels, see clearTile().
+    constexpr unsigned noNode = ~0u;
+    std::vector<unsigned> tiledNodes(mTiler.mNumTiles, noNode);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        unsigned tx, ty;
+        mTiler.linearToTiledCoords(tiles[i].mMinX, tiles[i].mMinY, &tx, &ty);
+        const size_t tiledIdx = (static_cast<size_t>(ty) * mTiler.mAlignedW + tx) >> 6;
+        if (tiledIdx < tiledNodes.size()) {
+            tiledNodes[tiledIdx] = tileNodes[i];
+        }
+    }
+
+    // Runs of consecutive tiles on the same node, tiles nobody renders join the run before them.
+    struct Run { size_t mStartTile; size_t mEndTile; unsigned mNode; };
+    std::vector<Run> runs;
+    for (size_t t = 0; t < tiledNodes.size(); ++t) {
+        const unsigned node = tiledNodes[t];
+        if (!runs.empty() && (node == noNode || node == runs.back().mNode)) {
+            runs.back().mEndTile = t + 1;
+        } else if (node != noNode) {
+            runs.push_back({t, t + 1, node});
+        }
+    }
+
+    unsigned failedRuns = 0;
+    auto bindBuffer = [&](void *data, size_t sizeOfPixel) {
+        for (const Run &run : runs) {
+            uint8_t *start = static_cast<uint8_t *>(data) + (run.mStartTile << 6) * sizeOfPixel;
+            const size_t size = ((run.mEndTile - run.mStartTile) << 6) * sizeOfPixel;
+            if (!mcrt_common::numaBindMemory(start, size, run.mNode)) {
+                ++failedRuns;
+            }
+        }
+    };
+
+    bindBuffer(mRenderBuf.getData(), sizeof(scene_rdl2::fb_util::RenderColor));
+    bindBuffer(mWeightBuf.getData(), sizeof(float));
+    if (mRenderBufOdd) {
+        bindBuffer(mRenderBufOdd->getData(), sizeof(scene_rdl2::fb_util::RenderColor));
+    }
+    for (scene_rdl2::fb_util::VariablePixelBuffer &buf : mAovBuf) {
+        bindBuffer(buf.getData(), buf.getSizeOfPixel());
+    }
+
+    if (failedRuns) {
+        scene_rdl2::logging::Logger::warn("Film NUMA binding failed for ", failedRuns,
+                                          " buffer ranges, they stay on their current node");
+    }
+}
+
+void
+Film::adviseHugePages()
+{
+    const size_t numPixels = static_cast<size_t>(mTiler.mNumTiles) << 6;
+    auto adviseBuffer = [numPixels](void *data, size_t sizeOfPixel) {
+        mcrt_common::adviseHugePages(data, numPixels * sizeOfPixel);
+    };
+
+    adviseBuffer(mRenderBuf.getData(), sizeof(scene_rdl2::fb_util::RenderColor));
+    adviseBuffer(mWeightBuf.getData(), sizeof(float));
+    if (mRenderBufOdd) {
+        adviseBuffer(mRenderBufOdd->getData(), sizeof(scene_rdl2::fb_util::RenderColor));
+    }
+    for (scene_rdl2::fb_util::VariablePixelBuffer &buf : mAovBuf) {
+        adviseBuffer(buf.getData(), buf.getSizeOfPixel());
+    }
 }
 
 void
@@ -561,6 +805,7 @@ Film::addSamplesToAovBuffer(unsigned px, unsigned py, float depth,
 {
     mTiler.linearToTiledCoords(px, py, &px, &py);
     addAovSamplesToBuffer(mAovBuf, mAovEntries, px, py, depth, accAovs);
+    markTileDirty(px, py);
 
     updateFilmActivity();
 }
@@ -672,6 +917,45 @@ Film::addAovSamplesToBufferSafe(std::vector<scene_rdl2::fb_util::VariablePixelBu
     }
 }
 
+void
+Film::addAovSamplesToBufferUnsafe(std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuf,
+                                  const std::vector<pbr::AovSchema::Entry> &aovEntries,
+                                  unsigned px, unsigned py, const float depth, const float *aovs)
+{
+    for (size_t b = 0; b < aovBuf.size(); ++b) {
+        scene_rdl2::fb_util::VariablePixelBuffer &buf = aovBuf[b];
+        const pbr::AovFilter &filter = aovEntries[b].filter();
+        const size_t numFloats = aovEntries[b].numChannels();
+
+        MNRY_ASSERT(filter != pbr::AOV_FILTER_CLOSEST ||
+                   buf.getFormat() == scene_rdl2::fb_util::VariablePixelBuffer::FLOAT4);
+
+        switch (buf.getFormat()) {
+        case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT:
+            MNRY_ASSERT(numFloats == 1);
+            mathFilter(&buf.getFloatBuffer().getPixel(px, py), aovs, numFloats, depth, filter);
+            break;
+        case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT2:
+            MNRY_ASSERT(numFloats == 2);
+            mathFilter(&buf.getFloat2Buffer().getPixel(px, py).x, aovs, numFloats, depth, filter);
+            break;
+        case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT3:
+            MNRY_ASSERT(numFloats == 3);
+            mathFilter(&buf.getFloat3Buffer().getPixel(px, py).x, aovs, numFloats, depth, filter);
+            break;
+        case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT4:
+            MNRY_ASSERT(numFloats == 1 || numFloats == 2 || numFloats == 3);
+            mathFilter(&buf.getFloat4Buffer().getPixel(px, py).x, aovs, numFloats, depth, filter);
+            break;
+        default:
+            MNRY_ASSERT(0 && "unexpected aov buffer format");
+        }
+
+        // onto the next aov
+        aovs += numFloats;
+    }
+}
+
 void
 Film::addTileSamplesToDisplayFilterBuffer(unsigned bufferIdx,
                                           unsigned startX, unsigned startY,
@@ -750,6 +1034,109 @@ Film::addSamplesToRenderBuffer(unsigned px, unsigned py,
         util::atomicAdd(&renderColorOdd.z, accSamplesOdd->z);
         util::atomicAdd(&renderColorOdd.w, accSamplesOdd->w);
     }
+    markTileDirty(px, py);
+
+    updateFilmActivity();
+}
+
+void
+Film::addSamplesToTileAccumulator(TileAccumulator &acc,
+                                  unsigned px, unsigned py,
+                                  const scene_rdl2::fb_util::RenderColor &accSamples,
+                                  float numSamples,
+                                  const scene_rdl2::fb_util::RenderColor *accSamplesOdd,
+                                  float depth,
+                                  const float *accAovs)
+{
+    beginTileAccumulation(acc, px, py);
+
+    // A pixel can be visited more than once per tile, e.g. in realtime mode where the
+    // pixel fill order wraps around.
+    if (!acc.addSamples(px, py, accSamples, numSamples, accSamplesOdd, depth, accAovs)) {
+        addTileSamples(acc);
+        acc.begin(px, py);
+        MNRY_VERIFY(acc.addSamples(px, py, accSamples, numSamples, accSamplesOdd, depth, accAovs));
+    }
+}
+
+void
+Film::beginTileAccumulation(TileAccumulator &acc, unsigned px, unsigned py)
+{
+    if (!acc.isEmpty() && (acc.getMinX() != (px & ~0x07u) || acc.getMinY() != (py & ~0x07u))) {
+        addTileSamples(acc);
+    }
+    if (acc.isEmpty()) {
+        acc.begin(px, py);
+    }
+}
+
+void
+Film::addTileSamples(TileAccumulator &acc)
+{
+    if (acc.isEmpty()) {
+        return;
+    }
+
+    {
+        // The same tile may be rendered by several threads at once, so the adds are done
+        // under the tile's lock instead of with one atomic per float.
+        tbb::spin_mutex::scoped_lock lock(mTileMutex.getMutex(acc.getMinX() >> 3, acc.getMinY() >> 3));
+
+        for (uint64_t mask = acc.getPixelMask(); mask; mask &= mask - 1) {
+            const unsigned idx = __builtin_ctzll(mask);
+            unsigned px = acc.getMinX() + (idx & 7);
+            unsigned py = acc.getMinY() + (idx >> 3);
+            mTiler.linearToTiledCoords(px, py, &px, &py);
+
+            mRenderBuf.getPixel(px, py) += acc.getColor(idx);
+            mWeightBuf.getPixel(px, py) += acc.getWeight(idx);
+            if (mRenderBufOdd) {
+                mRenderBufOdd->getPixel(px, py) += acc.getColorOdd(idx);
+            }
+            if (const float *aovs = acc.getAovs(idx)) {
+                addAovSamplesToBufferUnsafe(mAovBuf, mAovEntries, px, py, acc.getDepth(idx), aovs);
+            }
+        }
+    }
+    {
+        unsigned px, py;
+        mTiler.linearToTiledCoords(acc.getMinX(), acc.getMinY(), &px, &py);
+        markTileDirty(px, py);
+    }
+
+    if (acc.hasSplats() && mSplatBuf) {
+        // The splat block overlaps the neighboring tiles by the guard band, each tile
+        // is added under its own lock.
+        const int guardBand = int(acc.getGuardBand());
+        const int width = int(TileAccumulator::getSplatWidth(acc.getGuardBand()));
+        const int blockMinX = int(acc.getMinX()) - guardBand;
+        const int blockMinY = int(acc.getMinY()) - guardBand;
+        const int minX = std::max(blockMinX, 0);
+        const int minY = std::max(blockMinY, 0);
+        const int maxX = std::min(blockMinX + width, int(mTiler.mAlignedW));
+        const int maxY = std::min(blockMinY + width, int(mTiler.mAlignedH));
+
+        for (int tileY = minY & ~0x07; tileY < maxY; tileY += 8) {
+            for (int tileX = minX & ~0x07; tileX < maxX; tileX += 8) {
+                tbb::spin_mutex::scoped_lock lock(mTileMutex.getMutex(tileX >> 3, tileY >> 3));
+
+                for (int y = std::max(tileY, minY); y < std::min(tileY + 8, maxY); ++y) {
+                    for (int x = std::max(tileX, minX); x < std::min(tileX + 8, maxX); ++x) {
+                        const unsigned idx = (y - blockMinY) * width + (x - blockMinX);
+                        const float weight = acc.getSplatWeight(idx);
+                        if (weight == 0.f) {
+                            continue;
+                        }
+                        unsigned tx, ty;
+                        mTiler.linearToTiledCoords(unsigned(x), unsigned(y), &tx, &ty);
+                        mSplatBuf->getPixel(tx, ty) += acc.getSplatColor(idx);
+                        mSplatWeightBuf->getPixel(tx, ty) += weight;
+                    }
+                }
+            }
+        }
+    }
+    acc.clear();
 
     updateFilmActivity();
 }
@@ -758,6 +1145,12 @@ void
 Film::normalizeRenderBuffer(const scene_rdl2::fb_util::RenderBuffer *srcRenderBuffer,
                             scene_rdl2::fb_util::RenderBuffer *dstRenderBuffer, bool parallel) const
 {
+    const scene_rdl2::fb_util::FloatBuffer *weightBuffer = &mWeightBuf;
+    if (mSplatBuf && srcRenderBuffer == &mRenderBuf) {
+        srcRenderBuffer = mSplatBuf.get();
+        weightBuffer = mSplatWeightBuf.get();
+    }
+
     const unsigned w = std::min(dstRenderBuffer->getWidth(), srcRenderBuffer->getWidth());
     const unsigned h = std::min(dstRenderBuffer->getHeight(), srcRenderBuffer->getHeight());
 
@@ -767,7 +1160,7 @@ Film::normalizeRenderBuffer(const scene_rdl2::fb_util::RenderBuffer *srcRenderBu
             // don't alias each so it's free to generate code with that assumption.
             scene_rdl2::fb_util::RenderColor *__restrict dstRow = dstRenderBuffer->getRow(y);
             const scene_rdl2::fb_util::RenderColor *__restrict srcColor = srcRenderBuffer->getRow(y);
-            const float *__restrict srcWeight = mWeightBuf.getRow(y);
+            const float *__restrict srcWeight = weightBuffer->getRow(y);
 
             for (unsigned x = 0; x < w; ++x) {
 
@@ -804,10 +1197,31 @@ Film::extrapolateRenderBufferFastPath(const scene_rdl2::fb_util::RenderBuffer *s
             const scene_rdl2::fb_util::RenderColor *__restrict srcColor = srcRenderBuffer->getData() + (i << 6);
             const float *__restrict srcWeight = mWeightBuf.getData() + (i << 6);
 
-            extrapolatePartialTileV2(dst, srcColor, srcWeight, 0, 8, 0, 8, mTileExtrapolation);
+            extrapolateFullTile(dst, srcColor, srcWeight, mTileExtrapolation,
+                                mFillLevelMasks, mFillLevelPixIds);
         });
 }
 
+void
+Film::initFillLevelPixIds()
+{
+    MNRY_ASSERT(mTileExtrapolation);
+
+    // Fill level n has the first n pixels of gPixelFillOrder active.
+    uint64_t mask = (uint64_t)0x0;
+    for (unsigned level = 0; level <= 64; ++level) {
+        if (level > 0) {
+            mask |= (uint64_t)0x1 << gPixelFillOrder[level - 1];
+        }
+        int pixIds[64];
+        mTileExtrapolation->searchActiveNearestPixel(mask, pixIds, 0, 8, 0, 8);
+        mFillLevelMasks[level] = mask;
+        for (unsigned i = 0; i < 64; ++i) {
+            mFillLevelPixIds[level][i] = static_cast<uint8_t>(pixIds[i]);
+        }
+    }
+}
+
 void
 Film::extrapolateRenderBufferWithViewport(const scene_rdl2::fb_util::RenderBuffer *srcRenderBuffer,
                                           scene_rdl2::fb_util::RenderBuffer *dstRenderBuffer,
@@ -897,6 +1311,38 @@ Film::extrapolateRenderBufferWithTileList(const scene_rdl2::fb_util::RenderBuffe
     });
 }
 
+bool
+Film::isTileEmpty(const scene_rdl2::fb_util::Tile &tile, float minWeight) const
+{
+    const unsigned baseX = (tile.mMinX & ~0x07);
+    const unsigned baseY = (tile.mMinY & ~0x07);
+    const unsigned minX = tile.mMinX - baseX;
+    const unsigned maxX = tile.mMaxX - baseX;
+    const unsigned minY = tile.mMinY - baseY;
+    const unsigned maxY = tile.mMaxY - baseY;
+    MNRY_ASSERT(minX < maxX && minX < 8 && maxX <= 8);
+    MNRY_ASSERT(minY < maxY && minY < 8 && maxY <= 8);
+
+    const unsigned tileOfs = mTiler.linearCoordsToCoarseTileOffset(tile.mMinX, tile.mMinY);
+    MNRY_ASSERT((tileOfs & 63) == 0);
+
+    const scene_rdl2::fb_util::RenderColor *__restrict color = mRenderBuf.getData() + tileOfs;
+    const float *__restrict weight = mWeightBuf.getData() + tileOfs;
+
+    // Samples are accumulated as sums, so a zero sum of non-negative radiance
+    // and alpha means that every sample was zero.
+    for (unsigned y = minY; y < maxY; ++y) {
+        for (unsigned x = minX; x < maxX; ++x) {
+            const unsigned i = (y << 3) + x;
+            if (weight[i] < minWeight ||
+                color[i].x != 0.f || color[i].y != 0.f || color[i].z != 0.f || color[i].w != 0.f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 // static function
 void
 Film::constructPixelFillOrderTable(const unsigned nodeId, const unsigned nodeTotal)
@@ -1020,18 +1466,18 @@ Film::addSampleBundleHandlerHelper(mcrt_common::ThreadLocalState *tls,
                             // we only want to increment coverage, position, normal, and the normalization factor
                             // numFragSamples if we're dealing with the first sample for this path. We don't want 
                             // any data from the subsequent bounces except for the beauty (for GI)
-                            film.mCryptomatteBuf->addSampleVector(px, py, id, 1.f, position, normal, beauty,
+                            film.mCryptomatteBuf->addSampleVector(pbrTls, px, py, id, 1.f, position, normal, beauty,
                                                                   refP, p0, refN, uv, depth);
                             cryptomatteData->mIsFirstSample = 0;
                         } else {
-                            film.mCryptomatteBuf->addBeautySampleVector(px, py, id, beauty, depth);
+                            film.mCryptomatteBuf->addBeautySampleVector(pbrTls, px, py, id, beauty, depth);
                         }
                     } else if (cryptomatteData->mPresenceDepth >= 0 && cryptomatteData->mPathPixelWeight > 0.01f) {
                         // We divide by pathPixelWeight to compute Cryptomatte beauty.  This can cause fireflies if
                         // the value is small, so we clamp at 0.01.
                         beauty.a = 0.f;
                         // presence path: only add beauty -- the rest of the data is populated in the shadeBundleHandler 
-                        film.mCryptomatteBuf->addBeautySampleVector(px, py, id, beauty, depth);
+                        film.mCryptomatteBuf->addBeautySampleVector(pbrTls, px, py, id, beauty, depth);
                     }
                 }
                 pbrTls->releaseCryptomatteData(br->mCryptomatteDataHandle);
@@ -1078,6 +1524,7 @@ Film::addSampleBundleHandlerHelper(mcrt_common::ThreadLocalState *tls,
             }
         }
         film.addBeautyAndAlphaSamplesToBuffer(px, py, *dstColor);
+        film.markTileDirty(px, py);
 
         MNRY_ASSERT(entriesRemaining >= numLocalSamples);
         entriesRemaining -= numLocalSamples;
@@ -1214,6 +1661,7 @@ Film::addAovSampleBundleHandler(mcrt_common::ThreadLocalState *tls,
                 MNRY_ASSERT(0 && "unexpected aov buffer format");
             }
         }
+        film->markTileDirty(px, py);
 
         MNRY_ASSERT(entriesRemaining >= numLocalSamples);
         entriesRemaining -= numLocalSamples;
@@ -1351,6 +1799,7 @@ Film::addFilteredAovSampleBundleHandler(mcrt_common::ThreadLocalState *tls,
         // Update aov buffer
         film->mTiler.linearToTiledCoords(px, py, &px, &py);
         film->addAovSamplesToBufferSafe(film->mAovBuf, film->mAovEntries, px, py, localDepths, localAovs);
+        film->markTileDirty(px, py);
 
         MNRY_ASSERT(entriesRemaining >= numLocalSamples);
         entriesRemaining -= numLocalSamples;
@@ -1405,6 +1854,7 @@ Film::addHeatMapBundleHandler(mcrt_common::ThreadLocalState *tls,
             // need to.
             film->mTiler.linearToTiledCoords(px, py, &px, &py);
             util::atomicAdd(&film->mHeatMapBuf->getPixel(px, py), ticks);
+            film->markTileDirty(px, py);
         }
 
         MNRY_ASSERT(entriesRemaining >= numLocalSamples);
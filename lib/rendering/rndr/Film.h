@@ -11,6 +11,7 @@
 #pragma once
 #include "DebugSamplesRecArray.h"
 #include "SampleIdBuff.h"
+#include "TileAccumulator.h"
 #include "Util.h"
 #include "adaptive/ActivePixelMask.h"
 #include "adaptive/AdaptiveRegions.h"
@@ -29,6 +30,8 @@
 #include <scene_rdl2/common/fb_util/Tiler.h>
 #include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
 #include <scene_rdl2/render/util/MiscUtils.h>
+
+#include <tbb/spin_mutex.h>
 #include <vector>
 
 namespace scene_rdl2 {
@@ -65,6 +68,7 @@ public:
         RESUMABLE_OUTPUT            = 0x0020,
         VECTORIZED_CPU              = 0x0040,
         VECTORIZED_XPU              = 0x0080,
+        SPLAT_PIXEL_FILTER          = 0x0100,
     };
 
     Film();
@@ -91,7 +95,27 @@ public:
     void cleanUp();
 
     void clearAllBuffers();
+
+    // Clears all the tiled buffers of a single tile back to their initial values. Deep and
+    // cryptomatte buffers are not tiled and are left as is.
+    void clearTile(unsigned tileIdx);
+
+    // Moves the pages of the render, weight and aov buffers which hold the given tiles
+    // onto the NUMA node tileNodes[i] of tile i, see RenderOptions::setNumaAware().
+    // Pages shared by tiles of different nodes stay where they are.
+    void bindTilesToNumaNodes(const std::vector<scene_rdl2::fb_util::Tile> &tiles,
+                              const std::vector<unsigned> &tileNodes);
+
+    // Asks for transparent huge pages on the render, weight and aov buffers, see
+    // RenderOptions::setHugePageMode(). Buffers smaller than a huge page are skipped.
+    void adviseHugePages();
+
     void initAdaptiveRegions(const scene_rdl2::math::Viewport &viewport, float targetAdativeError, bool vectorized);
+    void setAdaptiveErrorMetric(AdaptiveErrorMetricType type) { mAdaptiveRegions.setErrorMetric(type); }
+    void setAdaptiveFocus(float x, float y, float radius)
+    {
+        mAdaptiveRegions.setFocus(scene_rdl2::math::Vec2f(x, y), radius);
+    }
 
     //
     // General const query APIs:
@@ -114,6 +138,18 @@ public:
     void updateFilmActivity()                   { mFilmActivity.fetch_add(1u, std::memory_order_release); }
     void updatePixelInfoBufferActivity()        { mPixelInfoBufActivity.fetch_add(1u, std::memory_order_release); }
 
+    // Dirty tiles for the snapshots of the progressive frames. Every tile records the
+    // epoch of its last write, every snapshot starts a new epoch, so a snapshot of a
+    // buffer only has to look at the tiles written since the previous snapshot of that
+    // buffer. Writes are marked after the pixels are written, and a snapshot which
+    // started in epoch E looks again at the tiles of epoch E the next time, so a write
+    // racing with a snapshot is never missed. Epoch 0 means everything is dirty.
+    uint32_t beginDirtyTileSnapshot() const { return mDirtyTileEpoch.fetch_add(1u, std::memory_order_acq_rel); }
+    inline bool isTileDirtySince(unsigned tileIdx, uint32_t epoch) const;
+    inline void markTileDirty(unsigned tiledPx, unsigned tiledPy); // tiled coordinates
+    inline void markPixelDirty(unsigned px, unsigned py);
+    void markAllTilesDirty();
+
     // This is only approximated since it's derived from the accumulated weight.
     // It should be exact for non-bundled rendering but only an approximation
     // for bundled rendering.
@@ -146,6 +182,26 @@ public:
     // This adds aovs to the Aov Buffers.
     void addSamplesToAovBuffer(unsigned px, unsigned py, float depth, const float *accAovs);
 
+    // Thread owned alternative to addSamplesToRenderBuffer() and addSamplesToAovBuffer()
+    // for scalar uniform sampling, see TileAccumulator. The samples are gathered in acc,
+    // which is added to the film buffers first if it belongs to another tile or already
+    // holds samples for this pixel. accAovs may be nullptr if there are no aovs.
+    void addSamplesToTileAccumulator(TileAccumulator &acc,
+                                     unsigned px, unsigned py,
+                                     const scene_rdl2::fb_util::RenderColor &accSamples,
+                                     float numSamples,
+                                     const scene_rdl2::fb_util::RenderColor *accSamplesOdd,
+                                     float depth,
+                                     const float *accAovs);
+
+    // Makes acc gather the tile containing pixel (px, py), adding what it holds for
+    // another tile to the film buffers first.
+    void beginTileAccumulation(TileAccumulator &acc, unsigned px, unsigned py);
+
+    // Adds all the samples gathered in acc to the film buffers and clears it.
+    // Thread-safe against other callers of addTileSamples().
+    void addTileSamples(TileAccumulator &acc);
+
     void addTileSamplesToDisplayFilterBuffer(unsigned bufferIdx,
                                              unsigned startX, unsigned startY,
                                              unsigned length,
@@ -171,11 +227,19 @@ private:
                                           const std::vector<pbr::AovSchema::Entry> &aovEntries,
                                           unsigned px, unsigned py, const float *depths, const float *aovs);
 
+    // Same as addAovSamplesToBuffer but without atomics, the caller has to own the pixel.
+    static void addAovSamplesToBufferUnsafe(std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuf,
+                                            const std::vector<pbr::AovSchema::Entry> &aovEntries,
+                                            unsigned px, unsigned py, const float depth, const float *aovs);
+
     static void addTileSamplesToDisplayFilterBuffer(scene_rdl2::fb_util::VariablePixelBuffer &buf,
                                                     unsigned px, unsigned py,
                                                     unsigned length,
                                                     const uint8_t *values);
 
+    // Precomputes mFillLevelMasks and mFillLevelPixIds from mTileExtrapolation.
+    void initFillLevelPixIds();
+
 public:
     void addBeautyAndAlphaSamplesToBuffer(unsigned px, unsigned py, const scene_rdl2::fb_util::RenderColor& color);
 
@@ -210,6 +274,10 @@ public:
     scene_rdl2::fb_util::FloatBuffer       &getWeightBuffer()       { return mWeightBuf; }
     const scene_rdl2::fb_util::FloatBuffer &getWeightBuffer() const { return mWeightBuf; }
 
+    // Only allocated with SPLAT_PIXEL_FILTER.
+    const scene_rdl2::fb_util::RenderBuffer *getSplatBuffer() const { return mSplatBuf.get(); }
+    const scene_rdl2::fb_util::FloatBuffer *getSplatWeightBuffer() const { return mSplatWeightBuf.get(); }
+
     pbr::DeepBuffer       *getDeepBuffer()       { return mDeepBuf; }
     const pbr::DeepBuffer *getDeepBuffer() const { return mDeepBuf; }
 
@@ -243,7 +311,14 @@ public:
     SampleIdBuff       &getCurrSampleIdBuff()       { return mCurrSampleId; }
     const SampleIdBuff &getCurrSampleIdBuff() const { return mCurrSampleId; }
 
-    // Normalizes pixel data using the corresponding existing weight.
+    // Returns true if every pixel of the tile has a weight of at least minWeight
+    // and all of its samples so far were black with zero alpha. Reads the buffers
+    // without locking, so it is only conclusive for pixels which are not being
+    // rendered at the same time.
+    bool isTileEmpty(const scene_rdl2::fb_util::Tile &tile, float minWeight) const;
+
+    // Normalizes pixel data using the corresponding existing weight. The render buffer
+    // is normalized from the splat buffers instead when they exist.
     void normalizeRenderBuffer(const scene_rdl2::fb_util::RenderBuffer *srcRenderBuffer,
                                scene_rdl2::fb_util::RenderBuffer *dstRenderBuffer, bool parallel) const;
 
@@ -316,6 +391,8 @@ public:
     bool isAdaptive() const { return mUseAdaptiveSampling; }
 
     ActivePixelMask getAdaptiveSampleArea(const scene_rdl2::fb_util::Tile& tile, mcrt_common::ThreadLocalState* tls) const;
+    // Adaptive error over target error of the unconverged pixels of the tile, see AdaptiveRegions::getErrorRatio().
+    float getAdaptiveErrorRatio(const scene_rdl2::fb_util::Tile& tile) const;
     void updateAdaptiveError(const scene_rdl2::fb_util::Tile& tile,
                              const scene_rdl2::fb_util::RenderBuffer& renderBuf,
                              const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
@@ -331,6 +408,7 @@ public:
 
     AdaptiveRenderTilesTable *getAdaptiveRenderTilesTable() { return mAdaptiveRenderTilesTable.get(); }
     const AdaptiveRenderTilesTable *getAdaptiveRenderTilesTable() const { return mAdaptiveRenderTilesTable.get(); }
+    const AdaptiveRegions &getAdaptiveRegions() const { return mAdaptiveRegions; }
 
     // This reports the progress fraction value which inherently takes into
     // account any adaptive sampling settings.
@@ -347,6 +425,10 @@ public:
 protected:
     alignas(CACHE_LINE_SIZE) std::atomic<unsigned>   mFilmActivity;
     alignas(CACHE_LINE_SIZE) std::atomic<unsigned>   mPixelInfoBufActivity;
+    alignas(CACHE_LINE_SIZE) mutable std::atomic<uint32_t> mDirtyTileEpoch;
+
+    // Epoch of the last write of every tile, see beginDirtyTileSnapshot().
+    std::unique_ptr<std::atomic<uint32_t>[]> mTileWriteEpochs;
 
     // 4th channel contains accumulated alpha value for pixel.
     scene_rdl2::fb_util::RenderBuffer mRenderBuf;
@@ -361,6 +443,13 @@ protected:
     bool mUseAdaptiveSampling;
     scene_rdl2::fb_util::RenderBuffer *mRenderBufOdd;
 
+    // Pixel filtered beauty, each sample weighted by the pixel filter in every pixel of
+    // its footprint, and the sum of those weights. mRenderBuf and mWeightBuf still hold
+    // the samples of each pixel, the sample counts and the adaptive and checkpoint logic
+    // rely on them.
+    std::unique_ptr<scene_rdl2::fb_util::RenderBuffer> mSplatBuf;
+    std::unique_ptr<scene_rdl2::fb_util::FloatBuffer> mSplatWeightBuf;
+
     // Optional, contains deep samples.  Does not currently support multi-camera.
     pbr::DeepBuffer *mDeepBuf;
 
@@ -400,12 +489,20 @@ protected:
     // tile extrapolation main logic for vectorized mode
     const scene_rdl2::fb_util::TileExtrapolation *mTileExtrapolation;
 
+    // Nearest active pixels of a full tile at each fill level of
+    // gPixelFillOrder (n = number of pixels rendered), see initFillLevelPixIds().
+    uint64_t mFillLevelMasks[65];
+    uint8_t mFillLevelPixIds[65][64];
+
     // tile render information for adaptive sampling mode
     std::unique_ptr<AdaptiveRenderTilesTable> mAdaptiveRenderTilesTable;
 
     // Creates a pools of 2^7 mutexes. Only needed for vector mode.
     MutexPool2D<7> mStatsMutex;
 
+    // Guards the pixels of a tile while a TileAccumulator is added, indexed by tile coordinates.
+    MutexPool2D<7, tbb::spin_mutex> mTileMutex;
+
     AdaptiveRegions mAdaptiveRegions;
 
     // In order to track Film is already resumed from file or not.
@@ -452,10 +549,38 @@ Film::setPixelInfo(unsigned px, unsigned py, const scene_rdl2::fb_util::PixelInf
     mTiler.linearToTiledCoords(px, py, &px, &py);
 
     mPixelInfoBuf->setPixel(px, py, data);
+    markTileDirty(px, py);
 
     updatePixelInfoBufferActivity();
 }
 
+inline bool
+Film::isTileDirtySince(unsigned tileIdx, uint32_t epoch) const
+{
+    MNRY_ASSERT(tileIdx < mTiler.mNumTiles);
+    return !epoch ||
+        static_cast<int32_t>(mTileWriteEpochs[tileIdx].load(std::memory_order_acquire) - epoch) >= 0;
+}
+
+inline void
+Film::markTileDirty(unsigned tiledPx, unsigned tiledPy)
+{
+    // Every tile is 64 contiguous pixels in the tiled buffers.
+    std::atomic<uint32_t> &tileEpoch = mTileWriteEpochs[(tiledPy * mTiler.mAlignedW + tiledPx) >> 6];
+    const uint32_t epoch = mDirtyTileEpoch.load(std::memory_order_acquire);
+    // Most writes find their tile already marked, which only costs a load.
+    if (tileEpoch.load(std::memory_order_relaxed) != epoch) {
+        tileEpoch.store(epoch, std::memory_order_release);
+    }
+}
+
+inline void
+Film::markPixelDirty(unsigned px, unsigned py)
+{
+    mTiler.linearToTiledCoords(px, py, &px, &py);
+    markTileDirty(px, py);
+}
+
 inline float
 Film::getWeight(unsigned px, unsigned py) const
 {
@@ -504,6 +629,15 @@ Film::getAdaptiveSampleArea(const scene_rdl2::fb_util::Tile& tile, mcrt_common::
     return mAdaptiveRegions.getSampleArea(bounds, tls);
 }
 
+inline float
+Film::getAdaptiveErrorRatio(const scene_rdl2::fb_util::Tile& tile) const
+{
+    const scene_rdl2::math::BBox2i bounds(
+        scene_rdl2::math::Vec2i(tile.mMinX, tile.mMinY),
+        scene_rdl2::math::Vec2i(tile.mMaxX, tile.mMaxY));
+    return mAdaptiveRegions.getErrorRatio(bounds);
+}
+
 //-------------------------------------------------------------------------------------------------------------
 
 // General purpose extrapolation functions. Can be used to extrapolate any
@@ -0,0 +1,253 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "FilmReprojection.h"
+#include "Film.h"
+#include "Util.h"
+
+#include <moonray/rendering/mcrt_common/Ray.h>
+#include <moonray/rendering/pbr/camera/Camera.h>
+#include <moonray/rendering/pbr/camera/ProjectiveCamera.h>
+
+#include <scene_rdl2/common/math/Math.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace moonray {
+namespace rndr {
+
+using namespace scene_rdl2::math;
+
+void
+FilmReprojection::clear()
+{
+    mWidth = mHeight = 0;
+    mSamples.clear();
+    mSamples.shrink_to_fit();
+    dropPrior();
+}
+
+bool
+FilmReprojection::capture(const Film &film, const pbr::Camera &camera, bool parallel)
+{
+    const scene_rdl2::fb_util::PixelInfoBuffer *pixelInfoBuf = film.getPixelInfoBuffer();
+    if (!pixelInfoBuf) {
+        clear();
+        return false;
+    }
+
+    const scene_rdl2::fb_util::Tiler &tiler = film.getTiler();
+    const unsigned w = film.getWidth();
+    const unsigned h = film.getHeight();
+    const scene_rdl2::fb_util::PixelInfo *pixelInfos = pixelInfoBuf->getData();
+    const scene_rdl2::fb_util::RenderColor *colors = film.getRenderBuffer().getData();
+    const float *weights = film.getWeightBuffer().getData();
+    const Mat4f &render2Camera = camera.getRender2Camera();
+    // Pixels which missed the scene have the far plane depth, FLT_MAX if they weren't rendered.
+    const float far = camera.getFar();
+
+    auto getDepth = [&](unsigned x, unsigned y) {
+        return pixelInfos[tiler.linearCoordsToTiledOffset(x, y)].depth;
+    };
+
+    std::vector<std::vector<Sample>> rows(h);
+    simpleLoop(parallel, 0u, h, [&](unsigned y) {
+        std::vector<Sample> &row = rows[y];
+        for (unsigned x = 0; x < w; ++x) {
+            const size_t ofs = tiler.linearCoordsToTiledOffset(x, y);
+            const float weight = weights[ofs];
+            const float depth = pixelInfos[ofs].depth;
+            if (weight <= 0.0f || depth >= far) {
+                continue;
+            }
+
+            // Skip the silhouettes, their color mixes the surfaces on either side.
+            const float maxDelta = sMaxDepthDiscontinuity * depth;
+            if ((x > 0     && abs(getDepth(x - 1, y) - depth) > maxDelta) ||
+                (x + 1 < w && abs(getDepth(x + 1, y) - depth) > maxDelta) ||
+                (y > 0     && abs(getDepth(x, y - 1) - depth) > maxDelta) ||
+                (y + 1 < h && abs(getDepth(x, y + 1) - depth) > maxDelta)) {
+                continue;
+            }
+
+            // The pixel info depth is the camera space depth of the hit of the pixel center ray,
+            // see pbr::computeOpenGLDepth().
+            mcrt_common::RayDifferential ray;
+            camera.createRay(&ray, x + 0.5f, y + 0.5f, 0.5f, 0.5f, 0.5f, false);
+            const Vec3f org = transformPoint(render2Camera, ray.getOrigin());
+            const Vec3f dir = transformVector(render2Camera, ray.getDirection());
+            if (abs(dir.z) < 1.0e-6f) {
+                continue;
+            }
+            const float t = (-depth - org.z) / dir.z;
+            if (!(t > 0.0f)) {
+                continue;
+            }
+
+            row.push_back(Sample{org + dir * t, colors[ofs] / weight, weight});
+        }
+    });
+
+    size_t numSamples = 0;
+    for (const std::vector<Sample> &row : rows) {
+        numSamples += row.size();
+    }
+    std::vector<Sample> samples;
+    samples.reserve(numSamples);
+    for (const std::vector<Sample> &row : rows) {
+        samples.insert(samples.end(), row.begin(), row.end());
+    }
+
+    capture(w, h, std::move(samples), camera.getCamera2World());
+    return true;
+}
+
+void
+FilmReprojection::capture(unsigned width, unsigned height, std::vector<Sample> &&samples,
+                          const Mat4d &camera2World)
+{
+    mWidth = width;
+    mHeight = height;
+    mSamples = std::move(samples);
+    mCamera2World = camera2World;
+}
+
+bool
+FilmReprojection::reproject(const Film &film, const pbr::Camera &camera, float maxPriorWeight, bool parallel)
+{
+    const pbr::ProjectiveCamera *projectiveCamera = dynamic_cast<const pbr::ProjectiveCamera *>(&camera);
+    if (!projectiveCamera) {
+        dropPrior();
+        return false;
+    }
+
+    // Raster space covers the aperture window, the film pixels the region window.
+    const Mat4f camera2Raster = projectiveCamera->computeCamera2Raster(0.0f) *
+                                Mat4f::translate(Vec4f(-camera.getRegionToApertureOffsetX(),
+                                                       -camera.getRegionToApertureOffsetY(), 0.0f, 0.0f));
+    return reproject(film.getTiler(), camera.getWorld2Camera(), camera2Raster, maxPriorWeight, parallel);
+}
+
+bool
+FilmReprojection::reproject(const scene_rdl2::fb_util::Tiler &tiler,
+                            const Mat4d &world2Camera,
+                            const Mat4f &camera2Raster,
+                            float maxPriorWeight,
+                            bool parallel)
+{
+    dropPrior();
+    if (mSamples.empty() || maxPriorWeight <= 0.0f ||
+        tiler.mOriginalW != mWidth || tiler.mOriginalH != mHeight) {
+        return false;
+    }
+
+    const Mat4f old2New = toFloat(mCamera2World * world2Camera);
+
+    // The closest sample landing on each pixel: the depth in the upper half, positive floats
+    // order like their bit patterns, and the sample index in the lower half.
+    constexpr uint64_t sEmpty = ~uint64_t(0);
+    const unsigned numPixels = tiler.mNumTiles << 6;
+    std::unique_ptr<std::atomic<uint64_t>[]> closest(new std::atomic<uint64_t>[numPixels]);
+    simpleLoop(parallel, 0u, numPixels, [&](unsigned ofs) {
+        closest[ofs].store(sEmpty, std::memory_order_relaxed);
+    });
+
+    simpleLoop(parallel, 0u, static_cast<unsigned>(mSamples.size()), [&](unsigned sampleIdx) {
+        const Vec3f p = transformPoint(old2New, mSamples[sampleIdx].mP);
+        if (!(p.z < 0.0f)) {
+            return; // behind the camera
+        }
+        const Vec3f raster = transformH(camera2Raster, p);
+        if (!(raster.x >= 0.0f && raster.y >= 0.0f &&
+              raster.x < static_cast<float>(mWidth) && raster.y < static_cast<float>(mHeight))) {
+            return;
+        }
+
+        const float depth = -p.z;
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        const uint64_t key = (uint64_t(depthBits) << 32) | sampleIdx;
+
+        std::atomic<uint64_t> &dst = closest[tiler.linearCoordsToTiledOffset(static_cast<unsigned>(raster.x),
+                                                                             static_cast<unsigned>(raster.y))];
+        uint64_t current = dst.load(std::memory_order_relaxed);
+        while (key < current && !dst.compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+    });
+
+    mPriorColor.init(tiler.mAlignedW, tiler.mAlignedH);
+    mPriorWeight.init(tiler.mAlignedW, tiler.mAlignedH);
+
+    std::atomic<size_t> numPriorPixels(0);
+    simpleLoop(parallel, 0u, tiler.mNumTiles, [&](unsigned tileIdx) {
+        size_t count = 0;
+        const unsigned start = tileIdx << 6;
+        for (unsigned ofs = start; ofs < start + 64; ++ofs) {
+            const uint64_t key = closest[ofs].load(std::memory_order_relaxed);
+            if (key == sEmpty) {
+                mPriorWeight.getData()[ofs] = 0.0f;
+                continue;
+            }
+            const Sample &sample = mSamples[key & 0xffffffffu];
+            mPriorColor.getData()[ofs] = sample.mColor;
+            mPriorWeight.getData()[ofs] = min(sample.mWeight, maxPriorWeight);
+            ++count;
+        }
+        numPriorPixels += count;
+    });
+
+    mNumPriorPixels = numPriorPixels;
+    mHasPrior = mNumPriorPixels > 0;
+    return mHasPrior;
+}
+
+void
+FilmReprojection::blendNormalized(const scene_rdl2::fb_util::FloatBuffer &weightBuf,
+                                  scene_rdl2::fb_util::RenderBuffer &normalizedBuf,
+                                  bool parallel) const
+{
+    if (!mHasPrior) {
+        return;
+    }
+    MNRY_ASSERT(weightBuf.getWidth() == mPriorWeight.getWidth() &&
+                weightBuf.getHeight() == mPriorWeight.getHeight());
+    MNRY_ASSERT(normalizedBuf.getWidth() == mPriorWeight.getWidth() &&
+                normalizedBuf.getHeight() == mPriorWeight.getHeight());
+
+    const unsigned numTiles = (mPriorWeight.getWidth() * mPriorWeight.getHeight()) >> 6;
+    simpleLoop(parallel, 0u, numTiles, [&](unsigned tileIdx) {
+        const unsigned start = tileIdx << 6;
+        for (unsigned ofs = start; ofs < start + 64; ++ofs) {
+            const float weight = weightBuf.getData()[ofs];
+            const float priorWeight = fadePriorWeight(mPriorWeight.getData()[ofs], weight);
+            if (priorWeight > 0.0f) {
+                scene_rdl2::fb_util::RenderColor &color = normalizedBuf.getData()[ofs];
+                color = (color * weight + mPriorColor.getData()[ofs] * priorWeight) / (weight + priorWeight);
+            }
+        }
+    });
+}
+
+void
+FilmReprojection::addToTile(unsigned tileIdx,
+                            const scene_rdl2::fb_util::RenderColor *srcColor, const float *srcWeight,
+                            scene_rdl2::fb_util::RenderColor *dstColor, float *dstWeight) const
+{
+    MNRY_ASSERT(mHasPrior);
+
+    const unsigned start = tileIdx << 6;
+    const scene_rdl2::fb_util::RenderColor *priorColor = mPriorColor.getData() + start;
+    const float *priorWeight = mPriorWeight.getData() + start;
+    for (unsigned i = 0; i < 64; ++i) {
+        const float weight = fadePriorWeight(priorWeight[i], srcWeight[i]);
+        dstColor[i] = srcColor[i] + priorColor[i] * weight;
+        dstWeight[i] = srcWeight[i] + weight;
+    }
+}
+
+} // namespace rndr
+} // namespace moonray
+
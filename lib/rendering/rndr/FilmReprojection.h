@@ -0,0 +1,128 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <scene_rdl2/common/fb_util/FbTypes.h>
+#include <scene_rdl2/common/fb_util/Tiler.h>
+#include <scene_rdl2/common/math/Mat4.h>
+#include <scene_rdl2/common/math/Vec3.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace moonray {
+
+namespace pbr { class Camera; }
+
+namespace rndr {
+
+class Film;
+
+class FilmReprojection
+//
+// Temporal reprojection of progressive renders.
+//
+// A camera move starts a new frame from an empty film, so the image falls back to
+// the extrapolated coarse passes. At the end of a frame, capture() keeps the
+// normalized color of every rendered pixel along with its camera space position,
+// which comes from the pixel info depth. At the start of the next frame,
+// reproject() forward warps those pixels into the view of the new camera. Where
+// several pixels land on the same target pixel the closest one wins, so the
+// surfaces the camera move uncovers (disocclusions) get no prior. The pixels on a
+// depth discontinuity are not captured, they blend foreground and background.
+//
+// The warped image is a prior, it never enters the film buffers: the snapshots
+// blend it with the samples of the new frame, weighted as up to maxPriorWeight
+// samples. The prior of a pixel fades out as the pixel receives samples and is
+// gone once it received sFadeSamples times its prior weight, so a converged
+// image is the same with or without reprojection.
+//
+// Not thread-safe. capture() and reproject() are called by the render driver
+// between frames, the blend functions only read.
+//
+{
+public:
+    // A captured pixel, positions in the camera space of the captured frame.
+    struct Sample
+    {
+        scene_rdl2::math::Vec3f mP;
+        scene_rdl2::fb_util::RenderColor mColor; // normalized
+        float mWeight;                            // samples the pixel received
+    };
+
+    static constexpr float sFadeSamples = 4.0f;
+
+    void clear();
+
+    // Captures the pixels of the film with a depth in the pixel info buffer, rendered
+    // with camera. Returns false and drops the capture if the film has no pixel info.
+    bool capture(const Film &film, const pbr::Camera &camera, bool parallel);
+    void capture(unsigned width, unsigned height, std::vector<Sample> &&samples,
+                 const scene_rdl2::math::Mat4d &camera2World);
+    bool hasCapture() const { return !mSamples.empty(); }
+
+    // Warps the capture into the view of camera. Returns false and drops the prior if
+    // there is no capture of the same resolution or camera isn't a projective camera.
+    // The capture is kept, it is replaced by the next capture() call.
+    bool reproject(const Film &film, const pbr::Camera &camera, float maxPriorWeight, bool parallel);
+    // camera2Raster maps the camera space of the new view to pixel coordinates
+    // (homogeneous, applied with transformH).
+    bool reproject(const scene_rdl2::fb_util::Tiler &tiler,
+                   const scene_rdl2::math::Mat4d &world2Camera,
+                   const scene_rdl2::math::Mat4f &camera2Raster,
+                   float maxPriorWeight, bool parallel);
+    bool hasPrior() const { return mHasPrior; }
+    void dropPrior()
+    {
+        mHasPrior = false;
+        mNumPriorPixels = 0;
+    }
+
+    // Weight of a prior worth priorWeight samples for a pixel which received weight.
+    static float fadePriorWeight(float priorWeight, float weight)
+    {
+        if (priorWeight <= 0.0f) {
+            return 0.0f;
+        }
+        const float fade = 1.0f - weight / (sFadeSamples * priorWeight);
+        return (fade > 0.0f) ? priorWeight * fade : 0.0f;
+    }
+
+    // Blends the prior into normalized colors tiled like the film, given the film
+    // weights. Pixels without samples take the prior as is.
+    void blendNormalized(const scene_rdl2::fb_util::FloatBuffer &weightBuf,
+                         scene_rdl2::fb_util::RenderBuffer &normalizedBuf,
+                         bool parallel) const;
+
+    // Adds the prior to the 64 pixels of tile tileIdx of the film color and weight
+    // (not normalized), for the delta snapshots.
+    void addToTile(unsigned tileIdx,
+                   const scene_rdl2::fb_util::RenderColor *srcColor, const float *srcWeight,
+                   scene_rdl2::fb_util::RenderColor *dstColor, float *dstWeight) const;
+
+    // Number of pixels which received a prior from the last reproject().
+    size_t getNumPriorPixels() const { return mNumPriorPixels; }
+
+    const scene_rdl2::fb_util::RenderBuffer &getPriorColorBuffer() const { return mPriorColor; }
+    const scene_rdl2::fb_util::FloatBuffer &getPriorWeightBuffer() const { return mPriorWeight; }
+
+private:
+    static constexpr float sMaxDepthDiscontinuity = 0.05f; // relative to the depth
+
+    unsigned mWidth {0};
+    unsigned mHeight {0};
+    std::vector<Sample> mSamples;
+    scene_rdl2::math::Mat4d mCamera2World;
+
+    bool mHasPrior {false};
+    size_t mNumPriorPixels {0};
+    scene_rdl2::fb_util::RenderBuffer mPriorColor; // tiled
+    scene_rdl2::fb_util::FloatBuffer mPriorWeight; // tiled, 0 : no prior
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -30,10 +30,14 @@ struct FrameState : public pbr::FrameState
     unsigned                mNumRenderThreads;
     bool                    mEnableMcrtCpuAffinity {true};
     std::shared_ptr<std::vector<unsigned>> mAffinityCpuIdTbl; // cpuId table for CPU-Affinity control
+    std::shared_ptr<std::vector<unsigned>> mNumaNodeTbl; // NUMA node per render thread, null : no NUMA placement
+    bool                    mHugePageFilm {false}; // advise transparent huge pages on the film buffers
+    bool                    mTlbStats {false}; // count the dTLB misses of the render threads
     unsigned                mNumRenderNodes;
     unsigned                mRenderNodeIdx;
     unsigned                mTileSchedulerType; // TileScheduler::Type
     unsigned                mTaskDistributionType; // Film::TaskDistribType
+    std::vector<float>      mRenderNodeWeights; // dynamic load balancing weights. empty : equal
 
     RenderMode              mRenderMode;
     FastRenderMode          mFastMode;
@@ -48,6 +52,20 @@ struct FrameState : public pbr::FrameState
     unsigned                mMinSamplesPerPixel;
     unsigned                mMaxSamplesPerPixel;
     float                   mTargetAdaptiveError;
+    AdaptiveErrorMetricType mAdaptiveErrorMetric;
+    float                   mAdaptiveStopGainPerMinute; // 0 : disabled
+    float                   mAdaptiveRouletteBoost {0.0f}; // <= 1 : disabled
+    unsigned                mUniformTileEarlyExitSamples; // 0 : disabled
+    bool                    mTileLocalAccumulation; // uniform sampling only
+    bool                    mDeterministic; // uniform sampling, scalar batch/progressive only
+    bool                    mPixelFilterSplat; // scalar tile local accumulation only
+
+    // Region of interest of progressive renders (pixel coordinates). Tiles close to the
+    // focus point are rendered first in every pass and adaptive sampling relaxes the target
+    // error away from it. mFocusRadius 0 : no focus
+    float                   mFocusX {0.0f};
+    float                   mFocusY {0.0f};
+    float                   mFocusRadius {0.0f};
 
     // This only exists for backward compatibility in the cases where a pixel
     // sample map contains values above 1. It would be nice to disallow that
@@ -65,6 +83,8 @@ struct FrameState : public pbr::FrameState
     float                   mDeepZTolerance;
     uint                    mDeepVolCompressionRes;
     std::vector<std::string> *mDeepIDChannelNames;
+    bool                    mStreamDeepOutput;
+    bool                    mStreamOutput;
 
     float mFps; // The desired frames per second for RENDER_MODE_PROGRESSIVE and RENDER_MODE_REALTIME modes.
 
@@ -81,10 +101,15 @@ struct FrameState : public pbr::FrameState
     CheckpointMode mCheckpointMode;
     unsigned mCheckpointStartSPP; // start pixel sample count for checkpoint dump
     bool mCheckpointBgWrite;
+    unsigned mCheckpointDeltaMax; // max delta checkpoints between full checkpoints, 0 = disable
+    bool mCheckpointEmergencyDump; // raw delta snapshot for the signal interruption
+    bool mCheckpointTileReuse; // save tile hash and reuse matching tiles of the resume file
 
     bool mTwoStageOutput;
 
     unsigned mDisplayFilterCount;
+    unsigned mDisplayFilterThreads; // dedicated display filter threads of progressive mode, 0 : render threads
+    float mTemporalReprojectionWeight; // max prior weight (samples) of the reprojected previous frame, 0 : off
 };
 
 #pragma warning(pop)
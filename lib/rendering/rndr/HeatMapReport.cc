@@ -0,0 +1,231 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "HeatMapReport.h"
+
+#include <moonray/rendering/mcrt_common/Clock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <ostream>
+#include <unordered_map>
+
+namespace moonray {
+namespace rndr {
+
+namespace {
+
+using TimeMap = std::unordered_map<std::string, double>;
+
+std::string
+idStr(float id)
+{
+    return std::isfinite(id) ? std::to_string(std::llround(id)) : std::string();
+}
+
+std::vector<HeatMapReport::Entry>
+sortedEntries(const TimeMap &times)
+{
+    std::vector<HeatMapReport::Entry> entries;
+    entries.reserve(times.size());
+    for (const auto &time : times) {
+        entries.push_back({time.first, time.second});
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const HeatMapReport::Entry &a, const HeatMapReport::Entry &b) {
+                  return (a.mSec != b.mSec) ? a.mSec > b.mSec : a.mName < b.mName;
+              });
+    return entries;
+}
+
+void
+writeJsonString(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void
+writeJsonEntries(std::ostream &out, const char *key, const std::vector<HeatMapReport::Entry> &entries,
+                 double totalSec)
+{
+    out << ",\n\"" << key << "\":[";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out << (i ? ",\n" : "\n") << "{\"name\":";
+        writeJsonString(out, entries[i].mName);
+        out << ",\"sec\":" << entries[i].mSec
+            << ",\"fraction\":" << ((totalSec > 0.0) ? entries[i].mSec / totalSec : 0.0) << '}';
+    }
+    out << "\n]";
+}
+
+} // namespace
+
+const char *HeatMapReport::sNone = "none";
+
+HeatMapReport::HeatMapReport(const PickFunc &pick, unsigned pickSamples, unsigned hotPixels) :
+    mPick(pick),
+    mPickSamples(std::max(pickSamples, 1u)),
+    mHotPixelCount(hotPixels),
+    mWidth(0),
+    mHeight(0),
+    mHasIds(false),
+    mTotalSec(0.0)
+{
+}
+
+bool
+HeatMapReport::build(const scene_rdl2::fb_util::HeatMapBuffer &heatMap,
+                     const scene_rdl2::fb_util::FloatBuffer *idBuffer)
+{
+    mWidth = static_cast<int>(heatMap.getWidth());
+    mHeight = static_cast<int>(heatMap.getHeight());
+    mHasIds = idBuffer && static_cast<int>(idBuffer->getWidth()) == mWidth &&
+              static_cast<int>(idBuffer->getHeight()) == mHeight;
+    mTotalSec = 0.0;
+    mGeometries.clear();
+    mMaterials.clear();
+    mIds.clear();
+    mHotPixels.clear();
+
+    const size_t pixelCount = static_cast<size_t>(mWidth) * static_cast<size_t>(mHeight);
+    if (pixelCount == 0) {
+        return false;
+    }
+
+    const int64_t *ticks = heatMap.getData();
+    const float *ids = mHasIds ? idBuffer->getData() : nullptr;
+
+    // The id join, every pixel gives its time to the id found there.
+    TimeMap idTimes;
+    int64_t totalTicks = 0;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        const int64_t t = std::max(ticks[i], int64_t(0));
+        totalTicks += t;
+        if (ids && t > 0) {
+            const std::string id = idStr(ids[i]);
+            idTimes[id.empty() ? sNone : id] += mcrt_common::Clock::seconds(t);
+        }
+    }
+    if (totalTicks == 0) {
+        return false;
+    }
+    mTotalSec = mcrt_common::Clock::seconds(totalTicks);
+    mIds = sortedEntries(idTimes);
+
+    auto pick = [&](size_t i, std::string &geometry, std::string &material) {
+        geometry.clear();
+        material.clear();
+        if (mPick) {
+            mPick(static_cast<int>(i % mWidth), static_cast<int>(i / mWidth), geometry, material);
+        }
+        if (geometry.empty()) geometry = sNone;
+        if (material.empty()) material = sNone;
+    };
+
+    // Systematic sampling of the pixels along their cumulative time: sample
+    // s lands in the pixel covering (s + 0.5) * step and stands for step
+    // seconds of render time.
+    TimeMap geometryTimes;
+    TimeMap materialTimes;
+    const double stepTicks = static_cast<double>(totalTicks) / mPickSamples;
+    const double stepSec = mTotalSec / mPickSamples;
+    size_t pixel = 0;
+    double pixelEnd = static_cast<double>(std::max(ticks[0], int64_t(0)));
+    size_t pickedPixel = pixelCount;
+    std::string geometry, material;
+    for (unsigned s = 0; s < mPickSamples; ++s) {
+        const double target = (s + 0.5) * stepTicks;
+        while (pixelEnd <= target && pixel + 1 < pixelCount) {
+            ++pixel;
+            pixelEnd += static_cast<double>(std::max(ticks[pixel], int64_t(0)));
+        }
+        if (pixel != pickedPixel) {
+            pick(pixel, geometry, material);
+            pickedPixel = pixel;
+        }
+        geometryTimes[geometry] += stepSec;
+        materialTimes[material] += stepSec;
+    }
+    mGeometries = sortedEntries(geometryTimes);
+    mMaterials = sortedEntries(materialTimes);
+
+    // The hottest pixels, picked on their own.
+    std::vector<size_t> order(pixelCount);
+    std::iota(order.begin(), order.end(), size_t(0));
+    const size_t hotCount = std::min(static_cast<size_t>(mHotPixelCount), pixelCount);
+    std::partial_sort(order.begin(), order.begin() + hotCount, order.end(),
+                      [&](size_t a, size_t b) { return (ticks[a] != ticks[b]) ? ticks[a] > ticks[b] : a < b; });
+    for (size_t h = 0; h < hotCount && ticks[order[h]] > 0; ++h) {
+        const size_t i = order[h];
+        HotPixel hot;
+        hot.mX = static_cast<int>(i % mWidth);
+        hot.mY = static_cast<int>(i / mWidth);
+        hot.mSec = mcrt_common::Clock::seconds(ticks[i]);
+        pick(i, hot.mGeometry, hot.mMaterial);
+        if (ids) {
+            hot.mId = idStr(ids[i]);
+        }
+        mHotPixels.push_back(std::move(hot));
+    }
+
+    return true;
+}
+
+void
+HeatMapReport::writeJson(std::ostream &out, const std::string &image) const
+{
+    out << "{\n\"image\":";
+    writeJsonString(out, image);
+    out << ",\n\"width\":" << mWidth << ",\"height\":" << mHeight
+        << ",\n\"totalSec\":" << mTotalSec
+        << ",\n\"pickSamples\":" << mPickSamples;
+
+    writeJsonEntries(out, "geometries", mGeometries, mTotalSec);
+    writeJsonEntries(out, "materials", mMaterials, mTotalSec);
+    if (mHasIds) {
+        writeJsonEntries(out, "ids", mIds, mTotalSec);
+    }
+
+    out << ",\n\"hotPixels\":[";
+    for (size_t i = 0; i < mHotPixels.size(); ++i) {
+        const HotPixel &hot = mHotPixels[i];
+        out << (i ? ",\n" : "\n") << "{\"x\":" << hot.mX << ",\"y\":" << hot.mY << ",\"sec\":" << hot.mSec
+            << ",\"geometry\":";
+        writeJsonString(out, hot.mGeometry);
+        out << ",\"material\":";
+        writeJsonString(out, hot.mMaterial);
+        if (!hot.mId.empty()) {
+            out << ",\"id\":" << hot.mId;
+        }
+        out << '}';
+    }
+    out << "\n]\n}\n";
+}
+
+bool
+HeatMapReport::writeJson(const std::string &filename, const std::string &image) const
+{
+    std::ofstream out(filename);
+    if (!out) {
+        return false;
+    }
+    writeJson(out, image);
+    return static_cast<bool>(out);
+}
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,102 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+//
+// -- Heat map cost report --
+//
+// Turns the per pixel time of the heat map into a ranking of what the render
+// time went to. The render time is attributed to the geometries and the
+// materials seen through the pixels: pick samples are spread over the image
+// in proportion to the time spent in each pixel (systematic sampling along
+// the cumulative pixel time), so each pick stands for an equal share of the
+// total time and the hot pixels get picked the most. Pixels hit by several
+// samples are only picked once.
+//
+// When an id buffer is given, typically a primitive attribute AOV holding a
+// primitive or material id with the closest filter, the time of every pixel
+// is also attributed to the id found in that pixel, no sampling involved.
+//
+// The report is written as JSON, next to the image for production tracking.
+//
+
+#include <scene_rdl2/common/fb_util/FbTypes.h>
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+
+class HeatMapReport
+{
+public:
+    // Names the geometry and the material seen through pixel (x, y) of the
+    // heat map, left empty when nothing is hit there.
+    using PickFunc = std::function<void(int x, int y, std::string &geometry, std::string &material)>;
+
+    struct Entry
+    {
+        std::string mName;
+        double mSec;
+    };
+
+    struct HotPixel
+    {
+        int mX;
+        int mY;
+        double mSec;
+        std::string mGeometry;
+        std::string mMaterial;
+        std::string mId; // empty without an id buffer or when the id isn't finite
+    };
+
+    static constexpr unsigned sDefaultPickSamples = 4096;
+    static constexpr unsigned sDefaultHotPixels = 32;
+
+    explicit HeatMapReport(const PickFunc &pick,
+                           unsigned pickSamples = sDefaultPickSamples,
+                           unsigned hotPixels = sDefaultHotPixels);
+
+    // heatMap is untiled, in clock ticks per pixel. idBuffer, untiled as well
+    // and of the same resolution, is optional. Returns false when the heat map
+    // is empty, i.e. the scene has no heat map RenderOutput.
+    bool build(const scene_rdl2::fb_util::HeatMapBuffer &heatMap,
+               const scene_rdl2::fb_util::FloatBuffer *idBuffer);
+
+    double getTotalSec() const { return mTotalSec; }
+
+    // Sorted by decreasing time. Time seen through no geometry or material is
+    // attributed to "none".
+    const std::vector<Entry> &getGeometries() const { return mGeometries; }
+    const std::vector<Entry> &getMaterials() const { return mMaterials; }
+    const std::vector<Entry> &getIds() const { return mIds; }
+    const std::vector<HotPixel> &getHotPixels() const { return mHotPixels; }
+
+    void writeJson(std::ostream &out, const std::string &image) const;
+    bool writeJson(const std::string &filename, const std::string &image) const;
+
+    static const char *sNone;
+
+private:
+    PickFunc mPick;
+    unsigned mPickSamples;
+    unsigned mHotPixelCount;
+
+    int mWidth;
+    int mHeight;
+    bool mHasIds;
+    double mTotalSec;
+    std::vector<Entry> mGeometries;
+    std::vector<Entry> mMaterials;
+    std::vector<Entry> mIds;
+    std::vector<HotPixel> mHotPixels;
+};
+
+} // namespace rndr
+} // namespace moonray
@@ -721,25 +721,28 @@ ImageWriteCache::getImgSpec(int id)
 }
 
 void
-ImageWriteCache::setupDeqBuff(const size_t fileId, const size_t subImgId)
+ImageWriteCache::getScanlineData(const size_t fileId, const size_t subImgId, const int y,
+                                 const void *&dataFull, const void *&dataHalf) const
 {
     const ImageWriteCacheBufferSpecSubImage &buffSpecSubImg =
         mBufferSpec.getBufferSpecFile(fileId).getBufferSpecSubImage(subImgId);
 
-    // Seeking to the data beginning address
-    for (int yBlockId = 0; yBlockId < mYBlockTotal; ++yBlockId) {
-        int yMin = yBlockId * mYBlockSize;
-        int yMax = yMin + mYBlockSize;
-        if (yMax > mHeight) yMax = mHeight;
-        int currBucketHeight = yMax - yMin;
-        int currBucketTotalPix = mWidth * currBucketHeight;
-
-        size_t yBlockFullOffset = currBucketTotalPix * buffSpecSubImg.getPixCacheFullOffset();
-        size_t yBlockHalfOffset = currBucketTotalPix * buffSpecSubImg.getPixCacheHalfOffset();
-
-        mCacheQueueFullBuffArray[yBlockId].mCDeq->seekSet(yBlockFullOffset);
-        mCacheQueueHalfBuffArray[yBlockId].mCDeq->seekSet(yBlockHalfOffset);
-    }
+    const int yBlockId = calcYBlockId(y);
+    int yMin = yBlockId * mYBlockSize;
+    int yMax = yMin + mYBlockSize;
+    if (yMax > mHeight) yMax = mHeight;
+    int currBucketHeight = yMax - yMin;
+    int currBucketTotalPix = mWidth * currBucketHeight;
+
+    // sub-images are stored one after another inside the yBlock and the pixels of a sub-image
+    // are stored in scanline order.
+    size_t fullOffset = currBucketTotalPix * buffSpecSubImg.getPixCacheFullOffset() +
+        static_cast<size_t>(y - yMin) * mWidth * buffSpecSubImg.getPixCacheFullSize();
+    size_t halfOffset = currBucketTotalPix * buffSpecSubImg.getPixCacheHalfOffset() +
+        static_cast<size_t>(y - yMin) * mWidth * buffSpecSubImg.getPixCacheHalfSize();
+
+    dataFull = static_cast<const void *>(mDataFullArray[yBlockId].data() + fullOffset);
+    dataHalf = static_cast<const void *>(mDataHalfArray[yBlockId].data() + halfOffset);
 }
 
 ImageWriteCache::ImageWriteCacheTmpFileItemShPtr
@@ -818,29 +821,39 @@ ImageWriteCache::outputDataFinalize()
         }
     }
 
-    //
-    // We have to consider two stage outputs and overwrite conditions.
-    // See comment of CheckpointController::fileOutputMain() for more detail.
-    //
-    mRenderOutputDriver->writeCheckpointDeq(this, false);
-    mRenderOutputDriver->loggingErrorAndInfo(this);
-
-    if (!mTwoStageOutput) {
-        if (!mCheckpointOverwrite) {
-            // non two stage mode multi version file output
-            mRenderOutputDriver->writeCheckpointDeq(this, true);
-            mRenderOutputDriver->loggingErrorAndInfo(this);
+    if (mFinalOutput) {
+        // Final output of a frame, the same as writeRenderOutputsWithMessages() but from the cache
+        mRenderOutputDriver->writeFinalDeq(this);
+        mFinalOutputResult = mRenderOutputDriver->loggingErrorAndInfo(this);
+        if (mTwoStageOutput && !allFinalizeFinalFile()) {
+            mFinalOutputResult = false;
         }
+
     } else {
-        // TwoStage output is on and data was written out to tmpFile.
-        allFinalizeCheckpointFile(); // copy and rename for checkpoint file
-        if (!mCheckpointOverwrite) {
-            // copy and rename for checkpoint multi version file
-            allFinalizeCheckpointMultiVersionFile();
+        //
+        // We have to consider two stage outputs and overwrite conditions.
+        // See comment of CheckpointController::fileOutputMain() for more detail.
+        //
+        mRenderOutputDriver->writeCheckpointDeq(this, false);
+        mRenderOutputDriver->loggingErrorAndInfo(this);
+
+        if (!mTwoStageOutput) {
+            if (!mCheckpointOverwrite) {
+                // non two stage mode multi version file output
+                mRenderOutputDriver->writeCheckpointDeq(this, true);
+                mRenderOutputDriver->loggingErrorAndInfo(this);
+            }
+        } else {
+            // TwoStage output is on and data was written out to tmpFile.
+            allFinalizeCheckpointFile(); // copy and rename for checkpoint file
+            if (!mCheckpointOverwrite) {
+                // copy and rename for checkpoint multi version file
+                allFinalizeCheckpointMultiVersionFile();
+            }
+        }
+        if (!mPostCheckpointScript.empty()) {
+            runPostCheckpointScript();
         }
-    }
-    if (!mPostCheckpointScript.empty()) {
-        runPostCheckpointScript();
     }
 
     if (getRenderDriver()->getCheckpointController().isMemorySnapshotActive()) {        
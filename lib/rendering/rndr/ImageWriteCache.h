@@ -22,7 +22,9 @@
 
 #include <atomic>
 #include <fstream>
+#include <memory>
 #include <numeric> // std::accumulate()
+#include <vector>
 
 // If this directive is enabled, showing detail message of file output sequence. 
 // These messages are tmpfile write, tmpfile copy to destination and rename to the final filename.
@@ -457,7 +459,11 @@ public:
     int getYBlockSize() const { return mYBlockSize; }
     int getYBlockTotal() const { return mYBlockTotal; }
     int calcYBlockId(const int y) const { return y / mYBlockSize; }
-    void setupDeqBuff(const size_t fileId, const size_t subImgId);
+    // Returns the beginning of the full/half cache data of scanline y of the sub-image. Scanlines
+    // can be fetched in any order and without any dequeue state, so the files of the same cache
+    // can be written by multiple threads at the same time.
+    void getScanlineData(const size_t fileId, const size_t subImgId, const int y,
+                         const void *&dataFull, const void *&dataHalf) const;
     scene_rdl2::cache::CacheEnqueue *enqFullBuff(int yBlockId) {
         return mCacheQueueFullBuffArray[yBlockId].mCEnq.get();
     }
@@ -507,6 +513,19 @@ public:
 
     //------------------------------
 
+    // The cache holds the final output of a frame, written by the ImageWriteDriver thread while
+    // the next frame renders, instead of a checkpoint. It keeps the RenderOutputDriver alive
+    // since the next renderPrep replaces the one of the RenderContext.
+    void setFinalOutput(const std::shared_ptr<const RenderOutputDriver> &renderOutputDriver)
+    {
+        mFinalOutput = true;
+        mFinalOutputDriver = renderOutputDriver;
+    }
+    bool getFinalOutput() const { return mFinalOutput; }
+    bool getFinalOutputResult() const { return mFinalOutputResult; } // after outputDataFinalize()
+
+    //------------------------------
+
     void outputDataFinalize(); // for ImageWriteDriver
     void runPostCheckpointScript();
 
@@ -605,6 +624,10 @@ private:
     bool mTwoStageOutput {true};
     bool mCheckpointOverwrite {true};
     std::vector<ImageWriteCacheTmpFileItemShPtr> mTmpFileItemArray;
+
+    bool mFinalOutput {false};
+    bool mFinalOutputResult {true};
+    std::shared_ptr<const RenderOutputDriver> mFinalOutputDriver; // same as mRenderOutputDriver
     
     //------------------------------
 
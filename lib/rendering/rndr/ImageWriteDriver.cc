@@ -10,11 +10,13 @@
 #include "RenderProgressEstimation.h"
 
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/mcrt_common/Util.h>
 
 #include <scene_rdl2/render/util/StrUtil.h>
 #include <scene_rdl2/render/util/TimeUtil.h>
 
+#include <algorithm>            // find_if
 #include <cstdlib>              // getenv, EXIT_SUCCESS
 #ifndef __APPLE__
 #include <malloc.h>             // malloc_trim
@@ -118,6 +120,7 @@ ImageWriteDriver::updateSnapshotData(ImageWriteCacheUqPtr& imageWriteCachePtr)
     {
         std::lock_guard<std::mutex> lock(mSnapshotDataMutex);
         mSnapshotData = std::move(imageWriteCachePtr);
+        mEmergencyCheckpoint.reset();
         mSnapshotDataFreshness.start();
     }
 #ifndef __APPLE__
@@ -131,6 +134,21 @@ ImageWriteDriver::resetSnapshotData()
     {
         std::lock_guard<std::mutex> lock(mSnapshotDataMutex);
         mSnapshotData.reset();
+        mEmergencyCheckpoint.reset();
+    }
+#ifndef __APPLE__
+    malloc_trim(0); // Return unused memory from malloc() arena to OS
+#endif
+}
+
+void
+ImageWriteDriver::updateEmergencyCheckpoint(CheckpointDelta::CaptureUqPtr& capture)
+{
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotDataMutex);
+        mEmergencyCheckpoint = std::move(capture);
+        mSnapshotData.reset();
+        mSnapshotDataFreshness.start();
     }
 #ifndef __APPLE__
     malloc_trim(0); // Return unused memory from malloc() arena to OS
@@ -227,6 +245,16 @@ ImageWriteDriver::setLastImageWriteCache(ImageWriteCacheUqPtr& imageWriteCachePt
 #   endif // end  DEBUG_MSG_MEMUSAGE
 }
 
+void
+ImageWriteDriver::freeImageWriteCache(ImageWriteCacheUqPtr& imageWriteCachePtr) // MTsafe
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mCurrImageWriteCacheMemSize = 0; // reset mem size for debug
+
+    imageWriteCachePtr.reset();
+}
+
 void
 ImageWriteDriver::conditionWaitUntilAllCompleted()
 // This function is used by RenderDriver::progressCheckpointRenderFrame()
@@ -238,6 +266,30 @@ ImageWriteDriver::conditionWaitUntilAllCompleted()
         });
 }
 
+void
+ImageWriteDriver::recFileWriteTime(const std::string& filename, float sec) // MTsafe
+{
+    std::lock_guard<std::mutex> lock(mFileWriteTimeMutex);
+
+    auto itr = std::find_if(mFileWriteTimeTable.begin(), mFileWriteTimeTable.end(),
+                            [&](const FileWriteTime& item) { return item.mFilename == filename; });
+    if (itr == mFileWriteTimeTable.end()) {
+        mFileWriteTimeTable.emplace_back();
+        itr = mFileWriteTimeTable.end() - 1;
+        itr->mFilename = filename;
+    }
+    itr->mWriteTotal++;
+    itr->mTotalSec += sec;
+    itr->mMaxSec = std::max(itr->mMaxSec, sec);
+}
+
+ImageWriteDriver::FileWriteTimeTable
+ImageWriteDriver::getFileWriteTimeTable() const // MTsafe
+{
+    std::lock_guard<std::mutex> lock(mFileWriteTimeMutex);
+    return mFileWriteTimeTable;
+}
+
 std::string
 ImageWriteDriver::genTmpFilename(const int fileSequenceId,
                                  const std::string& finalFilename)
@@ -330,6 +382,8 @@ ImageWriteDriver::threadMain(ImageWriteDriver* driver)
     driver->mThreadState = ThreadState::IDLE;
     driver->mCvBoot.notify_one(); // notify to ImageWriteDriver's constructor
 
+    mcrt_common::TimelineTrace::setThreadName("imageWriteDriver");
+
     //
     // This imageWriteDriver thread main function does not have interactive boot/shutdown
     // functionality yet. It is difficult to call this API from RenderContext::startFrame()
@@ -349,10 +403,18 @@ ImageWriteDriver::threadMain(ImageWriteDriver* driver)
         driver->mThreadState = ThreadState::BUSY;
         ImageWriteCacheUqPtr cache = std::move(driver->deqImageWriteCache());
         if (cache) {
-            // We have regular checkpoint data
+            // We have regular checkpoint data or the final output of a frame
             cache->outputDataFinalize();
 
-            driver->setLastImageWriteCache(cache); // free internal cache memory as well
+            if (cache->getFinalOutput()) {
+                // Not a checkpoint the final output may be copied from later, simply drop it.
+                if (!cache->getFinalOutputResult()) {
+                    driver->mFinalOutputErrorTotal++;
+                }
+                driver->freeImageWriteCache(cache);
+            } else {
+                driver->setLastImageWriteCache(cache); // free internal cache memory as well
+            }
             driver->mThreadState = ThreadState::IDLE;
 
             if (driver->mImageWriteCacheList.size() < driver->mMaxBgCache) {
@@ -463,17 +525,40 @@ ImageWriteDriver::signalAction()
          << showSigInfo(mSigInfo) << '\n';
 
     ImageWriteCacheUqPtr currSnapshotData;
+    CheckpointDelta::CaptureUqPtr currEmergencyCheckpoint;
     float freshnessSec = 0.0f;
     {
         std::lock_guard<std::mutex> lock(mSnapshotDataMutex);
         currSnapshotData = std::move(mSnapshotData);
         mSnapshotData.reset();
-        if (currSnapshotData) {
+        currEmergencyCheckpoint = std::move(mEmergencyCheckpoint);
+        mEmergencyCheckpoint.reset();
+        if (currSnapshotData || currEmergencyCheckpoint) {
             freshnessSec = mSnapshotDataFreshness.end();
         }
     }
 
-    if (currSnapshotData) {
+    if (currEmergencyCheckpoint) {
+        // Raw tiles only, no encoding. Resume applies this file like any other delta checkpoint file.
+        ostr << "dump emergency checkpoint sequence start ...";
+        msgOut(ostr.str());
+        ostr.str("");
+
+        scene_rdl2::rec_time::RecTime time;
+        time.start();
+        std::string errMsg;
+        if (CheckpointDelta::writeCapture(*currEmergencyCheckpoint, errMsg)) {
+            ostr << "emergency checkpoint file:" << currEmergencyCheckpoint->mFilename
+                 << " tiles:" << currEmergencyCheckpoint->mChangedTileTotal
+                 << " tileSamples:" << currEmergencyCheckpoint->mTileSamples
+                 << " size:" << scene_rdl2::str_util::byteStr(currEmergencyCheckpoint->mData.size()) << '\n';
+        } else {
+            ostr << "emergency checkpoint output failed (" << errMsg << ")\n";
+        }
+        ostr << "snapshot data freshness:" << freshnessSec << " sec old\n"
+             << "checkpoint file output action:" << time.end() << " sec\n";
+
+    } else if (currSnapshotData) {
         ostr << "dump snapshot data sequence start ...";
         msgOut(ostr.str());
         ostr.str("");
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "CheckpointDelta.h"
 #include "ImageWriteCache.h"
 
 #include <atomic>
@@ -13,6 +14,7 @@
 #include <signal.h>
 #include <thread>
 #include <time.h>
+#include <vector>
 
 namespace moonray {
 namespace rndr {
@@ -29,6 +31,16 @@ public:
 
     enum class ThreadState : int { INIT, IDLE, BUSY };
 
+    // Accumulated write time of a single output file
+    struct FileWriteTime
+    {
+        std::string mFilename;
+        unsigned mWriteTotal {0};
+        float mTotalSec {0.0f};
+        float mMaxSec {0.0f};
+    };
+    using FileWriteTimeTable = std::vector<FileWriteTime>;
+
     static void init();
     static ImageWriteDriverShPtr get();
 
@@ -48,6 +60,15 @@ public:
 
     void setMaxBgCache(size_t max) { mMaxBgCache = max; }
 
+    // Max number of files of a single output action written in parallel.
+    void setFileWriteThreads(unsigned n) { mFileWriteThreads = n; }
+    unsigned getFileWriteThreads() const { return mFileWriteThreads; }
+
+    // Process memory (rss) limit in byte for parallel file write. No more file write starts while the
+    // process memory is above this limit and other files are still being written. 0 means no limit.
+    void setFileWriteMemLimit(size_t limit) { mFileWriteMemLimit = limit; }
+    size_t getFileWriteMemLimit() const { return mFileWriteMemLimit; }
+
     void setRenderContext(RenderContext* renderContext) { mRenderContext = renderContext; }
 
     // Called from signal handler. This function should consists of async-signal-safe operations.
@@ -59,7 +80,11 @@ public:
                                             bool snapshotOnly = false); // MTsafe
 
     void updateSnapshotData(ImageWriteCacheUqPtr& imageWriteCachePtr); // MTsafe
-    void resetSnapshotData(); // MTsafe
+    void resetSnapshotData(); // MTsafe : also resets emergency checkpoint
+
+    // Raw delta checkpoint data written by the signal interruption instead of the snapshot data.
+    // Replaces the snapshot data, which is older.
+    void updateEmergencyCheckpoint(CheckpointDelta::CaptureUqPtr& capture); // MTsafe
 
     void enqImageWriteCache(ImageWriteCacheUqPtr& imageWriteCachePtr); // MTsafe
     void waitUntilBgWriteReady(); // MTsafe
@@ -72,6 +97,13 @@ public:
 
     void conditionWaitUntilAllCompleted(); // called by RenderDriver::progressCheckpointRenderFrame()
 
+    // Number of final outputs enqueued by the application (see ImageWriteCache::setFinalOutput())
+    // which failed to write.
+    unsigned getFinalOutputErrorTotal() const { return mFinalOutputErrorTotal; }
+
+    void recFileWriteTime(const std::string& filename, float sec); // MTsafe
+    FileWriteTimeTable getFileWriteTimeTable() const; // MTsafe
+
     //------------------------------
 
     std::string genTmpFilename(const int fileSequenceId, const std::string& finalFilename);
@@ -95,6 +127,14 @@ public:
     ImageWriteCacheList mImageWriteCacheList; // ImageWriteCache list
     ImageWriteCacheUqPtr mLastImageWriteCache;
 
+    unsigned mFileWriteThreads {1};
+    size_t mFileWriteMemLimit {0}; // byte
+
+    mutable std::mutex mFileWriteTimeMutex;
+    FileWriteTimeTable mFileWriteTimeTable; // in the order of the first write of each file
+
+    std::atomic<unsigned> mFinalOutputErrorTotal {0};
+
     // memory size of curently processed imageWriteCache by ImageWriteDriver thread
     size_t mCurrImageWriteCacheMemSize {0};
 
@@ -108,6 +148,7 @@ public:
     std::mutex mSnapshotDataMutex;
     scene_rdl2::rec_time::RecTime mSnapshotDataFreshness;
     ImageWriteCacheUqPtr mSnapshotData; // snapshot for signal interruption
+    CheckpointDelta::CaptureUqPtr mEmergencyCheckpoint; // used instead of mSnapshotData if any
 
     //------------------------------
     //
@@ -123,6 +164,7 @@ public:
 
     static void threadMain(ImageWriteDriver* driver);
     ImageWriteCacheUqPtr deqImageWriteCache(); // MTsafe
+    void freeImageWriteCache(ImageWriteCacheUqPtr& imageWriteCachePtr); // MTsafe
     bool isImageWriteCacheEmpty() const; // MTsafe
 
     std::string getTmpFilePrefix();
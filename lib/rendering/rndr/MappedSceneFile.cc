@@ -0,0 +1,132 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "MappedSceneFile.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moonray {
+namespace rndr {
+
+namespace {
+
+// Size of the pieces of the file prefetched in parallel.
+constexpr size_t sPrefetchChunkSize = 16 * 1024 * 1024;
+
+} // namespace
+
+MappedSceneFile::MappedSceneFile(const std::string &filename) :
+    mFilename(filename),
+    mData(nullptr),
+    mSize(0),
+    mStream(&mBuf)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            mData = static_cast<const char *>(addr);
+            mSize = st.st_size;
+            ::madvise(addr, mSize, MADV_SEQUENTIAL);
+        }
+    }
+
+    ::close(fd); // the mapping keeps the file alive
+    mBuf.set(mData, mSize);
+}
+
+MappedSceneFile::~MappedSceneFile()
+{
+    if (mData) {
+        ::munmap(const_cast<char *>(mData), mSize);
+    }
+}
+
+void
+MappedSceneFile::prefetch() const
+{
+    if (!mData) {
+        return;
+    }
+
+    const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+    const size_t numChunks = (mSize + sPrefetchChunkSize - 1) / sPrefetchChunkSize;
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numChunks, 1),
+                      [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t chunk = range.begin(); chunk != range.end(); ++chunk) {
+            const size_t begin = chunk * sPrefetchChunkSize;
+            const size_t end = std::min(begin + sPrefetchChunkSize, mSize);
+            ::madvise(const_cast<char *>(mData) + begin, end - begin, MADV_WILLNEED);
+
+            // madvise only queues the reads, touching the pages waits for them.
+            volatile char sink = 0;
+            for (size_t offset = begin; offset < end; offset += pageSize) {
+                sink = sink + mData[offset];
+            }
+        }
+    });
+}
+
+std::istream &
+MappedSceneFile::getStream()
+{
+    mStream.clear();
+    mStream.seekg(0);
+    return mStream;
+}
+
+void
+MappedSceneFile::MemoryBuf::set(const char *data, size_t size)
+{
+    char *begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+}
+
+std::streambuf::pos_type
+MappedSceneFile::MemoryBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type base = 0;
+    if (dir == std::ios_base::cur) {
+        base = gptr() - eback();
+    } else if (dir == std::ios_base::end) {
+        base = egptr() - eback();
+    }
+
+    const off_type pos = base + off;
+    if (pos < 0 || pos > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+std::streambuf::pos_type
+MappedSceneFile::MemoryBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+} // namespace rndr
+} // namespace moonray
+
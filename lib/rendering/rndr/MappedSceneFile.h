@@ -0,0 +1,67 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+namespace moonray {
+namespace rndr {
+
+class MappedSceneFile
+//
+// Read only memory mapping of a scene file, read through an std::istream.
+//
+// prefetch() faults the whole file into memory, reading chunks of it in
+// parallel. loadScene() prefetches the binary scene files on other threads
+// while it decodes the previous ones, so the reads overlap the decoding and a
+// large file is read with several requests in flight.
+//
+{
+public:
+    explicit MappedSceneFile(const std::string &filename);
+    ~MappedSceneFile();
+
+    MappedSceneFile(const MappedSceneFile &) = delete;
+    MappedSceneFile &operator=(const MappedSceneFile &) = delete;
+
+    // False if the file couldn't be opened or mapped, the caller should read
+    // it the regular way to get the usual error.
+    bool isValid() const { return mData != nullptr; }
+
+    const std::string &getFilename() const { return mFilename; }
+    size_t getSize() const { return mSize; }
+
+    // Thread safe, may run concurrently with reads of the stream.
+    void prefetch() const;
+
+    // Stream over the whole file, positioned at its start.
+    std::istream &getStream();
+
+private:
+    class MemoryBuf : public std::streambuf
+    {
+    public:
+        void set(const char *data, size_t size);
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    };
+
+    std::string mFilename;
+    const char *mData;
+    size_t mSize;
+
+    MemoryBuf mBuf;
+    std::istream mStream;
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,120 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "MemoryWatchdog.h"
+#include "ImageWriteDriver.h"
+
+#include <scene_rdl2/render/logging/logging.h>
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <chrono>
+#include <sstream>
+
+namespace moonray {
+namespace rndr {
+
+MemoryWatchdog::MemoryWatchdog(size_t budget, float intervalSec, const Action &action) :
+    mBudget(budget),
+    mIntervalSec(intervalSec),
+    mAction(action),
+    mMaxLevel(Level::NONE),
+    mStop(false)
+{
+}
+
+MemoryWatchdog::~MemoryWatchdog()
+{
+    stop();
+}
+
+void
+MemoryWatchdog::start()
+{
+    if (mWatchDogThread.joinable()) return;
+
+    mStop = false;
+    mWatchDogThread = std::thread([](MemoryWatchdog *watchdog) { watchdog->watchDogMainLoop(); }, this);
+}
+
+void
+MemoryWatchdog::stop()
+{
+    if (!mWatchDogThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCvStop.notify_one();
+    mWatchDogThread.join();
+}
+
+MemoryWatchdog::Level
+MemoryWatchdog::check(size_t rss)
+{
+    const Level level = getLevel(rss, mBudget);
+    Level maxLevel = mMaxLevel.load(std::memory_order_relaxed);
+    while (maxLevel < level) {
+        maxLevel = static_cast<Level>(static_cast<int>(maxLevel) + 1);
+
+        std::ostringstream ostr;
+        ostr << "Memory watchdog: " << scene_rdl2::str_util::byteStr(rss)
+             << " resident of the " << scene_rdl2::str_util::byteStr(mBudget) << " budget, "
+             << levelStr(maxLevel);
+        scene_rdl2::logging::Logger::warn(ostr.str());
+
+        if (mAction) {
+            mAction(maxLevel, rss);
+        }
+        mMaxLevel.store(maxLevel, std::memory_order_release);
+    }
+    return level;
+}
+
+// static function
+MemoryWatchdog::Level
+MemoryWatchdog::getLevel(size_t rss, size_t budget)
+{
+    if (budget == 0) return Level::NONE;
+
+    if (rss >= budget) return Level::STOP;
+    const double fraction = static_cast<double>(rss) / static_cast<double>(budget);
+    if (fraction >= 0.9) return Level::SHRINK_MORE;
+    if (fraction >= 0.8) return Level::SHRINK;
+    return Level::NONE;
+}
+
+// static function
+std::string
+MemoryWatchdog::levelStr(Level level)
+{
+    switch (level) {
+    case Level::NONE : return "NONE";
+    case Level::SHRINK : return "SHRINK";
+    case Level::SHRINK_MORE : return "SHRINK_MORE";
+    case Level::STOP : return "STOP";
+    default : return "?";
+    }
+}
+
+void
+MemoryWatchdog::watchDogMainLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mStop) {
+        mCvStop.wait_for(lock, std::chrono::milliseconds((int)(mIntervalSec * 1000.0f)));
+        if (mStop) break;
+
+        // The action may take a while, don't hold up stop() meanwhile.
+        lock.unlock();
+        const bool stopLevel = check(ImageWriteDriver::getProcMemUsage()) == Level::STOP;
+        lock.lock();
+
+        if (stopLevel) break; // nothing left to do for this frame
+    }
+}
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,77 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+//
+// -- Memory watchdog --
+//
+// Tracks the resident memory of the process against a budget from its own
+// thread while a frame renders. Rather than letting the job get killed by the
+// OOM killer hours into the render, it escalates through a set of pressure
+// levels as the memory gets close to the budget and hands each level to an
+// action callback the first time it is reached in the frame:
+//
+//   SHRINK      (80% of the budget)  : release memory held by caches
+//   SHRINK_MORE (90% of the budget)  : release more of it
+//   STOP        (100% of the budget) : stop the render cleanly
+//
+// Every level reached is logged, the action is expected to log what it does.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace moonray {
+namespace rndr {
+
+class MemoryWatchdog
+{
+public:
+    enum class Level : int { NONE, SHRINK, SHRINK_MORE, STOP };
+
+    using Action = std::function<void(Level level, size_t rss)>;
+
+    // budget and rss are in bytes
+    MemoryWatchdog(size_t budget, float intervalSec, const Action &action);
+    ~MemoryWatchdog();
+
+    MemoryWatchdog(const MemoryWatchdog&) = delete;
+    MemoryWatchdog& operator=(const MemoryWatchdog&) = delete;
+
+    void start(); // spawns the watchdog thread
+    void stop();  // joins the watchdog thread, no action runs once this returns
+
+    // One watchdog step for the given resident memory, the action runs for
+    // each level reached for the first time. Returns the level of rss.
+    Level check(size_t rss);
+
+    size_t getBudget() const { return mBudget; }
+    Level getMaxLevel() const { return mMaxLevel.load(std::memory_order_acquire); }
+
+    static Level getLevel(size_t rss, size_t budget);
+    static std::string levelStr(Level level);
+
+protected:
+    void watchDogMainLoop();
+
+    const size_t mBudget;
+    const float mIntervalSec;
+    const Action mAction;
+
+    std::atomic<Level> mMaxLevel; // highest level acted upon so far
+
+    std::mutex mMutex;
+    std::condition_variable mCvStop;
+    bool mStop;
+    std::thread mWatchDogThread;
+};
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,47 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "PickBatchQueue.h"
+
+namespace moonray {
+namespace rndr {
+
+PickBatchQueue::PickBatchQueue() :
+    // no slot reserved for external threads, the batches are picked up by a worker
+    mArena(1, 0, tbb::task_arena::priority::low),
+    mCanceled(false)
+{
+}
+
+PickBatchQueue::~PickBatchQueue()
+{
+    cancel();
+}
+
+void
+PickBatchQueue::submit(std::function<void(const std::atomic<bool> &canceled)> batch)
+{
+    mArena.execute([&]() {
+        mGroup.run([this, batch]() {
+            if (!mCanceled) {
+                batch(mCanceled);
+            }
+        });
+    });
+}
+
+void
+PickBatchQueue::cancel()
+{
+    mCanceled = true;
+    mArena.execute([&]() {
+        mGroup.wait();
+    });
+    mCanceled = false;
+}
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,87 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <moonray/rendering/shading/Shading.h>
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace scene_rdl2 {
+namespace rdl2 {
+class Geometry;
+class Material;
+}
+}
+
+namespace moonray {
+namespace rndr {
+
+// Queries of RenderContext::handlePickBatch(), or'ed together.
+enum PickQuery
+{
+    PICK_MATERIAL               = 1 << 0,
+    PICK_GEOMETRY               = 1 << 1,
+    PICK_LIGHT_CONTRIBUTIONS    = 1 << 2
+};
+
+// Result of the pick of one pixel by RenderContext::handlePickBatch(), only
+// the members of the queries asked for are filled in.
+struct PickResult
+{
+    int mX {0};
+    int mY {0};
+    const scene_rdl2::rdl2::Material *mMaterial {nullptr};
+    const scene_rdl2::rdl2::Geometry *mGeometry {nullptr};
+    std::string mPart;
+    shading::LightContribArray mLightContributions;
+};
+
+typedef std::function<void(std::vector<PickResult> &&results)> PickBatchCallback;
+
+class PickBatchQueue
+//
+// Runs batches of picking queries in the background, alongside rendering, so
+// that interactive tools can inspect whole regions without blocking the render
+// threads or their own thread.
+//
+// The batches run one at a time on a task arena of a single low priority slot:
+// picking only gets a render thread when the render leaves one idle, e.g.
+// between passes. One slot is all picking can use anyway, since it shades with
+// the GUI TLS, the only TLS which is free while rendering. The synchronous
+// picks share that TLS and must hold getGuiTLSMutex() while using it.
+//
+{
+public:
+    PickBatchQueue();
+    ~PickBatchQueue();
+
+    // Queues a batch. It is passed a flag which is raised once the batch is
+    // canceled, which it should poll between pixels.
+    void submit(std::function<void(const std::atomic<bool> &canceled)> batch);
+
+    // Cancels the queued and running batches and waits for them to return.
+    // Called before the scene changes.
+    void cancel();
+
+    std::mutex &getGuiTLSMutex() { return mGuiTLSMutex; }
+
+private:
+    tbb::task_arena mArena;
+    tbb::task_group mGroup;
+    std::atomic<bool> mCanceled;
+    std::mutex mGuiTLSMutex;
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,61 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "RealtimeFrameController.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace moonray {
+namespace rndr {
+
+void
+RealtimeFrameController::reset()
+{
+    mRenderBudget = 0.0;
+    mMargin = 0.0;
+    mAveragedOverrun = 0.0;
+}
+
+double
+RealtimeFrameController::startFrame(double renderBudget)
+{
+    mRenderBudget = std::max(renderBudget, 0.0);
+    // The budget shrinks when the update takes longer, the margin has to follow.
+    mMargin = std::min(mMargin, mRenderBudget * sMaxMarginFraction);
+    return mMargin;
+}
+
+double
+RealtimeFrameController::getParanoiaFactor(unsigned samplesPerTileRendered) const
+{
+    // The sample cost is averaged over the samples rendered so far, its error goes
+    // down roughly with their count.
+    const double samples = static_cast<double>(samplesPerTileRendered);
+    return sMaxParanoiaFactor * sConfidentSamplesPerTile / (sConfidentSamplesPerTile + samples);
+}
+
+void
+RealtimeFrameController::endFrame(double predictedEndTime, double actualEndTime)
+{
+    const double overrun = actualEndTime - predictedEndTime;
+    mAveragedOverrun += (overrun - mAveragedOverrun) * sOverrunSmoothing;
+    mMargin = std::clamp(mMargin + overrun * sGain, 0.0, mRenderBudget * sMaxMarginFraction);
+}
+
+std::string
+RealtimeFrameController::show() const
+{
+    std::ostringstream ostr;
+    ostr << "RealtimeFrameController {\n"
+         << "  mRenderBudget:" << mRenderBudget * 1000.0 << " ms\n"
+         << "  mMargin:" << mMargin * 1000.0 << " ms\n"
+         << "  mAveragedOverrun:" << mAveragedOverrun * 1000.0 << " ms\n"
+         << "}";
+    return ostr.str();
+}
+
+} // namespace rndr
+} // namespace moonray
@@ -0,0 +1,75 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <string>
+
+namespace moonray {
+namespace rndr {
+
+class RealtimeFrameController
+//
+// Closed loop frame pacing of the REALTIME render mode.
+//
+// RenderDriver::realtimeRenderFrame() sizes every pass from the sample cost the
+// RenderFrameTimingRecord measured for the earlier passes of the frame. That open
+// loop estimate is systematically off in both directions: the last pass of a
+// frame overruns the budget whenever the cost went up during the frame, and
+// frames end early by up to one pass when it went down. This controller closes
+// the loop over the frames:
+//
+// - It holds back a time margin from the render budget of every frame. The
+//   margin integrates the overrun (actual end - predicted end) of the finished
+//   frames, so it grows while frames are late and decays back to zero while they
+//   are on time. It is clamped to a fraction of the budget so that a single
+//   hiccup (i.e. a swap, a large update) can't starve the following frames.
+//
+// - It tells how much of the remaining time a pass may take. Passes sized from a
+//   cost measured over few samples are kept short, so the estimate gets refined
+//   before a long pass commits the rest of the frame.
+//
+// Not thread-safe, it is driven by the render driver thread only.
+//
+{
+public:
+    RealtimeFrameController() { reset(); }
+
+    void reset();
+
+    // Starts a frame with renderBudget sec of render time. Returns the time margin
+    // (sec) to hold back from the budget.
+    double startFrame(double renderBudget);
+
+    // Fraction (0.0 ~ 1.0) of the samples estimated to fit in the remaining time to
+    // hold back for the next pass, given the samples per tile the frame rendered so
+    // far. This is the "paranoia factor" of realtimeRenderFrame().
+    double getParanoiaFactor(unsigned samplesPerTileRendered) const;
+
+    // Feeds back the end time of the finished frame against the end time it was
+    // paced for (both sec, same clock).
+    void endFrame(double predictedEndTime, double actualEndTime);
+
+    double getMargin() const { return mMargin; }
+    // Smoothed overrun of the recent frames (sec), negative when frames end early.
+    double getAveragedOverrun() const { return mAveragedOverrun; }
+
+    std::string show() const;
+
+private:
+    static constexpr double sGain = 0.5;               // share of the overrun added to the margin
+    static constexpr double sMaxMarginFraction = 0.25;  // max margin relative to the render budget
+    static constexpr double sOverrunSmoothing = 0.1;    // weight of the newest frame in the average
+    static constexpr double sMaxParanoiaFactor = 0.5;   // for the pass right after the estimation pass
+    static constexpr double sConfidentSamplesPerTile = 4.0;
+
+    double mRenderBudget;
+    double mMargin;
+    double mAveragedOverrun;
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -12,7 +12,10 @@
 #include "CheckpointSigIntHandler.h"
 #include "FrameState.h"
 #include "ImageWriteDriver.h"
+#include "MappedSceneFile.h"
+#include "MemoryWatchdog.h"
 #include "PixelBufferUtils.h"
+#include "RenderDenoiser.h"
 #include "ProcKeeper.h"
 #include "RenderContextConsoleDriver.h"
 #include "RenderDriver.h"
@@ -21,6 +24,7 @@
 #include "RenderOutputHelper.h"
 #include "RenderStatistics.h"
 #include "ResumeHistoryMetaData.h"
+#include "TileAccumulator.h"
 #include "TileScheduler.h"
 #include "Types.h"
 
@@ -34,9 +38,11 @@
 #include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/bvh/shading/ThreadLocalObjectState.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/pbr/camera/Camera.h>
 #include <moonray/rendering/pbr/core/Aov.h>
 #include <moonray/rendering/pbr/core/DebugRay.h>
+#include <moonray/rendering/pbr/core/ImageDistributionCache.h>
 #include <moonray/rendering/pbr/core/Statistics.h>
 #include <moonray/rendering/pbr/handlers/ShadeBundleHandler.h>
 #include <moonray/rendering/pbr/integrator/PathIntegrator.h>
@@ -47,6 +53,7 @@
 #include <moonray/rendering/shading/BsdfBuilder.h>
 #include <moonray/rendering/shading/Geometry.h>
 #include <moonray/rendering/shading/Material.h>
+#include <moonray/rendering/texturing/sampler/VdbGridCache.h>
 
 
 #include <scene_rdl2/common/except/exceptions.h>
@@ -63,15 +70,22 @@
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #include <tbb/task_arena.h>
+#include <tbb/task_group.h>
 
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <future>
+#include <iomanip>
 #ifndef __APPLE__
 #include <malloc.h>
 #endif
 #include <memory>
+#include <set>
+#include <signal.h>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace moonray {
@@ -216,6 +230,9 @@ RenderContext::RenderContext(RenderOptions& options, std::stringstream* initMess
     mRenderPrepRun(false),
     mRendering(false),
     mFirstFrame(true),
+    mPreviewPrep(false),
+    mCanceledGeomChangeFlag(rt::ChangeFlag::NONE),
+    mKeepCanceledPrepWork(false),
     mSceneUpdated(false),
     mHasBeenInit(false),
     mSceneLoaded(false),
@@ -235,6 +252,8 @@ RenderContext::RenderContext(RenderOptions& options, std::stringstream* initMess
     mResumeHistoryMetaData.reset(new ResumeHistoryMetaData);
     mResumeHistoryMetaData->setProcStartTime();
 
+    mPickBatchQueue.reset(new PickBatchQueue);
+
     //------------------------------
 
     // Initialize set of standard attributes
@@ -292,6 +311,11 @@ RenderContext::RenderContext(RenderOptions& options, std::stringstream* initMess
         mSceneContext->setDsoPath(mOptions.getDsoPath() + ":" + mSceneContext->getDsoPath());
     }
 
+    if (!mOptions.getTimelineTraceFile().empty()) {
+        mcrt_common::TimelineTrace::enable();
+        mcrt_common::TimelineTrace::setThreadName("main");
+    }
+
     parserConfigure();
 }
 
@@ -453,10 +477,29 @@ RenderContext::initialize(std::stringstream &initMessages, LoggingConfiguration
     // Update texture system limits.
     texture::TextureSampler *sampler = MNRY_VERIFY(texture::getTextureSampler());
     sampler->setOpenFileLimit(sceneVars.get(scene_rdl2::rdl2::SceneVariables::sTextureFileHandleCount));
+    sampler->setSharedCache(mOptions.getTextureSharedCacheDir(), mOptions.getTextureSharedCacheSizeMb());
+    sampler->setConversionCache(mOptions.getTextureConvertDir());
+    sampler->setDeduplication(mOptions.getTextureDedupe());
+    sampler->getPrefetcher().setNumThreads(mOptions.getTexturePrefetchThreads());
 
     // configure GeometryManager options
     mGeometryManagerOptions->accelOptions.maxThreads = getNumTBBThreads();
     mGeometryManagerOptions->accelOptions.verbose = false;
+    mGeometryManagerOptions->accelOptions.deferSharedBVH = mOptions.getDeferInstanceBVH();
+    mGeometryManagerOptions->accelOptions.hugePages = mOptions.getHugePageMode() != mcrt_common::HugePageMode::OFF;
+    mGeometryManagerOptions->accelOptions.compactBVH = mOptions.getCompactBVH();
+    // Only interactive sessions re-tessellate the same meshes frame after frame
+    mGeometryManagerOptions->cacheSubdTopology =
+        getRenderMode() != RenderMode::BATCH &&
+        getRenderMode() != RenderMode::PROGRESS_CHECKPOINT;
+    mGeometryManagerOptions->tessellationFaceBudget = mOptions.getTessellationFaceBudget();
+    mGeometryManagerOptions->tessellationArena = mOptions.getTessellationArena();
+    mGeometryManagerOptions->tessellationArenaHugePages = mOptions.getHugePageMode();
+
+    // Same for the light image distributions
+    pbr::ImageDistributionCache::get().setUnusedMemoryLimit(
+        (getRenderMode() != RenderMode::BATCH && getRenderMode() != RenderMode::PROGRESS_CHECKPOINT) ?
+        mOptions.getImageDistributionCacheSizeMb() * 1024 * 1024 : 0);
 
     mGeometryManagerOptions->stats.logString =
         [stats = mRenderStats.get()](const std::string& str)
@@ -506,6 +549,12 @@ RenderContext::~RenderContext()
     if (mRendering) {
         stopFrame();
     }
+    mMemoryWatchdog.reset();
+    mPickBatchQueue->cancel();
+
+    // Pick up the image writes which followed the last frame.
+    writeTimelineTrace();
+
     // There is an issue NOVAVP-12 where we get render artifacts
     // Whenever we try to reset the scene. Adding this call here
     // Fixes it. For some reason it looks like a problem in oiio
@@ -582,6 +631,7 @@ RenderContext::updateGeometry(const std::vector<moonray::ObjectData>& updateData
     });
 
     mSceneUpdated = true;
+    mKeepCanceledPrepWork = false;
 }
 
 bool
@@ -628,11 +678,6 @@ RenderContext::bakeGeometry(std::vector<std::unique_ptr<geom::BakedMesh>>& baked
     shading::PerGeometryAttributeKeySet perGeometryAttributes;
     mPbrScene->getCamera()->getRequiredPrimAttributes(perGeometryAttributes);
 
-    mGeometryManager->loadGeometries(mLayer, rt::ChangeFlag::ALL, world2render, currentFrame, motionBlurParams,
-                                     getNumTBBThreads(), perGeometryAttributes);
-    mGeometryManager->loadGeometries(mMeshLightLayer, rt::ChangeFlag::ALL, world2render, currentFrame, motionBlurParams,
-                                     getNumTBBThreads(), perGeometryAttributes);
-
     // Get the camera frustum and render to camera matrices for times points 0 and 1
     // TODO: generalize for multi-segment motion blur. Currently we only have 2
     // motion samples and assume the ray time points are 0 and 1. In multi-segment
@@ -647,6 +692,12 @@ RenderContext::bakeGeometry(std::vector<std::unique_ptr<geom::BakedMesh>>& baked
         camera->computeFrustum(&frustums.back(), 1, true);  // frustum at shutter close
     }
 
+    mGeometryManager->loadGeometries(mLayer, rt::ChangeFlag::ALL, world2render, currentFrame, motionBlurParams,
+                                     frustums, getNumTBBThreads(), perGeometryAttributes);
+    mGeometryManager->loadGeometries(mMeshLightLayer, rt::ChangeFlag::ALL, world2render, currentFrame, motionBlurParams,
+                                     frustums, getNumTBBThreads(), perGeometryAttributes);
+    mGeometryManager->discardCanceledWork();
+
     const scene_rdl2::rdl2::Camera* dicingCamera = mSceneContext->getDicingCamera();
     mGeometryManager->bakeGeometry(mLayer,
                                    motionBlurParams,
@@ -672,6 +723,7 @@ RenderContext::updateScene(const std::string& manifest, const std::string& paylo
         scene_rdl2::rdl2::BinaryReader reader(*mSceneContext);
         reader.fromBytes(manifest, payload);
         mSceneUpdated = true;
+        mKeepCanceledPrepWork = false;
     }
 }
 
@@ -686,6 +738,7 @@ RenderContext::updateScene(const std::string& filename)
         RenderTimer funcTimer(mRenderStats->mUpdateSceneTime);
         readSceneFromFile(filename, *mSceneContext);
         mSceneUpdated = true;
+        mKeepCanceledPrepWork = false;
     }
 }
 
@@ -703,6 +756,28 @@ RenderContext::invalidateTextureResources(const std::vector<std::string>& resour
     setSceneUpdated();
 }
 
+void
+RenderContext::reloadShaderDsos(const std::set<std::string>& changedDsos)
+{
+    MNRY_ASSERT_REQUIRE(!mRendering, "Cannot reload shaders while rendering is in progress.");
+
+    mReloadedShaderDsos.insert(changedDsos.begin(), changedDsos.end());
+}
+
+void
+RenderContext::applyAttributeOverrides(const std::vector<RenderOptions::AttributeOverride>& overrides)
+{
+    MNRY_ASSERT_REQUIRE(!mRendering, "Cannot apply attribute overrides while rendering is in progress.");
+
+    std::stringstream messages;
+    const AttributeOverrideScope scope = rndr::applyAttributeOverrides(*mSceneContext, overrides, messages);
+    Logger::info("Applied ", scope.mApplied, " attribute overrides to ", scope.mObjects, " objects, ",
+                 scope.describe());
+    if (scope.mApplied) {
+        setSceneUpdated();
+    }
+}
+
 RenderContext::RP_RESULT
 RenderContext::startFrame()
 {
@@ -728,9 +803,15 @@ RenderContext::startFrame()
         if (mOptions.getTextureCacheSizeMb() != 0) {
             textureCacheSizeMb = mOptions.getTextureCacheSizeMb();
         }
-        if (static_cast<int>(sampler->getMemoryUsage()) != textureCacheSizeMb) {
+        // A cache grown by the previous frames keeps its size, up to the limit.
+        const float autoGrowLimitMb = static_cast<float>(mOptions.getTextureCacheAutoGrowMb());
+        const float currentSizeMb = sampler->getMemoryUsage();
+        const bool keepGrownSize = currentSizeMb > textureCacheSizeMb && currentSizeMb <= autoGrowLimitMb;
+        if (static_cast<int>(currentSizeMb) != textureCacheSizeMb && !keepGrownSize) {
             sampler->setMemoryUsage(static_cast<float>(textureCacheSizeMb));
         }
+        sampler->getCacheMonitor().setAutoGrowLimitMb(autoGrowLimitMb);
+        sampler->getCacheMonitor().startFrame(sampler->getTextureSystem());
     }
 
     MNRY_ASSERT_REQUIRE(!mRendering, "Must stop rendering before starting it again.");
@@ -904,6 +985,9 @@ RenderContext::startFrame()
     mDeepIDChannelNames.reset(new std::vector<std::string>());
     *mDeepIDChannelNames = vars.get(scene_rdl2::rdl2::SceneVariables::sDeepIDAttributeNames);
 
+    // Exclusive accumulators cache the profiling mode when the frame starts.
+    mcrt_common::setExclusiveAccumulatorSamplingInterval(mOptions.getProfileSamplingInterval());
+
     // Check if the user requested to record debug rays for this frame.
     if (!vars.get(scene_rdl2::rdl2::SceneVariables::sDebugRaysFile).empty()) {
         if (mDriver->getDebugRayState() == RenderDriver::READY) {
@@ -911,7 +995,15 @@ RenderContext::startFrame()
             Viewport vp = scene_rdl2::math::convertToClosedViewport(vars.getRezedRegionWindow());
             BBox2i bboxVp(vp.min(), vp.max());
             // Will accept a double to float precision loss for debug rays
-            pbr::DebugRayRecorder::enableRecording(bboxVp, toFloat(render2world));
+            if (mOptions.getStreamDebugRays()) {
+                // Streamed vertices don't stay in memory, only the 32 bit vertex ids limit them.
+                pbr::DebugRayRecorder::enableRecording(bboxVp, toFloat(render2world), 0xfffffffe,
+                                                       mOptions.getDebugRayPathSampleRate(),
+                                                       vars.get(scene_rdl2::rdl2::SceneVariables::sDebugRaysFile));
+            } else {
+                pbr::DebugRayRecorder::enableRecording(bboxVp, toFloat(render2world), 0x200000,
+                                                       mOptions.getDebugRayPathSampleRate());
+            }
             mDriver->switchDebugRayState(RenderDriver::READY, RenderDriver::REQUEST_RECORD);
         }
     }
@@ -962,6 +1054,8 @@ RenderContext::startFrame()
         ImageWriteDriver::get()->setTwoStageOutput(frameState.mTwoStageOutput);
         ImageWriteDriver::get()->setTmpDirectory(vars.getTmpDir());
         ImageWriteDriver::get()->setMaxBgCache(vars.get(scene_rdl2::rdl2::SceneVariables::sCheckpointMaxBgCache));
+        ImageWriteDriver::get()->setFileWriteThreads(mOptions.getImageWriteThreads());
+        ImageWriteDriver::get()->setFileWriteMemLimit(mOptions.getImageWriteMemLimitMb() * 1024 * 1024);
         ImageWriteDriver::get()->setRenderContext(this);
     }
 
@@ -993,6 +1087,9 @@ RenderContext::startFrame()
     // Setup the XPU queues in the RenderDriver if we are XPU accelerated.
     if (frameState.mExecutionMode == mcrt_common::ExecutionMode::XPU) {
         mDriver->createXPUQueues(frameState.mGPUAccel);
+        if (frameState.mGPUAccel) {
+            frameState.mGPUAccel->resetStats();
+        }
     }
 
     if (execResult == RP_RESULT::CANCELED) {
@@ -1020,12 +1117,74 @@ RenderContext::startFrame()
     mRendering = true;
     mDriver->startFrame(frameState);
 
+    if (mOptions.getMemoryBudgetMb() > 0) {
+        startMemoryWatchdog();
+    }
+
     mRenderPrepRun = false;
     mRenderPrepTimingStats->setWholeStartFrame(recTimeWhole.end());
 
     return RP_RESULT::FINISHED;
 }
 
+void
+RenderContext::startMemoryWatchdog()
+//
+// Sheds memory as the process gets close to the budget and stops the render once it reaches
+// it. Deep, cryptomatte and film buffers are needed until the end of the frame and only the
+// texture cache can give memory back while rendering.
+//
+{
+    constexpr size_t bytesPerMb = 1024 * 1024;
+    constexpr float minTextureCacheSizeMb = 256.0f;
+    constexpr float checkIntervalSec = 1.0f;
+
+    auto action = [this](MemoryWatchdog::Level level, size_t /*rss*/) {
+        std::ostringstream ostr;
+        ostr << "Memory watchdog: ";
+
+        switch (level) {
+        case MemoryWatchdog::Level::SHRINK :
+        case MemoryWatchdog::Level::SHRINK_MORE : {
+            texture::TextureSampler *sampler = texture::getTextureSampler();
+            const float scale = (level == MemoryWatchdog::Level::SHRINK) ? 0.5f : 0.25f;
+            const float sizeMb = sampler->getMemoryUsage();
+            const float newSizeMb = std::min(sizeMb, std::max(sizeMb * scale, minTextureCacheSizeMb));
+
+            // Don't let the cache grow back for the rest of the frame.
+            sampler->getCacheMonitor().setAutoGrowLimitMb(0.0f);
+            sampler->setMemoryUsage(newSizeMb);
+#ifndef __APPLE__
+            malloc_trim(0);
+#endif
+            ostr << "shrank the texture cache from " << sizeMb << " MB to " << newSizeMb
+                 << " MB and returned freed memory to the system";
+            Logger::warn(ostr.str());
+        } break;
+
+        case MemoryWatchdog::Level::STOP :
+            if (CheckpointSigIntHandler::isEnabled()) {
+                // Same path as an interactive SIGINT: checkpoint file output, then exit.
+                ostr << "memory budget reached, writing a checkpoint and exiting";
+                Logger::error(ostr.str());
+                raise(SIGINT);
+            } else {
+                ostr << "memory budget reached, stopping the render with the samples rendered so far";
+                Logger::error(ostr.str());
+                mDriver->requestStop();
+            }
+            break;
+
+        default :
+            break;
+        }
+    };
+
+    mMemoryWatchdog.reset(new MemoryWatchdog(mOptions.getMemoryBudgetMb() * bytesPerMb,
+                                             checkIntervalSec, action));
+    mMemoryWatchdog->start();
+}
+
 void
 RenderContext::requestStop()
 {
@@ -1052,9 +1211,20 @@ RenderContext::stopFrame()
 
     MNRY_ASSERT_REQUIRE(mRendering, "Must start rendering before it can be stopped.");
 
+    // The scene may change once the frame is stopped.
+    mPickBatchQueue->cancel();
+
+    // Nothing is shed nor stopped by the watchdog past this point.
+    mMemoryWatchdog.reset();
+
     // Halt the render driver.
     mDriver->stopFrame();
 
+    {
+        texture::TextureSampler *sampler = texture::getTextureSampler();
+        sampler->getCacheMonitor().endFrame(sampler->getTextureSystem());
+    }
+
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::StopFrameTag::MDRIVER_STOPFRAME);
 
     mPbrScene->postFrame();
@@ -1064,6 +1234,18 @@ RenderContext::stopFrame()
     // Accumulate pbr stats data.
     mPbrStatistics->mMcrtTime = mDriver->getLastFrameMcrtDuration();
     mPbrStatistics->mMcrtUtilization = mDriver->getLastFrameMcrtUtilization();
+    if (mIntegrator->getEnablePathGuide()) {
+        const pbr::PathGuide &pathGuide = mIntegrator->getPathGuide();
+        mPbrStatistics->mPathGuideSamplesRecorded = pathGuide.getNumSamplesRecorded();
+        mPbrStatistics->mPathGuideMergeTime = pathGuide.getMergeTime();
+    }
+    if (const rt::GPUAccelerator *gpuAccel = mGeometryManager->getGPUAccelerator()) {
+        mPbrStatistics->mGPUBusyTime = gpuAccel->getBusyTime();
+        for (unsigned i = 0; i < gpuAccel->getNumDevices(); ++i) {
+            mPbrStatistics->mGPUDeviceBusyTime.push_back(gpuAccel->getBusyTime(i));
+            mPbrStatistics->mGPUDeviceRays.push_back(gpuAccel->getNumRays(i));
+        }
+    }
     mPbrStatistics->initLightStats(mPbrScene->getLightCount());
 
     pbr::forEachTLS([this](pbr::TLState const *tls){ (*mPbrStatistics) += tls->mStatistics; });
@@ -1109,13 +1291,29 @@ RenderContext::stopFrame()
             mRenderStats->logInfoEmptyLine();
             mRenderStats->logLightStats(*mPbrStatistics, mPbrScene.get(), mSceneContext->getSceneVariables());
 
+            if (mOptions.getCostAttribution()) {
+                mRenderStats->logInfoEmptyLine();
+                mRenderStats->logCostAttributionStats(*mPbrStatistics, mPbrScene.get());
+            }
+
             mRenderStats->logInfoEmptyLine();
             mRenderStats->logTexturingStats(*texture::getTextureSampler(), mDebugLoggingEnabled);
+            mRenderStats->logVdbGridStats(texture::getVdbGridCache());
 
             mRenderStats->logRenderingStats(*mPbrStatistics,
                 static_cast<mcrt_common::ExecutionMode>(mDriver->getFrameState().mExecutionMode),
                 mSceneContext->getSceneVariables());
 
+            const auto execMode = static_cast<mcrt_common::ExecutionMode>(mDriver->getFrameState().mExecutionMode);
+            if (mOptions.getPoolGrowthLimit() &&
+                (execMode == mcrt_common::ExecutionMode::VECTORIZED ||
+                 execMode == mcrt_common::ExecutionMode::XPU)) {
+                mRenderStats->logPoolHighWater(pbr::TLState::getRayStatePoolHighWater(),
+                                               pbr::TLState::getRayStatePoolSize(),
+                                               pbr::TLState::getCL1PoolHighWater(),
+                                               pbr::TLState::getCL1PoolSize());
+            }
+
             mRenderStats->logRenderOutputs(mSceneContext->getAllRenderOutputs());
         } else {
             mLogTime = false;
@@ -1157,6 +1355,20 @@ RenderContext::stopFrame()
 
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::StopFrameTag::RESET);
     mRenderPrepTimingStats->recTimeEnd(RenderPrepTimingStats::StopFrameTag::WHOLE);
+
+    writeTimelineTrace();
+}
+
+void
+RenderContext::writeTimelineTrace() const
+{
+    const std::string &filename = mOptions.getTimelineTraceFile();
+    if (filename.empty() || !mcrt_common::TimelineTrace::isEnabled()) {
+        return;
+    }
+    if (!mcrt_common::TimelineTrace::writeChromeTrace(filename)) {
+        Logger::error("Cannot write the timeline trace file \"", filename, "\"");
+    }
 }
 
 double
@@ -1223,6 +1435,50 @@ RenderContext::snapshotRenderBuffer(scene_rdl2::fb_util::RenderBuffer *renderBuf
     mDriver->snapshotRenderBuffer(MNRY_VERIFY(renderBuffer), untile, parallel);
 }
 
+bool
+RenderContext::snapshotDenoisedRenderBuffer(scene_rdl2::fb_util::RenderBuffer *renderBuffer, bool parallel,
+                                            std::string &errorMsg)
+{
+    snapshotRenderBuffer(renderBuffer, /*untile*/ true, parallel);
+
+    const std::string &mode = mOptions.getDenoiseMode();
+    if (mode.empty()) {
+        errorMsg = "Denoising is disabled";
+        return false;
+    }
+
+    // Guide buffers from the RenderOutputs flagged as denoiser inputs, when
+    // they are regular aovs.
+    auto snapshotGuide = [&](int rodIndex, scene_rdl2::fb_util::RenderBuffer *guide) {
+        if (rodIndex < 0) {
+            return false;
+        }
+        bool found = false;
+        switchAovType(*mRenderOutputDriver,
+                      rodIndex,
+                      [](const scene_rdl2::rdl2::RenderOutput * /*ro*/) {},
+                      [](const int /*aovIdx*/) {},
+                      [&](const int aovIdx) {
+                          snapshotAovBuffer(guide, aovIdx, /*untile*/ true, parallel);
+                          found = true;
+                      });
+        return found;
+    };
+
+    scene_rdl2::fb_util::RenderBuffer albedo;
+    scene_rdl2::fb_util::RenderBuffer normals;
+    const bool useAlbedo = snapshotGuide(mRenderOutputDriver->getDenoiserAlbedoInput(), &albedo);
+    const bool useNormals = snapshotGuide(mRenderOutputDriver->getDenoiserNormalInput(), &normals);
+
+    if (!mDenoiser) {
+        mDenoiser.reset(new RenderDenoiser);
+    }
+    return mDenoiser->denoise(mode, renderBuffer,
+                              useAlbedo ? &albedo : nullptr,
+                              useNormals ? &normals : nullptr,
+                              errorMsg);
+}
+
 void
 RenderContext::snapshotRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *renderBufferOdd, bool untile, bool parallel) const
 {
@@ -1255,7 +1511,8 @@ void
 RenderContext::snapshotDelta(scene_rdl2::fb_util::RenderBuffer *renderBuffer,
                              scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                              scene_rdl2::fb_util::ActivePixels &activePixels,
-                             bool parallel) const
+                             bool parallel,
+                             uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the renderBuffer/weightBuffer w/ ActivePixels information
 // for ProgressiveFrame message related logic. So renderBuffer is not normalized by weight yet.
@@ -1265,14 +1522,15 @@ RenderContext::snapshotDelta(scene_rdl2::fb_util::RenderBuffer *renderBuffer,
 // renderBuffer/weightBuffer is tiled format and renderBuffer is not normalized by weight.
 //
 {
-    mDriver->snapshotDelta(renderBuffer, weightBuffer, activePixels, parallel);
+    mDriver->snapshotDelta(renderBuffer, weightBuffer, activePixels, parallel, dirtyEpoch);
 }
 
 void
 RenderContext::snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                             scene_rdl2::fb_util::FloatBuffer *weightRenderBufferOdd,
                                             scene_rdl2::fb_util::ActivePixels &activePixelsRenderBufferOdd,
-                                            bool parallel) const
+                                            bool parallel,
+                                            uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the renderBufferOdd/weightRenderBufferOdd w/ ActivePixelsRenderBufferOdd information
 // for ProgressiveFrame message related logic. So renderBufferOdd is not normalized by weight yet.
@@ -1285,14 +1543,16 @@ RenderContext::snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *r
     mDriver->snapshotDeltaRenderBufferOdd(renderBufferOdd,
                                           weightRenderBufferOdd,
                                           activePixelsRenderBufferOdd,
-                                          parallel);
+                                          parallel,
+                                          dirtyEpoch);
 }
 
 void
 RenderContext::snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *pixelInfoBuffer,
                                       scene_rdl2::fb_util::FloatBuffer *pixelInfoWeightBuffer,
                                       scene_rdl2::fb_util::ActivePixels &activePixelsPixelInfo,
-                                      bool parallel) const
+                                      bool parallel,
+                                      uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the pixelInfoBuffer/pixelInfoWeightBuffer w/
 // ActivePixelsPixelInfo information for ProgressiveFrame message related logic.
@@ -1303,7 +1563,8 @@ RenderContext::snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *pixe
 {
     mDriver->snapshotDeltaPixelInfo(pixelInfoBuffer, pixelInfoWeightBuffer,
                                     activePixelsPixelInfo,
-                                    parallel);
+                                    parallel,
+                                    dirtyEpoch);
 }
 
 void
@@ -1311,7 +1572,8 @@ RenderContext::snapshotDeltaHeatMap(scene_rdl2::fb_util::HeatMapBuffer *heatMapB
                                     scene_rdl2::fb_util::FloatBuffer *heatMapWeightBuffer,
                                     scene_rdl2::fb_util::ActivePixels &activePixelsHeatMap,
                                     scene_rdl2::fb_util::FloatBuffer *heatMapSecBuffer,
-                                    bool parallel) const
+                                    bool parallel,
+                                    uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the heatMapBuffer/heatMapWeightBuffer w/ ActivePixelsHeatMap information
 // for ProgressiveFrame message related logic.
@@ -1325,13 +1587,15 @@ RenderContext::snapshotDeltaHeatMap(scene_rdl2::fb_util::HeatMapBuffer *heatMapB
                                   heatMapWeightBuffer,
                                   activePixelsHeatMap,
                                   heatMapSecBuffer,
-                                  parallel);
+                                  parallel,
+                                  dirtyEpoch);
 }
 
 void
 RenderContext::snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                                          scene_rdl2::fb_util::ActivePixels &activePixelsWeightBuffer,
-                                         bool parallel) const
+                                         bool parallel,
+                                         uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the weightBuffer w/ ActivePixelsWeightBuffer information
 // for ProgressiveFrame message related logic.
@@ -1342,7 +1606,8 @@ RenderContext::snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *weigh
 {
     mDriver->snapshotDeltaWeightBuffer(weightBuffer,
                                        activePixelsWeightBuffer,
-                                       parallel);
+                                       parallel,
+                                       dirtyEpoch);
 }
 
 void
@@ -1352,7 +1617,8 @@ RenderContext::snapshotDeltaRenderOutput(unsigned int rodIndex,
                                          scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
                                          bool parallel,
                                          bool& denoiserAlbedoInput,
-                                         bool& denoiserNormalInput) const
+                                         bool& denoiserNormalInput,
+                                         uint32_t *dirtyEpoch) const
 //
 // Snapshots the contents of the renderOutputBuffer(rodIndex)/renderOutputWeightBuffer(rodIndex) w/
 // ActivePixelsRenderOutput information for ProgressiveFrame message related logic.
@@ -1370,14 +1636,16 @@ RenderContext::snapshotDeltaRenderOutput(unsigned int rodIndex,
                                                           renderOutputBuffer,
                                                           renderOutputWeightBuffer,
                                                           activePixelsRenderOutput,
-                                                          parallel);
+                                                          parallel,
+                                                          dirtyEpoch);
                   },
                   [&](const int aovIdx) { // regular AOV
                       mDriver->snapshotDeltaAov(aovIdx,
                                                 renderOutputBuffer,
                                                 renderOutputWeightBuffer,
                                                 activePixelsRenderOutput,
-                                                parallel);
+                                                parallel,
+                                                dirtyEpoch);
                   });
 
     // DisplayFilter
@@ -1455,7 +1723,10 @@ RenderContext::snapshotAovBuffers(std::vector<scene_rdl2::fb_util::VariablePixel
                              snapshotVisibilityBuffer(&aovBuffers[aovIdx], aovIdx, untile, parallel);
                          },
                          [&](const int aovIdx) { // regular AOV
-                             snapshotAovBuffer(&aovBuffers[aovIdx], aovIdx, untile, parallel);
+                             // the files of the streamed aovs were written while rendering
+                             if (!mRenderOutputDriver->isAovStreamed(aovIdx)) {
+                                 snapshotAovBuffer(&aovBuffers[aovIdx], aovIdx, untile, parallel);
+                             }
                          });
 }
 
@@ -1829,6 +2100,7 @@ RenderContext::renderPrep(bool allowUnsupportedXPUFeatures)
             return RP_RESULT::CANCELED;
         }
         mFirstFrame = false;
+        mReloadedShaderDsos.clear(); // all the shaders were just updated
     } else if (mSceneUpdated) {
         // Call update() on all SceneObjects. Flag the shaders in the layer that have been updated and save to 
         // mChangedRootShaders. We will use these changed shaders to build the attribute tables below. Also flag the 
@@ -1880,6 +2152,46 @@ RenderContext::renderPrep(bool allowUnsupportedXPUFeatures)
             rt::ChangeFlag::UPDATE;
     }
 
+    // Reloaded shader DSOs only update the shaders of their classes. The geometry,
+    // BVH, lights and textures stay as they are, unless the materials using these
+    // shaders now request other primitive attributes.
+    if (!mReloadedShaderDsos.empty()) {
+        if (updateReloadedShaders()) {
+            geomChangeFlag = rt::ChangeFlag::ALL;
+            loadAllGeometries = true;
+        }
+        mReloadedShaderDsos.clear();
+    }
+
+    // A canceled render prep leaves its geometry changes to the next one. The geometry
+    // it generated and tessellated is kept as long as the scene didn't change since, so
+    // only the remaining work is done again.
+    if (mCanceledGeomChangeFlag != rt::ChangeFlag::NONE) {
+        if (!mKeepCanceledPrepWork) {
+            mGeometryManager->discardCanceledWork();
+        }
+        geomChangeFlag = std::max(geomChangeFlag, mCanceledGeomChangeFlag);
+        loadAllGeometries = loadAllGeometries || geomChangeFlag == rt::ChangeFlag::ALL;
+    }
+
+    // Fast preview: a render prep which loads all the geometry of an interactive session
+    // only builds coarse geometry. Meshes keep their control mesh resolution and the BVH
+    // is built for build speed, so the first image shows up long before the full
+    // tessellation is done. Tessellation finalizes the meshes, so the full quality
+    // geometry of the next render prep reloads the procedurals.
+    if (mPreviewPrep) {
+        geomChangeFlag = rt::ChangeFlag::ALL;
+        loadAllGeometries = true;
+        mPreviewPrep = false;
+        mGeometryManager->discardCanceledWork(); // coarse geometry
+    } else if (geomChangeFlag == rt::ChangeFlag::ALL && mOptions.getFastPreview() && !mKeepCanceledPrepWork &&
+               (getRenderMode() == RenderMode::PROGRESSIVE || getRenderMode() == RenderMode::PROGRESSIVE_FAST)) {
+        mPreviewPrep = true;
+        Logger::info("Fast preview: building coarse geometry, the next frame builds the full geometry.");
+    }
+    // A budget of 1 face leaves every mesh at its base face count.
+    mGeometryManager->setTessellationFaceBudget(mPreviewPrep ? 1 : mOptions.getTessellationFaceBudget());
+
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::FLAG_STATUS_UPDATE);
 
     // Clear stats and logs on each frame
@@ -1889,27 +2201,52 @@ RenderContext::renderPrep(bool allowUnsupportedXPUFeatures)
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::LOAD_GEOMETRIES, 0.0);
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::REPORT_GEOMETRY_MEMORY, 0.0);
 
+    // The material aov flags only depend on the primitive attribute tables and
+    // the aov schema, not on the geometry, so they are set up while the geometry
+    // loads. The geometry manager only reads the attribute tables of the
+    // material extensions.
+    tbb::task_group prepTasks;
+    prepTasks.run([this]() {
+        // setup primitive attribute aov flags in the materials
+        buildMaterialAovFlags();
+    });
+
     RP_RESULT execResult = RP_RESULT::FINISHED;
-    if (geomChangeFlag != rt::ChangeFlag::NONE) {
-        execResult = loadGeometries(geomChangeFlag);
-
-        mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::LOAD_GEOMETRIES);
-
-        // Report memory footprint for geometry primitives.
-        if (mOptions.getApplicationMode() != ApplicationMode::MOTIONCAPTURE) {
-            if (mRenderStats->getLogInfo() ||
-                mRenderStats->getLogCsv()  ||
-                mRenderStats->getLogAthena()) {
-                reportGeometryTessellationTime();
-                reportGeometryMemory();
+    try {
+        if (geomChangeFlag != rt::ChangeFlag::NONE) {
+            scene_rdl2::rec_time::RecTime phaseTime;
+            phaseTime.start();
+            execResult = loadGeometries(geomChangeFlag);
+            mRenderPrepExecTracker.addPhaseTime("loadGeometries", phaseTime.end());
+            if (execResult == RP_RESULT::CANCELED) {
+                mCanceledGeomChangeFlag = geomChangeFlag;
+                mKeepCanceledPrepWork = true;
+            } else {
+                mCanceledGeomChangeFlag = rt::ChangeFlag::NONE;
+                mKeepCanceledPrepWork = false;
+                mGeometryManager->discardCanceledWork();
             }
-        }
 
-        mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::REPORT_GEOMETRY_MEMORY);
+            mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::LOAD_GEOMETRIES);
+
+            // Report memory footprint for geometry primitives.
+            if (mOptions.getApplicationMode() != ApplicationMode::MOTIONCAPTURE) {
+                if (mRenderStats->getLogInfo() ||
+                    mRenderStats->getLogCsv()  ||
+                    mRenderStats->getLogAthena()) {
+                    reportGeometryTessellationTime();
+                    reportGeometryMemory();
+                }
+            }
+
+            mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::REPORT_GEOMETRY_MEMORY);
+        }
+    } catch (...) {
+        prepTasks.wait(); // loadGeometries() may throw
+        throw;
     }
 
-    // setup primitive attribute aov flags in the materials
-    buildMaterialAovFlags();
+    prepTasks.wait();
 
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::BUILD_MATERIAL_AOV_FLAGS);
 
@@ -1933,25 +2270,42 @@ RenderContext::renderPrep(bool allowUnsupportedXPUFeatures)
 
     mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::PBR_STATISTICS_RESET);
 
-    // Update PBR
-    RenderTimer timer(mRenderStats->mLoadPbrTime);
-    mPbrScene->preFrame(mRenderOutputDriver->getLightAovs(), mExecutionMode, *mGeometryManager, 
-                        loadAllGeometries, *mRenderStats);
-
-    mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::UPDATE_PBR);
-    mRenderPrepTimingStats->recTimeEnd(RenderPrepTimingStats::RenderPrepTag::WHOLE);
+    // The shadow linkings go into the GPU accelerator, update them first.
+    mPbrScene->updateShadowLinkings(*mGeometryManager);
 
     // Update XPU
+    // The GPU accelerator only reads the primitives and the shadow linkings,
+    // so it is built while the pbr scene updates the lights and their
+    // accelerators below.
+    tbb::task_group gpuTasks;
     if (mExecutionMode == mcrt_common::ExecutionMode::XPU) {
         // Any update to the scene causes render prep to re-run which resets mExecutionMode.
         // Thus we must recreate the GPU accelerator to sync up with any scene changes and to
         // fall back properly if there is a problem.  E.g. what if we were running in XPU mode and
         // then a delta was applied that contained something incompatible with XPU?
-        mGeometryManager->updateGPUAccelerator(allowUnsupportedXPUFeatures, getNumTBBThreads(), mLayer);
-        if (mGeometryManager->getGPUAccelerator() == nullptr) {
-            // fall back to vector mode
-            mExecutionMode = mcrt_common::ExecutionMode::VECTORIZED;
-        }
+        gpuTasks.run([this, allowUnsupportedXPUFeatures]() {
+            mGeometryManager->updateGPUAccelerator(allowUnsupportedXPUFeatures, getNumTBBThreads(), mLayer);
+        });
+    }
+
+    // Update PBR
+    try {
+        RenderTimer timer(mRenderStats->mLoadPbrTime);
+        mPbrScene->preFrame(mRenderOutputDriver->getLightAovs(), mExecutionMode, *mGeometryManager,
+                            loadAllGeometries, *mRenderStats);
+    } catch (...) {
+        gpuTasks.wait();
+        throw;
+    }
+
+    mRenderPrepTimingStats->recTime(RenderPrepTimingStats::RenderPrepTag::UPDATE_PBR);
+    mRenderPrepTimingStats->recTimeEnd(RenderPrepTimingStats::RenderPrepTag::WHOLE);
+
+    gpuTasks.wait();
+    if (mExecutionMode == mcrt_common::ExecutionMode::XPU &&
+        mGeometryManager->getGPUAccelerator() == nullptr) {
+        // fall back to vector mode
+        mExecutionMode = mcrt_common::ExecutionMode::VECTORIZED;
     }
     mRenderStats->mBuildGPUAcceleratorTime =
         mGeometryManager->getStatistics().mBuildGPUAcceleratorTime;
@@ -1983,9 +2337,35 @@ RenderContext::loadScene(std::stringstream &initMessages)
                 "@rdla_set");
     }
 
-    // Load each scene file in order.
+    // Map the binary scene files and start reading all of them in the
+    // background, in order, so the reads of the later files overlap the
+    // decoding of the earlier ones.
     const auto& sceneFiles = mOptions.getSceneFiles();
-    for (const auto& sceneFile : sceneFiles) {
+    std::vector<std::unique_ptr<MappedSceneFile>> mappedFiles(sceneFiles.size());
+    for (size_t i = 0; i < sceneFiles.size(); ++i) {
+        if (scene_rdl2::util::lowerCaseExtension(sceneFiles[i]) == "rdlb") {
+            mappedFiles[i].reset(new MappedSceneFile(sceneFiles[i]));
+        }
+    }
+    std::future<void> prefetchAll = std::async(std::launch::async, [&mappedFiles]() {
+        for (const auto& mappedFile : mappedFiles) {
+            if (mappedFile) {
+                mappedFile->prefetch();
+            }
+        }
+    });
+
+    // Wait for the background reads before the files get unmapped, even when
+    // decoding throws.
+    struct PrefetchJoin
+    {
+        ~PrefetchJoin() { mFuture.wait(); }
+        std::future<void>& mFuture;
+    } prefetchJoin {prefetchAll};
+
+    // Load each scene file in order.
+    for (size_t i = 0; i < sceneFiles.size(); ++i) {
+        const auto& sceneFile = sceneFiles[i];
         if (!sceneFile.empty()) {
             mRenderStats->logLoadingScene(initMessages, sceneFile);
             // Grab the file extension and convert it to lower case.
@@ -1997,9 +2377,26 @@ RenderContext::loadScene(std::stringstream &initMessages)
             }
 
             if (ext == "rdla") {
+                RenderTimer decodeTimer(mRenderStats->mLoadSceneDecodeTime);
                 asciiReader.fromFile(sceneFile);
             } else if (ext == "rdlb") {
-                binaryReader.fromFile(sceneFile);
+                if (mappedFiles[i]->isValid()) {
+                    // Reads whatever the background prefetch hasn't reached
+                    // yet, in parallel chunks.
+                    const double readStart = time::getTime();
+                    mappedFiles[i]->prefetch();
+                    const double decodeStart = time::getTime();
+                    binaryReader.fromStream(mappedFiles[i]->getStream());
+                    const double decodeEnd = time::getTime();
+
+                    mRenderStats->mLoadSceneReadTime += decodeStart - readStart;
+                    mRenderStats->mLoadSceneDecodeTime += decodeEnd - decodeStart;
+                    mRenderStats->logLoadedScene(initMessages, mappedFiles[i]->getSize(),
+                                                 decodeStart - readStart, decodeEnd - decodeStart);
+                } else {
+                    RenderTimer decodeTimer(mRenderStats->mLoadSceneDecodeTime);
+                    binaryReader.fromFile(sceneFile);
+                }
             } else {
                 throw scene_rdl2::except::RuntimeError(scene_rdl2::util::buildString(
                         "File '", sceneFile, "' has an unknown extension."
@@ -2027,11 +2424,66 @@ RenderContext::loadScene(std::stringstream &initMessages)
 
     // Apply any attribute overrides or scene variable overrides specified in
     // the RenderOptions.
-    applyAttributeOverrides(*mSceneContext, *mRenderStats, mOptions, initMessages);
+    rndr::applyAttributeOverrides(*mSceneContext, *mRenderStats, mOptions, initMessages);
+
+    if (!mOptions.getOlatOutput().empty()) {
+        createOlatRenderOutputs(initMessages);
+    }
 
     mRenderStats->logLoadingSceneReadDiskIO(initMessages);
 }
 
+void
+RenderContext::createOlatRenderOutputs(std::stringstream &initMessages)
+{
+    // The light AOVs of all the lights come out of the same camera paths and
+    // BSDF samples, each light is sampled at every vertex anyway.
+    std::vector<scene_rdl2::rdl2::Light *> lights;
+    std::for_each(mSceneContext->beginSceneObject(),
+                  mSceneContext->endSceneObject(),
+                  [&lights](const std::pair<std::string, scene_rdl2::rdl2::SceneObject*>& entry) {
+            if (entry.second->isA<scene_rdl2::rdl2::Light>()) {
+                lights.push_back(entry.second->asA<scene_rdl2::rdl2::Light>());
+            }
+        });
+    std::sort(lights.begin(), lights.end(),
+              [](const scene_rdl2::rdl2::Light *a, const scene_rdl2::rdl2::Light *b) {
+            return a->getName() < b->getName();
+        });
+
+    // One AOV per label, the LPEs select lights by label.
+    std::vector<std::string> labels;
+    for (scene_rdl2::rdl2::Light *light : lights) {
+        if (light->get(scene_rdl2::rdl2::Light::sLabel).empty()) {
+            scene_rdl2::rdl2::SceneObject::UpdateGuard guard(light);
+            light->set(scene_rdl2::rdl2::Light::sLabel, light->getName());
+        }
+        const std::string &label = light->get(scene_rdl2::rdl2::Light::sLabel);
+        if (std::find(labels.begin(), labels.end(), label) == labels.end()) {
+            labels.push_back(label);
+        } else {
+            Logger::warn("OLAT: light \"", light->getName(), "\" shares the label \"", label,
+                         "\" of a previous light, their contributions share an AOV.");
+        }
+    }
+
+    initMessages << "OLAT outputs to " << mOptions.getOlatOutput() << ":\n";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        std::ostringstream channel;
+        channel << "olat_" << std::setw(4) << std::setfill('0') << i;
+
+        scene_rdl2::rdl2::SceneObject *ro =
+            mSceneContext->createSceneObject("RenderOutput", "__olat__/" + channel.str());
+        scene_rdl2::rdl2::SceneObject::UpdateGuard guard(ro);
+        ro->set("result", scene_rdl2::rdl2::Int(scene_rdl2::rdl2::RenderOutput::RESULT_LIGHT_AOV));
+        ro->set("lpe", scene_rdl2::rdl2::String("C.*<L.'" + labels[i] + "'>"));
+        ro->set("file_name", scene_rdl2::rdl2::String(mOptions.getOlatOutput()));
+        ro->set("channel_name", scene_rdl2::rdl2::String(channel.str()));
+
+        initMessages << "  " << channel.str() << " : " << labels[i] << '\n';
+    }
+}
+
 void
 RenderContext::createPbrScene()
 {
@@ -2098,6 +2550,16 @@ RenderContext::updatePbrState(const FrameState &fs)
         static_cast<int>(pbr::VolumeOverlapMode::NUM_MODES));
     integratorParams.mIntegratorVolumeOverlapMode =
         static_cast<pbr::VolumeOverlapMode>(vars.get(scene_rdl2::rdl2::SceneVariables::sVolumeOverlapMode));
+    integratorParams.mVolumeLightCacheResolution               = mOptions.getVolumeLightCacheResolution();
+    integratorParams.mVolumeRatioTracking                      = mOptions.getVolumeRatioTracking();
+    integratorParams.mCostAttribution                          = mOptions.getCostAttribution();
+    integratorParams.mShadowRayRouletteThreshold               = mOptions.getShadowRayRouletteThreshold();
+    integratorParams.mVolumeShaderCacheSize                    = mOptions.getVolumeShaderCacheSize();
+    integratorParams.mPrimaryShadingCacheSize                  = mOptions.getPrimaryShadingCacheSize();
+    integratorParams.mPrimaryShadingCacheResolution            = mOptions.getPrimaryShadingCacheResolution();
+    integratorParams.mPresenceCacheSize                        = mOptions.getPresenceCacheSize();
+    integratorParams.mPresenceCacheResolution                  = mOptions.getPresenceCacheResolution();
+    integratorParams.mKeepPathGuide                            = mOptions.getKeepPathGuide();
 
     mIntegrator->update(fs, integratorParams);
 }
@@ -2112,54 +2574,33 @@ RenderContext::buildPrimitiveAttributeTables(
     // will not know which primitive attributes to load
 
     RenderTimer timer(mRenderStats->mBuildPrimAttrTableTime);
-    for (scene_rdl2::rdl2::RootShader * const s : rootShaders) {
+    scene_rdl2::rec_time::RecTime phaseTime;
+    phaseTime.start();
+
+    // Each root shader only writes its own extension object, so scenes with
+    // many materials build their tables in parallel. The extension objects
+    // are created up front, in a deterministic order, since creating a
+    // Material extension registers it in a global list.
+    const std::vector<scene_rdl2::rdl2::RootShader *> shaders(rootShaders.begin(), rootShaders.end());
+    for (scene_rdl2::rdl2::RootShader * const s : shaders) {
+        if (s->isA<scene_rdl2::rdl2::Material>()) {
+            s->getOrCreate<shading::Material>();
+        } else {
+            s->getOrCreate<shading::RootShader>();
+        }
+    }
+    tbb::parallel_for(size_t(0), shaders.size(), [&](size_t shaderId) {
+        scene_rdl2::rdl2::RootShader * const s = shaders[shaderId];
         moonray::shading::AttributeKeySet requiredKeys;
         moonray::shading::AttributeKeySet optionalKeys;
-
-        // Always add the following attributes for explicit shading via instancing
-        optionalKeys.insert(shading::StandardAttributes::sNormal);
-        optionalKeys.insert(shading::StandardAttributes::sdPds);
-        optionalKeys.insert(shading::StandardAttributes::sdPdt);
-        optionalKeys.insert(shading::StandardAttributes::sUv);
-        optionalKeys.insert(shading::StandardAttributes::sExplicitShading);
-
-        scene_rdl2::rdl2::ConstSceneObjectSet b;
-        s->getBindingTransitiveClosure(b);
-        for (const scene_rdl2::rdl2::SceneObject * const o : b) {
-            if (o->isA<scene_rdl2::rdl2::Shader>()) {
-                const auto& reqKeys =
-                    o->asA<scene_rdl2::rdl2::Shader>()->getRequiredAttributes();
-                requiredKeys.insert(reqKeys.begin(), reqKeys.end());
-                const auto& optKeys =
-                    o->asA<scene_rdl2::rdl2::Shader>()->getOptionalAttributes();
-                optionalKeys.insert(optKeys.begin(), optKeys.end());
-            }
-        }
+        collectPrimitiveAttributeKeys(s, requiredKeys, optionalKeys);
 
         if (s->isA<scene_rdl2::rdl2::Material>()) {
-            // The render output driver might itself require certain attributes.
-            // Materials need to know what those attributes are so the
-            // intersection has access to them during MCRT time.
-            if (mRenderOutputDriver->requiresWireframe()) {
-                // see Aov.cc:sampleWireframe()
-                requiredKeys.insert(shading::StandardAttributes::sPolyVertexType);
-                requiredKeys.insert(shading::StandardAttributes::sNumPolyVertices);
-                optionalKeys.insert(shading::StandardAttributes::sPolyVertices,
-                    shading::StandardAttributes::sPolyVertices +
-                    shading::StandardAttributes::MAX_NUM_POLYVERTICES);
-            }
-            if (mRenderOutputDriver->requiresMotionVector()) {
-                // see Aov.cc:computeMotionVector()
-                optionalKeys.insert(shading::StandardAttributes::sMotion);
-            }
-            const auto &primAttrs = mRenderOutputDriver->getPrimAttrs();
-            optionalKeys.insert(primAttrs.begin(), primAttrs.end());
-
-            s->getOrCreate<shading::Material>().setAttributeTable(
+            s->get<shading::Material>().setAttributeTable(
                 std::unique_ptr<moonray::shading::AttributeTable>(
                 new moonray::shading::AttributeTable(requiredKeys, optionalKeys)));
         } else if (s->isA<scene_rdl2::rdl2::RootShader>()) {
-            s->getOrCreate<shading::RootShader>().setAttributeTable(
+            s->get<shading::RootShader>().setAttributeTable(
                 std::unique_ptr<moonray::shading::AttributeTable>(
                 new moonray::shading::AttributeTable(requiredKeys, optionalKeys)));
         }
@@ -2178,9 +2619,125 @@ RenderContext::buildPrimitiveAttributeTables(
             mLayer->setGeometryUpdated(find the geometry assigned to this shader);
         }
         */
+    });
+
+    mRenderPrepExecTracker.addPhaseTime("buildPrimitiveAttributeTables", phaseTime.end());
+}
+
+void
+RenderContext::collectPrimitiveAttributeKeys(const scene_rdl2::rdl2::RootShader *s,
+                                             shading::AttributeKeySet &requiredKeys,
+                                             shading::AttributeKeySet &optionalKeys) const
+{
+
+    // Always add the following attributes for explicit shading via instancing
+    optionalKeys.insert(shading::StandardAttributes::sNormal);
+    optionalKeys.insert(shading::StandardAttributes::sdPds);
+    optionalKeys.insert(shading::StandardAttributes::sdPdt);
+    optionalKeys.insert(shading::StandardAttributes::sUv);
+    optionalKeys.insert(shading::StandardAttributes::sExplicitShading);
+
+    scene_rdl2::rdl2::ConstSceneObjectSet b;
+    s->getBindingTransitiveClosure(b);
+    for (const scene_rdl2::rdl2::SceneObject * const o : b) {
+        if (o->isA<scene_rdl2::rdl2::Shader>()) {
+            const auto& reqKeys =
+                o->asA<scene_rdl2::rdl2::Shader>()->getRequiredAttributes();
+            requiredKeys.insert(reqKeys.begin(), reqKeys.end());
+            const auto& optKeys =
+                o->asA<scene_rdl2::rdl2::Shader>()->getOptionalAttributes();
+            optionalKeys.insert(optKeys.begin(), optKeys.end());
+        }
+    }
+
+    if (s->isA<scene_rdl2::rdl2::Material>()) {
+        // The render output driver might itself require certain attributes.
+        // Materials need to know what those attributes are so the
+        // intersection has access to them during MCRT time.
+        if (mRenderOutputDriver->requiresWireframe()) {
+            // see Aov.cc:sampleWireframe()
+            requiredKeys.insert(shading::StandardAttributes::sPolyVertexType);
+            requiredKeys.insert(shading::StandardAttributes::sNumPolyVertices);
+            optionalKeys.insert(shading::StandardAttributes::sPolyVertices,
+                shading::StandardAttributes::sPolyVertices +
+                shading::StandardAttributes::MAX_NUM_POLYVERTICES);
+        }
+        if (mRenderOutputDriver->requiresMotionVector()) {
+            // see Aov.cc:computeMotionVector()
+            optionalKeys.insert(shading::StandardAttributes::sMotion);
+        }
+        const auto &primAttrs = mRenderOutputDriver->getPrimAttrs();
+        optionalKeys.insert(primAttrs.begin(), primAttrs.end());
     }
 }
 
+bool
+RenderContext::updateReloadedShaders()
+{
+    // Find the shaders of the reloaded classes and the root shaders of both
+    // layers using them.
+    std::unordered_set<scene_rdl2::rdl2::SceneObject *> shaders;
+    scene_rdl2::rdl2::Layer::RootShaderSet rootShaders;
+    for (scene_rdl2::rdl2::Layer * const layer : { mLayer, mMeshLightLayer }) {
+        scene_rdl2::rdl2::Layer::RootShaderSet layerRootShaders;
+        layer->getAllRootShaders(layerRootShaders);
+        for (scene_rdl2::rdl2::RootShader * const s : layerRootShaders) {
+            scene_rdl2::rdl2::ConstSceneObjectSet b;
+            s->getBindingTransitiveClosure(b);
+            b.insert(s);
+            for (const scene_rdl2::rdl2::SceneObject * const o : b) {
+                if (o->isA<scene_rdl2::rdl2::Shader>() &&
+                    mReloadedShaderDsos.count(o->getSceneClass().getSourcePath())) {
+                    shaders.insert(const_cast<scene_rdl2::rdl2::SceneObject *>(o));
+                    rootShaders.insert(s);
+                }
+            }
+        }
+    }
+
+    // Bound shaders are updated before the root shaders, as applyUpdates() does.
+    for (scene_rdl2::rdl2::SceneObject * const o : shaders) {
+        if (!o->isA<scene_rdl2::rdl2::RootShader>()) {
+            o->update();
+        }
+    }
+    for (scene_rdl2::rdl2::SceneObject * const o : shaders) {
+        if (o->isA<scene_rdl2::rdl2::RootShader>()) {
+            o->update();
+        }
+    }
+
+    // The geometry keeps the primitive attributes of the current attribute
+    // tables, which are only replaced if the reloaded shaders request other
+    // attributes.
+    scene_rdl2::rdl2::Layer::RootShaderSet changedRootShaders;
+    for (scene_rdl2::rdl2::RootShader * const s : rootShaders) {
+        const shading::AttributeTable *table = s->isA<scene_rdl2::rdl2::Material>() ?
+            s->get<shading::Material>().getAttributeTable() :
+            s->get<shading::RootShader>().getAttributeTable();
+        shading::AttributeKeySet requiredKeys;
+        shading::AttributeKeySet optionalKeys;
+        collectPrimitiveAttributeKeys(s, requiredKeys, optionalKeys);
+        if (!table ||
+            requiredKeys != shading::AttributeKeySet(table->getRequiredAttributes().begin(),
+                                                     table->getRequiredAttributes().end()) ||
+            optionalKeys != shading::AttributeKeySet(table->getOptionalAttributes().begin(),
+                                                     table->getOptionalAttributes().end())) {
+            changedRootShaders.insert(s);
+        }
+    }
+
+    Logger::info("Reloaded shader DSOs: updated ", shaders.size(), " shaders used by ",
+                 rootShaders.size(), " root shaders.");
+    if (changedRootShaders.empty()) {
+        return false;
+    }
+
+    Logger::info("The reloaded shaders request other primitive attributes, reloading the geometry.");
+    buildPrimitiveAttributeTables(changedRootShaders);
+    return true;
+}
+
 void
 RenderContext::buildMaterialAovFlags()
 {
@@ -2189,6 +2746,9 @@ RenderContext::buildMaterialAovFlags()
     const auto &aovSchema = mRenderOutputDriver->getAovSchema();
     if (!aovSchema.size()) return;
 
+    scene_rdl2::rec_time::RecTime phaseTime;
+    phaseTime.start();
+
     // Gather all materials in shader network
     std::unordered_set<scene_rdl2::rdl2::Material *> materials;
     scene_rdl2::rdl2::Layer::MaterialSet topLevelMaterials;
@@ -2203,9 +2763,15 @@ RenderContext::buildMaterialAovFlags()
         }
     }
 
-    for (scene_rdl2::rdl2::Material *m : materials) {
-        // We need an extension object on all materials
-        shading::Material &ext = m->getOrCreate<shading::Material>();
+    // Each material only writes its own extension object, see
+    // buildPrimitiveAttributeTables() for why they are created up front.
+    const std::vector<scene_rdl2::rdl2::Material *> materialTbl(materials.begin(), materials.end());
+    for (scene_rdl2::rdl2::Material *m : materialTbl) {
+        m->getOrCreate<shading::Material>();
+    }
+    tbb::parallel_for(size_t(0), materialTbl.size(), [&](size_t materialId) {
+        scene_rdl2::rdl2::Material * const m = materialTbl[materialId];
+        shading::Material &ext = m->get<shading::Material>();
 
         // primitive attribute aovs
         // create a bool array, one entry per entry in the aov
@@ -2322,7 +2888,9 @@ RenderContext::buildMaterialAovFlags()
             ext.setExtraAovs(extraAovs);
             ext.setPostScatterExtraAovs(postScatterExtraAovs);
         }
-    }
+    });
+
+    mRenderPrepExecTracker.addPhaseTime("buildMaterialAovFlags", phaseTime.end());
 }
 
 void
@@ -2373,6 +2941,20 @@ RenderContext::loadGeometries(const rt::ChangeFlag flag)
     shading::PerGeometryAttributeKeySet perGeometryAttributes;
         scene->getCamera()->getRequiredPrimAttributes(perGeometryAttributes);
 
+    // Get the camera frustum and render to camera matrices for times points 0 and 1
+    // TODO: generalize for multi-segment motion blur. Currently we only have 2
+    // motion samples and assume the ray time points are 0 and 1. In multi-segment
+    // motion blur there will be multiple motion samples with a ray time range
+    // of [0,1].
+    std::vector<mcrt_common::Frustum> frustums;
+    const pbr::Camera *camera = scene->getCamera();
+    if (camera->hasFrustum()) {
+        frustums.push_back(mcrt_common::Frustum());
+        camera->computeFrustum(&frustums.back(), 0, true);  // frustum at shutter open
+        frustums.push_back(mcrt_common::Frustum());
+        camera->computeFrustum(&frustums.back(), 1, true);  // frustum at shutter close
+    }
+
     mGeometryManager->
         setStageIdAndCallBackLoadGeometries(0,
                                             mRenderPrepExecTracker.getRenderPrepStatsCallBack(),
@@ -2381,7 +2963,7 @@ RenderContext::loadGeometries(const rt::ChangeFlag flag)
         return RP_RESULT::CANCELED;
     }
     if (mGeometryManager->loadGeometries(mLayer, flag, world2render, currentFrame, motionBlurParams,
-                                         getNumTBBThreads(), perGeometryAttributes) ==
+                                         frustums, getNumTBBThreads(), perGeometryAttributes) ==
         rt::GeometryManager::GM_RESULT::CANCELED) {
         return RP_RESULT::CANCELED;
     }
@@ -2396,7 +2978,7 @@ RenderContext::loadGeometries(const rt::ChangeFlag flag)
         return RP_RESULT::CANCELED;
     }
     if (mGeometryManager->loadGeometries(mMeshLightLayer, flag, world2render, currentFrame, motionBlurParams,
-                                         getNumTBBThreads(), perGeometryAttributes) ==
+                                         frustums, getNumTBBThreads(), perGeometryAttributes) ==
         rt::GeometryManager::GM_RESULT::CANCELED) {
         return RP_RESULT::CANCELED;
     }
@@ -2415,22 +2997,10 @@ RenderContext::loadGeometries(const rt::ChangeFlag flag)
 
     mRenderStats->logEndGeneratingProcedurals();
 
-    // Get the camera frustum and render to camera matrices for times points 0 and 1
-    // TODO: generalize for multi-segment motion blur. Currently we only have 2
-    // motion samples and assume the ray time points are 0 and 1. In multi-segment
-    // motion blur there will be multiple motion samples with a ray time range
-    // of [0,1].
-    std::vector<mcrt_common::Frustum> frustums;
-    const pbr::Camera *camera = getScene()->getCamera();
-    if (camera->hasFrustum()) {
-        frustums.push_back(mcrt_common::Frustum());
-        camera->computeFrustum(&frustums.back(), 0, true);  // frustum at shutter open
-        frustums.push_back(mcrt_common::Frustum());
-        camera->computeFrustum(&frustums.back(), 1, true);  // frustum at shutter close
-    }
-
     // configure the way to construct spatial accelerator
-    constexpr rt::OptimizationTarget accelMode = rt::OptimizationTarget::HIGH_QUALITY_BVH_BUILD;
+    const rt::OptimizationTarget accelMode = mPreviewPrep ?
+                                             rt::OptimizationTarget::FAST_BVH_BUILD :
+                                             rt::OptimizationTarget::HIGH_QUALITY_BVH_BUILD;
 
     // this will trigger BVH build if needed.
     
@@ -2474,6 +3044,8 @@ RenderContext::loadGeometries(const rt::ChangeFlag flag)
         mGeometryManager->getStatistics().mPerPrimitiveTessellationTime;
     mRenderStats->mPerPrimitiveTessellationMemoryUsed =
         mGeometryManager->getStatistics().mPerPrimitiveTessellationMemoryUsed;
+    mRenderStats->mPerPrimitiveDisplacementStats =
+        mGeometryManager->getStatistics().mPerPrimitiveDisplacementStats;
     mRenderStats->mBuildAcceleratorTime =
         mGeometryManager->getStatistics().mBuildAcceleratorTime;
     mRenderStats->mBuildProceduralTime =
@@ -2518,12 +3090,17 @@ RenderContext::collectShaderStats()
             if (obj->isA<scene_rdl2::rdl2::Shader>()) {
                 const moonray::shading::ThreadLocalObjectState* threadLocalState =
                     obj->asA<scene_rdl2::rdl2::Shader>()->getThreadLocalObjectState();
+                moonray::util::AverageDouble occlusionTime;
                 if (threadLocalState != nullptr) {
                     for (int i = 0; i < numRenderThreads; i++) {
                         shaderCallStat += threadLocalState[i].mShaderCallStat;
+                        occlusionTime += threadLocalState[i].mOcclusionTime;
                     }
                 }
                 mRenderStats->mShaderCallStats[obj] = shaderCallStat;
+                if (obj->isA<scene_rdl2::rdl2::Material>() && occlusionTime.getCount() > 0) {
+                    mRenderStats->mMaterialOcclusionTime[obj] = occlusionTime;
+                }
             } else if (obj->isA<scene_rdl2::rdl2::Map>()) {
                 const moonray::shading::ThreadLocalObjectState* threadLocalState =
                     obj->asA<scene_rdl2::rdl2::Map>()->getThreadLocalObjectState();
@@ -2655,25 +3232,33 @@ RenderContext::reportXPUMemory()
 {
     size_t rayQueueBytes = mDriver->mXPURayQueue->getMemoryUsed();
     size_t occlusionRayQueueBytes = mDriver->mXPUOcclusionRayQueue->getMemoryUsed();
-    size_t cpuMemoryBytes = mGeometryManager->getGPUAccelerator()->getCPUMemoryUsed();
+    const rt::GPUAccelerator *gpuAccel = mGeometryManager->getGPUAccelerator();
+    size_t cpuMemoryBytes = gpuAccel->getCPUMemoryUsed();
+    std::vector<size_t> gpuMemoryBytes;
+    for (unsigned i = 0; i < gpuAccel->getNumDevices(); ++i) {
+        gpuMemoryBytes.push_back(gpuAccel->getGPUMemoryUsed(i));
+    }
 
-    mRenderStats->logXPUMemoryUsage(rayQueueBytes, occlusionRayQueueBytes, cpuMemoryBytes);
+    mRenderStats->logXPUMemoryUsage(rayQueueBytes, occlusionRayQueueBytes, cpuMemoryBytes, gpuMemoryBytes);
 }
 
-void
-RenderContext::reportGeometryMemory()
+namespace {
+
+// The procedurals of all the geometries in the scene, in scene order. The
+// memory and statistics reports walk the primitives of each of them in
+// parallel.
+std::vector<std::pair<const scene_rdl2::rdl2::Geometry*, geom::ProceduralLeaf*>>
+collectGeometryLeaves(scene_rdl2::rdl2::SceneContext& sceneContext)
 {
-    // Report memory footprint for geometry primitives
-    size_t totalGeometryBytes = 0;
-    std::vector<std::pair<std::string, size_t>> perGeometryBytes;
-    std::for_each(mSceneContext->beginGeometrySet(),
-        mSceneContext->endGeometrySet(),
+    std::vector<std::pair<const scene_rdl2::rdl2::Geometry*, geom::ProceduralLeaf*>> leaves;
+    std::for_each(sceneContext.beginGeometrySet(),
+        sceneContext.endGeometrySet(),
     [&](scene_rdl2::rdl2::GeometrySet* geometrySet) {
         const scene_rdl2::rdl2::SceneObjectIndexable& geometries = geometrySet->getGeometries();
         std::for_each(geometries.begin(), geometries.end(),
         [&](scene_rdl2::rdl2::SceneObject* sceneObject) {
-            geom::Procedural* procedural =
-                sceneObject->asA<scene_rdl2::rdl2::Geometry>()->getProcedural();
+            scene_rdl2::rdl2::Geometry* geometry = sceneObject->asA<scene_rdl2::rdl2::Geometry>();
+            geom::Procedural* procedural = geometry->getProcedural();
             // geometry can be in the GeometrySet but not added to layer
             // when user manually setup SceneContext by hand.
             if (procedural != nullptr) {
@@ -2682,23 +3267,36 @@ RenderContext::reportGeometryMemory()
                     throw scene_rdl2::except::NotImplementedError(
                         "Nested procedurals not supported yet.");
                 }
-                geom::ProceduralLeaf* leaf =
-                    static_cast<geom::ProceduralLeaf*>(procedural);
-                std::pair<std::string, size_t> geomMemInfo;
-                geomMemInfo.first = sceneObject->asA<scene_rdl2::rdl2::Geometry>()->getName();
-                size_t mem = leaf->getMemory();
-                geomMemInfo.second = mem;
-                perGeometryBytes.push_back(geomMemInfo);
-                totalGeometryBytes += mem;
+                leaves.emplace_back(geometry, static_cast<geom::ProceduralLeaf*>(procedural));
             }
         });
     });
+    return leaves;
+}
+
+} // namespace
+
+void
+RenderContext::reportGeometryMemory()
+{
+    // Report memory footprint for geometry primitives
+    const auto leaves = collectGeometryLeaves(*mSceneContext);
+    std::vector<std::pair<std::string, size_t>> perGeometryBytes(leaves.size());
+    tbb::parallel_for(size_t(0), leaves.size(), [&](size_t i) {
+        perGeometryBytes[i].first = leaves[i].first->getName();
+        perGeometryBytes[i].second = leaves[i].second->getMemory();
+    });
+
+    size_t totalGeometryBytes = 0;
+    for (const auto& geomMemInfo : perGeometryBytes) {
+        totalGeometryBytes += geomMemInfo.second;
+    }
 
     size_t bvhBytes = mGeometryManager->getEmbreeAccelerator()->getMemory();
     std::sort(perGeometryBytes.begin(),
           perGeometryBytes.end(),
-          [](std::pair<std::string, size_t> a,
-             std::pair<std::string, size_t> b) {
+          [](const std::pair<std::string, size_t>& a,
+             const std::pair<std::string, size_t>& b) {
           if (a.second < b.second) {
               return false;
           } else if (a.second > b.second) {
@@ -2715,40 +3313,16 @@ void
 RenderContext::reportGeometryStatistics()
 {
     // Report number of polys/cvs/curves/instances for geometry primitives
-    geom::GeometryStatistics totalGeomStatistics;
-    rndr::GeometryStatsTable perGeomStatistics;
-    std::for_each(mSceneContext->beginGeometrySet(),
-        mSceneContext->endGeometrySet(),
-    [&](scene_rdl2::rdl2::GeometrySet* geometrySet) {
-        const scene_rdl2::rdl2::SceneObjectIndexable& geometries = geometrySet->getGeometries();
-        std::for_each(geometries.begin(), geometries.end(),
-        [&](scene_rdl2::rdl2::SceneObject* sceneObject) {
-            geom::Procedural* procedural =
-                sceneObject->asA<scene_rdl2::rdl2::Geometry>()->getProcedural();
-            // geometry can be in the GeometrySet but not added to layer
-            // when user manually setup SceneContext by hand.
-            if (procedural) {
-                // TODO: We can't handle nested procedurals yet.
-                if (!procedural->isLeaf()) {
-                    throw scene_rdl2::except::NotImplementedError(
-                        "Nested procedurals not supported yet.");
-                }
-                geom::ProceduralLeaf* leaf =
-                    static_cast<geom::ProceduralLeaf*>(procedural);
-                geom::GeometryStatistics statistics = leaf->getStatistics();
-                perGeomStatistics.emplace_back(
-                        sceneObject->asA<scene_rdl2::rdl2::Geometry>()->getName(),
-                        statistics);
-            }
-        });
+    const auto leaves = collectGeometryLeaves(*mSceneContext);
+    rndr::GeometryStatsTable perGeomStatistics(leaves.size());
+    tbb::parallel_for(size_t(0), leaves.size(), [&](size_t i) {
+        perGeomStatistics[i].first = leaves[i].first->getName();
+        perGeomStatistics[i].second = leaves[i].second->getStatistics();
     });
 
-    for (int i = 0; i < perGeomStatistics.size(); ++i) {
-        totalGeomStatistics.mFaceCount += perGeomStatistics[i].second.mFaceCount;
-        totalGeomStatistics.mMeshVertexCount += perGeomStatistics[i].second.mMeshVertexCount;
-        totalGeomStatistics.mCurvesCount += perGeomStatistics[i].second.mCurvesCount;
-        totalGeomStatistics.mCVCount += perGeomStatistics[i].second.mCVCount;
-        totalGeomStatistics.mInstanceCount += perGeomStatistics[i].second.mInstanceCount;
+    geom::GeometryStatistics totalGeomStatistics;
+    for (const auto& geomStatistics : perGeomStatistics) {
+        totalGeomStatistics += geomStatistics.second;
     }
 
     mRenderStats->logGeometryUsage(totalGeomStatistics, perGeomStatistics);
@@ -2797,6 +3371,12 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
         fs->mMaxSamplesPerPixel = unsigned(numSamplesPerPixel * mMaxPixelSampleValue);
         fs->mMinSamplesPerPixel = fs->mMaxSamplesPerPixel;
         fs->mTargetAdaptiveError = 0.f;
+        fs->mAdaptiveErrorMetric = AdaptiveErrorMetricType::LUMINANCE;
+        fs->mAdaptiveStopGainPerMinute = 0.f;
+        fs->mAdaptiveRouletteBoost = 0.f;
+        fs->mUniformTileEarlyExitSamples = mOptions.getUniformTileEarlyExitSamples();
+        fs->mTileLocalAccumulation = mOptions.getTileLocalAccumulation();
+        fs->mDeterministic = mOptions.getDeterministic();
         fs->mPixelSampleMap = mPixelSampleMap.get();
 
     } else {
@@ -2809,6 +3389,12 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
         // by 10,000 in order to provide more user-friendly values (e.g. 2.0).
         const float targetAdaptiveError = vars.get(scene_rdl2::rdl2::SceneVariables::sTargetAdaptiveError) / 10000.0f;
         fs->mTargetAdaptiveError = std::max(0.000001f, targetAdaptiveError);
+        fs->mAdaptiveErrorMetric = mOptions.getAdaptiveErrorMetric();
+        fs->mAdaptiveStopGainPerMinute = std::max(0.f, mOptions.getAdaptiveStopGainPerMinute());
+        fs->mAdaptiveRouletteBoost = mOptions.getAdaptiveRouletteBoost();
+        fs->mUniformTileEarlyExitSamples = 0;
+        fs->mTileLocalAccumulation = false;
+        fs->mDeterministic = false;
         fs->mPixelSampleMap = nullptr;
     }
 
@@ -2816,6 +3402,8 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
     fs->mDeepCurvatureTolerance = vars.get(scene_rdl2::rdl2::SceneVariables::sDeepCurvatureTolerance);
     fs->mDeepZTolerance = vars.get(scene_rdl2::rdl2::SceneVariables::sDeepZTolerance);
     fs->mDeepVolCompressionRes = vars.get(scene_rdl2::rdl2::SceneVariables::sDeepVolCompressionRes);
+    fs->mStreamDeepOutput = mOptions.getStreamDeepOutput();
+    fs->mStreamOutput = mOptions.getStreamOutput();
 
     fs->mDeepIDChannelNames = MNRY_VERIFY(mDeepIDChannelNames.get());
     if (fs->mDeepIDChannelNames->size() > 6) {
@@ -2846,6 +3434,8 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
     fs->mLightAovs = &mRenderOutputDriver->getLightAovs();
     fs->mRequiresHeatMap = mRenderOutputDriver->requiresHeatMap();
     fs->mShadingWorkloadChunkSize = mOptions.getShadingWorkloadChunkSize();
+    fs->mShadingSortKey = mOptions.getShadingSortKey();
+    fs->mAdaptiveQueueSizes = mOptions.getAdaptiveQueueSizes();
     fs->mRequiresCryptomatteBuffer = mRenderOutputDriver->requiresCryptomatteBuffer();
 
     moonray::pbr::LightSamplingMode lightSamplingMode = static_cast<moonray::pbr::LightSamplingMode>(
@@ -2857,12 +3447,22 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
     fs->mNumRenderThreads = MNRY_VERIFY(getNumTBBThreads());
     fs->mEnableMcrtCpuAffinity = getTLSInitParams().mEnableMcrtCpuAffinity;
     fs->mAffinityCpuIdTbl = getTLSInitParams().mAffinityCpuIdTbl; // set cpuId table for CPU-Affinity control
+    fs->mNumaNodeTbl = getTLSInitParams().mNumaNodeTbl;
+    fs->mHugePageFilm = mOptions.getHugePageMode() != mcrt_common::HugePageMode::OFF;
+    fs->mTlbStats = mOptions.getTlbStats();
 
     int machineId = vars.get(scene_rdl2::rdl2::SceneVariables::sMachineId);
     int numMachines = vars.get(scene_rdl2::rdl2::SceneVariables::sNumMachines);
     fs->mNumRenderNodes = std::max(numMachines, 1);
     fs->mRenderNodeIdx = clamp(machineId, 0, (int)(fs->mNumRenderNodes - 1));
     fs->mTaskDistributionType = (unsigned)vars.get(scene_rdl2::rdl2::SceneVariables::sTaskDistributionType);
+    fs->mRenderNodeWeights.clear();
+    if (mRenderNodeWeights.size() == fs->mNumRenderNodes) {
+        fs->mRenderNodeWeights = mRenderNodeWeights;
+    }
+    fs->mFocusX = mFocusX;
+    fs->mFocusY = mFocusY;
+    fs->mFocusRadius = mFocusRadius;
 
     fs->mLockFrameNoise = vars.get(scene_rdl2::rdl2::SceneVariables::sLockFrameNoise);
 
@@ -2921,6 +3521,10 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
         }
         */
     }
+    if (mPreviewPrep && fs->mRenderMode == RenderMode::PROGRESSIVE) {
+        // The preview geometry is only good enough for fast mode shading.
+        fs->mRenderMode = RenderMode::PROGRESSIVE_FAST;
+    }
     fs->mFastMode = getFastRenderMode();
     fs->mRequiresDeepBuffer = mRenderOutputDriver->requiresDeepBuffer();
 
@@ -2940,6 +3544,34 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
 
     fs->mPixelFilter = MNRY_VERIFY(mPixelFilter.get());
 
+    // Time driven modes stop wherever the clock says and the vectorized modes
+    // queue up rays from any tile, neither can be reproduced.
+    if (fs->mDeterministic &&
+        (fs->mExecutionMode != mcrt_common::ExecutionMode::SCALAR ||
+         (fs->mRenderMode != RenderMode::BATCH && fs->mRenderMode != RenderMode::PROGRESSIVE) ||
+         fs->mNumRenderNodes != 1)) {
+        Logger::warn("Deterministic rendering needs a scalar batch or progressive render on a single machine, "
+                     "turning it off");
+        fs->mDeterministic = false;
+    } else if (mOptions.getDeterministic() && samplingMode != SamplingMode::UNIFORM) {
+        Logger::warn("Deterministic rendering needs uniform sampling, turning it off");
+    }
+
+    // The splats are gathered per tile by the full scalar pixel loop. Checkpoint and
+    // multi-machine renders only carry the per pixel buffers around.
+    fs->mPixelFilterSplat = mOptions.getPixelFilterSplat() &&
+                            fs->mTileLocalAccumulation &&
+                            !fs->mDeterministic && // splats land in tiles owned by other threads
+                            fs->mExecutionMode == mcrt_common::ExecutionMode::SCALAR &&
+                            fs->mRenderMode != RenderMode::PROGRESS_CHECKPOINT &&
+                            fs->mRenderMode != RenderMode::PROGRESSIVE_FAST &&
+                            fs->mNumRenderNodes == 1;
+    if (fs->mPixelFilterSplat &&
+        TileAccumulator::getGuardBand(fs->mPixelFilter->getRadius()) > TileAccumulator::sMaxGuardBand) {
+        Logger::warn("Pixel filter too wide to splat, importance sampling it instead");
+        fs->mPixelFilterSplat = false;
+    }
+
     fs->mFrameNumber = getCurrentFrame();
     fs->mFps = std::max(vars.get(scene_rdl2::rdl2::SceneVariables::sFpsKey), 1.f);
     if (mOptions.getFps() > 0.0f) {
@@ -2994,6 +3626,10 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
     fs->mCheckpointStartSPP = vars.get(scene_rdl2::rdl2::SceneVariables::sCheckpointStartSPP);
     // Setup checkpoint bg write mode
     fs->mCheckpointBgWrite = vars.get(scene_rdl2::rdl2::SceneVariables::sCheckpointBgWrite);
+    // Setup delta checkpoint
+    fs->mCheckpointDeltaMax = mOptions.getCheckpointDeltaMax();
+    fs->mCheckpointEmergencyDump = mOptions.getCheckpointEmergencyDump();
+    fs->mCheckpointTileReuse = mOptions.getCheckpointTileReuse();
 
     // two stage output mode condition
     fs->mTwoStageOutput = vars.get(scene_rdl2::rdl2::SceneVariables::sTwoStageOutput);
@@ -3011,6 +3647,8 @@ RenderContext::buildFrameState(FrameState *fs, double frameStartTime) const
 #endif
 
     fs->mDisplayFilterCount = mRenderOutputDriver->getDisplayFilterCount();
+    fs->mDisplayFilterThreads = mOptions.getDisplayFilterThreads();
+    fs->mTemporalReprojectionWeight = std::max(mOptions.getTemporalReprojectionWeight(), 0.0f);
 }
 
 void
@@ -3021,6 +3659,21 @@ RenderContext::buildAndSaveRayDatabase()
         return;
     }
 
+    if (pbr::DebugRayRecorder::isStreaming()) {
+        // the recorders have written their files when they stopped recording
+        size_t numVertices = 0;
+        size_t numBytes = 0;
+        pbr::forEachTLS([&](pbr::TLState *tls) {
+            numVertices += tls->mRayRecorder->getNumStreamedRayVertices();
+            numBytes += tls->mRayRecorder->getNumStreamedBytes();
+        });
+        Logger::info("Streamed debug rays, vertices = " , numVertices ,
+                     ", compressed size = " , numBytes / (1024 * 1024) , " MB, files = " ,
+                     pbr::DebugRayRecorder::getStreamFileName(
+                         sceneVars.get(scene_rdl2::rdl2::SceneVariables::sDebugRaysFile), 0) , " ...");
+        return;
+    }
+
     try {
         tbb::tick_count t0 = tbb::tick_count::now();
 
@@ -3151,6 +3804,7 @@ RenderContext::handlePickLightContributions(const int x, const int y,
                    * sceneVars.get(scene_rdl2::rdl2::SceneVariables::sPixelSamplesSqrt);
     numSamples = numSamples * numSamples;
 
+    std::lock_guard<std::mutex> lock(mPickBatchQueue->getGuiTLSMutex());
     moonray::pbr::computeLightContributions(tls, mPbrScene.get(), x, y,
             lightContributions, numSamples, 1.0f);
 }
@@ -3159,6 +3813,7 @@ const scene_rdl2::rdl2::Material*
 RenderContext::handlePickMaterial(const int x, const int y) const
 {
     ThreadLocalState *tls = getGuiTLS();
+    std::lock_guard<std::mutex> lock(mPickBatchQueue->getGuiTLSMutex());
     return moonray::pbr::computeMaterial(tls, mPbrScene.get(), x, y);
 }
 
@@ -3167,7 +3822,10 @@ RenderContext::handlePickGeometry(const int x, const int y) const
 {
     ThreadLocalState *tls = getGuiTLS();
     int assignmentId = -1;
-    moonray::pbr::computePrimitive(tls, mPbrScene.get(), x, y, assignmentId);
+    {
+        std::lock_guard<std::mutex> lock(mPickBatchQueue->getGuiTLSMutex());
+        moonray::pbr::computePrimitive(tls, mPbrScene.get(), x, y, assignmentId);
+    }
 
     // If we didn't pick anything return NULL
     if (assignmentId == -1) {
@@ -3184,7 +3842,10 @@ RenderContext::handlePickGeometryPart(const int x, const int y, std::string& par
 {
     ThreadLocalState *tls = getGuiTLS();
     int assignmentId = -1;
-    moonray::pbr::computePrimitive(tls, mPbrScene.get(), x, y, assignmentId);
+    {
+        std::lock_guard<std::mutex> lock(mPickBatchQueue->getGuiTLSMutex());
+        moonray::pbr::computePrimitive(tls, mPbrScene.get(), x, y, assignmentId);
+    }
 
     // If we didn't pick anything return NULL
     if (assignmentId == -1) {
@@ -3197,6 +3858,54 @@ RenderContext::handlePickGeometryPart(const int x, const int y, std::string& par
     return geomPartPair.first;
 }
 
+void
+RenderContext::handlePickBatch(const std::vector<scene_rdl2::math::Vec2i> &pixels, unsigned queries,
+                               PickBatchCallback callback) const
+{
+    const scene_rdl2::rdl2::SceneVariables& sceneVars = mSceneContext->getSceneVariables();
+    // Same sample count as handlePickLightContributions()
+    int numSamples = sceneVars.get(scene_rdl2::rdl2::SceneVariables::sLightSamplesSqrt)
+                   * sceneVars.get(scene_rdl2::rdl2::SceneVariables::sPixelSamplesSqrt);
+    numSamples = numSamples * numSamples;
+
+    mPickBatchQueue->submit([this, pixels, queries, numSamples, callback](const std::atomic<bool> &canceled) {
+        ThreadLocalState *tls = getGuiTLS();
+        std::vector<PickResult> results(pixels.size());
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            if (canceled) {
+                return;
+            }
+
+            PickResult &result = results[i];
+            result.mX = pixels[i].x;
+            result.mY = pixels[i].y;
+
+            // Released between pixels to let the synchronous picks through
+            std::lock_guard<std::mutex> lock(mPickBatchQueue->getGuiTLSMutex());
+            if (queries & PICK_MATERIAL) {
+                result.mMaterial = moonray::pbr::computeMaterial(tls, mPbrScene.get(), result.mX, result.mY);
+            }
+            if (queries & PICK_GEOMETRY) {
+                int assignmentId = -1;
+                moonray::pbr::computePrimitive(tls, mPbrScene.get(), result.mX, result.mY, assignmentId);
+                if (assignmentId != -1) {
+                    scene_rdl2::rdl2::Layer::GeometryPartPair geomPartPair = mLayer->lookupGeomAndPart(assignmentId);
+                    result.mGeometry = geomPartPair.first;
+                    result.mPart = geomPartPair.second;
+                }
+            }
+            if (queries & PICK_LIGHT_CONTRIBUTIONS) {
+                moonray::pbr::computeLightContributions(tls, mPbrScene.get(), result.mX, result.mY,
+                                                        result.mLightContributions, numSamples, 1.0f);
+            }
+        }
+
+        if (!canceled) {
+            callback(std::move(results));
+        }
+    });
+}
+
 bool
 RenderContext::handlePickLocation(const int x, const int y, scene_rdl2::math::Vec3f *hitPoint) const
 {
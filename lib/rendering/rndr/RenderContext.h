@@ -6,10 +6,13 @@
 #ifndef RENDERCONTEXT_H
 #define RENDERCONTEXT_H
 
+#include "PickBatchQueue.h"
 #include "RenderOptions.h"
 #include "RenderPrepExecTracker.h"
 #include "Types.h"
 
+#include <moonray/rendering/bvh/shading/AttributeKey.h>
+
 #include <scene_rdl2/common/fb_util/FbTypes.h>
 #include <scene_rdl2/common/grid_util/Arg.h>
 #include <scene_rdl2/common/grid_util/Parser.h>
@@ -19,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -54,6 +58,8 @@ namespace rndr {
 
 struct FrameState;
 struct RealtimeFrameStats;
+class MemoryWatchdog;
+class RenderDenoiser;
 class RenderDriver;
 class RenderOutputDriver;
 struct RenderPrepTimingStats;
@@ -148,7 +154,11 @@ public:
      * Sets the scene updated flag to true, which can happen if the
      * SceneContext is modified externally
      */
-    void setSceneUpdated() { mSceneUpdated = true; }
+    void setSceneUpdated()
+    {
+        mSceneUpdated = true;
+        mKeepCanceledPrepWork = false;
+    }
 
 
     /**
@@ -175,6 +185,27 @@ public:
     void invalidateAllTextureResources();
     void invalidateTextureResources(const std::vector<std::string>& resources);
 
+    /**
+     * Updates the shaders whose DSOs changed, e.g. the files reported by a
+     * ChangeWatcher set up with watchShaderDsos(), once their SceneClass has
+     * loaded the new code. The next startFrame() only calls update() on the
+     * shaders of these classes. The geometry, BVH, lights and texture cache
+     * stay resident unless the root shaders using them now request other
+     * primitive attributes. Must be called between renders.
+     *
+     * @param   changedDsos The source paths of the changed DSOs.
+     */
+    void reloadShaderDsos(const std::set<std::string>& changedDsos);
+
+    /**
+     * Applies a batch of attribute overrides, e.g. the edits of a lighting
+     * tool, as a single scene update and logs the render prep scope they
+     * trigger. Must be called between renders.
+     *
+     * @param   overrides   The overrides, the last one of an attribute wins.
+     */
+    void applyAttributeOverrides(const std::vector<RenderOptions::AttributeOverride>& overrides);
+
     /**
      * Signals that you want to stop rendering a frame. This will trigger
      * cancelation logic in each of the active render threads. This function
@@ -221,6 +252,16 @@ public:
      */
     void snapshotRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *renderBufferOdd, bool untile, bool parallel) const;
 
+    /**
+     * Snapshots the untiled render buffer and denoises it with the mode set by
+     * RenderOptions::setDenoiseMode(), guided by the RenderOutputs flagged as
+     * albedo and normal denoiser inputs. The denoiser is kept between calls, so
+     * this can run on each progressive snapshot. Returns false, with errorMsg
+     * set and the snapshot left undenoised, if denoising is off or fails.
+     */
+    bool snapshotDenoisedRenderBuffer(scene_rdl2::fb_util::RenderBuffer *renderBuffer, bool parallel,
+                                      std::string &errorMsg);
+
     /**
      * Snapshots the contents of the renderBuffer/weightBuffer w/ ActivePixels information
      * for ProgressiveFrame message related logic. So renderBuffer is not normalized by weight yet.
@@ -228,11 +269,16 @@ public:
      * Just create snapshot data with properly constructed activePixels based on
      * difference between current and previous renderBuffer and weightBuffer.
      * renderBuffer/weightBuffer is tiled format and renderBuffer is not normalized by weight.
+     *
+     * With a dirtyEpoch, the snapshotDelta functions only compare the tiles written since
+     * the previous call with the same dirtyEpoch. Use one per destination buffer, set to 0
+     * whenever the destination buffer is reset.
      */
     void snapshotDelta(scene_rdl2::fb_util::RenderBuffer *renderBuffer,
                        scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                        scene_rdl2::fb_util::ActivePixels &activePixels,
-                       bool parallel) const;
+                       bool parallel,
+                       uint32_t *dirtyEpoch = nullptr) const;
 
     /**
      * Snapshots the contents of the renderBufferOdd/weightRenderBufferOdd w/ ActivePixelsRenderBufferOdd information
@@ -245,7 +291,8 @@ public:
     void snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                       scene_rdl2::fb_util::FloatBuffer *weightBufferOdd,
                                       scene_rdl2::fb_util::ActivePixels &activePixelsOdd,
-                                      bool parallel) const;
+                                      bool parallel,
+                                      uint32_t *dirtyEpoch = nullptr) const;
 
     /**
      * Snapshots the contents of the pixelInfoBuffer/pixelInfoWeightBuffer w/
@@ -257,7 +304,8 @@ public:
     void snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *pixelInfoBuffer,
                                 scene_rdl2::fb_util::FloatBuffer *pixelInfoWeightBuffer,
                                 scene_rdl2::fb_util::ActivePixels &activePixelsPixelInfo,
-                                bool parallel) const;
+                                bool parallel,
+                                uint32_t *dirtyEpoch = nullptr) const;
 
     /**
      * Snapshots the contents of the heatMapBuffer/heatMapWeightBuffer w/ ActivePixelsHeatMap information
@@ -271,7 +319,8 @@ public:
                               scene_rdl2::fb_util::FloatBuffer *heatMapWeightBuffer,
                               scene_rdl2::fb_util::ActivePixels &activePixelsHeatMap,
                               scene_rdl2::fb_util::FloatBuffer *heatMapSecBuffer,
-                              bool parallel) const;
+                              bool parallel,
+                              uint32_t *dirtyEpoch = nullptr) const;
 
     /**
      * Snapshots the contents of the weightBuffer w/ ActivePixelsWeightBuffer information
@@ -282,7 +331,8 @@ public:
      */
     void snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                                    scene_rdl2::fb_util::ActivePixels &activePixelsWeightBuffer,
-                                   bool parallel) const;
+                                   bool parallel,
+                                   uint32_t *dirtyEpoch = nullptr) const;
 
     /**
      * Snapshots the contents of the renderOutputBuffer(rodIndex)/renderOutputWeightBuffer(rodIndex) w/
@@ -297,7 +347,8 @@ public:
                                    scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
                                    bool parallel,
                                    bool& denoiserAlbedoInput,
-                                   bool& denoiserNormalInput) const;
+                                   bool& denoiserNormalInput,
+                                   uint32_t *dirtyEpoch = nullptr) const;
 
     // Don't need to snapshot here, yet.
     const pbr::DeepBuffer* getDeepBuffer() const;
@@ -425,6 +476,14 @@ public:
      */
     bool isFrameReadyForDisplay() const;
 
+    /**
+     * Returns true if the current frame renders the coarse preview geometry of
+     * RenderOptions::getFastPreview(). The application restarts the frame once the
+     * preview is displayed, the render prep of the next frame builds the full
+     * quality geometry.
+     */
+    bool isPreviewFrame() const { return mPreviewPrep; }
+
     /**
      * Returns true if the render context has been initialized
      */
@@ -441,6 +500,23 @@ public:
     void setMultiMachineGlobalProgressFraction(float fraction); // for multi-machine configuration
     float getMultiMachineGlobalProgressFraction() const;
 
+    // Tile ownership weights of each render node for multi-machine dynamic load balancing, computed by
+    // RenderNodeBalancer. Applied at the next render start. Empty weights mean the equal distribution.
+    void setRenderNodeWeights(const std::vector<float> &weights) { mRenderNodeWeights = weights; }
+    const std::vector<float> &getRenderNodeWeights() const { return mRenderNodeWeights; }
+
+    // Focus point (pixel coordinates, i.e. the mouse cursor or the gaze of the viewer) of progressive
+    // renders. The tiles within radius pixels are rendered first in every pass and adaptive sampling
+    // converges them first. Applied at the next render start. A radius of 0 removes the focus.
+    void setFocus(float x, float y, float radius)
+    {
+        mFocusX = x;
+        mFocusY = y;
+        mFocusRadius = (radius > 0.0f) ? radius : 0.0f;
+    }
+    void clearFocus() { mFocusRadius = 0.0f; }
+    bool hasFocus() const { return mFocusRadius > 0.0f; }
+
     bool isVectorizationDesired() const {
         return mOptions.getDesiredExecutionMode() == mcrt_common::ExecutionMode::VECTORIZED;
     }
@@ -505,6 +581,16 @@ public:
     /// @returns true if something was hit, false if not.
     bool handlePickLocation(const int x, const int y, scene_rdl2::math::Vec3f *hitPoint) const;
 
+    /// Asynchronous picking of many pixels at once, for the 'queries' (PickQuery
+    /// bits) of the handlePick* calls above. Returns immediately: the pixels are
+    /// picked in the background while rendering goes on, see PickBatchQueue, and
+    /// the callback is called with the results from the picking thread once the
+    /// batch is done. The pending batches are canceled, without calling their
+    /// callback, when the frame stops, i.e. before the scene can change.
+    /// The x, y coordinates are assumed to be relative to the region window.
+    void handlePickBatch(const std::vector<scene_rdl2::math::Vec2i> &pixels, unsigned queries,
+                         PickBatchCallback callback) const;
+
     RenderStats& getSceneRenderStats()             { return *mRenderStats; }
     const RenderStats& getSceneRenderStats() const { return *mRenderStats; }
 
@@ -518,6 +604,9 @@ public:
 
     RenderOutputDriver* getRenderOutputDriver() { return mRenderOutputDriver.get(); }
     const RenderOutputDriver* getRenderOutputDriver() const { return mRenderOutputDriver.get(); }
+    // Shares the ownership of the render output driver, which outlives the next renderPrep then.
+    // Used by the outputs of a frame written in the background while the next frame renders.
+    std::shared_ptr<const RenderOutputDriver> shareRenderOutputDriver() const { return mRenderOutputDriver; }
 
     ResumeHistoryMetaData *getResumeHistoryMetaData() { return mResumeHistoryMetaData.get(); }
     const ResumeHistoryMetaData *getResumeHistoryMetaData() const { return mResumeHistoryMetaData.get(); }
@@ -561,6 +650,10 @@ private:
     // Helper function which loads the scene into the SceneContext.
     void loadScene(std::stringstream &initMessages);
 
+    // Adds a light AOV RenderOutput per light label of the scene, written to
+    // the -olat_output file. Lights without a label get their name as label.
+    void createOlatRenderOutputs(std::stringstream &initMessages);
+
     // Helper function which creates a PBR scene.
     void createPbrScene();
 
@@ -572,6 +665,17 @@ private:
     // required to shade each Shader.
     void buildPrimitiveAttributeTables(const scene_rdl2::rdl2::Layer::RootShaderSet &rootShaders);
 
+    // The primitive attributes requested by a root shader and the shaders
+    // bound to it.
+    void collectPrimitiveAttributeKeys(const scene_rdl2::rdl2::RootShader *s,
+                                       shading::AttributeKeySet &requiredKeys,
+                                       shading::AttributeKeySet &optionalKeys) const;
+
+    // Updates the shaders of mReloadedShaderDsos. Returns true if the root
+    // shaders using them request other primitive attributes, their attribute
+    // tables are rebuilt and the geometry has to be loaded again.
+    bool updateReloadedShaders();
+
     // updates material with information about which of its primitive
     // attributes are also requested aovs in the aov schema
     void buildMaterialAovFlags();
@@ -601,6 +705,12 @@ private:
     // Report any logging that occurred during shading
     void reportShadingLogs();
 
+    // Writes the timeline recorded so far when -trace_timeline is set
+    void writeTimelineTrace() const;
+
+    // Starts the memory watchdog of the frame when -memory_budget is set
+    void startMemoryWatchdog();
+
     // Report tessellation time for geometry primitives
     void reportGeometryTessellationTime();
 
@@ -646,6 +756,10 @@ private:
     std::shared_ptr<RenderDriver> mDriver;
 
     float mMultiMachineGlobalProgressFraction {0.0f};
+    std::vector<float> mRenderNodeWeights;
+    float mFocusX {0.0f};
+    float mFocusY {0.0f};
+    float mFocusRadius {0.0f};
 
     /// GeometryManager manages all geometries in the scene for ray tracing.
     /// It handles proper update for changes and provides acceleration data
@@ -698,7 +812,11 @@ private:
     std::atomic_bool mRenderPrepRun;
     bool mRendering; // Are we actively rendering?
     bool mFirstFrame; // Is this the first frame the context has rendered?
+    bool mPreviewPrep; // Is the geometry the coarse preview of fast preview?
+    rt::ChangeFlag mCanceledGeomChangeFlag; // Geometry changes a canceled render prep left undone
+    bool mKeepCanceledPrepWork; // Is the work of the canceled render prep still valid?
     bool mSceneUpdated; // Has the scene been updated since the last render?
+    std::set<std::string> mReloadedShaderDsos; // DSOs reloaded since the last render prep
     bool mHasBeenInit; // Has the scene been initialized?
     bool mSceneLoaded; // Has the scene been loaded?
     bool mLogTime; // either first frame or previous frame logged timing
@@ -723,7 +841,16 @@ private:
     std::unique_ptr<geom::internal::Statistics> mGeomStatistics;
 
     // RenderOutput object management
-    std::unique_ptr<RenderOutputDriver> mRenderOutputDriver;
+    std::shared_ptr<RenderOutputDriver> mRenderOutputDriver;
+
+    // In process denoising of the render buffer snapshots
+    std::unique_ptr<RenderDenoiser> mDenoiser;
+
+    // Background picking, also serializes the use of the GUI TLS by the picks
+    std::unique_ptr<PickBatchQueue> mPickBatchQueue;
+
+    // Watches the process memory against RenderOptions::getMemoryBudgetMb() while rendering
+    std::unique_ptr<MemoryWatchdog> mMemoryWatchdog;
 
     // for Resume render
     std::string mOnResumeScript; // on resume script name
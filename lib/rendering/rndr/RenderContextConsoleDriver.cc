@@ -5,6 +5,7 @@
 //
 #include "RenderContextConsoleDriver.h"
 #include "RenderContext.h"
+#include "RenderDriver.h"
 
 #include <moonray/common/mcrt_macros/moonray_static_check.h>
 #include <moonray/rendering/texturing/sampler/TextureTLState.h>
@@ -32,6 +33,12 @@ RenderContextConsoleDriver::parserConfigure(Parser &parser)
                    if (!mRenderContext) return arg.msg("renderContext is nullptr\n");
                    return mRenderContext->getParser().main(arg.childArg());
                });
+    parser.opt("perf", "...command...", "live performance introspection command, same as renderDriver perf",
+               [&](Arg &arg) -> bool {
+                   std::shared_ptr<RenderDriver> driver = getRenderDriver();
+                   if (!driver) return arg.msg("renderDriver is nullptr\n");
+                   return driver->getPerfParser().main(arg.childArg());
+               });
     parser.opt("invalidateAllTexture", "", "invalidate all texture resources",
                [&](Arg &arg) -> bool {
                    std::lock_guard<std::mutex> lock(mMutexRenderContext);
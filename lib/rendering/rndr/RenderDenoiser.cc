@@ -0,0 +1,118 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "RenderDenoiser.h"
+
+#include <mcrt_denoise/denoiser/Denoiser.h>
+
+#include <cstring>
+#include <utility>
+
+namespace moonray {
+namespace rndr {
+
+namespace {
+
+bool
+toDenoiserMode(const std::string &mode, denoiser::DenoiserMode &denoiserMode)
+{
+    if (mode == "optix") {
+        denoiserMode = denoiser::OPTIX;
+    } else if (mode == "oidn") {
+        denoiserMode = denoiser::OPEN_IMAGE_DENOISE;
+    } else if (mode == "oidn_cpu") {
+        denoiserMode = denoiser::OPEN_IMAGE_DENOISE_CPU;
+    } else if (mode == "oidn_cuda") {
+        denoiserMode = denoiser::OPEN_IMAGE_DENOISE_CUDA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+RenderDenoiser::RenderDenoiser() :
+    mWidth(0),
+    mHeight(0),
+    mUseAlbedo(false),
+    mUseNormals(false)
+{
+}
+
+RenderDenoiser::~RenderDenoiser() = default;
+
+bool
+RenderDenoiser::isValidMode(const std::string &mode)
+{
+    denoiser::DenoiserMode denoiserMode;
+    return toDenoiserMode(mode, denoiserMode);
+}
+
+bool
+RenderDenoiser::denoise(const std::string &mode,
+                        scene_rdl2::fb_util::RenderBuffer *beauty,
+                        const scene_rdl2::fb_util::RenderBuffer *albedo,
+                        const scene_rdl2::fb_util::RenderBuffer *normals,
+                        std::string &errorMsg)
+{
+    denoiser::DenoiserMode denoiserMode;
+    if (!toDenoiserMode(mode, denoiserMode)) {
+        errorMsg = "Unknown denoiser mode '" + mode + "'";
+        return false;
+    }
+
+    const unsigned width = beauty->getWidth();
+    const unsigned height = beauty->getHeight();
+    for (const scene_rdl2::fb_util::RenderBuffer *guide : {albedo, normals}) {
+        if (guide && (guide->getWidth() != width || guide->getHeight() != height)) {
+            errorMsg = "Denoiser guide buffer size doesn't match the beauty buffer size";
+            return false;
+        }
+    }
+
+    const bool useAlbedo = albedo != nullptr;
+    const bool useNormals = normals != nullptr;
+    if (!mDenoiser || mode != mMode || width != mWidth || height != mHeight ||
+        useAlbedo != mUseAlbedo || useNormals != mUseNormals) {
+        mDenoiser.reset();
+        errorMsg.clear();
+        auto newDenoiser = std::make_unique<denoiser::Denoiser>(denoiserMode, width, height,
+                                                                useAlbedo, useNormals, &errorMsg);
+        if (!errorMsg.empty()) {
+            return false;
+        }
+        mDenoiser = std::move(newDenoiser);
+        mMode = mode;
+        mWidth = width;
+        mHeight = height;
+        mUseAlbedo = useAlbedo;
+        mUseNormals = useNormals;
+    }
+
+    if (mDenoised.getWidth() != width || mDenoised.getHeight() != height) {
+        mDenoised.init(width, height);
+    }
+
+    errorMsg.clear();
+    mDenoiser->denoise(reinterpret_cast<const float *>(beauty->getData()),
+                       useAlbedo ? reinterpret_cast<const float *>(albedo->getData()) : nullptr,
+                       useNormals ? reinterpret_cast<const float *>(normals->getData()) : nullptr,
+                       reinterpret_cast<float *>(mDenoised.getData()),
+                       &errorMsg);
+    if (!errorMsg.empty()) {
+        // Don't keep a denoiser which may be in a bad state.
+        mDenoiser.reset();
+        return false;
+    }
+
+    std::memcpy(beauty->getData(), mDenoised.getData(),
+                sizeof(scene_rdl2::fb_util::RenderColor) * width * height);
+    return true;
+}
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,61 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <scene_rdl2/common/fb_util/FbTypes.h>
+
+#include <memory>
+#include <string>
+
+namespace moonray {
+
+namespace denoiser { class Denoiser; }
+
+namespace rndr {
+
+class RenderDenoiser
+//
+// Denoises the beauty buffer in process, straight from the film snapshots,
+// instead of writing it out and running the standalone denoise tool on the
+// files.
+//
+// The OptiX and Open Image Denoise denoisers are expensive to create, so the
+// denoiser is kept and only recreated when the mode, the resolution or the
+// set of guide buffers changes. That keeps denoising each progressive
+// snapshot affordable.
+//
+{
+public:
+    RenderDenoiser();
+    ~RenderDenoiser();
+
+    // Modes accepted by denoise(), as the denoise tool's -mode: "optix",
+    // "oidn", "oidn_cpu" and "oidn_cuda".
+    static bool isValidMode(const std::string &mode);
+
+    // Denoises the untiled beauty buffer in place. The optional albedo and
+    // normal guide buffers must be untiled and of the same size. On failure
+    // beauty is left as it was.
+    bool denoise(const std::string &mode,
+                 scene_rdl2::fb_util::RenderBuffer *beauty,
+                 const scene_rdl2::fb_util::RenderBuffer *albedo,
+                 const scene_rdl2::fb_util::RenderBuffer *normals,
+                 std::string &errorMsg);
+
+private:
+    std::unique_ptr<denoiser::Denoiser> mDenoiser;
+    std::string mMode;
+    unsigned mWidth;
+    unsigned mHeight;
+    bool mUseAlbedo;
+    bool mUseNormals;
+
+    scene_rdl2::fb_util::RenderBuffer mDenoised;
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -7,6 +7,7 @@
 #include <moonray/rendering/pbr/core/Scene.h>
 
 #include "AdaptiveRenderTilesTable.h"
+#include "CheckpointDelta.h"
 #include "RenderDriver.h"
 #include "RenderContext.h"
 #include "PixelBufferUtils.h"
@@ -17,10 +18,13 @@
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/geom/prim/GeomTLState.h>
 #include <moonray/rendering/geom/prim/Statistics.h>
+#include <moonray/rendering/mcrt_common/NumaUtil.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/pbr/core/Aov.h>
 #include <moonray/rendering/pbr/core/DebugRay.h>
 #include <moonray/rendering/pbr/handlers/XPURayHandlers.h>
 #include <moonray/rendering/rt/gpu/GPUAccelerator.h>
+#include <moonray/rendering/texturing/sampler/TextureSampler.h>
 #include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
 
 #include <scene_rdl2/render/util/Memory.h>
@@ -30,6 +34,7 @@
 #include <scene_rdl2/render/util/ProcCpuAffinity.h>
 #endif
 
+#include <algorithm>
 #include <random>
 
 // Quick way to force a single sample per pixel. For debugging.
@@ -520,6 +525,7 @@ RenderDriver::RenderDriver(const TLSInitParams &initParams) :
     mCachedViewport(scene_rdl2::math::Viewport(0, 0, 0, 0)),
     mCachedSamplingMode(SamplingMode::UNIFORM),
     mCachedDisplayFilterCount(0),
+    mCachedPixelFilterSplat(false),
     mFilm(nullptr),
     mLastCoarsePassIdx(0),
     mTileScheduler(nullptr),
@@ -592,9 +598,7 @@ RenderDriver::RenderDriver(const TLSInitParams &initParams) :
 
     // We must wait for the render thread to get initialized before much of this
     // class becomes functional.
-    while (mRenderThreadState.get() == UNINITIALIZED) {
-        mcrt_common::threadSleep();
-    }
+    mRenderThreadState.waitWhile(UNINITIALIZED);
 }
 
 void
@@ -604,6 +608,16 @@ RenderDriver::setProcCpuAffinity(TLSInitParams& tlsInitParams)
     mEnableRenderPrepCpuAffinity = false;
     tlsInitParams.mEnableMcrtCpuAffinity = true; // default is MCRT CPU-Affinity = ON
 
+    // Explicit CPU or socket affinity takes precedence over NUMA placement. "-1" is the
+    // default CPU-Affinity definition, so it doesn't count as explicit.
+    const bool explicitAffinity =
+        (tlsInitParams.mCpuAffinityDef && !tlsInitParams.mCpuAffinityDef->empty() &&
+         (*tlsInitParams.mCpuAffinityDef) != "-1") ||
+        (tlsInitParams.mSocketAffinityDef && !tlsInitParams.mSocketAffinityDef->empty());
+    if (tlsInitParams.mNumaAware && !explicitAffinity && setNumaCpuAffinity(tlsInitParams)) {
+        return;
+    }
+
     scene_rdl2::CpuSocketUtil::CpuIdTbl cpuIdTbl;
     std::ostringstream ostr;
     std::string errMsg;
@@ -702,6 +716,39 @@ RenderDriver::setProcCpuAffinity(TLSInitParams& tlsInitParams)
 #endif // end ifndef PLATFORM_APPLE
 }
 
+bool
+RenderDriver::setNumaCpuAffinity(TLSInitParams& tlsInitParams)
+{
+    unsigned numThreads = tlsInitParams.mDesiredNumTBBThreads;
+    if (numThreads == 0) {
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+
+    mcrt_common::NumaTopology topology;
+    std::vector<unsigned> cpuIdTbl;
+    std::vector<unsigned> nodeTbl;
+    if (!topology.makeThreadPlacement(numThreads, cpuIdTbl, nodeTbl)) {
+        std::string msg = "NUMA placement skipped : single NUMA node";
+        Logger::info(msg);
+        if (isatty(STDOUT_FILENO)) std::cerr << msg << '\n';
+        return false;
+    }
+
+    // Only the MCRT threads are pinned, renderPrep keeps using every cpu.
+    tlsInitParams.mDesiredNumTBBThreads = numThreads;
+    tlsInitParams.mEnableMcrtCpuAffinity = true;
+    tlsInitParams.mAffinityCpuIdTbl = std::make_shared<std::vector<unsigned>>(cpuIdTbl);
+    tlsInitParams.mNumaNodeTbl = std::make_shared<std::vector<unsigned>>(nodeTbl);
+    mCpuAffinityCpuIdTbl = cpuIdTbl; // save for info display
+    mNumaNumNodes = topology.getNumNodes(); // save for info display
+
+    std::ostringstream ostr;
+    ostr << "NUMA placement numThreads:" << numThreads << ' ' << topology.show();
+    Logger::info(ostr.str());
+    if (isatty(STDOUT_FILENO)) std::cerr << ostr.str() << '\n';
+    return true;
+}
+
 RenderDriver::~RenderDriver()
 {
     stopFrame();
@@ -756,6 +803,51 @@ RenderDriver::getTiles() const
     }
 }
 
+CostTileScheduler *
+RenderDriver::getCostTileScheduler() const
+{
+    if (!mTileScheduler || mTileScheduler->getType() != TileScheduler::COST ||
+        mFs.mRenderMode != RenderMode::PROGRESSIVE ||
+        mLastCoarsePassIdx == MAX_RENDER_PASSES ||
+        mCheckpointEstimationStage ||
+        mFs.mFocusRadius > 0.0f) { // the focus order takes precedence
+        return nullptr;
+    }
+    return static_cast<CostTileScheduler *>(mTileScheduler.get());
+}
+
+void
+RenderDriver::applyCostTileOrder()
+{
+    CostTileScheduler *costTileScheduler = getCostTileScheduler();
+    if (!costTileScheduler) {
+        return;
+    }
+
+    std::vector<uint32_t> tileOrder;
+    std::vector<float> tileCosts;
+    if (costTileScheduler->computeCostTileOrder(tileOrder, tileCosts)) {
+        mTileWorkQueue.setTileOrder(mLastCoarsePassIdx + 1, tileOrder, tileCosts);
+    }
+}
+
+void
+RenderDriver::applyFocusTileOrder()
+{
+    if (mFs.mRenderMode != RenderMode::PROGRESSIVE || mFs.mFocusRadius <= 0.0f) {
+        if (mTileWorkQueue.hasTileOrder()) {
+            mTileWorkQueue.clearTileOrder();
+        }
+        return;
+    }
+
+    // All passes, the coarse passes included, start around the focus point.
+    std::vector<uint32_t> tileOrder;
+    std::vector<float> tileCosts;
+    mTileScheduler->computeFocusTileOrder(mFs.mFocusX, mFs.mFocusY, tileOrder, tileCosts);
+    mTileWorkQueue.setTileOrder(0, tileOrder, tileCosts);
+}
+
 void
 RenderDriver::startFrame(const FrameState &fs)
 {
@@ -770,6 +862,9 @@ RenderDriver::startFrame(const FrameState &fs)
     // This is set to true if either the tiles or passes were updated.
     bool updated = false;
 
+    // Set if the film buffers or the tiles changed, which moves the film's NUMA pages.
+    bool numaRebind = false;
+
     unsigned w = mFs.mWidth;
     unsigned h = mFs.mHeight;
     std::vector<unsigned int> aovChannels;
@@ -777,6 +872,9 @@ RenderDriver::startFrame(const FrameState &fs)
         aovChannels.push_back(entry.numChannels());
     }
 
+    // Temporal reprojection needs the pixel depths of the previous frame.
+    const bool generatePixelInfo = mFs.mGeneratePixelInfo || mFs.mTemporalReprojectionWeight > 0.0f;
+
     const bool needToUpdateBasedOnAdaptiveError = mFs.mSamplingMode == SamplingMode::ADAPTIVE &&
                                                  (mFs.mTargetAdaptiveError != mCachedTargetAdaptiveError);
 
@@ -784,7 +882,7 @@ RenderDriver::startFrame(const FrameState &fs)
         mCachedViewport != mFs.mViewport ||
         mFs.mRequiresDeepBuffer != mCachedRequiresDeepBuffer ||
         mFs.mRequiresCryptomatteBuffer != mCachedRequiresCryptomatteBuffer ||
-        mFs.mGeneratePixelInfo != mCachedGeneratePixelInfo ||
+        generatePixelInfo != mCachedGeneratePixelInfo ||
         aovChannels != mCachedAovChannels ||
         mFs.mRequiresHeatMap != mCachedRequiresHeatMap ||
         mFs.mDeepFormat != mCachedDeepFormat ||
@@ -794,7 +892,8 @@ RenderDriver::startFrame(const FrameState &fs)
         mFs.mDeepVolCompressionRes != mCachedDeepVolCompressionRes ||
         *(mFs.mDeepIDChannelNames) != mCachedDeepIDChannelNames ||
         mFs.mSamplingMode != mCachedSamplingMode ||
-        mFs.mDisplayFilterCount != mCachedDisplayFilterCount) {
+        mFs.mDisplayFilterCount != mCachedDisplayFilterCount ||
+        mFs.mPixelFilterSplat != mCachedPixelFilterSplat) {
 
         unsigned alignedW = scene_rdl2::util::alignUp(w, COARSE_TILE_SIZE);
         unsigned alignedH = scene_rdl2::util::alignUp(h, COARSE_TILE_SIZE);
@@ -807,7 +906,7 @@ RenderDriver::startFrame(const FrameState &fs)
         MNRY_ASSERT(mFilm);
         uint32_t filmFlags = 0;
         if (mFs.mSamplingMode != SamplingMode::UNIFORM) filmFlags |= Film::USE_ADAPTIVE_SAMPLING;
-        if (mFs.mGeneratePixelInfo) filmFlags |= Film::ALLOC_PIXEL_INFO_BUFFER;
+        if (generatePixelInfo) filmFlags |= Film::ALLOC_PIXEL_INFO_BUFFER;
         if (mFs.mRequiresHeatMap) filmFlags |= Film::ALLOC_HEAT_MAP_BUFFER;
         if (mFs.mExecutionMode == mcrt_common::ExecutionMode::XPU) filmFlags |= Film::VECTORIZED_XPU;
         else if (mFs.mExecutionMode == mcrt_common::ExecutionMode::VECTORIZED) filmFlags |= Film::VECTORIZED_CPU;
@@ -815,6 +914,7 @@ RenderDriver::startFrame(const FrameState &fs)
             filmFlags |= Film::ALLOC_DEEP_BUFFER;
         }
         if (mFs.mRequiresCryptomatteBuffer) filmFlags |= Film::ALLOC_CRYPTOMATTE_BUFFER;
+        if (mFs.mPixelFilterSplat) filmFlags |= Film::SPLAT_PIXEL_FILTER;
         if (mFs.mRenderContext->getSceneContext().getResumableOutput()) {
             filmFlags |= Film::RESUMABLE_OUTPUT;
         }
@@ -838,7 +938,12 @@ RenderDriver::startFrame(const FrameState &fs)
                     mFs.mTargetAdaptiveError,
                     cryptomatteMultiPresence);
 
+        if (mFs.mHugePageFilm) {
+            mFilm->adviseHugePages();
+        }
+
         updated = true;
+        numaRebind = true;
     }
 
     new(&mProgressEstimation) RenderProgressEstimation; // for interactive session, we need reset
@@ -849,6 +954,9 @@ RenderDriver::startFrame(const FrameState &fs)
         mProgressEstimation.setAdaptiveSampling(true);
 
         mFilm->getAdaptiveRenderTilesTable()->setTargetError(mFs.mTargetAdaptiveError);
+        mFilm->setAdaptiveErrorMetric(mFs.mAdaptiveErrorMetric);
+        mFilm->setAdaptiveFocus(mFs.mFocusX, mFs.mFocusY,
+                                (mFs.mRenderMode == RenderMode::PROGRESSIVE) ? mFs.mFocusRadius : 0.0f);
 
         if (!updated) {
             // We need to reset adaptiveRegions because adaptiveRegions is not initialized under
@@ -884,8 +992,10 @@ RenderDriver::startFrame(const FrameState &fs)
     // Update tiles as needed.
     if (updated ||
         mCachedViewport != mFs.mViewport ||
-        mTileScheduler->taskDistribType() != mFs.mTaskDistributionType) {
+        mTileScheduler->taskDistribType() != mFs.mTaskDistributionType ||
+        mTileScheduler->getRenderNodeWeights() != mFs.mRenderNodeWeights) {
         MNRY_ASSERT(mTileScheduler);
+        mTileScheduler->setRenderNodeWeights(mFs.mRenderNodeWeights);
         mTileScheduler->generateTiles(&getGuiTLS()->mArena, w, h, mFs.mViewport,
                                       mFs.mRenderNodeIdx, mFs.mNumRenderNodes,
                                       mFs.mTaskDistributionType);
@@ -900,6 +1010,7 @@ RenderDriver::startFrame(const FrameState &fs)
 #endif
 
         if (mTileSchedulerCheckpointInitEstimation != nullptr) {
+            mTileSchedulerCheckpointInitEstimation->setRenderNodeWeights(mFs.mRenderNodeWeights);
             mTileSchedulerCheckpointInitEstimation->
                 generateTiles(&getGuiTLS()->mArena, w, h, mFs.mViewport,
                               mFs.mRenderNodeIdx, mFs.mNumRenderNodes, mFs.mTaskDistributionType);
@@ -914,11 +1025,17 @@ RenderDriver::startFrame(const FrameState &fs)
         });
 
         updated = true;
+        numaRebind = true;
     }
 
     // Initialize DisplayFilterDriver after Film, RenderOutputDriver, and TileScheduler have been initialized.
+    // Display filter threads only take over the per tile display filter updates
+    // of progressive mode.
+    const RenderContext *renderContext = mFs.mRenderContext;
     mDisplayFilterDriver.init(mFilm, mFs.mRenderContext->getRenderOutputDriver(),
-                              getTiles(), mTileScheduler->getTileIndices(), mFs.mViewport, getNumTBBThreads());
+                              getTiles(), mTileScheduler->getTileIndices(), mFs.mViewport, getNumTBBThreads(),
+                              (mFs.mRenderMode == RenderMode::PROGRESSIVE) ? mFs.mDisplayFilterThreads : 0,
+                              [renderContext]() { renderContext->snapshotAovsForDisplayFilters(true, false); });
 
 
     if (mFs.mNumRenderNodes <= 1) {
@@ -973,6 +1090,8 @@ RenderDriver::startFrame(const FrameState &fs)
 
         // Initialize the work queue. This will get dynamically refined later
         // in the frame for the realtime/progressCheckpoint render mode.
+        mTileWorkQueue.setQueueNodes(mFs.mNumaNodeTbl ? *mFs.mNumaNodeTbl : std::vector<unsigned>());
+        mTileWorkQueue.setDeterministic(mFs.mDeterministic);
         mTileWorkQueue.init(mFs.mRenderMode,
                             unsigned(mTileScheduler->getTiles().size()),
                             unsigned(passes.size()),
@@ -980,6 +1099,19 @@ RenderDriver::startFrame(const FrameState &fs)
                             &passes.front());
     }
 
+    // The focus point may move from frame to frame without any other change.
+    applyFocusTileOrder();
+
+    if (numaRebind && mTileWorkQueue.hasQueueNodes()) {
+        // Put the film pages of the tiles each NUMA node's threads are handed onto that node.
+        const std::vector<scene_rdl2::fb_util::Tile> &tiles = mTileScheduler->getTiles();
+        std::vector<unsigned> tileNodes(tiles.size());
+        for (unsigned tileIdx = 0; tileIdx < tiles.size(); ++tileIdx) {
+            tileNodes[tileIdx] = mTileWorkQueue.getTileNode(tileIdx);
+        }
+        mFilm->bindTilesToNumaNodes(tiles, tileNodes);
+    }
+
     // Reset realtime stats.
     RealtimeFrameStats &rfs = getCurrentRealtimeFrameStats();
 
@@ -1001,7 +1133,7 @@ RenderDriver::startFrame(const FrameState &fs)
     mCachedRenderMode = mFs.mRenderMode;
     mCachedRequiresDeepBuffer = mFs.mRequiresDeepBuffer;
     mCachedRequiresCryptomatteBuffer = mFs.mRequiresCryptomatteBuffer;
-    mCachedGeneratePixelInfo = mFs.mGeneratePixelInfo;
+    mCachedGeneratePixelInfo = generatePixelInfo;
     mCachedAovChannels = std::move(aovChannels);
     mCachedRequiresHeatMap = mFs.mRequiresHeatMap;
     mCachedDeepFormat = mFs.mDeepFormat;
@@ -1013,6 +1145,7 @@ RenderDriver::startFrame(const FrameState &fs)
     mCachedViewport = mFs.mViewport;
     mCachedSamplingMode = mFs.mSamplingMode;
     mCachedDisplayFilterCount = mFs.mDisplayFilterCount;
+    mCachedPixelFilterSplat = mFs.mPixelFilterSplat;
 
     // Kick off the frame.
     mRenderThreadState.set(READY_TO_RENDER, REQUEST_RENDER, std::memory_order_release);
@@ -1142,6 +1275,9 @@ RenderDriver::stopFrame()
     // Wait on the cancellation to propagate.
     mRenderThreadState.wait(RENDERING_DONE);
 
+    // A canceled frame may leave tiles to the display filter threads.
+    mDisplayFilterDriver.pauseAsync();
+
     MNRY_ASSERT(mMcrtStartTime > 0.0);
     MNRY_ASSERT(mMcrtDuration > 0.0);
 
@@ -1309,6 +1445,7 @@ RenderDriver::saveRealtimeStats()
                                  "Predicted end,"
                                  "Actual end,"
                                  "Overhead duration (ms),"
+                                 "Time margin (ms),"
                                  "Over run (ms),"
                                  "Num render passes,"
                                  "Samples per tile,"
@@ -1323,7 +1460,7 @@ RenderDriver::saveRealtimeStats()
 
                 const RealtimeFrameStats &stats = mRealtimeStats[i];
 
-                sprintf(workBuf, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %d, %d %d\n",
+                sprintf(workBuf, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f, %d, %d %d\n",
                         stats.mUpdateDuration * 1000.0,
                         stats.mUpdateDurationOffset * 1000.0,
                         stats.mRenderBudget * 1000.0,
@@ -1335,6 +1472,7 @@ RenderDriver::saveRealtimeStats()
                         stats.mPredictedEndTime - baseTime,
                         stats.mActualEndTime - baseTime,
                         stats.mOverheadDuration * 1000.0,
+                        stats.mTimeMargin * 1000.0,
                         (stats.mActualEndTime - stats.mPredictedEndTime) * 1000.0,
                         (int)stats.mNumRenderPasses,
                         (int)stats.mSamplesPerTile,
@@ -1452,6 +1590,12 @@ RenderDriver::snapshotRenderBufferSub(scene_rdl2::fb_util::RenderBuffer *outputB
         mFilm->normalizeRenderBuffer(srcBuffer, normalizedBuffer, parallel);
     }
 
+    // Pixels with few samples lean on the previous frame, reprojected into this view.
+    // The odd buffer is left alone, it feeds the adaptive error estimation.
+    if (!oddBuffer && mFilmReprojection.hasPrior()) {
+        mFilmReprojection.blendNormalized(mFilm->getWeightBuffer(), *normalizedBuffer, parallel);
+    }
+
     if (untile) {
 #if 1
         scene_rdl2::fb_util::untile(outputBuffer, mExtrapolationBuffer, mFilm->getTiler(), parallel,
@@ -1909,6 +2053,50 @@ RenderDriver::snapshotAovBuffer(scene_rdl2::fb_util::VariablePixelBuffer *output
     }
 }
 
+void
+RenderDriver::snapshotAovTile(float *outputPixels,
+                              unsigned stride,
+                              int numConsistentSamples,
+                              unsigned int aov,
+                              const scene_rdl2::fb_util::Tile &tile) const
+{
+    const Film &film                     = getFilm();
+    const scene_rdl2::fb_util::Tiler &tiler = film.getTiler();
+    const float *weights                 = film.getWeightBuffer().getData();
+    const scene_rdl2::fb_util::VariablePixelBuffer &aovBuffer = film.getAovBuffer(aov);
+    const pbr::AovFilter filter          = film.getAovBufferFilter(aov);
+    const unsigned numFloats             = film.getAovNumFloats(aov);
+
+    // closest filter aovs are stored with 4 floats, the depth is dropped like without fulldump
+    const unsigned srcNumFloats = aovBuffer.getSizeOfPixel() / sizeof(float);
+    const float *src = reinterpret_cast<const float *>(aovBuffer.getData());
+
+    for (unsigned y = tile.mMinY; y < tile.mMaxY; ++y) {
+        unsigned ofs = tiler.linearCoordsToTiledOffset(tile.mMinX, y);
+        for (unsigned x = tile.mMinX; x < tile.mMaxX; ++x, ++ofs) {
+            const float *pixel = src + ofs * srcNumFloats;
+            float *dst = outputPixels + ((y & 7) * 8 + (x & 7)) * stride;
+
+            // See snapshotVariablePixelBuffer(), sum, min, max and closest aren't scaled
+            // and +inf or -inf pixels stay as they are.
+            float weight = 1.f;
+            if (filter == pbr::AovFilter::AOV_FILTER_AVG) {
+                weight = weights[ofs] > 0.f ? weights[ofs] : 1.f;
+            } else if (filter == pbr::AovFilter::AOV_FILTER_FORCE_CONSISTENT_SAMPLING) {
+                weight = static_cast<float>(numConsistentSamples);
+            }
+            for (unsigned i = 0; i < numFloats; ++i) {
+                if (!hasData(pixel[i])) {
+                    weight = 1.f;
+                }
+            }
+            for (unsigned i = 0; i < numFloats; ++i) {
+                dst[i] = pixel[i] / weight;
+            }
+        }
+    }
+}
+
 void
 RenderDriver::snapshotAovBuffer(scene_rdl2::fb_util::RenderBuffer *outputBuffer,
                                 int numConsistentSamples,
@@ -2129,6 +2317,94 @@ RenderDriver::revertFilmData(RenderOutputDriver *renderOutputDriver,
         return false;
     }
 
+    //
+    // Step 4 : Apply delta checkpoint files of the resume file on top of the non-normalized film data.
+    //
+    const std::string resumeBaseName = renderOutputDriver->getResumeDeltaBaseName();
+    const unsigned resumeFileTileSamples = resumeTileSamples;
+    bool filmUpdated = false;
+    if (!resumeBaseName.empty()) {
+        std::vector<std::string> deltaInfo;
+        const unsigned deltaTileSamples =
+            CheckpointDelta::applyDeltas(*mFilm, resumeBaseName, resumeTileSamples, deltaInfo);
+        for (const auto &e : deltaInfo) Logger::info(e);
+        if (deltaTileSamples != resumeTileSamples) {
+            resumeTileSamples = deltaTileSamples;
+            filmUpdated = true;
+        }
+    }
+
+    //
+    // Step 5 : Clear the tiles which see different surfaces from the frame of the resume file.
+    //
+    if (fs.mCheckpointTileReuse && !mTileHashes.empty()) {
+        if (!revertFilmTileReuse(resumeBaseName, resumeFileTileSamples, filmUpdated)) {
+            return false;
+        }
+    }
+
+    if (filmUpdated && mFilm->getResumeStartSampleIdBuff().isValid()) {
+        // 64 = tileWidth * tileHeight
+        mFilm->getResumeStartSampleIdBuff().init(mFilm->getWeightBuffer(), resumeTileSamples / 64);
+    }
+
+    // The whole film was rewritten.
+    mFilm->markAllTilesDirty();
+
+    return true;
+}
+
+bool
+RenderDriver::revertFilmTileReuse(const std::string &resumeBaseName,
+                                  const unsigned resumeFileTileSamples,
+                                  bool &filmUpdated)
+//
+// Compares the tile hash table of the resume file with the current frame and clears the tiles which
+// don't match. Returns false if the resume file can not be validated, in which case the caller falls
+// back on the standard render.
+//
+{
+    CheckpointTileHash::HashTable resumeTileHashes;
+    unsigned hashTileSamples = 0;
+    std::string errMsg;
+    if (resumeBaseName.empty() ||
+        !CheckpointTileHash::read(resumeBaseName, hashTileSamples, resumeTileHashes, errMsg)) {
+        Logger::error("Checkpoint tile reuse could not read the tile hash of the resume file. " + errMsg);
+        return false;
+    }
+    if (hashTileSamples != resumeFileTileSamples || resumeTileHashes.size() != mTileHashes.size()) {
+        Logger::error("Checkpoint tile reuse : tile hash file does not belong to the resume file " +
+                      resumeBaseName);
+        return false;
+    }
+
+    unsigned clearedTileTotal = 0;
+    for (size_t tileIdx = 0; tileIdx < mTileHashes.size(); ++tileIdx) {
+        if (resumeTileHashes[tileIdx] != mTileHashes[tileIdx]) {
+            mFilm->clearTile(tileIdx);
+            ++clearedTileTotal;
+        }
+    }
+    if (clearedTileTotal > 0) {
+        if (!mFilm->getResumeStartSampleIdBuff().isValid()) {
+            // Uniform sampling resumes all the pixels from the same sample id.
+            Logger::error("Checkpoint tile reuse requires ADAPTIVE sampling resume file when some of the tiles"
+                          " changed");
+            return false;
+        }
+        if (mFilm->getCryptomatteBuffer() || mFilm->getDeepBuffer()) {
+            // Those are not tiled and can not be cleared per tile.
+            Logger::error("Checkpoint tile reuse does not support cryptomatte and deep output when some of the"
+                          " tiles changed");
+            return false;
+        }
+        filmUpdated = true;
+    }
+
+    std::ostringstream ostr;
+    ostr << "Checkpoint tile reuse : reused tiles:" << (mTileHashes.size() - clearedTileTotal)
+         << '/' << mTileHashes.size();
+    Logger::info(ostr.str());
     return true;
 }
 
@@ -2403,7 +2679,8 @@ RenderDriver::renderThread(RenderDriver *driver,
         switch(state) {
         case UNINITIALIZED:
         case READY_TO_RENDER:
-            mcrt_common::threadSleep();
+            // Sleep until the main thread requests a frame or kills us.
+            driver->mRenderThreadState.waitWhile(state);
             break;
 
         case REQUEST_RENDER:
@@ -2423,7 +2700,8 @@ RenderDriver::renderThread(RenderDriver *driver,
             break;
 
         case RENDERING_DONE:
-            mcrt_common::threadYield();
+            // Sleep until stopFrame() has collected the frame.
+            driver->mRenderThreadState.waitWhile(state);
             break;
 
         case KILL_RENDER_THREAD:
@@ -2452,6 +2730,8 @@ RenderDriver::parserConfigure()
                 [&](Arg& arg) { return mTileWorkQueue.getParser().main(arg.childArg()); });
     mParser.opt("multiMachine", "...command...", "multi-machine related renderDriver command",
                 [&](Arg& arg) { return mParserMultiMachineControl.main(arg.childArg()); });
+    mParser.opt("perf", "...command...", "live performance introspection command",
+                [&](Arg& arg) { return mParserPerf.main(arg.childArg()); });
 
     //------------------------------
 
@@ -2498,6 +2778,43 @@ RenderDriver::parserConfigure()
                  });
     parserMm.opt("show", "", "show multi-machine renderDriver setup",
                  [&](Arg& arg) { return arg.msg(showMultiMachineCheckpointMainLoopInfo() + '\n'); });
+
+    //------------------------------
+
+    // All of these run while the frame keeps rendering, the numbers they show
+    // are snapshots of counters the render threads are still updating.
+    Parser& parserPerf = mParserPerf;
+    parserPerf.description("live performance introspection command");
+    parserPerf.opt("threads", "", "show render thread state and per thread pass progress",
+                   [&](Arg& arg) { return arg.msg(showPerfThreads() + '\n'); });
+    parserPerf.opt("queues", "", "show per thread local queue fill levels",
+                   [&](Arg& arg) { return arg.msg(showPerfQueues() + '\n'); });
+    parserPerf.opt("pools", "", "show ray state and cache line pool usage",
+                   [&](Arg& arg) { return arg.msg(showPerfPools() + '\n'); });
+    parserPerf.opt("texture", "", "show texture cache hit rate",
+                   [&](Arg& arg) {
+                       const float missFraction = texture::getTextureSampler()->getMainCacheMissFraction();
+                       return arg.fmtMsg("textureCacheHitRate:%5.1f%%\n", (1.0f - missFraction) * 100.0f);
+                   });
+    parserPerf.opt("hotTiles", "<n>", "show the n 8x8 tiles with the most samples",
+                   [&](Arg& arg) { return arg.msg(showPerfHotTiles((arg++).as<unsigned>(0)) + '\n'); });
+    parserPerf.opt("timeline", "<on|off|show>", "start/stop recording the timeline trace",
+                   [&](Arg& arg) {
+                       if (arg() == "show") arg++;
+                       else if ((arg++).as<bool>(0)) mcrt_common::TimelineTrace::enable();
+                       else mcrt_common::TimelineTrace::disable();
+                       return arg.fmtMsg("timeline:%s numEvents:%zu\n",
+                                         scene_rdl2::str_util::boolStr(mcrt_common::TimelineTrace::isEnabled()).c_str(),
+                                         mcrt_common::TimelineTrace::getNumEvents());
+                   });
+    parserPerf.opt("timelineWrite", "<filename>", "write the recorded timeline trace as a chrome trace",
+                   [&](Arg& arg) {
+                       const std::string filename = (arg++)();
+                       if (!mcrt_common::TimelineTrace::writeChromeTrace(filename)) {
+                           return arg.msg("could not write " + filename + '\n');
+                       }
+                       return arg.msg("wrote " + filename + '\n');
+                   });
 }
 
 std::string
@@ -2534,6 +2851,102 @@ RenderDriver::showMultiMachineCheckpointMainLoopInfo() const
     return ostr.str();
 }
 
+std::string
+RenderDriver::showPerfThreads() const
+{
+    static const char *const renderThreadStateNames[NUM_RENDER_THREAD_STATES] = {
+        "UNINITIALIZED", "READY_TO_RENDER", "REQUEST_RENDER", "RENDERING",
+        "RENDERING_DONE", "KILL_RENDER_THREAD", "DEAD"
+    };
+    static const char *const debugRayStateNames[NUM_DEBUG_RAY_STATES] = {
+        "READY", "REQUEST_RECORD", "RECORDING", "RECORDING_COMPLETE", "BUILDING"
+    };
+
+    std::ostringstream ostr;
+    ostr << "perf threads {\n"
+         << "  renderThreadState:" << renderThreadStateNames[mRenderThreadState.get(std::memory_order_relaxed)] << '\n'
+         << "  debugRayState:" << debugRayStateNames[getDebugRayState()] << '\n'
+         << "  numTBBThread:" << mcrt_common::getNumTBBThreads() << '\n';
+    unsigned threadIdx = 0;
+    pbr::forEachTLS([&](const pbr::TLState *tls) {
+        const unsigned passIdx = tls->mCurrentPassIdx;
+        ostr << "  thread " << threadIdx++ << " pass:" << passIdx;
+        if (passIdx < MAX_RENDER_PASSES) {
+            ostr << " primaryRaysSubmitted:" << tls->mPrimaryRaysSubmitted[passIdx];
+        }
+        ostr << '\n';
+    });
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+RenderDriver::showPerfQueues() const
+{
+    std::ostringstream ostr;
+    ostr << "perf queues (queued/size) {\n";
+    unsigned threadIdx = 0;
+    pbr::forEachTLS([&](const pbr::TLState *tls) {
+        ostr << "  thread " << threadIdx++ << tls->showQueueFill() << '\n';
+    });
+    ostr << "}";
+    return ostr.str();
+}
+
+std::string
+RenderDriver::showPerfPools() const
+{
+    using scene_rdl2::str_util::byteStr;
+
+    std::ostringstream ostr;
+    ostr << "perf pools {\n"
+         << "  rayState:" << byteStr(pbr::TLState::getRayStatePoolSize())
+         << " highWater:" << byteStr(pbr::TLState::getRayStatePoolHighWater()) << '\n'
+         << "  cacheLine:" << byteStr(pbr::TLState::getCL1PoolSize())
+         << " highWater:" << byteStr(pbr::TLState::getCL1PoolHighWater()) << '\n'
+         << "}";
+    return ostr.str();
+}
+
+std::string
+RenderDriver::showPerfHotTiles(unsigned maxTiles) const
+{
+    struct TileWeight
+    {
+        unsigned mX;
+        unsigned mY;
+        float mWeight;
+    };
+
+    // The weight of a pixel is the number of samples it received, unless
+    // the pixel filter weighs them.
+    const Film &film = getFilm();
+    std::vector<TileWeight> tiles;
+    for (unsigned ty = 0; ty < film.getHeight(); ty += 8) {
+        for (unsigned tx = 0; tx < film.getWidth(); tx += 8) {
+            float weight = 0.f;
+            for (unsigned py = ty; py < std::min(ty + 8, film.getHeight()); ++py) {
+                for (unsigned px = tx; px < std::min(tx + 8, film.getWidth()); ++px) {
+                    weight += film.getWeight(px, py);
+                }
+            }
+            tiles.push_back({tx, ty, weight});
+        }
+    }
+
+    maxTiles = std::min(maxTiles, static_cast<unsigned>(tiles.size()));
+    std::partial_sort(tiles.begin(), tiles.begin() + maxTiles, tiles.end(),
+                      [](const TileWeight &a, const TileWeight &b) { return a.mWeight > b.mWeight; });
+
+    std::ostringstream ostr;
+    ostr << "perf hotTiles (x y weight) {\n";
+    for (unsigned i = 0; i < maxTiles; ++i) {
+        ostr << "  " << tiles[i].mX << ' ' << tiles[i].mY << ' ' << tiles[i].mWeight << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
 void
 RenderDriver::setupCpuAffinityLogInfo(std::vector<std::string>& titleTbl,
                                       std::vector<std::string>& msgTbl) const
@@ -2554,6 +2967,13 @@ RenderDriver::setupCpuAffinityLogInfo(std::vector<std::string>& titleTbl,
         msgTbl.push_back("disabled");
     }
 
+    titleTbl.push_back("NUMA placement");
+    if (mNumaNumNodes) {
+        msgTbl.push_back("nodes:" + std::to_string(mNumaNumNodes));
+    } else {
+        msgTbl.push_back("disabled");
+    }
+
     titleTbl.push_back("MCRT CPU-affinity");
     if (mEnableMcrtCpuAffinity) {
         if (mEnableMcrtCpuAffinityAll) {
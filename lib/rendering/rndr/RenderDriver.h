@@ -6,9 +6,12 @@
 #pragma once
 #include "AdaptiveRenderTileInfo.h"
 #include "CheckpointController.h"
+#include "CheckpointTileHash.h"
 #include "DisplayFilterDriver.h"
 #include "FrameState.h"
 #include "Film.h"
+#include "FilmReprojection.h"
+#include "RealtimeFrameController.h"
 #include "RenderProgressEstimation.h"
 #include "RenderStatistics.h"
 #include "RenderTimingRecord.h"
@@ -17,10 +20,12 @@
 #include "Types.h"
 #include "Util.h"
 #include <moonray/rendering/rndr/adaptive/ActivePixelMask.h>
+#include <moonray/rendering/rndr/adaptive/AdaptiveConvergenceEstimator.h>
 #include <moonray/rendering/pbr/camera/StereoView.h>
 #include <moonray/rendering/pbr/core/XPUOcclusionRayQueue.h>
 #include <moonray/rendering/pbr/core/XPURayQueue.h>
 #include <moonray/common/mcrt_util/AlignedElementArray.h>
+#include <moonray/common/mcrt_util/Wait.h>
 
 #include <scene_rdl2/common/fb_util/TileExtrapolation.h>
 #include <scene_rdl2/common/grid_util/Arg.h>
@@ -76,6 +81,7 @@ class AdaptiveRenderTileInfo;
 class RenderOptions;
 class TileSampleSpecialEvent;
 class TileScheduler;
+class CostTileScheduler;
 class VariablePixelBuffer;
 
 // Used to signify that we should wrap up rendering this frame ASAP.
@@ -135,6 +141,11 @@ public:
     // - the index of the last coarse pass.
     unsigned            getLastCoarsePassIdx() const    { return mLastCoarsePassIdx; }
 
+    // Returns the cost driven tile scheduler if it is active for the current
+    // progressive frame, nullptr otherwise.
+    CostTileScheduler * getCostTileScheduler() const;
+    const TileWorkQueue &getTileWorkQueue() const       { return mTileWorkQueue; }
+
     const FrameState &  getFrameState() const           { return mFs; }
 
     // We copy frame state internally so it doesn't need to persist on the caller side.
@@ -222,6 +233,18 @@ public:
                                   bool parallel,
                                   bool fulldumpVisibility) const;
 
+    //
+    // Normalizes the pixels of a tile of a regular (non visibility) aov the same way
+    // snapshotAovBuffer() does without fulldump. The tile has to have all of its samples,
+    // nothing is extrapolated. The numFloats floats of pixel (x, y) are written to
+    // outputPixels[((y & 7) * 8 + (x & 7)) * stride]. Used to stream finished tiles to disk.
+    //
+    void snapshotAovTile(float *outputPixels,
+                         unsigned stride,
+                         int numConsistentSamples,
+                         unsigned int aov,
+                         const scene_rdl2::fb_util::Tile &tile) const;
+
     //
     // Whereas snapshotRenderBuffer and snapshotPixelInfoBuffer are buffer
     // specific, this is a general purpose version which can be used on any type
@@ -254,10 +277,16 @@ public:
     // difference between current and previous renderBuffer and weightBuffer.
     // renderBuffer/weightBuffer is tiled format and renderBuffer is not normalized by weight
     //
+    // The snapshotDelta functions only compare the tiles of the film written since
+    // the previous call with the same dirtyEpoch, see Film::beginDirtyTileSnapshot().
+    // Each destination buffer needs its own dirtyEpoch, which is reset to 0 whenever the
+    // destination buffer is reset. Without dirtyEpoch every tile is compared.
+    //
     void snapshotDelta(scene_rdl2::fb_util::RenderBuffer *renderBuffer,
                        scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                        scene_rdl2::fb_util::ActivePixels &activePixels,
-                       bool parallel) const;
+                       bool parallel,
+                       uint32_t *dirtyEpoch = nullptr) const;
 
     //
     // Creates snapshot renderBufferOdd/weightRenderBufferOdd data w/ activePixelsRenderBufferOdd information
@@ -270,7 +299,8 @@ public:
     void snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                       scene_rdl2::fb_util::FloatBuffer *weightRenderBufferOdd,
                                       scene_rdl2::fb_util::ActivePixels &activePixelsRenderBufferOdd,
-                                      bool parallel) const;
+                                      bool parallel,
+                                      uint32_t *dirtyEpoch = nullptr) const;
 
     //
     // Creates snapshot pixelInfoBuffer/pixelInfoWeightBuffer data w/ activePixelsPixelInfo information
@@ -282,7 +312,8 @@ public:
     void snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *pixelInfoBuffer,
                                 scene_rdl2::fb_util::FloatBuffer *pixelInfoWeightBuffer,
                                 scene_rdl2::fb_util::ActivePixels &activePixelsPixelInfo,
-                                bool parallel) const;
+                                bool parallel,
+                                uint32_t *dirtyEpoch = nullptr) const;
 
     //
     // Creates snapshot heatMapBuffer/heatMapWeightBuffer data w/ activePixelsHeatMap information
@@ -296,7 +327,8 @@ public:
                               scene_rdl2::fb_util::FloatBuffer *heatMapWeightBuffer,
                               scene_rdl2::fb_util::ActivePixels &activePixelsHeatMap,
                               scene_rdl2::fb_util::FloatBuffer *heatMapSecBuffer,
-                              bool parallel) const;
+                              bool parallel,
+                              uint32_t *dirtyEpoch = nullptr) const;
 
     //
     // Creates snapshot weightBuffer data w/ activePixelsWeightBuffer information
@@ -307,7 +339,8 @@ public:
     //
     void snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *weightBuffer,
                                    scene_rdl2::fb_util::ActivePixels &activePixelsWeightBuffer,
-                                   bool parallel) const;
+                                   bool parallel,
+                                   uint32_t *dirtyEpoch = nullptr) const;
 
     //
     // Creates snapshot renderOutputBuffer(aovIndex)/renderOutputWeightBuffer(aovIndex) data w/
@@ -320,13 +353,15 @@ public:
                           scene_rdl2::fb_util::VariablePixelBuffer *renderOutputBuffer,
                           scene_rdl2::fb_util::FloatBuffer *renderOutputWeightBuffer,
                           scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                          bool parallel) const;
+                          bool parallel,
+                          uint32_t *dirtyEpoch = nullptr) const;
     // This is a specially designed Visibility AOV buffer version of snapshotDeltaAov()
     void snapshotDeltaAovVisibility(unsigned aovIndex,
                                     scene_rdl2::fb_util::VariablePixelBuffer *renderOutputBuffer,
                                     scene_rdl2::fb_util::FloatBuffer *renderOutputWeightBuffer,
                                     scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                    bool parallel) const;
+                                    bool parallel,
+                                    uint32_t *dirtyEpoch = nullptr) const;
     // This is a specially designed DisplayFilter version of snapshotDelta.
     void snapshotDeltaDisplayFilter(unsigned dfIdx,
                                     scene_rdl2::fb_util::VariablePixelBuffer *renderOutputBuffer,
@@ -421,9 +456,14 @@ public:
 
     // Get RenderFrameTimingRecord which uses Realtime/ProgressiveCheckpoint renderMode
     RenderFrameTimingRecord &getRenderFrameTimingRecord() { return mTimeRec; }
+    RealtimeFrameController &getRealtimeFrameController() { return mRealtimeFrameController; }
+    const FilmReprojection &getFilmReprojection() const { return mFilmReprojection; }
     RenderProgressEstimation &getRenderProgressEstimation() { return mProgressEstimation; }
+    const AdaptiveConvergenceEstimator &getAdaptiveConvergence() const { return mAdaptiveConvergence; }
 
     bool revertFilmData(RenderOutputDriver *renderOutputDriver, const FrameState &fs, unsigned &resumeTileSamples);
+    bool revertFilmTileReuse(const std::string &resumeBaseName, const unsigned resumeFileTileSamples,
+                             bool &filmUpdated);
 
     template <typename F> void crawlAllTiledPixels(F pixelFunc) const;
 
@@ -438,6 +478,9 @@ public:
 
     const CheckpointController &getCheckpointController() const { return mCheckpointController; }
 
+    // Primary visibility hash of each tile for the current frame, empty if checkpoint tile reuse is off
+    const CheckpointTileHash::HashTable &getTileHashes() const { return mTileHashes; }
+
     // Convert numCheckpointFiles value to checkpoint qualitySteps
     static int convertTotalCheckpointToQualitySteps(SamplingMode mode,
                                                     int checkpointStartSPP,
@@ -469,6 +512,7 @@ public:
                                  std::vector<std::string>& msgTable) const;
 
     Parser& getParser() { return mParser; }
+    Parser& getPerfParser() { return mParserPerf; }
 
 private:
     friend void initRenderDriver(const mcrt_common::TLSInitParams &initParams);
@@ -478,6 +522,7 @@ private:
     explicit RenderDriver(const mcrt_common::TLSInitParams &initParams);
 
     void setProcCpuAffinity(mcrt_common::TLSInitParams& tlsInitParams);
+    bool setNumaCpuAffinity(mcrt_common::TLSInitParams& tlsInitParams);
 
     enum RenderThreadState
     {
@@ -500,6 +545,14 @@ private:
     // Special tile scheduler setup function for multi-machine configuration
     void setupMultiMachineTileScheduler(unsigned pixW, unsigned pixH);
 
+    // Reorders the fine passes of the work queue by the tile costs recorded during
+    // the coarse passes. Must only be called while no render threads are pulling work.
+    void applyCostTileOrder();
+
+    // Orders the tiles of every pass by distance from the focus point of the frame
+    // (FrameState::mFocusX/Y) in progressive mode, clears the tile order otherwise.
+    void applyFocusTileOrder();
+
     // snapshot renderBuffer or renderBufferOdd
     void snapshotRenderBufferSub(scene_rdl2::fb_util::RenderBuffer *outputBuffer,
                                  bool untile, bool parallel, bool oddBuffer) const;
@@ -509,22 +562,26 @@ private:
                                scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                               bool parallel) const;
+                               bool parallel,
+                               uint32_t *dirtyEpoch) const;
     void snapshotDeltaAovFloat2(unsigned aovIdx,
                                 scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                 scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                 scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                bool parallel) const;
+                                bool parallel,
+                                uint32_t *dirtyEpoch) const;
     void snapshotDeltaAovFloat3(unsigned aovIdx,
                                 scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                 scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                 scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                bool parallel) const;
+                                bool parallel,
+                                uint32_t *dirtyEpoch) const;
     void snapshotDeltaAovFloat4(unsigned aovIdx,
                                 scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                 scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                 scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                bool parallel) const;
+                                bool parallel,
+                                uint32_t *dirtyEpoch) const;
 
     void snapshotAovsForDisplayFilters(bool untile, bool parallel) const;
 
@@ -638,6 +695,8 @@ private:
     static bool renderTile(RenderDriver *driver, mcrt_common::ThreadLocalState *tls, const TileGroup &group,
                            RenderSamplesParams &params, pbr::DeepBuffer *deepBuffer,
                            pbr::CryptomatteBuffer *cryptomatteBuffer, unsigned &processedSampleTotal);
+    static bool skipConvergedTile(RenderDriver *driver, mcrt_common::ThreadLocalState *tls, const TileGroup &group,
+                                  const RenderSamplesParams &params);
     static bool renderTileAdaptiveStage(RenderDriver* driver,
                                         mcrt_common::ThreadLocalState* tls,
                                         const TileGroup& group,
@@ -677,6 +736,10 @@ private:
 
     std::string showInitFrameControl() const;
     std::string showMultiMachineCheckpointMainLoopInfo() const;
+    std::string showPerfThreads() const;
+    std::string showPerfQueues() const;
+    std::string showPerfPools() const;
+    std::string showPerfHotTiles(unsigned maxTiles) const;
 
     //------------------------------
 
@@ -704,6 +767,7 @@ private:
     scene_rdl2::math::Viewport mCachedViewport;
     SamplingMode               mCachedSamplingMode;
     unsigned                   mCachedDisplayFilterCount;
+    bool                       mCachedPixelFilterSplat;
 
     Film *              mFilm;
 
@@ -779,7 +843,7 @@ private:
             //      which we disallow
             const auto old [[gnu::unused]] = mRenderThreadState.exchange(newState, order);
             MNRY_ASSERT(old == oldState);
-            // TODO: C++20 atomic notify all
+            ::notify_all(mRenderThreadState);
         }
 
         RenderThreadState get(std::memory_order order = std::memory_order_seq_cst) const noexcept
@@ -787,14 +851,24 @@ private:
             return mRenderThreadState.load(order);
         }
 
+        // The waits spin briefly, then sleep on a futex until set() is called,
+        // so idle threads don't burn CPU between frames.
         void wait(RenderThreadState desired) noexcept
         {
-            while (mRenderThreadState.load(std::memory_order_relaxed) != desired) {
-                // TODO: C++20 atomic wait
-                mcrt_common::threadSleep();
+            RenderThreadState state = mRenderThreadState.load(std::memory_order_acquire);
+            while (state != desired) {
+                ::wait(mRenderThreadState, state, std::memory_order_acquire);
+                state = mRenderThreadState.load(std::memory_order_acquire);
             }
         }
 
+        // Returns the first state that differs from current.
+        RenderThreadState waitWhile(RenderThreadState current) noexcept
+        {
+            ::wait(mRenderThreadState, current, std::memory_order_acquire);
+            return mRenderThreadState.load(std::memory_order_acquire);
+        }
+
     private:
         std::atomic<RenderThreadState>  mRenderThreadState;
     };
@@ -815,7 +889,10 @@ private:
     // renderFrame() and multiple renderPasses() detail timing information about each engine threads
     // This info is used for realtime/progressiveCheckpoint renderMode to estimate proper sample count
     RenderFrameTimingRecord mTimeRec;
+    RealtimeFrameController mRealtimeFrameController; // frame pacing of realtime renderMode over the frames
+    FilmReprojection mFilmReprojection; // previous frame prior of progressive renderMode
     RenderProgressEstimation mProgressEstimation; // progress estimation logic for checkpoint render
+    AdaptiveConvergenceEstimator mAdaptiveConvergence; // error decay of the adaptive frame
     unsigned mAdaptiveTileSampleCap; // tile sample cap for adaptive checkpoint render
 
     int mLastCheckpointFileEndSampleId; // default is -1
@@ -823,6 +900,7 @@ private:
     std::string mCheckpointPostScript; // post checkpoint lua script name
 
     CheckpointController mCheckpointController;
+    CheckpointTileHash::HashTable mTileHashes;
     bool mMultiMachineCheckpointMainLoop {false};
     float mMultiMachineFrameBudgetSecShort {1.0f}; // sec
     float mMultiMachineQuickPhaseLengthSec {2.0f};
@@ -871,10 +949,12 @@ private:
     std::vector<unsigned> mCpuAffinityCpuIdTbl;
     bool mEnableMcrtCpuAffinity {false};
     bool mEnableMcrtCpuAffinityAll {false};
+    unsigned mNumaNumNodes {0}; // 0 : NUMA placement disabled
 
     Parser mParser;
     Parser mParserInitFrameControl;
     Parser mParserMultiMachineControl;
+    Parser mParserPerf;
 
     DISALLOW_COPY_OR_ASSIGNMENT(RenderDriver);
 };
@@ -958,7 +1038,8 @@ RenderDriver::snapshotBuffer(scene_rdl2::fb_util::PixelBuffer<DST_PIXEL_TYPE> *o
     if (untile) {
         scene_rdl2::fb_util::untile(outputBuffer, *srcBuf, tiler, parallel, pixelXform);
     } else {
-        unsigned area = mUnalignedW * mUnalignedH;
+        // The tiled layout spreads the pixels of the image over the whole aligned buffer.
+        unsigned area = tiler.mAlignedW * tiler.mAlignedH;
         auto *__restrict dstRow = outputBuffer->getData();
         const auto *__restrict srcRow = srcBuf->getData();
         //
@@ -34,6 +34,32 @@
 namespace moonray {
 namespace rndr {
 
+namespace {
+
+// Skips the tiles of the film which weren't written since the previous snapshot of the
+// same buffer, see Film::beginDirtyTileSnapshot(). Without a dirty epoch every tile is
+// compared.
+class DirtyTiles
+{
+public:
+    DirtyTiles(const Film &film, uint32_t *dirtyEpoch) :
+        mFilm(film),
+        mSince(dirtyEpoch ? *dirtyEpoch : 0)
+    {
+        if (dirtyEpoch) {
+            *dirtyEpoch = film.beginDirtyTileSnapshot();
+        }
+    }
+
+    bool isClean(unsigned tileId) const { return !mFilm.isTileDirtySince(tileId, mSince); }
+
+private:
+    const Film &mFilm;
+    const uint32_t mSince;
+};
+
+} // anonymous namespace
+
 //------------------------------------------------------------------------------
 
 template <int dimension>
@@ -114,10 +140,16 @@ snapshotDeltaAovFloatN(const Film &film,
                        scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                        scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                        scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                       bool parallel)
+                       bool parallel,
+                       uint32_t *dirtyEpoch)
 {
     const unsigned numTiles = film.getTiler().mNumTiles;
+    const DirtyTiles dirtyTiles(film, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsRenderOutput.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
             auto &dstBuffer = SnapshotDeltaAovFloatN<dimension>::get(*dstRenderOutputBuffer);
             const auto &srcBuffer = SnapshotDeltaAovFloatN<dimension>::get(film.getAovBuffer(aovIdx));
@@ -150,7 +182,8 @@ void
 RenderDriver::snapshotDelta(scene_rdl2::fb_util::RenderBuffer *dstRenderBuffer,
                             scene_rdl2::fb_util::FloatBuffer *dstWeightBuffer,
                             scene_rdl2::fb_util::ActivePixels &activePixels,
-                            bool parallel) const
+                            bool parallel,
+                            uint32_t *dirtyEpoch) const
 //
 // Creates snapshot renderBuffer/weightBuffer data w/ activePixels information
 // for ProgressiveFrame message related logic.
@@ -168,13 +201,27 @@ RenderDriver::snapshotDelta(scene_rdl2::fb_util::RenderBuffer *dstRenderBuffer,
     recTime.start();
 #endif // end SNAPSHOT_DELTA_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(*mFilm, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixels.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
             scene_rdl2::fb_util::RenderColor *dst = dstRenderBuffer->getData() + pixId;
             float *dstWeight = dstWeightBuffer->getData() + pixId;
             const scene_rdl2::fb_util::RenderColor *srcColor = mFilm->getRenderBuffer().getData() + pixId;
             const float *srcWeight = mFilm->getWeightBuffer().getData() + pixId;
 
+            // The reprojected previous frame travels as extra weight, the receiver normalizes as usual.
+            scene_rdl2::fb_util::RenderColor priorColor[64];
+            float priorWeight[64];
+            if (mFilmReprojection.hasPrior()) {
+                mFilmReprojection.addToTile(tileId, srcColor, srcWeight, priorColor, priorWeight);
+                srcColor = priorColor;
+                srcWeight = priorWeight;
+            }
+
             uint64_t activePixelMask =
                 scene_rdl2::fb_util::SnapshotUtil::snapshotTileColorWeight((uint32_t *)dst,
                                                                (uint32_t *)dstWeight,
@@ -198,7 +245,8 @@ void
 RenderDriver::snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *dstRenderBufferOdd,
                                            scene_rdl2::fb_util::FloatBuffer *dstWeightRenderBufferOdd,
                                            scene_rdl2::fb_util::ActivePixels &activePixelsRenderBufferOdd,
-                                           bool parallel) const
+                                           bool parallel,
+                                           uint32_t *dirtyEpoch) const
 //
 // Creates snapshot renderBufferOdd/weightRenderBufferOdd data w/ activePixelsRenderBufferOdd information
 // for ProgressiveFrame message related logic.
@@ -220,7 +268,12 @@ RenderDriver::snapshotDeltaRenderBufferOdd(scene_rdl2::fb_util::RenderBuffer *ds
     recTime.start();
 #endif // end SNAPSHOT_DELTA_RENDERBUFFERODD_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(*mFilm, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsRenderBufferOdd.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
             scene_rdl2::fb_util::RenderColor *dst = dstRenderBufferOdd->getData() + pixId;
             float *dstWeight = dstWeightRenderBufferOdd->getData() + pixId;
@@ -250,7 +303,8 @@ void
 RenderDriver::snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *dstPixelInfoBuffer,
                                      scene_rdl2::fb_util::FloatBuffer *dstPixelInfoWeightBuffer,
                                      scene_rdl2::fb_util::ActivePixels &activePixelsPixelInfo,
-                                     bool parallel) const
+                                     bool parallel,
+                                     uint32_t *dirtyEpoch) const
 //
 // Creates snapshot pixelInfoBuffer/pixelInfoWeightBuffer data w/ activePixelsPixelInfo information
 // for ProgressiveFrame message related logic.
@@ -267,7 +321,12 @@ RenderDriver::snapshotDeltaPixelInfo(scene_rdl2::fb_util::PixelInfoBuffer *dstPi
     recTime.start();
 #endif // end SNAPSHOT_DELTA_PIXINFO_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(*mFilm, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsPixelInfo.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
             scene_rdl2::fb_util::PixelInfo *dst = dstPixelInfoBuffer->getData() + pixId;
             float *dstW = dstPixelInfoWeightBuffer->getData() + pixId;
@@ -298,7 +357,8 @@ RenderDriver::snapshotDeltaHeatMap(scene_rdl2::fb_util::HeatMapBuffer *dstHeatMa
                                    scene_rdl2::fb_util::FloatBuffer *dstHeatMapWeightBuffer,
                                    scene_rdl2::fb_util::ActivePixels &activePixelsHeatMap,
                                    scene_rdl2::fb_util::FloatBuffer *dstHeatMapSecBuffer,
-                                   bool parallel) const
+                                   bool parallel,
+                                   uint32_t *dirtyEpoch) const
 //
 // Creates snapshot heatMapBuffer/heatMapWeightBuffer data w/ activePixelsHeatMap information
 // for ProgressiveFrame message related logic.
@@ -316,7 +376,12 @@ RenderDriver::snapshotDeltaHeatMap(scene_rdl2::fb_util::HeatMapBuffer *dstHeatMa
     recTime.start();
 #endif // end SNAPSHOT_DELTA_HEATMAP_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(*mFilm, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsHeatMap.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
 
             int64_t *dst = dstHeatMapBuffer->getData() + pixId;
@@ -357,7 +422,8 @@ RenderDriver::snapshotDeltaHeatMap(scene_rdl2::fb_util::HeatMapBuffer *dstHeatMa
 void
 RenderDriver::snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *dstWeightBuffer,
                                         scene_rdl2::fb_util::ActivePixels &activePixelsWeightBuffer,
-                                        bool parallel) const
+                                        bool parallel,
+                                        uint32_t *dirtyEpoch) const
 //
 // Creates snapshot weightBuffer data w/ activePixelsWeightBuffer information
 // for ProgressiveFrame message related logic.
@@ -374,7 +440,12 @@ RenderDriver::snapshotDeltaWeightBuffer(scene_rdl2::fb_util::FloatBuffer *dstWei
     recTime.start();
 #endif // end SNAPSHOT_DELTA_WEIGHTBUFFER_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(*mFilm, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsWeightBuffer.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
 
             float *dst = dstWeightBuffer->getData() + pixId;
@@ -399,7 +470,8 @@ RenderDriver::snapshotDeltaAov(unsigned aovIdx,
                                scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                               bool parallel) const
+                               bool parallel,
+                               uint32_t *dirtyEpoch) const
 //
 // Creates snapshot renderOutputBuffer(aovIndex)/renderOutputWeightBuffer(aovIndex) data w/
 // activePixelsRenderOutput information for ProgressiveFrame message related logic.
@@ -416,21 +488,24 @@ RenderDriver::snapshotDeltaAov(unsigned aovIdx,
                               dstRenderOutputBuffer,
                               dstRenderOutputWeightBuffer,
                               activePixelsRenderOutput,
-                              parallel);
+                              parallel,
+                              dirtyEpoch);
         break;
     case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT2 :
         snapshotDeltaAovFloat2(aovIdx,
                                dstRenderOutputBuffer,
                                dstRenderOutputWeightBuffer,
                                activePixelsRenderOutput,
-                               parallel);
+                               parallel,
+                               dirtyEpoch);
         break;
     case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT3 :
         snapshotDeltaAovFloat3(aovIdx,
                                dstRenderOutputBuffer,
                                dstRenderOutputWeightBuffer,
                                activePixelsRenderOutput,
-                               parallel);
+                               parallel,
+                               dirtyEpoch);
         break;
     case scene_rdl2::fb_util::VariablePixelBuffer::FLOAT4 :
         // currently these should only be closest filter aovs
@@ -440,7 +515,8 @@ RenderDriver::snapshotDeltaAov(unsigned aovIdx,
                                dstRenderOutputBuffer,
                                dstRenderOutputWeightBuffer,
                                activePixelsRenderOutput,
-                               parallel);
+                               parallel,
+                               dirtyEpoch);
         break;
     }
 }
@@ -450,7 +526,8 @@ RenderDriver::snapshotDeltaAovVisibility(unsigned aovIdx,
                                          scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                          scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                          scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                         bool parallel) const
+                                         bool parallel,
+                                         uint32_t *dirtyEpoch) const
 {
     const Film &film = getFilm();
     const unsigned numTiles = film.getTiler().mNumTiles;
@@ -461,7 +538,12 @@ RenderDriver::snapshotDeltaAovVisibility(unsigned aovIdx,
     recTime.start();
 #endif // end SNAPSHOT_DELTA_AOV_VISIBILITY_TIMING_TEST
 
+    const DirtyTiles dirtyTiles(film, dirtyEpoch);
     simpleLoop(parallel, 0u, numTiles, [&](unsigned tileId) {
+            if (dirtyTiles.isClean(tileId)) {
+                activePixelsRenderOutput.setTileMask(tileId, 0);
+                return;
+            }
             unsigned pixId = tileId << 6; // tile is 8x8 = 64pixels
             scene_rdl2::fb_util::FloatBuffer &dstFloatBuffer = dstRenderOutputBuffer->getFloatBuffer();
 
@@ -550,7 +632,8 @@ RenderDriver::snapshotDeltaAovFloat(unsigned aovIdx,
                                     scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                     scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                     scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                    bool parallel) const
+                                    bool parallel,
+                                    uint32_t *dirtyEpoch) const
 {
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT_TIMING_TEST
     static rec_time::RecTimeLog recTimeFloatLog;
@@ -563,7 +646,8 @@ RenderDriver::snapshotDeltaAovFloat(unsigned aovIdx,
                               dstRenderOutputBuffer,
                               dstRenderOutputWeightBuffer,
                               activePixelsRenderOutput,
-                              parallel);
+                              parallel,
+                              dirtyEpoch);
 
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT_TIMING_TEST
     recTimeFloatLog.add(recTime.end());
@@ -580,7 +664,8 @@ RenderDriver::snapshotDeltaAovFloat2(unsigned aovIdx,
                                      scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                      scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                      scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                     bool parallel) const
+                                     bool parallel,
+                                     uint32_t *dirtyEpoch) const
 {
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT2_TIMING_TEST
     static rec_time::RecTimeLog recTimeFloat2Log;
@@ -593,7 +678,8 @@ RenderDriver::snapshotDeltaAovFloat2(unsigned aovIdx,
                               dstRenderOutputBuffer,
                               dstRenderOutputWeightBuffer,
                               activePixelsRenderOutput,
-                              parallel);
+                              parallel,
+                              dirtyEpoch);
 
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT2_TIMING_TEST
     recTimeFloat2Log.add(recTime.end());
@@ -610,7 +696,8 @@ RenderDriver::snapshotDeltaAovFloat3(unsigned aovIdx,
                                      scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                      scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                      scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                     bool parallel) const
+                                     bool parallel,
+                                     uint32_t *dirtyEpoch) const
 {
 
 
@@ -625,7 +712,8 @@ RenderDriver::snapshotDeltaAovFloat3(unsigned aovIdx,
                               dstRenderOutputBuffer,
                               dstRenderOutputWeightBuffer,
                               activePixelsRenderOutput,
-                              parallel);
+                              parallel,
+                              dirtyEpoch);
 
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT3_TIMING_TEST
     recTimeFloat3Log.add(recTime.end());
@@ -642,7 +730,8 @@ RenderDriver::snapshotDeltaAovFloat4(unsigned aovIdx,
                                      scene_rdl2::fb_util::VariablePixelBuffer *dstRenderOutputBuffer,
                                      scene_rdl2::fb_util::FloatBuffer *dstRenderOutputWeightBuffer,
                                      scene_rdl2::fb_util::ActivePixels &activePixelsRenderOutput,
-                                     bool parallel) const
+                                     bool parallel,
+                                     uint32_t *dirtyEpoch) const
 {
 
 
@@ -657,7 +746,8 @@ RenderDriver::snapshotDeltaAovFloat4(unsigned aovIdx,
                               dstRenderOutputBuffer,
                               dstRenderOutputWeightBuffer,
                               activePixelsRenderOutput,
-                              parallel);
+                              parallel,
+                              dirtyEpoch);
 
 #ifdef SNAPSHOT_DELTA_AOV_FLOAT4_TIMING_TEST
     recTimeFloat4Log.add(recTime.end());
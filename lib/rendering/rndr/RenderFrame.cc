@@ -22,11 +22,13 @@
 #include "PixSampleRuntimeVerify.h"
 #include "RenderContext.h"
 #include "RenderDriver.h"
+#include "RenderOutputDriver.h"
 #include "ResumeHistoryMetaData.h"
 #include "TileSampleSpecialEvent.h"
 
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/pbr/core/DebugRay.h>
+#include <moonray/rendering/texturing/sampler/TextureSampler.h>
 
 #include <tbb/task_arena.h>
 
@@ -143,6 +145,7 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
                              driver->getLastCoarsePassIdx() != MAX_RENDER_PASSES)
                              ? 0.f : 1.f;
         tls->setAllQueueSizes(queueInterp);
+        tls->resetAdaptiveQueueSizes();
     });
 
     // Need to setup the accumulators for the GUI TLS, which is separate from the other TLSes
@@ -167,6 +170,16 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
     // We are guaranteed to have copied the previous frame buffer by this point if we needed it.
     film->clearAllBuffers();
 
+    // The previous frame, warped into the current view, fills in the display until the
+    // new samples take over. It is blended at snapshot time and never enters the film.
+    // Distributed renders are left alone, the merger would add up the priors of the nodes.
+    if (fs.mRenderMode == RenderMode::PROGRESSIVE && fs.mTemporalReprojectionWeight > 0.0f &&
+        !driver->mTileScheduler->isDistributed()) {
+        driver->mFilmReprojection.reproject(*film, *fs.mScene->getCamera(), fs.mTemporalReprojectionWeight, true);
+    } else {
+        driver->mFilmReprojection.dropPrior();
+    }
+
     // Disable adjust adaptive tree update timing logic at this moment. we will enable later for checkpoint
     film->disableAdjustAdaptiveTreeUpdateTiming();
 
@@ -174,10 +187,20 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
     film->getAdaptiveRenderTilesTable()->setDebugPosition(*driver->getTiles()); // for debug
     */
 
+    // Resume validates the tiles of the resume file by this table, checkpoint output saves it.
+    driver->mTileHashes.clear();
+    if (fs.mCheckpointTileReuse) {
+        CheckpointTileHash::compute(*fs.mRenderContext->getScene(), film->getTiler(), driver->mTileHashes);
+    }
+
     // This should be before workQueue reset because revert film object might change workQueue parameters.
     unsigned progressCheckpointStartTileSampleId = revertFilmObjectAndResetWorkQueue(driver, fs);
 
     if (fs.mSamplingMode == SamplingMode::ADAPTIVE) {
+        driver->mAdaptiveConvergence.reset(scene_rdl2::util::getSeconds(),
+                                           fs.mTargetAdaptiveError,
+                                           fs.mAdaptiveStopGainPerMinute);
+
         // Initialize current sampleId buffer for adaptive sampling.
         film->getCurrSampleIdBuff().init(film->getWeightBuffer(), fs.mMaxSamplesPerPixel);
     }
@@ -191,10 +214,16 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
         driver->setCoarsePassesComplete();
     }
 
+    // Record the texture footprints of the first passes, see renderFramePasses().
+    texture::TextureSampler *textureSampler = MNRY_VERIFY(texture::getTextureSampler());
+    textureSampler->getPrefetcher().startRecording();
+
     //
     // Start rendering the frame.
     //
 
+    mcrt_common::startExclusiveAccumulatorSampling();
+
     bool canceled = false;
 
     switch(fs.mRenderMode) {
@@ -285,9 +314,18 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
         MNRY_ASSERT(0);
     }
 
+    mcrt_common::stopExclusiveAccumulatorSampling();
+
     // This must always be updated before we leave this function.
     driver->setReadyForDisplay();
 
+    // Canceled frames are captured as well, a camera move cancels the frame it replaces.
+    if (fs.mRenderMode == RenderMode::PROGRESSIVE && fs.mTemporalReprojectionWeight > 0.0f) {
+        driver->mFilmReprojection.capture(*film, *fs.mScene->getCamera(), true);
+    } else {
+        driver->mFilmReprojection.clear();
+    }
+
 #   ifdef RUNTIME_VERIFY
     if (fs.mSamplingMode == SamplingMode::ADAPTIVE) {
         if (!film->getCurrSampleIdBuff().verify(film->getWeightBuffer())) {
@@ -319,6 +357,8 @@ RenderDriver::renderFrame(RenderDriver *driver, const FrameState &fs)
     // Frame clean up.
     //
 
+    textureSampler->getPrefetcher().stop();
+
     if (fs.mExecutionMode == mcrt_common::ExecutionMode::VECTORIZED ||
         fs.mExecutionMode == mcrt_common::ExecutionMode::XPU) {
         if (canceled) {
@@ -375,9 +415,43 @@ RenderDriver::batchRenderFrame(RenderDriver *driver, const FrameState &fs)
     // store timing info for resume history
     fs.mRenderContext->getResumeHistoryMetaData()->setMCRTStintStartTime();
 
+    // Stream the deep output as the rows of tiles finish instead of writing the whole
+    // deep image at the end of the frame.  A tile has to be finished when its last pass
+    // returns, which rules out the vectorized modes where its samples are still queued and
+    // adaptive sampling where the last pass of a tile isn't known up front.
+    pbr::DeepBuffer *deepBuffer = driver->mFilm->getDeepBuffer();
+    const RenderOutputDriver *renderOutputDriver = fs.mRenderContext->getRenderOutputDriver();
+    const bool streamDeep = deepBuffer && renderOutputDriver && fs.mStreamDeepOutput &&
+                            fs.mExecutionMode == mcrt_common::ExecutionMode::SCALAR &&
+                            fs.mSamplingMode == SamplingMode::UNIFORM &&
+                            fs.mNumRenderNodes == 1;
+    if (streamDeep) {
+        const Film *film = driver->mFilm;
+        deepBuffer->startStreaming([film](unsigned x, unsigned y) {
+            return film->getNumRenderBufferPixelSamples(x, y);
+        });
+        renderOutputDriver->startDeepStreaming(deepBuffer);
+    }
+
+    // Same for the files of the other render outputs, which are written tile by tile as
+    // tiled images. Pixel filter splatting adds samples to the neighbor tiles as well.
+    const bool streamOutput = renderOutputDriver && fs.mStreamOutput &&
+                              fs.mExecutionMode == mcrt_common::ExecutionMode::SCALAR &&
+                              fs.mSamplingMode == SamplingMode::UNIFORM &&
+                              fs.mNumRenderNodes == 1 &&
+                              !fs.mPixelFilterSplat &&
+                              renderOutputDriver->startStreaming();
+
     // Submit all passes with cancellation.
     RenderPassesResult result = renderPasses(driver, fs, true);
 
+    if (streamDeep) {
+        deepBuffer->finishStreaming();
+    }
+    if (streamOutput) {
+        renderOutputDriver->finishStreaming();
+    }
+
     if (result != RenderPassesResult::ERROR_OR_CANCEL) {
         driver->setReadyForDisplay();
         driver->setFrameComplete();
@@ -402,8 +476,9 @@ RenderDriver::batchRenderFrame(RenderDriver *driver, const FrameState &fs)
 void
 RenderDriver::runDisplayFiltersEndOfPass(RenderDriver *driver, const FrameState &fs)
 {
-    fs.mRenderContext->snapshotAovsForDisplayFilters(true, true);
     const DisplayFilterDriver& displayFilterDriver = driver->getDisplayFilterDriver();
+    displayFilterDriver.pauseAsync();
+    fs.mRenderContext->snapshotAovsForDisplayFilters(true, true);
     simpleLoop (true, 0u, (unsigned int)driver->getTiles()->size() - 1u, [&](unsigned tileIdx) {
         int threadId = tbb::task_arena::current_thread_index();
         displayFilterDriver.runDisplayFilters(tileIdx, threadId);
@@ -422,6 +497,13 @@ RenderDriver::progressiveRenderFrame(RenderDriver *driver, const FrameState &fs)
 
     TileWorkQueue *workQueue = &driver->mTileWorkQueue;
 
+    // The cost driven tile scheduler records tile timings during the coarse passes
+    // and uses them to order the fine passes.
+    CostTileScheduler *costTileScheduler = driver->getCostTileScheduler();
+    if (costTileScheduler) {
+        costTileScheduler->resetTileCosts();
+    }
+
     // Only allow rendering of pass 0 initially. This will allow us to present a new frame
     // up on screen quickly. Pass 0 is dynamically configured with the same rules as for
     // realtime rendering.
@@ -463,10 +545,14 @@ RenderDriver::progressiveRenderFrame(RenderDriver *driver, const FrameState &fs)
                     if (enablePathGuide) {
                         const_cast<pbr::PathIntegrator *>(fs.mIntegrator)->passReset();
                     }
+                    if (costTileScheduler && clampPass == int(driver->mLastCoarsePassIdx) + 1) {
+                        driver->applyCostTileOrder();
+                    }
                     workQueue->clampToPass(clampPass);
                     RenderPassesResult result = renderPasses(driver, fs, true);
                     if (hasDisplayFilters) {
                         runDisplayFiltersEndOfPass(driver, fs);
+                        driver->getDisplayFilterDriver().resumeAsync();
                     }
                     if (result == RenderPassesResult::ERROR_OR_CANCEL) {
                         return false;
@@ -476,13 +562,34 @@ RenderDriver::progressiveRenderFrame(RenderDriver *driver, const FrameState &fs)
                     }
                 }
             } else {
-                // Allow rendering of all remaining passes.
-                workQueue->unclampPasses();
+                bool renderRemainingPasses = true;
+                if (costTileScheduler) {
+                    // Finish the coarse passes first so that their tile timings are
+                    // complete before the fine passes get ordered by them.
+                    if (driver->mLastCoarsePassIdx > 0) {
+                        workQueue->clampToPass(driver->mLastCoarsePassIdx);
+                        RenderPassesResult result = renderPasses(driver, fs, true);
+                        if (result == RenderPassesResult::ERROR_OR_CANCEL) {
+                            return false;
+                        }
+                        if (result == RenderPassesResult::STOP_AT_PASS_BOUNDARY) {
+                            renderRemainingPasses = false; // render completed at pass boundary condition
+                        }
+                    }
+                    if (renderRemainingPasses) {
+                        driver->applyCostTileOrder();
+                    }
+                }
+
+                if (renderRemainingPasses) {
+                    // Allow rendering of all remaining passes.
+                    workQueue->unclampPasses();
 
-                // Render all remaining passes.
-                RenderPassesResult result = renderPasses(driver, fs, true);
-                if (result == RenderPassesResult::ERROR_OR_CANCEL) {
-                    return false;
+                    // Render all remaining passes.
+                    RenderPassesResult result = renderPasses(driver, fs, true);
+                    if (result == RenderPassesResult::ERROR_OR_CANCEL) {
+                        return false;
+                    }
                 }
             }
         }
@@ -492,6 +599,9 @@ RenderDriver::progressiveRenderFrame(RenderDriver *driver, const FrameState &fs)
     // When the display filters are run during a pass they may
     // use outdated data from neighboring tiles.
     if (driver->getDisplayFilterDriver().hasDisplayFilters()) {
+        // Stays paused till the end of the frame.
+        driver->getDisplayFilterDriver().pauseAsync();
+
         // Request to update all tiles
         unsigned numTiles = driver->getFilm().getTiler().mNumTiles;
         for (unsigned tile = 0; tile < numTiles; ++tile) {
@@ -516,6 +626,7 @@ RenderDriver::realtimeRenderFrame(RenderDriver *driver, const FrameState &fs)
 {
     RenderFrameTimingRecord &timingRec = driver->getRenderFrameTimingRecord();
     timingRec.reset(0);   // reset condition for new frame : set renderFrameStartTime internally
+    RealtimeFrameController &frameController = driver->getRealtimeFrameController();
 
     TileWorkQueue *workQueue = &driver->mTileWorkQueue;
 
@@ -543,6 +654,7 @@ RenderDriver::realtimeRenderFrame(RenderDriver *driver, const FrameState &fs)
         rts.mUpdateDurationOffset = driver->getLastFrameUpdateDurationOffset();
         rts.mRenderBudget = frameBudget;
         rts.mPredictedEndTime = predictedEnd;
+        rts.mTimeMargin = frameController.startFrame(frameBudget);
 
         driver->mFrameEndTime = predictedEnd;
     }
@@ -564,8 +676,9 @@ RenderDriver::realtimeRenderFrame(RenderDriver *driver, const FrameState &fs)
         double now = scene_rdl2::util::getSeconds();
 
         // mFrameEndTime is completely dynamic, it is updated by calling
-        // RenderDriver::requestStop or RenderDriver::stop.
-        double remainingTime = driver->mFrameEndTime - now;
+        // RenderDriver::requestStop or RenderDriver::stop. The margin is what
+        // the frame controller holds back for the overrun of the recent frames.
+        double remainingTime = driver->mFrameEndTime - rts.mTimeMargin - now;
 
         // Do we have time to render more samples?
         if (timingRec.isComplete(remainingTime, now)) {
@@ -588,12 +701,11 @@ RenderDriver::realtimeRenderFrame(RenderDriver *driver, const FrameState &fs)
         //       queues than is optimal, but we are also the least likely to
         //       exceed our time budget.
         //
-        // TODO: We could refine the paranoia factor dynamically get larger
-        //       as more samples are rendered. The more samples rendered,
-        //       the higher confidence we can have in the cost estimate
-        //       (since we're refining it continually for each new pass).
+        // The factor gets smaller as more samples are rendered. The more
+        // samples rendered, the higher confidence we can have in the cost
+        // estimate (since we're refining it continually for each new pass).
         //
-        const double paranoiaFactor = 0.0;
+        const double paranoiaFactor = frameController.getParanoiaFactor(timingRec.getNumSamplesPerTile());
 
         // Compute how many new samples we can safely render within the
         // remaining time interval.
@@ -631,6 +743,10 @@ RenderDriver::realtimeRenderFrame(RenderDriver *driver, const FrameState &fs)
     rts.mActualEndTime = timingRec.getRenderFrameEndTime();
     rts.mOverheadDuration = timingRec.getTotalOverheadDuration();
 
+    // Pace the next frames from how far this one ended off its (possibly
+    // stopped early) end time.
+    frameController.endFrame(driver->mFrameEndTime, timingRec.getRenderFrameEndTime());
+
     driver->setReadyForDisplay();
 
     // Mark frame as fully complete.
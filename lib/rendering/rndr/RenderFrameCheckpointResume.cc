@@ -685,6 +685,7 @@ RenderDriver::progressCheckpointRenderFrame(RenderDriver *driver, const FrameSta
     //
     // checkpoint stint loop
     //
+    driver->mCheckpointController.setEmergencyCheckpoint(fs.mCheckpointEmergencyDump);
     driver->mCheckpointController.reset();
     double frameBudgetBase = fs.mCheckpointInterval * 60.0f; // convert to second from minute
     int quickPhaseTotal = 0;
@@ -800,6 +801,14 @@ RenderDriver::progressCheckpointRenderFrame(RenderDriver *driver, const FrameSta
     } // checkpoint stint loop
     fs.mRenderContext->getRenderOutputDriver()->setLastCheckpointRenderTileSamples(endSampleId);
 
+    // Replace the delta chain by full checkpoint files, final output (two stage output case) copies
+    // the last checkpoint files.
+    driver->mCheckpointController.compactDelta(fs.mCheckpointBgWrite,
+                                               fs.mTwoStageOutput,
+                                               fs.mRenderContext,
+                                               driver->mCheckpointPostScript,
+                                               endSampleId);
+
     // finalize sync (wait all ImageWriteDriver task) here
     fs.mRenderContext->getResumeHistoryMetaData()->setFinalizeSyncStartTime();
     ImageWriteDriver::get()->conditionWaitUntilAllCompleted(); // condition wait
@@ -1382,6 +1391,7 @@ RenderDriver::checkpointFileOutput(RenderDriver *driver, const FrameState &fs, c
     driver->mProgressEstimation.checkpointOutput(true, endSampleId);
     driver->mCheckpointController.output(fs.mCheckpointBgWrite,
                                          fs.mTwoStageOutput,
+                                         fs.mCheckpointDeltaMax,
                                          fs.mRenderContext,
                                          driver->mCheckpointPostScript,
                                          endSampleId);
@@ -15,17 +15,23 @@
 #include "AdaptiveRenderTilesTable.h"
 #include "DisplayFilterDriver.h"
 #include "PixSampleRuntimeVerify.h"
+#include "RenderOutputDriver.h"
 
 #include <moonray/rendering/rndr/adaptive/ActivePixelMask.h>
 
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/mcrt_common/Clock.h>
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
+#include <moonray/rendering/mcrt_common/NumaUtil.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/pbr/camera/Camera.h>
 #include <moonray/rendering/pbr/core/RayState.h>
 #include <moonray/rendering/pbr/integrator/PathIntegrator.h>
 #include <moonray/rendering/pbr/integrator/Picking.h>
+#include <moonray/rendering/pbr/sampler/PixelFilter.h>
 #include <moonray/rendering/pbr/sampler/PixelScramble.h>
+#include <moonray/rendering/texturing/sampler/TextureSampler.h>
 
 #include <scene_rdl2/common/math/Color.h>
 #ifndef PLATFORM_APPLE
@@ -87,6 +93,37 @@ verifyNoOutstandingWork(const FrameState &fs)
 }
 #endif // end DEBUG
 
+// With pixel filter splatting the samples are spread uniformly over their pixel,
+// the filter only weights them.
+const pbr::BoxPixelFilter sSplatSampleFilter(1.f);
+
+// Filter weights of a sample at 'offset' within its pixel for the pixels from
+// guardBand pixels before to guardBand pixels after it, along one dimension.
+void
+computeSplatWeights(const pbr::PixelFilter &filter, float offset, unsigned guardBand, float *weights)
+{
+    for (unsigned i = 0; i <= 2 * guardBand; ++i) {
+        weights[i] = filter.evaluate(offset - 0.5f - (float(i) - float(guardBand)));
+    }
+}
+
+// Russian roulette threshold scale of the adaptive samples of a tile. The tile's
+// error over target error ratio is 1 for pixels about to converge, they get the
+// full boost, which fades out for pixels with boost times the target error.
+float
+computeRouletteScale(const FrameState &fs, const Film &film, const scene_rdl2::fb_util::Tile &tile)
+{
+    const float boost = fs.mAdaptiveRouletteBoost;
+    if (!(boost > 1.f) || fs.mExecutionMode != mcrt_common::ExecutionMode::SCALAR) {
+        return 1.f;
+    }
+    const float errorRatio = film.getAdaptiveErrorRatio(tile);
+    if (!(errorRatio > 0.f)) {
+        return 1.f;
+    }
+    return scene_rdl2::math::clamp(boost / errorRatio, 1.f, boost);
+}
+
 } // namespace
 
 //---------------------------------------------------------------------------------------------------------------
@@ -126,7 +163,14 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
 #   ifndef PLATFORM_APPLE
     if (fs.mEnableMcrtCpuAffinity) {
         driver->mEnableMcrtCpuAffinity = true;
-        if (fs.mNumRenderThreads == std::thread::hardware_concurrency()) {
+        if (fs.mNumaNodeTbl && fs.mAffinityCpuIdTbl && !fs.mAffinityCpuIdTbl->empty()) {
+            // NUMA placement, MCRT threads are attached to the cores node by node.
+            calcCpuIdFunc = calcCpuIdByTbl;
+            driver->mEnableMcrtCpuAffinityAll = false;
+            ostr << " : MCRT-CPU-affinity enabled : NUMA"
+                 << " : " << scene_rdl2::CpuSocketUtil::showCpuIdTbl("CPU-Tbl", *fs.mAffinityCpuIdTbl)
+                 << " numRenderThreads:" << fs.mNumRenderThreads;
+        } else if (fs.mNumRenderThreads == std::thread::hardware_concurrency()) {
             // We want to use all cores. We activate CPU-affinity control and
             // all MCRT threads are individually attached to the core.
             calcCpuIdFunc = calcCpuIdSequential;
@@ -194,22 +238,43 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
         */
     }
 
+    // The texture footprints and the volume light importance are recorded
+    // during the coarse passes, or during the first pass if there are none,
+    // and used by the passes after.
+    texture::TextureSampler *textureSampler = MNRY_VERIFY(texture::getTextureSampler());
+    const unsigned lastFootprintPassIdx = (driver->getLastCoarsePassIdx() == MAX_RENDER_PASSES) ?
+                                          0 : driver->getLastCoarsePassIdx();
+
+    // Under NUMA placement the memory of each TLS lives on the node of the cpu its
+    // thread was pinned to, but the thread pool doesn't tell which task ends up on
+    // which thread. Each task therefore claims a TLS of the node it runs on.
+    std::unique_ptr<mcrt_common::NumaThreadSlots> numaThreadSlots;
+#   ifndef FORCE_SINGLE_THREADED_RENDERING
+    if (fs.mNumaNodeTbl && fs.mAffinityCpuIdTbl && driver->mEnableMcrtCpuAffinity) {
+        numaThreadSlots.reset(new mcrt_common::NumaThreadSlots(*fs.mAffinityCpuIdTbl, *fs.mNumaNodeTbl,
+                                                               fs.mNumRenderThreads));
+    }
+#   endif // end ifndef FORCE_SINGLE_THREADED_RENDERING
+
     // Spawn one task for each tbb thread.
     for (unsigned ithread = 0; ithread < fs.mNumRenderThreads; ++ithread) {
 
-        mcrt_common::ThreadLocalState *topLevelTls = topLevelTlsList + ithread;
+        mcrt_common::ThreadLocalState *taskTls = topLevelTlsList + ithread;
 
-        // The topLevelTls pointer must be captured by value to prevent it changing out
+        // The taskTls pointer must be captured by value to prevent it changing out
         // from under us as other threads are subsequently spawned.
 
 #ifdef FORCE_SINGLE_THREADED_RENDERING
-        callLambda([&, topLevelTls]()
+        callLambda([&, taskTls]()
 #else
-        taskGroup.run([&, topLevelTls]()
+        taskGroup.run([&, taskTls]()
 #endif
         {
             double timeStart = scene_rdl2::util::getSeconds(); // get current time
 
+            mcrt_common::ThreadLocalState *topLevelTls =
+                numaThreadSlots ? topLevelTlsList + numaThreadSlots->claim() : taskTls;
+
             ++numTBBThreads;
 
             pbr::TLState *tls = MNRY_VERIFY(topLevelTls->mPbrTls.get());
@@ -217,6 +282,9 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
             EXCL_ACCUMULATOR_PROFILE(tls, EXCL_ACCUM_RENDER_DRIVER_OVERHEAD);
             ACCUMULATOR_PROFILE(tls, ACCUM_RENDER_DRIVER_PARALLEL);
 
+            const double timelineStart = mcrt_common::TimelineTrace::isEnabled() ?
+                                         mcrt_common::TimelineTrace::now() : -1.0;
+
             // Wait barrier until all threads are wake up and ready to go.
             // This is a busy loop and cost is big concern for REALTIME renderMode case.
             // (It's negligible when BATCH and PROGRESSIVE case).
@@ -244,6 +312,12 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
             }
 
             double timeReady = scene_rdl2::util::getSeconds(); // get current time
+            if (timelineStart >= 0.0) {
+                mcrt_common::TimelineTrace::record("waitForRenderThreads", "render",
+                                                   timelineStart, mcrt_common::TimelineTrace::now());
+            }
+
+            const mcrt_common::DtlbMissCounter dtlbMissCounter(fs.mTlbStats);
 
 
             // Embree wants these modes set on each thread it uses.
@@ -285,6 +359,11 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
                     });
                 }
 
+                if (group.mPassIdx > lastFootprintPassIdx) {
+                    textureSampler->getPrefetcher().startPrefetch(textureSampler->getTextureSystem());
+                    fs.mIntegrator->freezeVolumeLightCache();
+                }
+
                 // Record tiles currently being rendered.
                 tls->mCurrentPassIdx = group.mPassIdx;
                 if (fs.mRenderMode == RenderMode::PROGRESS_CHECKPOINT) {
@@ -292,9 +371,26 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
                     // So we set passId + 1 for tls when PROGRESS_CHECKPOINT mode.
                     tls->mCurrentPassIdx++;
                 }
-                processedSampleTotal += static_cast<unsigned long long>(renderTiles(driver, topLevelTls, group));
+                textureSampler->getCacheMonitor().passStarted(group.mPassIdx, textureSampler->getTextureSystem());
+                {
+                    mcrt_common::TimelineScope timelineScope("renderTiles", "render", "pass", group.mPassIdx);
+                    processedSampleTotal += static_cast<unsigned long long>(renderTiles(driver, topLevelTls, group));
+                }
                 ++processedTilesTotal;
 
+                if (fs.mAdaptiveQueueSizes) {
+                    // Leave the queues alone during the progressive coarse passes,
+                    // which run with reduced queue sizes on purpose (see RenderFrame.cc).
+                    const bool coarsePass = (fs.mRenderMode == RenderMode::PROGRESSIVE ||
+                                             fs.mRenderMode == RenderMode::PROGRESSIVE_FAST ||
+                                             fs.mRenderMode == RenderMode::PROGRESS_CHECKPOINT) &&
+                                            driver->getLastCoarsePassIdx() != MAX_RENDER_PASSES &&
+                                            group.mPassIdx < driver->getLastCoarsePassIdx();
+                    if (!coarsePass) {
+                        tls->updateAdaptiveQueueSizes();
+                    }
+                }
+
                 if (driver->mParallelInitFrameUpdate) {
                     // Under parallel init frame update mode, we have to check the total number of processed
                     // tiles exceeds threshold. If we processed tile more than the threshold, we turn on the
@@ -329,6 +425,11 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
                     if (driver->mFilm->getAdaptiveDone()) {
                         break;
                     }
+                    // The frame is deemed converged once more time barely lowers the error.
+                    if (driver->mAdaptiveConvergence.update(scene_rdl2::util::getSeconds(),
+                                                            driver->mFilm->getAdaptiveRegions().getError())) {
+                        break;
+                    }
                 }
             }
 
@@ -344,6 +445,7 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
                 fs.mExecutionMode == mcrt_common::ExecutionMode::XPU) {
 
                 ACCUMULATOR_PROFILE(tls, ACCUM_DRAIN_QUEUES);
+                mcrt_common::TimelineScope timelineScope("drainQueues", "queue");
 
                 if (tls->isCanceled() || stopAtPassBoundaryThreadLocal) {
 
@@ -383,6 +485,13 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
 
             tls->disableCancellation();
 
+            if (dtlbMissCounter.isValid()) {
+                uint64_t dtlbAccesses, dtlbMisses;
+                dtlbMissCounter.read(dtlbAccesses, dtlbMisses);
+                tls->mStatistics.addToCounter(pbr::STATS_DTLB_LOAD_ACCESSES, dtlbAccesses);
+                tls->mStatistics.addToCounter(pbr::STATS_DTLB_LOAD_MISSES, dtlbMisses);
+            }
+
             // Update progress.
             driver->transferAllProgressFromSingleTLS(tls);
 
@@ -406,6 +515,14 @@ RenderDriver::renderPasses(RenderDriver *driver, const FrameState &fs,
 
     taskGroup.wait();
 
+    // The render threads queue their deep and cryptomatte samples in vector mode, merge whatever is left.
+    if (pbr::DeepBuffer *deepBuffer = driver->mFilm->getDeepBuffer()) {
+        deepBuffer->flushSamples();
+    }
+    if (pbr::CryptomatteBuffer *cryptomatteBuffer = driver->mFilm->getCryptomatteBuffer()) {
+        cryptomatteBuffer->flushSamples();
+    }
+
     timingRec.finalizeRenderPasses(); // End record timing : compute average thread timing and other info
     driver->mProgressEstimation.updatePassInfo(timingRec); // update pass info
 
@@ -469,6 +586,9 @@ struct RenderSamplesParams
     float *             mDeepAovs;
     float *             mDeepVolumeAovs;
 
+    // Non null if the samples are gathered per tile, see FrameState::mTileLocalAccumulation.
+    TileAccumulator *   mTileAccumulator;
+
     mcrt_common::ScopedAccumulator * mNonRenderDriverAccumulator;
 };
 
@@ -520,6 +640,21 @@ RenderDriver::renderTiles(RenderDriver *driver,
 
         params.mRenderNodeTotal = fs.mNumRenderNodes;
         params.mRenderNodeSampleOfs = fs.mRenderNodeIdx;
+
+        // Other execution modes can deliver the samples of a pixel from any thread.
+        if (fs.mTileLocalAccumulation && fs.mExecutionMode == mcrt_common::ExecutionMode::SCALAR) {
+            float *tileAovs = params.mAovNumFloats ? arena->allocArray<float>(64 * params.mAovNumFloats) : nullptr;
+            if (fs.mPixelFilterSplat) {
+                const unsigned guardBand = TileAccumulator::getGuardBand(fs.mPixelFilter->getRadius());
+                const unsigned numSplatPixels = TileAccumulator::getNumSplatPixels(guardBand);
+                params.mTileAccumulator = arena->allocWithArgs<TileAccumulator>(params.mAovNumFloats, tileAovs,
+                    guardBand,
+                    arena->allocArray<scene_rdl2::fb_util::RenderColor>(numSplatPixels, CACHE_LINE_SIZE),
+                    arena->allocArray<float>(numSplatPixels));
+            } else {
+                params.mTileAccumulator = arena->allocWithArgs<TileAccumulator>(params.mAovNumFloats, tileAovs);
+            }
+        }
     }
 
     unsigned processedSampleTotalFilm0 = 0;
@@ -544,13 +679,42 @@ RenderDriver::renderTiles(RenderDriver *driver,
 
     pbr::CryptomatteBuffer *cryptomatteBuffer = params.mFilm->getCryptomatteBuffer();
 
+    // Record the render time of each tile during the coarse passes for the cost driven tile scheduler.
+    CostTileScheduler *costTileScheduler = nullptr;
+    if (driver->mTileWorkQueue.getPass(group.mPassIdx).isCoarsePass()) {
+        costTileScheduler = driver->getCostTileScheduler();
+    }
+
+    const RenderOutputDriver *renderOutputDriver = fs.mRenderContext->getRenderOutputDriver();
+    const bool streamOutput = renderOutputDriver && renderOutputDriver->isStreaming() &&
+                              group.mPassIdx + 1 == driver->mTileWorkQueue.getNumPasses();
+
     // Loop over current batch of tiles, we execute tile batches in parallel.
     unsigned processedSampleTotal = 0;
     for (unsigned itile = group.mStartTileIdx; itile != group.mEndTileIdx; ++itile) {
-        params.mTileIdx = itile;
-        if (!renderTile(driver, tls, group, params, deepBuffer, cryptomatteBuffer, processedSampleTotal)) {
+        params.mTileIdx = group.getTileIdx(itile);
+
+        int64_t tileTime = 0;
+        bool nonCanceled;
+        {
+            mcrt_common::Clock clock(costTileScheduler ? &tileTime : nullptr);
+            nonCanceled = renderTile(driver, tls, group, params, deepBuffer, cryptomatteBuffer, processedSampleTotal);
+        }
+        if (!nonCanceled) {
             return 0; // cancel return
         }
+        if (costTileScheduler) {
+            costTileScheduler->addTileCost(params.mTileIdx, tileTime);
+        }
+        if (deepBuffer && deepBuffer->isStreaming() &&
+            group.mPassIdx + 1 == driver->mTileWorkQueue.getNumPasses()) {
+            // the tile got all of its samples, its row of tiles may be ready to write
+            deepBuffer->finishTile((*driver->getTiles())[params.mTileIdx].mMinY);
+        }
+        if (streamOutput) {
+            // the tile got all of its samples
+            renderOutputDriver->streamTile(params.mTileIdx);
+        }
     }
     processedSampleTotalFilm0 = processedSampleTotal;
 
@@ -579,12 +743,24 @@ RenderDriver::renderTile(RenderDriver *driver,
     }
 
     const Pass &pass = driver->mTileWorkQueue.getPass(group.mPassIdx);
+    if (fs.mSamplingMode == SamplingMode::UNIFORM && fs.mUniformTileEarlyExitSamples && pass.isFinePass()) {
+        if (skipConvergedTile(driver, tls, group, params)) {
+            return true;        // converged empty tile.
+        }
+    }
+
     if (fs.mSamplingMode == SamplingMode::UNIFORM || pass.isCoarsePass()) {
         //
         // Uniform sampling tile mode
         //
-        if (!renderTileUniformSamples<false>(driver, tls, group, params, deepBuffer, cryptomatteBuffer,
-                                             pass.mStartSampleIdx, pass.mEndSampleIdx, processedSampleTotal)) {
+        const bool nonCanceled =
+            renderTileUniformSamples<false>(driver, tls, group, params, deepBuffer, cryptomatteBuffer,
+                                            pass.mStartSampleIdx, pass.mEndSampleIdx, processedSampleTotal);
+        if (params.mTileAccumulator) {
+            // keep the samples of the pixels finished before a cancel, as the atomic path does
+            params.mFilm->addTileSamples(*params.mTileAccumulator);
+        }
+        if (!nonCanceled) {
             return false; // canceled render
         }
     } else {
@@ -599,14 +775,61 @@ RenderDriver::renderTile(RenderDriver *driver,
             }
         }
     }
-    driver->mDisplayFilterDriver.requestTileUpdate(params.mTileIdx);
-
     // Update display filters after each tile is rendered in progressive mode.
     // This is done for non coarse passes because each of the neighboring
     // tiles are guaranteed to have valid data, though it might be outdated data.
     if (driver->areCoarsePassesComplete() && fs.mRenderMode == RenderMode::PROGRESSIVE) {
-        runDisplayFiltersTile(driver, params.mTileIdx, tls->mThreadIdx);
+        if (driver->mDisplayFilterDriver.isAsync()) {
+            // leave it to the display filter threads
+            driver->mDisplayFilterDriver.queueTileUpdate(params.mTileIdx);
+        } else {
+            driver->mDisplayFilterDriver.requestTileUpdate(params.mTileIdx);
+            runDisplayFiltersTile(driver, params.mTileIdx, tls->mThreadIdx);
+        }
+    } else {
+        driver->mDisplayFilterDriver.requestTileUpdate(params.mTileIdx);
+    }
+
+    return true;
+}
+
+// static function
+bool
+RenderDriver::skipConvergedTile(RenderDriver *driver,
+                                mcrt_common::ThreadLocalState *tls,
+                                const TileGroup &group,
+                                const RenderSamplesParams &params)
+//
+// return true if this tile is retired and the pass should not render it.
+//
+{
+    const rndr::FrameState &fs = driver->getFrameState();
+    const Pass &pass = driver->mTileWorkQueue.getPass(group.mPassIdx);
+    TileWorkQueue &workQueue = driver->mTileWorkQueue;
+    const scene_rdl2::fb_util::Tile &tile = (*driver->getTiles())[params.mTileIdx];
+
+    if (!workQueue.isTileRetired(params.mTileIdx)) {
+        if (pass.mStartSampleIdx < fs.mUniformTileEarlyExitSamples) {
+            return false;
+        }
+        // Asking for all the samples of the previous passes makes sure that none of them
+        // is still in flight in the vector mode queues.
+        if (!params.mFilm->isTileEmpty(tile, static_cast<float>(pass.mStartSampleIdx))) {
+            return false;
+        }
+        workQueue.retireTile(params.mTileIdx);
+    }
+    workQueue.addSkippedTile();
+
+    // Count the skipped samples as submitted, progress would never reach the end of the frame otherwise.
+    unsigned numPixels = 0;
+    for (unsigned ipix = pass.mStartPixelIdx; ipix != pass.mEndPixelIdx; ++ipix) {
+        unsigned pixelPerm = Film::getPixelFillOrder(params.mTileIdx, ipix);
+        unsigned px = (tile.mMinX & ~0x07) + (pixelPerm & 7);
+        unsigned py = (tile.mMinY & ~0x07) + (pixelPerm / 8);
+        if (fs.mViewport.contains(px, py)) ++numPixels;
     }
+    tls->mPbrTls->mPrimaryRaysSubmitted[group.mPassIdx] += numPixels * pass.getNumSamplesPerPixel();
 
     return true;
 }
@@ -638,6 +861,7 @@ RenderDriver::renderTileAdaptiveStage(RenderDriver* driver,
     const scene_rdl2::fb_util::Tile &tile = (*driver->getTiles())[params.mTileIdx];
 
     ActivePixelMask adaptiveRegion;
+    float rouletteScale = 1.f;
     switch (updateTileCondition(driver, group, params, pass.mStartSampleIdx)) {
         case AdaptiveRenderTileInfo::Stage::COMPLETED:
             return true;
@@ -646,19 +870,26 @@ RenderDriver::renderTileAdaptiveStage(RenderDriver* driver,
             break;
         case AdaptiveRenderTileInfo::Stage::ADAPTIVE_STAGE:
             adaptiveRegion = film->getAdaptiveSampleArea(tile, tls);
+            rouletteScale = computeRouletteScale(driver->getFrameState(), *film, tile);
             break;
 
     }
-    if (!renderTileUniformSamples<true>(driver,
-                                        tls,
-                                        group,
-                                        params,
-                                        deepBuffer,
-                                        cryptomatteBuffer,
-                                        pass.mStartSampleIdx,
-                                        pass.mEndSampleIdx,
-                                        processedSampleTotal,
-                                        adaptiveRegion)) {
+
+    // The scale only applies to the samples of this tile.
+    pbr::TLState* pbrTls = tls->mPbrTls.get();
+    pbrTls->mRussianRouletteScale = rouletteScale;
+    const bool rendered = renderTileUniformSamples<true>(driver,
+                                                         tls,
+                                                         group,
+                                                         params,
+                                                         deepBuffer,
+                                                         cryptomatteBuffer,
+                                                         pass.mStartSampleIdx,
+                                                         pass.mEndSampleIdx,
+                                                         processedSampleTotal,
+                                                         adaptiveRegion);
+    pbrTls->mRussianRouletteScale = 1.f;
+    if (!rendered) {
 #       ifdef PRINT_DEBUG_MESSAGE_ADAPTIVE_STAGE
         if (debug) { std::cerr << ">> RenderFrame.cc renderTileAdaptiveStage() canceled" << std::endl; }
 #       endif // end PRINT_DEBUG_MESSAGE_ADAPTIVE_STAGE
@@ -792,7 +1023,8 @@ RenderDriver::renderTileUniformSamples(RenderDriver *driver,
         bool use8x8Grid = deepBuffer ?
             (deepBuffer->getFormat() == pbr::DeepFormat::OpenDCX2_0) : false;
         sampler = pbr::Sampler(pbr::PixelScramble(px, py, fs.mFrameNumber, stereo),
-                          fs.mPixelFilter, use8x8Grid, totalNumSamples);
+                          fs.mPixelFilterSplat ? &sSplatSampleFilter : fs.mPixelFilter,
+                          use8x8Grid, totalNumSamples);
         params.mSampler = &sampler;
 
         // Used for generating good sampling index values in the case of realtime.
@@ -823,7 +1055,8 @@ RenderDriver::renderTileUniformSamples(RenderDriver *driver,
         unsigned samplesRendered = currEndSampleIdx - currStartSampleIdx;
         pbrTls->mPrimaryRaysSubmitted[group.mPassIdx] += samplesRendered; // used by non checkpoint case
         processedSampleTotal += samplesRendered;
-        if (fs.mRenderMode == RenderMode::PROGRESS_CHECKPOINT) {
+        if (fs.mRenderMode == RenderMode::PROGRESS_CHECKPOINT || fs.mNumRenderNodes > 1) {
+            // multi-machine case, sample rate is used for dynamic load balancing
             driver->mProgressEstimation.atomicAddSamples(samplesRendered);
         }
 
@@ -878,6 +1111,15 @@ RenderDriver::renderPixelScalarSamples(pbr::TLState *pbrTls,
     DebugSamplesRecArray *debugSamplesRecArray = film->getDebugSamplesRecArray();
 #endif // end DEBUG_SAMPLE_REC_MODE
 
+    // The samples are splatted into the tile accumulator as they come, the pixel
+    // totals below are only added at the end.
+    const bool splat = fs.mPixelFilterSplat && params->mTileAccumulator;
+    float splatWeightsX[2 * TileAccumulator::sMaxGuardBand + 1];
+    float splatWeightsY[2 * TileAccumulator::sMaxGuardBand + 1];
+    if (splat) {
+        film->beginTileAccumulation(*params->mTileAccumulator, px, py);
+    }
+
     // Loop over samples in current pixel. It is important to note that all samples within
     // a single pass are guaranteed to be executed on the same thread. No single tile can
     // be executed on different threads at one point in time (the TileWorkQueue ensures
@@ -968,6 +1210,13 @@ RenderDriver::renderPixelScalarSamples(pbr::TLState *pbrTls,
 
         ++numAccSamples;
 
+        if (splat) {
+            const unsigned guardBand = params->mTileAccumulator->getGuardBand();
+            computeSplatWeights(*fs.mPixelFilter, sample.pixelX, guardBand, splatWeightsX);
+            computeSplatWeights(*fs.mPixelFilter, sample.pixelY, guardBand, splatWeightsY);
+            params->mTileAccumulator->splat(px, py, splatWeightsX, splatWeightsY, sampleResult);
+        }
+
         if (params->mAovNumFloats) {
             unsigned aovFloatIndex = 0;
 
@@ -1053,20 +1302,29 @@ RenderDriver::renderPixelScalarSamples(pbr::TLState *pbrTls,
     if (numAccSamples) {
         // Update frame buffer. Scale the weights so that they are in
         // the same space as radiance.
-        {
+        if (params->mTileAccumulator) {
             EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_ADD_SAMPLE_HANDLER);
-            film->addSamplesToRenderBuffer(px, py, accRadiance,
-                    numAccSamples, &accRadiance2);
-        }
-        // update aovs
-        if (params->mAovNumFloats) {
-            EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
-            film->addSamplesToAovBuffer(px, py, localDepth, localAovs);
+            film->addSamplesToTileAccumulator(*params->mTileAccumulator, px, py, accRadiance,
+                    numAccSamples, &accRadiance2, localDepth, params->mAovNumFloats ? localAovs : nullptr);
+        } else {
+            {
+                EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_ADD_SAMPLE_HANDLER);
+                film->addSamplesToRenderBuffer(px, py, accRadiance,
+                        numAccSamples, &accRadiance2);
+            }
+            // update aovs
+            if (params->mAovNumFloats) {
+                EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
+                film->addSamplesToAovBuffer(px, py, localDepth, localAovs);
+            }
         }
     }
 
     // conditional heat map collection
     MCRT_COMMON_CLOCK_CLOSE();
+    if (fs.mRequiresHeatMap) {
+        film->markPixelDirty(px, py);
+    }
 
     return true;
 }
@@ -1188,11 +1446,16 @@ RenderDriver::renderPixelScalarSamplesFast(pbr::TLState *pbrTls,
             // Use constant black value since we don't care about adaptive samplinng in fast mode
             const scene_rdl2::fb_util::RenderColor blackConst = scene_rdl2::fb_util::RenderColor(scene_rdl2::math::ZeroTy());
             EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_ADD_SAMPLE_HANDLER);
-            film->addSamplesToRenderBuffer(px, py, accRadiance,
-                    numAccSamples, &blackConst);
+            if (params->mTileAccumulator) {
+                film->addSamplesToTileAccumulator(*params->mTileAccumulator, px, py, accRadiance,
+                        numAccSamples, &blackConst, localDepth, params->mAovNumFloats ? localAovs : nullptr);
+            } else {
+                film->addSamplesToRenderBuffer(px, py, accRadiance,
+                        numAccSamples, &blackConst);
+            }
         }
         // update aovs
-        if (params->mAovNumFloats) {
+        if (params->mAovNumFloats && !params->mTileAccumulator) {
             EXCL_ACCUMULATOR_PROFILE(pbrTls, EXCL_ACCUM_AOVS);
             film->addSamplesToAovBuffer(px, py, localDepth, localAovs);
         }
@@ -1200,6 +1463,9 @@ RenderDriver::renderPixelScalarSamplesFast(pbr::TLState *pbrTls,
 
     // conditional heat map collection
     MCRT_COMMON_CLOCK_CLOSE();
+    if (fs.mRequiresHeatMap) {
+        film->markPixelDirty(px, py);
+    }
 
     return true;
 }
@@ -1246,6 +1512,11 @@ RenderDriver::renderPixelVectorSamples(pbr::TLState *pbrTls,
     pbr::RayState **rayStatesToFree = arena->allocArray<pbr::RayState*>(numSamples);
     unsigned numRayStatesToFree = 0;
 
+    // The samples of the pixel, their primary rays are created and queued
+    // in one batch.
+    pbr::Sample *samples = arena->allocArray<pbr::Sample>(numSamples);
+    int *subpixelIndices = arena->allocArray<int>(numSamples);
+
     for (unsigned isub = startSampleIdx; isub != endSampleIdx; ++isub) {
 
     if (isub >= params->mTotalNumSamples) break;
@@ -1267,6 +1538,9 @@ RenderDriver::renderPixelVectorSamples(pbr::TLState *pbrTls,
                                                fs.mDofEnabled,
                                                shutterBias);
 
+        samples[isub - startSampleIdx] = sample;
+        subpixelIndices[isub - startSampleIdx] = int(offset);
+
         pbr::RayState *rs = rayStates[isub - startSampleIdx];
 
         // Partially fill in RayState data.
@@ -1293,21 +1567,23 @@ RenderDriver::renderPixelVectorSamples(pbr::TLState *pbrTls,
             rs->mCryptoRefN = scene_rdl2::math::Vec3f(0.f);
             rs->mCryptoUV = scene_rdl2::math::Vec2f(0.f);
         }
+    } // isub
 
-        // Queue up new primary ray.
+    // Queue up the new primary rays.
+    if (numSamples > 0) {
         ACCUMULATOR_UNPAUSE(*(params->mNonRenderDriverAccumulator));
-        bool queued =
-            fs.mIntegrator->queuePrimaryRay(pbrTls,
-                                            px, py,
-                                            int(offset),
-                                            params->mTotalNumSamples,
-                                            sample,
-                                            rs);
-        if (!queued) {
-            rayStatesToFree[numRayStatesToFree++] = rs;
-        }
+        const unsigned numQueued =
+            fs.mIntegrator->queuePrimaryRays(pbrTls,
+                                             px, py,
+                                             numSamples,
+                                             subpixelIndices,
+                                             params->mTotalNumSamples,
+                                             samples,
+                                             rayStates,
+                                             rayStatesToFree);
+        numRayStatesToFree = numSamples - numQueued;
         ACCUMULATOR_PAUSE(*(params->mNonRenderDriverAccumulator));
-    } // isub
+    }
 
     // Bulk free of raystates that were not queued
     pbrTls->freeRayStates(numRayStatesToFree, rayStatesToFree);
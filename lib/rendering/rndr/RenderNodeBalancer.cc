@@ -0,0 +1,150 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "RenderNodeBalancer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace moonray {
+namespace rndr {
+
+void
+RenderNodeBalancer::setNumRenderNodes(unsigned numRenderNodes)
+{
+    mThroughput.assign(numRenderNodes, 0.0f);
+    mWeights.clear();
+}
+
+void
+RenderNodeBalancer::updateNodeStat(unsigned nodeIdx, float samplesPerSec, float cpuUsage)
+{
+    if (nodeIdx >= mThroughput.size() || samplesPerSec <= 0.0f || cpuUsage < sMinCpuUsage) return;
+
+    float &throughput = mThroughput[nodeIdx];
+    if (throughput <= 0.0f) {
+        throughput = samplesPerSec;
+    } else {
+        throughput += (samplesPerSec - throughput) * sSmoothing;
+    }
+}
+
+bool
+RenderNodeBalancer::rebalance()
+{
+    const size_t numRenderNodes = mThroughput.size();
+    if (numRenderNodes < 2) return false;
+
+    float sum = 0.0f;
+    for (float throughput : mThroughput) {
+        if (throughput <= 0.0f) return false; // not all the nodes reported yet
+        sum += throughput;
+    }
+
+    // Keeps a minimum share for every node, so a node which got very slow still renders some tiles
+    // and keeps reporting its sample rate.
+    const float minWeight = 0.1f / numRenderNodes;
+    std::vector<float> weights(numRenderNodes);
+    float weightSum = 0.0f;
+    for (size_t i = 0; i < numRenderNodes; ++i) {
+        weights[i] = std::max(mThroughput[i] / sum, minWeight);
+        weightSum += weights[i];
+    }
+    for (float &w : weights) w /= weightSum;
+
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < numRenderNodes; ++i) {
+        const float curr = (mWeights.size() == numRenderNodes) ? mWeights[i] : 1.0f / numRenderNodes;
+        maxDiff = std::max(maxDiff, std::abs(weights[i] - curr) / curr);
+    }
+    if (maxDiff <= mImbalanceThreshold) return false;
+
+    mWeights = std::move(weights);
+    ++mRebalanceTotal;
+    return true;
+}
+
+// static function
+void
+RenderNodeBalancer::assignTiles(const std::vector<float> &weights,
+                                unsigned numTiles,
+                                unsigned renderNodeIdx,
+                                std::vector<unsigned> &tileIds)
+{
+    tileIds.clear();
+    const size_t numRenderNodes = weights.size();
+    if (renderNodeIdx >= numRenderNodes) return;
+
+    float sum = 0.0f;
+    for (float w : weights) sum += std::max(w, 0.0f);
+    if (sum <= 0.0f) return;
+
+    // The credit is computed from scratch for every tile instead of accumulated, so nodes with the
+    // same weight get bit-identical credits and ties are always resolved to the lower index.
+    std::vector<unsigned> assigned(numRenderNodes, 0);
+    for (unsigned tileId = 0; tileId < numTiles; ++tileId) {
+        size_t owner = 0;
+        double maxCredit = 0.0;
+        for (size_t i = 0; i < numRenderNodes; ++i) {
+            const double credit =
+                static_cast<double>(std::max(weights[i], 0.0f) / sum) * (tileId + 1) - assigned[i];
+            if (i == 0 || credit > maxCredit) {
+                owner = i;
+                maxCredit = credit;
+            }
+        }
+        ++assigned[owner];
+        if (owner == renderNodeIdx) tileIds.push_back(tileId);
+    }
+}
+
+// static function
+std::string
+RenderNodeBalancer::encodeWeights(const std::vector<float> &weights)
+{
+    std::ostringstream ostr;
+    ostr << std::setprecision(6);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (i) ostr << ' ';
+        ostr << weights[i];
+    }
+    return ostr.str();
+}
+
+// static function
+bool
+RenderNodeBalancer::decodeWeights(const std::string &str, std::vector<float> &weights)
+{
+    std::istringstream istr(str);
+    std::vector<float> tmp;
+    float w;
+    while (istr >> w) {
+        if (!(w >= 0.0f)) return false;
+        tmp.push_back(w);
+    }
+    if (!istr.eof()) return false;
+    weights = std::move(tmp);
+    return true;
+}
+
+std::string
+RenderNodeBalancer::show() const
+{
+    std::ostringstream ostr;
+    ostr << "RenderNodeBalancer (numRenderNodes:" << mThroughput.size()
+         << " rebalanceTotal:" << mRebalanceTotal << ") {\n";
+    for (size_t i = 0; i < mThroughput.size(); ++i) {
+        ostr << "  node:" << std::setw(3) << i
+             << " samples/sec:" << std::setw(12) << mThroughput[i]
+             << " weight:" << ((i < mWeights.size()) ? mWeights[i] : 0.0f) << '\n';
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
+} // namespace rndr
+} // namespace moonray
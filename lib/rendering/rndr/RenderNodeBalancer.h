@@ -0,0 +1,74 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+
+class RenderNodeBalancer
+//
+// Dynamic load balancing of the tile ownership under multi-machine rendering with
+// NON_OVERLAPPED_TILE task distribution.
+//
+// Each render node periodically reports its sample rate and CPU usage. The balancer keeps a smoothed
+// throughput of every node and computes relative weights (sum = 1.0) which are sent to all the render
+// nodes. All the nodes compute the same tile ownership from the same weights by assignTiles(), so the
+// tiles never overlap and no extra synchronization between nodes is needed.
+// New weights are only published when the imbalance exceeds the threshold, because every rebalance
+// restarts the render on all the nodes.
+//
+{
+public:
+    explicit RenderNodeBalancer(unsigned numRenderNodes = 0) { setNumRenderNodes(numRenderNodes); }
+
+    void setNumRenderNodes(unsigned numRenderNodes);
+    unsigned getNumRenderNodes() const { return static_cast<unsigned>(mThroughput.size()); }
+
+    // relative weight difference which triggers the rebalance (default 0.1 = 10%)
+    void setImbalanceThreshold(float threshold) { mImbalanceThreshold = threshold; }
+
+    // samplesPerSec : sample rate of the node measured by RenderProgressEstimation
+    // cpuUsage : average CPU usage of all the cores of the node by RecLoad (0.0 ~ 1.0)
+    // A report with a low CPU usage is ignored, the node is idle (i.e. finished or waiting updates)
+    // and its sample rate does not show the capacity of the node.
+    void updateNodeStat(unsigned nodeIdx, float samplesPerSec, float cpuUsage);
+
+    // Returns true if the weights are updated. Weights are only updated after all the nodes reported.
+    bool rebalance();
+
+    // Empty until the first rebalance. Empty weights mean the regular equal distribution.
+    const std::vector<float> &getWeights() const { return mWeights; }
+
+    // Returns the tile ids (index of the tile array) owned by renderNodeIdx.
+    // Tiles are interleaved in proportion to the weights by smooth weighted round-robin, this is the
+    // same order as the regular distribution (tileId % numRenderNodes) when all weights are equal.
+    static void assignTiles(const std::vector<float> &weights,
+                            unsigned numTiles,
+                            unsigned renderNodeIdx,
+                            std::vector<unsigned> &tileIds);
+
+    // Encode/decode weights to/from message string "w0 w1 ... wN-1"
+    static std::string encodeWeights(const std::vector<float> &weights);
+    static bool decodeWeights(const std::string &str, std::vector<float> &weights);
+
+    std::string show() const;
+
+private:
+    static constexpr float sMinCpuUsage = 0.5f;
+    static constexpr float sSmoothing = 0.5f; // weight of the new report
+
+    float mImbalanceThreshold {0.1f};
+
+    std::vector<float> mThroughput; // smoothed samples/sec of each node. 0 : not reported yet
+    std::vector<float> mWeights;
+    unsigned mRebalanceTotal {0};
+};
+
+} // namespace rndr
+} // namespace moonray
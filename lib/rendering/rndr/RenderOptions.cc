@@ -3,7 +3,9 @@
 
 
 #include "RenderOptions.h"
+#include "RenderDenoiser.h"
 
+#include <moonray/rendering/bvh/shading/Intersection.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 
 #include <scene_rdl2/common/except/exceptions.h>
@@ -17,6 +19,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <cstddef>
 #include <cstdlib>
 #include <iterator>
@@ -213,6 +216,131 @@ RenderOptions::parseFromCommandLine(int argc, char* argv[])
         mSocketAffinityDef = "";
     }
 
+    validFlags.push_back("-numa");
+    if (args.getFlagValues("-numa", 0, values) >= 0) {
+        setNumaAware(true);
+    }
+
+    validFlags.push_back("-huge_pages");
+    if (args.getFlagValues("-huge_pages", 1, values) >= 0) {
+        setHugePageMode(values[0]);
+    }
+
+    validFlags.push_back("-pool_growth");
+    if (args.getFlagValues("-pool_growth", 1, values) >= 0) {
+        setPoolGrowthLimit(stringToUnsignedLong(values[0]));
+    }
+
+    validFlags.push_back("-tlb_stats");
+    if (args.getFlagValues("-tlb_stats", 0, values) >= 0) {
+        setTlbStats(true);
+    }
+
+    validFlags.push_back("-sort_rays");
+    if (args.getFlagValues("-sort_rays", 0, values) >= 0) {
+        setSortRays(true);
+    }
+
+    validFlags.push_back("-display_filter_threads");
+    if (args.getFlagValues("-display_filter_threads", 1, values) >= 0) {
+        setDisplayFilterThreads(stringToUnsignedLong(values[0]));
+    }
+
+    validFlags.push_back("-temporal_reprojection");
+    if (args.getFlagValues("-temporal_reprojection", 1, values) >= 0) {
+        setTemporalReprojectionWeight(std::stof(values[0]));
+    }
+
+    validFlags.push_back("-fast_preview");
+    if (args.getFlagValues("-fast_preview", 0, values) >= 0) {
+        setFastPreview(true);
+    }
+
+    validFlags.push_back("-cost_attribution");
+    if (args.getFlagValues("-cost_attribution", 0, values) >= 0) {
+        setCostAttribution(true);
+    }
+
+    validFlags.push_back("-shadow_ray_roulette");
+    if (args.getFlagValues("-shadow_ray_roulette", 1, values) >= 0) {
+        setShadowRayRouletteThreshold(std::stof(values[0]));
+    }
+
+    validFlags.push_back("-trace_timeline");
+    if (args.getFlagValues("-trace_timeline", 1, values) >= 0) {
+        setTimelineTraceFile(values[0]);
+    }
+
+    validFlags.push_back("-denoise");
+    if (args.getFlagValues("-denoise", 1, values) >= 0) {
+        setDenoiseMode(values[0]);
+    }
+
+    validFlags.push_back("-denoise_out");
+    if (args.getFlagValues("-denoise_out", 1, values) >= 0) {
+        setDenoiseOutputFile(values[0]);
+    }
+
+    validFlags.push_back("-heat_map_report");
+    if (args.getFlagValues("-heat_map_report", 0, values) >= 0) {
+        setHeatMapReport(true);
+    }
+
+    validFlags.push_back("-heat_map_report_aov");
+    if (args.getFlagValues("-heat_map_report_aov", 1, values) >= 0) {
+        setHeatMapReportAov(values[0]);
+    }
+
+    validFlags.push_back("-metrics_port");
+    if (args.getFlagValues("-metrics_port", 1, values) >= 0) {
+        setMetricsPort(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-bake_udims");
+    if (args.getFlagValues("-bake_udims", 1, values) >= 0) {
+        setBakeUdims(values[0]);
+    }
+
+    validFlags.push_back("-frames");
+    if (args.getFlagValues("-frames", 1, values) >= 0) {
+        setSequenceFrames(values[0]);
+    }
+
+    validFlags.push_back("-frame_deltas");
+    if (args.getFlagValues("-frame_deltas", 1, values) >= 0) {
+        setFrameDeltasFile(values[0]);
+    }
+
+    validFlags.push_back("-stereo_eyes");
+    if (args.getFlagValues("-stereo_eyes", 0, values) >= 0) {
+        setStereoEyes(true);
+    }
+
+    validFlags.push_back("-background_output");
+    if (args.getFlagValues("-background_output", 0, values) >= 0) {
+        setBackgroundOutput(true);
+    }
+
+    validFlags.push_back("-debug_rays_stream");
+    if (args.getFlagValues("-debug_rays_stream", 0, values) >= 0) {
+        setStreamDebugRays(true);
+    }
+
+    validFlags.push_back("-debug_rays_sample_rate");
+    if (args.getFlagValues("-debug_rays_sample_rate", 1, values) >= 0) {
+        setDebugRayPathSampleRate(std::max(1ul, std::stoul(values[0])));
+    }
+
+    validFlags.push_back("-profile_sampling_interval");
+    if (args.getFlagValues("-profile_sampling_interval", 1, values) >= 0) {
+        setProfileSamplingInterval(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-olat_output");
+    if (args.getFlagValues("-olat_output", 1, values) >= 0) {
+        setOlatOutput(values[0]);
+    }
+
     validFlags.push_back("-dso_path");
     if (args.getFlagValues("-dso_path", 1, values) >= 0) {
         setDsoPath(values[0]);
@@ -451,6 +579,181 @@ RenderOptions::parseFromCommandLine(int argc, char* argv[])
         setGUID(scene_rdl2::util::GUID(values[0]));
     }
 
+    validFlags.push_back("-tessellation_budget");
+    if (args.getFlagValues("-tessellation_budget", 1, values) >= 0) {
+        setTessellationFaceBudget(std::stoull(values[0]));
+    }
+
+    validFlags.push_back("-tessellation_arena");
+    if (args.getFlagValues("-tessellation_arena", 0, values) >= 0) {
+        setTessellationArena(true);
+    }
+
+    validFlags.push_back("-shading_sort_key");
+    if (args.getFlagValues("-shading_sort_key", 1, values) >= 0) {
+        if (values[0] == "uv") {
+            setShadingSortKey(static_cast<int>(shading::ShadingSortKey::UV));
+        } else if (values[0] == "direction") {
+            setShadingSortKey(static_cast<int>(shading::ShadingSortKey::DIRECTION));
+        } else {
+            fprintf(stderr, "Invalid -shading_sort_key value \"%s\", expected uv or direction\n",
+                    values[0].c_str());
+            exit(-1);
+        }
+    }
+
+    validFlags.push_back("-adaptive_queue_sizes");
+    if (args.getFlagValues("-adaptive_queue_sizes", 0, values) >= 0) {
+        setAdaptiveQueueSizes(true);
+    }
+
+    validFlags.push_back("-texture_shared_cache");
+    if (args.getFlagValues("-texture_shared_cache", 1, values) >= 0) {
+        setTextureSharedCacheDir(values[0]);
+    }
+
+    validFlags.push_back("-texture_shared_cache_size");
+    if (args.getFlagValues("-texture_shared_cache_size", 1, values) >= 0) {
+        setTextureSharedCacheSizeMb(std::stoull(values[0]));
+    }
+
+    validFlags.push_back("-texture_convert_dir");
+    if (args.getFlagValues("-texture_convert_dir", 1, values) >= 0) {
+        setTextureConvertDir(values[0]);
+    }
+
+    validFlags.push_back("-texture_dedupe");
+    if (args.getFlagValues("-texture_dedupe", 0, values) >= 0) {
+        setTextureDedupe(true);
+    }
+
+    validFlags.push_back("-image_distribution_cache_size");
+    if (args.getFlagValues("-image_distribution_cache_size", 1, values) >= 0) {
+        setImageDistributionCacheSizeMb(std::stoull(values[0]));
+    }
+
+    validFlags.push_back("-texture_prefetch_threads");
+    if (args.getFlagValues("-texture_prefetch_threads", 1, values) >= 0) {
+        setTexturePrefetchThreads(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-texture_cache_auto_grow");
+    if (args.getFlagValues("-texture_cache_auto_grow", 1, values) >= 0) {
+        setTextureCacheAutoGrowMb(std::stoi(values[0]));
+    }
+
+    validFlags.push_back("-defer_instance_bvh");
+    if (args.getFlagValues("-defer_instance_bvh", 0, values) >= 0) {
+        setDeferInstanceBVH(true);
+    }
+
+    validFlags.push_back("-compact_bvh");
+    if (args.getFlagValues("-compact_bvh", 0, values) >= 0) {
+        setCompactBVH(true);
+    }
+
+    validFlags.push_back("-volume_light_cache");
+    if (args.getFlagValues("-volume_light_cache", 1, values) >= 0) {
+        setVolumeLightCacheResolution(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-volume_ratio_tracking");
+    if (args.getFlagValues("-volume_ratio_tracking", 0, values) >= 0) {
+        setVolumeRatioTracking(true);
+    }
+
+    validFlags.push_back("-volume_shader_cache");
+    if (args.getFlagValues("-volume_shader_cache", 1, values) >= 0) {
+        setVolumeShaderCacheSize(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-primary_shading_cache");
+    if (args.getFlagValues("-primary_shading_cache", 2, values) >= 0) {
+        setPrimaryShadingCacheSize(std::stoul(values[0]));
+        setPrimaryShadingCacheResolution(std::stoul(values[1]));
+    }
+
+    validFlags.push_back("-presence_cache");
+    if (args.getFlagValues("-presence_cache", 2, values) >= 0) {
+        setPresenceCacheSize(std::stoul(values[0]));
+        setPresenceCacheResolution(std::stoul(values[1]));
+    }
+
+    validFlags.push_back("-image_write_threads");
+    if (args.getFlagValues("-image_write_threads", 1, values) >= 0) {
+        setImageWriteThreads(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-image_write_mem_limit");
+    if (args.getFlagValues("-image_write_mem_limit", 1, values) >= 0) {
+        setImageWriteMemLimitMb(std::stoull(values[0]));
+    }
+
+    validFlags.push_back("-memory_budget");
+    if (args.getFlagValues("-memory_budget", 1, values) >= 0) {
+        setMemoryBudgetMb(std::stoull(values[0]));
+    }
+
+    validFlags.push_back("-checkpoint_delta");
+    if (args.getFlagValues("-checkpoint_delta", 1, values) >= 0) {
+        setCheckpointDeltaMax(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-checkpoint_emergency_dump");
+    if (args.getFlagValues("-checkpoint_emergency_dump", 0, values) >= 0) {
+        setCheckpointEmergencyDump(true);
+    }
+
+    validFlags.push_back("-checkpoint_tile_reuse");
+    if (args.getFlagValues("-checkpoint_tile_reuse", 0, values) >= 0) {
+        setCheckpointTileReuse(true);
+    }
+
+    validFlags.push_back("-adaptive_error_metric");
+    if (args.getFlagValues("-adaptive_error_metric", 1, values) >= 0) {
+        setAdaptiveErrorMetric(values[0]);
+    }
+
+    validFlags.push_back("-adaptive_stop_gain");
+    if (args.getFlagValues("-adaptive_stop_gain", 1, values) >= 0) {
+        setAdaptiveStopGainPerMinute(std::stof(values[0]));
+    }
+
+    validFlags.push_back("-adaptive_roulette");
+    if (args.getFlagValues("-adaptive_roulette", 1, values) >= 0) {
+        setAdaptiveRouletteBoost(std::stof(values[0]));
+    }
+
+    validFlags.push_back("-uniform_tile_early_exit");
+    if (args.getFlagValues("-uniform_tile_early_exit", 1, values) >= 0) {
+        setUniformTileEarlyExitSamples(std::stoul(values[0]));
+    }
+
+    validFlags.push_back("-stream_deep_output");
+    if (args.getFlagValues("-stream_deep_output", 0, values) >= 0) {
+        setStreamDeepOutput(true);
+    }
+
+    validFlags.push_back("-stream_output");
+    if (args.getFlagValues("-stream_output", 0, values) >= 0) {
+        setStreamOutput(true);
+    }
+
+    validFlags.push_back("-tile_local_accumulation");
+    if (args.getFlagValues("-tile_local_accumulation", 0, values) >= 0) {
+        setTileLocalAccumulation(true);
+    }
+
+    validFlags.push_back("-deterministic");
+    if (args.getFlagValues("-deterministic", 0, values) >= 0) {
+        setDeterministic(true);
+    }
+
+    validFlags.push_back("-pixel_filter_splat");
+    if (args.getFlagValues("-pixel_filter_splat", 0, values) >= 0) {
+        setPixelFilterSplat(true);
+    }
+
     //
     // For developer profiling only, not documented or exposed to user.
     // Use like so:
@@ -550,6 +853,168 @@ RenderOptions::getUsageMessage(const std::string& programName, bool guiMode)
 "        socketIdDef example : 0\n"
 "                              0,1 or 0-1 => 0 1\n"
 "\n"
+"    -numa\n"
+"        Place the render threads on all NUMA nodes, pinned so that the\n"
+"        threads of a node have consecutive thread indices. Each thread's\n"
+"        memory pools are allocated on its own node and the tiles are routed\n"
+"        so that the threads of a node mostly render, and write the frame\n"
+"        buffers of, the same part of the image. Ignored on single node\n"
+"        machines and when -cpuAffinity or -socketAffinity is set.\n"
+"\n"
+"    -huge_pages off|transparent|explicit\n"
+"        Back the ray state pools, the frame buffers and the BVH with 2MB\n"
+"        pages. transparent needs transparent_hugepage set to madvise or\n"
+"        always, explicit takes pages from the vm.nr_hugepages pool and\n"
+"        falls back to transparent pages when it runs dry. Arena memory\n"
+"        comes from malloc, run with GLIBC_TUNABLES=glibc.malloc.hugetlb=1\n"
+"        to put it on huge pages too. Default is off.\n"
+"\n"
+"    -pool_growth n\n"
+"        Let the ray state pools of vector mode grow on demand up to n times\n"
+"        their preallocated size instead of draining the queues early when\n"
+"        they run out. Only the memory a frame touches is used and it is\n"
+"        given back after the frame, the high water marks are printed with\n"
+"        the rendering stats. 0, the default, preallocates the pools.\n"
+"\n"
+"    -tlb_stats\n"
+"        Count the dTLB load misses of the render threads and print them\n"
+"        with the rendering stats. Needs perf_event_paranoid <= 2.\n"
+"\n"
+"    -sort_rays\n"
+"        Vector mode only. Sort each queued bundle of intersection rays by\n"
+"        direction octant and origin before tracing it, so that neighbouring\n"
+"        rays walk the same parts of the BVH. The rendering stats report the\n"
+"        average number of rays per octant run.\n"
+"\n"
+"    -display_filter_threads n\n"
+"        Run the display filters of progressive renders on n dedicated\n"
+"        threads, which update the finished tiles in batches, instead of on\n"
+"        the render threads. 0, the default, uses the render threads.\n"
+"\n"
+"    -temporal_reprojection n\n"
+"        Progressive mode only. Warp the image of the previous frame into the\n"
+"        new camera view with the pixel depths and show it as a prior worth up\n"
+"        to n samples per pixel, so the image doesn't fall back to the coarse\n"
+"        passes while the camera moves. The prior fades out once the pixels\n"
+"        received 4n samples, it is only used for display and snapshots.\n"
+"        Projective cameras only, 0 disables it (default).\n"
+"\n"
+"    -fast_preview\n"
+"        Progressive modes only. The render prep which loads all the geometry\n"
+"        (i.e. when opening a scene) only builds a preview: meshes are\n"
+"        tessellated at their control mesh resolution, the BVH is built for\n"
+"        build speed and the frame is shaded in fast mode. The next render\n"
+"        prep, which the interactive computation requests as soon as the\n"
+"        preview is displayed, reloads the geometry at full quality.\n"
+"\n"
+"    -cost_attribution\n"
+"        Time the shadow rays and print, with the light stats, the lights\n"
+"        and the materials which cost the most: shadow ray time per light,\n"
+"        shading plus shadow ray time per material. Scalar mode only, the\n"
+"        timers add some overhead to every shadow ray.\n"
+"\n"
+"    -shadow_ray_roulette t\n"
+"        Russian roulette on the shadow rays of the dim light samples, at\n"
+"        every depth: a light sample contributing less than t times the path\n"
+"        throughput only casts its shadow ray with a probability proportional\n"
+"        to its contribution. Unbiased, trades a little noise for fewer\n"
+"        shadow rays in scenes with many lights, e.g. 0.01.\n"
+"        (default = 0, off)\n"
+"\n"
+"    -trace_timeline file.json\n"
+"        Record what each thread does over time: the render prep stages, the\n"
+"        tile groups of each pass, the queue flushes and the image writes.\n"
+"        The timeline is written at the end of every frame in the Chrome\n"
+"        trace format, open it in chrome://tracing or ui.perfetto.dev. Each\n"
+"        thread keeps its last 65536 events.\n"
+"\n"
+"    -denoise optix|oidn|oidn_cpu|oidn_cuda\n"
+"        Denoise the beauty output in process once the frame is done, straight\n"
+"        from the film, guided by the RenderOutputs flagged as albedo and\n"
+"        normal denoiser inputs. This writes the same image as the standalone\n"
+"        denoise tool without writing and reading the inputs back.\n"
+"\n"
+"    -denoise_out denoised.exr\n"
+"        File the denoised beauty is written to. Defaults to the output file\n"
+"        name with \".denoised\" inserted before the extension.\n"
+"\n"
+"    -heat_map_report\n"
+"        Once the frame is done, rank the geometries and the materials by the\n"
+"        render time of the pixels they are seen through, along with the\n"
+"        hottest pixels, and write it as JSON next to the output file, with\n"
+"        \".heat_map_report.json\" in place of its extension. Needs a heat map\n"
+"        RenderOutput.\n"
+"\n"
+"    -heat_map_report_aov name\n"
+"        Also rank the ids held by this RenderOutput, e.g. a primitive\n"
+"        attribute with the closest filter holding a primitive or material id,\n"
+"        by the render time of the pixels they are found in.\n"
+"\n"
+"    -bake_udims 1001-1010,1021\n"
+"        Bake each of these udims in turn with the BakeCamera, in one process.\n"
+"        The scene and the BVH are loaded once, only the camera udim changes\n"
+"        between bakes. A <UDIM> token in the output file names and in the\n"
+"        camera normal map is replaced by the udim, output names without one\n"
+"        get the udim inserted before their extension.\n"
+"\n"
+"    -frames 101-120,130\n"
+"        Render each of these frames in turn, in one process. The frame scene\n"
+"        variable is set to each frame and the scene is updated rather than\n"
+"        reloaded, so shader DSOs, textures and scene objects are kept from one\n"
+"        frame to the next. A run of # in the output file names is replaced by\n"
+"        the zero padded frame, output names without one get the frame\n"
+"        inserted before their extension.\n"
+"\n"
+"    -frame_deltas shot.####.rdla\n"
+"        Deltas applied before rendering each frame of -frames, the run of #\n"
+"        in the file name being replaced by the zero padded frame.\n"
+"\n"
+"    -stereo_eyes\n"
+"        Render the left and then the right eye of a stereo camera in one\n"
+"        process, only the stereo_view of the primary camera changing between\n"
+"        them. The geometry, BVH, lights and textures are prepared once, and\n"
+"        the path guide learned on the left eye is kept for the right eye.\n"
+"        %V in the output file names is replaced by left or right and %v by\n"
+"        l or r, names without one get the eye inserted before their extension.\n"
+"\n"
+"    -background_output\n"
+"        Write the render outputs of a frame from a background thread while\n"
+"        the next frame of -frames, -bake_udims, -stereo_eyes or -deltas is\n"
+"        prepared and rendered, rather than leaving the render threads idle\n"
+"        meanwhile. The outputs are copied first, at most 2 frames wait to be\n"
+"        written. The beauty output file, deep outputs and outputs streamed\n"
+"        while rendering are still written at the end of their frame.\n"
+"\n"
+"    -metrics_port 9464\n"
+"        Serve the live render counters over HTTP at\n"
+"        http://<host>:<port>/metrics in the Prometheus text format: frame\n"
+"        progress, samples and rays per second by ray type, texture cache\n"
+"        hit ratio and process memory. The counters are read without\n"
+"        pausing the render. 0 (the default) disables it.\n"
+"\n"
+"    -debug_rays_stream\n"
+"        Stream the rays recorded for the debug_rays_file scene variable to\n"
+"        disk as they are traced, in compressed chunks written by each thread\n"
+"        to <debug_rays_file>.<thread>.rays, so that full frames can be\n"
+"        recorded. Use the debug_rays command to query the files or to\n"
+"        convert a region of them into a ray database.\n"
+"\n"
+"    -debug_rays_sample_rate 1\n"
+"        Only record 1 in n of the paths started in the debug ray viewport.\n"
+"\n"
+"    -profile_sampling_interval 0\n"
+"        Estimate the exclusive times of the render profile by sampling which\n"
+"        block each render thread is in every n microseconds, instead of\n"
+"        timing every block. Lowers the profiling overhead of production\n"
+"        renders. 0 (the default) times every block.\n"
+"\n"
+"    -olat_output olat.exr\n"
+"        Also write a one light at a time (OLAT) sequence to this file: one\n"
+"        light AOV per light of the scene, named olat_<index>, from the same\n"
+"        render. The camera paths and BSDF samples are shared by all the\n"
+"        lights. Lights without a label are labeled with their name, the\n"
+"        lights which share a label share their AOV.\n"
+"\n"
 "    -size 1920 1080\n"
 "        Canonical image width and height (in pixels).\n"
 "\n"
@@ -582,6 +1047,225 @@ RenderOptions::getUsageMessage(const std::string& programName, bool guiMode)
 "    -fast_geometry_update\n"
 "        Turn on supporting fast geometry update for animation.\n"
 "\n"
+"    -tessellation_budget faces\n"
+"        Upper bound of tessellated mesh faces for the whole scene. Meshes\n"
+"        inside the camera frustum keep priority, 0 means unlimited (default).\n"
+"\n"
+"    -tessellation_arena\n"
+"        Allocate the tessellated vertex buffers of the meshes from a few large\n"
+"        chunks, backed by huge pages as set by -huge_pages, which are freed\n"
+"        together when the meshes get re-tessellated.\n"
+"\n"
+"    -shading_sort_key uv|direction\n"
+"        How vectorized shading points are ordered before shading. uv sorts\n"
+"        by light set, udim, mip level and uv (default). direction also groups\n"
+"        the points of each udim by ray direction octant.\n"
+"\n"
+"    -adaptive_queue_sizes\n"
+"        Resize the vectorized per thread ray, occlusion and sample queues while\n"
+"        rendering to minimize the time spent per queued entry, instead of\n"
+"        always using the configured queue sizes.\n"
+"\n"
+"    -texture_shared_cache dir\n"
+"        Copy the texture files to dir, for example a directory in /dev/shm,\n"
+"        and open them from there. The render processes of a node using the\n"
+"        same dir read each texture file over the network once and share the\n"
+"        memory of the copy.\n"
+"\n"
+"    -texture_shared_cache_size mb\n"
+"        Size budget of the -texture_shared_cache directory in megabytes.\n"
+"        Textures which don't fit are opened from their source file, 0 means\n"
+"        unlimited (default).\n"
+"\n"
+"    -texture_convert_dir /path/to/dir\n"
+"        Convert the texture files which aren't tiled or mipmapped to .tx\n"
+"        files in this directory, as maketx would, and render with those.\n"
+"        Such files are otherwise rejected. Conversions are keyed by the\n"
+"        source path, size and modification time and shared by every process\n"
+"        using the directory, so each texture is converted once.\n"
+"\n"
+"    -texture_dedupe\n"
+"        Open the texture files which have the same content as a file already\n"
+"        used, e.g. copies of a publish under another path, as that file, so\n"
+"        they are read and cached once. Files are compared by size and header\n"
+"        first, only the ones matching another file are read and hashed.\n"
+"\n"
+"    -image_distribution_cache_size mb\n"
+"        Memory in megabytes the sampling distributions of light and light\n"
+"        filter images may keep once no light uses them, so interactive\n"
+"        sessions switching back to an image or re-creating a light don't\n"
+"        load and tabulate it again. Batch renders never keep them. Defaults\n"
+"        to 512.\n"
+"\n"
+"    -texture_prefetch_threads n\n"
+"        Record the texture regions looked up by the coarse passes, or by the\n"
+"        first pass when there are none, and load their tiles on n background\n"
+"        threads while the remaining passes render. 0 disables the prefetch\n"
+"        (default).\n"
+"\n"
+"    -texture_cache_auto_grow 8000\n"
+"        Double the texture cache, up to this size in megabytes, at the end\n"
+"        of the passes where the cache is full and re-reads tiles it evicted.\n"
+"        The grown size carries over to the next frames. The per file and\n"
+"        per pass cache stats printed with the texturing stats suggest a\n"
+"        size either way. 0 disables it (default).\n"
+"\n"
+"    -defer_instance_bvh\n"
+"        Build the BVH of an instanced primitive when a ray first reaches one\n"
+"        of its instances instead of before rendering, so primitives whose\n"
+"        instances are never hit don't pay for a BVH. Primitives holding\n"
+"        volumes or nested instances are still built before rendering.\n"
+"\n"
+"    -compact_bvh\n"
+"        Have Embree build compact BVHs, trading some ray tracing speed for\n"
+"        memory. Mostly worth it for scenes dominated by hair and fur, whose\n"
+"        curve BVHs can outweigh the curves themselves.\n"
+"\n"
+"    -volume_light_cache res\n"
+"        Record how much each light contributes to volume in-scattering in a\n"
+"        sparse grid of res cells along the longest scene axis during the\n"
+"        coarse passes, or the first pass when there are none, and evaluate\n"
+"        the lights which barely contribute to a cell less often in the\n"
+"        passes after. 0 disables the cache (default).\n"
+"\n"
+"    -volume_ratio_tracking\n"
+"        Estimate the shadow transmittance through heterogeneous volumes with\n"
+"        unbiased ratio tracking, looking the density up only at the random\n"
+"        collisions drawn against a coarse grid of density upper bounds built\n"
+"        for each vdb volume, instead of ray marching at fixed steps. Volumes\n"
+"        without bounds, or using the \"random\" overlap mode, are still ray\n"
+"        marched.\n"
+"\n"
+"    -volume_shader_cache n\n"
+"        Cache up to n volume shader results per render thread and reuse them\n"
+"        for the samples landing in the same cell, half the volume feature\n"
+"        size wide, of a motionless heterogeneous volume. Only use it with\n"
+"        volume shaders whose results only depend on the position, such as\n"
+"        procedural noise. 0 disables the cache (default).\n"
+"\n"
+"    -primary_shading_cache n res\n"
+"        Cache up to n shaded camera ray hits per render thread and reuse them\n"
+"        for the samples of later passes landing in the same cell of a res by\n"
+"        res grid over the same primitive, only integrating the lighting\n"
+"        again. The shading of camera hits becomes constant over each cell and\n"
+"        view dependent shader inputs are taken from the first sample of the\n"
+"        cell, so res should resolve the texture detail on screen. Meant for\n"
+"        progressive and realtime previews. 0 disables the cache (default).\n"
+"\n"
+"    -presence_cache n res\n"
+"        Cache up to n material presence values of shadow ray hits per render\n"
+"        thread and reuse them for the shadow rays crossing the same cell of a\n"
+"        res by res grid over the same primitive, skipping the presence shader.\n"
+"        Only use it with materials whose presence only depends on the surface\n"
+"        parameterization, such as texture mapped leaf cutouts. 0 disables the\n"
+"        cache (default).\n"
+"\n"
+"    -image_write_threads n\n"
+"        Write up to n image files of the same output, checkpoint or final, in\n"
+"        parallel (default 4). 1 writes the files one by one.\n"
+"\n"
+"    -image_write_mem_limit mb\n"
+"        Do not start another parallel image file write while the process\n"
+"        memory is above mb megabytes, unless no other file is being written.\n"
+"        0 means no limit (default).\n"
+"\n"
+"    -memory_budget mb\n"
+"        Watch the process memory against a budget of mb megabytes while\n"
+"        rendering. At 80% and 90% of the budget the texture cache is shrunk and\n"
+"        freed memory is returned to the system, textures are then read again\n"
+"        from disk more often. At 100% the render stops: it writes a checkpoint\n"
+"        and exits when checkpoint on signal is active, otherwise it finishes\n"
+"        the frame with the samples rendered so far. Every action is logged.\n"
+"        0 means no budget (default).\n"
+"\n"
+"    -checkpoint_delta n\n"
+"        Only write the tiles which changed since the previous checkpoint into\n"
+"        a delta file next to the checkpoint file, up to n deltas between two\n"
+"        full checkpoints. Resume applies the deltas on top of the checkpoint\n"
+"        file. 0 disables delta checkpoints (default).\n"
+"\n"
+"    -checkpoint_emergency_dump\n"
+"        Keep the snapshot for the signal interruption as raw tiles of the film\n"
+"        and write it uncompressed as a delta checkpoint file on SIGINT, which\n"
+"        takes seconds instead of a full checkpoint output. Needs a checkpoint\n"
+"        file of the frame first, until then the regular snapshot is used.\n"
+"        Resume applies it on top of the checkpoint file.\n"
+"\n"
+"    -checkpoint_tile_reuse\n"
+"        Save a per tile hash of the primary visibility next to the checkpoint\n"
+"        files. Resume from the checkpoint file of the other frame keeps the\n"
+"        tiles which see the same surfaces and renders the others from\n"
+"        scratch. Light and shader edits are not detected. Requires adaptive\n"
+"        sampling if some of the tiles changed.\n"
+"\n"
+"    -adaptive_error_metric luminance|relative|max_channel|tonemapped\n"
+"        Per pixel error metric of the adaptive sampling, from the difference\n"
+"        of the even and odd samples of the beauty.\n"
+"          luminance   : luminance noise scaled by sqrt of the luminance (default)\n"
+"          relative    : luminance noise relative to the luminance, dark areas\n"
+"                        converge as well as bright ones\n"
+"          max_channel : worst color channel, catches chromatic noise\n"
+"          tonemapped  : noise after a Reinhard tonemap, highlights converge\n"
+"                        early\n"
+"        The metrics have different scales, target_adaptive_error usually needs\n"
+"        to be retuned.\n"
+"\n"
+"    -adaptive_stop_gain 0.0\n"
+"        Stop an adaptive frame before it reaches target_adaptive_error once\n"
+"        the next minute of rendering is predicted to lower the error by less\n"
+"        than this fraction (e.g. 0.01 for 1%). The prediction extrapolates the\n"
+"        decay of the adaptive error over the render time. 0 disables it.\n"
+"\n"
+"    -adaptive_roulette 0.0\n"
+"        Scalar mode only. Raise the russian roulette threshold of the pixels\n"
+"        close to target_adaptive_error, up to this factor for the pixels right\n"
+"        above it, so their paths end earlier and the render time goes to the\n"
+"        noisier pixels. The factor fades out for pixels whose error is that\n"
+"        many times the target. The image stays unbiased. Values up to 1\n"
+"        disable it (default).\n"
+"\n"
+"    -uniform_tile_early_exit n\n"
+"        Uniform sampling only. Stop rendering a tile once each of its pixels\n"
+"        received at least n samples and all of them were black with zero\n"
+"        alpha, like empty background or holdout areas. This is a heuristic,\n"
+"        small or rare features behind such a tile are missed if none of the\n"
+"        first n samples hit them and AOVs are not checked. 0 disables it\n"
+"        (default).\n"
+"\n"
+"    -stream_deep_output\n"
+"        Batch mode only. Write each row of tiles to the deep output files as\n"
+"        soon as all of its tiles are rendered and free its deep data, instead\n"
+"        of keeping the whole deep image in memory until the end of the frame.\n"
+"        Only used for uniform sampling in scalar mode without checkpoints,\n"
+"        other renders write the deep files at the end of the frame.\n"
+"\n"
+"    -stream_output\n"
+"        Batch mode only. Write each tile to the render output files as soon\n"
+"        as it is rendered, as tiled exr, instead of writing the files at the\n"
+"        end of the frame. Only files holding nothing but beauty, alpha and\n"
+"        regular aovs are streamed, without checkpoints, resumable output or\n"
+"        two stage output, for uniform sampling in scalar mode without pixel\n"
+"        filter splatting. The other files are written at the end of the frame.\n"
+"\n"
+"    -tile_local_accumulation\n"
+"        Accumulate the samples of each tile in a buffer owned by the render\n"
+"        thread and add them to the frame buffers once the tile is done, which\n"
+"        avoids atomic operations per sample. Only used for uniform sampling in\n"
+"        scalar mode.\n"
+"\n"
+"    -deterministic\n"
+"        Give every tile to the same render thread in all passes and turn off\n"
+"        work stealing, so the image is identical whatever the number of\n"
+"        threads, at the cost of load balancing. Only used for uniform\n"
+"        sampling in scalar batch and progressive renders on a single machine,\n"
+"        and turns off -pixel_filter_splat.\n"
+"\n"
+"    -pixel_filter_splat\n"
+"        Splat every sample over the pixels of the pixel filter footprint\n"
+"        instead of importance sampling the filter. Requires\n"
+"        -tile_local_accumulation and a filter no wider than 9 pixels, and\n"
+"        is ignored by checkpoint and multi-machine renders.\n"
+"\n"
 "    -record_rays .raydb/.mm\n"
 "        Save ray database or mm for later debugging.\n"
 "\n"
@@ -743,6 +1427,119 @@ RenderOptions::setRdlaGlobals(std::vector<RdlaGlobal> rdlaGlobals)
     mRdlaGlobals = std::move(rdlaGlobals);
 }
 
+void
+RenderOptions::setHugePageMode(const std::string& name)
+{
+    if (name == "off") {
+        mHugePageMode = mcrt_common::HugePageMode::OFF;
+    } else if (name == "transparent") {
+        mHugePageMode = mcrt_common::HugePageMode::TRANSPARENT;
+    } else if (name == "explicit") {
+        mHugePageMode = mcrt_common::HugePageMode::EXPLICIT;
+    } else {
+        std::stringstream errMsg;
+        errMsg << "Unexpected string passed to setHugePageMode(): '" << name << "'!";
+        throw scene_rdl2::except::ValueError(errMsg.str());
+    }
+}
+
+void
+RenderOptions::setDenoiseMode(const std::string& mode)
+{
+    if (!mode.empty() && !RenderDenoiser::isValidMode(mode)) {
+        std::stringstream errMsg;
+        errMsg << "Unexpected denoiser mode passed to setDenoiseMode(): '" << mode << "'!";
+        throw scene_rdl2::except::ValueError(errMsg.str());
+    }
+    mDenoiseMode = mode;
+}
+
+void
+RenderOptions::setBakeUdims(const std::string& udims)
+{
+    auto fail = [&]() {
+        std::stringstream errMsg;
+        errMsg << "Unexpected udim list passed to setBakeUdims(): '" << udims << "'!";
+        throw scene_rdl2::except::ValueError(errMsg.str());
+    };
+
+    mBakeUdims.clear();
+    std::stringstream ranges(udims);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        char extra = 0;
+        const int numRead = sscanf(range.c_str(), "%d-%d%c", &first, &last, &extra);
+        if (numRead == 1) {
+            last = first;
+        } else if (numRead != 2) {
+            fail();
+        }
+        if (first < 1001 || last < first) {
+            fail();
+        }
+        for (int udim = first; udim <= last; ++udim) {
+            mBakeUdims.push_back(udim);
+        }
+    }
+}
+
+void
+RenderOptions::setSequenceFrames(const std::string& frames)
+{
+    auto fail = [&]() {
+        std::stringstream errMsg;
+        errMsg << "Unexpected frame list passed to setSequenceFrames(): '" << frames << "'!";
+        throw scene_rdl2::except::ValueError(errMsg.str());
+    };
+
+    mSequenceFrames.clear();
+    std::stringstream ranges(frames);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        char extra = 0;
+        const int numRead = sscanf(range.c_str(), "%d-%d%c", &first, &last, &extra);
+        if (numRead == 1) {
+            last = first;
+        } else if (numRead != 2) {
+            fail();
+        }
+        if (first < 0 || last < first) {
+            fail();
+        }
+        for (int frame = first; frame <= last; ++frame) {
+            mSequenceFrames.push_back(frame);
+        }
+    }
+}
+
+void
+RenderOptions::setAdaptiveErrorMetric(const std::string& name)
+{
+    if (name == "luminance") {
+        mAdaptiveErrorMetric = AdaptiveErrorMetricType::LUMINANCE;
+    } else if (name == "relative") {
+        mAdaptiveErrorMetric = AdaptiveErrorMetricType::RELATIVE;
+    } else if (name == "max_channel") {
+        mAdaptiveErrorMetric = AdaptiveErrorMetricType::MAX_CHANNEL;
+    } else if (name == "tonemapped") {
+        mAdaptiveErrorMetric = AdaptiveErrorMetricType::TONEMAPPED;
+    } else {
+        std::stringstream errMsg;
+        errMsg << "Unexpected string passed to setAdaptiveErrorMetric(): '" << name << "'!";
+        throw scene_rdl2::except::ValueError(errMsg.str());
+    }
+}
+
 void
 RenderOptions::setDesiredExecutionMode(const std::string &execMode)
 {
@@ -808,6 +1605,10 @@ RenderOptions::setupTLSInitParams(mcrt_common::TLSInitParams *params, bool realt
     if (!mSocketAffinityDef.empty()) {
         params->mSocketAffinityDef = std::make_shared<std::string>(mSocketAffinityDef);
     }
+    params->mNumaAware = mNumaAware;
+    params->mHugePageMode = mHugePageMode;
+    params->mPoolGrowthLimit = mPoolGrowthLimit;
+    params->mSortRays = mSortRays;
 }
 
 std::string
@@ -929,6 +1730,67 @@ RenderOptions::show() const
          << scene_rdl2::str_util::addIndent(showVectorString("mDeltasFiles", mDeltasFiles)) << '\n'
          << "  mDsoPath:" << mDsoPath << '\n'
          << "  mTextureCacheSizeMb:" << mTextureCacheSizeMb << '\n'
+         << "  mTessellationFaceBudget:" << mTessellationFaceBudget << '\n'
+         << "  mTessellationArena:" << showBool(mTessellationArena) << '\n'
+         << "  mShadingSortKey:" << mShadingSortKey << '\n'
+         << "  mAdaptiveQueueSizes:" << showBool(mAdaptiveQueueSizes) << '\n'
+         << "  mTextureSharedCacheDir:" << mTextureSharedCacheDir << '\n'
+         << "  mTextureSharedCacheSizeMb:" << mTextureSharedCacheSizeMb << '\n'
+         << "  mTextureConvertDir:" << mTextureConvertDir << '\n'
+         << "  mTextureDedupe:" << showBool(mTextureDedupe) << '\n'
+         << "  mImageDistributionCacheSizeMb:" << mImageDistributionCacheSizeMb << '\n'
+         << "  mTexturePrefetchThreads:" << mTexturePrefetchThreads << '\n'
+         << "  mTextureCacheAutoGrowMb:" << mTextureCacheAutoGrowMb << '\n'
+         << "  mDeferInstanceBVH:" << showBool(mDeferInstanceBVH) << '\n'
+         << "  mCompactBVH:" << showBool(mCompactBVH) << '\n'
+         << "  mVolumeLightCacheResolution:" << mVolumeLightCacheResolution << '\n'
+         << "  mVolumeRatioTracking:" << showBool(mVolumeRatioTracking) << '\n'
+         << "  mVolumeShaderCacheSize:" << mVolumeShaderCacheSize << '\n'
+         << "  mPrimaryShadingCacheSize:" << mPrimaryShadingCacheSize << '\n'
+         << "  mPrimaryShadingCacheResolution:" << mPrimaryShadingCacheResolution << '\n'
+         << "  mPresenceCacheSize:" << mPresenceCacheSize << '\n'
+         << "  mPresenceCacheResolution:" << mPresenceCacheResolution << '\n'
+         << "  mImageWriteThreads:" << mImageWriteThreads << '\n'
+         << "  mImageWriteMemLimitMb:" << mImageWriteMemLimitMb << '\n'
+         << "  mMemoryBudgetMb:" << mMemoryBudgetMb << '\n'
+         << "  mCheckpointDeltaMax:" << mCheckpointDeltaMax << '\n'
+         << "  mCheckpointEmergencyDump:" << showBool(mCheckpointEmergencyDump) << '\n'
+         << "  mCheckpointTileReuse:" << showBool(mCheckpointTileReuse) << '\n'
+         << "  mAdaptiveErrorMetric:" << static_cast<int>(mAdaptiveErrorMetric) << '\n'
+         << "  mAdaptiveStopGainPerMinute:" << mAdaptiveStopGainPerMinute << '\n'
+         << "  mAdaptiveRouletteBoost:" << mAdaptiveRouletteBoost << '\n'
+         << "  mUniformTileEarlyExitSamples:" << mUniformTileEarlyExitSamples << '\n'
+         << "  mStreamDeepOutput:" << showBool(mStreamDeepOutput) << '\n'
+         << "  mStreamOutput:" << showBool(mStreamOutput) << '\n'
+         << "  mTileLocalAccumulation:" << showBool(mTileLocalAccumulation) << '\n'
+         << "  mDeterministic:" << showBool(mDeterministic) << '\n'
+         << "  mPixelFilterSplat:" << showBool(mPixelFilterSplat) << '\n'
+         << "  mNumaAware:" << showBool(mNumaAware) << '\n'
+         << "  mHugePageMode:" << mcrt_common::showHugePageMode(mHugePageMode) << '\n'
+         << "  mTlbStats:" << showBool(mTlbStats) << '\n'
+         << "  mSortRays:" << showBool(mSortRays) << '\n'
+         << "  mPoolGrowthLimit:" << mPoolGrowthLimit << '\n'
+         << "  mDisplayFilterThreads:" << mDisplayFilterThreads << '\n'
+         << "  mTemporalReprojectionWeight:" << mTemporalReprojectionWeight << '\n'
+         << "  mFastPreview:" << showBool(mFastPreview) << '\n'
+         << "  mCostAttribution:" << showBool(mCostAttribution) << '\n'
+         << "  mShadowRayRouletteThreshold:" << mShadowRayRouletteThreshold << '\n'
+         << "  mTimelineTraceFile:" << mTimelineTraceFile << '\n'
+         << "  mDenoiseMode:" << mDenoiseMode << '\n'
+         << "  mDenoiseOutputFile:" << mDenoiseOutputFile << '\n'
+         << "  mHeatMapReport:" << showBool(mHeatMapReport) << '\n'
+         << "  mHeatMapReportAov:" << mHeatMapReportAov << '\n'
+         << "  mMetricsPort:" << mMetricsPort << '\n'
+         << "  mBakeUdims:" << mBakeUdims.size() << '\n'
+         << "  mSequenceFrames:" << mSequenceFrames.size() << '\n'
+         << "  mFrameDeltasFile:" << mFrameDeltasFile << '\n'
+         << "  mStereoEyes:" << showBool(mStereoEyes) << '\n'
+         << "  mKeepPathGuide:" << showBool(mKeepPathGuide) << '\n'
+         << "  mBackgroundOutput:" << showBool(mBackgroundOutput) << '\n'
+         << "  mStreamDebugRays:" << showBool(mStreamDebugRays) << '\n'
+         << "  mDebugRayPathSampleRate:" << mDebugRayPathSampleRate << '\n'
+         << "  mProfileSamplingInterval:" << mProfileSamplingInterval << '\n'
+         << "  mOlatOutput:" << mOlatOutput << '\n'
          << scene_rdl2::str_util::addIndent(showAttributeOverrides(mAttributeOverrides)) << '\n'
          << scene_rdl2::str_util::addIndent(showRdlaGlobals(mRdlaGlobals)) << '\n'
          << "  mCommandLine:" << mCommandLine << '\n'
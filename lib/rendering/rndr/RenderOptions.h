@@ -13,6 +13,7 @@
 #include <scene_rdl2/render/util/GUID.h>
 #include <moonray/rendering/shading/Shading.h>
 #include <moonray/rendering/mcrt_common/ExecutionMode.h>
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
 // #include <moonray/rendering/mcrt_common/TextureSystem.h>
 
 #include <cstdint>
@@ -170,6 +171,302 @@ public:
     void setTextureCacheSizeMb(int sizeMb) { mTextureCacheSizeMb = sizeMb; }
     int getTextureCacheSizeMb() const { return mTextureCacheSizeMb; }
 
+    // Scene wide upper bound of tessellated mesh faces, 0 means unlimited.
+    void setTessellationFaceBudget(size_t faceBudget) { mTessellationFaceBudget = faceBudget; }
+    size_t getTessellationFaceBudget() const { return mTessellationFaceBudget; }
+
+    // Carve the tessellated vertex buffers out of a few large chunks, backed as
+    // set by the huge page mode, instead of allocating each of them on its own.
+    void setTessellationArena(bool arena) { mTessellationArena = arena; }
+    bool getTessellationArena() const { return mTessellationArena; }
+
+    // Layout of the vectorized shading sort key, a shading::ShadingSortKey value.
+    void setShadingSortKey(int sortKey) { mShadingSortKey = sortKey; }
+    int getShadingSortKey() const { return mShadingSortKey; }
+
+    // Adapt the local queue sizes to the measured handler cost while rendering.
+    void setAdaptiveQueueSizes(bool adaptive) { mAdaptiveQueueSizes = adaptive; }
+    bool getAdaptiveQueueSizes() const { return mAdaptiveQueueSizes; }
+
+    // Node local directory the texture files are copied to and shared from by
+    // all the render processes of the node, empty disables the shared cache.
+    void setTextureSharedCacheDir(const std::string& dir) { mTextureSharedCacheDir = dir; }
+    const std::string& getTextureSharedCacheDir() const { return mTextureSharedCacheDir; }
+
+    // Size budget of the shared texture cache directory, 0 means unlimited.
+    void setTextureSharedCacheSizeMb(size_t sizeMb) { mTextureSharedCacheSizeMb = sizeMb; }
+    size_t getTextureSharedCacheSizeMb() const { return mTextureSharedCacheSizeMb; }
+
+    // Directory the untiled or unmipped texture files are converted to tiled,
+    // mipmapped .tx files in, shared by all the processes using it. Empty
+    // disables the conversion.
+    void setTextureConvertDir(const std::string& dir) { mTextureConvertDir = dir; }
+    const std::string& getTextureConvertDir() const { return mTextureConvertDir; }
+
+    // Texture files with the same content are opened as a single file.
+    void setTextureDedupe(bool dedupe) { mTextureDedupe = dedupe; }
+    bool getTextureDedupe() const { return mTextureDedupe; }
+
+    // Memory the light image distributions no light uses any more may keep
+    // between frames of interactive sessions, in megabytes.
+    void setImageDistributionCacheSizeMb(size_t sizeMb) { mImageDistributionCacheSizeMb = sizeMb; }
+    size_t getImageDistributionCacheSizeMb() const { return mImageDistributionCacheSizeMb; }
+
+    // Number of threads prefetching the texture tiles touched by the first
+    // passes during the remaining passes, 0 disables the prefetch.
+    void setTexturePrefetchThreads(unsigned numThreads) { mTexturePrefetchThreads = numThreads; }
+    unsigned getTexturePrefetchThreads() const { return mTexturePrefetchThreads; }
+
+    // Texture cache size in megabytes the cache may grow to when it thrashes,
+    // 0 disables growing it.
+    void setTextureCacheAutoGrowMb(int sizeMb) { mTextureCacheAutoGrowMb = sizeMb; }
+    int getTextureCacheAutoGrowMb() const { return mTextureCacheAutoGrowMb; }
+
+    // Build the BVH of instanced primitives when a ray first reaches one of
+    // their instances instead of at scene build time.
+    void setDeferInstanceBVH(bool defer) { mDeferInstanceBVH = defer; }
+    bool getDeferInstanceBVH() const { return mDeferInstanceBVH; }
+
+    // Build smaller BVHs at some cost in traversal speed.
+    void setCompactBVH(bool compact) { mCompactBVH = compact; }
+    bool getCompactBVH() const { return mCompactBVH; }
+
+    // Number of cells along the longest scene axis of the grid caching the
+    // light importance of volume in-scattering, 0 disables the cache.
+    void setVolumeLightCacheResolution(unsigned res) { mVolumeLightCacheResolution = res; }
+    unsigned getVolumeLightCacheResolution() const { return mVolumeLightCacheResolution; }
+
+    // Estimate the shadow transmittance of heterogeneous volumes with ratio
+    // tracking against their majorant grids instead of ray marching.
+    void setVolumeRatioTracking(bool enable) { mVolumeRatioTracking = enable; }
+    bool getVolumeRatioTracking() const { return mVolumeRatioTracking; }
+
+    // Number of volume shader results each render thread caches, 0 disables
+    // the cache.
+    void setVolumeShaderCacheSize(unsigned size) { mVolumeShaderCacheSize = size; }
+    unsigned getVolumeShaderCacheSize() const { return mVolumeShaderCacheSize; }
+
+    // Number of shaded camera ray hits each render thread caches, 0 disables
+    // the cache, and number of cells along u and v of each primitive they are
+    // shared over.
+    void setPrimaryShadingCacheSize(unsigned size) { mPrimaryShadingCacheSize = size; }
+    unsigned getPrimaryShadingCacheSize() const { return mPrimaryShadingCacheSize; }
+    void setPrimaryShadingCacheResolution(unsigned res) { mPrimaryShadingCacheResolution = res; }
+    unsigned getPrimaryShadingCacheResolution() const { return mPrimaryShadingCacheResolution; }
+
+    // Number of presence values of shadow ray hits each render thread caches,
+    // 0 disables the cache, and number of cells along u and v of each
+    // primitive they are shared over.
+    void setPresenceCacheSize(unsigned size) { mPresenceCacheSize = size; }
+    unsigned getPresenceCacheSize() const { return mPresenceCacheSize; }
+    void setPresenceCacheResolution(unsigned res) { mPresenceCacheResolution = res; }
+    unsigned getPresenceCacheResolution() const { return mPresenceCacheResolution; }
+
+    // Max number of image files written in parallel by a single output action.
+    void setImageWriteThreads(unsigned n) { mImageWriteThreads = n; }
+    unsigned getImageWriteThreads() const { return mImageWriteThreads; }
+
+    // Process memory limit in MB above which no more parallel image file write
+    // is started, 0 means no limit.
+    void setImageWriteMemLimitMb(size_t limit) { mImageWriteMemLimitMb = limit; }
+    size_t getImageWriteMemLimitMb() const { return mImageWriteMemLimitMb; }
+
+    // Process memory budget in MB watched while a frame renders. Memory is
+    // released from the texture cache as the process gets close to it and the
+    // render is stopped once it is reached, 0 means no budget.
+    void setMemoryBudgetMb(size_t budget) { mMemoryBudgetMb = budget; }
+    size_t getMemoryBudgetMb() const { return mMemoryBudgetMb; }
+
+    // Max number of delta checkpoints written between two full checkpoints,
+    // 0 disables delta checkpoints.
+    void setCheckpointDeltaMax(unsigned n) { mCheckpointDeltaMax = n; }
+    unsigned getCheckpointDeltaMax() const { return mCheckpointDeltaMax; }
+
+    // Keeps the signal interruption snapshot as raw delta checkpoint data, which is
+    // written within seconds instead of going through the encoded checkpoint output.
+    void setCheckpointEmergencyDump(bool flag) { mCheckpointEmergencyDump = flag; }
+    bool getCheckpointEmergencyDump() const { return mCheckpointEmergencyDump; }
+
+    // Saves a per tile primary visibility hash next to the checkpoint files, and
+    // resume keeps only the tiles whose hash matches the current frame.
+    void setCheckpointTileReuse(bool reuse) { mCheckpointTileReuse = reuse; }
+    bool getCheckpointTileReuse() const { return mCheckpointTileReuse; }
+
+    // Per pixel error metric of the adaptive sampling. Throws if the name is unknown.
+    void setAdaptiveErrorMetric(const std::string& name);
+    void setAdaptiveErrorMetric(AdaptiveErrorMetricType type) { mAdaptiveErrorMetric = type; }
+    AdaptiveErrorMetricType getAdaptiveErrorMetric() const { return mAdaptiveErrorMetric; }
+
+    // Adaptive frames stop once the next minute of rendering is predicted to remove less
+    // than this fraction of the error, see AdaptiveConvergenceEstimator. 0 disables it.
+    void setAdaptiveStopGainPerMinute(float gain) { mAdaptiveStopGainPerMinute = gain; }
+    float getAdaptiveStopGainPerMinute() const { return mAdaptiveStopGainPerMinute; }
+
+    // Adaptive sampling raises the russian roulette threshold of the pixels close to
+    // their target error by up to this factor. Values up to 1 disable it.
+    void setAdaptiveRouletteBoost(float boost) { mAdaptiveRouletteBoost = boost; }
+    float getAdaptiveRouletteBoost() const { return mAdaptiveRouletteBoost; }
+
+    // Uniform sampling stops rendering the tiles whose pixels all received at least
+    // this many samples and every sample came back black with zero alpha. 0 disables it.
+    void setUniformTileEarlyExitSamples(unsigned n) { mUniformTileEarlyExitSamples = n; }
+    unsigned getUniformTileEarlyExitSamples() const { return mUniformTileEarlyExitSamples; }
+
+    // Batch mode writes the deep files row of tiles by row of tiles while rendering
+    // instead of keeping the whole deep image in memory until the end of the frame.
+    void setStreamDeepOutput(bool stream) { mStreamDeepOutput = stream; }
+    bool getStreamDeepOutput() const { return mStreamDeepOutput; }
+
+    // Batch mode writes the render output files tile by tile while rendering
+    // instead of writing them at the end of the frame.
+    void setStreamOutput(bool stream) { mStreamOutput = stream; }
+    bool getStreamOutput() const { return mStreamOutput; }
+
+    // Scalar render threads gather the samples of the tile they are rendering in a
+    // thread owned buffer and add it to the film in one go when the tile is done,
+    // instead of adding every pixel to the film buffers with atomics.
+    void setTileLocalAccumulation(bool local) { mTileLocalAccumulation = local; }
+    bool getTileLocalAccumulation() const { return mTileLocalAccumulation; }
+
+    // Every tile is rendered by the same thread in every pass and threads don't
+    // steal work from each other, so the image doesn't depend on the number of
+    // threads or on their scheduling. Uniform sampling in scalar mode only.
+    void setDeterministic(bool deterministic) { mDeterministic = deterministic; }
+    bool getDeterministic() const { return mDeterministic; }
+
+    // Samples are spread over every pixel of the pixel filter footprint, weighted by
+    // the filter, instead of being placed by importance sampling the filter. Needs the
+    // tile local accumulation, see FrameState::mPixelFilterSplat.
+    void setPixelFilterSplat(bool splat) { mPixelFilterSplat = splat; }
+    bool getPixelFilterSplat() const { return mPixelFilterSplat; }
+
+    // Pins the render threads node by node on NUMA machines, allocates their thread
+    // local memory on their own node and routes the tiles so that a node mostly
+    // writes its own part of the frame buffers. Explicit CPU or socket affinity wins.
+    void setNumaAware(bool numa) { mNumaAware = numa; }
+    bool getNumaAware() const { return mNumaAware; }
+
+    // Backs the RayState and CL1 pools, the film buffers and the BVH with huge pages
+    // to cut dTLB misses. Accepts "off", "transparent" and "explicit", throws otherwise.
+    void setHugePageMode(const std::string& name);
+    void setHugePageMode(mcrt_common::HugePageMode mode) { mHugePageMode = mode; }
+    mcrt_common::HugePageMode getHugePageMode() const { return mHugePageMode; }
+
+    // 0 preallocates the RayState and CL1 pools. n > 0 lets them grow on demand up
+    // to n times their preallocated size and returns their memory after each frame.
+    void setPoolGrowthLimit(unsigned limit) { mPoolGrowthLimit = limit; }
+    unsigned getPoolGrowthLimit() const { return mPoolGrowthLimit; }
+
+    // Counts the dTLB misses of the render threads and reports them with the rendering stats.
+    void setTlbStats(bool tlbStats) { mTlbStats = tlbStats; }
+    bool getTlbStats() const { return mTlbStats; }
+
+    // Sorts the bundled intersection rays by direction octant and origin before
+    // tracing them, for BVH coherence.
+    void setSortRays(bool sortRays) { mSortRays = sortRays; }
+    bool getSortRays() const { return mSortRays; }
+
+    // Runs the display filters of progressive mode on n dedicated threads instead
+    // of the render threads. 0 keeps them on the render threads.
+    void setDisplayFilterThreads(unsigned n) { mDisplayFilterThreads = n; }
+    unsigned getDisplayFilterThreads() const { return mDisplayFilterThreads; }
+
+    // Progressive mode reprojects the image of the previous frame into the new view and
+    // shows it as a prior worth up to this many samples per pixel. 0 disables it.
+    void setTemporalReprojectionWeight(float weight) { mTemporalReprojectionWeight = weight; }
+    float getTemporalReprojectionWeight() const { return mTemporalReprojectionWeight; }
+
+    // Progressive modes build coarse preview geometry on the render prep which loads all
+    // the geometry, and full quality geometry on the next one.
+    void setFastPreview(bool fastPreview) { mFastPreview = fastPreview; }
+    bool getFastPreview() const { return mFastPreview; }
+
+    // Times the shadow rays of the scalar integrator and attributes the time to the
+    // light and to the material at the shading point, reported with the light stats.
+    void setCostAttribution(bool costAttribution) { mCostAttribution = costAttribution; }
+    bool getCostAttribution() const { return mCostAttribution; }
+
+    // Light samples contributing less than this fraction of the path throughput
+    // only cast their shadow ray with a probability proportional to their
+    // contribution, and are reweighted when they do. 0 turns it off.
+    void setShadowRayRouletteThreshold(float threshold) { mShadowRayRouletteThreshold = threshold; }
+    float getShadowRayRouletteThreshold() const { return mShadowRayRouletteThreshold; }
+
+    // Records a per thread timeline of the render prep stages, the render passes, the
+    // queue flushes and the image writes, written to this Chrome trace file at the
+    // end of each frame. Empty disables it.
+    void setTimelineTraceFile(const std::string &filename) { mTimelineTraceFile = filename; }
+    const std::string &getTimelineTraceFile() const { return mTimelineTraceFile; }
+
+    // Denoises the beauty output in process with this denoiser: "optix", "oidn",
+    // "oidn_cpu" or "oidn_cuda". Empty disables it. The denoised image goes to
+    // the denoise output file, which defaults to the output file name with
+    // ".denoised" inserted before the extension.
+    void setDenoiseMode(const std::string &mode);
+    const std::string &getDenoiseMode() const { return mDenoiseMode; }
+    void setDenoiseOutputFile(const std::string &filename) { mDenoiseOutputFile = filename; }
+    const std::string &getDenoiseOutputFile() const { return mDenoiseOutputFile; }
+
+    // Writes a JSON report ranking the geometries and the materials by the heat
+    // map time of the pixels they are seen through next to the output file once
+    // the frame is done. The ids held by the heat map report AOV, the name of a
+    // RenderOutput, are ranked too when it is set.
+    void setHeatMapReport(bool flag) { mHeatMapReport = flag; }
+    bool getHeatMapReport() const { return mHeatMapReport; }
+    void setHeatMapReportAov(const std::string &name) { mHeatMapReportAov = name; }
+    const std::string &getHeatMapReportAov() const { return mHeatMapReportAov; }
+
+    // Serves the live render counters in the Prometheus text format on this port
+    // at /metrics. 0 disables it.
+    void setMetricsPort(unsigned port) { mMetricsPort = port; }
+    unsigned getMetricsPort() const { return mMetricsPort; }
+
+    // Udims the bake camera bakes one after the other in the same process, the
+    // scene and the BVH staying loaded. Set from a list such as "1001-1010,1021".
+    void setBakeUdims(const std::string& udims);
+    const std::vector<int>& getBakeUdims() const { return mBakeUdims; }
+
+    // Frames rendered one after the other in the same process, the scene being
+    // updated rather than reloaded between them. Set from a list such as
+    // "101-120,130". The frame deltas file name has a run of # replaced by the
+    // frame and is applied before rendering each frame.
+    void setSequenceFrames(const std::string& frames);
+    const std::vector<int>& getSequenceFrames() const { return mSequenceFrames; }
+    void setFrameDeltasFile(const std::string& file) { mFrameDeltasFile = file; }
+    const std::string& getFrameDeltasFile() const { return mFrameDeltasFile; }
+
+    // Both eyes of a stereo camera are rendered one after the other in the
+    // same process, the scene being prepared once. The path guide of the
+    // previous frame is kept while mKeepPathGuide is set, the application sets
+    // it for the second eye.
+    void setStereoEyes(bool stereoEyes) { mStereoEyes = stereoEyes; }
+    bool getStereoEyes() const { return mStereoEyes; }
+    void setKeepPathGuide(bool keep) { mKeepPathGuide = keep; }
+    bool getKeepPathGuide() const { return mKeepPathGuide; }
+
+    // The render outputs of a frame are written by the ImageWriteDriver thread while the
+    // next frame of a sequence renders, the application waits for them before exiting.
+    void setBackgroundOutput(bool backgroundOutput) { mBackgroundOutput = backgroundOutput; }
+    bool getBackgroundOutput() const { return mBackgroundOutput; }
+
+    // Debug ray recording (the debug_rays_file scene variable) streams compressed
+    // per thread chunks to "<debug_rays_file>.<thread>.rays" instead of building
+    // the ray database in memory, and only records 1 in n paths.
+    void setStreamDebugRays(bool stream) { mStreamDebugRays = stream; }
+    bool getStreamDebugRays() const { return mStreamDebugRays; }
+    void setDebugRayPathSampleRate(unsigned n) { mDebugRayPathSampleRate = n; }
+    unsigned getDebugRayPathSampleRate() const { return mDebugRayPathSampleRate; }
+
+    // Sampling interval of the exclusive profile accumulators in microseconds,
+    // 0 times every block. See setExclusiveAccumulatorSamplingInterval().
+    void setProfileSamplingInterval(unsigned microseconds) { mProfileSamplingInterval = microseconds; }
+    unsigned getProfileSamplingInterval() const { return mProfileSamplingInterval; }
+
+    // File the OLAT (one light at a time) light AOVs are written to, one AOV
+    // per light of the scene from a single render. Empty disables them.
+    void setOlatOutput(const std::string& fileName) { mOlatOutput = fileName; }
+    const std::string& getOlatOutput() const { return mOlatOutput; }
+
     /// Retrieves the attribute overrides for SceneObjects in the scene.
     std::vector<AttributeOverride> getAttributeOverrides() const;
 
@@ -269,6 +566,67 @@ private:
     std::vector<std::string> mDeltasFiles;
     std::string mDsoPath;
     int mTextureCacheSizeMb;
+    size_t mTessellationFaceBudget {0};
+    bool mTessellationArena {false};
+    int mShadingSortKey {0};
+    bool mAdaptiveQueueSizes {false};
+    std::string mTextureSharedCacheDir;
+    size_t mTextureSharedCacheSizeMb {0};
+    std::string mTextureConvertDir;
+    bool mTextureDedupe {false};
+    size_t mImageDistributionCacheSizeMb {512};
+    unsigned mTexturePrefetchThreads {0};
+    int mTextureCacheAutoGrowMb {0};
+    bool mDeferInstanceBVH {false};
+    bool mCompactBVH {false};
+    unsigned mVolumeLightCacheResolution {0};
+    bool mVolumeRatioTracking {false};
+    unsigned mVolumeShaderCacheSize {0};
+    unsigned mPrimaryShadingCacheSize {0};
+    unsigned mPrimaryShadingCacheResolution {16};
+    unsigned mPresenceCacheSize {0};
+    unsigned mPresenceCacheResolution {64};
+    unsigned mImageWriteThreads {4};
+    size_t mImageWriteMemLimitMb {0};
+    size_t mMemoryBudgetMb {0};
+    unsigned mCheckpointDeltaMax {0};
+    bool mCheckpointEmergencyDump {false};
+    bool mCheckpointTileReuse {false};
+    AdaptiveErrorMetricType mAdaptiveErrorMetric {AdaptiveErrorMetricType::LUMINANCE};
+    float mAdaptiveStopGainPerMinute {0.0f};
+    float mAdaptiveRouletteBoost {0.0f};
+    unsigned mUniformTileEarlyExitSamples {0};
+    bool mStreamDeepOutput {false};
+    bool mStreamOutput {false};
+    bool mTileLocalAccumulation {false};
+    bool mDeterministic {false};
+    bool mPixelFilterSplat {false};
+    bool mNumaAware {false};
+    mcrt_common::HugePageMode mHugePageMode {mcrt_common::HugePageMode::OFF};
+    bool mTlbStats {false};
+    bool mSortRays {false};
+    unsigned mPoolGrowthLimit {0};
+    unsigned mDisplayFilterThreads {0};
+    float mTemporalReprojectionWeight {0.0f};
+    bool mFastPreview {false};
+    bool mCostAttribution {false};
+    float mShadowRayRouletteThreshold {0.0f};
+    std::string mTimelineTraceFile;
+    std::string mDenoiseMode;
+    std::string mDenoiseOutputFile;
+    bool mHeatMapReport {false};
+    std::string mHeatMapReportAov;
+    unsigned mMetricsPort {0};
+    std::vector<int> mBakeUdims;
+    std::vector<int> mSequenceFrames;
+    std::string mFrameDeltasFile;
+    bool mStereoEyes {false};
+    bool mKeepPathGuide {false};
+    bool mBackgroundOutput {false};
+    bool mStreamDebugRays {false};
+    unsigned mDebugRayPathSampleRate {1};
+    unsigned mProfileSamplingInterval {0};
+    std::string mOlatOutput;
     std::vector<AttributeOverride> mAttributeOverrides;
     std::vector<RdlaGlobal> mRdlaGlobals;
     std::string mCommandLine;
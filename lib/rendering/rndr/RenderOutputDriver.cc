@@ -212,7 +212,8 @@ RenderOutputDriver::Impl::Impl(const RenderContext *renderContext) :
     mZeroWeightMask(false),
     mRevertBeautyAuxAOV(false),
     mLastTileSamples(0),
-    mRenderContext(renderContext)
+    mRenderContext(renderContext),
+    mStreamNumConsistentSamples(0)
 {
     parserConfigure();
 
@@ -626,6 +627,9 @@ RenderOutputDriver::Impl::Impl(const RenderContext *renderContext) :
     // finalize our light aov object
     mLightAovs.finalize();
 
+    // flatten the material aovs of the schema into a single evaluation program
+    mMaterialAovs.compile(mAovSchema);
+
 #ifdef DEBUG_DUMP_ENTRIES_AND_FILES
     // Useful debug dump to trackdown all entry items and file info of renderOutputDriver
     {
@@ -2240,6 +2244,24 @@ RenderOutputDriver::setLastCheckpointRenderTileSamples(const unsigned samples)
     mImpl->setLastCheckpointRenderTileSamples(samples);
 }
 
+std::string
+RenderOutputDriver::getCheckpointDeltaBaseName() const
+{
+    for (const auto &file : mImpl->mFiles) {
+        if (!file.mCheckpointName.empty()) return file.mCheckpointName;
+    }
+    return "";
+}
+
+std::string
+RenderOutputDriver::getResumeDeltaBaseName() const
+{
+    for (const auto &file : mImpl->mFiles) {
+        if (!file.mResumeName.empty()) return file.mResumeName;
+    }
+    return "";
+}
+
 scene_rdl2::grid_util::Parser&
 RenderOutputDriver::getParser()
 {
@@ -170,9 +170,30 @@ public:
     /// events occur.
     const pbr::LightAovs &getLightAovs() const;
 
+    /// Opens the final deep output files for streaming while rendering, see
+    /// pbr::DeepBuffer::startStreaming(). writeFinal() then skips them.
+    void startDeepStreaming(pbr::DeepBuffer *deepBuffer) const;
+
+    /// Opens the final output files which only hold beauty, alpha and regular aovs as
+    /// tiled images, to be written tile by tile while rendering. Returns false when there
+    /// is no such file. writeFinal() skips the streamed files.
+    bool startStreaming() const;
+    /// Writes a film tile which has all of its samples to the streamed files. MT safe.
+    void streamTile(unsigned tileIdx) const;
+    /// Writes the tiles left, for example after a cancel, and closes the streamed files.
+    void finishStreaming() const;
+    bool isStreaming() const;
+    /// True when some final output files were written while rendering, until writeFinal().
+    bool hasStreamedFiles() const;
+    /// True when the aov buffer is only used by the files written while rendering,
+    /// its final snapshot isn't needed.
+    bool isAovStreamed(int aovIdx) const;
+
     /// Write the outputs : final output and non checkpoint file
     /// Errors are checked via errors()
     /// renderBuffer, aovBuffer, heatMap can be null if no output requires them
+    /// tiled should be true when the buffers are snapshot without untile. They are read
+    /// directly in the Film's tiled layout then.
     void writeFinal(const pbr::DeepBuffer *deepBuffer,
                     pbr::CryptomatteBuffer *cryptomatteBuffer,
                     const scene_rdl2::fb_util::HeatMapBuffer *heatMap,
@@ -180,11 +201,13 @@ public:
                     const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                     const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
                     const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                    const bool tiled,
                     ImageWriteCache *cache) const;
 
     /// Write the checkpoint outputs
     /// Errors are checked via errors()
     /// renderBuffer, aovBuffer, heatMap can be null if no output requires them
+    /// tiled is the same as writeFinal()
     void writeCheckpointEnq(const bool checkpointMultiVersion,
                             const pbr::DeepBuffer *deepBuffer,
                             pbr::CryptomatteBuffer *cryptomatteBuffer,
@@ -193,11 +216,16 @@ public:
                             const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                             const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
                             const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                            const bool tiled,
                             const unsigned tileSampleTotals,
                             ImageWriteCache *outCache) const;
     void writeCheckpointDeq(ImageWriteCache *cache,
                             const bool checkpointMultiVersion) const;
 
+    /// Write the final outputs enqueued by writeFinal() into an ImageWriteCache set up for
+    /// final output, see ImageWriteCache::setFinalOutput(). Called by the ImageWriteDriver thread.
+    void writeFinalDeq(ImageWriteCache *cache) const;
+
     /// Errors and Infos during writing  are reported via a vector of strings. If empty, no error.
     /// In general, the class tries to output all the results it can sensibly
     /// figure out.  When it encounters a problem, it pushes an error and
@@ -241,6 +269,11 @@ public:
 
     void setLastCheckpointRenderTileSamples(const unsigned samples);
 
+    /// Filename which delta checkpoint and tile hash files are placed next to. This is the first
+    /// checkpoint filename (or resume filename) of the outputs. Returns empty string if there is none.
+    std::string getCheckpointDeltaBaseName() const;
+    std::string getResumeDeltaBaseName() const;
+
     //------------------------------
 
     scene_rdl2::grid_util::Parser& getParser();
@@ -14,6 +14,12 @@
 #include <scene_rdl2/render/util/LuaScriptRunner.h>
 #include <scene_rdl2/scene/rdl2/RenderOutput.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
 // Useful debug dump to trackdown all entry items and file info of renderOutputDriver
 //#define DEBUG_DUMP_ENTRIES_AND_FILES
 
@@ -21,6 +27,7 @@ namespace moonray {
 namespace rndr {
 
 class ImageWriteCacheImageSpec;
+class RenderDriver;
 
 // files contain 1 or more (sub-)images (parts).  the
 // case of 1 un-named image per file is allowed, and is typically
@@ -98,6 +105,33 @@ struct File
     std::vector<Image> mImages; // images in file
 };
 
+// A final output file which is written tile by tile while rendering, see
+// RenderOutputDriver::startStreaming(). The film tiles have y up and the tiles of the file
+// have y down, so a film tile covers parts of 2 file tiles when the height isn't a multiple of
+// the tile size. A file tile is kept until all of its pixels are in.
+struct StreamedFile
+{
+    static constexpr unsigned sTileSize = 8; // same as the film tiles
+
+    struct Tile
+    {
+        std::vector<float> mPixels; // allocated by the first film tile which covers it
+        unsigned mNumPixels {0};
+        bool mWritten {false};
+    };
+
+    size_t mFileId {0};
+    OIIO::ImageOutput::unique_ptr mIo;
+    OIIO::ImageSpec mSpec;
+    std::vector<int> mAovs;         // film aov of each entry of the image
+    unsigned mNumChannels {0};
+    unsigned mNumTilesX {0};
+    bool mFailed {false};
+
+    std::mutex mMutex;
+    std::vector<Tile> mTiles;       // file tiles, row by row from the top
+};
+
 //------------------------------------------------------------------------------------------
 
 class RenderOutputDriver::Impl
@@ -154,6 +188,7 @@ public:
                const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> *aovBuffers,
                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> *displayFilterBuffers,
+               const bool tiled,
                const unsigned checkpointTileSampleTotals,
                ImageWriteCache *cache,
                scene_rdl2::grid_util::Sha1Gen::Hash *hashOut) const;
@@ -162,6 +197,30 @@ public:
                    const unsigned checkpointTileSampleTotals,
                    const scene_rdl2::fb_util::PixelBuffer<unsigned> &samplesCount,
                    const pbr::DeepBuffer *deepBuffer) const;
+    void startDeepStreaming(pbr::DeepBuffer *deepBuffer) const;
+
+    // Calls deepFileFunc for every deep output file with what DeepBuffer::write() needs
+    using DeepFileFunc = std::function<void(const std::string &filename,
+                                            const std::vector<int> &outputAOVs,
+                                            const std::vector<std::string> &outputAOVChannelNames,
+                                            const scene_rdl2::math::HalfOpenViewport &aperture,
+                                            const scene_rdl2::math::HalfOpenViewport &region,
+                                            const scene_rdl2::rdl2::Metadata *rdlMetadata)>;
+    void crawlDeepFiles(const bool checkpointOutput,
+                        const bool checkpointOutputMultiVersion,
+                        const unsigned checkpointTileSampleTotals,
+                        const DeepFileFunc &deepFileFunc) const;
+
+    bool startStreaming() const;
+    void streamTile(unsigned tileIdx) const;
+    void finishStreaming() const;
+    bool isStreaming() const { return !mStreamedFiles.empty(); }
+    bool hasStreamedFiles() const
+    {
+        return std::find(mStreamedFileFlags.begin(), mStreamedFileFlags.end(), true) != mStreamedFileFlags.end();
+    }
+    bool isAovStreamed(int aovIdx) const;
+    void clearStreamedFiles() const;
 
     bool loggingErrorAndInfo(ImageWriteCache *cache) const;
 
@@ -257,6 +316,13 @@ private:
 
     std::string showDenoiseInfo() const;
 
+    bool isStreamable(const File &file) const;
+    void streamFileTile(const RenderDriver &driver,
+                        StreamedFile &file,
+                        const scene_rdl2::fb_util::Tile &tile) const;
+    bool writeStreamedTile(StreamedFile &file, unsigned fileTileIdx) const;
+    void setupStreamedAovs() const;
+
     //------------------------------
 
     std::vector<const Entry *>        mEntries;                 // our entry order
@@ -292,6 +358,13 @@ private:
 
     const RenderContext *mRenderContext;
 
+    // Tile by tile output while rendering, see startStreaming()
+    mutable std::vector<std::unique_ptr<StreamedFile>> mStreamedFiles;
+    mutable std::unique_ptr<std::atomic<bool>[]> mStreamedFilmTiles; // film tiles already written
+    mutable std::vector<bool> mStreamedFileFlags; // by mFiles index, skipped by the final output
+    mutable std::vector<bool> mStreamedAovs;      // by film aov, only used by streamed files
+    mutable int mStreamNumConsistentSamples;
+
     Parser mParser;
 };
 
@@ -11,6 +11,12 @@
 
 #include <moonray/rendering/mcrt_common/Clock.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <memory>
+#include <vector>
+
 namespace moonray {
 namespace rndr {
 
@@ -211,21 +217,49 @@ RenderOutputDriver::Impl::read(const File& file, Film& film)
         return false; // not enough information for resume render -> We can not resume render without them.
     }
 
+    //
+    // read all subImages in parallel. Each subImage after the first has its own reader on the same file,
+    // so the parts of a multi-part file are decoded concurrently instead of one seek_subimage() at a time.
+    // All the subImages are held in memory until they are processed below.
+    //
+    const size_t imageTotal = file.mImages.size();
+    std::vector<std::unique_ptr<OiioReader>> subImageReaders(imageTotal);
+    std::vector<char> readDone(imageTotal, 0);
+
+#ifdef SINGLE_THREAD_READ
+    size_t taskSize = imageTotal;
+#else
+    size_t taskSize = 1;
+#endif
+    tbb::blocked_range<size_t> range(0, imageTotal, taskSize);
+    tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t imgId = r.begin(); imgId < r.end(); ++imgId) {
+                OiioReader* currReader = &reader;
+                if (imgId > 0) {
+                    subImageReaders[imgId].reset(new OiioReader(filename));
+                    currReader = subImageReaders[imgId].get();
+                }
+                // read whole image data from file into memory inside reader here.
+                readDone[imgId] = (*currReader && currReader->readData(imgId)) ? 1 : 0;
+            } // imgId
+        });
+
     //
     // subImage loop
     //
-    for (size_t imgId = 0; imgId < file.mImages.size(); ++imgId) {
-        // read whole image data from file into memory inside reader here.
-        if (!reader.readData(imgId)) {
+    for (size_t imgId = 0; imgId < imageTotal; ++imgId) {
+        if (!readDone[imgId]) {
             mErrors.push_back("read data failed.");
             return false;
         }
-        // std::cerr << reader.showSpec("") << std::endl; // useful for debug
+        OiioReader& currReader = (imgId > 0) ? *subImageReaders[imgId] : reader;
+        // std::cerr << currReader.showSpec("") << std::endl; // useful for debug
 
         // process reader internal memory data to proper way by multi-threaded operation
-        if (!readSubImage(reader, file.mImages[imgId], film)) {
+        if (!readSubImage(currReader, file.mImages[imgId], film)) {
             return false;
         }
+        subImageReaders[imgId].reset(); // free the pixels of this subImage
     }
 
     return true;
@@ -520,7 +554,8 @@ RenderOutputDriver::Impl::readSubImageOneEntry(OiioReader& reader,
             // Clear the cryptomatte buffer ready for loading resume data
             pbr::CryptomatteBuffer* cryptomatteBuf = film.getCryptomatteBuffer();
             cryptomatteBuf->clear();
-            cryptomatteBuf->init(reader.getWidth(), reader.getHeight(), 1, cryptomatteBuf->getMultiPresenceOn());
+            cryptomatteBuf->init(reader.getWidth(), reader.getHeight(), 1, cryptomatteBuf->getMultiPresenceOn(),
+                                 cryptomatteBuf->getNumRenderThreads());
 
             scene_rdl2::fb_util::Tiler tiler(reader.getWidth(), reader.getHeight());
             reader.crawlAllTiledScanline
@@ -13,8 +13,11 @@
 
 #include <moonray/rendering/pbr/core/DeepBuffer.h>
 #include <scene_rdl2/common/grid_util/Sha1Util.h>
+#include <scene_rdl2/render/logging/logging.h>
 #include <scene_rdl2/render/util/Strings.h>
 
+#include <algorithm>
+
 // This directive is used to verify logic correctness between ENQ and DEQ action by SHA1 hash value.
 // We can control hash computation precision as well.
 // See PRECISE_HASH_COMPARE directive (RenderOutputWriter.cc) for more detail.
@@ -31,7 +34,7 @@ RenderOutputDriver::Impl::writeDeq(ImageWriteCache *cache,
 {
     
     write(true, checkpointOutputMultiVersion,
-          nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0,
+          nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false, 0,
           cache, hashOut);
 }
 
@@ -45,11 +48,14 @@ RenderOutputDriver::Impl::write(const bool checkpointOutput,
                                 const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> *aovBuffers,
                                 const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> *displayFilterBuffers,
+                                const bool tiled, // only used for STD and ENQ
                                 const unsigned checkpointTileSampleTotals, // only used for STD and ENQ
                                 ImageWriteCache *cache,
                                 scene_rdl2::grid_util::Sha1Gen::Hash *hashOut) const
 //
 // weightBuffer : only has valid info when RenderOutputDriver has weightAOV.
+// tiled : heatMap, weightBuffer, renderBufferOdd, aovBuffers and displayFilterBuffers are snapshot
+//         without untile (i.e. Film's tiled memory layout) and are read through the Film's tiler.
 // checkpointOutputMultiVersion : runtime multi-version checkpoint file output condition.
 //                                This flag only used under checkpointOutput = on
 //
@@ -162,8 +168,12 @@ RenderOutputDriver::Impl::write(const bool checkpointOutput,
                                   callBackMetadata,
                                   cryptomatteBuffer, heatMap, weightBuffer, renderBufferOdd,
                                   aovBuffers, displayFilterBuffers,
+                                  (tiled) ? &rndr::getRenderDriver()->getFilm().getTiler() : nullptr,
                                   errors, infos,
                                   sha1GenPtr);
+        if (!mStreamedFileFlags.empty()) {
+            writer.setStreamedFiles(&mStreamedFileFlags);
+        }
         if (cache) cache->timeRec(2); // record timing into position id = 2
 
         writer.main();
@@ -214,9 +224,52 @@ RenderOutputDriver::Impl::deepWrite(const bool checkpointOutput,
                                     const scene_rdl2::fb_util::PixelBuffer<unsigned> &samplesCount,
                                     const pbr::DeepBuffer *deepBuffer) const
 {
-    std::vector<std::string> &errors = mErrors;
     std::vector<std::string> &infos = mInfos;
 
+    crawlDeepFiles(checkpointOutput, checkpointOutputMultiVersion, checkpointTileSampleTotals,
+                   [&](const std::string &filename,
+                       const std::vector<int> &outputAOVs,
+                       const std::vector<std::string> &outputAOVChannelNames,
+                       const scene_rdl2::math::HalfOpenViewport &aperture,
+                       const scene_rdl2::math::HalfOpenViewport &region,
+                       const scene_rdl2::rdl2::Metadata *rdlMetadata) {
+        if (deepBuffer->isStreamed(filename)) {
+            // already written while rendering
+            infos.push_back(scene_rdl2::util::buildString("Streamed deep: ", filename));
+            return;
+        }
+
+        deepBuffer->write(filename, outputAOVs, outputAOVChannelNames, samplesCount, aperture, region, rdlMetadata);
+
+        infos.push_back(scene_rdl2::util::buildString("Wrote deep: ", filename));
+    });
+}
+
+void
+RenderOutputDriver::Impl::startDeepStreaming(pbr::DeepBuffer *deepBuffer) const
+{
+    // The errors found crawling the files are reported by the final write
+    const size_t numErrors = mErrors.size();
+    crawlDeepFiles(false, false, 0,
+                   [&](const std::string &filename,
+                       const std::vector<int> &outputAOVs,
+                       const std::vector<std::string> &outputAOVChannelNames,
+                       const scene_rdl2::math::HalfOpenViewport &aperture,
+                       const scene_rdl2::math::HalfOpenViewport &region,
+                       const scene_rdl2::rdl2::Metadata *rdlMetadata) {
+        deepBuffer->addStreamingOutput(filename, outputAOVs, outputAOVChannelNames, aperture, region, rdlMetadata);
+    });
+    mErrors.resize(numErrors);
+}
+
+void
+RenderOutputDriver::Impl::crawlDeepFiles(const bool checkpointOutput,
+                                         const bool checkpointOutputMultiVersion,
+                                         const unsigned checkpointTileSampleTotals,
+                                         const DeepFileFunc &deepFileFunc) const
+{
+    std::vector<std::string> &errors = mErrors;
+
     int deepAOV = 0;
     for (const auto &f: mFiles) {
 
@@ -296,9 +349,7 @@ RenderOutputDriver::Impl::deepWrite(const bool checkpointOutput,
         }
 
         if (!filename.empty()) {
-            deepBuffer->write(filename, outputAOVs, outputAOVChannelNames, samplesCount, aperture, region, rdlMetadata);
-
-            infos.push_back(scene_rdl2::util::buildString("Wrote deep: ", filename));
+            deepFileFunc(filename, outputAOVs, outputAOVChannelNames, aperture, region, rdlMetadata);
         }
     }
 }
@@ -396,9 +447,295 @@ RenderOutputDriver::Impl::writeCheckpointResumeMetadata(const unsigned checkpoin
     return outTbl;
 }
 
+bool
+RenderOutputDriver::Impl::isStreamable(const File &file) const
+//
+// Only files of a single image whose pixels all come straight from the regular aov buffers
+// of the film are streamed. Cryptomatte, display filters, heat map, weight and visibility aovs
+// are finalized for the whole frame at the end.
+//
+{
+    if (file.mName.empty() || file.mImages.size() != 1) {
+        return false;
+    }
+    const Image &img = file.mImages[0];
+    for (size_t i = 0; i < img.mEntries.size(); ++i) {
+        const int roIdx = img.mStartRoIdx + static_cast<int>(i);
+        if (img.mEntries[i].mRenderOutput->getOutputType() != std::string("flat") ||
+            getAovBuffer(roIdx) < 0 ||
+            isVisibilityAov(roIdx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+RenderOutputDriver::Impl::startStreaming() const
+{
+    clearStreamedFiles();
+
+    // Checkpoint and resumable files need the whole frame and two stage output writes
+    // every file at once at the end.
+    if (mCheckpointRenderActive || mResumableOutput || ImageWriteDriver::get()->getTwoStageOutput()) {
+        return false;
+    }
+
+    const std::shared_ptr<RenderDriver> driver = rndr::getRenderDriver();
+    const Film &film = driver->getFilm();
+    const int width = film.getTiler().mOriginalW;
+    const int height = film.getTiler().mOriginalH;
+    const unsigned numTilesX = (width + StreamedFile::sTileSize - 1) / StreamedFile::sTileSize;
+    const unsigned numTilesY = (height + StreamedFile::sTileSize - 1) / StreamedFile::sTileSize;
+
+    mStreamedFileFlags.assign(mFiles.size(), false);
+    for (size_t fileId = 0; fileId < mFiles.size(); ++fileId) {
+        const File &f = mFiles[fileId];
+        if (!isStreamable(f)) {
+            continue;
+        }
+
+        std::unique_ptr<StreamedFile> file(new StreamedFile);
+        file->mFileId = fileId;
+        file->mIo = OIIO::ImageOutput::create(f.mName.c_str());
+        if (!file->mIo || !file->mIo->supports("tiles")) {
+            continue; // written at the end of the frame
+        }
+        file->mSpec = RenderOutputWriter::setupStreamedImageSpec(f.mImages[0], width, height, StreamedFile::sTileSize);
+        if (!file->mIo->open(f.mName.c_str(), file->mSpec)) {
+            continue; // written at the end of the frame, which reports the error
+        }
+
+        const Image &img = f.mImages[0];
+        for (size_t i = 0; i < img.mEntries.size(); ++i) {
+            file->mAovs.push_back(getAovBuffer(img.mStartRoIdx + static_cast<int>(i)));
+            file->mNumChannels += img.mEntries[i].mChannelNames.size();
+        }
+        file->mNumTilesX = numTilesX;
+        file->mTiles.resize(numTilesX * numTilesY);
+
+        mStreamedFileFlags[fileId] = true;
+        mStreamedFiles.push_back(std::move(file));
+    }
+    if (mStreamedFiles.empty()) {
+        clearStreamedFiles();
+        return false;
+    }
+    setupStreamedAovs();
+
+    const size_t numFilmTiles = driver->getTiles()->size();
+    mStreamedFilmTiles.reset(new std::atomic<bool>[numFilmTiles]);
+    for (size_t tileIdx = 0; tileIdx < numFilmTiles; ++tileIdx) {
+        mStreamedFilmTiles[tileIdx] = false;
+    }
+    mStreamNumConsistentSamples = mRenderContext->getNumConsistentSamples();
+    return true;
+}
+
+void
+RenderOutputDriver::Impl::streamTile(unsigned tileIdx) const
+{
+    if (mStreamedFiles.empty() || mStreamedFilmTiles[tileIdx].exchange(true)) {
+        return;
+    }
+
+    const std::shared_ptr<RenderDriver> driver = rndr::getRenderDriver();
+    const scene_rdl2::fb_util::Tile &tile = (*driver->getTiles())[tileIdx];
+    for (const auto &file : mStreamedFiles) {
+        streamFileTile(*driver, *file, tile);
+    }
+}
+
+void
+RenderOutputDriver::Impl::streamFileTile(const RenderDriver &driver,
+                                         StreamedFile &file,
+                                         const scene_rdl2::fb_util::Tile &tile) const
+{
+    const unsigned numChannels = file.mNumChannels;
+
+    // Normalize the pixels of the film tile before taking the lock of the file
+    std::vector<float> pixels(StreamedFile::sTileSize * StreamedFile::sTileSize * numChannels);
+    const Image &img = mFiles[file.mFileId].mImages[0];
+    unsigned chanOffset = 0;
+    for (size_t i = 0; i < file.mAovs.size(); ++i) {
+        driver.snapshotAovTile(&pixels[chanOffset], numChannels, mStreamNumConsistentSamples,
+                               file.mAovs[i], tile);
+        chanOffset += img.mEntries[i].mChannelNames.size();
+    }
+
+    std::lock_guard<std::mutex> lock(file.mMutex);
+    if (file.mFailed) {
+        return;
+    }
+
+    // film y is up, file y is down
+    const unsigned height = file.mSpec.height;
+    for (unsigned y = tile.mMinY; y < tile.mMaxY; ++y) {
+        const unsigned yOut = height - 1 - y;
+        for (unsigned x = tile.mMinX; x < tile.mMaxX; ++x) {
+            StreamedFile::Tile &fileTile =
+                file.mTiles[(yOut / StreamedFile::sTileSize) * file.mNumTilesX + x / StreamedFile::sTileSize];
+            if (fileTile.mPixels.empty()) {
+                fileTile.mPixels.resize(StreamedFile::sTileSize * StreamedFile::sTileSize * numChannels, 0.f);
+            }
+            const unsigned src = ((y & 7) * 8 + (x & 7)) * numChannels;
+            const unsigned dst = ((yOut % StreamedFile::sTileSize) * StreamedFile::sTileSize + x % StreamedFile::sTileSize) * numChannels;
+            std::copy_n(&pixels[src], numChannels, &fileTile.mPixels[dst]);
+            ++fileTile.mNumPixels;
+        }
+    }
+
+    // Write the file tiles which got all of their pixels
+    const unsigned tileX = tile.mMinX / StreamedFile::sTileSize;
+    const unsigned width = file.mSpec.width;
+    for (unsigned tileY = (height - tile.mMaxY) / StreamedFile::sTileSize;
+         tileY <= (height - 1 - tile.mMinY) / StreamedFile::sTileSize; ++tileY) {
+        const unsigned tileWidth = std::min(StreamedFile::sTileSize, width - tileX * StreamedFile::sTileSize);
+        const unsigned tileHeight = std::min(StreamedFile::sTileSize, height - tileY * StreamedFile::sTileSize);
+        const unsigned fileTileIdx = tileY * file.mNumTilesX + tileX;
+        if (file.mTiles[fileTileIdx].mNumPixels == tileWidth * tileHeight) {
+            if (!writeStreamedTile(file, fileTileIdx)) {
+                return;
+            }
+        }
+    }
+}
+
+bool
+RenderOutputDriver::Impl::writeStreamedTile(StreamedFile &file, unsigned fileTileIdx) const
+{
+    StreamedFile::Tile &fileTile = file.mTiles[fileTileIdx];
+    if (fileTile.mPixels.empty()) {
+        // not covered by any film tile
+        fileTile.mPixels.resize(StreamedFile::sTileSize * StreamedFile::sTileSize * file.mNumChannels, 0.f);
+    }
+
+    const int x = file.mSpec.x + (fileTileIdx % file.mNumTilesX) * StreamedFile::sTileSize;
+    const int y = file.mSpec.y + (fileTileIdx / file.mNumTilesX) * StreamedFile::sTileSize;
+    if (!file.mIo->write_tile(x, y, file.mSpec.z, OIIO::TypeDesc::FLOAT, fileTile.mPixels.data())) {
+        file.mFailed = true;
+        return false;
+    }
+    fileTile.mWritten = true;
+    std::vector<float>().swap(fileTile.mPixels);
+    return true;
+}
+
+void
+RenderOutputDriver::Impl::finishStreaming() const
+{
+    if (mStreamedFiles.empty()) {
+        return;
+    }
+
+    // The film tiles which didn't get all of their samples, after a cancel for example
+    const size_t numFilmTiles = rndr::getRenderDriver()->getTiles()->size();
+    for (size_t tileIdx = 0; tileIdx < numFilmTiles; ++tileIdx) {
+        streamTile(tileIdx);
+    }
+
+    for (const auto &file : mStreamedFiles) {
+        for (size_t fileTileIdx = 0; fileTileIdx < file->mTiles.size() && !file->mFailed; ++fileTileIdx) {
+            if (!file->mTiles[fileTileIdx].mWritten) {
+                writeStreamedTile(*file, fileTileIdx);
+            }
+        }
+
+        const std::string &filename = mFiles[file->mFileId].mName;
+        if (!file->mIo->close() || file->mFailed) {
+            // fall back to the final output
+            scene_rdl2::logging::Logger::warn("Failed to stream '", filename, "' oiioError:(",
+                                              file->mIo->geterror(), "). Writing it at the end of the frame.");
+            mStreamedFileFlags[file->mFileId] = false;
+        } else {
+            mInfos.push_back(scene_rdl2::util::buildString("Wrote: ", filename));
+        }
+    }
+
+    mStreamedFiles.clear();
+    mStreamedFilmTiles.reset();
+    setupStreamedAovs();
+}
+
+void
+RenderOutputDriver::Impl::setupStreamedAovs() const
+//
+// Every aov buffer belongs to a single render output, the buffers of the streamed files
+// don't need a final snapshot.
+//
+{
+    mStreamedAovs.assign(mAovBuffers.size(), false);
+    for (size_t fileId = 0; fileId < mFiles.size(); ++fileId) {
+        if (!mStreamedFileFlags[fileId]) {
+            continue;
+        }
+        const Image &img = mFiles[fileId].mImages[0];
+        for (size_t i = 0; i < img.mEntries.size(); ++i) {
+            mStreamedAovs[getAovBuffer(img.mStartRoIdx + static_cast<int>(i))] = true;
+        }
+    }
+}
+
+bool
+RenderOutputDriver::Impl::isAovStreamed(int aovIdx) const
+{
+    return aovIdx >= 0 && static_cast<size_t>(aovIdx) < mStreamedAovs.size() && mStreamedAovs[aovIdx];
+}
+
+void
+RenderOutputDriver::Impl::clearStreamedFiles() const
+{
+    mStreamedFiles.clear();
+    mStreamedFilmTiles.reset();
+    mStreamedFileFlags.clear();
+    mStreamedAovs.clear();
+}
+
 //------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------
 
+void
+RenderOutputDriver::startDeepStreaming(pbr::DeepBuffer *deepBuffer) const
+{
+    mImpl->startDeepStreaming(deepBuffer);
+}
+
+bool
+RenderOutputDriver::startStreaming() const
+{
+    return mImpl->startStreaming();
+}
+
+void
+RenderOutputDriver::streamTile(unsigned tileIdx) const
+{
+    mImpl->streamTile(tileIdx);
+}
+
+void
+RenderOutputDriver::finishStreaming() const
+{
+    mImpl->finishStreaming();
+}
+
+bool
+RenderOutputDriver::isStreaming() const
+{
+    return mImpl->isStreaming();
+}
+
+bool
+RenderOutputDriver::hasStreamedFiles() const
+{
+    return mImpl->hasStreamedFiles();
+}
+
+bool
+RenderOutputDriver::isAovStreamed(int aovIdx) const
+{
+    return mImpl->isAovStreamed(aovIdx);
+}
+
 void
 RenderOutputDriver::writeFinal(const pbr::DeepBuffer *deepBuffer,
                                pbr::CryptomatteBuffer *cryptomatteBuffer,
@@ -407,6 +744,7 @@ RenderOutputDriver::writeFinal(const pbr::DeepBuffer *deepBuffer,
                                const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
                                const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                               const bool tiled,
                                ImageWriteCache *cache) const
 //
 // This function writes image as final output.
@@ -414,8 +752,9 @@ RenderOutputDriver::writeFinal(const pbr::DeepBuffer *deepBuffer,
 {
     mImpl->write(false, false,
                  deepBuffer, cryptomatteBuffer, heatMap, weightBuffer,
-                 renderBufferOdd, &aovBuffers, &displayFilterBuffers, 0,
+                 renderBufferOdd, &aovBuffers, &displayFilterBuffers, tiled, 0,
                  cache, nullptr);
+    mImpl->clearStreamedFiles();
 }
 
 void
@@ -427,6 +766,7 @@ RenderOutputDriver::writeCheckpointEnq(const bool checkpointMultiVersion,
                                        const scene_rdl2::fb_util::RenderBuffer *renderBufferOdd,
                                        const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &aovBuffers,
                                        const std::vector<scene_rdl2::fb_util::VariablePixelBuffer> &displayFilterBuffers,
+                                       const bool tiled,
                                        const unsigned tileSampleTotals,
                                        ImageWriteCache *outCache) const
 {
@@ -444,14 +784,14 @@ RenderOutputDriver::writeCheckpointEnq(const bool checkpointMultiVersion,
         } else {
             mImpl->write(false, false,
                          deepBuffer, cryptomatteBuffer, heatMap, weightBuffer,
-                         renderBufferOdd, &aovBuffers, &displayFilterBuffers, tileSampleTotals,
+                         renderBufferOdd, &aovBuffers, &displayFilterBuffers, tiled, tileSampleTotals,
                          nullptr, hashPtr);
         }
     }
 
     mImpl->write(true, checkpointMultiVersion,
                  deepBuffer, cryptomatteBuffer, heatMap, weightBuffer,
-                 renderBufferOdd, &aovBuffers, &displayFilterBuffers, tileSampleTotals,
+                 renderBufferOdd, &aovBuffers, &displayFilterBuffers, tiled, tileSampleTotals,
                  outCache, nullptr);
 }
 
@@ -481,5 +821,15 @@ RenderOutputDriver::writeCheckpointDeq(ImageWriteCache *cache,
     }
 }
 
+void
+RenderOutputDriver::writeFinalDeq(ImageWriteCache *cache) const
+{
+    cache->setupDeqMode();
+
+    mImpl->write(false, false,
+                 nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false, 0,
+                 cache, nullptr);
+}
+
 } // namespace rndr
 } // namespace moonray
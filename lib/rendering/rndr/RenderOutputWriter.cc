@@ -7,12 +7,18 @@
 #include "RenderOutputWriter.h"
 
 #include <moonray/rendering/mcrt_common/Clock.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 #include <moonray/rendering/pbr/core/Cryptomatte.h>
 #include <scene_rdl2/common/fb_util/VariablePixelBuffer.h>
 #include <scene_rdl2/common/grid_util/Sha1Util.h>
 #include <scene_rdl2/render/util/StrUtil.h>
 #include <scene_rdl2/render/util/Strings.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unistd.h> // usleep
+
 // Useful runtime verify for single float to half float conversion for ImageWriteCache
 //#define RUNTIME_VERIFY_FTOH
 
@@ -70,6 +76,10 @@ FileNameParam::show() const
 bool
 RenderOutputWriter::main() const
 {
+    if (mFileOutputThreads > 1) {
+        return parallelFileOutput();
+    }
+
     bool result = true;
     for (size_t fileId = 0; fileId < mCurrBufferSpec->getFileTotal(); ++fileId) {
         if (!singleFileOutput(fileId)) {
@@ -259,6 +269,10 @@ RenderOutputWriter::setupWidthHeight(const int predefinedWidth,
         if (predefinedWidth > 0 && predefinedHeight > 0) {
             mWidth = predefinedWidth;
             mHeight = predefinedHeight;
+        } else if (mTiler) {
+            // tiled buffers are aligned to the tile size, the image is the original resolution.
+            mWidth = mTiler->mOriginalW;
+            mHeight = mTiler->mOriginalH;
         } else if (mCryptomatteBuffer) {
             mWidth = mCryptomatteBuffer->getWidth();
             mHeight = mCryptomatteBuffer->getHeight();
@@ -295,56 +309,171 @@ RenderOutputWriter::setupWidthHeight(const int predefinedWidth,
     }
 }
 
+void
+RenderOutputWriter::setupFileOutputThreads()
+//
+// Multiple files are written in parallel only under STD and DEQ mode. ENQ mode serializes all the files
+// into the single cache stream. Hash computation for debugging also requires the file order.
+//
+{
+    mFileOutputThreads = 1;
+    if (mRunMode != ImageWriteCache::Mode::ENQ && !mSha1Gen && mCurrBufferSpec->getFileTotal() > 1) {
+        mFileOutputThreads = std::max(ImageWriteDriver::get()->getFileWriteThreads(), 1u);
+    }
+    mTimeCache = (mFileOutputThreads > 1) ? nullptr : mCache;
+}
+
 bool
 RenderOutputWriter::singleFileOutput(const size_t fileId) const
 //
 // Single file data output action
 //
 {
-    if (mCache) mCache->timeStartFile();
+    if (mTimeCache) mTimeCache->timeStartFile();
+
+    FileOutput fileOutput;
+    bool setupFileOutputReturnStatus;
+    if (!setupFileOutput(fileId, fileOutput, setupFileOutputReturnStatus)) {
+        return setupFileOutputReturnStatus;
+    }
+
+    return writeFileOutput(fileOutput);
+}
+
+bool
+RenderOutputWriter::parallelFileOutput() const
+//
+// Multiple files data output action by the file write thread pool
+//
+// Files are set up one by one first because the filename and the file condition of DEQ mode are
+// dequeued from the single cache stream in file order. After that, the pool threads pick up the next
+// file and encode/write it independently. Each file only reads its own sub-image data, so there is no
+// dependency between the files.
+// We don't start a new file while the process memory is above the file write memory limit and some
+// other files are still being written, they release their image buffers when they are done.
+//
+{
+    bool result = true;
+
+    std::vector<FileOutput> fileOutputs;
+    fileOutputs.reserve(mCurrBufferSpec->getFileTotal());
+    for (size_t fileId = 0; fileId < mCurrBufferSpec->getFileTotal(); ++fileId) {
+        FileOutput fileOutput;
+        bool setupFileOutputReturnStatus;
+        if (setupFileOutput(fileId, fileOutput, setupFileOutputReturnStatus)) {
+            fileOutputs.push_back(std::move(fileOutput));
+        } else if (!setupFileOutputReturnStatus) {
+            result = false;
+            // we want to continue to write lest of the files even some file setup is failed.
+        }
+    }
+
+    const size_t memLimit = ImageWriteDriver::get()->getFileWriteMemLimit(); // byte, 0 is no limit
+    std::atomic<size_t> nextId {0};
+    std::atomic<int> activeTotal {0};
+    std::atomic<bool> writeResult {true};
+    auto worker = [&]() {
+        while (true) {
+            while (memLimit && activeTotal.load() > 0 && ImageWriteDriver::getProcMemUsage() > memLimit) {
+                usleep(10000); // 10ms : wait until other files are done and free their buffers
+            }
+            const size_t id = nextId++;
+            if (id >= fileOutputs.size()) {
+                break;
+            }
+            ++activeTotal;
+            if (!writeFileOutput(fileOutputs[id])) {
+                writeResult = false;
+            }
+            --activeTotal;
+        }
+    };
+
+    const size_t threadTotal = std::min(static_cast<size_t>(mFileOutputThreads), fileOutputs.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadTotal; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker(); // caller thread is one of the pool threads
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return (result && writeResult);
+}
+
+bool
+RenderOutputWriter::setupFileOutput(const size_t fileId, FileOutput& fileOutput, bool& returnStatus) const
+//
+// Return true if the file is ready to write. Otherwise returnStatus tells whether this is an error or
+// this file is simply skipped.
+//
+{
+    returnStatus = true;
+    fileOutput.mFileId = fileId;
 
     //------------------------------
     // setup filename and verify
-    ImageWriteCache::ImageWriteCacheTmpFileItemShPtr tmpFileItem;
-    std::string filename = calcFilename(fileId, tmpFileItem);
-    bool verifyFilenameAndDataTypeReturnStatus;
-    if (!verifyFilenameAndDataType(fileId, filename, tmpFileItem, verifyFilenameAndDataTypeReturnStatus)) {
-        return verifyFilenameAndDataTypeReturnStatus;
+    fileOutput.mFilename = calcFilename(fileId, fileOutput.mTmpFileItem);
+    if (!verifyFilenameAndDataType(fileId, fileOutput.mFilename, fileOutput.mTmpFileItem, returnStatus)) {
+        return false;
     }
-    if (mCache) mCache->timeRecFile(0); // record File timing into position id = 0
+    if (mTimeCache) mTimeCache->timeRecFile(0); // record File timing into position id = 0
 
     //------------------------------
     bool oiioImgSetupResult;
-    auto io = setupOiioImageSetup(filename, tmpFileItem, oiioImgSetupResult);
+    fileOutput.mIo = setupOiioImageSetup(fileOutput.mFilename, fileOutput.mTmpFileItem, oiioImgSetupResult);
     if (!oiioImgSetupResult) {
+        returnStatus = false;
         return false;
     }
-    if (mCache) mCache->timeRecFile(1); // record File timing into position id = 1
+    if (mTimeCache) mTimeCache->timeRecFile(1); // record File timing into position id = 1
 
     //------------------------------
     // create an OIIO::ImageSpec for each output image in the file
-    std::vector<OIIO::ImageSpec> specs;
-    setupOiioImageSpecTable(fileId, specs);
-    if (mCache) mCache->timeRecFile(2); // record File timing into position id = 2
+    setupOiioImageSpecTable(fileId, fileOutput.mSpecs);
+    if (mTimeCache) mTimeCache->timeRecFile(2); // record File timing into position id = 2
+
+    return true;
+}
+
+bool
+RenderOutputWriter::writeFileOutput(FileOutput& fileOutput) const
+{
+    mcrt_common::TimelineScope timelineScope("writeImageFile", "imageWrite", "fileId", fileOutput.mFileId);
+    scene_rdl2::rec_time::RecTime recTime;
+    recTime.start();
 
     //------------------------------
     // open the file
-    if (!openFile(filename, tmpFileItem, io, specs)) {
+    if (!openFile(fileOutput.mFilename, fileOutput.mTmpFileItem, fileOutput.mIo, fileOutput.mSpecs)) {
         return false;
     }
-    if (mCache) mCache->timeRecFile(3); // record File timing into position id = 3
+    if (mTimeCache) mTimeCache->timeRecFile(3); // record File timing into position id = 3
 
     //------------------------------
     // create a buffer for each image, fill it, and write it.
-    bool fillBufferAndWriteResult = fillBufferAndWrite(fileId, filename, tmpFileItem, io, specs);
-    if (mCache) mCache->timeRecFile(4); // record File timing into position id = 4
+    bool fillBufferAndWriteResult = fillBufferAndWrite(fileOutput.mFileId,
+                                                       fileOutput.mFilename,
+                                                       fileOutput.mTmpFileItem,
+                                                       fileOutput.mIo,
+                                                       fileOutput.mSpecs);
+    if (mTimeCache) mTimeCache->timeRecFile(4); // record File timing into position id = 4
 
     //------------------------------
     // close the file
-    bool closeFileResult = closeFile(filename, tmpFileItem, io);
-    if (mCache) mCache->timeRecFile(5); // record File timing into position id = 5
-
-    return (fillBufferAndWriteResult && closeFileResult);
+    bool closeFileResult = closeFile(fileOutput.mFilename, fileOutput.mTmpFileItem, fileOutput.mIo);
+    if (mTimeCache) mTimeCache->timeRecFile(5); // record File timing into position id = 5
+
+    const bool result = (fillBufferAndWriteResult && closeFileResult);
+    if (result && mRunMode != ImageWriteCache::Mode::ENQ) {
+        // Two stage output records the timing by the final destination filename.
+        ImageWriteDriver::get()->recFileWriteTime((fileOutput.mTmpFileItem) ?
+                                                  fileOutput.mTmpFileItem->getDestinationFilename() :
+                                                  fileOutput.mFilename,
+                                                  recTime.end());
+    }
+    return result;
 }
 
 std::string
@@ -396,6 +525,8 @@ RenderOutputWriter::calcFilename(const size_t fileId,
             if (mCache->getTwoStageOutput()) {
                 // We store filename (=tmpFilename) into cache when we are two stage output mode.
                 mCache->enq()->enqString(filename); // enq output filename into cache.
+            } else if (mCache->getFinalOutput()) {
+                mCache->enq()->enqString(filename); // final output filename
             } else {
                 // We store both of the filename into cache anyway and the final output filename will
                 // be decided at runtime depending on che condition of checkpointOuptutMultiVersion flag.
@@ -408,6 +539,8 @@ RenderOutputWriter::calcFilename(const size_t fileId,
             filename = mCache->deq()->deqString();
             // tmpFileItem is only valid pointer when two stage output mode is enabled
             tmpFileItem = mCache->getTmpFileItem(fileId);
+        } else if (mCache->getFinalOutput()) {
+            filename = mCache->deq()->deqString();
         } else {
             std::string checkpointFilename = mCache->deq()->deqString();
             std::string checkpointMultiVersionFilename = mCache->deq()->deqString();
@@ -438,7 +571,7 @@ RenderOutputWriter::verifyFilenameAndDataType(const size_t fileId,
                         const std::string& name = entry.mRenderOutput->getName();
                         std::ostringstream ostr;
                         ostr << "File output disabled for RenderOutput(\'" << name << "\'), file name empty.";
-                        mErrors.push_back(ostr.str());
+                        pushError(ostr.str());
                     }
                 }
             }
@@ -446,10 +579,15 @@ RenderOutputWriter::verifyFilenameAndDataType(const size_t fileId,
             returnStatus = false;
             return false;
         }
+        if (mRunMode == ImageWriteCache::Mode::STD && !mFileNameParam->mCheckpointOutput &&
+            mStreamedFiles && (*mStreamedFiles)[fileId]) {
+            // already written tile by tile while rendering
+            return false; // this is not a error
+        }
         if (mRunMode == ImageWriteCache::Mode::ENQ) mCache->enq()->enqBool(true);
     } else { // DEQ
         if (!mCache->deq()->deqBool()) {
-            mErrors.push_back("File output disable : file name empty.");
+            pushError("File output disable : file name empty.");
             returnStatus = false;
             return false;
         }
@@ -480,7 +618,7 @@ RenderOutputWriter::verifyFilenameAndDataType(const size_t fileId,
             return false; // this is not a error
         }
         if (hasFlat && hasNonFlat) {
-            mErrors.push_back(errMsg("Output file has a mixture of flat and non-float images", filename,
+            pushError(errMsg("Output file has a mixture of flat and non-float images", filename,
                                      tmpFileItem));
             if (mRunMode == ImageWriteCache::Mode::ENQ) mCache->enq()->enqBool(false);
             returnStatus = false;
@@ -489,7 +627,7 @@ RenderOutputWriter::verifyFilenameAndDataType(const size_t fileId,
         if (mRunMode == ImageWriteCache::Mode::ENQ) mCache->enq()->enqBool(true);
     } else { // DEQ
         if (!mCache->deq()->deqBool()) {
-            mErrors.push_back("Output file has a mixture of flat and non-float images");
+            pushError("Output file has a mixture of flat and non-float images");
             returnStatus = false;
             return false;
         }
@@ -512,7 +650,7 @@ RenderOutputWriter::setupOiioImageSetup(const std::string& filename,
             mSha1Gen->updateStr("io_construct");
         }
         if (!imgOutput) {
-            mErrors.push_back(errMsg("Failed to create OIIO::ImageOutput for ", filename, tmpFileItem));
+            pushError(errMsg("Failed to create OIIO::ImageOutput for ", filename, tmpFileItem));
             result = false;
         }
     } else { // ENQ
@@ -607,7 +745,7 @@ RenderOutputWriter::openFile(const std::string& filename,
         if (!io->open(filename.c_str(), specs.size(), &specs[0])) {
             std::ostringstream ostr;
             ostr << "Failed to open '" << filename << "' for writing." << " oiioError:(" << io->geterror() << ")";
-            mErrors.push_back(ostr.str());
+            pushError(ostr.str());
             return false;
         }
 
@@ -618,7 +756,7 @@ RenderOutputWriter::openFile(const std::string& filename,
                 std::ostringstream ostr;
                 ostr << "Failed to open two stage output tmpFile '" << filename
                      << "' (finally copy to '" << tmpFileItem->getDestinationFilename() << "').";
-                mErrors.push_back(ostr.str());
+                pushError(ostr.str());
                 io->close(); // close oiio file first.
                 return false;
             }
@@ -642,7 +780,7 @@ RenderOutputWriter::fillBufferAndWrite(const size_t fileId,
             bufferSpecFile.getBufferSpecSubImage(subImgId);
         const OIIO::ImageSpec* spec = (mRunMode != ImageWriteCache::Mode::ENQ) ? &specs[subImgId] : nullptr;
 
-        if (mCache) mCache->timeStartImage();
+        if (mTimeCache) mTimeCache->timeStartImage();
 
         // if not the first image, need to re-open to process the next sub-image
         if (subImgId > 0) {
@@ -656,20 +794,20 @@ RenderOutputWriter::fillBufferAndWrite(const size_t fileId,
                         std::ostringstream ostr;
                         ostr << "Failed to reopen file for writing part-name:"
                              << bufferSpecSubImage.getName();
-                        mErrors.push_back(errMsg(ostr.str(), filename, tmpFileItem));
+                        pushError(errMsg(ostr.str(), filename, tmpFileItem));
                         result = false;
-                        if (mCache) {
-                            mCache->timeRecImage(0); // record Image timing into position id = 0
-                            mCache->timeRecImage(1); // record Image timing into position id = 1
-                            mCache->timeRecImage(2); // record Image timing into position id = 2
-                            mCache->timeRecImage(3); // record Image timing into position id = 3
+                        if (mTimeCache) {
+                            mTimeCache->timeRecImage(0); // record Image timing into position id = 0
+                            mTimeCache->timeRecImage(1); // record Image timing into position id = 1
+                            mTimeCache->timeRecImage(2); // record Image timing into position id = 2
+                            mTimeCache->timeRecImage(3); // record Image timing into position id = 3
                         }
                         continue; // next! but I don't have a good feeling about the next sub-images either.
                     }
                 }
             }
         }
-        if (mCache) mCache->timeRecImage(0); // record Image timing into position id = 0
+        if (mTimeCache) mTimeCache->timeRecImage(0); // record Image timing into position id = 0
 
         if (!subImageFillBufferAndWrite(fileId, subImgId, io, spec)) {
             if (tmpFileItem) { // two stage output mode
@@ -678,10 +816,10 @@ RenderOutputWriter::fillBufferAndWrite(const size_t fileId,
             std::ostringstream ostr;
             ostr << "Failed to write buffer. part-name:"
                  << bufferSpecSubImage.getName();
-            mErrors.push_back(errMsg(ostr.str(), filename, tmpFileItem));
+            pushError(errMsg(ostr.str(), filename, tmpFileItem));
             result = false;
         }
-        if (mCache) mCache->timeRecImage(3); // record Image timing into position id = 3
+        if (mTimeCache) mTimeCache->timeRecImage(3); // record Image timing into position id = 3
     } // loop file.mImages
 
     return result;
@@ -710,16 +848,16 @@ RenderOutputWriter::closeFile(const std::string& filename,
             if (tmpFileItem) { // two stage output mode
                 tmpFileItem->closeTmpFile(); // clean up for two stage output
             }
-            mErrors.push_back(errMsg("Failed to close file", filename, tmpFileItem));
+            pushError(errMsg("Failed to close file", filename, tmpFileItem));
             result = false;
         } else {
             if (tmpFileItem) {
 #               ifdef IMAGE_WRITE_DETAIL_MESSAGE
-                mInfos.push_back(scene_rdl2::util::buildString("Wrote: tmpFile for ",
+                pushInfo(scene_rdl2::util::buildString("Wrote: tmpFile for ",
                                                                tmpFileItem->getDestinationFilename()));
 #               endif // end IMAGE_WRITE_DETAIL_MESSAGE
             } else {
-                mInfos.push_back(scene_rdl2::util::buildString("Wrote: ", filename));
+                pushInfo(scene_rdl2::util::buildString("Wrote: ", filename));
             }
         }
     }
@@ -734,6 +872,24 @@ RenderOutputWriter::setupImageSpecStdEnq(ImageWriteCacheImageSpec* imgSpec,
                                          const Image& img,
                                          const scene_rdl2::math::HalfOpenViewport& aperture,
                                          const scene_rdl2::math::HalfOpenViewport& region) const
+{
+    setupImageSpec(imgSpec, img, mWidth, mHeight, aperture, region);
+
+    // add checkpoint resume metadata if call back returns data
+    std::vector<std::string> metadata = (*mCallBackCheckpointResumeMetadata)(mCheckpointTileSampleTotals);
+    if (!metadata.empty()) {
+        imgSpec->resumeAttr() = metadata;
+    }
+}
+
+// static function
+void
+RenderOutputWriter::setupImageSpec(ImageWriteCacheImageSpec* imgSpec,
+                                   const Image& img,
+                                   const int width,
+                                   const int height,
+                                   const scene_rdl2::math::HalfOpenViewport& aperture,
+                                   const scene_rdl2::math::HalfOpenViewport& region)
 {
     int numChans = 0;
     for (const auto &entry: img.mEntries) {
@@ -756,8 +912,8 @@ RenderOutputWriter::setupImageSpecStdEnq(ImageWriteCacheImageSpec* imgSpec,
         imgSpec->setName(img.mName);
     }
                 
-    imgSpec->setSizeInfo(mWidth,
-                         mHeight,
+    imgSpec->setSizeInfo(width,
+                         height,
                          region.min().x,
                          aperture.max().y - region.max().y, // flip y relative to display window
                          aperture.min().x,
@@ -783,12 +939,31 @@ RenderOutputWriter::setupImageSpecStdEnq(ImageWriteCacheImageSpec* imgSpec,
             break;
         }
     }
+}
 
-    // add checkpoint resume metadata if call back returns data
-    std::vector<std::string> metadata = (*mCallBackCheckpointResumeMetadata)(mCheckpointTileSampleTotals);
-    if (!metadata.empty()) {
-        imgSpec->resumeAttr() = metadata;
-    }
+// static function
+OIIO::ImageSpec
+RenderOutputWriter::setupStreamedImageSpec(const Image& img,
+                                           const int width,
+                                           const int height,
+                                           const int tileSize)
+{
+    const scene_rdl2::rdl2::SceneVariables& vars =
+        img.mEntries[0].mRenderOutput->getSceneClass().getSceneContext()->getSceneVariables();
+
+    ImageWriteCacheImageSpec imgSpec;
+    setupImageSpec(&imgSpec, img, width, height, vars.getRezedApertureWindow(), vars.getRezedRegionWindow());
+
+    std::vector<OIIO::ImageSpec> specs;
+    addOiioImageSpec(&imgSpec, specs);
+
+    OIIO::ImageSpec& spec = specs[0];
+    spec.tile_width = tileSize;
+    spec.tile_height = tileSize;
+    spec.tile_depth = 1;
+    // tiles are written in the order they finish rendering
+    spec.attribute("openexr:lineOrder", "randomY");
+    return spec;
 }
 
 // static function
@@ -1000,25 +1175,24 @@ RenderOutputWriter::subImageFillBufferAndWrite(const size_t fileId,
 {
     bool result = true;
     if (mRunMode != ImageWriteCache::Mode::ENQ) { // STD/DEQ
-        OIIO::ImageBuf buffer(*spec);
-        fillBuffer(fileId, subImgId, &buffer);
-        if (mCache) mCache->timeRecImage(1); // record Image timing into position id = 1
-
+        // Scanlines are filled and written one by one. There is no whole sub-image sized
+        // intermediate buffer, so fill and write are recorded as a single step.
         if (mSha1Gen) {
             mSha1Gen->updateStr("buffer.write()");
         }
-        if (!mSha1Gen || mRunMode == ImageWriteCache::Mode::DEQ) {
-            if (mCache) mCache->timeStartBuffWrite();
-            result = buffer.write(io.get(), &progressCallBack, static_cast<void *>(mCache));
-            if (mCache) mCache->timeEndBuffWrite();
+        if (mTimeCache) mTimeCache->timeStartBuffWrite();
+        result = fillBuffer(fileId, subImgId, io.get(), spec);
+        if (mTimeCache) mTimeCache->timeEndBuffWrite();
+        if (mTimeCache) {
+            mTimeCache->timeRecImage(1); // record Image timing into position id = 1
+            mTimeCache->timeRecImage(2); // record Image timing into position id = 2
         }
-        if (mCache) mCache->timeRecImage(2); // record Image timing into position id = 2
 
     } else { // ENQ
-        result = fillBuffer(fileId, subImgId, nullptr);
-        if (mCache) {
-            mCache->timeRecImage(1); // record Image timing into position id = 1
-            mCache->timeRecImage(2); // record Image timing into position id = 2
+        result = fillBuffer(fileId, subImgId, nullptr, nullptr);
+        if (mTimeCache) {
+            mTimeCache->timeRecImage(1); // record Image timing into position id = 1
+            mTimeCache->timeRecImage(2); // record Image timing into position id = 2
         }
     }
 
@@ -1028,7 +1202,12 @@ RenderOutputWriter::subImageFillBufferAndWrite(const size_t fileId,
 bool
 RenderOutputWriter::fillBuffer(const size_t fileId,
                                const size_t subImgId,
-                               OIIO::ImageBuf* buffer) const
+                               OIIO::ImageOutput* io,
+                               const OIIO::ImageSpec* spec) const
+//
+// STD/DEQ : io and spec are the opened sub-image. io is not used when computing hash under STD mode.
+// ENQ : io and spec are nullptr.
+//
 {
     auto getBuffSpecSubImage = [&]() -> const ImageWriteCacheBufferSpecSubImage & {
         const ImageWriteCacheBufferSpecFile &buffSpecFile = mCurrBufferSpec->getBufferSpecFile(fileId);
@@ -1097,39 +1276,44 @@ RenderOutputWriter::fillBuffer(const size_t fileId,
         }
 
     } else { // STD/DEQ
-        // dataStd is a float buffer which includes final pixel values to pass into the openimageio API.
-        // STD mode simply fills dataStd from film and passes dataStd into openimageio API.
-        // DEQ mode constructs dataStd from imageWriteCache's dataFull/dataHalf and passes dataStd into
+        // scanline is a float buffer which includes final pixel values of a single scanline to pass into
+        // the openimageio API.
+        // STD mode simply fills scanline from film and passes scanline into openimageio API.
+        // DEQ mode constructs scanline from imageWriteCache's dataFull/dataHalf and passes scanline into
         // openimageio API.
-        std::vector<float> dataStd;
-        dataStd.resize(numchannels);
-
-        if (mRunMode == ImageWriteCache::Mode::DEQ) {
-            // We are going to initialize the DEQ buffer setup based on each sub-Image independently.
-            // This is important for error handling. Each sub-Image output does not have any dependency
-            // on the previous sub-image output result. This behavior is pretty important If the previous
-            // sub-Image (or file) failed to write.
-            mCache->setupDeqBuff(fileId, subImgId);
-        }
+        // Each scanline is written to the file as soon as it is filled. Only a single scanline is
+        // allocated instead of a whole sub-image buffer, which keeps the peak memory of the output
+        // close to the snapshot buffers themselves.
+        std::vector<float> scanline(static_cast<size_t>(mWidth) * numchannels);
+        const bool write = (!mSha1Gen || mRunMode == ImageWriteCache::Mode::DEQ);
+        MNRY_ASSERT(!write || (spec->height == mHeight && spec->tile_width == 0));
 
         //
-        // buffer setpixel operation is done by single thread
+        // Scanlines have to be written in increasing order. Image y is flipped relative to the
+        // buffer y. DEQ mode fetches the cache data of each scanline directly, so the order of
+        // the scanlines does not matter and files of the same cache can be written in parallel.
         //
-        for (int y = 0; y < mHeight; ++y) {
-            for (int x = 0; x < mWidth; ++x) {
-                if (mRunMode == ImageWriteCache::Mode::STD) { // STD
+        const int progressStep = std::max(mHeight / 10, 1);
+        for (int yOut = 0; yOut < mHeight; ++yOut) {
+            const int y = mHeight - yOut - 1;
+            if (mRunMode == ImageWriteCache::Mode::STD) { // STD
+                for (int x = 0; x < mWidth; ++x) {
                     fillPixBufferStd(fileId, subImgId, x, y,
-                                     getAovBuff(), getDisplayFilterBuff(), &dataStd[0]);
-                } else { // DEQ
-                    int yBlockId = mCache->calcYBlockId(y);
-                    const void *dataFull =
-                        (const void *)mCache->deqFullBuff(yBlockId)->skipByteData(pixCacheSizeFull);
-                    const void *dataHalf =
-                        (const void *)mCache->deqHalfBuff(yBlockId)->skipByteData(pixCacheSizeHalf);
-                    fillPixBufferDeq(fileId, subImgId, dataFull, dataHalf, &dataStd[0]);
+                                     getAovBuff(), getDisplayFilterBuff(), &scanline[x * numchannels]);
                 }
-                if (!mSha1Gen || mRunMode == ImageWriteCache::Mode::DEQ) {
-                    buffer->setpixel(buffer->xbegin() + x, buffer->yend() - y - 1, &dataStd[0]);
+            } else { // DEQ
+                // Cache data of the pixels of a scanline is stored contiguously inside the yBlock.
+                const void *dataFull = nullptr;
+                const void *dataHalf = nullptr;
+                mCache->getScanlineData(fileId, subImgId, y, dataFull, dataHalf);
+                fillScanlineDeq(fileId, subImgId, dataFull, dataHalf, &scanline[0]);
+            }
+            if (write) {
+                if (!io->write_scanline(spec->y + yOut, spec->z, OIIO::TypeDesc::FLOAT, &scanline[0])) {
+                    return false;
+                }
+                if (yOut % progressStep == 0) {
+                    progressCallBack(static_cast<void *>(mTimeCache), static_cast<float>(yOut) / mHeight);
                 }
             }
         }
@@ -1258,21 +1442,21 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
         if (mHeatMap) {
             // time per pixel stat
             const int64_t* p = mHeatMap->getData();
-            p = p + y * mWidth + x;
+            p = p + getPixOffset(x, y);
             outPtr[0] = mcrt_common::Clock::seconds(*p);
         }
         break;
     case scene_rdl2::rdl2::RenderOutput::RESULT_WEIGHT:
         if (mWeightBuffer) {
             const float* p = mWeightBuffer->getData();
-            p = p + y * mWidth + x;
+            p = p + getPixOffset(x, y);
             outPtr[0] = *p;
         }
         break;
     case scene_rdl2::rdl2::RenderOutput::RESULT_BEAUTY_AUX:
         if (mRenderBufferOdd) {
             const scene_rdl2::fb_util::RenderColor* p = mRenderBufferOdd->getData();
-            p = p + y * mWidth + x;
+            p = p + getPixOffset(x, y);
             outPtr[0] = p->x;
             outPtr[1] = p->y;
             outPtr[2] = p->z;
@@ -1281,7 +1465,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
     case scene_rdl2::rdl2::RenderOutput::RESULT_ALPHA_AUX:
         if (mRenderBufferOdd) {
             const scene_rdl2::fb_util::RenderColor* p = mRenderBufferOdd->getData();
-            p = p + y * mWidth + x;
+            p = p + getPixOffset(x, y);
             outPtr[0] = p->w;
         }
         break;
@@ -1303,7 +1487,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
                     MNRY_ASSERT(e.mChannelNames.size() == 1);
                     const scene_rdl2::fb_util::FloatBuffer& fbuf = aov->getFloatBuffer();
                     const float* f = fbuf.getData();
-                    f += y * mWidth + x;
+                    f += getPixOffset(x, y);
                     outPtr[0] = *f;
                 }
                 break;
@@ -1312,7 +1496,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
                     MNRY_ASSERT(e.mChannelNames.size() == 2);
                     const scene_rdl2::fb_util::Float2Buffer& f2buf = aov->getFloat2Buffer();
                     const scene_rdl2::math::Vec2f* v2f = f2buf.getData();
-                    v2f += y * mWidth + x;
+                    v2f += getPixOffset(x, y);
                     outPtr[0] = v2f->x;
                     outPtr[1] = v2f->y;
                 }
@@ -1322,7 +1506,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
                     MNRY_ASSERT(e.mChannelNames.size() == 3);
                     const scene_rdl2::fb_util::Float3Buffer& f3buf = aov->getFloat3Buffer();
                     const scene_rdl2::math::Vec3f* v3f = f3buf.getData();
-                    v3f += y * mWidth + x;
+                    v3f += getPixOffset(x, y);
                     outPtr[0] = v3f->x;
                     outPtr[1] = v3f->y;
                     outPtr[2] = v3f->z;
@@ -1333,7 +1517,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
                     MNRY_ASSERT(e.mChannelNames.size() == 4);
                     const scene_rdl2::fb_util::Float4Buffer& f4buf = aov->getFloat4Buffer();
                     const scene_rdl2::math::Vec4f* v4f = f4buf.getData();
-                    v4f += y * mWidth + x;
+                    v4f += getPixOffset(x, y);
                     outPtr[0] = v4f->x;
                     outPtr[1] = v4f->y;
                     outPtr[2] = v4f->z;
@@ -1361,7 +1545,7 @@ RenderOutputWriter::fillPixBufferSingleEntry(const Entry& e,
         {
             // Read data from the DisplayFilter Buffer
             const scene_rdl2::fb_util::Float3Buffer& f3buf = displayFilterBuffer->getFloat3Buffer();
-            const scene_rdl2::math::Vec3f& v3f = f3buf.getPixel(x, y);
+            const scene_rdl2::math::Vec3f& v3f = f3buf.getData()[getPixOffset(x, y)];
             outPtr[0] = v3f.x;
             outPtr[1] = v3f.y;
             outPtr[2] = v3f.z;
@@ -1395,8 +1579,6 @@ RenderOutputWriter::fillPixBufferDeq(const size_t fileId,
         return getBuffSpecSubImage().getPixNumChan()[entryId];
     };
 
-    std::vector<float> fVec;
-
     size_t cacheDataFullOffset = 0;
     size_t cacheDataHalfOffset = 0;
     size_t dataOutOffset = 0;
@@ -1407,10 +1589,8 @@ RenderOutputWriter::fillPixBufferDeq(const size_t fileId,
         case ImageWriteCacheBufferSpecSubImage::ChanFormat::HALF :
             {
                 const unsigned short* hPtr = (const unsigned short *)((uintptr_t)cacheDataHalf + cacheDataHalfOffset);
-                hVecToFVec(hPtr, numChan, fVec);
-                size_t dataSize = numChan * sizeof(float);
-                std::memcpy((void *)((uintptr_t)dataOut + dataOutOffset), &fVec[0], dataSize);
-                dataOutOffset += dataSize;
+                hToFArray(hPtr, numChan, (float *)((uintptr_t)dataOut + dataOutOffset));
+                dataOutOffset += numChan * sizeof(float);
                 cacheDataHalfOffset += numChan * sizeof(unsigned short);
 
                 if (mSha1Gen) {
@@ -1443,6 +1623,45 @@ RenderOutputWriter::fillPixBufferDeq(const size_t fileId,
     } // loop entries
 }
 
+void
+RenderOutputWriter::fillScanlineDeq(const size_t fileId,
+                                    const size_t subImgId,
+                                    const void* cacheDataFull,
+                                    const void* cacheDataHalf,
+                                    float* dataOut) const
+//
+// A scanline of cache data consists of mWidth pixels of pixCacheFullSize/pixCacheHalfSize bytes.
+// If all the entries of the sub-image are half (or all are full) float, the cache data of the scanline
+// has exactly the same channel order as the output scanline and we convert (or copy) it at once.
+// Otherwise, the pixels are constructed one by one. Hash computation also requires per pixel order.
+//
+{
+    const ImageWriteCacheBufferSpecSubImage& buffSpecSubImg =
+        mCurrBufferSpec->getBufferSpecFile(fileId).getBufferSpecSubImage(subImgId);
+    const size_t numChan = buffSpecSubImg.getTotalNumChannels();
+    const size_t pixCacheSizeFull = buffSpecSubImg.getPixCacheFullSize();
+    const size_t pixCacheSizeHalf = buffSpecSubImg.getPixCacheHalfSize();
+
+    if (!mSha1Gen) {
+        const size_t total = static_cast<size_t>(mWidth) * numChan;
+        if (pixCacheSizeFull == 0 && pixCacheSizeHalf == numChan * sizeof(unsigned short)) {
+            hToFArray(static_cast<const unsigned short *>(cacheDataHalf), total, dataOut);
+            return;
+        }
+        if (pixCacheSizeHalf == 0 && pixCacheSizeFull == numChan * sizeof(float)) {
+            std::memcpy(static_cast<void *>(dataOut), cacheDataFull, total * sizeof(float));
+            return;
+        }
+    }
+
+    for (int x = 0; x < mWidth; ++x) {
+        fillPixBufferDeq(fileId, subImgId,
+                         (const void *)((uintptr_t)cacheDataFull + x * pixCacheSizeFull),
+                         (const void *)((uintptr_t)cacheDataHalf + x * pixCacheSizeHalf),
+                         dataOut + x * numChan);
+    }
+}
+
 // static function
 void
 RenderOutputWriter::calcPixCacheSize(const std::vector<Entry>& entries,
@@ -1464,33 +1683,6 @@ RenderOutputWriter::calcPixCacheSize(const std::vector<Entry>& entries,
 void
 RenderOutputWriter::fVecToHVec(const PageAlignedBuff& fVec, unsigned short* hVec)
 {
-#if 1
-    // fp16c instruction version :
-    // You can check your cpu has fp16c instruction by ( lscpu | grep fp16c).
-    auto f4toh4 = [](const __m128& in, unsigned short* h4, int count) {
-        // This function basically converts 4 floats to 4 half floats however still need to maintain
-        // less than 4 floats case. (i.e. it is the case that Input data has 4 float memory but only
-        // set less than 4 float).
-        __m128i out = _mm_cvtps_ph(in, 0); // An immediate value controlling rounding bits : 0=Nearest
-        MNRY_ASSERT(count <= 4);
-        std::memcpy(static_cast<void *>(h4),
-                    static_cast<const void *>(&out), sizeof(unsigned short) * count);
-    };
-#else
-    // non fp16c instruction version
-    auto f4toh4 = [&](const __m128& in, unsigned short* h4, int count) {
-        // This is a special version which does not use fp16c instruction (i.e. _mm_cvtps_ph).
-        // We are not using a host that does not support fp16c instruction anymore.
-        // However, just in case, I would like to keep this code in order to support non-fp16c hosts
-        // in some cases.
-        MNRY_ASSERT(count <= 4);
-        const float* fptr = (const float*)&in;
-        for (int i = 0; i < count; ++i) {
-            h4[i] = ftoh(fptr[i]);
-        }
-    };
-#endif
-
     const float* fPtr = (const float*)&fVec[0];
 
     size_t fCount = fVec.size() / sizeof(float); // total float count
@@ -1501,21 +1693,8 @@ RenderOutputWriter::fVecToHVec(const PageAlignedBuff& fVec, unsigned short* hVec
         hVerifyTarget.push_back(ftoh(fPtr[i]));
     }
 #   endif // end RUNTIME_VERIFY_FTOH
-    
-    if (fCount == 1) {
-        hVec[0] = ftoh(fPtr[0]);
-    } else {
-        const __m128* m128Ptr = (const __m128*)fPtr;
 
-        size_t simd4LoopMax = fCount / 4;
-        for (size_t i = 0; i < simd4LoopMax; ++i) {
-            f4toh4(m128Ptr[i], &hVec[i * 4], 4);
-        }
-
-        if (fCount % 4) {
-            f4toh4(m128Ptr[simd4LoopMax], &hVec[simd4LoopMax * 4], fCount % 4);
-        }
-    }
+    fToHArray(fPtr, fCount, hVec);
 
 #   ifdef RUNTIME_VERIFY_FTOH
     for (size_t i = 0; i < fCount; ++i) {
@@ -1527,6 +1706,58 @@ RenderOutputWriter::fVecToHVec(const PageAlignedBuff& fVec, unsigned short* hVec
 #   endif // end RUNTIME_VERIFY_FTOH
 }
 
+// static function
+void
+RenderOutputWriter::fToHArray(const float* fArray, const size_t total, unsigned short* hArray)
+//
+// All the vector versions use the same rounding (= nearest) as ftoh() and the remaining tail is
+// converted by ftoh(). So the result is bit-exact regardless of the instruction set.
+// You can check your cpu has fp16c instruction by ( lscpu | grep f16c).
+//
+{
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= total; i += 16) {
+        const __m256i h16 = _mm512_cvtps_ph(_mm512_loadu_ps(fArray + i),
+                                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(hArray + i), h16);
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 8 <= total; i += 8) {
+        const __m128i h8 = _mm256_cvtps_ph(_mm256_loadu_ps(fArray + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(hArray + i), h8);
+    }
+#endif
+    for (; i < total; ++i) {
+        hArray[i] = ftoh(fArray[i]);
+    }
+}
+
+// static function
+void
+RenderOutputWriter::hToFArray(const unsigned short* hArray, const size_t total, float* fArray)
+//
+// Half to full float conversion is exact, so all the versions return the same result.
+//
+{
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= total; i += 16) {
+        const __m256i h16 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hArray + i));
+        _mm512_storeu_ps(fArray + i, _mm512_cvtph_ps(h16));
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 8 <= total; i += 8) {
+        const __m128i h8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hArray + i));
+        _mm256_storeu_ps(fArray + i, _mm256_cvtph_ps(h8));
+    }
+#endif
+    for (; i < total; ++i) {
+        fArray[i] = htof(hArray[i]);
+    }
+}
 
 // static function
 float
@@ -1558,17 +1789,6 @@ RenderOutputWriter::ftoh(const float f)
 #endif
 }
 
-// static function
-void
-RenderOutputWriter::hVecToFVec(const unsigned short* hVec, const unsigned itemTotal, std::vector<float>& fVec)
-{
-    fVec.clear();
-    fVec.resize(itemTotal);
-    for (size_t i = 0; i < itemTotal; ++i) {
-        fVec[i] = htof(hVec[i]);
-    }
-}
-
 // static function
 #ifdef PRECISE_HASH_COMPARE
 float
@@ -1619,5 +1839,19 @@ RenderOutputWriter::errMsg(const std::string& msg,
     return ostr.str();
 }
 
+void
+RenderOutputWriter::pushError(const std::string& msg) const
+{
+    std::lock_guard<std::mutex> lock(mMessageMutex);
+    mErrors.push_back(msg);
+}
+
+void
+RenderOutputWriter::pushInfo(const std::string& msg) const
+{
+    std::lock_guard<std::mutex> lock(mMessageMutex);
+    mInfos.push_back(msg);
+}
+
 } // namespace rndr
 } // namespace moonray
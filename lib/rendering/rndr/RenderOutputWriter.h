@@ -5,10 +5,13 @@
 
 #include "ImageWriteCache.h"
 
+#include <scene_rdl2/common/fb_util/Tiler.h>
 #include <scene_rdl2/render/util/AlignedAllocator.h>
 
 #include <OpenImageIO/imagebuf.h>
 
+#include <mutex>
+
 namespace scene_rdl2 {
 namespace fb_util {
     class VariablePixelBuffer;
@@ -101,6 +104,7 @@ public:
                        const scene_rdl2::fb_util::RenderBuffer* renderBufferOdd,
                        const std::vector<scene_rdl2::fb_util::VariablePixelBuffer>* aovBuffers,
                        const std::vector<scene_rdl2::fb_util::VariablePixelBuffer>* displayFilterBuffers,
+                       const scene_rdl2::fb_util::Tiler* tiler,
                        std::vector<std::string>& errors,
                        std::vector<std::string>& infos,
                        scene_rdl2::grid_util::Sha1Gen* sha1Gen)
@@ -117,6 +121,7 @@ public:
         , mRenderBufferOdd(renderBufferOdd)
         , mAovBuffers(aovBuffers)
         , mDisplayFilterBuffers(displayFilterBuffers)
+        , mTiler(tiler)
         , mSha1Gen(sha1Gen)
     {
         MNRY_ASSERT(dataValidityCheck(predefinedWidth, predefinedHeight));
@@ -124,6 +129,7 @@ public:
         setupBuffOffsetTable();
         setupCheckpointTileSampleTotals(checkpointTileSampleTotals);
         setupWidthHeight(predefinedWidth, predefinedHeight);
+        setupFileOutputThreads();
     }
 
     // constructor for DEQ operation
@@ -145,6 +151,7 @@ public:
         setupBuffOffsetTable();
         setupCheckpointTileSampleTotals(0);
         setupWidthHeight(0, 0);
+        setupFileOutputThreads();
     }
 
     //
@@ -160,23 +167,59 @@ public:
     // We don't stop writing action when we hit the first error, and we will try to write the data as much
     // as possible.
     //
+    // STD and DEQ write the files by multiple threads when ImageWriteDriver allows more than one file
+    // write thread. See parallelFileOutput() for more detail.
+    //
     bool main() const;
 
+    // Final output files which were already written tile by tile while rendering. They are
+    // skipped by the final output. See RenderOutputDriver::startStreaming().
+    void setStreamedFiles(const std::vector<bool>* streamedFiles) { mStreamedFiles = streamedFiles; }
+
+    // Spec of a single image file which is written tile by tile, in the order the tiles finish
+    // rendering, as a tiled image of tileSize x tileSize tiles.
+    static OIIO::ImageSpec setupStreamedImageSpec(const Image& img,
+                                                  const int width,
+                                                  const int height,
+                                                  const int tileSize);
+
     static std::string generateCheckpointMultiVersionFilename(const File& file,
                                                               const bool overwriteCheckpoint,
                                                               const unsigned finalMaxSamplesPerPixel,
                                                               const unsigned checkpointTileSampleTotals);
 
+    // Full float <-> half float conversion of arrays. Vectorized by AVX-512 or F16C depending on the
+    // build target and bit-exact with the single value ftoh()/htof() conversions.
+    static void fToHArray(const float* fArray, const size_t total, unsigned short* hArray);
+    static void hToFArray(const unsigned short* hArray, const size_t total, float* fArray);
+    static float htof(const unsigned short h);
+    static unsigned short ftoh(const float f);
+
 private:
 
     bool dataValidityCheck(const int predefinedWidth, const int predefinedHeight) const;
     void setupBuffOffsetTable();
     void setupCheckpointTileSampleTotals(const unsigned checkpointTileSampleTotals);
     void setupWidthHeight(const int deepBufferWidth, const int deepBufferHeight);
+    void setupFileOutputThreads();
 
     //------------------------------
 
+    // A file which is ready to be written. Set up by setupFileOutput() and written by writeFileOutput().
+    struct FileOutput
+    {
+        size_t mFileId {0};
+        std::string mFilename;
+        ImageWriteCache::ImageWriteCacheTmpFileItemShPtr mTmpFileItem;
+        OIIO::ImageOutput::unique_ptr mIo;
+        std::vector<OIIO::ImageSpec> mSpecs;
+    };
+
     bool singleFileOutput(const size_t fileId) const;
+    bool parallelFileOutput() const;
+
+    bool setupFileOutput(const size_t fileId, FileOutput& fileOutput, bool& returnStatus) const;
+    bool writeFileOutput(FileOutput& fileOutput) const;
 
     std::string calcFilename(const size_t fileId,
                              ImageWriteCache::ImageWriteCacheTmpFileItemShPtr& tmpFileItem) const;
@@ -215,6 +258,12 @@ private:
                               const Image& img,
                               const scene_rdl2::math::HalfOpenViewport& aperture,
                               const scene_rdl2::math::HalfOpenViewport& region) const;
+    static void setupImageSpec(ImageWriteCacheImageSpec* imgSpec,
+                               const Image& img,
+                               const int width,
+                               const int height,
+                               const scene_rdl2::math::HalfOpenViewport& aperture,
+                               const scene_rdl2::math::HalfOpenViewport& region);
     static void addOiioImageSpec(const ImageWriteCacheImageSpec* imgSpec,
                                  std::vector<OIIO::ImageSpec>& specs);
     void updateHashImageSpecOrg(const File& f,
@@ -231,7 +280,8 @@ private:
                                     const OIIO::ImageSpec* spec) const;
     bool fillBuffer(const size_t fileId,
                     const size_t subImgId,
-                    OIIO::ImageBuf* buffer) const;
+                    OIIO::ImageOutput* io,
+                    const OIIO::ImageSpec* spec) const;
     void fillPixBufferStd(const size_t fileId,
                           const size_t subImgId,
                           const int x,
@@ -256,17 +306,22 @@ private:
                                   const VariablePixelBuffer *&aov,
                                   const VariablePixelBuffer *&displayFilterBuffer,
                                   float* outPtr) const;
+    size_t getPixOffset(const int x, const int y) const {
+        return (mTiler) ? mTiler->linearCoordsToTiledOffset(x, y) : static_cast<size_t>(y) * mWidth + x;
+    }
 
     void fillPixBufferDeq(const size_t fileId,
                           const size_t subImgId,
                           const void* cacheDataFull,
                           const void* cacheDataHalf,
                           float* dataOut) const;
+    void fillScanlineDeq(const size_t fileId,
+                         const size_t subImgId,
+                         const void* cacheDataFull,
+                         const void* cacheDataHalf,
+                         float* dataOut) const;
 
     static void calcPixCacheSize(const std::vector<Entry>& entries, size_t& fullBuffSize, size_t& halfBuffSize);
-    static float htof(const unsigned short h);
-    static unsigned short ftoh(const float f);
-    static void hVecToFVec(const unsigned short* hVec, const unsigned itemTotal, std::vector<float>& fVec);
     static void fVecToHVec(const PageAlignedBuff& fVec, unsigned short* hVec);
 
     static float precisionAdjustF(const float f, int reso=4096);
@@ -278,14 +333,24 @@ private:
                        const std::string& filename,
                        ImageWriteCache::ImageWriteCacheTmpFileItemShPtr tmpFileItem) const;
 
+    // MTsafe, files might be written by multiple threads
+    void pushError(const std::string& msg) const;
+    void pushInfo(const std::string& msg) const;
+
     //------------------------------
 
     std::vector<std::string>& mErrors;
     std::vector<std::string>& mInfos;
+    mutable std::mutex mMessageMutex;
 
     const ImageWriteCache::Mode mRunMode {ImageWriteCache::Mode::DEQ};
     ImageWriteCache* mCache {nullptr};
 
+    // The timing log of the cache is only recorded when the files are written one by one. It is not
+    // designed for concurrent updates. mTimeCache is nullptr when the files are written in parallel.
+    unsigned mFileOutputThreads {1};
+    ImageWriteCache* mTimeCache {nullptr};
+
     unsigned mCheckpointTileSampleTotals {0};
     int mWidth {0};
     int mHeight {0};
@@ -304,6 +369,13 @@ private:
     const scene_rdl2::fb_util::RenderBuffer* mRenderBufferOdd {nullptr};
     const std::vector<scene_rdl2::fb_util::VariablePixelBuffer>* mAovBuffers {nullptr};
     const std::vector<scene_rdl2::fb_util::VariablePixelBuffer>* mDisplayFilterBuffers {nullptr};
+
+    // Non null when the pixel buffers above are in the tiled memory layout of the Film (i.e. snapshot
+    // without untile). Pixels are then looked up through the tiler instead of by scanline offset and
+    // the width/height are the original (unaligned) resolution of the tiler.
+    const scene_rdl2::fb_util::Tiler* mTiler {nullptr};
+
+    const std::vector<bool>* mStreamedFiles {nullptr};
         
     scene_rdl2::grid_util::Sha1Gen* mSha1Gen {nullptr};
 };
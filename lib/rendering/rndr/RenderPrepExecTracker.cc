@@ -5,12 +5,21 @@
 //
 #include "RenderPrepExecTracker.h"
 
+#include <moonray/common/mcrt_util/StringPool.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
+
 #include <scene_rdl2/common/grid_util/Arg.h>
 #include <scene_rdl2/common/grid_util/Parser.h>
 #include <scene_rdl2/common/grid_util/RenderPrepStats.h>
 #include <scene_rdl2/scene/rdl2/ValueContainerDeq.h>
 #include <scene_rdl2/scene/rdl2/ValueContainerEnq.h>
 
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 //#define DEBUG_MSG
 
 #ifdef DEBUG_MSG
@@ -70,6 +79,9 @@ public:
 
     RESULT endRenderPrep();
 
+    void addPhaseTime(const std::string &phase, float sec);
+    std::string showPhaseTime() const;
+
     Parser& getParser() { return mParser; }
 
     std::string cancelInfoEncode() const; // for debug console
@@ -102,6 +114,7 @@ private:
                            const Condition &cancelCondition) const;
     RESULT checkRunStatus(const CancelCodePos &callerCodePos) const;
     void renderPrepStatsUpdate() const;
+    void traceStage(const CancelCodePos &callerCodePos) const;
     scene_rdl2::grid_util::RenderPrepStats calcRenderPrepStats() const;
 
     void parserConfigure();
@@ -127,10 +140,17 @@ private:
     Condition mRunFinalizeChange0;
     Condition mRunFinalizeChange1;
 
+    // phase name and accumulated time in sec, in the order the phases first ran
+    mutable std::mutex mPhaseTimeMutex;
+    std::vector<std::pair<std::string, float>> mPhaseTime;
+
     //------------------------------
 
     Parser mParser;
     CancelCodePos mCancelCodePos;
+
+    // timeline trace start time of the stages, indexed by their start CancelCodePos
+    mutable double mStageTraceStart[static_cast<int>(CancelCodePos::MAX)];
 };
 
 void
@@ -160,6 +180,10 @@ RenderPrepExecTracker::Impl::init()
     mRunLoadGeom1 = Condition::INIT;
     mRunFinalizeChange0 = Condition::INIT;
     mRunFinalizeChange1 = Condition::INIT;
+    std::fill(std::begin(mStageTraceStart), std::end(mStageTraceStart), -1.0);
+
+    std::lock_guard<std::mutex> lock(mPhaseTimeMutex);
+    mPhaseTime.clear();
 }
 
 RenderPrepExecTracker::Impl::RESULT
@@ -270,6 +294,40 @@ RenderPrepExecTracker::Impl::endRenderPrep()
                            Condition::END_CANCELED);
 }
 
+void
+RenderPrepExecTracker::Impl::addPhaseTime(const std::string &phase, float sec)
+{
+    if (mcrt_common::TimelineTrace::isEnabled()) {
+        // Phases are reported once finished. The trace keeps the name pointer, so it has
+        // to come from the string pool.
+        const double end = mcrt_common::TimelineTrace::now();
+        mcrt_common::TimelineTrace::record(util::getStringPool().get(phase)->c_str(), "renderPrep",
+                                           end - sec * 1.0e6, end);
+    }
+
+    std::lock_guard<std::mutex> lock(mPhaseTimeMutex);
+    for (auto &itr : mPhaseTime) {
+        if (itr.first == phase) {
+            itr.second += sec;
+            return;
+        }
+    }
+    mPhaseTime.emplace_back(phase, sec);
+}
+
+std::string
+RenderPrepExecTracker::Impl::showPhaseTime() const
+{
+    std::lock_guard<std::mutex> lock(mPhaseTimeMutex);
+    std::ostringstream ostr;
+    ostr << "phaseTime (size:" << mPhaseTime.size() << ") {\n";
+    for (const auto &itr : mPhaseTime) {
+        ostr << "  " << itr.first << " : " << itr.second * 1000.0f << " ms\n";
+    }
+    ostr << "}";
+    return ostr.str();
+}
+
 std::string
 RenderPrepExecTracker::Impl::cancelInfoEncode() const
 {
@@ -335,6 +393,7 @@ RenderPrepExecTracker::Impl::updateRunStatus(const CancelCodePos &callerCodePos,
     }
 
     renderPrepStatsUpdate();
+    traceStage(callerCodePos);
 
     if (mMsgHandlerCallBack && result == RESULT::CANCELED) {
         std::ostringstream ostr;
@@ -384,6 +443,44 @@ RenderPrepExecTracker::Impl::renderPrepStatsUpdate() const
 #   endif // end DEBUG_MSG    
 }
 
+void
+RenderPrepExecTracker::Impl::traceStage(const CancelCodePos &callerCodePos) const
+{
+    if (!mcrt_common::TimelineTrace::isEnabled()) return;
+
+    // stage name and start position of the end positions
+    const char *name = nullptr;
+    CancelCodePos startCodePos = CancelCodePos::EMPTY;
+    switch (callerCodePos) {
+    case CancelCodePos::RENDER_PREP_START :
+    case CancelCodePos::APPLY_UPDATE_START :
+    case CancelCodePos::LOAD_GEOM0_START :
+    case CancelCodePos::LOAD_GEOM1_START :
+    case CancelCodePos::FINALIZE_CHANGE0_START :
+    case CancelCodePos::FINALIZE_CHANGE1_START :
+        mStageTraceStart[static_cast<int>(callerCodePos)] = mcrt_common::TimelineTrace::now();
+        return;
+    case CancelCodePos::APPLY_UPDATE_END :
+        name = "applyUpdate"; startCodePos = CancelCodePos::APPLY_UPDATE_START; break;
+    case CancelCodePos::LOAD_GEOM0_END :
+        name = "loadGeom0"; startCodePos = CancelCodePos::LOAD_GEOM0_START; break;
+    case CancelCodePos::LOAD_GEOM1_END :
+        name = "loadGeom1"; startCodePos = CancelCodePos::LOAD_GEOM1_START; break;
+    case CancelCodePos::FINALIZE_CHANGE0_END :
+        name = "finalizeChange0"; startCodePos = CancelCodePos::FINALIZE_CHANGE0_START; break;
+    case CancelCodePos::FINALIZE_CHANGE1_END :
+        name = "finalizeChange1"; startCodePos = CancelCodePos::FINALIZE_CHANGE1_START; break;
+    case CancelCodePos::RENDER_PREP_END :
+        name = "renderPrep"; startCodePos = CancelCodePos::RENDER_PREP_START; break;
+    default : return;
+    }
+
+    const double start = mStageTraceStart[static_cast<int>(startCodePos)];
+    if (start >= 0.0) {
+        mcrt_common::TimelineTrace::record(name, "renderPrep", start, mcrt_common::TimelineTrace::now());
+    }
+}
+
 scene_rdl2::grid_util::RenderPrepStats
 RenderPrepExecTracker::Impl::calcRenderPrepStats() const
 //
@@ -471,6 +568,8 @@ RenderPrepExecTracker::Impl::parserConfigure()
                 [&](Arg &arg) -> bool { return arg.msg(showCancelCodePosIdList() + '\n'); });
     mParser.opt("show", "", "show internal parameters",
                 [&](Arg &arg) -> bool { return arg.msg(show() + '\n'); });
+    mParser.opt("phaseTime", "", "show time of the renderPrep phases",
+                [&](Arg &arg) -> bool { return arg.msg(showPhaseTime() + '\n'); });
 }
 
 std::string
@@ -660,6 +759,18 @@ RenderPrepExecTracker::endRenderPrep()
     return mImpl->endRenderPrep();
 }
 
+void
+RenderPrepExecTracker::addPhaseTime(const std::string &phase, float sec)
+{
+    mImpl->addPhaseTime(phase, sec);
+}
+
+std::string
+RenderPrepExecTracker::showPhaseTime() const
+{
+    return mImpl->showPhaseTime();
+}
+
 scene_rdl2::grid_util::Parser &
 RenderPrepExecTracker::getParser()
 {
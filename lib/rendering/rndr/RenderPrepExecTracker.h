@@ -9,6 +9,7 @@
 
 #include <memory>               // unique_ptr
 #include <functional>           // function
+#include <string>
 
 namespace scene_rdl2 {
 
@@ -78,6 +79,12 @@ public:
 
     RESULT endRenderPrep();
 
+    // Wall clock time of renderPrep phases which have no stage of their own (building the
+    // primitive attribute tables, the material aov flags, ...). Phases called more than once
+    // accumulate. Some phases run concurrently, so this is thread-safe. Cleared by init().
+    void addPhaseTime(const std::string &phase, float sec);
+    std::string showPhaseTime() const;
+
     //------------------------------
 
     scene_rdl2::grid_util::Parser& getParser();
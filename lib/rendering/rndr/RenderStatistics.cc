@@ -6,6 +6,7 @@
 
 #include "RenderStatistics.h"
 #include "Error.h"
+#include "ImageWriteDriver.h"
 #include "RenderDriver.h"
 
 #include <moonray/statistics/StatsTable.h>
@@ -20,6 +21,7 @@
 #include <moonray/rendering/pbr/core/Scene.h>
 #include <moonray/rendering/pbr/core/Statistics.h>
 #include <moonray/rendering/texturing/sampler/TextureSampler.h>
+#include <moonray/rendering/texturing/sampler/VdbGridCache.h>
 
 #include <scene_rdl2/common/math/Viewport.h>
 #include <scene_rdl2/common/math/Math.h>
@@ -27,8 +29,12 @@
 #include <scene_rdl2/scene/rdl2/RenderOutput.h>
 #include <scene_rdl2/scene/rdl2/rdl2.h>
 
+#include <algorithm>
+#include <cmath>
 #include <ctime>
+#include <functional>
 #include <iomanip>
+#include <sstream>
 #include <fstream>
 #include <sys/param.h>
 #include <unistd.h>
@@ -41,6 +47,10 @@
 # endif
 #endif
 
+#ifndef MOONRAY_ISPC_TARGETS
+#define MOONRAY_ISPC_TARGETS ""
+#endif
+
 namespace moonray {
 namespace rndr {
 
@@ -83,6 +93,36 @@ getCommonPrefix(std::vector<RenderStats::ShaderStat>::const_iterator first,
     return result;
 }
 
+#ifndef __APPLE__
+// The target the ISPC dispatch code runs on this cpu: the best of the comma
+// separated targets built in which the cpu supports.
+std::string
+getIspcRuntimeTarget(const util::CPUID &cpuid, const std::string &targets)
+{
+    auto rank = [&cpuid](const std::string &isa) {
+        if (isa.compare(0, 9, "avx512skx") == 0) return cpuid.avx512skx() ? 5 : -1;
+        if (isa.compare(0, 4, "avx2") == 0)      return cpuid.avx2() ? 4 : -1;
+        if (isa.compare(0, 3, "avx") == 0)       return cpuid.avx() ? 3 : -1;
+        if (isa.compare(0, 4, "sse4") == 0)      return cpuid.sse42() ? 2 : -1;
+        if (isa.compare(0, 4, "sse2") == 0)      return cpuid.sse2() ? 1 : -1;
+        return 0;
+    };
+
+    std::string best = "none";
+    int bestRank = -1;
+    std::stringstream ss(targets);
+    std::string isa;
+    while (std::getline(ss, isa, ',')) {
+        const int isaRank = rank(isa);
+        if (isaRank > bestRank) {
+            best = isa;
+            bestRank = isaRank;
+        }
+    }
+    return best;
+}
+#endif
+
 std::string
 commonPrefixObjectName(const scene_rdl2::rdl2::SceneObject *obj, const std::string &prefix)
 {
@@ -174,6 +214,8 @@ RenderStats::reset()
     // work we can display that AND ouptut the average over many frames in the
     // stats file.
     mLoadSceneTime.reset();
+    mLoadSceneReadTime.reset();
+    mLoadSceneDecodeTime.reset();
     mLoadPbrTime.reset();
     mBuildPrimAttrTableTime.reset();
     mLoadProceduralsTime.reset();
@@ -188,6 +230,7 @@ RenderStats::reset()
     mRtcCommitTime = 0.0;
 
     mShaderCallStats.clear();
+    mMaterialOcclusionTime.clear();
 
     mTotalRenderPrepTime = 0.0;
     mFrameStartTime = 0.0;
@@ -514,6 +557,8 @@ RenderStats::logRenderOptions(const RenderOptions& options, std::ostream& outs,
     hardwareTable.emplace_back("AVX support", cpuid.avx());
     hardwareTable.emplace_back("AVX2 support", cpuid.avx2());
     hardwareTable.emplace_back("AVX512 support", cpuid.avx512());
+    hardwareTable.emplace_back("ISPC build targets", MOONRAY_ISPC_TARGETS);
+    hardwareTable.emplace_back("ISPC runtime target", getIspcRuntimeTarget(cpuid, MOONRAY_ISPC_TARGETS));
 
     char curPath[MAXPATHLEN];
     getcwd(curPath, MAXPATHLEN);
@@ -964,10 +1009,51 @@ RenderStats::logVectorMemoryUsage(size_t rayQueuesBytes,
     }
 }
 
+void
+RenderStats::logPoolHighWater(size_t rayStatePoolBytes,
+                              size_t rayStatePoolReservedBytes,
+                              size_t cacheLine1PoolBytes,
+                              size_t cacheLine1PoolReservedBytes)
+{
+    StatsTable<2> poolTable("Vector Pool High Water");
+
+    auto fraction = [](size_t used, size_t reserved) {
+        return (reserved > 0) ? static_cast<double>(used) / static_cast<double>(reserved) : 0.0;
+    };
+
+    poolTable.emplace_back("RayState pool high water", bytes(rayStatePoolBytes));
+    poolTable.emplace_back("RayState pool reserved", bytes(rayStatePoolReservedBytes));
+    poolTable.emplace_back("RayState pool used", percentage(fraction(rayStatePoolBytes, rayStatePoolReservedBytes)));
+    poolTable.emplace_back("CacheLine 1 pool high water", bytes(cacheLine1PoolBytes));
+    poolTable.emplace_back("CacheLine 1 pool reserved", bytes(cacheLine1PoolReservedBytes));
+    poolTable.emplace_back("CacheLine 1 pool used",
+                           percentage(fraction(cacheLine1PoolBytes, cacheLine1PoolReservedBytes)));
+
+    auto writeCSV = [&](std::ostream& outs, bool athenaFormat) {
+        outs.precision(2);
+        outs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        writeEqualityCSVTable(outs, poolTable, athenaFormat);
+    };
+
+    if (getLogAthena()) {
+        writeCSV(mAthenaStream, true);
+    }
+    if (getLogCsv()) {
+        writeCSV(mCSVStream, false);
+    }
+    if (getLogInfo()) {
+        const std::string pre = getPrependString();
+        mInfoStream.precision(2);
+        mInfoStream.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        writeEqualityInfoTable(mInfoStream, pre, poolTable);
+    }
+}
+
 void
 RenderStats::logXPUMemoryUsage(size_t rayQueueBytes,
                                size_t occlusionQueueBytes,
-                               size_t cpuMemoryBytes)
+                               size_t cpuMemoryBytes,
+                               const std::vector<size_t>& gpuMemoryBytes)
 {
     StatsTable<2> summaryTable("XPU Memory Summary");
 
@@ -980,6 +1066,9 @@ RenderStats::logXPUMemoryUsage(size_t rayQueueBytes,
     summaryTable.emplace_back("Ray (pointer) queue memory", bytes(rayQueueBytes));
     summaryTable.emplace_back("Occlusion queue memory", bytes(occlusionQueueBytes));
     summaryTable.emplace_back("CPU memory", bytes(cpuMemoryBytes));
+    for (size_t i = 0; i < gpuMemoryBytes.size(); ++i) {
+        summaryTable.emplace_back("GPU " + std::to_string(i) + " memory", bytes(gpuMemoryBytes[i]));
+    }
 
     if (getLogAthena()) {
         writeCSV(mAthenaStream, true);
@@ -1047,11 +1136,11 @@ void
 RenderStats::logGeometryUsage(const geom::GeometryStatistics& totalGeomStatistics,
         const GeometryStatsTable& geomStateInfo)
 {
-    using GeomTable = StatsTable<6>;
+    using GeomTable = StatsTable<7>;
     GeomTable geomTable("Geometry Statistics", "Geometry Name",
         "Face Count", "Mesh Vertex Count",
         "Curves Count", "Curves CV Count",
-        "Instance Count");
+        "Instance Count", "Vertex Bytes Copied");
 
     for(std::size_t i = 0; i < geomStateInfo.size(); ++i) {
         geomTable.emplace_back(geomStateInfo[i].first,
@@ -1059,7 +1148,8 @@ RenderStats::logGeometryUsage(const geom::GeometryStatistics& totalGeomStatistic
            geomStateInfo[i].second.mMeshVertexCount,
            geomStateInfo[i].second.mCurvesCount,
            geomStateInfo[i].second.mCVCount,
-           geomStateInfo[i].second.mInstanceCount);
+           geomStateInfo[i].second.mInstanceCount,
+           geomStateInfo[i].second.mVertexBytesCopied);
     }
 
     StatsTable<2> summaryTable("Geometry Statistics Summary");
@@ -1073,6 +1163,8 @@ RenderStats::logGeometryUsage(const geom::GeometryStatistics& totalGeomStatistic
         totalGeomStatistics.mCVCount);
     summaryTable.emplace_back("Total Instance Count",
         totalGeomStatistics.mInstanceCount);
+    summaryTable.emplace_back("Total Vertex Bytes Copied",
+        totalGeomStatistics.mVertexBytesCopied);
 
     auto writeCSV = [&](std::ostream& outs, bool athenaFormat) {
         outs.precision(2);
@@ -1136,6 +1228,23 @@ RenderStats::logTopTessellationStats()
         tsFormat.set().precision(5);
         writeCSVTable(mCSVStream, tsMemoryUsedTableInfo, false /* not athena */, tsFormat);
     }
+
+    const auto dispTableInfo = buildDisplacementStatistics(maxEntry);
+
+    if (getLogInfo()) {
+        auto tsFormat = getHumanColumnFlags(mInfoStream, dispTableInfo);
+        tsFormat.set(0).left();
+        tsFormat.set(1).left();
+        tsFormat.set(2).precision(3);
+        tsFormat.set(2).right();
+        writeInfoTable(mInfoStream, getPrependString(), dispTableInfo, tsFormat);
+    }
+    if (getLogCsv()) {
+        auto tsFormat = getCSVFlags(mCSVStream, dispTableInfo);
+        tsFormat.set().setf(std::ios::fixed, std:: ios::floatfield);
+        tsFormat.set().precision(5);
+        writeCSVTable(mCSVStream, dispTableInfo, false /* not athena */, tsFormat);
+    }
 }
 
 void
@@ -1168,6 +1277,14 @@ RenderStats::logAllTessellationStats()
             table.emplace_back(obj.first->getRdlGeometry()->getName(), obj.first->getName(), bytes(obj.second));
         }
 
+        auto tsFormat = getCSVFlags(mAthenaStream, table);
+        tsFormat.set().setf(std::ios::fixed, std:: ios::floatfield);
+        tsFormat.set().precision(5);
+        writeCSVTable(mAthenaStream, table, true, tsFormat);
+    }
+    {
+        const auto table = buildDisplacementStatistics(mPerPrimitiveDisplacementStats.size());
+
         auto tsFormat = getCSVFlags(mAthenaStream, table);
         tsFormat.set().setf(std::ios::fixed, std:: ios::floatfield);
         tsFormat.set().precision(5);
@@ -1184,6 +1301,8 @@ RenderStats::updateAndLogRenderPrepStats(std::ostream& outs, OutputFormat format
 
     StatsTable<2> table(header);
     table.emplace_back("Loading scene", moonray_stats::time(mLoadSceneTime.getSum()));
+    table.emplace_back("  Reading scene files", moonray_stats::time(mLoadSceneReadTime.getSum()));
+    table.emplace_back("  Decoding scene files", moonray_stats::time(mLoadSceneDecodeTime.getSum()));
     table.emplace_back("Initialize renderer", moonray_stats::time(mLoadPbrTime.getSum() + mBuildPrimAttrTableTime.getSum()));
     table.emplace_back("Generating procedurals", moonray_stats::time(mLoadProceduralsTime.getSum()));
     table.emplace_back("Tessellation", moonray_stats::time(mTessellationTime.getSum()));
@@ -1372,7 +1491,29 @@ void RenderStats::logLightStats(const pbr::Statistics& pbrStats, const pbr::Scen
     // By efficiency (% samples used)
     sortAndPrintLights(pbrStats, lightStats, topLightsTable2, numLights, totalTime,
             [](const LightStat& a, const LightStat& b) { return a.efficiency < b.efficiency; });
-    
+
+    // Shadow rays skipped by the shadow ray roulette, scalar mode only
+    StatsTable<3> culledLightsTable("Top 10 Lights: By Culled Shadow Rays", "Light Name", "Culled",
+                                    "\% of samples");
+    {
+        std::vector<std::pair<uint32_t, int>> culled;
+        for (int i = 0; i < static_cast<int>(pbrStats.mCulledShadowRays.size()); ++i) {
+            if (pbrStats.mCulledShadowRays[i] > 0) {
+                culled.emplace_back(pbrStats.mCulledShadowRays[i], i);
+            }
+        }
+        std::sort(culled.begin(), culled.end(), std::greater<std::pair<uint32_t, int>>());
+        for (size_t i = 0; i < culled.size() && i < static_cast<size_t>(numLights); ++i) {
+            const int lightIdx = culled[i].second;
+            const uint32_t lightSamples = pbrStats.mLightSamples[lightIdx];
+            culledLightsTable.emplace_back(
+                scene->getLight(lightIdx)->getRdlLight()->get(scene_rdl2::rdl2::Light::sLabel),
+                culled[i].first,
+                percentage(lightSamples > 0 ? culled[i].first / static_cast<double>(lightSamples) : 0.0));
+        }
+    }
+    const bool hasCulledLights = culledLightsTable.getNumRows() > 0;
+
     // ------------------------------ Output log info ---------------------------------------
 
     auto writeCSV = [&](std::ostream& outs, bool athenaFormat) {
@@ -1384,6 +1525,9 @@ void RenderStats::logLightStats(const pbr::Statistics& pbrStats, const pbr::Scen
         }
         writeCSVTable(outs, topLightsTable1, athenaFormat);
         writeCSVTable(outs, topLightsTable2, athenaFormat);
+        if (hasCulledLights) {
+            writeCSVTable(outs, culledLightsTable, athenaFormat);
+        }
     };
 
     if (getLogAthena()) {
@@ -1414,9 +1558,124 @@ void RenderStats::logLightStats(const pbr::Statistics& pbrStats, const pbr::Scen
         writeInfoTable(mInfoStream, pre, topLightsTable1, fmt);
         logInfoEmptyLine();
         writeInfoTable(mInfoStream, pre, topLightsTable2, fmt);
+        if (hasCulledLights) {
+            logInfoEmptyLine();
+            writeInfoTable(mInfoStream, pre, culledLightsTable, getHumanColumnFlags(mInfoStream, culledLightsTable));
+        }
+    }
+}
+
+
+void
+RenderStats::logCostAttributionStats(const pbr::Statistics& pbrStats, const pbr::Scene* scene)
+{
+    updateToMostRecentTicksPerSecond();
+    const unsigned numThreads = mcrt_common::getNumTBBThreads();
+    const size_t maxEntries = 10;
+
+    // Per light: time of the shadow rays toward the light, next to its sampling time.
+    struct LightCost {
+        std::string label;
+        double occlusionTime;
+        double samplingTime;
+    };
+    std::vector<LightCost> lightCosts;
+    double totalOcclusionTime = 0.0;
+    for (int i = 0; i < scene->getLightCount(); ++i) {
+        if (static_cast<size_t>(i) >= pbrStats.mLightOcclusionTime.size() ||
+            pbrStats.mLightOcclusionTime[i].getCount() == 0) {
+            continue;
+        }
+        LightCost cost;
+        cost.label = scene->getLight(i)->getRdlLight()->get(scene_rdl2::rdl2::Light::sLabel);
+        cost.occlusionTime = pbrStats.mLightOcclusionTime[i].getSum() / numThreads;
+        cost.samplingTime = pbrStats.mLightSamplingTime[i].getSum() / numThreads;
+        totalOcclusionTime += cost.occlusionTime;
+        lightCosts.push_back(cost);
+    }
+    std::sort(lightCosts.begin(), lightCosts.end(),
+              [](const LightCost& a, const LightCost& b) { return a.occlusionTime > b.occlusionTime; });
+
+    StatsTable<4> topLightsTable("Top 10 Lights: By Shadow Ray Time", "Light Name", "Shadow (s)",
+                                 "\% of shadow", "Sampling (s)");
+    for (size_t i = 0; i < std::min(maxEntries, lightCosts.size()); ++i) {
+        const LightCost& cost = lightCosts[i];
+        topLightsTable.emplace_back(cost.label, cost.occlusionTime,
+                                    percentage(totalOcclusionTime > 0.0 ? cost.occlusionTime / totalOcclusionTime : 0.0),
+                                    cost.samplingTime);
+    }
+
+    // Per material: inclusive shading time, which counts the maps it evaluates, plus the
+    // time of the shadow rays cast from its shading points.
+    struct MaterialCost {
+        std::string name;
+        double shadingTime;
+        double occlusionTime;
+    };
+    std::vector<MaterialCost> materialCosts;
+    for (const auto& entry : mShaderCallStats) {
+        if (!entry.first->isA<scene_rdl2::rdl2::Material>()) {
+            continue;
+        }
+        MaterialCost cost;
+        cost.name = entry.first->getName();
+        cost.shadingTime = ticksToSec(entry.second.getInclusiveSum(), numThreads);
+        const auto it = mMaterialOcclusionTime.find(entry.first);
+        cost.occlusionTime = (it != mMaterialOcclusionTime.end()) ? it->second.getSum() / numThreads : 0.0;
+        if (cost.shadingTime + cost.occlusionTime > 0.0) {
+            materialCosts.push_back(cost);
+        }
+    }
+    std::sort(materialCosts.begin(), materialCosts.end(),
+              [](const MaterialCost& a, const MaterialCost& b) {
+                  return a.shadingTime + a.occlusionTime > b.shadingTime + b.occlusionTime;
+              });
+
+    StatsTable<4> topMaterialsTable("Top 10 Materials: By Shading + Shadow Ray Time", "Material Name",
+                                    "Total (s)", "Shading (s)", "Shadow (s)");
+    for (size_t i = 0; i < std::min(maxEntries, materialCosts.size()); ++i) {
+        const MaterialCost& cost = materialCosts[i];
+        topMaterialsTable.emplace_back(cost.name, cost.shadingTime + cost.occlusionTime,
+                                       cost.shadingTime, cost.occlusionTime);
+    }
+
+    auto writeCSV = [&](std::ostream& outs, bool athenaFormat) {
+        outs.precision(2);
+        outs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        writeCSVTable(outs, topLightsTable, athenaFormat);
+        writeCSVTable(outs, topMaterialsTable, athenaFormat);
+    };
+
+    if (getLogAthena()) {
+        writeCSV(mAthenaStream, true);
+    }
+    if (getLogCsv()) {
+        writeCSV(mCSVStream, false);
+    }
+
+    if (getLogInfo()) {
+        mInfoStream.setf(std::ios::fixed, std:: ios::floatfield);
+        mInfoStream.precision(2);
+
+        auto fmt = getHumanColumnFlags(mInfoStream, topLightsTable);
+        for (int col = 0; col < 4; ++col) {
+            fmt.set(col).left();
+            if (col == 0) fmt.set(col).width(30);
+            else fmt.set(col).width(12);
+        }
+        const std::string pre = getPrependString();
+        writeInfoTable(mInfoStream, pre, topLightsTable, fmt);
+        logInfoEmptyLine();
+        writeInfoTable(mInfoStream, pre, topMaterialsTable, fmt);
     }
 }
 
+unsigned
+RenderStats::snapshotAccumulators(std::vector<mcrt_common::AccumulatorResult> *results)
+{
+    updateToMostRecentTicksPerSecond();
+    return mcrt_common::snapshotAccumulators(results, mInvTicksPerSecond, 0.f);
+}
 
 void
 RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::internal::Statistics& geomStats)
@@ -1432,6 +1691,8 @@ RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::inter
     const size_t bundledGPUIsectRays = pbrStats.getCounter(pbr::STATS_BUNDLED_GPU_INTERSECTION_RAYS);
 
     const size_t presenceShadowRays = pbrStats.getCounter(pbr::STATS_PRESENCE_SHADOW_RAYS);
+    const size_t presenceCacheHits = geomStats.getCounter(geom::internal::STATS_PRESENCE_CACHE_HITS);
+    const size_t presenceCacheMisses = geomStats.getCounter(geom::internal::STATS_PRESENCE_CACHE_MISSES);
 
     const size_t occlRays = pbrStats.getCounter(pbr::STATS_OCCLUSION_RAYS);
     const size_t bundledOcclRays = pbrStats.getCounter(pbr::STATS_BUNDLED_OCCLUSION_RAYS);
@@ -1446,6 +1707,11 @@ RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::inter
     const size_t emissionGridSampls = geomStats.getCounter(geom::internal::STATS_EMISSION_GRID_SAMPLES);
     const size_t colorGridSampls = geomStats.getCounter(geom::internal::STATS_COLOR_GRID_SAMPLES);
     const size_t bakedDensityGridSampls = geomStats.getCounter(geom::internal::STATS_BAKED_DENSITY_GRID_SAMPLES);
+    const size_t volumeShaderCacheHits = geomStats.getCounter(geom::internal::STATS_VOLUME_SHADER_CACHE_HITS);
+    const size_t volumeShaderCacheMisses = geomStats.getCounter(geom::internal::STATS_VOLUME_SHADER_CACHE_MISSES);
+
+    const size_t volumeTrSegments = pbrStats.getCounter(pbr::STATS_VOLUME_TRANSMITTANCE_SEGMENTS);
+    const size_t volumeTrLookups = pbrStats.getCounter(pbr::STATS_VOLUME_TRANSMITTANCE_LOOKUPS);
 
     StatsTable<2> table("Sampling Statistics");
     table.emplace_back("Pixel samples", pixelSamples);
@@ -1453,21 +1719,49 @@ RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::inter
     table.emplace_back("Bsdf samples", bsdfSamples);
     table.emplace_back("Bssrdf samples", bssrdfSamples);
     table.emplace_back("Total samples", totalSamples);
+    const size_t scalarPathBounces = pbrStats.getCounter(pbr::STATS_SCALAR_PATH_BOUNCES);
+    if (scalarPathBounces > 0 && pixelSamples > 0) {
+        table.emplace_back("Average scalar path depth",
+            static_cast<double>(scalarPathBounces) / static_cast<double>(pixelSamples));
+    }
 
     table.emplace_back("Intersection rays", isectRays);
     table.emplace_back("Bundled intersection rays", bundledIsectRays);
     const double gpuIntersectionUtilization = (bundledIsectRays > 0) ?
         static_cast<double>(bundledGPUIsectRays) / static_cast<double>(bundledIsectRays) : 0.0;
     table.emplace_back("GPU bundled intersection ray utilization", percentage(gpuIntersectionUtilization));
+    const size_t sortedIsectRays = pbrStats.getCounter(pbr::STATS_SORTED_INTERSECTION_RAYS);
+    if (sortedIsectRays > 0) {
+        const size_t sortedIsectRayRuns = pbrStats.getCounter(pbr::STATS_SORTED_INTERSECTION_RAY_RUNS);
+        table.emplace_back("Sorted intersection rays", sortedIsectRays);
+        table.emplace_back("Sorted intersection rays per octant run",
+            static_cast<double>(sortedIsectRays) / static_cast<double>(std::max(sortedIsectRayRuns, size_t(1))));
+    }
 
     table.emplace_back("Presence shadow rays", presenceShadowRays);
+    table.emplace_back("Presence cache hits", presenceCacheHits);
+    table.emplace_back("Presence cache misses", presenceCacheMisses);
 
     table.emplace_back("Occlusion rays", occlRays);
+    table.emplace_back("Culled shadow rays", pbrStats.getCounter(pbr::STATS_CULLED_SHADOW_RAYS));
     table.emplace_back("Bundled occlusion rays", bundledOcclRays);
     const double gpuOcclusionUtilization = (bundledOcclRays > 0) ?
         static_cast<double>(bundledGPUOcclRays) / static_cast<double>(bundledOcclRays) : 0.0;
     table.emplace_back("GPU bundled occlusion ray utilization", percentage(gpuOcclusionUtilization));
 
+    if (pbrStats.mGPUBusyTime > 0.0) {
+        table.emplace_back("GPU busy time", moonray_stats::time(pbrStats.mGPUBusyTime));
+        table.emplace_back("GPU busy utilization", percentage(pbrStats.mGPUBusyTime / pbrStats.mMcrtTime));
+        for (size_t i = 0; i < pbrStats.mGPUDeviceRays.size(); ++i) {
+            const std::string device = "GPU " + std::to_string(i);
+            const double busyTime = pbrStats.mGPUDeviceBusyTime[i];
+            const double raysPerSecond = (busyTime > 0.0) ? pbrStats.mGPUDeviceRays[i] / busyTime : 0.0;
+            table.emplace_back(device + " rays", pbrStats.mGPUDeviceRays[i]);
+            table.emplace_back(device + " busy utilization", percentage(busyTime / pbrStats.mMcrtTime));
+            table.emplace_back(device + " million rays/busy sec", raysPerSecond / 1000000.0);
+        }
+    }
+
     table.emplace_back("Total rays", totalRays);
 
     table.emplace_back("Shader evals", shaderEvals);
@@ -1477,6 +1771,44 @@ RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::inter
     table.emplace_back("Emission grid samples", emissionGridSampls);
     table.emplace_back("Color grid samples", colorGridSampls);
     table.emplace_back("BakedDensity grid samples", bakedDensityGridSampls);
+    table.emplace_back("Volume shader cache hits", volumeShaderCacheHits);
+    table.emplace_back("Volume shader cache misses", volumeShaderCacheMisses);
+
+    table.emplace_back("Volume transmittance segments", volumeTrSegments);
+    table.emplace_back("Volume transmittance lookups", volumeTrLookups);
+    const double lookupsPerSegment = (volumeTrSegments > 0) ?
+        static_cast<double>(volumeTrLookups) / static_cast<double>(volumeTrSegments) : 0.0;
+    table.emplace_back("Volume transmittance lookups per segment", lookupsPerSegment);
+
+    const size_t volumeIntervalRays = pbrStats.getCounter(pbr::STATS_VOLUME_INTERVAL_RAYS);
+    const size_t volumeIntervals = pbrStats.getCounter(pbr::STATS_VOLUME_INTERVALS);
+    table.emplace_back("Volume interval rays", volumeIntervalRays);
+    table.emplace_back("Volume intervals", volumeIntervals);
+    const double intervalsPerRay = (volumeIntervalRays > 0) ?
+        static_cast<double>(volumeIntervals) / static_cast<double>(volumeIntervalRays) : 0.0;
+    table.emplace_back("Volume intervals per ray", intervalsPerRay);
+    table.emplace_back("Volume interval sorts", pbrStats.getCounter(pbr::STATS_VOLUME_INTERVAL_SORTS));
+
+    // Only counted with -tlb_stats, and only where perf events are available.
+    const size_t dtlbAccesses = pbrStats.getCounter(pbr::STATS_DTLB_LOAD_ACCESSES);
+    const size_t dtlbMisses = pbrStats.getCounter(pbr::STATS_DTLB_LOAD_MISSES);
+    if (dtlbMisses > 0) {
+        table.emplace_back("dTLB load misses", dtlbMisses);
+        if (dtlbAccesses > 0) {
+            table.emplace_back("dTLB load miss rate",
+                               percentage(static_cast<double>(dtlbMisses) / static_cast<double>(dtlbAccesses)));
+        }
+        if (pixelSamples > 0) {
+            table.emplace_back("dTLB load misses per pixel sample",
+                               static_cast<double>(dtlbMisses) / static_cast<double>(pixelSamples));
+        }
+    }
+
+    // Only measured in scalar mode.
+    if (pbrStats.mPathArenaPeakBytes > 0) {
+        table.emplace_back("Path arena peak per thread", bytes(pbrStats.mPathArenaPeakBytes));
+        table.emplace_back("Path arena unmeasured bounces", pbrStats.mPathArenaUnmeasuredBounces);
+    }
 
     // We want all of the rows below to be right justified in human readable
     // format.
@@ -1503,6 +1835,8 @@ RenderStats::logSamplingStats(const pbr::Statistics& pbrStats, const geom::inter
     table.emplace_back("Bsdf SIMD utilization", percentage(bsdfSimdUtilization));
     table.emplace_back("Bssrdf SIMD utilization", percentage(bssrdfSimdUtilization));
 
+    ADD_LANE_UTILIZATION(table, pbrStats, pbr::STATS_VEC_SHADE);
+
     ADD_LANE_UTILIZATION(table, pbrStats, pbr::STATS_VEC_BSDF_LOBES);
     ADD_LANE_UTILIZATION(table, pbrStats, pbr::STATS_VEC_BSDF_LOBE_SAMPLES_PRE);
     ADD_LANE_UTILIZATION(table, pbrStats, pbr::STATS_VEC_BSDF_LOBE_SAMPLES_POST);
@@ -1579,6 +1913,53 @@ RenderStats::logTexturingStats(texture::TextureSampler& texturesampler, bool ver
     if (getLogInfo()) {
         texturesampler.getStatistics(getPrependString(), mInfoStream, verbose);
         texturesampler.getMainCacheInfo(getPrependString(), mInfoStream);
+        texturesampler.getCacheAnalysis(getPrependString(), mInfoStream, verbose);
+    }
+}
+
+void
+RenderStats::logVdbGridStats(const texture::VdbGridCache& gridCache)
+{
+    const std::vector<texture::VdbGridCache::GridStats> gridStats = gridCache.getStats();
+    if (gridStats.empty()) {
+        return;
+    }
+
+    StatsTable<6> gridTable("VDB Grids", "File", "Grid", "Type", "Requests", "Read (s)", "Memory");
+    size_t totalBytes = 0;
+    for (const texture::VdbGridCache::GridStats& grid : gridStats) {
+        gridTable.emplace_back(grid.mFileName, grid.mGridName, grid.mValueType, grid.mRequests,
+                               moonray_stats::time(grid.mReadTime), bytes(grid.mMemoryBytes));
+        totalBytes += grid.mMemoryBytes;
+    }
+
+    StatsTable<2> summaryTable("VDB Grid Cache Summary");
+    summaryTable.emplace_back("Grids", gridStats.size());
+    summaryTable.emplace_back("Grid memory", bytes(totalBytes));
+
+    auto writeCSV = [&](std::ostream& outs, bool athenaFormat) {
+        outs.precision(2);
+        outs.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        writeCSVTable(outs, gridTable, athenaFormat);
+        writeEqualityCSVTable(outs, summaryTable, athenaFormat);
+    };
+
+    if (getLogAthena()) {
+        writeCSV(mAthenaStream, true);
+    }
+    if (getLogCsv()) {
+        writeCSV(mCSVStream, false);
+    }
+    if (getLogInfo()) {
+        mInfoStream.precision(2);
+        mInfoStream.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        auto fmt = getHumanColumnFlags(mInfoStream, gridTable);
+        fmt.set(0).left();
+        fmt.set(1).left();
+        fmt.set(2).left();
+        const std::string pre = getPrependString();
+        writeInfoTable(mInfoStream, pre, gridTable, fmt);
+        writeEqualityInfoTable(mInfoStream, pre, summaryTable);
     }
 }
 
@@ -1662,6 +2043,34 @@ RenderStats::buildTessellationMemoryUsedStatistics(std::size_t maxEntry)
     return table;
 }
 
+moonray_stats::StatsTable<5>
+RenderStats::buildDisplacementStatistics(std::size_t maxEntry)
+{
+    using DispStat = std::pair<geom::internal::NamedPrimitive*, geom::internal::DisplacementStats>;
+
+    auto first = mPerPrimitiveDisplacementStats.begin();
+    auto last = mPerPrimitiveDisplacementStats.end();
+    std::tie(first, last) = getRelevantStats(first, last,
+            [](const DispStat& ds) { return ds.second.mEvalCount > 0; },
+            [=](const DispStat& s1, const DispStat& s2)
+            {
+                return s1.second.mTime > s2.second.mTime;
+            },
+            maxEntry);
+
+    moonray_stats::StatsTable<5> table("Displacement time", "Rdl Geometry", "part name", "time",
+                                       "evaluations", "reused motion steps");
+
+    for (auto it = first; it != last; ++it) {
+        const auto& obj = *it;
+        table.emplace_back(obj.first->getRdlGeometry()->getName(), obj.first->getName(),
+                           moonray_stats::time(obj.second.mTime),
+                           obj.second.mEvalCount, obj.second.mReusedCount);
+    }
+
+    return table;
+}
+
 // This function WILL modify the ShaderStat vector.
 RenderStats::ShaderStatsTable RenderStats::buildShaderStatistics(std::vector<ShaderStat>::iterator first,
                                                                  std::vector<ShaderStat>::iterator last,
@@ -1802,7 +2211,9 @@ RenderStats::logRenderingStats(const pbr::Statistics& pbrStats,
     // Accumulator stats:
     //
     using AccumulatorTable = StatsTable<3>;
-    AccumulatorTable accumulatorTable("MCRT Time Breakdown", "Name", "Avg Time per Thread (s)", "Percentage of Total");
+    AccumulatorTable accumulatorTable(mcrt_common::getExclusiveAccumulatorSamplingInterval() ?
+                                      "MCRT Time Breakdown (sampled)" : "MCRT Time Breakdown",
+                                      "Name", "Avg Time per Thread (s)", "Percentage of Total");
 
     std::vector<mcrt_common::AccumulatorResult> accStats;
     const unsigned numAccumulators = mcrt_common::snapshotAccumulators(&accStats,
@@ -1831,6 +2242,22 @@ RenderStats::logRenderingStats(const pbr::Statistics& pbrStats,
                                       moonray_stats::percentage(stat.mPercentageOfTotal/100.0));
     }
 
+    // SIMD lane utilization of the vectorized code timed by the accumulators
+    // above. Only accumulators which recorded lane counts are listed.
+    AccumulatorTable laneTable("MCRT Lane Utilization", "Name", "Active Lanes", "Lane Utilization");
+    bool hasLaneStats = false;
+    for (unsigned i = 0; i < numAccumulators; ++i) {
+        const auto &stat = accStats[i];
+        if (stat.mTotalLanes == 0) {
+            continue;
+        }
+
+        const double utilization = static_cast<double>(stat.mActiveLanes) /
+                                   static_cast<double>(stat.mTotalLanes);
+        laneTable.emplace_back(stat.mName, stat.mActiveLanes, moonray_stats::percentage(utilization));
+        hasLaneStats = true;
+    }
+
     const moonray::rndr::Film &film = rndr::getRenderDriver()->getFilm();
     double proportionOfPixelsAtAdaptiveMax;
     double avgSamplesPerPixel;
@@ -1865,15 +2292,54 @@ RenderStats::logRenderingStats(const pbr::Statistics& pbrStats,
     renderingStatsTable.emplace_back("Total efficiency", percentage((sysTimeSecs + userTimeSecs) / (processTime * numThreads)));
     if (film.isAdaptive()) {
         renderingStatsTable.emplace_back("Pixels at max adaptive samples", percentage(proportionOfPixelsAtAdaptiveMax));
+
+        // Wall clock time of the adaptive bookkeeping, summed over all the regions. Each region update runs on one
+        // thread (pixel errors may use more) while the other threads keep rendering.
+        unsigned adaptiveUpdateTotal;
+        double adaptivePixelErrorSec, adaptiveTreeBuildSec;
+        film.getAdaptiveRegions().getUpdateStats(adaptiveUpdateTotal, adaptivePixelErrorSec, adaptiveTreeBuildSec);
+        renderingStatsTable.emplace_back("Adaptive tree updates", adaptiveUpdateTotal);
+        renderingStatsTable.emplace_back("Adaptive pixel error time", moonray_stats::time(adaptivePixelErrorSec));
+        renderingStatsTable.emplace_back("Adaptive tree build time", moonray_stats::time(adaptiveTreeBuildSec));
+        renderingStatsTable.emplace_back("Adaptive % of Mcrt time",
+                                         percentage((adaptivePixelErrorSec + adaptiveTreeBuildSec) /
+                                                    (pbrStats.mMcrtTime * numThreads)));
+
+        // Extrapolated from the decay of the adaptive error over the render time.
+        const AdaptiveConvergenceEstimator &convergence = rndr::getRenderDriver()->getAdaptiveConvergence();
+        if (convergence.hasPrediction()) {
+            renderingStatsTable.emplace_back("Adaptive error decay exponent", convergence.getDecayExponent());
+            renderingStatsTable.emplace_back("Adaptive error gain per minute",
+                                             percentage(convergence.getErrorGainPerMinute()));
+            if (std::isfinite(convergence.getPredictedSecToTarget())) {
+                renderingStatsTable.emplace_back("Adaptive predicted time to target",
+                                                 moonray_stats::time(convergence.getPredictedSecToTarget()));
+            }
+            renderingStatsTable.emplace_back("Adaptive stopped before target",
+                                             convergence.shouldStop() ? "yes" : "no");
+        }
+    }
+    if (rndr::getRenderDriver()->getFrameState().mUniformTileEarlyExitSamples) {
+        const TileWorkQueue &workQueue = rndr::getRenderDriver()->getTileWorkQueue();
+        renderingStatsTable.emplace_back("Uniform tiles retired", workQueue.getNumRetiredTiles());
+        renderingStatsTable.emplace_back("Uniform tile passes skipped", workQueue.getNumSkippedTiles());
     }
     renderingStatsTable.emplace_back("Render stats read disk I/O", bytes(mProcessStats.getBytesRead()));
     renderingStatsTable.emplace_back("Normalized sample cost", sampleCost);
+    if (vars.get(scene_rdl2::rdl2::SceneVariables::sPathGuideEnable)) {
+        renderingStatsTable.addSeparator();
+        renderingStatsTable.emplace_back("Path guide samples recorded", pbrStats.mPathGuideSamplesRecorded);
+        renderingStatsTable.emplace_back("Path guide merge time", moonray_stats::time(pbrStats.mPathGuideMergeTime));
+    }
 
     if (csvStream) {
         outs.setf(std::ios::fixed, std:: ios::floatfield);
         outs.precision(5);
         writeEqualityCSVTable(outs, totalTimeTable, format == OutputFormat::athenaCSV);
         writeCSVTable(outs, accumulatorTable, format == OutputFormat::athenaCSV);
+        if (hasLaneStats) {
+            writeCSVTable(outs, laneTable, format == OutputFormat::athenaCSV);
+        }
         writeEqualityCSVTable(outs, renderingStatsTable, format == OutputFormat::athenaCSV);
     } else {
         const std::string prepend = getPrependString();
@@ -1888,6 +2354,12 @@ RenderStats::logRenderingStats(const pbr::Statistics& pbrStats,
         logInfoEmptyLine();
         writeInfoTable(outs, prepend, accumulatorTable, accumFormat);
         logInfoEmptyLine();
+        if (hasLaneStats) {
+            auto laneFormat = getHumanColumnFlags(outs, laneTable);
+            laneFormat.set(0).left();
+            writeInfoTable(outs, prepend, laneTable, laneFormat);
+            logInfoEmptyLine();
+        }
         writeEqualityInfoTable(outs, prepend, renderingStatsTable);
     }
 }
@@ -1912,6 +2384,28 @@ RenderStats::logDsoUsage(const std::unordered_map<std::string, size_t>& dsoCount
     logInfoEmptyLine();
 }
 
+void
+RenderStats::logImageWriteStats() const
+{
+    const ImageWriteDriver::FileWriteTimeTable table = ImageWriteDriver::get()->getFileWriteTimeTable();
+    if (table.empty()) {
+        return;
+    }
+
+    logInfoEmptyLine();
+    logInfoString(std::string("---------- Image Write ----------"));
+    for (const ImageWriteDriver::FileWriteTime& item : table) {
+        std::ostringstream oss;
+        oss << item.mFilename
+            << "  writes:" << item.mWriteTotal
+            << "  total:" << timeIntervalFormat(item.mTotalSec)
+            << "  average:" << timeIntervalFormat(item.mTotalSec / item.mWriteTotal)
+            << "  max:" << timeIntervalFormat(item.mMaxSec);
+        logInfoString(oss.str());
+    }
+    logInfoEmptyLine();
+}
+
 void
 RenderStats::logRenderingStats(const pbr::Statistics& pbrStats,
                                mcrt_common::ExecutionMode executionMode,
@@ -2016,6 +2510,13 @@ RenderStats::logLoadingScene(std::stringstream &initMessages, const std::string&
     initMessages << "Loading Scene File: " << sceneFile << '\n';
 }
 
+void
+RenderStats::logLoadedScene(std::stringstream &initMessages, size_t bytes, double readTime, double decodeTime)
+{
+    initMessages << "    " << bytes / (1024 * 1024) << " MB, read " << readTime
+                 << " s, decoded " << decodeTime << " s\n";
+}
+
 void
 RenderStats::logLoadingSceneUpdates(std::stringstream *initMessages, const std::string& sceneClass, const std::string& name)
 {
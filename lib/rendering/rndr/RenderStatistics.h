@@ -11,6 +11,7 @@
 #include <moonray/rendering/rndr/statistics/AthenaCSVStream.h>
 #include <moonray/common/mcrt_util/Average.h>
 #include <moonray/common/mcrt_util/ProcessStats.h>
+#include <moonray/rendering/geom/prim/DisplacementStats.h>
 #include <moonray/statistics/StatsTable.h>
 
 #include <scene_rdl2/common/rec_time/RecTime.h>
@@ -26,12 +27,16 @@
 
 
 namespace moonray {
+namespace mcrt_common {
+struct AccumulatorResult;
+}
 namespace pbr {
 class Scene;
 class Statistics;
 }
 namespace texture {
 class TextureSampler;
+class VdbGridCache;
 }
 
 namespace geom {
@@ -100,6 +105,13 @@ public:
     // Called when render prep start
     void startRenderPrep();
 
+    // gross render prep time of the last render prep, in seconds
+    double getTotalRenderPrepTime() const { return mTotalRenderPrepTime; }
+
+    // snapshot of all the profile accumulators of the last frame, as listed
+    // in the "MCRT Time Breakdown" table, see mcrt_common::snapshotAccumulators()
+    unsigned snapshotAccumulators(std::vector<mcrt_common::AccumulatorResult> *results);
+
     //  report the first line in the log
     void logInfoPrependStringHeader() const;
 
@@ -136,9 +148,17 @@ public:
                               size_t rayStatePoolBytes,
                               size_t cacheLine1PoolBytes);
 
+    // Per frame high water marks of the growable RayState and CL1 pools against
+    // the memory reserved for them.
+    void logPoolHighWater(size_t rayStatePoolBytes,
+                          size_t rayStatePoolReservedBytes,
+                          size_t cacheLine1PoolBytes,
+                          size_t cacheLine1PoolReservedBytes);
+
     void logXPUMemoryUsage(size_t rayQueueBytes,
                            size_t occlusionQueueBytes,
-                           size_t cpuMemoryBytes);
+                           size_t cpuMemoryBytes,
+                           const std::vector<size_t>& gpuMemoryBytes);
 
     //  report out the memory footprint in megabyte
     //  includes total memory for all geometry objects,
@@ -172,6 +192,10 @@ public:
     void logLightStats(const pbr::Statistics& pbrStats, const pbr::Scene* scene, 
                        const scene_rdl2::rdl2::SceneVariables& sceneVars);
 
+    // log the top ten lights by shadow ray time and the top ten materials by
+    // shading plus shadow ray time, with cost attribution on
+    void logCostAttributionStats(const pbr::Statistics& pbrStats, const pbr::Scene* scene);
+
     //  log post frame sampling stats
     void logSamplingStats(const pbr::Statistics& pbrStats,
                           const geom::internal::Statistics& geomStats);
@@ -182,6 +206,9 @@ public:
     // completeness .
     void logTexturingStats(texture::TextureSampler& texturesampler, bool verbose);
 
+    // log the grids held by the VDB grid cache, with their memory
+    void logVdbGridStats(const texture::VdbGridCache& gridCache);
+
     //  log the post frame render stats
     void logRenderingStats(const pbr::Statistics& renderstats,
                            mcrt_common::ExecutionMode executionMode,
@@ -190,6 +217,9 @@ public:
     // log the count of each dso used
     void logDsoUsage(const std::unordered_map<std::string, size_t>& dsoCounts) const;
 
+    // log the write time of each output image file, checkpoint and final
+    void logImageWriteStats() const;
+
     //  log the current date and time
     void logCurrentDateTime(std::stringstream &initMessages);
 
@@ -199,6 +229,9 @@ public:
     //  log the scene file names
     void logLoadingScene(std::stringstream &initMessages, const std::string& sceneFile);
 
+    //  log the size, read and decode times of a loaded binary scene file
+    void logLoadedScene(std::stringstream &initMessages, size_t bytes, double readTime, double decodeTime);
+
     //  log the scene file class names
     void logLoadingSceneUpdates(std::stringstream *initMessages, const std::string& sceneClass, const std::string& name);
 
@@ -298,6 +331,8 @@ public:
 
     // stats are public for ease of access
     moonray::util::AverageDouble mLoadSceneTime;
+    moonray::util::AverageDouble mLoadSceneReadTime;    // waiting on scene file reads, part of mLoadSceneTime
+    moonray::util::AverageDouble mLoadSceneDecodeTime;  // parsing scene files, part of mLoadSceneTime
     moonray::util::AverageDouble mLoadPbrTime;
     moonray::util::AverageDouble mBuildPrimAttrTableTime;
     moonray::util::AverageDouble mLoadProceduralsTime;
@@ -319,9 +354,15 @@ public:
     // tessellation memory usage stats
     std::vector<std::pair<geom::internal::NamedPrimitive*, size_t> > mPerPrimitiveTessellationMemoryUsed;
 
+    // displacement stats, part of the tessellation
+    std::vector<std::pair<geom::internal::NamedPrimitive*, geom::internal::DisplacementStats> > mPerPrimitiveDisplacementStats;
+
     // shader call stats
     std::unordered_map<scene_rdl2::rdl2::SceneObject *, moonray::util::InclusiveExclusiveAverage<int64> > mShaderCallStats;
 
+    // shadow ray time per material, with cost attribution on
+    std::unordered_map<scene_rdl2::rdl2::SceneObject *, moonray::util::AverageDouble> mMaterialOcclusionTime;
+
     size_t mLightBVHMemoryFootprint;
 
 private:
@@ -345,6 +386,7 @@ private:
 
     moonray_stats::StatsTable<3> buildTessellationTimeStatistics(std::size_t maxEntry);
     moonray_stats::StatsTable<3> buildTessellationMemoryUsedStatistics(std::size_t maxEntry);
+    moonray_stats::StatsTable<5> buildDisplacementStatistics(std::size_t maxEntry);
 
     // This function WILL modify the ShaderStat vector.
     ShaderStatsTable buildShaderStatistics(std::vector<ShaderStat>::iterator first,
@@ -554,6 +596,10 @@ struct RealtimeFrameStats
     // The measured average cost of non active duration of each render thread.
     double      mOverheadDuration;
 
+    // Time held back from the render budget by the RealtimeFrameController to
+    // absorb the overrun of the recent frames.
+    double      mTimeMargin;
+
     // The number of passes we ended up rendering (including the "first" pass).
     unsigned    mNumRenderPasses;
 
@@ -0,0 +1,214 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+
+#include <scene_rdl2/common/fb_util/PixelBuffer.h>
+#include <scene_rdl2/common/math/Math.h>
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace moonray {
+namespace rndr {
+
+//
+// Thread owned accumulation of the samples of a single 8x8 tile.
+//
+// Scalar render threads normally add the samples of each pixel straight to the Film
+// buffers with one atomic operation per float, since a tile may be handed to more
+// than one thread at a time (see TileWorkQueue). A TileAccumulator lets the thread
+// gather the samples of the tile it is rendering instead, Film::addTileSamples()
+// then adds the whole tile under that tile's lock with plain arithmetic.
+//
+// With pixel filter splatting, each sample is also spread over the pixels of the filter
+// footprint. Those land in a block covering the tile plus a guard band of getGuardBand()
+// pixels on each side, Film::addTileSamples() adds the guard band to the neighboring
+// tiles under their own locks.
+//
+// Each render thread owns at most one TileAccumulator at a time, so the extra memory
+// is bounded by numRenderThreads * getMemoryUsage(aovNumFloats, guardBand).
+//
+class TileAccumulator
+{
+public:
+    // Wider filters don't splat, the guard band would outgrow the tile.
+    static constexpr unsigned sMaxGuardBand = 4;
+
+    // aovs has to hold 64 * aovNumFloats floats, it's unused when aovNumFloats is 0.
+    // splatColors and splatWeights have to hold getNumSplatPixels(guardBand) entries if
+    // the samples are splatted, both are nullptr otherwise.
+    TileAccumulator(unsigned aovNumFloats, float *aovs,
+                    unsigned guardBand = 0,
+                    scene_rdl2::fb_util::RenderColor *splatColors = nullptr,
+                    float *splatWeights = nullptr) :
+        mMinX(0),
+        mMinY(0),
+        mPixelMask(0),
+        mAovNumFloats(aovNumFloats),
+        mAovs(aovs),
+        mGuardBand(guardBand),
+        mHasSplats(false),
+        mSplatColors(splatColors),
+        mSplatWeights(splatWeights)
+    {
+        MNRY_ASSERT(!aovNumFloats || aovs);
+        MNRY_ASSERT(guardBand <= sMaxGuardBand);
+        MNRY_ASSERT(!splatColors == !splatWeights);
+        if (mSplatColors) {
+            clearSplats();
+        }
+    }
+
+    // Guard band needed to splat with a filter of the given radius, the sample pixel
+    // center is at most 0.5 pixel away from the sample.
+    static unsigned getGuardBand(float filterRadius)
+    {
+        return unsigned(std::max(0.f, std::ceil(filterRadius - 0.5f)));
+    }
+
+    static unsigned getSplatWidth(unsigned guardBand) { return 8 + 2 * guardBand; }
+    static unsigned getNumSplatPixels(unsigned guardBand)
+    {
+        return getSplatWidth(guardBand) * getSplatWidth(guardBand);
+    }
+
+    // Starts gathering the samples of the tile containing pixel (x, y).
+    // The accumulator has to be empty.
+    void begin(unsigned x, unsigned y)
+    {
+        MNRY_ASSERT(isEmpty());
+        mMinX = x & ~0x07u;
+        mMinY = y & ~0x07u;
+    }
+
+    // Same arguments as Film::addSamplesToRenderBuffer() and Film::addSamplesToAovBuffer(),
+    // accAovs is only read if the accumulator holds aovs.
+    // Returns false without adding anything if the pixel already holds samples, in which
+    // case the tile has to be added to the film first.
+    bool addSamples(unsigned px, unsigned py,
+                    const scene_rdl2::fb_util::RenderColor &accSamples,
+                    float numSamples,
+                    const scene_rdl2::fb_util::RenderColor *accSamplesOdd,
+                    float depth,
+                    const float *accAovs)
+    {
+        MNRY_ASSERT(px - mMinX < 8 && py - mMinY < 8);
+        const unsigned idx = ((py - mMinY) << 3) + (px - mMinX);
+        const uint64_t bit = uint64_t(1) << idx;
+        if (mPixelMask & bit) {
+            return false;
+        }
+        mPixelMask |= bit;
+
+        mColor[idx] = accSamples;
+        mColorOdd[idx] = accSamplesOdd ? *accSamplesOdd :
+                                         scene_rdl2::fb_util::RenderColor(scene_rdl2::math::zero);
+        mWeight[idx] = numSamples;
+        mDepth[idx] = depth;
+        if (mAovNumFloats) {
+            MNRY_ASSERT(accAovs);
+            std::memcpy(mAovs + idx * mAovNumFloats, accAovs, mAovNumFloats * sizeof(float));
+        }
+        return true;
+    }
+
+    // Adds sample * weightsX[i] * weightsY[j] and the weight to pixel
+    // (px - guardBand + i, py - guardBand + j), for i, j in [0, 2 * guardBand].
+    // (px, py) has to be in the current tile.
+    void splat(unsigned px, unsigned py,
+               const float *weightsX, const float *weightsY,
+               const scene_rdl2::fb_util::RenderColor &sample)
+    {
+        MNRY_ASSERT(mSplatColors);
+        MNRY_ASSERT(px - mMinX < 8 && py - mMinY < 8);
+        const unsigned width = getSplatWidth(mGuardBand);
+        const unsigned size = 2 * mGuardBand + 1;
+        for (unsigned j = 0; j < size; ++j) {
+            if (weightsY[j] == 0.f) {
+                continue;
+            }
+            // The block starts guardBand pixels before the tile.
+            const unsigned row = (py - mMinY + j) * width + (px - mMinX);
+            for (unsigned i = 0; i < size; ++i) {
+                const float weight = weightsX[i] * weightsY[j];
+                mSplatColors[row + i] += sample * weight;
+                mSplatWeights[row + i] += weight;
+            }
+        }
+        mHasSplats = true;
+    }
+
+    bool isEmpty() const { return mPixelMask == 0 && !mHasSplats; }
+    void clear()
+    {
+        mPixelMask = 0;
+        if (mHasSplats) {
+            clearSplats();
+        }
+    }
+
+    unsigned getMinX() const { return mMinX; }
+    unsigned getMinY() const { return mMinY; }
+
+    // Bit i is set if pixel (getMinX() + (i & 7), getMinY() + (i >> 3)) holds samples.
+    uint64_t getPixelMask() const { return mPixelMask; }
+
+    const scene_rdl2::fb_util::RenderColor &getColor(unsigned idx) const { return mColor[idx]; }
+    const scene_rdl2::fb_util::RenderColor &getColorOdd(unsigned idx) const { return mColorOdd[idx]; }
+    float getWeight(unsigned idx) const { return mWeight[idx]; }
+    float getDepth(unsigned idx) const { return mDepth[idx]; }
+    const float *getAovs(unsigned idx) const { return mAovNumFloats ? mAovs + idx * mAovNumFloats : nullptr; }
+
+    unsigned getGuardBand() const { return mGuardBand; }
+    bool hasSplats() const { return mHasSplats; }
+
+    // Splat block pixel idx is (getMinX() - getGuardBand() + idx % width,
+    // getMinY() - getGuardBand() + idx / width), width being getSplatWidth(getGuardBand()).
+    const scene_rdl2::fb_util::RenderColor &getSplatColor(unsigned idx) const { return mSplatColors[idx]; }
+    float getSplatWeight(unsigned idx) const { return mSplatWeights[idx]; }
+
+    static size_t getMemoryUsage(unsigned aovNumFloats, unsigned guardBand = 0, bool splat = false)
+    {
+        size_t bytes = sizeof(TileAccumulator) + 64 * aovNumFloats * sizeof(float);
+        if (splat) {
+            bytes += getNumSplatPixels(guardBand) * (sizeof(scene_rdl2::fb_util::RenderColor) + sizeof(float));
+        }
+        return bytes;
+    }
+
+private:
+    scene_rdl2::fb_util::RenderColor mColor[64];
+    scene_rdl2::fb_util::RenderColor mColorOdd[64];
+    float mWeight[64];
+    float mDepth[64];
+
+    unsigned mMinX;
+    unsigned mMinY;
+    uint64_t mPixelMask;
+
+    void clearSplats()
+    {
+        const unsigned numPixels = getNumSplatPixels(mGuardBand);
+        std::fill(mSplatColors, mSplatColors + numPixels,
+                  scene_rdl2::fb_util::RenderColor(scene_rdl2::math::zero));
+        std::fill(mSplatWeights, mSplatWeights + numPixels, 0.f);
+        mHasSplats = false;
+    }
+
+    unsigned mAovNumFloats;
+    float *mAovs;
+
+    unsigned mGuardBand;
+    bool mHasSplats;
+    scene_rdl2::fb_util::RenderColor *mSplatColors;
+    float *mSplatWeights;
+};
+
+} // namespace rndr
+} // namespace moonray
@@ -12,8 +12,11 @@
 //
 #include "TileScheduler.h"
 #include "Film.h"
+#include "RenderNodeBalancer.h"
 #include <scene_rdl2/render/util/Arena.h>
 #include <scene_rdl2/render/util/Random.h>
+#include <algorithm>
+#include <numeric>
 #include <random>
 
 namespace moonray {
@@ -36,6 +39,22 @@ distributeTiles(std::vector<scene_rdl2::fb_util::Tile>& tiles, unsigned renderNo
     tiles.swap(temp);
 }
 
+void
+distributeTilesWeighted(std::vector<scene_rdl2::fb_util::Tile>& tiles, unsigned renderNodeIdx,
+                        const std::vector<float> &weights)
+{
+    std::vector<unsigned> tileIds;
+    RenderNodeBalancer::assignTiles(weights, unsigned(tiles.size()), renderNodeIdx, tileIds);
+
+    std::vector<scene_rdl2::fb_util::Tile> temp;
+    temp.reserve(tileIds.size());
+    for (unsigned tileId : tileIds) {
+        temp.push_back(tiles[tileId]);
+    }
+
+    tiles.swap(temp);
+}
+
 }   // End of anon namespace.
 
 //-----------------------------------------------------------------------------
@@ -126,13 +145,42 @@ TileScheduler::generateTiles(scene_rdl2::alloc::Arena *arena,
         mTaskDistribType = taskDistribType;
         if (mTaskDistribType == static_cast<unsigned>(scene_rdl2::rdl2::TaskDistributionType::NON_OVERLAPPED_TILE)) {
             // unorverlapped tile distribution
-            distributeTiles(mTiles, renderNodeIdx, numRenderNodes);
+            // Weighted distribution needs enough tiles, so that the minimum share of the weights
+            // (see RenderNodeBalancer::rebalance()) still gives some tiles to every node.
+            if (mRenderNodeWeights.size() == numRenderNodes && mTiles.size() >= numRenderNodes * 16) {
+                distributeTilesWeighted(mTiles, renderNodeIdx, mRenderNodeWeights);
+            } else {
+                distributeTiles(mTiles, renderNodeIdx, numRenderNodes);
+            }
         }
     }
 
     return unsigned(mTiles.size());
 }
 
+void
+TileScheduler::computeFocusTileOrder(float focusX, float focusY,
+                                     std::vector<uint32_t> &tileOrder, std::vector<float> &tileCosts) const
+{
+    const unsigned numTiles = unsigned(mTiles.size());
+
+    // Squared distance of each tile center from the focus point.
+    std::vector<float> distances(numTiles);
+    for (unsigned i = 0; i < numTiles; ++i) {
+        const scene_rdl2::fb_util::Tile &tile = mTiles[i];
+        const float dx = 0.5f * static_cast<float>(tile.mMinX + tile.mMaxX) - focusX;
+        const float dy = 0.5f * static_cast<float>(tile.mMinY + tile.mMaxY) - focusY;
+        distances[i] = dx * dx + dy * dy;
+    }
+
+    tileOrder.resize(numTiles);
+    std::iota(tileOrder.begin(), tileOrder.end(), 0u);
+    std::stable_sort(tileOrder.begin(), tileOrder.end(), [&](uint32_t a, uint32_t b) {
+        return distances[a] < distances[b];
+    });
+    tileCosts.assign(numTiles, 1.0f);
+}
+
 std::unique_ptr<TileScheduler>
 TileScheduler::create(TileScheduler::Type type)
 {
@@ -148,6 +196,7 @@ TileScheduler::create(TileScheduler::Type type)
     case SPIRAL_SQUARE:    tileScheduler.reset(new SpiralSquareTileScheduler);    break;
     case SPIRAL_RECT:      tileScheduler.reset(new SpiralRectTileScheduler);      break;
     case MORTON_SHIFTFLIP: tileScheduler.reset(new MortonShiftFlipTileScheduler); break;
+    case COST:             tileScheduler.reset(new CostTileScheduler);            break;
     default:
         MNRY_ASSERT(0);
     }
@@ -296,6 +345,54 @@ MortonTileScheduler::generateTileIndices(scene_rdl2::alloc::Arena *arena,
     mortonTileOrderGen(arena, numTilesX, numTilesY, tileIndices, 0, 0, false, false);
 }
 
+void
+CostTileScheduler::generateTileIndices(scene_rdl2::alloc::Arena *arena,
+                                       unsigned numTilesX, unsigned numTilesY,
+                                       uint32_t *tileIndices, uint32_t seed) const
+//
+// Coarse passes use the standard Morton order, fine passes are reordered by cost.
+//
+{
+    mortonTileOrderGen(arena, numTilesX, numTilesY, tileIndices, 0, 0, false, false);
+}
+
+void
+CostTileScheduler::resetTileCosts()
+{
+    const unsigned numTiles = unsigned(mTiles.size());
+    if (numTiles != mNumTileCosts) {
+        mTileCosts.reset(new std::atomic<int64_t>[numTiles]);
+        mNumTileCosts = numTiles;
+    }
+    for (unsigned i = 0; i < mNumTileCosts; ++i) {
+        mTileCosts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool
+CostTileScheduler::computeCostTileOrder(std::vector<uint32_t> &tileOrder, std::vector<float> &tileCosts) const
+{
+    tileOrder.resize(mNumTileCosts);
+    tileCosts.resize(mNumTileCosts);
+
+    int64_t totalCost = 0;
+    for (unsigned i = 0; i < mNumTileCosts; ++i) {
+        tileOrder[i] = i;
+        totalCost += mTileCosts[i].load(std::memory_order_relaxed);
+    }
+    if (totalCost <= 0) {
+        return false;
+    }
+
+    std::stable_sort(tileOrder.begin(), tileOrder.end(), [&](uint32_t a, uint32_t b) {
+        return mTileCosts[a].load(std::memory_order_relaxed) > mTileCosts[b].load(std::memory_order_relaxed);
+    });
+    for (unsigned i = 0; i < mNumTileCosts; ++i) {
+        tileCosts[i] = static_cast<float>(mTileCosts[tileOrder[i]].load(std::memory_order_relaxed)) * 1e-9f;
+    }
+    return true;
+}
+
 void
 MortonShiftFlipTileScheduler::generateTileIndices(scene_rdl2::alloc::Arena *arena,
                                                   unsigned numTilesX, unsigned numTilesY,
@@ -7,6 +7,7 @@
 #include <scene_rdl2/common/fb_util/FbTypes.h>
 #include <scene_rdl2/scene/rdl2/SceneVariables.h>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -34,6 +35,7 @@ public:
         SPIRAL_SQUARE,      // 6
         SPIRAL_RECT,        // 7
         MORTON_SHIFTFLIP,   // 8
+        COST,               // 9
         NUM_TILE_SCHEDULER_TYPES,
     };
 
@@ -61,12 +63,25 @@ public:
 
     unsigned getRenderNodeIdx() const { return mRenderNodeIdx; }
 
+    // Relative throughput of each render node for dynamic load balancing (see RenderNodeBalancer).
+    // Only used by the NON_OVERLAPPED_TILE task distribution. Empty weights or weights which don't
+    // match numRenderNodes fall back to the regular equal distribution. Takes effect at the next
+    // generateTiles() call.
+    void setRenderNodeWeights(const std::vector<float> &weights) { mRenderNodeWeights = weights; }
+    const std::vector<float> &getRenderNodeWeights() const { return mRenderNodeWeights; }
+
     // Returns cached minimal set of tiles for viewport passed in.
     const std::vector<scene_rdl2::fb_util::Tile> &getTiles() const   { return mTiles; }
 
     // Returns the permuted order of the tile indices
     const uint32_t* getTileIndices() const { return mTileIndices.get(); }
 
+    // Fills in the indices into getTiles() sorted by increasing distance of the tile centers
+    // from the focus point (pixel coordinates) along with a uniform per tile cost, ready for
+    // TileWorkQueue::setTileOrder(). Tiles at the same distance keep the scheduler order.
+    void computeFocusTileOrder(float focusX, float focusY,
+                               std::vector<uint32_t> &tileOrder, std::vector<float> &tileCosts) const;
+
     // Factory function.
     static std::unique_ptr<TileScheduler> create(TileScheduler::Type type);
 
@@ -90,6 +105,8 @@ protected:
     std::unique_ptr<uint32_t[]> mTileIndices;
 
     unsigned mTaskDistribType;  // Film::TaskDistribType
+
+    std::vector<float> mRenderNodeWeights;
 };
 
 //-----------------------------------------------------------------------------
@@ -211,6 +228,43 @@ private:
     bool mFlipY {false};
 };
 
+//
+// Cost driven tile scheduler. Coarse passes are rendered in Morton order while the
+// render time of each tile is recorded. Once the coarse passes are done,
+// computeCostTileOrder() returns the tiles sorted from most to least expensive so
+// that fine passes start the expensive (e.g. hair heavy) tiles first and don't end
+// with a long tail of a few slow tiles.
+//
+class CostTileScheduler : public TileScheduler
+{
+public:
+    CostTileScheduler() : TileScheduler(TileScheduler::COST) {}
+    virtual void generateTileIndices(scene_rdl2::alloc::Arena *arena,
+                                     unsigned numTilesX,
+                                     unsigned numTilesY,
+                                     uint32_t *tileIndices,
+                                     uint32_t seed) const override;
+
+    // Clears all recorded tile costs. Must be called before the first pass of a frame.
+    void resetTileCosts();
+
+    // Thread-safe. tileIdx is an index into getTiles().
+    void addTileCost(unsigned tileIdx, int64_t nsec)
+    {
+        MNRY_ASSERT(tileIdx < mNumTileCosts);
+        mTileCosts[tileIdx].fetch_add(nsec, std::memory_order_relaxed);
+    }
+
+    // Fills in the tile indices sorted by decreasing recorded cost along with the
+    // matching per tile cost (in seconds). Tiles of equal cost keep their Morton order.
+    // Returns false if no cost has been recorded yet.
+    bool computeCostTileOrder(std::vector<uint32_t> &tileOrder, std::vector<float> &tileCosts) const;
+
+private:
+    unsigned mNumTileCosts {0};
+    std::unique_ptr<std::atomic<int64_t>[]> mTileCosts;
+};
+
 //-----------------------------------------------------------------------------
 
 } // namespace rndr
@@ -11,6 +11,8 @@
 #include <scene_rdl2/common/math/MathUtil.h>
 #include <scene_rdl2/render/util/StrUtil.h>
 
+#include <algorithm>
+
 #ifdef RUNTIME_VERIFY_TILE_WORK_QUEUE // See RuntimeVerify.h
 #define RUNTIME_VERIFY
 #endif // end RUNTIME_VERIFY_TILE_WORK_QUEUE
@@ -20,10 +22,22 @@ namespace rndr {
 
 namespace
 {
+// Tiles per group in deterministic mode, whatever the samples per tile of the pass.
+constexpr unsigned sDeterministicTilesPerGroup = 4;
+
 constexpr unsigned roundUpDivision(unsigned dividend, unsigned divisor) noexcept
 {
     return (dividend + (divisor - 1u)) / divisor;
 }
+
+// Neighbours are visited in order of increasing distance from the stealing
+// thread so steals tend to stay within the same part of the TileScheduler order.
+inline unsigned neighbourQueueIdx(unsigned queueIdx, unsigned step, unsigned numQueues) noexcept
+{
+    const unsigned offset = (step + 2u) / 2u;
+    return (step & 1u) ? (queueIdx + numQueues - offset % numQueues) % numQueues :
+                         (queueIdx + offset) % numQueues;
+}
 }   // End of anon namespace.
 
 //-----------------------------------------------------------------------------
@@ -32,13 +46,16 @@ TileWorkQueue::TileWorkQueue()
 : mNumPasses(0)
 , mNumTiles(0)
 , mGroupClampIdx(0)
-, mOffset(OffsetData{0, 0})
-, mGlobalGroupIdx(0)
+, mNumQueues(0)
+, mCurrentPass(0)
+, mStatsEnabled(false)
+, mResetTime(0.0)
 , mRuntimeDebug(false)
 {
     // CPPCHECK -- Using memset() on struct which contains a floating point number.
     // cppcheck-suppress memsetClassFloat
     memset(mPassInfos, 0, sizeof(mPassInfos));
+    memset(mPassGroupStarts, 0, sizeof(mPassGroupStarts));
 
     parserConfigure();
 }
@@ -125,6 +142,10 @@ TileWorkQueue::init(RenderMode mode,
         unsigned samplesPerTile = (pass.mEndPixelIdx - pass.mStartPixelIdx) * samplesPerPixel;
         unsigned tilesPerGroup = static_cast<unsigned>(std::lround(static_cast<float>(desiredSamplesPerGroup) /
                                                        static_cast<float>(samplesPerTile)));
+        if (mDeterministic) {
+            // The groups, and so the queue owning each tile, must be the same in every pass.
+            tilesPerGroup = sDeterministicTilesPerGroup;
+        }
         tilesPerGroup = scene_rdl2::math::clamp<unsigned>(tilesPerGroup, minTilesPerGroup, maxTilesPerGroup);
         MNRY_ASSERT(tilesPerGroup);
 
@@ -143,6 +164,38 @@ TileWorkQueue::init(RenderMode mode,
         groupIdx = passInfo->mEndGroupIdx;
     }
 
+    //
+    // Allocate one queue per render thread.
+    //
+
+    mNumQueues = numRenderThreads;
+    mQueues.reset(new ThreadQueue[mNumQueues]);
+    for (unsigned q = 0; q < mNumQueues; ++q) {
+        mQueues[q].mRangeBlocks.reset(new RangeBlock[roundUpDivision(mNumPasses, RangesPerBlock)]);
+    }
+
+    // Group the queues by NUMA node. Without a node table all queues form one group.
+    if (!mQueueNodes.empty() && mQueueNodes.size() < mNumQueues) {
+        mQueueNodes.clear();
+    }
+    for (unsigned first = 0; first < mNumQueues; ) {
+        unsigned end = first + 1;
+        while (!mQueueNodes.empty() && end < mNumQueues && mQueueNodes[end] == mQueueNodes[first]) {
+            ++end;
+        }
+        if (mQueueNodes.empty()) {
+            end = mNumQueues;
+        }
+        for (unsigned q = first; q < end; ++q) {
+            mQueues[q].mNodeFirstQueue = first;
+            mQueues[q].mNodeNumQueues = end - first;
+        }
+        first = end;
+    }
+
+    mPassStats.reset(new PassStats[mNumPasses]);
+    mRetiredTiles.reset(new std::atomic<bool>[mNumTiles]);
+
     reset();
 
     if (mRuntimeDebug) {
@@ -157,8 +210,103 @@ TileWorkQueue::reset()
         unclampPasses();
     }
 
-    mGlobalGroupIdx.store(0);
-    mOffset.store(OffsetData{0, 0});
+    clearTileOrder();
+
+    // Refill every per-thread queue with its share of the tile groups of each pass.
+    for (unsigned q = 0; q < mNumQueues; ++q) {
+        ThreadQueue &queue = mQueues[q];
+        for (unsigned passIdx = 0; passIdx < mNumPasses; ++passIdx) {
+            queue.getRange(passIdx).store(makeRange(0, getNumGroupsInQueue(passIdx, q)),
+                                         std::memory_order_relaxed);
+        }
+        queue.mStats = TileWorkQueueStats::Thread();
+        queue.mPassIdx = 0;
+    }
+    for (unsigned passIdx = 0; passIdx < mNumPasses; ++passIdx) {
+        mPassStats[passIdx].mDrainTime.store(0.0, std::memory_order_relaxed);
+        mPassStats[passIdx].mStolenGroups.store(0, std::memory_order_relaxed);
+    }
+    mResetTime = scene_rdl2::util::getSeconds();
+
+    for (unsigned tileIdx = 0; tileIdx < mNumTiles; ++tileIdx) {
+        mRetiredTiles[tileIdx].store(false, std::memory_order_relaxed);
+    }
+    mNumRetiredTiles.store(0, std::memory_order_relaxed);
+    mNumSkippedTiles.store(0, std::memory_order_relaxed);
+
+    mCurrentPass.store(0);
+}
+
+bool
+TileWorkQueue::retireTile(unsigned tileIdx)
+{
+    MNRY_ASSERT(tileIdx < mNumTiles);
+    if (mRetiredTiles[tileIdx].exchange(true, std::memory_order_relaxed)) {
+        return false; // already retired by another thread
+    }
+    mNumRetiredTiles.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void
+TileWorkQueue::setTileOrder(unsigned firstPassIdx,
+                            const std::vector<uint32_t> &tileOrder,
+                            const std::vector<float> &tileCosts)
+{
+    MNRY_ASSERT(tileOrder.size() == mNumTiles && tileCosts.size() == mNumTiles);
+
+    clearTileOrder();
+    if (firstPassIdx >= mNumPasses || mDeterministic) {
+        return;
+    }
+
+    mTileOrderFirstPass = firstPassIdx;
+    mTileOrder = tileOrder;
+
+    // mTileOrderCostPrefix[i] is the total cost of the first i tiles in the order.
+    mTileOrderCostPrefix.resize(mNumTiles + 1);
+    mTileOrderCostPrefix[0] = 0.0f;
+    for (unsigned i = 0; i < mNumTiles; ++i) {
+        mTileOrderCostPrefix[i + 1] = mTileOrderCostPrefix[i] + std::max(tileCosts[i], 0.0f);
+    }
+    const float totalCost = mTileOrderCostPrefix[mNumTiles];
+
+    for (unsigned passIdx = firstPassIdx; passIdx < mNumPasses; ++passIdx) {
+        const PassInfo &passInfo = mPassInfos[passIdx];
+        const unsigned numGroups = passInfo.mEndGroupIdx - passInfo.mStartGroupIdx;
+
+        auto inserted = mTileOrderGroupStarts.emplace(numGroups, std::vector<uint32_t>());
+        std::vector<uint32_t> &groupStarts = inserted.first->second;
+        if (inserted.second) {
+            // Each group gets an equal share of the total cost. Every group holds at least
+            // one tile, and enough tiles are left over for the remaining groups.
+            groupStarts.resize(numGroups + 1);
+            groupStarts[0] = 0;
+            for (unsigned g = 1; g < numGroups; ++g) {
+                const float targetCost = totalCost * (static_cast<float>(g) / static_cast<float>(numGroups));
+                unsigned start = static_cast<unsigned>(
+                    std::lower_bound(mTileOrderCostPrefix.begin(), mTileOrderCostPrefix.end(), targetCost) -
+                    mTileOrderCostPrefix.begin());
+                start = std::max(start, groupStarts[g - 1] + 1u);
+                start = std::min(start, mNumTiles - (numGroups - g));
+                groupStarts[g] = start;
+            }
+            groupStarts[numGroups] = mNumTiles;
+        }
+        mPassGroupStarts[passIdx] = &groupStarts;
+    }
+}
+
+void
+TileWorkQueue::clearTileOrder()
+{
+    for (unsigned passIdx = mTileOrderFirstPass; passIdx < mNumPasses; ++passIdx) {
+        mPassGroupStarts[passIdx] = nullptr;
+    }
+    mTileOrderFirstPass = 0;
+    mTileOrder.clear();
+    mTileOrderCostPrefix.clear();
+    mTileOrderGroupStarts.clear();
 }
 
 // Executes the up until and including this pass and then stops.
@@ -177,69 +325,197 @@ TileWorkQueue::unclampPasses()
     mGroupClampIdx = mPassInfos[mNumPasses - 1].mEndGroupIdx;
 }
 
-TileGroup
-TileWorkQueue::reserveNextTileGroup()
+unsigned
+TileWorkQueue::getNodeGroupStart(unsigned numGroups, unsigned queueIdx) const
 {
-    // TODO: C++17 change to is_always_lock_free and do a static assert, although this is desired behavior, we're
-    // probably okay even if it's not true.
-    MNRY_ASSERT(mOffset.is_lock_free());
+    // First tile group of the node share which starts at queueIdx.
+    return static_cast<unsigned>((static_cast<std::uint64_t>(numGroups) * queueIdx) / mNumQueues);
+}
 
-    constexpr unsigned minTilesPerGroup = 1u;
-    TileGroup group;
+unsigned
+TileWorkQueue::getNumGroupsInQueue(unsigned passIdx, unsigned queueIdx) const
+{
+    // Round-robin share of the node's tile groups owned by this queue.
+    const PassInfo &passInfo = mPassInfos[passIdx];
+    const ThreadQueue &queue = mQueues[queueIdx];
+    const unsigned numGroups = passInfo.mEndGroupIdx - passInfo.mStartGroupIdx;
+    const unsigned nodeGroups = getNodeGroupStart(numGroups, queue.mNodeFirstQueue + queue.mNodeNumQueues) -
+                                getNodeGroupStart(numGroups, queue.mNodeFirstQueue);
+    const unsigned localIdx = queueIdx - queue.mNodeFirstQueue;
+    return (nodeGroups > localIdx) ? roundUpDivision(nodeGroups - localIdx, queue.mNodeNumQueues) : 0u;
+}
 
-    OffsetData currentOffset = mOffset;
-    while (true) {
-        // Get pass information
-        const PassInfo& passInfo = mPassInfos[currentOffset.mPass];
-        const unsigned numGroupTiles = std::max(minTilesPerGroup, passInfo.mTilesPerGroup);
-
-        // This will load-balance in that each tile group will only differ by
-        // +/-1 from the (number of tiles)/(number of group tiles).
-        //
-        // groupsLeftInPass will eventually be 1, which leaves that group to
-        // get the remainder of the tiles.
-        const auto tilesLeftInPass = mNumTiles - currentOffset.mTile;
-        const auto groupsLeftInPass = roundUpDivision(tilesLeftInPass, numGroupTiles);
-
-        OffsetData nextOffset(currentOffset);
-        if (groupsLeftInPass <= 1) {
-            // We need to start a new pass next time
-            nextOffset.mTile = 0;
-            ++nextOffset.mPass;
-        } else {
-            const auto numTiles = tilesLeftInPass/groupsLeftInPass;
-            nextOffset.mTile = currentOffset.mTile + numTiles;
-            MNRY_ASSERT(nextOffset.mTile < mNumTiles);
+unsigned
+TileWorkQueue::getTileNode(unsigned tileIdx) const
+{
+    MNRY_ASSERT(tileIdx < mNumTiles);
+    if (mQueueNodes.empty()) {
+        return 0;
+    }
+    // Node shares are proportional to the number of queues, for the tile groups as
+    // well as for the tiles they cover.
+    const unsigned queueIdx = static_cast<unsigned>((static_cast<std::uint64_t>(tileIdx) * mNumQueues) / mNumTiles);
+    return mQueueNodes[queueIdx];
+}
+
+bool
+TileWorkQueue::popFront(unsigned queueIdx, unsigned passIdx, unsigned *slot, unsigned *casRetries)
+{
+    std::atomic<Range> &range = mQueues[queueIdx].getRange(passIdx);
+    Range current = range.load(std::memory_order_acquire);
+    while (rangeFront(current) < rangeBack(current)) {
+        const Range next = makeRange(rangeFront(current) + 1u, rangeBack(current));
+        if (range.compare_exchange_weak(current, next, std::memory_order_acq_rel)) {
+            *slot = rangeFront(current);
+            return true;
         }
+        ++(*casRetries);
+    }
+    return false;
+}
 
-        // Check to see if we can actually claim this offset though CAS.
-        if (mOffset.compare_exchange_strong(currentOffset, nextOffset)) {
-            // We have successfully claimed this offset. Update our group data for returning.
-            group.mPassIdx      = currentOffset.mPass;
-            group.mStartTileIdx = currentOffset.mTile;
-            group.mEndTileIdx   = (nextOffset.mTile == 0) ? mNumTiles : (nextOffset.mTile);
-
-            MNRY_ASSERT(group.mEndTileIdx > group.mStartTileIdx);
-            MNRY_ASSERT(group.mStartTileIdx < mNumTiles);
-            MNRY_ASSERT(group.mEndTileIdx <= mNumTiles);
-            return group;
+bool
+TileWorkQueue::popBack(unsigned queueIdx, unsigned passIdx, unsigned *slot, unsigned *casRetries)
+{
+    std::atomic<Range> &range = mQueues[queueIdx].getRange(passIdx);
+    Range current = range.load(std::memory_order_acquire);
+    while (rangeFront(current) < rangeBack(current)) {
+        const Range next = makeRange(rangeFront(current), rangeBack(current) - 1u);
+        if (range.compare_exchange_weak(current, next, std::memory_order_acq_rel)) {
+            *slot = rangeBack(current) - 1u;
+            return true;
         }
+        ++(*casRetries);
+    }
+    return false;
+}
+
+TileGroup
+TileWorkQueue::makeTileGroup(unsigned passIdx, unsigned queueIdx, unsigned slot) const
+{
+    const PassInfo &passInfo = mPassInfos[passIdx];
+    const ThreadQueue &queue = mQueues[queueIdx];
+    const unsigned numGroups = passInfo.mEndGroupIdx - passInfo.mStartGroupIdx;
+    const unsigned groupIdx = getNodeGroupStart(numGroups, queue.mNodeFirstQueue) +
+                              (queueIdx - queue.mNodeFirstQueue) + slot * queue.mNodeNumQueues;
+    MNRY_ASSERT(groupIdx < numGroups);
+
+    // This will load-balance in that each tile group will only differ by
+    // +/-1 from the (number of tiles)/(number of groups).
+    auto groupStartTile = [&](unsigned idx) {
+        return static_cast<unsigned>((static_cast<std::uint64_t>(idx) * mNumTiles) / numGroups);
+    };
+
+    TileGroup group;
+    group.mPassIdx = passIdx;
+    group.mFirstFinePass = false;
+    if (const std::vector<uint32_t> *groupStarts = mPassGroupStarts[passIdx]) {
+        // Cost balanced groups over the order given to setTileOrder().
+        group.mStartTileIdx = (*groupStarts)[groupIdx];
+        group.mEndTileIdx   = (*groupStarts)[groupIdx + 1u];
+        group.mTileOrder    = mTileOrder.data();
+    } else {
+        group.mStartTileIdx = groupStartTile(groupIdx);
+        group.mEndTileIdx   = groupStartTile(groupIdx + 1u);
+        group.mTileOrder    = nullptr;
+    }
+
+    MNRY_ASSERT(group.mEndTileIdx > group.mStartTileIdx);
+    MNRY_ASSERT(group.mStartTileIdx < mNumTiles);
+    MNRY_ASSERT(group.mEndTileIdx <= mNumTiles);
+    return group;
+}
+
+void
+TileWorkQueue::recordPassDrained(unsigned passIdx)
+{
+    if (mStatsEnabled) {
+        mPassStats[passIdx].mDrainTime.store(scene_rdl2::util::getSeconds() - mResetTime,
+                                             std::memory_order_relaxed);
     }
 }
 
 bool
 TileWorkQueue::getNextTileGroup(unsigned threadIdx, TileGroup *group, unsigned lastCoursePassIdx)
 {
-    MNRY_ASSERT(mNumPasses);
-
-    // mGroupClampIdx is set by the main thread.
-    auto groupIdx = mGlobalGroupIdx.load();
-    do {
-        if (groupIdx >= mGroupClampIdx) {
+    MNRY_ASSERT(mNumPasses && mNumQueues);
+
+    const unsigned queueIdx = threadIdx % mNumQueues;
+    const ThreadQueue &ownQueue = mQueues[queueIdx];
+    const unsigned nodeFirstQueue = ownQueue.mNodeFirstQueue;
+    const unsigned nodeNumQueues = ownQueue.mNodeNumQueues;
+    TileWorkQueueStats::Thread &stats = mQueues[queueIdx].mStats;
+    unsigned casRetries = 0;
+
+    // In deterministic mode each thread walks the passes of its own queue.
+    MNRY_ASSERT(!mDeterministic || threadIdx < mNumQueues);
+    std::uint32_t passIdx = mDeterministic ? ownQueue.mPassIdx : mCurrentPass.load(std::memory_order_acquire);
+    while (passIdx < mNumPasses) {
+        // mGroupClampIdx is set by the main thread.
+        if (mPassInfos[passIdx].mEndGroupIdx > mGroupClampIdx) {
             return false;
         }
-    } while (!mGlobalGroupIdx.compare_exchange_weak(groupIdx, groupIdx + 1u));
-    *group = reserveNextTileGroup();
+
+        unsigned slot = 0;
+        unsigned ownerIdx = queueIdx;
+        bool found = popFront(queueIdx, passIdx, &slot, &casRetries);
+        if (found) {
+            if (mStatsEnabled) {
+                ++stats.mOwnGroups;
+            }
+        } else if (!mDeterministic) {
+            // Our own queue is empty, try to steal from the back of a neighbour's.
+            // Neighbours on our own NUMA node come first.
+            const unsigned localIdx = queueIdx - nodeFirstQueue;
+            for (unsigned step = 0; step + 1u < nodeNumQueues && !found; ++step) {
+                ownerIdx = nodeFirstQueue + neighbourQueueIdx(localIdx, step, nodeNumQueues);
+                found = popBack(ownerIdx, passIdx, &slot, &casRetries);
+            }
+            bool remote = false;
+            if (nodeNumQueues < mNumQueues) {
+                for (unsigned step = 0; step + 1u < mNumQueues && !found; ++step) {
+                    ownerIdx = neighbourQueueIdx(queueIdx, step, mNumQueues);
+                    if (ownerIdx - nodeFirstQueue < nodeNumQueues) {
+                        continue; // already tried
+                    }
+                    found = remote = popBack(ownerIdx, passIdx, &slot, &casRetries);
+                }
+            }
+            if (found && mStatsEnabled) {
+                ++stats.mStolenGroups;
+                if (remote) {
+                    ++stats.mRemoteGroups;
+                }
+                mPassStats[passIdx].mStolenGroups.fetch_add(1u, std::memory_order_relaxed);
+            }
+        }
+
+        if (found) {
+            *group = makeTileGroup(passIdx, ownerIdx, slot);
+            break;
+        }
+
+        if (mDeterministic) {
+            // Our own share of the pass is done, the other threads may still be
+            // rendering theirs but none of them touches our tiles.
+            mQueues[queueIdx].mPassIdx = ++passIdx;
+            continue;
+        }
+
+        // Every queue was empty for this pass. Queues never grow during a pass,
+        // so all of its tile groups have been handed out and we can move on.
+        if (mCurrentPass.compare_exchange_strong(passIdx, passIdx + 1u, std::memory_order_acq_rel)) {
+            recordPassDrained(passIdx);
+            ++passIdx;
+        }
+    }
+
+    if (mStatsEnabled) {
+        stats.mCasRetries += casRetries;
+    }
+    if (passIdx >= mNumPasses) {
+        return false;
+    }
 
 #ifdef RUNTIME_VERIFY
     TileGroupRuntimeVerify::get()->push(*group);
@@ -259,6 +535,59 @@ TileWorkQueue::getNextTileGroup(unsigned threadIdx, TileGroup *group, unsigned l
     return true;
 }
 
+TileWorkQueueStats
+TileWorkQueue::getStats() const
+{
+    TileWorkQueueStats result;
+    result.mThreads.resize(mNumQueues);
+    for (unsigned q = 0; q < mNumQueues; ++q) {
+        result.mThreads[q] = mQueues[q].mStats;
+    }
+    result.mPasses.resize(mNumPasses);
+    for (unsigned passIdx = 0; passIdx < mNumPasses; ++passIdx) {
+        result.mPasses[passIdx].mDrainTime = mPassStats[passIdx].mDrainTime.load(std::memory_order_relaxed);
+        result.mPasses[passIdx].mStolenGroups = mPassStats[passIdx].mStolenGroups.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+std::string
+TileWorkQueueStats::show() const
+{
+    unsigned totalOwn = 0;
+    unsigned totalStolen = 0;
+    unsigned totalRemote = 0;
+    unsigned totalRetries = 0;
+
+    std::ostringstream ostr;
+    ostr << "TileWorkQueueStats {\n";
+    ostr << "  threads:" << mThreads.size() << " {\n";
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        const Thread &t = mThreads[i];
+        ostr << "    i:" << i
+             << " own:" << t.mOwnGroups
+             << " stolen:" << t.mStolenGroups
+             << " remote:" << t.mRemoteGroups
+             << " casRetries:" << t.mCasRetries << '\n';
+        totalOwn += t.mOwnGroups;
+        totalStolen += t.mStolenGroups;
+        totalRemote += t.mRemoteGroups;
+        totalRetries += t.mCasRetries;
+    }
+    ostr << "  }\n";
+    ostr << "  passes:" << mPasses.size() << " {\n";
+    for (size_t i = 0; i < mPasses.size(); ++i) {
+        ostr << "    i:" << i
+             << " drainTime:" << mPasses[i].mDrainTime << " sec"
+             << " stolen:" << mPasses[i].mStolenGroups << '\n';
+    }
+    ostr << "  }\n";
+    ostr << "  total own:" << totalOwn << " stolen:" << totalStolen << " remote:" << totalRemote
+         << " casRetries:" << totalRetries << '\n';
+    ostr << "}";
+    return ostr.str();
+}
+
 unsigned
 TileWorkQueue::getTotalTileSamples() const
 {
@@ -295,13 +624,20 @@ TileWorkQueue::show() const
     std::ostringstream ostr;
     ostr << "TileWorkQueue {\n";
     ostr << "  mNumTiles:" << mNumTiles << '\n'
-         << "  mGroupClampIdx:" << mGroupClampIdx << '\n';
+         << "  mGroupClampIdx:" << mGroupClampIdx << '\n'
+         << "  mNumQueues:" << mNumQueues << '\n'
+         << "  numaNodes:" << (hasQueueNodes() ? "on" : "off") << '\n'
+         << "  mCurrentPass:" << mCurrentPass.load() << '\n'
+         << "  mDeterministic:" << scene_rdl2::str_util::boolStr(mDeterministic) << '\n'
+         << "  tileOrder:" << (hasTileOrder() ? "from pass " + std::to_string(mTileOrderFirstPass) : "none") << '\n'
+         << "  retiredTiles:" << getNumRetiredTiles() << " skipped:" << getNumSkippedTiles() << '\n';
     ostr << "  mNumPasses:" << mNumPasses << " {\n";
     for (unsigned i = 0; i < mNumPasses; ++i) {
         ostr << "    i:" << i << '\n'
              << scene_rdl2::str_util::addIndent(showPassInfo(mPassInfos[i]), 2) << '\n';
     }
     ostr << "  }\n";
+    ostr << "  mStatsEnabled:" << scene_rdl2::str_util::boolStr(mStatsEnabled) << '\n';
     ostr << "  mRuntimeDebug:" << scene_rdl2::str_util::boolStr(mRuntimeDebug) << '\n';
     ostr << "}";
     return ostr.str();
@@ -320,6 +656,15 @@ TileWorkQueue::parserConfigure()
                     mRuntimeDebug = (arg++).as<bool>(0);
                     return arg.msg(scene_rdl2::str_util::boolStr(mRuntimeDebug) + '\n');
                 });
+    mParser.opt("stats", "<on|off|show>", "enable/disable work distribution statistics or show them",
+                [&](Arg& arg) -> bool {
+                    if (arg() == "show") {
+                        arg++;
+                        return arg.msg(getStats().show() + '\n');
+                    }
+                    mStatsEnabled = (arg++).as<bool>(0);
+                    return arg.msg(scene_rdl2::str_util::boolStr(mStatsEnabled) + '\n');
+                });
 }
 
 } // namespace rndr
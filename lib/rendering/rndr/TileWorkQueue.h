@@ -11,6 +11,10 @@
 #include <scene_rdl2/common/grid_util/Parser.h>
 
 #include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace moonray {
 namespace rndr {
@@ -23,15 +27,63 @@ struct TileGroup
     unsigned    mStartTileIdx;
     unsigned    mEndTileIdx;        // One past the end.
     bool        mFirstFinePass;     // If this is the first tile group of the fine pass this will be set to true.
+
+    // Optional remapping from the tile group range to indices into the tile list.
+    // nullptr means the identity mapping.
+    const uint32_t *mTileOrder;
+
+    unsigned    getTileIdx(unsigned idx) const { return mTileOrder ? mTileOrder[idx] : idx; }
 };
 
 //
-// This is a shared queue which hands out work for all the render threads on request.
+// Work distribution statistics collected by the TileWorkQueue while the "stats"
+// debug option is enabled. All counts are accumulated since the last reset().
+//
+struct TileWorkQueueStats
+{
+    struct Thread
+    {
+        unsigned mOwnGroups{0};     // Tile groups taken from the thread's own queue.
+        unsigned mStolenGroups{0};  // Tile groups stolen from a neighbour's queue.
+        unsigned mRemoteGroups{0};  // Stolen tile groups which belong to another NUMA node.
+        unsigned mCasRetries{0};    // Failed compare-exchanges (contention).
+    };
+
+    struct Pass
+    {
+        double   mDrainTime{0.0};   // Seconds after reset() at which every group of the pass was handed out.
+        unsigned mStolenGroups{0};  // Tile groups of the pass which were stolen.
+    };
+
+    std::vector<Thread> mThreads;
+    std::vector<Pass>   mPasses;
+
+    std::string show() const;
+};
+
+//
+// This is a queue which hands out work for all the render threads on request.
 // Along with queue draining, it is the mechanism we use to load balance the work
 // amongst threads. It's a virtual queue in that it looks like a queue to the outside
 // world but doesn't explicitly store any elements in a queue internally. Instead,
-// these are synthesized given an atomic incrementing counter and the current list
-// of passes and tiles for the frame.
+// each render thread owns a range of tile group indices per pass, and the tile
+// groups are synthesized from those indices and the current list of passes and
+// tiles for the frame.
+//
+// The tile groups of a pass are dealt out round-robin to the per-thread queues in
+// TileScheduler order, so thread t owns the groups t, t + numQueues, t + 2 * numQueues...
+// A thread pops from the front of its own queue and, once that is empty, steals from
+// the back of its neighbours' queues. Only when every queue of a pass is empty does
+// the queue move on to the next pass, so passes are still handed out in order.
+// Each queue lives on its own cache line, so threads only contend with each other
+// when stealing.
+//
+// When the queues are grouped by NUMA node, see setQueueNodes(), each node first
+// gets a contiguous share of the tile groups of every pass, in proportion to its
+// number of queues, and deals it out round-robin to its own queues. Thieves try
+// the queues of their own node before those of other nodes. Since the share of a
+// node covers about the same tiles in every pass, the threads of a node mostly
+// write to the same part of the film.
 //
 class TileWorkQueue
 {
@@ -50,6 +102,29 @@ public:
 
     void        reset();
 
+    //
+    // Groups the queues by NUMA node, queueNodes[i] is the node of the render
+    // thread with index i. The queues of a node must be consecutive. Takes effect
+    // at the next init(), an empty table turns the grouping off.
+    //
+    void        setQueueNodes(const std::vector<unsigned> &queueNodes) { mQueueNodes = queueNodes; }
+    bool        hasQueueNodes() const { return !mQueueNodes.empty(); }
+
+    //
+    // Deterministic mode. Every pass is split into the same tile groups, each of
+    // them always owned by the same queue, and threads neither steal nor wait
+    // for the other threads to drain a pass. A tile is then only ever rendered by
+    // one thread, one pass after the other, so the samples of a pixel reach the
+    // film in the same order whatever the number of threads. setTileOrder() has
+    // no effect in this mode. Takes effect at the next init().
+    //
+    void        setDeterministic(bool deterministic) { mDeterministic = deterministic; }
+    bool        isDeterministic() const { return mDeterministic; }
+
+    // NUMA node whose threads own the tile at tileIdx in the tile list order,
+    // 0 if the queues are not grouped by node.
+    unsigned    getTileNode(unsigned tileIdx) const;
+
     unsigned    getNumPasses() const noexcept { return mNumPasses; }
     const Pass &getPass(unsigned idx) const { MNRY_ASSERT(idx < mNumPasses); return mPassInfos[idx].mPass; }
 
@@ -72,27 +147,93 @@ public:
 
     unsigned getNumTiles() const { return mNumTiles; }
 
+    //
+    // Hands out the tiles of all passes from firstPassIdx onwards in the given order
+    // instead of the tile list order. Tile groups are split so that each group of a
+    // pass holds roughly the same total cost, which puts expensive tiles in small
+    // groups at the start of the pass. tileCosts[i] is the cost of tile tileOrder[i].
+    // Not thread-safe, must be called while no render threads are pulling work.
+    // The order is cleared by reset().
+    //
+    void        setTileOrder(unsigned firstPassIdx,
+                             const std::vector<uint32_t> &tileOrder,
+                             const std::vector<float> &tileCosts);
+    void        clearTileOrder();
+    bool        hasTileOrder() const { return !mTileOrder.empty(); }
+
+    //
+    // Tiles which don't need any more samples this frame, e.g. converged empty tiles
+    // under uniform sampling. The render threads still receive the tile groups which
+    // contain retired tiles and skip them, see RenderDriver::renderTile().
+    // Thread-safe. The table is cleared by reset().
+    //
+    // retireTile returns false if the tile was already retired.
+    //
+    bool        retireTile(unsigned tileIdx);
+    bool        isTileRetired(unsigned tileIdx) const
+    {
+        MNRY_ASSERT(tileIdx < mNumTiles);
+        return mRetiredTiles[tileIdx].load(std::memory_order_relaxed);
+    }
+    void        addSkippedTile() { mNumSkippedTiles.fetch_add(1, std::memory_order_relaxed); }
+    unsigned    getNumRetiredTiles() const { return mNumRetiredTiles.load(std::memory_order_relaxed); }
+    unsigned    getNumSkippedTiles() const { return mNumSkippedTiles.load(std::memory_order_relaxed); }
+
+    // Work distribution statistics, only collected when enabled.
+    void        setStatsEnabled(bool enabled) { mStatsEnabled = enabled; }
+    bool        getStatsEnabled() const { return mStatsEnabled; }
+    TileWorkQueueStats getStats() const;
+
     std::string show() const;
 
     Parser& getParser() { return mParser; }
 
 private:
-    TileGroup reserveNextTileGroup();
+    // Packed [front, back) range of slots in a per-thread queue.
+    using Range = std::uint64_t;
+    static Range    makeRange(std::uint32_t front, std::uint32_t back) { return (Range(back) << 32) | front; }
+    static unsigned rangeFront(Range range) { return static_cast<unsigned>(range & 0xffffffffu); }
+    static unsigned rangeBack(Range range) { return static_cast<unsigned>(range >> 32); }
 
-    void parserConfigure();
+    // Ranges are stored in whole cache lines so that queues of different threads never share one.
+    static constexpr unsigned RangesPerBlock = CACHE_LINE_SIZE / sizeof(Range);
+    struct alignas(CACHE_LINE_SIZE) RangeBlock
+    {
+        std::atomic<Range> mRanges[RangesPerBlock];
+    };
+
+    // Each render thread has one of these. It holds one range per pass, each
+    // range indexes into the thread's round-robin share of the pass's tile groups.
+    struct alignas(CACHE_LINE_SIZE) ThreadQueue
+    {
+        std::unique_ptr<RangeBlock[]> mRangeBlocks;
 
-    static constexpr std::size_t OffsetDataAlignment = alignof(std::atomic<std::uint64_t>);
+        // Consecutive queues of the same NUMA node as this one. The whole queue
+        // list if the queues are not grouped by node.
+        unsigned mNodeFirstQueue{0};
+        unsigned mNodeNumQueues{0};
 
-#pragma pack(push, 1)
-        struct alignas(OffsetDataAlignment) OffsetData
+        // Pass the owning thread is working on, deterministic mode only.
+        unsigned mPassIdx{0};
+
+        // Statistics, only touched by the owning thread. Kept on their own cache
+        // line since other threads read mRangeBlocks when stealing.
+        alignas(CACHE_LINE_SIZE) TileWorkQueueStats::Thread mStats;
+
+        std::atomic<Range> &getRange(unsigned passIdx)
         {
-            std::uint32_t mPass;
-            std::uint32_t mTile;
-        };
-#pragma pack(pop)
+            return mRangeBlocks[passIdx / RangesPerBlock].mRanges[passIdx % RangesPerBlock];
+        }
+    };
 
-    // TODO: C++17 change to always_lock_free
-    static_assert(sizeof(OffsetData) <= 64, "We expect to be able to do atomic operations on this struct");
+    unsigned   getNodeGroupStart(unsigned numGroups, unsigned queueIdx) const;
+    unsigned   getNumGroupsInQueue(unsigned passIdx, unsigned queueIdx) const;
+    bool       popFront(unsigned queueIdx, unsigned passIdx, unsigned *slot, unsigned *casRetries);
+    bool       popBack(unsigned queueIdx, unsigned passIdx, unsigned *slot, unsigned *casRetries);
+    TileGroup  makeTileGroup(unsigned passIdx, unsigned queueIdx, unsigned slot) const;
+    void       recordPassDrained(unsigned passIdx);
+
+    void parserConfigure();
 
     // Each input pass has an associated PassInfo structure created for it.
     struct PassInfo
@@ -110,8 +251,38 @@ private:
     unsigned                       mNumTiles{0};
     unsigned                       mGroupClampIdx{0};
 
-    std::atomic<OffsetData>        mOffset{OffsetData{0, 0}};
-    std::atomic<std::uint32_t>     mGlobalGroupIdx{0};
+    unsigned                       mNumQueues{0};
+    std::unique_ptr<ThreadQueue[]> mQueues;
+    std::vector<unsigned>          mQueueNodes;
+    bool                           mDeterministic{false};
+
+    // Tile order set by setTileOrder() along with the first tile of each group
+    // for passes >= mTileOrderFirstPass, indexed by the number of groups in the pass.
+    unsigned                                      mTileOrderFirstPass{0};
+    std::vector<uint32_t>                         mTileOrder;
+    std::vector<float>                            mTileOrderCostPrefix;
+    std::map<unsigned, std::vector<uint32_t>>     mTileOrderGroupStarts;
+    const std::vector<uint32_t>                  *mPassGroupStarts[MAX_RENDER_PASSES];
+
+    // Retired tiles along with the number of retired tiles and the number of times
+    // a render thread skipped one of them since the last reset().
+    std::unique_ptr<std::atomic<bool>[]> mRetiredTiles;
+    std::atomic<unsigned>               mNumRetiredTiles{0};
+    std::atomic<unsigned>               mNumSkippedTiles{0};
+
+    // Lowest pass which may still have tile groups left. Only written when a pass drains.
+    CACHE_ALIGN std::atomic<std::uint32_t> mCurrentPass{0};
+
+    // Per pass statistics, only updated when mStatsEnabled is set.
+    struct PassStats
+    {
+        std::atomic<double>   mDrainTime{0.0};
+        std::atomic<unsigned> mStolenGroups{0};
+    };
+
+    bool mStatsEnabled;
+    double mResetTime;
+    std::unique_ptr<PassStats[]> mPassStats;
 
     Parser mParser;
     bool mRuntimeDebug;
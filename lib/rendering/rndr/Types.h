@@ -78,6 +78,14 @@ enum class SamplingMode
     NUM_MODES,
 };
 
+enum class AdaptiveErrorMetricType
+{
+    LUMINANCE = 0,   // luminance difference normalized by sqrt of luminance (default)
+    RELATIVE = 1,    // luminance-weighted relative error
+    MAX_CHANNEL = 2, // max of the per channel normalized difference
+    TONEMAPPED = 3,  // luminance difference after a Reinhard tonemap
+};
+
 enum class CheckpointMode
 {
     TIME_BASED = 0,    // Time based checkpoint rendering mode
@@ -0,0 +1,138 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "AdaptiveConvergenceEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace moonray {
+namespace rndr {
+
+void
+AdaptiveConvergenceEstimator::reset(double startTime, float targetError, float minGainPerMinute)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStartTime = startTime;
+    mTargetError = targetError;
+    mMinGainPerMinute = minGainPerMinute;
+    mMeasurements.clear();
+    mHasPrediction = false;
+    mDecayExponent = 0.0;
+    mPredictedSecToTarget = 0.0;
+    mErrorGainPerMinute = 0.0;
+    mStop = false;
+}
+
+bool
+AdaptiveConvergenceEstimator::update(double time, float error)
+{
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    if (mStop) {
+        return true;
+    }
+
+    // The regions report the max float error until they are first evaluated.
+    const double t = time - mStartTime;
+    if (t <= 0.0 || !(error > 0.0f) || error >= std::numeric_limits<float>::max()) {
+        return false;
+    }
+    if (!mMeasurements.empty() && t - mMeasurements.back().mTime < sMinInterval) {
+        return false;
+    }
+
+    mMeasurements.push_back({t, double(error)});
+    if (mMeasurements.size() > sMaxMeasurements) {
+        mMeasurements.pop_front();
+    }
+    fit();
+
+    mStop = mHasPrediction && mMinGainPerMinute > 0.0f && mErrorGainPerMinute < mMinGainPerMinute;
+    return mStop;
+}
+
+void
+AdaptiveConvergenceEstimator::fit()
+{
+    if (mMeasurements.size() < sMinMeasurements) {
+        return;
+    }
+
+    // Least squares line through (log t, log error).
+    double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    for (const Measurement &m : mMeasurements) {
+        const double x = std::log(m.mTime);
+        const double y = std::log(m.mError);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    const double n = double(mMeasurements.size());
+    const double det = n * sumXX - sumX * sumX;
+    if (det <= 0.0) {
+        return;
+    }
+    const double slope = (n * sumXY - sumX * sumY) / det;
+    const double intercept = (sumY - slope * sumX) / n;
+
+    mHasPrediction = true;
+    const double t = mMeasurements.back().mTime;
+    if (slope >= 0.0) {
+        // Not converging any more, more time won't help.
+        mDecayExponent = 0.0;
+        mPredictedSecToTarget = std::numeric_limits<double>::infinity();
+        mErrorGainPerMinute = 0.0;
+        return;
+    }
+
+    mDecayExponent = -slope;
+    // error(t) = exp(intercept) * t^slope
+    const double targetTime = std::exp((std::log(double(mTargetError)) - intercept) / slope);
+    mPredictedSecToTarget = std::max(targetTime - t, 0.0);
+    mErrorGainPerMinute = 1.0 - std::pow((t + 60.0) / t, slope);
+}
+
+bool
+AdaptiveConvergenceEstimator::shouldStop() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStop;
+}
+
+bool
+AdaptiveConvergenceEstimator::hasPrediction() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHasPrediction;
+}
+
+double
+AdaptiveConvergenceEstimator::getDecayExponent() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDecayExponent;
+}
+
+double
+AdaptiveConvergenceEstimator::getPredictedSecToTarget() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPredictedSecToTarget;
+}
+
+double
+AdaptiveConvergenceEstimator::getErrorGainPerMinute() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mErrorGainPerMinute;
+}
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,70 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+namespace moonray {
+namespace rndr {
+
+// Predicts how the adaptive sampling error of a frame goes down over the render time.
+//
+// The render threads feed it the current AdaptiveRegions::getError(). It fits the recent
+// measurements to error(t) = a * t^-b (b is 0.5 for plain Monte Carlo convergence), which
+// gives the time left to reach the target error and the fraction of the error the next
+// minute of rendering would remove. A frame can be stopped once that gain falls below a
+// threshold, as it would otherwise spend its remaining time on barely visible changes.
+class AdaptiveConvergenceEstimator
+{
+public:
+    // Measurements closer in time are dropped.
+    static constexpr double sMinInterval = 1.0;
+    // Only the most recent measurements are fitted, the early decay is usually steeper.
+    static constexpr unsigned sMaxMeasurements = 16;
+    // Nothing is predicted before this many measurements.
+    static constexpr unsigned sMinMeasurements = 4;
+
+    // minGainPerMinute is the fraction of the current error (0 disables the stop).
+    void reset(double startTime, float targetError, float minGainPerMinute);
+
+    // Adds the error measured at 'time' (seconds, same clock as startTime). Thread-safe,
+    // returns without waiting if another thread is adding one. Returns true once the
+    // frame should stop, and from then on.
+    bool update(double time, float error);
+
+    bool shouldStop() const;
+
+    // False until enough measurements were fitted, the predictions are 0 then.
+    bool hasPrediction() const;
+    double getDecayExponent() const;
+    double getPredictedSecToTarget() const; // from the last measurement
+    double getErrorGainPerMinute() const;   // fraction of the current error
+
+private:
+    struct Measurement
+    {
+        double mTime;  // since the start
+        double mError;
+    };
+
+    void fit();
+
+    mutable std::mutex mMutex;
+    double mStartTime {0.0};
+    float mTargetError {0.0f};
+    float mMinGainPerMinute {0.0f};
+    std::deque<Measurement> mMeasurements;
+
+    bool mHasPrediction {false};
+    double mDecayExponent {0.0};
+    double mPredictedSecToTarget {0.0};
+    double mErrorGainPerMinute {0.0};
+    bool mStop {false};
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,153 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "AdaptiveErrorMetric.h"
+
+#include <algorithm>
+
+namespace moonray {
+namespace rndr {
+
+namespace {
+
+using AdaptiveNS::TileRowSamples;
+
+inline float luma(float r, float g, float b) { return 0.299f * r + 0.587f * g + 0.114f * b; }
+
+class LuminanceErrorMetric : public AdaptiveErrorMetric
+//
+// Variation on the error metric proposed in the paper "A Hierarchical Automatic Stopping Condition for Monte Carlo
+// Global Illumination", by Dammertz et al. The luminance difference is normalized by sqrt of the luminance to
+// approximate eye's response to linear light (i.e. fake a pseudo gamma curve).
+//
+{
+public:
+    void estimate(const TileRowSamples& s, float* __restrict errors) const override
+    {
+        for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+            const float lumDiff = luma(s.absDiff(0, i), s.absDiff(1, i), s.absDiff(2, i));
+            const float lumAvg = luma(s.mean(0, i), s.mean(1, i), s.mean(2, i));
+            const float alphaScore = s.absDiff(3, i);
+
+            // Radiance is pure black. Return the difference in the alpha to see if there's still work to do.
+            errors[i] = (lumAvg <= 0.0f) ? alphaScore : lumDiff / std::sqrt(lumAvg) + alphaScore;
+        }
+    }
+
+    AdaptiveErrorMetricType getType() const override { return AdaptiveErrorMetricType::LUMINANCE; }
+};
+
+class RelativeErrorMetric : public AdaptiveErrorMetric
+//
+// Luminance difference relative to the luminance. Noise in dark areas counts as much as noise in bright areas,
+// which suits comp work where the plates get graded up. The epsilon keeps black pixels from dominating.
+//
+{
+public:
+    void estimate(const TileRowSamples& s, float* __restrict errors) const override
+    {
+        constexpr float sEpsilon = 0.001f;
+
+        for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+            const float lumDiff = luma(s.absDiff(0, i), s.absDiff(1, i), s.absDiff(2, i));
+            const float lumAvg = luma(s.mean(0, i), s.mean(1, i), s.mean(2, i));
+            errors[i] = lumDiff / (std::max(lumAvg, 0.0f) + sEpsilon) + s.absDiff(3, i);
+        }
+    }
+
+    AdaptiveErrorMetricType getType() const override { return AdaptiveErrorMetricType::RELATIVE; }
+};
+
+class MaxChannelErrorMetric : public AdaptiveErrorMetric
+//
+// Max over the color channels of the difference normalized by sqrt of the channel value. Chromatic noise, such
+// as from saturated light sources which end up in separate light AOVs, is hidden by the luminance but not here.
+//
+{
+public:
+    void estimate(const TileRowSamples& s, float* __restrict errors) const override
+    {
+        for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+            float error = 0.0f;
+            for (int c = 0; c < 3; ++c) {
+                const float avg = s.mean(c, i);
+                const float channelError = (avg <= 0.0f) ? 0.0f : s.absDiff(c, i) / std::sqrt(avg);
+                error = std::max(error, channelError);
+            }
+            errors[i] = error + s.absDiff(3, i);
+        }
+    }
+
+    AdaptiveErrorMetricType getType() const override { return AdaptiveErrorMetricType::MAX_CHANNEL; }
+};
+
+class TonemappedErrorMetric : public AdaptiveErrorMetric
+//
+// Luminance difference of the even and odd halves after a Reinhard tonemap (x / (1 + x)), as a cheap stand-in for
+// the display transform. Noise in highlights which compress to white on display stops driving the samples.
+//
+{
+public:
+    void estimate(const TileRowSamples& s, float* __restrict errors) const override
+    {
+        auto tonemap = [](float v) { v = std::max(v, 0.0f); return v / (1.0f + v); };
+
+        for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+            float diff[3];
+            for (int c = 0; c < 3; ++c) {
+                diff[c] = std::abs(tonemap(s.evenMean(c, i)) - tonemap(s.oddMean(c, i)));
+            }
+            errors[i] = luma(diff[0], diff[1], diff[2]) + s.absDiff(3, i);
+        }
+    }
+
+    AdaptiveErrorMetricType getType() const override { return AdaptiveErrorMetricType::TONEMAPPED; }
+};
+
+} // namespace
+
+// static function
+std::unique_ptr<AdaptiveErrorMetric>
+AdaptiveErrorMetric::create(AdaptiveErrorMetricType type)
+{
+    switch (type) {
+    case AdaptiveErrorMetricType::RELATIVE : return std::make_unique<RelativeErrorMetric>();
+    case AdaptiveErrorMetricType::MAX_CHANNEL : return std::make_unique<MaxChannelErrorMetric>();
+    case AdaptiveErrorMetricType::TONEMAPPED : return std::make_unique<TonemappedErrorMetric>();
+    default : return std::make_unique<LuminanceErrorMetric>();
+    }
+}
+
+// static function
+std::string
+AdaptiveErrorMetric::typeStr(AdaptiveErrorMetricType type)
+{
+    switch (type) {
+    case AdaptiveErrorMetricType::LUMINANCE : return "luminance";
+    case AdaptiveErrorMetricType::RELATIVE : return "relative";
+    case AdaptiveErrorMetricType::MAX_CHANNEL : return "max_channel";
+    case AdaptiveErrorMetricType::TONEMAPPED : return "tonemapped";
+    default : return "?";
+    }
+}
+
+// static function
+bool
+AdaptiveErrorMetric::parseType(const std::string& str, AdaptiveErrorMetricType& type)
+{
+    for (AdaptiveErrorMetricType t : {AdaptiveErrorMetricType::LUMINANCE,
+                                      AdaptiveErrorMetricType::RELATIVE,
+                                      AdaptiveErrorMetricType::MAX_CHANNEL,
+                                      AdaptiveErrorMetricType::TONEMAPPED}) {
+        if (str == typeStr(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,115 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <moonray/common/mcrt_util/Atomic.h>
+#include <moonray/rendering/rndr/Types.h>
+
+#include <scene_rdl2/common/fb_util/FbTypes.h>
+#include <scene_rdl2/common/math/Vec4.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+namespace moonray {
+namespace rndr {
+
+namespace AdaptiveNS
+{
+
+// Beauty values of one row of a tile (8 horizontally adjacent pixels which are stored contiguously in the tiled
+// buffers) in structure-of-arrays form, so that the error metrics can evaluate all the lanes by a vectorized loop.
+struct TileRowSamples
+{
+    static constexpr int sLanes = 8;
+
+    // Atomically loads the pixels. Returns false if some pixel doesn't have both even and odd samples yet.
+    bool load(const float* const sampleCountPointer,
+              const scene_rdl2::fb_util::RenderColor* const totalColorPointer,
+              const scene_rdl2::fb_util::RenderColor* const oddColorPointer)
+    {
+        for (int i = 0; i < sLanes; ++i) {
+            mTotalSamples[i] = util::atomicLoad(sampleCountPointer + i, std::memory_order_relaxed);
+
+            alignas(util::kDoubleQuadWordAtomicAlignment) scene_rdl2::math::Vec4f totalColor;
+            util::atomicLoadFloat4(&totalColor[0], &(totalColorPointer[i][0]));
+            alignas(util::kDoubleQuadWordAtomicAlignment) scene_rdl2::math::Vec4f oddColor;
+            util::atomicLoadFloat4(&oddColor[0], &(oddColorPointer[i][0]));
+            for (int c = 0; c < 4; ++c) {
+                mTotal[c][i] = totalColor[c];
+                mOdd[c][i] = oddColor[c];
+            }
+        }
+
+        int invalid = 0;
+        for (int i = 0; i < sLanes; ++i) {
+            mNumOddSamples[i] = std::floor(mTotalSamples[i] * 0.5f);
+            mNumEvenSamples[i] = mTotalSamples[i] - mNumOddSamples[i];
+            invalid |= (mNumEvenSamples[i] <= 0.0f || mNumOddSamples[i] <= 0.0f);
+        }
+        return !invalid;
+    }
+
+    //
+    //            even_color          oddColor
+    //   diff = ---------------  -  -------------
+    //          numEvenSamples      numOddSamples
+    //
+    // where even_color = totalColor - oddColor, refactored to remove one of the divides.
+    //
+    float absDiff(int c, int i) const
+    {
+        return std::abs((mTotal[c][i] * mNumOddSamples[i] - mOdd[c][i] * mTotalSamples[i]) /
+                        (mNumOddSamples[i] * mNumEvenSamples[i]));
+    }
+
+    float mean(int c, int i) const { return mTotal[c][i] / mTotalSamples[i]; }
+    float evenMean(int c, int i) const { return (mTotal[c][i] - mOdd[c][i]) / mNumEvenSamples[i]; }
+    float oddMean(int c, int i) const { return mOdd[c][i] / mNumOddSamples[i]; }
+
+    bool isnan(int i) const
+    {
+        return std::isnan(mTotal[0][i]) || std::isnan(mTotal[1][i]) ||
+               std::isnan(mTotal[2][i]) || std::isnan(mTotal[3][i]) ||
+               std::isnan(mOdd[0][i]) || std::isnan(mOdd[1][i]) ||
+               std::isnan(mOdd[2][i]) || std::isnan(mOdd[3][i]);
+    }
+
+    alignas(32) float mTotalSamples[sLanes];
+    alignas(32) float mNumOddSamples[sLanes];
+    alignas(32) float mNumEvenSamples[sLanes];
+    alignas(32) float mTotal[4][sLanes];
+    alignas(32) float mOdd[4][sLanes];
+};
+
+} // namespace AdaptiveNS
+
+class AdaptiveErrorMetric
+//
+// Per pixel error estimation of the adaptive sampling from the difference between the even and odd sample halves
+// of the beauty. The metric decides which pixels the adaptive tree keeps sampling, so a show can spend the samples
+// where the noise is visible for its pipeline. All the metrics add the alpha difference to resolve edges.
+//
+// Only the beauty accumulates the odd samples, the AOV buffers don't have the odd half to estimate their error.
+//
+{
+public:
+    virtual ~AdaptiveErrorMetric() = default;
+
+    // Computes the error of all the lanes. Lanes with NaN colors are handled by the caller.
+    virtual void estimate(const AdaptiveNS::TileRowSamples& samples, float* __restrict errors) const = 0;
+
+    virtual AdaptiveErrorMetricType getType() const = 0;
+
+    static std::unique_ptr<AdaptiveErrorMetric> create(AdaptiveErrorMetricType type);
+
+    static std::string typeStr(AdaptiveErrorMetricType type);
+    static bool parseType(const std::string& str, AdaptiveErrorMetricType& type);
+};
+
+} // namespace rndr
+} // namespace moonray
+
@@ -18,6 +18,9 @@
 #include <ostream>
 #include <functional>
 
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
 namespace moonray {
 namespace rndr {
 
@@ -72,27 +75,72 @@ int AdaptiveRegionTree::maxNodes(const scene_rdl2::math::BBox2i& bounds)
     return 2*nLeafNodes - 1;
 }
 
-/// @return Average error of leaf nodes.
-float AdaptiveRegionTree::update(const scene_rdl2::fb_util::Tiler& tiler,
-                                 const scene_rdl2::fb_util::RenderBuffer& renderBuf,
-                                 const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
-                                 const scene_rdl2::fb_util::RenderBuffer& renderBufOdd)
+bool AdaptiveRegionTree::updatePixelErrors(const scene_rdl2::fb_util::Tiler& tiler,
+                                           const scene_rdl2::fb_util::RenderBuffer& renderBuf,
+                                           const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
+                                           const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
+                                           const AdaptiveErrorMetric& metric,
+                                           bool parallel)
 {
-    // On update, we rebuild the entire tree so that it gets rebalanced.
-    mRoot.mChildren = nullptr;
-    mRoot.mStatus = Node::Status::unconverged;
-    mNodePool.clear();
-
-    // mIntegerRootBounds should be closed-open (inclusive-exclusive).
-    for (auto pit = begin(mIntegerRootBounds); pit != end(mIntegerRootBounds); ++pit) {
-        const scene_rdl2::math::Vec2i& p = *pit;
-        const scene_rdl2::math::Vec2i pRelative = p - mIntegerRootBounds.lower;
-        float pixelError = getPixelError(p[0], p[1], tiler, renderBuf, numSamplesBuf, renderBufOdd);
-        if (std::isinf(pixelError)) {
-            return pixelError;
+    // Regions smaller than this are not worth the overhead of the parallel loop.
+    constexpr int sMinParallelPixels = 64 * 1024;
+
+    // The old tree is no longer valid, even if we end up with an infinite error.
+    resetTree();
+
+    const int x0 = mIntegerRootBounds.lower[0];
+    const int x1 = mIntegerRootBounds.upper[0];
+    const int y0 = mIntegerRootBounds.lower[1];
+    const int y1 = mIntegerRootBounds.upper[1];
+
+    const float* const numSamples = numSamplesBuf.getData();
+    const scene_rdl2::fb_util::RenderColor* const totalColors = renderBuf.getData();
+    const scene_rdl2::fb_util::RenderColor* const oddColors = renderBufOdd.getData();
+
+    std::atomic<bool> infinite(false);
+    auto updateRow = [&](int y) {
+        // Every span is one row of a tile, the pixels are contiguous in the tiled buffers. The first and last spans
+        // may stick out of the region if it is not tile aligned, those pixels are evaluated but not stored.
+        alignas(32) float errors[8];
+        for (int spanX = x0 & ~7; spanX < x1; spanX += 8) {
+            const size_t offset = tiler.linearCoordsToTiledOffset(static_cast<unsigned>(spanX),
+                                                                  static_cast<unsigned>(y));
+            if (!AdaptiveNS::estimateTileRowPixelErrors(numSamples + offset,
+                                                        totalColors + offset,
+                                                        oddColors + offset,
+                                                        metric,
+                                                        errors)) {
+                infinite = true;
+                return;
+            }
+            const int startX = std::max(spanX, x0);
+            const int endX = std::min(spanX + 8, x1);
+            for (int x = startX; x < endX; ++x) {
+                mPixelErrors(x - x0, y - y0) = errors[x - spanX];
+            }
+        }
+    };
+
+    if (parallel && (x1 - x0) * (y1 - y0) >= sMinParallelPixels) {
+        // The caller holds the exclusive lock of this region. Isolation keeps this thread from picking up an outer
+        // render task while it waits for the rows, which might try to lock the same region.
+        tbb::this_task_arena::isolate([&]() {
+            tbb::parallel_for(y0, y1, [&](int y) {
+                if (!infinite.load(std::memory_order_relaxed)) updateRow(y);
+            });
+        });
+    } else {
+        for (int y = y0; y < y1 && !infinite; ++y) {
+            updateRow(y);
         }
-        mPixelErrors(pRelative[0], pRelative[1]) = pixelError;
     }
+    return !infinite;
+}
+
+/// @return Average error of leaf nodes.
+float AdaptiveRegionTree::updateTree()
+{
+    resetTree();
     const float error = updateImpl(mRoot);
     return error;
 }
@@ -132,11 +180,13 @@ float AdaptiveRegionTree::updateImpl(Node& node)
 
     const float vr = volume(node.mBounds);
     const float error = calculateAreaError(accumulatedError.back(), vr);
+    const float targetError = getTargetError(node.mBounds);
+    node.mErrorRatio = (targetError > 0.0f) ? error / targetError : std::numeric_limits<float>::infinity();
 
-    if (error < mTargetError && lengthAlongSplit < sMaxNodeSize) {
+    if (error < targetError && lengthAlongSplit < sMaxNodeSize) {
         node.mStatus = Node::Status::complete;
         return error;
-    } else if (error < mTargetError*sSplitThreshold && lengthAlongSplit > sMinNodeSize*2) { // We can split in half
+    } else if (error < targetError*sSplitThreshold && lengthAlongSplit > sMinNodeSize*2) { // We can split in half
         const float offset = findSplitLocation(accumulatedError, lengthAlongSplit);
         MNRY_ASSERT(!noSplit(offset));
         if (unlikely(noSplit(offset))) {
@@ -203,6 +253,22 @@ ActivePixelMask AdaptiveRegionTree::getSampleAreaImpl(const scene_rdl2::math::BB
     return mask;
 }
 
+float AdaptiveRegionTree::getErrorRatioImpl(const scene_rdl2::math::BBox2i& tile, const Node& node) const
+{
+    if (node.mStatus == Node::Status::complete) {
+        return 0.0f;
+    }
+    const auto isect = intersect(node.mBounds, toFloat(tile));
+    if (isect.empty() || volume(isect) <= 0) {
+        return 0.0f;
+    }
+
+    if (hasChildren(node)) {
+        return std::max(getErrorRatioImpl(tile, node.getLeftChild()), getErrorRatioImpl(tile, node.getRightChild()));
+    }
+    return node.mErrorRatio;
+}
+
 void AdaptiveRegionTree::svg(std::ostream& outs) const
 {
     const char* header = R"(<?xml version="1.0" encoding="UTF-8" ?>)";
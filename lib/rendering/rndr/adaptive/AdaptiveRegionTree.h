@@ -5,6 +5,7 @@
 #pragma once
 
 #include "ActivePixelMask.h"
+#include "AdaptiveErrorMetric.h"
 #include <moonray/common/mcrt_util/Atomic.h>
 
 #include <scene_rdl2/common/fb_util/FbTypes.h>
@@ -21,6 +22,7 @@
 #include <atomic>
 #include <iosfwd>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <numeric>
 
@@ -114,6 +116,32 @@ estimatePixelErrorInternal(unsigned px,
     return (lumDiff * scene_rdl2::math::rsqrt(lumAvg)) + alphaScore;
 }
 
+//
+// Batch version of estimatePixelErrorInternal for one row of a tile (8 horizontally adjacent pixels), which is
+// stored contiguously in the tiled buffers. The pixel values are atomically loaded into structure-of-arrays form
+// first, then the error is evaluated for all the lanes by the metric, whose loop the compiler vectorizes.
+// @return false if some pixel doesn't have both even and odd samples yet (i.e. the error is infinite).
+//
+inline bool
+estimateTileRowPixelErrors(const float* const sampleCountPointer,
+                           const scene_rdl2::fb_util::RenderColor* const totalColorPointer,
+                           const scene_rdl2::fb_util::RenderColor* const oddColorPointer,
+                           const AdaptiveErrorMetric& metric,
+                           float* __restrict errors)
+{
+    TileRowSamples samples;
+    if (!samples.load(sampleCountPointer, totalColorPointer, oddColorPointer)) {
+        return false;
+    }
+    metric.estimate(samples, errors);
+    for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+        if (samples.isnan(i)) {
+            errors[i] = 0.0f;
+        }
+    }
+    return true;
+}
+
 /// @function orientedAccumulatedPixelError
 /// The partial sum of errors in a direction is used for finding a split location when subdividing a tree node.
 /// @return This returns a partial sum of sums along an axis in _region_
@@ -145,15 +173,25 @@ orientedAccumulatedPixelError(const scene_rdl2::math::BBox2i& baseRegion,
     // past its capacity: we may run out of space as it has to move all of its elements later in the array.
     std::vector<float, AdaptiveNS::PoolAllocator<float>> marginalErrors(length, 0.0f, allocator);
 
-    // This doesn't work on ICC 15 for some reason. It works on other compilers. :-/
-    //for (auto p : region) {
-
-    for (auto pit = begin(region); pit != end(region); ++pit) {
-        const scene_rdl2::math::Vec2i& p = *pit;
-        const scene_rdl2::math::Vec2i pBaseRelative = p - baseRegion.lower;
-        const int idx = p[axis] - region.lower[axis];
-        const float pixelError = pixelErrors(pBaseRelative[0], pBaseRelative[1]);
-        marginalErrors[idx] += pixelError;
+    // The loops are written per axis (instead of iterating over the region with BBox2iIterator) so that the inner
+    // loop is a contiguous add (horizontal) or a reduction (vertical) along the row, both of which vectorize.
+    const int x0 = region.lower[0] - baseRegion.lower[0];
+    const int x1 = region.upper[0] - baseRegion.lower[0];
+    const int y0 = region.lower[1] - baseRegion.lower[1];
+    const int y1 = region.upper[1] - baseRegion.lower[1];
+    float* __restrict marginal = marginalErrors.data();
+    for (int y = y0; y < y1; ++y) {
+        if (axis == 0) {
+            for (int x = x0; x < x1; ++x) {
+                marginal[x - x0] += pixelErrors(x, y);
+            }
+        } else {
+            float rowError = 0.0f;
+            for (int x = x0; x < x1; ++x) {
+                rowError += pixelErrors(x, y);
+            }
+            marginal[y - y0] += rowError;
+        }
     }
 
     std::partial_sum(marginalErrors.begin(), marginalErrors.end(), marginalErrors.begin());
@@ -214,6 +252,8 @@ class AdaptiveRegionTree
         scene_rdl2::math::BBox2f mBounds;
         Node* mChildren{nullptr};
         Status mStatus{Status::unconverged};
+        // Error of the node over its target error as of the last update, infinite before the first one.
+        float mErrorRatio{std::numeric_limits<float>::infinity()};
     };
 
     static bool hasChildren(const Node& n) noexcept
@@ -288,6 +328,8 @@ public:
     : mRoot()
     , mIntegerRootBounds()
     , mTargetError(0)
+    , mFocus(0.0f, 0.0f)
+    , mFocusRadius(0.0f)
     , mPixelErrors()
     , mNodePool(0)
     , mAccumulatedErrorPool(0)
@@ -298,6 +340,8 @@ public:
     : mRoot()
     , mIntegerRootBounds(bounds)
     , mTargetError(targetError)
+    , mFocus(0.0f, 0.0f)
+    , mFocusRadius(0.0f)
     , mPixelErrors(extents(bounds, 0), extents(bounds, 1))
     , mNodePool(maxNodes(bounds))
     , mAccumulatedErrorPool(std::max(extents(bounds, 0), extents(bounds, 1)))
@@ -315,14 +359,69 @@ public:
         return getSampleAreaImpl(tile, mRoot);
     }
 
+    // Largest error over target error ratio of the unconverged leaf nodes overlapping the tile, 0 when the tile is
+    // converged. Values close to 1 mean the pixels of the tile are about to converge.
+    float getErrorRatio(const scene_rdl2::math::BBox2i& tile) const
+    {
+        return getErrorRatioImpl(tile, mRoot);
+    }
+
     /// @return Max error of leaf nodes.
     float update(const scene_rdl2::fb_util::Tiler& tiler,
                  const scene_rdl2::fb_util::RenderBuffer& renderBuf,
                  const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
-                 const scene_rdl2::fb_util::RenderBuffer& renderBufOdd);
+                 const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
+                 const AdaptiveErrorMetric& metric,
+                 bool parallel = false)
+    {
+        if (!updatePixelErrors(tiler, renderBuf, numSamplesBuf, renderBufOdd, metric, parallel)) {
+            return std::numeric_limits<float>::infinity();
+        }
+        return updateTree();
+    }
+
+    // The update is split into two stages so that the caller can profile them separately.
+    // updatePixelErrors() evaluates the error of every pixel in the region. The rows are independent, so they
+    // are evaluated in parallel when parallel is true and the region is big enough.
+    /// @return false if some pixel doesn't have both even and odd samples yet (the error is infinite).
+    bool updatePixelErrors(const scene_rdl2::fb_util::Tiler& tiler,
+                           const scene_rdl2::fb_util::RenderBuffer& renderBuf,
+                           const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
+                           const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
+                           const AdaptiveErrorMetric& metric,
+                           bool parallel);
+
+    // Rebuilds the entire tree from the pixel errors so that it gets rebalanced.
+    /// @return Max error of leaf nodes.
+    float updateTree();
 
     bool done() const noexcept { return mRoot.mStatus == Node::Status::complete; }
 
+    // Region of interest. The target error of a node grows with the square of its distance from the focus
+    // point (pixel coordinates) beyond radius, in units of radius, so the samples go to the region around the
+    // focus point first while the rest of the image still converges, only to a looser error. A radius of 0
+    // removes the focus. Takes effect at the next update.
+    void setFocus(const scene_rdl2::math::Vec2f& focus, float radius) noexcept
+    {
+        mFocus = focus;
+        mFocusRadius = radius;
+    }
+
+    float getTargetError(const scene_rdl2::math::BBox2f& bounds) const noexcept
+    {
+        // A node is never relaxed by more than this, so the far end of the image still gets some samples.
+        constexpr float sMaxFocusFalloff = 64.0f;
+
+        if (mFocusRadius <= 0.0f) {
+            return mTargetError;
+        }
+        // Distance from the closest point of the node, so no node overlapping the focus region is relaxed.
+        const float dx = std::max({bounds.lower[0] - mFocus[0], mFocus[0] - bounds.upper[0], 0.0f});
+        const float dy = std::max({bounds.lower[1] - mFocus[1], mFocus[1] - bounds.upper[1], 0.0f});
+        const float d = std::max(scene_rdl2::math::sqrt(dx * dx + dy * dy) - mFocusRadius, 0.0f) / mFocusRadius;
+        return mTargetError * std::min(1.0f + d * d, sMaxFocusFalloff);
+    }
+
     void svg(std::ostream& outs) const;
 
     bool savePixelErrorsByPPM(const std::string& filename) const; // for debug
@@ -335,6 +434,7 @@ public:
 
 private:
     ActivePixelMask getSampleAreaImpl(const scene_rdl2::math::BBox2i& tile, const Node& node) const;
+    float getErrorRatioImpl(const scene_rdl2::math::BBox2i& tile, const Node& node) const;
 
     static float calculateAreaError(float error, float nodeArea)
     {
@@ -369,6 +469,14 @@ private:
         return AdaptiveNS::estimatePixelErrorInternal(px, py, tiler, renderBuf, numSamplesBuf, renderBufOdd);
     }
 
+    // On update, we rebuild the entire tree so that it gets rebalanced.
+    void resetTree()
+    {
+        mRoot.mChildren = nullptr;
+        mRoot.mStatus = Node::Status::unconverged;
+        mNodePool.clear();
+    }
+
     /// @return Average error of leaf nodes.
     float updateImpl(Node& node);
 
@@ -424,6 +532,8 @@ private:
     Node mRoot;
     scene_rdl2::math::BBox2i mIntegerRootBounds; // We can get the bounds from the root node, but they're in floats.
     float mTargetError;
+    scene_rdl2::math::Vec2f mFocus;
+    float mFocusRadius; // 0 : no focus
     scene_rdl2::util::Array2D<float> mPixelErrors;
     AdaptiveNS::MemoryPool<Node> mNodePool;
     AdaptiveNS::MemoryPool<float> mAccumulatedErrorPool;
@@ -9,6 +9,10 @@
 #include <moonray/rendering/pbr/core/PbrTLState.h>
 #include <moonray/rendering/shading/Material.h>
 
+#include <scene_rdl2/common/rec_time/RecTime.h>
+
+#include <tbb/parallel_for.h>
+
 #include <algorithm>
 #include <iomanip>
 #include <limits>
@@ -45,15 +49,34 @@ void AdaptiveRegions::init(scene_rdl2::math::BBox2i renderBounds, float targetEr
         const scene_rdl2::math::BBox2i bounds = mRegions.getOverlappingRegionBounds(i);
 
         mTrees[i] = AdaptiveRegionTree(bounds, targetError);
+        mTrees[i].setFocus(mFocus, mFocusRadius);
         mRegionError[i] = std::numeric_limits<float>::max();
         mDone[i] = false;
         mRegionTileCount[i].value = mNumTiles[i] = tilesHorizontal(extents(bounds, 0)) *
                                                    tilesVertical(extents(bounds, 1));
         mAdaptiveTreeUpdateCounter[i] = 0;
+        mPixelErrorSec[i] = 0.0;
+        mTreeBuildSec[i] = 0.0;
     }
     disableAdjustUpdateTiming();
 }
 
+void AdaptiveRegions::setErrorMetric(AdaptiveErrorMetricType type)
+{
+    if (!mErrorMetric || mErrorMetric->getType() != type) {
+        mErrorMetric = AdaptiveErrorMetric::create(type);
+    }
+}
+
+void AdaptiveRegions::setFocus(const scene_rdl2::math::Vec2f& focus, float radius)
+{
+    mFocus = focus;
+    mFocusRadius = std::max(radius, 0.0f);
+    for (int i = 0; i < mRegions.getNumRegions(); ++i) {
+        mTrees[i].setFocus(mFocus, mFocusRadius);
+    }
+}
+
 void AdaptiveRegions::update(const scene_rdl2::math::BBox2i& tile,
                              const scene_rdl2::fb_util::Tiler& tiler,
                              const scene_rdl2::fb_util::RenderBuffer& renderBuf,
@@ -131,7 +154,7 @@ void AdaptiveRegions::update(const scene_rdl2::math::BBox2i& tile,
                 // saveFloatBufferByPPM(idx, tiler, numSamplesBuf);
 
                 // We have to update adaptive tree
-                const float error = mTrees[idx].update(tiler, renderBuf, numSamplesBuf, renderBufOdd);
+                const float error = updateTree(idx, tiler, renderBuf, numSamplesBuf, renderBufOdd, tls);
                 mRegionError[idx].store(error, std::memory_order_relaxed);
                 mDone[idx].store(mTrees[idx].done(), std::memory_order_relaxed);
 
@@ -159,16 +182,62 @@ AdaptiveRegions::updateAll(const scene_rdl2::fb_util::Tiler& tiler,
                            const scene_rdl2::fb_util::RenderBuffer& renderBufOdd)
 //
 // This function is only called at initialization stage (i.e. before start MCRT) of resume render
-// by single thread
+// by single thread. Trees are independent, so all the regions are updated in parallel.
 //
 {
-    for (int idx = 0; idx < sMaxNRegions; ++idx) { // Can we do by MT?
-        const float error = mTrees[idx].update(tiler, renderBuf, numSamplesBuf, renderBufOdd);
+    tbb::parallel_for(0, sMaxNRegions, [&](int idx) {
+        const float error = updateTree(idx, tiler, renderBuf, numSamplesBuf, renderBufOdd, nullptr);
         mRegionError[idx].store(error, std::memory_order_relaxed);
 
         // savePixelErrorsByPPM(idx); // useful debug dump all pixelError info to the disk as image
         ++mAdaptiveTreeUpdateCounter[idx];
         mDone[idx].store(mTrees[idx].done(), std::memory_order_relaxed);
+    });
+}
+
+float
+AdaptiveRegions::updateTree(const int idx,
+                            const scene_rdl2::fb_util::Tiler& tiler,
+                            const scene_rdl2::fb_util::RenderBuffer& renderBuf,
+                            const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
+                            const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
+                            mcrt_common::ThreadLocalState* tls)
+//
+// Updates the adaptive tree of the region and records the time of the pixel error evaluation and the tree build
+// separately. The caller has to own the region (exclusive lock or single thread). tls is nullptr outside of MCRT.
+//
+{
+    scene_rdl2::rec_time::RecTime recTime;
+
+    recTime.start();
+    bool valid;
+    if (tls) {
+        EXCL_ACCUMULATOR_PROFILE(tls, EXCL_ADAPTIVE_PIXEL_ERROR);
+        valid = mTrees[idx].updatePixelErrors(tiler, renderBuf, numSamplesBuf, renderBufOdd, *mErrorMetric, true);
+    } else {
+        valid = mTrees[idx].updatePixelErrors(tiler, renderBuf, numSamplesBuf, renderBufOdd, *mErrorMetric, true);
+    }
+    mPixelErrorSec[idx] += recTime.end();
+    if (!valid) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    recTime.start();
+    const float error = mTrees[idx].updateTree();
+    mTreeBuildSec[idx] += recTime.end();
+    return error;
+}
+
+void
+AdaptiveRegions::getUpdateStats(unsigned& updateTotal, double& pixelErrorSec, double& treeBuildSec) const
+{
+    updateTotal = 0;
+    pixelErrorSec = 0.0;
+    treeBuildSec = 0.0;
+    for (int idx = 0; idx < mRegions.getNumRegions(); ++idx) {
+        updateTotal += mAdaptiveTreeUpdateCounter[idx];
+        pixelErrorSec += mPixelErrorSec[idx];
+        treeBuildSec += mTreeBuildSec[idx];
     }
 }
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "ActivePixelMask.h"
+#include "AdaptiveErrorMetric.h"
 #include "AdaptiveRegionTree.h"
 #include "OverlappingRegions.h"
 #include "UpdateSentinel.h"
@@ -19,6 +20,7 @@
 
 #include <array>
 #include <atomic>
+#include <memory>
 
 namespace moonray {
 namespace rndr {
@@ -63,12 +65,21 @@ class AdaptiveRegions
     }
 
 public:
-    AdaptiveRegions() = default;
+    AdaptiveRegions() : mErrorMetric(AdaptiveErrorMetric::create(AdaptiveErrorMetricType::LUMINANCE)) {}
 
     using VisitedArray = std::array<bool, sMaxNRegions>;
 
     void init(scene_rdl2::math::BBox2i renderBounds, float targetError, bool vectorized);
 
+    // The metric is kept over init(). It has to be set before the render starts, the trees are updated with it.
+    void setErrorMetric(AdaptiveErrorMetricType type);
+    AdaptiveErrorMetricType getErrorMetricType() const { return mErrorMetric->getType(); }
+
+    // Focus point (pixel coordinates) and radius of the radial falloff of the target error, see
+    // AdaptiveRegionTree::setFocus(). Kept over init(), radius 0 removes the focus. Must be set
+    // before the render starts.
+    void setFocus(const scene_rdl2::math::Vec2f& focus, float radius);
+
     inline void disableAdjustUpdateTiming();
     inline void enableAdjustUpdateTiming(const std::vector<unsigned> &adaptiveIterationPixSampleIdTbl);
 
@@ -84,7 +95,13 @@ public:
                    const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
                    const scene_rdl2::fb_util::RenderBuffer& renderBufOdd);
 
+    // Total number of the tree updates and the time spent on the pixel error evaluation and on the tree build,
+    // summed over all the regions since init(). For the render stats.
+    void getUpdateStats(unsigned& updateTotal, double& pixelErrorSec, double& treeBuildSec) const;
+
     ActivePixelMask getSampleArea(const scene_rdl2::math::BBox2i& tile, mcrt_common::ThreadLocalState* tls) const;
+    // See AdaptiveRegionTree::getErrorRatio(), checked against the primary region of the tile like getSampleArea().
+    float getErrorRatio(const scene_rdl2::math::BBox2i& tile) const;
     float getError() const;
     bool done() const;
 
@@ -109,9 +126,22 @@ private:
     AdaptiveRegionTree mTrees[sMaxNRegions];
     int mNumTiles[sMaxNRegions];
 
+    std::unique_ptr<AdaptiveErrorMetric> mErrorMetric;
+    scene_rdl2::math::Vec2f mFocus{0.0f, 0.0f};
+    float mFocusRadius{0.0f};
+
     UpdateSentinel mUpdateSentinel; // adjust adaptiveTreeUpdate timing logic related code
 
     unsigned mAdaptiveTreeUpdateCounter[sMaxNRegions]; // for debug purpose. count adaptive tree update is very useful
+    double mPixelErrorSec[sMaxNRegions]; // only updated by the owner of the region
+    double mTreeBuildSec[sMaxNRegions];
+
+    float updateTree(const int idx,
+                     const scene_rdl2::fb_util::Tiler& tiler,
+                     const scene_rdl2::fb_util::RenderBuffer& renderBuf,
+                     const scene_rdl2::fb_util::FloatBuffer& numSamplesBuf,
+                     const scene_rdl2::fb_util::RenderBuffer& renderBufOdd,
+                     mcrt_common::ThreadLocalState* tls);
 
     void savePixelErrorsByPPM(const int adaptiveRegionTreeId) const; // for debug
     void saveRenderBufferByPPM(const int adaptiveRegionTreeId,
@@ -145,6 +175,13 @@ inline ActivePixelMask AdaptiveRegions::getSampleArea(const scene_rdl2::math::BB
     return mTrees[idx].getSampleArea(tile);
 }
 
+inline float AdaptiveRegions::getErrorRatio(const scene_rdl2::math::BBox2i& tile) const
+{
+    const int idx = mRegions.getRegionIndex(tile);
+    ReadLock lock(mMutexPool[idx].getMutex(tile.lower[0]/sTileWidth, tile.lower[1]/sTileHeight));
+    return mTrees[idx].getErrorRatio(tile);
+}
+
 inline float AdaptiveRegions::getError() const
 {
     float error = 0.0f;
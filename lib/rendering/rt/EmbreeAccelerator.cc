@@ -31,6 +31,9 @@
 
 #include <tbb/concurrent_unordered_map.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace scene_rdl2 {
 using namespace math;
 using namespace util;
@@ -39,10 +42,215 @@ using namespace util;
 namespace moonray {
 namespace rt {
 
+// Define the packet types which depend on the vector width
+#if (VLEN == 4u)
+    const auto& rtcIntersectv = rtcIntersect4;
+    const auto& rtcOccludedv = rtcOccluded4;
+    typedef RTCRayHit4 RTCRayHitv;
+    typedef RTCRay4 RTCRayv;
+#elif (VLEN == 8u)
+    const auto& rtcIntersectv = rtcIntersect8;
+    const auto& rtcOccludedv = rtcOccluded8;
+    typedef RTCRayHit8 RTCRayHitv;
+    typedef RTCRay8 RTCRayv;
+#elif (VLEN == 16u)
+    const auto& rtcIntersectv = rtcIntersect16;
+    const auto& rtcOccludedv = rtcOccluded16;
+    typedef RTCRayHit16 RTCRayHitv;
+    typedef RTCRay16 RTCRayv;
+#endif
+
 
 typedef tbb::concurrent_unordered_map<std::shared_ptr<geom::SharedPrimitive>,
         std::shared_ptr<std::atomic<bool>>, geom::SharedPtrHash> SharedSceneMap;
 
+// Number of primitives whose embree representation got (re)built or refit
+// during a single EmbreeAccelerator::build() call
+struct BVHUpdateCounts
+{
+    std::atomic<unsigned> mRebuilt {0};
+    std::atomic<unsigned> mRefit {0};
+    // motion steps of the (re)built meshes and curves, as tessellated and
+    // as handed to embree
+    std::atomic<unsigned> mInputMotionSteps {0};
+    std::atomic<unsigned> mBuiltMotionSteps {0};
+    // shared primitive BVH scenes built or deferred, by build quality
+    std::atomic<unsigned> mSharedScenes[3] {{0}, {0}, {0}};
+};
+
+// Shared primitives with less tessellated data than this still get a high
+// quality BVH when the build is meant to be fast, their build is short
+// either way
+constexpr size_t sFastBuildHighQualityBytes = 64 * 1024 * 1024;
+
+// Build quality of the BVH scene of a shared primitive. The rays reaching
+// any of its instances traverse that one scene, so a high quality build is
+// worth its time unless the build is meant to be fast and the prototype is
+// big. Moving prototypes get rebuilt every frame and are kept to low
+// quality builds.
+RTCBuildQuality
+getSharedSceneBuildQuality(const scene_rdl2::rdl2::Geometry* geometry, OptimizationTarget accelMode,
+        size_t sharedPrimitiveBytes)
+{
+    if (!geometry->isStatic()) {
+        return RTC_BUILD_QUALITY_LOW;
+    }
+    if (accelMode == OptimizationTarget::HIGH_QUALITY_BVH_BUILD ||
+        sharedPrimitiveBytes < sFastBuildHighQualityBytes) {
+        return RTC_BUILD_QUALITY_HIGH;
+    }
+    return RTC_BUILD_QUALITY_MEDIUM;
+}
+
+// Index of a build quality in BVHUpdateCounts::mSharedScenes
+int
+getSharedSceneQualityIndex(RTCBuildQuality quality)
+{
+    return quality == RTC_BUILD_QUALITY_HIGH ? 0 : (quality == RTC_BUILD_QUALITY_MEDIUM ? 1 : 2);
+}
+
+// Memory of the primitives of a shared primitive, the instances it contains
+// only count for themselves
+class SharedPrimitiveBytes : public geom::PrimitiveVisitor
+{
+public:
+    SharedPrimitiveBytes(): mBytes(0) {}
+
+    virtual void visitPrimitive(geom::Primitive& p) override {
+        const geom::internal::Primitive* pImpl =
+            geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&p);
+        if (pImpl != nullptr) {
+            mBytes += pImpl->getMemory();
+        }
+    }
+
+    virtual void visitPrimitiveGroup(geom::PrimitiveGroup& pg) override {
+        bool isParallel = false;
+        pg.forEachPrimitive(*this, isParallel);
+    }
+
+    virtual void visitTransformedPrimitive(geom::TransformedPrimitive& t) override {
+        t.getPrimitive()->accept(*this);
+    }
+
+    size_t mBytes;
+};
+
+size_t
+getSharedPrimitiveBytes(const std::shared_ptr<geom::SharedPrimitive>& ref)
+{
+    SharedPrimitiveBytes bytes;
+    ref->getPrimitive()->accept(bytes);
+    return bytes.mBytes;
+}
+
+// Relative to the extent of the first motion step
+constexpr float sMotionStepTolerance = 1e-6f;
+
+// Returns the stride at which the motion steps of the vertex buffers are
+// handed to embree. Steps which are, within float precision, the linear
+// interpolation of the kept steps around them carry no information: embree
+// interpolates linearly between time steps anyway and the kept steps still
+// bound the motion exactly. A primitive which doesn't move at all ends up
+// with a single time step and regular, non motion blur, BVH nodes.
+// Motion which isn't linear keeps all its steps, the geometry code
+// interpolates its own vertex buffers at ray time when shading the hit and
+// a coarser approximation in the BVH would make the two disagree.
+size_t
+getMotionStepStride(const std::vector<geom::internal::BufferDesc>& descs,
+                    size_t vertexCount, unsigned numComponents)
+{
+    const size_t mbSteps = descs.size();
+    if (mbSteps < 2 || vertexCount == 0) {
+        return 1;
+    }
+
+    auto vertex = [&](size_t step, size_t v) {
+        const geom::internal::BufferDesc& desc = descs[step];
+        return reinterpret_cast<const float*>(
+            static_cast<const char*>(desc.mData) + desc.mOffset + v * desc.mStride);
+    };
+
+    float extent = 0.f;
+    {
+        float lo[4], hi[4];
+        const float* p = vertex(0, 0);
+        for (unsigned c = 0; c < numComponents; ++c) {
+            lo[c] = hi[c] = p[c];
+        }
+        for (size_t v = 1; v < vertexCount; ++v) {
+            p = vertex(0, v);
+            for (unsigned c = 0; c < numComponents; ++c) {
+                lo[c] = std::min(lo[c], p[c]);
+                hi[c] = std::max(hi[c], p[c]);
+            }
+        }
+        for (unsigned c = 0; c < numComponents; ++c) {
+            extent = std::max(extent, hi[c] - lo[c]);
+        }
+    }
+    const float tolerance = sMotionStepTolerance * std::max(extent, 1.f);
+
+    // is every step between kept steps the interpolation of its neighbours ?
+    auto isRedundant = [&](size_t stride) {
+        for (size_t k = 0; k + stride < mbSteps; k += stride) {
+            for (size_t step = k + 1; step < k + stride; ++step) {
+                const float t = float(step - k) / float(stride);
+                for (size_t v = 0; v < vertexCount; ++v) {
+                    const float* p0 = vertex(k, v);
+                    const float* p1 = vertex(k + stride, v);
+                    const float* p = vertex(step, v);
+                    for (unsigned c = 0; c < numComponents; ++c) {
+                        const float lerp = p0[c] + t * (p1[c] - p0[c]);
+                        if (std::abs(p[c] - lerp) > tolerance) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    };
+
+    auto isStatic = [&]() {
+        for (size_t step = 1; step < mbSteps; ++step) {
+            for (size_t v = 0; v < vertexCount; ++v) {
+                const float* p0 = vertex(0, v);
+                const float* p = vertex(step, v);
+                for (unsigned c = 0; c < numComponents; ++c) {
+                    if (std::abs(p[c] - p0[c]) > tolerance) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+
+    if (isStatic()) {
+        return mbSteps;
+    }
+    // largest stride which evenly divides the motion, so the last step is kept
+    for (size_t stride = mbSteps - 1; stride > 1; --stride) {
+        if ((mbSteps - 1) % stride == 0 && isRedundant(stride)) {
+            return stride;
+        }
+    }
+    return 1;
+}
+
+// Number of motion steps kept with the given stride
+size_t
+getBuiltMotionSteps(size_t mbSteps, size_t stride)
+{
+    return mbSteps < 2 ? mbSteps : (mbSteps - 1) / stride + 1;
+}
+
+
+bool deferSharedScene(EmbreeAccelerator* accelerator, const scene_rdl2::rdl2::Layer* layer,
+        const scene_rdl2::rdl2::Geometry* geometry, RTCDevice& device, RTCSceneFlags sceneFlags,
+        OptimizationTarget accelMode, BVHUpdateCounts& updateCounts,
+        const std::shared_ptr<geom::SharedPrimitive>& ref);
 
 class BVHBuilder : public geom::PrimitiveVisitor
 {
@@ -50,16 +258,51 @@ public:
     typedef geom::internal::BVHUserData::IntersectionFilterManager IntersectionFilterManager;
 
     BVHBuilder(const scene_rdl2::rdl2::Layer* layer, const scene_rdl2::rdl2::Geometry* geometry,
-            RTCDevice& device, RTCScene& parentScene,
-            SharedSceneMap& sharedSceneMap, BVHUserDataList& userData,
-            bool getAssignments):
+            RTCDevice& device, RTCSceneFlags sceneFlags, OptimizationTarget accelMode,
+            RTCScene& parentScene, SharedSceneMap& sharedSceneMap, BVHUserDataList& userData,
+            ChangeFlag changeFlag, BVHUpdateCounts& updateCounts,
+            bool getAssignments, EmbreeAccelerator* deferTo):
         mLayer(layer), mGeometry(geometry),
-        mDevice(device), mParentScene(parentScene),
+        mDevice(device), mSceneFlags(sceneFlags), mAccelMode(accelMode), mParentScene(parentScene),
         mSharedSceneMap(sharedSceneMap), mBVHUserData(userData),
+        mChangeFlag(changeFlag), mUpdateCounts(updateCounts),
+        mDeferTo(deferTo),
         mGetAssignments(getAssignments),
         mHasVolumeAssignment(false),
         mHasSurfaceAssignment(false) {}
 
+    ~BVHBuilder() {
+        // release the geometries prepared for meshes the visit never reached
+        for (auto& prepared : mPreparedMeshes) {
+            if (prepared.second.mRtcGeom) {
+                rtcReleaseGeometry(prepared.second.mRtcGeom);
+                delete prepared.second.mUserData;
+            }
+        }
+    }
+
+    // Embree geometry of a mesh created and committed ahead of the visit,
+    // waiting to be attached to the parent scene
+    struct PreparedMesh {
+        RTCGeometry mRtcGeom;
+        geom::internal::BVHUserData* mUserData;
+        size_t mTopologyKey;
+    };
+
+    // Creates the embree geometries of the meshes without a BVH in parallel,
+    // setting up their shared index and vertex buffers, filters and user data.
+    // The visit that follows only attaches them to the parent scene, in
+    // visiting order, so the geometry ids stay deterministic.
+    void prepareMeshes(geom::Procedural& procedural) {
+        MeshPreparer preparer(*this);
+        procedural.forEachPrimitive(preparer, true);
+    }
+
+    void prepareMeshes(geom::Primitive& primitive) {
+        MeshPreparer preparer(*this);
+        primitive.accept(preparer);
+    }
+
     virtual void visitCurves(geom::Curves& c) override {
         geom::internal::Primitive* pImpl =
             geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&c);
@@ -70,10 +313,10 @@ public:
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
         if (mGeometry->isStatic() || !pCurves->isBVHInitialized()) {
-            pCurves->setBVHHandle(createCurvesInBVH(*pCurves,
+            rebuildBVHHandle(*pCurves, createCurvesInBVH(*pCurves,
                 c.getCurvesType(), c.getCurvesSubType(), c.getTessellationRate(), getGeomFlag()));
         } else {
-            pCurves->updateBVHHandle();
+            updateBVHHandle(*pCurves);
         }
     }
 
@@ -83,14 +326,30 @@ public:
         MNRY_ASSERT_REQUIRE(pImpl != nullptr);
         MNRY_ASSERT_REQUIRE(pImpl->getType() == geom::internal::Primitive::QUADRIC);
         auto pPoints =
-            static_cast<geom::internal::NamedPrimitive*>(pImpl);
+            static_cast<geom::internal::Points*>(pImpl);
+        // Points are embree sphere points when the device supports them,
+        // the user geometry callbacks are the fallback
+        const bool nativePoints = rtcGetDeviceProperty(mDevice,
+            RTC_DEVICE_PROPERTY_POINT_GEOMETRY_SUPPORTED) != 0;
         // bind the BVH representation to corresponding Primitive
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
         if (mGeometry->isStatic() || !pPoints->isBVHInitialized()) {
-            pPoints->setBVHHandle(createQuadricInBVH(*pPoints, getGeomFlag()));
+            rebuildBVHHandle(*pPoints, nativePoints ?
+                createPointsInBVH(*pPoints, getGeomFlag()) :
+                createQuadricInBVH(*pPoints, getGeomFlag()));
+        } else if (pPoints->hasSphereVertices()) {
+            // the sphere vertices are a copy of the deformed positions
+            const void* vertices = pPoints->getSphereVertices(0);
+            pPoints->updateSphereVertices();
+            if (pPoints->getSphereVertices(0) == vertices) {
+                pPoints->refitBVHHandle(pPoints->getMotionSamplesCount());
+                ++mUpdateCounts.mRefit;
+            } else {
+                rebuildBVHHandle(*pPoints, createPointsInBVH(*pPoints, getGeomFlag()));
+            }
         } else {
-            pPoints->updateBVHHandle();
+            updateBVHHandle(*pPoints);
         }
     }
 
@@ -103,10 +362,13 @@ public:
         // bind the BVH representation to corresponding Primitive
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
-        if (mGeometry->isStatic() || !pMesh->isBVHInitialized()) {
-            pMesh->setBVHHandle(createPolyMeshInBVH(*pMesh, getGeomFlag()));
+        if (!pMesh->isBVHInitialized()) {
+            rebuildBVHHandle(*pMesh, createPolyMeshInBVH(*pMesh, getGeomFlag()));
+        } else if (!mGeometry->isStatic()) {
+            updateBVHHandle(*pMesh);
         } else {
-            pMesh->updateBVHHandle();
+            // static meshes which only got deformed keep their BVH and refit it
+            refitOrRebuildMesh(*pMesh);
         }
     }
 
@@ -121,9 +383,9 @@ public:
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
         if (mGeometry->isStatic() || !pSphere->isBVHInitialized()) {
-            pSphere->setBVHHandle(createQuadricInBVH(*pSphere, getGeomFlag()));
+            rebuildBVHHandle(*pSphere, createQuadricInBVH(*pSphere, getGeomFlag()));
         } else {
-            pSphere->updateBVHHandle();
+            updateBVHHandle(*pSphere);
         }
     }
 
@@ -138,9 +400,9 @@ public:
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
         if (mGeometry->isStatic() || !pBox->isBVHInitialized()) {
-            pBox->setBVHHandle(createQuadricInBVH(*pBox, getGeomFlag()));
+            rebuildBVHHandle(*pBox, createQuadricInBVH(*pBox, getGeomFlag()));
         } else {
-            pBox->updateBVHHandle();
+            updateBVHHandle(*pBox);
         }
     }
 
@@ -153,10 +415,13 @@ public:
         // bind the BVH representation to corresponding Primitive
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
-        if (mGeometry->isStatic() || !pMesh->isBVHInitialized()) {
-            pMesh->setBVHHandle(createPolyMeshInBVH(*pMesh, getGeomFlag()));
+        if (!pMesh->isBVHInitialized()) {
+            rebuildBVHHandle(*pMesh, createPolyMeshInBVH(*pMesh, getGeomFlag()));
+        } else if (!mGeometry->isStatic()) {
+            updateBVHHandle(*pMesh);
         } else {
-            pMesh->updateBVHHandle();
+            // static meshes which only got deformed keep their BVH and refit it
+            refitOrRebuildMesh(*pMesh);
         }
     }
 
@@ -182,19 +447,29 @@ public:
         const auto& ref = i.getReference();
         // visit the referenced Primitive if it's not visited yet
         if (mSharedSceneMap.insert(std::make_pair(ref, std::make_shared<std::atomic<bool>>(false))).second) {
-            RTCScene sharedScene = rtcNewScene(mDevice);
-            rtcSetSceneBuildQuality(sharedScene, mGeometry->isStatic() ?
-                RTC_BUILD_QUALITY_HIGH : RTC_BUILD_QUALITY_LOW);
-            geom::internal::PrimitivePrivateAccess::setBVHScene(*ref,
-                static_cast<void*>(sharedScene));
-            BVHBuilder builder(mLayer, mGeometry, mDevice, sharedScene,
-                mSharedSceneMap, mBVHUserData, mGetAssignments);
-            ref->getPrimitive()->accept(builder);
-            rtcCommitScene(sharedScene);
-            // store if the reference contains volumes or surfaces
-            if (mGetAssignments) {
-                ref->setHasSurfaceAssignment(builder.getHasSurfaceAssignment());
-                ref->setHasVolumeAssignment(builder.getHasVolumeAssignment());
+            // the deferred scene gets built by the first ray reaching
+            // one of the instances of ref
+            if (!deferSharedScene(mDeferTo, mLayer, mGeometry, mDevice, mSceneFlags, mAccelMode,
+                    mUpdateCounts, ref)) {
+                RTCScene sharedScene = rtcNewScene(mDevice);
+                const RTCBuildQuality quality = getSharedSceneBuildQuality(mGeometry, mAccelMode,
+                    getSharedPrimitiveBytes(ref));
+                ++mUpdateCounts.mSharedScenes[getSharedSceneQualityIndex(quality)];
+                rtcSetSceneBuildQuality(sharedScene, quality);
+                rtcSetSceneFlags(sharedScene, mSceneFlags);
+                geom::internal::PrimitivePrivateAccess::setBVHScene(*ref,
+                    static_cast<void*>(sharedScene));
+                BVHBuilder builder(mLayer, mGeometry, mDevice, mSceneFlags, mAccelMode, sharedScene,
+                    mSharedSceneMap, mBVHUserData, mChangeFlag, mUpdateCounts, mGetAssignments,
+                    mDeferTo);
+                builder.prepareMeshes(*ref->getPrimitive());
+                ref->getPrimitive()->accept(builder);
+                rtcCommitScene(sharedScene);
+                // store if the reference contains volumes or surfaces
+                if (mGetAssignments) {
+                    ref->setHasSurfaceAssignment(builder.getHasSurfaceAssignment());
+                    ref->setHasVolumeAssignment(builder.getHasVolumeAssignment());
+                }
             }
             // mark the BVH representation of referenced primitive (group)
             // has been correctly constructed so that all the instances
@@ -214,9 +489,9 @@ public:
         // or update the BVH representation if Primitive got deformed
         // (real time frame update case)
         if (mGeometry->isStatic() || !pInstance->isBVHInitialized()) {
-            pInstance->setBVHHandle(createInstanceInBVH(*pInstance, getGeomFlag()));
+            rebuildBVHHandle(*pInstance, createInstanceInBVH(*pInstance, getGeomFlag()));
         } else {
-            pInstance->updateBVHHandle();
+            updateBVHHandle(*pInstance);
         }
     }
 
@@ -231,9 +506,9 @@ public:
             // or update the BVH representation if Primitive got deformed
             // (real time frame update case)
             if (mGeometry->isStatic() || !pVolume->isBVHInitialized()) {
-                pVolume->setBVHHandle(createVolumeInBVH(*pVolume, getGeomFlag()));
+                rebuildBVHHandle(*pVolume, createVolumeInBVH(*pVolume, getGeomFlag()));
             } else {
-                pVolume->updateBVHHandle();
+                updateBVHHandle(*pVolume);
             }
         }
     }
@@ -252,9 +527,89 @@ public:
 
 private:
 
+    void rebuildBVHHandle(geom::internal::Primitive& prim,
+            std::unique_ptr<geom::internal::BVHHandle>&& bvhHandle) {
+        prim.setBVHHandle(std::move(bvhHandle));
+        ++mUpdateCounts.mRebuilt;
+    }
+
+    void updateBVHHandle(geom::internal::Primitive& prim) {
+        prim.updateBVHHandle();
+        ++mUpdateCounts.mRefit;
+    }
+
+    // Identifies the topology and shared buffers of a tessellated mesh.
+    // Two matching keys mean the existing embree geometry still points at
+    // the right buffers and only the vertex positions may differ.
+    static size_t getMeshTopologyKey(const geom::internal::Mesh::TessellatedMesh& mesh,
+                                     size_t motionStepStride) {
+        size_t key = 0;
+        auto combine = [&key](size_t v) {
+            key ^= std::hash<size_t>()(v) + 0x9e3779b9 + (key << 6) + (key >> 2);
+        };
+        combine(static_cast<size_t>(mesh.mIndexBufferType));
+        combine(mesh.mFaceCount);
+        combine(mesh.mVertexCount);
+        combine(reinterpret_cast<size_t>(mesh.mIndexBufferDesc.mData));
+        combine(mesh.mIndexBufferDesc.mOffset);
+        combine(mesh.mIndexBufferDesc.mStride);
+        combine(mesh.mVertexBufferDesc.size());
+        combine(motionStepStride);
+        for (const auto& desc : mesh.mVertexBufferDesc) {
+            combine(reinterpret_cast<size_t>(desc.mData));
+            combine(desc.mOffset);
+            combine(desc.mStride);
+        }
+        // 0 is reserved for primitives without a topology key
+        return key ? key : 1;
+    }
+
+    // Refit the BVH of a deformed static mesh when its topology is
+    // unchanged, otherwise rebuild it
+    void refitOrRebuildMesh(geom::internal::Mesh& geomMesh) {
+        if (mChangeFlag == ChangeFlag::UPDATE) {
+            geom::internal::Mesh::TessellatedMesh mesh;
+            geomMesh.getTessellatedMesh(mesh);
+            // a mesh which started or stopped moving changes its number of
+            // embree time steps and needs a rebuild
+            const size_t stride = getMotionStepStride(mesh.mVertexBufferDesc, mesh.mVertexCount, 3);
+            if (geomMesh.getBVHTopologyKey() == getMeshTopologyKey(mesh, stride)) {
+                geomMesh.refitBVHHandle(static_cast<unsigned>(
+                    getBuiltMotionSteps(mesh.mVertexBufferDesc.size(), stride)));
+                ++mUpdateCounts.mRefit;
+                return;
+            }
+        }
+        rebuildBVHHandle(geomMesh, createPolyMeshInBVH(geomMesh, getGeomFlag()));
+    }
+
     std::unique_ptr<geom::internal::BVHHandle> createPolyMeshInBVH(
         geom::internal::Mesh& geomMesh, const RTCBuildQuality flag) {
 
+        // use the embree geometry prepareMeshes() made for this mesh, if any
+        PreparedMesh prepared;
+        auto it = mPreparedMeshes.find(&geomMesh);
+        if (it != mPreparedMeshes.end() && it->second.mRtcGeom) {
+            prepared = it->second;
+            it->second.mRtcGeom = nullptr;
+        } else {
+            prepared = newPolyMeshGeometry(geomMesh);
+        }
+
+        // attaching in visiting order keeps the geometry ids deterministic
+        mBVHUserData.emplace_back(prepared.mUserData);
+        geomMesh.mEmbreeUserData = (void*)prepared.mUserData;
+
+        uint32_t geomID = rtcAttachGeometry(mParentScene, prepared.mRtcGeom);
+        geomMesh.mEmbreeGeomID = geomID;
+
+        return fauxstd::make_unique<geom::internal::BVHHandle>(
+            mParentScene, geomID, prepared.mTopologyKey);
+    }
+
+    // Creates and commits the embree geometry of a mesh, everything but
+    // attaching it to the parent scene. Safe to call from several threads.
+    PreparedMesh newPolyMeshGeometry(geom::internal::Mesh& geomMesh) {
         geom::internal::Mesh::TessellatedMesh mesh;
         geomMesh.getTessellatedMesh(mesh);
 
@@ -277,8 +632,11 @@ private:
             MNRY_ASSERT_REQUIRE(false);
             break;
         }
-        size_t mbSteps = mesh.mVertexBufferDesc.size();
+        const size_t stride = getMotionStepStride(mesh.mVertexBufferDesc, mesh.mVertexCount, 3);
+        const size_t mbSteps = getBuiltMotionSteps(mesh.mVertexBufferDesc.size(), stride);
         rtcSetGeometryTimeStepCount(rtcGeom, mbSteps);
+        mUpdateCounts.mInputMotionSteps += mesh.mVertexBufferDesc.size();
+        mUpdateCounts.mBuiltMotionSteps += mbSteps;
 
         // Set up mesh index buffer
         rtcSetSharedGeometryBuffer(rtcGeom, RTC_BUFFER_TYPE_INDEX, 0,
@@ -287,13 +645,14 @@ private:
                                    mesh.mIndexBufferDesc.mOffset,
                                    mesh.mIndexBufferDesc.mStride,
                                    mesh.mFaceCount);
-        // Set up the polygon mesh vertex buffers, one for each motion step
+        // Set up the polygon mesh vertex buffers, one for each kept motion step
         for (size_t i = 0; i < mbSteps; i++) {
+            const geom::internal::BufferDesc& desc = mesh.mVertexBufferDesc[i * stride];
             rtcSetSharedGeometryBuffer(rtcGeom, RTC_BUFFER_TYPE_VERTEX, i,
                 RTC_FORMAT_FLOAT3, // xyz
-                const_cast<void*>((const void*)mesh.mVertexBufferDesc[i].mData),
-                mesh.mVertexBufferDesc[i].mOffset,
-                mesh.mVertexBufferDesc[i].mStride,
+                const_cast<void*>(desc.mData),
+                desc.mOffset,
+                desc.mStride,
                 mesh.mVertexCount);
         }
 
@@ -304,31 +663,28 @@ private:
             new IntersectionFilterManager();
         bool hasVolumeAssignment = geomMesh.hasVolumeAssignment(mLayer);
         // force volume primitive to be two sided for odd-even test
-        if (geomMesh.getIsSingleSided() && !hasVolumeAssignment) {
-            filterManager->addIntersectionFilter(&backFaceCullingFilter);
-            filterManager->addOcclusionFilter(&backFaceCullingFilter);
-        }
-        filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
         if (hasVolumeAssignment) {
-            filterManager->addIntersectionFilter(&manifoldVolumeIntervalFilter);
+            filterManager->addIntersectionFilter(
+                &filterChain<bssrdfTraceSetIntersectionFilter, manifoldVolumeIntervalFilter>);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<true>);
+        } else if (geomMesh.getIsSingleSided()) {
+            filterManager->addIntersectionFilter(
+                &filterChain<backFaceCullingFilter, bssrdfTraceSetIntersectionFilter>);
+            filterManager->addOcclusionFilter(
+                &filterChain<backFaceCullingFilter, skipOcclusionFilter<false>>);
+        } else {
+            filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<false>);
         }
-
-        filterManager->addOcclusionFilter(&skipOcclusionFilter);
         installFilterCallbacks(rtcGeom, filterManager);
 
         // set user data
         geom::internal::BVHUserData* userData =
             new geom::internal::BVHUserData(mLayer, &geomMesh, filterManager);
-        mBVHUserData.emplace_back(userData);
         rtcSetGeometryUserData(rtcGeom, (void*)userData);
-        geomMesh.mEmbreeUserData = (void*)userData;
-
-        uint32_t geomID = rtcAttachGeometry(mParentScene, rtcGeom);
-        geomMesh.mEmbreeGeomID = geomID;
 
         rtcCommitGeometry(rtcGeom);
-        return fauxstd::make_unique<geom::internal::BVHHandle>(
-            mParentScene, geomID);
+        return PreparedMesh {rtcGeom, userData, getMeshTopologyKey(mesh, stride)};
     }
 
     std::unique_ptr<geom::internal::BVHHandle> createQuadricInBVH(
@@ -354,12 +710,14 @@ private:
         // set intersection filter
         IntersectionFilterManager* filterManager =
             new IntersectionFilterManager();
-        filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
         if (quadric.hasVolumeAssignment(mLayer)) {
             filterManager->addIntersectionFilter(
-                &manifoldVolumeIntervalFilter);
+                &filterChain<bssrdfTraceSetIntersectionFilter, manifoldVolumeIntervalFilter>);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<true>);
+        } else {
+            filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<false>);
         }
-        filterManager->addOcclusionFilter(&skipOcclusionFilter);
         installFilterCallbacks(rtcGeom, filterManager);
 
         // set user data
@@ -377,6 +735,68 @@ private:
             mParentScene, geomID);
     }
 
+    std::unique_ptr<geom::internal::BVHHandle> createPointsInBVH(
+        geom::internal::Points& points,
+        const RTCBuildQuality flag) {
+
+        rtcGetDeviceError(mDevice);  // clear error code
+
+        // Embree leaf intersection of the spheres instead of a user
+        // callback per candidate point
+        points.updateSphereVertices();
+        const size_t pointsCount = points.getSubPrimitiveCount();
+        const size_t mbSteps = points.getMotionSamplesCount();
+
+        RTCGeometry rtcGeom = rtcNewGeometry(mDevice, RTC_GEOMETRY_TYPE_SPHERE_POINT);
+        MNRY_ASSERT_REQUIRE(rtcGeom != NULL);
+        rtcSetGeometryTimeStepCount(rtcGeom, mbSteps);
+        mUpdateCounts.mInputMotionSteps += mbSteps;
+        mUpdateCounts.mBuiltMotionSteps += mbSteps;
+        rtcSetGeometryBuildQuality(rtcGeom, flag);
+
+        for (size_t i = 0; i < mbSteps; i++) {
+            rtcSetSharedGeometryBuffer(rtcGeom, RTC_BUFFER_TYPE_VERTEX, i,
+                RTC_FORMAT_FLOAT4, // xyzr
+                const_cast<void*>((const void*)points.getSphereVertices(i)),
+                0,
+                sizeof(scene_rdl2::math::Vec3fa),
+                pointsCount);
+        }
+
+        rtcSetGeometryMask(rtcGeom, resolveVisibilityMask(points));
+
+        // set intersection filter
+        IntersectionFilterManager* filterManager =
+            new IntersectionFilterManager();
+        if (points.hasVolumeAssignment(mLayer)) {
+            filterManager->addIntersectionFilter(
+                &filterChain<bssrdfTraceSetIntersectionFilter, manifoldVolumeIntervalFilter>);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<true>);
+        } else {
+            filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<false>);
+        }
+        installFilterCallbacks(rtcGeom, filterManager);
+
+        // set user data
+        geom::internal::BVHUserData* userData =
+            new geom::internal::BVHUserData(mLayer, &points, filterManager);
+        mBVHUserData.emplace_back(userData);
+        rtcSetGeometryUserData(rtcGeom, (void*)userData);
+        points.mEmbreeUserData = (void*)userData;
+
+        uint32_t geomID = rtcAttachGeometry(mParentScene, rtcGeom);
+        points.mEmbreeGeomID = geomID;
+
+        rtcCommitGeometry(rtcGeom);
+
+        // catch any embree errors in this function
+        MNRY_ASSERT_REQUIRE(rtcGetDeviceError(mDevice) == RTC_ERROR_NONE);
+
+        return fauxstd::make_unique<geom::internal::BVHHandle>(
+            mParentScene, geomID);
+    }
+
     std::unique_ptr<geom::internal::BVHHandle> createCurvesInBVH(
         geom::internal::Curves& geomCurves,
         const geom::Curves::Type curvesType,
@@ -411,8 +831,14 @@ private:
         }
         MNRY_ASSERT_REQUIRE(rtcGeom != NULL);
 
-        size_t mbSteps = spans.mVertexBufferDesc.size();
+        // Curves of dynamic geometry get updated in place later on and keep
+        // all their motion steps
+        const size_t stride = mGeometry->isStatic() ?
+            getMotionStepStride(spans.mVertexBufferDesc, spans.mVertexCount, 4) : 1;
+        const size_t mbSteps = getBuiltMotionSteps(spans.mVertexBufferDesc.size(), stride);
         rtcSetGeometryTimeStepCount(rtcGeom, mbSteps);
+        mUpdateCounts.mInputMotionSteps += spans.mVertexBufferDesc.size();
+        mUpdateCounts.mBuiltMotionSteps += mbSteps;
         rtcSetGeometryBuildQuality(rtcGeom, flag);
 
         // Set up span index buffer
@@ -424,14 +850,15 @@ private:
             spans.mIndexBufferDesc.mStride,
             spans.mSpanCount);
 
-        // Set up the control vertex data buffers, one for each motion step
+        // Set up the control vertex data buffers, one for each kept motion step
         for (size_t i = 0; i < mbSteps; i++) {
-            MNRY_ASSERT_REQUIRE(spans.mVertexBufferDesc[i].mData != nullptr);
+            const geom::internal::BufferDesc& desc = spans.mVertexBufferDesc[i * stride];
+            MNRY_ASSERT_REQUIRE(desc.mData != nullptr);
             rtcSetSharedGeometryBuffer(rtcGeom, RTC_BUFFER_TYPE_VERTEX, i,
                 RTC_FORMAT_FLOAT4, // xyzr
-                const_cast<void*>((const void*)spans.mVertexBufferDesc[i].mData),
-                spans.mVertexBufferDesc[i].mOffset,
-                spans.mVertexBufferDesc[i].mStride,
+                const_cast<void*>(desc.mData),
+                desc.mOffset,
+                desc.mStride,
                 spans.mVertexCount);
         }
 
@@ -451,7 +878,11 @@ private:
         IntersectionFilterManager* filterManager =
             new IntersectionFilterManager();
         filterManager->addIntersectionFilter(&bssrdfTraceSetIntersectionFilter);
-        filterManager->addOcclusionFilter(&skipOcclusionFilter);
+        if (geomCurves.hasVolumeAssignment(mLayer)) {
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<true>);
+        } else {
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<false>);
+        }
         installFilterCallbacks(rtcGeom, filterManager);
 
         rtcSetGeometryTessellationRate(rtcGeom, tessellationRate);
@@ -568,8 +999,10 @@ private:
             new IntersectionFilterManager();
         if (geomVolume.hasVolumeAssignment(mLayer)) {
             filterManager->addIntersectionFilter(&vdbVolumeIntervalFilter);
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<true>);
+        } else {
+            filterManager->addOcclusionFilter(&skipOcclusionFilter<false>);
         }
-        filterManager->addOcclusionFilter(&skipOcclusionFilter);
         installFilterCallbacks(rtcGeom, filterManager);
 
         // set user data
@@ -607,23 +1040,72 @@ private:
         return mask;
     }
 
+    // A single filter, which is what the create*InBVH() functions register
+    // with filterChain, is handed to embree directly. Only longer lists go
+    // through the IntersectionFilterManager dispatch loop.
     void installFilterCallbacks(RTCGeometry rtcGeom,
             const IntersectionFilterManager* filterManager)
     {
-        if (!filterManager->mIntersectionFilters.empty()) {
+        const auto& intersectionFilters = filterManager->mIntersectionFilters;
+        if (intersectionFilters.size() == 1) {
+            rtcSetGeometryIntersectFilterFunction(rtcGeom,
+                intersectionFilters.front());
+        } else if (!intersectionFilters.empty()) {
             rtcSetGeometryIntersectFilterFunction(rtcGeom,
                 IntersectionFilterManager::intersectionFilter);
         }
-        if (!filterManager->mOcclusionFilters.empty()) {
+        const auto& occlusionFilters = filterManager->mOcclusionFilters;
+        if (occlusionFilters.size() == 1) {
+            rtcSetGeometryOccludedFilterFunction(rtcGeom,
+                occlusionFilters.front());
+        } else if (!occlusionFilters.empty()) {
             rtcSetGeometryOccludedFilterFunction(rtcGeom,
                 IntersectionFilterManager::occlusionFilter);
         }
     }
 
 private:
+    // Parallel pre-pass of prepareMeshes(). Instances are skipped, their
+    // shared primitives are prepared by the builder of their own scene.
+    class MeshPreparer : public geom::PrimitiveVisitor
+    {
+    public:
+        explicit MeshPreparer(BVHBuilder& builder): mBuilder(builder) {}
+
+        virtual void visitPolygonMesh(geom::PolygonMesh& p) override {
+            prepare(geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&p));
+        }
+
+        virtual void visitSubdivisionMesh(geom::SubdivisionMesh& s) override {
+            prepare(geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&s));
+        }
+
+        virtual void visitPrimitiveGroup(geom::PrimitiveGroup& pg) override {
+            pg.forEachPrimitive(*this, true);
+        }
+
+        virtual void visitTransformedPrimitive(geom::TransformedPrimitive& t) override {
+            t.getPrimitive()->accept(*this);
+        }
+
+    private:
+        void prepare(geom::internal::Primitive* pImpl) {
+            MNRY_ASSERT_REQUIRE(pImpl != nullptr);
+            auto pMesh = static_cast<geom::internal::Mesh*>(pImpl);
+            if (!pMesh->isBVHInitialized()) {
+                mBuilder.mPreparedMeshes.insert(
+                    std::make_pair(pMesh, mBuilder.newPolyMeshGeometry(*pMesh)));
+            }
+        }
+
+        BVHBuilder& mBuilder;
+    };
+
     const scene_rdl2::rdl2::Layer* mLayer;
     const scene_rdl2::rdl2::Geometry* mGeometry;
     RTCDevice& mDevice;
+    RTCSceneFlags mSceneFlags;
+    OptimizationTarget mAccelMode;
     RTCScene mParentScene;
 
     SharedSceneMap& mSharedSceneMap;
@@ -632,14 +1114,107 @@ private:
     // deletion of additional data needed for intersection filters
     BVHUserDataList& mBVHUserData;
 
+    // ChangeFlag::UPDATE allows deformed static meshes to be refit
+    ChangeFlag mChangeFlag;
+    BVHUpdateCounts& mUpdateCounts;
+
+    // Accelerator the builds of shared scenes can be deferred to,
+    // nullptr to build them right away
+    EmbreeAccelerator* mDeferTo;
+
     // When building scenes for shared primitives we need to know if they are
     // bound to volumes or materials in order to properly set the geometry
     // mask for instance primitives.
     bool mGetAssignments;
     bool mHasVolumeAssignment;
     bool mHasSurfaceAssignment;
+
+    // Filled by prepareMeshes(), consumed by createPolyMeshInBVH()
+    tbb::concurrent_unordered_map<const geom::internal::Mesh*, PreparedMesh> mPreparedMeshes;
+};
+
+// Computes the bound of the primitives of a shared primitive and checks
+// whether the build of its scene can be deferred. Shared primitives containing
+// instances or volumes, or primitives already bound to an embree scene, are
+// built right away.
+class DeferredSceneCheck : public geom::PrimitiveVisitor
+{
+public:
+    DeferredSceneCheck():
+        mCanDefer(true), mNumPrimitives(0), mBytes(0), mBound(scene_rdl2::util::empty) {}
+
+    virtual void visitPrimitive(geom::Primitive& p) override {
+        const geom::internal::Primitive* pImpl =
+            geom::internal::PrimitivePrivateAccess::getPrimitiveImpl(&p);
+        if (pImpl == nullptr || pImpl->isBVHInitialized()) {
+            mCanDefer = false;
+            return;
+        }
+        mBound = scene_rdl2::math::merge(mBound, pImpl->computeAABB());
+        ++mNumPrimitives;
+        mBytes += pImpl->getMemory();
+    }
+
+    virtual void visitPrimitiveGroup(geom::PrimitiveGroup& pg) override {
+        bool isParallel = false;
+        pg.forEachPrimitive(*this, isParallel);
+    }
+
+    virtual void visitTransformedPrimitive(geom::TransformedPrimitive& t) override {
+        t.getPrimitive()->accept(*this);
+    }
+
+    virtual void visitInstance(geom::Instance& i) override {
+        mCanDefer = false;
+    }
+
+    virtual void visitVdbVolume(geom::VdbVolume& v) override {
+        mCanDefer = false;
+    }
+
+    bool mCanDefer;
+    size_t mNumPrimitives;
+    size_t mBytes;
+    scene_rdl2::math::BBox3f mBound;
 };
 
+bool
+deferSharedScene(EmbreeAccelerator* accelerator, const scene_rdl2::rdl2::Layer* layer,
+        const scene_rdl2::rdl2::Geometry* geometry, RTCDevice& device, RTCSceneFlags sceneFlags,
+        OptimizationTarget accelMode, BVHUpdateCounts& updateCounts,
+        const std::shared_ptr<geom::SharedPrimitive>& ref)
+{
+    if (accelerator == nullptr || ref->getHasVolumeAssignment()) {
+        return false;
+    }
+    DeferredSceneCheck check;
+    ref->getPrimitive()->accept(check);
+    if (!check.mCanDefer || check.mNumPrimitives == 0) {
+        return false;
+    }
+    // ref owns the build function so it can safely point back at it
+    geom::SharedPrimitive* sharedPrimitive = ref.get();
+    RTCDevice rtcDevice = device;
+    const RTCBuildQuality quality = getSharedSceneBuildQuality(geometry, accelMode, check.mBytes);
+    ++updateCounts.mSharedScenes[getSharedSceneQualityIndex(quality)];
+    accelerator->deferSharedScene(ref,
+        [layer, geometry, rtcDevice, sceneFlags, accelMode, quality, sharedPrimitive](BVHUserDataList& userData) {
+            RTCDevice buildDevice = rtcDevice;
+            RTCScene sharedScene = rtcNewScene(buildDevice);
+            rtcSetSceneBuildQuality(sharedScene, quality);
+            rtcSetSceneFlags(sharedScene, sceneFlags);
+            SharedSceneMap sharedSceneMap;
+            BVHUpdateCounts updateCounts;
+            BVHBuilder builder(layer, geometry, buildDevice, sceneFlags, accelMode, sharedScene,
+                sharedSceneMap, userData, ChangeFlag::ALL, updateCounts,
+                /* get assignments = */ false, /* defer to = */ nullptr);
+            sharedPrimitive->getPrimitive()->accept(builder);
+            rtcCommitScene(sharedScene);
+            return sharedScene;
+        }, check.mBound);
+    return true;
+}
+
 static bool memoryMonitor(void* userPtr, const ssize_t bytes, const bool post)
 {
     ((EmbreeAccelerator*)userPtr)->addMemoryUsage(bytes);
@@ -649,12 +1224,24 @@ static bool memoryMonitor(void* userPtr, const ssize_t bytes, const bool post)
 EmbreeAccelerator::EmbreeAccelerator(const AcceleratorOptions& options):
     mBvhBuildProceduralTime(0.0),
     mRtcCommitTime(0.0),
-    mRootScene(nullptr), mDevice(nullptr), mBVHMemory(0)
+    mBvhRebuiltPrimitives(0),
+    mBvhRefitPrimitives(0),
+    mBvhInputMotionSteps(0),
+    mBvhBuiltMotionSteps(0),
+    mBvhSharedScenes{0, 0, 0},
+    mRootScene(nullptr), mDevice(nullptr), mBVHMemory(0),
+    mDeferSharedBVH(options.deferSharedBVH),
+    mSceneFlags(options.compactBVH ? RTC_SCENE_FLAG_COMPACT : RTC_SCENE_FLAG_NONE),
+    mDeferredScenes(0),
+    mDeferredScenesBuilt(0)
 {
     std::string cfg = "threads=" + std::to_string(options.maxThreads);
     if (options.verbose) {
         cfg += ",verbose=2";
     }
+    if (options.hugePages) {
+        cfg += ",hugepages=1";
+    }
 
     mDevice = rtcNewDevice(cfg.c_str());
     // monitor memory usage
@@ -665,6 +1252,14 @@ EmbreeAccelerator::EmbreeAccelerator(const AcceleratorOptions& options):
 
 EmbreeAccelerator::~EmbreeAccelerator()
 {
+    // the pending builds point back at this accelerator
+    for (const auto& deferredRef : mDeferredRefs) {
+        std::shared_ptr<geom::SharedPrimitive> ref = deferredRef.lock();
+        scene_rdl2::math::BBox3f bound;
+        if (ref && geom::internal::PrimitivePrivateAccess::getDeferredBVHBound(*ref, bound)) {
+            geom::internal::PrimitivePrivateAccess::setBVHScene(*ref, nullptr);
+        }
+    }
     // reset the root scene
     if (mRootScene != nullptr) {
         rtcReleaseScene(mRootScene);
@@ -673,12 +1268,37 @@ EmbreeAccelerator::~EmbreeAccelerator()
     rtcReleaseDevice(mDevice);
 }
 
+void
+EmbreeAccelerator::deferSharedScene(const std::shared_ptr<geom::SharedPrimitive>& ref,
+        std::function<RTCScene(BVHUserDataList&)>&& buildScene,
+        const scene_rdl2::math::BBox3f& localBound)
+{
+    geom::internal::PrimitivePrivateAccess::setDeferredBVHScene(*ref,
+        [this, buildScene]() {
+            // Deferred builds run on the render threads, concurrently for
+            // different shared primitives, so they fill a local list
+            BVHUserDataList userData;
+            RTCScene sharedScene = buildScene(userData);
+            std::lock_guard<std::mutex> lock(mDeferredMutex);
+            for (auto& data : userData) {
+                mBVHUserData.push_back(std::move(data));
+            }
+            ++mDeferredScenesBuilt;
+            return static_cast<void*>(sharedScene);
+        }, localBound);
+
+    std::lock_guard<std::mutex> lock(mDeferredMutex);
+    mDeferredRefs.push_back(ref);
+    ++mDeferredScenes;
+}
+
 void
 buildBVHBottomUp(const scene_rdl2::rdl2::Layer* layer, scene_rdl2::rdl2::Geometry* geometry,
-        RTCDevice& rtcDevice, RTCScene& rootScene,
+        RTCDevice& rtcDevice, RTCSceneFlags sceneFlags, OptimizationTarget accelMode, RTCScene& rootScene,
         SharedSceneMap& visitedBVHScene,
         std::unordered_set<scene_rdl2::rdl2::Geometry*>& visitedGeometry,
-        BVHUserDataList& bvhUserData)
+        BVHUserDataList& bvhUserData, ChangeFlag changeFlag,
+        BVHUpdateCounts& updateCounts, EmbreeAccelerator* deferTo)
 {
     geom::Procedural* procedural = geometry->getProcedural();
     // All parts in a procedural are unassigned in the layer
@@ -697,53 +1317,88 @@ buildBVHBottomUp(const scene_rdl2::rdl2::Layer* layer, scene_rdl2::rdl2::Geometr
             continue;
         }
         scene_rdl2::rdl2::Geometry* referencedGeometry = ref->asA<scene_rdl2::rdl2::Geometry>();
-        buildBVHBottomUp(layer, referencedGeometry, rtcDevice, rootScene,
-            visitedBVHScene, visitedGeometry, bvhUserData);
+        buildBVHBottomUp(layer, referencedGeometry, rtcDevice, sceneFlags, accelMode, rootScene,
+            visitedBVHScene, visitedGeometry, bvhUserData, changeFlag, updateCounts, deferTo);
     }
     // We disable the parallel here to solve the non-deterministic
     // issue for some hair/fur related scenes.
     // Also, testing shows no speed gain is achieved when
     // parallelize this for loop.
     bool doParallel = false;
+    // Shared scenes are only reused within a build through visitedBVHScene.
+    // They can't be cached across processes : Embree has no API to serialize
+    // a committed scene or to load prebuilt acceleration data, and its geometry
+    // buffers point directly at the tessellated primitive data owned by geom.
     if (procedural->isReference()) {
         const std::shared_ptr<geom::SharedPrimitive>& ref =
             procedural->getReference();
         if (visitedBVHScene.insert(std::make_pair(ref, std::make_shared<std::atomic<bool>>(false))).second) {
-            RTCScene sharedScene = rtcNewScene(rtcDevice);
-            rtcSetSceneBuildQuality(sharedScene, geometry->isStatic()?
-                RTC_BUILD_QUALITY_HIGH : RTC_BUILD_QUALITY_LOW);
-            geom::internal::PrimitivePrivateAccess::setBVHScene(*ref,
-                static_cast<void*>(sharedScene));
-            BVHBuilder builder(layer, geometry, rtcDevice, sharedScene,
-                visitedBVHScene, bvhUserData, /* get assignments = */ true);
-            ref->getPrimitive()->accept(builder);
-            rtcCommitScene(sharedScene);
+            if (!deferSharedScene(deferTo, layer, geometry, rtcDevice, sceneFlags, accelMode,
+                    updateCounts, ref)) {
+                RTCScene sharedScene = rtcNewScene(rtcDevice);
+                const RTCBuildQuality quality = getSharedSceneBuildQuality(geometry, accelMode,
+                    getSharedPrimitiveBytes(ref));
+                ++updateCounts.mSharedScenes[getSharedSceneQualityIndex(quality)];
+                rtcSetSceneBuildQuality(sharedScene, quality);
+                rtcSetSceneFlags(sharedScene, sceneFlags);
+                geom::internal::PrimitivePrivateAccess::setBVHScene(*ref,
+                    static_cast<void*>(sharedScene));
+                BVHBuilder builder(layer, geometry, rtcDevice, sceneFlags, accelMode, sharedScene,
+                    visitedBVHScene, bvhUserData, changeFlag, updateCounts,
+                    /* get assignments = */ true, deferTo);
+                builder.prepareMeshes(*ref->getPrimitive());
+                ref->getPrimitive()->accept(builder);
+                rtcCommitScene(sharedScene);
+            }
             // mark the BVH representation of referenced primitive (group)
             // has been correctly constructed so that all the instances
             // reference it can start accessing it
             *visitedBVHScene[ref] = true;
         }
     } else {
-        BVHBuilder bvhBuilder(layer, geometry, rtcDevice, rootScene,
-            visitedBVHScene, bvhUserData, /* get assignments = */ false);
+        BVHBuilder bvhBuilder(layer, geometry, rtcDevice, sceneFlags, accelMode, rootScene,
+            visitedBVHScene, bvhUserData, changeFlag, updateCounts,
+            /* get assignments = */ false, deferTo);
+        bvhBuilder.prepareMeshes(*procedural);
         procedural->forEachPrimitive(bvhBuilder, doParallel);
     }
     visitedGeometry.insert(geometry);
 }
 
-void
+// Cancels a commit through the embree progress monitor, which gets called
+// concurrently from the build threads
+struct CommitCancel
+{
+    const EmbreeAccelerator::CancelCallBack& mCancel;
+    std::atomic<bool> mCanceled {false};
+};
+
+bool
+commitProgressMonitor(void* ptr, double /* progress */)
+{
+    CommitCancel* commitCancel = static_cast<CommitCancel*>(ptr);
+    if (!commitCancel->mCanceled && commitCancel->mCancel()) {
+        commitCancel->mCanceled = true;
+    }
+    // returning false cancels the build
+    return !commitCancel->mCanceled;
+}
+
+bool
 EmbreeAccelerator::build(OptimizationTarget accelMode, ChangeFlag changeFlag,
         const scene_rdl2::rdl2::Layer *layer,
         const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
-        const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap* g2s)
+        const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap* g2s,
+        const CancelCallBack& geometryCancel,
+        const CancelCallBack& commitCancel)
 {
     if (changeFlag == ChangeFlag::ALL) {
         if (accelMode == OptimizationTarget::HIGH_QUALITY_BVH_BUILD) {
             rtcSetSceneBuildQuality(mRootScene, RTC_BUILD_QUALITY_HIGH);
-            rtcSetSceneFlags(mRootScene, RTC_SCENE_FLAG_NONE);
+            rtcSetSceneFlags(mRootScene, mSceneFlags);
         } else {
             rtcSetSceneBuildQuality(mRootScene, RTC_BUILD_QUALITY_LOW);
-            rtcSetSceneFlags(mRootScene, RTC_SCENE_FLAG_DYNAMIC);
+            rtcSetSceneFlags(mRootScene, RTCSceneFlags(mSceneFlags | RTC_SCENE_FLAG_DYNAMIC));
         }
     }
     scene_rdl2::rec_time::RecTime recTime;
@@ -751,23 +1406,68 @@ EmbreeAccelerator::build(OptimizationTarget accelMode, ChangeFlag changeFlag,
     recTime.start();
     SharedSceneMap visitedBVHScene;
     std::unordered_set<scene_rdl2::rdl2::Geometry*> visitedGeometry;
+    BVHUpdateCounts updateCounts;
+    mDeferredScenes = 0;
+    mDeferredScenesBuilt = 0;
+    // only keep track of the shared primitives still waiting for a build
+    mDeferredRefs.erase(std::remove_if(mDeferredRefs.begin(), mDeferredRefs.end(),
+        [](const std::weak_ptr<geom::SharedPrimitive>& deferredRef) {
+            std::shared_ptr<geom::SharedPrimitive> ref = deferredRef.lock();
+            scene_rdl2::math::BBox3f bound;
+            return !ref || !geom::internal::PrimitivePrivateAccess::getDeferredBVHBound(*ref, bound);
+        }), mDeferredRefs.end());
+    EmbreeAccelerator* deferTo = mDeferSharedBVH ? this : nullptr;
     for (const auto& geometrySet : geometrySets) {
         const scene_rdl2::rdl2::SceneObjectIndexable& geometries = geometrySet->getGeometries();
         for (auto& sceneObject : geometries) {
+            if (geometryCancel && geometryCancel()) {
+                // The handles built so far stay in the root scene, an uncommitted
+                // scene is never traced and the next build updates them.
+                mBvhBuildProceduralTime = recTime.end();
+                mBvhRebuiltPrimitives = updateCounts.mRebuilt;
+                mBvhRefitPrimitives = updateCounts.mRefit;
+                mBvhInputMotionSteps = updateCounts.mInputMotionSteps;
+                mBvhBuiltMotionSteps = updateCounts.mBuiltMotionSteps;
+                for (int i = 0; i < 3; ++i) {
+                    mBvhSharedScenes[i] = updateCounts.mSharedScenes[i];
+                }
+                return false;
+            }
             scene_rdl2::rdl2::Geometry* geometry = sceneObject->asA<scene_rdl2::rdl2::Geometry>();
             if (g2s != nullptr && g2s->find(geometry) == g2s->end()) {
                 continue;
             }
-            buildBVHBottomUp(layer, geometry, mDevice, mRootScene,
-                visitedBVHScene, visitedGeometry, mBVHUserData);
+            buildBVHBottomUp(layer, geometry, mDevice, mSceneFlags, accelMode, mRootScene,
+                visitedBVHScene, visitedGeometry, mBVHUserData, changeFlag, updateCounts, deferTo);
         }
     }
     mBvhBuildProceduralTime = recTime.end();
+    mBvhRebuiltPrimitives = updateCounts.mRebuilt;
+    mBvhRefitPrimitives = updateCounts.mRefit;
+    mBvhInputMotionSteps = updateCounts.mInputMotionSteps;
+    mBvhBuiltMotionSteps = updateCounts.mBuiltMotionSteps;
+    for (int i = 0; i < 3; ++i) {
+        mBvhSharedScenes[i] = updateCounts.mSharedScenes[i];
+    }
 
     // now build the root scene
     recTime.start();
-    rtcCommitScene(mRootScene);
+    bool canceled = false;
+    if (commitCancel) {
+        CommitCancel cancel {commitCancel};
+        rtcSetSceneProgressMonitorFunction(mRootScene, commitProgressMonitor, &cancel);
+        rtcCommitScene(mRootScene);
+        rtcSetSceneProgressMonitorFunction(mRootScene, nullptr, nullptr);
+        canceled = cancel.mCanceled;
+        if (canceled) {
+            // clear RTC_ERROR_CANCELLED, the next build checks the device error
+            rtcGetDeviceError(mDevice);
+        }
+    } else {
+        rtcCommitScene(mRootScene);
+    }
     mRtcCommitTime = recTime.end();
+    return !canceled;
 }
 
 // For debugging purpose
@@ -839,6 +1539,131 @@ EmbreeAccelerator::occluded(mcrt_common::Ray& ray) const
     return ray.tfar < 0.0f;
 }
 
+// Copy up to VLEN rays into the SoA packet layout expected by Embree.
+// The ray id is set to the lane index so intersection filters and instance
+// kernels can find the matching RayExtension in the IntersectContext.
+static void
+gatherRayPacket(unsigned numLanes, mcrt_common::Ray** rays, RTCRayv& packet,
+        mcrt_common::RayExtension* extensions, int* valid)
+{
+    for (unsigned lane = 0; lane < VLEN; ++lane) {
+        if (lane >= numLanes) {
+            valid[lane] = 0;
+            // keep inactive lanes well formed
+            packet.tnear[lane] = 0.0f;
+            packet.tfar[lane] = -1.0f;
+            continue;
+        }
+        const mcrt_common::Ray& ray = *rays[lane];
+        MNRY_ASSERT(isValidRay(ray));
+        valid[lane] = -1;
+        packet.org_x[lane] = ray.org.x;
+        packet.org_y[lane] = ray.org.y;
+        packet.org_z[lane] = ray.org.z;
+        packet.tnear[lane] = ray.tnear;
+        packet.dir_x[lane] = ray.dir.x;
+        packet.dir_y[lane] = ray.dir.y;
+        packet.dir_z[lane] = ray.dir.z;
+        packet.time[lane]  = ray.time;
+        packet.tfar[lane]  = ray.tfar;
+        packet.mask[lane]  = ray.mask;
+        packet.id[lane]    = lane;
+        packet.flags[lane] = 0;
+        extensions[lane] = ray.ext;
+    }
+}
+
+void
+EmbreeAccelerator::intersect(unsigned numRays, mcrt_common::Ray** rays) const
+{
+    for (unsigned start = 0; start < numRays; start += VLEN) {
+        const unsigned numLanes = std::min(numRays - start, (unsigned)VLEN);
+        mcrt_common::Ray** packetRays = rays + start;
+
+        if (numLanes == 1) {
+            // not worth the packet setup
+            intersect(*packetRays[0]);
+            continue;
+        }
+
+        RTCRayHitv rayHit;
+        __align(64) int valid[VLEN];
+        mcrt_common::RayExtension extensions[VLEN];
+        gatherRayPacket(numLanes, packetRays, rayHit.ray, extensions, valid);
+        for (unsigned lane = 0; lane < VLEN; ++lane) {
+            rayHit.hit.geomID[lane] = RTC_INVALID_GEOMETRY_ID;
+            rayHit.hit.instID[0][lane] = RTC_INVALID_GEOMETRY_ID;
+        }
+
+        mcrt_common::IntersectContext context;
+        context.mRayExtension = extensions;
+
+        RTCIntersectArguments args;
+        rtcInitIntersectArguments(&args);
+        args.context = &context.mRtcContext;
+
+        rtcIntersectv(valid, mRootScene, &rayHit, &args);
+
+        for (unsigned lane = 0; lane < numLanes; ++lane) {
+            mcrt_common::Ray& ray = *packetRays[lane];
+            ray.id     = 0;
+            ray.tfar   = rayHit.ray.tfar[lane];
+            ray.Ng.x   = rayHit.hit.Ng_x[lane];
+            ray.Ng.y   = rayHit.hit.Ng_y[lane];
+            ray.Ng.z   = rayHit.hit.Ng_z[lane];
+            ray.u      = rayHit.hit.u[lane];
+            ray.v      = rayHit.hit.v[lane];
+            ray.primID = rayHit.hit.primID[lane];
+            ray.geomID = rayHit.hit.geomID[lane];
+            ray.instID = rayHit.hit.instID[0][lane];
+            ray.ext    = extensions[lane];
+
+            if (ray.geomID != RTC_INVALID_GEOMETRY_ID &&
+                ray.instID == RTC_INVALID_GEOMETRY_ID) {
+                // intersect a regular primitive (if the intersection is an instance,
+                // its userData has been filled in instance intersection kernel
+                ray.ext.userData = rtcGetGeometryUserData(
+                    rtcGetGeometry(mRootScene, ray.geomID));
+            }
+        }
+    }
+}
+
+void
+EmbreeAccelerator::occluded(unsigned numRays, mcrt_common::Ray** rays,
+        bool* occludedResults) const
+{
+    for (unsigned start = 0; start < numRays; start += VLEN) {
+        const unsigned numLanes = std::min(numRays - start, (unsigned)VLEN);
+        mcrt_common::Ray** packetRays = rays + start;
+
+        if (numLanes == 1) {
+            occludedResults[start] = occluded(*packetRays[0]);
+            continue;
+        }
+
+        RTCRayv ray;
+        __align(64) int valid[VLEN];
+        mcrt_common::RayExtension extensions[VLEN];
+        gatherRayPacket(numLanes, packetRays, ray, extensions, valid);
+
+        mcrt_common::IntersectContext context;
+        context.mRayExtension = extensions;
+
+        RTCOccludedArguments args;
+        rtcInitOccludedArguments(&args);
+        args.context = &context.mRtcContext;
+
+        rtcOccludedv(valid, mRootScene, &ray, &args);
+
+        for (unsigned lane = 0; lane < numLanes; ++lane) {
+            packetRays[lane]->id = 0;
+            packetRays[lane]->tfar = ray.tfar[lane];
+            occludedResults[start + lane] = ray.tfar[lane] < 0.0f;
+        }
+    }
+}
+
 scene_rdl2::math::BBox3f
 EmbreeAccelerator::getBounds() const
 {
@@ -6,6 +6,7 @@
 #include <moonray/rendering/geom/prim/Primitive.h>
 
 #include <moonray/rendering/rt/rt.h>
+#include <moonray/rendering/geom/SharedPrimitive.h>
 #include <moonray/rendering/geom/prim/BVHUserData.h>
 #include <moonray/rendering/mcrt_common/Ray.h>
 
@@ -15,6 +16,9 @@
 
 #include <embree4/rtcore.h>
 
+#include <functional>
+#include <mutex>
+
 namespace moonray {
 namespace rt {
 
@@ -29,15 +33,34 @@ public:
     EmbreeAccelerator(const EmbreeAccelerator& other) = delete;
     const EmbreeAccelerator &operator=(const EmbreeAccelerator& other) = delete;
 
-    void build(OptimizationTarget accelMode, ChangeFlag changeFlag,
+    // Returns true to cancel the build
+    using CancelCallBack = std::function<bool()>;
+
+    /// Returns false if the build got canceled, the accelerator then has to be
+    /// built again before tracing any ray. geometryCancel is called before the
+    /// BVH of each geometry is built, commitCancel from the embree threads
+    /// while the root scene gets committed.
+    bool build(OptimizationTarget accelMode, ChangeFlag changeFlag,
             const scene_rdl2::rdl2::Layer *layer,
             const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
-            const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap* g2s = nullptr);
+            const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap* g2s = nullptr,
+            const CancelCallBack& geometryCancel = nullptr,
+            const CancelCallBack& commitCancel = nullptr);
 
     void intersect(mcrt_common::Ray& ray) const;
 
     bool occluded(mcrt_common::Ray& ray) const;
 
+    /// Batched versions of intersect() and occluded() for coherent ray
+    /// queues in bundled mode. Rays are traced in packets of VLEN using
+    /// the Embree packet API instead of one rtcIntersect1/rtcOccluded1
+    /// call per ray. The results written to each ray are identical to
+    /// calling the single ray version on each ray in turn.
+    void intersect(unsigned numRays, mcrt_common::Ray** rays) const;
+
+    /// occludedResults[i] is set to whether rays[i] is occluded.
+    void occluded(unsigned numRays, mcrt_common::Ray** rays, bool* occludedResults) const;
+
     scene_rdl2::math::BBox3f getBounds() const;
 
     size_t getMemory() const {
@@ -53,10 +76,41 @@ public:
         mBVHMemory += bytes;
     }
 
+    bool getDeferSharedBVH() const {
+        return mDeferSharedBVH;
+    }
+
+    /// Registers the deferred build of the BVH scene of a shared primitive.
+    /// buildScene is run by the first ray reaching one of its instances and
+    /// returns the committed scene.
+    void deferSharedScene(const std::shared_ptr<geom::SharedPrimitive>& ref,
+            std::function<RTCScene(BVHUserDataList&)>&& buildScene,
+            const scene_rdl2::math::BBox3f& localBound);
+
+    /// Number of shared primitive BVH scenes deferred by the last build() call
+    /// and how many of them have been built since
+    unsigned getDeferredScenes() const {
+        return mDeferredScenes;
+    }
+    unsigned getDeferredScenesBuilt() const {
+        return mDeferredScenesBuilt;
+    }
+
     //------------------------------
 
     double mBvhBuildProceduralTime;
     double mRtcCommitTime;
+    // primitives rebuilt/refit by the last build() call
+    unsigned mBvhRebuiltPrimitives;
+    unsigned mBvhRefitPrimitives;
+    // motion steps of the meshes and curves (re)built by the last build()
+    // call, as tessellated and as kept in the BVH after dropping the static
+    // and linearly interpolated ones
+    unsigned mBvhInputMotionSteps;
+    unsigned mBvhBuiltMotionSteps;
+    // shared primitive BVH scenes built or deferred by the last build()
+    // call with high, medium and low build quality
+    unsigned mBvhSharedScenes[3];
 
 private:
     /// An Embree scene that contains all geometry and instances
@@ -65,6 +119,15 @@ private:
     // container for userdata so that they can be safely deleted.
     BVHUserDataList mBVHUserData;
     std::atomic<ssize_t> mBVHMemory;
+
+    bool mDeferSharedBVH;
+    // flags of every Embree scene on top of the dynamic flag of the root scene
+    RTCSceneFlags mSceneFlags;
+    // guards mBVHUserData while deferred scenes get built during rendering
+    std::mutex mDeferredMutex;
+    std::vector<std::weak_ptr<geom::SharedPrimitive>> mDeferredRefs;
+    unsigned mDeferredScenes;
+    std::atomic<unsigned> mDeferredScenesBuilt;
 };
 
 } // namespace rt
@@ -17,11 +17,13 @@ public:
     GeomGenerateContext(scene_rdl2::rdl2::Layer* pRdlLayer,scene_rdl2::rdl2::Geometry* pRdlGeometry,
             shading::AttributeKeySet&& requestedAttributes,
             int currentFrame, int threads,
-            const geom::MotionBlurParams& motionBlurParams):
+            const geom::MotionBlurParams& motionBlurParams,
+            const std::vector<mcrt_common::Frustum>& frustums):
             mRdlLayer(pRdlLayer), mRdlGeometry(pRdlGeometry),
             mRequestedAttributes(std::move(requestedAttributes)),
             mCurrentFrame(currentFrame),
-            mThreads(threads), mMotionBlurParams(motionBlurParams)
+            mThreads(threads), mMotionBlurParams(motionBlurParams),
+            mFrustums(frustums)
     {
     }
 
@@ -63,6 +65,10 @@ public:
     virtual void getMotionBlurDelta(
             float& shutterOpenDelta, float& shutterCloseDelta) const override;
 
+    finline virtual const std::vector<mcrt_common::Frustum>& getFrustums() const override {
+        return mFrustums;
+    }
+
 private:
 
     scene_rdl2::rdl2::Layer *mRdlLayer;
@@ -71,6 +77,7 @@ private:
     int mCurrentFrame;
     int mThreads;
     const geom::MotionBlurParams& mMotionBlurParams;
+    const std::vector<mcrt_common::Frustum>& mFrustums;
 };
 
 
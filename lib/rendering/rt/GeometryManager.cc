@@ -22,9 +22,11 @@
 #include <moonray/rendering/geom/PrimitiveVisitor.h>
 #include <moonray/rendering/geom/prim/Instance.h>
 #include <moonray/rendering/geom/prim/Mesh.h>
+#include <moonray/rendering/geom/prim/OpenSubdivTopologyCache.h>
 #include <moonray/rendering/geom/prim/Curves.h>
 #include <moonray/rendering/geom/prim/PrimitivePrivateAccess.h>
 #include <moonray/rendering/geom/prim/Sphere.h>
+#include <moonray/rendering/geom/prim/TessellationArena.h>
 #include <moonray/rendering/geom/prim/VolumeAssignmentTable.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 #include <moonray/rendering/pbr/camera/PerspectiveCamera.h>
@@ -40,6 +42,13 @@
 
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #ifndef __APPLE__
 #include <malloc.h>    // malloc_trim
@@ -573,6 +582,7 @@ GeometryManager::loadGeometries(scene_rdl2::rdl2::Layer* layer,
                                 const Mat4d& world2render,
                                 const int currentFrame,
                                 const geom::MotionBlurParams& motionBlurParams,
+                                const std::vector<mcrt_common::Frustum>& frustums,
                                 const unsigned threadCount,
                                 const shading::PerGeometryAttributeKeySet &perGeometryAttributes)
 {
@@ -617,90 +627,128 @@ GeometryManager::loadGeometries(scene_rdl2::rdl2::Layer* layer,
         }
 
         std::atomic<bool> geoLoadItemCancelCondition(false);
+        TbbSetOfGeometry& generatedGeometries = mGeneratedGeometries[layer];
 
-        // now fire up the generate calls in dependency order
+        // Each geometry is generated as soon as the geometries it references
+        // are, rather than after the whole previous generate order.
+        std::vector<scene_rdl2::rdl2::Geometry*> geometriesToGenerate;
+        std::unordered_map<const scene_rdl2::rdl2::Geometry*, size_t> generateIndex;
+        std::unordered_map<const scene_rdl2::rdl2::SceneClass*, std::mutex> classMutexes;
         for (const auto& pair : toGenerate) {
-            const auto& geometries = pair.second;
-            tbb::parallel_for_each(geometries.begin(), geometries.end(),
-                [&](scene_rdl2::rdl2::Geometry* geometry) {
+            for (scene_rdl2::rdl2::Geometry* geometry : pair.second) {
+                generateIndex[geometry] = geometriesToGenerate.size();
+                geometriesToGenerate.push_back(geometry);
+                classMutexes[&geometry->getSceneClass()];
+            }
+        }
+        std::vector<std::vector<size_t>> dependents(geometriesToGenerate.size());
+        std::unique_ptr<std::atomic<int>[]> numPendingReferences(
+            new std::atomic<int>[geometriesToGenerate.size()]);
+        for (size_t i = 0; i < geometriesToGenerate.size(); ++i) {
+            numPendingReferences[i] = 0;
+            const scene_rdl2::rdl2::SceneObjectVector& references =
+                geometriesToGenerate[i]->get(scene_rdl2::rdl2::Geometry::sReferenceGeometries);
+            for (const auto& ref : references) {
+                if (!ref->isA<scene_rdl2::rdl2::Geometry>()) {
+                    continue;
+                }
+                const auto it = generateIndex.find(ref->asA<scene_rdl2::rdl2::Geometry>());
+                if (it != generateIndex.end() && it->second != i) {
+                    ++numPendingReferences[i];
+                    dependents[it->second].push_back(i);
+                }
+            }
+        }
+
+        const auto generateGeometry = [&](scene_rdl2::rdl2::Geometry* geometry) {
 
-                if (mOptions.stats.mGeometryManagerExecTracker.startLoadGeometriesItem() ==
+            if (mOptions.stats.mGeometryManagerExecTracker.startLoadGeometriesItem() ==
+                GeometryManagerExecTracker::RESULT::CANCELED) {
+                geoLoadItemCancelCondition = true;
+                return;
+            }
+
+            if (generatedGeometries.find(geometry) != generatedGeometries.end()) {
+                // generated by a canceled render prep
+                if (mOptions.stats.mGeometryManagerExecTracker.endLoadGeometriesItem() ==
                     GeometryManagerExecTracker::RESULT::CANCELED) {
                     geoLoadItemCancelCondition = true;
-                    return;
                 }
+                return;
+            }
 
-                mOptions.stats.logString("Generating " +
-                    geometry->getSceneClass().getName() +
-                    "(\"" + geometry->getName() + "\")");
+            mOptions.stats.logString("Generating " +
+                geometry->getSceneClass().getName() +
+                "(\"" + geometry->getName() + "\")");
 
-                // Load the procedural.
-                if (!geometry->getProcedural()) {
-                    geometry->loadProcedural();
-                }
-                // Prepend geometry --> world.
-                shading::XformSamples geometry2render;
-
-                Mat4f l2r0, l2r1;
-                if (geometry->getUseLocalMotionBlur() && motionBlurParams.isMotionBlurOn()) {
-                    // If use_local_motion_blur is on then the node_xform is
-                    // baked into the points so we don't use it here.
-                    l2r0 = toFloat(world2render);
-                    l2r1 = toFloat(world2render);
-                } else {
-                    l2r0 = toFloat(geometry->get(scene_rdl2::rdl2::Node::sNodeXformKey,
-                                                 scene_rdl2::rdl2::TIMESTEP_BEGIN) * world2render);
-                    l2r1 = toFloat(geometry->get(scene_rdl2::rdl2::Node::sNodeXformKey,
-                                                 scene_rdl2::rdl2::TIMESTEP_END) * world2render);
-                }
+            // Load the procedural.
+            if (!geometry->getProcedural()) {
+                geometry->loadProcedural();
+            }
+            // Prepend geometry --> world.
+            shading::XformSamples geometry2render;
+
+            Mat4f l2r0, l2r1;
+            if (geometry->getUseLocalMotionBlur() && motionBlurParams.isMotionBlurOn()) {
+                // If use_local_motion_blur is on then the node_xform is
+                // baked into the points so we don't use it here.
+                l2r0 = toFloat(world2render);
+                l2r1 = toFloat(world2render);
+            } else {
+                l2r0 = toFloat(geometry->get(scene_rdl2::rdl2::Node::sNodeXformKey,
+                                             scene_rdl2::rdl2::TIMESTEP_BEGIN) * world2render);
+                l2r1 = toFloat(geometry->get(scene_rdl2::rdl2::Node::sNodeXformKey,
+                                             scene_rdl2::rdl2::TIMESTEP_END) * world2render);
+            }
 
-                if (scene_rdl2::math::isEqual(l2r0, l2r1) ||
-                    !motionBlurParams.isMotionBlurOn()) {
-                    geometry2render = {xform<Xform3f>(l2r0)};
-                } else {
-                    geometry2render = {xform<Xform3f>(l2r0), xform<Xform3f>(l2r1)};
-                }
+            if (scene_rdl2::math::isEqual(l2r0, l2r1) ||
+                !motionBlurParams.isMotionBlurOn()) {
+                geometry2render = {xform<Xform3f>(l2r0)};
+            } else {
+                geometry2render = {xform<Xform3f>(l2r0), xform<Xform3f>(l2r1)};
+            }
 
-                // TODO the getRender2Object is used in shading stage that doesn't
-                // take time factor into account. We should update this function
-                // interface to accept more than one Xform sample when we need to
-                // do time varying shading calculation
-                geometry->setRender2Object(geometry2render[0].inverse());
-
-                shading::AttributeKeySet requestedAttributes;
-                // Find which primitive attributes this procedural needs to load.
-
-                if (geometryRootShadersToLoad.find(geometry) != geometryRootShadersToLoad.end()) {
-                    const auto& rootShaders = geometryRootShadersToLoad[geometry];
-                for (const scene_rdl2::rdl2::RootShader* const s : rootShaders) {
-                    const auto& table = s->get<shading::RootShader>().getAttributeTable();
-                    const auto& reqKeys = table->getRequiredAttributes();
-                    requestedAttributes.insert(reqKeys.begin(), reqKeys.end());
-                    const auto& optKeys = table->getOptionalAttributes();
-                    requestedAttributes.insert(optKeys.begin(), optKeys.end());
-                }
-                } else {
-                    geometry->warn("Geometry is not in the Layer");
-                }
+            // TODO the getRender2Object is used in shading stage that doesn't
+            // take time factor into account. We should update this function
+            // interface to accept more than one Xform sample when we need to
+            // do time varying shading calculation
+            geometry->setRender2Object(geometry2render[0].inverse());
+
+            shading::AttributeKeySet requestedAttributes;
+            // Find which primitive attributes this procedural needs to load.
+
+            if (geometryRootShadersToLoad.find(geometry) != geometryRootShadersToLoad.end()) {
+                const auto& rootShaders = geometryRootShadersToLoad[geometry];
+            for (const scene_rdl2::rdl2::RootShader* const s : rootShaders) {
+                const auto& table = s->get<shading::RootShader>().getAttributeTable();
+                const auto& reqKeys = table->getRequiredAttributes();
+                requestedAttributes.insert(reqKeys.begin(), reqKeys.end());
+                const auto& optKeys = table->getOptionalAttributes();
+                requestedAttributes.insert(optKeys.begin(), optKeys.end());
+            }
+            } else {
+                geometry->warn("Geometry is not in the Layer");
+            }
 
-                shading::PerGeometryAttributeKeySet::const_iterator itr =
-                    perGeometryAttributes.find(geometry);
-                if (itr != perGeometryAttributes.end()) {
-                    if (!itr->second.empty()) {
-                        requestedAttributes.insert(itr->second.begin(),
-                            itr->second.end());
-                    }
+            shading::PerGeometryAttributeKeySet::const_iterator itr =
+                perGeometryAttributes.find(geometry);
+            if (itr != perGeometryAttributes.end()) {
+                if (!itr->second.empty()) {
+                    requestedAttributes.insert(itr->second.begin(),
+                        itr->second.end());
                 }
+            }
 
-                // Generate geometry for the procedural.
-                GeomGenerateContext generateContext(layer,
-                    geometry, std::move(requestedAttributes), currentFrame,
-                    threadCount, motionBlurParams);
-                // TODO: We can't handle nested procedurals yet.
-                if (!geometry->getProcedural()->isLeaf()) {
-                    geometry->error("Nested procedurals not supported yet.");
-                }
-                geom::Procedural* procedural = geometry->getProcedural();
+            // Generate geometry for the procedural.
+            GeomGenerateContext generateContext(layer,
+                geometry, std::move(requestedAttributes), currentFrame,
+                threadCount, motionBlurParams, frustums);
+            // TODO: We can't handle nested procedurals yet.
+            if (!geometry->getProcedural()->isLeaf()) {
+                geometry->error("Nested procedurals not supported yet.");
+            }
+            geom::Procedural* procedural = geometry->getProcedural();
+            const auto generate = [&]() {
                 try {
                     procedural->clear();
                     if (isReferenced.find(geometry) != isReferenced.end()) {
@@ -717,16 +765,47 @@ GeometryManager::loadGeometries(scene_rdl2::rdl2::Layer* layer,
                 } catch (const std::exception &e) {
                     geometry->error(e.what());
                 }
-                RdlGeometrySetter rdlGeometrySetter(geometry);
-                procedural->forEachPrimitive(rdlGeometrySetter);
+            };
+            if (procedural->isGenerateThreadSafe()) {
+                generate();
+            } else {
+                // One generate() at a time per scene class.  Isolated so
+                // this thread can't pick up another generate() of the same
+                // class while it holds the lock.
+                std::lock_guard<std::mutex> lock(classMutexes.at(&geometry->getSceneClass()));
+                tbb::this_task_arena::isolate(generate);
+            }
+            RdlGeometrySetter rdlGeometrySetter(geometry);
+            procedural->forEachPrimitive(rdlGeometrySetter);
+            generatedGeometries.insert(geometry);
 
-                if (mOptions.stats.mGeometryManagerExecTracker.endLoadGeometriesItem() ==
-                    GeometryManagerExecTracker::RESULT::CANCELED) {
-                    geoLoadItemCancelCondition = true;
-                    return;
+            if (mOptions.stats.mGeometryManagerExecTracker.endLoadGeometriesItem() ==
+                GeometryManagerExecTracker::RESULT::CANCELED) {
+                geoLoadItemCancelCondition = true;
+                return;
+            }
+        };
+
+        // The generate() calls run in an arena of threadCount threads, each
+        // one releases the geometries waiting on it, canceled or not.
+        tbb::task_arena generateArena(static_cast<int>(std::max(threadCount, 1u)));
+        tbb::task_group generateGroup;
+        std::function<void(size_t)> generateItem = [&](size_t i) {
+            generateGeometry(geometriesToGenerate[i]);
+            for (size_t dependent : dependents[i]) {
+                if (--numPendingReferences[dependent] == 0) {
+                    generateGroup.run([&generateItem, dependent]() { generateItem(dependent); });
                 }
-            });
-        }
+            }
+        };
+        generateArena.execute([&]() {
+            for (size_t i = 0; i < geometriesToGenerate.size(); ++i) {
+                if (numPendingReferences[i] == 0) {
+                    generateGroup.run([&generateItem, i]() { generateItem(i); });
+                }
+            }
+            generateGroup.wait();
+        });
 
         if (geoLoadItemCancelCondition) {
             mOptions.stats.mGeometryManagerExecTracker.finalizeLoadGeometriesItem(true); // cancel = true
@@ -1063,6 +1142,11 @@ GeometryManager::finalizeChanges(scene_rdl2::rdl2::Layer* layer,
         TransformConcatenator transformConcatenator(motionBlurParams);
         ReferenceSetter referenceSetter(0.f, true);
         for (auto& sharedPrimitive : sharedPrimitives) {
+            // a finalize resumed after a cancel already transformed the shared
+            // primitives the canceled render prep got to
+            if (!mTransformedSharedPrimitives.insert(sharedPrimitive.get()).second) {
+                continue;
+            }
             sharedPrimitive->getPrimitive()->accept(transformConcatenator);
             // Set adaptive error to 0 on objects that are instanced to disable
             // adaptive tessellation
@@ -1112,11 +1196,17 @@ GeometryManager::finalizeChanges(scene_rdl2::rdl2::Layer* layer,
         }
 
         if (updateSceneBVH) {
-            if (mOptions.stats.mGeometryManagerExecTracker.startBVHConstruction() ==
+            int totalBVHGeometries = 0;
+            for (const auto& geometrySet : geometrySets) {
+                totalBVHGeometries += geometrySet->getGeometries().size();
+            }
+            if (mOptions.stats.mGeometryManagerExecTracker.startBVHConstruction(totalBVHGeometries) ==
                 GeometryManagerExecTracker::RESULT::CANCELED) {
                 return GM_RESULT::CANCELED;
             }
-            updateAccelerator(layer, geometrySets, g2s, accelMode);
+            if (updateAccelerator(layer, geometrySets, g2s, accelMode) == GM_RESULT::CANCELED) {
+                return GM_RESULT::CANCELED;
+            }
             if (mOptions.stats.mGeometryManagerExecTracker.endBVHConstruction() ==
                 GeometryManagerExecTracker::RESULT::CANCELED) {
                 return GM_RESULT::CANCELED;
@@ -1128,6 +1218,7 @@ GeometryManager::finalizeChanges(scene_rdl2::rdl2::Layer* layer,
         GeometryManagerExecTracker::RESULT::CANCELED) {
         return GM_RESULT::CANCELED;
     }
+    mTransformedSharedPrimitives.clear();
 
     return GM_RESULT::FINISHED;
 }
@@ -1402,6 +1493,8 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
         primitivesToTessellate.size());
     mOptions.stats.mPerPrimitiveTessellationMemoryUsed.resize(statsSize +
         primitivesToTessellate.size());
+    mOptions.stats.mPerPrimitiveDisplacementStats.resize(statsSize +
+        primitivesToTessellate.size());
     // tessellation timer for all primitives
     util::AverageDouble previousTessellationTime(
         mOptions.stats.mTessellationTime.getCount(),
@@ -1435,7 +1528,55 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
 
     std::atomic<bool> tessellationCancelCondition(false);
 
-    tbb::blocked_range<size_t> range(0, primitivesToTessellate.size());
+    // Split the scene face budget between meshes by their base face count.
+    // The split only depends on the input meshes so the result doesn't
+    // change with the order the primitives get tessellated in.
+    std::vector<size_t> faceBudgets(primitivesToTessellate.size(), 0);
+    if (mOptions.tessellationFaceBudget > 0) {
+        size_t totalBaseFaceCount = 0;
+        for (size_t i = 0; i < primitivesToTessellate.size(); ++i) {
+            const geom::internal::Mesh* mesh =
+                dynamic_cast<const geom::internal::Mesh*>(primitivesToTessellate[i]);
+            if (mesh) {
+                faceBudgets[i] = mesh->getBaseFaceCount();
+                totalBaseFaceCount += faceBudgets[i];
+            }
+        }
+        if (totalBaseFaceCount > 0) {
+            const double budgetRatio =
+                static_cast<double>(mOptions.tessellationFaceBudget) / totalBaseFaceCount;
+            for (size_t& faceBudget : faceBudgets) {
+                // never ask for fewer faces than the base mesh, which is
+                // what the coarsest tessellation produces anyway
+                faceBudget = std::max(faceBudget,
+                    static_cast<size_t>(faceBudget * budgetRatio));
+            }
+        }
+    }
+    std::atomic<size_t> budgetSavedFaceCount(0);
+    std::atomic<size_t> budgetLimitedPrimitiveCount(0);
+
+    geom::internal::OpenSubdivTopologyCache& subdTopologyCache =
+        geom::internal::OpenSubdivTopologyCache::get();
+    subdTopologyCache.setEnabled(mOptions.cacheSubdTopology);
+    subdTopologyCache.beginPass();
+
+    // The buffers of the previous pass give their chunks back as the
+    // primitives get re-tessellated.
+    if (mOptions.tessellationArena) {
+        if (!mTessellationArena) {
+            mTessellationArena.reset(
+                new geom::internal::TessellationArena(mOptions.tessellationArenaHugePages));
+        }
+        mTessellationArena->reset();
+    } else {
+        mTessellationArena.reset();
+    }
+
+    // Tessellation cost varies wildly between primitives (a single heavy subd
+    // mesh can dominate), so schedule every primitive as its own task rather
+    // than letting the auto partitioner batch several of them on one thread.
+    tbb::blocked_range<size_t> range(0, primitivesToTessellate.size(), 1);
     tbb::parallel_for(range, [&](const tbb::blocked_range<size_t> &r) {
         // When we create this localThreadID, the global atomic gThreadIdCounter is
         // incremented. This way, each thread gets a unique id.
@@ -1480,7 +1621,9 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
                                                                     enableDisplacement,
                                                                     fastGeomUpdate,
                                                                     /* isBaking = */ false,
-                                                                    mVolumeAssignmentTable.get());
+                                                                    mVolumeAssignmentTable.get(),
+                                                                    faceBudgets[i],
+                                                                    mTessellationArena.get());
                 prim->tessellate(tessParams, tessStats);
 
                 // Bake the density map of a volume shader bound to this primitive. This is more
@@ -1496,6 +1639,12 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
                 std::make_pair(prim, primTessTime.getSum());
             mOptions.stats.mPerPrimitiveTessellationMemoryUsed[statsSize + i] =
                 std::make_pair(prim, tessStats.mMemoryUsed);
+            mOptions.stats.mPerPrimitiveDisplacementStats[statsSize + i] =
+                std::make_pair(prim, tessStats.mDisplacement);
+            if (tessStats.mBudgetSavedFaceCount > 0) {
+                budgetSavedFaceCount += tessStats.mBudgetSavedFaceCount;
+                ++budgetLimitedPrimitiveCount;
+            }
 
             std::stringstream finishedMsg;
             finishedMsg << "Thread " << localThreadID.mId << "\t: FINISHED tessellating "
@@ -1508,10 +1657,27 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
                 return;
             }
         }
-    });
+    }, tbb::simple_partitioner());
     tessellationTimer.stop();
     mOptions.stats.mTessellationTime += previousTessellationTime;
 
+    if (mOptions.tessellationFaceBudget > 0) {
+        mOptions.stats.mTessellationBudgetSavedFaceCount += budgetSavedFaceCount;
+        std::stringstream budgetMsg;
+        budgetMsg << "Tessellation face budget " << mOptions.tessellationFaceBudget
+                  << " saved ~" << budgetSavedFaceCount << " faces on "
+                  << budgetLimitedPrimitiveCount << " primitives.";
+        mOptions.stats.logString(budgetMsg.str());
+    }
+
+    subdTopologyCache.endPass();
+    if (subdTopologyCache.isEnabled()) {
+        mOptions.stats.logDebugString(subdTopologyCache.show());
+    }
+    if (mTessellationArena) {
+        mOptions.stats.logDebugString(mTessellationArena->show());
+    }
+
 #ifndef __APPLE__
     // return unused memory from malloc() arena to OS so process memory usage
     // stats are accurate
@@ -1535,7 +1701,8 @@ GeometryManager::tessellate(scene_rdl2::rdl2::Layer* layer,
     return GM_RESULT::FINISHED;
 }
 
-void GeometryManager::updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
+GeometryManager::GM_RESULT
+GeometryManager::updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
         const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
         const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap& g2s,
         OptimizationTarget accelMode)
@@ -1544,15 +1711,31 @@ void GeometryManager::updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
         "---------- Building BVH ----------------------------------");
     Timer buildBVHTimer(mOptions.stats.mBuildAcceleratorTime);
     buildBVHTimer.start();
+
+    GeometryManagerExecTracker& execTracker = mOptions.stats.mGeometryManagerExecTracker;
+    const EmbreeAccelerator::CancelCallBack geometryCancel = [&]() {
+        return execTracker.startBVHConstructionItem() == GeometryManagerExecTracker::RESULT::CANCELED;
+    };
+    const EmbreeAccelerator::CancelCallBack commitCancel = [&]() {
+        return execTracker.checkBVHConstructionCancel() == GeometryManagerExecTracker::RESULT::CANCELED;
+    };
+
     // geometry updates for real time rendering do not have valid
     // GeometryToRootShadersMaps. So we pass in the nullptr instead.
+    bool built;
     if (mSceneContext->getSceneVariables().get(
         scene_rdl2::rdl2::SceneVariables::sFastGeomUpdate)) {
-        mEmbreeAccelerator->build(accelMode, mChangeStatus, layer,
-            geometrySets, nullptr);
+        built = mEmbreeAccelerator->build(accelMode, mChangeStatus, layer,
+            geometrySets, nullptr, geometryCancel, commitCancel);
     } else {
-        mEmbreeAccelerator->build(accelMode, mChangeStatus, layer,
-            geometrySets, &g2s);
+        built = mEmbreeAccelerator->build(accelMode, mChangeStatus, layer,
+            geometrySets, &g2s, geometryCancel, commitCancel);
+    }
+    if (!built) {
+        buildBVHTimer.stop();
+        execTracker.cancelBVHConstruction();
+        mOptions.stats.logString("BVH build canceled.");
+        return GM_RESULT::CANCELED;
     }
 
 #ifndef __APPLE__
@@ -1561,7 +1744,21 @@ void GeometryManager::updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
     malloc_trim(0);
 #endif
 
-    mOptions.stats.logString("BVH build finished.");
+    mOptions.stats.mGeometryManagerExecTracker.setBVHUpdateCounts(
+        mEmbreeAccelerator->mBvhRebuiltPrimitives, mEmbreeAccelerator->mBvhRefitPrimitives);
+
+    mOptions.stats.mGeometryManagerExecTracker.setBVHDeferredScenes(
+        mEmbreeAccelerator->getDeferredScenes());
+
+    mOptions.stats.logString("BVH build finished. rebuilt primitives: " +
+            std::to_string(mEmbreeAccelerator->mBvhRebuiltPrimitives) + " refit primitives: " +
+            std::to_string(mEmbreeAccelerator->mBvhRefitPrimitives) + " deferred instance BVHs: " +
+            std::to_string(mEmbreeAccelerator->getDeferredScenes()) + " motion steps: " +
+            std::to_string(mEmbreeAccelerator->mBvhBuiltMotionSteps) + " of " +
+            std::to_string(mEmbreeAccelerator->mBvhInputMotionSteps) + " instance BVH quality high/medium/low: " +
+            std::to_string(mEmbreeAccelerator->mBvhSharedScenes[0]) + "/" +
+            std::to_string(mEmbreeAccelerator->mBvhSharedScenes[1]) + "/" +
+            std::to_string(mEmbreeAccelerator->mBvhSharedScenes[2]));
 
     buildBVHTimer.stop();
 
@@ -1576,6 +1773,8 @@ void GeometryManager::updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
             std::to_string(upper.x) + " " +
             std::to_string(upper.y) + " " +
             std::to_string(upper.z));
+
+    return GM_RESULT::FINISHED;
 }
 
 void GeometryManager::updateGPUAccelerator(bool allowUnsupportedFeatures,
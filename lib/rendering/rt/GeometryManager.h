@@ -9,6 +9,7 @@
 
 #include <moonray/common/mcrt_util/Average.h>
 #include <moonray/rendering/mcrt_common/Frustum.h>
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
 #include <moonray/rendering/geom/MotionBlurParams.h>
 #include <moonray/rendering/geom/prim/NamedPrimitive.h>
 #include <moonray/rendering/geom/Primitive.h>
@@ -22,14 +23,18 @@
 
 #include <tbb/concurrent_unordered_set.h>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace moonray {
 
 namespace geom {
 class BakedMesh;
 class BakedCurves;
+class SharedPrimitive;
 
 namespace internal {
+class TessellationArena;
 class VolumeAssignmentTable;
 }
 }
@@ -52,6 +57,9 @@ struct GeometryManagerStats
     double mRtcCommitTime;
     std::vector<std::pair<geom::internal::NamedPrimitive*, double> > mPerPrimitiveTessellationTime;
     std::vector<std::pair<geom::internal::NamedPrimitive*, size_t> > mPerPrimitiveTessellationMemoryUsed;
+    std::vector<std::pair<geom::internal::NamedPrimitive*, geom::internal::DisplacementStats> > mPerPrimitiveDisplacementStats;
+    // estimated tessellated faces skipped by GeometryManagerOptions::tessellationFaceBudget
+    size_t mTessellationBudgetSavedFaceCount = 0;
 
     GeometryManagerExecTracker mGeometryManagerExecTracker;
 
@@ -64,6 +72,8 @@ struct GeometryManagerStats
         mRtcCommitTime = 0.0;
         mPerPrimitiveTessellationTime.clear();
         mPerPrimitiveTessellationMemoryUsed.clear();
+        mPerPrimitiveDisplacementStats.clear();
+        mTessellationBudgetSavedFaceCount = 0;
 
         mGeometryManagerExecTracker.initLoadGeometries(0);
         mGeometryManagerExecTracker.initFinalizeChange(0);
@@ -76,6 +86,16 @@ GeometryManagerOptions
 {
     GeometryManagerStats stats;
     AcceleratorOptions accelOptions;
+    // Keep refined subdivision topology between tessellation passes so meshes
+    // that only deform skip the OpenSubdiv topology refinement on updates.
+    bool cacheSubdTopology = false;
+    // Scene wide upper bound of tessellated mesh faces, 0 means unlimited.
+    // It is shared between meshes in proportion to their base face count.
+    size_t tessellationFaceBudget = 0;
+    // Carve the tessellated vertex buffers of the layer out of a few large
+    // chunks, backed as requested by tessellationArenaHugePages.
+    bool tessellationArena = false;
+    mcrt_common::HugePageMode tessellationArenaHugePages = mcrt_common::HugePageMode::OFF;
 };
 
 /**
@@ -102,10 +122,14 @@ public:
     ~GeometryManager() = default;
 
     /// Load geometries and their procedurals from the SceneContext and Layer.
+    /// Geometries generated since the last discardCanceledWork() call are not
+    /// generated again, so a render prep canceled by the cancel callback resumes
+    /// where it stopped.
     GM_RESULT loadGeometries(scene_rdl2::rdl2::Layer* layer, const ChangeFlag flag,
                              const scene_rdl2::math::Mat4d& world2render,
                              const int currentFrame,
                              const geom::MotionBlurParams& motionBlurParams,
+                             const std::vector<mcrt_common::Frustum>& frustums,
                              const unsigned threadCount,
                              const shading::PerGeometryAttributeKeySet &perGeometryAttributes);
 
@@ -177,6 +201,21 @@ public:
         mOptions.stats.reset();
     }
 
+    /// Forgets the geometries generated by a canceled render prep, they get
+    /// generated again by the next loadGeometries(). Has to be called once a
+    /// render prep finished and whenever the scene changed after a cancel.
+    void discardCanceledWork()
+    {
+        mGeneratedGeometries.clear();
+        mTransformedSharedPrimitives.clear();
+    }
+
+    // Overrides GeometryManagerOptions::tessellationFaceBudget for the next tessellation.
+    void setTessellationFaceBudget(size_t faceBudget)
+    {
+        mOptions.tessellationFaceBudget = faceBudget;
+    }
+
     finline void setChangeFlag(ChangeFlag flag)
     {
         mChangeStatus = flag;
@@ -226,7 +265,7 @@ private:
 
     /// Add/update geometries in the provided GeometrySets to the
     /// spatial accelerator
-    void updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
+    GM_RESULT updateAccelerator(const scene_rdl2::rdl2::Layer* layer,
             const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
             const scene_rdl2::rdl2::Layer::GeometryToRootShadersMap& g2s,
             OptimizationTarget accelMode);
@@ -244,6 +283,13 @@ private:
     /// which require a BVH update
     TbbSetOfGeometrySet mDeformedGeometrySets;
 
+    typedef tbb::concurrent_unordered_set<const scene_rdl2::rdl2::Geometry*> TbbSetOfGeometry;
+
+    /// The geometries of each layer generated since the last discardCanceledWork(),
+    /// and the shared primitives finalizeChanges() moved to their local space
+    std::unordered_map<const scene_rdl2::rdl2::Layer*, TbbSetOfGeometry> mGeneratedGeometries;
+    std::unordered_set<const geom::SharedPrimitive*> mTransformedSharedPrimitives;
+
     // The Embree spatial accelerator for ray intersection.
     std::unique_ptr<EmbreeAccelerator> mEmbreeAccelerator;
 
@@ -258,6 +304,9 @@ private:
     ChangeFlagAtomic mChangeStatus;
 
     std::unique_ptr<geom::internal::VolumeAssignmentTable> mVolumeAssignmentTable;
+
+    // Created by the first tessellation pass when GeometryManagerOptions::tessellationArena is set
+    std::unique_ptr<geom::internal::TessellationArena> mTessellationArena;
 };
 
 // For use with shadow suppression between specified geometries
@@ -42,6 +42,11 @@ GeometryManagerExecTracker::initFinalizeChange(int stageId)
     for (int i = stageId; i < mStageMax; ++i) {
         mRunTessellation[i] = Condition::INIT;
         mRunBVHConstruction[i] = Condition::INIT;
+        mRunBVHConstructionTotal[i] = 0;
+        mRunBVHConstructionProcessed[i] = 0;
+        mBVHRebuiltPrimitives[i] = 0;
+        mBVHRefitPrimitives[i] = 0;
+        mBVHDeferredScenes[i] = 0;
     }
 
     mRenderPrepStatsCallBack = nullptr;
@@ -187,8 +192,11 @@ GeometryManagerExecTracker::endTessellation()
 }
 
 GeometryManagerExecTracker::RESULT
-GeometryManagerExecTracker::startBVHConstruction()
+GeometryManagerExecTracker::startBVHConstruction(int totalGeometries)
 {
+    mRunBVHConstructionTotal[mStageId] = totalGeometries;
+    mRunBVHConstructionProcessed[mStageId] = 0; // just in case
+
     return updateRunStatus(CancelCodePos::BVH_CONSTRUCTION_0_START,
                            CancelCodePos::BVH_CONSTRUCTION_1_START,
                            mRunBVHConstruction[mStageId],
@@ -196,6 +204,34 @@ GeometryManagerExecTracker::startBVHConstruction()
                            Condition::START_CANCELED);
 }
 
+GeometryManagerExecTracker::RESULT
+GeometryManagerExecTracker::startBVHConstructionItem()
+{
+    // A cancel stops the whole BVH construction, so it directly goes to END_CANCELED.
+    RESULT result = updateRunStatus(CancelCodePos::BVH_CONSTRUCTION_ITEM_0,
+                                    CancelCodePos::BVH_CONSTRUCTION_ITEM_1,
+                                    mRunBVHConstruction[mStageId],
+                                    Condition::START,
+                                    Condition::END_CANCELED);
+    mRunBVHConstructionProcessed[mStageId]++;
+    return result;
+}
+
+GeometryManagerExecTracker::RESULT
+GeometryManagerExecTracker::checkBVHConstructionCancel() const
+{
+    return checkRunStatus((mStageId == 0) ?
+                          CancelCodePos::BVH_CONSTRUCTION_ITEM_0 :
+                          CancelCodePos::BVH_CONSTRUCTION_ITEM_1);
+}
+
+void
+GeometryManagerExecTracker::cancelBVHConstruction()
+{
+    mRunBVHConstruction[mStageId] = Condition::END_CANCELED;
+    renderPrepStatsUpdate();
+}
+
 GeometryManagerExecTracker::RESULT
 GeometryManagerExecTracker::endBVHConstruction()
 {
@@ -206,6 +242,13 @@ GeometryManagerExecTracker::endBVHConstruction()
                            Condition::END_CANCELED);
 }
 
+void
+GeometryManagerExecTracker::setBVHUpdateCounts(unsigned rebuiltPrimitives, unsigned refitPrimitives)
+{
+    mBVHRebuiltPrimitives[mStageId] = rebuiltPrimitives;
+    mBVHRefitPrimitives[mStageId] = refitPrimitives;
+}
+
 GeometryManagerExecTracker::RESULT
 GeometryManagerExecTracker::endFinalizeChange()
 {
@@ -224,6 +267,7 @@ GeometryManagerExecTracker::cancelInfoEncode() const
     vcEnq.enqInt(static_cast<int>(mCancelCodePos));
     vcEnq.enqInt(mCancelCodePosLoadGeomCounter);
     vcEnq.enqInt(mCancelCodePosTessellationCounter);
+    vcEnq.enqInt(mCancelCodePosBVHConstructionCounter);
     vcEnq.finalize();
     return data;
 }
@@ -235,6 +279,7 @@ GeometryManagerExecTracker::cancelInfoDecode(const std::string &data)
     mCancelCodePos = static_cast<CancelCodePos>(vcDeq.deqInt());
     mCancelCodePosLoadGeomCounter = vcDeq.deqInt();
     mCancelCodePosTessellationCounter = vcDeq.deqInt();
+    mCancelCodePosBVHConstructionCounter = vcDeq.deqInt();
 }
 
 std::string
@@ -287,6 +332,11 @@ GeometryManagerExecTracker::show() const
          << "    mRunTessellationItem:" << showCondition(mRunTessellationItem[0]) << '\n'
          << "    mRunTessellationProcessed:" << mRunTessellationProcessed[0] << '\n'
          << "    mRunBVHConstruction:" << showCondition(mRunBVHConstruction[0]) << '\n'
+         << "    mRunBVHConstructionTotal:" << mRunBVHConstructionTotal[0] << '\n'
+         << "    mRunBVHConstructionProcessed:" << mRunBVHConstructionProcessed[0] << '\n'
+         << "    mBVHRebuiltPrimitives:" << mBVHRebuiltPrimitives[0] << '\n'
+         << "    mBVHRefitPrimitives:" << mBVHRefitPrimitives[0] << '\n'
+         << "    mBVHDeferredScenes:" << mBVHDeferredScenes[0] << '\n'
          << "  }\n"
          << "  stage_1 finalizeChange {\n"
          << "    mRunFinalizeChange:" << showCondition(mRunFinalizeChange[1]) << '\n' 
@@ -295,10 +345,16 @@ GeometryManagerExecTracker::show() const
          << "    mRunTessellationItem:" << showCondition(mRunTessellationItem[1]) << '\n'
          << "    mRunTessellationProcessed:" << mRunTessellationProcessed[1] << '\n'
          << "    mRunBVHConstruction:" << showCondition(mRunBVHConstruction[1]) << '\n'
+         << "    mRunBVHConstructionTotal:" << mRunBVHConstructionTotal[1] << '\n'
+         << "    mRunBVHConstructionProcessed:" << mRunBVHConstructionProcessed[1] << '\n'
+         << "    mBVHRebuiltPrimitives:" << mBVHRebuiltPrimitives[1] << '\n'
+         << "    mBVHRefitPrimitives:" << mBVHRefitPrimitives[1] << '\n'
+         << "    mBVHDeferredScenes:" << mBVHDeferredScenes[1] << '\n'
          << "  }\n"
          << "  mCancelCodePos:" << showCancelCodePosWithId() << '\n'
          << "  mCancelCodePosLoadGeomCounter:" << mCancelCodePosLoadGeomCounter << '\n'
          << "  mCancelCodePosTessellationCounter:" << mCancelCodePosTessellationCounter << '\n'
+         << "  mCancelCodePosBVHConstructionCounter:" << mCancelCodePosBVHConstructionCounter << '\n'
          << "}";
     return ostr.str();
 }
@@ -331,6 +387,11 @@ GeometryManagerExecTracker::parserConfigure()
                     mCancelCodePosTessellationCounter = (arg++).as<int>(0);
                     return true;
                 });
+    mParser.opt("cancelBVHConstructionCounter", "<id>", "set BVH construction geometry-id for BVH cancelTest",
+                [&](Arg &arg) -> bool {
+                    mCancelCodePosBVHConstructionCounter = (arg++).as<int>(0);
+                    return true;
+                });
     mParser.opt("cancelCodePosIdList", "", "show cancel code position id list",
                 [&](Arg &arg) -> bool { return arg.msg(showCancelCodePosIdList() + '\n'); });
     mParser.opt("show", "", "show internal parameters",
@@ -377,6 +438,13 @@ GeometryManagerExecTracker::checkRunStatus(const CancelCodePos &callerCodePos) c
                 return RESULT::CANCELED;
             }
             break;
+        case CancelCodePos::BVH_CONSTRUCTION_ITEM_0 :
+        case CancelCodePos::BVH_CONSTRUCTION_ITEM_1 :
+            // We have to check cancelCodePosBVHConstructionCounter
+            if (mCancelCodePosBVHConstructionCounter <= mRunBVHConstructionProcessed[mStageId]) {
+                return RESULT::CANCELED;
+            }
+            break;
         default :
             return RESULT::CANCELED;
         }
@@ -632,6 +700,7 @@ GeometryManagerExecTracker::showCancelCodePos(const CancelCodePos &cancelCodePos
     case CancelCodePos::TESSELLATION_ITEM_0_END : return "TESSELLATION_ITEM_0_END";
     case CancelCodePos::TESSELLATION_0_END : return "TESSELLATION_0_END";
     case CancelCodePos::BVH_CONSTRUCTION_0_START : return "BVH_CONSTRUCTION_0_START";
+    case CancelCodePos::BVH_CONSTRUCTION_ITEM_0 : return "BVH_CONSTRUCTION_ITEM_0";
     case CancelCodePos::BVH_CONSTRUCTION_0_END : return "BVH_CONSTRUCTION_0_END";
     case CancelCodePos::FINALIZE_CHANGE_0_END : return "FINALIZE_CHANGE_0_END";
     case CancelCodePos::FINALIZE_CHANGE_1_START : return "FINALIZE_CHANGE_1_START";
@@ -640,6 +709,7 @@ GeometryManagerExecTracker::showCancelCodePos(const CancelCodePos &cancelCodePos
     case CancelCodePos::TESSELLATION_ITEM_1_END : return "TESSELLATION_ITEM_1_END";
     case CancelCodePos::TESSELLATION_1_END : return "TESSELLATION_1_END";
     case CancelCodePos::BVH_CONSTRUCTION_1_START : return "BVH_CONSTRUCTION_1_START";
+    case CancelCodePos::BVH_CONSTRUCTION_ITEM_1 : return "BVH_CONSTRUCTION_ITEM_1";
     case CancelCodePos::BVH_CONSTRUCTION_1_END : return "BVH_CONSTRUCTION_1_END";
     case CancelCodePos::FINALIZE_CHANGE_1_END : return "FINALIZE_CHANGE_1_END";
 
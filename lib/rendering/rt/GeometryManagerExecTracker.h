@@ -55,9 +55,15 @@ public:
         mRunTessellation{Condition::INIT, Condition::INIT},
         mRunTessellationTotal{0, 0},
         mRunBVHConstruction{Condition::INIT, Condition::INIT},
+        mRunBVHConstructionTotal{0, 0},
+        mRunBVHConstructionProcessed{0, 0},
+        mBVHRebuiltPrimitives{0, 0},
+        mBVHRefitPrimitives{0, 0},
+        mBVHDeferredScenes{0, 0},
         mCancelCodePos(CancelCodePos::EMPTY),
         mCancelCodePosLoadGeomCounter(std::numeric_limits<int>::max()),
-        mCancelCodePosTessellationCounter(std::numeric_limits<int>::max())
+        mCancelCodePosTessellationCounter(std::numeric_limits<int>::max()),
+        mCancelCodePosBVHConstructionCounter(std::numeric_limits<int>::max())
     {
         // The following parameters need initialize here in order to avoid GCC compile error.
         for (int i = 0; i < mStageMax; ++i) {
@@ -79,9 +85,15 @@ public:
         mRunTessellation{src.mRunTessellation[0], src.mRunTessellation[1]},
         mRunTessellationTotal{src.mRunTessellationTotal[0], src.mRunTessellationTotal[1]},
         mRunBVHConstruction{src.mRunBVHConstruction[0], src.mRunBVHConstruction[1]},
+        mRunBVHConstructionTotal{src.mRunBVHConstructionTotal[0], src.mRunBVHConstructionTotal[1]},
+        mRunBVHConstructionProcessed{src.mRunBVHConstructionProcessed[0], src.mRunBVHConstructionProcessed[1]},
+        mBVHRebuiltPrimitives{src.mBVHRebuiltPrimitives[0], src.mBVHRebuiltPrimitives[1]},
+        mBVHRefitPrimitives{src.mBVHRefitPrimitives[0], src.mBVHRefitPrimitives[1]},
+        mBVHDeferredScenes{src.mBVHDeferredScenes[0], src.mBVHDeferredScenes[1]},
         mCancelCodePos(src.mCancelCodePos),
         mCancelCodePosLoadGeomCounter(src.mCancelCodePosLoadGeomCounter),
-        mCancelCodePosTessellationCounter(src.mCancelCodePosTessellationCounter)
+        mCancelCodePosTessellationCounter(src.mCancelCodePosTessellationCounter),
+        mCancelCodePosBVHConstructionCounter(src.mCancelCodePosBVHConstructionCounter)
     {
         // The following parameters need initialize here in order to avoid GCC compile error.
         for (int i = 0; i < mStageMax; ++i) {
@@ -116,15 +128,25 @@ public:
 
     RESULT startFinalizeChange();
 
-    // Probably some detailed progress update API will be added between startBVHConstruction
-    // and endBVHConstruction in the future in order to capture more detailed progress updates.
     RESULT startTessellation(int totalTessellation);
     RESULT startTessellationItem(); // called from multi-threaded function
     RESULT endTessellationItem(); // called from multi-threaded function
     void   finalizeTessellationItem(bool canceled);
     RESULT endTessellation();
-    RESULT startBVHConstruction();
+    RESULT startBVHConstruction(int totalGeometries);
+    RESULT startBVHConstructionItem(); // called before the BVH of each geometry is built
+    // Cancel check without stats update, called from the embree build threads while the
+    // root scene gets committed.
+    RESULT checkBVHConstructionCancel() const;
+    void   cancelBVHConstruction(); // BVH construction stopped in the middle
     RESULT endBVHConstruction();
+    // Number of primitives whose BVH got rebuilt or refit by the BVH construction of the current stage
+    void setBVHUpdateCounts(unsigned rebuiltPrimitives, unsigned refitPrimitives);
+    unsigned getBVHRebuiltPrimitives() const { return mBVHRebuiltPrimitives[mStageId]; }
+    unsigned getBVHRefitPrimitives() const { return mBVHRefitPrimitives[mStageId]; }
+    // Number of instanced primitive BVHs whose build got deferred until a ray reaches them
+    void setBVHDeferredScenes(unsigned deferredScenes) { mBVHDeferredScenes[mStageId] = deferredScenes; }
+    unsigned getBVHDeferredScenes() const { return mBVHDeferredScenes[mStageId]; }
 
     RESULT endFinalizeChange();
 
@@ -157,6 +179,7 @@ private:
         TESSELLATION_ITEM_0_END,
         TESSELLATION_0_END,
         BVH_CONSTRUCTION_0_START,
+        BVH_CONSTRUCTION_ITEM_0,
         BVH_CONSTRUCTION_0_END,
         FINALIZE_CHANGE_0_END,
         FINALIZE_CHANGE_1_START,
@@ -165,6 +188,7 @@ private:
         TESSELLATION_ITEM_1_END,
         TESSELLATION_1_END,
         BVH_CONSTRUCTION_1_START,
+        BVH_CONSTRUCTION_ITEM_1,
         BVH_CONSTRUCTION_1_END,
         FINALIZE_CHANGE_1_END,
 
@@ -237,6 +261,11 @@ private:
 
     // internal of finalizeChange stage condition for BVH construction
     Condition mRunBVHConstruction[mStageMax];
+    int mRunBVHConstructionTotal[mStageMax];
+    int mRunBVHConstructionProcessed[mStageMax];
+    unsigned mBVHRebuiltPrimitives[mStageMax];
+    unsigned mBVHRefitPrimitives[mStageMax];
+    unsigned mBVHDeferredScenes[mStageMax];
 
     //------------------------------
 
@@ -244,6 +273,7 @@ private:
     CancelCodePos mCancelCodePos;
     int mCancelCodePosLoadGeomCounter;
     int mCancelCodePosTessellationCounter;
+    int mCancelCodePosBVHConstructionCounter;
 };
 
 } // namespace rt
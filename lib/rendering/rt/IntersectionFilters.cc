@@ -104,6 +104,9 @@ vdbVolumeIntervalFilter(const RTCFilterFunctionNArguments* args)
         // volume intersections
         args->valid[0] = 0;
         auto& volumeRayState = tls->mVolumeRayState;
+        if (volumeRayState.getVolumeAssignmentTable()->isInert(assignmentId)) {
+            return;
+        }
         const int volumeId = volumeRayState.getVolumeId(assignmentId, context->mRayExtension->volumeInstanceState);
         bool eval = !volumeRayState.isVisited(volumeId);
         if (ray->mask & (scene_rdl2::rdl2::SHADOW << scene_rdl2::rdl2::sNumVisibilityTypes)) {
@@ -215,6 +218,9 @@ manifoldVolumeIntervalFilter(const RTCFilterFunctionNArguments* args)
         // volume intersections
         args->valid[0] = 0;
         auto& volumeRayState = tls->mVolumeRayState;
+        if (volumeRayState.getVolumeAssignmentTable()->isInert(assignmentId)) {
+            return;
+        }
         const int volumeId = volumeRayState.getVolumeId(assignmentId, context->mRayExtension->volumeInstanceState);
         // ray casting method to determine whether ray origin is inside
         // this volume. If the ray hits this primitive even times,
@@ -263,24 +269,31 @@ bssrdfTraceSetIntersectionFilter(const RTCFilterFunctionNArguments* args)
     // TODO can we make this filter only get called while firing bssrdf
     // projection ray instead of register it to every intersection call?
     // (it seems embree can do some kind of per ray filter function call)
-    if (args->N == 1) {
+    int* valid = args->valid;
+    const unsigned int N = args->N;
+    RTCRayN* rays = args->ray;
+    RTCHitN* hits = args->hit;
+    mcrt_common::IntersectContext* context =
+        (mcrt_common::IntersectContext*)args->context;
+    const geom::internal::BVHUserData* userData =
+        (const geom::internal::BVHUserData*)args->geometryUserPtr;
+    auto primitive = (const geom::internal::NamedPrimitive*)userData->mPrimitive;
+    for (unsigned int index = 0; index < N; ++index) {
+        if (valid[index] == 0) {
+            continue;
+        }
         // If this is not a subsurface intersection,
-        // immediately exit filter function.
-        mcrt_common::IntersectContext* context =
-            (mcrt_common::IntersectContext*)args->context;
-        mcrt_common::RayExtension* rayExtension = context->mRayExtension;
+        // skip this ray.
+        const mcrt_common::RayExtension* rayExtension =
+            &context->mRayExtension[RTCRayN_id(rays, N, index)];
         if (rayExtension->materialID == -1) {
-            return;
+            continue;
         }
         auto geomTls = (geom::internal::TLState*)rayExtension->geomTls;
-        RTCRay* ray = (RTCRay*)args->ray;
-        RTCHit* hit = (RTCHit*)args->hit;
-        const geom::internal::BVHUserData* userData =
-            (const geom::internal::BVHUserData*)args->geometryUserPtr;
-        auto primitive = (const geom::internal::NamedPrimitive*)userData->mPrimitive;
-        int assignmentId = primitive->getIntersectionAssignmentId(hit->primID);
+        int assignmentId = primitive->getIntersectionAssignmentId(
+            RTCHitN_primID(hits, N, index));
         if (assignmentId < 0) {
-            return;
+            continue;
         }
         if (geomTls->mSubsurfaceTraceSet != nullptr) {
             // there is a user specified trace set
@@ -291,7 +304,7 @@ bssrdfTraceSetIntersectionFilter(const RTCFilterFunctionNArguments* args)
             // If there is ever a complaint that using a trace set
             // slows down the render, this is the place to optimize.
             if (traceSet->getAssignmentId(gp.first, gp.second) < 0) {
-                args->valid[0] = 0;
+                valid[index] = 0;
             }
         } else {
             // default case: we compare material ids of subsurface ray
@@ -301,7 +314,7 @@ bssrdfTraceSetIntersectionFilter(const RTCFilterFunctionNArguments* args)
             const shading::RootShader* material =
                 &rdl2Material->get<const shading::RootShader>();
             if (rayExtension->materialID != material->getMaterialId()) {
-                args->valid[0] = 0;
+                valid[index] = 0;
             }
         }
     }
@@ -329,56 +342,78 @@ backFaceCullingFilter(const RTCFilterFunctionNArguments* args)
     }
 }
 
+template <bool HasVolumeAssignment>
 void
 skipOcclusionFilter(const RTCFilterFunctionNArguments* args)
 {
-
-    // Although "args" points to a packet of N rays, in practice we always set N=1 (and there are parts of the code
-    // base which already rely on this assumption). So here we hardcode for that case - thus we only need to inspect
-    // valid[0] here, which we can write as *valid.
+    // "args" points to a packet of N rays. N is 1 for rays traced through the single ray
+    // EmbreeAccelerator::occluded() and VLEN for rays traced through the batched occluded() call.
+    // In both cases the ray id is the index of the matching RayExtension in the IntersectContext.
     int* valid = args->valid;
-    if (*valid == 0) {
-        return;
-    }
-
-    // We continue to assume N=1 here and cast the various data types to their single-ray counterparts.
+    const unsigned int N = args->N;
+    RTCRayN* rays = args->ray;
+    RTCHitN* hits = args->hit;
     const geom::internal::BVHUserData* userData = static_cast<const geom::internal::BVHUserData*>(args->geometryUserPtr);
     const geom::internal::NamedPrimitive* prim  = static_cast<const geom::internal::NamedPrimitive*>(userData->mPrimitive);
-    RTCRay* ray = (RTCRay*)args->ray;
-    RTCHit* hit = (RTCHit*)args->hit;
     const mcrt_common::IntersectContext* context = reinterpret_cast<const mcrt_common::IntersectContext*>(args->context);
-    mcrt_common::RayExtension& rayExtension = context->mRayExtension[ray->id];
-    int casterId = prim->getIntersectionAssignmentId(hit->primID);
-    int receiverId = rayExtension.shadowReceiverId;
-
-    // If the occlusion ray was cast from a volume, suppress shadowing by the geometry it's assigned to (see
-    // MOONRAY-4130). This test reuses the volumeInstanceState member of RayExtension, which is otherwise unused
-    // in occlusion tests.
-    if (rayExtension.volumeInstanceState && (receiverId == casterId)) {
-        *valid = 0;
-        return;
-    }
 
     // Shadow linking
     // We currently don't support per instance shadow linking.
     MNRY_ASSERT(userData->mPrimitive->getType() != geom::internal::Primitive::INSTANCE);
-    const geom::internal::ShadowLinking* shadowLinking = prim->getShadowLinking(casterId);
-    if (shadowLinking != nullptr) {
-        // Suppress shadows if this light is marked as not casting shadows from the caster geometry
-        if (!shadowLinking->canCastShadow((const scene_rdl2::rdl2::Light*)rayExtension.instance0OrLight)) {
-            *valid = 0;
-            return;
+
+    // The shadow linkings are updated without rebuilding the BVH when only the ShadowSets change,
+    // so this is checked here rather than when the filter is installed.
+    const bool hasShadowLinking = prim->hasAnyShadowLinking();
+    if (!HasVolumeAssignment && !hasShadowLinking) {
+        return;
+    }
+
+    for (unsigned int index = 0; index < N; ++index) {
+        if (valid[index] == 0) {
+            continue;
         }
 
-        // Suppress shadows if this receiver is marked as not receiving shadows from the caster geometry
-        // (See MOONRAY-4130 and MOONRAY-4663)
-        if (!shadowLinking->canReceiveShadow(receiverId)) {
-            *valid = 0;
-            return;
+        const mcrt_common::RayExtension& rayExtension = context->mRayExtension[RTCRayN_id(rays, N, index)];
+        const bool fromVolume = HasVolumeAssignment && rayExtension.volumeInstanceState;
+        if (!fromVolume && !hasShadowLinking) {
+            continue;
+        }
+        int casterId = prim->getIntersectionAssignmentId(RTCHitN_primID(hits, N, index));
+        int receiverId = rayExtension.shadowReceiverId;
+
+        // If the occlusion ray was cast from a volume, suppress shadowing by the geometry it's assigned to (see
+        // MOONRAY-4130). This test reuses the volumeInstanceState member of RayExtension, which is otherwise unused
+        // in occlusion tests.
+        if (fromVolume && (receiverId == casterId)) {
+            valid[index] = 0;
+            continue;
+        }
+
+        if (!hasShadowLinking) {
+            continue;
+        }
+
+        const geom::internal::ShadowLinking* shadowLinking = prim->getShadowLinking(casterId);
+        if (shadowLinking != nullptr) {
+            // Suppress shadows if this light is marked as not casting shadows from the caster geometry
+            if (!shadowLinking->canCastShadow((const scene_rdl2::rdl2::Light*)rayExtension.instance0OrLight)) {
+                valid[index] = 0;
+                continue;
+            }
+
+            // Suppress shadows if this receiver is marked as not receiving shadows from the caster geometry
+            // (See MOONRAY-4130 and MOONRAY-4663)
+            if (!shadowLinking->canReceiveShadow(receiverId)) {
+                valid[index] = 0;
+                continue;
+            }
         }
     }
 }
 
+template void skipOcclusionFilter<false>(const RTCFilterFunctionNArguments* args);
+template void skipOcclusionFilter<true>(const RTCFilterFunctionNArguments* args);
+
 } // namespace rt
 } // namespace moonray
 
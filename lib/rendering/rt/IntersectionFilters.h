@@ -16,8 +16,22 @@ void bssrdfTraceSetIntersectionFilter(const RTCFilterFunctionNArguments* args);
 
 void backFaceCullingFilter(const RTCFilterFunctionNArguments* args);
 
+// HasVolumeAssignment tells whether the geometry has a volume assigned in the
+// layer, without one the test which suppresses the self-shadowing of volumes
+// can never pass and is compiled out.
+template <bool HasVolumeAssignment>
 void skipOcclusionFilter(const RTCFilterFunctionNArguments* args);
 
+// Runs Filters in order as a single Embree filter callback. The filters a
+// geometry needs are known when it is added to the BVH, so it gets one of
+// these instead of going through the IntersectionFilterManager loop.
+template <RTCFilterFunctionN... Filters>
+void
+filterChain(const RTCFilterFunctionNArguments* args)
+{
+    (Filters(args), ...);
+}
+
 } // namespace rt
 } // namespace moonray
 
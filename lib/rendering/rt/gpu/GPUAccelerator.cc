@@ -19,6 +19,10 @@
 
 #include "GPUAccelerator.h"
 
+#include <scene_rdl2/render/util/GetEnv.h>
+
+#include <algorithm>
+
 #ifndef __APPLE__
 // This header must be included in exactly one .cc file for the link to succeed
 #include <optix_function_table_definition.h>
@@ -35,14 +39,35 @@ GPUAccelerator::GPUAccelerator(bool allowUnsupportedFeatures,
                                std::vector<std::string>& warningMsgs,
                                std::string* errorMsg)
 {
-    mImpl.reset(new GPUAcceleratorType(
-        allowUnsupportedFeatures, numCPUThreads, layer, geometrySets, g2s, warningMsgs, errorMsg));
-    if (!errorMsg->empty()) {
-        // Something went wrong so free everything
-        // Output the error to Logger::error so we are guaranteed to see it
-        scene_rdl2::logging::Logger::error("GPU: " + *errorMsg + "   ...falling back to CPU vectorized mode");
-        mImpl.reset();
+    int numDevices = GPUAcceleratorType::getNumDevices();
+    const int maxDevices = scene_rdl2::util::getenv<int>("MOONRAY_XPU_MAX_GPUS");
+    if (maxDevices > 0) {
+        numDevices = std::min(numDevices, maxDevices);
     }
+    // There is no point in a device without any queue feeding it
+    numDevices = std::min(numDevices, static_cast<int>(numCPUThreads));
+    // Let the impl report the missing device error
+    numDevices = std::max(numDevices, 1);
+
+    // The impls hold one set of input/output buffers per queue buffer
+    const uint32_t numBufferQueues = numCPUThreads * getNumQueueBuffers();
+
+    for (int deviceID = 0; deviceID < numDevices; deviceID++) {
+        // Every device builds the same scene, only keep the first device's warnings
+        std::vector<std::string> replicaWarningMsgs;
+        mImpls.emplace_back(new GPUAcceleratorType(
+            allowUnsupportedFeatures, deviceID, numBufferQueues, layer, geometrySets, g2s,
+            deviceID == 0 ? warningMsgs : replicaWarningMsgs, errorMsg));
+        if (!errorMsg->empty()) {
+            // Something went wrong so free everything
+            // Output the error to Logger::error so we are guaranteed to see it
+            scene_rdl2::logging::Logger::error("GPU: " + *errorMsg + "   ...falling back to CPU vectorized mode");
+            mImpls.clear();
+            return;
+        }
+    }
+    mDeviceStats.resize(mImpls.size());
+    mNumPendingRays.resize(numBufferQueues, 0);
 }
 
 GPUAccelerator::~GPUAccelerator()
@@ -52,7 +77,39 @@ GPUAccelerator::~GPUAccelerator()
 std::string
 GPUAccelerator::getGPUDeviceName() const
 {
-    return mImpl->getGPUDeviceName();
+    std::string name;
+    for (const auto& impl : mImpls) {
+        if (!name.empty()) {
+            name += ", ";
+        }
+        name += impl->getGPUDeviceName();
+    }
+    return name;
+}
+
+unsigned
+GPUAccelerator::getNumDevices() const
+{
+    return mImpls.size();
+}
+
+unsigned
+GPUAccelerator::getDeviceIdx(const uint32_t queueIdx) const
+{
+    return queueIdx % mImpls.size();
+}
+
+uint32_t
+GPUAccelerator::getBufferQueueIdx(const uint32_t queueIdx, const uint32_t bufferIdx)
+{
+    MNRY_ASSERT(bufferIdx < getNumQueueBuffers());
+    return queueIdx * getNumQueueBuffers() + bufferIdx;
+}
+
+unsigned
+GPUAccelerator::getNumQueueBuffers()
+{
+    return GPUAcceleratorType::getNumQueueBuffers();
 }
 
 void
@@ -60,25 +117,32 @@ GPUAccelerator::intersect(const uint32_t queueIdx,
                           const uint32_t numRays,
                           const GPURay* rays) const
 {
-    mImpl->intersect(queueIdx, numRays, rays);
+    const unsigned deviceIdx = getDeviceIdx(queueIdx);
+    beginBusy(deviceIdx);
+    mImpls[deviceIdx]->intersect(getBufferQueueIdx(queueIdx, 0), numRays, rays);
+    endBusy(deviceIdx, numRays);
 }
 
 GPURayIsect*
 GPUAccelerator::getOutputIsectBuf(const uint32_t queueIdx) const
 {
-    return mImpl->getOutputIsectBuf(queueIdx);
+    return mImpls[getDeviceIdx(queueIdx)]->getOutputIsectBuf(getBufferQueueIdx(queueIdx, 0));
 }
 
 GPURay*
-GPUAccelerator::getGPURaysBufUMA(const uint32_t queueIdx) const
+GPUAccelerator::getGPURaysBufUMA(const uint32_t queueIdx, const uint32_t bufferIdx) const
 {
-    return mImpl->getGPURaysBufUMA(queueIdx);
+    return mImpls[getDeviceIdx(queueIdx)]->getGPURaysBufUMA(getBufferQueueIdx(queueIdx, bufferIdx));
 }
 
 void*
-GPUAccelerator::getBundledOcclRaysBufUMA(const uint32_t queueIdx, uint32_t numRays, size_t stride) const
+GPUAccelerator::getBundledOcclRaysBufUMA(const uint32_t queueIdx,
+                                         const uint32_t numRays,
+                                         const size_t stride,
+                                         const uint32_t bufferIdx) const
 {
-    return mImpl->getBundledOcclRaysBufUMA(queueIdx, numRays, stride);
+    return mImpls[getDeviceIdx(queueIdx)]->getBundledOcclRaysBufUMA(getBufferQueueIdx(queueIdx, bufferIdx),
+                                                                    numRays, stride);
 }
 
 void
@@ -88,19 +152,72 @@ GPUAccelerator::occluded(const uint32_t queueIdx,
                          const void* bundledOcclRaysUMA,
                          size_t bundledOcclRayStride) const
 {
-    mImpl->occluded(queueIdx, numRays, rays, bundledOcclRaysUMA, bundledOcclRayStride);
+    const unsigned deviceIdx = getDeviceIdx(queueIdx);
+    beginBusy(deviceIdx);
+    mImpls[deviceIdx]->occluded(getBufferQueueIdx(queueIdx, 0), numRays, rays,
+                                bundledOcclRaysUMA, bundledOcclRayStride);
+    endBusy(deviceIdx, numRays);
+}
+
+void
+GPUAccelerator::occludedAsync(const uint32_t queueIdx,
+                              const uint32_t bufferIdx,
+                              const uint32_t numRays,
+                              const GPURay* rays,
+                              const void* bundledOcclRaysUMA,
+                              const size_t bundledOcclRayStride) const
+{
+    const unsigned deviceIdx = getDeviceIdx(queueIdx);
+    const uint32_t bufferQueueIdx = getBufferQueueIdx(queueIdx, bufferIdx);
+    MNRY_ASSERT(mNumPendingRays[bufferQueueIdx] == 0);
+
+    // The GPU is busy until the batch has been waited on
+    beginBusy(deviceIdx);
+    mNumPendingRays[bufferQueueIdx] = numRays;
+#ifdef MOONRAY_USE_METAL
+    mImpls[deviceIdx]->occludedAsync(bufferQueueIdx, numRays, rays,
+                                     bundledOcclRaysUMA, bundledOcclRayStride);
+#else
+    mImpls[deviceIdx]->occluded(bufferQueueIdx, numRays, rays,
+                                bundledOcclRaysUMA, bundledOcclRayStride);
+#endif
+}
+
+void
+GPUAccelerator::waitOccluded(const uint32_t queueIdx,
+                             const uint32_t bufferIdx) const
+{
+    const unsigned deviceIdx = getDeviceIdx(queueIdx);
+    const uint32_t bufferQueueIdx = getBufferQueueIdx(queueIdx, bufferIdx);
+    MNRY_ASSERT(mNumPendingRays[bufferQueueIdx] > 0);
+
+#ifdef MOONRAY_USE_METAL
+    mImpls[deviceIdx]->waitOccluded(bufferQueueIdx);
+#endif
+    endBusy(deviceIdx, mNumPendingRays[bufferQueueIdx]);
+    mNumPendingRays[bufferQueueIdx] = 0;
 }
 
 unsigned char*
-GPUAccelerator::getOutputOcclusionBuf(const uint32_t queueIdx) const
+GPUAccelerator::getOutputOcclusionBuf(const uint32_t queueIdx, const uint32_t bufferIdx) const
 {
-    return mImpl->getOutputOcclusionBuf(queueIdx);
+    return mImpls[getDeviceIdx(queueIdx)]->getOutputOcclusionBuf(getBufferQueueIdx(queueIdx, bufferIdx));
 }
 
 size_t
 GPUAccelerator::getCPUMemoryUsed() const
 {
-    return mImpl->getCPUMemoryUsed();
+    size_t bytes = 0;
+    for (const auto& impl : mImpls) {
+        bytes += impl->getCPUMemoryUsed();
+    }
+    return bytes;
+}
+
+size_t
+GPUAccelerator::getGPUMemoryUsed(const unsigned deviceIdx) const
+{
+    return mImpls[deviceIdx]->getGPUMemoryUsed();
 }
 
 uint32_t
@@ -141,6 +258,18 @@ GPUAccelerator::getGPUDeviceName() const
     return "";
 }
 
+unsigned
+GPUAccelerator::getNumDevices() const
+{
+    return 0;
+}
+
+unsigned
+GPUAccelerator::getDeviceIdx(const uint32_t /*queueIdx*/) const
+{
+    return 0;
+}
+
 void
 GPUAccelerator::intersect(const uint32_t /*queueIdx*/,
                           const uint32_t /*numRays*/,
@@ -154,8 +283,21 @@ GPUAccelerator::getOutputIsectBuf(const uint32_t /*queueIdx*/) const
     return nullptr;
 }
 
+uint32_t
+GPUAccelerator::getBufferQueueIdx(const uint32_t queueIdx, const uint32_t /*bufferIdx*/)
+{
+    return queueIdx;
+}
+
+unsigned
+GPUAccelerator::getNumQueueBuffers()
+{
+    return 1;
+}
+
 GPURay*
-GPUAccelerator::getGPURaysBufUMA(const uint32_t /* queueIdx */) const
+GPUAccelerator::getGPURaysBufUMA(const uint32_t /* queueIdx */,
+                                 const uint32_t /* bufferIdx */) const
 {
     return nullptr;
 }
@@ -163,7 +305,8 @@ GPUAccelerator::getGPURaysBufUMA(const uint32_t /* queueIdx */) const
 void*
 GPUAccelerator::getBundledOcclRaysBufUMA(const uint32_t /* queueIdx */,
                                          const uint32_t /* numRays */,
-                                         const size_t /* stride */) const
+                                         const size_t /* stride */,
+                                         const uint32_t /* bufferIdx */) const
 {
     return nullptr;
 }
@@ -177,8 +320,25 @@ GPUAccelerator::occluded(const uint32_t /* queueIdx */,
 {
 }
 
+void
+GPUAccelerator::occludedAsync(const uint32_t /* queueIdx */,
+                              const uint32_t /* bufferIdx */,
+                              const uint32_t /* numRays */,
+                              const GPURay* /* rays */,
+                              const void* /* bundledOcclRaysUMA */,
+                              const size_t /* bundledOcclRayStride */) const
+{
+}
+
+void
+GPUAccelerator::waitOccluded(const uint32_t /* queueIdx */,
+                             const uint32_t /* bufferIdx */) const
+{
+}
+
 unsigned char*
-GPUAccelerator::getOutputOcclusionBuf(const uint32_t /*queueIdx*/) const
+GPUAccelerator::getOutputOcclusionBuf(const uint32_t /*queueIdx*/,
+                                      const uint32_t /*bufferIdx*/) const
 {
     return nullptr;
 }
@@ -189,6 +349,12 @@ GPUAccelerator::getCPUMemoryUsed() const
     return 0;
 }
 
+size_t
+GPUAccelerator::getGPUMemoryUsed(const unsigned /*deviceIdx*/) const
+{
+    return 0;
+}
+
 uint32_t
 GPUAccelerator::getRaysBufSize()
 {
@@ -199,3 +365,89 @@ GPUAccelerator::getRaysBufSize()
 } // namespace moonray
 
 #endif // not MOONRAY_USE_OPTIX || MOONRAY_USE_METAL
+
+namespace moonray {
+namespace rt {
+
+double
+GPUAccelerator::getBusyTime() const
+{
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    return std::chrono::duration<double>(mBusy.mTime).count();
+}
+
+double
+GPUAccelerator::getBusyTime(const unsigned deviceIdx) const
+{
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    return std::chrono::duration<double>(mDeviceStats[deviceIdx].mBusy.mTime).count();
+}
+
+uint64_t
+GPUAccelerator::getNumRays(const unsigned deviceIdx) const
+{
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    return mDeviceStats[deviceIdx].mNumRays;
+}
+
+void
+GPUAccelerator::resetStats() const
+{
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    mBusy.mTime = std::chrono::steady_clock::duration::zero();
+    for (auto& stats : mDeviceStats) {
+        stats.mBusy.mTime = std::chrono::steady_clock::duration::zero();
+        stats.mNumRays = 0;
+    }
+}
+
+namespace {
+
+void
+startBusyTimer(uint32_t& numBusyQueues,
+               std::chrono::steady_clock::time_point& start,
+               const std::chrono::steady_clock::time_point& now)
+{
+    if (numBusyQueues++ == 0) {
+        start = now;
+    }
+}
+
+void
+stopBusyTimer(uint32_t& numBusyQueues,
+              const std::chrono::steady_clock::time_point& start,
+              std::chrono::steady_clock::duration& time,
+              const std::chrono::steady_clock::time_point& now)
+{
+    MNRY_ASSERT(numBusyQueues > 0);
+    if (--numBusyQueues == 0) {
+        time += now - start;
+    }
+}
+
+} // namespace
+
+void
+GPUAccelerator::beginBusy(const unsigned deviceIdx) const
+{
+    // Only called once per batch of rays so the lock isn't contended.
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    startBusyTimer(mBusy.mNumBusyQueues, mBusy.mStart, now);
+    BusyTimer& deviceBusy = mDeviceStats[deviceIdx].mBusy;
+    startBusyTimer(deviceBusy.mNumBusyQueues, deviceBusy.mStart, now);
+}
+
+void
+GPUAccelerator::endBusy(const unsigned deviceIdx, const uint32_t numRays) const
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mBusyMutex);
+    stopBusyTimer(mBusy.mNumBusyQueues, mBusy.mStart, mBusy.mTime, now);
+    BusyTimer& deviceBusy = mDeviceStats[deviceIdx].mBusy;
+    stopBusyTimer(deviceBusy.mNumBusyQueues, deviceBusy.mStart, deviceBusy.mTime, now);
+    mDeviceStats[deviceIdx].mNumRays += numRays;
+}
+
+} // namespace rt
+} // namespace moonray
@@ -98,6 +98,37 @@ object on the host side and it creates/manages a buffer on the GPU.  It has meth
 for easily copying to/from the GPU buffer.  It will automatically release the GPU
 buffer in its destructor which helps prevent GPU memory leaks.
 
+The per-queue GPURay input buffers returned by getGPURaysBufUMA() are host memory the
+GPU can read directly: UMA on Apple, pinned (page-locked) memory with Optix.  The XPU
+queues write their rays straight into these buffers so no intermediate copy is made
+on the CPU side and the upload is a single DMA transfer.
+
+***** Asynchronous submission:
+
+With Metal each queue has two sets of buffers.  The XPU occlusion queue submits a
+full buffer with occludedAsync() and goes on filling the other one while the GPU
+traces the rays.  It only waits on the first batch once the second one is full, so
+the render thread and the GPU work in parallel.  Optix traces the batch in
+occludedAsync(), so there is a single buffer per queue and nothing left to wait for.
+
+***** Multiple GPUs:
+
+GPUAccelerator creates one Optix accelerator per CUDA device, each with its own
+context, pipelines and a full copy of the GAS/IAS.  The number of devices can be
+capped with the MOONRAY_XPU_MAX_GPUS environment variable, all devices are used
+by default.  Each queue is bound to device (queueIdx % numDevices) for the whole
+render so that the queue's input/output buffers stay on one device.  As every
+render thread fills its queue at roughly the same rate this spreads the batches
+evenly across the devices.  Metal always uses a single device.
+
+***** Statistics:
+
+GPUAccelerator tracks the wall clock time during which at least one queue is
+waiting on the GPU, overall and per device, as well as the number of rays each
+device has traced.  These are reported as the GPU busy time, utilization and
+per device ray rates in the rendering stats at the end of the frame.  The
+device memory in use is reported with the XPU memory stats.
+
 */
 
 #pragma once
@@ -110,6 +141,11 @@ buffer in its destructor which helps prevent GPU memory leaks.
 #include <scene_rdl2/scene/rdl2/Layer.h>
 #include <scene_rdl2/scene/rdl2/SceneContext.h>
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace moonray {
 namespace rt {
 
@@ -139,8 +175,11 @@ public:
     GPUAccelerator(const GPUAccelerator& other) = delete;
     GPUAccelerator &operator=(const GPUAccelerator& other) = delete;
 
+    // Names of all the devices in use, separated by commas
     std::string getGPUDeviceName() const;
 
+    unsigned getNumDevices() const;
+
     // The queueIdx in these functions is the same as the CPU-side threadIdx, as
     // each CPU-side thread that is submitting rays to the GPU has a separate
     // queue on the GPU.  This allows multiple CPU threads to use the GPU independently.
@@ -158,25 +197,91 @@ public:
                   const void* bundledOcclRaysUMA,
                   const size_t bundledOcclRayStride) const;
 
-    // output occlusion results are placed in here
-    unsigned char* getOutputOcclusionBuf(const uint32_t queueIdx) const;
-
-    ::moonray::rt::GPURay* getGPURaysBufUMA(const uint32_t queueIdx) const;
+    // Each queue has getNumQueueBuffers() sets of input/output buffers.  While the
+    // GPU traces the rays of one buffer, the queue fills the next one.
+    // occludedAsync() submits the rays of a buffer and returns immediately, the
+    // results in getOutputOcclusionBuf() are only valid once waitOccluded() has
+    // returned for that buffer.  The buffer must not be written to in between.
+    // Backends without asynchronous submission trace the rays in occludedAsync().
+    void occludedAsync(const uint32_t queueIdx,
+                       const uint32_t bufferIdx,
+                       const uint32_t numRays,
+                       const GPURay* rays,
+                       const void* bundledOcclRaysUMA,
+                       const size_t bundledOcclRayStride) const;
+
+    void waitOccluded(const uint32_t queueIdx,
+                      const uint32_t bufferIdx) const;
+
+    static unsigned getNumQueueBuffers();
+
+    // output occlusion results are placed in here: 1 = occluded, 0 = not occluded,
+    // 2 = not occluded by the geometry on the GPU, but the ray crossed geometry
+    // that didn't fit in GPU memory and has to be traced on the CPU
+    unsigned char* getOutputOcclusionBuf(const uint32_t queueIdx,
+                                         const uint32_t bufferIdx = 0) const;
+
+    // Host side input ray buffer for the queue, readable by the GPU without an
+    // intermediate copy.  Holds getRaysBufSize() rays.
+    ::moonray::rt::GPURay* getGPURaysBufUMA(const uint32_t queueIdx,
+                                            const uint32_t bufferIdx = 0) const;
 
     void* getBundledOcclRaysBufUMA(const uint32_t queueIdx,
                                    const uint32_t numRays,
-                                   const size_t stride) const;
+                                   const size_t stride,
+                                   const uint32_t bufferIdx = 0) const;
 
     size_t getCPUMemoryUsed() const;
 
+    size_t getGPUMemoryUsed(const unsigned deviceIdx) const;
+
     static uint32_t getRaysBufSize();
 
+    // Wall clock time in seconds the GPU has spent processing rays since the
+    // last call to resetStats().  Concurrent queues are only counted once.
+    double getBusyTime() const;
+
+    // Same as above for a single device, along with the number of rays it traced.
+    double getBusyTime(const unsigned deviceIdx) const;
+    uint64_t getNumRays(const unsigned deviceIdx) const;
+
+    void resetStats() const;
+
 private:
+    unsigned getDeviceIdx(const uint32_t queueIdx) const;
+
+    // Index of the queue's buffer in the device's buffers
+    static uint32_t getBufferQueueIdx(const uint32_t queueIdx, const uint32_t bufferIdx);
+
+    void beginBusy(const unsigned deviceIdx) const;
+    void endBusy(const unsigned deviceIdx, const uint32_t numRays) const;
+
+    struct BusyTimer
+    {
+        uint32_t mNumBusyQueues = 0;
+        std::chrono::steady_clock::time_point mStart;
+        std::chrono::steady_clock::duration mTime = std::chrono::steady_clock::duration::zero();
+    };
+
+    struct DeviceStats
+    {
+        BusyTimer mBusy;
+        uint64_t mNumRays = 0;
+    };
+
+    mutable std::mutex mBusyMutex;
+    mutable BusyTimer mBusy;
+    mutable std::vector<DeviceStats> mDeviceStats;
+
+    // Rays submitted by occludedAsync() and not waited on yet, per queue buffer.
+    // Each entry is only accessed by the queue's thread.
+    mutable std::vector<uint32_t> mNumPendingRays;
 
+    // One per device
 #ifdef MOONRAY_USE_OPTIX
-     std::unique_ptr<OptixGPUAccelerator> mImpl;
+    std::vector<std::unique_ptr<OptixGPUAccelerator>> mImpls;
 #elif MOONRAY_USE_METAL
-    std::unique_ptr<MetalGPUAccelerator> mImpl;
+    std::vector<std::unique_ptr<MetalGPUAccelerator>> mImpls;
 #endif
 
 };
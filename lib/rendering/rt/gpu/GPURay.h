@@ -16,6 +16,11 @@ namespace rt {
 // Moonray math::Vec3 types because that would pull those headers into the GPU
 // code.  So, we are limited to the built-in C++ types.  Luckily we are only
 // passing a small amount of simple data.
+//
+// No ray differentials or ray cone are sent: the GPU only finds the hit, the
+// RayDifferential stays in the CPU side RayState and the shade handlers
+// transfer it to the hit point as they do for Embree hits, so texture mip
+// selection after a GPU hit is the same as after a CPU hit.
 
 struct GPURay
 {
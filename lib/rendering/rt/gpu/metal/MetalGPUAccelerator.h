@@ -30,6 +30,7 @@ class MetalGPUAccelerator
 {
 public:
     MetalGPUAccelerator(bool allowUnsupportedFeatures,
+                       const int deviceID, // unused, there is only one Metal device
                        const uint32_t numCPUThreads,
                        const scene_rdl2::rdl2::Layer *layer,
                        const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
@@ -62,10 +63,27 @@ public:
                   const void* bundledOcclRaysUMA,
                   const size_t bundledOcclRayStride) const;
 
+    // Commits the rays and returns without waiting for the GPU
+    void occludedAsync(const uint32_t queueIdx,
+                       const uint32_t numRays,
+                       const GPURay* rays,
+                       const void* bundledOcclRaysUMA,
+                       const size_t bundledOcclRayStride) const;
+
+    // Blocks until the rays committed by occludedAsync() have been traced
+    void waitOccluded(const uint32_t queueIdx) const;
+
     size_t getCPUMemoryUsed() const { return 0; }
 
+    size_t getGPUMemoryUsed() const { return 0; }
+
     static uint32_t getRaysBufSize() { return mRaysBufSize; }
 
+    static int getNumDevices() { return 1; }
+
+    // Double buffered: a queue fills one set of buffers while the GPU traces the other
+    static unsigned getNumQueueBuffers() { return 2; }
+
 private:
     bool build(const scene_rdl2::rdl2::Layer *layer,
                const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
@@ -143,6 +161,8 @@ private:
         id<MTLCommandBuffer> commandBuffer = nil;
         id<MTLComputeCommandEncoder> encoder = nil;
         id<MTLBuffer> cpuBuffer = nil;
+        // Committed by occludedAsync(), retained until waitOccluded()
+        id<MTLCommandBuffer> inFlightCommandBuffer = nil;
     };
     
     // This is stores a GPU state for each CPU thread, allowning a lockless and
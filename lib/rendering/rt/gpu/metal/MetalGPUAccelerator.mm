@@ -1042,6 +1042,7 @@ MetalGPUBVHBuilder::getShadowLinkingReceivers(const geom::internal::NamedPrimiti
 
 
 MetalGPUAccelerator::MetalGPUAccelerator(bool allowUnsupportedFeatures,
+                                        const int /* deviceID */,
                                         const uint32_t numCPUThreads,
                                        const scene_rdl2::rdl2::Layer *layer,
                                        const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
@@ -1163,6 +1164,12 @@ MetalGPUAccelerator::~MetalGPUAccelerator()
     scene_rdl2::logging::Logger::info("GPU: Freeing accelerator");
 
     for (auto& encoderState : mEncoderStates) {
+        // The GPU may still be reading the buffers freed below
+        if (encoderState.inFlightCommandBuffer) {
+            [encoderState.inFlightCommandBuffer waitUntilCompleted];
+            [encoderState.inFlightCommandBuffer release];
+            encoderState.inFlightCommandBuffer = nil;
+        }
         if (encoderState.cpuBuffer) {
             [encoderState.cpuBuffer release];
             encoderState.cpuBuffer = nil;
@@ -1507,7 +1514,20 @@ MetalGPUAccelerator::occluded(const uint32_t queueIdx,
 {
     // std::cout << "occluded(): " << numRays << std::endl;
 
+    occludedAsync(queueIdx, numRays, rays, cpuRays, cpuRayStride);
+    waitOccluded(queueIdx);
+}
+
+void
+MetalGPUAccelerator::occludedAsync(const uint32_t queueIdx,
+                                   const uint32_t numRays,
+                                   const GPURay* rays,
+                                   const void* cpuRays,
+                                   const size_t cpuRayStride) const
+{
     MNRY_ASSERT_REQUIRE(queueIdx < mEncoderStates.size());
+    // The buffers of this queue are still in use by the previous batch
+    MNRY_ASSERT_REQUIRE(!mEncoderStates[queueIdx].inFlightCommandBuffer);
     MNRY_ASSERT_REQUIRE(numRays <= mRaysBufSize);
     // Ensure getBundledOcclRaysBufUMA was called to allocate the cpuRays pointer for this queue
     MNRY_ASSERT_REQUIRE(cpuRays == [mEncoderStates[queueIdx].cpuBuffer contents]);
@@ -1531,17 +1551,38 @@ MetalGPUAccelerator::occluded(const uint32_t queueIdx,
     [mEncoderStates[queueIdx].encoder dispatchThreadgroups:threadgroupsPerDispatch
                                     threadsPerThreadgroup:threadsPerThreadgroup];
 
-    // Commit the GPU work
+    // Commit the GPU work.  The completion handler runs on a Metal thread, so it
+    // only reports errors and the results are read by the queue's thread once
+    // it has waited on the command buffer.
     id<MTLCommandBuffer> commandBuffer = mEncoderStates[queueIdx].commandBuffer;
     [mEncoderStates[queueIdx].encoder endEncoding];
+    [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> completedBuffer) {
+        if (completedBuffer.status == MTLCommandBufferStatusError) {
+            scene_rdl2::logging::Logger::error("GPU: Occlusion command buffer failed: ",
+                                               [[completedBuffer.error localizedDescription] UTF8String]);
+        }
+    }];
     [commandBuffer commit];
+    mEncoderStates[queueIdx].inFlightCommandBuffer = [commandBuffer retain];
 
-    // Before waiting for the GPU to complete, use the time to set up the next
-    // encoder
+    // While the GPU is busy, set up the next encoder
     prepareEncoder(queueIdx);
+}
+
+void
+MetalGPUAccelerator::waitOccluded(const uint32_t queueIdx) const
+{
+    MNRY_ASSERT_REQUIRE(queueIdx < mEncoderStates.size());
+
+    id<MTLCommandBuffer> commandBuffer = mEncoderStates[queueIdx].inFlightCommandBuffer;
+    if (!commandBuffer) {
+        return;
+    }
 
-    // Now block until the GPU is done
+    // Block until the GPU is done
     [commandBuffer waitUntilCompleted];
+    [commandBuffer release];
+    mEncoderStates[queueIdx].inFlightCommandBuffer = nil;
 }
 
 } // namespace rt
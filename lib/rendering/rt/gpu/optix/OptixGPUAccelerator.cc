@@ -26,6 +26,8 @@
 #include <scene_rdl2/render/util/BitUtils.h>
 #include <scene_rdl2/render/util/GetEnv.h>
 
+#include <algorithm>
+
 namespace moonray {
 namespace rt {
 
@@ -40,6 +42,40 @@ static void optixMessageCallback(unsigned int level,
 }
 
 
+// Device memory the geometry of the shared (instanced) groups may fill.  A
+// shared group that doesn't fit is evicted: its buffers are freed and its
+// instances reference a proxy box around its bounds instead.  Occlusion rays
+// crossing a proxy are traced again on the CPU.  The root group always stays
+// on the GPU.  The rest of the device memory is left for the GAS builds.
+class OptixGPUMemoryBudget
+{
+public:
+    explicit OptixGPUMemoryBudget(size_t budgetBytes) :
+        mBudgetBytes(budgetBytes),
+        mNumEvictedGroups(0) {}
+
+    bool hasRoom() const
+    {
+        size_t freeBytes = 0;
+        size_t totalBytes = 0;
+        if (cudaMemGetInfo(&freeBytes, &totalBytes) != cudaSuccess) {
+            return false;
+        }
+        return totalBytes - freeBytes < mBudgetBytes;
+    }
+
+    size_t mBudgetBytes;
+    int mNumEvictedGroups;
+};
+
+static OptixGPUPrimitiveGroup*
+buildSharedGroup(bool allowUnsupportedFeatures,
+                 const scene_rdl2::rdl2::Layer* layer,
+                 const scene_rdl2::rdl2::Geometry* geometry,
+                 const std::shared_ptr<geom::SharedPrimitive>& ref,
+                 SharedGroupMap& groups,
+                 OptixGPUMemoryBudget& budget);
+
 class OptixGPUBVHBuilder : public geom::PrimitiveVisitor
 {
 public:
@@ -50,13 +86,15 @@ public:
                        const scene_rdl2::rdl2::Layer* layer,
                        const scene_rdl2::rdl2::Geometry* geometry,
                        OptixGPUPrimitiveGroup* parentGroup,
-                       SharedGroupMap& groups) :
+                       SharedGroupMap& groups,
+                       OptixGPUMemoryBudget& budget) :
         mAllowUnsupportedFeatures(allowUnsupportedFeatures),
         mFailed(false),
         mLayer(layer),
         mGeometry(geometry),
         mParentGroup(parentGroup),
-        mSharedGroups(groups) {}
+        mSharedGroups(groups),
+        mBudget(budget) {}
 
     virtual void visitCurves(geom::Curves& c) override
     {
@@ -200,9 +238,8 @@ public:
         const auto& ref = i.getReference();
         // visit the referenced Primitive if it's not visited yet
         if (mSharedGroups.insert(std::make_pair(ref, nullptr)).second) {
-            OptixGPUPrimitiveGroup *group = new OptixGPUPrimitiveGroup();
-            OptixGPUBVHBuilder builder(mAllowUnsupportedFeatures, mLayer, mGeometry, group, mSharedGroups);
-            ref->getPrimitive()->accept(builder);
+            OptixGPUPrimitiveGroup *group = buildSharedGroup(mAllowUnsupportedFeatures, mLayer, mGeometry,
+                                                             ref, mSharedGroups, mBudget);
             // mark the BVH representation of referenced primitive (group)
             // has been correctly constructed so that all the instances
             // reference it can start accessing it
@@ -283,8 +320,75 @@ private:
     const scene_rdl2::rdl2::Geometry* mGeometry;
     OptixGPUPrimitiveGroup* mParentGroup;
     SharedGroupMap& mSharedGroups;
+    OptixGPUMemoryBudget& mBudget;
 };
 
+// Stands in for an evicted shared group: a single proxy box around the bounds
+// of the shared primitive, in its own space.
+static OptixGPUPrimitiveGroup*
+createProxyGroup(const std::shared_ptr<geom::SharedPrimitive>& ref)
+{
+    geom::BBox3f bound;
+    if (!geom::internal::PrimitivePrivateAccess::getDeferredBVHBound(*ref, bound)) {
+        RTCBounds refBound;
+        rtcGetSceneBounds(static_cast<RTCScene>(geom::internal::PrimitivePrivateAccess::getBVHScene(*ref)),
+                          &refBound);
+        bound.lower = geom::Vec3f(refBound.lower_x, refBound.lower_y, refBound.lower_z);
+        bound.upper = geom::Vec3f(refBound.upper_x, refBound.upper_y, refBound.upper_z);
+    }
+
+    OptixGPUPrimitiveGroup* group = new OptixGPUPrimitiveGroup();
+    if (!scene_rdl2::math::isFinite(bound.lower) || !scene_rdl2::math::isFinite(bound.upper)) {
+        // empty reference, nothing to stand in for
+        return group;
+    }
+
+    OptixGPUBox* proxy = new OptixGPUBox();
+    group->mCustomPrimitives.push_back(proxy);
+
+    proxy->mIsProxy = true;
+    proxy->mInputFlags = 0;
+    proxy->mIsSingleSided = false;
+    proxy->mIsNormalReversed = false;
+    proxy->mVisibleShadow = true;
+    proxy->mEmbreeUserData = 0;
+    proxy->mEmbreeGeomID = RTC_INVALID_GEOMETRY_ID;
+
+    const geom::Vec3f center = bound.center();
+    const geom::Vec3f size = bound.size();
+    proxy->mL2P = mat43ToOptixGPUXform(geom::Mat43(scene_rdl2::math::one, center));
+    proxy->mP2L = mat43ToOptixGPUXform(geom::Mat43(scene_rdl2::math::one, -center));
+    proxy->mLength = size.x;
+    proxy->mHeight = size.y;
+    proxy->mWidth = size.z;
+    return group;
+}
+
+// Builds the group of a shared primitive, or its proxy if the group doesn't
+// fit in the memory budget.
+static OptixGPUPrimitiveGroup*
+buildSharedGroup(bool allowUnsupportedFeatures,
+                 const scene_rdl2::rdl2::Layer* layer,
+                 const scene_rdl2::rdl2::Geometry* geometry,
+                 const std::shared_ptr<geom::SharedPrimitive>& ref,
+                 SharedGroupMap& groups,
+                 OptixGPUMemoryBudget& budget)
+{
+    if (budget.hasRoom()) {
+        OptixGPUPrimitiveGroup *group = new OptixGPUPrimitiveGroup();
+        OptixGPUBVHBuilder builder(allowUnsupportedFeatures, layer, geometry, group, groups, budget);
+        ref->getPrimitive()->accept(builder);
+        // A failed upload is most likely the device running out of memory,
+        // the CPU handles the group then.
+        if (!builder.hasFailed() && budget.hasRoom()) {
+            return group;
+        }
+        delete group;
+    }
+    budget.mNumEvictedGroups++;
+    return createProxyGroup(ref);
+}
+
 void
 OptixGPUBVHBuilder::logWarningMsg(const std::string& msg)
 {
@@ -437,40 +541,11 @@ void
 OptixGPUBVHBuilder::createRoundCurves(const geom::internal::Curves& geomCurves,
                                       const geom::Curves::Type curvesType)
 {
-    if (curvesType == geom::Curves::Type::BEZIER) {
-        // todo: this is supported in Optix 7.7
-        if (mAllowUnsupportedFeatures) {
-            logWarningMsg(
-                "Round bezier curves are currently unsupported in XPU mode.  "
-                "Ignoring geometry.");
-            return;
-        } else {
-            mFailed = true;
-            mWhyFailed = "Round bezier curves are currently unsupported in XPU mode";
-            return;
-        }
-    }
-
-    // This code assumes that there is a max of 2 motion samples.
-    // TODO: add support for round curves with more motion samples.
-    bool motionBlur = geomCurves.getMotionSamplesCount() > 1;
-    if (geomCurves.getMotionSamplesCount() > 2) {
-        if (mAllowUnsupportedFeatures) {
-            logWarningMsg(
-                "Round curves with more than 2 motion samples are currently unsupported in XPU mode.  "
-                "Only using first 2 samples.");
-        } else {
-            mFailed = true;
-            mWhyFailed = "Round curves with more than 2 motion samples are currently unsupported in XPU mode";
-            return;
-        }
-    }
-
     geom::internal::Curves::Spans spans;
     geomCurves.getTessellatedSpans(spans);
 
     OptixGPURoundCurves* gpuCurve = new OptixGPURoundCurves();
-    if (!motionBlur) {
+    if (geomCurves.getMotionSamplesCount() == 1) {
         mParentGroup->mRoundCurves.push_back(gpuCurve);
     } else {
         mParentGroup->mRoundCurvesMB.push_back(gpuCurve);
@@ -498,14 +573,17 @@ OptixGPUBVHBuilder::createRoundCurves(const geom::internal::Curves& geomCurves,
     }
 
     gpuCurve->mMotionSamplesCount = geomCurves.getMotionSamplesCount();
-    if (gpuCurve->mMotionSamplesCount > 2) {
-        gpuCurve->mMotionSamplesCount = 2;
-    }
+
+    // Bezier segments are converted to BSpline segments with the same shape
+    // and parameterization, as Optix only has a built-in bezier intersector
+    // from 7.7 on.  Each bezier segment gets its own 4 BSpline control points.
+    const bool bezier = curvesType == geom::Curves::Type::BEZIER;
 
     switch (curvesType) {
     case geom::Curves::Type::LINEAR:
         gpuCurve->mType = OPTIX_PRIMITIVE_TYPE_ROUND_LINEAR;
     break;
+    case geom::Curves::Type::BEZIER:
     case geom::Curves::Type::BSPLINE:
         gpuCurve->mType = OPTIX_PRIMITIVE_TYPE_ROUND_CUBIC_BSPLINE;
     break;
@@ -513,28 +591,54 @@ OptixGPUBVHBuilder::createRoundCurves(const geom::internal::Curves& geomCurves,
         MNRY_ASSERT_REQUIRE(false);
     }
 
-    gpuCurve->mNumControlPoints = spans.mVertexCount;
+    gpuCurve->mNumControlPoints = bezier ? spans.mSpanCount * 4 : spans.mVertexCount;
     const unsigned int* indices = reinterpret_cast<const unsigned int*>(spans.mIndexBufferDesc.mData);
 
     std::vector<int> assignmentIds(spans.mSpanCount);
     std::vector<unsigned int> hostIndices(spans.mSpanCount);
-    std::vector<float3> hostVertices(spans.mVertexCount * gpuCurve->mMotionSamplesCount);
-    std::vector<float> hostWidths(spans.mVertexCount * gpuCurve->mMotionSamplesCount);
+    gpuCurve->mHostVertices.resize(gpuCurve->mNumControlPoints * gpuCurve->mMotionSamplesCount);
+    gpuCurve->mHostWidths.resize(gpuCurve->mNumControlPoints * gpuCurve->mMotionSamplesCount);
 
     for (size_t i = 0; i < spans.mSpanCount; i++) {
         // We only want every third element of the index buffer to get the vertex index.
         // See: geom/prim/Curves.h struct IndexData
-        hostIndices[i] = indices[i * 3];
+        hostIndices[i] = bezier ? static_cast<unsigned int>(i * 4) : indices[i * 3];
         assignmentIds[i] = geomCurves.getIntersectionAssignmentId(i);
     }
 
     const geom::Curves::VertexBuffer& verts = geomCurves.getVertexBuffer();
 
     for (int ms = 0; ms < gpuCurve->mMotionSamplesCount; ms++) {
-        for (size_t i = 0; i < spans.mVertexCount; i++) {
-            const scene_rdl2::math::Vec3fa& cp = verts(i, ms);
-            hostVertices[ms * spans.mVertexCount + i] = {cp.x, cp.y, cp.z};
-            hostWidths[ms * spans.mVertexCount + i] = cp.w;
+        float3* msVertices = gpuCurve->mHostVertices.data() + ms * gpuCurve->mNumControlPoints;
+        float* msWidths = gpuCurve->mHostWidths.data() + ms * gpuCurve->mNumControlPoints;
+        if (!bezier) {
+            for (size_t i = 0; i < spans.mVertexCount; i++) {
+                const scene_rdl2::math::Vec3fa& cp = verts(i, ms);
+                msVertices[i] = {cp.x, cp.y, cp.z};
+                msWidths[i] = cp.w;
+            }
+            continue;
+        }
+        for (size_t i = 0; i < spans.mSpanCount; i++) {
+            const unsigned int first = indices[i * 3];
+            const scene_rdl2::math::Vec3fa& p0 = verts(first, ms);
+            const scene_rdl2::math::Vec3fa& p1 = verts(first + 1, ms);
+            const scene_rdl2::math::Vec3fa& p2 = verts(first + 2, ms);
+            const scene_rdl2::math::Vec3fa& p3 = verts(first + 3, ms);
+            const float3 c0 = {p0.x, p0.y, p0.z};
+            const float3 c1 = {p1.x, p1.y, p1.z};
+            const float3 c2 = {p2.x, p2.y, p2.z};
+            const float3 c3 = {p3.x, p3.y, p3.z};
+            msVertices[i * 4 + 0] = 6.f * c0 - 7.f * c1 + 2.f * c2;
+            msVertices[i * 4 + 1] = 2.f * c1 - c2;
+            msVertices[i * 4 + 2] = 2.f * c2 - c1;
+            msVertices[i * 4 + 3] = 2.f * c1 - 7.f * c2 + 6.f * c3;
+            // The converted radii can dip below zero where the bezier radius
+            // changes quickly, the intersector needs them non-negative.
+            msWidths[i * 4 + 0] = std::max(6.f * p0.w - 7.f * p1.w + 2.f * p2.w, 0.f);
+            msWidths[i * 4 + 1] = std::max(2.f * p1.w - p2.w, 0.f);
+            msWidths[i * 4 + 2] = std::max(2.f * p2.w - p1.w, 0.f);
+            msWidths[i * 4 + 3] = std::max(2.f * p1.w - 7.f * p2.w + 6.f * p3.w, 0.f);
         }
     }
 
@@ -550,31 +654,8 @@ OptixGPUBVHBuilder::createRoundCurves(const geom::internal::Curves& geomCurves,
         return;
     }
 
-    if (gpuCurve->mVertices.allocAndUpload(hostVertices) != cudaSuccess) {
-        mFailed = true;
-        mWhyFailed = "There was a problem uploading the curve vertices to the GPU";
-        return;
-    }
-
-    if (gpuCurve->mWidths.allocAndUpload(hostWidths) != cudaSuccess) {
-        mFailed = true;
-        mWhyFailed = "There was a problem uploading the curve widths to the GPU";
-        return;
-    }
-
-    // Get the vertex/width buffer pointers.  For curves without motion blur, the
-    // second pointer is null.
-    gpuCurve->mVerticesPtrs[0] = gpuCurve->mVertices.deviceptr();
-    gpuCurve->mWidthsPtrs[0] = gpuCurve->mWidths.deviceptr();
-    if (gpuCurve->mMotionSamplesCount == 2) {
-        gpuCurve->mVerticesPtrs[1] = gpuCurve->mVertices.deviceptr() +
-                                     gpuCurve->mNumControlPoints * sizeof(float3);
-        gpuCurve->mWidthsPtrs[1] = gpuCurve->mWidths.deviceptr() +
-                                   gpuCurve->mNumControlPoints * sizeof(float);
-    } else {
-        gpuCurve->mVerticesPtrs[1] = 0;
-        gpuCurve->mWidthsPtrs[1] = 0;
-    }
+    // The vertices and widths are uploaded when the GAS is built, once the number
+    // of motion keys of the GAS is known.
 }
 
 void
@@ -1027,6 +1108,7 @@ OptixGPUBVHBuilder::getShadowLinkingReceivers(const geom::internal::NamedPrimiti
 
 
 OptixGPUAccelerator::OptixGPUAccelerator(bool allowUnsupportedFeatures,
+                                         const int deviceID,
                                          const uint32_t numCPUThreads,
                                          const scene_rdl2::rdl2::Layer *layer,
                                          const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
@@ -1035,6 +1117,7 @@ OptixGPUAccelerator::OptixGPUAccelerator(bool allowUnsupportedFeatures,
                                          std::string* errorMsg) :
     mAllowUnsupportedFeatures {allowUnsupportedFeatures},
     mNumCPUThreads {numCPUThreads},
+    mDeviceID {deviceID},
     mContext {nullptr},
     mModule {nullptr},
     mRoundLinearCurvesModule {nullptr},
@@ -1045,9 +1128,10 @@ OptixGPUAccelerator::OptixGPUAccelerator(bool allowUnsupportedFeatures,
 {
     // The constructor fully initializes the GPU.  We are ready to trace rays afterwards.
 
-    scene_rdl2::logging::Logger::info("GPU: Creating accelerator");
+    scene_rdl2::logging::Logger::info("GPU: Creating accelerator on device ", mDeviceID);
 
     if (!createOptixContext(optixMessageCallback,
+                            mDeviceID,
                             &mCudaStream,
                             &mContext,
                             &mGPUDeviceName,
@@ -1179,6 +1263,14 @@ OptixGPUAccelerator::OptixGPUAccelerator(bool allowUnsupportedFeatures,
         }
     }
 
+    mInputRaysBuf.resize(mNumCPUThreads, nullptr);
+    for (int i = 0; i < mNumCPUThreads; i++) {
+        if (cudaMallocHost(&(mInputRaysBuf[i]), sizeof(GPURay) * mRaysBufSize) != cudaSuccess) {
+            *errorMsg = "GPU: Error allocating input rays buffer";
+            return;
+        }
+    }
+
     mOutputOcclusionBuf.resize(mNumCPUThreads, nullptr);
     for (int i = 0; i < mNumCPUThreads; i++) {
         if (cudaMallocHost(&(mOutputOcclusionBuf[i]), sizeof(unsigned char) * mRaysBufSize) != cudaSuccess) {
@@ -1232,8 +1324,9 @@ OptixGPUAccelerator::OptixGPUAccelerator(bool allowUnsupportedFeatures,
 
 OptixGPUAccelerator::~OptixGPUAccelerator()
 {
-    scene_rdl2::logging::Logger::info("GPU: Freeing accelerator");
+    scene_rdl2::logging::Logger::info("GPU: Freeing accelerator on device ", mDeviceID);
 
+    cudaSetDevice(mDeviceID);
 
     // delete in the opposite order of creation
     for (size_t i = 0; i < mPipeline.size(); i++) {
@@ -1272,6 +1365,10 @@ OptixGPUAccelerator::~OptixGPUAccelerator()
         optixDeviceContextDestroy(mContext);
     }
 
+    for (size_t i = 0; i < mInputRaysBuf.size(); i++) {
+        cudaFreeHost(mInputRaysBuf[i]);
+    }
+
     for (size_t i = 0; i < mOutputOcclusionBuf.size(); i++) {
         cudaFreeHost(mOutputOcclusionBuf[i]);
     }
@@ -1289,9 +1386,21 @@ OptixGPUAccelerator::getGPUDeviceName() const
 
 size_t OptixGPUAccelerator::getCPUMemoryUsed() const
 {
+    size_t inputRaysBufSize = mNumCPUThreads * sizeof(GPURay) * mRaysBufSize;
     size_t outputOcclusionBufSize = mNumCPUThreads * sizeof(unsigned char) * mRaysBufSize;
     size_t outputIsectBufSize = mNumCPUThreads * sizeof(GPURayIsect) * mRaysBufSize;
-    return outputOcclusionBufSize + outputIsectBufSize;
+    return inputRaysBufSize + outputOcclusionBufSize + outputIsectBufSize;
+}
+
+size_t OptixGPUAccelerator::getGPUMemoryUsed() const
+{
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+    if (cudaSetDevice(mDeviceID) != cudaSuccess ||
+        cudaMemGetInfo(&freeBytes, &totalBytes) != cudaSuccess) {
+        return 0;
+    }
+    return totalBytes - freeBytes;
 }
 
 bool
@@ -1300,6 +1409,7 @@ buildGPUBVHBottomUp(bool allowUnsupportedFeatures,
                     scene_rdl2::rdl2::Geometry* geometry,
                     OptixGPUPrimitiveGroup* rootGroup,
                     SharedGroupMap& groups,
+                    OptixGPUMemoryBudget& budget,
                     std::unordered_set<scene_rdl2::rdl2::Geometry*>& visitedGeometry,
                     std::vector<std::string>& warningMsgs,
                     std::string* errorMsg)
@@ -1329,6 +1439,7 @@ buildGPUBVHBottomUp(bool allowUnsupportedFeatures,
                             referencedGeometry,
                             rootGroup,
                             groups,
+                            budget,
                             visitedGeometry,
                             warningMsgs,
                             errorMsg);
@@ -1341,9 +1452,8 @@ buildGPUBVHBottomUp(bool allowUnsupportedFeatures,
         const std::shared_ptr<geom::SharedPrimitive>& ref =
             procedural->getReference();
         if (groups.insert(std::make_pair(ref, nullptr)).second) {
-            OptixGPUPrimitiveGroup *group = new OptixGPUPrimitiveGroup();
-            OptixGPUBVHBuilder builder(allowUnsupportedFeatures, layer, geometry, group, groups);
-            ref->getPrimitive()->accept(builder);
+            OptixGPUPrimitiveGroup *group = buildSharedGroup(allowUnsupportedFeatures, layer, geometry,
+                                                             ref, groups, budget);
             // mark the BVH representation of referenced primitive (group)
             // has been correctly constructed so that all the instances
             // reference it can start accessing it
@@ -1354,7 +1464,8 @@ buildGPUBVHBottomUp(bool allowUnsupportedFeatures,
                                        layer,
                                        geometry,
                                        rootGroup,
-                                       groups);
+                                       groups,
+                                       budget);
         procedural->forEachPrimitive(geomBuilder, doParallel);
         warningMsgs.insert(warningMsgs.end(),
                            geomBuilder.warningMsgs().begin(),
@@ -1382,6 +1493,18 @@ OptixGPUAccelerator::build(CUstream cudaStream,
 
     mRootGroup = new OptixGPUPrimitiveGroup();
 
+    // MOONRAY_XPU_GPU_MEMORY_MB caps the device memory the shared groups may
+    // fill, by default half of it is left for the GAS builds.
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+    cudaMemGetInfo(&freeBytes, &totalBytes);
+    size_t budgetBytes = totalBytes / 2;
+    const int budgetMB = scene_rdl2::util::getenv<int>("MOONRAY_XPU_GPU_MEMORY_MB");
+    if (budgetMB > 0) {
+        budgetBytes = std::min(static_cast<size_t>(budgetMB) << 20, totalBytes);
+    }
+    OptixGPUMemoryBudget budget(budgetBytes);
+
     std::unordered_set<scene_rdl2::rdl2::Geometry*> visitedGeometry;
     for (const auto& geometrySet : geometrySets) {
         const scene_rdl2::rdl2::SceneObjectIndexable& geometries = geometrySet->getGeometries();
@@ -1395,6 +1518,7 @@ OptixGPUAccelerator::build(CUstream cudaStream,
                                      geometry,
                                      mRootGroup,
                                      mSharedGroups,
+                                     budget,
                                      visitedGeometry,
                                      warningMsgs,
                                      errorMsg)) {
@@ -1403,6 +1527,12 @@ OptixGPUAccelerator::build(CUstream cudaStream,
         }
     }
 
+    if (budget.mNumEvictedGroups > 0) {
+        warningMsgs.push_back(std::to_string(budget.mNumEvictedGroups) +
+                              " instanced geometries didn't fit in GPU memory, their occlusion rays are traced on"
+                              " the CPU");
+    }
+
     unsigned int sbtOffset = 0;
     mRootGroup->setSBTOffset(sbtOffset);
     for (auto& groupEntry : mSharedGroups) {
@@ -1646,6 +1776,9 @@ OptixGPUAccelerator::intersect(const uint32_t queueIdx,
     MNRY_ASSERT_REQUIRE(queueIdx <= mIsectBuf.size());
     MNRY_ASSERT_REQUIRE(numRays <= mRaysBufSize);
 
+    // The calling render thread may have last used a different device
+    cudaSetDevice(mDeviceID);
+
     // This function uses async GPU calls.  This means the CPU doesn't wait for the GPU
     // to finish the operation.  Instead, we submit multiple async calls to the GPU and
     // then wait once at the very end.  This allows for better GPU throughput.
@@ -1698,6 +1831,9 @@ OptixGPUAccelerator::occluded(const uint32_t queueIdx,
     MNRY_ASSERT_REQUIRE(queueIdx <= mIsOccludedBuf.size());
     MNRY_ASSERT_REQUIRE(numRays <= mRaysBufSize);
 
+    // The calling render thread may have last used a different device
+    cudaSetDevice(mDeviceID);
+
     // This function uses async GPU calls.  This means the CPU doesn't wait for the GPU
     // to finish the operation.  Instead, we submit multiple async calls to the GPU and
     // then wait once at the very end.  This allows for better GPU throughput.
@@ -30,6 +30,7 @@ class OptixGPUAccelerator
 {
 public:
     OptixGPUAccelerator(bool allowUnsupportedFeatures,
+                        const int deviceID,
                         const uint32_t numCPUThreads,
                         const scene_rdl2::rdl2::Layer *layer,
                         const scene_rdl2::rdl2::SceneContext::GeometrySetVector& geometrySets,
@@ -55,7 +56,7 @@ public:
                   const size_t /* bundledOcclRayStride - unused for Optix*/) const;
 
     GPURay* getGPURaysBufUMA(const uint32_t queueIdx) const {
-        return nullptr;
+        return mInputRaysBuf[queueIdx];
     }
 
     void* getBundledOcclRaysBufUMA(const uint32_t queueIdx,
@@ -70,8 +71,16 @@ public:
 
     size_t getCPUMemoryUsed() const;
 
+    // Memory in use on this accelerator's device, as reported by the driver
+    size_t getGPUMemoryUsed() const;
+
     static uint32_t getRaysBufSize() { return mRaysBufSize; }
 
+    static int getNumDevices() { return getNumCUDADevices(); }
+
+    // occluded() is synchronous, a second buffer per queue wouldn't be used
+    static unsigned getNumQueueBuffers() { return 1; }
+
 private:
     bool build(CUstream cudaStream,
                OptixDeviceContext context,
@@ -89,6 +98,11 @@ private:
 
     bool mAllowUnsupportedFeatures;
 
+    // The CUDA device everything below lives on.  CUDA's current device is per
+    // host thread, so every entry point must make it current before touching
+    // any GPU resources.
+    int mDeviceID;
+
     CUstream mCudaStream;
     std::vector<CUstream> mCudaStreams; // per-thread (queue) streams
 
@@ -142,6 +156,10 @@ private:
      
     mutable std::vector<OptixGPUBuffer<GPURay>> mRaysBuf; // per-thread (queue) input ray buffers
 
+    // pinned host memory the XPU queues write their rays into, so uploading
+    // the rays doesn't need a staging copy in the GPU driver
+    mutable std::vector<GPURay*> mInputRaysBuf; // per-thread (or queue) input ray buffers
+
     // pinned host memory to avoid an extra copy in the GPU driver
     // when copying results from the GPU
     mutable std::vector<unsigned char*> mOutputOcclusionBuf; // per-thread (or queue) output result buffers
@@ -4,6 +4,8 @@
 #include "OptixGPUPrimitive.h"
 #include "OptixGPUInstance.h"
 
+#include <algorithm>
+
 namespace moonray {
 namespace rt {
 
@@ -21,6 +23,55 @@ OptixGPUBox::getPrimitiveAabbs(std::vector<OptixAabb>* aabbs) const
     aabbs->push_back(mL2P.transformAabb(localAabb));
 }
 
+cudaError_t
+OptixGPURoundCurves::uploadMotionKeys(int numKeys)
+{
+    if (numKeys != mMotionSamplesCount) {
+        // The motion samples are evenly spaced over the shutter interval, resample
+        // them to numKeys evenly spaced keys the same way the custom curves are
+        // interpolated at a given ray time.
+        std::vector<float3> vertices(static_cast<size_t>(numKeys) * mNumControlPoints);
+        std::vector<float> widths(static_cast<size_t>(numKeys) * mNumControlPoints);
+        for (int key = 0; key < numKeys; key++) {
+            const float time = (numKeys > 1) ? static_cast<float>(key) / (numKeys - 1) : 0.f;
+            const float sample0PlusT = time * (mMotionSamplesCount - 1);
+            const int sample0 = static_cast<int>(sample0PlusT);
+            const int sample1 = std::min(sample0 + 1, mMotionSamplesCount - 1);
+            const float t = sample0PlusT - sample0;
+            for (int i = 0; i < mNumControlPoints; i++) {
+                const size_t src0 = static_cast<size_t>(sample0) * mNumControlPoints + i;
+                const size_t src1 = static_cast<size_t>(sample1) * mNumControlPoints + i;
+                const size_t dst = static_cast<size_t>(key) * mNumControlPoints + i;
+                vertices[dst] = (1.f - t) * mHostVertices[src0] + t * mHostVertices[src1];
+                widths[dst] = lerpf(mHostWidths[src0], mHostWidths[src1], t);
+            }
+        }
+        mHostVertices.swap(vertices);
+        mHostWidths.swap(widths);
+        mMotionSamplesCount = numKeys;
+    }
+
+    cudaError_t err = mVertices.allocAndUpload(mHostVertices);
+    if (err != cudaSuccess) {
+        return err;
+    }
+    err = mWidths.allocAndUpload(mHostWidths);
+    if (err != cudaSuccess) {
+        return err;
+    }
+
+    mVerticesPtrs.resize(numKeys);
+    mWidthsPtrs.resize(numKeys);
+    for (int key = 0; key < numKeys; key++) {
+        mVerticesPtrs[key] = mVertices.deviceptr() + key * mNumControlPoints * sizeof(float3);
+        mWidthsPtrs[key] = mWidths.deviceptr() + key * mNumControlPoints * sizeof(float);
+    }
+
+    clearMemory(mHostVertices);
+    clearMemory(mHostWidths);
+    return cudaSuccess;
+}
+
 void
 OptixGPUCurve::getPrimitiveAabbs(std::vector<OptixAabb>* aabbs) const
 {
@@ -58,25 +58,38 @@ public:
 };
 
 // Linear or BSpline round curves.  This is supported as a built-in type by Optix 7.1,
-// thus they do not need an intersection program specified.
+// thus they do not need an intersection program specified.  Bezier curves are
+// converted to BSpline segments so they use the same built-in intersector.
 
 class OptixGPURoundCurves : public OptixGPUPrimitive
 {
 public:
     OptixPrimitiveType mType;
 
-    int mMotionSamplesCount; // 1 or 2 - a current limitation of RoundCurves
+    // Number of motion samples for motion blur.  1 = no motion blur.
+    int mMotionSamplesCount;
 
     // each index points to the first control point in a curve segment
     OptixGPUBuffer<unsigned int> mIndices;
 
     int mNumControlPoints;
-    // We need to keep a pointer to each motion sample's vertex buffer. If there is no motion blur, both pointers
-    // will point to the same buffer.
-    std::array<CUdeviceptr, 2> mVerticesPtrs;
+
+    // Host-side copy of the control points and widths of each motion sample.
+    // All of the curves in a motion blurred GAS must have the same number of
+    // motion keys, so the vertices are only resampled to the key count of the
+    // GAS and uploaded when it is built.
+    std::vector<float3> mHostVertices;
+    std::vector<float> mHostWidths;
+
+    // We need to keep a pointer to each motion key's vertex buffer.
+    std::vector<CUdeviceptr> mVerticesPtrs;
     OptixGPUBuffer<float3> mVertices;
-    std::array<CUdeviceptr, 2> mWidthsPtrs;
+    std::vector<CUdeviceptr> mWidthsPtrs;
     OptixGPUBuffer<float> mWidths; // radius, but Optix calls it width
+
+    // Resamples the host-side control points to numKeys motion keys, uploads
+    // them and frees the host-side copy.
+    cudaError_t uploadMotionKeys(int numKeys);
 };
 
 // Custom primitives for non-trimesh geometry.  These have custom intersection
@@ -103,6 +116,8 @@ public:
 class OptixGPUBox : public OptixGPUCustomPrimitive
 {
 public:
+    OptixGPUBox() : mIsProxy(false) {}
+
     void getPrimitiveAabbs(std::vector<OptixAabb>* aabbs) const override;
 
     OptixGPUXform mL2P;  // Local to Primitive
@@ -110,6 +125,10 @@ public:
     float mLength;
     float mHeight;
     float mWidth;
+
+    // The box is the bounds of a shared group that was evicted from the GPU.
+    // It never occludes, the rays which cross it are traced again on the CPU.
+    bool mIsProxy;
 };
 
 class OptixGPUCurve : public OptixGPUCustomPrimitive
@@ -416,6 +416,7 @@ OptixGPUPrimitiveGroup::getSBTRecords(std::map<std::string, OptixProgramGroup>&
         OptixGPUBox* box = dynamic_cast<OptixGPUBox*>(prim);
         if (box) {
             rec.mData.mType = HitGroupData::BOX;
+            rec.mData.mIsProxy = box->mIsProxy;
             rec.mData.box.mL2P = box->mL2P;
             rec.mData.box.mP2L = box->mP2L;
             rec.mData.box.mLength = box->mLength;
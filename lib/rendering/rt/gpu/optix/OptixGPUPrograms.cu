@@ -22,6 +22,7 @@ struct PerRayData
     int mShadowReceiverId;        // used for shadow linking (input)
     unsigned long long mLightId;  // used for shadow linking (input)
     bool mDidHitGeom;             // did ray hit geometry? (output)
+    bool mHitProxy;               // did ray cross an evicted group? (output)
 
     float mTFar; // intersection distance
     float mNgX, mNgY, mNgZ; // geometry normal
@@ -107,6 +108,7 @@ void __raygen__()
         prd.mShadowReceiverId = -1;
         prd.mLightId = -1;
         prd.mDidHitGeom = false;
+        prd.mHitProxy = false;
         unsigned int u0, u1;
         splitPointer(&prd, u0, u1);
 
@@ -145,6 +147,7 @@ void __raygen__()
         prd.mShadowReceiverId = ray->mShadowReceiverId;
         prd.mLightId = ray->mLightId;
         prd.mDidHitGeom = false;
+        prd.mHitProxy = false;
         unsigned int u0, u1;
         splitPointer(&prd, u0, u1);
 
@@ -161,7 +164,9 @@ void __raygen__()
                 0,             // missSBTIndex
                 u0, u1);
 
-        params.mIsOccludedBuf[idx.x] = prd.mDidHitGeom ? 1 : 0;
+        // 2 = not occluded by the resident geometry, but the ray crossed the
+        // bounds of an evicted group and must be traced again on the CPU.
+        params.mIsOccludedBuf[idx.x] = prd.mDidHitGeom ? 1 : (prd.mHitProxy ? 2 : 0);
     }
 }
 
@@ -323,6 +328,13 @@ void __anyhit__()
     PerRayData* prd = getPRD<PerRayData>();
     const moonray::rt::HitGroupData* data = (moonray::rt::HitGroupData*)optixGetSbtDataPointer();
 
+    if (data->mIsProxy) {
+        // Keep looking for a resident occluder, the proxy only flags the ray.
+        prd->mHitProxy = true;
+        optixIgnoreIntersection();
+        return;
+    }
+
     if (prd->mIsOcclusionRay) {
         if (data->mIsSingleSided && optixIsTriangleBackFaceHit()) {
             optixIgnoreIntersection();
@@ -465,6 +477,12 @@ void __intersection__box()
     if (t0 > rayTfar || t1 < rayTnear) {
         return;
     }
+    if (data->mIsProxy) {
+        // Any overlap of the ray with the proxy bounds may hit the evicted
+        // geometry, including rays that start and end inside of them.
+        optixReportIntersection(t0 < rayTnear ? rayTnear : t0, 0);
+        return;
+    }
     float tHit = t0;
     if (t0 < rayTnear || (isSingleSided && isNormalReversed)) {
         tHit = t1;
@@ -968,6 +986,12 @@ void __intersection__sphere()
     if (t0 > rayTfar || t1 < rayTnear) {
         return;
     }
+    if (data->mIsProxy) {
+        // Any overlap of the ray with the proxy bounds may hit the evicted
+        // geometry, including rays that start and end inside of them.
+        optixReportIntersection(t0 < rayTnear ? rayTnear : t0, 0);
+        return;
+    }
     float tHit = t0;
     if (t0 < rayTnear || (isSingleSided && isNormalReversed)) {
         tHit = t1;
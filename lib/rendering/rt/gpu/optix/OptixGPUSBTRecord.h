@@ -55,6 +55,7 @@ struct HitGroupData
     bool mIsSingleSided;
     bool mIsNormalReversed;
     bool mVisibleShadow;
+    bool mIsProxy;  // stands in for an evicted group, see OptixGPUBox::mIsProxy
     int *mAssignmentIds;
     intptr_t mEmbreeUserData;
     unsigned int mEmbreeGeomID;
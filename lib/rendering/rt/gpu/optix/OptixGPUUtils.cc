@@ -10,6 +10,7 @@
 #undef max
 #include <optix_stack_size.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -41,8 +42,19 @@ getNVIDIADriverVersion(int* major, int* minor)
     return success;
 }
 
+int
+getNumCUDADevices()
+{
+    int numDevices = 0;
+    if (cudaGetDeviceCount(&numDevices) != cudaSuccess) {
+        return 0;
+    }
+    return numDevices;
+}
+
 bool
 createOptixContext(OptixLogCallback logCallback,
+                   const int deviceID,
                    CUstream* cudaStream,
                    OptixDeviceContext* ctx,
                    std::string* deviceName,
@@ -62,14 +74,16 @@ createOptixContext(OptixLogCallback logCallback,
 
     cudaFree(0);    // init CUDA
 
-    int numDevices = 0;
-    cudaGetDeviceCount(&numDevices);
+    const int numDevices = getNumCUDADevices();
     if (numDevices == 0) {
         *errorMsg = "No CUDA capable devices found";
         return false;
     }
+    if (deviceID >= numDevices) {
+        *errorMsg = "Invalid CUDA device " + std::to_string(deviceID);
+        return false;
+    }
 
-    const int deviceID = 0;
     if (cudaSetDevice(deviceID) != cudaSuccess) {
         *errorMsg = "Unable to set the CUDA device";
         return false;
@@ -485,16 +499,27 @@ createRoundCurvesGAS(CUstream cudaStream,
                      OptixGPUBuffer<char>* accelBuf,
                      std::string* errorMsg)
 {
+    // All of the build inputs of a GAS need the same number of motion keys, the
+    // curves with fewer motion samples are resampled to the largest count.
+    int numKeys = 1;
+    for (const auto& shape : roundCurves) {
+        numKeys = std::max(numKeys, shape->mMotionSamplesCount);
+    }
+
     std::vector<OptixBuildInput> inputs;
 
-    bool enableMotionBlur = false;
     for (const auto& shape : roundCurves) {
+        if (shape->uploadMotionKeys(numKeys) != cudaSuccess) {
+            *errorMsg = "Error uploading the curve vertices to the GPU";
+            return false;
+        }
+
         OptixBuildInput input = {};  // zero everything
         input.type = OPTIX_BUILD_INPUT_TYPE_CURVES;
         input.curveArray.curveType = shape->mType;
         input.curveArray.numPrimitives = static_cast<unsigned int>(shape->mIndices.count());
         input.curveArray.vertexBuffers = shape->mVerticesPtrs.data();
-        input.curveArray.numVertices = static_cast<unsigned int>(shape->mVertices.count());
+        input.curveArray.numVertices = static_cast<unsigned int>(shape->mNumControlPoints);
         input.curveArray.vertexStrideInBytes = sizeof(float3);
         input.curveArray.widthBuffers = shape->mWidthsPtrs.data();
         input.curveArray.widthStrideInBytes = sizeof(float);
@@ -502,10 +527,6 @@ createRoundCurvesGAS(CUstream cudaStream,
         input.curveArray.indexStrideInBytes = sizeof(unsigned int);
         input.curveArray.flag = OPTIX_GEOMETRY_FLAG_DISABLE_ANYHIT;
 
-        if (shape->mMotionSamplesCount > 1) {
-            enableMotionBlur = true;
-        }
-
         inputs.push_back(input);
     }
 
@@ -515,8 +536,8 @@ createRoundCurvesGAS(CUstream cudaStream,
     accelOptions.motionOptions.numKeys  = 0;
     accelOptions.operation              = OPTIX_BUILD_OPERATION_BUILD;
 
-    if (enableMotionBlur) {
-        accelOptions.motionOptions.numKeys   = 2;
+    if (numKeys > 1) {
+        accelOptions.motionOptions.numKeys   = numKeys;
         accelOptions.motionOptions.timeBegin = 0.f;
         accelOptions.motionOptions.timeEnd   = 1.f;
         accelOptions.motionOptions.flags     = OPTIX_MOTION_FLAG_NONE;
@@ -27,8 +27,13 @@ getNVIDIADriverVersion(int* major, int* minor);
 // Wrappers for the verbose and low-level Optix 7 API.  This makes the code
 // dramatically cleaner overall and adapts to our error handling convention.
 
+// Number of CUDA capable devices, 0 if CUDA is not available.
+int
+getNumCUDADevices();
+
 bool
 createOptixContext(OptixLogCallback logCallback,
+                   const int deviceID,
                    CUstream* cudaStream,
                    OptixDeviceContext* ctx,
                    std::string* deviceName,
@@ -39,6 +39,14 @@ struct AcceleratorOptions
 {
     int maxThreads = 0;
     bool verbose = false;
+    // Build the BVH of instanced prototypes the first time a ray reaches one
+    // of their instances instead of at scene build time
+    bool deferSharedBVH = false;
+    // Let Embree allocate the BVH nodes and primitive data on 2MB pages
+    bool hugePages = false;
+    // Have Embree trade some traversal speed for smaller BVHs, which mostly
+    // pays off for scenes dominated by curves
+    bool compactBVH = false;
 };
 
 } // namespace rt
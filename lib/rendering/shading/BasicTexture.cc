@@ -242,6 +242,8 @@ public:
         // dwa_texture *must* be given 4 floats for the result.
         ALIGN(16) float tmp[4];
 
+        tls->mTextureSampler->getPrefetcher().record(getTextureHandle(), st[0], st[1], derivatives);
+
         bool res = texSys->texture(
             const_cast<texture::TextureHandle *>(getTextureHandle()),
             tls->mOIIOThreadData,
@@ -410,6 +412,8 @@ void CPP_oiioTexture(const ispc::BASIC_TEXTURE_Data *tx,
     float dtdy = derivatives[3];
     const int nChannels = 4;
 
+    tls->mTextureSampler->getPrefetcher().record(textureHandle, s, t, derivatives);
+
     bool res = texSys->texture(textureHandle,
                                threadInfo,
                                options[index],
@@ -418,14 +422,9 @@ void CPP_oiioTexture(const ispc::BASIC_TEXTURE_Data *tx,
                                nChannels,
                                result);
 
-    if (res) {
-        if (tx->mApplyGamma && tx->mIs8bit) { // actually INVERSE gamma
-            result[0] = pow(result[0], 2.2f);
-            result[1] = pow(result[1], 2.2f);
-            result[2] = pow(result[2], 2.2f);
-            // don't gamma the alpha channel
-        }
-    } else {
+    // The inverse gamma of 8 bit textures is applied to all the lanes at once
+    // by BASIC_TEXTURE_sample().
+    if (!res) {
         scene_rdl2::rdl2::Shader* const shader = reinterpret_cast<scene_rdl2::rdl2::Shader*>(tx->mShader);
         scene_rdl2::rdl2::Shader::getLogEventRegistry().log(shader, tx->mBasicTextureStaticDataPtr->sErrorSampleFail);
         result[0] = result[1] = result[2] = result[3] = 0.f;
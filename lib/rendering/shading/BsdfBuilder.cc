@@ -64,6 +64,37 @@ namespace shading {
 
 class BsdfBuilder::Impl
 {
+private:
+    enum MergeKind
+    {
+        MERGE_LAMBERT_BRDF,
+        MERGE_LAMBERT_BTDF,
+        MERGE_MICROFACET_BRDF,
+        MERGE_KIND_COUNT
+    };
+
+    // The last lobe of a kind that subsequent compatible components are
+    // merged into, see BsdfBuilder::setLobeMerging()
+    struct MergeCandidate
+    {
+        BsdfLobe * mLobe = nullptr;
+        int mLabel = 0;
+        bool mPreventLightCulling = false;
+        scene_rdl2::math::Vec3f mN;
+
+        // lambert
+        scene_rdl2::math::Color mAlbedoScale;
+
+        // microfacet
+        float mRoughness = 0.f;
+        ispc::MicrofacetDistribution mDistribution;
+        bool mIsConductor = false;
+        scene_rdl2::math::Color mEta;
+        scene_rdl2::math::Color mK;
+        scene_rdl2::math::Color mFavg;
+        float mWeight = 0.f;
+    };
+
 public:
     Impl(Bsdf& bsdf,
          shading::TLState *tls,
@@ -82,7 +113,10 @@ public:
         mWeightAccum(0.f),
         mIsThinGeo(false),
         mPreventLightCulling(false),
-        mInAdjacentBlock(false)
+        mInAdjacentBlock(false),
+        mLobePruneThreshold(0.f),
+        mMergeLobes(false),
+        mMergeCandidates()
     {}
 
     Impl(const Impl& other) =delete;
@@ -201,7 +235,114 @@ public:
                       ispc::BsdfBuilderBehavior combineBehavior)
     {
         if (weight < scene_rdl2::math::sEpsilon) { return false; }
-        return (!isUnder(combineBehavior) || mCurrentTransmittance > 0.f);
+        if (!isUnder(combineBehavior)) { return weight >= mLobePruneThreshold; }
+        // A pruned component doesn't take its weight from the components
+        // under it, which keeps the energy of the layer stack.
+        return mCurrentTransmittance > 0.f &&
+               weight * mCurrentTransmittance >= mLobePruneThreshold;
+    }
+
+    // A lobe can take in a subsequent component when neither is attenuated
+    // by the dielectric/clearcoat lobes above it.
+    finline bool
+    isMergeable(ispc::BsdfBuilderBehavior combineBehavior)
+    {
+        return mMergeLobes && (!isUnder(combineBehavior) || mActiveAttenuatorCount == 0);
+    }
+
+    finline MergeCandidate *
+    findMergeCandidate(MergeKind kind,
+                       ispc::BsdfBuilderBehavior combineBehavior,
+                       const int label,
+                       const scene_rdl2::math::Vec3f& N)
+    {
+        if (!isMergeable(combineBehavior)) { return nullptr; }
+        MergeCandidate& candidate = mMergeCandidates[kind];
+        if (!candidate.mLobe ||
+            candidate.mLabel != label ||
+            candidate.mPreventLightCulling != mPreventLightCulling ||
+            !scene_rdl2::math::isEqual(candidate.mN, N)) {
+            return nullptr;
+        }
+        return &candidate;
+    }
+
+    // Returns the candidate to fill in, or nullptr if the lobe can't take in
+    // subsequent components.
+    finline MergeCandidate *
+    recordMergeCandidate(MergeKind kind,
+                         ispc::BsdfBuilderBehavior combineBehavior,
+                         const int label,
+                         const scene_rdl2::math::Vec3f& N,
+                         BsdfLobe * lobe)
+    {
+        MergeCandidate& candidate = mMergeCandidates[kind];
+        if (!isMergeable(combineBehavior)) {
+            candidate.mLobe = nullptr;
+            return nullptr;
+        }
+        candidate.mLobe = lobe;
+        candidate.mLabel = label;
+        candidate.mPreventLightCulling = mPreventLightCulling;
+        candidate.mN = N;
+        return &candidate;
+    }
+
+    // Folds a lambertian component into a previous lambertian lobe with the
+    // same normal and label. The lobe albedo takes the scale of both.
+    finline bool
+    mergeLambert(MergeKind kind,
+                 const scene_rdl2::math::Vec3f& N,
+                 const scene_rdl2::math::Color& albedo,
+                 float weight,
+                 ispc::BsdfBuilderBehavior combineBehavior,
+                 const int label)
+    {
+        MergeCandidate * candidate = findMergeCandidate(kind, combineBehavior, label, N);
+        if (!candidate) { return false; }
+
+        float scale = weight;
+        if (isUnder(combineBehavior)) {
+            scale *= mCurrentTransmittance;
+        }
+        candidate->mAlbedoScale += albedo * scale;
+
+        LambertBsdfLobe * lobe = static_cast<LambertBsdfLobe *>(candidate->mLobe);
+        lobe->setAlbedo(candidate->mAlbedoScale);
+        lobe->setScale(scene_rdl2::math::sWhite);
+        return true;
+    }
+
+    // Folds a microfacet component into a previous microfacet lobe with the
+    // same normal, roughness, fresnel and label. The lobe keeps its fresnel,
+    // whose weight may also drive an attenuator, so the component weight goes
+    // into the lobe scale instead.
+    finline bool
+    mergeMicrofacet(const MicrofacetIsotropicBRDF& component,
+                    float weight,
+                    ispc::BsdfBuilderBehavior combineBehavior,
+                    const int label)
+    {
+        if (component.getIridescence()) { return false; }
+
+        MergeCandidate * candidate = findMergeCandidate(MERGE_MICROFACET_BRDF, combineBehavior, label,
+                                                        component.getN());
+        if (!candidate ||
+            candidate->mRoughness != component.getRoughness() ||
+            candidate->mDistribution != component.getMicrofacetDistribution() ||
+            candidate->mIsConductor != component.isConductor() ||
+            !scene_rdl2::math::isEqual(candidate->mEta, component.getEta()) ||
+            !scene_rdl2::math::isEqual(candidate->mK, component.getK()) ||
+            !scene_rdl2::math::isEqual(candidate->mFavg, component.getFavg())) {
+            return false;
+        }
+
+        scene_rdl2::math::Color scale = scene_rdl2::math::sWhite;
+        if (isUnder(combineBehavior)) {
+            scale *= mCurrentTransmittance;
+        }
+        candidate->mLobe->setScale(candidate->mLobe->getScale() + scale * (weight / candidate->mWeight));
+        return true;
     }
 
     finline BsdfLobe *
@@ -498,6 +639,14 @@ public:
                  ispc::BsdfBuilderBehavior combineBehavior,
                  const int label)
     {
+        if (mergeLambert(MERGE_LAMBERT_BRDF, component.getN(), component.getAlbedo(), weight, combineBehavior, label)) {
+            if (isOver(combineBehavior)) {
+                // account for this lobe's energy allocation
+                mWeightAccum += weight;
+            }
+            return;
+        }
+
         BsdfLobe* lobe = mTls->mArena->allocWithArgs<LambertBsdfLobe>(
                 component.getN(),
                 component.getAlbedo(),
@@ -530,6 +679,10 @@ public:
 
         lobe->setLabel(label);
         mBsdf.addLobe(lobe);
+        if (MergeCandidate * candidate =
+                recordMergeCandidate(MERGE_LAMBERT_BRDF, combineBehavior, label, component.getN(), lobe)) {
+            candidate->mAlbedoScale = component.getAlbedo() * lobe->getScale();
+        }
     }
 
     finline void
@@ -538,6 +691,14 @@ public:
                  ispc::BsdfBuilderBehavior combineBehavior,
                  const int label)
     {
+        if (mergeLambert(MERGE_LAMBERT_BTDF, component.getN(), component.getTint(), weight, combineBehavior, label)) {
+            if (isOver(combineBehavior)) {
+                // account for this lobe's energy allocation
+                mWeightAccum += weight;
+            }
+            return;
+        }
+
         BsdfLobe* lobe = mTls->mArena->allocWithArgs<LambertBsdfLobe>(
                 component.getN(),
                 component.getTint(),
@@ -570,6 +731,10 @@ public:
 
         lobe->setLabel(label);
         mBsdf.addLobe(lobe);
+        if (MergeCandidate * candidate =
+                recordMergeCandidate(MERGE_LAMBERT_BTDF, combineBehavior, label, component.getN(), lobe)) {
+            candidate->mAlbedoScale = component.getTint() * lobe->getScale();
+        }
     }
 
     finline void
@@ -1057,6 +1222,28 @@ public:
         // Adapt normal to prevent reflection ray from self-intersecting this geometry
         const scene_rdl2::math::Vec3f adaptedNormal = mState.adaptNormal(component.getN());
 
+        if (mergeMicrofacet(component, weight, combineBehavior, label)) {
+            if (isOver(combineBehavior)) {
+                if (component.isConductor()) {
+                    mWeightAccum += weight;
+                } else {
+                    // the attenuator still needs this component's fresnel
+                    Fresnel * fresnel = createFresnel(component.getEta(),
+                                                      component.getK(),
+                                                      false); // isConductor
+                    fresnel->setWeight(weight);
+                    SimpleAttenuator * atten = mTls->mArena->allocWithArgs<SimpleAttenuator>(
+                            mTls->mArena,
+                            adaptedNormal,
+                            component.getRoughness(),
+                            fresnel);
+
+                    stageAttenuator(atten);
+                }
+            }
+            return;
+        }
+
         BsdfLobe * lobe;
         if (component.getMicrofacetDistribution() == ispc::MICROFACET_DISTRIBUTION_BECKMANN) {
             lobe = mTls->mArena->allocWithArgs<CookTorranceBsdfLobe>(
@@ -1108,6 +1295,20 @@ public:
 
         lobe->setLabel(label);
         mBsdf.addLobe(lobe);
+        if (!component.getIridescence()) {
+            if (MergeCandidate * candidate =
+                    recordMergeCandidate(MERGE_MICROFACET_BRDF, combineBehavior, label, component.getN(), lobe)) {
+                candidate->mRoughness = component.getRoughness();
+                candidate->mDistribution = component.getMicrofacetDistribution();
+                candidate->mIsConductor = component.isConductor();
+                candidate->mEta = component.getEta();
+                candidate->mK = component.getK();
+                candidate->mFavg = component.getFavg();
+                candidate->mWeight = weight;
+            }
+        } else {
+            mMergeCandidates[MERGE_MICROFACET_BRDF].mLobe = nullptr;
+        }
     }
 
     finline void
@@ -2129,6 +2330,10 @@ public:
 
     void setPreventLightCulling(bool isPrevented) { mPreventLightCulling = isPrevented; }
 
+    void setLobePruneThreshold(float threshold) { mLobePruneThreshold = threshold; }
+
+    void setLobeMerging(bool isEnabled) { mMergeLobes = isEnabled; }
+
     const Bsdf*
     getBsdf() const
     {
@@ -2155,6 +2360,10 @@ private:
     bool mIsThinGeo;
     bool mPreventLightCulling;
     bool mInAdjacentBlock;
+
+    float mLobePruneThreshold;
+    bool mMergeLobes;
+    MergeCandidate mMergeCandidates[MERGE_KIND_COUNT];
 };
 
 BsdfBuilder::BsdfBuilder(Bsdf& bsdf,
@@ -2270,6 +2479,18 @@ BsdfBuilder::setPreventLightCulling(bool isPrevented)
     mImpl->setPreventLightCulling(isPrevented);
 }
 
+void
+BsdfBuilder::setLobePruneThreshold(float threshold)
+{
+    mImpl->setLobePruneThreshold(threshold);
+}
+
+void
+BsdfBuilder::setLobeMerging(bool isEnabled)
+{
+    mImpl->setLobeMerging(isEnabled);
+}
+
 
 const Bsdf*
 BsdfBuilder::getBsdf() const
@@ -290,6 +290,18 @@ public:
     // This is useful for certain NPR effects
     void setPreventLightCulling(bool isPrevented);
 
+    // Skip the components whose weight, after the attenuation of the
+    // components above them, is below the threshold. A skipped component
+    // doesn't attenuate the components under it either, so they take over its
+    // share of the energy. Defaults to 0, which keeps every visible component.
+    void setLobePruneThreshold(float threshold);
+
+    // Fold lambertian and isotropic microfacet components into a previously
+    // added lobe of the same kind when the normal, label and (for microfacet)
+    // roughness and fresnel match, instead of adding another lobe. Components
+    // attenuated by the clearcoat/dielectric lobes above them are not merged.
+    void setLobeMerging(bool isEnabled);
+
     // Temporary function to allow certain legacy materials direct
     // access to the Bsdf. This is required for now because we
     // do not support Schlick Fresnel through our shading API. This function
@@ -4,6 +4,7 @@
 #include "Material.h"
 
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
 
 namespace moonray {
 namespace shading {
@@ -195,6 +196,8 @@ Material::areAllShadeQueuesEmpty()
 unsigned
 Material::flushNonEmptyShadeQueue(mcrt_common::ThreadLocalState *tls)
 {
+    mcrt_common::TimelineScope timelineScope("flushShadeQueue", "queue");
+
     // Always force sFlushCycleIdx to increment by at least 1.
     size_t startIdx = sFlushCycleIdx++;
 
@@ -9,62 +9,23 @@
 
 #include <moonray/rendering/bvh/shading/ShadingTLState.h>
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/texturing/sampler/VdbGridCache.h>
 #include <scene_rdl2/render/util/stdmemory.h>
 
 #include <openvdb/openvdb.h>
 
-#include <sstream>
+#ifdef MOONRAY_USE_NANOVDB
+#include <moonray/rendering/texturing/sampler/NanoVDBSampler.h>
+#endif
 
 using moonray::texture::VDBSampler;
-using moonray::texture::TypedVDBSampler;
 
-namespace {
-
-openvdb::GridBase::Ptr
-readGrid(const std::string &fileName, const std::string &gridName,
-         std::string &foundGrid, std::string &errorMsg)
-{
-    openvdb::GridBase::Ptr grid;
-
-    if (fileName.empty()) {
-        errorMsg = "no .vdb filename specified";
-        return grid;
-    }
-
-    openvdb::initialize();
-    openvdb::io::File file(fileName);
-    try {
-        file.open();
-    } catch (const openvdb::IoError &e) {
-        errorMsg = e.what();
-        return grid;
-    }
-
-    std::string whichGrid = gridName;
-
-    if (gridName.empty()) {
-        // use first grid in the file
-        openvdb::io::File::NameIterator firstName = file.beginName();
-        if (firstName != file.endName()) {
-            whichGrid = firstName.gridName();
-        }
-    } else if (!file.hasGrid(gridName)) {
-        std::ostringstream os;
-        os << "'" << fileName << "' does not contain a grid named '" << gridName << "'";
-        file.close();
-        errorMsg = os.str();
-        return grid;
-    }
-
-    grid = file.readGrid(whichGrid);
-    file.close();
-
-    foundGrid = whichGrid;
-
-    return grid;
-}
-
-} // anonymous namespace
+// Grids are converted to NanoVDB at load time when it is available.
+#ifdef MOONRAY_USE_NANOVDB
+template<typename GridT> using TypedSampler = moonray::texture::TypedNanoVDBSampler<GridT>;
+#else
+template<typename GridT> using TypedSampler = moonray::texture::TypedVDBSampler<GridT>;
+#endif
 
 namespace moonray {
 namespace shading {
@@ -90,15 +51,20 @@ OpenVdbSampler::initialize(const std::string &fileName,
     // the openvdb library itself, to prevent users of this class
     // from needing to try/catch to prevent moonray from crashing.
     try {
-        std::string foundGrid;
-        mGrid = readGrid(fileName, gridName, foundGrid, errorMsg);
+        // The grid may be shared with other maps, light filters and volumes
+        // through the grid cache.
+        mCachedGrid = texture::getVdbGridCache().getGrid(fileName, gridName, errorMsg);
 
-        if (!mGrid) {
+        if (!mCachedGrid) {
             // errorMsg is already set
             return false;
         }
 
-        mValueType = mGrid->valueType();
+        mValueType = mCachedGrid->valueType();
+
+        // Our own grid sharing the cached grid's tree, with its own transform
+        mGrid = openvdb::ConstPtrCast<openvdb::GridBase>(mCachedGrid)->copyGrid();
+        mGrid->setTransform(mCachedGrid->transform().copy());
 
         // Append any additional transform provided by the user
         if (grid2world) {
@@ -118,10 +84,10 @@ OpenVdbSampler::initialize(const std::string &fileName,
         // create the appropriate TypedVDBSampler for this grid type
         if (mGrid->isType<openvdb::FloatGrid>()) {
             openvdb::FloatGrid::ConstPtr g = openvdb::gridConstPtrCast<openvdb::FloatGrid>(mGrid);
-            mSampler = fauxstd::make_unique<TypedVDBSampler<openvdb::FloatGrid>>(*g);
+            mSampler = fauxstd::make_unique<TypedSampler<openvdb::FloatGrid>>(*g);
         } else if (mGrid->isType<openvdb::VectorGrid>()) {
             openvdb::VectorGrid::ConstPtr g = openvdb::gridConstPtrCast<openvdb::VectorGrid>(mGrid);
-            mSampler = fauxstd::make_unique<TypedVDBSampler<openvdb::VectorGrid>>(*g);
+            mSampler = fauxstd::make_unique<TypedSampler<openvdb::VectorGrid>>(*g);
         } else {
             // TODO: provide more information to user
             // eg. filename, gridname, which gridtype is it that is unsupported...
@@ -130,7 +96,7 @@ OpenVdbSampler::initialize(const std::string &fileName,
         }
 
         mFileName = fileName;
-        mGridName = foundGrid;
+        mGridName = gridName.empty() ? mGrid->getName() : gridName;
         mR2W = render2world;
         mIsInitialized = true;
     } catch (const std::exception &e) {
@@ -188,13 +154,13 @@ OpenVdbSampler::sample(shading::TLState* tls,
 
     // cast to appropriate type and sample
     if (mGrid->isType<openvdb::FloatGrid>()) {
-        TypedVDBSampler<openvdb::FloatGrid>* sampler =
-            static_cast<TypedVDBSampler<openvdb::FloatGrid>*>(mSampler.get());
+        TypedSampler<openvdb::FloatGrid>* sampler =
+            static_cast<TypedSampler<openvdb::FloatGrid>*>(mSampler.get());
         const float val = sampler->sample(tls->mThreadIdx, p, interpolation);
         result = scene_rdl2::math::Color(val, val, val);
     } else if (mGrid->isType<openvdb::VectorGrid>()) {
-        TypedVDBSampler<openvdb::VectorGrid>* sampler =
-            static_cast<TypedVDBSampler<openvdb::VectorGrid>*>(mSampler.get());
+        TypedSampler<openvdb::VectorGrid>* sampler =
+            static_cast<TypedSampler<openvdb::VectorGrid>*>(mSampler.get());
         const openvdb::Vec3f val = sampler->sample(tls->mThreadIdx, p, interpolation);
         result = scene_rdl2::math::Color(val[0], val[1], val[2]);
     } else {
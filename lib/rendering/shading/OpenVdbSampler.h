@@ -85,6 +85,7 @@ public:
 
 private:
     bool mIsInitialized;
+    openvdb::GridBase::ConstPtr mCachedGrid;   // keeps the grid in the cache
     openvdb::GridBase::Ptr mGrid;
     std::unique_ptr<moonray::texture::VDBSampler> mSampler;
     const scene_rdl2::math::Mat4d* mR2W;
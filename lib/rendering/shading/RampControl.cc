@@ -14,6 +14,9 @@
 #include <scene_rdl2/common/math/Vec4.h>
 #include <scene_rdl2/render/util/stdmemory.h>
 
+#include <algorithm>
+#include <memory>
+
 using namespace scene_rdl2;
 using namespace scene_rdl2::math;
 
@@ -509,36 +512,33 @@ eval1DRamp(const int numEntries,
     return result;
 }
 
-template<class OutputType, typename BlendAdjustmentCallbackType>
+// eval1D evaluates the ramp at a 1D position
+template<class OutputType, typename Eval1DType>
 OutputType
 eval2DRamp(const int numEntries,
-           const float* inputs,
            const OutputType* outputs,
-           const ispc::RampInterpolatorMode* interpolators,
-           const OutputType* slopes,
            Vec2f uv,
            ispc::RampInterpolator2DType rampType2D,
            float inputRamp,
-           const BlendAdjustmentCallbackType& blendAdjustmentCallback)
+           const Eval1DType& eval1D)
 {
     OutputType result(math::zero);
 
     switch (rampType2D) {
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_V_RAMP:
-        result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, uv.y, blendAdjustmentCallback);
+        result = eval1D(uv.y);
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_U_RAMP:
-        result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, uv.x, blendAdjustmentCallback);
+        result = eval1D(uv.x);
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_DIAGONAL_RAMP:
-        result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, 0.5f * (uv.x + uv.y),
-                          blendAdjustmentCallback);
+        result = eval1D(0.5f * (uv.x + uv.y));
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_RADIAL_RAMP:
         {
             float value = math::atan2(uv.x - 0.5f, uv.y - 0.5f);
             value = 0.5f * (1.0f + value / math::sPi);
-            result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, value, blendAdjustmentCallback);
+            result = eval1D(value);
         }
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_CIRCULAR_RAMP:
@@ -551,20 +551,18 @@ eval2DRamp(const int numEntries,
             } else {
                 value = 0.0f;
             }
-            result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, value, blendAdjustmentCallback);
+            result = eval1D(value);
         }
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_BOX_RAMP:
         {
             const float value = 2.0f * math::max(math::abs(uv.x - 0.5f), math::abs(uv.y - 0.5f));
-            result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes, value, blendAdjustmentCallback);
+            result = eval1D(value);
         }
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_UxV_RAMP:
-        result = eval1DRamp(numEntries, inputs, outputs, interpolators, slopes,
-                          2.0f * math::abs(uv.y - 0.5f), blendAdjustmentCallback);
-        result *= eval1DRamp(numEntries, inputs, outputs, interpolators, slopes,
-                           2.0f * math::abs(uv.x - 0.5f), blendAdjustmentCallback);
+        result = eval1D(2.0f * math::abs(uv.y - 0.5f));
+        result *= eval1D(2.0f * math::abs(uv.x - 0.5f));
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_FOUR_CORNER_RAMP: // Special case, not calling evaluateRampColor()
         {
@@ -580,9 +578,7 @@ eval2DRamp(const int numEntries,
         break;
     case ispc::RAMP_INTERPOLATOR_2D_TYPE_INPUT:
         {
-            result = eval1DRamp(numEntries,
-                                inputs, outputs, interpolators, slopes,
-                                inputRamp, blendAdjustmentCallback);
+            result = eval1D(inputRamp);
         }
         break;
     default:
@@ -591,6 +587,87 @@ eval2DRamp(const int numEntries,
     return result;
 }
 
+// Max error of a baked ramp, relative to values above 1
+constexpr float sRampLutTolerance = 1e-3f;
+
+// Position of t in a baked ramp's table: returns the index of the table
+// interval and the fractional position within it. Matches
+// getRampLutPosition() in RampControl.ispc.
+finline float
+getRampLutPosition(float t, float lutStart, float lutScale, int& index)
+{
+    float x = (t - lutStart) * lutScale;
+    x = x > 0.0f ? x : 0.0f; // also maps NaN to the start of the ramp
+    x = math::min(x, float(ispc::RAMP_LUT_SIZE - 1));
+    index = math::min(int(x), ispc::RAMP_LUT_SIZE - 2);
+    return x - float(index);
+}
+
+// Copy of a baked ramp's table, owned by the caller
+float*
+copyRampLut(const float* lut, const int numChannels)
+{
+    if (!lut) {
+        return nullptr;
+    }
+    float* copy = new float[ispc::RAMP_LUT_SIZE * numChannels];
+    std::copy(lut, lut + ispc::RAMP_LUT_SIZE * numChannels, copy);
+    return copy;
+}
+
+// Samples a ramp over its defined range into a table of ispc::RAMP_LUT_SIZE
+// samples of numChannels floats each, eval1D(t, values) evaluating it exactly.
+// Outside that range ramps are constant, which the clamped table lookup
+// reproduces. Returns false if the ramp has discontinuities, or if linear
+// interpolation of the samples is off by more than the tolerance in the
+// middle of any table interval, which catches spans too short or curved
+// for the table resolution.
+template<typename Eval1DType>
+bool
+bakeRampLut(const int numEntries,
+            const float* inputs,
+            const ispc::RampInterpolatorMode* interpolators,
+            const int numChannels,
+            const Eval1DType& eval1D,
+            float* lut,
+            float& lutStart,
+            float& lutScale)
+{
+    // A single control point is as cheap to evaluate as the table
+    if (numEntries < 2) {
+        return false;
+    }
+    const float range = inputs[numEntries - 1] - inputs[0];
+    const float step = range / float(ispc::RAMP_LUT_SIZE - 1);
+
+    // Spans shorter than a table step are steps as far as the table goes
+    for (int i = 0; i < numEntries - 1; ++i) {
+        if (interpolators[i] == ispc::RAMP_INTERPOLATOR_MODE_NONE ||
+            !(inputs[i + 1] - inputs[i] >= step)) {
+            return false;
+        }
+    }
+    lutStart = inputs[0];
+    lutScale = 1.0f / step;
+
+    for (int i = 0; i < ispc::RAMP_LUT_SIZE; ++i) {
+        eval1D(lutStart + float(i) * step, &lut[i * numChannels]);
+    }
+
+    float exact[3];
+    MNRY_ASSERT(numChannels <= 3);
+    for (int i = 0; i < ispc::RAMP_LUT_SIZE - 1; ++i) {
+        eval1D(lutStart + (float(i) + 0.5f) * step, exact);
+        for (int c = 0; c < numChannels; ++c) {
+            const float approx = 0.5f * (lut[i * numChannels + c] + lut[(i + 1) * numChannels + c]);
+            if (!(math::abs(approx - exact[c]) <= sRampLutTolerance * math::max(1.0f, math::abs(exact[c])))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 } // end anonymous namespace
 
 
@@ -606,6 +683,8 @@ FloatRampControl::init(int numEntries,
     // ignore any extra points
     numEntries = math::min(numEntries, ispc::RAMP_MAX_POINTS);
 
+    delete [] mIspc.mLut;
+    mIspc.mLut = nullptr;
     mIspc.mNumEntries = numEntries;
 
     for (int i = 0; i < numEntries; ++i) {
@@ -624,15 +703,64 @@ FloatRampControl::init(int numEntries,
                            mIspc.mSlopes);
 }
 
+FloatRampControl::FloatRampControl(const FloatRampControl& other) :
+    mIspc(other.mIspc)
+{
+    mIspc.mLut = copyRampLut(other.mIspc.mLut, 1);
+}
+
+FloatRampControl&
+FloatRampControl::operator=(const FloatRampControl& other)
+{
+    if (this != &other) {
+        delete [] mIspc.mLut;
+        mIspc = other.mIspc;
+        mIspc.mLut = copyRampLut(other.mIspc.mLut, 1);
+    }
+    return *this;
+}
+
+FloatRampControl::~FloatRampControl()
+{
+    delete [] mIspc.mLut;
+}
+
+bool
+FloatRampControl::bake()
+{
+    delete [] mIspc.mLut;
+    mIspc.mLut = nullptr;
+
+    std::unique_ptr<float[]> lut(new float[ispc::RAMP_LUT_SIZE]);
+    if (!bakeRampLut(mIspc.mNumEntries, mIspc.mInputs, mIspc.mInterpolators, 1,
+                     [&](float t, float* value) { *value = evalExact1D(t); },
+                     lut.get(), mIspc.mLutStart, mIspc.mLutScale)) {
+        return false;
+    }
+
+    mIspc.mLut = lut.release();
+    return true;
+}
+
+float
+FloatRampControl::evalExact1D(float t) const
+{
+    auto blendAdjustmentCallback = [&](const float&, const float&) { };
+    return eval1DRamp(mIspc.mNumEntries, mIspc.mInputs, mIspc.mOutputs, mIspc.mInterpolators,
+                      mIspc.mSlopes, t, blendAdjustmentCallback);
+}
+
 float
 FloatRampControl::eval1D(float t) const {
     if (mIspc.mNumEntries == 0) {
         return  0.0f;
     }
-    auto blendAdjustmentCallback = [&](const float&, const float&) { };
-    float result = eval1DRamp(mIspc.mNumEntries, mIspc.mInputs, mIspc.mOutputs, mIspc.mInterpolators,
-                             mIspc.mSlopes, t, blendAdjustmentCallback);
-    return result;
+    if (mIspc.mLut) {
+        int i;
+        const float f = getRampLutPosition(t, mIspc.mLutStart, mIspc.mLutScale, i);
+        return mIspc.mLut[i] + f * (mIspc.mLut[i + 1] - mIspc.mLut[i]);
+    }
+    return evalExact1D(t);
 }
 
 float
@@ -642,9 +770,8 @@ FloatRampControl::eval2D(const Vec2f& uv,
     if (mIspc.mNumEntries == 0) {
         return 1.0f;
     }
-    auto blendAdjustmentCallback = [&](float& left, float& right) { };
-    float result = eval2DRamp(mIspc.mNumEntries, mIspc.mInputs, mIspc.mOutputs, mIspc.mInterpolators,
-                             mIspc.mSlopes, uv, rampType2D, inputRamp, blendAdjustmentCallback);
+    float result = eval2DRamp(mIspc.mNumEntries, mIspc.mOutputs, uv, rampType2D, inputRamp,
+                              [&](float t) { return eval1D(t); });
 
     return result;
 }
@@ -663,6 +790,8 @@ ColorRampControl::init(int numEntries,
     numEntries = math::min(numEntries, ispc::RAMP_MAX_POINTS);
 
     // copy inputs/outputs/interpolators
+    delete [] mIspc.mLut;
+    mIspc.mLut = nullptr;
     mIspc.mNumEntries = numEntries;
     for (int i = 0; i < numEntries; ++i) {
         mIspc.mInputs[i] = inputs[i];
@@ -724,6 +853,80 @@ ColorRampControl::blendAdjustment(Color& left, Color& right) const {
     }
 }
 
+ColorRampControl::ColorRampControl(const ColorRampControl& other) :
+    mIspc(other.mIspc)
+{
+    mIspc.mLut = copyRampLut(other.mIspc.mLut, 3);
+}
+
+ColorRampControl&
+ColorRampControl::operator=(const ColorRampControl& other)
+{
+    if (this != &other) {
+        delete [] mIspc.mLut;
+        mIspc = other.mIspc;
+        mIspc.mLut = copyRampLut(other.mIspc.mLut, 3);
+    }
+    return *this;
+}
+
+ColorRampControl::~ColorRampControl()
+{
+    delete [] mIspc.mLut;
+}
+
+bool
+ColorRampControl::bake()
+{
+    delete [] mIspc.mLut;
+    mIspc.mLut = nullptr;
+
+    // The table holds the values in the ramp's color space, before the
+    // conversion back to RGB, as the exact evaluation blends them.
+    std::unique_ptr<float[]> lut(new float[ispc::RAMP_LUT_SIZE * 3]);
+    if (!bakeRampLut(mIspc.mNumEntries, mIspc.mInputs, mIspc.mInterpolators, 3,
+                     [&](float t, float* value) {
+                         const Color c = evalExact1D(t);
+                         value[0] = c.r;
+                         value[1] = c.g;
+                         value[2] = c.b;
+                     },
+                     lut.get(), mIspc.mLutStart, mIspc.mLutScale)) {
+        return false;
+    }
+
+    mIspc.mLut = lut.release();
+    return true;
+}
+
+Color
+ColorRampControl::evalExact1D(float t) const
+{
+    return eval1DRamp(mIspc.mNumEntries,
+                      mIspc.mInputs,
+                      reinterpret_cast<const Color*>(mIspc.mOutputs),
+                      mIspc.mInterpolators,
+                      reinterpret_cast<const Color*>(mIspc.mSlopes),
+                      t,
+                      [&](Color& left, Color& right) {
+                          blendAdjustment(left, right);
+                      });
+}
+
+Color
+ColorRampControl::evalSpace1D(float t) const
+{
+    if (mIspc.mLut) {
+        int i;
+        const float f = getRampLutPosition(t, mIspc.mLutStart, mIspc.mLutScale, i);
+        const float* lut = mIspc.mLut + 3 * i;
+        const Color left(lut[0], lut[1], lut[2]);
+        const Color right(lut[3], lut[4], lut[5]);
+        return left + f * (right - left);
+    }
+    return evalExact1D(t);
+}
+
 Color
 ColorRampControl::eval1D(float t) const
 {
@@ -731,15 +934,7 @@ ColorRampControl::eval1D(float t) const
         return math::sBlack;
     }
 
-    Color result = eval1DRamp(mIspc.mNumEntries,
-                            mIspc.mInputs,
-                            reinterpret_cast<const Color*>(mIspc.mOutputs),
-                            mIspc.mInterpolators,
-                            reinterpret_cast<const Color*>(mIspc.mSlopes),
-                            t,
-                            [&](Color& left, Color& right) {
-                                blendAdjustment(left, right);
-                            });
+    Color result = evalSpace1D(t);
 
     // convert back to HSV/HSL after evaluation if needed
     if (mIspc.mColorSpace == ispc::COLOR_RAMP_CONTROL_SPACE_HSV) {
@@ -767,16 +962,11 @@ ColorRampControl::eval2D(const Vec2f& uv,
         result = outputs[0];
     } else {
         result = eval2DRamp(mIspc.mNumEntries,
-                              mIspc.mInputs,
-                              outputs,
-                              mIspc.mInterpolators,
-                              reinterpret_cast<const Color*>(mIspc.mSlopes),
-                              uv,
-                              rampType2D,
-                              inputRamp,
-                              [&](Color& left, Color& right) {
-                                  blendAdjustment(left, right);
-                              });
+                            outputs,
+                            uv,
+                            rampType2D,
+                            inputRamp,
+                            [&](float t) { return evalSpace1D(t); });
     }
 
     // convert back to HSV/HSL after evaluation if needed
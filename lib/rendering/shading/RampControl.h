@@ -20,13 +20,26 @@ namespace shading {
 class FloatRampControl {
 public:
     FloatRampControl() : mIspc() {}
-    ~FloatRampControl() {}
+    FloatRampControl(const FloatRampControl& other);
+    FloatRampControl& operator=(const FloatRampControl& other);
+    ~FloatRampControl();
 
     void init(const int numEntries,
               const float* inputs,
               const float* outputs,
               const ispc::RampInterpolatorMode* interpolators);
 
+    /// Bakes the ramp into a table of RAMP_LUT_SIZE samples, which the scalar
+    /// and vector evaluations then interpolate linearly instead of evaluating
+    /// the control points. Meant for ramps set up once in update(), not for
+    /// ramps set up per shading point. Ramps with discontinuities, i.e. spans
+    /// with no interpolation or shorter than a table step, or which the table
+    /// doesn't reproduce within tolerance keep the exact evaluation.
+    /// init() discards the table.
+    /// @return true if the ramp was baked
+    bool bake();
+    bool isBaked() const { return mIspc.mLut != nullptr; }
+
     /// evaluates the ramp to return an output float value based on a 1D input 't'
     /// @param t input position to be evaluated on the ramp
     /// @return float result based on ramp control and input 't'
@@ -44,6 +57,11 @@ public:
     /// Gets ispc object for vector mode
     HUD_AS_ISPC_METHODS(FloatRampControl);
 private:
+    float evalExact1D(float t) const;
+
+    // Owns the table mIspc.mLut points to, if baked. This class must stay
+    // the same size as the ispc struct, as it is a member of ispc mirrored
+    // classes such as the light filters.
     ispc::FloatRampControl mIspc;
 };
 
@@ -53,7 +71,9 @@ private:
 class ColorRampControl {
 public:
     ColorRampControl() : mIspc() {}
-    ~ColorRampControl() {}
+    ColorRampControl(const ColorRampControl& other);
+    ColorRampControl& operator=(const ColorRampControl& other);
+    ~ColorRampControl();
 
     void init(const int numEntries,
               const float* inputs,
@@ -62,6 +82,10 @@ public:
               ispc::ColorRampControlSpace colorSpace,
               const bool applyHueBlendAdjustment = true);
 
+    /// Bakes the ramp into a table, see FloatRampControl::bake()
+    bool bake();
+    bool isBaked() const { return mIspc.mLut != nullptr; }
+
     /// evaluates the ramp to return an output Color value based on a 1D input 't'
     /// @param t input position to be evaluated on the ramp
     /// @return Color result based on ramp control and input 't'
@@ -83,6 +107,11 @@ private:
     void blendAdjustment(scene_rdl2::math::Color& left,
                          scene_rdl2::math::Color& right) const;
 
+    // In the ramp's color space, as the table
+    scene_rdl2::math::Color evalExact1D(float t) const;
+    scene_rdl2::math::Color evalSpace1D(float t) const;
+
+    // Owns the table mIspc.mLut points to, see FloatRampControl
     ispc::ColorRampControl mIspc;
 };
 
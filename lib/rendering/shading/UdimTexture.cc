@@ -347,6 +347,8 @@ public:
             }
         }
 
+        tls->mTextureSampler->getPrefetcher().record(texHandle, st[0], st[1], derivatives);
+
         bool res = texSys->texture(
             const_cast<texture::TextureHandle *>(texHandle),
             tls->mOIIOThreadData,
@@ -707,7 +709,7 @@ void CPP_oiioUdimTexture(const ispc::UDIM_TEXTURE_Data *tx,
 
     scene_rdl2::rdl2::Shader *shader = reinterpret_cast<scene_rdl2::rdl2::Shader *>(tx->mShader);
 
-    const texture::TextureHandle *textureHandle = (udim >= tx->mNumTextures) ? 
+    const texture::TextureHandle *textureHandle = (udim < 0 || udim >= tx->mNumTextures) ?
         nullptr :
         (reinterpret_cast<const texture::TextureHandle **>(tx->mTextureHandles))[udim];
 
@@ -721,7 +723,7 @@ void CPP_oiioUdimTexture(const ispc::UDIM_TEXTURE_Data *tx,
             result[3] = 1.0f;
             return;
         } else {
-            if (udim >= tx->mNumTextures) {
+            if (udim < 0 || udim >= tx->mNumTextures) {
                 scene_rdl2::rdl2::Shader::getLogEventRegistry().log(shader, tx->mErrorUdimOutOfRangeV);
             } else {
                 scene_rdl2::rdl2::Shader::getLogEventRegistry().log(shader, tx->mErrorUdimMissingTexture[udim]);
@@ -750,6 +752,8 @@ void CPP_oiioUdimTexture(const ispc::UDIM_TEXTURE_Data *tx,
     float dtdy = derivatives[3];
     const int nChannels = 4;
 
+    tls->mTextureSampler->getPrefetcher().record(textureHandle, s, t, derivatives);
+
     bool res = texSys->texture(const_cast<texture::TextureHandle *>(textureHandle),
                                threadInfo,
                                *options[udim * QualityCount + index],
@@ -771,6 +775,176 @@ void CPP_oiioUdimTexture(const ispc::UDIM_TEXTURE_Data *tx,
     }
 }
 
+namespace {
+
+OIIO::TextureOptBatch
+toBatchOptions(const texture::TextureOptions &options)
+{
+    OIIO::TextureOptBatch batchOptions;
+    for (int i = 0; i < OIIO::Tex::BatchWidth; ++i) {
+        batchOptions.sblur[i] = options.sblur;
+        batchOptions.tblur[i] = options.tblur;
+        batchOptions.swidth[i] = options.swidth;
+        batchOptions.twidth[i] = options.twidth;
+    }
+    batchOptions.firstchannel = options.firstchannel;
+    batchOptions.subimage = options.subimage;
+    batchOptions.subimagename = options.subimagename;
+    batchOptions.swrap = static_cast<OIIO::Tex::Wrap>(options.swrap);
+    batchOptions.twrap = static_cast<OIIO::Tex::Wrap>(options.twrap);
+    batchOptions.mipmode = static_cast<OIIO::Tex::MipMode>(options.mipmode);
+    batchOptions.interpmode = static_cast<OIIO::Tex::InterpMode>(options.interpmode);
+    batchOptions.anisotropic = options.anisotropic;
+    batchOptions.conservative_filter = options.conservative_filter;
+    batchOptions.fill = options.fill;
+    batchOptions.missingcolor = options.missingcolor;
+    return batchOptions;
+}
+
+} // namespace
+
+void CPP_oiioUdimTextureBatch(const ispc::UDIM_TEXTURE_Data *tx,
+                              shading::TLState *tls,
+                              const uint32_t displacement,
+                              const uint64_t laneMask,
+                              const int *pathTypes,
+                              const float *derivatives,
+                              const int *udims,
+                              const float *st,
+                              float *result)
+//
+// The arrays hold VLEN lanes each, derivatives 4 and st 2 rows of them, and
+// result 4 rows of VLEN. Lanes sharing a udim tile and texture options are
+// looked up with a single call to the batched OIIO texture(), so the tile
+// handle and mip level work is done once per group rather than once per lane.
+//
+{
+    const uint64_t one = 1;
+
+    auto sampleLane = [&](int lane) {
+        const float laneDerivatives[4] = { derivatives[lane], derivatives[VLEN + lane],
+                                           derivatives[2 * VLEN + lane], derivatives[3 * VLEN + lane] };
+        const float laneSt[2] = { st[lane], st[VLEN + lane] };
+        float laneResult[4];
+        CPP_oiioUdimTexture(tx, tls, displacement, pathTypes[lane], laneDerivatives, udims[lane],
+                            laneSt, laneResult);
+        for (int c = 0; c < 4; ++c) {
+            result[c * VLEN + lane] = laneResult[c];
+        }
+    };
+
+    if (!tx->mIsValid && tx->mUseDefaultColor) {
+        for (int lane = 0; lane < int(VLEN); ++lane) {
+            if (laneMask & (one << lane)) {
+                sampleLane(lane);
+            }
+        }
+        return;
+    }
+
+    scene_rdl2::rdl2::Shader *shader = reinterpret_cast<scene_rdl2::rdl2::Shader *>(tx->mShader);
+    const texture::TextureHandle * const *textureHandles =
+        reinterpret_cast<const texture::TextureHandle * const *>(tx->mTextureHandles);
+    std::vector<std::unique_ptr<texture::TextureOptions>>& options =
+        *(reinterpret_cast<std::vector<std::unique_ptr<texture::TextureOptions>>*>(tx->mTextureOptions));
+
+    texture::TLState::Perthread *threadInfo = tls->mOIIOThreadData;
+    OIIO::TextureSystem *texSys = MNRY_VERIFY(tls->mTextureSystem);
+    texture::TexturePrefetcher &prefetcher = tls->mTextureSampler->getPrefetcher();
+
+    constexpr int batchWidth = OIIO::Tex::BatchWidth;
+    ALIGN(64) float s[batchWidth];
+    ALIGN(64) float t[batchWidth];
+    ALIGN(64) float dsdx[batchWidth];
+    ALIGN(64) float dtdx[batchWidth];
+    ALIGN(64) float dsdy[batchWidth];
+    ALIGN(64) float dtdy[batchWidth];
+    ALIGN(64) float batchResult[4 * batchWidth];
+    int batchLanes[batchWidth];
+
+    uint64_t remaining = laneMask;
+    while (remaining) {
+        const int firstLane = __builtin_ctzll(remaining);
+        const int udim = udims[firstLane];
+        const int index = getTextureOptionIndex(displacement != 0,
+            static_cast<shading::Intersection::PathType>(pathTypes[firstLane]));
+
+        // Gather the lanes sharing the udim and options of the first lane.
+        uint64_t group = 0;
+        for (uint64_t bits = remaining; bits; bits &= bits - 1) {
+            const int lane = __builtin_ctzll(bits);
+            if (udims[lane] == udim && pathTypes[lane] == pathTypes[firstLane]) {
+                group |= one << lane;
+            }
+        }
+        remaining &= ~group;
+
+        const texture::TextureHandle *textureHandle = (udim < 0 || udim >= tx->mNumTextures) ?
+            nullptr : textureHandles[udim];
+        if (textureHandle == nullptr) {
+            // Missing and out of range tiles take the scalar path, which
+            // handles their default color and error logging.
+            for (uint64_t bits = group; bits; bits &= bits - 1) {
+                sampleLane(__builtin_ctzll(bits));
+            }
+            continue;
+        }
+
+        OIIO::TextureOptBatch batchOptions = toBatchOptions(*options[udim * QualityCount + index]);
+
+        while (group) {
+            int numLanes = 0;
+            for (; group && numLanes < batchWidth; group &= group - 1) {
+                const int lane = __builtin_ctzll(group);
+                // Same derivative order as CPP_oiioUdimTexture().
+                s[numLanes] = st[lane];
+                t[numLanes] = st[VLEN + lane];
+                dsdx[numLanes] = derivatives[lane];
+                dtdx[numLanes] = derivatives[2 * VLEN + lane];
+                dsdy[numLanes] = derivatives[VLEN + lane];
+                dtdy[numLanes] = derivatives[3 * VLEN + lane];
+                batchLanes[numLanes] = lane;
+
+                const float laneDerivatives[4] = { dsdx[numLanes], dsdy[numLanes], dtdx[numLanes], dtdy[numLanes] };
+                prefetcher.record(textureHandle, s[numLanes], t[numLanes], laneDerivatives);
+                ++numLanes;
+            }
+            for (int i = numLanes; i < batchWidth; ++i) {
+                s[i] = t[i] = dsdx[i] = dtdx[i] = dsdy[i] = dtdy[i] = 0.0f;
+            }
+
+            const OIIO::Tex::RunMask runMask = (numLanes == batchWidth) ?
+                OIIO::Tex::RunMaskOn : ((OIIO::Tex::RunMask(1) << numLanes) - 1);
+            const bool res = texSys->texture(const_cast<texture::TextureHandle *>(textureHandle),
+                                             threadInfo,
+                                             batchOptions,
+                                             runMask,
+                                             s, t,
+                                             dsdx, dtdx, dsdy, dtdy,
+                                             4,
+                                             batchResult);
+
+            if (!res) {
+                scene_rdl2::rdl2::Shader::getLogEventRegistry().log(shader, tx->mErrorSampleFail);
+            }
+
+            for (int i = 0; i < numLanes; ++i) {
+                float *laneResult[4];
+                for (int c = 0; c < 4; ++c) {
+                    laneResult[c] = &result[c * VLEN + batchLanes[i]];
+                    *laneResult[c] = res ? batchResult[c * batchWidth + i] : 0.0f;
+                }
+                if (res && tx->mApplyGamma && tx->mIs8bit) {
+                    // don't gamma the alpha channel
+                    for (int c = 0; c < 3; ++c) {
+                        *laneResult[c] = *laneResult[c] > 0.0f ? powf(*laneResult[c], 2.2f) : 0.0f;
+                    }
+                }
+            }
+        }
+    }
+}
+
 } // namespace shading
 } // namespace moonray
 
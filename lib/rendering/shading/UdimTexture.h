@@ -69,6 +69,18 @@ void CPP_oiioUdimTexture(const ispc::UDIM_TEXTURE_Data* tx,
                          const int udim,
                          const float* st,
                          float* result);
+
+// Samples the lanes set in laneMask, grouping them by udim tile. Every array
+// holds VLEN lanes per row, see UdimTexture.cc.
+void CPP_oiioUdimTextureBatch(const ispc::UDIM_TEXTURE_Data* tx,
+                              shading::TLState *tls,
+                              const uint32_t displacement,
+                              const uint64_t laneMask,
+                              const int* pathTypes,
+                              const float* derivatives,
+                              const int* udims,
+                              const float* st,
+                              float* result);
 }
 
 } // namespace shading
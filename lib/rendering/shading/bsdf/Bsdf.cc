@@ -50,6 +50,14 @@ BsdfLobe::setFresnel(Fresnel *fresnel)
     mFresnel = fresnel;
 }
 
+void
+BsdfLobe::evalBatch(const BsdfSlice &slice, int count, const Vec3f *wi, Color *f, float *pdf) const
+{
+    for (int i = 0; i < count; ++i) {
+        f[i] = eval(slice, wi[i], &pdf[i]);
+    }
+}
+
 bool
 BsdfLobe::getProperty(Property property, float *dest) const
 {
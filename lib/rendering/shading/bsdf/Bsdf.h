@@ -210,6 +210,15 @@ public:
     virtual scene_rdl2::math::Color eval(const BsdfSlice &slice, const scene_rdl2::math::Vec3f &wi,
             float *pdf = nullptr) const = 0;
 
+    /// Evaluate the bsdf and the pdf for count directions at once, the same as
+    /// calling eval(slice, wi[i], &pdf[i]) for each of them. Lobes can override
+    /// this to compute the terms which only depend on wo, such as the fresnel
+    /// term of a diffuse lobe, once for all the directions. Lobes deriving from
+    /// a lobe which overrides this must override it too if they change eval().
+    /// Same thread-safety caveat as eval().
+    virtual void evalBatch(const BsdfSlice &slice, int count, const scene_rdl2::math::Vec3f *wi,
+            scene_rdl2::math::Color *f, float *pdf) const;
+
     /// Sample the bsdf for the given observer (fixed) direction wo.
     /// This function should sample an incident direction wi and return
     /// the probability density of choosing this direction given wo (density
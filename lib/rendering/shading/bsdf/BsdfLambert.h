@@ -43,6 +43,8 @@ public:
         mFrame(N),
         mAlbedo(albedo) {}
 
+    finline void setAlbedo(const scene_rdl2::math::Color& albedo) { mAlbedo = albedo; }
+
     // BsdfLobe API
     finline scene_rdl2::math::Color eval(const BsdfSlice &slice, const scene_rdl2::math::Vec3f &wi, float *pdf = NULL) const override
     {
@@ -71,6 +73,30 @@ public:
                 (slice.getIncludeCosineTerm()  ?  cosThetaWi  :  1.0f);
     }
 
+    void evalBatch(const BsdfSlice &slice, int count, const scene_rdl2::math::Vec3f *wi,
+            scene_rdl2::math::Color *f, float *pdf) const override
+    {
+        // Same as eval(), but the fresnel term only depends on wo so it is
+        // evaluated once for all the directions.
+        float cosThetaWo = 1.0f;
+        if (getFresnel()) {
+            const scene_rdl2::math::Vec3f N = (matchesFlag(REFLECTION)) ? mFrame.getN() : -mFrame.getN();
+            cosThetaWo = scene_rdl2::math::max(dot(N, slice.getWo()), 0.0f);
+        }
+        const scene_rdl2::math::Color albedo = mAlbedo * computeScaleAndFresnel(cosThetaWo) *
+                                               scene_rdl2::math::sOneOverPi;
+        const bool reflection = matchesFlag(REFLECTION);
+        const bool includeCosineTerm = slice.getIncludeCosineTerm();
+
+        for (int i = 0; i < count; ++i) {
+            const float cosThetaWi = scene_rdl2::math::max(dot(mFrame.getN(), wi[i]), 0.0f);
+            pdf[i] = cosThetaWi * scene_rdl2::math::sOneOverPi;
+
+            const float Gs = reflection ? slice.computeShadowTerminatorFix(mFrame.getN(), wi[i]) : 1.0f;
+            f[i] = Gs * albedo * (includeCosineTerm  ?  cosThetaWi  :  1.0f);
+        }
+    }
+
 
     finline scene_rdl2::math::Color sample(const BsdfSlice &slice, float r1, float r2,
             scene_rdl2::math::Vec3f &wi, float &pdf) const override
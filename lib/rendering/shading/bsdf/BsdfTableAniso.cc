@@ -16,6 +16,11 @@
 #include <cstring>
 #include <stdio.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace scene_rdl2::math;
 
 namespace moonray {
@@ -41,7 +46,9 @@ AnisotropicBsdfTable::AnisotropicBsdfTable(bool reciprocal) :
     mSizeThetaD(90),
     mSizePhiD(reciprocal  ?  180  :  360),
     mReciprocal(reciprocal),
-    mData(nullptr)
+    mData(nullptr),
+    mMapping(nullptr),
+    mMappingSize(0)
 {
     init();
 }
@@ -54,7 +61,9 @@ AnisotropicBsdfTable::AnisotropicBsdfTable(int sizeThetaH, int sizePhiH,
     mSizeThetaD(sizeThetaD),
     mSizePhiD(sizePhiD),
     mReciprocal(reciprocal),
-    mData(nullptr)
+    mData(nullptr),
+    mMapping(nullptr),
+    mMappingSize(0)
 {
     init();
 }
@@ -73,7 +82,11 @@ AnisotropicBsdfTable::init()
 
 AnisotropicBsdfTable::~AnisotropicBsdfTable()
 {
-    delete [] mData;
+    if (mMapping) {
+        munmap(mMapping, mMappingSize);
+    } else {
+        delete [] mData;
+    }
 }
 
 
@@ -81,37 +94,47 @@ AnisotropicBsdfTable::~AnisotropicBsdfTable()
 
 // cppcheck-suppress uninitMemberVar // note these is an embree file so we are ignoring these
 AnisotropicBsdfTable::AnisotropicBsdfTable(const std::string &filename) :
-    mData(nullptr)
+    mData(nullptr),
+    mMapping(nullptr),
+    mMappingSize(0)
 {
     // Read file
-    FILE *file = fopen(filename.c_str(), "rb");
-    if (!file) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
         throw scene_rdl2::except::IoError("Cannot open file \"" + filename + "\" ("
                 + strerror(errno) + ")");
     }
 
     // TODO: read header
 
-    int reciprocal = 0;
-    if (fread(&mSizeThetaH, sizeof(int), 1, file) != 1  ||
-        fread(&mSizePhiH, sizeof(int), 1, file) != 1  ||
-        fread(&mSizeThetaD, sizeof(int), 1, file) != 1  ||
-        fread(&mSizePhiD, sizeof(int), 1, file) != 1  ||
-        fread(&reciprocal, sizeof(int), 1, file) != 1) {
-        fclose(file);
+    int header[5];
+    if (read(fd, header, sizeof(header)) != sizeof(header)) {
+        close(fd);
         throw scene_rdl2::except::IoError("Cannot read table size in file \"" + filename + "\" ("
                 + strerror(errno) + ")");
     }
-    mReciprocal = reciprocal;
-
-    init();
-
-    int floatCount = getFloatCount();
-    if (fread(mData, sizeof(float), floatCount, file) != floatCount) {
-        fclose(file);
+    mSizeThetaH = header[0];
+    mSizePhiH = header[1];
+    mSizeThetaD = header[2];
+    mSizePhiD = header[3];
+    mReciprocal = header[4];
+
+    // The table follows the header as is, map it rather than read it. The
+    // mapping is private, writes go to copies of the pages.
+    const size_t tableSize = sizeof(float) * size_t(getFloatCount());
+    struct stat st;
+    if (fstat(fd, &st) != 0  ||  size_t(st.st_size) < sizeof(header) + tableSize) {
+        close(fd);
+        throw scene_rdl2::except::IoError("Cannot read table in file \"" + filename + "\" (truncated)");
+    }
+    mMappingSize = sizeof(header) + tableSize;
+    void *mapping = mmap(nullptr, mMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
         throw scene_rdl2::except::IoError("Cannot read table in file \"" + filename + "\" ("+ strerror(errno) + ")");
     }
-    fclose(file);
+    mMapping = mapping;
+    mData = reinterpret_cast<float *>(static_cast<char *>(mapping) + sizeof(header));
 }
 
 
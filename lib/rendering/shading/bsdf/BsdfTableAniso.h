@@ -11,6 +11,7 @@
 #include <scene_rdl2/common/math/Color.h>
 #include <scene_rdl2/common/math/Vec3.h>
 
+#include <cstddef>
 #include <string>
 
 
@@ -46,6 +47,8 @@ public:
     ~AnisotropicBsdfTable();
 
     // Load a tabulated brdf file
+    // The table is mapped from the file, so the tables loaded from the same
+    // file share their pages, until setBsdf() writes to one of them.
     // This function is not thread-safe and may throw in case of error
     AnisotropicBsdfTable(const std::string &filename);
     void saveAs(const std::string &filename) const;
@@ -125,6 +128,10 @@ private:
     int mSizePhiD;
     bool mReciprocal;
     float *mData;
+
+    // File mapping holding mData, null when mData is allocated
+    void *mMapping;
+    size_t mMappingSize;
 };
 
 
@@ -526,6 +526,26 @@ GGXCookTorranceBsdfLobe::eval(const BsdfSlice &slice, const Vec3f &wi,
     return Gs * eval(slice, wi, pdf, cosNO, cosNI, mFrame);
 }
 
+void
+GGXCookTorranceBsdfLobe::evalBatch(const BsdfSlice &slice, int count, const Vec3f *wi,
+        Color *f, float *pdf) const
+{
+    const float cosNO = dot(mFrame.getN(), slice.getWo());
+    if (cosNO <= 0.0f) {
+        for (int i = 0; i < count; ++i) {
+            f[i] = sBlack;
+            pdf[i] = 0.0f;
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const float cosNI = dot(mFrame.getN(), wi[i]);
+        const float Gs = slice.computeShadowTerminatorFix(mFrame.getN(), wi[i]);
+        f[i] = Gs * eval(slice, wi[i], &pdf[i], cosNO, cosNI, mFrame);
+    }
+}
+
 Color
 GGXCookTorranceBsdfLobe::sample(const BsdfSlice &slice, float r1, float r2,
         Vec3f &wi, float &pdf) const
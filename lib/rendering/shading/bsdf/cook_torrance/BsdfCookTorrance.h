@@ -255,6 +255,8 @@ public:
 
     // BsdfLobe API
     scene_rdl2::math::Color eval(const BsdfSlice &slice, const scene_rdl2::math::Vec3f &wi, float *pdf = NULL) const override;
+    void evalBatch(const BsdfSlice &slice, int count, const scene_rdl2::math::Vec3f *wi,
+            scene_rdl2::math::Color *f, float *pdf) const override;
     scene_rdl2::math::Color sample(const BsdfSlice &slice, float r1, float r2,
                  scene_rdl2::math::Vec3f &wi, float &pdf) const override;
 
@@ -306,6 +308,12 @@ public:
 
     // BsdfLobe API
     scene_rdl2::math::Color eval(const BsdfSlice &slice, const scene_rdl2::math::Vec3f &wi, float *pdf = NULL) const override;
+    void evalBatch(const BsdfSlice &slice, int count, const scene_rdl2::math::Vec3f *wi,
+            scene_rdl2::math::Color *f, float *pdf) const override
+    {
+        // The evaluation frame is picked per direction.
+        BsdfLobe::evalBatch(slice, count, wi, f, pdf);
+    }
     scene_rdl2::math::Color sample(const BsdfSlice &slice, float r1, float r2,
             scene_rdl2::math::Vec3f &wi, float &pdf) const override;
 
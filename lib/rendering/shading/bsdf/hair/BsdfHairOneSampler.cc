@@ -34,7 +34,20 @@ HairOneSampleLobe::eval(const BsdfSlice &slice,
                         mHairRotation * mHairUV.x,  // use hair s coord to vary rotation from base to tip
                         mHairNormal);
 
-    if (pdf) *pdf = evalPdf(hairState);
+    if (pdf) {
+#if !PBR_HAIR_USE_UNIFORM_SAMPLING
+        // weights and cdfs for R, TRT, TT lobes respectively
+        float weights[3];
+        float cdf[3];
+        calculateSamplingWeightsAndCDF(hairState,
+                                       weights,
+                                       cdf);
+        if (!scene_rdl2::math::isZero(cdf[2])) {
+            return getScale() * evalBsdfAndPdf(hairState, weights, pdf);
+        }
+#endif
+        *pdf = evalPdf(hairState);
+    }
 
     return getScale() * evalBsdf(hairState);
 }
@@ -129,6 +142,71 @@ HairOneSampleLobe::evalPdf(const HairState& hairState,
 #endif
 }
 
+Color
+HairOneSampleLobe::evalBsdfAndPdf(const HairState& hairState,
+                                  const float (&weights)[3],
+                                  float *pdf) const
+{
+    // Same as evalBsdf() and evalPdf() above but the longitudinal M term of
+    // each lobe, which is also its theta pdf, and the azimuthal N terms of
+    // the R and TT lobes, which are also their phi pdfs, are only evaluated
+    // once. The TRT bsdf adds the glint to its N term so only its M term is
+    // shared.
+    Color bsdf = scene_rdl2::math::sBlack;
+    float rProb = 0.0f, ttProb = 0.0f, trtProb = 0.0f;
+
+    const Color T = hairState.absorptionTerm();
+
+    const Color fresnel = evalHairFresnel(hairState,
+                                          hairState.cosThetaD());
+
+    const Color oneMinusFresnel = scene_rdl2::math::sWhite - fresnel;
+
+    if (mShowR) {
+        const float m = rLobe.evalMTerm(hairState);
+        const float n = rLobe.evalPhiPdf(hairState);
+        const Color rFresnel = fresnel;
+        bsdf += rFresnel *
+                rLobe.getTint() *
+                m *
+                n * rLobe.absorption(hairState);
+        rProb = weights[0] * m * n;
+    }
+
+    if (mShowTT) {
+        const float m = ttLobe.evalMTerm(hairState);
+        const float n = ttLobe.evalPhiPdf(hairState);
+        const Color ttFresnel = oneMinusFresnel * oneMinusFresnel;
+        bsdf += ttFresnel *
+                ttLobe.getTint() *
+                m *
+                n * ttLobe.absorption(hairState);
+        ttProb = weights[2] * m * n;
+    }
+
+    if (mShowTRT) {
+        const float m = trtLobe.evalMTerm(hairState);
+        const Color trtFresnel = fresnel * oneMinusFresnel * oneMinusFresnel;
+        bsdf += trtFresnel *
+                trtLobe.getTint() *
+                m *
+                trtLobe.evalNTermWithAbsorption(hairState);
+        trtProb = weights[1] * m * trtLobe.evalPhiPdf(hairState);
+    }
+
+    if (mShowTRRT) {
+        const Color trrt = trrtLobe.compensationFactor(fresnel, oneMinusFresnel, T);
+        bsdf += trrt *
+                trrtLobe.getTint() *
+                trrtLobe.evalMTerm(hairState) *
+                trrtLobe.evalNTermWithAbsorption(hairState);
+    }
+
+    *pdf = max(0.0f, (rProb + trtProb + ttProb));
+
+    return bsdf;
+}
+
 //-----------------------------------------------------------------------------------//
 Color
 HairOneSampleLobe::sample(const BsdfSlice &slice,
@@ -208,9 +286,7 @@ HairOneSampleLobe::sample(const BsdfSlice &slice,
                            phiI,
                            thetaI);
 
-    pdf = evalPdf(hairState, weights);
-
-    return getScale() * evalBsdf(hairState);
+    return getScale() * evalBsdfAndPdf(hairState, weights, &pdf);
 #endif
 }
 
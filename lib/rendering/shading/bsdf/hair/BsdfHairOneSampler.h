@@ -140,6 +140,11 @@ private:
     float evalPdf(const HairState& hairState,
                   const float (&weights)[3]) const;
 
+    // evalBsdf() and evalPdf(hairState, weights) in one pass
+    scene_rdl2::math::Color evalBsdfAndPdf(const HairState& hairState,
+                                           const float (&weights)[3],
+                                           float *pdf) const;
+
     void calculateSamplingWeightsAndCDF(const HairState& hairState,
                                         float (&weights)[3],
                                         float (&cdf)[3]) const;
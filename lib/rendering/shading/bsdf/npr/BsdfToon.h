@@ -185,6 +185,13 @@ public:
                              const scene_rdl2::math::Vec3f &wi,
                              float *pdf = NULL) const override;
 
+    // The lambert batch evaluation doesn't know about the ramp.
+    void evalBatch(const BsdfSlice &slice, int count, const scene_rdl2::math::Vec3f *wi,
+            scene_rdl2::math::Color *f, float *pdf) const override
+    {
+        BsdfLobe::evalBatch(slice, count, wi, f, pdf);
+    }
+
     void show(std::ostream& os, const std::string& indent) const override;
 
 private: 
@@ -0,0 +1,87 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file NanoVDBSampler.h
+///
+
+#pragma once
+
+#include "VDBSampler.h"
+
+#include <nanovdb/NanoVDB.h>
+#include <nanovdb/util/GridHandle.h>
+#include <nanovdb/util/OpenToNanoVDB.h>
+#include <nanovdb/util/SampleFromVoxels.h>
+
+namespace moonray {
+namespace texture {
+
+// NanoVDB value types of the supported OpenVDB grid types.
+template<typename GridT> struct NanoVDBValueType;
+template<> struct NanoVDBValueType<openvdb::FloatGrid> { typedef float Type; };
+template<> struct NanoVDBValueType<openvdb::Vec3SGrid> { typedef nanovdb::Vec3f Type; };
+
+//
+// Drop in replacement of TypedVDBSampler which converts the grid to NanoVDB
+// once, at load time. The NanoVDB grid is a single pointer free block of
+// memory, so lookups only need a read accessor on the stack instead of a per
+// thread OpenVDB accessor, and the block can be handed to the GPU as is.
+//
+template<typename GridT>
+class TypedNanoVDBSampler : public VDBSampler
+{
+private:
+    typedef typename GridT::ValueType ValueT;
+    typedef typename NanoVDBValueType<GridT>::Type NanoValueT;
+    typedef nanovdb::NanoGrid<NanoValueT> NanoGridT;
+
+public:
+    explicit TypedNanoVDBSampler(const GridT& grid) :
+        mHandle(nanovdb::openToNanoVDB(grid)),
+        mGrid(mHandle.template grid<NanoValueT>())
+    {
+        MNRY_ASSERT_REQUIRE(mGrid);
+    }
+
+    ~TypedNanoVDBSampler() override {}
+
+    bool getIsActive(const uint32_t /*threadIdx*/,
+                     const openvdb::Vec3d& pos) override
+    {
+        const nanovdb::Vec3d p = mGrid->worldToIndex(nanovdb::Vec3d(pos.x(), pos.y(), pos.z()));
+        const nanovdb::Coord coord(int(p[0]), int(p[1]), int(p[2]));
+        return mGrid->getAccessor().isActive(coord);
+    }
+
+    ValueT sample(const uint32_t /*threadIdx*/, const openvdb::Vec3d& pos,
+                  Interpolation mode) const
+    {
+        const nanovdb::Vec3d p = mGrid->worldToIndex(nanovdb::Vec3d(pos.x(), pos.y(), pos.z()));
+        const auto accessor = mGrid->getAccessor();
+        switch (mode) {
+        case Interpolation::Box :
+            return toOpenVdb(nanovdb::createSampler<1>(accessor)(p));
+        case Interpolation::Quadratic :
+            return toOpenVdb(nanovdb::createSampler<2>(accessor)(p));
+        case Interpolation::Point :
+        default:
+            return toOpenVdb(nanovdb::createSampler<0>(accessor)(p));
+        }
+    }
+
+    const NanoGridT* getGrid() const { return mGrid; }
+
+    size_t getMemory() const { return mHandle.size(); }
+
+private:
+    static float toOpenVdb(float v) { return v; }
+    static openvdb::Vec3f toOpenVdb(const nanovdb::Vec3f& v) { return openvdb::Vec3f(v[0], v[1], v[2]); }
+
+    nanovdb::GridHandle<nanovdb::HostBuffer> mHandle;
+    const NanoGridT* mGrid;
+};
+
+} // namespace texture
+} // namespace moonray
+
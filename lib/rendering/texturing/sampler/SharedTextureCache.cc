@@ -0,0 +1,277 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file SharedTextureCache.cc
+///
+
+#include "SharedTextureCache.h"
+
+#include <scene_rdl2/render/logging/logging.h>
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef __APPLE__
+#include <sys/sendfile.h>
+#endif
+
+namespace moonray {
+namespace texture {
+
+using scene_rdl2::logging::Logger;
+
+namespace {
+
+const char *const sTmpSuffix = ".tmp";
+const char *const sLockSuffix = ".lock";
+
+bool
+endsWith(const std::string &str, const char *suffix)
+{
+    const size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+// Closes the file, which also releases the flock().
+class ScopedFd
+{
+public:
+    explicit ScopedFd(int fd) : mFd(fd) {}
+    ~ScopedFd() { if (mFd >= 0) close(mFd); }
+    int get() const { return mFd; }
+
+private:
+    int mFd;
+};
+
+} // namespace
+
+SharedTextureCache::SharedTextureCache() :
+    mMaxSize(0),
+    mNumHits(0),
+    mNumCopies(0),
+    mNumFallbacks(0)
+{
+}
+
+void
+SharedTextureCache::configure(const std::string &directory, size_t maxSizeMb)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (directory == mDirectory && maxSizeMb * size_t(1024 * 1024) == mMaxSize) {
+        return;
+    }
+
+    mDirectory = directory;
+    mMaxSize = maxSizeMb * size_t(1024 * 1024);
+    mResolved.clear();
+
+    if (mDirectory.empty()) {
+        return;
+    }
+
+    if (mkdir(mDirectory.c_str(), 0777) == -1 && errno != EEXIST) {
+        Logger::warn("Could not create shared texture cache directory '", mDirectory, "' ",
+                     strerror(errno), ", the shared texture cache is disabled");
+        mDirectory.clear();
+    }
+}
+
+std::string
+SharedTextureCache::resolve(const std::string &filename)
+{
+    if (!isEnabled()) {
+        return filename;
+    }
+
+    auto fallback = [&]() {
+        ++mNumFallbacks;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResolved[filename] = filename;
+        return filename;
+    };
+
+    // Processes may have been started from different directories.
+    char absName[PATH_MAX];
+    struct stat srcStat;
+    if (!realpath(filename.c_str(), absName) ||
+        stat(absName, &srcStat) == -1 || !S_ISREG(srcStat.st_mode)) {
+        return fallback();
+    }
+
+    // Key the copy by source path, size and modification time. The base name
+    // is kept so OIIO can still pick the image format from the extension.
+    std::ostringstream key;
+    key << absName << ':' << srcStat.st_size << ':'
+        << srcStat.st_mtim.tv_sec << '.' << srcStat.st_mtim.tv_nsec;
+    const char *baseName = strrchr(absName, '/');
+    baseName = baseName ? baseName + 1 : absName;
+
+    std::ostringstream cacheName;
+    cacheName << mDirectory << '/' << std::hex << std::setw(16) << std::setfill('0')
+              << std::hash<std::string>()(key.str()) << '_' << baseName;
+    const std::string dstName = cacheName.str();
+    const size_t srcSize = size_t(srcStat.st_size);
+
+    auto isCached = [&]() {
+        struct stat dstStat;
+        return stat(dstName.c_str(), &dstStat) == 0 && size_t(dstStat.st_size) == srcSize;
+    };
+
+    if (!isCached()) {
+        // Only one process copies a given texture, the others wait on the lock.
+        const std::string lockName = dstName + sLockSuffix;
+        ScopedFd lockFd(open(lockName.c_str(), O_RDWR | O_CREAT, 0666));
+        if (lockFd.get() < 0 || flock(lockFd.get(), LOCK_EX) == -1) {
+            Logger::warn("Could not lock shared texture cache file '", lockName, "' ", strerror(errno));
+            return fallback();
+        }
+
+        if (!isCached()) {
+            if (mMaxSize && getDirectorySize() + srcSize > mMaxSize) {
+                return fallback();
+            }
+
+            std::string errMsg;
+            if (!copyToCache(absName, srcSize, dstName, errMsg)) {
+                Logger::warn(errMsg);
+                return fallback();
+            }
+            ++mNumCopies;
+        } else {
+            ++mNumHits;
+        }
+    } else {
+        ++mNumHits;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResolved[filename] = dstName;
+    return dstName;
+}
+
+std::string
+SharedTextureCache::getResolved(const std::string &filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mResolved.find(filename);
+    return (it == mResolved.end()) ? filename : it->second;
+}
+
+std::string
+SharedTextureCache::showStats() const
+{
+    std::ostringstream ostr;
+    ostr << "SharedTextureCache {\n"
+         << "  mDirectory:" << mDirectory << '\n'
+         << "  mMaxSize:" << mMaxSize << '\n'
+         << "  mNumHits:" << mNumHits << '\n'
+         << "  mNumCopies:" << mNumCopies << '\n'
+         << "  mNumFallbacks:" << mNumFallbacks << '\n'
+         << "}";
+    return ostr.str();
+}
+
+bool
+SharedTextureCache::copyToCache(const std::string &srcName, size_t srcSize, const std::string &dstName,
+                                std::string &errMsg) const
+//
+// Copies srcName to a temporary file next to dstName and renames it into place
+// once complete. Other processes only ever see a missing or a complete copy.
+//
+{
+    ScopedFd srcFd(open(srcName.c_str(), O_RDONLY));
+    if (srcFd.get() < 0) {
+        errMsg = scene_rdl2::util::buildString("Could not open texture file '", srcName, "' ",
+                                               strerror(errno));
+        return false;
+    }
+
+    const std::string tmpName = dstName + '.' + std::to_string(getpid()) + sTmpSuffix;
+    bool copied = false;
+    {
+        ScopedFd dstFd(open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666));
+        if (dstFd.get() < 0) {
+            errMsg = scene_rdl2::util::buildString("Could not create shared texture cache file '",
+                                                   tmpName, "' ", strerror(errno));
+            return false;
+        }
+
+        size_t copiedSize = 0;
+        while (copiedSize < srcSize) {
+#ifdef __APPLE__
+            char buf[1 << 16];
+            ssize_t size = read(srcFd.get(), buf, sizeof(buf));
+            if (size > 0) {
+                size = write(dstFd.get(), buf, size_t(size));
+            }
+#else
+            ssize_t size = sendfile(dstFd.get(), srcFd.get(), nullptr, srcSize - copiedSize);
+#endif
+            if (size <= 0) {
+                break;
+            }
+            copiedSize += size_t(size);
+        }
+        copied = (copiedSize == srcSize);
+    }
+
+    if (!copied) {
+        errMsg = scene_rdl2::util::buildString("Failed to copy texture file '", srcName,
+                                               "' to the shared texture cache ", strerror(errno));
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    if (rename(tmpName.c_str(), dstName.c_str()) == -1) {
+        errMsg = scene_rdl2::util::buildString("Failed to rename from '", tmpName, "' to '",
+                                               dstName, "' ", strerror(errno));
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+size_t
+SharedTextureCache::getDirectorySize() const
+{
+    DIR *dir = opendir(mDirectory.c_str());
+    if (!dir) {
+        return 0;
+    }
+
+    size_t total = 0;
+    while (const struct dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name == "." || name == ".." || endsWith(name, sLockSuffix)) {
+            continue;
+        }
+
+        struct stat st;
+        const std::string path = mDirectory + '/' + name;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            total += size_t(st.st_size);
+        }
+    }
+    closedir(dir);
+
+    return total;
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
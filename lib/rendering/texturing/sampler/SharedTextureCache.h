@@ -0,0 +1,70 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file SharedTextureCache.h
+///
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace moonray {
+namespace texture {
+
+//
+// Node local copy of the texture files shared by all the render processes of
+// a node. Point it at a tmpfs directory such as /dev/shm so the processes
+// rendering the same shot read each texture over the network once, and share
+// the resident pages of the copy through the page cache.
+//
+// Copies are keyed by the source path, size and modification time, so an
+// edited texture gets a new copy. The first process needing a texture copies
+// it while holding an flock() on a per copy lock file, the other processes
+// wait for it and then reuse the copy. The copy is written to a temporary file
+// and renamed into place, so a copy which exists is always complete.
+//
+// Any failure, including the cache directory reaching its size budget, falls
+// back to the source file.
+//
+class SharedTextureCache
+{
+public:
+    SharedTextureCache();
+
+    // An empty directory disables the cache. maxSizeMb bounds the total size
+    // of the copies in the directory, 0 means unlimited.
+    void configure(const std::string &directory, size_t maxSizeMb);
+
+    bool isEnabled() const  { return !mDirectory.empty(); }
+
+    // Returns the path of the node local copy of filename, creating it if
+    // needed, or filename itself if the file can't be cached.
+    std::string resolve(const std::string &filename);
+
+    // Returns the path filename was last resolved to, or filename itself.
+    std::string getResolved(const std::string &filename) const;
+
+    std::string showStats() const;
+
+private:
+    bool copyToCache(const std::string &srcName, size_t srcSize, const std::string &dstName,
+                     std::string &errMsg) const;
+    size_t getDirectorySize() const;
+
+    std::string mDirectory;
+    size_t      mMaxSize;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, std::string> mResolved;
+
+    std::atomic<unsigned> mNumHits;
+    std::atomic<unsigned> mNumCopies;
+    std::atomic<unsigned> mNumFallbacks;
+};
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
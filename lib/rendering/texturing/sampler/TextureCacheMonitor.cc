@@ -0,0 +1,319 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TextureCacheMonitor.cc
+///
+
+#include "TextureCacheMonitor.h"
+
+#include <scene_rdl2/render/logging/logging.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace moonray {
+namespace texture {
+
+namespace {
+
+constexpr double sBytesPerMb = 1024.0 * 1024.0;
+
+// The cache counts as full once it holds this fraction of its size, OIIO
+// starts evicting a bit below the limit.
+constexpr double sFullFraction = 0.9;
+
+// Headroom of the recommended cache size over the working set, the working
+// set of later frames of a shot tends to vary a little.
+constexpr double sRecommendedHeadroom = 1.25;
+
+int64_t
+getFileStat(OIIO::TextureSystem *textureSystem, OIIO::ustring filename, const char *name)
+{
+    long long value = 0;
+    textureSystem->get_texture_info(filename, 0, OIIO::ustring(name), OIIO::TypeDesc::INT64, &value);
+    return static_cast<int64_t>(value);
+}
+
+int
+getFileStatInt(OIIO::TextureSystem *textureSystem, OIIO::ustring filename, const char *name)
+{
+    int value = 0;
+    textureSystem->get_texture_info(filename, 0, OIIO::ustring(name), OIIO::TypeDesc::INT, &value);
+    return value;
+}
+
+float
+getCacheSizeMb(OIIO::TextureSystem *textureSystem)
+{
+    float mb = 0.0f;
+    textureSystem->getattribute("max_memory_MB", mb);
+    return mb;
+}
+
+std::string
+showMipsUsed(unsigned mipsUsed)
+{
+    std::ostringstream ostr;
+    for (unsigned level = 0; level < 32; ++level) {
+        if (mipsUsed & (1u << level)) {
+            if (ostr.tellp() > 0) ostr << ',';
+            ostr << level;
+        }
+    }
+    return ostr.tellp() > 0 ? ostr.str() : "-";
+}
+
+} // namespace
+
+TextureCacheMonitor::TextureCacheMonitor() :
+    mAutoGrowLimitMb(0.0f),
+    mCurrentPassIdx(INT_MAX),
+    mRedundantBytesAtLastGrowCheck(0)
+{
+}
+
+void
+TextureCacheMonitor::startFrame(OIIO::TextureSystem *textureSystem)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPassStats.clear();
+    mPassStart = readCounters(textureSystem);
+    mRedundantBytesAtLastGrowCheck = 0;
+    mCurrentPassIdx.store(-1, std::memory_order_release);
+}
+
+void
+TextureCacheMonitor::endFrame(OIIO::TextureSystem *textureSystem)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCurrentPassIdx.load(std::memory_order_relaxed) >= 0 && !mPassStats.empty()) {
+        closePass(readCounters(textureSystem), textureSystem);
+    }
+    mCurrentPassIdx.store(INT_MAX, std::memory_order_release);
+}
+
+void
+TextureCacheMonitor::startPass(unsigned passIdx, OIIO::TextureSystem *textureSystem)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (int(passIdx) <= mCurrentPassIdx.load(std::memory_order_relaxed)) {
+        return; // another thread got here first
+    }
+
+    const Counters counters = readCounters(textureSystem);
+    if (!mPassStats.empty()) {
+        closePass(counters, textureSystem);
+    }
+
+    mPassStart = counters;
+    PassStats pass;
+    pass.mPassIdx = passIdx;
+    mPassStats.push_back(pass);
+    mCurrentPassIdx.store(int(passIdx), std::memory_order_release);
+}
+
+void
+TextureCacheMonitor::closePass(const Counters &counters, OIIO::TextureSystem *textureSystem)
+{
+    PassStats &pass = mPassStats.back();
+    pass.mTileLookups = counters.mTileLookups - mPassStart.mTileLookups;
+    pass.mTileMisses = counters.mTileMisses - mPassStart.mTileMisses;
+    pass.mBytesRead = counters.mBytesRead - mPassStart.mBytesRead;
+    pass.mGrown = maybeGrow(counters, textureSystem);
+    pass.mCacheSizeMb = getCacheSizeMb(textureSystem);
+}
+
+bool
+TextureCacheMonitor::maybeGrow(const Counters &counters, OIIO::TextureSystem *textureSystem)
+{
+    const float sizeMb = getCacheSizeMb(textureSystem);
+    if (mAutoGrowLimitMb <= sizeMb) {
+        return false;
+    }
+
+    // Nothing is evicted until the cache is full, which keeps the per file
+    // queries below to the cases which can thrash.
+    if (double(counters.mMemoryUsed) < sFullFraction * double(sizeMb) * sBytesPerMb) {
+        return false;
+    }
+
+    int64_t redundantBytes = 0;
+    for (const FileStats &file : getFileStats(textureSystem)) {
+        redundantBytes += file.mRedundantBytes;
+    }
+    const bool thrashing = redundantBytes > mRedundantBytesAtLastGrowCheck;
+    mRedundantBytesAtLastGrowCheck = redundantBytes;
+    if (!thrashing) {
+        return false;
+    }
+
+    float newSizeMb = std::min(2.0f * sizeMb, mAutoGrowLimitMb);
+    textureSystem->attribute("max_memory_MB", OIIO::TypeDesc::FLOAT, &newSizeMb);
+
+    std::ostringstream ostr;
+    ostr << "Texture cache is re-reading evicted tiles, growing it from "
+         << sizeMb << " MB to " << newSizeMb << " MB";
+    scene_rdl2::logging::Logger::info(ostr.str());
+    return true;
+}
+
+TextureCacheMonitor::Counters
+TextureCacheMonitor::readCounters(OIIO::TextureSystem *textureSystem)
+{
+    Counters counters;
+
+    long long lookups = 0;
+    long long bytesRead = 0;
+    long long memoryUsed = 0;
+    int misses = 0;
+    textureSystem->getattribute("stat:find_tile_calls", OIIO::TypeDesc::INT64, &lookups);
+    textureSystem->getattribute("stat:find_tile_cache_misses", OIIO::TypeDesc::INT, &misses);
+    textureSystem->getattribute("stat:bytes_read", OIIO::TypeDesc::INT64, &bytesRead);
+    textureSystem->getattribute("stat:cache_memory_used", OIIO::TypeDesc::INT64, &memoryUsed);
+
+    counters.mTileLookups = static_cast<int64_t>(lookups);
+    counters.mTileMisses = static_cast<int64_t>(misses);
+    counters.mBytesRead = static_cast<int64_t>(bytesRead);
+    counters.mMemoryUsed = static_cast<int64_t>(memoryUsed);
+    return counters;
+}
+
+std::vector<TextureCacheMonitor::FileStats>
+TextureCacheMonitor::getFileStats(OIIO::TextureSystem *textureSystem)
+{
+    int totalFiles = 0;
+    textureSystem->getattribute("total_files", totalFiles);
+    if (totalFiles <= 0) {
+        return {};
+    }
+
+    std::vector<OIIO::ustring> filenames(totalFiles);
+    textureSystem->getattribute("all_filenames", OIIO::TypeDesc(OIIO::TypeDesc::STRING, totalFiles),
+                                filenames.data());
+
+    std::vector<FileStats> fileStats;
+    fileStats.reserve(filenames.size());
+    for (const OIIO::ustring &filename : filenames) {
+        // The tiles of duplicate files are read through the file they
+        // duplicate, which gets the stats.
+        if (filename.empty() || getFileStatInt(textureSystem, filename, "stat:is_duplicate")) {
+            continue;
+        }
+
+        FileStats file;
+        file.mFilename = filename.string();
+        file.mTilesRead = getFileStat(textureSystem, filename, "stat:tilesread");
+        file.mBytesRead = getFileStat(textureSystem, filename, "stat:bytesread");
+        file.mRedundantTiles = getFileStat(textureSystem, filename, "stat:redundant_tiles");
+        file.mRedundantBytes = getFileStat(textureSystem, filename, "stat:redundant_bytesread");
+        file.mFileSize = getFileStat(textureSystem, filename, "stat:file_size");
+        file.mMipsUsed = static_cast<unsigned>(getFileStatInt(textureSystem, filename, "stat:mipsused"));
+        file.mTimesOpened = getFileStatInt(textureSystem, filename, "stat:timesopened");
+        textureSystem->get_texture_info(filename, 0, OIIO::ustring("stat:iotime"),
+                                        OIIO::TypeDesc::FLOAT, &file.mIoTime);
+        fileStats.push_back(std::move(file));
+    }
+    return fileStats;
+}
+
+float
+TextureCacheMonitor::getRecommendedCacheSizeMb(const std::vector<FileStats> &fileStats)
+{
+    int64_t workingSet = 0;
+    for (const FileStats &file : fileStats) {
+        workingSet += file.getWorkingSetBytes();
+    }
+    // Round up to a multiple of 64 MB.
+    const double mb = double(workingSet) * sRecommendedHeadroom / sBytesPerMb;
+    return static_cast<float>(std::ceil(mb / 64.0) * 64.0);
+}
+
+std::vector<TextureCacheMonitor::PassStats>
+TextureCacheMonitor::getPassStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPassStats;
+}
+
+void
+TextureCacheMonitor::getAnalysis(const std::string &prepend, std::ostream &outs,
+                                 OIIO::TextureSystem *textureSystem, size_t maxFiles) const
+{
+    std::vector<FileStats> files = getFileStats(textureSystem);
+    if (files.empty()) {
+        return;
+    }
+
+    int64_t workingSet = 0;
+    int64_t bytesRead = 0;
+    int64_t redundantBytes = 0;
+    int64_t redundantTiles = 0;
+    for (const FileStats &file : files) {
+        workingSet += file.getWorkingSetBytes();
+        bytesRead += file.mBytesRead;
+        redundantBytes += file.mRedundantBytes;
+        redundantTiles += file.mRedundantTiles;
+    }
+
+    const float cacheSizeMb = getCacheSizeMb(textureSystem);
+    const float recommendedMb = getRecommendedCacheSizeMb(files);
+
+    std::ostringstream ostr;
+    ostr << std::fixed << std::setprecision(1);
+
+    ostr << prepend << "Texture cache analysis\n"
+         << prepend << "  cache size          = " << cacheSizeMb << " MB\n"
+         << prepend << "  working set         = " << double(workingSet) / sBytesPerMb << " MB\n"
+         << prepend << "  read                = " << double(bytesRead) / sBytesPerMb << " MB\n"
+         << prepend << "  re-read (evicted)   = " << double(redundantBytes) / sBytesPerMb << " MB, "
+         << redundantTiles << " tiles\n";
+    if (redundantBytes > 0 && recommendedMb > cacheSizeMb) {
+        ostr << prepend << "  recommended size    = " << recommendedMb
+             << " MB, the cache is too small for the working set and re-reads evicted tiles\n";
+    } else {
+        ostr << prepend << "  recommended size    = " << cacheSizeMb << " MB, the cache holds the working set\n";
+    }
+
+    const std::vector<PassStats> passes = getPassStats();
+    if (!passes.empty()) {
+        ostr << prepend << "  pass  lookups       misses     miss%    MB read  cache MB\n";
+        for (const PassStats &pass : passes) {
+            const double missPercent = pass.mTileLookups > 0 ?
+                                       100.0 * double(pass.mTileMisses) / double(pass.mTileLookups) : 0.0;
+            ostr << prepend << "  " << std::setw(4) << pass.mPassIdx
+                 << std::setw(13) << pass.mTileLookups
+                 << std::setw(12) << pass.mTileMisses
+                 << std::setw(9) << missPercent
+                 << std::setw(11) << double(pass.mBytesRead) / sBytesPerMb
+                 << std::setw(10) << pass.mCacheSizeMb
+                 << (pass.mGrown ? "  grown" : "") << '\n';
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const FileStats &a, const FileStats &b) {
+        return a.mBytesRead > b.mBytesRead;
+    });
+    const size_t numFiles = std::min(files.size(), maxFiles);
+    ostr << prepend << "  top " << numFiles << " of " << files.size() << " files by bytes read:\n"
+         << prepend << "     tiles    MB read  re-read%  opens  I/O (s)  mips  file\n";
+    for (size_t i = 0; i < numFiles; ++i) {
+        const FileStats &file = files[i];
+        ostr << prepend << "  " << std::setw(8) << file.mTilesRead
+             << std::setw(11) << double(file.mBytesRead) / sBytesPerMb
+             << std::setw(10) << 100.0f * file.getRereadFraction()
+             << std::setw(7) << file.mTimesOpened
+             << std::setw(9) << file.mIoTime
+             << "  " << showMipsUsed(file.mMipsUsed)
+             << "  " << file.mFilename << '\n';
+    }
+
+    outs << ostr.str();
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
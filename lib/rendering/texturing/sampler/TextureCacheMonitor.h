@@ -0,0 +1,137 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file TextureCacheMonitor.h
+///
+#pragma once
+
+#include <scene_rdl2/common/platform/Platform.h>
+
+#include <OpenImageIO/texture.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moonray {
+namespace texture {
+
+//
+// Tracks how the OIIO tile cache behaves over a frame to diagnose cache
+// thrash: the counters of each render pass, the tiles and bytes each file
+// read, and an estimate of the working set the cache would need to hold.
+//
+// OIIO doesn't identify the tiles a lookup touched, so the working set is
+// estimated from the bytes read minus the bytes read again after their tile
+// got evicted (OIIO's "redundant" reads). With a cache large enough, nothing
+// is read twice and the two are equal.
+//
+// A pass spans from the first thread starting its tiles to the first thread
+// starting the tiles of the next pass, threads still finishing the previous
+// pass count towards the next one.
+//
+// When an auto grow limit is set, the cache size is doubled, up to the limit,
+// at the pass boundaries where the cache is full and tiles are being re-read.
+//
+class TextureCacheMonitor
+{
+public:
+    // Running totals of the image cache.
+    struct Counters
+    {
+        int64_t mTileLookups {0};   // find_tile calls
+        int64_t mTileMisses {0};    // lookups which had to read the tile
+        int64_t mBytesRead {0};     // bytes read from texture files
+        int64_t mMemoryUsed {0};    // bytes currently held by the tile cache
+    };
+
+    struct FileStats
+    {
+        std::string mFilename;
+        int64_t mTilesRead {0};
+        int64_t mBytesRead {0};
+        int64_t mRedundantTiles {0};    // tiles read again after eviction
+        int64_t mRedundantBytes {0};
+        int64_t mFileSize {0};
+        unsigned mMipsUsed {0};         // bit i set if mip level i was looked up
+        int mTimesOpened {0};
+        float mIoTime {0.0f};           // seconds
+
+        int64_t getWorkingSetBytes() const { return mBytesRead - mRedundantBytes; }
+        float getRereadFraction() const
+        {
+            return mTilesRead > 0 ? float(mRedundantTiles) / float(mTilesRead) : 0.0f;
+        }
+    };
+
+    struct PassStats
+    {
+        unsigned mPassIdx {0};
+        int64_t mTileLookups {0};
+        int64_t mTileMisses {0};
+        int64_t mBytesRead {0};
+        float mCacheSizeMb {0.0f};      // cache size at the end of the pass
+        bool mGrown {false};            // the cache was grown at the end of the pass
+    };
+
+    TextureCacheMonitor();
+
+    // 0 disables growing the cache.
+    void setAutoGrowLimitMb(float limitMb) { mAutoGrowLimitMb = limitMb; }
+    float getAutoGrowLimitMb() const { return mAutoGrowLimitMb; }
+
+    // Clears the pass stats of the previous frame. Call once the OIIO stats
+    // are reset.
+    void startFrame(OIIO::TextureSystem *textureSystem);
+
+    // Called by the render threads as they start the tiles of a pass, only
+    // the first call of each pass does any work.
+    finline void passStarted(unsigned passIdx, OIIO::TextureSystem *textureSystem)
+    {
+        if (int(passIdx) > mCurrentPassIdx.load(std::memory_order_relaxed)) {
+            startPass(passIdx, textureSystem);
+        }
+    }
+
+    // Closes the last pass of the frame.
+    void endFrame(OIIO::TextureSystem *textureSystem);
+
+    static Counters readCounters(OIIO::TextureSystem *textureSystem);
+
+    // Per file stats of all the files the cache opened since the stats were
+    // reset.
+    static std::vector<FileStats> getFileStats(OIIO::TextureSystem *textureSystem);
+
+    // Cache size which would hold the working set of the frame with some
+    // headroom, given the file stats.
+    static float getRecommendedCacheSizeMb(const std::vector<FileStats> &fileStats);
+
+    std::vector<PassStats> getPassStats() const;
+
+    // Human readable per file, per pass and working set report. Lists the
+    // maxFiles files which read the most bytes.
+    void getAnalysis(const std::string &prepend, std::ostream &outs,
+                     OIIO::TextureSystem *textureSystem, size_t maxFiles) const;
+
+private:
+    void startPass(unsigned passIdx, OIIO::TextureSystem *textureSystem);
+    void closePass(const Counters &counters, OIIO::TextureSystem *textureSystem);
+    bool maybeGrow(const Counters &counters, OIIO::TextureSystem *textureSystem);
+
+    float mAutoGrowLimitMb;
+
+    std::atomic<int> mCurrentPassIdx;   // -1 until the first pass starts
+
+    mutable std::mutex mMutex;
+    Counters mPassStart;
+    std::vector<PassStats> mPassStats;
+    int64_t mRedundantBytesAtLastGrowCheck;
+};
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
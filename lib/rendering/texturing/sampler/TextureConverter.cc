@@ -0,0 +1,264 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TextureConverter.cc
+///
+
+#include "TextureConverter.h"
+
+#include <scene_rdl2/render/logging/logging.h>
+#include <scene_rdl2/render/util/StrUtil.h>
+
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imageio.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moonray {
+namespace texture {
+
+using scene_rdl2::logging::Logger;
+
+namespace {
+
+const char *const sTmpSuffix = ".tmp";
+const char *const sLockSuffix = ".lock";
+const char *const sTxSuffix = ".tx";
+
+// Tile size of the converted files, the maketx default.
+constexpr int sTileSize = 64;
+
+bool
+endsWith(const std::string &str, const char *suffix)
+{
+    const size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+// Closes the file, which also releases the flock().
+class ScopedFd
+{
+public:
+    explicit ScopedFd(int fd) : mFd(fd) {}
+    ~ScopedFd() { if (mFd >= 0) close(mFd); }
+    int get() const { return mFd; }
+
+private:
+    int mFd;
+};
+
+} // namespace
+
+TextureConverter::TextureConverter() :
+    mNumHits(0),
+    mNumConversions(0),
+    mNumFallbacks(0),
+    mNumSkipped(0)
+{
+}
+
+void
+TextureConverter::configure(const std::string &directory)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (directory == mDirectory) {
+        return;
+    }
+
+    mDirectory = directory;
+    mResolved.clear();
+    mNoConversion.clear();
+
+    if (mDirectory.empty()) {
+        return;
+    }
+
+    if (mkdir(mDirectory.c_str(), 0777) == -1 && errno != EEXIST) {
+        Logger::warn("Could not create texture conversion directory '", mDirectory, "' ",
+                     strerror(errno), ", textures won't be converted");
+        mDirectory.clear();
+    }
+}
+
+std::string
+TextureConverter::resolve(const std::string &filename)
+{
+    if (!isEnabled()) {
+        return filename;
+    }
+
+    auto keepSource = [&](std::atomic<unsigned> &counter) {
+        ++counter;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResolved[filename] = filename;
+        return filename;
+    };
+
+    // .tx files are written by maketx, which always tiles and mipmaps, skip
+    // opening them.
+    char absName[PATH_MAX];
+    struct stat srcStat;
+    if (endsWith(filename, sTxSuffix) || !realpath(filename.c_str(), absName) ||
+        stat(absName, &srcStat) == -1 || !S_ISREG(srcStat.st_mode)) {
+        return keepSource(mNumSkipped);
+    }
+
+    // Same key as the shared texture cache: source path, size and modification
+    // time.
+    std::ostringstream key;
+    key << absName << ':' << srcStat.st_size << ':'
+        << srcStat.st_mtim.tv_sec << '.' << srcStat.st_mtim.tv_nsec;
+
+    // Don't open the same tiled and mipmapped file again for every map using it.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mNoConversion.count(key.str())) {
+            mResolved[filename] = filename;
+            ++mNumSkipped;
+            return filename;
+        }
+    }
+
+    const char *baseName = strrchr(absName, '/');
+    baseName = baseName ? baseName + 1 : absName;
+
+    std::ostringstream cacheName;
+    cacheName << mDirectory << '/' << std::hex << std::setw(16) << std::setfill('0')
+              << std::hash<std::string>()(key.str()) << '_' << baseName << sTxSuffix;
+    const std::string dstName = cacheName.str();
+
+    auto isConverted = [&]() {
+        struct stat dstStat;
+        return stat(dstName.c_str(), &dstStat) == 0;
+    };
+
+    if (!isConverted() && !needsConversion(absName)) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mNoConversion.insert(key.str());
+        }
+        return keepSource(mNumSkipped);
+    }
+
+    if (!isConverted()) {
+        // Only one process converts a given texture, the others wait on the lock.
+        const std::string lockName = dstName + sLockSuffix;
+        ScopedFd lockFd(open(lockName.c_str(), O_RDWR | O_CREAT, 0666));
+        if (lockFd.get() < 0 || flock(lockFd.get(), LOCK_EX) == -1) {
+            Logger::warn("Could not lock texture conversion file '", lockName, "' ", strerror(errno));
+            return keepSource(mNumFallbacks);
+        }
+
+        if (!isConverted()) {
+            std::string errMsg;
+            if (!convert(absName, dstName, errMsg)) {
+                Logger::warn(errMsg);
+                return keepSource(mNumFallbacks);
+            }
+            Logger::info("Converted untiled or unmipped texture '", filename, "' to '", dstName, "'");
+            ++mNumConversions;
+        } else {
+            ++mNumHits;
+        }
+    } else {
+        ++mNumHits;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResolved[filename] = dstName;
+    return dstName;
+}
+
+std::string
+TextureConverter::getResolved(const std::string &filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mResolved.find(filename);
+    return (it == mResolved.end()) ? filename : it->second;
+}
+
+std::string
+TextureConverter::showStats() const
+{
+    std::ostringstream ostr;
+    ostr << "TextureConverter {\n"
+         << "  mDirectory:" << mDirectory << '\n'
+         << "  mNumHits:" << mNumHits << '\n'
+         << "  mNumConversions:" << mNumConversions << '\n'
+         << "  mNumFallbacks:" << mNumFallbacks << '\n'
+         << "  mNumSkipped:" << mNumSkipped << '\n'
+         << "}";
+    return ostr.str();
+}
+
+bool
+TextureConverter::needsConversion(const std::string &filename) const
+//
+// Only reads the header. Files OIIO can't open are left to the texture system,
+// which reports the error.
+//
+{
+    auto in = OIIO::ImageInput::open(filename);
+    if (!in) {
+        OIIO::geterror(); // clear it
+        return false;
+    }
+
+    const OIIO::ImageSpec &spec = in->spec();
+    const bool tiled = spec.tile_width > 0;
+    const bool singleTexel = spec.width <= 1 && spec.height <= 1;
+    const bool mipmapped = singleTexel || in->seek_subimage(0, 1);
+    in->close();
+    return !tiled || !mipmapped;
+}
+
+bool
+TextureConverter::convert(const std::string &srcName, const std::string &dstName, std::string &errMsg) const
+//
+// Writes the .tx file to a temporary file next to dstName and renames it into
+// place once complete. Other processes only ever see a missing or a complete
+// file.
+//
+{
+    const std::string tmpName = dstName + '.' + std::to_string(getpid()) + sTmpSuffix;
+
+    OIIO::ImageSpec config;
+    config.tile_width = sTileSize;
+    config.tile_height = sTileSize;
+    config.tile_depth = 1;
+    // The temporary name has no extension to pick the format from.
+    config.attribute("maketx:fileformatname", "tiff");
+
+    std::ostringstream log;
+    if (!OIIO::ImageBufAlgo::make_texture(OIIO::ImageBufAlgo::MakeTxTexture, srcName, tmpName, config, &log)) {
+        errMsg = scene_rdl2::util::buildString("Failed to convert texture file '", srcName, "' to '",
+                                               dstName, "' ", OIIO::geterror(), ' ', log.str());
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    if (rename(tmpName.c_str(), dstName.c_str()) == -1) {
+        errMsg = scene_rdl2::util::buildString("Failed to rename from '", tmpName, "' to '",
+                                               dstName, "' ", strerror(errno));
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
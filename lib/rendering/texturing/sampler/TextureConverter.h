@@ -0,0 +1,72 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file TextureConverter.h
+///
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace moonray {
+namespace texture {
+
+//
+// Converts the texture files which aren't tiled or aren't mipmapped to tiled,
+// mipmapped .tx files in a cache directory, the way maketx would, and
+// redirects the lookups to the converted files. The texture system rejects
+// untiled and unmipped files, so without the conversion such textures fail to
+// load.
+//
+// Conversions are keyed by the source path, size and modification time, so an
+// edited texture gets converted again, and are shared by all the processes
+// using the directory: the first process needing a texture converts it while
+// holding an flock() on a per file lock file, the others wait for it, later
+// processes and frames just open the converted file. Conversions of different
+// files run in parallel on the threads loading the textures.
+//
+// Any failure falls back to the source file.
+//
+class TextureConverter
+{
+public:
+    TextureConverter();
+
+    // An empty directory disables the conversion.
+    void configure(const std::string &directory);
+
+    bool isEnabled() const  { return !mDirectory.empty(); }
+
+    // Returns the path of the converted copy of filename, converting it if
+    // needed, or filename itself if it needs no conversion or can't be
+    // converted.
+    std::string resolve(const std::string &filename);
+
+    // Returns the path filename was last resolved to, or filename itself.
+    std::string getResolved(const std::string &filename) const;
+
+    std::string showStats() const;
+
+private:
+    bool needsConversion(const std::string &filename) const;
+    bool convert(const std::string &srcName, const std::string &dstName, std::string &errMsg) const;
+
+    std::string mDirectory;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, std::string> mResolved;
+    std::unordered_set<std::string> mNoConversion;  // keys of the files which are fine as they are
+
+    std::atomic<unsigned> mNumHits;
+    std::atomic<unsigned> mNumConversions;
+    std::atomic<unsigned> mNumFallbacks;
+    std::atomic<unsigned> mNumSkipped;
+};
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
@@ -0,0 +1,277 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TextureDeduplicator.cc
+///
+
+#include "TextureDeduplicator.h"
+
+#include <scene_rdl2/render/logging/logging.h>
+
+#include <OpenImageIO/hash.h>
+#include <OpenImageIO/imageio.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moonray {
+namespace texture {
+
+using scene_rdl2::logging::Logger;
+
+namespace {
+
+constexpr size_t sReadSize = 1 << 20;
+
+} // namespace
+
+TextureDeduplicator::TextureDeduplicator() :
+    mEnabled(false),
+    mNumFiles(0),
+    mNumAliases(0),
+    mNumHashed(0),
+    mAliasBytes(0),
+    mHashedBytes(0)
+{
+}
+
+void
+TextureDeduplicator::configure(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (enabled != mEnabled) {
+        mEnabled = enabled;
+        clear();
+    }
+}
+
+std::string
+TextureDeduplicator::resolve(const std::string &filename)
+{
+    if (!isEnabled()) {
+        return filename;
+    }
+
+    auto setResolved = [&](const std::string &resolvedName) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResolved[filename] = resolvedName;
+        return resolvedName;
+    };
+
+    char absName[PATH_MAX];
+    struct stat srcStat;
+    if (!realpath(filename.c_str(), absName) || stat(absName, &srcStat) == -1 ||
+        !S_ISREG(srcStat.st_mode)) {
+        return setResolved(filename);
+    }
+    const size_t size = srcStat.st_size;
+
+    std::ostringstream fileKey;
+    fileKey << absName << ':' << size << ':'
+            << srcStat.st_mtim.tv_sec << '.' << srcStat.st_mtim.tv_nsec;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mResolvedFiles.find(fileKey.str());
+        if (it != mResolvedFiles.end()) {
+            mResolved[filename] = it->second;
+            return it->second;
+        }
+    }
+    ++mNumFiles;
+
+    std::string headerKey;
+    if (!getHeaderKey(absName, size, headerKey)) {
+        return setResolved(filename);
+    }
+
+    // Hash the contents of the group on first need, outside the lock: this
+    // file's and those of the files which were alone in the group so far.
+    std::vector<std::string> toHash;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<Candidate> &group = mGroups[headerKey];
+        if (group.empty()) {
+            group.push_back(Candidate {filename, absName, std::string()});
+            mResolvedFiles[fileKey.str()] = filename;
+            mResolved[filename] = filename;
+            return filename;
+        }
+        for (Candidate &candidate : group) {
+            if (candidate.mAbsName == absName) {
+                // Edited in place, its content is hashed again when needed.
+                candidate.mHash.clear();
+                mResolvedFiles[fileKey.str()] = candidate.mName;
+                mResolved[filename] = candidate.mName;
+                return candidate.mName;
+            }
+            if (candidate.mHash.empty()) {
+                toHash.push_back(candidate.mAbsName);
+            }
+        }
+    }
+    toHash.push_back(absName);
+
+    std::vector<std::string> hashes(toHash.size());
+    for (size_t i = 0; i < toHash.size(); ++i) {
+        if (!hashFile(toHash[i], hashes[i])) {
+            hashes[i].clear();
+        }
+    }
+    const std::string &hash = hashes.back();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<Candidate> &group = mGroups[headerKey];
+    for (Candidate &candidate : group) {
+        for (size_t i = 0; i + 1 < toHash.size(); ++i) {
+            if (candidate.mAbsName == toHash[i] && candidate.mHash.empty()) {
+                candidate.mHash = hashes[i];
+            }
+        }
+    }
+
+    std::string resolvedName = filename;
+    if (!hash.empty()) {
+        bool found = false;
+        for (const Candidate &candidate : group) {
+            if (candidate.mHash == hash) {
+                resolvedName = candidate.mName;
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            ++mNumAliases;
+            mAliasBytes += size;
+            Logger::info("Texture '", filename, "' has the same content as '", resolvedName,
+                         "', using the latter");
+        } else {
+            group.push_back(Candidate {filename, absName, hash});
+        }
+    }
+    mResolvedFiles[fileKey.str()] = resolvedName;
+    mResolved[filename] = resolvedName;
+    return resolvedName;
+}
+
+std::string
+TextureDeduplicator::getResolved(const std::string &filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mResolved.find(filename);
+    return (it == mResolved.end()) ? filename : it->second;
+}
+
+void
+TextureDeduplicator::invalidate(const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto resolvedIt = mResolved.find(filename);
+    if (resolvedIt == mResolved.end()) {
+        return;
+    }
+    const std::string resolvedName = resolvedIt->second;
+
+    auto eraseIf = [](std::unordered_map<std::string, std::string> &map, const std::string &name) {
+        for (auto it = map.begin(); it != map.end(); ) {
+            it = (it->second == name) ? map.erase(it) : std::next(it);
+        }
+    };
+    eraseIf(mResolved, resolvedName);
+    eraseIf(mResolvedFiles, resolvedName);
+    for (auto &group : mGroups) {
+        for (auto it = group.second.begin(); it != group.second.end(); ) {
+            it = (it->mName == resolvedName) ? group.second.erase(it) : std::next(it);
+        }
+    }
+}
+
+std::string
+TextureDeduplicator::showStats() const
+{
+    std::ostringstream ostr;
+    ostr << "TextureDeduplicator {\n"
+         << "  mNumFiles:" << mNumFiles << '\n'
+         << "  mNumAliases:" << mNumAliases << '\n'
+         << "  mNumHashed:" << mNumHashed << '\n'
+         << "  aliasMB:" << (mAliasBytes / (1024.0 * 1024.0)) << '\n'
+         << "  hashedMB:" << (mHashedBytes / (1024.0 * 1024.0)) << '\n'
+         << "}";
+    return ostr.str();
+}
+
+bool
+TextureDeduplicator::getHeaderKey(const std::string &absName, size_t size, std::string &key) const
+{
+    auto in = OIIO::ImageInput::open(absName);
+    if (!in) {
+        OIIO::geterror(); // clear it, the texture system reports it
+        return false;
+    }
+
+    std::ostringstream ostr;
+    ostr << size;
+    for (int subimage = 0; in->seek_subimage(subimage, 0); ++subimage) {
+        int numMipLevels = 1;
+        while (in->seek_subimage(subimage, numMipLevels)) {
+            ++numMipLevels;
+        }
+        in->seek_subimage(subimage, 0);
+        const OIIO::ImageSpec &spec = in->spec();
+        ostr << '|' << spec.width << 'x' << spec.height << 'x' << spec.depth
+             << ':' << spec.nchannels << ':' << spec.format.c_str()
+             << ':' << spec.tile_width << 'x' << spec.tile_height << 'x' << spec.tile_depth
+             << ':' << numMipLevels << ':' << spec.get_string_attribute("oiio:SHA-1");
+    }
+    in->close();
+
+    key = ostr.str();
+    return true;
+}
+
+bool
+TextureDeduplicator::hashFile(const std::string &absName, std::string &hash)
+{
+    const int fd = open(absName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    OIIO::SHA1 sha;
+    std::unique_ptr<char[]> buffer(new char[sReadSize]);
+    size_t total = 0;
+    ssize_t n;
+    while ((n = read(fd, buffer.get(), sReadSize)) > 0) {
+        sha.append(buffer.get(), n);
+        total += n;
+    }
+    close(fd);
+    if (n < 0) {
+        Logger::warn("Could not read texture '", absName, "' to deduplicate it");
+        return false;
+    }
+
+    ++mNumHashed;
+    mHashedBytes += total;
+    hash = sha.digest();
+    return true;
+}
+
+void
+TextureDeduplicator::clear()
+{
+    mResolved.clear();
+    mResolvedFiles.clear();
+    mGroups.clear();
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
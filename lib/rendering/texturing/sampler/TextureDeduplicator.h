@@ -0,0 +1,83 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file TextureDeduplicator.h
+///
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moonray {
+namespace texture {
+
+//
+// Maps texture files with the same content to a single one of them, so the
+// copies of a texture published under several paths (versioned publishes,
+// copies across shows) are opened, cached and read once by the texture system.
+//
+// Files are first grouped by size and by a fingerprint of their header:
+// resolution, channels, pixel format, tiling, subimages, mip levels and the
+// SHA-1 of the pixels maketx writes. Only the files sharing a group with
+// another file get their whole content hashed, so a texture without any
+// alias is never read here. Files are keyed by path, size and modification
+// time, so an edited texture is examined again.
+//
+// Any failure keeps the file as it is.
+//
+class TextureDeduplicator
+{
+public:
+    TextureDeduplicator();
+
+    void configure(bool enabled);
+
+    bool isEnabled() const  { return mEnabled; }
+
+    // Returns the first file seen with the same content as filename, or
+    // filename itself.
+    std::string resolve(const std::string &filename);
+
+    // Returns the path filename was last resolved to, or filename itself.
+    std::string getResolved(const std::string &filename) const;
+
+    // Forgets filename and every file resolved to it, its content may have
+    // changed.
+    void invalidate(const std::string &filename);
+
+    std::string showStats() const;
+
+private:
+    struct Candidate
+    {
+        std::string mName;      // as first requested
+        std::string mAbsName;
+        std::string mHash;      // content hash, empty until needed
+    };
+
+    bool getHeaderKey(const std::string &absName, size_t size, std::string &key) const;
+    bool hashFile(const std::string &absName, std::string &hash);
+    void clear();
+
+    bool mEnabled;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, std::string> mResolved;      // filename -> resolved name
+    std::unordered_map<std::string, std::string> mResolvedFiles;  // path:size:mtime -> resolved name
+    std::unordered_map<std::string, std::vector<Candidate>> mGroups; // header key -> distinct contents
+
+    std::atomic<unsigned> mNumFiles;
+    std::atomic<unsigned> mNumAliases;
+    std::atomic<unsigned> mNumHashed;
+    std::atomic<uint64_t> mAliasBytes;
+    std::atomic<uint64_t> mHashedBytes;
+};
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
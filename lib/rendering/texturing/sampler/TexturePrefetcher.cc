@@ -0,0 +1,226 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TexturePrefetcher.cc
+///
+
+#include "TexturePrefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace moonray {
+namespace texture {
+
+namespace {
+
+constexpr int      sCellBits = 6;
+constexpr int      sNumCells = 1 << sCellBits;
+constexpr uint32_t sCellMask = sNumCells - 1;
+constexpr int      sMaxWidthLevel = 31;
+
+// Bounds the memory used to record footprints, footprints past this are
+// dropped, the corresponding tiles simply won't be prefetched.
+constexpr size_t sMaxFootprintsPerThread = 1 << 16;
+
+finline uint32_t
+toCell(float x)
+{
+    x -= std::floor(x); // periodic wrap
+    return std::min(uint32_t(x * float(sNumCells)), sCellMask);
+}
+
+} // namespace
+
+TexturePrefetcher::TexturePrefetcher() :
+    mNumThreads(0),
+    mRecording(false),
+    mPrefetchStarted(false),
+    mCanceled(false),
+    mNextFootprint(0),
+    mNumPrefetched(0),
+    mNumTexels(0)
+{
+}
+
+TexturePrefetcher::~TexturePrefetcher()
+{
+    stop();
+}
+
+void
+TexturePrefetcher::startRecording()
+{
+    stop();
+
+    if (!mNumThreads) {
+        return;
+    }
+
+    for (ThreadFootprints &footprints : mThreadFootprints) {
+        footprints.mFootprints.clear();
+    }
+    mFootprints.clear();
+    mMergeOnce.reset(new std::once_flag);
+    mNextFootprint = 0;
+    mNumPrefetched = 0;
+    mNumTexels = 0;
+    mCanceled = false;
+    mPrefetchStarted = false;
+    mRecording = true;
+}
+
+void
+TexturePrefetcher::recordFootprint(const TextureHandle *handle, float s, float t, const float *derivatives)
+{
+    if (!handle) {
+        return;
+    }
+
+    const float width = std::max(std::max(std::abs(derivatives[0]), std::abs(derivatives[1])),
+                                 std::max(std::abs(derivatives[2]), std::abs(derivatives[3])));
+
+    // The filter covers about 2^-widthLevel of the texture.
+    const int widthLevel = (width > 0.0f) ? std::min(std::max(-std::ilogb(width), 0), sMaxWidthLevel) :
+                                            sMaxWidthLevel;
+
+    const Footprint footprint = { handle,
+                                  uint32_t(widthLevel) << (2 * sCellBits) |
+                                  toCell(t) << sCellBits | toCell(s) };
+
+    ThreadFootprints &footprints = mThreadFootprints.local();
+    tbb::spin_mutex::scoped_lock lock(footprints.mMutex);
+    if (footprints.mFootprints.size() < sMaxFootprintsPerThread) {
+        footprints.mFootprints.insert(footprint);
+    }
+}
+
+void
+TexturePrefetcher::startPrefetch(OIIO::TextureSystem *textureSystem)
+{
+    if (!mRecording.load(std::memory_order_relaxed) || mPrefetchStarted.exchange(true)) {
+        return;
+    }
+    mRecording = false;
+
+    MNRY_ASSERT(mThreads.empty());
+    for (unsigned i = 0; i < mNumThreads; ++i) {
+        mThreads.emplace_back(&TexturePrefetcher::prefetchThreadMain, this, textureSystem);
+    }
+}
+
+void
+TexturePrefetcher::stop()
+{
+    mRecording = false;
+    mCanceled = true;
+    for (std::thread &thread : mThreads) {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+void
+TexturePrefetcher::mergeFootprints()
+{
+    FootprintSet merged;
+    for (ThreadFootprints &footprints : mThreadFootprints) {
+        tbb::spin_mutex::scoped_lock lock(footprints.mMutex);
+        merged.insert(footprints.mFootprints.begin(), footprints.mFootprints.end());
+    }
+
+    mFootprints.assign(merged.begin(), merged.end());
+
+    // Coarse mip levels first, their tiles cover the most lookups.
+    std::sort(mFootprints.begin(), mFootprints.end(), [](const Footprint &a, const Footprint &b) {
+        return (a.mCell >> (2 * sCellBits)) != (b.mCell >> (2 * sCellBits)) ?
+            (a.mCell >> (2 * sCellBits)) < (b.mCell >> (2 * sCellBits)) :
+            (a.mHandle != b.mHandle ? a.mHandle < b.mHandle : a.mCell < b.mCell);
+    });
+}
+
+void
+TexturePrefetcher::prefetchThreadMain(OIIO::TextureSystem *textureSystem)
+{
+    std::call_once(*mMergeOnce, &TexturePrefetcher::mergeFootprints, this);
+
+    std::vector<float> buffer;
+    while (!mCanceled.load(std::memory_order_relaxed)) {
+        const size_t idx = mNextFootprint++;
+        if (idx >= mFootprints.size()) {
+            break;
+        }
+        prefetch(textureSystem, mFootprints[idx], buffer);
+        ++mNumPrefetched;
+        mNumTexels += buffer.size();
+    }
+}
+
+void
+TexturePrefetcher::prefetch(OIIO::TextureSystem *textureSystem, const Footprint &footprint,
+                            std::vector<float> &buffer)
+//
+// Reads the texels of the footprint region at the mip level OIIO would pick
+// for lookups of the recorded filter width, which pulls their tiles into the
+// tile cache.
+//
+{
+    buffer.clear();
+
+    TextureHandle *handle = const_cast<TextureHandle *>(footprint.mHandle);
+    TextureSystem::Perthread *perThread = textureSystem->get_perthread_info();
+    const OIIO::ImageSpec *spec = textureSystem->imagespec(handle, perThread);
+    if (!spec || spec->width <= 0 || spec->height <= 0) {
+        return;
+    }
+
+    int numMipLevels = 1;
+    textureSystem->get_texture_info(handle, perThread, 0, OIIO::ustring("miplevels"),
+                                    OIIO::TypeDesc::TypeInt, &numMipLevels);
+
+    const int widthLevel = int(footprint.mCell >> (2 * sCellBits));
+    const int mipLevel = std::min(std::max(std::ilogb(std::max(spec->width, spec->height)) - widthLevel, 0),
+                                  std::max(numMipLevels - 1, 0));
+
+    const int width = std::max(spec->width >> mipLevel, 1);
+    const int height = std::max(spec->height >> mipLevel, 1);
+    const int cellX = int(footprint.mCell & sCellMask);
+    const int cellY = int((footprint.mCell >> sCellBits) & sCellMask);
+
+    const int xBegin = cellX * width / sNumCells;
+    const int xEnd = std::max((cellX + 1) * width / sNumCells, xBegin + 1);
+    const int yBegin = cellY * height / sNumCells;
+    const int yEnd = std::max((cellY + 1) * height / sNumCells, yBegin + 1);
+
+    // A single channel is enough, tiles hold all the channels.
+    buffer.resize(size_t(xEnd - xBegin) * size_t(yEnd - yBegin));
+
+    OIIO::TextureOpt options;
+    if (!textureSystem->get_texels(handle, perThread, options, mipLevel,
+                                   spec->x + xBegin, spec->x + xEnd, spec->y + yBegin, spec->y + yEnd,
+                                   0, 1, 0, 1, OIIO::TypeDesc::FLOAT, buffer.data())) {
+        // Errors are reported by the render threads looking the texture up,
+        // just clear the error state of this thread.
+        textureSystem->geterror();
+        buffer.clear();
+    }
+}
+
+std::string
+TexturePrefetcher::showStats() const
+{
+    std::ostringstream ostr;
+    ostr << "TexturePrefetcher {\n"
+         << "  mNumThreads:" << mNumThreads << '\n'
+         << "  footprints:" << mFootprints.size() << '\n'
+         << "  mNumPrefetched:" << mNumPrefetched << '\n'
+         << "  mNumTexels:" << mNumTexels << '\n'
+         << "}";
+    return ostr.str();
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
@@ -0,0 +1,125 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file TexturePrefetcher.h
+///
+#pragma once
+#include "TextureTLState.h"
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/spin_mutex.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace moonray {
+namespace texture {
+
+//
+// Records which texture regions and mip levels the early passes of a frame
+// touch, then loads the tiles of those regions on a few background threads
+// while the remaining passes render. The render threads then mostly find the
+// tiles they need in the OIIO tile cache instead of stalling on file reads.
+//
+// A footprint is a cell of a 64x64 grid over the [0, 1] texture space plus the
+// log2 of the lookup filter width, from which the prefetch threads work out
+// the mip level OIIO will pick for lookups of that width.
+//
+class TexturePrefetcher
+{
+public:
+    typedef OIIO::TextureSystem::TextureHandle TextureHandle;
+
+    TexturePrefetcher();
+    ~TexturePrefetcher();
+
+    // 0 threads disables the prefetcher.
+    void setNumThreads(unsigned numThreads)     { mNumThreads = numThreads; }
+    unsigned getNumThreads() const              { return mNumThreads; }
+
+    // Clears the footprints of the previous frame and starts recording.
+    void startRecording();
+
+    // Records a texture lookup, st and the 4 filter derivatives as passed to
+    // OIIO::TextureSystem::texture().
+    finline void record(const TextureHandle *handle, float s, float t, const float *derivatives)
+    {
+        if (mRecording.load(std::memory_order_relaxed)) {
+            recordFootprint(handle, s, t, derivatives);
+        }
+    }
+
+    // Stops recording and prefetches the recorded footprints in the
+    // background. Only the first call of a frame has any effect.
+    void startPrefetch(OIIO::TextureSystem *textureSystem);
+
+    // Stops recording, cancels any pending prefetch and waits for the prefetch
+    // threads to exit.
+    void stop();
+
+    std::string showStats() const;
+
+private:
+    struct Footprint
+    {
+        bool operator==(const Footprint &other) const
+        {
+            return mHandle == other.mHandle && mCell == other.mCell;
+        }
+
+        const TextureHandle *mHandle;
+        uint32_t mCell;     // filter width level << 12 | t cell << 6 | s cell
+    };
+
+    struct FootprintHash
+    {
+        size_t operator()(const Footprint &f) const
+        {
+            return std::hash<const void *>()(f.mHandle) ^ (size_t(f.mCell) * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    typedef std::unordered_set<Footprint, FootprintHash> FootprintSet;
+
+    // The lock is only contended while the footprints are merged.
+    struct ThreadFootprints
+    {
+        tbb::spin_mutex mMutex;
+        FootprintSet mFootprints;
+    };
+
+    void recordFootprint(const TextureHandle *handle, float s, float t, const float *derivatives);
+    void mergeFootprints();
+    void prefetchThreadMain(OIIO::TextureSystem *textureSystem);
+    static void prefetch(OIIO::TextureSystem *textureSystem, const Footprint &footprint,
+                         std::vector<float> &buffer);
+
+    unsigned mNumThreads;
+
+    std::atomic<bool> mRecording;
+    std::atomic<bool> mPrefetchStarted;
+    std::atomic<bool> mCanceled;
+
+    // Per thread footprints, merged when the prefetch starts.
+    tbb::enumerable_thread_specific<ThreadFootprints, tbb::cache_aligned_allocator<ThreadFootprints>,
+                                    tbb::ets_key_per_instance> mThreadFootprints;
+
+    // Merged and sorted by the first prefetch thread.
+    std::unique_ptr<std::once_flag> mMergeOnce;
+    std::vector<Footprint> mFootprints;
+    std::atomic<size_t> mNextFootprint;
+    std::vector<std::thread> mThreads;
+
+    std::atomic<uint64_t> mNumPrefetched;
+    std::atomic<uint64_t> mNumTexels;
+};
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
@@ -76,6 +76,8 @@ TextureSampler::TextureSampler()
 
 TextureSampler::~TextureSampler()
 {
+    // The prefetch threads use the texture system.
+    mPrefetcher.stop();
     OIIO::TextureSystem::destroy(mTextureSystem, false);
 }
 
@@ -87,7 +89,15 @@ TextureSampler::getHandle(const std::string& fileName,
     MNRY_ASSERT(mTextureSystem);
     MNRY_ASSERT(perThread == mTextureSystem->get_perthread_info());
 
-    OIIO::ustring file = static_cast<OIIO::ustring>(fileName);
+    // Aliases of a file are converted and cached as that file. Converted
+    // files already live in a cache directory, only the others go through the
+    // shared cache.
+    const std::string sourceName = mDeduplicator.isEnabled() ? mDeduplicator.resolve(fileName) : fileName;
+    std::string resolvedName = mConverter.isEnabled() ? mConverter.resolve(sourceName) : sourceName;
+    if (mSharedCache.isEnabled() && resolvedName == sourceName) {
+        resolvedName = mSharedCache.resolve(sourceName);
+    }
+    OIIO::ustring file = static_cast<OIIO::ustring>(resolvedName);
 
     // Note: The OIIO api doesn't seem to provide a way to close a texture
     //       handle. It appears all handles are kept open until the OIIO texture
@@ -340,6 +350,18 @@ TextureSampler::getMainCacheMissFraction() const
     return f / 100.0f; // return fraction
 }
 
+TextureSampler::CacheCounters
+TextureSampler::getCacheCounters() const
+{
+    return TextureCacheMonitor::readCounters(mTextureSystem);
+}
+
+void
+TextureSampler::getCacheAnalysis(const std::string& prepend, std::ostream& outs, bool verbose) const
+{
+    mCacheMonitor.getAnalysis(prepend, outs, mTextureSystem, verbose ? 50 : 10);
+}
+
 void
 TextureSampler::getMainCacheInfo(const std::string& prepend, std::ostream& outs) const
 {
@@ -401,8 +423,20 @@ TextureSampler::showStats(int level, bool icstats) const
 
     std::ostringstream ostr;
     ostr << "textureSampler stats {\n"
-         << addIndent(rmLastNL(mTextureSystem->getstats(std::min(std::max(level, 1), 5), icstats))) << '\n'
-         << "}";
+         << addIndent(rmLastNL(mTextureSystem->getstats(std::min(std::max(level, 1), 5), icstats))) << '\n';
+    if (mSharedCache.isEnabled()) {
+        ostr << addIndent(mSharedCache.showStats()) << '\n';
+    }
+    if (mConverter.isEnabled()) {
+        ostr << addIndent(mConverter.showStats()) << '\n';
+    }
+    if (mDeduplicator.isEnabled()) {
+        ostr << addIndent(mDeduplicator.showStats()) << '\n';
+    }
+    if (mPrefetcher.getNumThreads()) {
+        ostr << addIndent(mPrefetcher.showStats()) << '\n';
+    }
+    ostr << "}";
     return ostr.str();
 }
 
@@ -426,6 +460,24 @@ TextureSampler::setOpenFileLimit(int count)
     mTextureSystem->attribute("max_open_files", OIIO::TypeDesc::INT, &count);
 }
 
+void
+TextureSampler::setSharedCache(const std::string &directory, size_t maxSizeMb)
+{
+    mSharedCache.configure(directory, maxSizeMb);
+}
+
+void
+TextureSampler::setConversionCache(const std::string &directory)
+{
+    mConverter.configure(directory);
+}
+
+void
+TextureSampler::setDeduplication(bool enabled)
+{
+    mDeduplicator.configure(enabled);
+}
+
 void
 TextureSampler::invalidateResources(const std::vector<std::string>& resources) const
 {
@@ -533,6 +585,19 @@ TextureSampler::invalidateResourceInternal(OIIO::ustring file, std::set<scene_rd
     std::string resourceName = file.c_str();
     mTextureSystem->invalidate(file);
 
+    // The maps get a new handle when updated, which copies or converts the
+    // edited file to the cache again, so only the stale copy needs
+    // invalidating here. The aliases of the file are deduplicated again too.
+    const std::string sourceName = mDeduplicator.getResolved(resourceName);
+    for (const std::string &resolvedName : { sourceName,
+                                             mSharedCache.getResolved(sourceName),
+                                             mConverter.getResolved(sourceName) }) {
+        if (resolvedName != resourceName) {
+            mTextureSystem->invalidate(OIIO::ustring(resolvedName));
+        }
+    }
+    mDeduplicator.invalidate(resourceName);
+
     // Read the texture file again.
     if(!mTextureSystem->imagespec(file)) {
         std::string errorString ("Unable to read texture file " + resourceName);
@@ -756,6 +821,13 @@ TextureSampler::parserConfigure()
                 });
     mParser.opt("showUserFriendlyStats", "", "show user-friendly stats that moonray log shows",
                 [&](Arg& arg) -> bool { return arg.msg(showGetStatistics() + '\n'); });
+    mParser.opt("cacheAnalysis", "<maxFiles>", "show per file, per pass and working set stats of the cache",
+                [&](Arg& arg) -> bool {
+                    std::ostringstream ostr;
+                    mCacheMonitor.getAnalysis("", ostr, mTextureSystem,
+                                              static_cast<size_t>((arg++).as<int>(0)));
+                    return arg.msg(ostr.str());
+                });
     mParser.opt("showFileIOTimeAveragePerThread", "", "show file I/O time averaged per thread",
                 [&](Arg& arg) -> bool {
                     return arg.fmtMsg("fileI/O:%s\n", showStatsFileIOTimeAveragePerThread().c_str());
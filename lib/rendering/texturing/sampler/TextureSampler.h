@@ -5,6 +5,11 @@
 /// @file TextureSampler.h
 ///
 #pragma once
+#include "SharedTextureCache.h"
+#include "TextureCacheMonitor.h"
+#include "TextureConverter.h"
+#include "TextureDeduplicator.h"
+#include "TexturePrefetcher.h"
 #include "TextureTLState.h"
 
 #include <scene_rdl2/common/grid_util/Arg.h>
@@ -60,6 +65,15 @@ public:
     std::string showStatsFileIOTimeAveragePerThread() const;
     std::string showStats(int level=1, bool icstats=false) const;
 
+    // Running totals of the image cache, read straight from the OIIO
+    // counters so they are cheap enough to poll while rendering.
+    typedef TextureCacheMonitor::Counters CacheCounters;
+    CacheCounters getCacheCounters() const;
+
+    // Per file, per pass and working set report of the cache, see
+    // TextureCacheMonitor.
+    void getCacheAnalysis(const std::string& prepend, std::ostream& outs, bool verbose) const;
+
     //------------------------------
 
     // Returns a texture handle which can be subsequently used to sample this
@@ -91,6 +105,24 @@ public:
     // limits the number of open files OIIO uses.
     void setOpenFileLimit(int count);
 
+    // Textures are opened from node local copies in directory, see
+    // SharedTextureCache. An empty directory disables the shared cache.
+    void setSharedCache(const std::string &directory, size_t maxSizeMb);
+
+    // Untiled or unmipped textures are converted to .tx files in directory,
+    // see TextureConverter. An empty directory disables the conversion.
+    void setConversionCache(const std::string &directory);
+
+    // Files with the same content share a single texture, see
+    // TextureDeduplicator.
+    void setDeduplication(bool enabled);
+
+    // Background prefetch of the texture tiles touched by the early passes.
+    TexturePrefetcher& getPrefetcher() { return mPrefetcher; }
+
+    // Per pass cache stats and cache auto grow.
+    TextureCacheMonitor& getCacheMonitor() { return mCacheMonitor; }
+
     OIIO::TextureSystem* getTextureSystem() { return mTextureSystem; }
 
     void registerMapForInvalidation(const std::string &filename,
@@ -139,6 +171,17 @@ protected:
 
     tbb::recursive_mutex mMutex;
 
+    SharedTextureCache mSharedCache;
+
+    TextureConverter mConverter;
+
+    // Forgets edited files from the const invalidation functions.
+    mutable TextureDeduplicator mDeduplicator;
+
+    TexturePrefetcher mPrefetcher;
+
+    TextureCacheMonitor mCacheMonitor;
+
     Parser mParser;
 };
 
@@ -0,0 +1,195 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file VdbGridCache.cc
+///
+
+#include "VdbGridCache.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include <sys/stat.h>
+
+namespace moonray {
+namespace texture {
+
+openvdb::GridBase::ConstPtr
+VdbGridCache::getGrid(const std::string &fileName,
+                      const std::string &gridName,
+                      std::string &errorMsg)
+{
+    if (fileName.empty()) {
+        errorMsg = "no .vdb filename specified";
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::stat(fileName.c_str(), &st) != 0) {
+        errorMsg = "could not open file \"" + fileName + "\"";
+        return nullptr;
+    }
+
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::shared_ptr<Entry> &slot =
+            mEntries[Key(fileName, gridName, st.st_mtim.tv_sec, st.st_mtim.tv_nsec)];
+        if (!slot) {
+            purgeExpired();
+            slot = std::make_shared<Entry>();
+        }
+        entry = slot;
+        ++entry->mRequests;
+    }
+
+    // Only this grid's readers wait on the read.
+    std::lock_guard<std::mutex> lock(entry->mReadMutex);
+    openvdb::GridBase::ConstPtr grid = entry->mGrid.lock();
+    if (grid) {
+        return grid;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::string foundGridName;
+    openvdb::GridBase::Ptr readGrid = VdbGridCache::readGrid(fileName, gridName, foundGridName, errorMsg);
+    if (!readGrid) {
+        return nullptr;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    grid = readGrid;
+    entry->mGrid = grid;
+    entry->mFoundGridName = foundGridName;
+    entry->mReadTime += elapsed.count();
+    return grid;
+}
+
+std::vector<openvdb::GridBase::ConstPtr>
+VdbGridCache::getGrids(const std::string &fileName,
+                       const std::vector<std::string> &gridNames,
+                       std::vector<std::string> &errorMsgs)
+{
+    std::vector<openvdb::GridBase::ConstPtr> grids(gridNames.size());
+    errorMsgs.assign(gridNames.size(), std::string());
+
+    tbb::parallel_for(size_t(0), gridNames.size(), [&](size_t i) {
+        try {
+            grids[i] = getGrid(fileName, gridNames[i], errorMsgs[i]);
+        } catch (const std::exception &e) {
+            errorMsgs[i] = e.what();
+        }
+    });
+    return grids;
+}
+
+std::vector<VdbGridCache::GridStats>
+VdbGridCache::getStats() const
+{
+    std::vector<GridStats> stats;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto &it : mEntries) {
+        Entry &entry = *it.second;
+        std::lock_guard<std::mutex> readLock(entry.mReadMutex);
+        const openvdb::GridBase::ConstPtr grid = entry.mGrid.lock();
+        if (!grid) {
+            continue;
+        }
+        GridStats gridStats;
+        gridStats.mFileName = std::get<0>(it.first);
+        gridStats.mGridName = entry.mFoundGridName;
+        gridStats.mValueType = grid->valueType();
+        // Delay-loaded voxel data only counts once it has been read.
+        gridStats.mMemoryBytes = grid->memUsage();
+        gridStats.mRequests = entry.mRequests;
+        gridStats.mReadTime = entry.mReadTime;
+        stats.push_back(gridStats);
+    }
+
+    std::sort(stats.begin(), stats.end(), [](const GridStats &a, const GridStats &b) {
+        return a.mMemoryBytes > b.mMemoryBytes;
+    });
+    return stats;
+}
+
+size_t
+VdbGridCache::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const GridStats &gridStats : getStats()) {
+        bytes += gridStats.mMemoryBytes;
+    }
+    return bytes;
+}
+
+openvdb::GridBase::Ptr
+VdbGridCache::readGrid(const std::string &fileName,
+                       const std::string &gridName,
+                       std::string &foundGridName,
+                       std::string &errorMsg)
+{
+    openvdb::GridBase::Ptr grid;
+
+    // Each read has its own file, so reads of different grids are independent.
+    openvdb::initialize();
+    openvdb::io::File file(fileName);
+    try {
+        file.open(/* delayLoad = */ true);
+    } catch (const openvdb::IoError &e) {
+        errorMsg = e.what();
+        return grid;
+    }
+
+    std::string whichGrid = gridName;
+
+    if (gridName.empty()) {
+        // use first grid in the file
+        openvdb::io::File::NameIterator firstName = file.beginName();
+        if (firstName != file.endName()) {
+            whichGrid = firstName.gridName();
+        }
+    } else if (!file.hasGrid(gridName)) {
+        std::ostringstream os;
+        os << "'" << fileName << "' does not contain a grid named '" << gridName << "'";
+        file.close();
+        errorMsg = os.str();
+        return grid;
+    }
+
+    grid = file.readGrid(whichGrid);
+    file.close();
+
+    foundGridName = whichGrid;
+
+    return grid;
+}
+
+void
+VdbGridCache::purgeExpired()
+{
+    // Entries still being read have a null grid too, but are referenced by
+    // their readers.
+    for (auto it = mEntries.begin(); it != mEntries.end(); ) {
+        if (it->second && it->second.use_count() == 1 && it->second->mGrid.expired()) {
+            it = mEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+VdbGridCache &
+getVdbGridCache()
+{
+    static VdbGridCache cache;
+    return cache;
+}
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
@@ -0,0 +1,102 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+/// @file VdbGridCache.h
+///
+#pragma once
+
+#include <openvdb/openvdb.h>
+
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace moonray {
+namespace texture {
+
+//
+// Process wide cache of the grids read from .vdb files, so that a grid used
+// by several objects, e.g. a VdbGeometry and a VdbLightFilter, or several
+// OpenVdbMaps, is only read and held in memory once.
+//
+// Grids are keyed by file, grid name and the file's modification time, so an
+// edited file is read again. The cache only holds weak references: a grid is
+// freed once the last object using it releases it. Reads are delay-loaded,
+// the voxel data of a grid is only read from the file when first accessed.
+//
+// The cached grids are shared and must not be modified. Users which change a
+// grid's transform work on a copyGrid() sharing its tree, users which change
+// its voxels on a deepCopyGrid().
+//
+class VdbGridCache
+{
+public:
+    struct GridStats
+    {
+        std::string mFileName;
+        std::string mGridName;
+        std::string mValueType;
+        size_t mMemoryBytes;
+        size_t mRequests;       // calls to getGrid() for this grid
+        double mReadTime;       // seconds
+    };
+
+    // Returns grid 'gridName' of 'fileName', reading it on the first request.
+    // An empty name is the first grid in the file and "name[N]" the Nth grid
+    // called name. Concurrent requests for the same grid wait for a single
+    // read, requests for different grids read in parallel.
+    // Returns null with an error message if the file can't be opened or has
+    // no such grid, other openvdb exceptions are passed on.
+    openvdb::GridBase::ConstPtr getGrid(const std::string &fileName,
+                                        const std::string &gridName,
+                                        std::string &errorMsg);
+
+    // Reads several grids of a file in parallel. The grids which can't be
+    // read are null, with the error message in the same slot of 'errorMsgs'.
+    std::vector<openvdb::GridBase::ConstPtr> getGrids(const std::string &fileName,
+                                                      const std::vector<std::string> &gridNames,
+                                                      std::vector<std::string> &errorMsgs);
+
+    // Statistics of the grids still in use, sorted by decreasing memory.
+    std::vector<GridStats> getStats() const;
+
+    // Total memory of the grids still in use.
+    size_t getMemoryUsage() const;
+
+private:
+    typedef std::tuple<std::string, std::string, std::time_t, long> Key; // file, grid, mtime s, ns
+
+    struct Entry
+    {
+        Entry() : mRequests(0), mReadTime(0.0) {}
+
+        std::mutex mReadMutex;  // held while the grid is read
+        std::weak_ptr<const openvdb::GridBase> mGrid;
+        std::string mFoundGridName;
+        size_t mRequests;
+        double mReadTime;
+    };
+
+    static openvdb::GridBase::Ptr readGrid(const std::string &fileName,
+                                           const std::string &gridName,
+                                           std::string &foundGridName,
+                                           std::string &errorMsg);
+
+    // Drops the entries whose grid has been freed, called with mMutex held.
+    void purgeExpired();
+
+    mutable std::mutex mMutex;  // guards mEntries, not the reads
+    std::map<Key, std::shared_ptr<Entry>> mEntries;
+};
+
+VdbGridCache &getVdbGridCache();
+
+} //  end of texture namespace
+} //  end of moonray namespace
+
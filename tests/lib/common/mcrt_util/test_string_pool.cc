@@ -0,0 +1,65 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test_string_pool.h"
+
+#include <moonray/common/mcrt_util/StringPool.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestStringPool);
+
+void TestStringPool::testIntern()
+{
+    moonray::util::StringPool pool;
+
+    const std::string* a = pool.get("diffuse");
+    const std::string* b = pool.get("specular");
+    CPPUNIT_ASSERT(a != b);
+    CPPUNIT_ASSERT_EQUAL(std::string("diffuse"), *a);
+    CPPUNIT_ASSERT_EQUAL(std::string("specular"), *b);
+
+    // Equal strings are the same pointer, which stays valid as the pool grows.
+    for (int i = 0; i < 1000; ++i) {
+        pool.get("label" + std::to_string(i));
+    }
+    CPPUNIT_ASSERT(pool.get(std::string("diff") + "use") == a);
+    CPPUNIT_ASSERT_EQUAL(std::string("diffuse"), *a);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1002), pool.size());
+}
+
+void TestStringPool::testConcurrentIntern()
+{
+    moonray::util::StringPool pool;
+
+    constexpr int numThreads = 8;
+    constexpr int numStrings = 2000;
+
+    // All the threads intern the same strings, racing on the inserts.
+    std::vector<std::vector<const std::string*>> results(numThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&pool, &results, t]() {
+            results[t].resize(numStrings);
+            for (int i = 0; i < numStrings; ++i) {
+                const int n = (i + t * 127) % numStrings;
+                results[t][n] = pool.get("aov" + std::to_string(n));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    CPPUNIT_ASSERT_EQUAL(std::size_t(numStrings), pool.size());
+    for (int i = 0; i < numStrings; ++i) {
+        const std::string* s = pool.get("aov" + std::to_string(i));
+        CPPUNIT_ASSERT_EQUAL("aov" + std::to_string(i), *s);
+        for (int t = 0; t < numThreads; ++t) {
+            CPPUNIT_ASSERT(results[t][i] == s);
+        }
+    }
+}
+
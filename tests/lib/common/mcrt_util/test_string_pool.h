@@ -0,0 +1,19 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestStringPool: public CppUnit::TestCase
+{
+public:
+    CPPUNIT_TEST_SUITE(TestStringPool);
+    CPPUNIT_TEST(testIntern);
+    CPPUNIT_TEST(testConcurrentIntern);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testIntern();
+    void testConcurrentIntern();
+};
+
@@ -9,6 +9,8 @@
 #include <moonray/rendering/geom/Types.h>
 #include <moonray/rendering/geom/VertexBuffer.h>
 
+#include <vector>
+
 namespace moonray {
 namespace geom {
 namespace unittest {
@@ -829,6 +831,54 @@ void appendTest3fa()
     }
 }
 
+template <template <typename> class Allocator>
+void adoptTest3fa()
+{
+    typedef VertexBuffer<Vec3fa, InterleavedTraits, Allocator<Vec3fa>> VB;
+
+    std::vector<Vec3fa> source;
+    for (size_t i = 0; i < 10; ++i) {
+        source.push_back(Vec3fa(float(i), 0.f, 0.f, 0.f));
+        source.push_back(Vec3fa(float(i), 1.f, 0.f, 0.f));
+    }
+    const float* sourceData = reinterpret_cast<const float*>(source.data());
+
+    VB it0 = VB::adopt(std::move(source), 2);
+
+    CPPUNIT_ASSERT(it0.is_adopted());
+    CPPUNIT_ASSERT(it0.size() == 10);
+    CPPUNIT_ASSERT(it0.get_time_steps() == 2);
+    CPPUNIT_ASSERT(it0.get_bytes_copied() == 0);
+    // the elements are referenced in place
+    CPPUNIT_ASSERT(it0.data() == sourceData);
+    for (size_t i = 0; i < it0.size(); ++i) {
+        CPPUNIT_ASSERT(it0(i, 0) == Vec3fa(float(i), 0.f, 0.f, 0.f));
+        CPPUNIT_ASSERT(it0(i, 1) == Vec3fa(float(i), 1.f, 0.f, 0.f));
+    }
+
+    VB it1(std::move(it0));
+
+    CPPUNIT_ASSERT(it1.is_adopted());
+    CPPUNIT_ASSERT(it1.data() == sourceData);
+    CPPUNIT_ASSERT(it1.get_bytes_copied() == 0);
+
+    // growing copies the elements into memory of the buffer's own
+    it1.resize(20, Vec3fa(1.0f, 2.0f, 3.0f, 0.f));
+
+    CPPUNIT_ASSERT(!it1.is_adopted());
+    CPPUNIT_ASSERT(it1.size() == 20);
+    CPPUNIT_ASSERT(it1.get_bytes_copied() == 10 * 2 * sizeof(Vec3fa));
+    for (size_t i = 0; i < 10; ++i) {
+        CPPUNIT_ASSERT(it1(i, 0) == Vec3fa(float(i), 0.f, 0.f, 0.f));
+        CPPUNIT_ASSERT(it1(i, 1) == Vec3fa(float(i), 1.f, 0.f, 0.f));
+    }
+
+    VB it2;
+    it2.push_back(Vec3fa(1.0f, 2.0f, 3.0f, 0.f));
+    CPPUNIT_ASSERT(!it2.is_adopted());
+    CPPUNIT_ASSERT(it2.get_bytes_copied() == sizeof(Vec3fa));
+}
+
 void TestGeomApi::testVertexBufferResize()
 {
     resizeTest3fa<std::allocator>();
@@ -853,6 +903,12 @@ void TestGeomApi::testVertexBufferAppend()
     appendTest<SizeVerifyingAllocator>();
 }
 
+void TestGeomApi::testVertexBufferAdopt()
+{
+    adoptTest3fa<std::allocator>();
+    adoptTest3fa<SizeVerifyingAllocator>();
+}
+
 } // namespace unittest
 } // namespace geom
 } // namespace moonray
@@ -27,6 +27,7 @@ public:
     CPPUNIT_TEST(testVertexBufferResize);
     CPPUNIT_TEST(testVertexBufferClear);
     CPPUNIT_TEST(testVertexBufferAppend);
+    CPPUNIT_TEST(testVertexBufferAdopt);
     CPPUNIT_TEST_SUITE_END();
 
     void testLayerAssignmentId();
@@ -40,6 +41,7 @@ public:
     void testVertexBufferResize();
     void testVertexBufferClear();
     void testVertexBufferAppend();
+    void testVertexBufferAdopt();
 
 };
 
@@ -1895,6 +1895,104 @@ void TestInterpolator::testMeshVertexMB()
 }
 
 
+void TestInterpolator::testMeshPreparedRowsMB()
+{
+    // same setup as testMeshVaryingMB, but the varying row is interpolated
+    // at once by prepareRows before the keys are looked up
+    const size_t nFaces = 2;
+    std::vector<std::vector<int> > faceIndexes(nFaces);
+    faceIndexes[0] = {0, 1, 2};
+    faceIndexes[1] = {2, 1, 3, 4};
+    const size_t nVertices = 5;
+
+    const size_t nTimes = 2;
+    std::vector<std::vector<float>> varyingFloat(nTimes);
+    std::vector<std::vector<scene_rdl2::math::Color>> varyingColor(nTimes);
+    std::vector<std::vector<scene_rdl2::math::Color4>> varyingRGBA(nTimes);
+    std::vector<std::vector<scene_rdl2::math::Vec2f>> varyingVec2f(nTimes);
+    std::vector<std::vector<scene_rdl2::math::Vec3f>> varyingVec3f(nTimes);
+    std::vector<std::vector<scene_rdl2::math::Mat4f>> varyingMat4f(nTimes);
+
+    for (size_t i = 0; i < nVertices; ++i) {
+        for (size_t t = 0; t < nTimes; ++t) {
+            varyingFloat[t].push_back(mRNG.randomFloat());
+            varyingColor[t].push_back(mRNG.randomColor());
+            varyingRGBA[t].push_back(mRNG.randomColor4());
+            varyingVec2f[t].push_back(mRNG.randomVec2f());
+            varyingVec3f[t].push_back(mRNG.randomVec3f());
+            varyingMat4f[t].push_back(mRNG.randomMat4f());
+        }
+    }
+
+    PrimitiveAttributeTable table;
+    table.addAttribute(TestAttributes::sTestFloat0, RATE_VARYING,
+        std::vector<std::vector<float>>(varyingFloat));
+    table.addAttribute(TestAttributes::sTestColor0, RATE_VARYING,
+        std::vector<std::vector<scene_rdl2::math::Color>>(varyingColor));
+    table.addAttribute(TestAttributes::sTestRGBA0, RATE_VARYING,
+        std::vector<std::vector<scene_rdl2::math::Color4>>(varyingRGBA));
+    table.addAttribute(TestAttributes::sTestVec2f0, RATE_VARYING,
+        std::vector<std::vector<scene_rdl2::math::Vec2f>>(varyingVec2f));
+    table.addAttribute(TestAttributes::sTestVec3f0, RATE_VARYING,
+        std::vector<std::vector<scene_rdl2::math::Vec3f>>(varyingVec3f));
+    table.addAttribute(TestAttributes::sTestMat4f0, RATE_VARYING,
+        std::vector<std::vector<scene_rdl2::math::Mat4f>>(varyingMat4f));
+    std::unique_ptr<Attributes> attr(
+        Attributes::interleave(table, 0, 0, nVertices,
+        std::vector<size_t>(), 0));
+    CPPUNIT_ASSERT(attr->isFloatRate(RATE_VARYING));
+
+    const std::vector<AttributeKey> requiredKeys = {
+        TestAttributes::sTestFloat0, TestAttributes::sTestColor0,
+        TestAttributes::sTestRGBA0, TestAttributes::sTestVec2f0};
+    const std::vector<AttributeKey> optionalKeys = {
+        TestAttributes::sTestVec3f0, TestAttributes::sTestMat4f0};
+
+    std::unique_ptr<internal::MeshInterpolator> interpolator;
+    float t = mRNG.randomFloat();
+    for (size_t i = 0; i < nFaces; ++i) {
+        const std::vector<int>& v = faceIndexes[i];
+        float w[4];
+        if (v.size() == 3) {
+            w[0] = mRNG.randomFloat();
+            w[1] = (1.0f - w[0]) * mRNG.randomFloat();
+            w[2] = 1.0f - w[0] - w[1];
+            interpolator.reset(new internal::MeshInterpolator(attr.get(), t,
+                0, i, v[0], v[1], v[2], w[0], w[1], w[2],
+                i, v[0], v[1], v[2], w[0], w[1], w[2]));
+        } else {
+            w[0] = mRNG.randomFloat();
+            w[1] = (1.0f - w[0]) * mRNG.randomFloat();
+            w[2] = (1.0f - w[0] - w[1]) * mRNG.randomFloat();
+            w[3] = 1.0f - w[0] - w[1] - w[2];
+            interpolator.reset(new internal::MeshInterpolator(attr.get(), t,
+                0, i, v[0], v[1], v[2], v[3], w[0], w[1], w[2], w[3],
+                i, v[0], v[1], v[2], w[0], w[1], w[2]));
+        }
+        interpolator->prepareRows(requiredKeys, optionalKeys);
+
+        size_t nSamples = v.size();
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestFloat0, *interpolator,
+            weightSumMB(&varyingFloat[0][0], &varyingFloat[1][0],
+            &v[0], w, nSamples, t)));
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestColor0, *interpolator,
+            weightSumMB(&varyingColor[0][0], &varyingColor[1][0],
+            &v[0], w, nSamples, t)));
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestRGBA0, *interpolator,
+            weightSumMB(&varyingRGBA[0][0], &varyingRGBA[1][0],
+            &v[0], w, nSamples, t)));
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestVec2f0, *interpolator,
+            weightSumMB(&varyingVec2f[0][0], &varyingVec2f[1][0],
+            &v[0], w, nSamples, t)));
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestVec3f0, *interpolator,
+            weightSumMB(&varyingVec3f[0][0], &varyingVec3f[1][0],
+            &v[0], w, nSamples, t)));
+        CPPUNIT_ASSERT(verifyResult(TestAttributes::sTestMat4f0, *interpolator,
+            weightSumMB(&varyingMat4f[0][0], &varyingMat4f[1][0],
+            &v[0], w, nSamples, t)));
+    }
+}
+
 } // namespace unittest
 } // namespace geom
 } // namespace moonray
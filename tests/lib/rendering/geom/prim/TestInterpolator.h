@@ -46,6 +46,7 @@ public:
     CPPUNIT_TEST(testMeshFaceVaryingMB);
     CPPUNIT_TEST(testMeshVertex);
     CPPUNIT_TEST(testMeshVertexMB);
+    CPPUNIT_TEST(testMeshPreparedRowsMB);
     CPPUNIT_TEST_SUITE_END();
 
     void testCurvesConstant();
@@ -70,6 +71,7 @@ public:
     void testMeshFaceVaryingMB();
     void testMeshVertex();
     void testMeshVertexMB();
+    void testMeshPreparedRowsMB();
 
 private:
     RNG mRNG;
@@ -0,0 +1,124 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestMeshTessellationUtil.cc
+///
+
+#include "TestMeshTessellationUtil.h"
+
+#include <moonray/rendering/geom/prim/MeshTessellationUtil.h>
+
+#include <vector>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+using namespace moonray::geom::internal;
+
+namespace {
+
+std::vector<PolyTessellationFactor>
+makeQuadFactors(size_t faceCount, int edgeFactor)
+{
+    std::vector<PolyTessellationFactor> factors(faceCount);
+    for (auto& factor : factors) {
+        factor.mEdgeFactor = {edgeFactor, edgeFactor, edgeFactor, edgeFactor};
+    }
+    return factors;
+}
+
+std::vector<SubdTessellationFactor>
+makeSubdFactors(size_t faceCount, int edgeFactor)
+{
+    std::vector<SubdTessellationFactor> factors(faceCount);
+    for (auto& factor : factors) {
+        factor.mEdge0Factor = {edgeFactor, edgeFactor, edgeFactor, edgeFactor};
+        factor.mEdge1Factor = {edgeFactor, edgeFactor, edgeFactor, edgeFactor};
+    }
+    return factors;
+}
+
+} // anonymous namespace
+
+void
+TestMeshTessellationUtil::testFaceBudgetUnlimited()
+{
+    std::vector<PolyTessellationFactor> factors = makeQuadFactors(16, 7);
+    // 8 x 8 faces for each quad
+    CPPUNIT_ASSERT_EQUAL(size_t(16 * 64),
+        estimateTessellatedFaceCount(factors, sQuadVertexCount));
+
+    // a budget of 0 means unlimited
+    CPPUNIT_ASSERT_EQUAL(size_t(0),
+        applyTessellationFaceBudget(factors, sQuadVertexCount, 0));
+    CPPUNIT_ASSERT_EQUAL(7, factors[0].mEdgeFactor[0]);
+
+    // a budget the mesh already fits in leaves the factors alone
+    CPPUNIT_ASSERT_EQUAL(size_t(0),
+        applyTessellationFaceBudget(factors, sQuadVertexCount, 16 * 64));
+    CPPUNIT_ASSERT_EQUAL(7, factors[0].mEdgeFactor[0]);
+}
+
+void
+TestMeshTessellationUtil::testPolyFaceBudget()
+{
+    std::vector<PolyTessellationFactor> factors = makeQuadFactors(16, 7);
+    const size_t faceBudget = 16 * 16;
+    size_t savedFaceCount =
+        applyTessellationFaceBudget(factors, sQuadVertexCount, faceBudget);
+    size_t faceCount = estimateTessellatedFaceCount(factors, sQuadVertexCount);
+    CPPUNIT_ASSERT(faceCount <= faceBudget);
+    CPPUNIT_ASSERT_EQUAL(size_t(16 * 64) - faceCount, savedFaceCount);
+    // a quarter of the faces means half the segments on every edge
+    for (const auto& factor : factors) {
+        for (size_t i = 0; i < sQuadVertexCount; ++i) {
+            CPPUNIT_ASSERT_EQUAL(3, factor.mEdgeFactor[i]);
+        }
+    }
+}
+
+void
+TestMeshTessellationUtil::testSubdFaceBudget()
+{
+    std::vector<SubdTessellationFactor> factors = makeSubdFactors(8, 15);
+    size_t estimatedFaceCount = estimateTessellatedFaceCount(factors);
+    const size_t faceBudget = estimatedFaceCount / 10;
+    size_t savedFaceCount = applyTessellationFaceBudget(factors, faceBudget);
+    size_t faceCount = estimateTessellatedFaceCount(factors);
+    CPPUNIT_ASSERT(faceCount <= faceBudget);
+    CPPUNIT_ASSERT_EQUAL(estimatedFaceCount - faceCount, savedFaceCount);
+    // every shared edge gets the same factor so the mesh stays crack free
+    for (const auto& factor : factors) {
+        for (size_t i = 0; i < sQuadVertexCount; ++i) {
+            CPPUNIT_ASSERT_EQUAL(factors[0].mEdge0Factor[0], factor.mEdge0Factor[i]);
+            CPPUNIT_ASSERT_EQUAL(factors[0].mEdge0Factor[0], factor.mEdge1Factor[i]);
+        }
+    }
+}
+
+void
+TestMeshTessellationUtil::testFaceBudgetKeepsCoarseFaces()
+{
+    // faces outside the frustum come in with a factor of 0 and keep it,
+    // the budget is taken from the finely tessellated faces
+    std::vector<PolyTessellationFactor> factors = makeQuadFactors(8, 0);
+    std::vector<PolyTessellationFactor> inFrustum = makeQuadFactors(8, 31);
+    factors.insert(factors.end(), inFrustum.begin(), inFrustum.end());
+    size_t estimatedFaceCount =
+        estimateTessellatedFaceCount(factors, sQuadVertexCount);
+    applyTessellationFaceBudget(factors, sQuadVertexCount, estimatedFaceCount / 4);
+    for (size_t f = 0; f < 8; ++f) {
+        CPPUNIT_ASSERT_EQUAL(0, factors[f].mEdgeFactor[0]);
+    }
+    for (size_t f = 8; f < factors.size(); ++f) {
+        CPPUNIT_ASSERT(factors[f].mEdgeFactor[0] > 0);
+        CPPUNIT_ASSERT(factors[f].mEdgeFactor[0] < 31);
+    }
+}
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
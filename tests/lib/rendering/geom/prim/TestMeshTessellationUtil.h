@@ -0,0 +1,35 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestMeshTessellationUtil.h
+///
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+class TestMeshTessellationUtil : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestMeshTessellationUtil);
+    CPPUNIT_TEST(testFaceBudgetUnlimited);
+    CPPUNIT_TEST(testPolyFaceBudget);
+    CPPUNIT_TEST(testSubdFaceBudget);
+    CPPUNIT_TEST(testFaceBudgetKeepsCoarseFaces);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testFaceBudgetUnlimited();
+    void testPolyFaceBudget();
+    void testSubdFaceBudget();
+    void testFaceBudgetKeepsCoarseFaces();
+};
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,113 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestPresenceCache.cc
+///
+
+#include "TestPresenceCache.h"
+
+#include <moonray/rendering/geom/prim/PresenceCache.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+using namespace moonray::geom::internal;
+
+namespace {
+
+void
+fill(PresenceCache& cache, int primId, float u, float v, float value)
+{
+    bool hit;
+    float* presence = cache.lookup(0, nullptr, 0, primId, -1, u, v, hit);
+    CPPUNIT_ASSERT(!hit);
+    *presence = value;
+}
+
+bool
+isCached(PresenceCache& cache, int primId, float u, float v, float value)
+{
+    bool hit;
+    const float* presence = cache.lookup(0, nullptr, 0, primId, -1, u, v, hit);
+    return hit && *presence == value;
+}
+
+} // namespace
+
+void
+TestPresenceCache::testHitSameCell()
+{
+    PresenceCache cache;
+    CPPUNIT_ASSERT(!cache.isEnabled());
+    cache.setCapacity(64, 4);
+    CPPUNIT_ASSERT(cache.isEnabled());
+
+    fill(cache, 0, 0.3f, 0.6f, 0.5f);
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.3f, 0.6f, 0.5f));
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.26f, 0.74f, 0.5f));
+}
+
+void
+TestPresenceCache::testMissOtherCellOrPrimitive()
+{
+    PresenceCache cache;
+    cache.setCapacity(64, 4);
+
+    fill(cache, 0, 0.1f, 0.1f, 0.25f);
+    fill(cache, 0, 0.4f, 0.1f, 0.5f);
+    fill(cache, 1, 0.1f, 0.1f, 0.75f);
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.1f, 0.1f, 0.25f));
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.4f, 0.1f, 0.5f));
+    CPPUNIT_ASSERT(isCached(cache, 1, 0.1f, 0.1f, 0.75f));
+
+    // same cell of another instance
+    int instance = 0;
+    bool hit;
+    cache.lookup(0, &instance, 0, 0, -1, 0.1f, 0.1f, hit);
+    CPPUNIT_ASSERT(!hit);
+}
+
+void
+TestPresenceCache::testLeastRecentlyUsedEviction()
+{
+    // a single set
+    PresenceCache cache;
+    cache.setCapacity(1, 8);
+
+    for (int i = 0; i < 4; ++i) {
+        fill(cache, i, 0.0f, 0.0f, float(i));
+    }
+    // touch all but the second primitive, then bring in a fifth one
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.0f, 0.0f, 0.0f));
+    CPPUNIT_ASSERT(isCached(cache, 2, 0.0f, 0.0f, 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 3, 0.0f, 0.0f, 3.0f));
+    fill(cache, 4, 0.0f, 0.0f, 4.0f);
+
+    CPPUNIT_ASSERT(isCached(cache, 0, 0.0f, 0.0f, 0.0f));
+    CPPUNIT_ASSERT(isCached(cache, 2, 0.0f, 0.0f, 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 3, 0.0f, 0.0f, 3.0f));
+    CPPUNIT_ASSERT(isCached(cache, 4, 0.0f, 0.0f, 4.0f));
+    bool hit;
+    cache.lookup(0, nullptr, 0, 1, -1, 0.0f, 0.0f, hit);
+    CPPUNIT_ASSERT(!hit);
+}
+
+void
+TestPresenceCache::testClear()
+{
+    PresenceCache cache;
+    cache.setCapacity(64, 4);
+
+    fill(cache, 0, 0.5f, 0.5f, 1.0f);
+    cache.clear();
+    bool hit;
+    cache.lookup(0, nullptr, 0, 0, -1, 0.5f, 0.5f, hit);
+    CPPUNIT_ASSERT(!hit);
+}
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,35 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestPresenceCache.h
+///
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+class TestPresenceCache : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestPresenceCache);
+    CPPUNIT_TEST(testHitSameCell);
+    CPPUNIT_TEST(testMissOtherCellOrPrimitive);
+    CPPUNIT_TEST(testLeastRecentlyUsedEviction);
+    CPPUNIT_TEST(testClear);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testHitSameCell();
+    void testMissOtherCellOrPrimitive();
+    void testLeastRecentlyUsedEviction();
+    void testClear();
+};
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
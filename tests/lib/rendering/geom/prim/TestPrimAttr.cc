@@ -388,6 +388,42 @@ void TestRenderingPrimAttr::testVarying0()
     CPPUNIT_ASSERT(attr->getVarying(TestAttributes::sTestColor0,0) == mC0);
 }
 
+void TestRenderingPrimAttr::testVaryingPacked()
+{
+    // 24 byte rows are padded to 32 bytes so they don't straddle cache lines
+    PrimitiveAttributeTable table;
+    size_t numVaryings= 3;
+    table.addAttribute(TestAttributes::sTestFloat0, RATE_VARYING,
+        std::vector<float>{mF0, mF1, mF2});
+    table.addAttribute(TestAttributes::sTestColor0, RATE_VARYING, {mC0, mC1, mC2});
+    table.addAttribute(TestAttributes::sTestVec2f0, RATE_VARYING,
+        {scene_rdl2::math::Vec2f(mF0, mF1), scene_rdl2::math::Vec2f(mF1, mF2),
+        scene_rdl2::math::Vec2f(mF2, mF3)});
+    std::unique_ptr<Attributes> attr(
+        Attributes::interleave(table, 0, 0, numVaryings,
+        std::vector<size_t>(), 0));
+
+    CPPUNIT_ASSERT(attr->getVaryingAttributesStride() == 32);
+    CPPUNIT_ASSERT(attr->getVarying(TestAttributes::sTestFloat0,2) == mF2);
+    CPPUNIT_ASSERT(attr->getVarying(TestAttributes::sTestColor0,1) == mC1);
+    CPPUNIT_ASSERT(attr->getVarying(TestAttributes::sTestVec2f0,2) ==
+        scene_rdl2::math::Vec2f(mF2, mF3));
+
+    // padding 20 byte rows to 32 bytes would waste too much memory
+    PrimitiveAttributeTable table2;
+    table2.addAttribute(TestAttributes::sTestFloat0, RATE_VARYING,
+        std::vector<float>{mF0, mF1, mF2});
+    table2.addAttribute(TestAttributes::sTestColor0, RATE_VARYING, {mC0, mC1, mC2});
+    table2.addAttribute(TestAttributes::sTestFloat1, RATE_VARYING,
+        std::vector<float>{mF3, mF2, mF1});
+    std::unique_ptr<Attributes> attr2(
+        Attributes::interleave(table2, 0, 0, numVaryings,
+        std::vector<size_t>(), 0));
+
+    CPPUNIT_ASSERT(attr2->getVaryingAttributesStride() == 20);
+    CPPUNIT_ASSERT(attr2->getVarying(TestAttributes::sTestFloat1,2) == mF1);
+}
+
 void TestRenderingPrimAttr::testVertex0()
 {
     // Basic vertex
@@ -883,6 +919,48 @@ void TestRenderingPrimAttr::testInstanceAttributes()
     CPPUNIT_ASSERT(!attr.isSupported(TypedAttributeKey<int>("not_exist_attr")));
 }
 
+void TestRenderingPrimAttr::testInstanceAttributesShared()
+{
+    TypedAttributeKey<float> fKey("test_shared_f");
+    TypedAttributeKey<int> iKey("test_shared_i");
+    TypedAttributeKey<std::string> sKey("test_shared_s");
+    TypedAttributeKey<Vec3f> v3Key("test_shared_vec3");
+
+    size_t constantsSize;
+    auto keyOffset = InstanceAttributes::buildKeyOffsetTable(
+        {fKey, iKey, sKey, v3Key}, constantsSize);
+    CPPUNIT_ASSERT(constantsSize >= sizeof(float) + sizeof(int) +
+        sizeof(std::string*) + sizeof(Vec3f));
+
+    InstanceAttributes attr0(keyOffset, constantsSize);
+    InstanceAttributes attr1(keyOffset, constantsSize);
+    // constant data starts zeroed
+    CPPUNIT_ASSERT(attr0.getAttribute(fKey) == 0.0f);
+    CPPUNIT_ASSERT(attr0.getAttribute(iKey) == 0);
+
+    attr0.setAttribute(fKey, 0.5f);
+    attr0.setAttribute(iKey, 7);
+    attr0.setAttribute(sKey, std::string("instance0"));
+    attr0.setAttribute(v3Key, Vec3f(1, 2, 3));
+    attr1.setAttribute(fKey, 1.5f);
+    attr1.setAttribute(iKey, 8);
+    attr1.setAttribute(sKey, std::string("instance1"));
+    attr1.setAttribute(v3Key, Vec3f(4, 5, 6));
+
+    CPPUNIT_ASSERT(attr0.getAttribute(fKey) == 0.5f);
+    CPPUNIT_ASSERT(attr0.getAttribute(iKey) == 7);
+    CPPUNIT_ASSERT(attr0.getAttribute(sKey) == "instance0");
+    CPPUNIT_ASSERT(attr0.getAttribute(v3Key) == Vec3f(1, 2, 3));
+    CPPUNIT_ASSERT(attr1.getAttribute(fKey) == 1.5f);
+    CPPUNIT_ASSERT(attr1.getAttribute(iKey) == 8);
+    CPPUNIT_ASSERT(attr1.getAttribute(sKey) == "instance1");
+    CPPUNIT_ASSERT(attr1.getAttribute(v3Key) == Vec3f(4, 5, 6));
+
+    CPPUNIT_ASSERT(!attr0.isSupported(TypedAttributeKey<int>("not_exist_attr")));
+    // the shared table is only accounted once among its users
+    CPPUNIT_ASSERT(keyOffset.use_count() == 3);
+}
+
 } // namespace unittest
 } // namespace geom
 } // namespace moonray
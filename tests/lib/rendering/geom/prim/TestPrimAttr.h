@@ -31,6 +31,7 @@ public:
     CPPUNIT_TEST(testFaceVarying2);
     CPPUNIT_TEST(testFaceVarying3);
     CPPUNIT_TEST(testVarying0);
+    CPPUNIT_TEST(testVaryingPacked);
     CPPUNIT_TEST(testVertex0);
     CPPUNIT_TEST(testVertex1);
     CPPUNIT_TEST(testVertex2);
@@ -40,6 +41,7 @@ public:
     CPPUNIT_TEST(testTransformAttributes1);
     CPPUNIT_TEST(testTransformAttributes2);
     CPPUNIT_TEST(testInstanceAttributes);
+    CPPUNIT_TEST(testInstanceAttributesShared);
     CPPUNIT_TEST_SUITE_END();
 
     void testConstant();
@@ -54,6 +56,7 @@ public:
     void testFaceVarying2();
     void testFaceVarying3();
     void testVarying0();
+    void testVaryingPacked();
     void testVertex0();
     void testVertex1();
     void testVertex2();
@@ -63,6 +66,7 @@ public:
     void testTransformAttributes1();
     void testTransformAttributes2();
     void testInstanceAttributes();
+    void testInstanceAttributesShared();
 
 private:
     scene_rdl2::math::Color mC0;
@@ -0,0 +1,111 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestTessellationArena.cc
+///
+
+#include "TestTessellationArena.h"
+
+#include <moonray/rendering/geom/prim/TessellationArena.h>
+#include <moonray/rendering/geom/Types.h>
+
+#include <cstdint>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+using namespace moonray::geom::internal;
+
+void
+TestTessellationArena::testSharedChunk()
+{
+    TessellationArena arena;
+
+    std::shared_ptr<void> owner0, owner1;
+    char* p0 = static_cast<char*>(arena.allocate(100, 64, owner0));
+    char* p1 = static_cast<char*>(arena.allocate(1000, 64, owner1));
+
+    // Small buffers come out of the same chunk, aligned and zeroed.
+    CPPUNIT_ASSERT(owner0 && owner0 == owner1);
+    CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(p0) % 64 == 0);
+    CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(p1) % 64 == 0);
+    CPPUNIT_ASSERT(p1 >= p0 + 100);
+    for (int i = 0; i < 1000; ++i) {
+        CPPUNIT_ASSERT(p1[i] == 0);
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(1), arena.getChunkCount());
+    CPPUNIT_ASSERT_EQUAL(size_t(1100), arena.getUsedBytes());
+    CPPUNIT_ASSERT_EQUAL(TessellationArena::sMinChunkSize, arena.getReservedBytes());
+}
+
+void
+TestTessellationArena::testLargeBuffer()
+{
+    TessellationArena arena;
+
+    std::shared_ptr<void> small, large;
+    arena.allocate(64, 64, small);
+    arena.allocate(TessellationArena::sMinChunkSize, 64, large);
+
+    // Large buffers get a chunk of their own and leave the shared one open.
+    CPPUNIT_ASSERT(small != large);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), arena.getChunkCount());
+
+    std::shared_ptr<void> other;
+    arena.allocate(64, 64, other);
+    CPPUNIT_ASSERT(other == small);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), arena.getChunkCount());
+}
+
+void
+TestTessellationArena::testReset()
+{
+    TessellationArena arena;
+
+    std::shared_ptr<void> before;
+    arena.allocate(64, 64, before);
+    std::weak_ptr<void> chunk = before;
+
+    // The buffers of the previous pass keep their chunk alive, the new pass
+    // starts a new one.
+    arena.reset();
+    CPPUNIT_ASSERT_EQUAL(size_t(0), arena.getUsedBytes());
+    CPPUNIT_ASSERT_EQUAL(size_t(0), arena.getChunkCount());
+    CPPUNIT_ASSERT(!chunk.expired());
+
+    std::shared_ptr<void> after;
+    arena.allocate(64, 64, after);
+    CPPUNIT_ASSERT(after != before);
+
+    // The chunk is released with its last buffer.
+    before.reset();
+    CPPUNIT_ASSERT(chunk.expired());
+}
+
+void
+TestTessellationArena::testVertexBuffer()
+{
+    TessellationArena arena;
+
+    typedef VertexBuffer<Vec3fa, InterleavedTraits> Buffer;
+    Buffer buffer = allocateTessellatedBuffer<Vec3fa>(&arena, 10, 2);
+    CPPUNIT_ASSERT(buffer.is_adopted());
+    CPPUNIT_ASSERT_EQUAL(size_t(10), buffer.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), buffer.get_time_steps());
+    CPPUNIT_ASSERT_EQUAL(size_t(10 * 2 * sizeof(Vec3fa)), arena.getUsedBytes());
+
+    buffer(9, 1) = Vec3fa(1.0f, 2.0f, 3.0f, 0.0f);
+    CPPUNIT_ASSERT(buffer(9, 1).x == 1.0f && buffer(9, 1).z == 3.0f);
+
+    // Without an arena the buffer is allocated on its own.
+    Buffer own = allocateTessellatedBuffer<Vec3fa>(nullptr, 10, 2);
+    CPPUNIT_ASSERT(!own.is_adopted());
+    CPPUNIT_ASSERT_EQUAL(size_t(10), own.size());
+}
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,35 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestTessellationArena.h
+///
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+class TestTessellationArena : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestTessellationArena);
+    CPPUNIT_TEST(testSharedChunk);
+    CPPUNIT_TEST(testLargeBuffer);
+    CPPUNIT_TEST(testReset);
+    CPPUNIT_TEST(testVertexBuffer);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testSharedChunk();
+    void testLargeBuffer();
+    void testReset();
+    void testVertexBuffer();
+};
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
@@ -0,0 +1,107 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestVolumeShaderCache.cc
+///
+
+#include "TestVolumeShaderCache.h"
+
+#include <moonray/rendering/geom/prim/VolumeShaderCache.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+using namespace moonray::geom::internal;
+
+namespace {
+
+void
+fill(VolumeShaderCache& cache, int volumeId, const Vec3f& p, float value)
+{
+    bool hit;
+    VolumeShaderCache::Result* result = cache.lookup(volumeId, p, 1.0f, hit);
+    CPPUNIT_ASSERT(!hit);
+    result->mExtinction = scene_rdl2::math::Color(value);
+}
+
+bool
+isCached(VolumeShaderCache& cache, int volumeId, const Vec3f& p, float value)
+{
+    bool hit;
+    const VolumeShaderCache::Result* result = cache.lookup(volumeId, p, 1.0f, hit);
+    return hit && result->mExtinction == scene_rdl2::math::Color(value);
+}
+
+} // namespace
+
+void
+TestVolumeShaderCache::testHitSameCell()
+{
+    VolumeShaderCache cache;
+    CPPUNIT_ASSERT(!cache.isEnabled());
+    cache.setCapacity(64);
+    CPPUNIT_ASSERT(cache.isEnabled());
+
+    fill(cache, 0, Vec3f(0.25f, 0.5f, 0.75f), 2.0f);
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(0.25f, 0.5f, 0.75f), 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(0.9f, 0.1f, 0.0f), 2.0f));
+}
+
+void
+TestVolumeShaderCache::testMissOtherCellOrVolume()
+{
+    VolumeShaderCache cache;
+    cache.setCapacity(64);
+
+    fill(cache, 0, Vec3f(0.5f), 2.0f);
+    fill(cache, 0, Vec3f(-0.5f), 3.0f);
+    fill(cache, 1, Vec3f(0.5f), 4.0f);
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(0.5f), 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(-0.5f), 3.0f));
+    CPPUNIT_ASSERT(isCached(cache, 1, Vec3f(0.5f), 4.0f));
+}
+
+void
+TestVolumeShaderCache::testLeastRecentlyUsedEviction()
+{
+    // a single set
+    VolumeShaderCache cache;
+    cache.setCapacity(1);
+
+    for (int i = 0; i < 4; ++i) {
+        fill(cache, 0, Vec3f(float(i), 0.0f, 0.0f), float(i));
+    }
+    // touch all but the second cell, then bring in a fifth one
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(0.0f), 0.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(2.0f, 0.0f, 0.0f), 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(3.0f, 0.0f, 0.0f), 3.0f));
+    fill(cache, 0, Vec3f(4.0f, 0.0f, 0.0f), 4.0f);
+
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(0.0f), 0.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(2.0f, 0.0f, 0.0f), 2.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(3.0f, 0.0f, 0.0f), 3.0f));
+    CPPUNIT_ASSERT(isCached(cache, 0, Vec3f(4.0f, 0.0f, 0.0f), 4.0f));
+    bool hit;
+    cache.lookup(0, Vec3f(1.0f, 0.0f, 0.0f), 1.0f, hit);
+    CPPUNIT_ASSERT(!hit);
+}
+
+void
+TestVolumeShaderCache::testClear()
+{
+    VolumeShaderCache cache;
+    cache.setCapacity(64);
+
+    fill(cache, 0, Vec3f(0.5f), 2.0f);
+    cache.clear();
+    bool hit;
+    cache.lookup(0, Vec3f(0.5f), 1.0f, hit);
+    CPPUNIT_ASSERT(!hit);
+}
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
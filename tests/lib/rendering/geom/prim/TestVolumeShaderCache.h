@@ -0,0 +1,35 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestVolumeShaderCache.h
+///
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace geom {
+namespace unittest {
+
+class TestVolumeShaderCache : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestVolumeShaderCache);
+    CPPUNIT_TEST(testHitSameCell);
+    CPPUNIT_TEST(testMissOtherCellOrVolume);
+    CPPUNIT_TEST(testLeastRecentlyUsedEviction);
+    CPPUNIT_TEST(testClear);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testHitSameCell();
+    void testMissOtherCellOrVolume();
+    void testLeastRecentlyUsedEviction();
+    void testClear();
+};
+
+} // namespace unittest
+} // namespace geom
+} // namespace moonray
+
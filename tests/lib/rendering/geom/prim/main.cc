@@ -3,6 +3,10 @@
 
 #include "TestPrimAttr.h"
 #include "TestInterpolator.h"
+#include "TestMeshTessellationUtil.h"
+#include "TestPresenceCache.h"
+#include "TestTessellationArena.h"
+#include "TestVolumeShaderCache.h"
 #include <moonray/rendering/mcrt_common/ThreadLocalState.h>
 #include <scene_rdl2/pdevunit/pdevunit.h>
 #include <tbb/task_scheduler_init.h>
@@ -21,6 +25,10 @@ main(int argc, char *argv[])
 
     CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestRenderingPrimAttr);
     CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestInterpolator);
+    CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestMeshTessellationUtil);
+    CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestVolumeShaderCache);
+    CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestPresenceCache);
+    CPPUNIT_TEST_SUITE_REGISTRATION(moonray::geom::unittest::TestTessellationArena);
 
     int result = pdevunit::run(argc, argv);
     moonray::mcrt_common::cleanUpTLS();
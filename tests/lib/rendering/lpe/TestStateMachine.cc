@@ -84,6 +84,116 @@ TestStateMachine::testLpe()
     }
 }
 
+void
+TestStateMachine::testDenseTables()
+{
+    StateMachine m;
+    CPPUNIT_ASSERT(m.addExpression("CD*L", 1) == 0);
+    CPPUNIT_ASSERT(m.addExpression("C<.D'diffuse'>L", 2) == 0);
+    CPPUNIT_ASSERT(m.addExpression("C<RG>L", 3) == 0);
+    const int diffuseLabel = m.getLabelId("diffuse");
+    CPPUNIT_ASSERT(diffuseLabel >= 0);
+
+    m.build();
+
+    const int *eventTable = nullptr;
+    const int *labelTable = nullptr;
+    int numLabelColumns = 0;
+    m.getDenseTables(eventTable, labelTable, numLabelColumns);
+    CPPUNIT_ASSERT(eventTable != nullptr);
+    CPPUNIT_ASSERT(labelTable != nullptr);
+    CPPUNIT_ASSERT(numLabelColumns >= 2);
+
+    // walks the tables the way the vectorized code does
+    auto denseTransition = [&](int stateId, EventType ev, EventScatteringType evs, int labelId) {
+        if (stateId < 0) return stateId;
+        stateId = eventTable[stateId * LPE_NUM_EVENT_CODES + ev * LPE_NUM_EVENT_SCATTERING_TYPES + evs];
+        if (stateId < 0) return stateId;
+        return labelTable[stateId * numLabelColumns + labelId + 1];
+    };
+
+    const EventType events[] = { EVENT_TYPE_REFLECTION, EVENT_TYPE_TRANSMISSION, EVENT_TYPE_VOLUME };
+    const EventScatteringType scatterings[] = { EVENT_SCATTERING_TYPE_DIFFUSE, EVENT_SCATTERING_TYPE_GLOSSY,
+                                                EVENT_SCATTERING_TYPE_MIRROR, EVENT_SCATTERING_TYPE_STRAIGHT };
+    const int labels[] = { sNoLabel, diffuseLabel };
+
+    for (EventType ev: events) {
+        for (EventScatteringType evs: scatterings) {
+            for (int labelId: labels) {
+                int stateId = m.transition(StateMachine::sInitialStateId, EVENT_TYPE_CAMERA,
+                                           EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+                int denseStateId = denseTransition(StateMachine::sInitialStateId, EVENT_TYPE_CAMERA,
+                                                   EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+                CPPUNIT_ASSERT_EQUAL(stateId, denseStateId);
+
+                stateId = m.transition(stateId, ev, evs, labelId);
+                denseStateId = denseTransition(denseStateId, ev, evs, labelId);
+                CPPUNIT_ASSERT_EQUAL(stateId, denseStateId);
+
+                stateId = m.transition(stateId, EVENT_TYPE_LIGHT, EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+                denseStateId = denseTransition(denseStateId, EVENT_TYPE_LIGHT, EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+                CPPUNIT_ASSERT_EQUAL(stateId, denseStateId);
+
+                const bool diffuse = evs == EVENT_SCATTERING_TYPE_DIFFUSE;
+                CPPUNIT_ASSERT_EQUAL(diffuse, m.isValid(stateId, 1));
+                CPPUNIT_ASSERT_EQUAL(diffuse && labelId == diffuseLabel, m.isValid(stateId, 2));
+                CPPUNIT_ASSERT_EQUAL(ev == EVENT_TYPE_REFLECTION && evs == EVENT_SCATTERING_TYPE_GLOSSY,
+                                     m.isValid(stateId, 3));
+            }
+        }
+    }
+
+    // a dead path stays dead
+    CPPUNIT_ASSERT_EQUAL(-1, m.transition(-1, EVENT_TYPE_LIGHT, EVENT_SCATTERING_TYPE_NONE, sNoLabel));
+}
+
+void
+TestStateMachine::testValidIds()
+{
+    StateMachine m;
+    CPPUNIT_ASSERT(m.addExpression("CD*L", 7) == 0);
+    CPPUNIT_ASSERT(m.addExpression("C<.D'diffuse'>L", 2) == 0);
+    CPPUNIT_ASSERT(m.addExpression("CRL", 5) == 0);
+    CPPUNIT_ASSERT(m.addExpression("CDL", 3) == 0);
+    const int diffuseLabel = m.getLabelId("diffuse");
+    CPPUNIT_ASSERT(diffuseLabel >= 0);
+
+    m.build();
+
+    const EventScatteringType scatterings[] = { EVENT_SCATTERING_TYPE_DIFFUSE, EVENT_SCATTERING_TYPE_GLOSSY };
+    const int labels[] = { sNoLabel, diffuseLabel };
+
+    // the lists hold exactly the ids isValid() accepts, in increasing order
+    for (EventScatteringType evs: scatterings) {
+        for (int labelId: labels) {
+            int stateId = m.transition(StateMachine::sInitialStateId, EVENT_TYPE_CAMERA,
+                                       EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+            stateId = m.transition(stateId, EVENT_TYPE_REFLECTION, evs, labelId);
+            stateId = m.transition(stateId, EVENT_TYPE_LIGHT, EVENT_SCATTERING_TYPE_NONE, sNoLabel);
+
+            int count = 0;
+            const int *ids = m.getValidIds(stateId, count);
+            int numValid = 0;
+            for (int id = 0; id < 8; ++id) {
+                numValid += m.isValid(stateId, id) ? 1 : 0;
+            }
+            CPPUNIT_ASSERT_EQUAL(numValid, count);
+            for (int i = 0; i < count; ++i) {
+                CPPUNIT_ASSERT(m.isValid(stateId, ids[i]));
+                CPPUNIT_ASSERT(i == 0 || ids[i - 1] < ids[i]);
+            }
+
+            const bool diffuse = evs == EVENT_SCATTERING_TYPE_DIFFUSE;
+            CPPUNIT_ASSERT_EQUAL(diffuse ? (labelId == diffuseLabel ? 4 : 3) : 1, count);
+        }
+    }
+
+    // a dead path has no valid ids
+    int count = -1;
+    CPPUNIT_ASSERT(m.getValidIds(-1, count) == nullptr);
+    CPPUNIT_ASSERT_EQUAL(0, count);
+}
+
 } // namespace unittest
 } // namespace lpe
 } // namespace moonray
@@ -15,9 +15,13 @@ namespace unittest {
 class TestStateMachine : public CppUnit::TestFixture
 {
     void testLpe();
+    void testDenseTables();
+    void testValidIds();
 
     CPPUNIT_TEST_SUITE(TestStateMachine);
     CPPUNIT_TEST(testLpe);
+    CPPUNIT_TEST(testDenseTables);
+    CPPUNIT_TEST(testValidIds);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -0,0 +1,136 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestAosSoa.h"
+#include <moonray/rendering/mcrt_common/SOAUtil.h>
+#include <moonray/common/time/Ticker.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+#ifdef __AVX512F__
+
+//----------------------------------------------------------------------------
+
+//
+// 16 wide counterparts of the AVX tests, the SOA layout of the bundled
+// pipeline in AVX-512 builds.
+//
+
+void
+doAVX512RefAOSToSOA( unsigned numElems,
+                     const AOSData *__restrict aosData,
+                     SOABlock16 *__restrict soaBlocks,
+                     SortOrder *sortOrder,
+                     scene_rdl2::alloc::Arena *arena,
+                     Ticks *ticks )
+{
+    ticks->mPreSort = time::getTicks();
+
+    // Sorting phase:
+    std::sort(sortOrder, sortOrder + numElems, [](const SortOrder &a, const SortOrder &b) -> bool {
+        return a.mSortKey < b.mSortKey;
+    });
+
+    ticks->mPostSort = time::getTicks();
+
+    // Transposition phase:
+    for (unsigned i = 0; i < numElems; ++i) {
+
+        unsigned blockIdx = i >> AVX512_VLEN_SHIFT;
+        unsigned laneIdx = i & AVX512_VLEN_MASK;
+
+        const AOSData *aos = aosData + sortOrder[i].mElemIdx;
+
+        for (unsigned j = 0; j < sizeof(AOSData) / sizeof(uint32_t); ++j) {
+            soaBlocks[blockIdx].mData[j][laneIdx] = aos->mData[j];
+        }
+    }
+
+    // Smear final entry over trailing SOA entries.
+    if ((numElems & AVX512_VLEN_MASK) != 0) {
+
+        SOABlock16 &finalSoa = soaBlocks[numElems >> AVX512_VLEN_SHIFT];
+        unsigned finalLaneIdx = (numElems - 1) & AVX512_VLEN_MASK;
+
+        for (unsigned i = 0; i < sizeof(AOSData) / sizeof(uint32_t); ++i) {
+            uint32_t ref = finalSoa.mData[i][finalLaneIdx];
+            for (unsigned j = finalLaneIdx + 1; j < AVX512_VLEN; ++j) {
+                finalSoa.mData[i][j] = ref;
+            }
+        }
+    }
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doAVX512OptAOSToSOA( unsigned numElems,
+                     const AOSData *__restrict aosData,
+                     SOABlock16 *__restrict soaBlocks,
+                     SortOrder *sortOrder,
+                     scene_rdl2::alloc::Arena *arena,
+                     Ticks *ticks)
+{
+    ticks->mPreSort = time::getTicks();
+
+    scene_rdl2::util::inPlaceRadixSort32(numElems, sortOrder, arena);
+
+    ticks->mPostSort = time::getTicks();
+
+    convertAOSToSOAIndexed_AVX512<sizeof(AOSData),
+                                  sizeof(AOSData),
+                                  sizeof(SOABlock16),
+                                  sizeof(SortOrder),
+                                  0>
+        (numElems, (const uint32_t *)aosData, (uint32_t *)soaBlocks, &sortOrder[0].mElemIdx);
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doAVX512OptSOAToAOS( unsigned numElems,
+                     const SOABlock16 *__restrict soaBlocks,
+                     AOSData **__restrict aosData,
+                     uint32_t *indices,
+                     scene_rdl2::alloc::Arena *arena,
+                     Ticks *ticks )
+{
+    ticks->mPreSort = ticks->mPostSort = time::getTicks();
+
+    convertSOAToAOSIndexed_AVX512<sizeof(SOABlock16),
+                                  sizeof(SOABlock16),
+                                  sizeof(uint32_t),
+                                  0>
+        (numElems, indices, (const uint32_t *)soaBlocks, (uint32_t **)aosData);
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doAVX512UnsortedAOSToSOA( unsigned numElems,
+                          const AOSData *__restrict aosData,
+                          SOABlock16 *__restrict soaBlocks )
+{
+    convertAOSToSOA_AVX512<sizeof(AOSData),
+                           sizeof(AOSData),
+                           sizeof(SOABlock16),
+                           0>
+        (numElems, (const uint32_t *)aosData, (uint32_t *)soaBlocks);
+}
+
+//----------------------------------------------------------------------------
+
+#endif // __AVX512F__
+
+} // namespace mcrt_common
+} // namespace moonray
+
@@ -0,0 +1,135 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestAosSoa.h"
+#include <moonray/rendering/mcrt_common/SOAUtil.h>
+#include <moonray/common/time/Ticker.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+#ifdef __ARM_NEON__
+
+//----------------------------------------------------------------------------
+
+//
+// 4 wide counterparts of the AVX tests, the SOA layout of the bundled
+// pipeline in arm64 builds.
+//
+
+void
+doNEONRefAOSToSOA( unsigned numElems,
+                   const AOSData *__restrict aosData,
+                   SOABlock4 *__restrict soaBlocks,
+                   SortOrder *sortOrder,
+                   scene_rdl2::alloc::Arena *arena,
+                   Ticks *ticks )
+{
+    ticks->mPreSort = time::getTicks();
+
+    // Sorting phase:
+    std::sort(sortOrder, sortOrder + numElems, [](const SortOrder &a, const SortOrder &b) -> bool {
+        return a.mSortKey < b.mSortKey;
+    });
+
+    ticks->mPostSort = time::getTicks();
+
+    // Transposition phase:
+    for (unsigned i = 0; i < numElems; ++i) {
+
+        unsigned blockIdx = i >> SSE_VLEN_SHIFT;
+        unsigned laneIdx = i & SSE_VLEN_MASK;
+
+        const AOSData *aos = aosData + sortOrder[i].mElemIdx;
+
+        for (unsigned j = 0; j < sizeof(AOSData) / sizeof(uint32_t); ++j) {
+            soaBlocks[blockIdx].mData[j][laneIdx] = aos->mData[j];
+        }
+    }
+
+    // Smear final entry over trailing SOA entries.
+    if ((numElems & SSE_VLEN_MASK) != 0) {
+
+        SOABlock4 &finalSoa = soaBlocks[numElems >> SSE_VLEN_SHIFT];
+        unsigned finalLaneIdx = (numElems - 1) & SSE_VLEN_MASK;
+
+        for (unsigned i = 0; i < sizeof(AOSData) / sizeof(uint32_t); ++i) {
+            uint32_t ref = finalSoa.mData[i][finalLaneIdx];
+            for (unsigned j = finalLaneIdx + 1; j < SSE_VLEN; ++j) {
+                finalSoa.mData[i][j] = ref;
+            }
+        }
+    }
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doNEONOptAOSToSOA( unsigned numElems,
+                   const AOSData *__restrict aosData,
+                   SOABlock4 *__restrict soaBlocks,
+                   SortOrder *sortOrder,
+                   scene_rdl2::alloc::Arena *arena,
+                   Ticks *ticks )
+{
+    ticks->mPreSort = time::getTicks();
+
+    scene_rdl2::util::inPlaceRadixSort32(numElems, sortOrder, arena);
+
+    ticks->mPostSort = time::getTicks();
+
+    convertAOSToSOAIndexed_NEON<sizeof(AOSData),
+                                sizeof(AOSData),
+                                sizeof(SOABlock4),
+                                sizeof(SortOrder),
+                                0>
+        (numElems, (const uint32_t *)aosData, (uint32_t *)soaBlocks, &sortOrder[0].mElemIdx);
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doNEONOptSOAToAOS( unsigned numElems,
+                   const SOABlock4 *__restrict soaBlocks,
+                   AOSData **__restrict aosData,
+                   uint32_t *indices,
+                   scene_rdl2::alloc::Arena *arena,
+                   Ticks *ticks )
+{
+    ticks->mPreSort = ticks->mPostSort = time::getTicks();
+
+    convertSOAToAOSIndexed_NEON<sizeof(SOABlock4),
+                                sizeof(SOABlock4),
+                                sizeof(uint32_t),
+                                0>
+        (numElems, indices, (const uint32_t *)soaBlocks, (uint32_t **)aosData);
+
+    ticks->mPostTranspose = time::getTicks();
+}
+
+//----------------------------------------------------------------------------
+
+void
+doNEONUnsortedAOSToSOA( unsigned numElems,
+                        const AOSData *__restrict aosData,
+                        SOABlock4 *__restrict soaBlocks )
+{
+    convertAOSToSOA_NEON<sizeof(AOSData),
+                         sizeof(AOSData),
+                         sizeof(SOABlock4),
+                         0>
+        (numElems, (const uint32_t *)aosData, (uint32_t *)soaBlocks);
+}
+
+//----------------------------------------------------------------------------
+
+#endif // __ARM_NEON__
+
+} // namespace mcrt_common
+} // namespace moonray
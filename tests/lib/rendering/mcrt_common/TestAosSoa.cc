@@ -122,21 +122,26 @@ validateSOAToAOSResults( unsigned numElems,
 }
 
 void
-displayStats(const char *heading, const Ticks &ticks)
+displayStats(const char *heading, const Ticks &ticks, unsigned numElems)
 {
     double milSortTicks = double(ticks.mPostSort - ticks.mPreSort) / 1000000.0;
     double milTransposeTicks = double(ticks.mPostTranspose - ticks.mPostSort) / 1000000.0;
 
+    // Throughput of the transposition alone, comparable across the ISAs.
+    double elemsPerMilTicks = (milTransposeTicks > 0.0) ? double(numElems) / milTransposeTicks : 0.0;
+
     fprintf(stderr,
             "\"%s\" results are valid:\n"
             "          sorting (millions of ticks) = %13.6f\n"
             "    transposition (millions of ticks) = %13.6f\n"
             "                                         ------------\n"
-            "                                        %13.6f\n",
+            "                                        %13.6f\n"
+            " elements per million transpose ticks = %13.1f\n",
             heading,
             milSortTicks,
             milTransposeTicks,
-            milSortTicks + milTransposeTicks);
+            milSortTicks + milTransposeTicks,
+            elemsPerMilTicks);
 }
 
 
@@ -177,7 +182,7 @@ runTests( REF_A2S doRefAOSToSOA,
         CPPUNIT_ASSERT(0);
         return false;
     } else {
-        displayStats("Reference AOS->SOA", refTicks);
+        displayStats("Reference AOS->SOA", refTicks, numElems);
     }
 
     //
@@ -196,7 +201,7 @@ runTests( REF_A2S doRefAOSToSOA,
         CPPUNIT_ASSERT(0);
         return false;
     } else {
-        displayStats("Optimized AOS->SOA", optTicks);
+        displayStats("Optimized AOS->SOA", optTicks, numElems);
     }
 
     //
@@ -226,7 +231,7 @@ runTests( REF_A2S doRefAOSToSOA,
         CPPUNIT_ASSERT(0);
         return false;
     } else { 
-        displayStats("Optimized SOA->AOS", optTicks);
+        displayStats("Optimized SOA->AOS", optTicks, numIndices);
     }
 
     return true;
@@ -273,6 +278,72 @@ void TestAosSoa::testAVX()
                          &mArena );
 }
 
+#ifdef __AVX512F__
+void TestAosSoa::testAVX512()
+{
+    // Run AVX-512 tests.
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Running AVX-512 tests\n");
+    fprintf(stderr, "---------------------\n");
+    runTests<SOABlock16>( doAVX512RefAOSToSOA,
+                          doAVX512OptAOSToSOA,
+                          doAVX512OptSOAToAOS,
+                          mNumElems,
+                          mRefAosData,
+                          mRefSortOrder,
+                          mRNG,
+                          &mArena );
+
+    // The unsorted transpose keeps the AOS order, validate it against the
+    // identity order.
+    SCOPED_MEM(&mArena);
+
+    const unsigned numSoaBlocks = scene_rdl2::util::alignUp(mNumElems, AVX512_VLEN) / AVX512_VLEN;
+    SOABlock16 *soaBlocks = mArena.allocArray<SOABlock16>(numSoaBlocks, CACHE_LINE_SIZE);
+    SortOrder *identityOrder = mArena.allocArray<SortOrder>(mNumElems, CACHE_LINE_SIZE);
+    for (unsigned i = 0; i < mNumElems; ++i) {
+        identityOrder[i].mSortKey = i;
+        identityOrder[i].mElemIdx = i;
+    }
+
+    doAVX512UnsortedAOSToSOA(mNumElems, mRefAosData, soaBlocks);
+    CPPUNIT_ASSERT(validateAOSToSOAResults(mNumElems, mRefAosData, soaBlocks, identityOrder, &mArena));
+}
+#endif
+
+#ifdef __ARM_NEON__
+void TestAosSoa::testNEON()
+{
+    // Run NEON tests.
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Running NEON tests\n");
+    fprintf(stderr, "------------------\n");
+    runTests<SOABlock4>( doNEONRefAOSToSOA,
+                         doNEONOptAOSToSOA,
+                         doNEONOptSOAToAOS,
+                         mNumElems,
+                         mRefAosData,
+                         mRefSortOrder,
+                         mRNG,
+                         &mArena );
+
+    // The unsorted transpose keeps the AOS order, validate it against the
+    // identity order.
+    SCOPED_MEM(&mArena);
+
+    const unsigned numSoaBlocks = scene_rdl2::util::alignUp(mNumElems, SSE_VLEN) / SSE_VLEN;
+    SOABlock4 *soaBlocks = mArena.allocArray<SOABlock4>(numSoaBlocks, CACHE_LINE_SIZE);
+    SortOrder *identityOrder = mArena.allocArray<SortOrder>(mNumElems, CACHE_LINE_SIZE);
+    for (unsigned i = 0; i < mNumElems; ++i) {
+        identityOrder[i].mSortKey = i;
+        identityOrder[i].mElemIdx = i;
+    }
+
+    doNEONUnsortedAOSToSOA(mNumElems, mRefAosData, soaBlocks);
+    CPPUNIT_ASSERT(validateAOSToSOAResults(mNumElems, mRefAosData, soaBlocks, identityOrder, &mArena));
+}
+#endif
+
 //----------------------------------------------------------------------------
 
 } // namespace mcrt_common
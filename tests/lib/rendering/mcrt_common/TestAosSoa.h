@@ -12,8 +12,9 @@
 // The number of objects we want to transpose.
 #define NUM_AOS_ELEMS           17011
 
-// In bytes. Size must be a multiple of SIMD_MEMORY_ALIGNMENT for the given ISA.
-#define SIZE_OF_AOS_OBJECT      160
+// In bytes. Size must be a multiple of SIMD_MEMORY_ALIGNMENT for all the ISAs
+// tested, 64 bytes with AVX-512.
+#define SIZE_OF_AOS_OBJECT      192
 
 MNRY_STATIC_ASSERT((SIZE_OF_AOS_OBJECT % SIMD_MEMORY_ALIGNMENT) == 0);
 
@@ -91,6 +92,57 @@ void doAVXOptSOAToAOS( unsigned numElems,
                        scene_rdl2::alloc::Arena *arena,
                        Ticks *ticks );
 
+void doAVX512RefAOSToSOA( unsigned numElems,
+                          const AOSData *__restrict aosData,
+                          SOABlock16 *__restrict soaBlocks,
+                          SortOrder *sortOrder,
+                          scene_rdl2::alloc::Arena *arena,
+                          Ticks *ticks );
+
+void doAVX512OptAOSToSOA( unsigned numElems,
+                          const AOSData *__restrict aosData,
+                          SOABlock16 *__restrict soaBlocks,
+                          SortOrder *sortOrder,
+                          scene_rdl2::alloc::Arena *arena,
+                          Ticks *ticks );
+
+void doAVX512OptSOAToAOS( unsigned numElems,
+                          const SOABlock16 *__restrict soaBlocks,
+                          AOSData **__restrict aosData,
+                          uint32_t *indices,
+                          scene_rdl2::alloc::Arena *arena,
+                          Ticks *ticks );
+
+// Transposes without sorting, the SOA blocks keep the AOS order.
+void doAVX512UnsortedAOSToSOA( unsigned numElems,
+                               const AOSData *__restrict aosData,
+                               SOABlock16 *__restrict soaBlocks );
+
+void doNEONRefAOSToSOA( unsigned numElems,
+                        const AOSData *__restrict aosData,
+                        SOABlock4 *__restrict soaBlocks,
+                        SortOrder *sortOrder,
+                        scene_rdl2::alloc::Arena *arena,
+                        Ticks *ticks );
+
+void doNEONOptAOSToSOA( unsigned numElems,
+                        const AOSData *__restrict aosData,
+                        SOABlock4 *__restrict soaBlocks,
+                        SortOrder *sortOrder,
+                        scene_rdl2::alloc::Arena *arena,
+                        Ticks *ticks );
+
+void doNEONOptSOAToAOS( unsigned numElems,
+                        const SOABlock4 *__restrict soaBlocks,
+                        AOSData **__restrict aosData,
+                        uint32_t *indices,
+                        scene_rdl2::alloc::Arena *arena,
+                        Ticks *ticks );
+
+void doNEONUnsortedAOSToSOA( unsigned numElems,
+                             const AOSData *__restrict aosData,
+                             SOABlock4 *__restrict soaBlocks );
+
 //----------------------------------------------------------------------------
 
 class TestAosSoa : public CppUnit::TestFixture
@@ -104,11 +156,19 @@ public:
 #ifdef __AVX__
     CPPUNIT_TEST(testAVX);
 #endif
+#ifdef __AVX512F__
+    CPPUNIT_TEST(testAVX512);
+#endif
+#ifdef __ARM_NEON__
+    CPPUNIT_TEST(testNEON);
+#endif
 
     CPPUNIT_TEST_SUITE_END();
 
 private:
     void testAVX();
+    void testAVX512();
+    void testNEON();
 
     scene_rdl2::util::Ref<scene_rdl2::alloc::ArenaBlockPool> mArenaBlockPool;
     scene_rdl2::alloc::Arena mArena;
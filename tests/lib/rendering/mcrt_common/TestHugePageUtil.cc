@@ -0,0 +1,96 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestHugePageUtil.h"
+#include <moonray/rendering/mcrt_common/HugePageUtil.h>
+
+#include <cstring>
+#include <vector>
+
+namespace moonray {
+namespace mcrt_common {
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHugePageUtil);
+
+void
+TestHugePageUtil::testAlloc()
+{
+    // Explicit pages usually aren't reserved on test machines, which exercises the fall back.
+    for (HugePageMode mode : {HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT}) {
+        const size_t size = 3 * HUGE_PAGE_SIZE + 100;
+        HugePageMode usedMode;
+        uint8_t *mem = static_cast<uint8_t *>(allocHugePageBacked(size, mode, &usedMode));
+        CPPUNIT_ASSERT(mem);
+        CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(mem) % HUGE_PAGE_SIZE == 0);
+        if (mode == HugePageMode::OFF) {
+            CPPUNIT_ASSERT(usedMode == HugePageMode::OFF);
+        }
+
+        bool zeroed = true;
+        for (size_t i = 0; i < size; i += 4096) {
+            zeroed = zeroed && mem[i] == 0;
+            mem[i] = 1;
+        }
+        CPPUNIT_ASSERT(zeroed);
+        mem[size - 1] = 1;
+
+        freeHugePageBacked(mem, size);
+    }
+}
+
+void
+TestHugePageUtil::testAdvise()
+{
+    // Nothing 2MB aligned inside.
+    std::vector<uint8_t> small(4096);
+    CPPUNIT_ASSERT(!adviseHugePages(small.data(), small.size()));
+    CPPUNIT_ASSERT(!adviseHugePages(nullptr, 0));
+}
+
+void
+TestHugePageUtil::testReleasePages()
+{
+    const size_t size = 4 * HUGE_PAGE_SIZE;
+    uint8_t *mem = static_cast<uint8_t *>(allocHugePageBacked(size, HugePageMode::OFF));
+    CPPUNIT_ASSERT(mem);
+
+    // Nothing is committed until touched.
+    CPPUNIT_ASSERT(getResidentBytes(mem, size) == 0);
+
+    memset(mem, 7, HUGE_PAGE_SIZE);
+    const size_t resident = getResidentBytes(mem, size);
+    CPPUNIT_ASSERT(resident >= HUGE_PAGE_SIZE && resident <= size);
+
+    CPPUNIT_ASSERT(releasePages(mem, size));
+    CPPUNIT_ASSERT(getResidentBytes(mem, size) == 0);
+    CPPUNIT_ASSERT(mem[0] == 0);
+
+    freeHugePageBacked(mem, size);
+}
+
+void
+TestHugePageUtil::testDtlbMissCounter()
+{
+    const DtlbMissCounter disabled(false);
+    CPPUNIT_ASSERT(!disabled.isValid());
+    uint64_t accesses = 1, misses = 1;
+    disabled.read(accesses, misses);
+    CPPUNIT_ASSERT(accesses == 0 && misses == 0);
+
+    // Perf events may not be available, only check that the counter stays usable.
+    const DtlbMissCounter enabled(true);
+    std::vector<uint8_t> mem(16 * 1024 * 1024, 1);
+    unsigned sum = 0;
+    for (size_t i = 0; i < mem.size(); i += 4096) sum += mem[i];
+    CPPUNIT_ASSERT(sum == mem.size() / 4096);
+    enabled.read(accesses, misses);
+    if (!enabled.isValid()) {
+        CPPUNIT_ASSERT(misses == 0);
+    }
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
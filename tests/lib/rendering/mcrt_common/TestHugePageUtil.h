@@ -0,0 +1,32 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+class TestHugePageUtil : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestHugePageUtil);
+    CPPUNIT_TEST(testAlloc);
+    CPPUNIT_TEST(testAdvise);
+    CPPUNIT_TEST(testReleasePages);
+    CPPUNIT_TEST(testDtlbMissCounter);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    void testAlloc();
+    void testAdvise();
+    void testReleasePages();
+    void testDtlbMissCounter();
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
@@ -0,0 +1,133 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestQueueSizeController.h"
+#include <moonray/rendering/mcrt_common/QueueSizeController.h>
+
+#include <functional>
+
+namespace moonray {
+namespace mcrt_common {
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestQueueSizeController);
+
+namespace {
+
+// Handler cost per entry with a single minimum at optimalSize.
+double
+costPerEntry(unsigned size, double optimalSize)
+{
+    return 100.0 * (optimalSize / double(size) + double(size) / optimalSize);
+}
+
+// Feeds the controller full flushes of a simulated handler until it converges
+// and returns the final queue size.
+unsigned
+runController(QueueSizeController &controller, unsigned size, unsigned maxSize,
+              const std::function<double (unsigned)> &cost, double occupancy = 1.0)
+{
+    QueueFlushStats stats;
+    for (unsigned iter = 0; iter < 100 && !controller.isConverged(); ++iter) {
+        for (unsigned i = 0; i < 16; ++i) {
+            const unsigned numEntries = unsigned(double(size) * occupancy);
+            stats.record(size, numEntries, uint64_t(cost(size) * double(numEntries)));
+        }
+
+        const unsigned newSize = controller.update(stats, maxSize);
+        CPPUNIT_ASSERT(newSize > 0);
+        CPPUNIT_ASSERT(newSize <= maxSize);
+        stats.reset();
+        size = newSize;
+    }
+    return size;
+}
+
+}   // End of anon namespace.
+
+void
+TestQueueSizeController::testFlushStats()
+{
+    QueueFlushStats stats;
+    stats.record(64, 64, 1000);
+    stats.record(64, 32, 500);
+    CPPUNIT_ASSERT_EQUAL(2u, stats.mNumFlushes);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(96), stats.mNumEntries);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1500), stats.mTicks);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.75, stats.getOccupancy(), 1e-9);
+
+    // A flush at a different queue size starts a new window.
+    stats.record(128, 128, 2000);
+    CPPUNIT_ASSERT_EQUAL(128u, stats.mQueueSize);
+    CPPUNIT_ASSERT_EQUAL(1u, stats.mNumFlushes);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(128), stats.mNumEntries);
+
+    // Too few flushes to decide on.
+    QueueSizeController controller;
+    CPPUNIT_ASSERT_EQUAL(0u, controller.update(stats, 1024));
+}
+
+void
+TestQueueSizeController::testConvergence()
+{
+    const double optimalSizes[] = { 64.0, 300.0, 1000.0 };
+    for (double optimalSize : optimalSizes) {
+        QueueSizeController controller;
+        const unsigned size = runController(controller, 1024, 2048,
+            [&](unsigned s) { return costPerEntry(s, optimalSize); });
+
+        CPPUNIT_ASSERT(controller.isConverged());
+        // Within 5% of the optimal cost.
+        CPPUNIT_ASSERT(costPerEntry(size, optimalSize) < costPerEntry(unsigned(optimalSize), optimalSize) * 1.05);
+    }
+
+    // The search stops at the allocated size.
+    QueueSizeController controller;
+    const unsigned size = runController(controller, 256, 1024,
+        [](unsigned s) { return costPerEntry(s, 4096.0); });
+    CPPUNIT_ASSERT_EQUAL(1024u, size);
+}
+
+void
+TestQueueSizeController::testLowOccupancy()
+{
+    // A mostly empty queue never grows, even if the cost says otherwise.
+    QueueSizeController controller;
+    const unsigned size = runController(controller, 512, 2048,
+        [](unsigned s) { return costPerEntry(s, 2048.0); }, 0.25);
+    CPPUNIT_ASSERT(size <= 512u);
+}
+
+void
+TestQueueSizeController::testRestart()
+{
+    QueueSizeController controller;
+    unsigned size = runController(controller, 1024, 2048,
+        [](unsigned s) { return costPerEntry(s, 1024.0); });
+    CPPUNIT_ASSERT(controller.isConverged());
+
+    // Cost stays put, so does the size.
+    QueueFlushStats stats;
+    for (unsigned i = 0; i < 16; ++i) {
+        stats.record(size, size, uint64_t(costPerEntry(size, 1024.0) * double(size)));
+    }
+    CPPUNIT_ASSERT_EQUAL(size, controller.update(stats, 2048));
+    CPPUNIT_ASSERT(controller.isConverged());
+
+    // The workload changes, the search restarts and finds the new minimum.
+    stats.reset();
+    for (unsigned i = 0; i < 16; ++i) {
+        stats.record(size, size, uint64_t(costPerEntry(size, 128.0) * double(size)));
+    }
+    size = controller.update(stats, 2048);
+    CPPUNIT_ASSERT(!controller.isConverged());
+
+    size = runController(controller, size, 2048,
+        [](unsigned s) { return costPerEntry(s, 128.0); });
+    CPPUNIT_ASSERT(costPerEntry(size, 128.0) < costPerEntry(128, 128.0) * 1.05);
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
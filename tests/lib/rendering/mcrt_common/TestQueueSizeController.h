@@ -0,0 +1,32 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+class TestQueueSizeController : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestQueueSizeController);
+    CPPUNIT_TEST(testFlushStats);
+    CPPUNIT_TEST(testConvergence);
+    CPPUNIT_TEST(testLowOccupancy);
+    CPPUNIT_TEST(testRestart);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    void testFlushStats();
+    void testConvergence();
+    void testLowOccupancy();
+    void testRestart();
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
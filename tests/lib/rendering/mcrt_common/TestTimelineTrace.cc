@@ -0,0 +1,132 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestTimelineTrace.h"
+#include <moonray/rendering/mcrt_common/TimelineTrace.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestTimelineTrace);
+
+namespace {
+
+std::string
+writeTrace()
+{
+    std::ostringstream filename;
+    filename << "/tmp/moonray_timeline_trace_test_" << getpid() << ".json";
+    CPPUNIT_ASSERT(TimelineTrace::writeChromeTrace(filename.str()));
+
+    std::ifstream in(filename.str());
+    std::ostringstream content;
+    content << in.rdbuf();
+    std::remove(filename.str().c_str());
+    return content.str();
+}
+
+size_t
+countOccurrences(const std::string &str, const std::string &pattern)
+{
+    size_t count = 0;
+    for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+void
+TestTimelineTrace::tearDown()
+{
+    TimelineTrace::disable();
+}
+
+void
+TestTimelineTrace::testDisabled()
+{
+    TimelineTrace::enable();
+    TimelineTrace::disable();
+    {
+        TimelineScope scope("ignored", "test");
+    }
+    TimelineTrace::record("ignored", "test", 0.0, 1.0);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), TimelineTrace::getNumEvents());
+}
+
+void
+TestTimelineTrace::testThreads()
+{
+    constexpr int numThreads = 4;
+    constexpr int numEvents = 100;
+
+    TimelineTrace::enable();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < numEvents; ++i) {
+                TimelineScope scope("work", "test", "index", i);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    TimelineTrace::setThreadName("main \"test\" thread");
+    TimelineTrace::record("main", "test", 0.0, TimelineTrace::now());
+
+    CPPUNIT_ASSERT_EQUAL(size_t(numThreads * numEvents + 1), TimelineTrace::getNumEvents());
+
+    const std::string trace = writeTrace();
+    CPPUNIT_ASSERT_EQUAL(size_t(numThreads * numEvents), countOccurrences(trace, "\"name\":\"work\""));
+    CPPUNIT_ASSERT_EQUAL(size_t(numThreads * numEvents + 1), countOccurrences(trace, "\"ph\":\"X\""));
+    CPPUNIT_ASSERT_EQUAL(size_t(numThreads + 1), countOccurrences(trace, "\"thread_name\""));
+    CPPUNIT_ASSERT(trace.find("main \\\"test\\\" thread") != std::string::npos);
+    CPPUNIT_ASSERT(trace.find("\"args\":{\"index\":99}") != std::string::npos);
+
+    // Enabling again starts a new trace.
+    TimelineTrace::enable();
+    CPPUNIT_ASSERT_EQUAL(size_t(0), TimelineTrace::getNumEvents());
+}
+
+void
+TestTimelineTrace::testWrapAround()
+{
+    constexpr size_t capacity = 8;
+
+    // Run on a new thread so its buffer is created with the small capacity.
+    TimelineTrace::enable(capacity);
+    std::thread thread([]() {
+        for (int i = 0; i < 20; ++i) {
+            TimelineTrace::record("event", "test", double(i), double(i) + 0.5, "index", i);
+        }
+    });
+    thread.join();
+
+    CPPUNIT_ASSERT_EQUAL(capacity, TimelineTrace::getNumEvents());
+
+    // Only the last events are kept, oldest first.
+    const std::string trace = writeTrace();
+    CPPUNIT_ASSERT(trace.find("\"index\":11}") == std::string::npos);
+    const size_t first = trace.find("\"index\":12}");
+    const size_t last = trace.find("\"index\":19}");
+    CPPUNIT_ASSERT(first != std::string::npos);
+    CPPUNIT_ASSERT(last != std::string::npos);
+    CPPUNIT_ASSERT(first < last);
+}
+
+} // namespace mcrt_common
+} // namespace moonray
+
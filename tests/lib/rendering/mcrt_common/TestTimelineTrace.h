@@ -0,0 +1,32 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#pragma once
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+namespace moonray {
+namespace mcrt_common {
+
+class TestTimelineTrace : public CppUnit::TestFixture
+{
+public:
+    void tearDown();
+
+    CPPUNIT_TEST_SUITE(TestTimelineTrace);
+    CPPUNIT_TEST(testDisabled);
+    CPPUNIT_TEST(testThreads);
+    CPPUNIT_TEST(testWrapAround);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    void testDisabled();
+    void testThreads();
+    void testWrapAround();
+};
+
+} // namespace mcrt_common
+} // namespace moonray
+
@@ -0,0 +1,284 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file TestBsdfPerf.cc
+
+#include "BsdfFactory.h"
+#include "TestBsdfPerf.h"
+#include "TestUtil.h"
+#include "TestBsdf_ispc_stubs.h"
+
+#include <moonray/common/time/Timer.h>
+#include <moonray/rendering/mcrt_common/ThreadLocalState.h>
+#include <moonray/rendering/shading/Util.h>
+#include <moonray/rendering/shading/bsdf/Bsdf.h>
+#include <moonray/rendering/shading/bsdf/BsdfSlice.h>
+
+#include <scene_rdl2/common/math/Color.h>
+#include <scene_rdl2/common/math/ReferenceFrame.h>
+#include <scene_rdl2/render/util/Random.h>
+
+#include <cmath>
+#include <vector>
+
+namespace moonray {
+namespace pbr {
+
+using namespace scene_rdl2::math;
+
+//----------------------------------------------------------------------------
+
+// Enough calls per measurement to dwarf the timer resolution while keeping
+// the whole suite to a few seconds.
+static const int sCallCount = 1 << 16;
+static const float sRoughness = 0.4f;
+
+static double
+callsPerSecond(int count, double seconds)
+{
+    return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+void
+TestBsdfPerf::timeBsdf(const char *name, const BsdfFactory &factory)
+{
+    printInfo("##### TestBsdfPerf::%s() ####################", name);
+
+    mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
+    scene_rdl2::alloc::Arena &arena = tls->mArena;
+    SCOPED_MEM(&arena);
+
+    const ReferenceFrame frame;
+    const Vec3f &Ng = frame.getN();
+    // 45 degrees off the normal, away from the grazing angles some lobes
+    // special case.
+    const Vec3f wo = normalize(frame.getX() + frame.getN());
+
+    // Draw all the inputs up front so only the lobe calls are timed.
+    scene_rdl2::util::Random random(2285938u, 185283u);
+    std::vector<float> r1(sCallCount);
+    std::vector<float> r2(sCallCount);
+    std::vector<Vec3f> wi(sCallCount);
+    for (int i = 0; i < sCallCount; ++i) {
+        r1[i] = random.getNextFloat();
+        r2[i] = random.getNextFloat();
+        wi[i] = shading::sampleSphereUniform(random.getNextFloat(), random.getNextFloat());
+    }
+    std::vector<Color> f(sCallCount);
+    std::vector<float> pdf(sCallCount);
+
+    const shading::Bsdf *bsdf = factory(arena, frame);
+    const shading::BsdfSlice slice(Ng, wo, true, true, ispc::SHADOW_TERMINATOR_FIX_OFF);
+
+    ispc::TestBsdfTiming test;
+    test.mBsdf = factory.getBsdfv(arena, frame);
+    test.mCount = sCallCount;
+    test.mR1 = r1.data();
+    test.mR2 = r2.data();
+    test.mWi = (const ispc::Vec3f *) wi.data();
+    test.mNg = *((const ispc::Vec3f *) &Ng);
+    test.mWo = *((const ispc::Vec3f *) &wo);
+
+    const int lobeCount = bsdf->getLobeCount();
+    CPPUNIT_ASSERT(lobeCount == test.mBsdf->mNumLobes);
+
+    for (int lobeIndex = 0; lobeIndex < lobeCount; ++lobeIndex) {
+        const shading::BsdfLobe *lobe = bsdf->getLobe(lobeIndex);
+        float checksum = 0.0f;
+
+        double timeSample = 0.0;
+        {
+            time::TimerDouble timer(timeSample);
+            timer.start();
+            for (int i = 0; i < sCallCount; ++i) {
+                Vec3f dir;
+                const Color c = lobe->sample(slice, r1[i], r2[i], dir, pdf[i]);
+                checksum += c.r + c.g + c.b + pdf[i];
+            }
+            timer.stop();
+        }
+
+        double timeEval = 0.0;
+        {
+            time::TimerDouble timer(timeEval);
+            timer.start();
+            for (int i = 0; i < sCallCount; ++i) {
+                const Color c = lobe->eval(slice, wi[i]);
+                checksum += c.r + c.g + c.b;
+            }
+            timer.stop();
+        }
+
+        double timeEvalPdf = 0.0;
+        {
+            time::TimerDouble timer(timeEvalPdf);
+            timer.start();
+            for (int i = 0; i < sCallCount; ++i) {
+                const Color c = lobe->eval(slice, wi[i], &pdf[i]);
+                checksum += c.r + c.g + c.b + pdf[i];
+            }
+            timer.stop();
+        }
+
+        double timeEvalBatch = 0.0;
+        {
+            time::TimerDouble timer(timeEvalBatch);
+            timer.start();
+            lobe->evalBatch(slice, sCallCount, wi.data(), f.data(), pdf.data());
+            timer.stop();
+            checksum += f[sCallCount - 1].r + pdf[sCallCount - 1];
+        }
+
+        test.mLobeIndex = lobeIndex;
+
+        double timeSamplev = 0.0;
+        {
+            time::TimerDouble timer(timeSamplev);
+            test.mOperation = ispc::TEST_BSDF_TIMING_SAMPLE;
+            timer.start();
+            ispc::TestBsdf_timeLobe(&test);
+            timer.stop();
+            checksum += test.mChecksum;
+        }
+
+        double timeEvalv = 0.0;
+        {
+            time::TimerDouble timer(timeEvalv);
+            test.mOperation = ispc::TEST_BSDF_TIMING_EVAL;
+            timer.start();
+            ispc::TestBsdf_timeLobe(&test);
+            timer.stop();
+            checksum += test.mChecksum;
+        }
+
+        double timeEvalPdfv = 0.0;
+        {
+            time::TimerDouble timer(timeEvalPdfv);
+            test.mOperation = ispc::TEST_BSDF_TIMING_EVAL_PDF;
+            timer.start();
+            ispc::TestBsdf_timeLobe(&test);
+            timer.stop();
+            checksum += test.mChecksum;
+        }
+
+        printInfo("----- lobe %d (%d calls, ispc width %d) -----",
+                  lobeIndex, sCallCount, ispc::TestBsdf_getTimingWidth());
+        printInfo(" scalar sample    = %10.0f calls/s", callsPerSecond(sCallCount, timeSample));
+        printInfo(" scalar eval      = %10.0f calls/s", callsPerSecond(sCallCount, timeEval));
+        printInfo(" scalar eval+pdf  = %10.0f calls/s", callsPerSecond(sCallCount, timeEvalPdf));
+        printInfo(" scalar evalBatch = %10.0f calls/s", callsPerSecond(sCallCount, timeEvalBatch));
+        printInfo(" ispc sample      = %10.0f calls/s", callsPerSecond(sCallCount, timeSamplev));
+        printInfo(" ispc eval        = %10.0f calls/s", callsPerSecond(sCallCount, timeEvalv));
+        printInfo(" ispc eval+pdf    = %10.0f calls/s", callsPerSecond(sCallCount, timeEvalPdfv));
+
+        // The lobes return finite values for any input, a nan or inf here
+        // means one of the timed paths did something other than intended.
+        testAssert(std::isfinite(checksum), "lobe %d returned non finite values", lobeIndex);
+    }
+}
+
+//----------------------------------------------------------------------------
+
+void TestBsdfPerf::setUp()
+{
+    setupThreadLocalData();
+}
+
+void TestBsdfPerf::tearDown()
+{
+    cleanupThreadLocalData();
+}
+
+//----------------------------------------------------------------------------
+
+void
+TestBsdfPerf::testLambert()
+{
+    timeBsdf("testLambert", LambertBsdfFactory());
+}
+
+void
+TestBsdfPerf::testCookTorrance()
+{
+    timeBsdf("testCookTorrance", CookTorranceBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testGGXCookTorrance()
+{
+    timeBsdf("testGGXCookTorrance", GGXCookTorranceBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testAnisoCookTorrance()
+{
+    timeBsdf("testAnisoCookTorrance", AnisoCookTorranceBsdfFactory(sRoughness, 0.5f * sRoughness));
+}
+
+void
+TestBsdfPerf::testTransmissionCookTorrance()
+{
+    timeBsdf("testTransmissionCookTorrance", TransmissionCookTorranceBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testRetroreflection()
+{
+    timeBsdf("testRetroreflection", RetroreflectionBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testDwaFabric()
+{
+    timeBsdf("testDwaFabric", DwaFabricBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testAshikminhShirley()
+{
+    timeBsdf("testAshikminhShirley", AshikminhShirleyBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testWardCorrected()
+{
+    timeBsdf("testWardCorrected", WardCorrectedBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testHairDiffuse()
+{
+    timeBsdf("testHairDiffuse", HairDiffuseBsdfFactory());
+}
+
+void
+TestBsdfPerf::testHairR()
+{
+    timeBsdf("testHairR", HairRBsdfFactory(sRoughness, 0.0f));
+}
+
+void
+TestBsdfPerf::testHairTT()
+{
+    timeBsdf("testHairTT", HairTTBsdfFactory(sRoughness, 0.5f, 0.0f));
+}
+
+void
+TestBsdfPerf::testTwoLobes()
+{
+    timeBsdf("testTwoLobes", TwoLobeBsdfFactory(sRoughness));
+}
+
+void
+TestBsdfPerf::testThreeLobes()
+{
+    timeBsdf("testThreeLobes", ThreeLobeBsdfFactory(0.2f, sRoughness));
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace pbr
+} // namespace moonray
+
+CPPUNIT_TEST_SUITE_REGISTRATION(moonray::pbr::TestBsdfPerf);
+
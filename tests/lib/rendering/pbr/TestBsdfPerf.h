@@ -0,0 +1,80 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+/// @file TestBsdfPerf.h
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+namespace moonray {
+namespace pbr {
+
+class BsdfFactory;
+
+///
+/// @class TestBsdfPerf TestBsdfPerf.h <pbr/unittest/TestBsdfPerf.h>
+/// @brief Measures the sample() and eval() throughput of each bsdf lobe, for
+/// both the scalar and the vectorized code paths, on fixed random inputs.
+/// The vectorized numbers are for the ispc target this test was built with.
+///
+class TestBsdfPerf : public CppUnit::TestFixture
+{
+public:
+    void setUp();
+    void tearDown();
+
+    CPPUNIT_TEST_SUITE(TestBsdfPerf);
+    CPPUNIT_TEST(testLambert);
+
+    CPPUNIT_TEST(testCookTorrance);
+    CPPUNIT_TEST(testGGXCookTorrance);
+    CPPUNIT_TEST(testAnisoCookTorrance);
+    CPPUNIT_TEST(testTransmissionCookTorrance);
+
+    CPPUNIT_TEST(testRetroreflection);
+
+    CPPUNIT_TEST(testDwaFabric);
+
+    CPPUNIT_TEST(testAshikminhShirley);
+
+    CPPUNIT_TEST(testWardCorrected);
+
+    CPPUNIT_TEST(testHairDiffuse);
+    CPPUNIT_TEST(testHairR);
+    CPPUNIT_TEST(testHairTT);
+
+    CPPUNIT_TEST(testTwoLobes);
+    CPPUNIT_TEST(testThreeLobes);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testLambert();
+
+    void testCookTorrance();
+    void testGGXCookTorrance();
+    void testAnisoCookTorrance();
+    void testTransmissionCookTorrance();
+
+    void testRetroreflection();
+
+    void testDwaFabric();
+
+    void testAshikminhShirley();
+
+    void testWardCorrected();
+
+    void testHairDiffuse();
+    void testHairR();
+    void testHairTT();
+
+    void testTwoLobes();
+    void testThreeLobes();
+
+private:
+    void timeBsdf(const char *name, const BsdfFactory &factory);
+};
+
+} // namespace pbr
+} // namespace moonray
+
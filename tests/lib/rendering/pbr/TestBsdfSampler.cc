@@ -18,6 +18,7 @@
 #include <moonray/rendering/pbr/core/PbrTLState.h>
 #include <moonray/rendering/shading/bsdf/Bsdf.h>
 #include <moonray/rendering/shading/bsdf/BsdfSlice.h>
+#include <moonray/rendering/shading/Util.h>
 
 #include <scene_rdl2/common/math/Color.h>
 #include <scene_rdl2/render/util/Random.h>
@@ -581,6 +582,63 @@ TestBsdfSampler::testUnderClearcoatCookTorrance()
         }
     }
 }
+
+//----------------------------------------------------------------------------
+
+static void
+testLobesEvalBatch(const BsdfFactory &factory, const scene_rdl2::math::ReferenceFrame &frame)
+{
+    static const int sDirCount = 32;
+
+    mcrt_common::ThreadLocalState *tls = mcrt_common::getFrameUpdateTLS();
+    scene_rdl2::alloc::Arena *arena = &tls->mArena;
+    SCOPED_MEM(arena);
+
+    scene_rdl2::util::Random random(0x2f3ab1u);
+    const shading::Bsdf *bsdf = factory(*arena, frame);
+
+    for (int view = 0; view < 8; ++view) {
+        const scene_rdl2::math::Vec3f wo = frame.localToGlobal(
+            shading::sampleLocalHemisphereCosine(random.getNextFloat(), random.getNextFloat()));
+        shading::BsdfSlice slice(frame.getN(), wo, true, true, ispc::SHADOW_TERMINATOR_FIX_OFF);
+
+        scene_rdl2::math::Vec3f wi[sDirCount];
+        for (int i = 0; i < sDirCount; ++i) {
+            wi[i] = shading::sampleSphereUniform(random.getNextFloat(), random.getNextFloat());
+        }
+
+        for (int l = 0; l < bsdf->getLobeCount(); ++l) {
+            const shading::BsdfLobe *lobe = bsdf->getLobe(l);
+            scene_rdl2::math::Color f[sDirCount];
+            float pdf[sDirCount];
+            lobe->evalBatch(slice, sDirCount, wi, f, pdf);
+
+            for (int i = 0; i < sDirCount; ++i) {
+                float expectedPdf;
+                const scene_rdl2::math::Color expected = lobe->eval(slice, wi[i], &expectedPdf);
+                const float tolerance = 1e-5f * (1.0f + scene_rdl2::math::abs(expectedPdf));
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedPdf, pdf[i], tolerance);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.r, f[i].r, 1e-5f * (1.0f + expected.r));
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.g, f[i].g, 1e-5f * (1.0f + expected.g));
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.b, f[i].b, 1e-5f * (1.0f + expected.b));
+            }
+        }
+    }
+}
+
+void
+TestBsdfSampler::testEvalBatch()
+{
+    scene_rdl2::math::ReferenceFrame frame;
+
+    printInfo("##### TestBsdfSampler::testEvalBatch() ####################");
+    testLobesEvalBatch(LambertBsdfFactory(), frame);
+    for (int i=0; i < sRoughnessCount; i++) {
+        testLobesEvalBatch(GGXCookTorranceBsdfFactory(sRoughness[i]), frame);
+        testLobesEvalBatch(TwoLobeBsdfFactory(sRoughness[i]), frame);
+    }
+}
+
 //----------------------------------------------------------------------------
 
 } // namespace pbr
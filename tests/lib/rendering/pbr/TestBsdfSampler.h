@@ -64,6 +64,8 @@ public:
 
     CPPUNIT_TEST(testUnderClearcoatLambert);
     CPPUNIT_TEST(testUnderClearcoatCookTorrance);
+
+    CPPUNIT_TEST(testEvalBatch);
 #endif
 
     CPPUNIT_TEST_SUITE_END();
@@ -101,6 +103,8 @@ public:
 
     void testUnderClearcoatLambert();
     void testUnderClearcoatCookTorrance();
+
+    void testEvalBatch();
 };
 
 
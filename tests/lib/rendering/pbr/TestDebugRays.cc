@@ -274,6 +274,73 @@ TestDebugRays::testSerialization()
 
 //----------------------------------------------------------------------------
 
+void
+TestDebugRays::testStreaming()
+{
+    char const *prefix = "unittest_stream";
+    const uint32_t numPaths = 20000;
+    const uint32_t numVertsPerPath = 5;
+
+    // record 1 in 3 paths, enough of them to be streamed in several chunks
+    pbr::DebugRayRecorder::enableRecording(
+        scene_rdl2::math::BBox2i(
+            scene_rdl2::math::Vec2i(0, 0), scene_rdl2::math::Vec2i(WIDTH - 1, HEIGHT - 1)),
+        scene_rdl2::math::Mat4f(scene_rdl2::math::one), 0x100000, 3, prefix);
+
+    size_t numVertices = 0;
+    {
+        DebugRayRecorder recorder(0);
+        for (uint32_t i = 0; i < numPaths; ++i) {
+            DebugRayVertex *vertex = recorder.startNewRay(Vec3f(scene_rdl2::math::zero),
+                                                          i % WIDTH, (i / WIDTH) % HEIGHT);
+            for (uint32_t depth = 1; depth < numVertsPerPath; ++depth) {
+                vertex = recorder.extendRay(vertex);
+            }
+        }
+        recorder.stopRecording();
+
+        numVertices = recorder.getNumRayVertices();
+        CPPUNIT_ASSERT(recorder.getNumStreamedRayVertices() == numVertices);
+        CPPUNIT_ASSERT(recorder.getNumBufferedRayVertices() == 0);
+    }
+
+    DebugRayRecorder::disableRecording();
+
+    const uint32_t numSampledPaths = (numPaths + 2) / 3;
+    CPPUNIT_ASSERT(numVertices == numSampledPaths * numVertsPerPath);
+
+    // read back
+    std::string fileName = DebugRayRecorder::getStreamFileName(prefix, 0);
+    std::vector<DebugRayVertex> vertices;
+    size_t numChunks = 0;
+    {
+        DebugRayStreamReader reader;
+        CPPUNIT_ASSERT(reader.open(fileName.c_str()));
+        CPPUNIT_ASSERT(reader.getThreadId() == 0);
+        while (reader.readChunk(&vertices)) {
+            ++numChunks;
+        }
+    }
+    std::remove(fileName.c_str());
+
+    CPPUNIT_ASSERT(numChunks > 1);
+    CPPUNIT_ASSERT(vertices.size() == numVertices);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        CPPUNIT_ASSERT(vertices[i].mId == i);
+    }
+
+    // the streamed vertices build the same way as recorded ones
+    DebugRayBuilder builder;
+    CPPUNIT_ASSERT(builder.build(WIDTH, HEIGHT, &vertices, Mat4f(scene_rdl2::math::one)));
+
+    DebugRayDatabase db;
+    CPPUNIT_ASSERT(builder.exportDatabase(&db));
+    CPPUNIT_ASSERT(db.getPrimaryRayIndices().size() == numSampledPaths);
+    CPPUNIT_ASSERT(db.getRays().size() == numVertices);
+}
+
+//----------------------------------------------------------------------------
+
 void
 TestDebugRays::populateRecorder(DebugRayRecorder *recorder)
 {
@@ -19,6 +19,7 @@ class TestDebugRays : public CppUnit::TestFixture
     CPPUNIT_TEST(testRectFilter);
     CPPUNIT_TEST(testTagFilter);
     CPPUNIT_TEST(testSerialization);
+    CPPUNIT_TEST(testStreaming);
 #endif
     CPPUNIT_TEST_SUITE_END();
 
@@ -31,6 +32,7 @@ public:
     void testRectFilter();
     void testTagFilter();
     void testSerialization();
+    void testStreaming();
 
 private:
     void populateRecorder(DebugRayRecorder *recorder);
@@ -12,6 +12,7 @@
 
 #include <moonray/rendering/pbr/core/Distribution.h>
 #include <moonray/rendering/pbr/sampler/IntegratorSample.h>
+#include <moonray/common/time/Timer.h>
 
 #include <scene_rdl2/common/except/exceptions.h>
 #include <scene_rdl2/common/math/MathUtil.h>
@@ -188,6 +189,56 @@ TestDistribution::testImages()
     testImage(path, "parking_lot-vvsmall.exr");
 }
 
+void
+TestDistribution::testSpeed()
+{
+    fprintf(stderr, "=========================== Timing Distribution2D ==============================\n");
+
+    // The size of a typical environment map
+    static const int sizeU = 4096;
+    static const int sizeV = 2048;
+    static const int sampleCount = 1 << 20;
+
+    FloatArray r1, r2;
+    generate2DSequence(sampleCount, r1, r2);
+    FloatArray u, v;
+
+    for (int run = 0; run < 2; ++run) {
+        double timeBuild = 0.0;
+        time::TimerDouble timerBuild(timeBuild);
+        timerBuild.start();
+        Distribution2D dist(sizeU, sizeV);
+        for (int y = 0; y < sizeV; ++y) {
+            for (int x = 0; x < sizeU; ++x) {
+                dist.setWeight(x, y, 1.0f + float((x * 7 + y * 13) % 256));
+            }
+        }
+        dist.tabulateCdf(Distribution2D::SPHERICAL);
+        timerBuild.stop();
+
+        double timeCpp = 0.0;
+        time::TimerDouble timerCpp(timeCpp);
+        timerCpp.start();
+        sampleDistribution2D(dist, r1, r2, u, v);
+        timerCpp.stop();
+
+        double timeIspc = 0.0;
+        time::TimerDouble timerIspc(timeIspc);
+        timerIspc.start();
+        const bool equal = asCppBool(ispc::sampleDistribution2D(dist.asIspc(), sampleCount,
+                &(r1[0]), &(r2[0]), &(u[0]), &(v[0])));
+        timerIspc.stop();
+
+        // The first run includes the cost of first touching the memory
+        printInfo(" run %d: %dx%d", run, sizeU, sizeV);
+        printInfo("   build: %f sec", timeBuild);
+        printInfo("   c++  : %.0f samples/sec", sampleCount / timeCpp);
+        printInfo("   ispc : %.0f samples/sec", sampleCount / timeIspc);
+
+        CPPUNIT_ASSERT(equal);
+    }
+}
+
 namespace
 {
     template <typename Iter>
@@ -33,6 +33,7 @@ public:
     CPPUNIT_TEST(testGradient);
     CPPUNIT_TEST(testImages);
     CPPUNIT_TEST(testDiscrete);
+    CPPUNIT_TEST(testSpeed);
 #endif
     CPPUNIT_TEST_SUITE_END();
 
@@ -40,6 +41,7 @@ public:
     void testGradient();
     void testImages();
     void testDiscrete();
+    void testSpeed();
 
 private:
     void testImage(const std::string &path, const std::string &filename);
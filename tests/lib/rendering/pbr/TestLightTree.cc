@@ -2,9 +2,20 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "TestLightTree.h"
+#include "TestUtil.h"
+#include "TestLightTree_ispc_stubs.h"
 
+#include <moonray/rendering/pbr/light/LightTree.h>
 #include <moonray/rendering/pbr/light/LightTreeUtil.h>
 #include <moonray/rendering/pbr/light/LightTreeUtil.cc>
+#include <moonray/rendering/pbr/light/SphereLight.h>
+
+#include <moonray/common/time/Timer.h>
+
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
 
 namespace moonray {
 namespace pbr {
@@ -107,6 +118,142 @@ void TestLightTree::testCone()
     }
 }
 
+void TestLightTree::testSamplingSpeed()
+{
+    fprintf(stderr, "=========================== Timing LightTree sampling ===========================\n");
+
+    scene_rdl2::rdl2::SceneContext context;
+    context.setDsoPath(RDL2DSO_PATH);
+
+    // A grid of sphere lights above the shading points, large enough for a deep tree
+    const int gridSize = 32;
+    const int lightCount = gridSize * gridSize;
+    std::vector<std::unique_ptr<Light>> lights;
+    std::vector<const Light*> lightPtrs;
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            const std::string name = "SphereLight_" + std::to_string(z * gridSize + x);
+            const Mat4f xform = Mat4f::translate(Vec4f(x * 2.f, 4.f, z * 2.f, 0.f));
+            const Color color = Color(1.f + (x % 3), 1.f + (z % 5), 1.f);
+            lights.emplace_back(new SphereLight(makeSphereLightSceneObject(name.c_str(), &context, xform, color,
+                                                                           0.5f, nullptr, false)));
+            lights.back()->update(Mat4d(one));
+            lightPtrs.push_back(lights.back().get());
+        }
+    }
+
+    std::vector<int> lightIdMap(lightCount);
+    std::iota(lightIdMap.begin(), lightIdMap.end(), 0);
+
+    const int sampleCount = 1 << 16;
+    std::vector<float> lightSelectionPdfs(lightCount);
+    // lightCount varying floats for the ispc side, 16 is the widest vector we build for
+    FloatArray scratch(lightCount * 16);
+
+    for (float samplingThreshold : { 0.f, 0.25f, 0.75f }) {
+        LightTree lightTree(samplingThreshold);
+        lightTree.build(lightPtrs.data(), lightCount, nullptr, 0);
+
+        double timeCpp = 0.0;
+        time::TimerDouble timerCpp(timeCpp);
+        timerCpp.start();
+        int chosenCountCpp = 0;
+        for (int s = 0; s < sampleCount; ++s) {
+            std::fill(lightSelectionPdfs.begin(), lightSelectionPdfs.end(), -1.f);
+            const IntegratorSample1D lightSelectionSample(SequenceID(s, 97u, 89u));
+            const Vec3f P(float(s % 256) * 0.25f, 0.f, float((s / 256) % 256) * 0.25f);
+            const Vec3f N(0.f, 1.f, 0.f);
+            lightTree.sample(lightSelectionPdfs.data(), P, N, nullptr, lightSelectionSample, lightIdMap.data(),
+                             /* nonMirrorDepth */ 0);
+            for (float pdf : lightSelectionPdfs) {
+                chosenCountCpp += (pdf > 0.f);
+            }
+        }
+        timerCpp.stop();
+
+        double timeIspc = 0.0;
+        time::TimerDouble timerIspc(timeIspc);
+        timerIspc.start();
+        const int chosenCountIspc =
+            ispc::testLightTreeSample(reinterpret_cast<const ispc::LightTree *>(&lightTree), lightIdMap.data(),
+                                      lightCount, scratch.data(), sampleCount);
+        timerIspc.stop();
+
+        printInfo(" threshold %.2f: %d lights, %d samples", samplingThreshold, lightCount, sampleCount);
+        printInfo("   c++  : %.0f samples/sec, %f lights per sample",
+                  sampleCount / timeCpp, float(chosenCountCpp) / sampleCount);
+        printInfo("   ispc : %.0f samples/sec, %f lights per sample",
+                  sampleCount / timeIspc, float(chosenCountIspc) / sampleCount);
+
+        // Every sample chooses at least one light
+        CPPUNIT_ASSERT(chosenCountCpp >= sampleCount);
+        CPPUNIT_ASSERT(chosenCountIspc >= sampleCount);
+    }
+}
+
+void TestLightTree::testRefit()
+{
+    fprintf(stderr, "=========================== Testing LightTree refit =============================\n");
+
+    scene_rdl2::rdl2::SceneContext context;
+    context.setDsoPath(RDL2DSO_PATH);
+
+    const int gridSize = 8;
+    const int lightCount = gridSize * gridSize;
+    std::vector<scene_rdl2::rdl2::Light*> rdlLights;
+    std::vector<std::unique_ptr<Light>> lights;
+    std::vector<const Light*> lightPtrs;
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            const std::string name = "SphereLight_" + std::to_string(z * gridSize + x);
+            const Mat4f xform = Mat4f::translate(Vec4f(x * 2.f, 4.f, z * 2.f, 0.f));
+            rdlLights.push_back(makeSphereLightSceneObject(name.c_str(), &context, xform, sWhite, 0.5f, nullptr,
+                                                           false));
+            lights.emplace_back(new SphereLight(rdlLights.back()));
+            lights.back()->update(Mat4d(one));
+            lightPtrs.push_back(lights.back().get());
+        }
+    }
+
+    LightTree lightTree(/* samplingThreshold */ 0.f);
+    lightTree.build(lightPtrs.data(), lightCount, nullptr, 0);
+
+    const auto moveLight = [&](uint32_t lightIndex, const Vec3f& position) {
+        scene_rdl2::rdl2::SceneObject* object = rdlLights[lightIndex];
+        object->beginUpdate();
+        object->set<scene_rdl2::rdl2::Mat4d>(scene_rdl2::rdl2::Node::sNodeXformKey,
+            toDouble(Mat4f::translate(Vec4f(position.x, position.y, position.z, 0.f))));
+        object->endUpdate();
+        lights[lightIndex]->update(Mat4d(one));
+    };
+
+    // Does a ray straight down onto p reach the light through the tree bounds?
+    const auto reachesLight = [&](uint32_t lightIndex, const Vec3f& p) {
+        bool reached = false;
+        lightTree.intersectBounds(p + Vec3f(0.f, 10.f, 0.f), Vec3f(0.f, -1.f, 0.f), 20.f,
+                                  [&](int index) { reached |= (uint32_t(index) == lightIndex); });
+        return reached;
+    };
+
+    // A light nudged within the grid, the tree bounds follow it and the tree stays good
+    const Vec3f nudged(3.f, 4.5f, 3.f);
+    moveLight(0, nudged);
+    CPPUNIT_ASSERT(lightTree.refit({ 0 }));
+    CPPUNIT_ASSERT(reachesLight(0, nudged));
+
+    // A light thrown far off the grid, the tree bounds still follow it but the tree has degraded past
+    // the rebuild threshold
+    const Vec3f thrown(1000.f, -500.f, 1000.f);
+    moveLight(lightCount - 1, thrown);
+    CPPUNIT_ASSERT(!lightTree.refit({ uint32_t(lightCount - 1) }));
+    CPPUNIT_ASSERT(reachesLight(lightCount - 1, thrown));
+
+    // Rebuilt, the tree is good again
+    lightTree.build(lightPtrs.data(), lightCount, nullptr, 0);
+    CPPUNIT_ASSERT(lightTree.refit({ uint32_t(lightCount - 1) }));
+    CPPUNIT_ASSERT(reachesLight(lightCount - 1, thrown));
+}
+
 }
 }
 CPPUNIT_TEST_SUITE_REGISTRATION(moonray::pbr::TestLightTree);
@@ -18,11 +18,15 @@ class TestLightTree : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE(TestLightTree);
 
     CPPUNIT_TEST(testCone);
+    CPPUNIT_TEST(testSamplingSpeed);
+    CPPUNIT_TEST(testRefit);
 
     CPPUNIT_TEST_SUITE_END();
 
 public:
     void testCone();
+    void testSamplingSpeed();
+    void testRefit();
 };
 
 //----------------------------------------------------------------------------
@@ -779,6 +779,81 @@ void TestSampler::testSamplePartition()
     CPPUNIT_ASSERT_EQUAL(kTestDimensions*kTestDimensions, static_cast<int>(ids.size()));
 }
 
+void TestSampler::testExternalSamplePartition()
+{
+    // A partition over the built samples of another, as when they are mapped
+    // from a table image, must sample identically.
+    std::vector<TestPoint> input;
+    scene_rdl2::util::Random rng(0x1234);
+    for (int i = 0; i < kTestDimensions*kTestDimensions*8; ++i) {
+        input.push_back({ rng.getNextFloat(), rng.getNextFloat(), 0, 0, static_cast<char>('a' + i % 26) });
+    }
+
+    using Partition = SpatialSamplePartition<TestPoint, kTestDimensions>;
+    Partition built(input.cbegin(), input.cend());
+    CPPUNIT_ASSERT_EQUAL(Partition::buildSize(static_cast<int>(input.size())), built.size());
+
+    const std::vector<TestPoint> image(built.data(), built.data() + built.size());
+    Partition external(image.data(), static_cast<int>(image.size()), sp::ExternalStorage());
+    CPPUNIT_ASSERT_EQUAL(built.numPixelSamples(), external.numPixelSamples());
+
+    for (int r = 0; r < kTestDimensions*kTestDimensions; ++r) {
+        built.rotate(r);
+        external.rotate(r);
+        for (int y = 0; y < kTestDimensions; ++y) {
+            for (int x = 0; x < kTestDimensions; ++x) {
+                for (int n = 0; n < built.numPixelSamples(); ++n) {
+                    CPPUNIT_ASSERT_EQUAL(built(x, y, n).x, external(x, y, n).x);
+                    CPPUNIT_ASSERT_EQUAL(built(x, y, n).y, external(x, y, n).y);
+                    CPPUNIT_ASSERT_EQUAL(built(x, y, n).id, external(x, y, n).id);
+                }
+            }
+        }
+    }
+}
+
+void TestSampler::testPartitionForEachSample()
+{
+    // The batched lookups must return the same samples, in the same order, as
+    // looking each sample up on its own.
+    std::vector<TestPoint> input;
+    scene_rdl2::util::Random rng(0x4321);
+    for (int i = 0; i < kTestDimensions*kTestDimensions*8; ++i) {
+        input.push_back({ rng.getNextFloat(), rng.getNextFloat(), 0, 0, static_cast<char>('a' + i % 26) });
+    }
+
+    SpatialSamplePartition<TestPoint, kTestDimensions> spatial(input.cbegin(), input.cend());
+    SamplePartition<TestPoint, 3*3, 8> sets(input.cbegin(), input.cbegin() + 3*3*8);
+
+    for (int r = 0; r < 9; ++r) {
+        spatial.rotate(r);
+        sets.rotate(r);
+        for (int y = 0; y < kTestDimensions; ++y) {
+            for (int x = 0; x < kTestDimensions; ++x) {
+                for (int n = 0; n < 8; ++n) {
+                    const int count = 8 - n;
+                    int calls = 0;
+                    spatial.forEachSample(x, y, n, count, [&](sp::size_type i, const TestPoint& s) {
+                        CPPUNIT_ASSERT_EQUAL(calls++, static_cast<int>(i));
+                        CPPUNIT_ASSERT_EQUAL(spatial(x, y, n + i).id, s.id);
+                    });
+                    CPPUNIT_ASSERT_EQUAL(count, calls);
+
+                    calls = 0;
+                    sets.forEachSample(x, y, n, count, [&](sp::size_type i, const TestPoint& s) {
+                        CPPUNIT_ASSERT_EQUAL(calls++, static_cast<int>(i));
+                        const TestPoint expected = sets(x, y, n + i);
+                        CPPUNIT_ASSERT_EQUAL(expected.x, s.x);
+                        CPPUNIT_ASSERT_EQUAL(expected.y, s.y);
+                        CPPUNIT_ASSERT_EQUAL(expected.id, s.id);
+                    });
+                    CPPUNIT_ASSERT_EQUAL(count, calls);
+                }
+            }
+        }
+    }
+}
+
 } // namespace pbr
 } // namespace moonray
 
@@ -33,6 +33,8 @@ public:
     CPPUNIT_TEST(testISPCSequenceID);
     CPPUNIT_TEST(testISCPPermutations);
     CPPUNIT_TEST(testSamplePartition);
+    CPPUNIT_TEST(testExternalSamplePartition);
+    CPPUNIT_TEST(testPartitionForEachSample);
 #endif
     CPPUNIT_TEST_SUITE_END();
 
@@ -44,6 +46,8 @@ public:
     void testISPCSequenceID();
     void testISCPPermutations();
     void testSamplePartition();
+    void testExternalSamplePartition();
+    void testPartitionForEachSample();
 
 public:
     void setUp();
@@ -0,0 +1,99 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "TestAdaptiveConvergenceEstimator.h"
+#include <moonray/rendering/rndr/adaptive/AdaptiveConvergenceEstimator.h>
+
+#include <cmath>
+#include <limits>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+// Monte Carlo convergence, the error halves when the time quadruples.
+float
+mcError(double t)
+{
+    return float(0.1 / std::sqrt(t));
+}
+
+} // anonymous namespace
+
+void
+TestAdaptiveConvergenceEstimator::testPrediction()
+{
+    AdaptiveConvergenceEstimator estimator;
+    estimator.reset(100.0, 0.01f, 0.0f);
+
+    // Not evaluated yet, and too early to predict.
+    CPPUNIT_ASSERT(!estimator.update(101.0, std::numeric_limits<float>::max()));
+    for (int i = 1; i < 4; ++i) {
+        CPPUNIT_ASSERT(!estimator.update(100.0 + i, mcError(i)));
+    }
+    CPPUNIT_ASSERT(!estimator.hasPrediction());
+
+    // Too close to the previous measurement, ignored.
+    CPPUNIT_ASSERT(!estimator.update(103.5, 1.0f));
+    CPPUNIT_ASSERT(!estimator.hasPrediction());
+
+    for (int i = 4; i <= 20; ++i) {
+        CPPUNIT_ASSERT(!estimator.update(100.0 + i, mcError(i)));
+    }
+    CPPUNIT_ASSERT(estimator.hasPrediction());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, estimator.getDecayExponent(), 1e-3);
+    // 0.1 / sqrt(t) = 0.01 at t = 100.
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(80.0, estimator.getPredictedSecToTarget(), 0.5);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0 - std::sqrt(20.0 / 80.0), estimator.getErrorGainPerMinute(), 1e-3);
+    CPPUNIT_ASSERT(!estimator.shouldStop());
+}
+
+void
+TestAdaptiveConvergenceEstimator::testStop()
+{
+    // The gain per minute goes down as the render time goes up.
+    AdaptiveConvergenceEstimator estimator;
+    estimator.reset(0.0, 0.0001f, 0.05f);
+
+    double stopTime = 0.0;
+    for (int i = 1; i <= 10000; i += 10) {
+        if (estimator.update(double(i), mcError(i))) {
+            stopTime = double(i);
+            break;
+        }
+    }
+    CPPUNIT_ASSERT(estimator.shouldStop());
+    // 1 - (t / (t + 60))^0.5 < 0.05 from t ~ 555
+    CPPUNIT_ASSERT(stopTime > 500.0 && stopTime < 600.0);
+    CPPUNIT_ASSERT(estimator.getPredictedSecToTarget() > 0.0);
+
+    // Sticky until the next frame.
+    CPPUNIT_ASSERT(estimator.update(stopTime + 10.0, mcError(1)));
+    estimator.reset(0.0, 0.0001f, 0.05f);
+    CPPUNIT_ASSERT(!estimator.shouldStop());
+    CPPUNIT_ASSERT(!estimator.hasPrediction());
+}
+
+void
+TestAdaptiveConvergenceEstimator::testStalled()
+{
+    // The error no longer goes down, the target is never reached.
+    AdaptiveConvergenceEstimator estimator;
+    estimator.reset(0.0, 0.01f, 0.01f);
+
+    bool stop = false;
+    for (int i = 1; i <= 8 && !stop; ++i) {
+        stop = estimator.update(double(i), 0.05f);
+    }
+    CPPUNIT_ASSERT(stop);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, estimator.getErrorGainPerMinute(), 1e-9);
+    CPPUNIT_ASSERT(std::isinf(estimator.getPredictedSecToTarget()));
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
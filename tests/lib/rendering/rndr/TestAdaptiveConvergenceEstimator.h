@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestAdaptiveConvergenceEstimator : public CppUnit::TestFixture
+{
+public:
+    void testPrediction();
+    void testStop();
+    void testStalled();
+
+    CPPUNIT_TEST_SUITE(TestAdaptiveConvergenceEstimator);
+    CPPUNIT_TEST(testPrediction);
+    CPPUNIT_TEST(testStop);
+    CPPUNIT_TEST(testStalled);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,109 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "TestAdaptiveErrorMetric.h"
+#include <moonray/rendering/rndr/adaptive/AdaptiveErrorMetric.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+using AdaptiveNS::TileRowSamples;
+
+// All the lanes get the given even and odd sample means (rgb, alpha = 1) with 8 samples each.
+TileRowSamples
+makeSamples(const float even[3], const float odd[3])
+{
+    constexpr float numHalfSamples = 8.0f;
+
+    TileRowSamples s;
+    for (int i = 0; i < TileRowSamples::sLanes; ++i) {
+        s.mTotalSamples[i] = numHalfSamples * 2.0f;
+        s.mNumOddSamples[i] = numHalfSamples;
+        s.mNumEvenSamples[i] = numHalfSamples;
+        for (int c = 0; c < 3; ++c) {
+            s.mOdd[c][i] = odd[c] * numHalfSamples;
+            s.mTotal[c][i] = (even[c] + odd[c]) * numHalfSamples;
+        }
+        s.mOdd[3][i] = numHalfSamples;
+        s.mTotal[3][i] = numHalfSamples * 2.0f;
+    }
+    return s;
+}
+
+float
+error(AdaptiveErrorMetricType type, const TileRowSamples& s)
+{
+    float errors[TileRowSamples::sLanes];
+    AdaptiveErrorMetric::create(type)->estimate(s, errors);
+    for (int i = 1; i < TileRowSamples::sLanes; ++i) {
+        CPPUNIT_ASSERT_EQUAL(errors[0], errors[i]);
+    }
+    return errors[0];
+}
+
+} // namespace
+
+void
+TestAdaptiveErrorMetric::testConverged()
+{
+    const float color[3] = {0.5f, 0.25f, 2.0f};
+    const TileRowSamples s = makeSamples(color, color);
+    for (AdaptiveErrorMetricType type : {AdaptiveErrorMetricType::LUMINANCE,
+                                         AdaptiveErrorMetricType::RELATIVE,
+                                         AdaptiveErrorMetricType::MAX_CHANNEL,
+                                         AdaptiveErrorMetricType::TONEMAPPED}) {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, error(type, s), 1e-6);
+        CPPUNIT_ASSERT(AdaptiveErrorMetric::create(type)->getType() == type);
+    }
+}
+
+void
+TestAdaptiveErrorMetric::testRelative()
+{
+    // Same relative noise in a dark and a bright pixel
+    const float darkEven[3] = {0.011f, 0.011f, 0.011f};
+    const float darkOdd[3] = {0.009f, 0.009f, 0.009f};
+    const float brightEven[3] = {11.0f, 11.0f, 11.0f};
+    const float brightOdd[3] = {9.0f, 9.0f, 9.0f};
+    const TileRowSamples dark = makeSamples(darkEven, darkOdd);
+    const TileRowSamples bright = makeSamples(brightEven, brightOdd);
+
+    // luminance metric favors the bright pixel, relative metric weights them about the same
+    CPPUNIT_ASSERT(error(AdaptiveErrorMetricType::LUMINANCE, bright) >
+                   10.0f * error(AdaptiveErrorMetricType::LUMINANCE, dark));
+    const float relativeDark = error(AdaptiveErrorMetricType::RELATIVE, dark);
+    const float relativeBright = error(AdaptiveErrorMetricType::RELATIVE, bright);
+    CPPUNIT_ASSERT(relativeDark > 0.5f * relativeBright && relativeDark < relativeBright);
+}
+
+void
+TestAdaptiveErrorMetric::testMaxChannel()
+{
+    // Noise only in the blue channel, which has a small luminance weight
+    const float even[3] = {1.0f, 1.0f, 1.2f};
+    const float odd[3] = {1.0f, 1.0f, 0.8f};
+    const TileRowSamples s = makeSamples(even, odd);
+    CPPUNIT_ASSERT(error(AdaptiveErrorMetricType::MAX_CHANNEL, s) >
+                   5.0f * error(AdaptiveErrorMetricType::LUMINANCE, s));
+}
+
+void
+TestAdaptiveErrorMetric::testTonemapped()
+{
+    // The same absolute noise is much less visible in a highlight after the tonemap
+    const float midEven[3] = {0.6f, 0.6f, 0.6f};
+    const float midOdd[3] = {0.4f, 0.4f, 0.4f};
+    const float highEven[3] = {50.1f, 50.1f, 50.1f};
+    const float highOdd[3] = {49.9f, 49.9f, 49.9f};
+    CPPUNIT_ASSERT(error(AdaptiveErrorMetricType::TONEMAPPED, makeSamples(midEven, midOdd)) >
+                   100.0f * error(AdaptiveErrorMetricType::TONEMAPPED, makeSamples(highEven, highOdd)));
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
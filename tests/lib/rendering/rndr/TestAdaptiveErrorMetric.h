@@ -0,0 +1,33 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestAdaptiveErrorMetric : public CppUnit::TestFixture
+{
+public:
+    void testConverged();
+    void testRelative();
+    void testMaxChannel();
+    void testTonemapped();
+
+    CPPUNIT_TEST_SUITE(TestAdaptiveErrorMetric);
+    CPPUNIT_TEST(testConverged);
+    CPPUNIT_TEST(testRelative);
+    CPPUNIT_TEST(testMaxChannel);
+    CPPUNIT_TEST(testTonemapped);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
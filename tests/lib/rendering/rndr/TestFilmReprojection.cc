@@ -0,0 +1,145 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestFilmReprojection.h"
+
+#include <moonray/rendering/rndr/FilmReprojection.h>
+
+#include <scene_rdl2/common/math/Math.h>
+
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+using scene_rdl2::fb_util::RenderColor;
+using scene_rdl2::math::Mat4d;
+using scene_rdl2::math::Mat4f;
+using scene_rdl2::math::Vec3f;
+using scene_rdl2::math::Vec4d;
+
+namespace {
+
+// The previous camera sat one unit to the right of the current one, the
+// current camera maps camera space x, y straight to pixel coordinates.
+void
+setupShiftedCapture(FilmReprojection &reprojection, unsigned w, unsigned h)
+{
+    const RenderColor red(1.0f, 0.0f, 0.0f, 1.0f);
+    const RenderColor green(0.0f, 1.0f, 0.0f, 1.0f);
+
+    std::vector<FilmReprojection::Sample> samples;
+    samples.push_back({Vec3f(2.5f, 3.5f, -2.0f), green, 8.0f});  // occluded by the red one
+    samples.push_back({Vec3f(2.5f, 3.5f, -1.0f), red, 8.0f});
+    samples.push_back({Vec3f(15.5f, 0.5f, -1.0f), red, 8.0f});   // leaves the image
+    samples.push_back({Vec3f(5.5f, 5.5f, 1.0f), red, 8.0f});     // behind the camera
+    reprojection.capture(w, h, std::move(samples), Mat4d::translate(Vec4d(1.0, 0.0, 0.0, 0.0)));
+}
+
+} // anonymous namespace
+
+void
+TestFilmReprojection::testFadePriorWeight()
+{
+    CPPUNIT_ASSERT(FilmReprojection::fadePriorWeight(0.0f, 0.0f) == 0.0f);
+    CPPUNIT_ASSERT(FilmReprojection::fadePriorWeight(4.0f, 0.0f) == 4.0f);
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(FilmReprojection::fadePriorWeight(4.0f, 8.0f), 2.0f));
+
+    // Gone once the pixel received sFadeSamples times the prior weight.
+    CPPUNIT_ASSERT(FilmReprojection::fadePriorWeight(4.0f, 4.0f * FilmReprojection::sFadeSamples) == 0.0f);
+    CPPUNIT_ASSERT(FilmReprojection::fadePriorWeight(4.0f, 100.0f) == 0.0f);
+}
+
+void
+TestFilmReprojection::testReproject()
+{
+    const unsigned w = 16;
+    const unsigned h = 16;
+    const scene_rdl2::fb_util::Tiler tiler(w, h);
+
+    FilmReprojection reprojection;
+    CPPUNIT_ASSERT(!reprojection.reproject(tiler, Mat4d(scene_rdl2::math::one), Mat4f(scene_rdl2::math::one),
+                                           4.0f, false));
+
+    setupShiftedCapture(reprojection, w, h);
+    CPPUNIT_ASSERT(reprojection.hasCapture());
+
+    // A resolution change drops the prior.
+    CPPUNIT_ASSERT(!reprojection.reproject(scene_rdl2::fb_util::Tiler(w, h + 8),
+                                           Mat4d(scene_rdl2::math::one), Mat4f(scene_rdl2::math::one),
+                                           4.0f, false));
+    CPPUNIT_ASSERT(!reprojection.hasPrior());
+
+    CPPUNIT_ASSERT(reprojection.reproject(tiler, Mat4d(scene_rdl2::math::one), Mat4f(scene_rdl2::math::one),
+                                          4.0f, false));
+    CPPUNIT_ASSERT(reprojection.hasPrior());
+    CPPUNIT_ASSERT(reprojection.getNumPriorPixels() == 1);
+
+    const RenderColor *priorColor = reprojection.getPriorColorBuffer().getData();
+    const float *priorWeight = reprojection.getPriorWeightBuffer().getData();
+
+    // The closest sample wins, its weight clamped to the max prior weight.
+    const unsigned ofs = tiler.linearCoordsToTiledOffset(3, 3);
+    CPPUNIT_ASSERT(priorWeight[ofs] == 4.0f);
+    CPPUNIT_ASSERT(priorColor[ofs].x == 1.0f && priorColor[ofs].y == 0.0f);
+    CPPUNIT_ASSERT(priorWeight[tiler.linearCoordsToTiledOffset(2, 3)] == 0.0f);
+
+    reprojection.dropPrior();
+    CPPUNIT_ASSERT(!reprojection.hasPrior());
+    CPPUNIT_ASSERT(reprojection.hasCapture());
+
+    reprojection.clear();
+    CPPUNIT_ASSERT(!reprojection.hasCapture());
+}
+
+void
+TestFilmReprojection::testBlend()
+{
+    const unsigned w = 16;
+    const unsigned h = 16;
+    const scene_rdl2::fb_util::Tiler tiler(w, h);
+
+    FilmReprojection reprojection;
+    setupShiftedCapture(reprojection, w, h);
+    CPPUNIT_ASSERT(reprojection.reproject(tiler, Mat4d(scene_rdl2::math::one), Mat4f(scene_rdl2::math::one),
+                                          4.0f, false));
+
+    scene_rdl2::fb_util::FloatBuffer weightBuf;
+    scene_rdl2::fb_util::RenderBuffer colorBuf;
+    weightBuf.init(tiler.mAlignedW, tiler.mAlignedH);
+    colorBuf.init(tiler.mAlignedW, tiler.mAlignedH);
+    weightBuf.clear();
+    colorBuf.clear();
+
+    const RenderColor blue(0.0f, 0.0f, 1.0f, 1.0f);
+    const unsigned ofs = tiler.linearCoordsToTiledOffset(3, 3);
+    const unsigned tileIdx = ofs >> 6;
+    weightBuf.getData()[ofs] = 2.0f;
+    colorBuf.getData()[ofs] = blue * 2.0f;
+
+    // Delta snapshots: the prior adds up as extra weight, 4 * (1 - 2 / 16) = 3.5 samples.
+    RenderColor color[64];
+    float weight[64];
+    reprojection.addToTile(tileIdx, colorBuf.getData() + (tileIdx << 6), weightBuf.getData() + (tileIdx << 6),
+                           color, weight);
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(weight[ofs & 63], 5.5f));
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(color[ofs & 63].x, 3.5f));
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(color[ofs & 63].z, 2.0f));
+    const unsigned otherOfs = tiler.linearCoordsToTiledOffset(2, 3) & 63;
+    CPPUNIT_ASSERT(weight[otherOfs] == 0.0f);
+
+    // Normalized snapshots.
+    colorBuf.getData()[ofs] = blue;
+    reprojection.blendNormalized(weightBuf, colorBuf, false);
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(colorBuf.getData()[ofs].x, 3.5f / 5.5f));
+    CPPUNIT_ASSERT(scene_rdl2::math::isEqual(colorBuf.getData()[ofs].z, 2.0f / 5.5f));
+    CPPUNIT_ASSERT(colorBuf.getData()[tiler.linearCoordsToTiledOffset(2, 3)].x == 0.0f);
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
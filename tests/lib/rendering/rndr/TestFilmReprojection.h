@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestFilmReprojection : public CppUnit::TestFixture
+{
+public:
+    void testFadePriorWeight();
+    void testReproject();
+    void testBlend();
+
+    CPPUNIT_TEST_SUITE(TestFilmReprojection);
+    CPPUNIT_TEST(testFadePriorWeight);
+    CPPUNIT_TEST(testReproject);
+    CPPUNIT_TEST(testBlend);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,143 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestHeatMapReport.h"
+
+#include <moonray/rendering/mcrt_common/Clock.h>
+#include <moonray/rendering/rndr/HeatMapReport.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+// 4x2 image: geometry "a" with material "ma" on the left half, geometry "b"
+// with material "mb" on the right half but for pixel (3, 1) where nothing is
+// hit. The left pixels take 1ms each, the right ones 3ms.
+void
+initHeatMap(scene_rdl2::fb_util::HeatMapBuffer &heatMap)
+{
+    heatMap.init(4, 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            heatMap.setPixel(x, y, mcrt_common::Clock::nanoseconds((x < 2) ? 0.001 : 0.003));
+        }
+    }
+}
+
+void
+pick(int x, int y, std::string &geometry, std::string &material)
+{
+    if (x == 3 && y == 1) return;
+    geometry = (x < 2) ? "a" : "b";
+    material = (x < 2) ? "ma" : "mb";
+}
+
+} // namespace
+
+void
+TestHeatMapReport::testRanking()
+{
+    scene_rdl2::fb_util::HeatMapBuffer heatMap;
+    initHeatMap(heatMap);
+
+    int pickCount = 0;
+    HeatMapReport report([&](int x, int y, std::string &geometry, std::string &material) {
+        ++pickCount;
+        pick(x, y, geometry, material);
+    }, 1600, 2);
+    CPPUNIT_ASSERT(report.build(heatMap, nullptr));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.016, report.getTotalSec(), 1e-9);
+
+    // Each pixel is picked once for the ranking, the hot pixels once more.
+    CPPUNIT_ASSERT_EQUAL(8 + 2, pickCount);
+
+    const auto &geometries = report.getGeometries();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), geometries.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("b"), geometries[0].mName);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.009, geometries[0].mSec, 1e-4);
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), geometries[1].mName);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.004, geometries[1].mSec, 1e-4);
+    CPPUNIT_ASSERT_EQUAL(std::string(HeatMapReport::sNone), geometries[2].mName);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.003, geometries[2].mSec, 1e-4);
+
+    const auto &materials = report.getMaterials();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), materials.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("mb"), materials[0].mName);
+    CPPUNIT_ASSERT_EQUAL(std::string("ma"), materials[1].mName);
+
+    // The hottest pixels, ties in pixel order.
+    const auto &hot = report.getHotPixels();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), hot.size());
+    CPPUNIT_ASSERT(hot[0].mX == 2 && hot[0].mY == 0);
+    CPPUNIT_ASSERT(hot[1].mX == 3 && hot[1].mY == 0);
+    CPPUNIT_ASSERT_EQUAL(std::string("b"), hot[0].mGeometry);
+    CPPUNIT_ASSERT(hot[0].mId.empty());
+
+    std::ostringstream ostr;
+    report.writeJson(ostr, "out.exr");
+    const std::string json = ostr.str();
+    CPPUNIT_ASSERT(json.find("\"image\":\"out.exr\"") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"geometries\":[") != std::string::npos);
+    CPPUNIT_ASSERT(json.find("\"ids\":[") == std::string::npos);
+}
+
+void
+TestHeatMapReport::testIds()
+{
+    scene_rdl2::fb_util::HeatMapBuffer heatMap;
+    initHeatMap(heatMap);
+
+    // Every pixel gives its time to its id, the miss value to none.
+    scene_rdl2::fb_util::FloatBuffer ids;
+    ids.init(4, 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            ids.setPixel(x, y, (x < 2) ? 7.0f : 12.0f);
+        }
+    }
+    ids.setPixel(3, 1, std::numeric_limits<float>::infinity());
+
+    HeatMapReport report(pick, 64, 1);
+    CPPUNIT_ASSERT(report.build(heatMap, &ids));
+
+    const auto &entries = report.getIds();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), entries.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("12"), entries[0].mName);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.009, entries[0].mSec, 1e-9);
+    CPPUNIT_ASSERT_EQUAL(std::string("7"), entries[1].mName);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.004, entries[1].mSec, 1e-9);
+    CPPUNIT_ASSERT_EQUAL(std::string(HeatMapReport::sNone), entries[2].mName);
+    CPPUNIT_ASSERT_EQUAL(std::string("12"), report.getHotPixels()[0].mId);
+
+    std::ostringstream ostr;
+    report.writeJson(ostr, "out.exr");
+    CPPUNIT_ASSERT(ostr.str().find("\"ids\":[") != std::string::npos);
+    CPPUNIT_ASSERT(ostr.str().find("\"id\":12") != std::string::npos);
+}
+
+void
+TestHeatMapReport::testEmpty()
+{
+    // No heat map RenderOutput, nothing to report.
+    scene_rdl2::fb_util::HeatMapBuffer heatMap;
+    HeatMapReport report(pick);
+    CPPUNIT_ASSERT(!report.build(heatMap, nullptr));
+
+    heatMap.init(4, 2);
+    heatMap.clear();
+    CPPUNIT_ASSERT(!report.build(heatMap, nullptr));
+    CPPUNIT_ASSERT(report.getGeometries().empty());
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
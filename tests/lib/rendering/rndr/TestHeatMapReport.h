@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestHeatMapReport : public CppUnit::TestFixture
+{
+public:
+    void testRanking();
+    void testIds();
+    void testEmpty();
+
+    CPPUNIT_TEST_SUITE(TestHeatMapReport);
+    CPPUNIT_TEST(testRanking);
+    CPPUNIT_TEST(testIds);
+    CPPUNIT_TEST(testEmpty);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
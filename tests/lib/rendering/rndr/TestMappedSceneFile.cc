@@ -0,0 +1,103 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestMappedSceneFile.h"
+
+#include <moonray/rendering/rndr/MappedSceneFile.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+// Writes a file spanning several prefetch chunks, with a non multiple of the
+// page size tail.
+std::string
+writeTestFile(std::string &contents)
+{
+    const std::string filename = "TestMappedSceneFile." + std::to_string(getpid()) + ".rdlb";
+    contents.resize(40 * 1024 * 1024 + 123);
+    for (size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<char>(i * 31 + (i >> 12));
+    }
+    std::ofstream(filename, std::ios::binary) << contents;
+    return filename;
+}
+
+} // namespace
+
+void
+TestMappedSceneFile::testRead()
+{
+    std::string contents;
+    const std::string filename = writeTestFile(contents);
+    {
+        MappedSceneFile file(filename);
+        CPPUNIT_ASSERT(file.isValid());
+        CPPUNIT_ASSERT(file.getSize() == contents.size());
+
+        file.prefetch();
+        std::istream &in = file.getStream();
+        const std::string read((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        CPPUNIT_ASSERT(read == contents);
+
+        // The stream starts over on each call.
+        char c = 0;
+        CPPUNIT_ASSERT(file.getStream().get(c));
+        CPPUNIT_ASSERT(c == contents[0]);
+    }
+    std::remove(filename.c_str());
+}
+
+void
+TestMappedSceneFile::testSeek()
+{
+    std::string contents;
+    const std::string filename = writeTestFile(contents);
+    {
+        MappedSceneFile file(filename);
+        std::istream &in = file.getStream();
+        char buf[16];
+
+        in.seekg(1000);
+        CPPUNIT_ASSERT(in.read(buf, sizeof(buf)));
+        CPPUNIT_ASSERT(contents.compare(1000, sizeof(buf), buf, sizeof(buf)) == 0);
+        CPPUNIT_ASSERT(in.tellg() == std::streampos(1000 + sizeof(buf)));
+
+        in.seekg(-16, std::ios::end);
+        CPPUNIT_ASSERT(in.read(buf, sizeof(buf)));
+        CPPUNIT_ASSERT(contents.compare(contents.size() - 16, sizeof(buf), buf, sizeof(buf)) == 0);
+        CPPUNIT_ASSERT(!in.read(buf, 1));
+
+        in.clear();
+        in.seekg(1, std::ios::end);
+        CPPUNIT_ASSERT(in.fail());
+    }
+    std::remove(filename.c_str());
+}
+
+void
+TestMappedSceneFile::testMissingFile()
+{
+    MappedSceneFile file("TestMappedSceneFile.missing.rdlb");
+    CPPUNIT_ASSERT(!file.isValid());
+    CPPUNIT_ASSERT(file.getSize() == 0);
+    file.prefetch();
+    char c;
+    CPPUNIT_ASSERT(!file.getStream().get(c));
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
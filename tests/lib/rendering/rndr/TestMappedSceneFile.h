@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestMappedSceneFile : public CppUnit::TestFixture
+{
+public:
+    void testRead();
+    void testSeek();
+    void testMissingFile();
+
+    CPPUNIT_TEST_SUITE(TestMappedSceneFile);
+    CPPUNIT_TEST(testRead);
+    CPPUNIT_TEST(testSeek);
+    CPPUNIT_TEST(testMissingFile);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
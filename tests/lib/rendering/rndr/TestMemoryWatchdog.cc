@@ -0,0 +1,93 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestMemoryWatchdog.h"
+
+#include <moonray/rendering/rndr/MemoryWatchdog.h>
+
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+using Level = MemoryWatchdog::Level;
+
+void
+TestMemoryWatchdog::testLevel()
+{
+    const size_t budget = 1000;
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(0, budget) == Level::NONE);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(799, budget) == Level::NONE);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(800, budget) == Level::SHRINK);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(899, budget) == Level::SHRINK);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(900, budget) == Level::SHRINK_MORE);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(999, budget) == Level::SHRINK_MORE);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(1000, budget) == Level::STOP);
+
+    // Large budgets don't overflow.
+    const size_t largeBudget = size_t(1) << 62;
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(largeBudget / 2, largeBudget) == Level::NONE);
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(largeBudget / 100 * 95, largeBudget) == Level::SHRINK_MORE);
+
+    // No budget, no pressure.
+    CPPUNIT_ASSERT(MemoryWatchdog::getLevel(size_t(1) << 40, 0) == Level::NONE);
+}
+
+void
+TestMemoryWatchdog::testEscalation()
+{
+    std::vector<Level> actions;
+    MemoryWatchdog watchdog(1000, 1.0f, [&](Level level, size_t) { actions.push_back(level); });
+
+    CPPUNIT_ASSERT(watchdog.check(500) == Level::NONE);
+    CPPUNIT_ASSERT(actions.empty());
+
+    // Each level runs its action once.
+    CPPUNIT_ASSERT(watchdog.check(850) == Level::SHRINK);
+    CPPUNIT_ASSERT(watchdog.check(850) == Level::SHRINK);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), actions.size());
+    CPPUNIT_ASSERT(actions[0] == Level::SHRINK);
+
+    // Memory going down doesn't run anything again.
+    CPPUNIT_ASSERT(watchdog.check(500) == Level::NONE);
+    CPPUNIT_ASSERT(watchdog.check(850) == Level::SHRINK);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), actions.size());
+
+    // Jumping over a level still runs its action, in order.
+    CPPUNIT_ASSERT(watchdog.check(1200) == Level::STOP);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), actions.size());
+    CPPUNIT_ASSERT(actions[1] == Level::SHRINK_MORE);
+    CPPUNIT_ASSERT(actions[2] == Level::STOP);
+    CPPUNIT_ASSERT(watchdog.getMaxLevel() == Level::STOP);
+}
+
+void
+TestMemoryWatchdog::testThread()
+{
+    // A budget of one byte is reached right away by any process.
+    std::vector<Level> actions;
+    {
+        MemoryWatchdog watchdog(1, 0.01f, [&](Level level, size_t) { actions.push_back(level); });
+        watchdog.start();
+        while (watchdog.getMaxLevel() != Level::STOP) {}
+        watchdog.stop();
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(3), actions.size());
+    CPPUNIT_ASSERT(actions[2] == Level::STOP);
+
+    // Stopping before the first check runs nothing.
+    actions.clear();
+    {
+        MemoryWatchdog watchdog(1, 60.0f, [&](Level level, size_t) { actions.push_back(level); });
+        watchdog.start();
+    }
+    CPPUNIT_ASSERT(actions.empty());
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestMemoryWatchdog : public CppUnit::TestFixture
+{
+public:
+    void testLevel();
+    void testEscalation();
+    void testThread();
+
+    CPPUNIT_TEST_SUITE(TestMemoryWatchdog);
+    CPPUNIT_TEST(testLevel);
+    CPPUNIT_TEST(testEscalation);
+    CPPUNIT_TEST(testThread);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,76 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestRealtimeFrameController.h"
+
+#include <moonray/rendering/rndr/RealtimeFrameController.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+void
+TestRealtimeFrameController::testMarginFollowsOverrun()
+{
+    const double budget = 1.0 / 30.0;
+    RealtimeFrameController controller;
+    CPPUNIT_ASSERT(controller.startFrame(budget) == 0.0);
+
+    // Late frames build up a margin.
+    controller.endFrame(1.0, 1.002);
+    const double margin = controller.startFrame(budget);
+    CPPUNIT_ASSERT(margin > 0.0);
+    CPPUNIT_ASSERT(controller.getAveragedOverrun() > 0.0);
+
+    controller.endFrame(2.0, 2.002);
+    CPPUNIT_ASSERT(controller.startFrame(budget) > margin);
+
+    // Early frames give it back, down to no margin at all.
+    for (int i = 0; i < 10; ++i) {
+        controller.endFrame(3.0 + i, 3.0 + i - 0.002);
+        controller.startFrame(budget);
+    }
+    CPPUNIT_ASSERT(controller.getMargin() == 0.0);
+
+    controller.reset();
+    CPPUNIT_ASSERT(controller.getMargin() == 0.0);
+    CPPUNIT_ASSERT(controller.getAveragedOverrun() == 0.0);
+}
+
+void
+TestRealtimeFrameController::testMarginClamp()
+{
+    const double budget = 1.0 / 30.0;
+    RealtimeFrameController controller;
+    controller.startFrame(budget);
+
+    // A single very late frame only holds back part of the budget.
+    controller.endFrame(1.0, 2.0);
+    const double margin = controller.startFrame(budget);
+    CPPUNIT_ASSERT(margin > 0.0 && margin < 0.5 * budget);
+
+    // The margin follows a shrinking budget.
+    CPPUNIT_ASSERT(controller.startFrame(0.5 * budget) < margin);
+    CPPUNIT_ASSERT(controller.startFrame(0.0) == 0.0);
+}
+
+void
+TestRealtimeFrameController::testParanoiaFactor()
+{
+    RealtimeFrameController controller;
+    double last = controller.getParanoiaFactor(1);
+    CPPUNIT_ASSERT(last > 0.0 && last < 1.0);
+    for (unsigned samples = 2; samples <= 1024; samples *= 2) {
+        const double factor = controller.getParanoiaFactor(samples);
+        CPPUNIT_ASSERT(factor > 0.0 && factor < last);
+        last = factor;
+    }
+    CPPUNIT_ASSERT(last < 0.01);
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestRealtimeFrameController : public CppUnit::TestFixture
+{
+public:
+    void testMarginFollowsOverrun();
+    void testMarginClamp();
+    void testParanoiaFactor();
+
+    CPPUNIT_TEST_SUITE(TestRealtimeFrameController);
+    CPPUNIT_TEST(testMarginFollowsOverrun);
+    CPPUNIT_TEST(testMarginClamp);
+    CPPUNIT_TEST(testParanoiaFactor);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,108 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestRenderNodeBalancer.h"
+
+#include <moonray/rendering/rndr/RenderNodeBalancer.h>
+
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+void
+TestRenderNodeBalancer::testAssignTilesEqual()
+{
+    // Equal weights have to give the same ownership as the regular distribution.
+    const unsigned numTiles = 1013;
+    const unsigned numRenderNodes = 7;
+    const std::vector<float> weights(numRenderNodes, 1.0f);
+
+    for (unsigned nodeIdx = 0; nodeIdx < numRenderNodes; ++nodeIdx) {
+        std::vector<unsigned> tileIds;
+        RenderNodeBalancer::assignTiles(weights, numTiles, nodeIdx, tileIds);
+
+        std::vector<unsigned> expected;
+        for (unsigned tileId = nodeIdx; tileId < numTiles; tileId += numRenderNodes) {
+            expected.push_back(tileId);
+        }
+        CPPUNIT_ASSERT(tileIds == expected);
+    }
+}
+
+void
+TestRenderNodeBalancer::testAssignTilesWeighted()
+{
+    const unsigned numTiles = 1000;
+    const std::vector<float> weights = {0.5f, 0.25f, 0.125f, 0.125f};
+
+    std::vector<unsigned> owner(numTiles, ~0u);
+    for (unsigned nodeIdx = 0; nodeIdx < weights.size(); ++nodeIdx) {
+        std::vector<unsigned> tileIds;
+        RenderNodeBalancer::assignTiles(weights, numTiles, nodeIdx, tileIds);
+
+        // share is proportional to the weight
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(weights[nodeIdx] * numTiles, (double)tileIds.size(), 1.0);
+
+        // tiles never overlap
+        for (unsigned tileId : tileIds) {
+            CPPUNIT_ASSERT(owner[tileId] == ~0u);
+            owner[tileId] = nodeIdx;
+        }
+    }
+    for (unsigned tileId = 0; tileId < numTiles; ++tileId) {
+        CPPUNIT_ASSERT(owner[tileId] != ~0u);
+    }
+}
+
+void
+TestRenderNodeBalancer::testRebalance()
+{
+    RenderNodeBalancer balancer(3);
+
+    // No weights until all the nodes reported
+    balancer.updateNodeStat(0, 1000.0f, 1.0f);
+    balancer.updateNodeStat(1, 1000.0f, 1.0f);
+    CPPUNIT_ASSERT(!balancer.rebalance());
+    CPPUNIT_ASSERT(balancer.getWeights().empty());
+
+    // Report of an idle node is ignored
+    balancer.updateNodeStat(2, 10.0f, 0.1f);
+    CPPUNIT_ASSERT(!balancer.rebalance());
+
+    // Balanced nodes don't need to rebalance
+    balancer.updateNodeStat(2, 1000.0f, 1.0f);
+    CPPUNIT_ASSERT(!balancer.rebalance());
+
+    // Node 2 is twice as fast as others
+    for (int i = 0; i < 8; ++i) balancer.updateNodeStat(2, 2000.0f, 1.0f);
+    CPPUNIT_ASSERT(balancer.rebalance());
+    const std::vector<float> &weights = balancer.getWeights();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), weights.size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, weights[0], 0.01);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, weights[1], 0.01);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, weights[2], 0.01);
+
+    // Same condition does not rebalance again
+    CPPUNIT_ASSERT(!balancer.rebalance());
+}
+
+void
+TestRenderNodeBalancer::testWeightsMessage()
+{
+    const std::vector<float> weights = {0.25f, 0.125f, 0.625f};
+    std::vector<float> decoded;
+    CPPUNIT_ASSERT(RenderNodeBalancer::decodeWeights(RenderNodeBalancer::encodeWeights(weights), decoded));
+    CPPUNIT_ASSERT(weights == decoded);
+
+    CPPUNIT_ASSERT(!RenderNodeBalancer::decodeWeights("0.5 abc", decoded));
+    CPPUNIT_ASSERT(!RenderNodeBalancer::decodeWeights("0.5 -1", decoded));
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,33 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestRenderNodeBalancer : public CppUnit::TestFixture
+{
+public:
+    void testAssignTilesEqual();
+    void testAssignTilesWeighted();
+    void testRebalance();
+    void testWeightsMessage();
+
+    CPPUNIT_TEST_SUITE(TestRenderNodeBalancer);
+    CPPUNIT_TEST(testAssignTilesEqual);
+    CPPUNIT_TEST(testAssignTilesWeighted);
+    CPPUNIT_TEST(testRebalance);
+    CPPUNIT_TEST(testWeightsMessage);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,149 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestRenderOutputWriter.h"
+
+#include <moonray/rendering/rndr/RenderOutputWriter.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+uint32_t
+floatBits(float f)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+float
+bitsFloat(uint32_t bits)
+{
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+} // namespace
+
+void
+TestRenderOutputWriter::testHalfToFloat()
+{
+    // Every half value, odd total so the scalar tail is used as well.
+    std::vector<unsigned short> hArray(0x10000 + 3);
+    for (size_t i = 0; i < hArray.size(); ++i) {
+        hArray[i] = static_cast<unsigned short>(i);
+    }
+
+    std::vector<float> fArray(hArray.size());
+    RenderOutputWriter::hToFArray(hArray.data(), hArray.size(), fArray.data());
+    for (size_t i = 0; i < hArray.size(); ++i) {
+        CPPUNIT_ASSERT_EQUAL(floatBits(RenderOutputWriter::htof(hArray[i])), floatBits(fArray[i]));
+    }
+}
+
+void
+TestRenderOutputWriter::testFloatToHalf()
+{
+    std::vector<float> fArray = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 65504.0f, 65520.0f, 1.0e6f, -1.0e6f,
+        6.1e-5f, 5.96e-8f, 2.98e-8f, 1.0e-10f, // around the half denormals
+        1.0009765625f, 1.00048828125f, 1.00146484375f, // halfway cases
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min()
+    };
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> bits;
+    while (fArray.size() < (1 << 16) + 5) {
+        fArray.push_back(bitsFloat(bits(rng)));
+    }
+
+    std::vector<unsigned short> hArray(fArray.size());
+    RenderOutputWriter::fToHArray(fArray.data(), fArray.size(), hArray.data());
+    for (size_t i = 0; i < fArray.size(); ++i) {
+        CPPUNIT_ASSERT_EQUAL(RenderOutputWriter::ftoh(fArray[i]), hArray[i]);
+    }
+}
+
+void
+TestRenderOutputWriter::testBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+
+    // A 4 channel half float AOV of a 2K scanline, converted repeatedly for 16 megapixels.
+    constexpr size_t width = 2048;
+    constexpr size_t numChan = 4;
+    constexpr size_t numScanlines = 16 * 1024 * 1024 / width;
+
+    std::vector<float> fArray(width * numChan);
+    std::mt19937 rng(5678);
+    std::uniform_real_distribution<float> value(0.0f, 4.0f);
+    for (float &f : fArray) {
+        f = value(rng);
+    }
+    std::vector<unsigned short> hArray(fArray.size());
+    std::vector<float> fResult(fArray.size());
+
+    auto megaPixelPerSec = [&](const Clock::time_point &start) {
+        const double sec = std::chrono::duration<double>(Clock::now() - start).count();
+        return (sec > 0.0) ? (width * numScanlines) / (sec * 1.0e6) : 0.0;
+    };
+
+    Clock::time_point start = Clock::now();
+    for (size_t y = 0; y < numScanlines; ++y) {
+        for (size_t i = 0; i < fArray.size(); ++i) {
+            hArray[i] = RenderOutputWriter::ftoh(fArray[i]);
+        }
+    }
+    const double scalarFtoH = megaPixelPerSec(start);
+
+    start = Clock::now();
+    for (size_t y = 0; y < numScanlines; ++y) {
+        RenderOutputWriter::fToHArray(fArray.data(), fArray.size(), hArray.data());
+    }
+    const double vectorFtoH = megaPixelPerSec(start);
+
+    start = Clock::now();
+    for (size_t y = 0; y < numScanlines; ++y) {
+        for (size_t i = 0; i < hArray.size(); ++i) {
+            fResult[i] = RenderOutputWriter::htof(hArray[i]);
+        }
+    }
+    const double scalarHtoF = megaPixelPerSec(start);
+
+    start = Clock::now();
+    for (size_t y = 0; y < numScanlines; ++y) {
+        RenderOutputWriter::hToFArray(hArray.data(), hArray.size(), fResult.data());
+    }
+    const double vectorHtoF = megaPixelPerSec(start);
+
+    for (size_t i = 0; i < fArray.size(); ++i) {
+        CPPUNIT_ASSERT_EQUAL(floatBits(RenderOutputWriter::htof(RenderOutputWriter::ftoh(fArray[i]))),
+                             floatBits(fResult[i]));
+    }
+
+    std::cout << "\nRenderOutputWriter half conversion benchmark: " << numChan << " channels"
+              << std::fixed << std::setprecision(1) << '\n'
+              << "  float->half scalar:" << scalarFtoH << " Mpix/sec vector:" << vectorFtoH << " Mpix/sec\n"
+              << "  half->float scalar:" << scalarHtoF << " Mpix/sec vector:" << vectorHtoF << " Mpix/sec"
+              << std::endl;
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
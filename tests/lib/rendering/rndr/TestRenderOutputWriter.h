@@ -0,0 +1,31 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestRenderOutputWriter : public CppUnit::TestFixture
+{
+public:
+    void testHalfToFloat();
+    void testFloatToHalf();
+    void testBenchmark(); // reports conversion throughput per megapixel
+
+    CPPUNIT_TEST_SUITE(TestRenderOutputWriter);
+    CPPUNIT_TEST(testHalfToFloat);
+    CPPUNIT_TEST(testFloatToHalf);
+    CPPUNIT_TEST(testBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
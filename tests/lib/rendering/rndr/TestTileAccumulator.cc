@@ -0,0 +1,131 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "TestTileAccumulator.h"
+#include <moonray/rendering/rndr/TileAccumulator.h>
+
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+using scene_rdl2::fb_util::RenderColor;
+
+void
+TestTileAccumulator::testAddSamples()
+{
+    TileAccumulator acc(0, nullptr);
+    CPPUNIT_ASSERT(acc.isEmpty());
+
+    // Any pixel of the tile selects the tile origin.
+    acc.begin(21, 42);
+    CPPUNIT_ASSERT_EQUAL(16u, acc.getMinX());
+    CPPUNIT_ASSERT_EQUAL(40u, acc.getMinY());
+
+    const RenderColor color(1.f, 2.f, 3.f, 4.f);
+    const RenderColor colorOdd(0.5f, 1.f, 1.5f, 2.f);
+    CPPUNIT_ASSERT(acc.addSamples(21, 42, color, 4.f, &colorOdd, 1.f, nullptr));
+    CPPUNIT_ASSERT(acc.addSamples(16, 40, color, 2.f, nullptr, 1.f, nullptr));
+    CPPUNIT_ASSERT(!acc.isEmpty());
+
+    const unsigned idx = (2 << 3) + 5;
+    CPPUNIT_ASSERT_EQUAL((uint64_t(1) << idx) | uint64_t(1), acc.getPixelMask());
+    CPPUNIT_ASSERT(acc.getColor(idx) == color);
+    CPPUNIT_ASSERT(acc.getColorOdd(idx) == colorOdd);
+    CPPUNIT_ASSERT_EQUAL(4.f, acc.getWeight(idx));
+    CPPUNIT_ASSERT(acc.getColorOdd(0) == RenderColor(0.f, 0.f, 0.f, 0.f));
+    CPPUNIT_ASSERT_EQUAL(2.f, acc.getWeight(0));
+    CPPUNIT_ASSERT(acc.getAovs(0) == nullptr);
+
+    acc.clear();
+    CPPUNIT_ASSERT(acc.isEmpty());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), acc.getPixelMask());
+}
+
+void
+TestTileAccumulator::testRevisitPixel()
+{
+    TileAccumulator acc(0, nullptr);
+    acc.begin(0, 0);
+
+    const RenderColor color(1.f, 1.f, 1.f, 1.f);
+    CPPUNIT_ASSERT(acc.addSamples(7, 7, color, 1.f, nullptr, 1.f, nullptr));
+
+    // The second visit isn't merged, the caller has to add the tile to the film first.
+    CPPUNIT_ASSERT(!acc.addSamples(7, 7, color * 2.f, 2.f, nullptr, 1.f, nullptr));
+    CPPUNIT_ASSERT_EQUAL(1.f, acc.getWeight(63));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1) << 63, acc.getPixelMask());
+}
+
+void
+TestTileAccumulator::testAovs()
+{
+    const unsigned numFloats = 3;
+    std::vector<float> storage(64 * numFloats, 0.f);
+    TileAccumulator acc(numFloats, storage.data());
+    acc.begin(8, 0);
+
+    const float aovs[numFloats] = { 1.f, 2.f, 3.f };
+    const RenderColor color(0.f, 0.f, 0.f, 0.f);
+    CPPUNIT_ASSERT(acc.addSamples(9, 1, color, 1.f, nullptr, 5.f, aovs));
+
+    const unsigned idx = (1 << 3) + 1;
+    CPPUNIT_ASSERT_EQUAL(5.f, acc.getDepth(idx));
+    const float *result = acc.getAovs(idx);
+    CPPUNIT_ASSERT(result == storage.data() + idx * numFloats);
+    for (unsigned i = 0; i < numFloats; ++i) {
+        CPPUNIT_ASSERT_EQUAL(aovs[i], result[i]);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(sizeof(TileAccumulator) + 64 * numFloats * sizeof(float),
+                         TileAccumulator::getMemoryUsage(numFloats));
+}
+
+void
+TestTileAccumulator::testSplat()
+{
+    CPPUNIT_ASSERT_EQUAL(0u, TileAccumulator::getGuardBand(0.5f));
+    CPPUNIT_ASSERT_EQUAL(1u, TileAccumulator::getGuardBand(1.f));
+    CPPUNIT_ASSERT_EQUAL(2u, TileAccumulator::getGuardBand(2.f));
+
+    const unsigned guardBand = 1;
+    const unsigned width = TileAccumulator::getSplatWidth(guardBand);
+    CPPUNIT_ASSERT_EQUAL(10u, width);
+    std::vector<RenderColor> colors(TileAccumulator::getNumSplatPixels(guardBand));
+    std::vector<float> weights(TileAccumulator::getNumSplatPixels(guardBand));
+    TileAccumulator acc(0, nullptr, guardBand, colors.data(), weights.data());
+    CPPUNIT_ASSERT(acc.isEmpty());
+    acc.begin(8, 8);
+
+    // A sample in the corner pixel of the tile reaches into the guard band.
+    const float weightsX[3] = { 0.25f, 0.5f, 0.25f };
+    const float weightsY[3] = { 0.f, 1.f, 0.5f };
+    const RenderColor sample(2.f, 4.f, 6.f, 1.f);
+    acc.splat(8, 15, weightsX, weightsY, sample);
+    CPPUNIT_ASSERT(!acc.isEmpty());
+    CPPUNIT_ASSERT(acc.hasSplats());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), acc.getPixelMask());
+
+    // pixel (7, 15) is block pixel (0, 8), pixel (9, 16) is block pixel (2, 9)
+    CPPUNIT_ASSERT_EQUAL(0.25f, acc.getSplatWeight(8 * width));
+    CPPUNIT_ASSERT(acc.getSplatColor(8 * width) == sample * 0.25f);
+    CPPUNIT_ASSERT_EQUAL(0.125f, acc.getSplatWeight(9 * width + 2));
+    CPPUNIT_ASSERT_EQUAL(0.f, acc.getSplatWeight(7 * width + 1));
+
+    float total = 0.f;
+    for (unsigned i = 0; i < weights.size(); ++i) {
+        total += acc.getSplatWeight(i);
+    }
+    CPPUNIT_ASSERT_EQUAL(1.5f, total);
+
+    acc.clear();
+    CPPUNIT_ASSERT(acc.isEmpty());
+    CPPUNIT_ASSERT_EQUAL(0.f, acc.getSplatWeight(8 * width));
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,33 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestTileAccumulator : public CppUnit::TestFixture
+{
+public:
+    void testAddSamples();
+    void testRevisitPixel();
+    void testAovs();
+    void testSplat();
+
+    CPPUNIT_TEST_SUITE(TestTileAccumulator);
+    CPPUNIT_TEST(testAddSamples);
+    CPPUNIT_TEST(testRevisitPixel);
+    CPPUNIT_TEST(testAovs);
+    CPPUNIT_TEST(testSplat);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,458 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+//
+//
+#include "TestTileWorkQueue.h"
+
+#include <moonray/rendering/rndr/TileScheduler.h>
+#include <moonray/rendering/rndr/TileWorkQueue.h>
+
+#include <scene_rdl2/render/util/Arena.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+namespace {
+
+// A typical progressive set of passes: 3 coarse passes followed by fine passes.
+std::vector<Pass>
+makePasses(unsigned numFinePasses)
+{
+    std::vector<Pass> passes;
+    passes.push_back(Pass{ 0,  1, 0, 1});
+    passes.push_back(Pass{ 1,  4, 0, 1});
+    passes.push_back(Pass{ 4, 64, 0, 1});
+    for (unsigned i = 0; i < numFinePasses; ++i) {
+        passes.push_back(Pass{0, 64, 1 + i * 4, 1 + (i + 1) * 4});
+    }
+    return passes;
+}
+
+// Runs numThreads threads draining the queue. Every handed out tile is counted
+// in tileCounts[passIdx * numTiles + tileIdx]. Returns false if any thread saw
+// passes handed out in decreasing order.
+template <typename WorkFunc>
+bool
+drainQueue(TileWorkQueue &queue, unsigned numThreads, unsigned numTiles,
+           std::vector<std::atomic<unsigned>> &tileCounts, WorkFunc workFunc)
+{
+    std::atomic<bool> passOrderOk(true);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            TileGroup group;
+            unsigned lastPass = 0;
+            while (queue.getNextTileGroup(t, &group, 2)) {
+                if (group.mPassIdx < lastPass) {
+                    passOrderOk = false;
+                }
+                lastPass = group.mPassIdx;
+                for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+                    ++tileCounts[group.mPassIdx * numTiles + group.getTileIdx(tile)];
+                }
+                workFunc(t, group);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return passOrderOk;
+}
+
+} // anonymous namespace
+
+void
+TestTileWorkQueue::testAllGroupsHandedOutOnce()
+{
+    const unsigned numTiles = 1013;
+    const std::vector<Pass> passes = makePasses(6);
+
+    for (unsigned numThreads : {1u, 3u, 8u, 17u}) {
+        TileWorkQueue queue;
+        queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+
+        std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+        CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [](unsigned, const TileGroup &) {}));
+
+        for (const auto &count : tileCounts) {
+            CPPUNIT_ASSERT_EQUAL(1u, count.load());
+        }
+
+        // A reset queue hands out everything again.
+        queue.reset();
+        CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [](unsigned, const TileGroup &) {}));
+        for (const auto &count : tileCounts) {
+            CPPUNIT_ASSERT_EQUAL(2u, count.load());
+        }
+    }
+}
+
+void
+TestTileWorkQueue::testClampToPass()
+{
+    const unsigned numTiles = 256;
+    const unsigned numThreads = 4;
+    const std::vector<Pass> passes = makePasses(2);
+
+    TileWorkQueue queue;
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+
+    std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+
+    queue.clampToPass(1);
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [](unsigned, const TileGroup &) {}));
+    for (unsigned passIdx = 0; passIdx < passes.size(); ++passIdx) {
+        for (unsigned tile = 0; tile < numTiles; ++tile) {
+            CPPUNIT_ASSERT_EQUAL(passIdx <= 1 ? 1u : 0u, tileCounts[passIdx * numTiles + tile].load());
+        }
+    }
+
+    queue.unclampPasses();
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [](unsigned, const TileGroup &) {}));
+    for (const auto &count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+}
+
+void
+TestTileWorkQueue::testTileOrder()
+{
+    const unsigned numTiles = 500;
+    const unsigned numThreads = 4;
+    const std::vector<Pass> passes = makePasses(3);
+    const unsigned firstPassIdx = 3; // first fine pass
+
+    TileWorkQueue queue;
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+
+    // Reverse order with a few very expensive tiles at the front.
+    std::vector<uint32_t> tileOrder(numTiles);
+    std::vector<float> tileCosts(numTiles);
+    for (unsigned i = 0; i < numTiles; ++i) {
+        tileOrder[i] = numTiles - 1 - i;
+        tileCosts[i] = (i < 8) ? 100.0f : 1.0f;
+    }
+    queue.setTileOrder(firstPassIdx, tileOrder, tileCosts);
+    CPPUNIT_ASSERT(queue.hasTileOrder());
+
+    std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+    std::atomic<bool> groupsOk(true);
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [&](unsigned, const TileGroup &group) {
+        if (group.mStartTileIdx >= group.mEndTileIdx ||
+            (group.mPassIdx < firstPassIdx) != (group.mTileOrder == nullptr)) {
+            groupsOk = false;
+        }
+        // The expensive tiles make up most of the cost so they end up in groups of their own.
+        if (group.mTileOrder && group.mStartTileIdx < 8 && group.mEndTileIdx - group.mStartTileIdx > 1) {
+            groupsOk = false;
+        }
+    }));
+    CPPUNIT_ASSERT(groupsOk);
+    for (const auto &count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+
+    // reset() goes back to the tile list order.
+    queue.reset();
+    CPPUNIT_ASSERT(!queue.hasTileOrder());
+}
+
+void
+TestTileWorkQueue::testFocusTileOrder()
+{
+    scene_rdl2::util::Ref<scene_rdl2::alloc::ArenaBlockPool> arenaBlockPool =
+        scene_rdl2::util::alignedMallocCtorArgs<scene_rdl2::alloc::ArenaBlockPool>(CACHE_LINE_SIZE);
+    scene_rdl2::alloc::Arena arena;
+    arena.init(arenaBlockPool.get());
+
+    std::unique_ptr<TileScheduler> scheduler = TileScheduler::create(TileScheduler::MORTON);
+    const unsigned numTiles = scheduler->generateTiles(&arena, 200, 100, scene_rdl2::math::Viewport(0, 0, 199, 99));
+    const std::vector<scene_rdl2::fb_util::Tile> &tiles = scheduler->getTiles();
+
+    const float focusX = 150.0f;
+    const float focusY = 30.0f;
+    std::vector<uint32_t> tileOrder;
+    std::vector<float> tileCosts;
+    scheduler->computeFocusTileOrder(focusX, focusY, tileOrder, tileCosts);
+    CPPUNIT_ASSERT_EQUAL(size_t(numTiles), tileOrder.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(numTiles), tileCosts.size());
+
+    // The tile under the focus point comes first and the distances never decrease.
+    const scene_rdl2::fb_util::Tile &first = tiles[tileOrder[0]];
+    CPPUNIT_ASSERT(first.mMinX <= 150 && 150 < first.mMaxX && first.mMinY <= 30 && 30 < first.mMaxY);
+    float lastDistance = 0.0f;
+    for (uint32_t tileIdx : tileOrder) {
+        const float dx = 0.5f * (tiles[tileIdx].mMinX + tiles[tileIdx].mMaxX) - focusX;
+        const float dy = 0.5f * (tiles[tileIdx].mMinY + tiles[tileIdx].mMaxY) - focusY;
+        CPPUNIT_ASSERT(dx * dx + dy * dy >= lastDistance);
+        lastDistance = dx * dx + dy * dy;
+    }
+
+    // Every pass hands out all the tiles once, in focus order.
+    const unsigned numThreads = 4;
+    const std::vector<Pass> passes = makePasses(2);
+    TileWorkQueue queue;
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+    queue.setTileOrder(0, tileOrder, tileCosts);
+
+    std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+    std::atomic<bool> groupsOk(true);
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [&](unsigned, const TileGroup &group) {
+        if (group.mTileOrder == nullptr) {
+            groupsOk = false;
+        }
+    }));
+    CPPUNIT_ASSERT(groupsOk);
+    for (const auto &count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+
+    arena.cleanUp();
+}
+
+void
+TestTileWorkQueue::testRetiredTiles()
+{
+    const unsigned numTiles = 300;
+    const unsigned numThreads = 8;
+    const std::vector<Pass> passes = makePasses(4);
+
+    TileWorkQueue queue;
+    queue.init(RenderMode::BATCH, numTiles, passes.size(), numThreads, passes.data());
+    CPPUNIT_ASSERT_EQUAL(0u, queue.getNumRetiredTiles());
+
+    // Every thread tries to retire all the even tiles, each of them is only counted once.
+    std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+    std::atomic<unsigned> numRetired(0);
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, [&](unsigned, const TileGroup &group) {
+        for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+            const unsigned tileIdx = group.getTileIdx(tile);
+            if (queue.isTileRetired(tileIdx)) {
+                queue.addSkippedTile();
+            } else if ((tileIdx & 1) == 0 && queue.retireTile(tileIdx)) {
+                ++numRetired;
+            }
+        }
+    }));
+    CPPUNIT_ASSERT_EQUAL(numTiles / 2, numRetired.load());
+    CPPUNIT_ASSERT_EQUAL(numTiles / 2, queue.getNumRetiredTiles());
+    CPPUNIT_ASSERT(queue.getNumSkippedTiles() > 0);
+    for (unsigned tileIdx = 0; tileIdx < numTiles; ++tileIdx) {
+        CPPUNIT_ASSERT_EQUAL((tileIdx & 1) == 0, queue.isTileRetired(tileIdx));
+    }
+    CPPUNIT_ASSERT(!queue.retireTile(0));
+
+    // Retired tiles are still handed out, skipping them is up to the render threads.
+    for (const auto &count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+
+    // reset() brings all the tiles back.
+    queue.reset();
+    CPPUNIT_ASSERT_EQUAL(0u, queue.getNumRetiredTiles());
+    CPPUNIT_ASSERT_EQUAL(0u, queue.getNumSkippedTiles());
+    for (unsigned tileIdx = 0; tileIdx < numTiles; ++tileIdx) {
+        CPPUNIT_ASSERT(!queue.isTileRetired(tileIdx));
+    }
+}
+
+void
+TestTileWorkQueue::testQueueNodes()
+{
+    const unsigned numTiles = 1000;
+    const std::vector<Pass> passes = makePasses(4);
+
+    // Two uneven NUMA nodes, the kernel node ids don't need to start at 0.
+    const std::vector<unsigned> queueNodes = {1, 1, 1, 1, 1, 3, 3, 3};
+    const unsigned numThreads = queueNodes.size();
+
+    TileWorkQueue queue;
+    queue.setQueueNodes(queueNodes);
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+    CPPUNIT_ASSERT(queue.hasQueueNodes());
+
+    // Each node owns a contiguous share of the tiles in proportion to its threads.
+    unsigned node1Tiles = 0;
+    for (unsigned tileIdx = 0; tileIdx < numTiles; ++tileIdx) {
+        const unsigned node = queue.getTileNode(tileIdx);
+        CPPUNIT_ASSERT(node == 1 || node == 3);
+        CPPUNIT_ASSERT(tileIdx == 0 || node >= queue.getTileNode(tileIdx - 1));
+        node1Tiles += (node == 1) ? 1 : 0;
+    }
+    CPPUNIT_ASSERT_EQUAL(numTiles * 5 / 8, node1Tiles);
+
+    // Threads taking turns only steal once their own queue is empty, until then
+    // they render tiles of their own node.
+    std::vector<unsigned> tileCounts(passes.size() * numTiles, 0);
+    unsigned remoteTiles = 0;
+    unsigned totalTiles = 0;
+    for (bool more = true; more; ) {
+        more = false;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            TileGroup group;
+            if (!queue.getNextTileGroup(t, &group, 2)) {
+                continue;
+            }
+            more = true;
+            for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+                ++tileCounts[group.mPassIdx * numTiles + group.getTileIdx(tile)];
+                remoteTiles += (queue.getTileNode(group.getTileIdx(tile)) != queueNodes[t]) ? 1 : 0;
+                ++totalTiles;
+            }
+        }
+    }
+    for (unsigned count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count);
+    }
+    CPPUNIT_ASSERT(remoteTiles * 10 < totalTiles);
+
+    // Without the table the queues form a single group again.
+    queue.setQueueNodes(std::vector<unsigned>());
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+    CPPUNIT_ASSERT(!queue.hasQueueNodes());
+    CPPUNIT_ASSERT_EQUAL(0u, queue.getTileNode(numTiles - 1));
+}
+
+void
+TestTileWorkQueue::testDeterministic()
+{
+    const unsigned numTiles = 1013;
+    const std::vector<Pass> passes = makePasses(6);
+
+    // A tile cost which makes the threads finish their passes at different times.
+    std::vector<uint32_t> tileOrder(numTiles);
+    std::vector<float> tileCosts(numTiles);
+    for (unsigned i = 0; i < numTiles; ++i) {
+        tileOrder[i] = numTiles - 1 - i;
+        tileCosts[i] = (i % 97 == 0) ? 100.0f : 1.0f;
+    }
+    auto work = [&](unsigned, const TileGroup &group) {
+        volatile float sink = 0.0f;
+        for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+            for (unsigned i = 0; i < unsigned(tileCosts[group.getTileIdx(tile)]) * 100; ++i) {
+                sink = sink + 1.0f;
+            }
+        }
+    };
+
+    for (unsigned numThreads : {1u, 3u, 8u, 17u}) {
+        TileWorkQueue queue;
+        queue.setDeterministic(true);
+        queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+        CPPUNIT_ASSERT(queue.isDeterministic());
+
+        // Tile orders would regroup the tiles of the later passes.
+        queue.setTileOrder(3, tileOrder, tileCosts);
+        CPPUNIT_ASSERT(!queue.hasTileOrder());
+
+        for (unsigned run = 0; run < 2; ++run) {
+            std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+            std::vector<std::atomic<unsigned>> tileThreads(numTiles);
+            for (auto &owner : tileThreads) {
+                owner = numThreads;
+            }
+            std::atomic<bool> ownerOk(true);
+            CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts,
+                                      [&](unsigned threadIdx, const TileGroup &group) {
+                for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+                    unsigned owner = numThreads;
+                    if (!tileThreads[group.getTileIdx(tile)].compare_exchange_strong(owner, threadIdx) &&
+                        owner != threadIdx) {
+                        ownerOk = false;
+                    }
+                }
+                work(threadIdx, group);
+            }));
+
+            // Every tile of every pass is rendered once, always by the same thread.
+            CPPUNIT_ASSERT(ownerOk);
+            for (const auto &count : tileCounts) {
+                CPPUNIT_ASSERT_EQUAL(1u, count.load());
+            }
+            queue.reset();
+        }
+    }
+}
+
+void
+TestTileWorkQueue::testBenchmark()
+{
+    using Clock = std::chrono::steady_clock;
+
+    const unsigned numTiles = 4096;
+    const unsigned numThreads = std::max(2u, std::min(128u, std::thread::hardware_concurrency()));
+    const std::vector<Pass> passes = makePasses(4);
+
+    TileWorkQueue queue;
+    queue.init(RenderMode::PROGRESSIVE, numTiles, passes.size(), numThreads, passes.data());
+    queue.setStatsEnabled(true);
+
+    // Per thread, per pass busy time and first/last activity times.
+    struct PassActivity
+    {
+        double mBusy{0.0};
+        Clock::time_point mStart{Clock::time_point::max()};
+        Clock::time_point mEnd{Clock::time_point::min()};
+    };
+    std::vector<std::vector<PassActivity>> activity(numThreads, std::vector<PassActivity>(passes.size()));
+
+    // Synthetic tile cost which varies across the image like a hair-heavy region would.
+    auto work = [&](unsigned threadIdx, const TileGroup &group) {
+        const Clock::time_point start = Clock::now();
+        volatile float sink = 0.0f;
+        const Pass &pass = passes[group.mPassIdx];
+        for (unsigned tile = group.mStartTileIdx; tile < group.mEndTileIdx; ++tile) {
+            const unsigned cost = pass.getNumSamplesPerTile() * ((tile % 97 == 0) ? 16 : 1);
+            for (unsigned i = 0; i < cost; ++i) {
+                sink = sink + 1.0f;
+            }
+        }
+        const Clock::time_point end = Clock::now();
+        PassActivity &a = activity[threadIdx][group.mPassIdx];
+        a.mBusy += std::chrono::duration<double>(end - start).count();
+        a.mStart = std::min(a.mStart, start);
+        a.mEnd = std::max(a.mEnd, end);
+    };
+
+    std::vector<std::atomic<unsigned>> tileCounts(passes.size() * numTiles);
+    CPPUNIT_ASSERT(drainQueue(queue, numThreads, numTiles, tileCounts, work));
+    for (const auto &count : tileCounts) {
+        CPPUNIT_ASSERT_EQUAL(1u, count.load());
+    }
+
+    std::cout << "\nTileWorkQueue benchmark: threads:" << numThreads << " tiles:" << numTiles << '\n';
+    for (unsigned passIdx = 0; passIdx < passes.size(); ++passIdx) {
+        double busy = 0.0;
+        Clock::time_point start = Clock::time_point::max();
+        Clock::time_point end = Clock::time_point::min();
+        for (unsigned t = 0; t < numThreads; ++t) {
+            const PassActivity &a = activity[t][passIdx];
+            busy += a.mBusy;
+            start = std::min(start, a.mStart);
+            end = std::max(end, a.mEnd);
+        }
+        const double wall = (end > start) ? std::chrono::duration<double>(end - start).count() : 0.0;
+        const double utilization = (wall > 0.0) ? busy / (wall * numThreads) : 0.0;
+        std::cout << "  pass:" << passIdx
+                  << " wall:" << std::fixed << std::setprecision(6) << wall << " sec"
+                  << " utilization:" << std::setprecision(1) << utilization * 100.0 << "%\n";
+    }
+    std::cout << queue.getStats().show() << std::endl;
+}
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
@@ -0,0 +1,41 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace moonray {
+namespace rndr {
+namespace unittest {
+
+class TestTileWorkQueue : public CppUnit::TestFixture
+{
+public:
+    void testAllGroupsHandedOutOnce();
+    void testClampToPass();
+    void testTileOrder();
+    void testFocusTileOrder();
+    void testRetiredTiles();
+    void testQueueNodes();
+    void testDeterministic();
+    void testBenchmark(); // reports contention and utilization per pass
+
+    CPPUNIT_TEST_SUITE(TestTileWorkQueue);
+    CPPUNIT_TEST(testAllGroupsHandedOutOnce);
+    CPPUNIT_TEST(testClampToPass);
+    CPPUNIT_TEST(testTileOrder);
+    CPPUNIT_TEST(testFocusTileOrder);
+    CPPUNIT_TEST(testRetiredTiles);
+    CPPUNIT_TEST(testQueueNodes);
+    CPPUNIT_TEST(testDeterministic);
+    CPPUNIT_TEST(testBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+} // namespace unittest
+} // namespace rndr
+} // namespace moonray
+
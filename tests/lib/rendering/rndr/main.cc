@@ -3,9 +3,20 @@
 
 
 #include "TestActivePixelMask.h"
+#include "TestAdaptiveConvergenceEstimator.h"
+#include "TestAdaptiveErrorMetric.h"
 #include "TestCheckpoint.h"
+#include "TestFilmReprojection.h"
+#include "TestHeatMapReport.h"
+#include "TestMappedSceneFile.h"
+#include "TestMemoryWatchdog.h"
 #include "TestOverlappingRegions.h"
+#include "TestRealtimeFrameController.h"
+#include "TestRenderNodeBalancer.h"
+#include "TestRenderOutputWriter.h"
 #include "TestSocketStream.h"
+#include "TestTileAccumulator.h"
+#include "TestTileWorkQueue.h"
 
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
@@ -20,6 +31,17 @@ main(int argc, char* argv[])
     CPPUNIT_TEST_SUITE_REGISTRATION(TestOverlappingRegions);
     CPPUNIT_TEST_SUITE_REGISTRATION(TestCheckpoint);
     CPPUNIT_TEST_SUITE_REGISTRATION(TestActivePixelMask);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestAdaptiveErrorMetric);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestAdaptiveConvergenceEstimator);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestTileWorkQueue);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestRenderOutputWriter);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestRealtimeFrameController);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestRenderNodeBalancer);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestTileAccumulator);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestFilmReprojection);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestMappedSceneFile);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestMemoryWatchdog);
+    CPPUNIT_TEST_SUITE_REGISTRATION(TestHeatMapReport);
 
     return pdevunit::run(argc, argv);
 }
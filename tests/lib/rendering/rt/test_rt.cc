@@ -68,8 +68,9 @@ void TestRenderingRT::testIntersectPolygon()
     geom->applyUpdates();
 
     geom->loadProcedural();
+    const std::vector<moonray::mcrt_common::Frustum> frustums;
     GeomGenerateContext generateContext(nullptr, geom, moonray::shading::AttributeKeySet(),
-        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f));
+        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f), frustums);
     scene_rdl2::math::Xform3f p2r(scene_rdl2::math::one);
     geom->getProcedural()->generate(generateContext, {p2r});
 
@@ -231,8 +232,9 @@ void TestRenderingRT::testIntersectInstances()
     geom->applyUpdates();
 
     geom->loadProcedural();
+    const std::vector<moonray::mcrt_common::Frustum> frustums;
     GeomGenerateContext generateContext(nullptr, geom, moonray::shading::AttributeKeySet(),
-        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f));
+        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f), frustums);
     scene_rdl2::math::Xform3f p2r(scene_rdl2::math::one);
     geom->getProcedural()->generate(generateContext, {p2r});
 
@@ -364,8 +366,9 @@ void TestRenderingRT::testIntersectNestedInstances()
     geom->applyUpdates();
 
     geom->loadProcedural();
+    const std::vector<moonray::mcrt_common::Frustum> frustums;
     GeomGenerateContext generateContext(nullptr, geom, moonray::shading::AttributeKeySet(),
-        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f));
+        0, 1, moonray::geom::MotionBlurParams({0.f}, 0.f, 0.f, false, 24.f), frustums);
     scene_rdl2::math::Xform3f p2r(scene_rdl2::math::one);
     geom->getProcedural()->generate(generateContext, {p2r});
 
@@ -0,0 +1,196 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestRampControl.cc
+///
+
+#include "TestRampControl.h"
+
+#include <moonray/rendering/shading/RampControl.h>
+#include <scene_rdl2/common/math/Color.h>
+#include <scene_rdl2/common/math/Math.h>
+
+namespace moonray {
+namespace shading {
+
+using namespace scene_rdl2::math;
+
+namespace {
+
+const float sInputs[] = { 0.0f, 0.3f, 0.7f, 1.0f };
+const float sOutputs[] = { 0.0f, 1.0f, 0.2f, 0.8f };
+const Color sColors[] = { Color(1.0f, 0.0f, 0.0f), Color(0.2f, 0.9f, 0.1f),
+                          Color(0.0f, 0.1f, 1.0f), Color(0.9f, 0.8f, 0.2f) };
+
+const ispc::RampInterpolatorMode sContinuousModes[] = {
+    ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+    ispc::RAMP_INTERPOLATOR_MODE_EXPONENTIAL_UP,
+    ispc::RAMP_INTERPOLATOR_MODE_EXPONENTIAL_DOWN,
+    ispc::RAMP_INTERPOLATOR_MODE_SMOOTH,
+    ispc::RAMP_INTERPOLATOR_MODE_CATMULLROM,
+    ispc::RAMP_INTERPOLATOR_MODE_MONOTONECUBIC
+};
+
+const ispc::RampInterpolator2DType s2DTypes[] = {
+    ispc::RAMP_INTERPOLATOR_2D_TYPE_V_RAMP,
+    ispc::RAMP_INTERPOLATOR_2D_TYPE_DIAGONAL_RAMP,
+    ispc::RAMP_INTERPOLATOR_2D_TYPE_RADIAL_RAMP,
+    ispc::RAMP_INTERPOLATOR_2D_TYPE_CIRCULAR_RAMP,
+    ispc::RAMP_INTERPOLATOR_2D_TYPE_UxV_RAMP
+};
+
+// Positions past both ends of the ramp too
+constexpr int sNumSamples = 1000;
+
+float
+samplePosition(int i)
+{
+    return -0.2f + 1.4f * float(i) / float(sNumSamples - 1);
+}
+
+} // namespace
+
+void
+TestRampControl::testBakedFloatRamp()
+{
+    for (const ispc::RampInterpolatorMode mode : sContinuousModes) {
+        const ispc::RampInterpolatorMode modes[] = { mode, mode, mode, mode };
+
+        FloatRampControl exact;
+        exact.init(4, sInputs, sOutputs, modes);
+        FloatRampControl baked;
+        baked.init(4, sInputs, sOutputs, modes);
+        CPPUNIT_ASSERT(baked.bake());
+        CPPUNIT_ASSERT(baked.isBaked());
+        CPPUNIT_ASSERT(!exact.isBaked());
+
+        for (int i = 0; i < sNumSamples; ++i) {
+            const float t = samplePosition(i);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(exact.eval1D(t), baked.eval1D(t), 2e-3);
+        }
+        for (const ispc::RampInterpolator2DType type : s2DTypes) {
+            for (int i = 0; i < 100; ++i) {
+                const Vec2f uv(float(i % 10) / 9.0f, float(i / 10) / 9.0f);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(exact.eval2D(uv, type), baked.eval2D(uv, type), 2e-3);
+            }
+        }
+    }
+}
+
+void
+TestRampControl::testBakedColorRamp()
+{
+    const ispc::ColorRampControlSpace spaces[] = {
+        ispc::COLOR_RAMP_CONTROL_SPACE_RGB,
+        ispc::COLOR_RAMP_CONTROL_SPACE_HSV,
+        ispc::COLOR_RAMP_CONTROL_SPACE_HSL
+    };
+
+    for (const ispc::ColorRampControlSpace space : spaces) {
+        for (const ispc::RampInterpolatorMode mode : sContinuousModes) {
+            const ispc::RampInterpolatorMode modes[] = { mode, mode, mode, mode };
+
+            ColorRampControl exact;
+            exact.init(4, sInputs, sColors, modes, space);
+            ColorRampControl baked;
+            baked.init(4, sInputs, sColors, modes, space);
+            // Hue wrapping around between control points is a discontinuity
+            // of the table in HSV and HSL, those ramps may not be baked.
+            const bool isBaked = baked.bake();
+            CPPUNIT_ASSERT(isBaked || space != ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+
+            // Hue errors are amplified by the conversion back to RGB
+            const float tolerance = space == ispc::COLOR_RAMP_CONTROL_SPACE_RGB ? 2e-3f : 1e-2f;
+            for (int i = 0; i < sNumSamples; ++i) {
+                const float t = samplePosition(i);
+                CPPUNIT_ASSERT(isEqual(exact.eval1D(t), baked.eval1D(t), tolerance));
+            }
+            for (const ispc::RampInterpolator2DType type : s2DTypes) {
+                for (int i = 0; i < 100; ++i) {
+                    const Vec2f uv(float(i % 10) / 9.0f, float(i / 10) / 9.0f);
+                    CPPUNIT_ASSERT(isEqual(exact.eval2D(uv, type), baked.eval2D(uv, type), tolerance));
+                }
+            }
+        }
+    }
+}
+
+void
+TestRampControl::testExactFallback()
+{
+    FloatRampControl ramp;
+
+    // Steps
+    const ispc::RampInterpolatorMode noneModes[] = {
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+        ispc::RAMP_INTERPOLATOR_MODE_NONE,
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR
+    };
+    ramp.init(4, sInputs, sOutputs, noneModes);
+    CPPUNIT_ASSERT(!ramp.bake());
+    CPPUNIT_ASSERT(!ramp.isBaked());
+
+    // Zero length span
+    const float duplicateInputs[] = { 0.0f, 0.5f, 0.5f, 1.0f };
+    const ispc::RampInterpolatorMode linearModes[] = {
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR,
+        ispc::RAMP_INTERPOLATOR_MODE_LINEAR
+    };
+    ramp.init(4, duplicateInputs, sOutputs, linearModes);
+    CPPUNIT_ASSERT(!ramp.bake());
+
+    // Span too short for the table resolution
+    const float shortSpanInputs[] = { 0.0f, 0.5f, 0.5001f, 1.0f };
+    ramp.init(4, shortSpanInputs, sOutputs, linearModes);
+    CPPUNIT_ASSERT(!ramp.bake());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, ramp.eval1D(0.5f), 1e-6);
+
+    // Constant
+    ramp.init(1, sInputs, sOutputs, linearModes);
+    CPPUNIT_ASSERT(!ramp.bake());
+
+    // init() discards the table
+    ramp.init(4, sInputs, sOutputs, linearModes);
+    CPPUNIT_ASSERT(ramp.bake());
+    ramp.init(4, sInputs, sOutputs, linearModes);
+    CPPUNIT_ASSERT(!ramp.isBaked());
+}
+
+void
+TestRampControl::testCopy()
+{
+    const ispc::RampInterpolatorMode modes[] = {
+        ispc::RAMP_INTERPOLATOR_MODE_SMOOTH,
+        ispc::RAMP_INTERPOLATOR_MODE_SMOOTH,
+        ispc::RAMP_INTERPOLATOR_MODE_SMOOTH,
+        ispc::RAMP_INTERPOLATOR_MODE_SMOOTH
+    };
+
+    ColorRampControl ramp;
+    ramp.init(4, sInputs, sColors, modes, ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+    CPPUNIT_ASSERT(ramp.bake());
+
+    const ColorRampControl copy(ramp);
+    ColorRampControl assigned;
+    assigned = ramp;
+    CPPUNIT_ASSERT(copy.isBaked());
+    CPPUNIT_ASSERT(assigned.isBaked());
+
+    // The copies own their tables
+    ramp.init(4, sInputs, sColors, modes, ispc::COLOR_RAMP_CONTROL_SPACE_RGB);
+    for (int i = 0; i < sNumSamples; ++i) {
+        const float t = samplePosition(i);
+        CPPUNIT_ASSERT(isEqual(ramp.eval1D(t), copy.eval1D(t), 2e-3f));
+        CPPUNIT_ASSERT(isEqual(ramp.eval1D(t), assigned.eval1D(t), 2e-3f));
+    }
+}
+
+} // namespace shading
+} // namespace moonray
+
+CPPUNIT_TEST_SUITE_REGISTRATION(moonray::shading::TestRampControl);
+
@@ -0,0 +1,39 @@
+// Copyright 2023-2024 DreamWorks Animation LLC
+// SPDX-License-Identifier: Apache-2.0
+
+///
+/// @file TestRampControl.h
+///
+
+#pragma once
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestFixture.h>
+
+namespace moonray {
+namespace shading {
+
+///
+/// @class TestRampControl TestRampControl.h <shading/TestRampControl.h>
+/// @brief This class tests that baked ramps match the exact evaluation,
+/// and that ramps which can't be baked keep it
+///
+class TestRampControl : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(TestRampControl);
+    CPPUNIT_TEST(testBakedFloatRamp);
+    CPPUNIT_TEST(testBakedColorRamp);
+    CPPUNIT_TEST(testExactFallback);
+    CPPUNIT_TEST(testCopy);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testBakedFloatRamp();
+    void testBakedColorRamp();
+    void testExactFallback();
+    void testCopy();
+};
+
+} // namespace shading
+} // namespace moonray
+